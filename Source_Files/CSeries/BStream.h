@@ -24,6 +24,8 @@
 
 #include "cseries.h"
 #include <streambuf>
+#include <string.h>
+#include <vector>
 
 class basic_bstream
 {
@@ -121,4 +123,101 @@ public:
 	BOStream& operator<<(double value);
 };
 
+// Big endian, like BOStreamBE, but into memory that grows as it's written;
+// reserve enough up front and it never reallocates
+class BOBufferBE
+{
+public:
+	BOBufferBE(size_t reserve = 0) { data_.reserve(reserve); }
+
+	size_t tellp() const { return data_.size(); }
+	const std::vector<char>& data() const { return data_; }
+	void clear() { data_.clear(); }
+
+	BOBufferBE& operator<<(uint8 value) { data_.push_back(static_cast<char>(value)); return *this; }
+	BOBufferBE& operator<<(int8 value) { return operator<<(static_cast<uint8>(value)); }
+	BOBufferBE& operator<<(uint16 value) {
+		char bytes[2] = { char(value >> 8), char(value) };
+		return write(bytes, 2);
+	}
+	BOBufferBE& operator<<(int16 value) { return operator<<(static_cast<uint16>(value)); }
+	BOBufferBE& operator<<(uint32 value) {
+		char bytes[4] = { char(value >> 24), char(value >> 16), char(value >> 8), char(value) };
+		return write(bytes, 4);
+	}
+	BOBufferBE& operator<<(int32 value) { return operator<<(static_cast<uint32>(value)); }
+	BOBufferBE& operator<<(double value) {
+		Uint64 ivalue;
+		memcpy(&ivalue, &value, 8);
+		operator<<(static_cast<uint32>(ivalue >> 32));
+		return operator<<(static_cast<uint32>(ivalue));
+	}
+
+	BOBufferBE& write(const char *s, size_t n) { data_.insert(data_.end(), s, s + n); return *this; }
+
+	// Leaves room for a value that's only known later; returns where it goes
+	size_t reserve32() { data_.resize(data_.size() + 4); return data_.size() - 4; }
+	void patch32(size_t offset, uint32 value) {
+		data_[offset] = char(value >> 24);
+		data_[offset + 1] = char(value >> 16);
+		data_[offset + 2] = char(value >> 8);
+		data_[offset + 3] = char(value);
+	}
+
+private:
+	std::vector<char> data_;
+};
+
+// Reads what BOBufferBE or BOStreamBE wrote, from memory; read_view() hands
+// out the bytes in place instead of copying them. Throws
+// basic_bstream::failure when reading past the end
+class BIBufferBE
+{
+public:
+	BIBufferBE(const char *data, size_t length) : begin_(data), p_(data), end_(data + length) { }
+
+	size_t tellg() const { return p_ - begin_; }
+	size_t maxg() const { return end_ - begin_; }
+
+	BIBufferBE& operator>>(uint8& value) { value = static_cast<uint8>(*read_view(1)); return *this; }
+	BIBufferBE& operator>>(int8& value) { value = static_cast<int8>(*read_view(1)); return *this; }
+	BIBufferBE& operator>>(uint16& value) {
+		const uint8 *bytes = reinterpret_cast<const uint8 *>(read_view(2));
+		value = (uint16(bytes[0]) << 8) | uint16(bytes[1]);
+		return *this;
+	}
+	BIBufferBE& operator>>(int16& value) { uint16 uvalue; operator>>(uvalue); value = static_cast<int16>(uvalue); return *this; }
+	BIBufferBE& operator>>(uint32& value) {
+		const uint8 *bytes = reinterpret_cast<const uint8 *>(read_view(4));
+		value = (uint32(bytes[0]) << 24) | (uint32(bytes[1]) << 16) | (uint32(bytes[2]) << 8) | uint32(bytes[3]);
+		return *this;
+	}
+	BIBufferBE& operator>>(int32& value) { uint32 uvalue; operator>>(uvalue); value = static_cast<int32>(uvalue); return *this; }
+	BIBufferBE& operator>>(double& value) {
+		uint32 high, low;
+		operator>>(high);
+		operator>>(low);
+		Uint64 ivalue = (Uint64(high) << 32) | low;
+		memcpy(&value, &ivalue, 8);
+		return *this;
+	}
+
+	BIBufferBE& read(char *s, size_t n) { memcpy(s, read_view(n), n); return *this; }
+	BIBufferBE& ignore(size_t n) { read_view(n); return *this; }
+
+	// The next n bytes, valid as long as the memory read from is
+	const char *read_view(size_t n) {
+		if (static_cast<size_t>(end_ - p_) < n)
+			throw basic_bstream::failure("serialization bound check failed");
+		const char *bytes = p_;
+		p_ += n;
+		return bytes;
+	}
+
+private:
+	const char *begin_;
+	const char *p_;
+	const char *end_;
+};
+
 #endif
@@ -32,6 +32,7 @@ static FilmProfile alephone1_2 = {
 	true, // m1_low_gravity_projectiles
 	true, // m1_buggy_repair_goal
 	false, // find_action_key_target_has_side_effects
+	true, // monster_ai_stride
 };
 
 static FilmProfile alephone1_1 = {
@@ -64,6 +65,7 @@ static FilmProfile alephone1_1 = {
 	false, // m1_low_gravity_projectiles
 	false, // m1_buggy_repair_goal
 	true, // find_action_key_target_has_side_effects
+	false, // monster_ai_stride
 };
 
 static FilmProfile alephone1_0 = {
@@ -96,6 +98,7 @@ static FilmProfile alephone1_0 = {
 	false, // m1_low_gravity_projectiles
 	false, // m1_buggy_repair_goal
 	true, // find_action_key_target_has_side_effects
+	false, // monster_ai_stride
 };
 
 static FilmProfile marathon2 = {
@@ -128,6 +131,7 @@ static FilmProfile marathon2 = {
 	false, // m1_low_gravity_projectiles
 	false, // m1_buggy_repair_goal
 	false, // find_action_key_target_has_side_effects
+	false, // monster_ai_stride
 };
 
 static FilmProfile marathon_infinity = {
@@ -160,6 +164,7 @@ static FilmProfile marathon_infinity = {
 	false, // m1_low_gravity_projectiles
 	false, // m1_buggy_repair_goal
 	false, // find_action_key_target_has_side_effects
+	false, // monster_ai_stride
 };
 
 FilmProfile film_profile = alephone1_2;
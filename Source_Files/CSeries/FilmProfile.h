@@ -95,6 +95,10 @@ struct FilmProfile
 	bool m1_low_gravity_projectiles;
 	bool m1_buggy_repair_goal;
 	bool find_action_key_target_has_side_effects;
+
+	// Aleph One 1.2 lets scenarios have monsters far from every player
+	// think on a stride (MML <monsters><ai_stride/>)
+	bool monster_ai_stride;
 };
 
 extern FilmProfile film_profile;
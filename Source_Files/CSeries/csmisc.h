@@ -22,10 +22,17 @@
 #define _CSERIES_MISC_
 
 #include "cstypes.h"
+#include <stdint.h>
 
 #define MACHINE_TICKS_PER_SECOND 1000
 
 extern uint32 machine_tick_count(void);
+
+// Returns once SDL_GetPerformanceCounter() reaches the count: sleeps while
+// there is time to spare, then spins out the last couple of milliseconds,
+// which a sleep could overrun
+extern void wait_for_performance_count(uint64_t count);
+
 extern bool wait_for_click_or_keypress(
 	uint32 ticks);
 
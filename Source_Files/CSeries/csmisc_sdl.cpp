@@ -37,6 +37,25 @@ uint32 machine_tick_count(void)
 }
 
 
+/*
+ *  Wait for a high-resolution time
+ */
+
+// How long before the time to stop sleeping
+const uint32 PRECISE_WAIT_SPIN_MS = 2;
+
+void wait_for_performance_count(uint64_t count)
+{
+	const uint64_t frequency = SDL_GetPerformanceFrequency();
+	const uint64_t spin = frequency * PRECISE_WAIT_SPIN_MS / 1000;
+	uint64_t now;
+	while ((now = SDL_GetPerformanceCounter()) < count) {
+		if (count - now > spin)
+			SDL_Delay(uint32((count - now - spin) * 1000 / frequency));
+	}
+}
+
+
 /*
  *  Wait for mouse click or keypress
  */
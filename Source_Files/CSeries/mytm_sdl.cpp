@@ -28,14 +28,18 @@
  *
  *  14 January 2003 (Woody Zenfell): TMTasks lock each other out while running (better models
  *      Time Manager behavior, so makes code safer).  Also removed missedDeadline stuff.
+ *
+ *  2026: every TMTask runs on one scheduler thread, each due a period after it was last due
+ *      on the high-resolution counter; late calls are counted per task and logged at cleanup.
  */
 
 // The implementation is built on SDL_thread, and approximates the Time Manager behavior.
 // Obviously, it's not a perfect emulation.  :)
-// In particular, though TMTasks now lock one another out (as they should), TMTasks do not
-// (cannot?) effectively lock out the main thread (as they would in Mac OS 9)... but, their
-// threads ought to be higher-priority than the main thread, which means that as long as they
-// don't block (which they shouldn't anyway), the main thread will not run while they do.
+// All TMTasks run on one scheduler thread, which sleeps until the earliest of them is due, so
+// they lock one another out (as they should) without more than one thread.  They do not
+// (cannot?) effectively lock out the main thread (as they would in Mac OS 9)... but the
+// scheduler thread ought to be higher-priority than the main thread, which means that as long
+// as tasks don't block (which they shouldn't anyway), the main thread will not run while they do.
 
 // I probably would have made life easier for myself by using SDL_timer instead, but frankly
 // the documentation does not inspire me to trust it.  I'll do things on my own.
@@ -71,13 +75,15 @@ struct myTMTask_profile {
 #endif
 
 // Housekeeping structure used in setup, teardown, and execution
+// Everything but mPeriod and mFunction is guarded by sSchedulerMutex.
 struct myTMTask {
-    SDL_Thread*		mThread;
     uint32		mPeriod;
     bool 		(*mFunction)(void);
-    volatile bool	mKeepRunning;	// set true by myTMSetup; set false by thread or by myTMRemove.
-    volatile bool	mIsRunning;	// set true by myTMSetup; set false by thread when about to exit.
-    volatile uint32	mResetTime;	// set positive by myTMReset; set to 0 by myTMSetup or by thread.
+    bool		mKeepRunning;	// set true by myTMSetup; set false by the scheduler or by myTMRemove.
+    bool		mIsRunning;	// set true by myTMSetup; set false by the scheduler when it stops calling.
+    uint64_t		mDueTime;	// next call, in performance counts
+    uint32		mNumLateCalls;	// calls that were due before the last one returned
+    uint32		mMaxLateness;	// ms
 #ifdef DEBUG
     myTMTask_profile	mProfilingData;
 #endif
@@ -86,22 +92,29 @@ struct myTMTask {
 // Only one TMTask should be scheduled at any given time, so they take this mutex.
 static SDL_mutex* sTMTaskMutex = NULL;
 
+// The scheduler: its thread, what it schedules and the task it's calling, if any
+static SDL_mutex* sSchedulerMutex = NULL;
+static SDL_cond* sSchedulerChanged = NULL;
+static SDL_Thread* sSchedulerThread = NULL;
+static myTMTaskPtr sCallingTask = NULL;
+
+static vector<myTMTaskPtr> sOutstandingTasks;
 
 void
 mytm_initialize() {
     // XXX should provide a way to destroy the mutex too - currently we rely on process exit to do that.
     if(sTMTaskMutex == NULL) {
         sTMTaskMutex = SDL_CreateMutex();
-        
+        sSchedulerMutex = SDL_CreateMutex();
+        sSchedulerChanged = SDL_CreateCond();
         //logCheckWarn0(sTMTaskMutex != NULL, "unable to create mytm mutex lock");
-        if(sTMTaskMutex == NULL)
+        if(sTMTaskMutex == NULL || sSchedulerMutex == NULL || sSchedulerChanged == NULL)
             logWarning("unable to create mytm mutex lock");
     }
     else
         logAnomaly("multiple invocations of mytm_initialize()");
 }
 
-
 // The logging system is not (currently) thread-safe, so these logging calls are potentially a Bad Idea
 // but if something's going wrong already, maybe it wouldn't hurt to take a small risk to shed some light.
 bool
@@ -112,8 +125,6 @@ take_mytm_mutex() {
     return success;
 }
 
-
-
 bool
 release_mytm_mutex() {
     bool success = (SDL_UnlockMutex(sTMTaskMutex) != -1);
@@ -122,129 +133,115 @@ release_mytm_mutex() {
     return success;
 }
 
+// Converts a period in ms to performance counts
+static uint64_t
+counts_for_ms(uint64_t inMilliseconds) {
+    return inMilliseconds * SDL_GetPerformanceFrequency() / 1000;
+}
 
+// Call with sSchedulerMutex held; the task due soonest, or NULL if none are running
+static myTMTaskPtr
+next_due_task() {
+    myTMTaskPtr theNextTask = NULL;
+    for(vector<myTMTaskPtr>::iterator i = sOutstandingTasks.begin(); i != sOutstandingTasks.end(); ++i) {
+        if((*i)->mIsRunning && (theNextTask == NULL || (*i)->mDueTime < theNextTask->mDueTime))
+            theNextTask = *i;
+    }
+    return theNextTask;
+}
 
-// Function that threads execute - does housekeeping and calls user callback
-// Tries to be drift-free.
+// What the scheduler thread runs: waits for the next task to fall due and calls it.
+// Tries to be drift-free: each call is scheduled a period after the last one was due
+// (not after it actually ran), and a call that runs late is made up for by the next ones
+// coming sooner.  Waits shorter than a couple of ms are finished off by
+// wait_for_performance_count() rather than a bare timed wait, which can oversleep.
 static int
-thread_loop(void* inData) {
-    myTMTask*	theTMTask	= (myTMTask*) inData;
-    
-    uint32	theLastRunTime	= SDL_GetTicks();
-    uint32	theCurrentRunTime;
-    int32	theDrift	= 0;
-
-#ifdef DEBUG
-    theTMTask->mProfilingData.mStartTime	= theLastRunTime;
-#endif
-
-    while(theTMTask->mKeepRunning) {
-        // Delay, unless we're at least a period behind schedule
-        // Originally, I didn't compute theDelay explicitly as a signed quantity, which
-        // made for some VERY long waits if we were running late...
-        int32	theDelay 	= theTMTask->mPeriod - theDrift;
-        if(theDelay > 0)
-            SDL_Delay(theDelay);
-        else {
-            // We missed a deadline!
-#ifdef DEBUG
-            theTMTask->mProfilingData.mNumLateCalls++;
-#endif                
+scheduler_loop(void*) {
+    const uint32 kSpinMilliseconds = 2;
+    const uint64_t theFrequency = SDL_GetPerformanceFrequency();
+
+    SDL_LockMutex(sSchedulerMutex);
+    for(;;) {
+        myTMTaskPtr theTask = next_due_task();
+        if(theTask == NULL) {
+            SDL_CondWait(sSchedulerChanged, sSchedulerMutex);
+            continue;
         }
-        
-        // If a reset was requested, pretend we were last called at the reset time, clear the reset,
-        // and delay some more if needed.
-        // Note: this is a "while" so, in case another reset comes while we are in the Delay() inside
-        // this block, we wait longer.
-        while(theTMTask->mResetTime > 0) {
-            theLastRunTime	= theTMTask->mResetTime;
-            theTMTask->mResetTime = 0;
-            
-#ifdef DEBUG
-            theTMTask->mProfilingData.mNumWarmResets++;
-            theTMTask->mProfilingData.mStartTime		= theLastRunTime;
-            theTMTask->mProfilingData.mNumCallsThisReset	= 0;
-#endif
-
-            theCurrentRunTime	= SDL_GetTicks();
-            theDrift		+= theCurrentRunTime - theLastRunTime - theTMTask->mPeriod;
-            theLastRunTime	= theCurrentRunTime;
 
-#ifdef DEBUG
-            if(theDrift < theTMTask->mProfilingData.mDriftMin)
-                theTMTask->mProfilingData.mDriftMin	= theDrift;
-
-            if(theDrift > theTMTask->mProfilingData.mDriftMax)
-                theTMTask->mProfilingData.mDriftMax	= theDrift;
-#endif
-            
-            theDelay = theTMTask->mPeriod - theDrift;
-            
-            if(theDelay > 0)
-                SDL_Delay(theDelay);
+        uint64_t theNow = SDL_GetPerformanceCounter();
+        if(theNow < theTask->mDueTime) {
+            uint32 theWait = uint32((theTask->mDueTime - theNow) * 1000 / theFrequency);
+            if(theWait > kSpinMilliseconds)
+                SDL_CondWaitTimeout(sSchedulerChanged, sSchedulerMutex, theWait - kSpinMilliseconds);
             else {
-                // We did miss a deadline!
-#ifdef DEBUG
-                theTMTask->mProfilingData.mNumLateCalls++;
-#endif                
+                SDL_UnlockMutex(sSchedulerMutex);
+                wait_for_performance_count(theTask->mDueTime);
+                SDL_LockMutex(sSchedulerMutex);
             }
+            // Tasks may have been added, reset or removed meanwhile
+            continue;
         }
-    
-	theCurrentRunTime	= SDL_GetTicks();
-	theDrift		+= theCurrentRunTime - theLastRunTime - theTMTask->mPeriod;
-        theLastRunTime		= theCurrentRunTime;
 
+        // Anything due before the last call returned is a missed deadline
+        uint32 theLateness = uint32((theNow - theTask->mDueTime) * 1000 / theFrequency);
+        if(theLateness > 0) {
+            theTask->mNumLateCalls++;
+            theTask->mMaxLateness = std::max(theTask->mMaxLateness, theLateness);
 #ifdef DEBUG
-        if(theDrift < theTMTask->mProfilingData.mDriftMin)
-            theTMTask->mProfilingData.mDriftMin	= theDrift;
-
-        if(theDrift > theTMTask->mProfilingData.mDriftMax)
-            theTMTask->mProfilingData.mDriftMax	= theDrift;
+            theTask->mProfilingData.mNumLateCalls++;
+#endif
+        }
+#ifdef DEBUG
+        int32	theDrift	= int32((int64_t(theNow) - int64_t(theTask->mDueTime)) * 1000 / int64_t(theFrequency));
+        if(theDrift < theTask->mProfilingData.mDriftMin)
+            theTask->mProfilingData.mDriftMin	= theDrift;
+        if(theDrift > theTask->mProfilingData.mDriftMax)
+            theTask->mProfilingData.mDriftMax	= theDrift;
+        theTask->mProfilingData.mNumCallsThisReset++;
+        theTask->mProfilingData.mNumCallsTotal++;
 #endif
+        theTask->mDueTime += counts_for_ms(theTask->mPeriod);
 
-        // Since we've been delayed for a while, double-check that we still want to run.
-        if(theTMTask->mKeepRunning == false)
-            break;
-        
-        // NOTE: since we could be preempted between checking for termination and actually calling the
-        // callback, there is a VERY small chance that mFunction could be called (at most once) after 
-        // myTMRemoveTask() completes.  This is a BUG, but to avoid expensive synchronization (making
-        // myTMRemoveTask() block until this thread finishes, protecting mKeepRunning with a mutex, etc.)
-        // we take our chances.  This bug could only bite anyway (in the current IPring) while making the
-        // transition from a normal player to the gatherer (in drop_upring_player()) as a result of the
-        // gatherer becoming netdead - not terribly likely to begin with!
-        
-        // Call the function.  If it doesn't want to be rescheduled, stop ourselves.
+        // Double-check that it still wants to run.
+        if(theTask->mKeepRunning == false) {
+            theTask->mIsRunning = false;
 #ifdef DEBUG
-        theTMTask->mProfilingData.mNumCallsThisReset++;
-        theTMTask->mProfilingData.mNumCallsTotal++;
+            theTask->mProfilingData.mFinishTime	= SDL_GetTicks();
 #endif
+            SDL_CondBroadcast(sSchedulerChanged);
+            continue;
+        }
 
-        bool runAgain = true;
+        // NOTE: since the task could be removed between the check above and the call below, there
+        // is a VERY small chance that mFunction could be called (at most once) after myTMRemove()
+        // returns.  myTMCleanup(true) does wait for that call to finish.
+        sCallingTask = theTask;
+        SDL_UnlockMutex(sSchedulerMutex);
 
-        // Lock out other tmtasks while we run ours
+        // Call the function, locking out the main thread's use of the mutex.
+        // If it doesn't want to be rescheduled, stop it.
+        bool runAgain = true;
         if(take_mytm_mutex()) {
-            runAgain = theTMTask->mFunction();
+            runAgain = theTask->mFunction();
             release_mytm_mutex();
         }
-        
-        if(!runAgain)
-            break;
-    }
-    
-    theTMTask->mIsRunning = false;
-    
+
+        SDL_LockMutex(sSchedulerMutex);
+        sCallingTask = NULL;
+        if(!runAgain) {
+            theTask->mKeepRunning = false;
+            theTask->mIsRunning = false;
 #ifdef DEBUG
-    theTMTask->mProfilingData.mFinishTime	= SDL_GetTicks();
+            theTask->mProfilingData.mFinishTime	= SDL_GetTicks();
 #endif
-    
+        }
+        SDL_CondBroadcast(sSchedulerChanged);
+    }
+    SDL_UnlockMutex(sSchedulerMutex);
+
     return 0;
 }
 
-
-static vector<myTMTaskPtr> sOutstandingTasks;
-
-
 // Set up a periodic callout with no anti-drift mechanisms.  (We don't support that,
 // but it's unlikely that anyone is counting on NOT having drift-correction?)
 myTMTaskPtr
@@ -256,33 +253,41 @@ myTMSetup(int32 time, bool (*func)(void)) {
 myTMTaskPtr
 myXTMSetup(int32 time, bool (*func)(void)) {
     myTMTaskPtr	theTask = new myTMTask;
-    
     theTask->mPeriod		= time;
     theTask->mFunction		= func;
     theTask->mKeepRunning	= true;
     theTask->mIsRunning		= true;
-    theTask->mResetTime		= 0;
-    
+    theTask->mDueTime		= SDL_GetPerformanceCounter() + counts_for_ms(time);
+    theTask->mNumLateCalls	= 0;
+    theTask->mMaxLateness	= 0;
 #ifdef DEBUG
     obj_clear(theTask->mProfilingData);
+    theTask->mProfilingData.mStartTime	= SDL_GetTicks();
 #endif
-    
-    theTask->mThread		= SDL_CreateThread(thread_loop, "myXTMSetup_taskThread", theTask);
 
-    // Set thread priority a little higher
-    BoostThreadPriority(theTask->mThread);
-    
+    SDL_LockMutex(sSchedulerMutex);
     sOutstandingTasks.push_back(theTask);
-    
+    if(sSchedulerThread == NULL) {
+        sSchedulerThread	= SDL_CreateThread(scheduler_loop, "myTM_scheduler", NULL);
+        // Set thread priority a little higher
+        BoostThreadPriority(sSchedulerThread);
+    }
+    SDL_CondBroadcast(sSchedulerChanged);
+    SDL_UnlockMutex(sSchedulerMutex);
+
     return theTask;
 }
 
 // Stop an existing callout from executing.
 myTMTaskPtr
 myTMRemove(myTMTaskPtr task) {
-    if(task != NULL)
+    if(task != NULL) {
+        SDL_LockMutex(sSchedulerMutex);
         task->mKeepRunning	= false;
-    
+        SDL_CondBroadcast(sSchedulerChanged);
+        SDL_UnlockMutex(sSchedulerMutex);
+    }
+
     return NULL;
 }
 
@@ -291,32 +296,21 @@ myTMRemove(myTMTaskPtr task) {
 void
 myTMReset(myTMTaskPtr task) {
     if(task != NULL) {
-        // If the thread has not exited, we can message it.  NOTE: there is a small possibility
-        // that the thread has already broken its loop, but got preempted before it could set
-        // mIsRunning to false.  I'm going to take the easy lazy evil way out and just hope that
-        // doesn't happen.
-        if(task->mIsRunning)
-            task->mResetTime	= SDL_GetTicks();
-        
-        // Otherwise, we need to start a new thread for the task.
-        else {
-            // This is our only chance to clean up that zombie thread.  This should not block.
-            SDL_WaitThread(task->mThread, NULL);
-            
-            task->mKeepRunning	= true;
-            task->mIsRunning	= true;
-            task->mResetTime	= 0;
-            
+        SDL_LockMutex(sSchedulerMutex);
 #ifdef DEBUG
+        if(task->mIsRunning)
+            task->mProfilingData.mNumWarmResets++;
+        else
             task->mProfilingData.mNumResuscitations++;
-            task->mProfilingData.mNumCallsThisReset = 0;
+        task->mProfilingData.mStartTime		= SDL_GetTicks();
+        task->mProfilingData.mNumCallsThisReset	= 0;
 #endif
-            
-            task->mThread	= SDL_CreateThread(thread_loop, "myTMReset_taskThread", task);
-
-            // Set thread priority a little higher
-            BoostThreadPriority(task->mThread);
-        }
+        // Whether or not it had stopped, it's next due a period from now
+        task->mKeepRunning	= true;
+        task->mIsRunning	= true;
+        task->mDueTime		= SDL_GetPerformanceCounter() + counts_for_ms(task->mPeriod);
+        SDL_CondBroadcast(sSchedulerChanged);
+        SDL_UnlockMutex(sSchedulerMutex);
     }
 }
 
@@ -343,28 +337,41 @@ myTMDumpProfile(myTMTask* inTask) {
 }
 #endif//DEBUG
 
-// ZZZ addition: clean up outstanding timer task blocks and threads
+// ZZZ addition: clean up outstanding timer task blocks
 // This could be slightly more efficient maybe by using a list, condensing calls to erase(), etc...
 // but why bother?  It's only used occasionally at non-time-critical moments, and we're only dealing with
 // a small handful of (small) elements anyway.
+// The scheduler thread itself stays, waiting for the next task to be set up.
 void
 myTMCleanup(bool inWaitForFinishers) {
-    vector<myTMTaskPtr>::iterator	i;
-
-    for(i = sOutstandingTasks.begin(); i != sOutstandingTasks.end(); ++i) {
-        if((*i)->mKeepRunning == false && (inWaitForFinishers || (*i)->mIsRunning == false)) {
-            myTMTaskPtr	theDeadTask = *i;
-            
-            // This does the right thing: i is sent to erase(), but before erase is called, i is decremented so
-            // the iterator remains valid.
-            sOutstandingTasks.erase(i--);
-            
+    vector<myTMTaskPtr>	theDeadTasks;
+
+    SDL_LockMutex(sSchedulerMutex);
+    // By index, since waiting lets others add tasks
+    for(size_t i = 0; i < sOutstandingTasks.size(); ) {
+        myTMTaskPtr	theTask = sOutstandingTasks[i];
+        // A removed task is never called again, but its last call may still be under way
+        if(theTask->mKeepRunning == false && inWaitForFinishers && sCallingTask == theTask) {
+            SDL_CondWait(sSchedulerChanged, sSchedulerMutex);
+            continue;
+        }
+        if(theTask->mKeepRunning == false && sCallingTask != theTask) {
+            theTask->mIsRunning = false;
+            theDeadTasks.push_back(theTask);
+            sOutstandingTasks.erase(sOutstandingTasks.begin() + i);
+        }
+        else
+            ++i;
+    }
+    SDL_UnlockMutex(sSchedulerMutex);
+
+    for(vector<myTMTaskPtr>::iterator i = theDeadTasks.begin(); i != theDeadTasks.end(); ++i) {
+        myTMTaskPtr	theDeadTask = *i;
+        if(theDeadTask->mNumLateCalls > 0)
+            logNote("timer task %p ran late %u times, by up to %u ms", theDeadTask->mFunction, theDeadTask->mNumLateCalls, theDeadTask->mMaxLateness);
 #ifdef DEBUG
-            myTMDumpProfile(theDeadTask);
+        myTMDumpProfile(theDeadTask);
 #endif  
-
-            SDL_WaitThread(theDeadTask->mThread, NULL);
-            delete theDeadTask;
-        }
+        delete theDeadTask;
     }
 }
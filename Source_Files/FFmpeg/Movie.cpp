@@ -40,9 +40,11 @@
 
 #ifdef HAVE_OPENGL
 #include "OGL_Headers.h"
+#include "OGL_Setup.h"
 #endif
 
 #include "Movie.h"
+#include "Trace.h"
 #include "interface.h"
 #include "screen.h"
 #include "Mixer.h"
@@ -60,6 +62,7 @@ void Movie::PromptForRecording() {}
 void Movie::StartRecording(std::string path) {}
 bool Movie::IsRecording() { return false; }
 void Movie::StopRecording() {}
+void Movie::StartBatchExport(std::string path) {}
 void Movie::AddFrame(FrameType ftype) {}
 
 bool Movie::Setup() { return false; }
@@ -67,7 +70,10 @@ int Movie::Movie_EncodeThread(void *arg) { return 0; }
 void Movie::EncodeThread() {}
 void Movie::EncodeVideo(bool last) {}
 void Movie::EncodeAudio(bool last) {}
-Movie::Movie() {}
+void Movie::MixAudio(std::vector<uint8>& audio) {}
+void Movie::CollectReadback(int index) {}
+void Movie::QueueFrame() {}
+Movie::Movie() : batch_export(false) {}
 
 #else
 
@@ -318,7 +324,10 @@ int ScaleQuality(int quality, int zeroLevel, int fiftyLevel, int hundredLevel)
 
 Movie::Movie() :
   moviefile(""),
-  temp_surface(NULL),
+  batch_export(false),
+  fill_slot(0),
+  encode_slot(0),
+  readback_index(0),
   av(NULL),
   encodeThread(NULL),
   encodeReady(NULL),
@@ -327,6 +336,17 @@ Movie::Movie() :
 {
     av = new libav_vars_t;
     memset(av, 0, sizeof(libav_vars_t));
+    
+    for (int i = 0; i < FRAME_SLOTS; i++)
+    {
+        slots[i].surface = NULL;
+        slots[i].upside_down = false;
+    }
+    for (int i = 0; i < READBACK_BUFFERS; i++)
+    {
+        readback[i] = 0;
+        readback_pending[i] = false;
+    }
 }
 
 void Movie::PromptForRecording()
@@ -344,6 +364,12 @@ void Movie::StartRecording(std::string path)
 	SDL_PauseAudio(IsRecording());
 }
 
+void Movie::StartBatchExport(std::string path)
+{
+	batch_export = true;
+	StartRecording(path);
+}
+
 bool Movie::IsRecording()
 {
   return (moviefile.length() > 0);
@@ -370,11 +396,32 @@ bool Movie::Setup()
 	view_rect.w *= scr->pixel_scale();
 	view_rect.h *= scr->pixel_scale();
 
-	temp_surface = SDL_CreateRGBSurface(SDL_SWSURFACE, view_rect.w, view_rect.h, 32,
-										0x00ff0000, 0x0000ff00, 0x000000ff,
-										0);
-	success = (temp_surface != NULL);
-	if (!success) err_msg = "Could not create SDL surface";
+	fill_slot = encode_slot = 0;
+	for (int i = 0; success && i < FRAME_SLOTS; i++)
+	{
+		slots[i].pixels.resize(view_rect.w * view_rect.h * 4);
+		slots[i].upside_down = false;
+		slots[i].surface = SDL_CreateRGBSurfaceFrom(&slots[i].pixels.front(), view_rect.w, view_rect.h, 32, view_rect.w * 4,
+													0x00ff0000, 0x0000ff00, 0x000000ff,
+													0);
+		success = (slots[i].surface != NULL);
+		if (!success) err_msg = "Could not create SDL surface";
+	}
+	
+#ifdef HAVE_OPENGL
+	readback_index = 0;
+	if (success && MainScreenIsOpenGL() && OGL_CheckExtension("GL_ARB_pixel_buffer_object"))
+	{
+		glGenBuffersARB(READBACK_BUFFERS, readback);
+		for (int i = 0; i < READBACK_BUFFERS; i++)
+		{
+			glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, readback[i]);
+			glBufferDataARB(GL_PIXEL_PACK_BUFFER_ARB, view_rect.w * view_rect.h * 4, NULL, GL_STREAM_READ_ARB);
+			readback_pending[i] = false;
+		}
+		glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, 0);
+	}
+#endif
 
     Mixer *mx = Mixer::instance();
     
@@ -544,7 +591,7 @@ bool Movie::Setup()
     // initialize conversion context
     if (success)
     {
-        av->sws_ctx = sws_getContext(temp_surface->w, temp_surface->h, AV_PIX_FMT_RGB32,
+        av->sws_ctx = sws_getContext(view_rect.w, view_rect.h, AV_PIX_FMT_RGB32,
                                      video_stream->codec->width,
                                      video_stream->codec->height,
                                      video_stream->codec->pix_fmt,
@@ -565,13 +612,15 @@ bool Movie::Setup()
     // set up our threads and intermediate storage
     if (success)
     {
-        videobuf.resize(av->video_bufsize);
-        audiobuf.resize(2 * 2 * mx->obtained.freq / 30);
+        for (int i = 0; i < FRAME_SLOTS; i++)
+            slots[i].audio.resize(2 * 2 * mx->obtained.freq / 30);
+        for (int i = 0; i < READBACK_BUFFERS; i++)
+            readback_audio[i].resize(2 * 2 * mx->obtained.freq / 30);
 	}
 	if (success)
 	{
 		encodeReady = SDL_CreateSemaphore(0);
-		fillReady = SDL_CreateSemaphore(1);
+		fillReady = SDL_CreateSemaphore(FRAME_SLOTS);
 		stillEncoding = true;
 		success = encodeReady && fillReady;
 		if (!success) err_msg = "Could not create movie thread semaphores";
@@ -590,6 +639,12 @@ bool Movie::Setup()
 		full_msg += err_msg;
 		full_msg += ".)";
         logError(full_msg.c_str());
+		if (batch_export)
+		{
+			// no one is there to see an alert
+			printf("%s\n", full_msg.c_str());
+			exit(1);
+		}
 		alert_user(full_msg.c_str());
 	}
     av->inited = success;
@@ -611,10 +666,19 @@ void Movie::EncodeVideo(bool last)
     AVFrame *frame = NULL;
     if (!last)
     {
-        int pitch[] = { temp_surface->pitch, 0 };
-        const uint8_t *const pdata[] = { reinterpret_cast<uint8_t *>(temp_surface->pixels), NULL };
+        // the conversion flips OpenGL frames, with a negative pitch
+        FrameSlot& slot = slots[encode_slot];
+        int row_bytes = view_rect.w * 4;
+        const uint8_t *pixels = &slot.pixels.front();
+        if (slot.upside_down)
+        {
+            pixels += row_bytes * (view_rect.h - 1);
+            row_bytes = -row_bytes;
+        }
+        int pitch[] = { row_bytes, 0 };
+        const uint8_t *const pdata[] = { pixels, NULL };
     
-        sws_scale(av->sws_ctx, pdata, pitch, 0, temp_surface->h,
+        sws_scale(av->sws_ctx, pdata, pitch, 0, view_rect.h,
                   av->video_frame->data, av->video_frame->linesize);
         av->video_frame->pts = av->video_counter++;
         frame = av->video_frame;
@@ -655,7 +719,11 @@ void Movie::EncodeAudio(bool last)
     AVCodecContext *acodec = astream->codec;
     
     
-    av_fifo_generic_write(av->audio_fifo, &audiobuf[0], audiobuf.size(), NULL);
+    if (!last)
+    {
+        std::vector<uint8>& audio = slots[encode_slot].audio;
+        av_fifo_generic_write(av->audio_fifo, &audio[0], audio.size(), NULL);
+    }
     
     // bps: bytes per sample
     int channels = acodec->channels;
@@ -771,9 +839,13 @@ void Movie::EncodeThread()
 			return;
 		}
         
+        Tracer::NameThread("movie encoder");
+        TRACE_SPAN("encode frame");
+
         // add video and audio
         EncodeVideo(false);
         EncodeAudio(false);
+		encode_slot = (encode_slot + 1) % FRAME_SLOTS;
 		
 		SDL_SemPost(fillReady);
 	}
@@ -794,39 +866,111 @@ void Movie::AddFrame(FrameType ftype)
 	if (ftype == FRAME_FADE && get_keyboard_controller_status())
 		return;
 	
-	SDL_SemWait(fillReady);
-  	
 	if (!MainScreenIsOpenGL())
 	{
+		SDL_SemWait(fillReady);
 		SDL_Surface *video = MainScreenSurface();
-		SDL_BlitSurface(video, &view_rect, temp_surface, NULL);
+		SDL_BlitSurface(video, &view_rect, slots[fill_slot].surface, NULL);
+		slots[fill_slot].upside_down = false;
+		MixAudio(slots[fill_slot].audio);
+		QueueFrame();
 	}
 #ifdef HAVE_OPENGL
+	else if (readback[0])
+	{
+		// Finish the read from when this buffer was last used,
+		// then start this frame's
+		int index = readback_index;
+		if (readback_pending[index])
+			CollectReadback(index);
+		
+		glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, readback[index]);
+		glReadPixels(view_rect.x, view_rect.y, view_rect.w, view_rect.h, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, NULL);
+		glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, 0);
+		MixAudio(readback_audio[index]);
+		readback_pending[index] = true;
+		readback_index = (index + 1) % READBACK_BUFFERS;
+	}
 	else
 	{
 		// Read OpenGL frame buffer
-		glReadPixels(view_rect.x, view_rect.y, view_rect.w, view_rect.h, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, &videobuf.front());
-		
-		// Copy pixel buffer (which is upside-down) to surface
-		for (int y = 0; y < view_rect.h; y++)
-			memcpy((uint8 *)temp_surface->pixels + temp_surface->pitch * y, &videobuf.front() + view_rect.w * 4 * (view_rect.h - y - 1), view_rect.w * 4);
+		SDL_SemWait(fillReady);
+		glReadPixels(view_rect.x, view_rect.y, view_rect.w, view_rect.h, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, &slots[fill_slot].pixels.front());
+		slots[fill_slot].upside_down = true;
+		MixAudio(slots[fill_slot].audio);
+		QueueFrame();
 	}
 #endif
-	
-	int audio_bytes_per_frame = audiobuf.size();
+}
+
+void Movie::MixAudio(std::vector<uint8>& audio)
+{
+	int audio_bytes_per_frame = audio.size();
 	Mixer *mx = Mixer::instance();
 	int old_vol = mx->main_volume;
 	mx->main_volume = 0x100;
-	mx->Mix(&audiobuf.front(), audio_bytes_per_frame / 4, true, true, true);
+	mx->Mix(&audio.front(), audio_bytes_per_frame / 4, true, true, true);
 	mx->main_volume = old_vol;
+}
+
+// Copies a finished read into the next free slot, with its audio
+void Movie::CollectReadback(int index)
+{
+#ifdef HAVE_OPENGL
+	SDL_SemWait(fillReady);
+	FrameSlot& slot = slots[fill_slot];
+	
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, readback[index]);
+	void *pixels = glMapBufferARB(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB);
+	if (pixels)
+	{
+		memcpy(&slot.pixels.front(), pixels, slot.pixels.size());
+		glUnmapBufferARB(GL_PIXEL_PACK_BUFFER_ARB);
+	}
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, 0);
+	slot.upside_down = true;
+	slot.audio.swap(readback_audio[index]);
+	readback_pending[index] = false;
 	
+	QueueFrame();
+#endif
+}
+
+void Movie::QueueFrame()
+{
+	fill_slot = (fill_slot + 1) % FRAME_SLOTS;
 	SDL_SemPost(encodeReady);
 }
 
 void Movie::StopRecording()
 {
+#ifdef HAVE_OPENGL
+	if (readback[0])
+	{
+		// oldest first
+		if (encodeThread)
+		{
+			for (int i = 0; i < READBACK_BUFFERS; i++)
+			{
+				int index = (readback_index + i) % READBACK_BUFFERS;
+				if (readback_pending[index])
+					CollectReadback(index);
+			}
+		}
+		glDeleteBuffersARB(READBACK_BUFFERS, readback);
+		for (int i = 0; i < READBACK_BUFFERS; i++)
+		{
+			readback[i] = 0;
+			readback_pending[i] = false;
+		}
+	}
+#endif
+	
 	if (encodeThread)
 	{
+		// let the encoder finish every queued frame
+		for (int i = 0; i < FRAME_SLOTS; i++)
+			SDL_SemWait(fillReady);
 		stillEncoding = false;
 		SDL_SemPost(encodeReady);
 		SDL_WaitThread(encodeThread, NULL);
@@ -842,10 +986,14 @@ void Movie::StopRecording()
 		SDL_DestroySemaphore(fillReady);
 		fillReady = NULL;
 	}
-	if (temp_surface)
+	for (int i = 0; i < FRAME_SLOTS; i++)
 	{
-		SDL_FreeSurface(temp_surface);
-		temp_surface = NULL;
+		if (slots[i].surface)
+		{
+			SDL_FreeSurface(slots[i].surface);
+			slots[i].surface = NULL;
+		}
+		std::vector<uint8>().swap(slots[i].pixels);
 	}
     
     if (av->inited)
@@ -857,6 +1005,12 @@ void Movie::StopRecording()
         avcodec_flush_buffers(av->fmt_ctx->streams[av->video_stream_idx]->codec);
         av_write_trailer(av->fmt_ctx);
         av->inited = false;
+        
+        if (batch_export)
+        {
+            logNote("exported %d frames to %s", int(av->video_counter), moviefile.c_str());
+            printf("exported %d frames to %s\n", int(av->video_counter), moviefile.c_str());
+        }
     }
     
     if (av->audio_fifo)
@@ -39,6 +39,11 @@ public:
 	bool IsRecording();
 	void StopRecording();
 	
+	// Records a film with nothing paced to real time, and quits when it
+	// ends (--export-film)
+	void StartBatchExport(std::string path);
+	bool IsBatchExport() { return batch_export; }
+	
 	enum FrameType {
 	  FRAME_NORMAL,
 	  FRAME_FADE,
@@ -50,11 +55,30 @@ private:
   static class Movie *m_instance;
   
   std::string moviefile;
+  bool batch_export;
   SDL_Rect view_rect;
-  SDL_Surface *temp_surface;
   
-  std::vector<uint8> videobuf;
-  std::vector<uint8> audiobuf;
+  // Frames captured and waiting for the encoder: the renderer fills
+  // them in turn, and only waits when all of them are still queued
+  enum { FRAME_SLOTS = 4 };
+  struct FrameSlot {
+    std::vector<uint8> pixels;
+    std::vector<uint8> audio;
+    SDL_Surface *surface;  // over pixels, for software rendering
+    bool upside_down;      // as OpenGL reads it; the encoder flips it
+  };
+  FrameSlot slots[FRAME_SLOTS];
+  int fill_slot;
+  int encode_slot;
+  
+  // OpenGL frames are read into a ring of pixel buffer objects, and
+  // collected when the ring comes round again, so glReadPixels() returns
+  // at once; each frame's audio waits with it
+  enum { READBACK_BUFFERS = 2 };
+  unsigned int readback[READBACK_BUFFERS];
+  std::vector<uint8> readback_audio[READBACK_BUFFERS];
+  bool readback_pending[READBACK_BUFFERS];
+  int readback_index;
   
   struct libav_vars *av;
   
@@ -69,6 +93,10 @@ private:
   void EncodeThread();
   void EncodeVideo(bool last);
   void EncodeAudio(bool last);
+  
+  void MixAudio(std::vector<uint8>& audio);
+  void CollectReadback(int index);
+  void QueueFrame();
 };
 	
 #endif
@@ -87,6 +87,17 @@ AIStream& AIStream::ignore(uint32 count)
 	return *this;
 }
 
+const uint8* AIStream::read_view(uint32 count)
+{
+	const uint8 *view = NULL;
+	if(bound_check(count))
+	{
+		view = _M_stream_pos;
+		_M_stream_pos += count;
+	}
+	return view;
+}
+
 AOStream& AOStream::operator<<(uint8 value)
 {
 	if(bound_check(1))
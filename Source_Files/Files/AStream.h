@@ -178,6 +178,11 @@ public:
 	AIStream&
 	ignore(uint32 __count);
 
+	// The next __count bytes where they are, instead of copied out;
+	// NULL if there aren't that many left
+	const uint8*
+	read_view(uint32 __count);
+
 	// Uses >> instead of operator>> so as to pick up friendly operator>>
 	template<class T>
 	inline AIStream&
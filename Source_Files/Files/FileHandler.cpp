@@ -37,8 +37,10 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <limits.h>
+#include <stdint.h>
 #include <string>
 #include <vector>
+#include <algorithm>
 
 #include <SDL_endian.h>
 
@@ -49,6 +51,10 @@
 #include <unistd.h>
 #endif
 
+#if defined(HAVE_UNISTD_H) && !defined(__WIN32__)
+#include <sys/mman.h>
+#endif
+
 #ifdef HAVE_ZZIP
 #include <zzip/lib.h>
 #include "SDL_rwops_zzip.h"
@@ -101,6 +107,7 @@ bool OpenedFile::Close()
 	is_forked = false;
 	fork_offset = 0;
 	fork_length = 0;
+	map_path.clear();
 	return true;
 }
 
@@ -161,6 +168,72 @@ bool OpenedFile::Write(int32 Count, void *Buffer)
 }
 
 
+uint8 *OpenedFile::Map(int32 Offset, int32 Length, void *&Base, size_t& BaseLength)
+{
+	Base = NULL;
+	BaseLength = 0;
+	if (f == NULL || map_path.empty() || Offset < 0 || Length <= 0)
+		return NULL;
+
+	int32 FileLength;
+	if (!GetLength(FileLength) || Offset > FileLength - Length)
+		return NULL;
+
+	// The view has to start on a page (or allocation granularity) boundary
+	int64_t Start = int64_t(Offset) + fork_offset;
+#if defined(__WIN32__)
+	SYSTEM_INFO Info;
+	GetSystemInfo(&Info);
+	int64_t Granularity = Info.dwAllocationGranularity;
+#elif defined(HAVE_UNISTD_H)
+	int64_t Granularity = sysconf(_SC_PAGESIZE);
+#else
+	int64_t Granularity = 0;
+#endif
+	if (Granularity <= 0)
+		return NULL;
+	int64_t AlignedStart = Start - Start % Granularity;
+	size_t ViewLength = static_cast<size_t>(Start - AlignedStart) + Length;
+
+	void *View = NULL;
+#if defined(__WIN32__)
+	HANDLE File = CreateFileA(map_path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (File == INVALID_HANDLE_VALUE)
+		return NULL;
+	HANDLE Mapping = CreateFileMappingA(File, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	CloseHandle(File);
+	if (Mapping == NULL)
+		return NULL;
+	View = MapViewOfFile(Mapping, FILE_MAP_COPY, DWORD(AlignedStart >> 32), DWORD(AlignedStart & 0xffffffff), ViewLength);
+	CloseHandle(Mapping);
+#elif defined(HAVE_UNISTD_H)
+	int File = open(map_path.c_str(), O_RDONLY);
+	if (File < 0)
+		return NULL;
+	View = mmap(NULL, ViewLength, PROT_READ | PROT_WRITE, MAP_PRIVATE, File, static_cast<off_t>(AlignedStart));
+	close(File);
+	if (View == MAP_FAILED)
+		return NULL;
+#endif
+	if (View == NULL)
+		return NULL;
+
+	Base = View;
+	BaseLength = ViewLength;
+	return static_cast<uint8 *>(View) + (Start - AlignedStart);
+}
+
+void OpenedFile::Unmap(void *Base, size_t BaseLength)
+{
+	if (Base == NULL)
+		return;
+#if defined(__WIN32__)
+	UnmapViewOfFile(Base);
+#elif defined(HAVE_UNISTD_H)
+	munmap(Base, BaseLength);
+#endif
+}
+
 SDL_RWops *OpenedFile::TakeRWops ()
 {
 	SDL_RWops *taken = f;
@@ -385,6 +458,9 @@ bool FileSpecifier::Open(OpenedFile &OFile, bool Writable)
 	if (Writable)
 		return true;
 
+	// A path inside a zip plugin doesn't open, so such files aren't mapped
+	OFile.map_path = GetPath();
+
 	// Transparently handle AppleSingle and MacBinary files on reading
 	int32 offset, data_length, rsrc_length;
 	if (is_applesingle(f, false, offset, data_length)) {
@@ -429,17 +505,8 @@ bool FileSpecifier::Exists()
 #ifdef HAVE_ZZIP
 	if (err)
 	{
-		// Check whether zzip can open the file (slow!)
-		ZZIP_FILE* file = zzip_open(unix_path_separators(GetPath()).c_str(), R_OK);
-		if (file)
-		{
-			zzip_close(file);
-			return true;
-		}
-		else
-		{
-			return false;
-		}
+		// Check whether the file is in a zip archive
+		return SDL_ZZIPFileExists(unix_path_separators(GetPath()).c_str()) != 0;
 	}
 #endif
 	return (err == 0);
@@ -851,6 +918,36 @@ bool FileSpecifier::ReadDirectory(vector<dir_entry> &vec)
 	return true;
 }
 
+struct written_earlier
+{
+	bool operator()(const dir_entry& a, const dir_entry& b) const { return a.date < b.date; }
+};
+
+void FileSpecifier::PruneDirectory(const char *extension, int64_t MaximumSize)
+{
+	vector<dir_entry> entries;
+	if (!ReadDirectory(entries))
+		return;
+
+	vector<dir_entry> files;
+	int64_t total = 0;
+	for (vector<dir_entry>::const_iterator it = entries.begin(); it != entries.end(); ++it)
+	{
+		if (it->is_directory || !boost::algorithm::ends_with(it->name, extension))
+			continue;
+		files.push_back(*it);
+		total += it->size;
+	}
+
+	std::sort(files.begin(), files.end(), written_earlier());
+	for (vector<dir_entry>::const_iterator it = files.begin(); it != files.end() && total > MaximumSize; ++it)
+	{
+		FileSpecifier file = *this + it->name;
+		if (file.Delete())
+			total -= it->size;
+	}
+}
+
 // Copy file contents
 bool FileSpecifier::CopyContents(FileSpecifier &source_name)
 {
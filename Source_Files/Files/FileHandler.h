@@ -105,11 +105,20 @@ public:
 	SDL_RWops *GetRWops() {return f;}
 	SDL_RWops *TakeRWops();		// Hand over SDL_RWops
 
+	// A copy-on-write view of Length bytes at Offset, straight from the
+	// page cache; NULL for files that aren't plain files opened for reading
+	// (zip plugins, writable files) or reach past the end of the file.
+	// The view outlives the file; hand Base and BaseLength to Unmap()
+	uint8 *Map(int32 Offset, int32 Length, void *&Base, size_t& BaseLength);
+	static void Unmap(void *Base, size_t BaseLength);
+
 private:
 	SDL_RWops *f;	// File handle
 	int err;		// Error code
 	bool is_forked;
 	int32 fork_offset, fork_length;
+	// set only when the file can be mapped
+	std::string map_path;
 };
 
 class opened_file_device {
@@ -349,6 +358,9 @@ public:
 
 	bool CreateDirectory();
 	bool ReadDirectory(vector<dir_entry> &vec);
+	// For caches: deletes the oldest files with that extension until
+	// the rest come to no more than MaximumSize bytes
+	void PruneDirectory(const char *extension, int64_t MaximumSize);
 
 	int GetError() const {return err;}
 
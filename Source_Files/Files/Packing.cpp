@@ -25,6 +25,19 @@
 #include "cseries.h"
 #include "Packing.h"
 
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PACKING_SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PACKING_SIMD_NEON
+#endif
+
+static_assert(sizeof(uint16) == 2 && sizeof(int16) == 2, "16-bit values must be 2 bytes");
+static_assert(sizeof(uint32) == 4 && sizeof(int32) == 4, "32-bit values must be 4 bytes");
+
 //big endian
 
  void StreamToValueBE(uint8* &Stream, uint16 &Value)
@@ -146,3 +159,170 @@
     ValueToStreamLE(Stream,uint32(Value));
 }
 
+
+// lists: copied whole, then byte-swapped in place if the stream's order
+// isn't this machine's
+
+static void SwapBytes16(uint8* Bytes, size_t Count)
+{
+    size_t k = 0;
+#if defined(PACKING_SIMD_SSE2)
+    for (; k+8 <= Count; k += 8)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i*>(Bytes + 2*k));
+        v = _mm_or_si128(_mm_slli_epi16(v,8), _mm_srli_epi16(v,8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(Bytes + 2*k), v);
+    }
+#elif defined(PACKING_SIMD_NEON)
+    for (; k+8 <= Count; k += 8)
+        vst1q_u8(Bytes + 2*k, vrev16q_u8(vld1q_u8(Bytes + 2*k)));
+#endif
+    for (; k<Count; k++)
+    {
+        uint8 *V = Bytes + 2*k;
+        uint8 Byte0 = V[0];
+        V[0] = V[1];
+        V[1] = Byte0;
+    }
+}
+
+static void SwapBytes32(uint8* Bytes, size_t Count)
+{
+    size_t k = 0;
+#if defined(PACKING_SIMD_SSE2)
+    for (; k+4 <= Count; k += 4)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i*>(Bytes + 4*k));
+        // Swap the bytes in each half, then the halves
+        v = _mm_or_si128(_mm_slli_epi16(v,8), _mm_srli_epi16(v,8));
+        v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2,3,0,1));
+        v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2,3,0,1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(Bytes + 4*k), v);
+    }
+#elif defined(PACKING_SIMD_NEON)
+    for (; k+4 <= Count; k += 4)
+        vst1q_u8(Bytes + 4*k, vrev32q_u8(vld1q_u8(Bytes + 4*k)));
+#endif
+    for (; k<Count; k++)
+    {
+        uint8 *V = Bytes + 4*k;
+        uint8 Byte0 = V[0];
+        uint8 Byte1 = V[1];
+        V[0] = V[3];
+        V[1] = V[2];
+        V[2] = Byte1;
+        V[3] = Byte0;
+    }
+}
+
+static void SwapBytes(uint8* Bytes, size_t Size, size_t Count)
+{
+    if (Size == 2)
+        SwapBytes16(Bytes,Count);
+    else
+        SwapBytes32(Bytes,Count);
+}
+
+#ifdef ALEPHONE_LITTLE_ENDIAN
+const bool SwapBE = true;
+const bool SwapLE = false;
+#else
+const bool SwapBE = false;
+const bool SwapLE = true;
+#endif
+
+static void UnpackList(uint8* &Stream, void* List, size_t Size, size_t Count, bool Swap)
+{
+    memcpy(List,Stream,Size*Count);
+    if (Swap)
+        SwapBytes(static_cast<uint8*>(List),Size,Count);
+    Stream += Size*Count;
+}
+
+static void PackList(uint8* &Stream, const void* List, size_t Size, size_t Count, bool Swap)
+{
+    memcpy(Stream,List,Size*Count);
+    if (Swap)
+        SwapBytes(Stream,Size,Count);
+    Stream += Size*Count;
+}
+
+ void StreamToListBE(uint8* &Stream, uint16* List, size_t Count)
+{
+    UnpackList(Stream,List,sizeof(*List),Count,SwapBE);
+}
+
+ void StreamToListBE(uint8* &Stream, int16* List, size_t Count)
+{
+    UnpackList(Stream,List,sizeof(*List),Count,SwapBE);
+}
+
+ void StreamToListBE(uint8* &Stream, uint32* List, size_t Count)
+{
+    UnpackList(Stream,List,sizeof(*List),Count,SwapBE);
+}
+
+ void StreamToListBE(uint8* &Stream, int32* List, size_t Count)
+{
+    UnpackList(Stream,List,sizeof(*List),Count,SwapBE);
+}
+
+ void ListToStreamBE(uint8* &Stream, const uint16* List, size_t Count)
+{
+    PackList(Stream,List,sizeof(*List),Count,SwapBE);
+}
+
+ void ListToStreamBE(uint8* &Stream, const int16* List, size_t Count)
+{
+    PackList(Stream,List,sizeof(*List),Count,SwapBE);
+}
+
+ void ListToStreamBE(uint8* &Stream, const uint32* List, size_t Count)
+{
+    PackList(Stream,List,sizeof(*List),Count,SwapBE);
+}
+
+ void ListToStreamBE(uint8* &Stream, const int32* List, size_t Count)
+{
+    PackList(Stream,List,sizeof(*List),Count,SwapBE);
+}
+
+ void StreamToListLE(uint8* &Stream, uint16* List, size_t Count)
+{
+    UnpackList(Stream,List,sizeof(*List),Count,SwapLE);
+}
+
+ void StreamToListLE(uint8* &Stream, int16* List, size_t Count)
+{
+    UnpackList(Stream,List,sizeof(*List),Count,SwapLE);
+}
+
+ void StreamToListLE(uint8* &Stream, uint32* List, size_t Count)
+{
+    UnpackList(Stream,List,sizeof(*List),Count,SwapLE);
+}
+
+ void StreamToListLE(uint8* &Stream, int32* List, size_t Count)
+{
+    UnpackList(Stream,List,sizeof(*List),Count,SwapLE);
+}
+
+ void ListToStreamLE(uint8* &Stream, const uint16* List, size_t Count)
+{
+    PackList(Stream,List,sizeof(*List),Count,SwapLE);
+}
+
+ void ListToStreamLE(uint8* &Stream, const int16* List, size_t Count)
+{
+    PackList(Stream,List,sizeof(*List),Count,SwapLE);
+}
+
+ void ListToStreamLE(uint8* &Stream, const uint32* List, size_t Count)
+{
+    PackList(Stream,List,sizeof(*List),Count,SwapLE);
+}
+
+ void ListToStreamLE(uint8* &Stream, const int32* List, size_t Count)
+{
+    PackList(Stream,List,sizeof(*List),Count,SwapLE);
+}
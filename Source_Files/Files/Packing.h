@@ -53,6 +53,10 @@
 
 Aug 27, 2002 (Alexander Strange):
 	Moved functions to Packing.cpp to get around inlining issues.
+
+	The list routines copy the whole list at once and swap its bytes in bulk
+	(with SSE2 or NEON where available) when the stream's byte order isn't
+	this machine's, rather than going value by value.
 */
 
 #include "cstypes.h"
@@ -73,11 +77,15 @@ Aug 27, 2002 (Alexander Strange):
 #ifdef PACKED_DATA_IS_BIG_ENDIAN
 #define StreamToValue StreamToValueBE
 #define ValueToStream ValueToStreamBE
+#define StreamToList StreamToListBE
+#define ListToStream ListToStreamBE
 #endif
 
 #ifdef PACKED_DATA_IS_LITTLE_ENDIAN
 #define StreamToValue StreamToValueLE
 #define ValueToStream ValueToStreamLE
+#define StreamToList StreamToListLE
+#define ListToStream ListToStreamLE
 #endif
 
 extern void StreamToValue(uint8* &Stream, uint16 &Value);
@@ -89,21 +97,16 @@ extern void ValueToStream(uint8* &Stream, int16 Value);
 extern void ValueToStream(uint8* &Stream, uint32 Value);
 extern void ValueToStream(uint8* &Stream, int32 Value);
 
-#ifndef PACKING_INTERNAL
-template<class T> inline static void StreamToList(uint8* &Stream, T* List, size_t Count)
-{
-    T* ValuePtr = List;
-    for (size_t k=0; k<Count; k++)
-        StreamToValue(Stream,*(ValuePtr++));
-}
-
+extern void StreamToList(uint8* &Stream, uint16* List, size_t Count);
+extern void StreamToList(uint8* &Stream, int16* List, size_t Count);
+extern void StreamToList(uint8* &Stream, uint32* List, size_t Count);
+extern void StreamToList(uint8* &Stream, int32* List, size_t Count);
+extern void ListToStream(uint8* &Stream, const uint16* List, size_t Count);
+extern void ListToStream(uint8* &Stream, const int16* List, size_t Count);
+extern void ListToStream(uint8* &Stream, const uint32* List, size_t Count);
+extern void ListToStream(uint8* &Stream, const int32* List, size_t Count);
 
-template<class T> inline static void ListToStream(uint8* &Stream, T* List, size_t Count)
-{
-    T* ValuePtr = List;
-    for (size_t k=0; k<Count; k++)
-        ValueToStream(Stream,*(ValuePtr++));
-}
+#ifndef PACKING_INTERNAL
 
 inline static void StreamToBytes(uint8* &Stream, void* Bytes, size_t Count)
 {
@@ -6,29 +6,268 @@
  */
 
 #include <SDL_rwops_zzip.h>
+#include <SDL_atomic.h>
 #include <zzip/zzip.h>
+#include <stdlib.h>
 #include <string.h> /* strchr */
+#include <errno.h>
+#include <sys/stat.h>
+
+/* Files are read through a buffer, so the many small reads of wad and
+ * image loaders don't each go to zzip (and inflate) */
+#define ZZIP_READ_AHEAD 65536
+
+/* Archives stay open, with their central directories parsed, so each file
+ * opened inside one doesn't scan the whole archive again as zzip_fopen does */
+#define ZZIP_ARCHIVE_POOL 16
+
+typedef struct {
+    char* path;
+    time_t date;
+    off_t size;
+    ZZIP_DIR* dir;
+    unsigned long used;
+} zzip_archive;
+
+static zzip_archive archives[ZZIP_ARCHIVE_POOL];
+static unsigned long archive_uses = 0;
+
+/* pooled archives share a file descriptor; files in them, and the pool
+ * itself, are only touched under this */
+static SDL_SpinLock archive_lock = 0;
+
+typedef struct {
+    ZZIP_FILE* file;
+    int pooled;
+    Sint64 position;        /* of the reader */
+    Sint64 file_position;   /* of zzip */
+    Sint64 buffer_start;
+    size_t buffer_length;
+    unsigned char buffer[ZZIP_READ_AHEAD];
+} zzip_rwops_data;
 
 /* MSVC can not take a casted variable as an lvalue ! */
 #define SDL_RWOPS_ZZIP_DATA(_context) \
              ((_context)->hidden.unknown.data1)
-#define SDL_RWOPS_ZZIP_FILE(_context)  (ZZIP_FILE*) \
+#define SDL_RWOPS_ZZIP_FILE(_context)  (zzip_rwops_data*) \
              ((_context)->hidden.unknown.data1)
 
+static void _zzip_lock(zzip_rwops_data* data)
+{
+    if (data->pooled) SDL_AtomicLock(&archive_lock);
+}
+
+static void _zzip_unlock(zzip_rwops_data* data)
+{
+    if (data->pooled) SDL_AtomicUnlock(&archive_lock);
+}
+
+/* must hold archive_lock; NULL if there is no such archive */
+static ZZIP_DIR* _zzip_pooled_archive(const char* path)
+{
+    struct stat st;
+    zzip_error_t e = 0;
+    int i, slot = -1;
+
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) return 0;
+
+    for (i = 0; i < ZZIP_ARCHIVE_POOL; i++)
+    {
+	if (archives[i].path && !strcmp(archives[i].path, path))
+	{
+	    if (archives[i].date == st.st_mtime && archives[i].size == st.st_size)
+	    {
+		archives[i].used = ++archive_uses;
+		return archives[i].dir;
+	    }
+	    slot = i; /* changed on disk since */
+	    break;
+	}
+    }
+
+    if (slot < 0)
+    {
+	/* an empty slot, or else the one used longest ago */
+	slot = 0;
+	for (i = 0; i < ZZIP_ARCHIVE_POOL; i++)
+	{
+	    if (!archives[i].path) { slot = i; break; }
+	    if (archives[i].used < archives[slot].used) slot = i;
+	}
+    }
+
+    /* files still open in the old archive keep it alive until they close */
+    if (archives[slot].path)
+    {
+	zzip_dir_close(archives[slot].dir);
+	free(archives[slot].path);
+	archives[slot].path = 0;
+    }
+
+    archives[slot].dir = zzip_dir_open(path, &e);
+    if (!archives[slot].dir) return 0;
+    archives[slot].path = strdup(path);
+    if (!archives[slot].path)
+    {
+	zzip_dir_close(archives[slot].dir);
+	return 0;
+    }
+    archives[slot].date = st.st_mtime;
+    archives[slot].size = st.st_size;
+    archives[slot].used = ++archive_uses;
+    return archives[slot].dir;
+}
+
+/* Finds the archive a path like X/graphics/game/greetings.bmp refers to,
+ * the way zzip_fopen does (X/graphics.zip, entry game/greetings.bmp); must
+ * hold archive_lock. Returns the entry's offset in the path, or -1 */
+static int _zzip_find_archive(const char* file, ZZIP_DIR** dir)
+{
+    static const char* extensions[] = { ".zip", ".ZIP", 0 };
+    size_t length = strlen(file);
+    char* base;
+    char* p;
+    int i, entry = -1;
+
+    base = (char*) malloc(length + 5);
+    if (!base) return -1;
+    memcpy(base, file, length + 1);
+
+    while (entry < 0 && (p = strrchr(base, '/')))
+    {
+	*p = '\0';
+	for (i = 0; extensions[i]; i++)
+	{
+	    strcpy(p, extensions[i]);
+	    *dir = _zzip_pooled_archive(base);
+	    if (*dir) { entry = (int) (p - base) + 1; break; }
+	}
+	*p = '\0';
+    }
+
+    free(base);
+    return entry;
+}
+
+static int _zzip_is_plain_file(const char* file)
+{
+    struct stat st;
+    return stat(file, &st) == 0;
+}
+
+int SDL_ZZIPFileExists(const char* file)
+{
+    ZZIP_DIR* dir;
+    ZZIP_STAT zs;
+    int entry, found = 0;
+
+    if (_zzip_is_plain_file(file)) return 1;
+
+    SDL_AtomicLock(&archive_lock);
+    entry = _zzip_find_archive(file, &dir);
+    if (entry >= 0)
+	found = zzip_dir_stat(dir, file + entry, &zs, 0) == 0;
+    SDL_AtomicUnlock(&archive_lock);
+    return found;
+}
+
 static Sint64 _zzip_size(SDL_RWops *context)
 {
-    return -1;
+    zzip_rwops_data* data = SDL_RWOPS_ZZIP_FILE(context);
+    ZZIP_STAT zs;
+    int result;
+
+    _zzip_lock(data);
+    result = zzip_fstat(data->file, &zs);
+    _zzip_unlock(data);
+    return result == 0 ? (Sint64) zs.st_size : -1;
 }
 
 static Sint64 _zzip_seek(SDL_RWops *context, Sint64 offset, int whence)
 {
-    return zzip_seek(SDL_RWOPS_ZZIP_FILE(context), offset, whence);
+    zzip_rwops_data* data = SDL_RWOPS_ZZIP_FILE(context);
+    Sint64 position;
+
+    if (whence == SEEK_SET) position = offset;
+    else if (whence == SEEK_CUR) position = data->position + offset;
+    else if (whence == SEEK_END) position = -1;
+    else return -1;
+
+    if (position < 0 && whence != SEEK_END) return -1;
+
+    /* inside the buffer, there's nothing for zzip to do */
+    if (position >= data->buffer_start &&
+	position <= data->buffer_start + (Sint64) data->buffer_length)
+    {
+	data->position = position;
+	return position;
+    }
+
+    _zzip_lock(data);
+    if (position >= 0)
+	position = zzip_seek(data->file, (zzip_off_t) position, SEEK_SET);
+    else
+	position = zzip_seek(data->file, (zzip_off_t) offset, whence);
+    _zzip_unlock(data);
+
+    if (position < 0) return -1;
+    data->position = data->file_position = position;
+    return position;
 }
 
 static size_t _zzip_rwread(SDL_RWops *context, void *ptr, size_t size, size_t maxnum)
 {
+    zzip_rwops_data* data = SDL_RWOPS_ZZIP_FILE(context);
+    unsigned char* out = (unsigned char*) ptr;
+    size_t total = size * maxnum;
+    size_t copied = 0;
+    zzip_ssize_t n;
+
     if (!size) return 0;
-    return zzip_read(SDL_RWOPS_ZZIP_FILE(context), ptr, size*maxnum) / size;
+
+    _zzip_lock(data);
+    while (copied < total)
+    {
+	size_t wanted = total - copied;
+
+	if (data->position >= data->buffer_start &&
+	    data->position < data->buffer_start + (Sint64) data->buffer_length)
+	{
+	    size_t offset = (size_t) (data->position - data->buffer_start);
+	    size_t count = data->buffer_length - offset;
+	    if (count > wanted) count = wanted;
+	    memcpy(out + copied, data->buffer + offset, count);
+	    copied += count;
+	    data->position += count;
+	    continue;
+	}
+
+	if (data->file_position != data->position)
+	{
+	    if (zzip_seek(data->file, (zzip_off_t) data->position, SEEK_SET) < 0) break;
+	    data->file_position = data->position;
+	}
+
+	/* large reads go straight to the caller */
+	if (wanted >= ZZIP_READ_AHEAD)
+	{
+	    n = zzip_read(data->file, out + copied, wanted);
+	    if (n <= 0) break;
+	    copied += n;
+	    data->position += n;
+	    data->file_position += n;
+	    continue;
+	}
+
+	n = zzip_read(data->file, data->buffer, ZZIP_READ_AHEAD);
+	if (n <= 0) break;
+	data->buffer_start = data->position;
+	data->buffer_length = n;
+	data->file_position += n;
+    }
+    _zzip_unlock(data);
+
+    return copied / size;
 }
 
 static size_t _zzip_rwwrite(SDL_RWops *context, const void *ptr, size_t size, size_t num)
@@ -38,9 +277,15 @@ static size_t _zzip_rwwrite(SDL_RWops *context, const void *ptr, size_t size, si
 
 static int _zzip_close(SDL_RWops *context)
 {
+    zzip_rwops_data* data;
+
     if (! context) return 0; /* may be SDL_RWclose is called by atexit */
 
-    zzip_close (SDL_RWOPS_ZZIP_FILE(context));
+    data = SDL_RWOPS_ZZIP_FILE(context);
+    _zzip_lock(data);
+    zzip_close (data->file);
+    _zzip_unlock(data);
+    free (data);
     SDL_FreeRW (context);
     return 0;
 }
@@ -48,18 +293,53 @@ static int _zzip_close(SDL_RWops *context)
 SDL_RWops *SDL_RWFromZZIP(const char* file, const char* mode)
 {
     register SDL_RWops* rwops;
-    register ZZIP_FILE* zzip_file;
+    register ZZIP_FILE* zzip_file = 0;
+    zzip_rwops_data* data;
+    ZZIP_DIR* dir;
+    int pooled = 0;
+    int entry;
 
     if (! strchr (mode, 'r'))
 	return SDL_RWFromFile(file, mode);
 
-    zzip_file = zzip_fopen (file, mode);
+    if (_zzip_is_plain_file(file))
+	zzip_file = zzip_fopen (file, mode);
+    else
+    {
+	SDL_AtomicLock(&archive_lock);
+	entry = _zzip_find_archive(file, &dir);
+	if (entry >= 0)
+	{
+	    zzip_file = zzip_file_open(dir, file + entry, 0);
+	    pooled = 1;
+	}
+	SDL_AtomicUnlock(&archive_lock);
+
+	/* anything past what the pool handles */
+	if (entry < 0)
+	    zzip_file = zzip_fopen (file, mode);
+    }
     if (! zzip_file) return 0;
 
-    rwops = SDL_AllocRW ();
-    if (! rwops) { errno=ENOMEM; zzip_close (zzip_file); return 0; }
+    data = (zzip_rwops_data*) malloc (sizeof(zzip_rwops_data));
+    rwops = data ? SDL_AllocRW () : 0;
+    if (! rwops)
+    {
+	errno=ENOMEM;
+	if (pooled) SDL_AtomicLock(&archive_lock);
+	zzip_close (zzip_file);
+	if (pooled) SDL_AtomicUnlock(&archive_lock);
+	free (data);
+	return 0;
+    }
+
+    data->file = zzip_file;
+    data->pooled = pooled;
+    data->position = data->file_position = 0;
+    data->buffer_start = 0;
+    data->buffer_length = 0;
 
-    SDL_RWOPS_ZZIP_DATA(rwops) = zzip_file;
+    SDL_RWOPS_ZZIP_DATA(rwops) = data;
     rwops->size = _zzip_size;
     rwops->read = _zzip_rwread;
     rwops->write = _zzip_rwwrite;
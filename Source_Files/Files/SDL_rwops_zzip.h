@@ -29,6 +29,10 @@ extern "C" {
 extern ZZIP_DECLSPEC
 SDL_RWops *SDL_RWFromZZIP(const char* file, const char* mode);
 
+/* whether SDL_RWFromZZIP would find the file, without opening it */
+extern ZZIP_DECLSPEC
+int SDL_ZZIPFileExists(const char* file);
+
 #ifdef __cplusplus
 } /* extern C */
 #endif
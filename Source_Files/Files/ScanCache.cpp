@@ -0,0 +1,258 @@
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  Scan cache (see ScanCache.h)
+
+ */
+
+#include "cseries.h"
+#include "ScanCache.h"
+
+#include "Logging.h"
+
+#include <time.h>
+
+static const char *cache_file_name = "Scan Cache.xml";
+
+// Dates are in seconds, so what changes within the second a scan sees it
+// could change again unnoticed; such things are not cached
+static bool too_recent(TimeType date)
+{
+	return date >= time(NULL) - 1;
+}
+
+ScanCache* ScanCache::m_instance = 0;
+ScanCache* ScanCache::instance()
+{
+	if (!m_instance)
+		m_instance = new ScanCache;
+	return m_instance;
+}
+
+bool ScanCache::ReadDirectory(FileSpecifier& dir, std::vector<dir_entry>& entries)
+{
+	Load();
+
+	std::string path = dir.GetPath();
+	TimeType date = dir.GetDate();
+	std::map<std::string, DirectoryListing>::const_iterator it = m_directories.find(path);
+	if (date && it != m_directories.end() && it->second.date == date)
+	{
+		entries.clear();
+		for (std::vector<std::string>::const_iterator name = it->second.files.begin(); name != it->second.files.end(); ++name)
+			entries.push_back(dir_entry(*name, 0, false));
+		for (std::vector<std::string>::const_iterator name = it->second.directories.begin(); name != it->second.directories.end(); ++name)
+			entries.push_back(dir_entry(*name, 0, true));
+		return true;
+	}
+
+	if (!dir.ReadDirectory(entries))
+		return false;
+
+	if (date && !too_recent(date))
+	{
+		DirectoryListing& listing = m_directories[path];
+		listing.date = date;
+		listing.files.clear();
+		listing.directories.clear();
+		for (std::vector<dir_entry>::const_iterator entry = entries.begin(); entry != entries.end(); ++entry)
+			(entry->is_directory ? listing.directories : listing.files).push_back(entry->name);
+		m_dirty = true;
+	}
+	return true;
+}
+
+Typecode ScanCache::GetType(FileSpecifier& file, const dir_entry& entry)
+{
+	Load();
+
+	std::string path = file.GetPath();
+	std::map<std::string, FileType>::const_iterator it = m_types.find(path);
+	if (it != m_types.end() && it->second.date == entry.date && it->second.size == entry.size)
+		return it->second.type;
+
+	Typecode type = file.GetType();
+	if (!too_recent(entry.date))
+	{
+		FileType& cached = m_types[path];
+		cached.date = entry.date;
+		cached.size = entry.size;
+		cached.type = type;
+		m_dirty = true;
+	}
+	return type;
+}
+
+bool ScanCache::GetRecord(const std::string& path, TimeType date, InfoTree& record)
+{
+	Load();
+
+	std::map<std::string, Record>::const_iterator it = m_records.find(path);
+	if (!date || it == m_records.end() || it->second.date != date)
+		return false;
+
+	record = it->second.tree;
+	return true;
+}
+
+void ScanCache::PutRecord(const std::string& path, TimeType date, const InfoTree& record)
+{
+	Load();
+
+	if (!date || too_recent(date))
+		return;
+
+	Record& cached = m_records[path];
+	cached.date = date;
+	cached.tree = record;
+	m_dirty = true;
+}
+
+void ScanCache::Load()
+{
+	if (m_loaded)
+		return;
+	m_loaded = true;
+
+	FileSpecifier file;
+	file.SetToLocalDataDir();
+	file.AddPart(cache_file_name);
+	if (!file.Exists())
+		return;
+
+	InfoTree root;
+	try {
+		root = InfoTree::load_xml(file).get_child("scan_cache");
+	} catch (InfoTree::parse_error e) {
+		logError("Could not read scan cache from %s (%s)", file.GetPath(), e.what());
+		return;
+	} catch (InfoTree::path_error e) {
+		logError("Could not read scan cache from %s (%s)", file.GetPath(), e.what());
+		return;
+	}
+
+	BOOST_FOREACH(const InfoTree &tree, root.children_named("directory"))
+	{
+		std::string path;
+		TimeType date;
+		if (!tree.read_attr("path", path) || !tree.read_attr("date", date))
+			continue;
+
+		DirectoryListing& listing = m_directories[path];
+		listing.date = date;
+		BOOST_FOREACH(const InfoTree &child, tree.children_named("file"))
+		{
+			std::string name;
+			if (child.read_attr("name", name))
+				listing.files.push_back(name);
+		}
+		BOOST_FOREACH(const InfoTree &child, tree.children_named("directory"))
+		{
+			std::string name;
+			if (child.read_attr("name", name))
+				listing.directories.push_back(name);
+		}
+	}
+
+	BOOST_FOREACH(const InfoTree &tree, root.children_named("file"))
+	{
+		std::string path;
+		FileType cached;
+		int type;
+		if (tree.read_attr("path", path) && tree.read_attr("date", cached.date) &&
+			tree.read_attr("size", cached.size) && tree.read_attr("type", type))
+		{
+			cached.type = static_cast<Typecode>(type);
+			m_types[path] = cached;
+		}
+	}
+
+	BOOST_FOREACH(const InfoTree &tree, root.children_named("record"))
+	{
+		std::string path;
+		Record cached;
+		if (tree.read_attr("path", path) && tree.read_attr("date", cached.date))
+		{
+			try {
+				cached.tree = tree.get_child("data");
+				m_records[path] = cached;
+			} catch (InfoTree::path_error e) { }
+		}
+	}
+}
+
+void ScanCache::Save()
+{
+	if (!m_dirty)
+		return;
+
+	InfoTree root;
+	for (std::map<std::string, DirectoryListing>::const_iterator it = m_directories.begin(); it != m_directories.end(); ++it)
+	{
+		InfoTree tree;
+		tree.put_attr("path", it->first);
+		tree.put_attr("date", it->second.date);
+		for (std::vector<std::string>::const_iterator name = it->second.files.begin(); name != it->second.files.end(); ++name)
+		{
+			InfoTree child;
+			child.put_attr("name", *name);
+			tree.add_child("file", child);
+		}
+		for (std::vector<std::string>::const_iterator name = it->second.directories.begin(); name != it->second.directories.end(); ++name)
+		{
+			InfoTree child;
+			child.put_attr("name", *name);
+			tree.add_child("directory", child);
+		}
+		root.add_child("directory", tree);
+	}
+
+	for (std::map<std::string, FileType>::const_iterator it = m_types.begin(); it != m_types.end(); ++it)
+	{
+		InfoTree tree;
+		tree.put_attr("path", it->first);
+		tree.put_attr("date", it->second.date);
+		tree.put_attr("size", it->second.size);
+		tree.put_attr("type", static_cast<int>(it->second.type));
+		root.add_child("file", tree);
+	}
+
+	for (std::map<std::string, Record>::const_iterator it = m_records.begin(); it != m_records.end(); ++it)
+	{
+		InfoTree tree;
+		tree.put_attr("path", it->first);
+		tree.put_attr("date", it->second.date);
+		tree.add_child("data", it->second.tree);
+		root.add_child("record", tree);
+	}
+
+	InfoTree fileroot;
+	fileroot.add_child("scan_cache", root);
+
+	FileSpecifier file;
+	file.SetToLocalDataDir();
+	file.AddPart(cache_file_name);
+	try {
+		fileroot.save_xml(file);
+		m_dirty = false;
+	} catch (InfoTree::parse_error e) {
+		logError("Could not save scan cache to %s (%s)", file.GetPath(), e.what());
+	} catch (InfoTree::unexpected_error e) {
+		logError("Could not save scan cache to %s (%s)", file.GetPath(), e.what());
+	}
+}
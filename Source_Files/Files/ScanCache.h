@@ -0,0 +1,84 @@
+#ifndef SCAN_CACHE_H
+#define SCAN_CACHE_H
+
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  Scan cache: what startup learns from walking the data directories
+  (directory listings, file types, parsed plugin metadata), kept in the
+  local data directory between runs and trusted only while the
+  modification dates it was taken at still match
+
+ */
+
+#include "FileHandler.h"
+#include "InfoTree.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+class ScanCache
+{
+public:
+	static ScanCache* instance();
+
+	// The names of a directory's entries, and which are directories; from
+	// the cache while the directory's date is unchanged (other entry details
+	// are not filled in then)
+	bool ReadDirectory(FileSpecifier& dir, std::vector<dir_entry>& entries);
+
+	// A file's type, for an entry just read from its directory; from the
+	// cache while the file's date and size are unchanged
+	Typecode GetType(FileSpecifier& file, const dir_entry& entry);
+
+	// Whatever a scanner made of a path, as of the given date
+	bool GetRecord(const std::string& path, TimeType date, InfoTree& record);
+	void PutRecord(const std::string& path, TimeType date, const InfoTree& record);
+
+	void Save();
+
+private:
+	ScanCache() : m_loaded(false), m_dirty(false) { }
+	void Load();
+
+	static ScanCache* m_instance;
+
+	struct DirectoryListing {
+		TimeType date;
+		std::vector<std::string> files;
+		std::vector<std::string> directories;
+	};
+	struct FileType {
+		TimeType date;
+		int32 size;
+		Typecode type;
+	};
+	struct Record {
+		TimeType date;
+		InfoTree tree;
+	};
+
+	std::map<std::string, DirectoryListing> m_directories;
+	std::map<std::string, FileType> m_types;
+	std::map<std::string, Record> m_records;
+	bool m_loaded;
+	bool m_dirty;
+};
+
+#endif
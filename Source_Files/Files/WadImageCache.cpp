@@ -50,7 +50,15 @@ WadImageCache* WadImageCache::instance() {
 
 SDL_Surface *WadImageCache::image_from_desc(WadImageDescriptor& desc)
 {
-	SDL_Surface *surface = NULL;
+	std::vector<uint8> data;
+	if (!image_data_from_desc(desc, data))
+		return NULL;
+	return image_from_data(data);
+}
+
+bool WadImageCache::image_data_from_desc(WadImageDescriptor& desc, std::vector<uint8>& image_data)
+{
+	bool found = false;
 	OpenedFile wad_file;
 	if (open_wad_file_for_reading(desc.file, wad_file))
 	{
@@ -66,12 +74,9 @@ SDL_Surface *WadImageCache::image_from_desc(WadImageDescriptor& desc)
 				data = extract_type_from_wad(wad, desc.tag, &length);
 				if (data && length)
 				{
-					SDL_RWops *rwops = SDL_RWFromConstMem(data, length);
-#ifdef HAVE_SDL_IMAGE
-					surface = IMG_Load_RW(rwops, 1);
-#else
-					surface = SDL_LoadBMP_RW(rwops, 1);
-#endif
+					uint8 *bytes = static_cast<uint8 *>(data);
+					image_data.assign(bytes, bytes + length);
+					found = true;
 				}
 				free_wad(wad);
 			}
@@ -79,7 +84,17 @@ SDL_Surface *WadImageCache::image_from_desc(WadImageDescriptor& desc)
 		close_wad_file(wad_file);
 	}
 	clear_game_error();
-	return surface;
+	return found;
+}
+
+SDL_Surface *WadImageCache::image_from_data(std::vector<uint8>& data)
+{
+	SDL_RWops *rwops = SDL_RWFromConstMem(&data[0], data.size());
+#ifdef HAVE_SDL_IMAGE
+	return IMG_Load_RW(rwops, 1);
+#else
+	return SDL_LoadBMP_RW(rwops, 1);
+#endif
 }
 
 SDL_Surface *WadImageCache::image_from_name(std::string& name) const
@@ -162,17 +177,22 @@ std::string WadImageCache::add_to_cache(cache_key_t key, SDL_Surface *surface)
 	std::string name = image_to_new_name(surface, &filesize);
 	if (!name.empty())
 	{
-		m_used.push_front(cache_pair_t(key, cache_value_t(name, filesize)));
-		m_cacheinfo[key] = m_used.begin();
-		m_cache_dirty = true;
-		
-		m_cachesize += filesize;
+		index_image(key, name, filesize);
 		apply_cache_limit();
 		autosave_cache();
 	}
 	return name;
 }
 
+void WadImageCache::index_image(cache_key_t key, std::string& name, int32 filesize)
+{
+	m_used.push_front(cache_pair_t(key, cache_value_t(name, filesize)));
+	m_cacheinfo[key] = m_used.begin();
+	m_cache_dirty = true;
+	
+	m_cachesize += filesize;
+}
+
 bool WadImageCache::apply_cache_limit()
 {
 	bool deleted = false;
@@ -246,6 +266,14 @@ void WadImageCache::remove_image(WadImageDescriptor& desc, int width, int height
 {
 	if (width <= 0 || height <= 0)
 	{
+		for (std::set<cache_key_t>::iterator it = m_loading.begin(); it != m_loading.end(); )
+		{
+			if (boost::tuples::get<0>(*it) == desc)
+				m_loading.erase(it++);
+			else
+				++it;
+		}
+		
 		// Partial key specified; walk the map to find all matches
 		for (std::map<cache_key_t, cache_iter_t>::iterator it = m_cacheinfo.begin(); it != m_cacheinfo.end(); )
 		{
@@ -265,6 +293,7 @@ void WadImageCache::remove_image(WadImageDescriptor& desc, int width, int height
 	else
 	{
 		cache_key_t key = cache_key_t(desc, width, height);
+		m_loading.erase(key);
 		
 		std::map<cache_key_t, cache_iter_t>::iterator it = m_cacheinfo.find(key);
 		if (it != m_cacheinfo.end()) {
@@ -313,6 +342,186 @@ SDL_Surface *WadImageCache::get_image(WadImageDescriptor& desc, int width, int h
 	return surface;
 }
 
+SDL_Surface *WadImageCache::get_image_async(WadImageDescriptor& desc, int width, int height)
+{
+	cache_key_t key = cache_key_t(desc, width, height);
+	
+	std::map<cache_key_t, SDL_Surface *>::iterator it = m_ready.find(key);
+	if (it != m_ready.end())
+	{
+		SDL_Surface *surface = it->second;
+		m_ready.erase(it);
+		return surface;
+	}
+	
+	SDL_Surface *surface = retrieve_image(desc, width, height);
+	if (surface || m_loading.count(key) || m_failed.count(key))
+		return surface;
+	
+	load_job *job = new load_job;
+	job->key = key;
+	job->surface = NULL;
+	job->filesize = 0;
+	if (!image_data_from_desc(desc, job->data))
+	{
+		delete job;
+		m_failed.insert(key);
+		return NULL;
+	}
+	
+	m_loading.insert(key);
+	start_load(job);
+	return NULL;
+}
+
+void WadImageCache::start_load(load_job *job)
+{
+	if (!m_load_mutex)
+		m_load_mutex = SDL_CreateMutex();
+	
+	SDL_LockMutex(m_load_mutex);
+	m_queued.push_back(job);
+	int workers = MIN(int(k_max_workers), MAX(1, SDL_GetCPUCount() - 1));
+	bool start_worker = m_running_workers < workers && m_running_workers < static_cast<int>(m_queued.size());
+	if (start_worker)
+		++m_running_workers;
+	SDL_UnlockMutex(m_load_mutex);
+	
+	if (start_worker)
+	{
+		SDL_Thread *thread = SDL_CreateThread(load_worker, "WadImageCache", this);
+		if (thread)
+			m_workers.push_back(thread);
+		else
+			run_loads();
+	}
+}
+
+int WadImageCache::load_worker(void *cache)
+{
+	static_cast<WadImageCache *>(cache)->run_loads();
+	return 0;
+}
+
+// Runs until the queue is empty; touches nothing else in the cache
+void WadImageCache::run_loads()
+{
+	while (true)
+	{
+		SDL_LockMutex(m_load_mutex);
+		if (m_queued.empty())
+		{
+			--m_running_workers;
+			SDL_UnlockMutex(m_load_mutex);
+			return;
+		}
+		load_job *job = m_queued.front();
+		m_queued.pop_front();
+		SDL_UnlockMutex(m_load_mutex);
+		
+		SDL_Surface *image = image_from_data(job->data);
+		if (image)
+		{
+			job->surface = resize_image(image, boost::tuples::get<1>(job->key), boost::tuples::get<2>(job->key));
+			SDL_FreeSurface(image);
+		}
+		if (job->surface)
+			job->name = image_to_new_name(job->surface, &job->filesize);
+		std::vector<uint8>().swap(job->data);
+		
+		SDL_LockMutex(m_load_mutex);
+		m_loaded.push_back(job);
+		SDL_UnlockMutex(m_load_mutex);
+	}
+}
+
+bool WadImageCache::process_loads()
+{
+	if (!m_load_mutex)
+		return false;
+	
+	std::vector<load_job *> loaded;
+	SDL_LockMutex(m_load_mutex);
+	loaded.swap(m_loaded);
+	bool idle = m_running_workers == 0;
+	SDL_UnlockMutex(m_load_mutex);
+	
+	// every worker has returned, or is about to
+	if (idle)
+	{
+		for (size_t i = 0; i < m_workers.size(); ++i)
+			SDL_WaitThread(m_workers[i], NULL);
+		m_workers.clear();
+	}
+	
+	bool ready = false;
+	bool indexed = false;
+	for (size_t i = 0; i < loaded.size(); ++i)
+	{
+		load_job *job = loaded[i];
+		if (!m_loading.count(job->key))
+		{
+			// removed while it was loading
+			if (!job->name.empty())
+				delete_storage_for_name(job->name);
+			if (job->surface)
+				SDL_FreeSurface(job->surface);
+		}
+		else if (!job->surface)
+		{
+			m_loading.erase(job->key);
+			m_failed.insert(job->key);
+		}
+		else
+		{
+			m_loading.erase(job->key);
+			if (!job->name.empty())
+			{
+				// an entry whose file has gone missing since
+				if (m_cacheinfo.count(job->key))
+				{
+					WadImageDescriptor desc = boost::tuples::get<0>(job->key);
+					remove_image(desc, boost::tuples::get<1>(job->key), boost::tuples::get<2>(job->key));
+				}
+				index_image(job->key, job->name, job->filesize);
+				indexed = true;
+			}
+			
+			std::map<cache_key_t, SDL_Surface *>::iterator it = m_ready.find(job->key);
+			if (it != m_ready.end())
+				SDL_FreeSurface(it->second);
+			m_ready[job->key] = job->surface;
+			ready = true;
+		}
+		delete job;
+	}
+	
+	if (indexed)
+	{
+		apply_cache_limit();
+		autosave_cache();
+	}
+	return ready;
+}
+
+void WadImageCache::discard_loaded_images()
+{
+	for (std::map<cache_key_t, SDL_Surface *>::iterator it = m_ready.begin(); it != m_ready.end(); ++it)
+		SDL_FreeSurface(it->second);
+	m_ready.clear();
+	m_failed.clear();
+}
+
+void WadImageCache::finish_loads()
+{
+	for (size_t i = 0; i < m_workers.size(); ++i)
+		SDL_WaitThread(m_workers[i], NULL);
+	m_workers.clear();
+	
+	process_loads();
+	discard_loaded_images();
+}
+
 void WadImageCache::initialize_cache()
 {
 	FileSpecifier info;
@@ -356,6 +565,9 @@ void WadImageCache::initialize_cache()
 		m_cacheinfo[key] = m_used.begin();
 		m_cachesize += filesize;
 	}
+
+	// the limit may have come down since the cache was written
+	apply_cache_limit();
 }
 
 void WadImageCache::save_cache()
@@ -28,8 +28,14 @@
 
 #include <boost/tuple/tuple.hpp>
 #include <boost/tuple/tuple_comparison.hpp>
+#include <deque>
 #include <list>
 #include <map>
+#include <set>
+#include <vector>
+
+#include <SDL_mutex.h>
+#include <SDL_thread.h>
 
 struct WadImageDescriptor {
 	FileSpecifier file;
@@ -97,6 +103,20 @@ public:
 	// reading wad file directly.
 	SDL_Surface *get_image(WadImageDescriptor& desc, int width, int height, SDL_Surface *surface = NULL);
 
+	// Like get_image(), but an image that isn't cached yet is decoded,
+	// scaled and cached on a worker thread: returns NULL until a call
+	// after process_loads() has seen it finish. The wad itself is still
+	// read on the calling thread.
+	SDL_Surface *get_image_async(WadImageDescriptor& desc, int width, int height);
+
+	// Call these from the same thread as get_image_async(). Caches what
+	// the workers have finished; true if any images are newly ready.
+	bool process_loads();
+	// Frees ready images no one asked for again, and forgets failures
+	void discard_loaded_images();
+	// Waits for the workers, and caches what they made
+	void finish_loads();
+
 	void save_cache();
 	void set_cache_autosave(bool enabled) { m_autosave = enabled; }
 	
@@ -106,13 +126,30 @@ public:
 	
 
 private:
-	WadImageCache() : m_cachesize(0), m_sizelimit(300000000), m_autosave(true) { }
+	WadImageCache() : m_cachesize(0), m_sizelimit(300000000), m_autosave(true), m_load_mutex(NULL), m_running_workers(0) { }
 	
+	struct load_job {
+		cache_key_t key;
+		std::vector<uint8> data;
+		// filled in by the worker
+		SDL_Surface *surface;
+		std::string name;
+		int32 filesize;
+	};
+	enum { k_max_workers = 4 };
+
+	static bool image_data_from_desc(WadImageDescriptor& desc, std::vector<uint8>& data);
+	static SDL_Surface *image_from_data(std::vector<uint8>& data);
+	static int load_worker(void *);
+	void run_loads();
+	void start_load(load_job *job);
+
 	SDL_Surface *image_from_name(std::string& name) const;
 	void delete_storage_for_name(std::string& name) const;
 	SDL_Surface *resize_image(SDL_Surface *original, int width, int height) const;
 	std::string image_to_new_name(SDL_Surface *image, int32 *filesize = NULL) const;
 	std::string add_to_cache(cache_key_t key, SDL_Surface *surface);
+	void index_image(cache_key_t key, std::string& name, int32 filesize);
 	bool apply_cache_limit();
 	std::string retrieve_name(WadImageDescriptor& desc, int width, int height, bool mark_accessed = true);
 	void autosave_cache() { if (m_autosave) save_cache(); }
@@ -124,6 +161,19 @@ private:
 	size_t m_sizelimit;
 	bool m_autosave;
 	bool m_cache_dirty;
+
+	// only the workers and start_load() share these, under m_load_mutex
+	SDL_mutex *m_load_mutex;
+	std::deque<load_job *> m_queued;
+	std::vector<load_job *> m_loaded;
+	int m_running_workers;
+
+	std::vector<SDL_Thread *> m_workers;
+	// queued, or made and not yet cached; remove_image() takes keys
+	// out so the results are thrown away
+	std::set<cache_key_t> m_loading;
+	std::set<cache_key_t> m_failed;
+	std::map<cache_key_t, SDL_Surface *> m_ready;
 };
 
 
@@ -27,30 +27,61 @@ Aug 15, 2000 (Loren Petrich):
 
 Nov 6, 2000 (Loren Petrich);
 	Suppressed commented-out FileSpecifier function
+
+Oct 14, 2026:
+	Only the data checksums in the standalone hub, which has no files to read
+
+Oct 14, 2026:
+	Slice-by-8, with carry-less multiply (x86) or CRC instructions (ARMv8)
+	where there are any; update_data_crc() for checksums built up in pieces
 */
 
 #include <stdlib.h>
 
 #include "cseries.h"
+#ifndef A1_NETWORK_STANDALONE_HUB
 #include "FileHandler.h"
+#endif
 #include "crc.h"
 
 /* ---------- constants */
 #define TABLE_SIZE (256)
 #define CRC32_POLYNOMIAL 0xEDB88320L
-#define BUFFER_SIZE 1024
+#define BUFFER_SIZE (64*1024)
+
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(_MSC_VER))
+#define CRC_CLMUL
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CLMUL_TARGET
+#else
+#include <cpuid.h>
+#define CLMUL_TARGET __attribute__((target("pclmul")))
+#endif
+#endif
+
+#ifdef __ARM_FEATURE_CRC32
+#include <arm_acle.h>
+#endif
 
 /* ---------- local data */
-static uint32 *crc_table= NULL;
+/* Slice-by-8: crc_tables[0] is the classic byte-at-a-time table, and
+   crc_tables[k][n] is the crc of byte n followed by k zero bytes */
+static uint32 crc_tables[8][TABLE_SIZE];
 
 /* ---------- local prototypes ------- */
+#ifndef A1_NETWORK_STANDALONE_HUB
 static uint32 calculate_file_crc(unsigned char *buffer, 
-	short buffer_size, OpenedFile& OFile);
-static uint32 calculate_buffer_crc(int32 count, uint32 crc, void *buffer);
+	int32 buffer_size, OpenedFile& OFile);
+#endif
+static uint32 calculate_buffer_crc(int32 count, uint32 crc, const void *buffer);
 static bool build_crc_table(void);
-static void free_crc_table(void);
+static bool crc_tables_ready(void);
 
 /* -------------- Entry Point ----------- */
+#ifndef A1_NETWORK_STANDALONE_HUB
 uint32 calculate_crc_for_file(FileSpecifier& File)
 {
 	uint32 crc = 0;
@@ -70,110 +101,234 @@ uint32 calculate_crc_for_opened_file(OpenedFile& OFile)
 	uint32 crc = 0;
 	unsigned char *buffer;
 
-	/* Build the crc table */
-	if(build_crc_table())
+	buffer = new byte[BUFFER_SIZE];
+	if(buffer) 
 	{
-		buffer = new byte[BUFFER_SIZE];
-		if(buffer) 
-		{
-			crc= calculate_file_crc(buffer, BUFFER_SIZE, OFile);
-			delete []buffer;
-		}
-		
-		/* free the crc table! */
-		free_crc_table();
+		crc= calculate_file_crc(buffer, BUFFER_SIZE, OFile);
+		delete []buffer;
 	}
 
 	return crc;
 }
+#endif
 
 /* Calculate the crc for a file using the given buffer.. */
 uint32 calculate_data_crc(
 	unsigned char *buffer,
 	int32 length)
 {
-	uint32 crc = 0;
-
 	assert(buffer);
 	
-	/* Build the crc table */
-	if(build_crc_table())
-	{
-		/* The odd permutions ensure that we get the same crc as for a file */
-		crc = 0xFFFFFFFFL;
-		crc = calculate_buffer_crc(length, crc, buffer);
-		crc ^= 0xFFFFFFFFL;
-
-		/* free the crc table! */
-		free_crc_table();
-	}
+	return update_data_crc(0, buffer, length);
+}
 
-	return crc;
+uint32 update_data_crc(
+	uint32 crc,
+	const void *buffer,
+	int32 length)
+{
+	/* The odd permutions ensure that we get the same crc as for a file */
+	crc ^= 0xFFFFFFFFL;
+	crc = calculate_buffer_crc(length, crc, buffer);
+	return crc ^ 0xFFFFFFFFL;
 }
 
 /* ---------------- Private Code --------------- */
 static bool build_crc_table(
 	void)
 {
-	bool success= false;
+	/* Build the table */
+	short index, j;
+	uint32 crc;
 
-	assert(!crc_table);
-	crc_table= new uint32[TABLE_SIZE];
-	if(crc_table)
+	for(index= 0; index<TABLE_SIZE; ++index)
 	{
-		/* Build the table */
-		short index, j;
-		uint32 crc;
+		crc= index;
+		for(j=0; j<8; j++)
+		{
+			if(crc & 1) crc=(crc>>1) ^ CRC32_POLYNOMIAL;
+			else crc>>=1;
+		}
+		crc_tables[0][index] = crc;
+	}
 
-		for(index= 0; index<TABLE_SIZE; ++index)
+	for(index= 0; index<TABLE_SIZE; ++index)
+	{
+		crc= crc_tables[0][index];
+		for(j=1; j<8; j++)
 		{
-			crc= index;
-			for(j=0; j<8; j++)
-			{
-				if(crc & 1) crc=(crc>>1) ^ CRC32_POLYNOMIAL;
-				else crc>>=1;
-			}
-			crc_table[index] = crc;
+			crc= (crc >> 8) ^ crc_tables[0][crc & 0xff];
+			crc_tables[j][index]= crc;
 		}
-		
-		success= true;
 	}
 	
-	return success;
+	return true;
+}
+
+/* Built once, the first time anyone needs them (from any thread) */
+static bool crc_tables_ready(
+	void)
+{
+	static const bool built= build_crc_table();
+	return built;
 }
 
-static void free_crc_table(
+#ifdef CRC_CLMUL
+static bool has_clmul(
 	void)
 {
-	assert(crc_table);
-	delete []crc_table;
-	crc_table= NULL;
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	return (info[2] & (1 << 1)) != 0;
+#else
+	unsigned int eax, ebx, ecx, edx;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return false;
+	return (ecx & bit_PCLMUL) != 0;
+#endif
 }
 
+/* Folds 64 bytes at a time with carry-less multiplies, as in Intel's
+   "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ"; count
+   must be at least 64 and a multiple of 16 */
+CLMUL_TARGET static uint32 calculate_buffer_crc_clmul(
+	int32 count,
+	uint32 crc,
+	const unsigned char *p)
+{
+	const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+	const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+	const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124LL);
+	const __m128i poly = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+	const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+	x1 = _mm_loadu_si128((const __m128i *) (p + 0x00));
+	x2 = _mm_loadu_si128((const __m128i *) (p + 0x10));
+	x3 = _mm_loadu_si128((const __m128i *) (p + 0x20));
+	x4 = _mm_loadu_si128((const __m128i *) (p + 0x30));
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+	p += 64;
+	count -= 64;
+
+	while (count >= 64)
+	{
+		x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+		x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+		x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+		x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *) (p + 0x00)));
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i *) (p + 0x10)));
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i *) (p + 0x20)));
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i *) (p + 0x30)));
+		p += 64;
+		count -= 64;
+	}
+
+	/* Fold the four lanes into one */
+	x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+	x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+	x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+	while (count >= 16)
+	{
+		x2 = _mm_loadu_si128((const __m128i *) p);
+		x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+		p += 16;
+		count -= 16;
+	}
+
+	/* 128 bits to 64 */
+	x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+	x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, mask32);
+	x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	/* Barrett reduction to 32 */
+	x2 = _mm_and_si128(x1, mask32);
+	x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+	x2 = _mm_and_si128(x2, mask32);
+	x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+	x0 = _mm_srli_si128(x1, 4);
+	return static_cast<uint32>(_mm_cvtsi128_si32(x0));
+}
+#endif
+
 /* Calculate for a block of data incrementally */
 static uint32 calculate_buffer_crc(
 	int32 count, 
 	uint32 crc, 
-	void *buffer)
+	const void *buffer)
 {
-	unsigned char *p;
-	uint32 a;
-	uint32 b;
+	const unsigned char *p;
+
+	crc_tables_ready();
 
-	p= (unsigned char *) buffer;
-	while (count--) 
+	p= (const unsigned char *) buffer;
+
+#ifdef CRC_CLMUL
+	static const bool use_clmul= has_clmul();
+	if (use_clmul && count >= 64)
+	{
+		int32 folded= count & ~15;
+		crc= calculate_buffer_crc_clmul(folded, crc, p);
+		p+= folded;
+		count-= folded;
+	}
+#endif
+
+#ifdef __ARM_FEATURE_CRC32
+	while (count >= 8)
+	{
+		Uint64 data= 0;
+		for (int i= 7; i >= 0; --i)
+			data= (data << 8) | p[i];
+		crc= __crc32d(crc, data);
+		p+= 8;
+		count-= 8;
+	}
+#else
+	while (count >= 8)
 	{
-		a= (crc >> 8) & 0x00FFFFFFL;
-		b= crc_table[((int) crc ^ *p++) & 0xff];
-		crc= a^b;
+		uint32 one= crc ^ (p[0] | (p[1] << 8) | (p[2] << 16) | (uint32(p[3]) << 24));
+		uint32 two= p[4] | (p[5] << 8) | (p[6] << 16) | (uint32(p[7]) << 24);
+		crc= crc_tables[7][one & 0xff] ^ crc_tables[6][(one >> 8) & 0xff] ^
+			crc_tables[5][(one >> 16) & 0xff] ^ crc_tables[4][one >> 24] ^
+			crc_tables[3][two & 0xff] ^ crc_tables[2][(two >> 8) & 0xff] ^
+			crc_tables[1][(two >> 16) & 0xff] ^ crc_tables[0][two >> 24];
+		p+= 8;
+		count-= 8;
+	}
+#endif
+
+	while (count-- > 0) 
+	{
+		crc= (crc >> 8) ^ crc_tables[0][(crc ^ *p++) & 0xff];
 	}
 	return crc;
 }
 
+#ifndef A1_NETWORK_STANDALONE_HUB
 /* Calculate the crc for a file using the given buffer.. */
 static uint32 calculate_file_crc(
 	unsigned char *buffer, 
-	short buffer_size,
+	int32 buffer_size,
 	OpenedFile& OFile)
 {
 	uint32 crc;
@@ -192,7 +347,7 @@ static uint32 calculate_file_crc(
 	if (!OFile.SetPosition(0))
 		return 0;
 
-	crc = 0xFFFFFFFFL;
+	crc = 0;
 	while(file_length) 
 	{
 		if(file_length>buffer_size)
@@ -205,15 +360,16 @@ static uint32 calculate_file_crc(
 		if (!OFile.Read(count, buffer))
 			return 0;
 
-		crc = calculate_buffer_crc(count, crc, buffer);
+		crc = update_data_crc(crc, buffer, count);
 		file_length -= count;
 	}
 	
 	/* Restore the file position */
 	OFile.SetPosition(initial_position);
 
-	return (crc ^= 0xFFFFFFFFL);
+	return crc;
 }
+#endif
 
 /*  crcccitt.c - a demonstration of look up table based CRC
  *               computation using the non-reversed CCITT_CRC
@@ -38,6 +38,10 @@ uint32 calculate_crc_for_file(FileSpecifier& File);
 uint32 calculate_crc_for_opened_file(OpenedFile& OFile);
 uint32 calculate_data_crc(unsigned char *buffer, int32 length);
 
+// Start with 0, and pass each result to the next piece: the same as
+// calculate_data_crc() over all of them at once
+uint32 update_data_crc(uint32 crc, const void *buffer, int32 length);
+
 uint16 calculate_data_crc_ccitt(unsigned char *buffer, int32 length);
 
 #endif
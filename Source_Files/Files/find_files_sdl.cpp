@@ -28,6 +28,7 @@
 #include "cseries.h"
 #include "FileHandler.h"
 #include "find_files.h"
+#include "ScanCache.h"
 
 #include <vector>
 #include <algorithm>
@@ -64,8 +65,9 @@ bool FileFinder::_Find(DirectorySpecifier &dir, Typecode type, bool recursive, i
 
 		} else {
 
-			// Check file type and call found() function
-			if (type == WILDCARD_TYPE || type == file.GetType())
+			// Check file type and call found() function; the types of files
+			// that haven't changed since the last run are remembered
+			if (type == WILDCARD_TYPE || type == ScanCache::instance()->GetType(file, *i))
 				if (found(file))
 					return true;
 		}
@@ -107,6 +107,7 @@ Feb 15, 2002 (Br'fin (Jeremy Parsons)):
 #include "wad.h"
 #include "game_wad.h"
 #include "interface.h"
+#include "vbl.h"
 #include "game_window.h"
 #include "game_errors.h"
 #include "computer_interface.h" // for loading/saving terminal state.
@@ -129,6 +130,9 @@ Feb 15, 2002 (Br'fin (Jeremy Parsons)):
 
 #include "Music.h"
 
+#include <SDL_atomic.h>
+#include <SDL_thread.h>
+
 // unify the save game code into one structure.
 
 /* -------- local globals */
@@ -226,6 +230,9 @@ void *get_map_for_net_transfer(
 /* This takes a cstring */
 void set_map_file(FileSpecifier& File)
 {
+	// what's being read ahead is from the old one
+	cancel_level_preload();
+
 	// Do whatever parameter restoration is specified before changing the file
 	if (file_is_set) RunRestorationScript();
 
@@ -267,6 +274,179 @@ bool use_map_file(
 	return success;
 }
 
+// The next level is read while the current one plays; nothing the game
+// simulates is touched until load_level_from_map() takes it over
+struct level_preload_data
+{
+	SDL_Thread *thread;
+	SDL_atomic_t cancel;
+
+	short level_index;
+	std::string map_path;
+	OpenedFile map_file;
+	struct wad_header header;
+	struct wad_data *wad;
+
+	FileSpecifier shapes_spec;
+	OpenedFile shapes_file;
+	bool landscapes_loaded;
+	bool wanted[NUMBER_OF_COLLECTIONS];
+	int32 offsets[NUMBER_OF_COLLECTIONS];
+	int32 lengths[NUMBER_OF_COLLECTIONS];
+	byte *data[NUMBER_OF_COLLECTIONS];
+};
+static level_preload_data level_preload;
+
+extern bool collection_loaded(short);
+
+static int level_preload_thread(void *)
+{
+	int32 length;
+	uint8 *raw_wad= read_raw_indexed_wad_from_file(level_preload.map_file, &level_preload.header, level_preload.level_index, &length);
+	if (raw_wad)
+		level_preload.wad= read_only_wad_from_raw(&level_preload.header, raw_wad, length);
+	level_preload.map_file.Close();
+
+	// Besides what's loaded now, the new level's environment
+	if (level_preload.wad)
+	{
+		size_t data_length;
+		uint8 *data= (uint8 *) extract_type_from_wad(level_preload.wad, MAP_INFO_TAG, &data_length);
+		if (data_length == SIZEOF_static_data)
+		{
+			static_data map_info;
+			unpack_static_data(data, &map_info, 1);
+			for (short collection_index= 0; collection_index<NUMBER_OF_COLLECTIONS; ++collection_index)
+			{
+				if (collection_in_environment(collection_index, map_info.environment_code))
+					level_preload.wanted[collection_index]= true;
+			}
+			short landscape= _collection_landscape1+map_info.song_index;
+			if (level_preload.landscapes_loaded && landscape>=_collection_landscape1 && landscape<NUMBER_OF_COLLECTIONS)
+				level_preload.wanted[landscape]= true;
+		}
+	}
+
+	if (level_preload.shapes_file.IsOpen())
+	{
+		for (short collection_index= 0; collection_index<NUMBER_OF_COLLECTIONS; ++collection_index)
+		{
+			if (SDL_AtomicGet(&level_preload.cancel))
+				break;
+			if (!level_preload.wanted[collection_index] || level_preload.lengths[collection_index]<=0)
+				continue;
+
+			byte *data= (byte *) malloc(level_preload.lengths[collection_index]);
+			if (data && level_preload.shapes_file.SetPosition(level_preload.offsets[collection_index]) &&
+				level_preload.shapes_file.Read(level_preload.lengths[collection_index], data))
+			{
+				level_preload.data[collection_index]= data;
+			} else {
+				free(data);
+			}
+		}
+		level_preload.shapes_file.Close();
+	}
+
+	return 0;
+}
+
+void start_level_preload(
+	short level_index)
+{
+	cancel_level_preload();
+	if (!file_is_set || level_index<0) return;
+
+	// Failing to open anything here only means there's nothing preloaded
+	short SavedType, SavedError = get_game_error(&SavedType);
+
+	if (open_wad_file_for_reading(MapFileSpec, level_preload.map_file) &&
+		read_wad_header(level_preload.map_file, &level_preload.header) &&
+		level_index<level_preload.header.wad_count)
+	{
+		level_preload.level_index= level_index;
+		level_preload.map_path= MapFileSpec.GetPath();
+		level_preload.wad= NULL;
+		level_preload.landscapes_loaded= LandscapesLoaded;
+
+		bool stage_collections= get_shapes_file_for_staging(level_preload.shapes_spec) &&
+			level_preload.shapes_spec.Open(level_preload.shapes_file);
+		for (short collection_index= 0; collection_index<NUMBER_OF_COLLECTIONS; ++collection_index)
+		{
+			level_preload.wanted[collection_index]= collection_loaded(collection_index);
+			level_preload.data[collection_index]= NULL;
+			if (!stage_collections || !get_collection_extent(collection_index, level_preload.offsets[collection_index], level_preload.lengths[collection_index]))
+				level_preload.lengths[collection_index]= 0;
+		}
+
+		SDL_AtomicSet(&level_preload.cancel, 0);
+		level_preload.thread= SDL_CreateThread(level_preload_thread, "level_preload", NULL);
+	}
+
+	if (!level_preload.thread)
+	{
+		level_preload.map_file.Close();
+		level_preload.shapes_file.Close();
+	}
+
+	set_game_error(SavedType, SavedError);
+}
+
+// Waits for the preload; its collections are staged for the next
+// load_collections() either way, and its wad is returned if it's the one
+// at that index in the file whose header was just read
+static struct wad_data *finish_level_preload(
+	short level_index,
+	struct wad_header *header)
+{
+	if (!level_preload.thread) return NULL;
+
+	SDL_WaitThread(level_preload.thread, NULL);
+	level_preload.thread= NULL;
+
+	for (short collection_index= 0; collection_index<NUMBER_OF_COLLECTIONS; ++collection_index)
+	{
+		if (level_preload.data[collection_index])
+		{
+			stage_collection_data(collection_index, level_preload.shapes_spec, level_preload.offsets[collection_index],
+				level_preload.data[collection_index], level_preload.lengths[collection_index]);
+			level_preload.data[collection_index]= NULL;
+		}
+	}
+
+	struct wad_data *wad= level_preload.wad;
+	level_preload.wad= NULL;
+	if (wad && (level_index!=level_preload.level_index || level_preload.map_path!=MapFileSpec.GetPath() ||
+		header->checksum!=level_preload.header.checksum || header->directory_offset!=level_preload.header.directory_offset ||
+		header->wad_count!=level_preload.header.wad_count))
+	{
+		free_wad(wad);
+		wad= NULL;
+	}
+
+	return wad;
+}
+
+void cancel_level_preload()
+{
+	if (!level_preload.thread) return;
+
+	SDL_AtomicSet(&level_preload.cancel, 1);
+	SDL_WaitThread(level_preload.thread, NULL);
+	level_preload.thread= NULL;
+
+	for (short collection_index= 0; collection_index<NUMBER_OF_COLLECTIONS; ++collection_index)
+	{
+		free(level_preload.data[collection_index]);
+		level_preload.data[collection_index]= NULL;
+	}
+	if (level_preload.wad)
+	{
+		free_wad(level_preload.wad);
+		level_preload.wad= NULL;
+	}
+}
+
 bool load_level_from_map(
 	short level_index)
 {
@@ -295,8 +475,9 @@ bool load_level_from_map(
 			{
 				if(index_to_load>=0 && index_to_load<header.wad_count)
 				{
-                        
-					wad= read_indexed_wad_from_file(MapFile, &header, index_to_load, true);
+					wad= restoring_game ? NULL : finish_level_preload(index_to_load, &header);
+					if (!wad)
+						wad= read_indexed_wad_from_file(MapFile, &header, index_to_load, true);
 					if (wad)
 					{
 						/* Process everything... */
@@ -838,7 +1019,13 @@ bool goto_level(
 			place_initial_objects();
 			initialize_control_panels_for_level();
 		}
-		
+
+		// Netgames get their levels from the gatherer
+		if (success && !game_is_networked)
+		{
+			short next_level= first_interlevel_teleport_destination();
+			start_level_preload(next_level!=NONE ? next_level : entry->level_number+1);
+		}
 	}
 	
 //	if(!success) alert_user(fatalError, strERRORS, badReadMap, -1);
@@ -1180,6 +1367,7 @@ bool load_game_from_file(FileSpecifier& File, bool run_scripts, bool *was_map_fo
 	revert_game_data.SavedGame = File;
 
 	/* Use the save game file.. */
+	finish_saving_game();
 	set_map_file(File);
 	
 	/* Load the level from the map */
@@ -1253,6 +1441,11 @@ bool revert_game(
 	
 	assert(dynamic_world->player_count==1);
 
+	// what's loaded now, to see whether the saved game is on the same level
+	short level_number= dynamic_world->current_level_number;
+	short environment_code= static_world->environment_code;
+	uint32 map_checksum= file_is_set ? get_current_map_checksum() : 0;
+
 	leaving_map();
 	
 	if (revert_game_data.game_is_from_disk)
@@ -1264,9 +1457,13 @@ bool revert_game(
 			Music::instance()->PreloadLevelMusic();
 			RunLuaScript();
 			
+			// if it is, the collections stay, and only the world in them is replaced
+			bool same_level= file_is_set && dynamic_world->current_level_number == level_number &&
+				static_world->environment_code == environment_code && get_current_map_checksum() == map_checksum;
+
 			// LP: added for loading the textures if one had died on another level;
 			// this gets around WZ's moving of this line into make_restored_game_relevant()
-			successful = entering_map(true /*restoring game*/);
+			successful = entering_map(true /*restoring game*/, same_level);
 		}
 
 		/* And they don't get to continue. */
@@ -1294,6 +1491,38 @@ bool revert_game(
 	return successful;
 }
 
+// Starts the film being replayed over, the way begin_game() started it
+bool revert_replay(
+	void)
+{
+	short number_of_players, recording_version;
+	uint32 map_checksum;
+	struct player_start_data starts[MAXIMUM_NUMBER_OF_PLAYERS];
+	struct game_data game_information;
+	struct entry_point entry;
+	bool successful;
+
+	obj_clear(entry);
+	get_recording_header_data(&number_of_players, &entry.level_number, &map_checksum,
+		&recording_version, starts, &game_information);
+	game_information.game_options |= _overhead_map_is_omniscient;
+
+	leaving_map();
+	rewind_replay();
+	successful= new_game(number_of_players, false, &game_information, starts, &entry);
+
+	if(successful)
+	{
+		update_interface(NONE);
+		ChaseCam_Reset();
+		ResetFieldOfView();
+		reset_messages();
+		ReloadViewContext();
+	}
+
+	return successful;
+}
+
 bool export_level(FileSpecifier& File)
 {
 	struct wad_header header;
@@ -1320,15 +1549,23 @@ bool export_level(FileSpecifier& File)
 				offset = SIZEOF_wad_header;
 				
 				wad = build_export_wad(&header, &wad_length);
+				uint8 *raw_wad = NULL;
 				if (wad)
+				{
+					raw_wad = build_raw_wad(&header, wad, &wad_length);
+					free_wad(wad);
+				}
+				if (raw_wad)
 				{
 					set_indexed_directory_offset_and_length(&header, &entry, 0, offset, wad_length, 0);
 					
-					if (write_wad(SaveFile, &header, wad, offset))
+					/* Checksum it here, rather than reading it back */
+					header.directory_offset= offset + wad_length;
+					header.checksum= calculate_raw_wadfile_checksum(&header, raw_wad, wad_length, &entry);
+
+					if (write_raw_wad(SaveFile, raw_wad, wad_length, offset))
 					{
 						/* Update the new header */
-												offset+= wad_length;
-						header.directory_offset= offset;
 						if (write_wad_header(SaveFile, &header) && write_directorys(SaveFile, &header, &entry))
 						{
 							/* We win. */
@@ -1336,12 +1573,11 @@ bool export_level(FileSpecifier& File)
 						} 
 					}
 					
-					free_wad(wad);
+					free(raw_wad);
 				}
 			}
 
 			err = SaveFile.GetError();
-			calculate_and_store_wadfile_checksum(SaveFile);
 			close_wad_file(SaveFile);
 		}
 
@@ -1382,15 +1618,140 @@ void get_current_saved_game_name(FileSpecifier& File)
 	File = revert_game_data.SavedGame;
 }
 
+// What a save hands over to the thread that writes it
+struct game_save_data {
+	FileSpecifier File;
+	FileSpecifier TempFile;
+	OpenedFile SaveFile;
+	struct wad_header header;
+	uint8 *game_wad;
+	int32 game_wad_length;
+	std::string metadata;
+	SDL_Surface *image;
+	save_game_image_encoder encode_image;
+	bool compress;
+
+	short error;
+	SDL_Thread *thread;
+	SDL_atomic_t done;
+};
+static game_save_data *game_save= NULL;
+
+// Stores a wad the way the header says its entries are stored
+static uint8 *stored_raw_wad(struct wad_header *header, uint8 *raw_wad, int32 raw_length, int32 *length)
+{
+	if (!(header->flags & WADFILE_ENTRIES_ARE_COMPRESSED))
+	{
+		*length= raw_length;
+		return raw_wad;
+	}
+
+	uint8 *compressed= compress_raw_wad(raw_wad, raw_length, length);
+	free(raw_wad);
+	return compressed;
+}
+
+static int game_save_thread(void *)
+{
+	game_save_data& save= *game_save;
+	struct wad_header& header= save.header;
+	struct directory_entry entries[2];
+	int32 offset= SIZEOF_wad_header;
+	bool success= false;
+
+	std::string imagedata;
+	if (save.image)
+	{
+		if (save.encode_image) imagedata= save.encode_image(save.image);
+		SDL_FreeSurface(save.image);
+		save.image= NULL;
+	}
+
+	if (save.compress) header.flags|= WADFILE_ENTRIES_ARE_COMPRESSED;
+
+	int32 game_wad_length, meta_wad_length= 0;
+	uint8 *game_wad= stored_raw_wad(&header, save.game_wad, save.game_wad_length, &game_wad_length);
+	uint8 *meta_wad= NULL;
+	save.game_wad= NULL;
+
+	struct wad_data *meta= build_meta_game_wad(save.metadata, imagedata, &header, &meta_wad_length);
+	if (meta)
+	{
+		meta_wad= build_raw_wad(&header, meta, &meta_wad_length);
+		free_wad(meta);
+		if (meta_wad) meta_wad= stored_raw_wad(&header, meta_wad, meta_wad_length, &meta_wad_length);
+	}
+
+	if (game_wad && meta_wad && write_wad_header(save.SaveFile, &header))
+	{
+		set_indexed_directory_offset_and_length(&header,
+			entries, 0, offset, game_wad_length, 0);
+
+		if (write_raw_wad(save.SaveFile, game_wad, game_wad_length, offset))
+		{
+			offset+= game_wad_length;
+			header.directory_offset= offset;
+
+			set_indexed_directory_offset_and_length(&header,
+				entries, 1, offset, meta_wad_length, SAVE_GAME_METADATA_INDEX);
+
+			if (write_raw_wad(save.SaveFile, meta_wad, meta_wad_length, offset))
+			{
+				offset+= meta_wad_length;
+				header.directory_offset= offset;
+
+				if (write_wad_header(save.SaveFile, &header) && write_directorys(save.SaveFile, &header, entries))
+				{
+					/* We win. */
+					success= true;
+				}
+			}
+		}
+	}
+	free(game_wad);
+	free(meta_wad);
+
+	save.error= save.SaveFile.GetError();
+	close_wad_file(save.SaveFile);
+
+	if (!save.error && (!success || !save.TempFile.Rename(save.File)))
+	{
+		save.error= 1;
+	}
+
+	SDL_AtomicSet(&save.done, 1);
+	return 0;
+}
+
+void finish_saving_game(bool report_errors)
+{
+	if (!game_save) return;
+
+	SDL_WaitThread(game_save->thread, NULL);
+	short err= game_save->error;
+	delete game_save;
+	game_save= NULL;
+
+	if (err && report_errors)
+	{
+		alert_user(infoError, strERRORS, fileError, err);
+	}
+}
+
+void saving_game_idle_proc()
+{
+	if (game_save && SDL_AtomicGet(&game_save->done))
+		finish_saving_game();
+}
+
 /* The current mapfile should be set to the save game file... */
-bool save_game_file(FileSpecifier& File, const std::string& metadata, const std::string& imagedata)
+bool save_game_file(FileSpecifier& File, const std::string& metadata, SDL_Surface *image, save_game_image_encoder encode_image)
 {
-	struct wad_header header;
 	short err = 0;
 	bool success= false;
-	int32 offset, wad_length;
-	struct directory_entry entries[2];
-	struct wad_data *wad, *meta_wad;
+
+	/* One at a time */
+	finish_saving_game();
 
 	/* Save off the random seed. */
 	dynamic_world->random_seed= get_random_seed();
@@ -1399,86 +1760,68 @@ bool save_game_file(FileSpecifier& File, const std::string& metadata, const std:
 	revert_game_data.game_is_from_disk= true;
 	revert_game_data.SavedGame = File;
 
+	game_save_data *save= new game_save_data;
+	save->File= File;
+	save->game_wad= NULL;
+	save->image= NULL;
+	save->error= 0;
+	save->thread= NULL;
+	SDL_AtomicSet(&save->done, 0);
+
 	// LP: add a file here; use temporary file for a safe save.
 	// Write into the temporary file first
-	FileSpecifier TempFile;
-	TempFile.SetTempName(File);
+	save->TempFile.SetTempName(File);
 	
 	/* Fill in the default wad header (we are using File instead of TempFile to get the name right in the header) */
-	fill_default_wad_header(File, CURRENT_WADFILE_VERSION, EDITOR_MAP_VERSION, 2, 0, &header);
+	fill_default_wad_header(File, CURRENT_WADFILE_VERSION, EDITOR_MAP_VERSION, 2, 0, &save->header);
+	save->header.parent_checksum= read_wad_file_checksum(MapFileSpec);
 		
 	/* Assume that we confirmed on save as... */
-	if (create_wadfile(TempFile,_typecode_savegame))
+	if (create_wadfile(save->TempFile,_typecode_savegame))
 	{
-		OpenedFile SaveFile;
-		if(open_wad_file_for_writing(TempFile,SaveFile))
+		if(open_wad_file_for_writing(save->TempFile,save->SaveFile))
 		{
-			/* Write out the new header */
-			if (write_wad_header(SaveFile, &header))
+			/* Only the snapshot of the world is taken here */
+			int32 wad_length;
+			struct wad_data *wad= build_save_game_wad(&save->header, &wad_length);
+			if (wad)
 			{
-				offset= SIZEOF_wad_header;
-		
-				wad= build_save_game_wad(&header, &wad_length);
-				if (wad)
-				{
-					/* Set the entry data.. */
-					set_indexed_directory_offset_and_length(&header, 
-						entries, 0, offset, wad_length, 0);
-					
-					/* Save it.. */
-					if (write_wad(SaveFile, &header, wad, offset))
-					{
-						/* Update the new header */
-						offset+= wad_length;
-						header.directory_offset= offset;
-						header.parent_checksum= read_wad_file_checksum(MapFileSpec);
-						
-						/* Create metadata wad */
-						meta_wad = build_meta_game_wad(metadata, imagedata, &header, &wad_length);
-						if (meta_wad)
-						{
-							set_indexed_directory_offset_and_length(&header,
-								entries, 1, offset, wad_length, SAVE_GAME_METADATA_INDEX);
-							
-							if (write_wad(SaveFile, &header, meta_wad, offset))
-							{
-								offset+= wad_length;
-								header.directory_offset= offset;
-						
-								if (write_wad_header(SaveFile, &header) && write_directorys(SaveFile, &header, entries))
-								{
-									/* We win. */
-									success= true;
-								}
-							}
-							
-							free_wad(meta_wad);
-						}
-					}
-
-					free_wad(wad);
-				}
+				save->game_wad= build_raw_wad(&save->header, wad, &save->game_wad_length);
+				free_wad(wad);
 			}
 
-			err = SaveFile.GetError();
-			close_wad_file(SaveFile);
-		}
-		
-		if (!err)
-		{
-			if (!TempFile.Rename(File))
+			if (save->game_wad && !error_pending())
 			{
-				err = 1;
+				save->metadata= metadata;
+				save->image= image;
+				save->encode_image= encode_image;
+				save->compress= environment_preferences->compress_saved_games;
+				image= NULL;
+
+				game_save= save;
+				game_save->thread= SDL_CreateThread(game_save_thread, "game_save", NULL);
+				if (!game_save->thread)
+				{
+					/* Write it here instead */
+					game_save_thread(NULL);
+				}
+				return true;
 			}
+
+			err = save->SaveFile.GetError();
+			close_wad_file(save->SaveFile);
 		}
 	}
+
+	free(save->game_wad);
+	delete save;
+	if (image) SDL_FreeSurface(image);
 	
 	if(err || error_pending())
 	{
 		if(!err) err= get_game_error(NULL);
 		alert_user(infoError, strERRORS, fileError, err);
 		clear_game_error();
-		success= false;
 	}
 	
 	return success;
@@ -1970,6 +2313,11 @@ static void load_redundant_map_data(
 		recalculate_redundant_map();
 		precalculate_map_indexes();
 	}
+	
+	build_polygon_lookup_grid();
+	reset_potentially_visible_sets();
+	invalidate_polygon_object_counts();
+	line_visibility_changed();
 }
 
 void load_terminal_data(
@@ -2615,6 +2963,12 @@ static void complete_restoring_level(
 	ok_to_reset_scenery_solidity = false;
 	/* Loading games needs this done. */
 	reset_action_queues();
+
+	/* the object, monster, effect and projectile lists were just unpacked */
+	rebuild_object_slot_index();
+	rebuild_monster_slot_index();
+	rebuild_projectile_slot_index();
+	rebuild_effect_slot_index();
 }
 
 
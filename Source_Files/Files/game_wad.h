@@ -37,8 +37,21 @@ Aug 12, 2000 (Loren Petrich):
 #include <string>
 
 class FileSpecifier;
-
-bool save_game_file(FileSpecifier& File, const std::string& metadata, const std::string& imagedata);
+struct SDL_Surface;
+
+// Turns a saved game's preview image into the bytes stored with it; this
+// runs on the thread that writes the file
+typedef std::string (*save_game_image_encoder)(SDL_Surface *image);
+
+// Takes the world into memory and returns; a worker thread encodes the
+// image (which it takes over, and may be NULL), compresses the world if the
+// environment preferences ask for it, and writes the file
+bool save_game_file(FileSpecifier& File, const std::string& metadata, SDL_Surface *image, save_game_image_encoder encode_image);
+// Waits for the file being written, if any, and alerts about its errors;
+// anything that reads saved games calls this first
+void finish_saving_game(bool report_errors = true);
+// Alerts about a finished save's errors, without waiting for one
+void saving_game_idle_proc();
 struct wad_data *build_meta_game_wad(const std::string& metadata, const std::string& imagedata, struct wad_header *header, int32 *length);
 
 bool export_level(FileSpecifier& File);
@@ -62,6 +75,11 @@ FileSpecifier& get_map_file(void);
 
 void level_has_embedded_physics_lua(int Level, bool& HasPhysics, bool& HasLua);
 
+// Reads the level's wad, and stages the collections it is likely to use, on
+// a worker thread; load_level_from_map() takes them over if it's that level
+void start_level_preload(short level_index);
+void cancel_level_preload();
+
 /* --------- from PREPROCESS_MAP_MAC.C */
 // Most of the get_default_filespecs moved to interface.h
 void get_savegame_filedesc(FileSpecifier& File);
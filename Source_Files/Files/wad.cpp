@@ -90,6 +90,9 @@ Jan 25, 2002 (Br'fin (Jeremy Parsons)):
 #include "FileHandler.h"
 #include "Packing.h"
 
+#include <vector>
+#include <zlib.h>
+
 // Formerly in portable_files.h
 inline short memory_error() {return 0;}
 
@@ -113,6 +116,8 @@ static bool read_indexed_directory_data(OpenedFile& OFile, struct wad_header *he
 static int32 calculate_raw_wad_length(struct wad_header *file_header, uint8 *wad);
 static bool read_indexed_wad_from_file_into_buffer(OpenedFile& OFile, 
 	struct wad_header *header, short index, void *buffer, int32 *length);
+static uint8 *read_compressed_indexed_wad(OpenedFile& OFile, struct wad_header *header,
+	short index, int32 *length);
 static short count_raw_tags(uint8 *raw_wad);
 static struct wad_data *convert_wad_from_raw(struct wad_header *header, uint8 *data,	int32 wad_start_offset,
 	int32 raw_length);
@@ -167,6 +172,46 @@ bool read_wad_header(
 
 extern void *level_transition_malloc(size_t size);
 
+static struct wad_data *read_mapped_indexed_wad(
+	OpenedFile& OFile,
+	struct wad_header *header,
+	short index,
+	int32 padded_length)
+{
+	struct directory_entry entry;
+	if (!read_indexed_directory_data(OFile, header, index, &entry) || entry.length <= 0)
+		return NULL;
+
+	void *base;
+	size_t base_length;
+	uint8 *raw_wad= OFile.Map(entry.offset_to_start, padded_length, base, base_length);
+	if (!raw_wad)
+		return NULL;
+
+	/* Veracity Check */
+	if (entry.length!=calculate_raw_wad_length(header, raw_wad))
+	{
+		OpenedFile::Unmap(base, base_length);
+		return NULL;
+	}
+
+	struct wad_data *read_wad= convert_wad_from_raw(header, raw_wad, 0, entry.length);
+	if (!read_wad || !read_wad->read_only_data)
+	{
+		if (read_wad)
+		{
+			free(read_wad->tag_data);
+			free(read_wad);
+		}
+		OpenedFile::Unmap(base, base_length);
+		return NULL;
+	}
+
+	read_wad->mapped_base= base;
+	read_wad->mapped_length= base_length;
+	return read_wad;
+}
+
 /* This could be improved.  Under the current implementation, it requires 2X sizeof level worth */
 /*  of memory to load... (This makes writing wads easier, but isn't really useful for loading */
 /* Note that this does the correct thing for union wadfiles... */
@@ -181,6 +226,22 @@ struct wad_data *read_indexed_wad_from_file(
      int32 length = 0;
 	int error = 0;
 
+	if (header->flags & WADFILE_ENTRIES_ARE_COMPRESSED)
+	{
+		raw_wad= read_compressed_indexed_wad(OFile, header, index, &length);
+		if (raw_wad)
+		{
+			read_wad= read_only ?
+				convert_wad_from_raw(header, raw_wad, 0, length) :
+				convert_wad_from_raw_modifiable(header, raw_wad, length);
+			if (!read_wad || !read_only)
+				free(raw_wad);
+		}
+		if (!read_wad)
+			set_game_error(systemError, memory_error());
+		return read_wad;
+	}
+
 	// if(file_id>=0) /* NOT a union wadfile... */
 	{
 		if (size_of_indexed_wad(OFile, header, index, &length))
@@ -189,6 +250,14 @@ struct wad_data *read_indexed_wad_from_file(
 			// on Marathon 1 wadfiles, which have a shorter entry header
 			int32 padded_length = length + (SIZEOF_entry_header-SIZEOF_old_entry_header);
 
+			// Read-only wads from plain files point into a mapping of the file
+			// instead of a copy; the padding must be in the file too
+			if(read_only && length > 0)
+			{
+				read_wad= read_mapped_indexed_wad(OFile, header, index, padded_length);
+				if(read_wad) return read_wad;
+			}
+
 			raw_wad= BetweenLevels ?
 				(uint8 *) level_transition_malloc(padded_length) :
 				(uint8 *) malloc(padded_length);
@@ -235,6 +304,55 @@ struct wad_data *read_indexed_wad_from_file(
 	return read_wad;
 }
 
+uint8 *read_raw_indexed_wad_from_file(
+	OpenedFile& OFile,
+	struct wad_header *header,
+	short index,
+	int32 *length)
+{
+	if (header->flags & WADFILE_ENTRIES_ARE_COMPRESSED)
+		return read_compressed_indexed_wad(OFile, header, index, length);
+
+	struct directory_entry entry;
+	if (!read_indexed_directory_data(OFile, header, index, &entry) || entry.length <= 0)
+		return NULL;
+
+	// The same padding as read_indexed_wad_from_file()
+	uint8 *raw_wad= (uint8 *) malloc(entry.length + (SIZEOF_entry_header-SIZEOF_old_entry_header));
+	if (!raw_wad)
+		return NULL;
+
+	if (!read_from_file(OFile, entry.offset_to_start, raw_wad, entry.length) ||
+		entry.length!=calculate_raw_wad_length(header, raw_wad))
+	{
+		free(raw_wad);
+		return NULL;
+	}
+
+	*length= entry.length;
+	return raw_wad;
+}
+
+struct wad_data *read_only_wad_from_raw(
+	struct wad_header *header,
+	uint8 *raw_wad,
+	int32 length)
+{
+	struct wad_data *read_wad= convert_wad_from_raw(header, raw_wad, 0, length);
+	if (!read_wad || !read_wad->read_only_data)
+	{
+		if (read_wad)
+		{
+			free(read_wad->tag_data);
+			free(read_wad);
+		}
+		free(raw_wad);
+		return NULL;
+	}
+
+	return read_wad;
+}
+
 void *extract_type_from_wad(
 	struct wad_data *wad,
 	WadDataType type, 
@@ -651,6 +769,26 @@ void calculate_and_store_wadfile_checksum(OpenedFile& OFile)
 	write_wad_header(OFile, &header);
 }
 
+uint32 calculate_raw_wadfile_checksum(
+	struct wad_header *header,
+	uint8 *raw_wad,
+	int32 raw_length,
+	void *entries)
+{
+	struct wad_header unsummed= *header;
+	uint8 buffer[SIZEOF_wad_header];
+	uint32 crc;
+
+	/* As calculate_and_store_wadfile_checksum() reads the file */
+	unsummed.checksum= 0;
+	obj_clear(buffer);
+	pack_wad_header(buffer, &unsummed, 1);
+
+	crc= update_data_crc(0, buffer, SIZEOF_wad_header);
+	crc= update_data_crc(crc, raw_wad, raw_length);
+	return update_data_crc(crc, entries, get_size_of_directory_data(header));
+}
+
 bool write_wad(
 	OpenedFile& OFile, 
 	struct wad_header *file_header,
@@ -720,6 +858,87 @@ bool write_wad(
 	return success;
 }
 
+uint8 *build_raw_wad(
+	struct wad_header *file_header,
+	struct wad_data *wad,
+	int32 *length)
+{
+	short entry_header_length= get_entry_header_length(file_header);
+	int32 raw_length= calculate_wad_length(file_header, wad);
+	
+	assert(!wad->read_only_data);
+
+	uint8 *raw_wad= (uint8 *) malloc(MAX(raw_length, 1));
+	if (!raw_wad) return NULL;
+
+	uint8 *S= raw_wad;
+	int32 running_offset= 0;
+	for (short index= 0; index<wad->tag_count; ++index)
+	{
+		struct entry_header header;
+		header.tag= wad->tag_data[index].tag;
+		header.length= wad->tag_data[index].length;
+		header.offset= wad->tag_data[index].offset;
+
+		/* As write_wad() does it */
+		if (index==wad->tag_count-1)
+		{
+			header.next_offset= 0;
+		} else {
+			running_offset+= header.length+entry_header_length;
+			header.next_offset= running_offset;
+		}
+
+		switch (entry_header_length)
+		{
+		case SIZEOF_old_entry_header:
+			S= pack_old_entry_header(S,(old_entry_header *)&header,1);
+			break;
+		case SIZEOF_entry_header:
+			S= pack_entry_header(S,&header,1);
+			break;
+		default:
+			vassert(false,csprintf(temporary,"Unrecognized entry-header length: %d",entry_header_length));
+		}
+		memcpy(S, wad->tag_data[index].data, header.length);
+		S+= header.length;
+	}
+
+	assert(S - raw_wad == raw_length);
+	*length= raw_length;
+	return raw_wad;
+}
+
+uint8 *compress_raw_wad(
+	uint8 *raw_wad,
+	int32 raw_length,
+	int32 *length)
+{
+	uLongf compressed_length= compressBound(raw_length);
+	uint8 *compressed= (uint8 *) malloc(4 + compressed_length);
+	if (!compressed) return NULL;
+
+	uint8 *S= compressed;
+	ValueToStream(S, uint32(raw_length));
+	if (compress2(S, &compressed_length, raw_wad, raw_length, Z_DEFAULT_COMPRESSION) != Z_OK)
+	{
+		free(compressed);
+		return NULL;
+	}
+
+	*length= 4 + int32(compressed_length);
+	return compressed;
+}
+
+bool write_raw_wad(
+	OpenedFile& OFile,
+	uint8 *raw_wad,
+	int32 length,
+	int32 offset)
+{
+	return write_to_file(OFile, offset, raw_wad, length);
+}
+
 short number_of_wads_in_file(FileSpecifier& File)
 {
 	short count= NONE;
@@ -748,7 +967,12 @@ void free_wad(
 	assert(wad);
 	
 	/* Free all of the tags */
-	if(wad->read_only_data)
+	if(wad->mapped_base)
+	{
+		/* Read only, straight from the file */
+		OpenedFile::Unmap(wad->mapped_base, wad->mapped_length);
+		free(wad->tag_data);
+	} else if(wad->read_only_data)
 	{
 		/* Read only wad.. */
 		free(wad->read_only_data);
@@ -813,7 +1037,30 @@ void *get_flat_data(
 		/* Read the file */
 		success= read_wad_header(OFile, &header);
 
-		if (success)
+		if (success && (header.flags & WADFILE_ENTRIES_ARE_COMPRESSED))
+		{
+			/* Flat data is always uncompressed */
+			int32 length;
+			uint8 *raw_wad= read_compressed_indexed_wad(OFile, &header, wad_index, &length);
+			if (raw_wad)
+			{
+				data= (uint8 *)malloc(length+SIZEOF_encapsulated_wad_data);
+				if (data)
+				{
+					header.flags&= ~WADFILE_ENTRIES_ARE_COMPRESSED;
+
+					uint8 *S = data;
+					ValueToStream(S,uint32(CURRENT_FLAT_MAGIC_COOKIE));
+					ValueToStream(S,int32(length + SIZEOF_encapsulated_wad_data));
+					S = pack_wad_header(S,&header,1);
+					memcpy(S, raw_wad, length);
+				}
+				free(raw_wad);
+			}
+			if (!data)
+				set_game_error(systemError, memory_error());
+		}
+		else if (success)
 		{
 			int32 length;
 			int error = 0;
@@ -1161,6 +1408,44 @@ static bool read_indexed_wad_from_file_into_buffer(
 	return success;
 }
 
+/* Inflates the entry into a buffer padded as read_indexed_wad_from_file() pads one */
+static uint8 *read_compressed_indexed_wad(
+	OpenedFile& OFile,
+	struct wad_header *header,
+	short index,
+	int32 *length)
+{
+	struct directory_entry entry;
+	if (!read_indexed_directory_data(OFile, header, index, &entry) || entry.length <= 4)
+		return NULL;
+
+	std::vector<uint8> stored(entry.length);
+	if (!read_from_file(OFile, entry.offset_to_start, &stored[0], entry.length))
+		return NULL;
+
+	uint8 *S= &stored[0];
+	uint32 raw_length;
+	StreamToValue(S, raw_length);
+	if (raw_length == 0 || raw_length > 0x7fffffff - (SIZEOF_entry_header-SIZEOF_old_entry_header))
+		return NULL;
+
+	uint8 *raw_wad= (uint8 *) malloc(raw_length + (SIZEOF_entry_header-SIZEOF_old_entry_header));
+	if (!raw_wad)
+		return NULL;
+
+	uLongf inflated_length= raw_length;
+	if (uncompress(raw_wad, &inflated_length, S, entry.length - 4) != Z_OK ||
+		inflated_length != raw_length ||
+		calculate_raw_wad_length(header, raw_wad) != int32(raw_length))
+	{
+		free(raw_wad);
+		return NULL;
+	}
+
+	*length= int32(raw_length);
+	return raw_wad;
+}
+
 /* This *MUST* be a base wad.. */
 static struct wad_data *convert_wad_from_raw(
 	struct wad_header *header, 
@@ -1372,7 +1657,8 @@ static uint8 *unpack_wad_header(uint8 *Stream, wad_header *Objects, size_t Count
 		StreamToValue(S,ObjPtr->entry_header_size);
 		StreamToValue(S,ObjPtr->directory_entry_base_size);
 		StreamToValue(S,ObjPtr->parent_checksum);
-		S += 2*20;
+		StreamToValue(S,ObjPtr->flags);
+		S += 2*19;
 	}
 	
 	assert((S - Stream) == static_cast<ptrdiff_t>(Count*SIZEOF_wad_header));
@@ -1396,7 +1682,8 @@ static uint8 *pack_wad_header(uint8 *Stream, wad_header *Objects, size_t Count)
 		ValueToStream(S,ObjPtr->entry_header_size);
 		ValueToStream(S,ObjPtr->directory_entry_base_size);
 		ValueToStream(S,ObjPtr->parent_checksum);
-		S += 2*20;
+		ValueToStream(S,ObjPtr->flags);
+		S += 2*19;
 	}
 	
 	assert((S - Stream) == static_cast<ptrdiff_t>(Count*SIZEOF_wad_header));
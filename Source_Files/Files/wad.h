@@ -52,6 +52,9 @@ Aug 12, 2000 (Loren Petrich):
 #define MAXIMUM_UNION_WADFILES 16
 #define MAXIMUM_OPEN_WADFILES 3
 
+/* wad_header flags */
+#define WADFILE_ENTRIES_ARE_COMPRESSED 0x0001 /* Each entry is its raw length, then that deflated with zlib */
+
 class FileSpecifier;
 class OpenedFile;
 
@@ -70,7 +73,8 @@ struct wad_header { /* 128 bytes */
 	int16 entry_header_size;
 	int16 directory_entry_base_size;
 	uint32 parent_checksum;	/* If non-zero, this is the checksum of our parent, and we are simply modifications! */
-	int16 unused[20];
+	int16 flags;
+	int16 unused[19];
 };
 const int SIZEOF_wad_header = 128;	// don't trust sizeof()
 
@@ -124,6 +128,8 @@ struct wad_data {
 	short padding;
 	byte *read_only_data;		/* If this is non NULL, we are read only.... */
 	struct tag_data *tag_data;	/* Tag data array */
+	void *mapped_base;			/* If non NULL, read_only_data is in this file mapping */
+	size_t mapped_length;
 };
 
 /* ----- miscellaneous functions */
@@ -151,6 +157,14 @@ bool read_wad_header(OpenedFile& OFile, struct wad_header *header);
 struct wad_data *read_indexed_wad_from_file(OpenedFile& OFile, 
 	struct wad_header *header, short index, bool read_only);
 
+/* For reading ahead on another thread: reads the indexed wad into a
+	malloc()ed buffer without touching the game error, and turns that
+	into a read-only wad, which takes over the buffer */
+uint8 *read_raw_indexed_wad_from_file(OpenedFile& OFile, struct wad_header *header,
+	short index, int32 *length);
+struct wad_data *read_only_wad_from_raw(struct wad_header *header, uint8 *raw_wad,
+	int32 length);
+
 /* Properly deal with the memory.. */
 void free_wad(struct wad_data *wad);
 
@@ -204,6 +218,21 @@ void calculate_and_store_wadfile_checksum(OpenedFile& OFile);
 bool write_wad(OpenedFile& OFile, struct wad_header *file_header, 
 	struct wad_data *wad, int32 offset);
 
+/* For writing on another thread: a wad packed into a malloc()ed buffer as
+	write_wad() would write it, optionally compressed for a wadfile with
+	WADFILE_ENTRIES_ARE_COMPRESSED, and written out; none of these touch
+	the game error */
+uint8 *build_raw_wad(struct wad_header *file_header, struct wad_data *wad,
+	int32 *length);
+uint8 *compress_raw_wad(uint8 *raw_wad, int32 raw_length, int32 *length);
+bool write_raw_wad(OpenedFile& OFile, uint8 *raw_wad, int32 length, int32 offset);
+
+/* What calculate_and_store_wadfile_checksum() would find for a file of the
+	header, the raw wad at SIZEOF_wad_header, then the directory, without
+	reading it back */
+uint32 calculate_raw_wadfile_checksum(struct wad_header *header, uint8 *raw_wad,
+	int32 raw_length, void *entries);
+
 void set_indexed_directory_offset_and_length(struct wad_header *header, 
 	void *entries, short index, int32 offset, int32 length, short wad_index);
 
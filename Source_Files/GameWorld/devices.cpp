@@ -76,6 +76,8 @@ Feb 3, 2003 (Woody Zenfell):
 
 #include <string.h>
 #include <limits.h>
+#include <algorithm>
+#include <vector>
 
 /* ---------- constants */
 
@@ -440,6 +442,34 @@ bool untoggled_repair_switches_on_level(
 	return untoggled_switch;
 }
 
+// (permutation, side index) for every side, in order, built when first
+// needed after the sides change; whether a side is a control panel is
+// looked at when it's used, since that changes during the game
+static std::vector<std::pair<short, short> > side_permutation_index;
+static bool side_permutation_index_valid= false;
+static side_data *side_permutation_index_sides= NULL;
+static short side_permutation_index_count= 0;
+
+void side_permutations_changed(
+	void)
+{
+	side_permutation_index_valid= false;
+}
+
+static void build_side_permutation_index(
+	void)
+{
+	side_permutation_index.clear();
+	side_permutation_index.reserve(dynamic_world->side_count);
+	for (short side_index= 0; side_index<dynamic_world->side_count; ++side_index)
+		side_permutation_index.push_back(std::pair<short, short>(map_sides[side_index].control_panel_permutation, side_index));
+	std::sort(side_permutation_index.begin(), side_permutation_index.end());
+	
+	side_permutation_index_valid= true;
+	side_permutation_index_sides= map_sides;
+	side_permutation_index_count= dynamic_world->side_count;
+}
+
 void assume_correct_switch_position(
 	short switch_type, /* platform or light */
 	short permutation, /* platform or light index */ /* ghs: appears to be polygon, not platform */
@@ -448,8 +478,17 @@ void assume_correct_switch_position(
 	short side_index;
 	struct side_data *side;
 	
-	for (side_index= 0, side= map_sides; side_index<dynamic_world->side_count; ++side_index, ++side)
+	if (!side_permutation_index_valid || side_permutation_index_sides!=map_sides ||
+		side_permutation_index_count!=dynamic_world->side_count)
+	{
+		build_side_permutation_index();
+	}
+	
+	std::vector<std::pair<short, short> >::const_iterator match= std::lower_bound(side_permutation_index.begin(), side_permutation_index.end(), std::pair<short, short>(permutation, SHRT_MIN));
+	for (; match!=side_permutation_index.end() && match->first==permutation; ++match)
 	{
+		side_index= match->second;
+		side= map_sides+side_index;
 		if (SIDE_IS_CONTROL_PANEL(side) && side->control_panel_permutation==permutation)
 		{
 			struct control_panel_definition *definition= get_control_panel_definition(side->control_panel_type);
@@ -949,7 +988,7 @@ void parse_mml_control_panels(const InfoTree& root)
 	root.read_attr("triple_energy", control_panel_settings.TripleEnergy);
 	root.read_attr("triple_energy_rate", control_panel_settings.TripleEnergyRate);
 	
-	BOOST_FOREACH(InfoTree panel, root.children_named("panel"))
+	BOOST_FOREACH(const InfoTree &panel, root.children_named("panel"))
 	{
 		int16 index;
 		if (!panel.read_indexed("index", index, NUMBER_OF_CONTROL_PANEL_DEFINITIONS))
@@ -963,7 +1002,7 @@ void parse_mml_control_panels(const InfoTree& root)
 		panel.read_indexed("item", def.item, NUMBER_OF_DEFINED_ITEMS, true);
 		panel.read_fixed("pitch", def.sound_frequency, 0, SHRT_MAX+1);
 		
-		BOOST_FOREACH(InfoTree sound, panel.children_named("sound"))
+		BOOST_FOREACH(const InfoTree &sound, panel.children_named("sound"))
 		{
 			int16 type, which;
 			if (!sound.read_indexed("type", type, NUMBER_OF_CONTROL_PANEL_SOUNDS) ||
@@ -49,7 +49,8 @@ static uint16 m2_dynamic_limits[NUMBER_OF_DYNAMIC_LIMITS] =
 	1024,	// Number of objects to render (was really 72, but
 		// doesn't affect film playback)
 	16,	// Local collision buffer (target visibility, NPC-NPC collisions, etc.)
-	64	// Global collision buffer (projectiles with other objects)
+	64,	// Global collision buffer (projectiles with other objects)
+	16384	// Point-to-polygon lookup grid cells (doesn't affect film playback)
 };
 
 // expanded defaults up to 1.0
@@ -62,7 +63,8 @@ static uint16 a1_1_0_dynamic_limits[NUMBER_OF_DYNAMIC_LIMITS] =
 	128,	// Currently-active effects (blood splatters, explosions, etc.)
 	1024,	// Number of objects to render
 	64,	// Local collision buffer (target visibility, NPC-NPC collisions, etc.)
-	256	// Global collision buffer (projectiles with other objects)
+	256,	// Global collision buffer (projectiles with other objects)
+	16384	// Point-to-polygon lookup grid cells (doesn't affect film playback)
 };
 
 // 1.1 reverts paths for classic scenario compatibility
@@ -75,7 +77,8 @@ static uint16 a1_1_1_dynamic_limits[NUMBER_OF_DYNAMIC_LIMITS] =
 	128,	// Currently-active effects (blood splatters, explosions, etc.)
 	1024,	// Number of objects to render
 	64,	// Local collision buffer (target visibility, NPC-NPC collisions, etc.)
-	256	// Global collision buffer (projectiles with other objects)
+	256,	// Global collision buffer (projectiles with other objects)
+	16384	// Point-to-polygon lookup grid cells (doesn't affect film playback)
 };
 
 static std::vector<uint16> dynamic_limits(NUMBER_OF_DYNAMIC_LIMITS);
@@ -107,7 +110,7 @@ void reset_mml_dynamic_limits()
 
 void parse_limit_value(const InfoTree& root, std::string child, int type)
 {
-	BOOST_FOREACH(InfoTree limit, root.children_named(child))
+	BOOST_FOREACH(const InfoTree &limit, root.children_named(child))
 		limit.read_attr_bounded<uint16>("value", dynamic_limits[type], 0, 32767);
 }
 
@@ -121,6 +124,7 @@ void parse_mml_dynamic_limits(const InfoTree& root)
 	parse_limit_value(root, "rendered", _dynamic_limit_rendered);
 	parse_limit_value(root, "local_collision", _dynamic_limit_local_collision);
 	parse_limit_value(root, "global_collision", _dynamic_limit_global_collision);
+	parse_limit_value(root, "polygon_lookup_cells", _dynamic_limit_polygon_lookup_cells);
 
 	// Resize the arrays of objects, monsters, effects, and projectiles
 	EffectList.resize(MAXIMUM_EFFECTS_PER_MAP);
@@ -44,6 +44,7 @@ enum {
 	_dynamic_limit_rendered,			// Number of objects to render
 	_dynamic_limit_local_collision,		// [16] Local collision buffer (target visibility, NPC-NPC collisions, etc.)
 	_dynamic_limit_global_collision,	// [64] Global collision buffer (projectiles with other objects) 
+	_dynamic_limit_polygon_lookup_cells,	// Most cells in the point-to-polygon lookup grid (0 disables it)
 	NUMBER_OF_DYNAMIC_LIMITS
 };
 
@@ -33,6 +33,10 @@ Feb 6, 2000 (Loren Petrich):
 
 Aug 30, 2000 (Loren Petrich):
 	Added stuff for unpacking and packing
+
+Oct 14, 2026:
+	update_effects() skips free slots with a used slot index (used_slot_index.h), and
+	new_effect() finds the first free slot with a free slot index
 */
 
 #include "cseries.h"
@@ -43,6 +47,7 @@ Aug 30, 2000 (Loren Petrich):
 #include "lua_script.h"
 
 #include "Packing.h"
+#include "used_slot_index.h"
 
 /*
 ryan reports get_object_data() failing on effect->data after a teleport effect terminates
@@ -59,6 +64,9 @@ ryan reports get_object_data() failing on effect->data after a teleport effect t
 /* import effect definition constants, structures and globals */
 #include "effect_definitions.h"
 
+static UsedSlotIndex EffectSlots;
+static FreeSlotIndex FreeEffectSlots;
+
 // Moved the definition over to map.cpp
 
 // struct effect_data *effects = NULL;
@@ -111,7 +119,7 @@ short new_effect(
 		}
 		else
 		{
-			for (effect_index= 0,effect= effects; effect_index<MAXIMUM_EFFECTS_PER_MAP; ++effect_index, ++effect)
+			for (effect_index= FreeEffectSlots.first_free(EffectList),effect= effects+effect_index; effect_index<MAXIMUM_EFFECTS_PER_MAP; ++effect_index, ++effect)
 			{
 				if (SLOT_IS_FREE(effect))
 				{
@@ -127,6 +135,7 @@ short new_effect(
 						effect->data= 0;
 						effect->delay= definition->delay ? global_random()%definition->delay : 0;
 						MARK_SLOT_AS_USED(effect);
+						EffectSlots.mark_used(effect_index);
 						
 						SET_OBJECT_OWNER(object, _object_is_effect);
 						object->sound_pitch= definition->sound_pitch;
@@ -155,8 +164,10 @@ void update_effects(
 	struct effect_data *effect;
 	short effect_index;
 	
-	for (effect_index= 0, effect= effects; effect_index<MAXIMUM_EFFECTS_PER_MAP; ++effect_index, ++effect)
+	for (effect_index= EffectSlots.next_used(EffectList, 0); effect_index<MAXIMUM_EFFECTS_PER_MAP;
+		effect_index= EffectSlots.next_used(EffectList, effect_index+1))
 	{
+		effect= effects+effect_index;
 		if (SLOT_IS_USED(effect))
 		{
 			struct object_data *object= get_object_data(effect->object_index);
@@ -206,6 +217,14 @@ void remove_effect(
 	remove_map_object(effect->object_index);
 	L_Invalidate_Effect(effect_index);
 	MARK_SLOT_AS_FREE(effect);
+	FreeEffectSlots.mark_free(effect_index);
+}
+
+void rebuild_effect_slot_index(
+	void)
+{
+	EffectSlots.rebuild(EffectList);
+	FreeEffectSlots.rebuild(EffectList);
 }
 
 void remove_all_nonpersistent_effects(
@@ -163,6 +163,7 @@ short new_effect(world_point3d *origin, short polygon_index, short type, angle f
 void update_effects(void); /* assumes t==1 tick */
 
 void remove_all_nonpersistent_effects(void);
+void rebuild_effect_slot_index(void); /* when EffectList is cleared or filled wholesale */
 void remove_effect(short effect_index);
 
 void mark_effect_collections(short type, bool loading);
@@ -32,6 +32,11 @@ Jan 30, 2000 (Loren Petrich):
 
 Feb. 4, 2000 (Loren Petrich):
 	Changed halt() to assert(false) for better debugging
+
+Oct 14, 2026:
+	_best_first now keeps its unexpanded nodes in a binary heap instead of scanning the
+	whole node list on every expansion; ties are broken by node index so the order in
+	which nodes are expanded is identical to the old linear scan.
 */
 
 /*
@@ -77,10 +82,23 @@ static short node_count= 0, last_node_index_expanded= NONE;
 static struct node_data *nodes = NULL;
 static short *visited_polygons = NULL;
 
+/* open set for _best_first: a binary min-heap of unexpanded node indexes, ordered by
+	(cost, node index); heap_positions maps a node index back to its slot (or NONE) */
+static bool heap_in_use= false;
+static short heap_count= 0;
+static short *node_heap = NULL;
+static short *heap_positions = NULL;
+
 /* ---------- private prototypes */
 
 static void add_node(short parent_node_index, short polygon_index, short depth, int32 cost, int32 user_flags);
 
+static inline bool heap_node_precedes(short a, short b);
+static void heap_sift_up(short position);
+static void heap_sift_down(short position);
+static void heap_insert_or_decrease(short node_index);
+static short heap_pop(void);
+
 /* ---------- code */
 
 void allocate_flood_map_memory(
@@ -91,7 +109,13 @@ void allocate_flood_map_memory(
 	nodes= new node_data[MAXIMUM_FLOOD_NODES];
 	if (visited_polygons) delete []visited_polygons;
 	visited_polygons= new short[MAXIMUM_POLYGONS_PER_MAP];
-	assert(nodes&&visited_polygons);
+	objlist_set(visited_polygons, NONE, MAXIMUM_POLYGONS_PER_MAP);
+	node_count= 0;
+	if (node_heap) delete []node_heap;
+	node_heap= new short[MAXIMUM_FLOOD_NODES];
+	if (heap_positions) delete []heap_positions;
+	heap_positions= new short[MAXIMUM_FLOOD_NODES];
+	assert(nodes&&visited_polygons&&node_heap&&heap_positions);
 }
 
 /* returns next polygon index or NONE if there are no more polygons left cheaper than maximum_cost */
@@ -110,26 +134,29 @@ short flood_map(
 	/* initialize ourselves if first_polygon_index!=NONE */
 	if (first_polygon_index!=NONE)
 	{
-		/* clear the visited polygon array */
-		objlist_set(visited_polygons, NONE, MAXIMUM_POLYGONS_PER_MAP);
+		/* clear the visited polygon array; only the last flood's nodes' polygons are
+			marked, so there's no need to go through every polygon of a large map */
+		for (node_index= 0; node_index<node_count; ++node_index)
+			visited_polygons[nodes[node_index].polygon_index]= UNVISITED;
 		
 		node_count= 0;
 		last_node_index_expanded= NONE;
+		heap_in_use= (flood_mode==_best_first);
+		heap_count= 0;
 		add_node(NONE, first_polygon_index, 0, 0, (flood_mode==_flagged_breadth_first) ? *((int32*)caller_data) : 0);
 	}
 	
 	switch (flood_mode)
 	{
 		case _best_first:
-			/* find the unexpanded node with the lowest cost */
+			/* the unexpanded node with the lowest cost is at the top of the heap; because
+				ties are broken by node index this is the same node a linear scan would find */
+			assert(heap_in_use);
 			lowest_cost= maximum_cost, lowest_cost_node_index= NONE;
-			for (node= nodes, node_index= 0; node_index<node_count; ++node_index, ++node)
+			if (heap_count>0 && nodes[node_heap[0]].cost<maximum_cost)
 			{
-				if (NODE_IS_UNEXPANDED(node)&&node->cost<lowest_cost)
-				{
-					lowest_cost_node_index= node_index;
-					lowest_cost= node->cost;
-				}
+				lowest_cost_node_index= heap_pop();
+				lowest_cost= nodes[lowest_cost_node_index].cost;
 			}
 			break;
 		
@@ -320,6 +347,7 @@ static void add_node(
 		{
 			if (node_index==node_count)
 			{
+				heap_positions[node_index]= NONE;
 				node_count+= 1;
 			}
 			
@@ -333,7 +361,94 @@ static void add_node(
 			assert(polygon_index>=0&&polygon_index<dynamic_world->polygon_count);
 			visited_polygons[polygon_index]= node_index;
 			
+			if (heap_in_use) heap_insert_or_decrease(node_index);
+			
 //			dprintf("added polygon #%d to node #%d (nodes=%p,visited=%p)", polygon_index, node_index, nodes, visited_polygons);
 		}
 	}
 }
+
+/* strict total order on unexpanded nodes: lower cost first, then lower node index */
+static inline bool heap_node_precedes(
+	short a,
+	short b)
+{
+	int32 cost_a= nodes[a].cost, cost_b= nodes[b].cost;
+	
+	return cost_a<cost_b || (cost_a==cost_b && a<b);
+}
+
+static void heap_sift_up(
+	short position)
+{
+	short node_index= node_heap[position];
+	
+	while (position>0)
+	{
+		short parent= (position-1)>>1;
+		
+		if (!heap_node_precedes(node_index, node_heap[parent])) break;
+		node_heap[position]= node_heap[parent];
+		heap_positions[node_heap[position]]= position;
+		position= parent;
+	}
+	
+	node_heap[position]= node_index;
+	heap_positions[node_index]= position;
+}
+
+static void heap_sift_down(
+	short position)
+{
+	short node_index= node_heap[position];
+	
+	for (;;)
+	{
+		short child= 2*position+1;
+		
+		if (child>=heap_count) break;
+		if (child+1<heap_count && heap_node_precedes(node_heap[child+1], node_heap[child])) child+= 1;
+		if (!heap_node_precedes(node_heap[child], node_index)) break;
+		node_heap[position]= node_heap[child];
+		heap_positions[node_heap[position]]= position;
+		position= child;
+	}
+	
+	node_heap[position]= node_index;
+	heap_positions[node_index]= position;
+}
+
+/* add_node() only ever lowers the cost of a node already in the heap, so a decrease-key
+	is a sift up from wherever the node currently sits */
+static void heap_insert_or_decrease(
+	short node_index)
+{
+	short position= heap_positions[node_index];
+	
+	if (position==NONE)
+	{
+		assert(heap_count<MAXIMUM_FLOOD_NODES);
+		position= heap_count++;
+		node_heap[position]= node_index;
+	}
+	
+	heap_sift_up(position);
+}
+
+static short heap_pop(
+	void)
+{
+	short node_index;
+	
+	assert(heap_count>0);
+	node_index= node_heap[0];
+	heap_positions[node_index]= NONE;
+	
+	if (--heap_count>0)
+	{
+		node_heap[0]= node_heap[heap_count];
+		heap_sift_down(0);
+	}
+	
+	return node_index;
+}
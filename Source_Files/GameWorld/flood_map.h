@@ -45,11 +45,17 @@ typedef int32 (*cost_proc_ptr)(short source_polygon_index, short line_index, sho
 void allocate_pathfinding_memory(void);
 void reset_paths(void);
 
+/* if cache_key is not NONE, non-random paths may be built from an earlier flood between the same
+	polygons with the same cost and cache_key; callers must give different keys to any two
+	caller_data which could make cost return different values */
 short new_path(world_point2d *source_point, short source_polygon_index,
 	world_point2d *destination_point, short destination_polygon_index,
-	world_distance minimum_separation, cost_proc_ptr cost, void *data);
+	world_distance minimum_separation, cost_proc_ptr cost, void *data, int32 cache_key = NONE);
 bool move_along_path(short path_index, world_point2d *p);
 void delete_path(short path_index);
+void invalidate_path_cache(bool only_monsters_moved= false);
+/* changes whenever invalidate_path_cache() is called for anything but monsters moving */
+uint32 get_map_cache_epoch(void);
 
 /* ---------- prototypes/FLOOD_MAP.C */
 
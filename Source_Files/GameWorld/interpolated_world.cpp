@@ -0,0 +1,292 @@
+/*
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	Interpolated world (see interpolated_world.h)
+
+*/
+
+#include "cseries.h"
+#include "interpolated_world.h"
+
+#include "map.h"
+#include "player.h"
+#include "platforms.h"
+#include "media.h"
+#include "mouse.h"
+
+#include <vector>
+#include <algorithm>
+
+enum {
+	// Anything that moved further than this in a tick teleported; it isn't interpolated
+	kMaximumInterpolatedDistance = 2 * WORLD_ONE
+};
+
+struct object_record
+{
+	bool used;
+	int16 polygon_index;
+	world_point3d location;
+	angle facing;
+};
+
+struct camera_record
+{
+	int16 polygon_index;
+	world_point3d location;
+	angle facing, elevation;
+};
+
+struct height_record
+{
+	world_distance floor, ceiling;
+};
+
+struct world_record
+{
+	int16 level_number;
+	int32 tick_count;
+	uint32 time;
+
+	std::vector<object_record> object_positions;
+	std::vector<camera_record> cameras;
+	// each platform's polygon, and then the lines around it
+	std::vector<height_record> platform_polygons;
+	std::vector<height_record> platform_lines;
+	std::vector<world_distance> media_heights;
+};
+
+static world_record previous_record, current_record, saved_record;
+static bool world_is_interpolated = false;
+
+static void capture_world(world_record& record)
+{
+	record.level_number = dynamic_world->current_level_number;
+	record.tick_count = dynamic_world->tick_count;
+	record.time = machine_tick_count();
+
+	record.object_positions.resize(ObjectList.size());
+	for (size_t i = 0; i < ObjectList.size(); i++)
+	{
+		const object_data& object = ObjectList[i];
+		object_record& r = record.object_positions[i];
+		r.used = SLOT_IS_USED(&object);
+		r.polygon_index = object.polygon;
+		r.location = object.location;
+		r.facing = object.facing;
+	}
+
+	record.cameras.resize(dynamic_world->player_count);
+	for (int i = 0; i < dynamic_world->player_count; i++)
+	{
+		const player_data *player = get_player_data(i);
+		camera_record& r = record.cameras[i];
+		r.polygon_index = player->camera_polygon_index;
+		r.location = player->camera_location;
+		r.facing = player->facing;
+		r.elevation = player->elevation;
+	}
+
+	record.platform_polygons.clear();
+	record.platform_lines.clear();
+	for (size_t i = 0; i < PlatformList.size(); i++)
+	{
+		const polygon_data *polygon = get_polygon_data(PlatformList[i].polygon_index);
+		height_record r = { polygon->floor_height, polygon->ceiling_height };
+		record.platform_polygons.push_back(r);
+		for (int j = 0; j < polygon->vertex_count; j++)
+		{
+			const line_data *line = get_line_data(polygon->line_indexes[j]);
+			height_record l = { line->highest_adjacent_floor, line->lowest_adjacent_ceiling };
+			record.platform_lines.push_back(l);
+		}
+	}
+
+	record.media_heights.resize(MediaList.size());
+	for (size_t i = 0; i < MediaList.size(); i++)
+		record.media_heights[i] = MediaList[i].height;
+}
+
+// Writes a record back; only what capture_world() took
+static void restore_world(const world_record& record)
+{
+	for (size_t i = 0; i < record.object_positions.size(); i++)
+	{
+		object_data& object = ObjectList[i];
+		object.location = record.object_positions[i].location;
+		object.facing = record.object_positions[i].facing;
+	}
+
+	for (size_t i = 0; i < record.cameras.size(); i++)
+	{
+		player_data *player = get_player_data(i);
+		player->camera_polygon_index = record.cameras[i].polygon_index;
+		player->camera_location = record.cameras[i].location;
+		player->facing = record.cameras[i].facing;
+		player->elevation = record.cameras[i].elevation;
+	}
+
+	size_t line = 0;
+	for (size_t i = 0; i < record.platform_polygons.size(); i++)
+	{
+		polygon_data *polygon = get_polygon_data(PlatformList[i].polygon_index);
+		polygon->floor_height = record.platform_polygons[i].floor;
+		polygon->ceiling_height = record.platform_polygons[i].ceiling;
+		for (int j = 0; j < polygon->vertex_count; j++, line++)
+		{
+			line_data *l = get_line_data(polygon->line_indexes[j]);
+			l->highest_adjacent_floor = record.platform_lines[line].floor;
+			l->lowest_adjacent_ceiling = record.platform_lines[line].ceiling;
+		}
+	}
+
+	for (size_t i = 0; i < record.media_heights.size(); i++)
+		MediaList[i].height = record.media_heights[i];
+}
+
+static inline int32 interpolate(int32 from, int32 to, float fraction)
+{
+	return from + static_cast<int32>((to - from) * fraction);
+}
+
+static inline angle interpolate_angle(angle from, angle to, float fraction)
+{
+	int32 delta = NORMALIZE_ANGLE(to - from + HALF_CIRCLE) - HALF_CIRCLE;
+	return NORMALIZE_ANGLE(from + static_cast<int32>(delta * fraction));
+}
+
+static bool interpolate_point(world_point3d& point, const world_point3d& from, const world_point3d& to, float fraction)
+{
+	if (guess_distance2d((world_point2d *) &from, (world_point2d *) &to) > kMaximumInterpolatedDistance)
+		return false;
+
+	point.x = interpolate(from.x, to.x, fraction);
+	point.y = interpolate(from.y, to.y, fraction);
+	point.z = interpolate(from.z, to.z, fraction);
+	return true;
+}
+
+void record_interpolated_world()
+{
+	assert(!world_is_interpolated);
+
+	std::swap(previous_record, current_record);
+	capture_world(current_record);
+
+	// a new level (or a film going back to the start) has nothing to come from
+	if (previous_record.level_number != current_record.level_number ||
+		previous_record.tick_count > current_record.tick_count ||
+		previous_record.object_positions.size() != current_record.object_positions.size() ||
+		previous_record.cameras.size() != current_record.cameras.size() ||
+		previous_record.platform_lines.size() != current_record.platform_lines.size() ||
+		previous_record.media_heights.size() != current_record.media_heights.size())
+	{
+		previous_record = current_record;
+	}
+}
+
+void enter_interpolated_world()
+{
+	assert(!world_is_interpolated);
+	if (current_record.object_positions.size() != ObjectList.size() || current_record.cameras.size() != size_t(dynamic_world->player_count))
+		return;
+
+	float fraction = (machine_tick_count() - current_record.time) * float(TICKS_PER_SECOND) / MACHINE_TICKS_PER_SECOND;
+	if (fraction >= 1)
+		return;
+
+	capture_world(saved_record);
+	world_is_interpolated = true;
+
+	for (size_t i = 0; i < current_record.object_positions.size(); i++)
+	{
+		const object_record& from = previous_record.object_positions[i];
+		const object_record& to = current_record.object_positions[i];
+		if (!from.used || !to.used)
+			continue;
+
+		// an object drawn from its polygon's list has to stay inside that polygon
+		object_data& object = ObjectList[i];
+		world_point3d location;
+		if (!interpolate_point(location, from.location, to.location, fraction))
+			continue;
+		if (from.polygon_index != to.polygon_index && !point_in_polygon(to.polygon_index, (world_point2d *) &location))
+			continue;
+
+		object.location = location;
+		object.facing = interpolate_angle(from.facing, to.facing, fraction);
+	}
+
+	// a view the mouse turns ahead of the ticks (see render_screen()) turns from the latest
+	short delta_yaw, delta_pitch;
+	bool mouse_turns_view = mouse_view_delta(&delta_yaw, &delta_pitch);
+
+	for (size_t i = 0; i < current_record.cameras.size(); i++)
+	{
+		const camera_record& from = previous_record.cameras[i];
+		const camera_record& to = current_record.cameras[i];
+		player_data *player = get_player_data(i);
+
+		// the camera can cross into another polygon, as long as we can tell which
+		world_point3d location;
+		if (!interpolate_point(location, from.location, to.location, fraction))
+			continue;
+		short polygon_index = to.polygon_index;
+		if (from.polygon_index != to.polygon_index)
+			polygon_index = find_new_object_polygon((world_point2d *) &to.location, (world_point2d *) &location, to.polygon_index);
+		if (polygon_index == NONE)
+			continue;
+
+		player->camera_location = location;
+		player->camera_polygon_index = polygon_index;
+		if (mouse_turns_view && player == current_player)
+			continue;
+		player->facing = interpolate_angle(from.facing, to.facing, fraction);
+		player->elevation = interpolate(from.elevation, to.elevation, fraction);
+	}
+
+	size_t line = 0;
+	for (size_t i = 0; i < current_record.platform_polygons.size(); i++)
+	{
+		polygon_data *polygon = get_polygon_data(PlatformList[i].polygon_index);
+		const height_record& from = previous_record.platform_polygons[i];
+		const height_record& to = current_record.platform_polygons[i];
+		polygon->floor_height = interpolate(from.floor, to.floor, fraction);
+		polygon->ceiling_height = interpolate(from.ceiling, to.ceiling, fraction);
+		for (int j = 0; j < polygon->vertex_count; j++, line++)
+		{
+			line_data *l = get_line_data(polygon->line_indexes[j]);
+			const height_record& line_from = previous_record.platform_lines[line];
+			const height_record& line_to = current_record.platform_lines[line];
+			l->highest_adjacent_floor = interpolate(line_from.floor, line_to.floor, fraction);
+			l->lowest_adjacent_ceiling = interpolate(line_from.ceiling, line_to.ceiling, fraction);
+		}
+	}
+
+	for (size_t i = 0; i < current_record.media_heights.size(); i++)
+		MediaList[i].height = interpolate(previous_record.media_heights[i], current_record.media_heights[i], fraction);
+}
+
+void exit_interpolated_world()
+{
+	if (!world_is_interpolated)
+		return;
+
+	restore_world(saved_record);
+	world_is_interpolated = false;
+}
@@ -0,0 +1,42 @@
+#ifndef __INTERPOLATED_WORLD_H
+#define __INTERPOLATED_WORLD_H
+
+/*
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	Interpolated world: lets frames be drawn between ticks.  The positions of
+	objects and cameras, and the heights of platforms and media, are recorded
+	after each update; a frame drawn later moves them part of the way from the
+	previous record to the latest, by how far into the next tick we are.  So
+	what is shown runs up to a tick behind, but moves smoothly.
+
+	Everything is put back before the frame returns, so the simulation only
+	ever sees its own values.
+
+*/
+
+// Call after update_world() whenever it changed the world
+void record_interpolated_world();
+
+// Move the world part of the way from the previous record to the latest
+void enter_interpolated_world();
+
+// Put back everything enter_interpolated_world() moved
+void exit_interpolated_world();
+
+#endif
@@ -201,7 +201,8 @@ void trigger_nearby_items(
 		struct object_data *object;
 		short object_index;
 
-		for (object_index= get_polygon_data(polygon_index)->first_object; object_index!=NONE; object_index= object->next_object)
+		object_index= polygon_may_contain_items(polygon_index) ? get_polygon_data(polygon_index)->first_object : NONE;
+		for (; object_index!=NONE; object_index= object->next_object)
 		{
 			object= get_object_data(object_index);
 			switch (GET_OBJECT_OWNER(object))
@@ -349,7 +350,8 @@ static void a1_swipe_nearby_items(
 	for (i=0;i<polygon->neighbor_count;++i)
 	{	
 		
-		struct polygon_data *neighboring_polygon= get_polygon_data(*neighbor_indexes++);
+		short source_index= *neighbor_indexes++;
+		struct polygon_data *neighboring_polygon= get_polygon_data(source_index);
 		
 		/*
 			LP change: since precalculate_map_indexes() and its associated routine
@@ -362,17 +364,22 @@ static void a1_swipe_nearby_items(
 		struct polygon_data *source_polygon = neighboring_polygon;
 		for (int ngbr_indx = -1; ngbr_indx<source_polygon->vertex_count; ngbr_indx++)
 		{
+		short neighboring_index;
 		if (ngbr_indx >= 0)
 		{
 			// Be sure to check on whether there is a valid polygon on the other side
 			short adjacent_index = source_polygon->adjacent_polygon_indexes[ngbr_indx];
 			if (adjacent_index == NONE) continue;
 			neighboring_polygon = get_polygon_data(adjacent_index);
+			neighboring_index = adjacent_index;
 		}
 		else
+		{
 			neighboring_polygon = source_polygon;
+			neighboring_index = source_index;
+		}
 		
-		if (!POLYGON_IS_DETACHED(neighboring_polygon))
+		if (!POLYGON_IS_DETACHED(neighboring_polygon) && polygon_may_contain_items(neighboring_index))
 		{
 			next_object= neighboring_polygon->first_object;
 
@@ -430,9 +437,10 @@ static void m2_swipe_nearby_items(
 	for (i=0;i<polygon->neighbor_count;++i)
 	{	
 		
-		struct polygon_data *neighboring_polygon= get_polygon_data(*neighbor_indexes++);
+		short neighboring_index= *neighbor_indexes++;
+		struct polygon_data *neighboring_polygon= get_polygon_data(neighboring_index);
 	
-		if (!POLYGON_IS_DETACHED(neighboring_polygon))
+		if (!POLYGON_IS_DETACHED(neighboring_polygon) && polygon_may_contain_items(neighboring_index))
 		{
 			next_object= neighboring_polygon->first_object;
 
@@ -839,7 +847,7 @@ void parse_mml_items(const InfoTree& root)
 			original_item_definitions[i] = item_definitions[i];
 	}
 	
-	BOOST_FOREACH(InfoTree itree, root.children_named("item"))
+	BOOST_FOREACH(const InfoTree &itree, root.children_named("item"))
 	{
 		int16 index;
 		if (!itree.read_indexed("index", index, NUMBER_OF_DEFINED_ITEMS))
@@ -852,7 +860,7 @@ void parse_mml_items(const InfoTree& root)
 		itree.read_attr("invalid", def.invalid_environments);
 		itree.read_indexed("type", def.item_kind, NUMBER_OF_ITEM_TYPES);
 		
-		BOOST_FOREACH(InfoTree shape, itree.children_named("shape"))
+		BOOST_FOREACH(const InfoTree &shape, itree.children_named("shape"))
 			shape.read_shape(def.base_shape);
 	}
 }
@@ -41,6 +41,11 @@ Aug 29, 2000 (Loren Petrich):
 
 Jul 3, 2002 (Loren Petrich):
 	Added support for Pfhortran Procedure: light_activated
+
+Oct 14, 2026:
+	update_lights() only rephases a light at the end of its period, and sets a light in a constant
+	state to its final intensity without going through the lighting functions
+	Linear and smooth intensities are worked out when read (get_light_intensity()), not every tick
 */
 
 #include "cseries.h"
@@ -52,6 +57,25 @@ Jul 3, 2002 (Loren Petrich):
 //MH: Lua scripting
 #include "lua_script.h"
 
+#include <algorithm>
+#include <limits.h>
+#include <vector>
+
+using std::pair;
+using std::vector;
+
+/* ---------- constants */
+
+enum /* light flags */
+{
+	/* linear and smooth intensities depend on nothing but the light's own phase, period, and
+		initial and final intensities, so update_lights() only notes which one applies and the
+		intensity is worked out when it's read (before any of those change) */
+	_light_intensity_is_linear= 0x0001,
+	_light_intensity_is_smooth= 0x0002,
+	_light_intensity_is_pending= _light_intensity_is_linear|_light_intensity_is_smooth
+};
+
 /* ---------- globals */
 
 // Turned the list of lights into a variable array;
@@ -64,6 +88,8 @@ vector<light_data> LightList;
 /* ---------- private prototypes */
 
 static void rephase_light(short light_index);
+static _fixed current_light_intensity(const struct light_data *light);
+static void resolve_light_intensity(struct light_data *light);
 
 // LP: "static" removed
 static struct lighting_function_specification *get_lighting_function_specification(
@@ -162,6 +188,38 @@ light_definition *get_light_definition(
 	return GetMemberWithBounds(light_definitions,type,NUMBER_OF_LIGHT_TYPES);
 }
 
+/* ---------- the lights with each tag */
+
+// (tag, light index) for every used light with a tag, in order, built when
+// first needed after a light's tag may have changed
+static vector<pair<short, short> > light_tag_index;
+static bool light_tag_index_valid= false;
+static light_data *light_tag_index_lights= NULL;
+static uint32 light_tag_generation= 0;
+
+void light_tags_changed(
+	void)
+{
+	light_tag_index_valid= false;
+	++light_tag_generation;
+}
+
+static void build_light_tag_index(
+	void)
+{
+	light_tag_index.clear();
+	for (short light_index= 0; light_index<short(MAXIMUM_LIGHTS_PER_MAP); ++light_index)
+	{
+		struct light_data *light= lights+light_index;
+		if (SLOT_IS_USED(light) && light->static_data.tag)
+			light_tag_index.push_back(pair<short, short>(light->static_data.tag, light_index));
+	}
+	std::sort(light_tag_index.begin(), light_tag_index.end());
+	
+	light_tag_index_valid= true;
+	light_tag_index_lights= lights;
+}
+
 short new_light(
 	struct static_light_data *data)
 {
@@ -176,8 +234,10 @@ short new_light(
 		if (SLOT_IS_FREE(light))
 		{
 			light->static_data= *data;
+			light_tags_changed();
 //			light->flags= 0;
 			MARK_SLOT_AS_USED(light);
+			light->flags&= ~_light_intensity_is_pending;
 			
 			light->intensity= 0;
 			change_light_state(light_index, LIGHT_IS_INITIALLY_ACTIVE(data) ? _light_secondary_active : _light_secondary_inactive);
@@ -217,13 +277,34 @@ void update_lights(
 	{
 		if (SLOT_IS_USED(light))
 		{
-			/* update light phase; if weve overflowed our period change to the next state */
+			struct lighting_function_specification *function;
+			
+			/* update light phase; if weve overflowed our period change to the next state (which
+				starts from the intensity we have now) */
+			if (light->phase+1>=light->period) resolve_light_intensity(light);
 			light->phase+= 1;
-			rephase_light(light_index);
+			if (light->phase>=light->period) rephase_light(light_index);
 			
-			/* calculate and remember intensity for this ii, fi, phase, period */
-			light->intensity= lighting_function_dispatch(get_lighting_function_specification(&light->static_data, light->state)->function,
-				light->initial_intensity, light->final_intensity, light->phase, light->period);
+			/* calculate and remember intensity for this ii, fi, phase, period; most lights spend
+				most of their time in a constant state, which needs no lighting function */
+			function= get_lighting_function_specification(&light->static_data, light->state);
+			light->flags&= ~_light_intensity_is_pending;
+			switch (function->function)
+			{
+				case _constant_lighting_function:
+					light->intensity= light->final_intensity;
+					break;
+				case _linear_lighting_function:
+					light->flags|= _light_intensity_is_linear;
+					break;
+				case _smooth_lighting_function:
+					light->flags|= _light_intensity_is_smooth;
+					break;
+				default:
+					light->intensity= lighting_function_dispatch(function->function,
+						light->initial_intensity, light->final_intensity, light->phase, light->period);
+					break;
+			}
 		}
 	}
 }
@@ -297,9 +378,20 @@ bool set_tagged_light_statuses(
 		int light_index;
 		struct light_data *light;
 		
-		for (light_index= 0, light= lights; light_index<short(MAXIMUM_LIGHTS_PER_MAP); ++light_index, ++light)
+		if (!light_tag_index_valid || light_tag_index_lights!=lights) build_light_tag_index();
+		
+		// copied, since a script run by a light changing may change tags
+		vector<short> tagged_lights;
+		vector<pair<short, short> >::const_iterator match= std::lower_bound(light_tag_index.begin(), light_tag_index.end(), pair<short, short>(tag, SHRT_MIN));
+		for (; match!=light_tag_index.end() && match->first==tag; ++match)
+			tagged_lights.push_back(match->second);
+		
+		uint32 generation= light_tag_generation;
+		short last_light_index= NONE;
+		for (size_t i= 0; i<tagged_lights.size() && generation==light_tag_generation; ++i)
 		{
-			if (light->static_data.tag==tag)
+			last_light_index= light_index= tagged_lights[i];
+			if (lights[light_index].static_data.tag==tag)
 			{
 				if (set_light_status(light_index, new_status))
 				{
@@ -307,6 +399,21 @@ bool set_tagged_light_statuses(
 				}
 			}
 		}
+		
+		// if one did, look at the rest of the lights as they are now
+		if (generation!=light_tag_generation)
+		{
+			for (light_index= last_light_index+1, light= lights+light_index; light_index<short(MAXIMUM_LIGHTS_PER_MAP); ++light_index, ++light)
+			{
+				if (light->static_data.tag==tag)
+				{
+					if (set_light_status(light_index, new_status))
+					{
+						changed= true;
+					}
+				}
+			}
+		}
 	}
 	
 	return changed;
@@ -319,7 +426,7 @@ _fixed get_light_intensity(
 	light_data *light = get_light_data(light_index);
 	if (!light) return 0;	// Blackness
 	
-	return light->intensity;
+	return current_light_intensity(light);
 }
 
 /* ---------- private code */
@@ -334,6 +441,7 @@ void change_light_state(
 	if (!light) return;
 	struct lighting_function_specification *function= get_lighting_function_specification(&light->static_data, new_state);
 	
+	resolve_light_intensity(light);
 	light->phase= 0;
 	light->period= function->period + global_random()%(function->delta_period+1);
 	
@@ -392,6 +500,28 @@ static void rephase_light(
 	}
 	light->phase= phase;
 }
+
+static _fixed current_light_intensity(
+	const struct light_data *light)
+{
+	if (light->flags&_light_intensity_is_linear)
+	{
+		return lighting_function_dispatch(_linear_lighting_function, light->initial_intensity, light->final_intensity, light->phase, light->period);
+	}
+	if (light->flags&_light_intensity_is_smooth)
+	{
+		return lighting_function_dispatch(_smooth_lighting_function, light->initial_intensity, light->final_intensity, light->phase, light->period);
+	}
+	
+	return light->intensity;
+}
+
+static void resolve_light_intensity(
+	struct light_data *light)
+{
+	light->intensity= current_light_intensity(light);
+	light->flags&= ~_light_intensity_is_pending;
+}
 				
 /* ---------- lighting functions */
 
@@ -627,6 +757,8 @@ uint8 *pack_static_light_data(uint8 *Stream, static_light_data* Objects, size_t
 
 uint8 *unpack_light_data(uint8 *Stream, light_data* Objects, size_t Count)
 {
+	light_tags_changed();
+
 	uint8* S = Stream;
 	light_data* ObjPtr = Objects;
 	
@@ -658,10 +790,11 @@ uint8 *pack_light_data(uint8 *Stream, light_data* Objects, size_t Count)
 	
 	for (size_t k = 0; k < Count; k++, ObjPtr++)
 	{
-		ValueToStream(S,ObjPtr->flags);
+		// saved as if every intensity had been worked out
+		ValueToStream(S,uint16(ObjPtr->flags&~_light_intensity_is_pending));
 		ValueToStream(S,ObjPtr->state);
 		
-		ValueToStream(S,ObjPtr->intensity);
+		ValueToStream(S,current_light_intensity(ObjPtr));
 		
 		ValueToStream(S,ObjPtr->phase);
 		ValueToStream(S,ObjPtr->period);
@@ -187,6 +187,8 @@ void update_lights(void);
 bool get_light_status(size_t light_index);
 bool set_light_status(size_t light_index, bool active);
 bool set_tagged_light_statuses(short tag, bool new_status);
+// call after changing a light's tag other than through new_light()
+void light_tags_changed(void);
 
 _fixed get_light_intensity(size_t light_index);
 
@@ -114,14 +114,17 @@ find_line_crossed leaving polygon could be sped up considerable by reversing the
 #include "lua_script.h"
 #include "media.h"
 #include "scenery.h"
+#include "flood_map.h"
 #include "SoundManager.h"
 #include "Console.h"
 #include "InfoTree.h"
+#include "used_slot_index.h"
 
 #include <string.h>
 #include <stdlib.h>
 #include <limits.h>
 
+#include <algorithm>
 #include <list>
 
 /* ---------- structures */
@@ -178,6 +181,7 @@ static struct environment_definition environment_definitions[]=
 
 struct static_data *static_world = NULL;
 struct dynamic_data *dynamic_world = NULL;
+uint32 map_load_count = 0;
 
 // These are allocated here because the numbers of these objects vary as a game progresses.
 vector<effect_data> EffectList(MAXIMUM_EFFECTS_PER_MAP);
@@ -232,6 +236,62 @@ struct map_memory_data {
 
 // LP addition: growable list of intersected objects
 static vector<short> IntersectedObjects;
+// and where they are, and how far, for the batched distance functions
+static vector<world_point2d> IntersectedLocations;
+static vector<world_distance> IntersectedDistances;
+
+// Uniform grid over polygon bounding boxes for world_point_to_polygon_index();
+// each cell lists (in increasing order) every polygon whose bounding box touches it
+struct polygon_lookup_grid_data {
+	short polygon_count; // the dynamic_world->polygon_count this grid was built for
+	world_distance x0, y0;
+	int32 cell_size; // up to the map's width or height, which needn't fit a world_distance
+	int32 columns, rows;
+	vector<int32> cell_starts; // rows*columns+1 offsets into cell_polygons
+	vector<int16> cell_polygons;
+};
+
+static polygon_lookup_grid_data PolygonLookupGrid;
+
+// How many monster, scenery and item objects are linked into each polygon's object list;
+// rebuilt from the lists themselves whenever it is marked invalid (e.g., after loading)
+struct polygon_object_counts {
+	int16 monster_count;
+	int16 scenery_count;
+	int16 item_count;
+};
+
+static vector<polygon_object_counts> PolygonObjectCounts;
+static bool PolygonObjectCountsValid = false;
+
+// Line-of-sight walks remembered since the line flags last changed, and which polygons can be
+// reached from each other through transparent lines only
+struct line_of_sight_memo_data {
+	uint32 epoch;
+	int16 kind;
+	int16 polygon_index1, polygon_index2;
+	world_point2d p1, p2;
+	bool result;
+};
+
+const int LINE_OF_SIGHT_MEMO_SIZE = 1024; // power of two
+static vector<line_of_sight_memo_data> LineOfSightMemos(LINE_OF_SIGHT_MEMO_SIZE);
+static uint32 LineVisibilityEpoch = 1;
+static uint32 TransparentComponentsEpoch = 0;
+static vector<int16> TransparentComponents;
+
+// Whether the line from a sound to the listener is obstructed, by the polygon
+// it starts in; every sound heard from the same polygon in the same tick
+// shares the first one's answer
+struct sound_obstruction_entry
+{
+	short source_polygon_index;
+	bool obstructed;
+};
+
+static vector<sound_obstruction_entry> sound_obstruction_cache;
+static int32 sound_obstruction_tick= NONE;
+static short sound_obstruction_listener_polygon_index= NONE;
 
 // Whether or not Marathon 2/oo landscapes had been loaded (switch off for Marathon 1 compatibility)
 bool LandscapesLoaded = true;
@@ -244,6 +304,8 @@ short LoadedWallTexture = NONE;
 
 static short _new_map_object(shape_descriptor shape, angle facing);
 
+static FreeSlotIndex FreeObjectSlots;
+
 // ZZZ: factored out some functionality for prediction, but ended up not using this stuff,
 // so am not "publishing" it via map.h yet.
 // SB: Blah.
@@ -374,6 +436,29 @@ void allocate_map_memory(
 	allocate_player_memory();
 }
 
+template <class T>
+static size_t vector_memory_usage(const vector<T>& list)
+{
+	return list.capacity() * sizeof(T);
+}
+
+size_t get_map_memory_usage(
+	void)
+{
+	return sizeof(static_data) + sizeof(dynamic_data) +
+		vector_memory_usage(EffectList) + vector_memory_usage(ObjectList) +
+		vector_memory_usage(MonsterList) + vector_memory_usage(ProjectileList) +
+		vector_memory_usage(EndpointList) + vector_memory_usage(LineList) +
+		vector_memory_usage(SideList) + vector_memory_usage(PolygonList) +
+		vector_memory_usage(PlatformList) + vector_memory_usage(LightList) +
+		vector_memory_usage(MediaList) +
+		vector_memory_usage(AmbientSoundImageList) + vector_memory_usage(RandomSoundImageList) +
+		vector_memory_usage(MapIndexList) +
+		vector_memory_usage(AutomapLineList) + vector_memory_usage(AutomapPolygonList) +
+		vector_memory_usage(MapAnnotationList) + vector_memory_usage(SavedObjectList) +
+		vector_memory_usage(PolygonObjectCounts) + vector_memory_usage(IntersectedObjects);
+}
+
 void initialize_map_for_new_game(
 	void)
 {
@@ -392,6 +477,10 @@ void initialize_map_for_new_level(
 	short player_count;
 	struct game_data game_information;
 
+	/* the tick count starts over, so what was cached for it doesn't hold */
+	sound_obstruction_tick= NONE;
+	map_load_count++;
+
 	/* The player count, tick count, and random seed must persist.. */
 	/* And the game information! (ajr) */
 	player_count= dynamic_world->player_count;
@@ -420,6 +509,10 @@ void initialize_map_for_new_level(
 	objlist_clear(projectiles,  ProjectileList.size());
 	objlist_clear(monsters,  MonsterList.size());
 	objlist_clear(objects,  ObjectList.size());
+	rebuild_object_slot_index();
+	rebuild_monster_slot_index();
+	rebuild_projectile_slot_index();
+	rebuild_effect_slot_index();
 
 	/* Note that these pointers just point into a larger structure, so this is not a bad thing */
 	// map_polygons= NULL;
@@ -541,6 +634,7 @@ void mark_map_collections(bool loading)
 			if (map_collections[collection])
 			{
 				mark_collection_for_loading(collection);
+				prefetch_collection(collection);
 			}
 		}
 
@@ -622,8 +716,198 @@ void mark_environment_collections(
 	
 	// Don't load/unload if M1 compatible...
 	if (LandscapesLoaded)
-		loading ? mark_collection_for_loading(_collection_landscape1+static_world->song_index) :
+	{
+		if (loading)
+		{
+			mark_collection_for_loading(_collection_landscape1+static_world->song_index);
+			prefetch_collection(_collection_landscape1+static_world->song_index);
+		}
+		else
 			mark_collection_for_unloading(_collection_landscape1+static_world->song_index);
+	}
+}
+
+static void adjust_polygon_object_counts(
+	short polygon_index,
+	short owner,
+	int16 delta)
+{
+	if (!PolygonObjectCountsValid || polygon_index==NONE) return;
+	
+	switch (owner)
+	{
+		case _object_is_monster: PolygonObjectCounts[polygon_index].monster_count+= delta; break;
+		case _object_is_scenery: PolygonObjectCounts[polygon_index].scenery_count+= delta; break;
+		case _object_is_item: PolygonObjectCounts[polygon_index].item_count+= delta; break;
+	}
+}
+
+static void recount_polygon_objects(
+	void)
+{
+	PolygonObjectCounts.assign(dynamic_world->polygon_count, polygon_object_counts());
+	PolygonObjectCountsValid= true;
+	
+	for (short polygon_index= 0; polygon_index<dynamic_world->polygon_count; ++polygon_index)
+	{
+		for (short object_index= get_polygon_data(polygon_index)->first_object; object_index!=NONE; object_index= get_object_data(object_index)->next_object)
+		{
+			adjust_polygon_object_counts(polygon_index, GET_OBJECT_OWNER(get_object_data(object_index)), 1);
+		}
+	}
+}
+
+void invalidate_polygon_object_counts(
+	void)
+{
+	PolygonObjectCountsValid= false;
+}
+
+/* only objects linked into a polygon's list are counted; parasitic objects share their host's
+	polygon index without being linked, but they are never monsters, scenery or items */
+void object_owner_will_change(
+	struct object_data *object,
+	short new_owner)
+{
+	short old_owner= GET_OBJECT_OWNER(object);
+	
+	if (old_owner!=new_owner && SLOT_IS_USED(object))
+	{
+		adjust_polygon_object_counts(object->polygon, old_owner, -1);
+		adjust_polygon_object_counts(object->polygon, new_owner, 1);
+	}
+}
+
+/* false means there is certainly no monster (or, if include_scenery, scenery) object in the
+	given polygon; true means there may be */
+bool polygon_may_contain_monsters(
+	short polygon_index,
+	bool include_scenery)
+{
+	if (!PolygonObjectCountsValid || PolygonObjectCounts.size()!=static_cast<size_t>(dynamic_world->polygon_count))
+		recount_polygon_objects();
+	
+	polygon_object_counts& counts= PolygonObjectCounts[polygon_index];
+	return counts.monster_count>0 || (include_scenery && counts.scenery_count>0);
+}
+
+/* false means there is certainly no item object (visible or not) in the given polygon */
+bool polygon_may_contain_items(
+	short polygon_index)
+{
+	if (!PolygonObjectCountsValid || PolygonObjectCounts.size()!=static_cast<size_t>(dynamic_world->polygon_count))
+		recount_polygon_objects();
+	
+	return PolygonObjectCounts[polygon_index].item_count>0;
+}
+
+/* call whenever line solidity or transparency changes (or a new map is loaded) */
+void line_visibility_changed(
+	void)
+{
+	LineVisibilityEpoch+= 1;
+}
+
+/* label each polygon with the lowest index of the polygons it can reach through transparent
+	lines; polygons with different labels can never see each other */
+static void label_transparent_components(
+	void)
+{
+	vector<int16> stack;
+	
+	TransparentComponents.assign(dynamic_world->polygon_count, NONE);
+	for (short seed= 0; seed<dynamic_world->polygon_count; ++seed)
+	{
+		if (TransparentComponents[seed]!=NONE) continue;
+		
+		TransparentComponents[seed]= seed;
+		stack.push_back(seed);
+		while (!stack.empty())
+		{
+			struct polygon_data *polygon= get_polygon_data(stack.back());
+			stack.pop_back();
+			
+			for (short i= 0; i<polygon->vertex_count; ++i)
+			{
+				short adjacent_polygon_index= polygon->adjacent_polygon_indexes[i];
+				
+				if (adjacent_polygon_index!=NONE && TransparentComponents[adjacent_polygon_index]==NONE &&
+					LINE_IS_TRANSPARENT(get_line_data(polygon->line_indexes[i])))
+				{
+					TransparentComponents[adjacent_polygon_index]= seed;
+					stack.push_back(adjacent_polygon_index);
+				}
+			}
+		}
+	}
+	
+	TransparentComponentsEpoch= LineVisibilityEpoch;
+}
+
+/* false if no line from one polygon could reach the other crossing only transparent lines */
+bool polygons_may_see_each_other(
+	short polygon_index1,
+	short polygon_index2)
+{
+	if (TransparentComponentsEpoch!=LineVisibilityEpoch || TransparentComponents.size()!=static_cast<size_t>(dynamic_world->polygon_count))
+		label_transparent_components();
+	
+	return TransparentComponents[polygon_index1]==TransparentComponents[polygon_index2];
+}
+
+static line_of_sight_memo_data& get_line_of_sight_memo(
+	short kind,
+	short polygon_index1,
+	world_point2d *p1,
+	short polygon_index2,
+	world_point2d *p2)
+{
+	uint32 hash= kind;
+	hash= hash*31 + uint16(polygon_index1);
+	hash= hash*31 + uint16(polygon_index2);
+	hash= hash*31 + uint16(p1->x), hash= hash*31 + uint16(p1->y);
+	hash= hash*31 + uint16(p2->x), hash= hash*31 + uint16(p2->y);
+	hash^= hash>>15;
+	
+	return LineOfSightMemos[hash&(LINE_OF_SIGHT_MEMO_SIZE-1)];
+}
+
+bool find_line_of_sight_memo(
+	short kind,
+	short polygon_index1,
+	world_point2d *p1,
+	short polygon_index2,
+	world_point2d *p2,
+	bool *result)
+{
+	line_of_sight_memo_data& memo= get_line_of_sight_memo(kind, polygon_index1, p1, polygon_index2, p2);
+	
+	if (memo.epoch==LineVisibilityEpoch && memo.kind==kind &&
+		memo.polygon_index1==polygon_index1 && memo.polygon_index2==polygon_index2 &&
+		memo.p1.x==p1->x && memo.p1.y==p1->y && memo.p2.x==p2->x && memo.p2.y==p2->y)
+	{
+		*result= memo.result;
+		return true;
+	}
+	
+	return false;
+}
+
+void remember_line_of_sight(
+	short kind,
+	short polygon_index1,
+	world_point2d *p1,
+	short polygon_index2,
+	world_point2d *p2,
+	bool result)
+{
+	line_of_sight_memo_data& memo= get_line_of_sight_memo(kind, polygon_index1, p1, polygon_index2, p2);
+	
+	memo.epoch= LineVisibilityEpoch;
+	memo.kind= kind;
+	memo.polygon_index1= polygon_index1, memo.polygon_index2= polygon_index2;
+	memo.p1= *p1, memo.p2= *p2;
+	memo.result= result;
 }
 
 /* make the object list and the map consistent */
@@ -651,6 +935,8 @@ void reconnect_map_object_list(
 			polygon->first_object= i;
 		}
 	}
+	
+	invalidate_polygon_object_counts();
 }
 
 bool valid_point2d(
@@ -803,6 +1089,7 @@ void remove_parasitic_object(
 
 	host->parasitic_object= NONE;
 	MARK_SLOT_AS_FREE(parasite);
+	FreeObjectSlots.mark_free(parasite-objects);
 }
 
 /* look up the index yourself */
@@ -821,12 +1108,22 @@ void remove_map_object(
 		struct object_data *parasite= get_object_data(object->parasitic_object);
 		
 		MARK_SLOT_AS_FREE(parasite);
+		FreeObjectSlots.mark_free(object->parasitic_object);
 	}
 
 	SoundManager::instance()->OrphanSound(object_index);
 	L_Invalidate_Object(object_index);
+	if (GET_OBJECT_OWNER(object)==_object_is_monster) invalidate_path_cache(true);
+	adjust_polygon_object_counts(object->polygon, GET_OBJECT_OWNER(object), -1);
 	*next_object= object->next_object;
 	MARK_SLOT_AS_FREE(object);
+	FreeObjectSlots.mark_free(object_index);
+}
+
+void rebuild_object_slot_index(
+	void)
+{
+	FreeObjectSlots.rebuild(ObjectList);
 }
 
 
@@ -850,7 +1147,11 @@ remove_object_from_polygon_object_list(short object_index, short polygon_index)
 
 	*next_object= object->next_object;
 
+	adjust_polygon_object_counts(polygon_index, GET_OBJECT_OWNER(object), -1);
 	object->polygon= NONE;
+	
+	/* monster pathfinding costs depend on how many monsters are in each polygon */
+	if (GET_OBJECT_OWNER(object)==_object_is_monster) invalidate_path_cache(true);
 }
 
 void
@@ -872,6 +1173,9 @@ add_object_to_polygon_object_list(short object_index, short polygon_index)
 	polygon->first_object= object_index;
 
 	object->polygon= polygon_index;
+	adjust_polygon_object_counts(polygon_index, GET_OBJECT_OWNER(object), 1);
+	
+	if (GET_OBJECT_OWNER(object)==_object_is_monster) invalidate_path_cache(true);
 }
 
 typedef std::pair<short, short>	DeferredObjectListInsertion;
@@ -912,6 +1216,7 @@ perform_deferred_polygon_object_list_manipulations()
 				{
 					object->next_object = *next_object_index_p;
 					*next_object_index_p = object_to_insert_index;
+					adjust_polygon_object_counts(object->polygon, GET_OBJECT_OWNER(object), 1);
 					inserted = true;
 				}
 
@@ -1011,7 +1316,7 @@ void get_object_shape_and_transfer_mode(
 	angle theta;
 	short view;
 	
-	animation= get_shape_animation_data(object->shape);
+	animation= get_object_animation_data(object);
 	// Added bug-outs in case of incorrect data; turned asserts into these tests:
 	if (!animation)
 	{
@@ -1180,6 +1485,43 @@ void set_object_shape_and_transfer_mode(
 	}
 }
 
+/* each object's .shape's animation data, good while .shape and the shapes' generation are
+	those it was resolved for; kept out of object_data, so that the world's checksums and
+	snapshots only ever see what the simulation itself keeps there */
+struct resolved_object_animation
+{
+	struct shape_animation_data *animation;
+	uint32 generation; // 0 is never a shapes generation
+	shape_descriptor shape;
+
+	resolved_object_animation() : animation(NULL), generation(0), shape(UNONE) {}
+};
+static vector<resolved_object_animation> ResolvedObjectAnimations;
+
+/* what get_shape_animation_data(object->shape) would say, looked up again only when
+	the shape or the loaded shapes change */
+struct shape_animation_data *get_object_animation_data(
+	struct object_data *object)
+{
+	ptrdiff_t object_index= object - objects;
+	if (object_index<0 || size_t(object_index)>=ObjectList.size())
+		return get_shape_animation_data(object->shape);
+	if (ResolvedObjectAnimations.size()<ObjectList.size())
+		ResolvedObjectAnimations.resize(ObjectList.size());
+
+	resolved_object_animation& resolved= ResolvedObjectAnimations[object_index];
+	uint32 generation= get_shape_data_generation();
+	
+	if (resolved.generation!=generation || resolved.shape!=object->shape)
+	{
+		resolved.animation= get_shape_animation_data(object->shape);
+		resolved.generation= generation;
+		resolved.shape= object->shape;
+	}
+	
+	return resolved.animation;
+}
+
 /* no longer called by RENDER.C; must be called by monster, projectile or effect controller;
 	now assumes t==1 tick */
 void animate_object(
@@ -1191,7 +1533,7 @@ void animate_object(
 
 	if (!OBJECT_IS_INVISIBLE(object)) /* invisible objects dont have valid .shape fields */
 	{
-		animation= get_shape_animation_data(object->shape);
+		animation= get_object_animation_data(object);
 		if (!animation) return;
 	
 		/* if this animation has frames, animate it */		
@@ -1354,6 +1696,27 @@ short world_point_to_polygon_index(
 	short polygon_index;
 	struct polygon_data *polygon;
 	
+	polygon_lookup_grid_data& grid= PolygonLookupGrid;
+	if (grid.polygon_count==dynamic_world->polygon_count && grid.polygon_count>0)
+	{
+		/* every polygon containing this point touches its cell, and the cell lists polygons in
+			increasing order, so the first hit is the same one the full scan below would find */
+		int32 column= (location->x-grid.x0)/grid.cell_size;
+		int32 row= (location->y-grid.y0)/grid.cell_size;
+		
+		if (location->x<grid.x0 || location->y<grid.y0 || column>=grid.columns || row>=grid.rows) return NONE;
+		
+		int32 cell= row*grid.columns+column;
+		for (int32 i= grid.cell_starts[cell]; i<grid.cell_starts[cell+1]; ++i)
+		{
+			polygon_index= grid.cell_polygons[i];
+			if (!POLYGON_IS_DETACHED(get_polygon_data(polygon_index)) && point_in_polygon(polygon_index, location))
+				return polygon_index;
+		}
+		
+		return NONE;
+	}
+	
 	for (polygon_index=0,polygon=map_polygons;polygon_index<dynamic_world->polygon_count;++polygon_index,++polygon)
 	{
 		if (!POLYGON_IS_DETACHED(polygon))
@@ -1366,6 +1729,134 @@ short world_point_to_polygon_index(
 	return polygon_index;
 }
 
+static void get_polygon_bounds(
+	short polygon_index,
+	world_point2d *minimum,
+	world_point2d *maximum)
+{
+	struct polygon_data *polygon= get_polygon_data(polygon_index);
+	
+	*minimum= *maximum= get_endpoint_data(polygon->endpoint_indexes[0])->vertex;
+	for (short i= 1; i<polygon->vertex_count; ++i)
+	{
+		world_point2d& vertex= get_endpoint_data(polygon->endpoint_indexes[i])->vertex;
+		
+		minimum->x= MIN(minimum->x, vertex.x), minimum->y= MIN(minimum->y, vertex.y);
+		maximum->x= MAX(maximum->x, vertex.x), maximum->y= MAX(maximum->y, vertex.y);
+	}
+}
+
+/* (re)build the world_point_to_polygon_index() grid; call whenever polygon geometry has been
+	loaded.  the number of cells is capped by the polygon_lookup_cells dynamic limit, and a
+	limit of zero turns the grid off entirely */
+void build_polygon_lookup_grid(
+	void)
+{
+	polygon_lookup_grid_data& grid= PolygonLookupGrid;
+	int32 maximum_cells= get_dynamic_limit(_dynamic_limit_polygon_lookup_cells);
+	
+	grid.polygon_count= 0;
+	grid.cell_starts.clear();
+	grid.cell_polygons.clear();
+	if (dynamic_world->polygon_count<=0 || maximum_cells<=0) return;
+	
+	/* find the extent of the map */
+	world_point2d map_minimum, map_maximum;
+	get_polygon_bounds(0, &map_minimum, &map_maximum);
+	for (short polygon_index= 1; polygon_index<dynamic_world->polygon_count; ++polygon_index)
+	{
+		world_point2d minimum, maximum;
+		
+		get_polygon_bounds(polygon_index, &minimum, &maximum);
+		map_minimum.x= MIN(map_minimum.x, minimum.x), map_minimum.y= MIN(map_minimum.y, minimum.y);
+		map_maximum.x= MAX(map_maximum.x, maximum.x), map_maximum.y= MAX(map_maximum.y, maximum.y);
+	}
+	
+	/* aim for about two cells per polygon, with square cells */
+	int32 width= map_maximum.x-map_minimum.x+1;
+	int32 height= map_maximum.y-map_minimum.y+1;
+	int32 target_cells= MIN(maximum_cells, 2*static_cast<int32>(dynamic_world->polygon_count));
+	int32 cell_size= static_cast<int32>(ceil(sqrt((double(width)*double(height))/target_cells)));
+	cell_size= MAX(cell_size, 1);
+	while ((width+cell_size-1)/cell_size * ((height+cell_size-1)/cell_size) > maximum_cells) cell_size+= 1 + cell_size/16;
+	// a single cell covers the whole map; bigger ones are no use
+	cell_size= PIN(cell_size, 1, MAX(width, height));
+	
+	grid.x0= map_minimum.x;
+	grid.y0= map_minimum.y;
+	grid.cell_size= cell_size;
+	grid.columns= (width+cell_size-1)/cell_size;
+	grid.rows= (height+cell_size-1)/cell_size;
+	
+	/* count, then fill, the polygons touching each cell */
+	int32 cell_count= grid.rows*grid.columns;
+	grid.cell_starts.assign(cell_count+1, 0);
+	for (int pass= 0; pass<2; ++pass)
+	{
+		vector<int32> cell_fill;
+		if (pass==1)
+		{
+			for (int32 cell= 0; cell<cell_count; ++cell) grid.cell_starts[cell+1]+= grid.cell_starts[cell];
+			grid.cell_polygons.resize(grid.cell_starts[cell_count]);
+			cell_fill.assign(grid.cell_starts.begin(), grid.cell_starts.end()-1);
+		}
+		
+		for (short polygon_index= 0; polygon_index<dynamic_world->polygon_count; ++polygon_index)
+		{
+			world_point2d minimum, maximum;
+			
+			get_polygon_bounds(polygon_index, &minimum, &maximum);
+			for (int32 row= (minimum.y-grid.y0)/cell_size; row<=(maximum.y-grid.y0)/cell_size; ++row)
+			{
+				for (int32 column= (minimum.x-grid.x0)/cell_size; column<=(maximum.x-grid.x0)/cell_size; ++column)
+				{
+					int32 cell= row*grid.columns+column;
+					
+					if (pass==0) grid.cell_starts[cell+1]+= 1;
+					else grid.cell_polygons[cell_fill[cell]++]= polygon_index;
+				}
+			}
+		}
+	}
+	
+	grid.polygon_count= dynamic_world->polygon_count;
+}
+
+/* every polygon whose bounding box may touch the square reaching radius from center (and
+	maybe a few more), in increasing order; false, with nothing found, if there is no grid and
+	every polygon must be considered */
+bool find_polygons_near_point(
+	world_point2d *center,
+	int32 radius,
+	vector<short>& polygons)
+{
+	polygon_lookup_grid_data& grid= PolygonLookupGrid;
+	
+	polygons.clear();
+	if (grid.polygon_count!=dynamic_world->polygon_count || grid.polygon_count<=0) return false;
+	
+	int32 column0= MAX(0, (center->x-radius-grid.x0)/grid.cell_size);
+	int32 row0= MAX(0, (center->y-radius-grid.y0)/grid.cell_size);
+	int32 column1= MIN(grid.columns-1, (center->x+radius-grid.x0)/grid.cell_size);
+	int32 row1= MIN(grid.rows-1, (center->y+radius-grid.y0)/grid.cell_size);
+	
+	for (int32 row= row0; row<=row1; ++row)
+	{
+		for (int32 column= column0; column<=column1; ++column)
+		{
+			int32 cell= row*grid.columns+column;
+			polygons.insert(polygons.end(), grid.cell_polygons.begin()+grid.cell_starts[cell],
+				grid.cell_polygons.begin()+grid.cell_starts[cell+1]);
+		}
+	}
+	
+	/* a polygon spanning several cells is listed in each */
+	std::sort(polygons.begin(), polygons.end());
+	polygons.erase(std::unique(polygons.begin(), polygons.end()), polygons.end());
+	
+	return true;
+}
+
 /* return the polygon on the other side of the given line from the given polygon (i.e., return
 	the polygon adjacent to line_index which isnt polygon_index).  can return NONE. */
 short find_adjacent_polygon(
@@ -1486,6 +1977,17 @@ short find_shared_line(
 	short shared_line_index= NONE;
 	short i;
 	
+	/* the adjacency table (see recalculate_redundant_polygon_data()) answers this without
+		touching the lines */
+	for (i=0;i<polygon->vertex_count;++i)
+	{
+		if (polygon->adjacent_polygon_indexes[i]==polygon_index2)
+		{
+			return polygon->line_indexes[i];
+		}
+	}
+	
+	/* but lines which dont list this polygon as an owner arent in it */
 	for (i=0;i<polygon->vertex_count;++i)
 	{
 		struct line_data *line= get_line_data(polygon->line_indexes[i]);
@@ -2088,6 +2590,7 @@ bool change_polygon_height(
 		/* slam the polygon heights, directly */
 		polygon->floor_height= new_floor_height;
 		polygon->ceiling_height= new_ceiling_height;
+		invalidate_path_cache();
 		
 		/* the highest_adjacent_floor, lowest_adjacent_ceiling and supporting_polygon_index fields
 			of all of this polygons endpoints and lines are potentially invalid now.  to assure
@@ -2147,21 +2650,31 @@ bool point_is_monster_visible(
 	IntersectedObjects.clear();
 	possible_intersecting_monsters(&IntersectedObjects, LOCAL_INTERSECTING_MONSTER_BUFFER_SIZE, polygon_index, false);
 	object_count = IntersectedObjects.size();
+	if (!object_count) return false;
 	
+	IntersectedLocations.resize(object_count);
+	IntersectedDistances.resize(object_count);
 	for (size_t i=0;i<object_count;++i)
 	{
 		// LP change:
 		struct object_data *object= get_object_data(IntersectedObjects[i]);
-		int32 this_distance;
-		
-		this_distance = guess_distance2d((world_point2d*)&object->location, p);
+		IntersectedLocations[i]= *(world_point2d*)&object->location;
+	}
+	guess_distance2d_batch(p, &IntersectedLocations[0], object_count, &IntersectedDistances[0]);
+	
+	for (size_t i=0;i<object_count;++i)
+	{
+		int32 this_distance= IntersectedDistances[i];
 		if (*distance>this_distance) *distance= this_distance;
 	}
 
 	return *distance!=INT32_MAX;
 }
 
-bool line_is_obstructed(
+// One walk for each setting of the film profile's fix, chosen once per call
+// rather than at every polygon crossed
+template <bool line_is_obstructed_fix>
+static bool walk_line_of_sight(
 	short polygon_index1,
 	world_point2d *p1,
 	short polygon_index2,
@@ -2174,7 +2687,7 @@ bool line_is_obstructed(
 	do
 	{
 		bool last_line = false;
-		if (film_profile.line_is_obstructed_fix)
+		if (line_is_obstructed_fix)
 		{
 			line_index = find_line_crossed_leaving_polygon(polygon_index, (world_point2d *)p1, (world_point2d *)p2);
 		}
@@ -2212,7 +2725,7 @@ bool line_is_obstructed(
 			if (polygon_index!=polygon_index2) 
 			{
 				obstructed= true;
-				if (film_profile.line_is_obstructed_fix)
+				if (line_is_obstructed_fix)
 				{
 					polygon_data* polygon = get_polygon_data(polygon_index);
 					polygon_data* polygon2 = get_polygon_data(polygon_index2);
@@ -2237,6 +2750,26 @@ bool line_is_obstructed(
 	return obstructed;
 }
 
+bool line_is_obstructed(
+	short polygon_index1,
+	world_point2d *p1,
+	short polygon_index2,
+	world_point2d *p2)
+{
+	bool obstructed= false;
+	
+	if (find_line_of_sight_memo(_line_of_sight_through_passable_lines, polygon_index1, p1, polygon_index2, p2, &obstructed))
+		return obstructed;
+	
+	if (film_profile.line_is_obstructed_fix)
+		obstructed= walk_line_of_sight<true>(polygon_index1, p1, polygon_index2, p2);
+	else
+		obstructed= walk_line_of_sight<false>(polygon_index1, p1, polygon_index2, p2);
+
+	remember_line_of_sight(_line_of_sight_through_passable_lines, polygon_index1, p1, polygon_index2, p2, obstructed);
+	return obstructed;
+}
+
 #define MAXIMUM_GARBAGE_OBJECTS_PER_MAP 256
 #define MAXIMUM_GARBAGE_OBJECTS_PER_POLYGON 10
 
@@ -2287,6 +2820,7 @@ void turn_object_to_shit( /* garbage that is, garbage */
 		}
 	}
 	
+	if (GET_OBJECT_OWNER(garbage_object)==_object_is_monster) invalidate_path_cache(true);
 	SET_OBJECT_OWNER(garbage_object, _object_is_garbage);
 }
 
@@ -2365,7 +2899,7 @@ static short _new_map_object(
 	struct object_data *object;
 	short object_index;
 	
-	for (object_index=0,object=objects;object_index<MAXIMUM_OBJECTS_PER_MAP;++object_index,++object)
+	for (object_index=FreeObjectSlots.first_free(ObjectList),object=objects+object_index;object_index<MAXIMUM_OBJECTS_PER_MAP;++object_index,++object)
 	{
 		if (SLOT_IS_FREE(object))
 		{
@@ -2489,6 +3023,37 @@ world_location3d *_sound_listener_proc(
 		NULL);
 }
 
+// The line from a sound to the listener is only walked once per source
+// polygon each tick (see sound_obstruction_cache)
+static bool sound_line_is_obstructed(
+	world_location3d *source,
+	world_location3d *listener)
+{
+	if (sound_obstruction_tick!=dynamic_world->tick_count ||
+		sound_obstruction_listener_polygon_index!=listener->polygon_index)
+	{
+		sound_obstruction_cache.clear();
+		sound_obstruction_tick= dynamic_world->tick_count;
+		sound_obstruction_listener_polygon_index= listener->polygon_index;
+	}
+	
+	for (size_t i= 0; i<sound_obstruction_cache.size(); ++i)
+	{
+		if (sound_obstruction_cache[i].source_polygon_index==source->polygon_index)
+		{
+			return sound_obstruction_cache[i].obstructed;
+		}
+	}
+	
+	sound_obstruction_entry entry;
+	entry.source_polygon_index= source->polygon_index;
+	entry.obstructed= line_is_obstructed(source->polygon_index, (world_point2d *)&source->point,
+		listener->polygon_index, (world_point2d *)&listener->point);
+	sound_obstruction_cache.push_back(entry);
+	
+	return entry.obstructed;
+}
+
 // stuff floating on top of media is above it
 uint16 _sound_obstructed_proc(
 	world_location3d *source)
@@ -2498,8 +3063,7 @@ uint16 _sound_obstructed_proc(
 	
 	if (listener)
 	{
-		if (line_is_obstructed(source->polygon_index, (world_point2d *)&source->point,
-			listener->polygon_index, (world_point2d *)&listener->point))
+		if (sound_line_is_obstructed(source, listener))
 		{
 			flags|= _sound_was_obstructed;
 		}
@@ -2755,7 +3319,7 @@ void parse_mml_texture_loading(const InfoTree& root)
 	
 	root.read_attr("landscapes", LandscapesLoaded);
 	
-	BOOST_FOREACH(InfoTree env, root.children_named("texture_env"))
+	BOOST_FOREACH(const InfoTree &env, root.children_named("texture_env"))
 	{
 		int16 index, which, coll;
 		if (env.read_indexed("index", index, NUMBER_OF_ENVIRONMENTS) &&
@@ -367,7 +367,7 @@ enum /* object scale flags */
 #define TOGGLE_OBJECT_STATUS(o) ((o)->flags^=(uint16)8)
 
 #define GET_OBJECT_OWNER(o) ((o)->flags&(uint16)7)
-#define SET_OBJECT_OWNER(o,n) { assert((n)>=0&&(n)<=7); (o)->flags&= (uint16)~7; (o)->flags|= (n); }
+#define SET_OBJECT_OWNER(o,n) { assert((n)>=0&&(n)<=7); object_owner_will_change((o), (n)); (o)->flags&= (uint16)~7; (o)->flags|= (n); }
 enum /* object owners (8) */
 {
 	_object_is_normal, /* normal */
@@ -991,6 +991,10 @@ const unsigned int SIZEOF_dynamic_data = 604;
 extern struct static_data *static_world;
 extern struct dynamic_data *dynamic_world;
 
+// How many levels have been set up; what is kept of a level's geometry
+// (by the renderer, say) was kept from an earlier one if this has changed
+extern uint32 map_load_count;
+
 extern vector<object_data> ObjectList;
 #define objects (&ObjectList[0])
 
@@ -1076,7 +1080,7 @@ void initialize_marathon(void);
 
 void leaving_map(void);
 // LP: added whether a savegame is being restored (skip Pfhortran init if that's the case)
-bool entering_map(bool restoring_saved);
+bool entering_map(bool restoring_saved, bool same_level = false);
 
 // ZZZ: now returns <whether anything changed, real-mode elapsed time>
 // (used to return only the latter)
@@ -1097,6 +1101,8 @@ short calculate_level_completion_state(void);
 /* ---------- prototypes/MAP.C */
 
 void allocate_map_memory(void);
+// Bytes the map's geometry and the things in it hold now
+size_t get_map_memory_usage(void);
 void initialize_map_for_new_game(void);
 void initialize_map_for_new_level(void);
 
@@ -1116,6 +1122,7 @@ void remove_parasitic_object(short host_index);
 bool translate_map_object(short object_index, world_point3d *new_location, short new_polygon_index);
 short find_new_object_polygon(world_point2d *parent_location, world_point2d *child_location, short parent_polygon_index);
 void remove_map_object(short index);
+void rebuild_object_slot_index(void); /* when ObjectList is cleared or filled wholesale */
 
 
 // ZZZ additions in support of prediction:
@@ -1153,6 +1160,7 @@ struct shape_and_transfer_mode
 void get_object_shape_and_transfer_mode(world_point3d *camera_location, short object_index, struct shape_and_transfer_mode *data);
 void set_object_shape_and_transfer_mode(short object_index, shape_descriptor shape, short transfer_mode);
 void animate_object(short object_index); /* assumes t==1 tick */
+struct shape_animation_data *get_object_animation_data(struct object_data *object);
 bool randomize_object_sequence(short object_index, shape_descriptor shape);
 
 void play_object_sound(short object_index, short sound_code);
@@ -1168,6 +1176,28 @@ void initialize_map_for_new_player(void);
 void generate_map(short level);
 
 short world_point_to_polygon_index(world_point2d *location);
+void build_polygon_lookup_grid(void);
+bool find_polygons_near_point(world_point2d *center, int32 radius, vector<short>& polygons);
+
+/* per-polygon counts of linked monster and scenery objects, kept up to date by the object list
+	functions so that collision and targeting searches can skip polygons with nothing in them */
+void object_owner_will_change(struct object_data *object, short new_owner);
+void invalidate_polygon_object_counts(void);
+bool polygon_may_contain_monsters(short polygon_index, bool include_scenery);
+bool polygon_may_contain_items(short polygon_index);
+
+/* results of walking a 2d line between two points through the map only depend on the line
+	flags, so they are remembered until line_visibility_changed() is next called */
+enum /* line of sight memo kinds */
+{
+	_line_of_sight_through_transparent_lines, /* clear_line_of_sight() */
+	_line_of_sight_through_passable_lines /* line_is_obstructed() */
+};
+
+void line_visibility_changed(void);
+bool polygons_may_see_each_other(short polygon_index1, short polygon_index2);
+bool find_line_of_sight_memo(short kind, short polygon_index1, world_point2d *p1, short polygon_index2, world_point2d *p2, bool *result);
+void remember_line_of_sight(short kind, short polygon_index1, world_point2d *p1, short polygon_index2, world_point2d *p2, bool result);
 short clockwise_endpoint_in_line(short polygon_index, short line_index, short index);
 
 short find_adjacent_polygon(short polygon_index, short line_index);
@@ -1357,6 +1387,8 @@ void update_action_key(short player_index, bool triggered);
 bool untoggled_repair_switches_on_level(bool only_last_switch = false);
 
 void assume_correct_switch_position(short switch_type, short permutation, bool new_state);
+// call after changing a side's control panel permutation
+void side_permutations_changed(void);
 
 void try_and_toggle_control_panel(short polygon_index, short line_index, short projectile_index);
 
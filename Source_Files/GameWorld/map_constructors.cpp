@@ -1140,18 +1140,40 @@ static void precalculate_polygon_sound_sources(
 {
 	short polygon_index;
 	struct polygon_data *polygon;
+	std::vector<short> sound_source_object_indexes;
+	
+	for (short object_index= 0; object_index<dynamic_world->initial_objects_count; ++object_index)
+	{
+		if (saved_objects[object_index].type==_saved_sound_source)
+		{
+			sound_source_object_indexes.push_back(object_index);
+		}
+	}
 	
 	for (polygon_index= 0, polygon= map_polygons; polygon_index<dynamic_world->polygon_count; ++polygon_index, ++polygon)
 	{
-		short object_index;
-		struct map_object *object;
 		short sound_sources= 0;
+		int32 x0= INT32_MAX, y0= INT32_MAX, x1= INT32_MIN, y1= INT32_MIN;
 		
 		polygon->sound_source_indexes= dynamic_world->map_index_count;
 		
-		for (object_index= 0, object= saved_objects; object_index<dynamic_world->initial_objects_count; ++object, ++object_index)
+		// a source farther than ZERO_VOLUME_DISTANCE along either axis from the
+		// polygon's bounds can't be close to any of its endpoints or lines
+		for (short i= 0; i<polygon->vertex_count; ++i)
 		{
-			if (object->type==_saved_sound_source)
+			world_point2d& vertex= get_endpoint_data(polygon->endpoint_indexes[i])->vertex;
+			x0= MIN(x0, vertex.x), y0= MIN(y0, vertex.y);
+			x1= MAX(x1, vertex.x), y1= MAX(y1, vertex.y);
+		}
+		x0-= ZERO_VOLUME_DISTANCE, y0-= ZERO_VOLUME_DISTANCE;
+		x1+= ZERO_VOLUME_DISTANCE, y1+= ZERO_VOLUME_DISTANCE;
+		
+		for (size_t k= 0; k<sound_source_object_indexes.size(); ++k)
+		{
+			short object_index= sound_source_object_indexes[k];
+			struct map_object *object= saved_objects + object_index;
+			
+			if (object->location.x>x0 && object->location.x<x1 && object->location.y>y0 && object->location.y<y1)
 			{
 				short i;
 				bool close= false;
@@ -1323,6 +1345,8 @@ void SideExclZoneToStream(uint8* &S, side_exclusion_zone& Object)
 
 uint8 *unpack_side_data(uint8 *Stream, side_data *Objects, size_t Count)
 {
+	side_permutations_changed();
+
 	uint8* S = Stream;
 	side_data* ObjPtr = Objects;
 	
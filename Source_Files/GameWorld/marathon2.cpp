@@ -72,6 +72,14 @@ Feb 8, 2003 (Woody Zenfell):
 	Player movement prediction support:
 	+ Support for retaining a partial game-state (this could be moved out to another file)
 	+ Changes to update_world() to take advantage of partial game-state saving/restoring.
+
+ Oct 14, 2026:
+	Prediction saves and restores the whole dynamic world (world_snapshot.h) rather than
+	just the players, their monsters and their objects.
+	Every second of a netgame or timedemo, checksums of the world are reported.
+	Catching up: what only shows on screen (or plays locally) is updated once, after
+	the last of a batch of ticks, rather than on each of them.
+	Entering a map rebuilds the slot indexes of objects, monsters, projectiles and effects.
 */
 
 #include "cseries.h"
@@ -118,13 +126,23 @@ Feb 8, 2003 (Woody Zenfell):
 #include "Console.h"
 #include "Movie.h"
 #include "Statistics.h"
+#include "vbl.h"
 
 #include "motion_sensor.h"
+#include "world_snapshot.h"
+#include "Trace.h"
+#include "MemoryAccounting.h"
 
 #include <limits.h>
+#include <stdint.h>
 
 /* ---------- constants */
 
+enum {
+	// how often world checksums go to the hub (or into a timedemo's result)
+	kWorldChecksumPeriod = TICKS_PER_SECOND
+};
+
 /* ---------- globals */
 
 // This is an intermediate action-flags queue for transferring action flags
@@ -136,6 +154,10 @@ ModifiableActionQueues* GetGameQueue() { return GameQueue; }
 // ZZZ: We keep this around for use in prediction (we assume a player keeps on doin' what he's been doin')
 static uint32	sMostRecentFlagsForPlayer[MAXIMUM_NUMBER_OF_PLAYERS];
 
+// More ticks are waiting behind this one, so presentation can wait for the last of them
+static bool	sCatchingUp = false;
+static bool	sPresentationDeferred = false;
+
 /* ---------- private prototypes */
 
 static void game_timed_out(void);
@@ -194,42 +216,20 @@ set_prediction_wanted(bool inPrediction)
 	sPredictionWanted= inPrediction;
 }
 
-static player_data sSavedPlayerData[MAXIMUM_NUMBER_OF_PLAYERS];
-static monster_data sSavedPlayerMonsterData[MAXIMUM_NUMBER_OF_PLAYERS];
-static object_data sSavedPlayerObjectData[MAXIMUM_NUMBER_OF_PLAYERS];
-static object_data sSavedPlayerParasiticObjectData[MAXIMUM_NUMBER_OF_PLAYERS];
-static short sSavedPlayerObjectNextObject[MAXIMUM_NUMBER_OF_PLAYERS];
-
 // For sanity-checking...
 static int32 sSavedTickCount;
-static uint16 sSavedRandomSeed;
 
 
-// ZZZ: If not already in predictive mode, save off partial game-state for later restoration.
+// ZZZ: If not already in predictive mode, save off the game-state for later restoration.
 static void
 enter_predictive_mode()
 {
 	if(sPredictedTicks == 0)
 	{
-		for(short i = 0; i < dynamic_world->player_count; i++)
-		{
-			sSavedPlayerData[i] = *get_player_data(i);
-			if(sSavedPlayerData[i].monster_index != NONE)
-			{
-				sSavedPlayerMonsterData[i] = *get_monster_data(sSavedPlayerData[i].monster_index);
-				if(sSavedPlayerMonsterData[i].object_index != NONE)
-				{
-					sSavedPlayerObjectData[i] = *get_object_data(sSavedPlayerMonsterData[i].object_index);
-					sSavedPlayerObjectNextObject[i] = sSavedPlayerObjectData[i].next_object;
-					if(sSavedPlayerObjectData[i].parasitic_object != NONE)
-						sSavedPlayerParasiticObjectData[i] = *get_object_data(sSavedPlayerObjectData[i].parasitic_object);
-				}
-			}
-		}
+		save_world_snapshot();
 		
 		// Sanity checking
 		sSavedTickCount = dynamic_world->tick_count;
-		sSavedRandomSeed = get_random_seed();
 	}
 }
 
@@ -279,62 +279,34 @@ exit_predictive_mode()
 {
 	if(sPredictedTicks > 0)
 	{
+		// We *don't* restore this tiny part of the game-state back because
+		// otherwise the player can't use [] to scroll the inventory panel.
+		// [] scrolling happens outside the normal input/update system, so that's
+		// enough to persuade me that not restoring this won't OOS any more often
+		// than []-scrolling did before prediction.  :)
+		int16 saved_interface_flags[MAXIMUM_NUMBER_OF_PLAYERS];
+		int16 saved_interface_decay[MAXIMUM_NUMBER_OF_PLAYERS];
 		for(short i = 0; i < dynamic_world->player_count; i++)
 		{
-			player_data* player = get_player_data(i);
-			
-			assert(player->monster_index == sSavedPlayerData[i].monster_index);
-
-			{
-				// We *don't* restore this tiny part of the game-state back because
-				// otherwise the player can't use [] to scroll the inventory panel.
-				// [] scrolling happens outside the normal input/update system, so that's
-				// enough to persuade me that not restoring this won't OOS any more often
-				// than []-scrolling did before prediction.  :)
-				int16 saved_interface_flags = player->interface_flags;
-				int16 saved_interface_decay = player->interface_decay;
-				
-				*player = sSavedPlayerData[i];
-
-				player->interface_flags = saved_interface_flags;
-				player->interface_decay = saved_interface_decay;
-			}
-
-			if(sSavedPlayerData[i].monster_index != NONE)
-			{
-				assert(get_monster_data(sSavedPlayerData[i].monster_index)->object_index == sSavedPlayerMonsterData[i].object_index);
-
-				*get_monster_data(sSavedPlayerData[i].monster_index) = sSavedPlayerMonsterData[i];
-				
-				if(sSavedPlayerMonsterData[i].object_index != NONE)
-				{
-					assert(get_object_data(sSavedPlayerMonsterData[i].object_index)->parasitic_object == sSavedPlayerObjectData[i].parasitic_object);
-
-					remove_object_from_polygon_object_list(sSavedPlayerMonsterData[i].object_index);
-					
-					*get_object_data(sSavedPlayerMonsterData[i].object_index) = sSavedPlayerObjectData[i];
-
-					// We have to defer this insertion since the object lists could still have other players
-					// in their predictive locations etc. - we need to reconstruct everything exactly as it
-					// was when we entered predictive mode.
-					deferred_add_object_to_polygon_object_list(sSavedPlayerMonsterData[i].object_index, sSavedPlayerObjectNextObject[i]);
-					
-					if(sSavedPlayerObjectData[i].parasitic_object != NONE)
-						*get_object_data(sSavedPlayerObjectData[i].parasitic_object) = sSavedPlayerParasiticObjectData[i];
-				}
-			}
+			saved_interface_flags[i] = get_player_data(i)->interface_flags;
+			saved_interface_decay[i] = get_player_data(i)->interface_decay;
 		}
 
-		perform_deferred_polygon_object_list_manipulations();
-		
-		sPredictedTicks = 0;
-
 		// Sanity checking
 		if(sSavedTickCount != dynamic_world->tick_count)
 			logWarning("saved tick count %d != dynamic_world->tick_count %d", sSavedTickCount, dynamic_world->tick_count);
 
-		if(sSavedRandomSeed != get_random_seed())
-			logWarning("saved random seed %d != get_random_seed() %d", sSavedRandomSeed, get_random_seed());
+		// Objects, monsters, the polygons' object lists and the random seed all go back
+		// together, so whatever prediction touched is exactly as it was.
+		restore_world_snapshot();
+
+		for(short i = 0; i < dynamic_world->player_count; i++)
+		{
+			get_player_data(i)->interface_flags = saved_interface_flags[i];
+			get_player_data(i)->interface_decay = saved_interface_decay[i];
+		}
+
+		sPredictedTicks = 0;
 	}
 }
 
@@ -345,34 +317,28 @@ exit_predictive_mode()
 static bool
 overlay_queue_with_queue_into_queue(ActionQueues* inBaseQueues, ActionQueues* inOverlayQueues, ActionQueues* inOutputQueues)
 {
-        bool haveFlagsForAllPlayers = true;
-        for(int p = 0; p < dynamic_world->player_count; p++)
-        {
-                if(inBaseQueues->countActionFlags(p) <= 0)
-                {
-                        haveFlagsForAllPlayers = false;
-                        break;
-                }
-        }
-        
-        if(!haveFlagsForAllPlayers)
+        if(inBaseQueues->countTicks(dynamic_world->player_count) <= 0)
         {
                 return false;
         }
         
-        for(int p = 0; p < dynamic_world->player_count; p++)
+        // Trust me, this is right - we dequeue from the Base Queues whether or not they get overridden.
+        uint32 action_flags[MAXIMUM_NUMBER_OF_PLAYERS];
+        inBaseQueues->dequeueTick(dynamic_world->player_count, action_flags);
+        
+        if(inOverlayQueues != NULL)
         {
-                // Trust me, this is right - we dequeue from the Base Queues whether or not they get overridden.
-                uint32 action_flags = inBaseQueues->dequeueActionFlags(p);
-                
-                if(inOverlayQueues != NULL && inOverlayQueues->countActionFlags(p) > 0)
+                for(int p = 0; p < dynamic_world->player_count; p++)
                 {
-                        action_flags = inOverlayQueues->dequeueActionFlags(p);
+                        if(inOverlayQueues->countActionFlags(p) > 0)
+                        {
+                                action_flags[p] = inOverlayQueues->dequeueActionFlags(p);
+                        }
                 }
-                
-                inOutputQueues->enqueueActionFlags(p, &action_flags, 1);
         }
         
+        inOutputQueues->enqueueTick(dynamic_world->player_count, action_flags);
+        
         return true;
 }
 
@@ -384,41 +350,84 @@ enum {
         kUpdateChangeLevel
 };
 
+// What only the local player sees or hears; none of it feeds back into the world
+static void
+update_world_presentation()
+{
+	TRACE_SPAN("presentation");
+	handle_random_sound_image();
+	AnimTxtr_Update();
+	ChaseCam_Update();
+	motion_sensor_scan();
+}
+
+// Timedemos time each part of the tick; returns the new mark, or 0 when not timing
+static uint64_t
+mark_timedemo_subsystem(int subsystem, uint64_t mark)
+{
+	if (!mark)
+		return 0;
+
+	uint64_t now = SDL_GetPerformanceCounter();
+	record_timedemo_subsystem(subsystem, now - mark);
+	return now;
+}
+
 // ZZZ: split out from update_world()'s loop.
 static int
 update_world_elements_one_tick()
 {
+	TRACE_SPAN("tick");
+	uint64_t theMark = timedemo_active() ? SDL_GetPerformanceCounter() : 0;
+
 	if (m1_solo_player_in_terminal()) 
 	{
 		update_m1_solo_player_in_terminal(GameQueue);
 	} 
 	else
 	{
-		L_Call_Idle();
+		/* the world may have changed since the last tick (or since prediction) in ways that
+			the path cache knows nothing about */
+		invalidate_path_cache();
+		{ TRACE_SPAN("lua idle"); L_Call_Idle(); }
+		theMark = mark_timedemo_subsystem(_timedemo_lua, theMark);
 		
-		update_lights();
-		update_medias();
-		update_platforms();
+		/* the phases stay in this order on this thread: lights take global_random()s
+			and medias take their heights from light intensities, platforms and panels
+			act on lights and each other, and scenery and items animate through the
+			objects, which can randomize their sequences; each is one span in a trace,
+			so the ones that are the length of a tick show up one after another */
+		{ TRACE_SPAN("lights"); update_lights(); }
+		{ TRACE_SPAN("medias"); update_medias(); }
+		{ TRACE_SPAN("platforms"); update_platforms(); }
 		
-		update_control_panels(); // don't put after update_players
-		update_players(GameQueue, false);
-		move_projectiles();
-		move_monsters();
-		update_effects();
+		{ TRACE_SPAN("control panels"); update_control_panels(); } // don't put after update_players
+		theMark = mark_timedemo_subsystem(_timedemo_map, theMark);
+		{ TRACE_SPAN("players"); update_players(GameQueue, false); }
+		theMark = mark_timedemo_subsystem(_timedemo_players, theMark);
+		{ TRACE_SPAN("projectiles"); move_projectiles(); }
+		theMark = mark_timedemo_subsystem(_timedemo_projectiles, theMark);
+		invalidate_path_cache();
+		{ TRACE_SPAN("monsters"); move_monsters(); }
+		theMark = mark_timedemo_subsystem(_timedemo_monsters, theMark);
+		{ TRACE_SPAN("effects"); update_effects(); }
 		recreate_objects();
 		
-		handle_random_sound_image();
-		animate_scenery();
+		{ TRACE_SPAN("scenery"); animate_scenery(); }
 		
 		// LP additions:
 		if (film_profile.animate_items)
 		{
+			TRACE_SPAN("items");
 			animate_items();
 		}
+		theMark = mark_timedemo_subsystem(_timedemo_objects, theMark);
 		
-		AnimTxtr_Update();
-		ChaseCam_Update();
-		motion_sensor_scan();
+		if (sCatchingUp)
+			sPresentationDeferred = true;
+		else
+			update_world_presentation();
+		theMark = mark_timedemo_subsystem(_timedemo_presentation, theMark);
 		check_m1_exploration();
 		
 #if !defined(DISABLE_NETWORKING)
@@ -445,6 +454,28 @@ update_world_elements_one_tick()
         return kUpdateNormalCompletion;
 }
 
+static void
+report_world_checksums()
+{
+	if (dynamic_world->tick_count % kWorldChecksumPeriod != 0)
+		return;
+
+	uint32 checksums[NUMBER_OF_WORLD_CHECKSUMS];
+#if !defined(DISABLE_NETWORKING)
+	if (game_is_networked)
+	{
+		compute_world_checksums(checksums);
+		NetReportWorldChecksums(dynamic_world->tick_count, checksums, NUMBER_OF_WORLD_CHECKSUMS);
+	}
+	else
+#endif
+	if (timedemo_active())
+	{
+		compute_world_checksums(checksums);
+		record_timedemo_world_checksums(checksums, NUMBER_OF_WORLD_CHECKSUMS);
+	}
+}
+
 // ZZZ: new formulation of update_world(), should be simpler and clearer I hope.
 // Now returns (whether something changed, number of real ticks elapsed) since, with
 // prediction, something can change even if no real ticks have elapsed.
@@ -452,6 +483,7 @@ update_world_elements_one_tick()
 std::pair<bool, int16>
 update_world()
 {
+	TRACE_SPAN("update_world");
         short theElapsedTime = 0;
         bool canUpdate = true;
         int theUpdateResult = kUpdateNormalCompletion;
@@ -483,7 +515,15 @@ update_world()
 			{
 				canUpdate = false;
 			}
+
+			sCatchingUp = canUpdate && dynamic_world->tick_count + 1 < theMostRecentAllowedTick;
 		}
+		else
+			sCatchingUp = true;
+
+		// ...and only if there are flags for another tick, and we'd go on to it
+		sCatchingUp = sCatchingUp && GetRealActionQueues()->countActionFlags(0) > 0
+			&& !Movie::instance()->IsRecording() && !timedemo_active();
                 
                 // If we can't update, we can't update.  We're done for now.
                 if(!canUpdate)
@@ -498,18 +538,39 @@ update_world()
 		for(short i = 0; i < dynamic_world->player_count; i++)
 			sMostRecentFlagsForPlayer[i] = GameQueue->peekActionFlags(i, 0);
 
-		theUpdateResult = update_world_elements_one_tick();
+		if (timedemo_active())
+		{
+			uint64_t theTickStart = SDL_GetPerformanceCounter();
+			theUpdateResult = update_world_elements_one_tick();
+			record_timedemo_tick((SDL_GetPerformanceCounter() - theTickStart) * 1000.0 / SDL_GetPerformanceFrequency());
+		}
+		else
+			theUpdateResult = update_world_elements_one_tick();
+
+		if (theUpdateResult == kUpdateNormalCompletion)
+			report_world_checksums();
 
                 theElapsedTime++;
 
                 
+		uint64_t thePostIdleStart = timedemo_active() ? SDL_GetPerformanceCounter() : 0;
                 L_Call_PostIdle();
-                if(theUpdateResult != kUpdateNormalCompletion || Movie::instance()->IsRecording())
+		mark_timedemo_subsystem(_timedemo_lua, thePostIdleStart);
+                if(theUpdateResult != kUpdateNormalCompletion || Movie::instance()->IsRecording() || (timedemo_active() && !timedemo_headless()))
                 {
                         canUpdate = false;
                 }
 	}
 
+	sCatchingUp = false;
+	if(sPresentationDeferred)
+	{
+		// a level change has already replaced the world these were for
+		if(theUpdateResult != kUpdateChangeLevel)
+			update_world_presentation();
+		sPresentationDeferred = false;
+	}
+
         // This and the following voodoo comes, effectively, from Bungie's code.
         if(theUpdateResult == kUpdateChangeLevel)
         {
@@ -550,11 +611,12 @@ update_world()
 			enter_predictive_mode();
 
 			// Enqueue stuff into thePredictiveQueues
+			uint32 theFlags[MAXIMUM_NUMBER_OF_PLAYERS];
 			for(short thePlayerIndex = 0; thePlayerIndex < dynamic_world->player_count; thePlayerIndex++)
 			{
-				uint32 theFlags = (thePlayerIndex == local_player_index) ? NetGetUnconfirmedActionFlag(sPredictedTicks) : sMostRecentFlagsForPlayer[thePlayerIndex];
-				thePredictiveQueues.enqueueActionFlags(thePlayerIndex, &theFlags, 1);
+				theFlags[thePlayerIndex] = (thePlayerIndex == local_player_index) ? NetGetUnconfirmedActionFlag(sPredictedTicks) : sMostRecentFlagsForPlayer[thePlayerIndex];
 			}
+			thePredictiveQueues.enqueueTick(dynamic_world->player_count, theFlags);
 			
 			// update_players() will dequeue the elements we just put in there
 			update_players(&thePredictiveQueues, true);
@@ -574,7 +636,9 @@ update_world()
 void leaving_map(
 	void)
 {
+	MemoryAccounting::LevelEnded(static_world->level_name);
 	
+	discard_world_snapshot();
 	remove_all_projectiles();
 	remove_all_nonpersistent_effects();
 	
@@ -620,10 +684,17 @@ void leaving_map(
 	player->location and player->facing have been updated, and as close to the end of
 	the loading process in general as possible. */
 // LP: added whether a savegame is being restored (skip Pfhortran init if that's the case)
-bool entering_map(bool restoring_saved)
+// and whether it is on the level that was loaded already (so what's in memory can stay)
+bool entering_map(bool restoring_saved, bool same_level)
 {
 	bool success= true;
 
+	/* the lists were just loaded (or unpacked from a saved game) */
+	rebuild_object_slot_index();
+	rebuild_monster_slot_index();
+	rebuild_projectile_slot_index();
+	rebuild_effect_slot_index();
+
 	/* if any active monsters think they have paths, we'll make them reconsider */
 	initialize_monsters_for_new_level();
 
@@ -639,7 +710,7 @@ bool entering_map(bool restoring_saved)
 	MarkLuaCollections(true);
 	MarkLuaHUDCollections(true);
 
-	load_collections(true, get_screen_mode()->acceleration != _no_acceleration);
+	load_collections(true, get_screen_mode()->acceleration != _no_acceleration, same_level);
 
 	load_all_monster_sounds();
 	load_all_game_sounds(static_world->environment_code);
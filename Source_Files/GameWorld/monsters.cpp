@@ -89,6 +89,11 @@ Oct 26, 2000 (Mark Levin)
 
 Jan 12, 2003 (Loren Petrich)
 	Added controllable damage kicks
+
+Oct 14, 2026:
+	activate_nearby_monsters() reuses the flood of an earlier request from the same polygon until
+	the map changes (see get_map_cache_epoch())
+	move_monsters() skips free slots with a used slot index (used_slot_index.h)
 */
 
 #include <string.h>
@@ -114,6 +119,7 @@ Jan 12, 2003 (Loren Petrich)
 #include "lua_script.h"
 #include "Logging.h"
 #include "InfoTree.h"
+#include "used_slot_index.h"
 
 
 /*
@@ -240,6 +246,13 @@ struct damage_kick_definition damage_kick_definitions[NUMBER_OF_DAMAGE_TYPES] =
 // LP addition: growable list of intersected objects
 static vector<short> IntersectedObjects;
 
+static UsedSlotIndex MonsterSlots;
+
+// MML: monsters farther than this from every player think only every so many ticks,
+// staggered by index; they keep moving along their paths in between
+static int16 monster_ai_stride = 0;
+static world_distance monster_ai_stride_distance = 16*WORLD_ONE;
+
 /* ---------- private prototypes */
 
 static monster_definition *get_monster_definition(
@@ -254,7 +267,8 @@ void change_monster_target(short monster_index, short target_index);
 static bool switch_target_check(short monster_index, short attacker_index, short delta_vitality);
 static bool clear_line_of_sight(short viewer_index, short target_index, bool full_circle);
 
-static void handle_moving_or_stationary_monster(short monster_index);
+static void handle_moving_or_stationary_monster(short monster_index, bool thinks);
+static bool monster_thinks_this_tick(short monster_index, struct object_data *object);
 static void execute_monster_attack(short monster_index);
 static void kill_monster(short monster_index);
 static bool translate_monster(short monster_index, world_distance distance);
@@ -421,6 +435,7 @@ short new_monster(
 					monster->sound_polygon_index= object->polygon;
 					monster->sound_location= object->location;
 					MARK_SLOT_AS_USED(monster);
+					MonsterSlots.mark_used(monster_index);
 					
 					/* initialize the monsters object */
 					if (definition->flags&_monster_is_invisible) object->transfer_mode= _xfer_invisibility;
@@ -431,6 +446,7 @@ short new_monster(
 					SET_OBJECT_OWNER(object, _object_is_monster);
 					object->permutation= monster_index;
 					object->sound_pitch= definition->sound_pitch;
+					invalidate_path_cache(true);
 
 					/* make sure the object frequency stuff keeps track of how many monsters are
 						on the map */
@@ -467,8 +483,10 @@ void move_monsters(
 	bool monster_built_path= (dynamic_world->tick_count&3) ? true : false;
 	short monster_index;
 
-	for (monster_index= 0, monster= monsters; monster_index<MAXIMUM_MONSTERS_PER_MAP; ++monster_index, ++monster)
+	for (monster_index= MonsterSlots.next_used(MonsterList, 0); monster_index<MAXIMUM_MONSTERS_PER_MAP;
+		monster_index= MonsterSlots.next_used(MonsterList, monster_index+1))
 	{
+		monster= monsters+monster_index;
 		if (SLOT_IS_USED(monster) && !MONSTER_IS_PLAYER(monster))
 		{
 			struct object_data *object= get_object_data(monster->object_index);
@@ -497,9 +515,10 @@ void move_monsters(
 						animate_object(monster->object_index);
 					}
 					animation_flags= GET_OBJECT_ANIMATION_FLAGS(object);
+					bool thinks= monster_thinks_this_tick(monster_index, object);
 		
 					/* give this monster time, if we can and he needs it */
-					if (!monster_got_time && monster_index>dynamic_world->last_monster_index_to_get_time && !MONSTER_IS_DYING(monster))
+					if (thinks && !monster_got_time && monster_index>dynamic_world->last_monster_index_to_get_time && !MONSTER_IS_DYING(monster))
 					{
 						switch (monster->mode)
 						{
@@ -529,7 +548,7 @@ void move_monsters(
 					/* if this monster needs a path, generate one (unless weve already generated a
 						path this frame in which case well wait until next frame, UNLESS the monster
 						has no path in which case it needs one regardless) */
-					if (MONSTER_NEEDS_PATH(monster) && !MONSTER_IS_DYING(monster) && !MONSTER_IS_ATTACKING(monster) &&
+					if (thinks && MONSTER_NEEDS_PATH(monster) && !MONSTER_IS_DYING(monster) && !MONSTER_IS_ATTACKING(monster) &&
 						((!monster_built_path && monster_index>dynamic_world->last_monster_index_to_build_path) || monster->path==NONE))
 					{
 						generate_new_path_for_monster(monster_index);
@@ -551,7 +570,7 @@ void move_monsters(
 							case _monster_is_waiting_to_attack_again:
 							case _monster_is_stationary:
 							case _monster_is_moving:
-								handle_moving_or_stationary_monster(monster_index);
+								handle_moving_or_stationary_monster(monster_index, thinks);
 								break;
 							
 							case _monster_is_attacking_close:
@@ -639,7 +658,8 @@ void move_monsters(
 			else
 			{
 				/* all inactive monsters get time to scan for targets */
-				if (!monster_got_time && !MONSTER_IS_BLIND(monster) && monster_index>dynamic_world->last_monster_index_to_get_time)
+				if (!monster_got_time && !MONSTER_IS_BLIND(monster) && monster_index>dynamic_world->last_monster_index_to_get_time &&
+					monster_thinks_this_tick(monster_index, object))
 				{
 					change_monster_target(monster_index, find_closest_appropriate_target(monster_index, false));
 					if (MONSTER_HAS_VALID_TARGET(monster)) activate_nearby_monsters(monster->target_index, monster_index, _pass_one_zone_border, MONSTER_ALERT_ACTIVATION_RANGE);
@@ -760,6 +780,12 @@ void initialize_monsters_for_new_level(
 	}
 }
 
+void rebuild_monster_slot_index(
+	void)
+{
+	MonsterSlots.rebuild(MonsterList);
+}
+
 static void load_sound(short sound_index)
 {
 	SoundManager::instance()->LoadSound(sound_index);
@@ -800,9 +826,67 @@ void mark_monster_collections(
 
 enum
 {
-	MAXIMUM_NEED_TARGET_INDEXES= 32
+	MAXIMUM_NEED_TARGET_INDEXES= 32,
+	MAXIMUM_CACHED_ACTIVATION_FLOODS= 4
 };
 
+/* the polygons an activation flood reached, in order, and its flags as it reached each one */
+struct activation_flood
+{
+	uint32 epoch; /* only valid if this matches get_map_cache_epoch() */
+
+	short polygon_index;
+	int32 flags;
+	int32 max_cost;
+
+	vector<short> polygon_indexes;
+	vector<int32> polygon_flags;
+};
+
+static struct activation_flood activation_floods[MAXIMUM_CACHED_ACTIVATION_FLOODS];
+static short next_activation_flood_index= 0;
+
+/* monster_activation_flood_proc() only looks at the map, so requests from the same polygon with
+	the same flags and range can share a flood until the map changes */
+static struct activation_flood *get_activation_flood(
+	short polygon_index,
+	int32 flags,
+	int32 max_cost)
+{
+	uint32 epoch= get_map_cache_epoch();
+	struct activation_flood *flood;
+	short flood_index;
+
+	for (flood_index= 0, flood= activation_floods; flood_index<MAXIMUM_CACHED_ACTIVATION_FLOODS; ++flood_index, ++flood)
+	{
+		if (flood->epoch==epoch && flood->polygon_index==polygon_index && flood->flags==flags && flood->max_cost==max_cost)
+		{
+			return flood;
+		}
+	}
+
+	flood= activation_floods + next_activation_flood_index;
+	next_activation_flood_index= (next_activation_flood_index+1)%MAXIMUM_CACHED_ACTIVATION_FLOODS;
+
+	flood->epoch= epoch;
+	flood->polygon_index= polygon_index;
+	flood->flags= flags;
+	flood->max_cost= max_cost;
+	flood->polygon_indexes.clear();
+	flood->polygon_flags.clear();
+
+	int32 flood_flags= flags;
+	polygon_index= flood_map(polygon_index, max_cost, monster_activation_flood_proc, _flagged_breadth_first, &flood_flags);
+	while (polygon_index!=NONE)
+	{
+		flood->polygon_indexes.push_back(polygon_index);
+		flood->polygon_flags.push_back(flood_flags);
+		polygon_index= flood_map(NONE, max_cost, monster_activation_flood_proc, _flagged_breadth_first, &flood_flags);
+	}
+
+	return flood;
+}
+
 void activate_nearby_monsters(
 	short target_index, /* activate with lock on this target (or NONE for lock-less activation) */
 	short caller_index, /* start the flood from here */
@@ -822,16 +906,17 @@ void activate_nearby_monsters(
 	if (dynamic_world->tick_count-caller->ticks_since_last_activation>MINIMUM_ACTIVATION_SEPARATION ||
 		(flags&_activation_cannot_be_avoided))
 	{
-		short polygon_index= get_object_data(caller->object_index)->polygon;
+		struct activation_flood *flood= get_activation_flood(get_object_data(caller->object_index)->polygon, flags, max_cost);
 		short need_target_indexes[MAXIMUM_NEED_TARGET_INDEXES];
 		short need_target_count= 0;
-		int32 flood_flags= flags;
+		size_t flood_index;
 		
 		/* flood out from the target monsters polygon, searching through the object lists of all
 			polygons we encounter */
-		polygon_index= flood_map(polygon_index, max_cost, monster_activation_flood_proc, _flagged_breadth_first, &flood_flags);
-		while (polygon_index!=NONE)
+		for (flood_index= 0; flood_index<flood->polygon_indexes.size(); ++flood_index)
 		{
+			short polygon_index= flood->polygon_indexes[flood_index];
+			int32 flood_flags= flood->polygon_flags[flood_index];
 			short object_index;
 			struct object_data *object;
 	
@@ -903,8 +988,6 @@ void activate_nearby_monsters(
 					}
 				}
 			}
-			
-			polygon_index= flood_map(NONE, max_cost, monster_activation_flood_proc, _flagged_breadth_first, &flood_flags);
 		}
 
 		// deferred find_closest_appropriate_target() calls
@@ -995,8 +1078,10 @@ bool live_aliens_on_map(
 	short threshhold= LIVE_ALIEN_THRESHHOLD;
 	short monster_index;
 	
-	for (monster_index= 0, monster= monsters; monster_index<MAXIMUM_MONSTERS_PER_MAP; ++monster_index, ++monster)
+	for (monster_index= MonsterSlots.next_used(MonsterList, 0); monster_index<MAXIMUM_MONSTERS_PER_MAP;
+		monster_index= MonsterSlots.next_used(MonsterList, monster_index+1))
 	{
+		monster= monsters+monster_index;
 		if (SLOT_IS_USED(monster))
 		{
 			struct monster_definition *definition= get_monster_definition(monster->type);
@@ -1155,11 +1240,27 @@ bool possible_intersecting_monsters(
 	// Skip this step if neighbor indexes were not found
 	if (!neighbor_indexes) return found_solid_object;
 
+	/* objects already in the list (callers may accumulate over several polygons) are marked
+		with this call's stamp, so checking for duplicates is constant time */
+	static vector<uint32> object_stamps;
+	static uint32 current_stamp= 0;
+	if (IntersectedObjectsPtr)
+	{
+		if (object_stamps.size()<static_cast<size_t>(MAXIMUM_OBJECTS_PER_MAP)) object_stamps.resize(MAXIMUM_OBJECTS_PER_MAP, 0);
+		if (++current_stamp==0)
+		{
+			std::fill(object_stamps.begin(), object_stamps.end(), 0);
+			current_stamp= 1;
+		}
+		for (unsigned j=0; j<IntersectedObjectsPtr->size(); ++j) object_stamps[(*IntersectedObjectsPtr)[j]]= current_stamp;
+	}
+
 	for (short i=0;i<polygon->neighbor_count;++i)
 	{
-		struct polygon_data *neighboring_polygon= get_polygon_data(*neighbor_indexes++);
+		short neighbor_index= *neighbor_indexes++;
+		struct polygon_data *neighboring_polygon= get_polygon_data(neighbor_index);
 		
-		if (!POLYGON_IS_DETACHED(neighboring_polygon))
+		if (!POLYGON_IS_DETACHED(neighboring_polygon) && polygon_may_contain_monsters(neighbor_index, include_scenery))
 		{
 			short object_index= neighboring_polygon->first_object;
 			
@@ -1196,14 +1297,12 @@ bool possible_intersecting_monsters(
 						// LP change:
 						if (IntersectedObjectsPtr && IntersectedObjectsPtr->size()<maximum_object_count) /* do we have enough space to add it? */
 						{
-							unsigned j;
-							
 							/* only add this object_index if it's not already in the list */
-							vector<short>& IntersectedObjects = *IntersectedObjectsPtr;
-							for (j=0; j<IntersectedObjects.size() && IntersectedObjects[j]!=object_index; ++j)
-								;
-							if (j==IntersectedObjects.size())
-								IntersectedObjects.push_back(object_index);
+							if (object_stamps[object_index]!=current_stamp)
+							{
+								object_stamps[object_index]= current_stamp;
+								IntersectedObjectsPtr->push_back(object_index);
+							}
 						}
 					}
 				}
@@ -2141,8 +2240,11 @@ static void generate_new_path_for_monster(
 	data.monster= monster;
 	data.cross_zone_boundaries= destination_polygon_index==NONE ? false : true;
 
+	/* monster_pathfinding_cost_function() only looks at the definition and cross_zone_boundaries,
+		so monsters of the same type chasing the same polygon can share a flood */
 	monster->path= new_path((world_point2d *)&object->location, object->polygon, destination,
-		destination_polygon_index, 3*definition->radius, monster_pathfinding_cost_function, &data);
+		destination_polygon_index, 3*definition->radius, monster_pathfinding_cost_function, &data,
+		(monster->type<<1) | (data.cross_zone_boundaries ? 1 : 0));
 	if (monster->path==NONE)
 	{
 		if (monster->action!=_monster_is_being_hit || MONSTER_IS_DYING(monster)) set_monster_action(monster_index, _monster_is_stationary);
@@ -2280,7 +2382,8 @@ short find_closest_appropriate_target(
 			struct object_data *object;
 	
 			/* loop through all objects in this polygon looking for hostile monsters we can see */
-			for (object_index= get_polygon_data(polygon_index)->first_object; object_index!=NONE; object_index= object->next_object)
+			object_index= polygon_may_contain_monsters(polygon_index, false) ? get_polygon_data(polygon_index)->first_object : NONE;
+			for (; object_index!=NONE; object_index= object->next_object)
 			{
 				object= get_object_data(object_index);
 				if (GET_OBJECT_OWNER(object)==_object_is_monster && OBJECT_IS_VISIBLE(object))
@@ -2384,8 +2487,19 @@ static bool clear_line_of_sight(
 			}
 		}
 
-		/* make sure there are no non-transparent lines between the viewer and the target */
-		if (target_visible)
+		/* make sure there are no non-transparent lines between the viewer and the target; this
+			only depends on the line flags, so polygons which can't reach each other through
+			transparent lines are rejected immediately and walks we've already done are reused */
+		if (target_visible && !polygons_may_see_each_other(viewer_object->polygon, target_object->polygon))
+		{
+			target_visible= false;
+		}
+		else if (target_visible && find_line_of_sight_memo(_line_of_sight_through_transparent_lines,
+			viewer_object->polygon, (world_point2d *)origin, target_object->polygon, (world_point2d *)destination, &target_visible))
+		{
+			/* target_visible is now whatever the last identical walk found */
+		}
+		else if (target_visible)
 		{
 			short polygon_index= viewer_object->polygon;
 			short line_index;
@@ -2416,6 +2530,9 @@ static bool clear_line_of_sight(
 				}
 			}
 			while (target_visible&&line_index!=NONE);
+			
+			remember_line_of_sight(_line_of_sight_through_transparent_lines, viewer_object->polygon,
+				(world_point2d *)origin, target_object->polygon, (world_point2d *)destination, target_visible);
 		}
 	}
 	
@@ -2471,8 +2588,31 @@ void change_monster_target(
 	}
 }
 
+// Whether a monster looks for targets, asks for a path and tries to attack this tick
+static bool monster_thinks_this_tick(
+	short monster_index,
+	struct object_data *object)
+{
+	if (!film_profile.monster_ai_stride || monster_ai_stride <= 1) return true;
+	if ((dynamic_world->tick_count + monster_index) % monster_ai_stride == 0) return true;
+	
+	for (short player_index= 0; player_index<dynamic_world->player_count; ++player_index)
+	{
+		struct player_data *player= get_player_data(player_index);
+		
+		if (!PLAYER_IS_TOTALLY_DEAD(player) &&
+			guess_distance2d((world_point2d *) &object->location, (world_point2d *) &player->location) < monster_ai_stride_distance)
+		{
+			return true;
+		}
+	}
+	
+	return false;
+}
+
 static void handle_moving_or_stationary_monster(
-	short monster_index)
+	short monster_index,
+	bool thinks)
 {
 	struct monster_data *monster= get_monster_data(monster_index);
 	struct object_data *object= get_object_data(monster->object_index);
@@ -2521,7 +2661,7 @@ static void handle_moving_or_stationary_monster(
 	
 		/* whether we moved or not, see if we can attack if we have lock */
 		monster->ticks_since_attack+= MONSTER_IS_BERSERK(monster) ? 3 : 1;
-		if (OBJECT_WAS_ANIMATED(object) && monster->mode==_monster_locked)
+		if (thinks && OBJECT_WAS_ANIMATED(object) && monster->mode==_monster_locked)
 		{
 			short attack_frequency= definition->attack_frequency;
 			
@@ -2605,7 +2745,7 @@ void set_monster_action(
 			else if (film_profile.key_frame_zero_shrapnel_fix)
 			{
 				object_data* object = get_object_data(monster->object_index);
-				shape_animation_data* animation = get_shape_animation_data(object->shape);
+				shape_animation_data* animation = get_object_animation_data(object);
 				if (animation && animation->key_frame == 0)
 				{
 					cause_shrapnel_damage(monster_index);
@@ -3927,7 +4067,7 @@ void parse_mml_damage_kicks(const InfoTree& root)
 			original_damage_kick_definitions[i] = damage_kick_definitions[i];
 	}
 	
-	BOOST_FOREACH(InfoTree kick, root.children_named("kick"))
+	BOOST_FOREACH(const InfoTree &kick, root.children_named("kick"))
 	{
 		int16 index;
 		if (!kick.read_indexed("index", index, NUMBER_OF_DAMAGE_TYPES))
@@ -3945,11 +4085,13 @@ void reset_mml_monsters()
 {
 	monster_must_be_exterminated.clear();
 	monster_must_be_exterminated.resize(NUMBER_OF_MONSTER_TYPES, false);
+	monster_ai_stride = 0;
+	monster_ai_stride_distance = 16*WORLD_ONE;
 }
 
 void parse_mml_monsters(const InfoTree& root)
 {
-	BOOST_FOREACH(InfoTree monster, root.children_named("monster"))
+	BOOST_FOREACH(const InfoTree &monster, root.children_named("monster"))
 	{
 		int16 index;
 		if (!monster.read_indexed("index", index, NUMBER_OF_MONSTER_TYPES))
@@ -3958,4 +4100,10 @@ void parse_mml_monsters(const InfoTree& root)
 		if (monster.read_attr("must_be_exterminated", exterminate))
 			monster_must_be_exterminated[index] = exterminate;
 	}
+	
+	BOOST_FOREACH(const InfoTree &stride, root.children_named("ai_stride"))
+	{
+		stride.read_attr_bounded<int16>("ticks", monster_ai_stride, 0, TICKS_PER_SECOND);
+		stride.read_wu("distance", monster_ai_stride_distance, 0, 31);
+	}
 }
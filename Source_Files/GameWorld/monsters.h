@@ -271,6 +271,7 @@ extern vector<monster_data> MonsterList;
 
 void initialize_monsters(void);
 void initialize_monsters_for_new_level(void); /* when a map is loaded */
+void rebuild_monster_slot_index(void); /* when MonsterList is cleared or filled wholesale */
 
 void move_monsters(void); /* assumes t==1 tick */
 
@@ -34,6 +34,15 @@ Wednesday, June 14, 1995 8:35:28 AM  (Jason)
 
 Feb 10, 2000 (Loren Petrich):
 	Added dynamic-limits setting of MAXIMUM_PATHS
+
+Oct 14, 2026:
+	non-random paths are now built from a small cache of flood results keyed by (source polygon,
+	destination polygon, cost function, caller key); the cache is emptied whenever anything a
+	cost function could look at changes (see invalidate_path_cache()).  only the polygon sequence
+	is cached, so the midpoints (and the global_random() calls they make) are still generated
+	per path and films stay in sync.
+	invalidate_path_cache(true) says only monsters moved; get_map_cache_epoch() lets other
+	floods (monster activation) be cached across that.
 */
 
 #include <string.h>
@@ -68,6 +77,9 @@ we should cut corners instead of blindly following map geometry (i.e., separate
 
 #define PATH_VALIDATION_AREA_SIZE 64*1024
 
+#define MAXIMUM_CACHED_PATHS 32
+#define MAXIMUM_POLYGONS_PER_CACHED_PATH 256 /* more than flood_map() can ever expand */
+
 /* ---------- structures */
 
 struct path_definition /* 256 bytes */
@@ -79,10 +91,38 @@ struct path_definition /* 256 bytes */
 	world_point2d points[MAXIMUM_POINTS_PER_PATH];
 };
 
+/* the result of flooding from a source polygon: the polygons reverse_flood_map() walked back
+	through (destination first), and the flood_depth() of the last node expanded */
+struct flood_result
+{
+	bool reached_destination;
+	short depth;
+	short polygon_count;
+	
+	short polygon_indexes[MAXIMUM_POLYGONS_PER_CACHED_PATH];
+};
+
+struct cached_path_data
+{
+	uint32 epoch; /* only valid if this matches path_cache_epoch */
+	
+	short source_polygon_index;
+	short destination_polygon_index;
+	cost_proc_ptr cost;
+	int32 cache_key;
+	
+	struct flood_result result;
+};
+
 /* ---------- globals */
 
 static struct path_definition *paths = NULL;
 
+static struct cached_path_data *cached_paths = NULL;
+static short next_cached_path_index= 0;
+static uint32 path_cache_epoch= 1;
+static uint32 map_cache_epoch= 1;
+
 #ifdef VERIFY_PATH_SYNC
 static byte *path_validation_area = NULL;
 static int32 path_validation_area_index;
@@ -94,6 +134,11 @@ static short path_run_count;
 static void calculate_midpoint_of_shared_line(short polygon1, short polygon2,
 	world_distance minimum_separation, world_point2d *midpoint);
 
+static void flood_for_path(short source_polygon_index, short destination_polygon_index,
+	world_point2d *destination_point, cost_proc_ptr cost, void *data, struct flood_result *result);
+static struct cached_path_data *find_cached_path(short source_polygon_index,
+	short destination_polygon_index, cost_proc_ptr cost, int32 cache_key);
+
 /* ---------- code */
 
 void allocate_pathfinding_memory(
@@ -104,6 +149,10 @@ void allocate_pathfinding_memory(
 	paths= new path_definition[MAXIMUM_PATHS];
 	assert(paths);
 
+	if (!cached_paths) cached_paths= new cached_path_data[MAXIMUM_CACHED_PATHS];
+	assert(cached_paths);
+	invalidate_path_cache();
+
 #ifdef VERIFY_PATH_SYNC
 	if (path_validation_area) delete []path_validation_area;
 	path_validation_area= new byte[PATH_VALIDATION_AREA_SIZE];
@@ -118,6 +167,7 @@ void reset_paths(
 	short path_index;
 
 	for (path_index=0;path_index<MAXIMUM_PATHS;++path_index) paths[path_index].step_count= NONE;
+	invalidate_path_cache();
 
 #ifdef VERIFY_PATH_SYNC
 	path_run_count+= 1;
@@ -132,7 +182,8 @@ short new_path(
 	short destination_polygon_index,
 	world_distance minimum_separation,
 	cost_proc_ptr cost,
-	void *data)
+	void *data,
+	int32 cache_key)
 {
 	short path_index;
 
@@ -167,44 +218,43 @@ short new_path(
 	
 	if (path_index!=NONE)
 	{
+		struct flood_result uncached_result;
+		struct flood_result *result;
 		bool reached_destination;
 		short polygon_index;
 		short step_count;
 		short depth;
 
-		if (destination_polygon_index!=NONE)
+		if (destination_polygon_index!=NONE && cache_key!=NONE)
 		{
-			/* NON-RANDOM PATH: we have a valid destination point: flood out from the source_polygon_index
-				until we reach destination_polygon_index or we run out of stack space */
+			/* NON-RANDOM PATH: the flood only depends on the cost function and the state of the
+				world, so if nothing has changed since somebody else flooded between these two
+				polygons with the same cost function we can reuse their polygon list */
+			struct cached_path_data *cached_path= find_cached_path(source_polygon_index, destination_polygon_index, cost, cache_key);
 			
-			polygon_index= flood_map(source_polygon_index, INT32_MAX, cost, _breadth_first, data);
-			while (polygon_index!=NONE&&polygon_index!=destination_polygon_index)
+			if (!cached_path)
 			{
-				polygon_index= flood_map(NONE, INT32_MAX, cost, _breadth_first, data);
+				cached_path= cached_paths + next_cached_path_index;
+				next_cached_path_index= (next_cached_path_index+1)%MAXIMUM_CACHED_PATHS;
+				
+				flood_for_path(source_polygon_index, destination_polygon_index, destination_point, cost, data, &cached_path->result);
+				cached_path->epoch= path_cache_epoch;
+				cached_path->source_polygon_index= source_polygon_index;
+				cached_path->destination_polygon_index= destination_polygon_index;
+				cached_path->cost= cost;
+				cached_path->cache_key= cache_key;
 			}
-
-			/* if we reached destination_polygon_index, extract the path by calling
-				reverse_flood_map().  remember to add the destination to the end of the path */
-			reached_destination= polygon_index==destination_polygon_index ? true : false;
+			
+			result= &cached_path->result;
 		}
 		else
 		{
-			/* RANDOM PATH: our destination point is invalid (the caller wants a random path); flood
-				out from the source polygon until we run out of stack space or we reach a cost
-				of RANDOM_PATH_AREA, whichever comes first.  in fact, our destination_point, if
-				not NULL, is a 2d vector specifying a bias in the direction we want to travel
-				(usually this will be away from somewhere we dont want to be) */
-			polygon_index= flood_map(source_polygon_index, INT32_MAX, cost, _breadth_first, data);
-			while (polygon_index!=NONE)
-			{
-				polygon_index= flood_map(NONE, INT32_MAX, cost, _breadth_first, data);
-			}
-			
-			choose_random_flood_node((world_vector2d *)destination_point); /* choose a random destination */
-			reached_destination= false; /* we didnt even have one */
+			flood_for_path(source_polygon_index, destination_polygon_index, destination_point, cost, data, &uncached_result);
+			result= &uncached_result;
 		}
+		reached_destination= result->reached_destination;
 
-		depth= flood_depth();
+		depth= result->depth;
 		if (reached_destination)
 		{
 			/* a depth of zero yeilds one point (the destination), two and greater 2*depth */
@@ -221,6 +271,7 @@ short new_path(
 		{
 			struct path_definition *path= paths+path_index;
 			short last_polygon_index;
+			short result_index;
 
 //#ifdef DEBUG
 			obj_set(*path, 0x80);
@@ -234,9 +285,11 @@ short new_path(
 			if (reached_destination && --step_count<MAXIMUM_POINTS_PER_PATH) path->points[step_count]= *destination_point;
 			
 			/* add all the points up to but not including the source (if we have room) */
-			last_polygon_index= reverse_flood_map();
-			while ((polygon_index= reverse_flood_map())!=NONE)
+			assert(result->polygon_count>0);
+			last_polygon_index= result->polygon_indexes[0];
+			for (result_index= 1; result_index<result->polygon_count; ++result_index)
 			{
+				polygon_index= result->polygon_indexes[result_index];
 				if (--step_count<MAXIMUM_POINTS_PER_PATH) calculate_midpoint_of_shared_line(last_polygon_index, polygon_index, minimum_separation, path->points+step_count);
 //				if (polygon_index!=source_polygon_index&&--step_count<MAXIMUM_POINTS_PER_PATH) find_center_of_polygon(polygon_index, path->points+step_count);
 				last_polygon_index= polygon_index;
@@ -324,8 +377,101 @@ void delete_path(
 	paths[path_index].step_count= NONE;
 }
 
+/* anything which changes the cost a cost_proc could return for some pair of polygons (monsters
+	changing polygons, platforms changing state, heights or types changing, each new tick) must
+	call this before the next call to new_path(); only_monsters_moved leaves the map epoch alone */
+void invalidate_path_cache(
+	bool only_monsters_moved)
+{
+	path_cache_epoch+= 1;
+	if (!only_monsters_moved) map_cache_epoch+= 1;
+}
+
+uint32 get_map_cache_epoch(
+	void)
+{
+	return map_cache_epoch;
+}
+
 /* ---------- private code */
 
+/* flood out from source_polygon_index until we reach destination_polygon_index (or choose a
+	random destination if destination_polygon_index is NONE), then record the polygons
+	reverse_flood_map() walks back through */
+static void flood_for_path(
+	short source_polygon_index,
+	short destination_polygon_index,
+	world_point2d *destination_point,
+	cost_proc_ptr cost,
+	void *data,
+	struct flood_result *result)
+{
+	short polygon_index;
+
+	if (destination_polygon_index!=NONE)
+	{
+		/* NON-RANDOM PATH: we have a valid destination point: flood out from the source_polygon_index
+			until we reach destination_polygon_index or we run out of stack space */
+		
+		polygon_index= flood_map(source_polygon_index, INT32_MAX, cost, _breadth_first, data);
+		while (polygon_index!=NONE&&polygon_index!=destination_polygon_index)
+		{
+			polygon_index= flood_map(NONE, INT32_MAX, cost, _breadth_first, data);
+		}
+
+		/* if we reached destination_polygon_index, extract the path by calling
+			reverse_flood_map().  remember to add the destination to the end of the path */
+		result->reached_destination= polygon_index==destination_polygon_index ? true : false;
+	}
+	else
+	{
+		/* RANDOM PATH: our destination point is invalid (the caller wants a random path); flood
+			out from the source polygon until we run out of stack space or we reach a cost
+			of RANDOM_PATH_AREA, whichever comes first.  in fact, our destination_point, if
+			not NULL, is a 2d vector specifying a bias in the direction we want to travel
+			(usually this will be away from somewhere we dont want to be) */
+		polygon_index= flood_map(source_polygon_index, INT32_MAX, cost, _breadth_first, data);
+		while (polygon_index!=NONE)
+		{
+			polygon_index= flood_map(NONE, INT32_MAX, cost, _breadth_first, data);
+		}
+		
+		choose_random_flood_node((world_vector2d *)destination_point); /* choose a random destination */
+		result->reached_destination= false; /* we didnt even have one */
+	}
+
+	result->depth= flood_depth();
+	result->polygon_count= 0;
+	while ((polygon_index= reverse_flood_map())!=NONE)
+	{
+		assert(result->polygon_count<MAXIMUM_POLYGONS_PER_CACHED_PATH);
+		result->polygon_indexes[result->polygon_count++]= polygon_index;
+	}
+}
+
+static struct cached_path_data *find_cached_path(
+	short source_polygon_index,
+	short destination_polygon_index,
+	cost_proc_ptr cost,
+	int32 cache_key)
+{
+	struct cached_path_data *cached_path;
+	short i;
+	
+	for (cached_path= cached_paths, i= 0; i<MAXIMUM_CACHED_PATHS; ++i, ++cached_path)
+	{
+		if (cached_path->epoch==path_cache_epoch &&
+			cached_path->source_polygon_index==source_polygon_index &&
+			cached_path->destination_polygon_index==destination_polygon_index &&
+			cached_path->cost==cost && cached_path->cache_key==cache_key)
+		{
+			return cached_path;
+		}
+	}
+	
+	return (struct cached_path_data *) NULL;
+}
+
 static void calculate_midpoint_of_shared_line(
 	short polygon1,
 	short polygon2,
@@ -675,8 +675,6 @@ static bool polygon_is_valid_for_object_drop(
 	bool valid = false;
 	int32 distance; // only used to call point_is_player_visible()
 
-	(void) (initial_drop);
-	
 	switch (polygon->type)
 	{
 		case _polygon_is_item_impassable:
@@ -697,7 +695,8 @@ static bool polygon_is_valid_for_object_drop(
 		default:
 			if (!POLYGON_IS_DETACHED(polygon))
 			{
-				if (!point_is_player_visible(dynamic_world->player_count, polygon_index, location, &distance) || initial_drop)
+				/* look at what's already here first; the sight lines to every player
+					cost far more, and don't matter for an initial drop */
 				{
 					short object_index= polygon->first_object;
 					
@@ -744,6 +743,12 @@ static bool polygon_is_valid_for_object_drop(
 						object_index= object->next_object;
 					}
 				}
+				
+				if (valid && !initial_drop &&
+					point_is_player_visible(dynamic_world->player_count, polygon_index, location, &distance))
+				{
+					valid= false;
+				}
 			}
 	}
 
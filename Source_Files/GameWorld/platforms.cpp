@@ -71,12 +71,17 @@ Jun 30, 2002 (tiennou):
 #include "SoundManager.h"
 #include "player.h"
 #include "media.h"
+#include "flood_map.h"
 #include "InfoTree.h"
 
 // LP addition: XML parser for damage
 #include "items.h"
 #include "Packing.h"
 
+#include <algorithm>
+#include <limits.h>
+#include <vector>
+
 //MH: Lua scripting
 #include "lua_script.h"
 
@@ -112,6 +117,8 @@ static void play_platform_sound(short platform_index, short sound_code);
 
 static platform_definition *get_platform_definition(const short type);
 
+static void invalidate_platform_update_mask(void);
+
 /* ---------- code */
 
 platform_data *get_platform_data(
@@ -151,6 +158,9 @@ short new_platform(
 		platform_index= dynamic_world->platform_count++;
 		platform= platforms+platform_index;
 
+		// the list may be the same one, at the same size, as last level's, with its mask
+		invalidate_platform_update_mask();
+
 		/* remember the platform_index in the polygons .permutation field */
 		polygon->permutation= platform_index;
 		polygon->type= _polygon_is_platform;
@@ -159,6 +169,7 @@ short new_platform(
 		platform->type= data->type;
 		platform->static_flags= data->static_flags;
 		platform->tag= data->tag;
+		platform_tags_changed();
 		platform->speed= data->speed;
 		platform->delay= data->delay;
 		platform->polygon_index= polygon_index;
@@ -249,17 +260,89 @@ struct static_platform_data *get_defaults_for_platform_type(
 	return &definition->defaults;
 }
 
+/* ---------- the platforms update_platforms() has to look at */
+
+// One bit per platform that is active, or was just activated or deactivated
+// and needs that cleared; the rest have nothing to do in a tick
+static std::vector<uint32> platform_update_mask;
+static bool platform_update_mask_valid= false;
+static platform_data *platform_update_mask_platforms= NULL;
+static short platform_update_mask_count= 0;
+
+static void build_platform_update_mask(
+	void)
+{
+	platform_update_mask.assign((dynamic_world->platform_count+31)/32, 0);
+	for (short platform_index= 0; platform_index<dynamic_world->platform_count; ++platform_index)
+	{
+		struct platform_data *platform= platforms+platform_index;
+		if (PLATFORM_IS_ACTIVE(platform) || PLATFORM_WAS_JUST_ACTIVATED_OR_DEACTIVATED(platform))
+			platform_update_mask[platform_index>>5]|= 1u<<(platform_index&31);
+	}
+	
+	platform_update_mask_valid= true;
+	platform_update_mask_platforms= platforms;
+	platform_update_mask_count= dynamic_world->platform_count;
+}
+
+static void invalidate_platform_update_mask(
+	void)
+{
+	platform_update_mask_valid= false;
+}
+
+static void mark_platform_for_update(
+	short platform_index)
+{
+	// if the mask is out of date, it will pick this platform up when rebuilt
+	if (platform_update_mask_valid && size_t(platform_index>>5)<platform_update_mask.size())
+		platform_update_mask[platform_index>>5]|= 1u<<(platform_index&31);
+}
+
+// The first marked platform after the given one, or NONE
+static short next_platform_to_update(
+	short platform_index)
+{
+	short next_index= platform_index+1;
+	size_t word= next_index>>5;
+	
+	if (word>=platform_update_mask.size()) return NONE;
+	uint32 bits= platform_update_mask[word]&(~0u<<(next_index&31));
+	while (!bits)
+	{
+		if (++word>=platform_update_mask.size()) return NONE;
+		bits= platform_update_mask[word];
+	}
+	
+	next_index= short(word<<5);
+	while (!(bits&1)) bits>>= 1, ++next_index;
+	return next_index<dynamic_world->platform_count ? next_index : NONE;
+}
+
 void update_platforms(
 	void)
 {
 	short platform_index;
 	struct platform_data *platform;
 	
-	for (platform_index= 0, platform= platforms; platform_index<dynamic_world->platform_count; ++platform_index, ++platform)
+	if (!platform_update_mask_valid || platform_update_mask_platforms!=platforms ||
+		platform_update_mask_count!=dynamic_world->platform_count)
+	{
+		build_platform_update_mask();
+	}
+	
+	/* in index order, as before; a platform one of these activates further on
+		is marked before we get to it, so it still moves this tick */
+	for (platform_index= next_platform_to_update(NONE); platform_index!=NONE; platform_index= next_platform_to_update(platform_index))
 	{
+		platform= platforms+platform_index;
 		CLEAR_PLATFORM_WAS_JUST_ACTIVATED_OR_DEACTIVATED(platform);
 		
-		if (PLATFORM_IS_ACTIVE(platform))
+		if (!PLATFORM_IS_ACTIVE(platform))
+		{
+			platform_update_mask[platform_index>>5]&= ~(1u<<(platform_index&31));
+		}
+		else
 		{
 			struct polygon_data *polygon= get_polygon_data(platform->polygon_index);
 			short sound_code= NONE;
@@ -643,6 +726,35 @@ bool try_and_change_platform_state(
 	return changed;
 }
 
+// (tag, platform index) for every platform with a tag, in order, built when
+// first needed after the platforms change
+static std::vector<std::pair<short, short> > platform_tag_index;
+static bool platform_tag_index_valid= false;
+static platform_data *platform_tag_index_platforms= NULL;
+static short platform_tag_index_count= 0;
+
+void platform_tags_changed(
+	void)
+{
+	platform_tag_index_valid= false;
+}
+
+static void build_platform_tag_index(
+	void)
+{
+	platform_tag_index.clear();
+	for (short platform_index= 0; platform_index<dynamic_world->platform_count; ++platform_index)
+	{
+		if (platforms[platform_index].tag)
+			platform_tag_index.push_back(std::pair<short, short>(platforms[platform_index].tag, platform_index));
+	}
+	std::sort(platform_tag_index.begin(), platform_tag_index.end());
+	
+	platform_tag_index_valid= true;
+	platform_tag_index_platforms= platforms;
+	platform_tag_index_count= dynamic_world->platform_count;
+}
+
 bool try_and_change_tagged_platform_states(
 	short tag,
 	bool state)
@@ -653,8 +765,22 @@ bool try_and_change_tagged_platform_states(
 	
 	if (tag)
 	{
-		for (platform_index= 0, platform= platforms; platform_index<dynamic_world->platform_count; ++platform_index, ++platform)
+		if (!platform_tag_index_valid || platform_tag_index_platforms!=platforms ||
+			platform_tag_index_count!=dynamic_world->platform_count)
 		{
+			build_platform_tag_index();
+		}
+		
+		// copied, in case a script run by a platform changing adds platforms
+		std::vector<short> tagged_platforms;
+		std::vector<std::pair<short, short> >::const_iterator match= std::lower_bound(platform_tag_index.begin(), platform_tag_index.end(), std::pair<short, short>(tag, SHRT_MIN));
+		for (; match!=platform_tag_index.end() && match->first==tag; ++match)
+			tagged_platforms.push_back(match->second);
+		
+		for (size_t i= 0; i<tagged_platforms.size(); ++i)
+		{
+			platform_index= tagged_platforms[i];
+			platform= platforms+platform_index;
 			if (platform->tag==tag)
 			{
 				if (try_and_change_platform_state(platform_index, state))
@@ -715,6 +841,8 @@ bool set_platform_state(
 				
 				/* the state of this platform cannot be changed again this tick */
 				SET_PLATFORM_WAS_JUST_ACTIVATED_OR_DEACTIVATED(platform);
+				mark_platform_for_update(platform_index);
+				invalidate_path_cache();
 				
 				if (state)
 				{
@@ -879,8 +1007,11 @@ void adjust_platform_endpoint_and_line_heights(
 			/* only worry about transparency and solidity if theres a polygon on the other side */
 			if (LINE_IS_VARIABLE_ELEVATION(line))
 			{
+				uint16 old_flags= line->flags;
+				
 				SET_LINE_TRANSPARENCY(line, line->highest_adjacent_floor<line->lowest_adjacent_ceiling);
 				SET_LINE_SOLIDITY(line, line->highest_adjacent_floor>=line->lowest_adjacent_ceiling);
+				if (line->flags!=old_flags) line_visibility_changed();
 			}
 			
 			/* and only if there is another polygon does this endpoint have a chance of being transparent */
@@ -1188,6 +1319,9 @@ inline void EndpointOwnerToStream(uint8* &S, endpoint_owner_data& Object)
 
 uint8 *unpack_platform_data(uint8 *Stream, platform_data* Objects, size_t Count)
 {
+	platform_tags_changed();
+	platform_update_mask_valid= false;
+
 	uint8* S = Stream;
 	platform_data* ObjPtr = Objects;
 	
@@ -1280,7 +1414,7 @@ void parse_mml_platforms(const InfoTree& root)
 			original_platform_definitions[i] = platform_definitions[i];
 	}
 	
-	BOOST_FOREACH(InfoTree ptree, root.children_named("platform"))
+	BOOST_FOREACH(const InfoTree &ptree, root.children_named("platform"))
 	{
 		int16 index;
 		if (!ptree.read_indexed("index", index, NUMBER_OF_PLATFORM_TYPES))
@@ -1296,7 +1430,7 @@ void parse_mml_platforms(const InfoTree& root)
 		ptree.read_indexed("moving", def.moving_sound, SHRT_MAX+1, true);
 		ptree.read_indexed("item", def.key_item_index, NUMBER_OF_DEFINED_ITEMS, true);
 		
-		BOOST_FOREACH(InfoTree dmg, ptree.children_named("damage"))
+		BOOST_FOREACH(const InfoTree &dmg, ptree.children_named("damage"))
 		{
 			dmg.read_damage(def.damage);
 		}
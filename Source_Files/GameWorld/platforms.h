@@ -275,6 +275,8 @@ void platform_was_entered(short platform_index, bool player);
 
 bool try_and_change_platform_state(short platform_index, bool state);
 bool try_and_change_tagged_platform_states(short tag, bool state);
+// call after changing a platform's tag other than through new_platform()
+void platform_tags_changed(void);
 
 enum /* return values from monster_can_enter_platform() and monster_can_leave_platform() */
 {
@@ -144,6 +144,7 @@ May 22, 2003 (Woody Zenfell):
 #include "FilmProfile.h"
 #include "media.h"
 #include "items.h"
+#include "flood_map.h"
 #include "weapons.h"
 #include "game_window.h"
 #include "computer_interface.h"
@@ -1597,6 +1598,7 @@ static void revive_player(
 	SET_OBJECT_SOLIDITY(object, true);
 	SET_OBJECT_OWNER(object, _object_is_monster);
 	object->permutation= player->monster_index;
+	invalidate_path_cache(true);
 	
 	/* create a new torso (shape will be set by set_player_shapes, below) */
 	attach_parasitic_object(monster->object_index, 0, location.yaw);
@@ -1729,6 +1731,7 @@ static void kill_player(
 
 	/* make our legs ownerless scenery, mark our monster as dying, stuff in the right dying shape */
 	SET_OBJECT_OWNER(legs, _object_is_normal);
+	invalidate_path_cache(true);
 	monster->action= action;
 	monster_died(player->monster_index);
 	set_player_dead_shape(player_index, true);
@@ -2371,7 +2374,7 @@ void parse_mml_player(const InfoTree& root)
 	root.read_attr("triple_energy", player_settings.TripleEnergy);
 	root.read_attr("can_swim", player_settings.CanSwim);
 	
-	BOOST_FOREACH(InfoTree item, root.children_named("item"))
+	BOOST_FOREACH(const InfoTree &item, root.children_named("item"))
 	{
 		int16 index;
 		if (!item.read_indexed("index", index, NUMBER_OF_PLAYER_INITIAL_ITEMS))
@@ -2379,7 +2382,7 @@ void parse_mml_player(const InfoTree& root)
 		item.read_indexed("type", player_initial_items[index], NUMBER_OF_DEFINED_ITEMS);
 	}
 	
-	BOOST_FOREACH(InfoTree dmg, root.children_named("damage"))
+	BOOST_FOREACH(const InfoTree &dmg, root.children_named("damage"))
 	{
 		int16 index;
 		if (!dmg.read_indexed("index", index, NUMBER_OF_DAMAGE_RESPONSE_DEFINITIONS))
@@ -2393,7 +2396,7 @@ void parse_mml_player(const InfoTree& root)
 		dmg.read_attr("death_action", def.death_action);
 	}
 	
-	BOOST_FOREACH(InfoTree assign, root.children_named("powerup_assign"))
+	BOOST_FOREACH(const InfoTree &assign, root.children_named("powerup_assign"))
 	{
 		assign.read_indexed("invincibility", player_powerups.Powerup_Invincibility, NUMBER_OF_DEFINED_ITEMS, true);
 		assign.read_indexed("invisibility", player_powerups.Powerup_Invisibility, NUMBER_OF_DEFINED_ITEMS, true);
@@ -2405,7 +2408,7 @@ void parse_mml_player(const InfoTree& root)
 		assign.read_indexed("oxygen", player_powerups.Powerup_Oxygen, NUMBER_OF_DEFINED_ITEMS, true);
 	}
 	
-	BOOST_FOREACH(InfoTree powerup, root.children_named("powerup"))
+	BOOST_FOREACH(const InfoTree &powerup, root.children_named("powerup"))
 	{
 		powerup.read_attr_bounded<int16>("invincibility", kINVINCIBILITY_DURATION, 0, SHRT_MAX);
 		powerup.read_attr_bounded<int16>("invisibility", kINVISIBILITY_DURATION, 0, SHRT_MAX);
@@ -2413,7 +2416,7 @@ void parse_mml_player(const InfoTree& root)
 		powerup.read_attr_bounded<int16>("extravision", kEXTRAVISION_DURATION, 0, SHRT_MAX);
 	}
 	
-	BOOST_FOREACH(InfoTree shp, root.children_named("shape"))
+	BOOST_FOREACH(const InfoTree &shp, root.children_named("shape"))
 	{
 		int16 type;
 		if (!shp.read_indexed("type", type, 4))
@@ -79,6 +79,12 @@ Aug 30, 2000 (Loren Petrich):
 	
 Oct 13, 2000 (Loren Petrich)
 	Converted the intersected-objects list into a Standard Template Library vector
+
+Oct 14, 2026:
+	move_projectiles() and orphan_projectiles() skip free slots with a used slot index
+	(used_slot_index.h), and new_projectile() finds the first free slot with a free slot index
+	translate_projectile() turns away objects well outside the box around its path before
+	working out their exact distance from it
 */
 
 #include "cseries.h"
@@ -98,6 +104,7 @@ Oct 13, 2000 (Loren Petrich)
 #include "Packing.h"
 
 #include "lua_script.h"
+#include "used_slot_index.h"
 
 /*
 //translate_projectile() must set _projectile_hit_landscape bit
@@ -138,6 +145,9 @@ enum /* things the projectile can hit in detonate_projectile() */
 
 /* if copy-protection fails, these are replaced externally with the rocket and the rifle bullet, respectively */
 short alien_projectile_override= NONE;
+
+static UsedSlotIndex ProjectileSlots;
+static FreeSlotIndex FreeProjectileSlots;
 short human_projectile_override= NONE;
 
 // LP addition: growable list of intersected objects
@@ -150,6 +160,9 @@ static short adjust_projectile_type(world_point3d *origin, short polygon_index,
 
 static void update_guided_projectile(short projectile_index);
 
+static void get_segment_box(world_point2d *a, world_point2d *b, world_point2d *minimum, world_point2d *maximum);
+static bool point_clear_of_segment(world_point2d *p, world_point2d *minimum, world_point2d *maximum, int32 threshold);
+
 /*static*/ projectile_definition *get_projectile_definition(
 	short type);
 
@@ -261,8 +274,8 @@ short new_projectile(
 	type= adjust_projectile_type(origin, polygon_index, type, owner_index, owner_type, intended_target_index, damage_scale);
 	definition= get_projectile_definition(type);
 
-	for (projectile_index= 0, projectile= projectiles; projectile_index<MAXIMUM_PROJECTILES_PER_MAP;
-		++projectile_index, ++projectile)
+	for (projectile_index= FreeProjectileSlots.first_free(ProjectileList), projectile= projectiles+projectile_index;
+		projectile_index<MAXIMUM_PROJECTILES_PER_MAP; ++projectile_index, ++projectile)
 	{
 		if (SLOT_IS_FREE(projectile))
 		{
@@ -298,6 +311,7 @@ short new_projectile(
 				projectile->distance_travelled= 0;
 				projectile->damage_scale= damage_scale;
 				MARK_SLOT_AS_USED(projectile);
+				ProjectileSlots.mark_used(projectile_index);
 
 				SET_OBJECT_OWNER(object, _object_is_projectile);
 				object->sound_pitch= definition->sound_pitch;
@@ -323,8 +337,10 @@ void move_projectiles(
 	struct projectile_data *projectile;
 	short projectile_index;
 	
-	for (projectile_index=0,projectile=projectiles;projectile_index<MAXIMUM_PROJECTILES_PER_MAP;++projectile_index,++projectile)
+	for (projectile_index=ProjectileSlots.next_used(ProjectileList, 0);projectile_index<MAXIMUM_PROJECTILES_PER_MAP;
+		projectile_index=ProjectileSlots.next_used(ProjectileList, projectile_index+1))
 	{
+		projectile= projectiles+projectile_index;
 		if (SLOT_IS_USED(projectile))
 		{
 			struct object_data *object= get_object_data(projectile->object_index);
@@ -583,6 +599,14 @@ void remove_projectile(
 	L_Invalidate_Projectile(projectile_index);
 	remove_map_object(projectile->object_index);
 	MARK_SLOT_AS_FREE(projectile);
+	FreeProjectileSlots.mark_free(projectile_index);
+}
+
+void rebuild_projectile_slot_index(
+	void)
+{
+	ProjectileSlots.rebuild(ProjectileList);
+	FreeProjectileSlots.rebuild(ProjectileList);
 }
 
 void remove_all_projectiles(
@@ -605,9 +629,11 @@ void orphan_projectiles(
 	struct projectile_data *projectile;
 	short projectile_index;
 
-	/* first, adjust all current projectile's .owner fields */
-	for (projectile_index=0,projectile=projectiles;projectile_index<MAXIMUM_PROJECTILES_PER_MAP;++projectile_index,++projectile)
+	/* first, adjust all current projectile's .owner fields; free slots get theirs when they're used */
+	for (projectile_index=ProjectileSlots.next_used(ProjectileList, 0);projectile_index<MAXIMUM_PROJECTILES_PER_MAP;
+		projectile_index=ProjectileSlots.next_used(ProjectileList, projectile_index+1))
 	{
+		projectile= projectiles+projectile_index;
 		if (projectile->owner_index==monster_index) projectile->owner_index= NONE;
 		if (projectile->target_index==monster_index) projectile->target_index= NONE;
 	}
@@ -707,6 +733,42 @@ static short adjust_projectile_type(
 	return type;
 }
 	
+/* the bounding box of the segment ab, for point_clear_of_segment() */
+static void get_segment_box(
+	world_point2d *a,
+	world_point2d *b,
+	world_point2d *minimum,
+	world_point2d *maximum)
+{
+	minimum->x= MIN(a->x, b->x), maximum->x= MAX(a->x, b->x);
+	minimum->y= MIN(a->y, b->y), maximum->y= MAX(a->y, b->y);
+}
+
+/* true if point_to_line_segment_distance_squared() from p to the segment with this bounding box
+	can't come out under threshold: p is that far outside the box, with room for the exact test's
+	rounding.  false (go on to the exact test) whenever the exact test's int16 deltas and their
+	products might overflow, so this never turns away anything the exact test would take */
+static bool point_clear_of_segment(
+	world_point2d *p,
+	world_point2d *minimum,
+	world_point2d *maximum,
+	int32 threshold)
+{
+	const int32 largest_safe_delta= 1<<14;
+	int32 dx= 0, dy= 0;
+	
+	if (p->x<minimum->x) dx= minimum->x-p->x;
+	else if (p->x>maximum->x) dx= p->x-maximum->x;
+	if (p->y<minimum->y) dy= minimum->y-p->y;
+	else if (p->y>maximum->y) dy= p->y-maximum->y;
+	
+	if (dx+(maximum->x-minimum->x)>=largest_safe_delta || dy+(maximum->y-minimum->y)>=largest_safe_delta) return false;
+	
+	/* the exact test's perpendicular distance may shave off up to 2^-14 of it, plus one */
+	int32 box_distance_squared= dx*dx + dy*dy;
+	return box_distance_squared - (box_distance_squared>>13) - 2 >= threshold;
+}
+
 #define MAXIMUM_GUIDED_DELTA_YAW 8
 #define MAXIMUM_GUIDED_DELTA_PITCH 6
 
@@ -954,14 +1016,14 @@ uint16 translate_projectile(
 		world_distance distance_traveled;
 		world_distance best_radius = 0;
 		short best_intersection_object = NONE;
+		world_point2d path_minimum, path_maximum;
 		
 		distance_traveled= distance2d((world_point2d *)old_location, (world_point2d *)new_location);
+		get_segment_box((world_point2d *)old_location, (world_point2d *)new_location, &path_minimum, &path_maximum);
 		for (size_t i=0;i<intersected_object_count;++i)
 		{
 			// LP change:
 			struct object_data *object= get_object_data(IntersectedObjects[i]);
-			int32 separation= point_to_line_segment_distance_squared((world_point2d *)&object->location,
-				(world_point2d *)old_location, (world_point2d *)new_location);
 			world_distance radius, height;
 				
 			if (object->permutation!=owner_index) /* dont hit ourselves */
@@ -978,6 +1040,12 @@ uint16 translate_projectile(
 				}
 				radius_squared= (radius+definition->radius)*(radius+definition->radius);
 				
+				/* too far from our path to be hit, or (monsters) flown by */
+				if (point_clear_of_segment((world_point2d *)&object->location, &path_minimum, &path_maximum,
+					GET_OBJECT_OWNER(object)==_object_is_monster ? 12*radius_squared : radius_squared)) continue;
+				
+				int32 separation= point_to_line_segment_distance_squared((world_point2d *)&object->location,
+					(world_point2d *)old_location, (world_point2d *)new_location);
 				if (separation<radius_squared) /* if were within radius^2 we passed through this monster */
 				{
 					world_distance distance= distance2d((world_point2d *)old_location, (world_point2d *)&object->location);
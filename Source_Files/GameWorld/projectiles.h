@@ -178,6 +178,7 @@ void move_projectiles(void); /* assumes 
 
 void remove_projectile(short projectile_index);
 void remove_all_projectiles(void);
+void rebuild_projectile_slot_index(void); /* when ProjectileList is cleared or filled wholesale */
 
 void orphan_projectiles(short monster_index);
 
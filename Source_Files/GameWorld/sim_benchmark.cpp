@@ -0,0 +1,598 @@
+/*
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	Simulation benchmark (see sim_benchmark.h)
+
+*/
+
+#include "cseries.h"
+#include "sim_benchmark.h"
+
+#include "map.h"
+#include "monsters.h"
+#include "projectiles.h"
+#include "effects.h"
+#include "platforms.h"
+#include "lightsource.h"
+#include "media.h"
+#include "player.h"
+#include "flood_map.h"
+#include "world_snapshot.h"
+#include "editor.h"
+#include "game_wad.h"
+#include "wad.h"
+#include "tags.h"
+#include "Packing.h"
+#include "Logging.h"
+
+#include <SDL_timer.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+enum
+{
+	kCellSize = WORLD_ONE,
+	kCeilingHeight = 2*WORLD_ONE,
+	kPlatformHeight = WORLD_ONE/2,
+	// so that the map fits in world coordinates
+	kMaximumGridSize = 60,
+	// every this many cells, one is a pillar (and one can be a platform)
+	kPillarSpacing = 4,
+	kRandomSeed = 0x1234
+};
+
+enum /* timed parts of a tick */
+{
+	_sim_benchmark_platforms,
+	_sim_benchmark_projectiles,
+	_sim_benchmark_monsters,
+	_sim_benchmark_effects,
+	_sim_benchmark_pathfinding,
+	_sim_benchmark_flood_map,
+	NUMBER_OF_SIM_BENCHMARK_PARTS
+};
+
+static const char *part_names[NUMBER_OF_SIM_BENCHMARK_PARTS] = {
+	"platforms",
+	"projectiles",
+	"monsters",
+	"effects",
+	"pathfinding",
+	"flood_map"
+};
+
+// Pfhor against S'pht'Kr and Bobs, so that they keep fighting
+static const short monster_types[] = {
+	_monster_fighter_minor,
+	_monster_trooper_minor,
+	_monster_defender_minor,
+	_civilian_security
+};
+
+static const short projectile_types[] = {
+	_projectile_rifle_bullet,
+	_projectile_rocket,
+	_projectile_grenade,
+	_projectile_staff_bolt
+};
+
+static const short effect_types[] = {
+	_effect_rocket_explosion,
+	_effect_grenade_explosion,
+	_effect_teleport_object_in
+};
+
+// The benchmark's own random numbers, so that what it spawns doesn't take
+// any from the game
+static uint32 benchmark_seed;
+
+static uint16 benchmark_random(
+	void)
+{
+	benchmark_seed = benchmark_seed * 1103515245U + 12345U;
+	return static_cast<uint16>(benchmark_seed >> 16);
+}
+
+/* ---------- the grid */
+
+static short grid_endpoint(short size, short x, short y) { return y*(size+1) + x; }
+// (size+1) rows of size horizontals, then size rows of (size+1) verticals
+static short grid_horizontal_line(short size, short x, short y) { return y*size + x; }
+static short grid_vertical_line(short size, short x, short y) { return size*(size+1) + y*(size+1) + x; }
+static short grid_polygon(short size, short x, short y) { return y*size + x; }
+static bool grid_pillar(short x, short y) { return x%kPillarSpacing == kPillarSpacing/2 && y%kPillarSpacing == kPillarSpacing/2; }
+static world_distance grid_coordinate(short size, short i) { return static_cast<world_distance>((i - size/2)*kCellSize); }
+
+static bool polygon_is_pillar(short size, short polygon_index)
+{
+	return polygon_index != NONE && grid_pillar(polygon_index%size, polygon_index/size);
+}
+
+static void set_grid_line(line_data& line, short endpoint0, short endpoint1,
+	short clockwise_owner, short counterclockwise_owner, bool solid)
+{
+	obj_clear(line);
+	line.endpoint_indexes[0] = endpoint0;
+	line.endpoint_indexes[1] = endpoint1;
+	line.clockwise_polygon_owner = clockwise_owner;
+	line.counterclockwise_polygon_owner = counterclockwise_owner;
+	line.clockwise_polygon_side_index = line.counterclockwise_polygon_side_index = NONE;
+	SET_LINE_SOLIDITY(&line, solid);
+	SET_LINE_TRANSPARENCY(&line, !solid);
+}
+
+template <class T>
+static wad_data *append_packed(wad_data *wad, WadDataType tag, std::vector<T>& list,
+	size_t object_size, uint8 *(*pack)(uint8 *, T *, size_t))
+{
+	if (!wad || list.empty())
+		return wad;
+
+	std::vector<uint8> data(list.size()*object_size);
+	pack(&data[0], &list[0], list.size());
+	return append_data_to_wad(wad, tag, &data[0], data.size(), 0);
+}
+
+// Like a map file's level, unprocessed, so that loading it goes through
+// all the usual precalculation
+static wad_data *build_grid_wad(short size, short platform_count, std::vector<short>& open_polygons)
+{
+	short endpoint_count = (size+1)*(size+1);
+	short line_count = 2*size*(size+1);
+	short polygon_count = size*size;
+
+	std::vector<uint8> points(endpoint_count*SIZEOF_world_point2d);
+	uint8 *S = &points[0];
+	for (short y = 0; y <= size; ++y)
+	{
+		for (short x = 0; x <= size; ++x)
+		{
+			ValueToStream(S, grid_coordinate(size, x));
+			ValueToStream(S, grid_coordinate(size, y));
+		}
+	}
+
+	// with y going down, a polygon's top and right lines run clockwise around it,
+	// and its bottom and left lines counterclockwise
+	std::vector<line_data> grid_lines(line_count);
+	for (short y = 0; y <= size; ++y)
+	{
+		for (short x = 0; x < size; ++x)
+		{
+			short below = y < size ? grid_polygon(size, x, y) : NONE;
+			short above = y > 0 ? grid_polygon(size, x, y-1) : NONE;
+			set_grid_line(grid_lines[grid_horizontal_line(size, x, y)],
+				grid_endpoint(size, x, y), grid_endpoint(size, x+1, y), below, above,
+				below == NONE || above == NONE || polygon_is_pillar(size, below) || polygon_is_pillar(size, above));
+		}
+	}
+	for (short y = 0; y < size; ++y)
+	{
+		for (short x = 0; x <= size; ++x)
+		{
+			short left = x > 0 ? grid_polygon(size, x-1, y) : NONE;
+			short right = x < size ? grid_polygon(size, x, y) : NONE;
+			set_grid_line(grid_lines[grid_vertical_line(size, x, y)],
+				grid_endpoint(size, x, y), grid_endpoint(size, x, y+1), left, right,
+				left == NONE || right == NONE || polygon_is_pillar(size, left) || polygon_is_pillar(size, right));
+		}
+	}
+
+	// platforms go on an evenly spread subset of the cells between pillars
+	// (leaving the player's corner alone)
+	std::vector<short> platform_candidates;
+	for (short y = 0; y < size; y += kPillarSpacing)
+	{
+		for (short x = 0; x < size; x += kPillarSpacing)
+		{
+			if (x || y)
+				platform_candidates.push_back(grid_polygon(size, x, y));
+		}
+	}
+	platform_count = MIN(platform_count, static_cast<short>(platform_candidates.size()));
+
+	std::vector<static_platform_data> grid_platforms(platform_count);
+	for (short i = 0; i < platform_count; ++i)
+	{
+		static_platform_data& platform = grid_platforms[i];
+		obj_clear(platform);
+		platform.type = _platform_is_spht_platform;
+		platform.speed = _slow_platform;
+		platform.delay = _short_delay_platform;
+		platform.minimum_height = 0;
+		platform.maximum_height = kPlatformHeight;
+		SET_PLATFORM_IS_INITIALLY_ACTIVE(&platform, true);
+		SET_PLATFORM_COMES_FROM_FLOOR(&platform, true);
+		SET_PLATFORM_REVERSES_DIRECTION_WHEN_OBSTRUCTED(&platform, true);
+		platform.polygon_index = platform_candidates[i*platform_candidates.size()/platform_count];
+	}
+
+	std::vector<polygon_data> grid_polygons(polygon_count);
+	for (short y = 0; y < size; ++y)
+	{
+		for (short x = 0; x < size; ++x)
+		{
+			short polygon_index = grid_polygon(size, x, y);
+			polygon_data& polygon = grid_polygons[polygon_index];
+			obj_clear(polygon);
+			polygon.type = _polygon_is_normal;
+			polygon.vertex_count = 4;
+			polygon.line_indexes[0] = grid_horizontal_line(size, x, y);
+			polygon.line_indexes[1] = grid_vertical_line(size, x+1, y);
+			polygon.line_indexes[2] = grid_horizontal_line(size, x, y+1);
+			polygon.line_indexes[3] = grid_vertical_line(size, x, y);
+			polygon.floor_texture = polygon.ceiling_texture = UNONE;
+			polygon.floor_height = 0;
+			polygon.ceiling_height = kCeilingHeight;
+			polygon.first_object = NONE;
+			polygon.media_index = polygon.media_lightsource_index = NONE;
+			polygon.sound_source_indexes = NONE;
+			polygon.ambient_sound_image_index = polygon.random_sound_image_index = NONE;
+
+			if (grid_pillar(x, y))
+				continue;
+
+			bool platform = false;
+			for (short i = 0; i < platform_count; ++i)
+			{
+				if (grid_platforms[i].polygon_index == polygon_index)
+				{
+					polygon.type = _polygon_is_platform;
+					polygon.permutation = i;
+					platform = true;
+				}
+			}
+			if (!platform)
+				open_polygons.push_back(polygon_index);
+		}
+	}
+
+	std::vector<static_light_data> grid_lights(1, *get_defaults_for_light_type(_normal_light));
+
+	std::vector<map_object> grid_objects(1);
+	obj_clear(grid_objects[0]);
+	grid_objects[0].type = _saved_player;
+	grid_objects[0].location.x = grid_coordinate(size, 0) + kCellSize/2;
+	grid_objects[0].location.y = grid_coordinate(size, 0) + kCellSize/2;
+	grid_objects[0].polygon_index = grid_polygon(size, 0, 0);
+
+	std::vector<static_data> map_info(1);
+	obj_clear(map_info[0]);
+	strncpy(map_info[0].level_name, "Simulation Benchmark", LEVEL_NAME_LENGTH-1);
+
+	wad_data *wad = create_empty_wad();
+	if (wad)
+		wad = append_data_to_wad(wad, POINT_TAG, &points[0], points.size(), 0);
+	wad = append_packed(wad, LINE_TAG, grid_lines, SIZEOF_line_data, pack_line_data);
+	wad = append_packed(wad, POLYGON_TAG, grid_polygons, SIZEOF_polygon_data, pack_polygon_data);
+	wad = append_packed(wad, LIGHTSOURCE_TAG, grid_lights, SIZEOF_static_light_data, pack_static_light_data);
+	wad = append_packed(wad, PLATFORM_STATIC_DATA_TAG, grid_platforms, SIZEOF_static_platform_data, pack_static_platform_data);
+	wad = append_packed(wad, OBJECT_TAG, grid_objects, SIZEOF_map_object, pack_map_object);
+	wad = append_packed(wad, MAP_INFO_TAG, map_info, SIZEOF_static_data, pack_static_data);
+	return wad;
+}
+
+/* ---------- keeping it busy */
+
+static void random_location(const std::vector<short>& open_polygons, world_distance height, object_location& location)
+{
+	short polygon_index = open_polygons[benchmark_random() % open_polygons.size()];
+	polygon_data *polygon = get_polygon_data(polygon_index);
+
+	obj_clear(location);
+	location.p.x = polygon->center.x + static_cast<world_distance>(benchmark_random() % (kCellSize/2)) - kCellSize/4;
+	location.p.y = polygon->center.y + static_cast<world_distance>(benchmark_random() % (kCellSize/2)) - kCellSize/4;
+	location.p.z = polygon->floor_height + height;
+	location.polygon_index = polygon_index;
+	location.yaw = NORMALIZE_ANGLE(benchmark_random());
+}
+
+// Returns how many of each there are now
+static void keep_populations_up(const sim_benchmark_parameters& parameters, const std::vector<short>& open_polygons,
+	short& monster_count, short& projectile_count, short& effect_count)
+{
+	monster_count = projectile_count = effect_count = 0;
+	for (size_t i = 0; i < MonsterList.size(); ++i)
+		if (SLOT_IS_USED(&MonsterList[i]) && !MONSTER_IS_PLAYER(&MonsterList[i])) ++monster_count;
+	for (size_t i = 0; i < ProjectileList.size(); ++i)
+		if (SLOT_IS_USED(&ProjectileList[i])) ++projectile_count;
+	for (size_t i = 0; i < EffectList.size(); ++i)
+		if (SLOT_IS_USED(&EffectList[i])) ++effect_count;
+
+	// stopping at the first failure, which means the lists are full
+	object_location location;
+	for (; monster_count < parameters.monster_count; ++monster_count)
+	{
+		random_location(open_polygons, 0, location);
+		short monster_index = new_monster(&location, monster_types[benchmark_random() % (sizeof(monster_types)/sizeof(monster_types[0]))]);
+		if (monster_index == NONE) break;
+		activate_monster(monster_index);
+	}
+
+	for (; projectile_count < parameters.projectile_count; ++projectile_count)
+	{
+		random_location(open_polygons, WORLD_ONE/2, location);
+		world_point3d vector;
+		vector.x = cosine_table[location.yaw];
+		vector.y = sine_table[location.yaw];
+		vector.z = 0;
+		if (new_projectile(&location.p, location.polygon_index, &vector, 0,
+			projectile_types[benchmark_random() % (sizeof(projectile_types)/sizeof(projectile_types[0]))],
+			NONE, NONE, NONE, FIXED_ONE) == NONE) break;
+	}
+
+	for (; effect_count < parameters.effect_count; ++effect_count)
+	{
+		random_location(open_polygons, WORLD_ONE/2, location);
+		if (new_effect(&location.p, location.polygon_index,
+			effect_types[benchmark_random() % (sizeof(effect_types)/sizeof(effect_types[0]))], location.yaw) == NONE) break;
+	}
+}
+
+// Like a monster's, without its size and platform rules
+static int32 benchmark_cost(short source_polygon_index, short line_index, short destination_polygon_index, void *)
+{
+	(void) (source_polygon_index);
+	if (LINE_IS_SOLID(get_line_data(line_index)))
+		return -1;
+	return get_polygon_data(destination_polygon_index)->area;
+}
+
+/* ---------- running */
+
+static bool parse_parameter(const char *key, size_t key_length, int value, sim_benchmark_parameters& parameters)
+{
+	struct { const char *name; int16 *value16; int32 *value32; int minimum, maximum; } fields[] = {
+		{ "grid", &parameters.grid_size, NULL, 2, kMaximumGridSize },
+		{ "monsters", &parameters.monster_count, NULL, 0, INT16_MAX },
+		{ "projectiles", &parameters.projectile_count, NULL, 0, INT16_MAX },
+		{ "effects", &parameters.effect_count, NULL, 0, INT16_MAX },
+		{ "platforms", &parameters.platform_count, NULL, 0, INT16_MAX },
+		{ "paths", &parameters.path_count, NULL, 0, INT16_MAX },
+		{ "floods", &parameters.flood_count, NULL, 0, INT16_MAX },
+		{ "ticks", NULL, &parameters.tick_count, 1, INT32_MAX }
+	};
+
+	for (size_t i = 0; i < sizeof(fields)/sizeof(fields[0]); ++i)
+	{
+		if (strlen(fields[i].name) != key_length || strncmp(fields[i].name, key, key_length) != 0)
+			continue;
+
+		value = PIN(value, fields[i].minimum, fields[i].maximum);
+		if (fields[i].value16)
+			*fields[i].value16 = static_cast<int16>(value);
+		else
+			*fields[i].value32 = value;
+		return true;
+	}
+	return false;
+}
+
+bool parse_sim_benchmark_parameters(const char *spec, sim_benchmark_parameters& parameters)
+{
+	if (strcmp(spec, "default") == 0)
+		return true;
+
+	while (*spec)
+	{
+		const char *equals = strchr(spec, '=');
+		if (!equals)
+			return false;
+
+		char *end;
+		long value = strtol(equals + 1, &end, 10);
+		if (end == equals + 1 || (*end && *end != ','))
+			return false;
+		if (!parse_parameter(spec, equals - spec, static_cast<int>(PIN(value, 0L, long(INT32_MAX))), parameters))
+			return false;
+
+		spec = *end ? end + 1 : end;
+	}
+	return true;
+}
+
+static double counter_ms(uint64_t counts)
+{
+	return counts * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+static bool enter_grid_map(const sim_benchmark_parameters& parameters, std::vector<short>& open_polygons)
+{
+	short size = PIN(parameters.grid_size, 2, kMaximumGridSize);
+	wad_data *wad = build_grid_wad(size, parameters.platform_count, open_polygons);
+	if (!wad)
+	{
+		logError("simbench: could not build the map");
+		return false;
+	}
+
+	// as new_game() does, for one player
+	game_data game_information;
+	obj_clear(game_information);
+	game_information.game_time_remaining = INT32_MAX;
+	game_information.game_type = _game_of_kill_monsters;
+	game_information.difficulty_level = _normal_level;
+	game_information.initial_random_seed = kRandomSeed;
+	set_random_seed(game_information.initial_random_seed);
+	benchmark_seed = kRandomSeed;
+
+	initialize_map_for_new_game();
+	obj_copy(dynamic_world->game_information, game_information);
+
+	bool success = process_map_wad(wad, false, MARATHON_TWO_DATA_VERSION);
+	free_wad(wad);
+	if (!success)
+	{
+		logError("simbench: could not load the map");
+		return false;
+	}
+
+	new_player(0, 0, 0);
+	set_local_player_index(0);
+	set_current_player_index(0);
+	reset_action_queues();
+
+	for (size_t i = 0; i < sizeof(monster_types)/sizeof(monster_types[0]); ++i)
+		mark_monster_collections(monster_types[i], true);
+	for (size_t i = 0; i < sizeof(projectile_types)/sizeof(projectile_types[0]); ++i)
+		mark_projectile_collections(projectile_types[i], true);
+	for (size_t i = 0; i < sizeof(effect_types)/sizeof(effect_types[0]); ++i)
+		mark_effect_collections(effect_types[i], true);
+	if (!entering_map(false))
+	{
+		logError("simbench: could not enter the map");
+		return false;
+	}
+	return true;
+}
+
+bool enter_sim_benchmark_map(const sim_benchmark_parameters& parameters)
+{
+	std::vector<short> open_polygons;
+	if (!enter_grid_map(parameters, open_polygons))
+		return false;
+
+	short monster_count, projectile_count, effect_count;
+	keep_populations_up(parameters, open_polygons, monster_count, projectile_count, effect_count);
+	return true;
+}
+
+bool run_sim_benchmark(const sim_benchmark_parameters& parameters)
+{
+	short size = PIN(parameters.grid_size, 2, kMaximumGridSize);
+	std::vector<short> open_polygons;
+	if (!enter_grid_map(parameters, open_polygons))
+		return false;
+
+	uint64_t part_counts[NUMBER_OF_SIM_BENCHMARK_PARTS];
+	memset(part_counts, 0, sizeof(part_counts));
+	uint64_t monsters_seen = 0, projectiles_seen = 0, effects_seen = 0;
+	int32 paths_found = 0;
+	int32 polygons_flooded = 0;
+	uint32 world_checksum = 2166136261U;
+
+	uint64_t start = SDL_GetPerformanceCounter();
+	for (int32 tick = 0; tick < parameters.tick_count; ++tick)
+	{
+		short monster_count, projectile_count, effect_count;
+		keep_populations_up(parameters, open_polygons, monster_count, projectile_count, effect_count);
+		monsters_seen += monster_count;
+		projectiles_seen += projectile_count;
+		effects_seen += effect_count;
+
+		// nothing moves the player, so nothing may kill them either
+		get_player_data(0)->invincibility_duration = INT16_MAX;
+
+		// the parts of update_world_elements_one_tick() that don't need players' input
+		invalidate_path_cache();
+		uint64_t mark = SDL_GetPerformanceCounter();
+		update_lights();
+		update_medias();
+		update_platforms();
+		uint64_t now = SDL_GetPerformanceCounter();
+		part_counts[_sim_benchmark_platforms] += now - mark;
+		mark = now;
+
+		move_projectiles();
+		now = SDL_GetPerformanceCounter();
+		part_counts[_sim_benchmark_projectiles] += now - mark;
+		invalidate_path_cache();
+		mark = SDL_GetPerformanceCounter();
+
+		move_monsters();
+		now = SDL_GetPerformanceCounter();
+		part_counts[_sim_benchmark_monsters] += now - mark;
+		mark = now;
+
+		update_effects();
+		now = SDL_GetPerformanceCounter();
+		part_counts[_sim_benchmark_effects] += now - mark;
+		mark = now;
+
+		for (short i = 0; i < parameters.path_count; ++i)
+		{
+			short source = open_polygons[benchmark_random() % open_polygons.size()];
+			short destination = open_polygons[benchmark_random() % open_polygons.size()];
+			world_point2d source_point = get_polygon_data(source)->center;
+			world_point2d destination_point = get_polygon_data(destination)->center;
+			short path_index = new_path(&source_point, source, &destination_point, destination, WORLD_ONE/3, benchmark_cost, NULL);
+			if (path_index != NONE)
+			{
+				++paths_found;
+				delete_path(path_index);
+			}
+		}
+		now = SDL_GetPerformanceCounter();
+		part_counts[_sim_benchmark_pathfinding] += now - mark;
+		mark = now;
+
+		for (short i = 0; i < parameters.flood_count; ++i)
+		{
+			short source = open_polygons[benchmark_random() % open_polygons.size()];
+			short polygon_index = flood_map(source, INT32_MAX, benchmark_cost, _breadth_first, NULL);
+			while (polygon_index != NONE)
+			{
+				++polygons_flooded;
+				polygon_index = flood_map(NONE, INT32_MAX, benchmark_cost, _breadth_first, NULL);
+			}
+		}
+		now = SDL_GetPerformanceCounter();
+		part_counts[_sim_benchmark_flood_map] += now - mark;
+
+		dynamic_world->tick_count += 1;
+		dynamic_world->game_information.game_time_remaining -= 1;
+	}
+	double total = counter_ms(SDL_GetPerformanceCounter() - start);
+
+	// runs doing the same work end up with the same world
+	uint32 checksums[NUMBER_OF_WORLD_CHECKSUMS];
+	compute_world_checksums(checksums);
+	for (int i = 0; i < NUMBER_OF_WORLD_CHECKSUMS; ++i)
+		world_checksum = (world_checksum ^ checksums[i]) * 16777619U;
+
+	int32 ticks = parameters.tick_count;
+	char report[512];
+	snprintf(report, sizeof(report),
+		"simbench: %dx%d grid, %d platforms; %.1f monsters, %.1f projectiles, %.1f effects on average; %d ticks in %.3f s (%.1f ticks per second); world checksum %08x",
+		int(size), int(size), int(dynamic_world->platform_count),
+		double(monsters_seen) / ticks, double(projectiles_seen) / ticks, double(effects_seen) / ticks,
+		int(ticks), total / 1000.0, total > 0 ? ticks * 1000.0 / total : 0.0, world_checksum);
+	logNote("%s", report);
+	printf("%s\n", report);
+
+	int length = snprintf(report, sizeof(report), "simbench per tick:");
+	for (int i = 0; i < NUMBER_OF_SIM_BENCHMARK_PARTS && length < int(sizeof(report)); ++i)
+	{
+		length += snprintf(report + length, sizeof(report) - length, " %s %.4f ms%s",
+			part_names[i], counter_ms(part_counts[i]) / ticks,
+			i + 1 < NUMBER_OF_SIM_BENCHMARK_PARTS ? "," : "");
+	}
+	logNote("%s", report);
+	printf("%s\n", report);
+
+	snprintf(report, sizeof(report), "simbench searches: %d of %d paths found; %.1f polygons per flood",
+		int(paths_found), int(ticks * parameters.path_count),
+		(ticks * parameters.flood_count) > 0 ? double(polygons_flooded) / (ticks * parameters.flood_count) : 0.0);
+	logNote("%s", report);
+	printf("%s\n", report);
+
+	leaving_map();
+	return true;
+}
@@ -0,0 +1,58 @@
+#ifndef __SIM_BENCHMARK_H
+#define __SIM_BENCHMARK_H
+
+/*
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	Simulation benchmark: builds a map that is a grid of square polygons (with
+	pillars and moving platforms), keeps it filled with monsters of warring
+	sides, projectiles and effects, and times each part of the simulation tick,
+	along with pathfinding and flood_map() between random polygons.  The map,
+	the random seeds and the spawns only depend on the parameters, so runs with
+	the same ones do the same work, and their timings can be compared.
+
+*/
+
+#include "cseries.h"
+
+struct sim_benchmark_parameters
+{
+	int16 grid_size; // polygons on a side
+	int16 monster_count, projectile_count, effect_count; // kept up to these
+	int16 platform_count;
+	int16 path_count, flood_count; // searches per tick
+	int32 tick_count;
+
+	sim_benchmark_parameters() :
+		grid_size(32), monster_count(100), projectile_count(64), effect_count(32), platform_count(16),
+		path_count(8), flood_count(2), tick_count(30*60) { }
+};
+
+// Reads "key=value,key=value..." (grid, monsters, projectiles, effects,
+// platforms, paths, floods, ticks) over the defaults; "default" keeps them
+bool parse_sim_benchmark_parameters(const char *spec, sim_benchmark_parameters& parameters);
+
+// Needs the shapes file open; replaces whatever map is loaded, logs and prints
+// the results, and returns whether the map could be built
+bool run_sim_benchmark(const sim_benchmark_parameters& parameters);
+
+// Loads the same map, with its monsters, projectiles and effects spawned once,
+// for other benchmarks to run on; leaving_map() when done with it
+bool enter_sim_benchmark_map(const sim_benchmark_parameters& parameters);
+
+#endif
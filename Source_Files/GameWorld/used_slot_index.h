@@ -0,0 +1,143 @@
+#ifndef __USED_SLOT_INDEX_H
+#define __USED_SLOT_INDEX_H
+
+/*
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	Used slot index: one bit per slot of a SLOT_IS_USED() list, set whenever a
+	slot is taken, so a pass over the list can skip straight from one used slot
+	to the next instead of reading every record.
+
+	The bits are a superset of the used slots: freeing a slot doesn't touch the
+	index, and next_used() clears the bit when it finds the slot free.  Slots
+	still come out in ascending order and are checked as they are reached, so a
+	loop sees exactly what a plain scan of the list would, including slots used
+	or freed while it runs.
+
+	Anything that fills a list wholesale (loading a level or a saved game, or
+	restoring a snapshot) has to rebuild() the index.
+
+	Free slot index: the same thing the other way round, for finding the first
+	free slot without reading every used record before it.  It has to hold every
+	free slot, so every MARK_SLOT_AS_FREE() of the list needs a mark_free(), and
+	anything that clears or fills the list wholesale a rebuild(); the first free
+	slot it finds is then the one a plain scan would find.
+
+*/
+
+#include "cseries.h"
+#include "map.h"
+
+#include <vector>
+
+class UsedSlotIndex
+{
+public:
+	template<typename T>
+	void rebuild(const std::vector<T>& list)
+	{
+		m_bits.assign((list.size() + 31) / 32, 0);
+		for (size_t i = 0; i < list.size(); i++)
+			if (SLOT_IS_USED(&list[i])) mark_used(i);
+	}
+
+	void mark_used(size_t index)
+	{
+		if (index / 32 >= m_bits.size()) m_bits.resize(index / 32 + 1, 0);
+		m_bits[index / 32] |= uint32(1) << (index % 32);
+	}
+
+	// The first used slot at or after index, or list.size() if there isn't one
+	template<typename T>
+	int16 next_used(const std::vector<T>& list, int16 index)
+	{
+		size_t word = index / 32;
+		uint32 bits = word < m_bits.size() ? m_bits[word] & (~uint32(0) << (index % 32)) : 0;
+		while (word < m_bits.size())
+		{
+			if (!bits)
+			{
+				if (++word < m_bits.size()) bits = m_bits[word];
+				continue;
+			}
+
+			int bit = 0;
+			while (!(bits & (uint32(1) << bit))) bit++;
+			bits &= ~(uint32(1) << bit);
+
+			size_t slot = word * 32 + bit;
+			if (slot >= list.size()) break;
+			if (SLOT_IS_USED(&list[slot])) return static_cast<int16>(slot);
+			m_bits[word] &= ~(uint32(1) << bit);
+		}
+		return static_cast<int16>(list.size());
+	}
+
+private:
+	std::vector<uint32> m_bits;
+};
+
+class FreeSlotIndex
+{
+public:
+	FreeSlotIndex() : m_size(0) { }
+
+	template<typename T>
+	void rebuild(const std::vector<T>& list)
+	{
+		m_size = list.size();
+		m_bits.assign((m_size + 31) / 32, 0);
+		for (size_t i = 0; i < m_size; i++)
+			if (SLOT_IS_FREE(&list[i])) mark_free(i);
+	}
+
+	void mark_free(size_t index)
+	{
+		if (index / 32 < m_bits.size())
+			m_bits[index / 32] |= uint32(1) << (index % 32);
+	}
+
+	// The first free slot, or list.size() if there isn't one
+	template<typename T>
+	int16 first_free(const std::vector<T>& list)
+	{
+		// the dynamic limits changed
+		if (m_size != list.size()) rebuild(list);
+
+		for (size_t word = 0; word < m_bits.size(); word++)
+		{
+			while (m_bits[word])
+			{
+				int bit = 0;
+				while (!(m_bits[word] & (uint32(1) << bit))) bit++;
+
+				size_t slot = word * 32 + bit;
+				if (slot >= m_size) return static_cast<int16>(m_size);
+				if (SLOT_IS_FREE(&list[slot])) return static_cast<int16>(slot);
+				m_bits[word] &= ~(uint32(1) << bit);
+			}
+		}
+		return static_cast<int16>(m_size);
+	}
+
+private:
+	size_t m_size;
+	std::vector<uint32> m_bits;
+};
+
+#endif
@@ -50,6 +50,10 @@ Feb 17, 2000 (Loren Petrich):
 
 Jul 1, 2000 (Loren Petrich):
 	Inlined the angle normalization; doing it automatically for all the functions that work with angles
+
+Oct 14, 2026:
+	Batch versions of isqrt() and the distance functions, with SSE2 and NEON kernels that give
+	the same results to the bit
 */
 
 #include "cseries.h"
@@ -60,6 +64,14 @@ Jul 1, 2000 (Loren Petrich):
 #include <math.h>
 #include <limits.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WORLD_SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define WORLD_SIMD_NEON
+#endif
+
 
 
 
@@ -632,6 +644,186 @@ int32 isqrt(uint32 x)
 	return r;
 }
 
+/* ---------- batches
+
+	The same results, to the bit, as calling the functions above for each element; the
+	vector kernels take groups of four and leave the rest to the scalar code.  isqrt()
+	is the costly part, so the distance functions make up their squares in chunks and
+	root them all together. */
+
+enum { ROOT_CHUNK_SIZE= 64 };
+
+#if defined(WORLD_SIMD_SSE2)
+// SSE2 has no 32-bit multiply that keeps the low halves
+static inline __m128i mullo_epi32(__m128i a, __m128i b)
+{
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// nor unsigned comparisons; flipping the sign bits makes signed ones do
+static inline __m128i cmpgt_epu32(__m128i a, __m128i b)
+{
+	__m128i sign = _mm_set1_epi32(INT32_MIN);
+	return _mm_cmpgt_epi32(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+}
+#endif
+
+void isqrt_batch(const uint32 *values, int32 *roots, size_t count)
+{
+	size_t i= 0;
+
+#if defined(WORLD_SIMD_SSE2)
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+		__m128i r = _mm_setzero_si128();
+		for (uint32 m = 0x40000000; m != 0; m >>= 2)
+		{
+			__m128i mm = _mm_set1_epi32(m);
+			__m128i nr = _mm_add_epi32(r, mm);
+			__m128i too_big = cmpgt_epu32(nr, x);
+			x = _mm_sub_epi32(x, _mm_andnot_si128(too_big, nr));
+			r = _mm_or_si128(_mm_and_si128(too_big, r), _mm_andnot_si128(too_big, _mm_add_epi32(nr, mm)));
+			r = _mm_srli_epi32(r, 1);
+		}
+		r = _mm_sub_epi32(r, cmpgt_epu32(x, r));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(roots + i), r);
+	}
+#elif defined(WORLD_SIMD_NEON)
+	for (; i + 4 <= count; i += 4)
+	{
+		uint32x4_t x = vld1q_u32(values + i);
+		uint32x4_t r = vdupq_n_u32(0);
+		for (uint32 m = 0x40000000; m != 0; m >>= 2)
+		{
+			uint32x4_t mm = vdupq_n_u32(m);
+			uint32x4_t nr = vaddq_u32(r, mm);
+			uint32x4_t fits = vcleq_u32(nr, x);
+			x = vsubq_u32(x, vandq_u32(fits, nr));
+			r = vbslq_u32(fits, vaddq_u32(nr, mm), r);
+			r = vshrq_n_u32(r, 1);
+		}
+		r = vsubq_u32(r, vcgtq_u32(x, r));
+		vst1q_s32(roots + i, vreinterpretq_s32_u32(r));
+	}
+#endif
+
+	for (; i < count; ++i)
+		roots[i]= isqrt(values[i]);
+}
+
+void distance2d_batch(
+	world_point2d *origin,
+	const world_point2d *points,
+	size_t count,
+	world_distance *distances)
+{
+	uint32 squares[ROOT_CHUNK_SIZE];
+	int32 roots[ROOT_CHUNK_SIZE];
+
+	for (size_t start= 0; start < count; start+= ROOT_CHUNK_SIZE)
+	{
+		size_t chunk= MIN(count - start, static_cast<size_t>(ROOT_CHUNK_SIZE));
+		for (size_t i= 0; i < chunk; ++i)
+		{
+			// the sum wraps as m2_distance2d()'s does
+			int32 dx= (int32)origin->x - points[start + i].x;
+			int32 dy= (int32)origin->y - points[start + i].y;
+			squares[i]= uint32(dx)*uint32(dx) + uint32(dy)*uint32(dy);
+		}
+		isqrt_batch(squares, roots, chunk);
+
+		if (film_profile.long_distance_physics)
+		{
+			for (size_t i= 0; i < chunk; ++i)
+				distances[start + i]= roots[i]>INT16_MAX ? INT16_MAX : roots[i];
+		}
+		else
+		{
+			for (size_t i= 0; i < chunk; ++i)
+				distances[start + i]= static_cast<world_distance>(roots[i]);
+		}
+	}
+}
+
+void distance3d_batch(
+	world_point3d *origin,
+	const world_point3d *points,
+	size_t count,
+	world_distance *distances)
+{
+	uint32 squares[ROOT_CHUNK_SIZE];
+	int32 roots[ROOT_CHUNK_SIZE];
+
+	for (size_t start= 0; start < count; start+= ROOT_CHUNK_SIZE)
+	{
+		size_t chunk= MIN(count - start, static_cast<size_t>(ROOT_CHUNK_SIZE));
+		for (size_t i= 0; i < chunk; ++i)
+		{
+			int32 dx= (int32)origin->x - points[start + i].x;
+			int32 dy= (int32)origin->y - points[start + i].y;
+			int32 dz= (int32)origin->z - points[start + i].z;
+			squares[i]= uint32(dx)*uint32(dx) + uint32(dy)*uint32(dy) + uint32(dz)*uint32(dz);
+		}
+		isqrt_batch(squares, roots, chunk);
+
+		for (size_t i= 0; i < chunk; ++i)
+			distances[start + i]= roots[i]>INT16_MAX ? INT16_MAX : roots[i];
+	}
+}
+
+void guess_distance2d_batch(
+	world_point2d *origin,
+	const world_point2d *points,
+	size_t count,
+	world_distance *distances)
+{
+	size_t i= 0;
+
+#if defined(WORLD_SIMD_SSE2)
+	// each 32-bit lane is one point, x in the low half
+	__m128i ox = _mm_set1_epi32(origin->x);
+	__m128i oy = _mm_set1_epi32(origin->y);
+	__m128i limit = _mm_set1_epi32(INT16_MAX);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(points + i));
+		__m128i dx = _mm_sub_epi32(ox, _mm_srai_epi32(_mm_slli_epi32(p, 16), 16));
+		__m128i dy = _mm_sub_epi32(oy, _mm_srai_epi32(p, 16));
+		__m128i sx = _mm_srai_epi32(dx, 31);
+		__m128i sy = _mm_srai_epi32(dy, 31);
+		dx = _mm_sub_epi32(_mm_xor_si128(dx, sx), sx);
+		dy = _mm_sub_epi32(_mm_xor_si128(dy, sy), sy);
+
+		__m128i x_longer = _mm_cmpgt_epi32(dx, dy);
+		__m128i longer = _mm_or_si128(_mm_and_si128(x_longer, dx), _mm_andnot_si128(x_longer, dy));
+		__m128i shorter = _mm_or_si128(_mm_and_si128(x_longer, dy), _mm_andnot_si128(x_longer, dx));
+		__m128i d = _mm_add_epi32(longer, _mm_srai_epi32(shorter, 1));
+
+		__m128i too_far = _mm_cmpgt_epi32(d, limit);
+		d = _mm_or_si128(_mm_and_si128(too_far, limit), _mm_andnot_si128(too_far, d));
+		// d is in [0, INT16_MAX], so packing doesn't saturate
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(distances + i), _mm_packs_epi32(d, d));
+	}
+#elif defined(WORLD_SIMD_NEON)
+	int32x4_t ox = vdupq_n_s32(origin->x);
+	int32x4_t oy = vdupq_n_s32(origin->y);
+	for (; i + 4 <= count; i += 4)
+	{
+		int16x4x2_t p = vld2_s16(reinterpret_cast<const int16*>(points + i));
+		int32x4_t dx = vabsq_s32(vsubq_s32(ox, vmovl_s16(p.val[0])));
+		int32x4_t dy = vabsq_s32(vsubq_s32(oy, vmovl_s16(p.val[1])));
+		int32x4_t d = vaddq_s32(vmaxq_s32(dx, dy), vshrq_n_s32(vminq_s32(dx, dy), 1));
+		vst1_s16(distances + i, vqmovn_s32(d));
+	}
+#endif
+
+	for (; i < count; ++i)
+		distances[i]= guess_distance2d(origin, const_cast<world_point2d *>(points + i));
+}
+
 // LP additions: stuff for handling long-distance views
 
 void long_to_overflow_short_2d(long_vector2d& LVec, world_point2d& WVec, uint16& flags)
@@ -209,6 +209,12 @@ world_distance distance2d(world_point2d *p0, world_point2d *p1); /* calls isqrt(
 
 int32 isqrt(uint32 x);
 
+/* the same as the above for each of many points (or values), only faster */
+void isqrt_batch(const uint32 *values, int32 *roots, size_t count);
+void guess_distance2d_batch(world_point2d *origin, const world_point2d *points, size_t count, world_distance *distances);
+void distance2d_batch(world_point2d *origin, const world_point2d *points, size_t count, world_distance *distances);
+void distance3d_batch(world_point3d *origin, const world_point3d *points, size_t count, world_distance *distances);
+
 // LP additions: kludges for doing long-distance calculation
 // by storing the upper digits in the upper byte of a "flags" value.
 // These digits are the first 4 of X and Y beyond the short-integer digits.
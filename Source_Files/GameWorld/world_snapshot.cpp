@@ -0,0 +1,268 @@
+/*
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	World snapshot (see world_snapshot.h)
+
+*/
+
+#include "cseries.h"
+#include "world_snapshot.h"
+
+#include "map.h"
+#include "player.h"
+#include "monsters.h"
+#include "projectiles.h"
+#include "effects.h"
+#include "platforms.h"
+#include "lightsource.h"
+#include "media.h"
+
+#include <string.h>
+#include <vector>
+
+enum {
+	// Small enough that a tick's changes touch few pages, big enough that
+	// comparing a page costs little more than copying it
+	kSnapshotPageSize = 1024
+};
+
+enum {
+	_snapshot_dynamic_world,
+	_snapshot_players,
+	_snapshot_objects,
+	_snapshot_monsters,
+	_snapshot_projectiles,
+	_snapshot_effects,
+	_snapshot_platforms,
+	_snapshot_lights,
+	_snapshot_medias,
+	_snapshot_polygons,
+	_snapshot_lines,
+	_snapshot_sides,
+	_snapshot_endpoints,
+	NUMBER_OF_SNAPSHOT_REGIONS
+};
+
+static std::vector<uint8> snapshot_regions[NUMBER_OF_SNAPSHOT_REGIONS];
+static uint16 snapshot_random_seed;
+
+// Copies the pages of from that differ from to
+static void copy_changed_pages(uint8 *to, const uint8 *from, size_t size)
+{
+	for (size_t offset = 0; offset < size; offset += kSnapshotPageSize)
+	{
+		size_t length = MIN(size - offset, size_t(kSnapshotPageSize));
+		if (memcmp(to + offset, from + offset, length) != 0)
+			memcpy(to + offset, from + offset, length);
+	}
+}
+
+static void save_region(int which, const void *data, size_t size)
+{
+	std::vector<uint8>& region = snapshot_regions[which];
+	if (region.size() != size)
+	{
+		region.resize(size);
+		if (size)
+			memcpy(&region[0], data, size);
+	}
+	else if (size)
+		copy_changed_pages(&region[0], static_cast<const uint8 *>(data), size);
+}
+
+static void restore_region(int which, void *data, size_t size)
+{
+	const std::vector<uint8>& region = snapshot_regions[which];
+	assert(region.size() == size);
+	if (size)
+		copy_changed_pages(static_cast<uint8 *>(data), &region[0], size);
+}
+
+template<typename T>
+static void save_list(int which, const std::vector<T>& list)
+{
+	save_region(which, list.empty() ? NULL : &list[0], list.size() * sizeof(T));
+}
+
+// A list that grew or shrank since the save goes back to its saved length
+template<typename T>
+static void restore_list(int which, std::vector<T>& list)
+{
+	list.resize(snapshot_regions[which].size() / sizeof(T));
+	restore_region(which, list.empty() ? NULL : &list[0], list.size() * sizeof(T));
+}
+
+void save_world_snapshot()
+{
+	save_region(_snapshot_dynamic_world, dynamic_world, sizeof(dynamic_data));
+	save_region(_snapshot_players, players, dynamic_world->player_count * sizeof(player_data));
+	save_list(_snapshot_objects, ObjectList);
+	save_list(_snapshot_monsters, MonsterList);
+	save_list(_snapshot_projectiles, ProjectileList);
+	save_list(_snapshot_effects, EffectList);
+	save_list(_snapshot_platforms, PlatformList);
+	save_list(_snapshot_lights, LightList);
+	save_list(_snapshot_medias, MediaList);
+	save_list(_snapshot_polygons, PolygonList);
+	save_list(_snapshot_lines, LineList);
+	save_list(_snapshot_sides, SideList);
+	save_list(_snapshot_endpoints, EndpointList);
+	snapshot_random_seed = get_random_seed();
+}
+
+void restore_world_snapshot()
+{
+	restore_region(_snapshot_dynamic_world, dynamic_world, sizeof(dynamic_data));
+	restore_region(_snapshot_players, players, dynamic_world->player_count * sizeof(player_data));
+	restore_list(_snapshot_objects, ObjectList);
+	restore_list(_snapshot_monsters, MonsterList);
+	restore_list(_snapshot_projectiles, ProjectileList);
+	restore_list(_snapshot_effects, EffectList);
+	restore_list(_snapshot_platforms, PlatformList);
+	restore_list(_snapshot_lights, LightList);
+	restore_list(_snapshot_medias, MediaList);
+	restore_list(_snapshot_polygons, PolygonList);
+	restore_list(_snapshot_lines, LineList);
+	restore_list(_snapshot_sides, SideList);
+	restore_list(_snapshot_endpoints, EndpointList);
+	set_random_seed(snapshot_random_seed);
+
+	rebuild_object_slot_index();
+	rebuild_monster_slot_index();
+	rebuild_projectile_slot_index();
+	rebuild_effect_slot_index();
+
+	// predicted moves changed them, and the objects went back to where they were
+	invalidate_polygon_object_counts();
+}
+
+void discard_world_snapshot()
+{
+	for (int i = 0; i < NUMBER_OF_SNAPSHOT_REGIONS; i++)
+		std::vector<uint8>().swap(snapshot_regions[i]);
+}
+
+static const char *world_checksum_names[NUMBER_OF_WORLD_CHECKSUMS] = {
+	"dynamic_world",
+	"players",
+	"objects",
+	"monsters",
+	"projectiles",
+	"effects",
+	"platforms",
+	"lights",
+	"media",
+	"map"
+};
+
+const char *world_checksum_name(int which)
+{
+	return (which >= 0 && which < NUMBER_OF_WORLD_CHECKSUMS) ? world_checksum_names[which] : "unknown";
+}
+
+// FNV-1a; records are hashed as they are saved, in a fixed byte order and
+// without the padding their structures have, so that all machines agree
+static uint32 checksum_bytes(uint32 hash, const uint8 *bytes, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+		hash = (hash ^ bytes[i]) * 16777619U;
+	return hash;
+}
+
+static uint32 checksum_value(uint32 hash, int16 value)
+{
+	uint8 bytes[2] = { uint8(uint16(value) >> 8), uint8(value) };
+	return checksum_bytes(hash, bytes, sizeof(bytes));
+}
+
+static const uint32 checksum_basis = 2166136261U;
+
+template<typename T>
+static uint32 checksum_packed(uint32 hash, T *records, size_t count, size_t packed_size, uint8 *(*pack)(uint8 *, T *, size_t))
+{
+	if (count == 0) return hash;
+
+	// what the packing skips stays zero
+	std::vector<uint8> packed(count * packed_size, 0);
+	pack(&packed[0], records, count);
+	return checksum_bytes(hash, &packed[0], packed.size());
+}
+
+// Only slots in use; a free slot keeps whatever its last occupant left
+template<typename T>
+static uint32 checksum_used_slots(std::vector<T>& list, size_t packed_size, uint8 *(*pack)(uint8 *, T *, size_t))
+{
+	uint32 hash = checksum_basis;
+	for (size_t i = 0; i < list.size(); i++)
+	{
+		if (SLOT_IS_USED(&list[i]))
+			hash = checksum_packed(checksum_value(hash, int16(i)), &list[i], 1, packed_size, pack);
+	}
+	return hash;
+}
+
+template<typename T>
+static uint32 checksum_list(uint32 hash, std::vector<T>& list, size_t packed_size, uint8 *(*pack)(uint8 *, T *, size_t))
+{
+	return list.empty() ? hash : checksum_packed(hash, &list[0], list.size(), packed_size, pack);
+}
+
+void compute_world_checksums(uint32 checksums[NUMBER_OF_WORLD_CHECKSUMS])
+{
+	// who's speaking and one's own annotations are local
+	dynamic_data world = *dynamic_world;
+	world.speaking_player_index = NONE;
+	world.personal_annotation_count = 0;
+	uint32 hash = checksum_packed(checksum_basis, &world, 1, SIZEOF_dynamic_data, pack_dynamic_data);
+	checksums[_world_checksum_dynamic_world] = checksum_value(hash, int16(get_random_seed()));
+
+	// [] scrolling of the inventory is local too (see exit_predictive_mode())
+	hash = checksum_basis;
+	for (int i = 0; i < dynamic_world->player_count; i++)
+	{
+		player_data player = players[i];
+		player.interface_flags = 0;
+		player.interface_decay = 0;
+		hash = checksum_packed(hash, &player, 1, SIZEOF_player_data, pack_player_data);
+	}
+	checksums[_world_checksum_players] = hash;
+
+	checksums[_world_checksum_objects] = checksum_used_slots(ObjectList, SIZEOF_object_data, pack_object_data);
+	checksums[_world_checksum_monsters] = checksum_used_slots(MonsterList, SIZEOF_monster_data, pack_monster_data);
+	checksums[_world_checksum_projectiles] = checksum_used_slots(ProjectileList, SIZEOF_projectile_data, pack_projectile_data);
+	checksums[_world_checksum_effects] = checksum_used_slots(EffectList, SIZEOF_effect_data, pack_effect_data);
+	checksums[_world_checksum_platforms] = checksum_list(checksum_basis, PlatformList, SIZEOF_platform_data, pack_platform_data);
+	checksums[_world_checksum_lights] = checksum_list(checksum_basis, LightList, SIZEOF_light_data, pack_light_data);
+	checksums[_world_checksum_medias] = checksum_used_slots(MediaList, SIZEOF_media_data, pack_media_data);
+
+	hash = checksum_list(checksum_basis, PolygonList, SIZEOF_polygon_data, pack_polygon_data);
+	hash = checksum_list(hash, LineList, SIZEOF_line_data, pack_line_data);
+	hash = checksum_list(hash, SideList, SIZEOF_side_data, pack_side_data);
+	// the renderer keeps its transformed coordinates in the endpoints
+	for (size_t i = 0; i < EndpointList.size(); i++)
+	{
+		const endpoint_data& endpoint = EndpointList[i];
+		hash = checksum_value(hash, int16(endpoint.flags));
+		hash = checksum_value(hash, endpoint.highest_adjacent_floor_height);
+		hash = checksum_value(hash, endpoint.lowest_adjacent_ceiling_height);
+		hash = checksum_value(hash, endpoint.vertex.x);
+		hash = checksum_value(hash, endpoint.vertex.y);
+		hash = checksum_value(hash, endpoint.supporting_polygon_index);
+	}
+	checksums[_world_checksum_map] = hash;
+}
@@ -0,0 +1,61 @@
+#ifndef __WORLD_SNAPSHOT_H
+#define __WORLD_SNAPSHOT_H
+
+/*
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	World snapshot: a copy of the dynamic world (dynamic_world, players, objects,
+	monsters, projectiles, effects, platforms, lights, media, and the map geometry
+	that platforms and media move) that can be put back exactly, for prediction.
+
+	The arrays are kept in pages; saving again and restoring copy only the pages
+	that differ, so the cost follows what the simulation touched, not the map size.
+	Module state outside those arrays (monster paths, sounds, Lua) isn't covered.
+
+	World checksums: a hash of each part of the same state as it would be saved,
+	leaving out what is local to one machine, so machines in sync agree.
+
+*/
+
+// Remember the dynamic world as it is now
+void save_world_snapshot();
+
+// Put the dynamic world back exactly as it was at the last save_world_snapshot()
+void restore_world_snapshot();
+
+// Release the snapshot's memory (when leaving a map)
+void discard_world_snapshot();
+
+enum {
+	_world_checksum_dynamic_world, // and the random seed
+	_world_checksum_players,
+	_world_checksum_objects,
+	_world_checksum_monsters,
+	_world_checksum_projectiles,
+	_world_checksum_effects,
+	_world_checksum_platforms,
+	_world_checksum_lights,
+	_world_checksum_medias,
+	_world_checksum_map, // polygons, lines, sides and endpoints
+	NUMBER_OF_WORLD_CHECKSUMS
+};
+
+void compute_world_checksums(uint32 checksums[NUMBER_OF_WORLD_CHECKSUMS]);
+const char *world_checksum_name(int which);
+
+#endif
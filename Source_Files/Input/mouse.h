@@ -32,13 +32,19 @@ Tuesday, January 17, 1995 2:53:17 PM  (Jason')
 void enter_mouse(short type);
 void test_mouse(short type, uint32 *action_flags, _fixed *delta_yaw, _fixed *delta_pitch, _fixed *delta_velocity);
 void exit_mouse(short type);
-void mouse_idle(short type);
+// Takes the motion up to tick_time (ms, as SDL_GetTicks()) for the next tick's flags
+void mouse_idle(short type, uint32 tick_time);
 void recenter_mouse(void);
 
 // ZZZ: stuff of various hackiness levels to pretend mouse buttons are keys
 void mouse_buttons_become_keypresses(Uint8* ioKeyMap);
 void mouse_scroll(bool up);
-void mouse_moved(int delta_x, int delta_y);
+void mouse_moved(int delta_x, int delta_y, uint32 timestamp);
+
+// The turn the motion not yet in any flags will make, in angles, for the view to be
+// drawn with ahead of the ticks; false when the local player's view isn't the
+// mouse's to turn
+bool mouse_view_delta(short *delta_yaw, short *delta_pitch);
 
 #define NUM_SDL_REAL_MOUSE_BUTTONS 5
 #define NUM_SDL_MOUSE_BUTTONS 7   		  // two scroll-wheel buttons
@@ -29,10 +29,14 @@
 
 #include "cseries.h"
 #include <math.h>
+#include <deque>
 
 #include "mouse.h"
+#include "map.h"
 #include "player.h"
 #include "shell.h"
+#include "interface.h"
+#include "computer_interface.h"
 #include "preferences.h"
 #include "screen.h"
 
@@ -46,7 +50,15 @@ static bool mouse_active = false;
 static uint8 button_mask = 0;		// Mask of enabled buttons
 static _fixed snapshot_delta_yaw, snapshot_delta_pitch;
 static _fixed snapshot_delta_scrollwheel;
-static int snapshot_delta_x, snapshot_delta_y;
+
+// Motion as it comes in, with when, so that each tick takes what happened before it
+struct mouse_sample
+{
+	uint32 time;
+	int delta_x, delta_y;
+};
+static std::deque<mouse_sample> mouse_samples;
+static const size_t MAXIMUM_MOUSE_SAMPLES = 1024;
 
 
 /*
@@ -65,7 +77,7 @@ void enter_mouse(short type)
 		mouse_active = true;
 		snapshot_delta_yaw = snapshot_delta_pitch = 0;
 		snapshot_delta_scrollwheel = 0;
-		snapshot_delta_x = snapshot_delta_y = 0;
+		mouse_samples.clear();
 		button_mask = 0;	// Disable all buttons (so a shot won't be fired if we enter the game with a mouse button down from clicking a GUI widget)
 		recenter_mouse();
 	}
@@ -104,70 +116,136 @@ static inline float MIX(float start, float end, float factor)
 	return (start * (1.f - factor)) + (end * factor);
 }
 
+#ifdef __APPLE__
+// In raw mode, unaccelerated deltas come from the HID system instead of the events
+static void poll_raw_mouse_motion()
+{
+	if (input_preferences->raw_mouse_input)
+	{
+		int delta_x = 0, delta_y = 0;
+		OSX_Mouse_GetMouseMovement(&delta_x, &delta_y);
+		if (delta_x || delta_y)
+			mouse_moved(delta_x, delta_y, SDL_GetTicks());
+	}
+}
+#endif
+
+// From counts to the deltas given to mask_in_absolute_positioning_information()
+static void scale_mouse_motion(int delta_x, int delta_y, _fixed& delta_yaw, _fixed& delta_pitch)
+{
+	// Calculate axis deltas
+	float dx = delta_x;
+	float dy = -delta_y;
+	
+	// Mouse inversion
+	if (TEST_FLAG(input_preferences->modifiers, _inputmod_invert_mouse))
+		dy = -dy;
+	
+	// scale input by sensitivity
+	const float sensitivityScale = 1.f / (66.f * FIXED_ONE);
+	float sx = sensitivityScale * input_preferences->sens_horizontal;
+	float sy = sensitivityScale * input_preferences->sens_vertical;
+	switch (input_preferences->mouse_accel_type)
+	{
+		case _mouse_accel_classic:
+			sx *= MIX(1.f, fabs(dx * sx) * 4.f, input_preferences->mouse_accel_scale);
+			sy *= MIX(1.f, fabs(dy * sy) * 4.f, input_preferences->mouse_accel_scale);
+			break;
+		case _mouse_accel_none:
+		default:
+			break;
+	}
+	dx *= sx;
+	dy *= sy;
+	
+	// 1 dx unit = 1 * 2^ABSOLUTE_YAW_BITS * (360 deg / 2^ANGULAR_BITS)
+	//           = 90 deg
+	//
+	// 1 dy unit = 1 * 2^ABSOLUTE_PITCH_BITS * (360 deg / 2^ANGULAR_BITS)
+	//           = 22.5 deg
+	
+	// Largest dx for which both -dx and +dx can be represented in 1 action flags bitset
+	float dxLimit = 0.5f - 1.f / (1<<ABSOLUTE_YAW_BITS);  // 0.4921875 dx units (~44.30 deg)
+	
+	// Largest dy for which both -dy and +dy can be represented in 1 action flags bitset
+	float dyLimit = 0.5f - 1.f / (1<<ABSOLUTE_PITCH_BITS);  // 0.46875 dy units (~10.55 deg)
+	
+	dxLimit = MIN(dxLimit, input_preferences->mouse_max_speed);
+	dyLimit = MIN(dyLimit, input_preferences->mouse_max_speed);
+	
+	dx = PIN(dx, -dxLimit, dxLimit);
+	dy = PIN(dy, -dyLimit, dyLimit);
+	
+	delta_yaw   = static_cast<_fixed>(dx * FIXED_ONE);
+	delta_pitch = static_cast<_fixed>(dy * FIXED_ONE);
+}
+
 /*
  *  Take a snapshot of the current mouse state
  */
 
-void mouse_idle(short type)
+void mouse_idle(short type, uint32 tick_time)
 {
 	if (mouse_active) {
 #ifdef __APPLE__
-		// In raw mode, get unaccelerated deltas from HID system
-		if (input_preferences->raw_mouse_input)
-			OSX_Mouse_GetMouseMovement(&snapshot_delta_x, &snapshot_delta_y);
+		poll_raw_mouse_motion();
 #endif
 		
-		// Calculate axis deltas
-		float dx = snapshot_delta_x;
-		float dy = -snapshot_delta_y;
-		snapshot_delta_x = 0;
-		snapshot_delta_y = 0;
-		
-		// Mouse inversion
-		if (TEST_FLAG(input_preferences->modifiers, _inputmod_invert_mouse))
-			dy = -dy;
-		
-		// scale input by sensitivity
-		const float sensitivityScale = 1.f / (66.f * FIXED_ONE);
-		float sx = sensitivityScale * input_preferences->sens_horizontal;
-		float sy = sensitivityScale * input_preferences->sens_vertical;
-		switch (input_preferences->mouse_accel_type)
+		// what came after the tick's time is left for the next one
+		int delta_x = 0, delta_y = 0;
+		while (!mouse_samples.empty() && static_cast<int32>(mouse_samples.front().time - tick_time) <= 0)
 		{
-			case _mouse_accel_classic:
-				sx *= MIX(1.f, fabs(dx * sx) * 4.f, input_preferences->mouse_accel_scale);
-				sy *= MIX(1.f, fabs(dy * sy) * 4.f, input_preferences->mouse_accel_scale);
-				break;
-			case _mouse_accel_none:
-			default:
-				break;
+			delta_x += mouse_samples.front().delta_x;
+			delta_y += mouse_samples.front().delta_y;
+			mouse_samples.pop_front();
 		}
-		dx *= sx;
-		dy *= sy;
-		
-		// 1 dx unit = 1 * 2^ABSOLUTE_YAW_BITS * (360 deg / 2^ANGULAR_BITS)
-		//           = 90 deg
-		//
-		// 1 dy unit = 1 * 2^ABSOLUTE_PITCH_BITS * (360 deg / 2^ANGULAR_BITS)
-		//           = 22.5 deg
-		
-		// Largest dx for which both -dx and +dx can be represented in 1 action flags bitset
-		float dxLimit = 0.5f - 1.f / (1<<ABSOLUTE_YAW_BITS);  // 0.4921875 dx units (~44.30 deg)
-		
-		// Largest dy for which both -dy and +dy can be represented in 1 action flags bitset
-		float dyLimit = 0.5f - 1.f / (1<<ABSOLUTE_PITCH_BITS);  // 0.46875 dy units (~10.55 deg)
-		
-		dxLimit = MIN(dxLimit, input_preferences->mouse_max_speed);
-		dyLimit = MIN(dyLimit, input_preferences->mouse_max_speed);
 		
-		dx = PIN(dx, -dxLimit, dxLimit);
-		dy = PIN(dy, -dyLimit, dyLimit);
-		
-		snapshot_delta_yaw   = static_cast<_fixed>(dx * FIXED_ONE);
-		snapshot_delta_pitch = static_cast<_fixed>(dy * FIXED_ONE);
+		scale_mouse_motion(delta_x, delta_y, snapshot_delta_yaw, snapshot_delta_pitch);
 	}
 }
 
 
+/*
+ *  Turn the view ahead of the ticks
+ */
+
+bool mouse_view_delta(short *delta_yaw, short *delta_pitch)
+{
+	*delta_yaw = *delta_pitch = 0;
+
+	// the flags made for the local player have to be what moves its view next,
+	// and nobody else's
+	if (!mouse_active || input_preferences->input_device != _mouse_yaw_pitch ||
+		!get_keyboard_controller_status() || game_is_networked || game_is_being_replayed() ||
+		current_player != local_player || PLAYER_IS_DEAD(local_player) ||
+		player_in_terminal_mode(local_player_index))
+		return false;
+
+#ifdef __APPLE__
+	poll_raw_mouse_motion();
+#endif
+
+	int delta_x = 0, delta_y = 0;
+	for (std::deque<mouse_sample>::const_iterator it = mouse_samples.begin(); it != mouse_samples.end(); ++it)
+	{
+		delta_x += it->delta_x;
+		delta_y += it->delta_y;
+	}
+
+	if (!delta_x && !delta_y)
+		return true;
+
+	// unless more comes, the next tick turns exactly this much once
+	// mask_in_absolute_positioning_information() has encoded it
+	_fixed yaw, pitch;
+	scale_mouse_motion(delta_x, delta_y, yaw, pitch);
+
+	*delta_yaw = static_cast<short>(yaw < 0 ? -((-yaw) >> (FIXED_FRACTIONAL_BITS-ABSOLUTE_YAW_BITS)) : yaw >> (FIXED_FRACTIONAL_BITS-ABSOLUTE_YAW_BITS));
+	*delta_pitch = static_cast<short>(pitch < 0 ? -((-pitch) >> (FIXED_FRACTIONAL_BITS-ABSOLUTE_PITCH_BITS)) : pitch >> (FIXED_FRACTIONAL_BITS-ABSOLUTE_PITCH_BITS));
+	return true;
+}
+
+
 /*
  *  Return mouse state
  */
@@ -229,8 +307,17 @@ void mouse_scroll(bool up)
 		snapshot_delta_scrollwheel -= 1;
 }
 
-void mouse_moved(int delta_x, int delta_y)
+void mouse_moved(int delta_x, int delta_y, uint32 timestamp)
 {
-	snapshot_delta_x += delta_x;
-	snapshot_delta_y += delta_y;
+	// nothing's taking them (paused, say): fold the oldest together
+	if (mouse_samples.size() >= MAXIMUM_MOUSE_SAMPLES)
+	{
+		mouse_sample oldest = mouse_samples.front();
+		mouse_samples.pop_front();
+		mouse_samples.front().delta_x += oldest.delta_x;
+		mouse_samples.front().delta_y += oldest.delta_y;
+	}
+
+	mouse_sample sample = { timestamp, delta_x, delta_y };
+	mouse_samples.push_back(sample);
 }
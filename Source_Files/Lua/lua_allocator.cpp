@@ -0,0 +1,254 @@
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  Lua allocator (see lua_allocator.h)
+
+ */
+
+#include "lua_allocator.h"
+
+#ifdef HAVE_LUA
+
+#include "Logging.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <vector>
+
+enum {
+	kGranularity = 16,
+	// Blocks up to this size come from the pools
+	kLargestPooledBlock = 256,
+	kNumberOfSizeClasses = kLargestPooledBlock / kGranularity,
+	kSlabSize = 64 * 1024
+};
+
+class LuaAllocator
+{
+public:
+	LuaAllocator(size_t limit) : m_limit(limit), m_in_use(0), m_peak(0), m_slab_next(NULL), m_slab_left(0) {
+		memset(m_free, 0, sizeof(m_free));
+	}
+
+	~LuaAllocator() {
+		for (size_t i = 0; i < m_slabs.size(); i++)
+			free(m_slabs[i]);
+	}
+
+	void *Allocate(void *ptr, size_t osize, size_t nsize);
+
+	size_t InUse() const { return m_in_use; }
+	size_t Peak() const { return m_peak; }
+
+private:
+	struct FreeBlock {
+		FreeBlock *next;
+	};
+
+	static int SizeClass(size_t size) { return static_cast<int>((size + kGranularity - 1) / kGranularity) - 1; }
+	void *AllocateBlock(size_t size);
+	void ReleaseBlock(void *ptr, size_t size);
+
+	size_t m_limit;
+	size_t m_in_use;
+	size_t m_peak;
+
+	FreeBlock *m_free[kNumberOfSizeClasses];
+	std::vector<void *> m_slabs;
+	// what is left of the newest slab
+	char *m_slab_next;
+	size_t m_slab_left;
+};
+
+void *LuaAllocator::AllocateBlock(size_t size)
+{
+	if (size > kLargestPooledBlock)
+		return malloc(size);
+
+	int size_class = SizeClass(size);
+	if (m_free[size_class])
+	{
+		FreeBlock *block = m_free[size_class];
+		m_free[size_class] = block->next;
+		return block;
+	}
+
+	size_t block_size = (size_class + 1) * kGranularity;
+	if (m_slabs.empty() || m_slab_left < block_size)
+	{
+		// what's left of the old slab goes to its size classes' free lists
+		while (!m_slabs.empty() && m_slab_left >= kGranularity)
+		{
+			size_t left_class = MIN(m_slab_left, size_t(kLargestPooledBlock)) / kGranularity - 1;
+			FreeBlock *block = reinterpret_cast<FreeBlock *>(m_slab_next);
+			block->next = m_free[left_class];
+			m_free[left_class] = block;
+			m_slab_next += (left_class + 1) * kGranularity;
+			m_slab_left -= (left_class + 1) * kGranularity;
+		}
+
+		void *slab = malloc(kSlabSize);
+		if (!slab)
+			return NULL;
+		m_slabs.push_back(slab);
+		m_slab_next = static_cast<char *>(slab);
+		m_slab_left = kSlabSize;
+	}
+
+	void *block = m_slab_next;
+	m_slab_next += block_size;
+	m_slab_left -= block_size;
+	return block;
+}
+
+void LuaAllocator::ReleaseBlock(void *ptr, size_t size)
+{
+	if (size > kLargestPooledBlock)
+	{
+		free(ptr);
+		return;
+	}
+
+	FreeBlock *block = static_cast<FreeBlock *>(ptr);
+	int size_class = SizeClass(size);
+	block->next = m_free[size_class];
+	m_free[size_class] = block;
+}
+
+// lua_Alloc semantics: without a block, osize is the type of the object
+// being made, not a size
+void *LuaAllocator::Allocate(void *ptr, size_t osize, size_t nsize)
+{
+	if (!ptr)
+		osize = 0;
+
+	if (nsize == 0)
+	{
+		if (ptr)
+		{
+			ReleaseBlock(ptr, osize);
+			m_in_use -= osize;
+		}
+		return NULL;
+	}
+
+	// shrinking must not fail, but growing past the cap must
+	if (nsize > osize && m_limit && m_in_use + (nsize - osize) > m_limit)
+		return NULL;
+
+	void *block;
+	if (!ptr)
+		block = AllocateBlock(nsize);
+	else if (osize > kLargestPooledBlock && nsize > kLargestPooledBlock)
+		block = realloc(ptr, nsize);
+	else if (osize <= kLargestPooledBlock && nsize <= kLargestPooledBlock && SizeClass(osize) == SizeClass(nsize))
+		block = ptr;
+	else
+	{
+		block = AllocateBlock(nsize);
+		if (block)
+		{
+			memcpy(block, ptr, MIN(osize, nsize));
+			ReleaseBlock(ptr, osize);
+		}
+	}
+
+	if (!block)
+		return NULL;
+
+	m_in_use += nsize;
+	m_in_use -= osize;
+	m_peak = MAX(m_peak, m_in_use);
+	return block;
+}
+
+static size_t memory_limit = 0;
+static std::map<lua_State *, LuaAllocator *> allocators;
+
+static void *allocate(void *ud, void *ptr, size_t osize, size_t nsize)
+{
+	return static_cast<LuaAllocator *>(ud)->Allocate(ptr, osize, nsize);
+}
+
+static int panic(lua_State *L)
+{
+	logFatal("unprotected error in call to Lua API (%s)", lua_tostring(L, -1));
+	return 0;
+}
+
+lua_State *L_New_State()
+{
+	LuaAllocator *allocator = new LuaAllocator(memory_limit);
+	lua_State *L = lua_newstate(allocate, allocator);
+	if (!L)
+	{
+		delete allocator;
+		return NULL;
+	}
+
+	lua_atpanic(L, panic);
+	allocators[L] = allocator;
+	return L;
+}
+
+void L_Close_State(lua_State *L)
+{
+	std::map<lua_State *, LuaAllocator *>::iterator it = allocators.find(L);
+	if (it == allocators.end())
+	{
+		lua_close(L);
+		return;
+	}
+
+	LuaAllocator *allocator = it->second;
+	allocators.erase(it);
+	lua_close(L);
+	delete allocator;
+}
+
+void L_Get_Memory_Usage(lua_State *L, size_t& in_use, size_t& peak)
+{
+	in_use = peak = 0;
+	std::map<lua_State *, LuaAllocator *>::iterator it = allocators.find(L);
+	if (it != allocators.end())
+	{
+		in_use = it->second->InUse();
+		peak = it->second->Peak();
+	}
+}
+
+size_t L_Get_Total_Memory_Usage()
+{
+	size_t in_use = 0;
+	for (std::map<lua_State *, LuaAllocator *>::iterator it = allocators.begin(); it != allocators.end(); ++it)
+		in_use += it->second->InUse();
+	return in_use;
+}
+
+void L_Set_Memory_Limit(size_t bytes)
+{
+	memory_limit = bytes;
+}
+
+size_t L_Get_Memory_Limit()
+{
+	return memory_limit;
+}
+
+#endif
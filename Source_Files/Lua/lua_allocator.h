@@ -0,0 +1,55 @@
+#ifndef __LUA_ALLOCATOR_H
+#define __LUA_ALLOCATOR_H
+
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  Lua allocator: each state gets its own pools of small blocks in a few size
+  classes, carved out of large slabs, so the tables, closures and strings
+  that scripts make and drop every tick don't go through malloc (nor contend
+  with other threads for it); bigger blocks still do.  What each state uses
+  is counted, and can be capped.
+
+ */
+
+#include "cseries.h"
+
+#ifdef HAVE_LUA
+extern "C"
+{
+#include "lua.h"
+}
+
+// A state allocating from its own pools; close with L_Close_State()
+lua_State *L_New_State();
+void L_Close_State(lua_State *L);
+
+// Bytes a state's allocations hold now, and at most so far
+void L_Get_Memory_Usage(lua_State *L, size_t& in_use, size_t& peak);
+
+// What all the states' allocations hold now
+size_t L_Get_Total_Memory_Usage();
+
+// Applies to states made afterwards; 0 for none.  Allocations past the cap
+// fail, which scripts see as a memory error
+void L_Set_Memory_Limit(size_t bytes);
+size_t L_Get_Memory_Limit();
+
+#endif
+
+#endif
@@ -0,0 +1,348 @@
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  Lua benchmark (see lua_benchmark.h)
+
+ */
+
+#include "cseries.h"
+#include "lua_benchmark.h"
+
+#include "Logging.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_LUA
+
+#include "lua_script.h"
+#include "sim_benchmark.h"
+#include "map.h"
+#include "monsters.h"
+
+#include <SDL_timer.h>
+#include <string>
+#include <vector>
+
+enum /* how a workload is timed */
+{
+	_timed_idle, // Triggers.idle does the operations
+	_timed_got_item, // each operation is a got_item trigger called
+	_timed_serialization // each operation is an entry of the persistent table saved, then restored
+};
+
+struct lua_workload
+{
+	const char *name;
+	const char *operation;
+	int timing;
+	// with "%d" for the operations per call
+	const char *script;
+};
+
+static const lua_workload workloads[] = {
+	{ "monster fields", "read m.vitality", _timed_idle,
+		"Triggers = {}\n"
+		"local ops = %d\n"
+		"local monsters = {}\n"
+		"function Triggers.init()\n"
+		"  for m in Monsters() do monsters[#monsters + 1] = m end\n"
+		"end\n"
+		"function Triggers.idle()\n"
+		"  local count, sum = #monsters, 0\n"
+		"  if count == 0 then return end\n"
+		"  for i = 1, ops do sum = sum + monsters[1 + i %% count].vitality end\n"
+		"end\n" },
+	{ "polygon fields", "read p.floor.height", _timed_idle,
+		"Triggers = {}\n"
+		"local ops = %d\n"
+		"function Triggers.idle()\n"
+		"  local count, sum = #Polygons, 0\n"
+		"  for i = 1, ops do sum = sum + Polygons[i %% count].floor.height end\n"
+		"end\n" },
+	{ "player fields", "read Players[0].x", _timed_idle,
+		"Triggers = {}\n"
+		"local ops = %d\n"
+		"function Triggers.idle()\n"
+		"  local sum = 0\n"
+		"  for i = 1, ops do sum = sum + Players[0].x end\n"
+		"end\n" },
+	{ "monster iteration", "one monster from Monsters()", _timed_idle,
+		"Triggers = {}\n"
+		"local ops = %d\n"
+		"function Triggers.idle()\n"
+		"  local n = 0\n"
+		"  while n < ops do\n"
+		"    local before = n\n"
+		"    for m in Monsters() do n = n + 1; if n >= ops then break end end\n"
+		"    if n == before then break end\n"
+		"  end\n"
+		"end\n" },
+	{ "polygon iteration", "one polygon from Polygons()", _timed_idle,
+		"Triggers = {}\n"
+		"local ops = %d\n"
+		"function Triggers.idle()\n"
+		"  local n = 0\n"
+		"  while n < ops do\n"
+		"    local before = n\n"
+		"    for p in Polygons() do n = n + 1; if n >= ops then break end end\n"
+		"    if n == before then break end\n"
+		"  end\n"
+		"end\n" },
+	{ "object creation", "Effects.new() and delete()", _timed_idle,
+		"Triggers = {}\n"
+		"local ops = %d\n"
+		"function Triggers.idle()\n"
+		"  local p = Polygons[1]\n"
+		"  for i = 1, ops do\n"
+		"    local e = Effects.new(p.x, p.y, p.z + 0.5, p, 0)\n"
+		"    if e then e:delete() end\n"
+		"  end\n"
+		"end\n" },
+	{ "trigger dispatch", "got_item called", _timed_got_item,
+		"Triggers = {}\n"
+		"local ops = %d\n"
+		"local count = 0\n"
+		"function Triggers.got_item(type, player) count = count + 1 end\n" },
+	{ "serialization", "persistent table entry", _timed_serialization,
+		"Triggers = {}\n"
+		"local ops = %d\n"
+		"function Triggers.init()\n"
+		"  local data = {}\n"
+		"  for i = 1, ops do data[i] = { index = i, name = \"entry \" .. i, even = i %% 2 == 0 } end\n"
+		"  Game.benchmark_data = data\n"
+		"end\n"
+		"function Triggers.idle() Game.restore_saved() end\n" }
+};
+
+static const int kWorkloadCount = sizeof(workloads)/sizeof(workloads[0]);
+
+static const struct { ScriptType type; const char *name; } state_types[] = {
+	{ _embedded_lua_script, "embedded" },
+	{ _lua_netscript, "netscript" },
+	{ _solo_lua_script, "solo" },
+	{ _stats_lua_script, "stats" }
+};
+
+static const int kStateTypeCount = sizeof(state_types)/sizeof(state_types[0]);
+
+static double counter_ns(uint64_t counts)
+{
+	return counts * 1.0e9 / SDL_GetPerformanceFrequency();
+}
+
+// Nanoseconds per operation, in result[0] (and the restore's in result[1]);
+// false if the script didn't load or run
+static bool time_workload(const lua_workload& workload, ScriptType type, const lua_benchmark_parameters& parameters, double result[2])
+{
+	std::vector<char> script(strlen(workload.script) + 16);
+	snprintf(&script[0], script.size(), workload.script, int(parameters.op_count));
+
+	CloseLuaScript();
+	ResetPassedLua();
+	if (!LoadLuaScript(&script[0], strlen(&script[0]), type) || !RunLuaScript())
+	{
+		CloseLuaScript();
+		return false;
+	}
+	L_Call_Init(false);
+
+	double operations = double(parameters.call_count) * parameters.op_count;
+	uint64_t start, elapsed = 0;
+	switch (workload.timing)
+	{
+	case _timed_idle:
+		// once before timing, for whatever the first call sets up
+		L_Call_Idle();
+		start = SDL_GetPerformanceCounter();
+		for (int32 call = 0; call < parameters.call_count; ++call)
+		{
+			L_Call_Idle();
+			L_Call_PostIdle();
+		}
+		elapsed = SDL_GetPerformanceCounter() - start;
+		break;
+
+	case _timed_got_item:
+		start = SDL_GetPerformanceCounter();
+		for (int32 call = 0; call < parameters.call_count; ++call)
+		{
+			for (int32 op = 0; op < parameters.op_count; ++op)
+				L_Call_Got_Item(0, 0);
+		}
+		elapsed = SDL_GetPerformanceCounter() - start;
+		break;
+
+	case _timed_serialization:
+		{
+			std::vector<uint8> data;
+			start = SDL_GetPerformanceCounter();
+			for (int32 call = 0; call < parameters.call_count; ++call)
+			{
+				data.resize(save_lua_states());
+				if (data.size())
+					pack_lua_states(&data[0], data.size());
+			}
+			elapsed = SDL_GetPerformanceCounter() - start;
+
+			// Game.restore_saved() reads what was saved last
+			if (data.size())
+				unpack_lua_states(&data[0], data.size());
+			start = SDL_GetPerformanceCounter();
+			for (int32 call = 0; call < parameters.call_count; ++call)
+				L_Call_Idle();
+			result[1] = counter_ns(SDL_GetPerformanceCounter() - start) / operations;
+		}
+		break;
+	}
+	result[0] = counter_ns(elapsed) / operations;
+
+	L_Call_Cleanup();
+	CloseLuaScript();
+	return true;
+}
+
+static bool parse_parameter(const char *key, size_t key_length, int value, lua_benchmark_parameters& parameters)
+{
+	struct { const char *name; int16 *value16; int32 *value32; int minimum, maximum; } fields[] = {
+		{ "grid", &parameters.grid_size, NULL, 2, INT16_MAX },
+		{ "monsters", &parameters.monster_count, NULL, 0, INT16_MAX },
+		{ "calls", NULL, &parameters.call_count, 1, INT32_MAX },
+		{ "ops", NULL, &parameters.op_count, 1, INT32_MAX }
+	};
+
+	for (size_t i = 0; i < sizeof(fields)/sizeof(fields[0]); ++i)
+	{
+		if (strlen(fields[i].name) != key_length || strncmp(fields[i].name, key, key_length) != 0)
+			continue;
+
+		value = PIN(value, fields[i].minimum, fields[i].maximum);
+		if (fields[i].value16)
+			*fields[i].value16 = static_cast<int16>(value);
+		else
+			*fields[i].value32 = value;
+		return true;
+	}
+	return false;
+}
+
+bool parse_lua_benchmark_parameters(const char *spec, lua_benchmark_parameters& parameters)
+{
+	if (strcmp(spec, "default") == 0)
+		return true;
+
+	while (*spec)
+	{
+		const char *equals = strchr(spec, '=');
+		if (!equals)
+			return false;
+
+		char *end;
+		long value = strtol(equals + 1, &end, 10);
+		if (end == equals + 1 || (*end && *end != ','))
+			return false;
+		if (!parse_parameter(spec, equals - spec, static_cast<int>(PIN(value, 0L, long(INT32_MAX))), parameters))
+			return false;
+
+		spec = *end ? end + 1 : end;
+	}
+	return true;
+}
+
+bool run_lua_benchmark(const lua_benchmark_parameters& parameters)
+{
+	// a map with monsters on it, and nothing else going on
+	sim_benchmark_parameters map_parameters;
+	map_parameters.grid_size = parameters.grid_size;
+	map_parameters.monster_count = parameters.monster_count;
+	map_parameters.projectile_count = map_parameters.effect_count = 0;
+	if (!enter_sim_benchmark_map(map_parameters))
+	{
+		logError("luabench: could not enter the map");
+		return false;
+	}
+
+	short monster_count = 0;
+	for (size_t i = 0; i < MonsterList.size(); ++i)
+		if (SLOT_IS_USED(&MonsterList[i])) ++monster_count;
+
+	char report[512];
+	snprintf(report, sizeof(report),
+		"luabench: %d polygons, %d monsters; %d calls of %d operations per workload and state, ns per operation",
+		int(dynamic_world->polygon_count), int(monster_count), int(parameters.call_count), int(parameters.op_count));
+	logNote("%s", report);
+	printf("%s\n", report);
+
+	bool success = true;
+	for (int w = 0; w < kWorkloadCount; ++w)
+	{
+		const lua_workload& workload = workloads[w];
+		bool serialization = workload.timing == _timed_serialization;
+
+		double results[kStateTypeCount][2];
+		bool ran[kStateTypeCount];
+		for (int s = 0; s < kStateTypeCount; ++s)
+		{
+			ran[s] = time_workload(workload, state_types[s].type, parameters, results[s]);
+			if (!ran[s])
+			{
+				logError("luabench: the %s script did not run in the %s state", workload.name, state_types[s].name);
+				success = false;
+			}
+		}
+
+		for (int phase = 0; phase < (serialization ? 2 : 1); ++phase)
+		{
+			int length = snprintf(report, sizeof(report), "luabench %s%s (%s):", workload.name,
+				serialization ? (phase ? " restore" : " save") : "", workload.operation);
+			for (int s = 0; s < kStateTypeCount && length < int(sizeof(report)); ++s)
+			{
+				if (ran[s])
+					length += snprintf(report + length, sizeof(report) - length, " %s %.1f%s",
+						state_types[s].name, results[s][phase], s + 1 < kStateTypeCount ? "," : "");
+				else
+					length += snprintf(report + length, sizeof(report) - length, " %s failed%s",
+						state_types[s].name, s + 1 < kStateTypeCount ? "," : "");
+			}
+			logNote("%s", report);
+			printf("%s\n", report);
+		}
+	}
+
+	leaving_map();
+	return success;
+}
+
+#else
+
+bool parse_lua_benchmark_parameters(const char *spec, lua_benchmark_parameters& parameters)
+{
+	(void) (spec);
+	(void) (parameters);
+	return true;
+}
+
+bool run_lua_benchmark(const lua_benchmark_parameters& parameters)
+{
+	(void) (parameters);
+	logError("luabench: built without Lua");
+	return false;
+}
+
+#endif /* HAVE_LUA */
@@ -0,0 +1,51 @@
+#ifndef __LUA_BENCHMARK_H
+#define __LUA_BENCHMARK_H
+
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  Lua benchmark: on the simulation benchmark's generated map, runs small
+  scripts that each do one thing through the bindings over and over (read
+  monster, polygon and player fields, iterate Monsters and Polygons, create
+  and delete effects, have triggers called, save and restore the persistent
+  table), once in each kind of Lua state, and reports nanoseconds per
+  operation, so that changes to the binding layer can be compared
+
+ */
+
+#include "cseries.h"
+
+struct lua_benchmark_parameters
+{
+	int16 grid_size, monster_count; // the map's (see sim_benchmark.h)
+	int32 call_count; // triggers called per workload and state
+	int32 op_count; // operations per trigger call
+
+	lua_benchmark_parameters() :
+		grid_size(32), monster_count(100), call_count(200), op_count(1000) { }
+};
+
+// Reads "key=value,key=value..." (grid, monsters, calls, ops) over the
+// defaults; "default" keeps them
+bool parse_lua_benchmark_parameters(const char *spec, lua_benchmark_parameters& parameters);
+
+// Needs the shapes file open; replaces whatever map is loaded, logs and prints
+// the results, and returns whether every script loaded and ran
+bool run_lua_benchmark(const lua_benchmark_parameters& parameters);
+
+#endif
@@ -0,0 +1,174 @@
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  Lua bytecode cache (see lua_cache.h)
+
+ */
+
+#include "lua_cache.h"
+
+#ifdef HAVE_LUA
+
+extern "C"
+{
+#include "lauxlib.h"
+}
+
+#include "crc.h"
+#include "FileHandler.h"
+#include "Logging.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+static const uint32 luaCacheMagic = FOUR_CHARS_TO_INT('A','1','L','C');
+
+// past this, the entries written longest ago go first
+static const int64_t luaCacheMaximumSize = 16 * 1024 * 1024;
+
+// bytecode only loads into the same Lua release with the same number and
+// pointer sizes
+static std::string cache_key(const char *buffer, size_t len, const char *name)
+{
+	char build[64];
+	sprintf(build, "%s %d %d %d\n", LUA_RELEASE, int(sizeof(lua_Number)), int(sizeof(size_t)), int(sizeof(int)));
+
+	std::string key = build;
+	key += name;
+	key += '\0';
+	key.append(buffer, len);
+	return key;
+}
+
+static DirectorySpecifier cache_directory()
+{
+	DirectorySpecifier dir;
+	dir.SetToLocalDataDir();
+	dir += "Lua Cache";
+	return dir;
+}
+
+static bool cache_file(const std::string& key, FileSpecifier& file)
+{
+	DirectorySpecifier dir = cache_directory();
+	if (!dir.Exists() && !dir.CreateDirectory())
+		return false;
+
+	char name[32];
+	sprintf(name, "%08x.luac", calculate_data_crc((unsigned char *) key.data(), key.size()));
+	file = dir + name;
+	return true;
+}
+
+static bool load_bytecode(const std::string& key, std::vector<char>& bytecode)
+{
+	FileSpecifier file;
+	if (!cache_file(key, file) || !file.Exists())
+		return false;
+
+	OpenedFile of;
+	if (!file.Open(of))
+		return false;
+
+	int32 length;
+	uint32 header[3];
+	if (!of.GetLength(length) || !of.Read(sizeof(header), header))
+		return false;
+	if (header[0] != luaCacheMagic || header[1] != key.size())
+		return false;
+
+	// a truncated or corrupt entry mustn't make us allocate what it claims
+	if (length < 0 || uint32(length) < sizeof(header) + header[1] || header[2] != uint32(length) - sizeof(header) - header[1])
+		return false;
+
+	std::string stored_key(header[1], '\0');
+	if (!of.Read(header[1], &stored_key[0]) || stored_key != key)
+		return false;
+
+	bytecode.resize(header[2]);
+	return !bytecode.empty() && of.Read(bytecode.size(), &bytecode[0]);
+}
+
+static int write_bytecode(lua_State *, const void *p, size_t size, void *ud)
+{
+	std::vector<char>& bytecode = *static_cast<std::vector<char> *>(ud);
+	const char *bytes = static_cast<const char *>(p);
+	bytecode.insert(bytecode.end(), bytes, bytes + size);
+	return 0;
+}
+
+static void save_bytecode(const std::string& key, const std::vector<char>& bytecode)
+{
+	FileSpecifier file;
+	if (!cache_file(key, file))
+		return;
+	FileSpecifier temp_file;
+	temp_file.SetTempName(file);
+	if (!temp_file.Create(_typecode_unknown))
+		return;
+
+	bool written = false;
+	{
+		OpenedFile of;
+		if (temp_file.Open(of, true))
+		{
+			uint32 header[3] = { luaCacheMagic, uint32(key.size()), uint32(bytecode.size()) };
+			written = of.Write(sizeof(header), header) &&
+				of.Write(key.size(), const_cast<char *>(key.data())) &&
+				of.Write(bytecode.size(), const_cast<char *>(&bytecode[0]));
+		}
+	}
+
+	if (!written || !temp_file.Rename(file))
+	{
+		logWarning("Could not write Lua cache entry %s", file.GetPath());
+		temp_file.Delete();
+		return;
+	}
+
+	cache_directory().PruneDirectory(".luac", luaCacheMaximumSize);
+}
+
+int L_Load_Cached(lua_State *L, const char *buffer, size_t len, const char *name)
+{
+	std::string key = cache_key(buffer, len, name);
+
+	std::vector<char> bytecode;
+	if (load_bytecode(key, bytecode))
+	{
+		if (luaL_loadbufferx(L, &bytecode[0], bytecode.size(), name, "b") == LUA_OK)
+			return LUA_OK;
+
+		// rewrite it below
+		lua_pop(L, 1);
+	}
+
+	int status = luaL_loadbufferx(L, buffer, len, name, "t");
+	if (status != LUA_OK)
+		return status;
+
+	bytecode.clear();
+	lua_dump(L, write_bytecode, &bytecode);
+	if (!bytecode.empty())
+		save_bytecode(key, bytecode);
+
+	return LUA_OK;
+}
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef __LUA_CACHE_H
+#define __LUA_CACHE_H
+
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  Lua bytecode cache: scripts compiled once are dumped to the local data
+  directory, keyed by their source, their name and the Lua build, and
+  loaded from there as bytecode the next time
+
+ */
+
+#include "cseries.h"
+
+#ifdef HAVE_LUA
+extern "C"
+{
+#include "lua.h"
+}
+
+// Like luaL_loadbufferx(L, buffer, len, name, "t"), but from the cache when
+// the same source was compiled before; only ever loads bytecode the cache
+// wrote itself
+int L_Load_Cached(lua_State *L, const char *buffer, size_t len, const char *name);
+
+#endif
+
+#endif
@@ -47,6 +47,9 @@ extern "C"
 
 #include "lua_hud_script.h"
 #include "lua_hud_objects.h"
+#include "lua_allocator.h"
+#include "lua_cache.h"
+#include "lua_profiler.h"
 
 #include <boost/shared_ptr.hpp>
 #include <boost/iostreams/device/array.hpp>
@@ -62,6 +65,7 @@ void L_Call_HUDInit() {}
 void L_Call_HUDCleanup() {}
 void L_Call_HUDDraw() {}
 void L_Call_HUDResize() {}
+void L_Step_HUDGarbageCollector() {}
 
 #else /* HAVE_LUA */
 
@@ -91,11 +95,13 @@ void* L_Persistent_Table_Key();
 class LuaHUDState
 {
 public:
-	LuaHUDState() : running_(false), inited_(false), num_scripts_(0) {
-		state_.reset(luaL_newstate(), lua_close);
+	LuaHUDState() : running_(false), inited_(false), num_scripts_(0), collected_tick_(NONE), trigger_("") {
+		state_.reset(L_New_State(), L_Close_State);
+		LuaProfiler::instance()->Attach(State(), "HUD Lua");
 	}
 
 	virtual ~LuaHUDState() {
+		LuaProfiler::instance()->Detach(State());
 	}
 
 public:
@@ -106,6 +112,7 @@ public:
 	bool Run();
 	void Stop() { running_ = false; }
 	void MarkCollections(std::set<short>& collections);
+	void StepGarbageCollector();
 
 	virtual void Initialize() {
 		const luaL_Reg *lib = lualibs;
@@ -114,6 +121,7 @@ public:
 			luaL_requiref(State(), lib->name, lib->func, 1);
 			lua_pop(State(), 1);
 		}
+		L_Configure_Garbage_Collector(State());
 		
 		RegisterFunctions();
 	}
@@ -142,6 +150,10 @@ private:
 	bool running_;
 	int num_scripts_;
     bool inited_;
+	int32 collected_tick_;
+
+	// the last trigger GetTrigger() found, for the profiler
+	const char *trigger_;
 };
 
 LuaHUDState *hud_state = NULL;
@@ -167,12 +179,17 @@ bool LuaHUDState::GetTrigger(const char* trigger)
 	}
 
 	lua_remove(State(), -2);
+	trigger_ = trigger;
 	return true;
 }
 
 void LuaHUDState::CallTrigger(int numArgs)
 {
-	if (lua_pcall(State(), numArgs, 0, 0) == LUA_ERRRUN)
+	LuaProfiler::instance()->BeginTrigger(State(), trigger_);
+	int result = lua_pcall(State(), numArgs, 0, 0);
+	LuaProfiler::instance()->EndTrigger(State());
+
+	if (result == LUA_ERRRUN)
 		L_Error(lua_tostring(State(), -1));
 }
 
@@ -215,7 +232,7 @@ void LuaHUDState::RegisterFunctions()
 
 bool LuaHUDState::Load(const char *buffer, size_t len)
 {
-	int status = luaL_loadbufferx(State(), buffer, len, "HUD Lua", "t");
+	int status = L_Load_Cached(State(), buffer, len, "HUD Lua");
 	if (status == LUA_ERRRUN)
 		logWarning("Lua loading failed: error running script.");
 	if (status == LUA_ERRFILE)
@@ -296,6 +313,17 @@ void LuaHUDState::MarkCollections(std::set<short>& collections)
 }
 
 
+// Only the HUD collects while waiting for a tick, as how long that wait
+// is doesn't change what a game script sees
+void LuaHUDState::StepGarbageCollector()
+{
+	if (!running_ || collected_tick_ == dynamic_world->tick_count)
+		return;
+
+	L_Step_Garbage_Collector(State());
+	collected_tick_ = dynamic_world->tick_count;
+}
+
 bool LuaHUDRunning()
 {
 	return (hud_state && hud_state->Running());
@@ -325,6 +353,12 @@ void L_Call_HUDResize()
 		hud_state->Resize();
 }
 
+void L_Step_HUDGarbageCollector()
+{
+	if (hud_state)
+		hud_state->StepGarbageCollector();
+}
+
 
 bool LoadLuaHUDScript(const char *buffer, size_t len)
 {
@@ -31,6 +31,9 @@ void L_Call_HUDCleanup();
 void L_Call_HUDDraw();
 void L_Call_HUDResize();
 
+// Once a tick, while waiting for the next
+void L_Step_HUDGarbageCollector();
+
 bool LoadLuaHUDScript(const char *buffer, size_t len);
 bool RunLuaHUDScript();
 bool LuaHUDRunning();
@@ -26,6 +26,7 @@ LUA_MAP.CPP
 #include "lua_monsters.h"
 #include "lua_objects.h"
 #include "lua_templates.h"
+#include "flood_map.h"
 #include "lightsource.h"
 #include "map.h"
 #include "media.h"
@@ -426,6 +427,7 @@ static int Lua_Platform_Set_Ceiling_Height(lua_State *L)
 	platform->ceiling_height = static_cast<world_distance>(lua_tonumber(L, 2) * WORLD_ONE);
 	adjust_platform_endpoint_and_line_heights(platform_index);
 	adjust_platform_for_media(platform_index, false);
+	invalidate_path_cache();
 	
 	return 0;
 }	
@@ -441,6 +443,7 @@ static int Lua_Platform_Set_Contracting(lua_State *L)
 		SET_PLATFORM_IS_CONTRACTING(platform);
 	else
 		SET_PLATFORM_IS_EXTENDING(platform);
+	invalidate_path_cache();
 	return 0;
 }
 
@@ -455,6 +458,7 @@ static int Lua_Platform_Set_Extending(lua_State *L)
 		SET_PLATFORM_IS_EXTENDING(platform);
 	else
 		SET_PLATFORM_IS_CONTRACTING(platform);
+	invalidate_path_cache();
 	return 0;
 }
 
@@ -469,6 +473,7 @@ static int Lua_Platform_Set_Floor_Height(lua_State *L)
 	platform->floor_height = static_cast<world_distance>(lua_tonumber(L, 2) * WORLD_ONE);
 	adjust_platform_endpoint_and_line_heights(platform_index);
 	adjust_platform_for_media(platform_index, false);
+	invalidate_path_cache();
 	
 	return 0;
 }	
@@ -487,6 +492,7 @@ static int Lua_Platform_Set_Type(lua_State* L)
 {
 	platform_data* platform = get_platform_data(Lua_Platform::Index(L, 1));
 	platform->type = Lua_PlatformType::ToIndex(L, 2);
+	invalidate_path_cache();
 	return 0;
 }
 	
@@ -597,6 +603,7 @@ static int Lua_Polygon_Floor_Set_Height(lua_State *L)
 		recalculate_redundant_endpoint_data(polygon->endpoint_indexes[i]);
 		recalculate_redundant_line_data(polygon->line_indexes[i]);
 	}
+	invalidate_path_cache();
 	return 0;
 }
 
@@ -751,6 +758,7 @@ static int Lua_Polygon_Ceiling_Set_Height(lua_State *L)
 		recalculate_redundant_endpoint_data(polygon->endpoint_indexes[i]);
 		recalculate_redundant_line_data(polygon->line_indexes[i]);
 	}
+	invalidate_path_cache();
 	return 0;
 }
 
@@ -1384,6 +1392,7 @@ static int Lua_Polygon_Set_Media(lua_State *L)
 	}
 
 	polygon->media_index = media_index;
+	invalidate_path_cache();
 	return 0;
 }
 		
@@ -1394,6 +1403,7 @@ static int Lua_Polygon_Set_Permutation(lua_State *L)
 	
 	int permutation = static_cast<int>(lua_tonumber(L, 2));
 	get_polygon_data(Lua_Polygon::Index(L, 1))->permutation = permutation;
+	invalidate_path_cache();
 	return 0;
 }
 
@@ -1416,6 +1426,7 @@ static int Lua_Polygon_Set_Type(lua_State *L)
 	}
 
 	get_polygon_data(Lua_Polygon::Index(L, 1))->type = type;
+	invalidate_path_cache();
 	return 0;
 }
 
@@ -1536,6 +1547,7 @@ static int Lua_Side_ControlPanel_Set_Permutation(lua_State *L)
 
 	side_data *side = get_side_data(Lua_Side_ControlPanel::Index(L, 1));
 	side->control_panel_permutation = static_cast<int16>(lua_tonumber(L, 2));
+	side_permutations_changed();
 	return 0;
 }
 
@@ -2503,6 +2515,7 @@ static int Lua_Light_Set_Tag(lua_State* L)
 
 	light_data* data = get_light_data(Lua_Light::Index(L, 1));
 	data->static_data.tag = tag;
+	light_tags_changed();
 	return 0;
 }
 
@@ -1007,8 +1007,103 @@ int Lua_Monsters_New(lua_State *L)
 	return 1;
 }
 
+static short Lua_Monsters_Polygon_Argument(lua_State *L, int index)
+{
+	if (lua_isnumber(L, index))
+	{
+		int polygon_index = static_cast<int>(lua_tonumber(L, index));
+		if (!Lua_Polygon::Valid(polygon_index))
+			luaL_error(L, "in_polygons: invalid polygon index");
+		return polygon_index;
+	}
+	else if (Lua_Polygon::Is(L, index))
+		return Lua_Polygon::Index(L, index);
+
+	luaL_error(L, "in_polygons: incorrect argument type");
+	return NONE;
+}
+
+// Monsters.in_polygons(polygon, ...) or Monsters.in_polygons({polygon, ...})
+int Lua_Monsters_In_Polygons(lua_State *L)
+{
+	std::vector<short> polygon_indexes;
+	if (lua_istable(L, 1))
+	{
+		for (int i = 1; ; i++)
+		{
+			lua_rawgeti(L, 1, i);
+			if (lua_isnil(L, -1))
+				break;
+			polygon_indexes.push_back(Lua_Monsters_Polygon_Argument(L, -1));
+			lua_pop(L, 1);
+		}
+		lua_pop(L, 1);
+	}
+	else
+	{
+		for (int i = 1; i <= lua_gettop(L); i++)
+			polygon_indexes.push_back(Lua_Monsters_Polygon_Argument(L, i));
+	}
+
+	// straight off the polygons' object lists
+	lua_newtable(L);
+	int table_index = 1;
+	for (size_t i = 0; i < polygon_indexes.size(); i++)
+	{
+		short object_index = get_polygon_data(polygon_indexes[i])->first_object;
+		while (object_index != NONE)
+		{
+			object_data *object = get_object_data(object_index);
+			if (GET_OBJECT_OWNER(object) == _object_is_monster)
+			{
+				Lua_Monster::Push(L, object->permutation);
+				lua_rawseti(L, -2, table_index++);
+			}
+
+			object_index = object->next_object;
+		}
+	}
+
+	return 1;
+}
+
+// Monsters.within(x, y, z, radius)
+int Lua_Monsters_Within(lua_State *L)
+{
+	if (!lua_isnumber(L, 1) || !lua_isnumber(L, 2) || !lua_isnumber(L, 3) || !lua_isnumber(L, 4))
+		return luaL_error(L, "within: incorrect argument type");
+
+	double x = lua_tonumber(L, 1) * WORLD_ONE;
+	double y = lua_tonumber(L, 2) * WORLD_ONE;
+	double z = lua_tonumber(L, 3) * WORLD_ONE;
+	double radius = lua_tonumber(L, 4) * WORLD_ONE;
+
+	lua_newtable(L);
+	int table_index = 1;
+	for (int16 monster_index = 0; monster_index < MAXIMUM_MONSTERS_PER_MAP; monster_index++)
+	{
+		monster_data *monster = GetMemberWithBounds(monsters, monster_index, MAXIMUM_MONSTERS_PER_MAP);
+		if (!SLOT_IS_USED(monster))
+			continue;
+
+		object_data *object = get_object_data(monster->object_index);
+		double dx = object->location.x - x;
+		double dy = object->location.y - y;
+		double dz = object->location.z - z;
+		if (dx * dx + dy * dy + dz * dz <= radius * radius)
+		{
+			Lua_Monster::Push(L, monster_index);
+			lua_rawseti(L, -2, table_index++);
+		}
+	}
+
+	return 1;
+}
+
 const luaL_Reg Lua_Monsters_Methods[] = {
+	{"in_polygons", L_TableFunction<Lua_Monsters_In_Polygons>},
 	{"new", L_TableFunction<Lua_Monsters_New>},
+	{"within", L_TableFunction<Lua_Monsters_Within>},
 	{0, 0}
 };
 
@@ -2230,8 +2230,32 @@ int Lua_Players_Get_Local_Player(lua_State *L)
 	return 1;
 }
 
+// Players.positions() returns tables of x, y, z and polygon, by player index
+int Lua_Players_Positions(lua_State *L)
+{
+	lua_createtable(L, dynamic_world->player_count, 0);
+	lua_createtable(L, dynamic_world->player_count, 0);
+	lua_createtable(L, dynamic_world->player_count, 0);
+	lua_createtable(L, dynamic_world->player_count, 0);
+	for (int player_index = 0; player_index < dynamic_world->player_count; player_index++)
+	{
+		player_data *player = get_player_data(player_index);
+		lua_pushnumber(L, (double) player->location.x / WORLD_ONE);
+		lua_rawseti(L, -5, player_index);
+		lua_pushnumber(L, (double) player->location.y / WORLD_ONE);
+		lua_rawseti(L, -4, player_index);
+		lua_pushnumber(L, (double) player->location.z / WORLD_ONE);
+		lua_rawseti(L, -3, player_index);
+		Lua_Polygon::Push(L, player->supporting_polygon_index);
+		lua_rawseti(L, -2, player_index);
+	}
+
+	return 4;
+}
+
 const luaL_Reg Lua_Players_Get[] = {
 	{"local_player", Lua_Players_Get_Local_Player},
+	{"positions", L_TableFunction<Lua_Players_Positions>},
 	{"print", L_TableFunction<Lua_Players_Print>},
 	{0, 0}
 };
@@ -0,0 +1,460 @@
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  Lua profiler
+
+ */
+
+#include "lua_profiler.h"
+#include "lua_allocator.h"
+
+#ifdef HAVE_LUA
+
+#include "Console.h"
+#include "FileHandler.h"
+#include "Logging.h"
+#include "shell.h"
+
+#include <stdio.h>
+#include <algorithm>
+
+LuaProfiler *LuaProfiler::m_instance = NULL;
+
+static const char *report_name = "Lua Profile.txt";
+
+static double milliseconds(uint64_t ticks)
+{
+	return ticks * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+static bool by_self_time(const LuaProfiler::Entry *a, const LuaProfiler::Entry *b)
+{
+	return a->self > b->self;
+}
+
+static void sort_entries(const std::vector<LuaProfiler::Entry>& entries, std::vector<const LuaProfiler::Entry *>& sorted)
+{
+	sorted.clear();
+	for (size_t i = 0; i < entries.size(); i++)
+		sorted.push_back(&entries[i]);
+	std::stable_sort(sorted.begin(), sorted.end(), by_self_time);
+}
+
+void LuaProfiler::HookFunction(lua_State *L, lua_Debug *ar)
+{
+	// every thread of a state shares its allocator, which knows the state
+	void *ud;
+	if (lua_getallocf(L, &ud) != AllocFunction)
+		return;
+
+	StateRecord& state = *static_cast<StateRecord *>(ud);
+	instance()->Hook(L, state, ar);
+
+	// both count every COUNT_INTERVAL instructions
+	if (ar->event == LUA_HOOKCOUNT && state.hook && (state.hook_mask & LUA_MASKCOUNT))
+		state.hook(L, ar);
+}
+
+void *LuaProfiler::AllocFunction(void *ud, void *ptr, size_t osize, size_t nsize)
+{
+	StateRecord *state = static_cast<StateRecord *>(ud);
+
+	// without a block, osize is the type of the object being made
+	if (nsize && (!ptr || nsize > osize))
+		instance()->Allocated(*state, ptr ? nsize - osize : nsize);
+
+	return state->alloc(state->alloc_ud, ptr, osize, nsize);
+}
+
+void LuaProfiler::Start()
+{
+	Clear();
+	active = true;
+	for (std::map<lua_State *, StateRecord>::iterator it = states.begin(); it != states.end(); ++it)
+		Install(it->first, it->second);
+}
+
+void LuaProfiler::Stop()
+{
+	for (std::map<lua_State *, StateRecord>::iterator it = states.begin(); it != states.end(); ++it)
+		Uninstall(it->first, it->second);
+	active = false;
+}
+
+void LuaProfiler::Attach(lua_State *L, const std::string& name)
+{
+	StateRecord& state = states[L];
+	state.name = name;
+	state.main_thread = L;
+	if (active && !state.hooked)
+		Install(L, state);
+}
+
+void LuaProfiler::Detach(lua_State *L)
+{
+	std::map<lua_State *, StateRecord>::iterator it = states.find(L);
+	if (it == states.end())
+		return;
+
+	Uninstall(it->first, it->second);
+	states.erase(it);
+}
+
+void LuaProfiler::Install(lua_State *L, StateRecord& state)
+{
+	if (state.hooked)
+		return;
+
+	state.alloc = lua_getallocf(L, &state.alloc_ud);
+	lua_setallocf(L, AllocFunction, &state);
+	state.hook = lua_gethook(L);
+	state.hook_mask = lua_gethookmask(L);
+	state.hook_count = lua_gethookcount(L);
+	lua_sethook(L, HookFunction, LUA_MASKCALL | LUA_MASKRET | LUA_MASKCOUNT, COUNT_INTERVAL);
+	state.hooked = true;
+	state.running = L;
+}
+
+void LuaProfiler::Uninstall(lua_State *L, StateRecord& state)
+{
+	if (!state.hooked)
+		return;
+
+	// coroutines made while profiling keep the hook, but without our
+	// allocator it does nothing
+	lua_sethook(L, state.hook, state.hook_mask, state.hook_count);
+	lua_setallocf(L, state.alloc, state.alloc_ud);
+	state.hooked = false;
+	state.triggers.clear();
+	state.trigger_depths.clear();
+	state.stacks.clear();
+}
+
+void LuaProfiler::Push(std::vector<Frame>& stack, std::vector<Entry>& entries, size_t entry)
+{
+	entries[entry].calls++;
+
+	Frame frame;
+	frame.entry = entry;
+	frame.started = SDL_GetPerformanceCounter();
+	frame.children = 0;
+	stack.push_back(frame);
+}
+
+void LuaProfiler::Pop(std::vector<Frame>& stack, std::vector<Entry>& entries)
+{
+	Frame frame = stack.back();
+	stack.pop_back();
+
+	uint64_t elapsed = SDL_GetPerformanceCounter() - frame.started;
+	Entry& entry = entries[frame.entry];
+	entry.total += elapsed;
+	entry.self += elapsed - std::min(elapsed, frame.children);
+
+	if (!stack.empty())
+		stack.back().children += elapsed;
+}
+
+static LuaProfiler::Entry new_entry(const std::string& name)
+{
+	LuaProfiler::Entry entry;
+	entry.name = name;
+	entry.calls = 0;
+	entry.total = entry.self = 0;
+	entry.instructions = entry.allocations = entry.bytes = 0;
+	return entry;
+}
+
+size_t LuaProfiler::FunctionEntry(lua_State *L, lua_Debug *ar)
+{
+	lua_getinfo(L, "Sn", ar);
+
+	// Lua functions by where they are defined, C functions by address
+	std::pair<const void *, int> key(ar->source, ar->linedefined);
+	if (ar->what[0] == 'C')
+	{
+		lua_getinfo(L, "f", ar);
+		key = std::make_pair(lua_topointer(L, -1), NONE);
+		lua_pop(L, 1);
+	}
+
+	std::map<std::pair<const void *, int>, size_t>::iterator it = function_index.find(key);
+	if (it != function_index.end())
+		return it->second;
+
+	char name[LUA_IDSIZE + 128];
+	if (ar->what[0] == 'C')
+		snprintf(name, sizeof(name), "[C] %s", ar->name ? ar->name : "?");
+	else if (ar->what[0] == 'm')
+		snprintf(name, sizeof(name), "%s (main chunk)", ar->short_src);
+	else
+		snprintf(name, sizeof(name), "%s:%d %s", ar->short_src, ar->linedefined, ar->name ? ar->name : "");
+
+	function_entries.push_back(new_entry(name));
+	function_index[key] = function_entries.size() - 1;
+	return function_entries.size() - 1;
+}
+
+void LuaProfiler::Hook(lua_State *L, StateRecord& state, lua_Debug *ar)
+{
+	state.running = L;
+	std::vector<Frame>& stack = state.stacks[L];
+
+	// a trigger only unwinds what it called
+	size_t floor = 0;
+	if (L == state.main_thread && !state.trigger_depths.empty())
+		floor = state.trigger_depths.back();
+
+	switch (ar->event)
+	{
+		case LUA_HOOKTAILCALL:
+			// the caller is replaced, and won't return
+			if (stack.size() > floor)
+				Pop(stack, function_entries);
+			Push(stack, function_entries, FunctionEntry(L, ar));
+			break;
+		case LUA_HOOKCALL:
+			Push(stack, function_entries, FunctionEntry(L, ar));
+			break;
+		case LUA_HOOKRET:
+			if (stack.size() > floor)
+				Pop(stack, function_entries);
+			break;
+		case LUA_HOOKCOUNT:
+			if (!stack.empty())
+				function_entries[stack.back().entry].instructions += COUNT_INTERVAL;
+			if (!state.triggers.empty())
+				trigger_entries[state.triggers.back().entry].instructions += COUNT_INTERVAL;
+			break;
+	}
+}
+
+void LuaProfiler::Allocated(StateRecord& state, size_t bytes)
+{
+	if (!state.triggers.empty())
+	{
+		Entry& entry = trigger_entries[state.triggers.back().entry];
+		entry.allocations++;
+		entry.bytes += bytes;
+	}
+
+	std::map<lua_State *, std::vector<Frame> >::iterator it = state.stacks.find(state.running);
+	if (it != state.stacks.end() && !it->second.empty())
+	{
+		Entry& entry = function_entries[it->second.back().entry];
+		entry.allocations++;
+		entry.bytes += bytes;
+	}
+}
+
+void LuaProfiler::BeginTrigger(lua_State *L, const char *trigger)
+{
+	if (!active)
+		return;
+
+	std::map<lua_State *, StateRecord>::iterator it = states.find(L);
+	if (it == states.end())
+		return;
+	StateRecord& state = it->second;
+
+	std::string name = state.name + ": " + trigger;
+	std::map<std::string, size_t>::iterator index = trigger_index.find(name);
+	if (index == trigger_index.end())
+	{
+		trigger_entries.push_back(new_entry(name));
+		index = trigger_index.insert(std::make_pair(name, trigger_entries.size() - 1)).first;
+	}
+
+	Push(state.triggers, trigger_entries, index->second);
+	state.trigger_depths.push_back(state.stacks[L].size());
+	state.running = L;
+}
+
+void LuaProfiler::EndTrigger(lua_State *L)
+{
+	if (!active)
+		return;
+
+	std::map<lua_State *, StateRecord>::iterator it = states.find(L);
+	if (it == states.end() || it->second.triggers.empty())
+		return;
+	StateRecord& state = it->second;
+
+	// an error skips the return hooks of everything it unwinds
+	std::vector<Frame>& stack = state.stacks[L];
+	while (stack.size() > state.trigger_depths.back())
+		Pop(stack, function_entries);
+	state.trigger_depths.pop_back();
+
+	Pop(state.triggers, trigger_entries);
+	state.running = L;
+}
+
+void LuaProfiler::Clear()
+{
+	for (std::map<lua_State *, StateRecord>::iterator it = states.begin(); it != states.end(); ++it)
+	{
+		it->second.triggers.clear();
+		it->second.trigger_depths.clear();
+		it->second.stacks.clear();
+	}
+
+	trigger_entries.clear();
+	function_entries.clear();
+	trigger_index.clear();
+	function_index.clear();
+}
+
+void LuaProfiler::Show()
+{
+	if (trigger_entries.empty())
+	{
+		screen_printf("No Lua triggers profiled");
+		return;
+	}
+
+	std::vector<const Entry *> sorted;
+	sort_entries(trigger_entries, sorted);
+	for (size_t i = 0; i < sorted.size() && i < 3; i++)
+		screen_printf("%s: %.1f ms in %u calls, %.1f ms self", sorted[i]->name.c_str(), milliseconds(sorted[i]->total), sorted[i]->calls, milliseconds(sorted[i]->self));
+
+	sort_entries(function_entries, sorted);
+	for (size_t i = 0; i < sorted.size() && i < 3; i++)
+		screen_printf("%s: %.1f ms self in %u calls", sorted[i]->name.c_str(), milliseconds(sorted[i]->self), sorted[i]->calls);
+}
+
+void LuaProfiler::ShowMemory()
+{
+	for (std::map<lua_State *, StateRecord>::iterator it = states.begin(); it != states.end(); ++it)
+	{
+		size_t in_use, peak;
+		L_Get_Memory_Usage(it->first, in_use, peak);
+		screen_printf("%s: %.1f KB in use, %.1f KB peak", it->second.name.c_str(), in_use / 1024.0, peak / 1024.0);
+	}
+
+	if (L_Get_Memory_Limit())
+		screen_printf("Lua memory limit: %.1f KB per state", L_Get_Memory_Limit() / 1024.0);
+}
+
+static void write_entries(FILE *file, const char *title, const std::vector<LuaProfiler::Entry>& entries)
+{
+	std::vector<const LuaProfiler::Entry *> sorted;
+	sort_entries(entries, sorted);
+
+	fprintf(file, "%12s %12s %10s %14s %12s %14s  %s\n", "total ms", "self ms", "calls", "instructions", "allocations", "bytes", title);
+	for (size_t i = 0; i < sorted.size(); i++)
+	{
+		const LuaProfiler::Entry& entry = *sorted[i];
+		fprintf(file, "%12.3f %12.3f %10u %14llu %12llu %14llu  %s\n",
+			milliseconds(entry.total), milliseconds(entry.self), entry.calls,
+			(unsigned long long) entry.instructions, (unsigned long long) entry.allocations, (unsigned long long) entry.bytes,
+			entry.name.c_str());
+	}
+	fprintf(file, "\n");
+}
+
+bool LuaProfiler::WriteReport(const std::string& path, const std::string& title)
+{
+	FILE *file = fopen(path.c_str(), "a");
+	if (!file)
+		return false;
+
+	// instructions are counted in steps of COUNT_INTERVAL
+	fprintf(file, "Lua profile: %s\n\n", title.c_str());
+	write_entries(file, "trigger", trigger_entries);
+	write_entries(file, "function", function_entries);
+
+	for (std::map<lua_State *, StateRecord>::iterator it = states.begin(); it != states.end(); ++it)
+	{
+		size_t in_use, peak;
+		L_Get_Memory_Usage(it->first, in_use, peak);
+		fprintf(file, "%14llu bytes in use, %14llu peak  %s\n", (unsigned long long) in_use, (unsigned long long) peak, it->second.name.c_str());
+	}
+	fprintf(file, "\n");
+	fclose(file);
+	return true;
+}
+
+void LuaProfiler::LevelEnded(const std::string& level_name)
+{
+	if (!active)
+		return;
+
+	FileSpecifier fs;
+	fs.SetToLocalDataDir();
+	fs += report_name;
+	if (!WriteReport(fs.GetPath(), level_name))
+		logWarning("Could not write the Lua profile to %s", fs.GetPath());
+	Clear();
+}
+
+struct luaprofile_on
+{
+	void operator() (const std::string&) const {
+		LuaProfiler::instance()->Start();
+		screen_printf("Lua profiler on");
+	}
+};
+
+struct luaprofile_off
+{
+	void operator() (const std::string&) const {
+		LuaProfiler::instance()->Stop();
+		screen_printf("Lua profiler off");
+	}
+};
+
+struct luaprofile_show
+{
+	void operator() (const std::string&) const {
+		LuaProfiler::instance()->Show();
+	}
+};
+
+struct luaprofile_memory
+{
+	void operator() (const std::string&) const {
+		LuaProfiler::instance()->ShowMemory();
+	}
+};
+
+struct luaprofile_report
+{
+	void operator() (const std::string&) const {
+		FileSpecifier fs;
+		fs.SetToLocalDataDir();
+		fs += report_name;
+		if (LuaProfiler::instance()->WriteReport(fs.GetPath(), "console"))
+			screen_printf("Wrote Lua profile to %s", utf8_to_mac_roman(fs.GetPath()).c_str());
+		else
+			screen_printf("Could not open %s", utf8_to_mac_roman(fs.GetPath()).c_str());
+	}
+};
+
+void LuaProfiler::RegisterCommands()
+{
+	CommandParser luaProfileParser;
+	luaProfileParser.register_command("on", luaprofile_on());
+	luaProfileParser.register_command("off", luaprofile_off());
+	luaProfileParser.register_command("show", luaprofile_show());
+	luaProfileParser.register_command("memory", luaprofile_memory());
+	luaProfileParser.register_command("report", luaprofile_report());
+	Console::instance()->register_command("luaprofile", luaProfileParser);
+}
+
+#endif
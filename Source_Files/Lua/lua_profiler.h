@@ -0,0 +1,148 @@
+#ifndef __LUA_PROFILER_H
+#define __LUA_PROFILER_H
+
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  Lua profiler: times each trigger, and each function with lua_sethook()
+  call and return hooks, in the scripts' Lua states; counts their VM
+  instructions with a count hook and their allocations through a wrapped
+  allocator; shown on screen, and written to a report at the end of each
+  level while it runs
+
+ */
+
+#include "cseries.h"
+
+#ifdef HAVE_LUA
+extern "C"
+{
+#include "lua.h"
+}
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+class LuaProfiler
+{
+public:
+	static LuaProfiler *instance() { if (!m_instance) m_instance = new LuaProfiler(); return m_instance; }
+
+	// "luaprofile on|off", "luaprofile show", "luaprofile memory" and
+	// "luaprofile report"
+	void RegisterCommands();
+
+	bool IsActive() const { return active; }
+	void Start();
+	void Stop();
+
+	// Every state to be profiled, from its creation until just before
+	// lua_close(); attaching again only renames it
+	void Attach(lua_State *L, const std::string& name);
+	void Detach(lua_State *L);
+
+	// Around each lua_pcall() of a trigger (or other entry into the state)
+	void BeginTrigger(lua_State *L, const char *trigger);
+	void EndTrigger(lua_State *L);
+
+	// The top entries on screen
+	void Show();
+
+	// What each attached state's allocations hold, on screen
+	void ShowMemory();
+
+	// Appends everything measured since the last Clear()
+	bool WriteReport(const std::string& path, const std::string& title);
+	void Clear();
+
+	// Writes the report to the local data directory and starts over
+	void LevelEnded(const std::string& level_name);
+
+	struct Entry {
+		std::string name;
+		uint32 calls;
+		uint64_t total;
+		uint64_t self;
+		uint64_t instructions;
+		uint64_t allocations;
+		uint64_t bytes;
+	};
+
+private:
+	static LuaProfiler *m_instance;
+
+	// VM instructions between count hooks
+	enum { COUNT_INTERVAL = 1000 };
+
+	struct Frame {
+		size_t entry;
+		uint64_t started;
+		uint64_t children;
+	};
+
+	struct StateRecord {
+		StateRecord() : alloc(NULL), alloc_ud(NULL), hook(NULL), hook_mask(0), hook_count(0), hooked(false), main_thread(NULL), running(NULL) { }
+
+		std::string name;
+		lua_Alloc alloc;
+		void *alloc_ud;
+		// the state's own hook, which still gets its count events
+		lua_Hook hook;
+		int hook_mask;
+		int hook_count;
+		bool hooked;
+		lua_State *main_thread;
+		// the thread allocations are charged to
+		lua_State *running;
+		// triggers that are running, innermost last; and each one's
+		// depth in the main thread's function stack when it started
+		std::vector<Frame> triggers;
+		std::vector<size_t> trigger_depths;
+		// function stacks, by thread
+		std::map<lua_State *, std::vector<Frame> > stacks;
+	};
+
+	bool active;
+
+	// by main thread
+	std::map<lua_State *, StateRecord> states;
+
+	std::vector<Entry> trigger_entries;
+	std::vector<Entry> function_entries;
+	std::map<std::string, size_t> trigger_index;
+	std::map<std::pair<const void *, int>, size_t> function_index;
+
+	LuaProfiler() : active(false) { }
+
+	void Hook(lua_State *L, StateRecord& state, lua_Debug *ar);
+	void Allocated(StateRecord& state, size_t bytes);
+	void Install(lua_State *L, StateRecord& state);
+	void Uninstall(lua_State *L, StateRecord& state);
+	void Push(std::vector<Frame>& stack, std::vector<Entry>& entries, size_t entry);
+	void Pop(std::vector<Frame>& stack, std::vector<Entry>& entries);
+	size_t FunctionEntry(lua_State *L, lua_Debug *ar);
+
+	static void HookFunction(lua_State *L, lua_Debug *ar);
+	static void *AllocFunction(void *ud, void *ptr, size_t osize, size_t nsize);
+};
+
+#endif
+
+#endif
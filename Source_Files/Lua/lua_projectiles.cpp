@@ -355,8 +355,42 @@ int Lua_Projectiles_New_Projectile(lua_State *L)
 	return 1;
 }
 
+// Projectiles.within(x, y, z, radius)
+int Lua_Projectiles_Within(lua_State *L)
+{
+	if (!lua_isnumber(L, 1) || !lua_isnumber(L, 2) || !lua_isnumber(L, 3) || !lua_isnumber(L, 4))
+		return luaL_error(L, "within: incorrect argument type");
+
+	double x = lua_tonumber(L, 1) * WORLD_ONE;
+	double y = lua_tonumber(L, 2) * WORLD_ONE;
+	double z = lua_tonumber(L, 3) * WORLD_ONE;
+	double radius = lua_tonumber(L, 4) * WORLD_ONE;
+
+	lua_newtable(L);
+	int table_index = 1;
+	for (int16 projectile_index = 0; projectile_index < MAXIMUM_PROJECTILES_PER_MAP; projectile_index++)
+	{
+		projectile_data *projectile = GetMemberWithBounds(projectiles, projectile_index, MAXIMUM_PROJECTILES_PER_MAP);
+		if (!SLOT_IS_USED(projectile))
+			continue;
+
+		object_data *object = get_object_data(projectile->object_index);
+		double dx = object->location.x - x;
+		double dy = object->location.y - y;
+		double dz = object->location.z - z;
+		if (dx * dx + dy * dy + dz * dz <= radius * radius)
+		{
+			Lua_Projectile::Push(L, projectile_index);
+			lua_rawseti(L, -2, table_index++);
+		}
+	}
+
+	return 1;
+}
+
 const luaL_Reg Lua_Projectiles_Methods[] = {
 	{"new", L_TableFunction<Lua_Projectiles_New_Projectile>},
+	{"within", L_TableFunction<Lua_Projectiles_Within>},
 	{0, 0}
 };
 
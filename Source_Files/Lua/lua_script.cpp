@@ -109,6 +109,8 @@ extern "C"
 #include "preferences.h"
 #include "BStream.h"
 #include "Plugins.h"
+#include "InfoTree.h"
+#include "FrameProfiler.h"
 
 #include "lua_script.h"
 #include "lua_map.h"
@@ -116,6 +118,9 @@ extern "C"
 #include "lua_objects.h"
 #include "lua_player.h"
 #include "lua_projectiles.h"
+#include "lua_allocator.h"
+#include "lua_cache.h"
+#include "lua_profiler.h"
 #include "lua_saved_objects.h"
 #include "lua_serialize.h"
 
@@ -146,6 +151,73 @@ int GetLuaScoringMode() {
 	return game_scoring_mode;
 }
 
+// <lua> garbage collector settings; zero leaves Lua's own
+struct lua_gc_settings
+{
+	bool generational;
+	int16 step; // KB collected each tick
+	int16 pause;
+	int16 step_multiplier;
+};
+
+static const lua_gc_settings default_lua_gc_settings = { false, 0, 0, 0 };
+static lua_gc_settings lua_gc_mml = default_lua_gc_settings;
+
+// <lua> instruction budget for each trigger, and what happens past it
+enum {
+	_lua_budget_warn,
+	_lua_budget_abort,
+	_lua_budget_disable
+};
+
+static int32 lua_instruction_budget = 0;
+static int16 lua_budget_action = _lua_budget_abort;
+
+void reset_mml_lua()
+{
+	lua_gc_mml = default_lua_gc_settings;
+	lua_instruction_budget = 0;
+	lua_budget_action = _lua_budget_abort;
+#ifdef HAVE_LUA
+	L_Set_Memory_Limit(0);
+#endif
+}
+
+void parse_mml_lua(const InfoTree& root)
+{
+	std::string mode;
+	if (root.read_attr("gc_mode", mode))
+	{
+		if (mode == "generational")
+			lua_gc_mml.generational = true;
+		else if (mode == "incremental")
+			lua_gc_mml.generational = false;
+	}
+	root.read_attr_bounded<int16>("gc_step", lua_gc_mml.step, 0, SHRT_MAX);
+	root.read_attr_bounded<int16>("gc_pause", lua_gc_mml.pause, 0, SHRT_MAX);
+	root.read_attr_bounded<int16>("gc_step_multiplier", lua_gc_mml.step_multiplier, 0, SHRT_MAX);
+
+	root.read_attr_bounded<int32>("instruction_budget", lua_instruction_budget, 0, INT32_MAX);
+	if (root.read_attr("budget_action", mode))
+	{
+		if (mode == "warn")
+			lua_budget_action = _lua_budget_warn;
+		else if (mode == "abort")
+			lua_budget_action = _lua_budget_abort;
+		else if (mode == "disable")
+			lua_budget_action = _lua_budget_disable;
+	}
+
+	// in KB, for each script's state
+	int32 memory_limit;
+	if (root.read_attr_bounded<int32>("memory_limit", memory_limit, 0, 4 * 1024 * 1024))
+	{
+#ifdef HAVE_LUA
+		L_Set_Memory_Limit(size_t(memory_limit) * 1024);
+#endif
+	}
+}
+
 #ifndef HAVE_LUA
 
 void L_Call_Init(bool) {}
@@ -236,18 +308,97 @@ void* L_Persistent_Table_Key()
 	return const_cast<char*>(key);
 }
 
+enum /* triggers */
+{
+	_lua_trigger_init,
+	_lua_trigger_idle,
+	_lua_trigger_cleanup,
+	_lua_trigger_postidle,
+	_lua_trigger_start_refuel,
+	_lua_trigger_end_refuel,
+	_lua_trigger_tag_switch,
+	_lua_trigger_light_switch,
+	_lua_trigger_platform_switch,
+	_lua_trigger_projectile_switch,
+	_lua_trigger_terminal_enter,
+	_lua_trigger_terminal_exit,
+	_lua_trigger_pattern_buffer,
+	_lua_trigger_got_item,
+	_lua_trigger_light_activated,
+	_lua_trigger_platform_activated,
+	_lua_trigger_player_revived,
+	_lua_trigger_player_killed,
+	_lua_trigger_monster_killed,
+	_lua_trigger_monster_damaged,
+	_lua_trigger_player_damaged,
+	_lua_trigger_projectile_detonated,
+	_lua_trigger_projectile_created,
+	_lua_trigger_item_created,
+	NUMBER_OF_LUA_TRIGGERS
+};
+
+static const char *lua_trigger_names[NUMBER_OF_LUA_TRIGGERS] = {
+	"init",
+	"idle",
+	"cleanup",
+	"postidle",
+	"start_refuel",
+	"end_refuel",
+	"tag_switch",
+	"light_switch",
+	"platform_switch",
+	"projectile_switch",
+	"terminal_enter",
+	"terminal_exit",
+	"pattern_buffer",
+	"got_item",
+	"light_activated",
+	"platform_activated",
+	"player_revived",
+	"player_killed",
+	"monster_killed",
+	"monster_damaged",
+	"player_damaged",
+	"projectile_detonated",
+	"projectile_created",
+	"item_created"
+};
+
 std::map<int, std::string> PassedLuaState;
 std::map<int, std::string> SavedLuaState;
 
+// VM instructions between checks of the instruction budget
+static const int kBudgetInterval = 1000;
+
+static void* L_Budget_Key()
+{
+	static const char *key = "budget";
+	return const_cast<char*>(key);
+}
+
 class LuaState
 {
 	friend bool CollectLuaStats(std::map<std::string, std::string>&, std::map<std::string, std::string>&);
 public:
-	LuaState() : running_(false), num_scripts_(0) {
-		state_.reset(luaL_newstate(), lua_close);
+	LuaState() : running_(false), num_scripts_(0), lua_depth_(0), trigger_(0), budget_left_(0), budget_what_(0), over_budget_(false) {
+		state_.reset(L_New_State(), L_Close_State);
+		ForgetAbsentTriggers();
+
+		// before the profiler, which passes count events on to it;
+		// coroutines inherit the hook from the thread that makes them
+		if (lua_instruction_budget)
+		{
+			lua_pushlightuserdata(State(), L_Budget_Key());
+			lua_pushlightuserdata(State(), this);
+			lua_settable(State(), LUA_REGISTRYINDEX);
+			lua_sethook(State(), BudgetHook, LUA_MASKCOUNT, kBudgetInterval);
+		}
+
+		LuaProfiler::instance()->Attach(State(), "Lua");
 	}
 
 	virtual ~LuaState() {
+		LuaProfiler::instance()->Detach(State());
 	}
 
 public:
@@ -257,6 +408,7 @@ public:
 	bool Running() { return running_; }
 	bool Run();
 	void Stop() { running_ = false; }
+	void StepGarbageCollector() { if (running_) L_Step_Garbage_Collector(State()); }
 	bool Matches(lua_State *state) { return state == State(); }
 	void MarkCollections(std::set<short>* collections);
 	void ExecuteCommand(const std::string& line);
@@ -286,6 +438,8 @@ public:
 		lua_newtable(State());
 		lua_settable(State(), LUA_REGISTRYINDEX);
 
+		L_Configure_Garbage_Collector(State());
+
 		RegisterFunctions();
 		LoadCompatibility();
 	}
@@ -295,8 +449,11 @@ public:
 	}
 
 protected:
-	bool GetTrigger(const char *trigger);
+	bool GetTrigger(int trigger);
 	void CallTrigger(int numArgs = 0);
+	int PCall(int numArgs, int numResults, const char *what = "script");
+	void ForgetAbsentTriggers() { memset(trigger_is_absent_, 0, sizeof(trigger_is_absent_)); }
+	static void BudgetHook(lua_State *L, lua_Debug *ar);
 
 	virtual void RegisterFunctions();
 	virtual void LoadCompatibility();
@@ -342,6 +499,21 @@ public:
 private:
 	bool running_;
 	int num_scripts_;
+
+	// only Lua code can change Triggers, so while none is running a trigger
+	// that wasn't there stays missing (see GetTrigger())
+	int lua_depth_;
+	bool trigger_is_absent_[NUMBER_OF_LUA_TRIGGERS];
+
+	// the last trigger GetTrigger() found, for the profiler
+	int trigger_;
+
+	// intervals of kBudgetInterval instructions the outermost PCall() has
+	// left, and what it was for
+	int32 budget_left_;
+	const char *budget_what_;
+	bool over_budget_;
+	std::set<std::string> budget_warned_;
 };
 
 typedef LuaState EmbeddedLuaState;
@@ -360,9 +532,9 @@ public:
 	}
 };
 
-bool LuaState::GetTrigger(const char* trigger)
+bool LuaState::GetTrigger(int trigger)
 {
-	if (!running_)
+	if (!running_ || trigger_is_absent_[trigger])
 		return false;
 
 	lua_getglobal(State(), "Triggers");
@@ -372,27 +544,84 @@ bool LuaState::GetTrigger(const char* trigger)
 		return false;
 	}
 
-	lua_pushstring(State(), trigger);
-	lua_gettable(State(), -2);
+	lua_getfield(State(), -1, lua_trigger_names[trigger]);
 	if (!lua_isfunction(State(), -1))
 	{
+		// an event from inside Lua code can't tell what that code will do next
+		if (lua_isnil(State(), -1) && !lua_depth_)
+			trigger_is_absent_[trigger] = true;
 		lua_pop(State(), 2);
 		return false;
 	}
 
 	lua_remove(State(), -2);
+	trigger_ = trigger;
 	return true;
 }
 
 void LuaState::CallTrigger(int numArgs)
 {
-	if (lua_pcall(State(), numArgs, 0, 0) == LUA_ERRRUN)
+	if (PCall(numArgs, 0, lua_trigger_names[trigger_]) == LUA_ERRRUN)
 		L_Error(lua_tostring(State(), -1));
 }
 
+int LuaState::PCall(int numArgs, int numResults, const char *what)
+{
+	// triggers run from inside Lua code share their caller's budget
+	if (!lua_depth_)
+	{
+		budget_left_ = (lua_instruction_budget + kBudgetInterval - 1) / kBudgetInterval;
+		budget_what_ = what;
+		over_budget_ = false;
+	}
+
+	LuaProfiler::instance()->BeginTrigger(State(), what);
+	++lua_depth_;
+	int result = lua_pcall(State(), numArgs, numResults, 0);
+	--lua_depth_;
+	LuaProfiler::instance()->EndTrigger(State());
+
+	if (!lua_depth_ && over_budget_ && lua_budget_action == _lua_budget_disable && running_)
+	{
+		logError("Lua script disabled: %s exceeded the instruction budget", budget_what_);
+		running_ = false;
+	}
+
+	ForgetAbsentTriggers();
+	return result;
+}
+
+// Instruction counts don't depend on the machine, so every player in a
+// netgame stops a runaway trigger at the same point
+void LuaState::BudgetHook(lua_State *L, lua_Debug *ar)
+{
+	lua_pushlightuserdata(L, L_Budget_Key());
+	lua_gettable(L, LUA_REGISTRYINDEX);
+	LuaState *state = static_cast<LuaState *>(lua_touserdata(L, -1));
+	lua_pop(L, 1);
+
+	if (!state || !state->lua_depth_ || --state->budget_left_ > 0)
+		return;
+
+	if (!state->over_budget_)
+	{
+		state->over_budget_ = true;
+		if (lua_budget_action == _lua_budget_warn)
+		{
+			if (state->budget_warned_.insert(state->budget_what_).second)
+				logWarning("Lua %s exceeded the instruction budget of %d", state->budget_what_, lua_instruction_budget);
+			return;
+		}
+	}
+
+	// again every interval until it unwinds, even past pcall()s in the script
+	if (lua_budget_action != _lua_budget_warn)
+		luaL_error(L, "%s exceeded the instruction budget of %d", state->budget_what_, lua_instruction_budget);
+}
+
 void LuaState::Init(bool fRestoringSaved)
 {
-	if (GetTrigger("init"))
+	if (GetTrigger(_lua_trigger_init))
 	{
 		lua_pushboolean(State(), fRestoringSaved);
 		CallTrigger(1);
@@ -401,25 +630,25 @@ void LuaState::Init(bool fRestoringSaved)
 
 void LuaState::Idle()
 {
-	if (GetTrigger("idle"))
+	if (GetTrigger(_lua_trigger_idle))
 		CallTrigger();
 }
 
 void LuaState::Cleanup()
 {
-	if (GetTrigger("cleanup"))
+	if (GetTrigger(_lua_trigger_cleanup))
 		CallTrigger();
 }
 
 void LuaState::PostIdle()
 {
-	if (GetTrigger("postidle"))
+	if (GetTrigger(_lua_trigger_postidle))
 		CallTrigger();
 }
 
 void LuaState::StartRefuel(short type, short player_index, short panel_side_index)
 {
-	if (GetTrigger("start_refuel"))
+	if (GetTrigger(_lua_trigger_start_refuel))
 	{
 		Lua_ControlPanelClass::Push(State(), type);
 		Lua_Player::Push(State(), player_index);
@@ -430,7 +659,7 @@ void LuaState::StartRefuel(short type, short player_index, short panel_side_inde
 
 void LuaState::EndRefuel(short type, short player_index, short panel_side_index)
 {
-	if (GetTrigger("end_refuel"))
+	if (GetTrigger(_lua_trigger_end_refuel))
 	{
 		Lua_ControlPanelClass::Push(State(), type);
 		Lua_Player::Push(State(), player_index);
@@ -441,7 +670,7 @@ void LuaState::EndRefuel(short type, short player_index, short panel_side_index)
 
 void LuaState::TagSwitch(short tag, short player_index, short side_index)
 {
-	if (GetTrigger("tag_switch"))
+	if (GetTrigger(_lua_trigger_tag_switch))
 	{
 		Lua_Tag::Push(State(), tag);
 		Lua_Player::Push(State(), player_index);
@@ -452,7 +681,7 @@ void LuaState::TagSwitch(short tag, short player_index, short side_index)
 
 void LuaState::LightSwitch(short light, short player_index, short side_index)
 {
-	if (GetTrigger("light_switch"))
+	if (GetTrigger(_lua_trigger_light_switch))
 	{
 		Lua_Light::Push(State(), light);
 		Lua_Player::Push(State(), player_index);
@@ -463,7 +692,7 @@ void LuaState::LightSwitch(short light, short player_index, short side_index)
 
 void LuaState::PlatformSwitch(short platform, short player_index, short side_index)
 {
-	if (GetTrigger("platform_switch"))
+	if (GetTrigger(_lua_trigger_platform_switch))
 	{
 		Lua_Polygon::Push(State(), platform);
 		Lua_Player::Push(State(), player_index);
@@ -474,7 +703,7 @@ void LuaState::PlatformSwitch(short platform, short player_index, short side_ind
 
 void LuaState::ProjectileSwitch(short side_index, short projectile_index)
 {
-	if (GetTrigger("projectile_switch"))
+	if (GetTrigger(_lua_trigger_projectile_switch))
 	{
 		Lua_Projectile::Push(State(), projectile_index);
 		Lua_Side::Push(State(), side_index);
@@ -484,7 +713,7 @@ void LuaState::ProjectileSwitch(short side_index, short projectile_index)
 
 void LuaState::TerminalEnter(short terminal_id, short player_index)
 {
-	if (GetTrigger("terminal_enter"))
+	if (GetTrigger(_lua_trigger_terminal_enter))
 	{
 		Lua_Terminal::Push(State(), terminal_id);
 		Lua_Player::Push(State(), player_index);
@@ -494,7 +723,7 @@ void LuaState::TerminalEnter(short terminal_id, short player_index)
 
 void LuaState::TerminalExit(short terminal_id, short player_index)
 {
-	if (GetTrigger("terminal_exit"))
+	if (GetTrigger(_lua_trigger_terminal_exit))
 	{
 		Lua_Terminal::Push(State(), terminal_id);
 		Lua_Player::Push(State(), player_index);
@@ -504,7 +733,7 @@ void LuaState::TerminalExit(short terminal_id, short player_index)
 
 void LuaState::PatternBuffer(short side_index, short player_index)
 {
-	if (GetTrigger("pattern_buffer"))
+	if (GetTrigger(_lua_trigger_pattern_buffer))
 	{
 		Lua_Side::Push(State(), side_index);
 		Lua_Player::Push(State(), player_index);
@@ -514,7 +743,7 @@ void LuaState::PatternBuffer(short side_index, short player_index)
 
 void LuaState::GotItem(short type, short player_index)
 {
-	if (GetTrigger("got_item"))
+	if (GetTrigger(_lua_trigger_got_item))
 	{
 		Lua_ItemType::Push(State(), type);
 		Lua_Player::Push(State(), player_index);
@@ -524,7 +753,7 @@ void LuaState::GotItem(short type, short player_index)
 
 void LuaState::LightActivated(short index)
 {
-	if (GetTrigger("light_activated"))
+	if (GetTrigger(_lua_trigger_light_activated))
 	{
 		Lua_Light::Push(State(), index);
 		CallTrigger(1);
@@ -533,7 +762,7 @@ void LuaState::LightActivated(short index)
 
 void LuaState::PlatformActivated(short index)
 {
-	if (GetTrigger("platform_activated"))
+	if (GetTrigger(_lua_trigger_platform_activated))
 	{
 		Lua_Polygon::Push(State(), index);
 		CallTrigger(1);
@@ -542,7 +771,7 @@ void LuaState::PlatformActivated(short index)
 
 void LuaState::PlayerRevived (short player_index)
 {
-	if (GetTrigger("player_revived"))
+	if (GetTrigger(_lua_trigger_player_revived))
 	{
 		Lua_Player::Push(State(), player_index);
 		CallTrigger(1);
@@ -551,7 +780,7 @@ void LuaState::PlayerRevived (short player_index)
 
 void LuaState::PlayerKilled (short player_index, short aggressor_player_index, short action, short projectile_index)
 {
-	if (GetTrigger("player_killed"))
+	if (GetTrigger(_lua_trigger_player_killed))
 	{
 		Lua_Player::Push(State(), player_index);
 
@@ -572,7 +801,7 @@ void LuaState::PlayerKilled (short player_index, short aggressor_player_index, s
 
 void LuaState::MonsterKilled (short monster_index, short aggressor_player_index, short projectile_index)
 {
-	if (GetTrigger("monster_killed"))
+	if (GetTrigger(_lua_trigger_monster_killed))
 	{
 		Lua_Monster::Push(State(), monster_index);
 		if (aggressor_player_index != -1)
@@ -591,7 +820,7 @@ void LuaState::MonsterKilled (short monster_index, short aggressor_player_index,
 
 void LuaState::MonsterDamaged(short monster_index, short aggressor_monster_index, int16 damage_type, short damage_amount, short projectile_index)
 {
-	if (GetTrigger("monster_damaged"))
+	if (GetTrigger(_lua_trigger_monster_damaged))
 	{
 		Lua_Monster::Push(State(), monster_index);
 		if (aggressor_monster_index != -1) 
@@ -614,7 +843,7 @@ void LuaState::MonsterDamaged(short monster_index, short aggressor_monster_index
 
 void LuaState::PlayerDamaged (short player_index, short aggressor_player_index, short aggressor_monster_index, int16 damage_type, short damage_amount, short projectile_index)
 {
-	if (GetTrigger("player_damaged"))
+	if (GetTrigger(_lua_trigger_player_damaged))
 	{
 		Lua_Player::Push(State(), player_index);
 
@@ -642,7 +871,7 @@ void LuaState::PlayerDamaged (short player_index, short aggressor_player_index,
 
 void LuaState::ProjectileDetonated(short type, short owner_index, short polygon, world_point3d location) 
 {
-	if (GetTrigger("projectile_detonated"))
+	if (GetTrigger(_lua_trigger_projectile_detonated))
 	{
 		Lua_ProjectileType::Push(State(), type);
 		if (owner_index != -1)
@@ -660,7 +889,7 @@ void LuaState::ProjectileDetonated(short type, short owner_index, short polygon,
 
 void LuaState::ProjectileCreated (short projectile_index)
 {
-	if (GetTrigger("projectile_created"))
+	if (GetTrigger(_lua_trigger_projectile_created))
 	{
 		Lua_Projectile::Push(State(), projectile_index);
 		CallTrigger(1);
@@ -669,7 +898,7 @@ void LuaState::ProjectileCreated (short projectile_index)
 
 void LuaState::ItemCreated (short item_index)
 {
-	if (GetTrigger("item_created"))
+	if (GetTrigger(_lua_trigger_item_created))
 	{
 		Lua_Item::Push(State(), item_index);
 		CallTrigger(1);
@@ -739,6 +968,27 @@ std::string L_Get_Search_Path(lua_State* L)
 
 }
 
+void L_Configure_Garbage_Collector(lua_State* L)
+{
+	lua_gc(L, lua_gc_mml.generational ? LUA_GCGEN : LUA_GCINC, 0);
+	if (lua_gc_mml.pause)
+		lua_gc(L, LUA_GCSETPAUSE, lua_gc_mml.pause);
+	if (lua_gc_mml.step_multiplier)
+		lua_gc(L, LUA_GCSETSTEPMUL, lua_gc_mml.step_multiplier);
+}
+
+// Pays off a tick's worth of collection at a known point, so the collector
+// has less left to do when some allocation in the middle of a tick trips it
+void L_Step_Garbage_Collector(lua_State* L)
+{
+	if (!lua_gc_mml.step)
+		return;
+
+	uint64_t started = SDL_GetPerformanceCounter();
+	lua_gc(L, LUA_GCSTEP, lua_gc_mml.step);
+	FrameProfiler::instance()->Add(FrameProfiler::LUA_GC, (SDL_GetPerformanceCounter() - started) * 1000.0 / SDL_GetPerformanceFrequency());
+}
+
 static char L_PROPER_ITEM_ACCOUNTING_KEY[] = "proper_item_accounting";
 
 void L_Set_Proper_Item_Accounting(lua_State* L, bool value)
@@ -827,7 +1077,7 @@ static const char *compatibility_triggers = ""
 void LuaState::LoadCompatibility()
 {
 	luaL_loadbuffer(State(), compatibility_triggers, strlen(compatibility_triggers), "compatibility_triggers");
-	lua_pcall(State(), 0, 0, 0);
+	PCall(0, 0);
 
 	struct lang_def
 	{
@@ -855,7 +1105,9 @@ void LuaState::LoadCompatibility()
 
 bool LuaState::Load(const char *buffer, size_t len, const char *desc)
 {
-	int status = luaL_loadbufferx(State(), buffer, len, desc, "t");
+	LuaProfiler::instance()->Attach(State(), desc);
+
+	int status = L_Load_Cached(State(), buffer, len, desc);
 	if (status == LUA_ERRRUN)
 		logWarning("Lua loading failed: error running script.");
 	if (status == LUA_ERRFILE)
@@ -886,7 +1138,7 @@ bool LuaState::Run()
 	// Call 'em
 	for (int i = 0; i < num_scripts_; ++i)
 	{
-		int ret = lua_pcall(State(), 0, LUA_MULTRET, 0);
+		int ret = PCall(0, LUA_MULTRET);
 		if (ret != 0)
 		{
 			L_Error(lua_tostring(State(), -1));
@@ -922,13 +1174,13 @@ void LuaState::ExecuteCommand(const std::string& line)
 	else 
 	{
 		running_ = true;
-		if (lua_pcall(State(), 0, (print_result) ? 1 : 0, 0) != 0)
+		if (PCall(0, (print_result) ? 1 : 0, "console") != 0)
 			L_Error(lua_tostring(State(), -1));
 		else if (print_result)
 		{
 			lua_getglobal(State(), "tostring");
 			lua_insert(State(), 1);
-			lua_pcall(State(), 1, 1, 0);
+			PCall(1, 1, "console");
 			if (lua_tostring(State(), -1))
 			{
 				screen_printf("%s", lua_tostring(State(), -1));
@@ -1204,6 +1456,7 @@ void L_Call_Idle()
 void L_Call_PostIdle()
 {
 	L_Dispatch(boost::bind(&LuaState::PostIdle, _1));
+	L_Dispatch(boost::bind(&LuaState::StepGarbageCollector, _1));
 }
 
 void L_Call_Start_Refuel (short type, short player_index, short panel_side_index)
@@ -2043,6 +2296,9 @@ void LoadReplayNetLua()
 
 void CloseLuaScript()
 {
+	LuaProfiler::instance()->LevelEnded(static_world->level_name);
+
+
 	// save variables for going into next level
 	PassedLuaState.clear();
 	for (state_map::iterator it = states.begin(); it != states.end(); ++it)
@@ -84,6 +84,10 @@ void LoadReplayNetLua();
 void LoadStatsLua();
 bool CollectLuaStats(std::map<std::string, std::string>& table, std::map<std::string, std::string>& parameters);
 
+class InfoTree;
+void parse_mml_lua(const InfoTree& root);
+void reset_mml_lua();
+
 void ToggleLuaMute();
 void ResetLuaMute();
 
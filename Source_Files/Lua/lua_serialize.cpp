@@ -26,8 +26,19 @@ LUA_SERIALIZE.CPP
 
 #include "BStream.h"
 
+#include <stdint.h>
+#include <string.h>
+#include <cmath>
+#include <vector>
+
 const static int SAVED_REFERENCE_PSEUDOTYPE = -2;
-const uint16 kVersion = 1;
+// version 2 numbers that fit
+const static int SAVED_INTEGER_PSEUDOTYPE = -3;
+
+// Version 2 writes strings once and then by reference, writes the values
+// of a table's keys 1..n without the keys, and makes references implicit:
+// tables, strings and userdata are numbered in the order they're written
+const uint16 kVersion = 2;
 
 static bool valid_key(int type)
 {
@@ -38,100 +49,141 @@ static bool valid_key(int type)
 		type == LUA_TUSERDATA);
 }
 
-static void save(lua_State *L, BOStreamBE& s, uint32& counter)
+static void add_reference(lua_State *L, uint32& counter)
 {
-	// if the object has already been written, write a reference to it
-
 	lua_pushvalue(L, -1);
-	lua_rawget(L, 1);
-	if (!lua_isnil(L, -1))
+	lua_pushnumber(L, static_cast<lua_Number>(++counter));
+	lua_rawset(L, 1);
+}
+
+static void save(lua_State *L, BOBufferBE& b, uint32& counter)
+{
+	int type = lua_type(L, -1);
+
+	// if the object has already been written, write a reference to it
+	if (type == LUA_TSTRING || type == LUA_TTABLE || type == LUA_TUSERDATA)
 	{
-		s << static_cast<int8>(SAVED_REFERENCE_PSEUDOTYPE)
-		  << static_cast<uint32>(lua_tonumber(L, -1));
+		lua_pushvalue(L, -1);
+		lua_rawget(L, 1);
+		if (!lua_isnil(L, -1))
+		{
+			b << static_cast<int8>(SAVED_REFERENCE_PSEUDOTYPE);
+			b << static_cast<uint32>(lua_tonumber(L, -1));
+			lua_pop(L, 1);
+			return;
+		}
 		lua_pop(L, 1);
-		return;
 	}
-	lua_pop(L, 1);
 
-	s << static_cast<int8>(lua_type(L, -1));
-	switch (lua_type(L, -1))
+	switch (type)
 	{
-		case LUA_TNIL:
-			break;
 		case LUA_TNUMBER:
 			{
-				s << static_cast<double>(lua_tonumber(L, -1));
+				double d = lua_tonumber(L, -1);
+				if (d >= INT32_MIN && d <= INT32_MAX && d == static_cast<int32>(d) && !(d == 0 && std::signbit(d)))
+				{
+					b << static_cast<int8>(SAVED_INTEGER_PSEUDOTYPE);
+					b << static_cast<uint32>(static_cast<int32>(d));
+				}
+				else
+				{
+					b << static_cast<uint8>(LUA_TNUMBER);
+					b << d;
+				}
 			}
 			break;
 		case LUA_TBOOLEAN:
-			s << static_cast<uint8>(lua_toboolean(L, -1) ? 1 : 0);
+			b << static_cast<uint8>(LUA_TBOOLEAN);
+			b << static_cast<uint8>(lua_toboolean(L, -1) ? 1 : 0);
 			break;
-		case LUA_TSTRING: 
+		case LUA_TSTRING:
 			{
-				s << static_cast<uint32>(lua_rawlen(L, -1));
-				s.write(lua_tostring(L, -1), lua_rawlen(L, -1));
+				add_reference(L, counter);
+
+				size_t length;
+				const char *string = lua_tolstring(L, -1, &length);
+				b << static_cast<uint8>(LUA_TSTRING);
+				b << static_cast<uint32>(length);
+				b.write(string, length);
 			}
 			break;
 		case LUA_TTABLE:
 			{
-				// add to the reference table
-				lua_pushvalue(L, -1);
-				lua_pushnumber(L, static_cast<lua_Number>(++counter));
-				lua_rawset(L, 1);
+				add_reference(L, counter);
+				b << static_cast<uint8>(LUA_TTABLE);
 
-				// write the reference
-				s << counter;
+				// the values of keys 1..n, up to the first nil
+				size_t array_size = b.reserve32();
+				uint32 n = 0;
+				for (;;)
+				{
+					lua_rawgeti(L, -1, n + 1);
+					if (lua_isnil(L, -1))
+					{
+						lua_pop(L, 1);
+						break;
+					}
+					save(L, b, counter);
+					lua_pop(L, 1);
+					++n;
+				}
+				b.patch32(array_size, n);
 
-				// write all k/v pairs
+				// then all other k/v pairs
 				lua_pushnil(L);
-				while (lua_next(L, -2)) 
+				while (lua_next(L, -2))
 				{
-					if (valid_key(lua_type(L, -2))) {
+					int key_type = lua_type(L, -2);
+					if (key_type == LUA_TNUMBER)
+					{
+						lua_Number key = lua_tonumber(L, -2);
+						if (key >= 1 && key <= n && key == static_cast<uint32>(key))
+						{
+							lua_pop(L, 1);
+							continue;
+						}
+					}
+
+					if (valid_key(key_type)) {
 						// another key
 						lua_pushvalue(L, -2);
-						
-						save(L, s, counter);
+
+						save(L, b, counter);
 						lua_pop(L, 1);
-						
-						save(L, s, counter);
+
+						save(L, b, counter);
 						lua_pop(L, 1);
 					} else {
 						lua_pop(L, 1);
 					}
 				}
 
-				lua_pushnil(L);
-				save(L, s, counter);
-				lua_pop(L, 1);
+				b << static_cast<uint8>(LUA_TNIL);
 			}
 			break;
 		case LUA_TUSERDATA:
 			{
-				// add to the reference table
-				lua_pushvalue(L, -1);
-				lua_pushnumber(L, static_cast<lua_Number>(++counter));
-				lua_rawset(L, 1);
-
-				// write the reference
-				s << counter;
+				add_reference(L, counter);
+				b << static_cast<uint8>(LUA_TUSERDATA);
 
 				// assume that this is one of our userdata
 				lua_getmetatable(L, -1);
 				lua_gettable(L, LUA_REGISTRYINDEX);
 
-				s << static_cast<uint8>(lua_rawlen(L, -1));
-				s.write(lua_tostring(L, -1), lua_rawlen(L, -1));
+				b << static_cast<uint8>(lua_rawlen(L, -1));
+				b.write(lua_tostring(L, -1), lua_rawlen(L, -1));
 				lua_pop(L, 1);
 
 				lua_getfield(L, -1, "index");
-				
-				s << static_cast<uint32>(lua_tonumber(L, -1));
+
+				b << static_cast<uint32>(lua_tonumber(L, -1));
 				lua_pop(L, 1);
 			}
 			break;
-		
+
 		default:
 			// we silently ignore other types
+			b << static_cast<uint8>(LUA_TNIL);
 			break;
 	}
 }
@@ -145,27 +197,147 @@ bool lua_save(lua_State *L, std::streambuf* sb)
 
 	// put it at the bottom of the stack
 	lua_insert(L, 1);
-	
+
+	// the persistent table is saved again and again, at about the same size
+	static size_t last_size = 0;
+	BOBufferBE b(last_size + last_size / 8);
+
 	uint32 counter = 0;
-	BOStreamBE s(sb);
-	try 
-	{
-		s << kVersion;
-		save(L, s, counter);
-	}
-	catch (const basic_bstream::failure& e)
+	b << static_cast<int16>(kVersion);
+	save(L, b, counter);
+	last_size = b.tellp();
+
+	// remove the reference table
+	lua_remove(L, 1);
+
+	if (sb->sputn(&b.data()[0], b.tellp()) != static_cast<std::streamsize>(b.tellp()))
 	{
-		logWarning("failed to save Lua data; %s", e.what());
+		logWarning("failed to save Lua data; could not write it out");
 		lua_settop(L, 0);
 		return false;
 	}
 
-	// remove the reference table
-	lua_remove(L, 1);
 	return true;
 }
 
-static int restore(lua_State *L, BIStreamBE& s)
+static int restore(lua_State *L, BIBufferBE& b, uint32& counter)
+{
+	int8 saved_type;
+	b >> saved_type;
+	int type = saved_type;
+
+	switch (type)
+	{
+		case LUA_TNIL:
+			lua_pushnil(L);
+			break;
+		case LUA_TBOOLEAN:
+			{
+				uint8 value;
+				b >> value;
+				lua_pushboolean(L, value == 1);
+			}
+			break;
+		case LUA_TNUMBER:
+			{
+				double value;
+				b >> value;
+				lua_pushnumber(L, static_cast<lua_Number>(value));
+			}
+			break;
+		case SAVED_INTEGER_PSEUDOTYPE:
+			{
+				int32 value;
+				b >> value;
+				lua_pushnumber(L, static_cast<lua_Number>(value));
+			}
+			break;
+		case LUA_TSTRING:
+			{
+				uint32 length;
+				b >> length;
+				lua_pushlstring(L, b.read_view(length), length);
+
+				lua_pushvalue(L, -1);
+				lua_rawseti(L, 1, ++counter);
+			}
+			break;
+		case LUA_TTABLE:
+			{
+				uint32 n;
+				b >> n;
+
+				// add to the reference table
+				lua_createtable(L, n, 0);
+				lua_pushvalue(L, -1);
+				lua_rawseti(L, 1, ++counter);
+
+				for (uint32 i = 1; i <= n; ++i)
+				{
+					restore(L, b, counter);
+					lua_rawseti(L, -2, i);
+				}
+
+				int key_type = restore(L, b, counter);
+				while (key_type != LUA_TNIL)
+				{
+					restore(L, b, counter); // value
+					if (lua_isnil(L, -2) || lua_isnil(L, -1))
+					{
+						// maybe an invalid userdata?
+						lua_pop(L, 2);
+					}
+					else
+					{
+						lua_rawset(L, -3);
+					}
+					key_type = restore(L, b, counter); // next key
+				}
+				lua_pop(L, 1);
+			}
+			break;
+		case LUA_TUSERDATA:
+			{
+				uint8 length;
+				b >> length;
+				lua_pushlstring(L, b.read_view(length), length);
+
+				uint32 index;
+				b >> index;
+
+				// get the metatable
+				lua_gettable(L, LUA_REGISTRYINDEX);
+				// get the accessor we added
+				lua_getfield(L, -1, "__new");
+				if (lua_isfunction(L, -1))
+				{
+					lua_pushnumber(L, static_cast<lua_Number>(index));
+					lua_call(L, 1, 1);
+				}
+
+				lua_remove(L, -2);
+
+				// add to the reference table
+				lua_pushvalue(L, -1);
+				lua_rawseti(L, 1, ++counter);
+			}
+			break;
+		case SAVED_REFERENCE_PSEUDOTYPE:
+			{
+				uint32 index;
+				b >> index;
+				lua_rawgeti(L, 1, index);
+			}
+			break;
+		default:
+			throw basic_bstream::failure("unknown type in saved Lua data");
+	}
+
+	return type;
+}
+
+// Version 1
+static int restore_v1(lua_State *L, BIStreamBE& s)
 {
 	int8 type;
 	s >> type;
@@ -207,10 +379,10 @@ static int restore(lua_State *L, BIStreamBE& s)
 				lua_pushvalue(L, -2);
 				lua_rawset(L, 1);
 
-				int key_type = restore(L, s);
+				int key_type = restore_v1(L, s);
 				while (key_type != LUA_TNIL)
 				{
-					restore(L, s); // value
+					restore_v1(L, s); // value
 					if (lua_isnil(L, -2)) 
 					{
 						// maybe an invalid userdata?
@@ -220,7 +392,7 @@ static int restore(lua_State *L, BIStreamBE& s)
 					{
 						lua_rawset(L, -3);
 					}
-					key_type = restore(L, s); // next key
+					key_type = restore_v1(L, s); // next key
 				}
 				lua_pop(L, 1);
 			}
@@ -290,7 +462,20 @@ bool lua_restore(lua_State *L, std::streambuf* sb)
 			return false;
 		}
 
-		restore(L, s);
+		if (version < 2)
+			restore_v1(L, s);
+		else
+		{
+			std::vector<char> data;
+			char chunk[4096];
+			std::streamsize count;
+			while ((count = sb->sgetn(chunk, sizeof(chunk))) > 0)
+				data.insert(data.end(), chunk, chunk + count);
+
+			BIBufferBE b(data.empty() ? NULL : &data[0], data.size());
+			uint32 counter = 0;
+			restore(L, b, counter);
+		}
 	}
 	catch (const basic_bstream::failure& e)
 	{
@@ -38,6 +38,7 @@ extern "C"
 #include "lua_mnemonics.h" // for lang_def and mnemonics
 #include <sstream>
 #include <map>
+#include <vector>
 
 static inline int luaL_typerror(lua_State* L, int narg, const char* tname)
 {
@@ -56,6 +57,10 @@ extern std::string L_Get_Search_Path(lua_State* L);
 extern bool L_Get_Proper_Item_Accounting(lua_State* L);
 extern void L_Set_Proper_Item_Accounting(lua_State* L, bool value);
 
+// apply the <lua> garbage collector settings; step once a tick
+extern void L_Configure_Garbage_Collector(lua_State* L);
+extern void L_Step_Garbage_Collector(lua_State* L);
+
 extern bool L_Get_Nonlocal_Overlays(lua_State* L);
 extern void L_Set_Nonlocal_Overlays(lua_State* L, bool value);
 
@@ -117,6 +122,11 @@ protected:
 		lua_pushlightuserdata(L, (void *) (&name[3]));
 	}
 
+	// registry refs of the instances with non-negative indexes, by index, for
+	// each state; the instance table only holds the rest
+	static std::map<lua_State *, std::vector<int> > _instance_refs;
+	static std::vector<int>& _get_instance_refs(lua_State *L);
+
 	// special tables
 	static void _push_custom_fields_table(lua_State *L);
 };
@@ -129,6 +139,28 @@ struct always_valid
 template<char *name, typename index_t>
 boost::function<bool (index_t)> L_Class<name, index_t>::Valid = always_valid();
 
+template<char *name, typename index_t>
+std::map<lua_State *, std::vector<int> > L_Class<name, index_t>::_instance_refs;
+
+// coroutines share their state's registry, so they share its refs too
+template<char *name, typename index_t>
+std::vector<int>& L_Class<name, index_t>::_get_instance_refs(lua_State *L)
+{
+	static lua_State *last_state = 0;
+	static std::vector<int> *last_refs = 0;
+
+	lua_rawgeti(L, LUA_REGISTRYINDEX, LUA_RIDX_MAINTHREAD);
+	lua_State *state = lua_tothread(L, -1);
+	lua_pop(L, 1);
+
+	if (state != last_state)
+	{
+		last_refs = &_instance_refs[state];
+		last_state = state;
+	}
+	return *last_refs;
+}
+
 template<char *name, typename index_t>
 void L_Class<name, index_t>::Register(lua_State *L, const luaL_Reg get[], const luaL_Reg set[], const luaL_Reg metatable[])
 {
@@ -186,6 +218,9 @@ void L_Class<name, index_t>::Register(lua_State *L, const luaL_Reg get[], const
 	lua_newtable(L);
 	lua_settable(L, LUA_REGISTRYINDEX);
 
+	// a new state can turn up where a closed one was
+	std::vector<int>().swap(_get_instance_refs(L));
+
 	// register is_
 	lua_pushcfunction(L, _is);
 	std::string is_name = "is_" + std::string(name);
@@ -203,6 +238,29 @@ L_Class<name, index_t> *L_Class<name, index_t>::Push(lua_State *L, index_t index
 		return 0;
 	}
 
+	if (index >= 0)
+	{
+		std::vector<int>& refs = _get_instance_refs(L);
+		if (static_cast<size_t>(index) < refs.size() && refs[index] != LUA_NOREF)
+		{
+			lua_rawgeti(L, LUA_REGISTRYINDEX, refs[index]);
+			return static_cast<L_Class<name, index_t> *>(lua_touserdata(L, -1));
+		}
+
+		// create an instance
+		t = static_cast<L_Class<name, index_t> *>(lua_newuserdata(L, sizeof(L_Class<name, index_t>)));
+		luaL_getmetatable(L, name);
+		lua_setmetatable(L, -2);
+		t->m_index = index;
+
+		if (static_cast<size_t>(index) >= refs.size())
+			refs.resize(index + 1, LUA_NOREF);
+		lua_pushvalue(L, -1);
+		refs[index] = luaL_ref(L, LUA_REGISTRYINDEX);
+
+		return t;
+	}
+
 	// look it up in the index table
 	_push_instances_key(L);
 	lua_gettable(L, LUA_REGISTRYINDEX);
@@ -272,14 +330,23 @@ bool L_Class<name, index_t>::Is(lua_State *L, int index)
 template<char *name, typename index_t>
 void L_Class<name, index_t>::Invalidate(lua_State *L, index_t index)
 {
-	// remove it from the index table
-	_push_instances_key(L);
-	lua_gettable(L, LUA_REGISTRYINDEX);
+	// remove it from the refs or the index table
+	std::vector<int>& refs = _get_instance_refs(L);
+	if (index >= 0 && static_cast<size_t>(index) < refs.size())
+	{
+		luaL_unref(L, LUA_REGISTRYINDEX, refs[index]);
+		refs[index] = LUA_NOREF;
+	}
+	else if (index < 0)
+	{
+		_push_instances_key(L);
+		lua_gettable(L, LUA_REGISTRYINDEX);
 
-	lua_pushnumber(L, index);
-	lua_pushnil(L);
-	lua_settable(L, -3);
-	lua_pop(L, 1);
+		lua_pushnumber(L, index);
+		lua_pushnil(L);
+		lua_settable(L, -3);
+		lua_pop(L, 1);
+	}
 
 	// clear custom fields
 	lua_pushlightuserdata(L, (void *) (L_Persistent_Table_Key()));
@@ -56,10 +56,8 @@ ActionQueues::ActionQueues(unsigned int inNumPlayers, unsigned int inQueueSize,
     
     assert(mQueueHeaders && mFlagsBuffer);
     
-    /* tell the queues where their buffers are */
     for (unsigned i = 0; i < mNumPlayers; ++i)
     {
-            mQueueHeaders[i].buffer= mFlagsBuffer + i*mQueueSize;
             // From reset()
             mQueueHeaders[i].read_index = mQueueHeaders[i].write_index = 0;
     }
@@ -114,7 +112,7 @@ ActionQueues::enqueueActionFlags(
                 
 	while ((count-= 1)>=0)
 	{
-		queue->buffer[queue->write_index]= *action_flags++;
+		flagsAt(player_index, queue->write_index)= *action_flags++;
 		queue->write_index= (queue->write_index+1) % mQueueSize;
 		if (queue->write_index==queue->read_index)
 			logError("blew player %d's queue", player_index);
@@ -149,7 +147,7 @@ ActionQueues::dequeueActionFlags(
 	else
 	{
 		// assert(queue->read_index!=queue->write_index);
-		action_flags= queue->buffer[queue->read_index];
+		action_flags= flagsAt(player_index, queue->read_index);
 		queue->read_index= (queue->read_index+1) % mQueueSize;
 	}
 
@@ -181,7 +179,7 @@ ActionQueues::peekActionFlags(int inPlayerIndex, size_t inElementsFromHead)
 	else
 	{
 		size_t theQueueIndex = (queue->read_index + inElementsFromHead) % mQueueSize;
-		action_flags= queue->buffer[theQueueIndex];
+		action_flags= flagsAt(inPlayerIndex, theQueueIndex);
 	}
 
 	return action_flags;
@@ -214,6 +212,38 @@ ActionQueues::countActionFlags(
 
 
 
+void
+ActionQueues::enqueueTick(int inPlayerCount, const uint32* inFlags)
+{
+	assert(inPlayerCount <= static_cast<int>(mNumPlayers));
+	for (int p = 0; p < inPlayerCount; ++p)
+		enqueueActionFlags(p, inFlags + p, 1);
+}
+
+
+
+void
+ActionQueues::dequeueTick(int inPlayerCount, uint32* outFlags)
+{
+	assert(inPlayerCount <= static_cast<int>(mNumPlayers));
+	for (int p = 0; p < inPlayerCount; ++p)
+		outFlags[p] = dequeueActionFlags(p);
+}
+
+
+
+unsigned int
+ActionQueues::countTicks(int inPlayerCount)
+{
+	assert(inPlayerCount <= static_cast<int>(mNumPlayers));
+	unsigned int ticks = mQueueSize;
+	for (int p = 0; p < inPlayerCount && ticks > 0; ++p)
+		ticks = std::min(ticks, countActionFlags(p));
+	return ticks;
+}
+
+
+
 bool
 ActionQueues::zombiesControllable() {
         return mZombiesControllable;
@@ -235,7 +265,8 @@ void ModifiableActionQueues::modifyActionFlags(int inPlayerIndex, uint32 inFlags
 	}
 
 	action_queue *queue = mQueueHeaders + inPlayerIndex;
-	if (queue->buffer[queue->read_index] != 0xffffffff)
-		queue->buffer[queue->read_index] = (queue->buffer[queue->read_index] & ~inFlagsMask) | (inFlags & inFlagsMask);
+	uint32& flags = flagsAt(inPlayerIndex, queue->read_index);
+	if (flags != 0xffffffff)
+		flags = (flags & ~inFlagsMask) | (inFlags & inFlagsMask);
 
 }
@@ -56,6 +56,13 @@ public:
     uint32		dequeueActionFlags(int inPlayerIndex);
     uint32		peekActionFlags(int inPlayerIndex, size_t inElementsFromHead);
     unsigned int	countActionFlags(int inPlayerIndex);
+
+    // The same for players 0 through inPlayerCount-1 at once, a tick at a
+    // time: inFlags and outFlags hold one flag for each player
+    void		enqueueTick(int inPlayerCount, const uint32* inFlags);
+    void		dequeueTick(int inPlayerCount, uint32* outFlags);
+    // how many whole ticks there are, for every one of those players
+    unsigned int	countTicks(int inPlayerCount);
     unsigned int	totalCapacity(int inPlayerIndex) { return mQueueSize - 1; }
     unsigned int	availableCapacity(int inPlayerIndex) { return totalCapacity(inPlayerIndex) - countActionFlags(inPlayerIndex); }
     bool		zombiesControllable();
@@ -66,10 +73,13 @@ public:
 protected:
     struct action_queue {
 	    unsigned int read_index, write_index;
-
-	    uint32 *buffer;
     };
 
+    // Tick-major: slot i of every player's queue sits together, so that
+    // while the queues keep pace, a tick's flags share a cache line
+    uint32&		flagsAt(int inPlayerIndex, unsigned int inQueueIndex)
+				{ return mFlagsBuffer[inQueueIndex * mNumPlayers + inPlayerIndex]; }
+
     unsigned int	mNumPlayers;
     unsigned int	mQueueSize;
     action_queue*	mQueueHeaders;
@@ -22,19 +22,33 @@
 	Jan. 16, 2003 (Woody Zenfell): Created.
 
 	May 21, 2003 (Woody Zenfell): being a little more defensive about NULL file pointer.
+
+	Oct 14, 2026: standalone hub (A1_NETWORK_STANDALONE_HUB) logs to the current directory, without MML.
+
+	Oct 14, 2026: messages go through a ring buffer to a writer thread; repeats from one
+	place are limited to a few a second.
 */
 
 #include "Logging.h"
 #include "cseries.h"
-#include "shell.h"
 
+#include <algorithm>
 #include <fstream>
 #include <string>
 #include <vector>
 #include <time.h>	// apparently is in C std library, used here to print time/date log section started.
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <signal.h>
+#include <SDL_atomic.h>
+#include <SDL_mutex.h>
+#include <SDL_thread.h>
+#ifndef A1_NETWORK_STANDALONE_HUB
+#include "shell.h"
 #include "FileHandler.h"
 #include "InfoTree.h"
+#endif
 
 #ifndef NO_STD_NAMESPACE
 using std::vector;
@@ -54,6 +68,234 @@ const char*	logDomain	= "global";
 static void InitializeLogging();
 
 
+// Formatted messages wait in a ring for the writer thread. Any thread may add to
+// it without a lock: each slot's sequence says whether it's free for the position
+// being written (== position), filled (== position + 1), or still being read.
+enum {
+	kRingSize = 512,
+	kRecordSize = 2 * kStringBufferSize,
+	kWriterWakeInterval = 250	// ms, for messages whose post was missed
+};
+
+struct LogRecord {
+	SDL_atomic_t sequence;
+	int length;
+	char text[kRecordSize];
+};
+
+static LogRecord	sRing[kRingSize];
+static SDL_atomic_t	sRingWrite;
+static int	sRingRead = 0;
+static SDL_atomic_t	sDroppedRecords;
+static SDL_mutex*	sDrainLock = NULL;
+static SDL_sem*	sWriterWork = NULL;
+static SDL_Thread*	sWriterThread = NULL;
+static SDL_atomic_t	sWriterQuit;
+
+// How many messages from one place (file and line) may be written each second
+enum {
+	kRateLimitSlots = 256,
+	kMessagesPerSecond = 20
+};
+
+struct RateLimit {
+	const char* file;
+	int line;
+	uint32 window_start;
+	int count;
+	int suppressed;
+};
+
+static RateLimit	sRateLimits[kRateLimitSlots];
+static SDL_SpinLock	sRateLimitLock = 0;
+
+// Writes out what's in the ring; only one drainer at a time
+static void
+DrainRecords(bool inFlushFile) {
+    int theDropped = SDL_AtomicSet(&sDroppedRecords, 0);
+    for (;;) {
+        LogRecord& theRecord = sRing[sRingRead % kRingSize];
+        if (SDL_AtomicGet(&theRecord.sequence) != sRingRead + 1)
+            break;
+
+        if (sOutputFile != NULL)
+            fwrite(theRecord.text, 1, theRecord.length, sOutputFile);
+        fwrite(theRecord.text, 1, theRecord.length, stderr);
+
+        SDL_AtomicSet(&theRecord.sequence, sRingRead + kRingSize);
+        sRingRead++;
+    }
+
+    if (theDropped) {
+        if (sOutputFile != NULL)
+            fprintf(sOutputFile, "(%d log messages were dropped)\n", theDropped);
+        fprintf(stderr, "(%d log messages were dropped)\n", theDropped);
+    }
+
+    if (inFlushFile && sOutputFile != NULL)
+        fflush(sOutputFile);
+}
+
+static int
+LogWriterThread(void*) {
+    while (!SDL_AtomicGet(&sWriterQuit)) {
+        SDL_SemWaitTimeout(sWriterWork, kWriterWakeInterval);
+
+        SDL_LockMutex(sDrainLock);
+        DrainRecords(sFlushOutput);
+        SDL_UnlockMutex(sDrainLock);
+    }
+    return 0;
+}
+
+static void
+FlushRecords() {
+    if (sDrainLock == NULL)
+        return;
+    SDL_LockMutex(sDrainLock);
+    DrainRecords(true);
+    SDL_UnlockMutex(sDrainLock);
+}
+
+// Returns false if the ring is full
+static bool
+EnqueueRecord(const string& inText) {
+    for (;;) {
+        int thePosition = SDL_AtomicGet(&sRingWrite);
+        LogRecord& theRecord = sRing[thePosition % kRingSize];
+        int theDifference = SDL_AtomicGet(&theRecord.sequence) - thePosition;
+        if (theDifference == 0) {
+            if (!SDL_AtomicCAS(&sRingWrite, thePosition, thePosition + 1))
+                continue;
+
+            theRecord.length = static_cast<int>(std::min(inText.size(), size_t(kRecordSize)));
+            memcpy(theRecord.text, inText.data(), theRecord.length);
+            SDL_AtomicSet(&theRecord.sequence, thePosition + 1);
+            return true;
+        }
+        if (theDifference < 0)
+            return false;
+    }
+}
+
+static void
+WriteRecord(int inLevel, const string& inText) {
+    if (sWriterThread == NULL) {
+        // no thread to hand it to (or it has stopped): write it now, in order
+        if (sDrainLock != NULL)
+            SDL_LockMutex(sDrainLock);
+        if (sOutputFile != NULL)
+            fputs(inText.c_str(), sOutputFile);
+        fputs(inText.c_str(), stderr);
+        if (sFlushOutput && sOutputFile != NULL)
+            fflush(sOutputFile);
+        if (sDrainLock != NULL)
+            SDL_UnlockMutex(sDrainLock);
+        return;
+    }
+
+    while (!EnqueueRecord(inText)) {
+        // the worst of it must get there; the rest may be dropped
+        if (inLevel > logErrorLevel) {
+            SDL_AtomicAdd(&sDroppedRecords, 1);
+            return;
+        }
+        SDL_SemPost(sWriterWork);
+        SDL_Delay(1);
+    }
+
+    if (sFlushOutput || inLevel <= logFatalLevel)
+        FlushRecords();
+    else
+        SDL_SemPost(sWriterWork);
+}
+
+// Whether a message from here may be written; counts the ones that weren't, to say so later
+static bool
+PassesRateLimit(int inLevel, const char* inFile, int inLine, int& outSuppressed) {
+    outSuppressed = 0;
+    if (inLevel <= logErrorLevel)
+        return true;
+
+    size_t theSlot = (reinterpret_cast<uintptr_t>(inFile) / sizeof(void*) * 31 + inLine) % kRateLimitSlots;
+    uint32 theNow = SDL_GetTicks();
+    bool thePasses = true;
+
+    SDL_AtomicLock(&sRateLimitLock);
+    RateLimit& theLimit = sRateLimits[theSlot];
+    if (theLimit.file != inFile || theLimit.line != inLine) {
+        theLimit.file = inFile;
+        theLimit.line = inLine;
+        theLimit.window_start = theNow;
+        theLimit.count = 0;
+        theLimit.suppressed = 0;
+    }
+    else if (theNow - theLimit.window_start >= 1000) {
+        outSuppressed = theLimit.suppressed;
+        theLimit.window_start = theNow;
+        theLimit.count = 0;
+        theLimit.suppressed = 0;
+    }
+
+    if (++theLimit.count > kMessagesPerSecond) {
+        theLimit.suppressed++;
+        thePasses = false;
+    }
+    SDL_AtomicUnlock(&sRateLimitLock);
+
+    return thePasses;
+}
+
+static void
+StopLogWriter() {
+    if (sWriterThread != NULL) {
+        SDL_AtomicSet(&sWriterQuit, 1);
+        SDL_SemPost(sWriterWork);
+        SDL_WaitThread(sWriterThread, NULL);
+        sWriterThread = NULL;
+    }
+    FlushRecords();
+}
+
+// Gets what's waiting out before a crash takes the process down
+typedef void (*SignalHandler)(int);
+static SignalHandler sPreviousHandlers[4];
+static const int sCrashSignals[4] = { SIGSEGV, SIGABRT, SIGFPE, SIGILL };
+
+static void
+CrashHandler(int inSignal) {
+    // a drain under way on the crashing thread would never finish
+    if (sDrainLock != NULL && SDL_TryLockMutex(sDrainLock) == 0) {
+        DrainRecords(true);
+        SDL_UnlockMutex(sDrainLock);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        if (sCrashSignals[i] == inSignal) {
+            signal(inSignal, sPreviousHandlers[i] == SIG_ERR ? SIG_DFL : sPreviousHandlers[i]);
+            break;
+        }
+    }
+    raise(inSignal);
+}
+
+static void
+StartLogWriter() {
+    for (int i = 0; i < kRingSize; i++)
+        SDL_AtomicSet(&sRing[i].sequence, i);
+    SDL_AtomicSet(&sRingWrite, 0);
+
+    sDrainLock = SDL_CreateMutex();
+    sWriterWork = SDL_CreateSemaphore(0);
+    if (sDrainLock != NULL && sWriterWork != NULL)
+        sWriterThread = SDL_CreateThread(LogWriterThread, "log_writer", NULL);
+
+    atexit(StopLogWriter);
+    for (int i = 0; i < 4; i++)
+        sPreviousHandlers[i] = signal(sCrashSignals[i], CrashHandler);
+}
+
+
 Logger*
 GetCurrentLogger() {
     if(sCurrentLogger == NULL)
@@ -149,8 +391,10 @@ void
 TopLevelLogger::logMessageV(const char* inDomain, int inLevel, const char* inFile, int inLine, const char* inMessage, va_list inArgs) {
     // Obviously eventually this will be settable more dynamically...
     // Also eventually some logged messages could be posted in a dialog in addition to appended to the file.
-    if(sOutputFile != NULL && inLevel < sLoggingThreshhold) {
+    int theSuppressed;
+    if(sOutputFile != NULL && inLevel < sLoggingThreshhold && PassesRateLimit(inLevel, inFile, inLine, theSuppressed)) {
         char	stringBuffer[kStringBufferSize];
+        string	theRecord;
         size_t firstDepthToPrint = mMostRecentCommonStackDepth;
     /*
         // This was designed to give a little context when coming back from deep stacks, but it seems
@@ -165,8 +409,8 @@ TopLevelLogger::logMessageV(const char* inDomain, int inLevel, const char* inFil
             theString += "while ";
             theString += mContextStack[depth];
             
-            fprintf(sOutputFile, "%s\n", theString.c_str());
-			fprintf(stderr, "%s\n", theString.c_str());
+            theRecord += theString;
+            theRecord += "\n";
         }
         
         vsnprintf(stringBuffer, kStringBufferSize, inMessage, inArgs);
@@ -182,11 +426,13 @@ TopLevelLogger::logMessageV(const char* inDomain, int inLevel, const char* inFil
         else
             theString += "\n";
         
-        fprintf(sOutputFile, "%s", theString.c_str());
-		fprintf(stderr, "%s", theString.c_str());
+        theRecord += theString;
+        if(theSuppressed) {
+            snprintf(stringBuffer, kStringBufferSize, "(%d more like this were not logged)\n", theSuppressed);
+            theRecord += stringBuffer;
+        }
         
-        if(sFlushOutput)
-                fflush(sOutputFile);
+        WriteRecord(inLevel, theRecord);
         
         mMostRecentCommonStackDepth = mContextStack.size();
         mMostRecentlyPrintedStackDepth = mContextStack.size();
@@ -195,10 +441,7 @@ TopLevelLogger::logMessageV(const char* inDomain, int inLevel, const char* inFil
 
 void TopLevelLogger::flush()
 {
-	if (sOutputFile)
-	{
-		fflush(sOutputFile);
-	}
+	FlushRecords();
 }
 
 #if defined(__unix__) || defined(__NetBSD__) || defined(__OpenBSD__) || (defined(__APPLE__) && defined(__MACH__))
@@ -209,6 +452,7 @@ void TopLevelLogger::flush()
 #endif
 #endif
 
+#ifndef A1_NETWORK_STANDALONE_HUB
 extern DirectorySpecifier log_dir;
 
 char g_loggingFileName[256] = "";
@@ -221,14 +465,24 @@ const char *loggingFileName()
 	}
 	return g_loggingFileName;
 }
+#else
+const char *loggingFileName()
+{
+	return "alephone-hub Log.txt";
+}
+#endif
 
 static void
 InitializeLogging() {
     assert(sOutputFile == NULL);
+#ifndef A1_NETWORK_STANDALONE_HUB
     FileSpecifier fs = log_dir;
     fs += loggingFileName();
 
     sOutputFile = fopen(fs.GetPath(), "a");
+#else
+    sOutputFile = fopen(loggingFileName(), "a");
+#endif
 
     sCurrentLogger = new TopLevelLogger;
     if(sOutputFile != NULL)
@@ -237,6 +491,8 @@ InitializeLogging() {
 	    const char* theTimeString = ctime(&theTime);
 	    fprintf(sOutputFile, "\n-------------------- %s\n\n", theTimeString == NULL ? "(timestamp unavailable)" : theTimeString);
     }
+
+    StartLogWriter();
 }
 
 
@@ -258,11 +514,12 @@ setFlushLoggingOutput(const char* inDomain, bool inFlushOutput) {
         sFlushOutput = inFlushOutput;
 
         // Flush now for good measure
-        if(sFlushOutput && sOutputFile != NULL)
-                fflush(sOutputFile);
+        if(sFlushOutput)
+                FlushRecords();
 }
 
 
+#ifndef A1_NETWORK_STANDALONE_HUB
 void reset_mml_logging()
 {
 	// no reset
@@ -270,7 +527,7 @@ void reset_mml_logging()
 
 void parse_mml_logging(const InfoTree& root)
 {
-	BOOST_FOREACH(InfoTree dtree, root.children_named("logging_domain"))
+	BOOST_FOREACH(const InfoTree &dtree, root.children_named("logging_domain"))
 	{
 		std::string domain;
 		if (!dtree.read_attr("domain", domain) || !domain.size())
@@ -287,3 +544,4 @@ void parse_mml_logging(const InfoTree& root)
 			setFlushLoggingOutput(domain.c_str(), flush);
 	}
 }
+#endif
@@ -0,0 +1,153 @@
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  Memory accounting (see MemoryAccounting.h)
+
+ */
+
+#include "MemoryAccounting.h"
+
+#include "Console.h"
+#include "Logging.h"
+#include "interface.h"
+#include "map.h"
+#include "shell.h"
+#include "SoundManager.h"
+#include "lua_allocator.h"
+#include "OGL_Textures.h"
+#include "OGL_Model_Def.h"
+#include "preferences.h"
+#include "WadImageCache.h"
+
+#include <string.h>
+
+size_t MemoryAccounting::current[NUMBER_OF_MEMORY_SUBSYSTEMS];
+size_t MemoryAccounting::peak[NUMBER_OF_MEMORY_SUBSYSTEMS];
+uint32 MemoryAccounting::last_sample = 0;
+
+static const char *subsystem_names[NUMBER_OF_MEMORY_SUBSYSTEMS] = {
+	"shapes",
+	"textures",
+	"sounds",
+	"lua",
+	"models",
+	"map"
+};
+
+const char *MemoryAccounting::Name(int subsystem)
+{
+	return subsystem_names[subsystem];
+}
+
+void MemoryAccounting::Sample()
+{
+	current[_memory_shapes] = get_collections_memory_usage();
+#ifdef HAVE_OPENGL
+	current[_memory_textures] = static_cast<size_t>(OGL_TextureBytesLoaded());
+	current[_memory_models] = OGL_ModelMemoryUsage();
+#endif
+	current[_memory_sounds] = SoundManager::instance()->MemoryUsage();
+#ifdef HAVE_LUA
+	current[_memory_lua] = L_Get_Total_Memory_Usage();
+#endif
+	current[_memory_map] = get_map_memory_usage();
+
+	for (int i = 0; i < NUMBER_OF_MEMORY_SUBSYSTEMS; ++i)
+		peak[i] = MAX(peak[i], current[i]);
+
+	last_sample = machine_tick_count();
+}
+
+void MemoryAccounting::Idle()
+{
+	if (machine_tick_count() - last_sample >= MACHINE_TICKS_PER_SECOND)
+		Sample();
+}
+
+void MemoryAccounting::ResetPeaks()
+{
+	memcpy(peak, current, sizeof(peak));
+}
+
+void MemoryAccounting::LevelEnded(const std::string& level_name)
+{
+	Sample();
+
+	size_t total = 0, total_peak = 0;
+	logNote("Memory at the end of %s:", level_name.c_str());
+	for (int i = 0; i < NUMBER_OF_MEMORY_SUBSYSTEMS; ++i)
+	{
+		logNote("  %-8s %8.1f KB now, %8.1f KB at most", Name(i), current[i] / 1024.0, peak[i] / 1024.0);
+		total += current[i];
+		total_peak += peak[i];
+	}
+	logNote("  %-8s %8.1f KB now, %8.1f KB at most", "total", total / 1024.0, total_peak / 1024.0);
+
+	ResetPeaks();
+}
+
+void MemoryAccounting::ShowFootprint()
+{
+	Sample();
+
+	size_t total = 0, total_peak = 0;
+	for (int i = 0; i < NUMBER_OF_MEMORY_SUBSYSTEMS; ++i)
+	{
+		total += current[i];
+		total_peak += peak[i];
+	}
+	screen_printf("total: %.1f KB (%.1f KB at most)%s", total / 1024.0, total_peak / 1024.0, environment_preferences->low_memory ? " in low memory mode" : "");
+
+	screen_printf("sounds budget: %.1f KB", SoundManager::instance()->MemoryBudget() / 1024.0);
+#ifdef HAVE_OPENGL
+	int texture_budget = OGL_TextureMemoryBudget();
+	if (texture_budget > 0)
+		screen_printf("textures budget: %i MB", texture_budget);
+	else
+		screen_printf("textures budget: no limit");
+#endif
+	screen_printf("image cache: %.1f of %.1f MB on disk", WadImageCache::instance()->size() / 1e6, WadImageCache::instance()->limit() / 1e6);
+}
+
+struct memory_show_command
+{
+	void operator() (const std::string&) const {
+		MemoryAccounting::Sample();
+		for (int i = 0; i < NUMBER_OF_MEMORY_SUBSYSTEMS; ++i)
+			screen_printf("%s: %.1f KB (%.1f KB at most)", MemoryAccounting::Name(i), MemoryAccounting::Current(i) / 1024.0, MemoryAccounting::Peak(i) / 1024.0);
+		MemoryAccounting::ShowFootprint();
+	}
+};
+
+struct memory_reset_command
+{
+	void operator() (const std::string&) const {
+		MemoryAccounting::Sample();
+		MemoryAccounting::ResetPeaks();
+		screen_printf("Memory peaks reset");
+	}
+};
+
+void MemoryAccounting::RegisterCommands()
+{
+	CommandParser memoryParser;
+	memoryParser.register_command("reset", memory_reset_command());
+	memoryParser.register_command("show", memory_show_command());
+	memoryParser.register_command("", memory_show_command());
+	Console::instance()->register_command("memory", memoryParser);
+}
@@ -0,0 +1,74 @@
+#ifndef __MEMORYACCOUNTING_H
+#define __MEMORYACCOUNTING_H
+
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  Memory accounting: what the shapes collections, OpenGL textures, sounds,
+  Lua states, models and map data each hold, asked of each subsystem's own
+  bookkeeping; with the most each has held since the level started
+
+ */
+
+#include "cseries.h"
+#include <string>
+
+enum /* memory subsystems */
+{
+	_memory_shapes,
+	_memory_textures,
+	_memory_sounds,
+	_memory_lua,
+	_memory_models,
+	_memory_map,
+	NUMBER_OF_MEMORY_SUBSYSTEMS
+};
+
+class MemoryAccounting
+{
+public:
+	// "memory" (or "memory show") shows each subsystem's bytes now and at most; "memory reset"
+	// starts the peaks over
+	static void RegisterCommands();
+
+	// Asks every subsystem what it holds now
+	static void Sample();
+
+	// Samples at most once a second; call as often as convenient
+	static void Idle();
+
+	static size_t Current(int subsystem) { return current[subsystem]; }
+	static size_t Peak(int subsystem) { return peak[subsystem]; }
+	static const char *Name(int subsystem);
+
+	static void ResetPeaks();
+
+	// Prints the total, and the budgets the subsystems keep to (smaller in low memory mode)
+	static void ShowFootprint();
+
+	// Logs each subsystem's bytes now and at most during the level, and
+	// starts the peaks over
+	static void LevelEnded(const std::string& level_name);
+
+private:
+	static size_t current[NUMBER_OF_MEMORY_SUBSYSTEMS];
+	static size_t peak[NUMBER_OF_MEMORY_SUBSYSTEMS];
+	static uint32 last_sample;
+};
+
+#endif
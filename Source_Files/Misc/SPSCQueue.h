@@ -0,0 +1,125 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  A circular queue for handing things from one thread to another without
+  locks, as CircularQueue does within one thread.
+
+  Exactly one thread may enqueue and exactly one other may dequeue at a
+  time; which threads those are may change, as long as the change is
+  itself synchronized (say, under SDL_LockAudio()). reset() and the
+  destructor may only be called while neither side is using the queue.
+
+  The write index is only stored by the producer, after the elements are
+  in place; the read index only by the consumer, after it is done with
+  them. SDL's atomics order those stores against the element copies, so
+  each side sees the other's data before the index that hands it over.
+  The two indices sit on separate cache lines, so the threads don't
+  contend for one.
+
+ */
+
+#include "csalerts.h"  // need assert
+#include <SDL_atomic.h>
+
+template<typename T>
+class SPSCQueue {
+public:
+	explicit SPSCQueue(unsigned int inSize) : mData(NULL), mQueueSize(0) { reset(inSize); }
+	~SPSCQueue() { delete [] mData; }
+
+	void reset() { reset(getTotalSpace()); }
+
+	void reset(unsigned int inSize) {
+		// One more than the queue holds, so that full and empty differ
+		unsigned int theStorageCount = inSize + 1;
+		assert(theStorageCount > inSize);
+
+		if (theStorageCount != mQueueSize || mData == NULL) {
+			delete [] mData;
+			mQueueSize = theStorageCount;
+			mData = new T[mQueueSize];
+		}
+
+		SDL_AtomicSet(&mReadIndex, 0);
+		SDL_AtomicSet(&mWriteIndex, 0);
+	}
+
+	unsigned int getTotalSpace() const { return mQueueSize - 1; }
+
+	// Exact for the side asking about its own end: the consumer may find
+	// more elements, and the producer more space, by the time it acts
+	unsigned int getCountOfElements() const {
+		unsigned int theRead = SDL_AtomicGet(const_cast<SDL_atomic_t *>(&mReadIndex));
+		unsigned int theWrite = SDL_AtomicGet(const_cast<SDL_atomic_t *>(&mWriteIndex));
+		return (mQueueSize + theWrite - theRead) % mQueueSize;
+	}
+
+	unsigned int getRemainingSpace() const { return getTotalSpace() - getCountOfElements(); }
+
+	// Producer only; false, and nothing enqueued, if there isn't room
+	bool enqueue(const T& inData) { return enqueue(&inData, 1); }
+
+	bool enqueue(const T* inData, unsigned int inCount) {
+		if (inCount > getRemainingSpace())
+			return false;
+
+		unsigned int theWrite = SDL_AtomicGet(&mWriteIndex);
+		for (unsigned int i = 0; i < inCount; i++) {
+			mData[theWrite] = inData[i];
+			theWrite = (theWrite + 1) % mQueueSize;
+		}
+		SDL_AtomicSet(&mWriteIndex, theWrite);
+		return true;
+	}
+
+	// Consumer only; false, and nothing dequeued, if there are too few
+	bool dequeue(T& outData) { return dequeue(&outData, 1); }
+
+	bool dequeue(T* outData, unsigned int inCount) {
+		if (inCount > getCountOfElements())
+			return false;
+
+		unsigned int theRead = SDL_AtomicGet(&mReadIndex);
+		for (unsigned int i = 0; i < inCount; i++) {
+			outData[i] = mData[theRead];
+			theRead = (theRead + 1) % mQueueSize;
+		}
+		SDL_AtomicSet(&mReadIndex, theRead);
+		return true;
+	}
+
+private:
+	enum { kCacheLineSize = 64 };
+
+	SDL_atomic_t	mReadIndex;
+	char		mReadPadding[kCacheLineSize - sizeof(SDL_atomic_t)];
+	SDL_atomic_t	mWriteIndex;
+	char		mWritePadding[kCacheLineSize - sizeof(SDL_atomic_t)];
+
+	T*		mData;
+	unsigned int	mQueueSize;
+
+	// Copying would have to stop both threads
+	SPSCQueue(const SPSCQueue<T>&);
+	SPSCQueue<T>& operator =(const SPSCQueue<T>&);
+};
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,248 @@
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  Startup tasks (see StartupTasks.h)
+
+ */
+
+#include "StartupTasks.h"
+
+#include "Logging.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Few steps may run off the main thread, so a few workers will do
+const int MAXIMUM_STARTUP_WORKERS = 3;
+
+StartupTasks::StartupTasks() :
+	m_mutex(NULL),
+	m_changed(NULL),
+	m_next_worker(0)
+{
+}
+
+int StartupTasks::Add(const char *name, task_proc proc, int thread, int after, int after_too)
+{
+	int id = static_cast<int>(m_tasks.size());
+	assert(after < id && after_too < id);
+
+	Task task;
+	task.name = name;
+	task.proc = proc;
+	task.thread = thread;
+	task.after[0] = after;
+	task.after[1] = after_too;
+	task.started = task.done = false;
+	task.worker = NONE;
+	task.start_time = task.end_time = 0;
+	m_tasks.push_back(task);
+
+	return id;
+}
+
+bool StartupTasks::Ready(const Task& task) const
+{
+	for (int i = 0; i < 2; ++i)
+	{
+		if (task.after[i] != NONE && !m_tasks[task.after[i]].done)
+			return false;
+	}
+	return true;
+}
+
+// Whether every step for the workers has been taken
+bool StartupTasks::HandedOut() const
+{
+	for (size_t i = 0; i < m_tasks.size(); ++i)
+	{
+		if (m_tasks[i].thread == _any_thread && !m_tasks[i].started)
+			return false;
+	}
+	return true;
+}
+
+bool StartupTasks::Done() const
+{
+	for (size_t i = 0; i < m_tasks.size(); ++i)
+	{
+		if (!m_tasks[i].done)
+			return false;
+	}
+	return true;
+}
+
+// Call with the mutex held; the step returned is the caller's to run
+StartupTasks::Task *StartupTasks::NextForWorker()
+{
+	for (size_t i = 0; i < m_tasks.size(); ++i)
+	{
+		Task& task = m_tasks[i];
+		if (task.thread == _any_thread && !task.started && Ready(task))
+		{
+			task.started = true;
+			return &task;
+		}
+	}
+	return NULL;
+}
+
+// Call without the mutex held
+void StartupTasks::RunTask(Task& task, int worker)
+{
+	task.worker = worker;
+	task.start_time = SDL_GetPerformanceCounter();
+	task.proc();
+	task.end_time = SDL_GetPerformanceCounter();
+
+	if (m_mutex)
+	{
+		SDL_LockMutex(m_mutex);
+		task.done = true;
+		SDL_CondBroadcast(m_changed);
+		SDL_UnlockMutex(m_mutex);
+	}
+	else
+		task.done = true;
+}
+
+int StartupTasks::Worker(void *data)
+{
+	StartupTasks *tasks = static_cast<StartupTasks *>(data);
+
+	SDL_LockMutex(tasks->m_mutex);
+	int worker = tasks->m_next_worker++;
+	while (!tasks->HandedOut())
+	{
+		Task *task = tasks->NextForWorker();
+		if (task)
+		{
+			SDL_UnlockMutex(tasks->m_mutex);
+			tasks->RunTask(*task, worker);
+			SDL_LockMutex(tasks->m_mutex);
+		}
+		else
+			SDL_CondWait(tasks->m_changed, tasks->m_mutex);
+	}
+	SDL_UnlockMutex(tasks->m_mutex);
+
+	return 0;
+}
+
+void StartupTasks::Run(bool profile)
+{
+	uint64_t run_start = SDL_GetPerformanceCounter();
+
+	int any_thread_count = 0;
+	for (size_t i = 0; i < m_tasks.size(); ++i)
+	{
+		if (m_tasks[i].thread == _any_thread)
+			++any_thread_count;
+	}
+
+	m_mutex = SDL_CreateMutex();
+	m_changed = SDL_CreateCond();
+	if (!m_mutex || !m_changed)
+	{
+		// Everything in the order it was added, which keeps every step
+		// after those it waits for
+		if (m_changed) SDL_DestroyCond(m_changed);
+		if (m_mutex) SDL_DestroyMutex(m_mutex);
+		m_mutex = NULL;
+		m_changed = NULL;
+		for (size_t i = 0; i < m_tasks.size(); ++i)
+			RunTask(m_tasks[i], NONE);
+	}
+	else
+	{
+		std::vector<SDL_Thread *> workers;
+		int worker_count = MIN(MIN(SDL_GetCPUCount() - 1, any_thread_count), MAXIMUM_STARTUP_WORKERS);
+		for (int i = 0; i < worker_count; ++i)
+		{
+			SDL_Thread *thread = SDL_CreateThread(Worker, "StartupTasks", this);
+			if (thread)
+				workers.push_back(thread);
+		}
+
+		// The main thread's steps, in order; without workers, it takes
+		// the others too, whenever it would otherwise wait for them
+		SDL_LockMutex(m_mutex);
+		for (size_t i = 0; i <= m_tasks.size(); ++i)
+		{
+			Task *task = (i < m_tasks.size()) ? &m_tasks[i] : NULL;
+			if (task && task->thread != _main_thread)
+				continue;
+
+			while (task ? !Ready(*task) : !Done())
+			{
+				Task *other = workers.empty() ? NextForWorker() : NULL;
+				if (other)
+				{
+					SDL_UnlockMutex(m_mutex);
+					RunTask(*other, NONE);
+					SDL_LockMutex(m_mutex);
+				}
+				else
+					SDL_CondWait(m_changed, m_mutex);
+			}
+
+			if (task)
+			{
+				task->started = true;
+				SDL_UnlockMutex(m_mutex);
+				RunTask(*task, NONE);
+				SDL_LockMutex(m_mutex);
+			}
+		}
+		SDL_UnlockMutex(m_mutex);
+
+		for (size_t i = 0; i < workers.size(); ++i)
+			SDL_WaitThread(workers[i], NULL);
+
+		SDL_DestroyCond(m_changed);
+		SDL_DestroyMutex(m_mutex);
+		m_changed = NULL;
+		m_mutex = NULL;
+	}
+
+	if (profile)
+	{
+		double to_ms = 1000.0 / SDL_GetPerformanceFrequency();
+		for (size_t i = 0; i < m_tasks.size(); ++i)
+		{
+			const Task& task = m_tasks[i];
+			char thread[16];
+			if (task.worker == NONE)
+				strcpy(thread, "main");
+			else
+				snprintf(thread, sizeof(thread), "worker %d", task.worker + 1);
+
+			char report[128];
+			snprintf(report, sizeof(report), "startup %-24s %8.2f ms, at %8.2f ms on %s",
+					 task.name, (task.end_time - task.start_time) * to_ms,
+					 (task.start_time - run_start) * to_ms, thread);
+			logNote("%s", report);
+			printf("%s\n", report);
+		}
+
+		char report[64];
+		snprintf(report, sizeof(report), "startup took %.2f ms", (SDL_GetPerformanceCounter() - run_start) * to_ms);
+		logNote("%s", report);
+		printf("%s\n", report);
+	}
+}
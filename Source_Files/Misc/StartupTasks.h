@@ -0,0 +1,80 @@
+#ifndef __STARTUPTASKS_H
+#define __STARTUPTASKS_H
+
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  Startup tasks: the steps of starting the application, as a graph.
+  Steps for the main thread run there one after another, in the order
+  they were added; steps that may run anywhere are handed to a few worker
+  threads as soon as the steps they wait for are done, while the main
+  thread goes on with its own
+
+ */
+
+#include "cseries.h"
+#include <stdint.h>
+#include <vector>
+
+class StartupTasks
+{
+public:
+	typedef void (*task_proc)(void);
+
+	enum {
+		_main_thread, // anything touching the window, dialogs or MML state
+		_any_thread
+	};
+
+	StartupTasks();
+
+	// Returns the step's id, for later steps to wait for; a step may
+	// only wait for steps added before it
+	int Add(const char *name, task_proc proc, int thread, int after = NONE, int after_too = NONE);
+
+	// Returns when every step has run; with profile on, prints how long
+	// each took, when it started and on which thread
+	void Run(bool profile);
+
+private:
+	struct Task {
+		const char *name;
+		task_proc proc;
+		int thread;
+		int after[2];
+		bool started;
+		bool done;
+		int worker; // that ran it; NONE for the main thread
+		uint64_t start_time, end_time;
+	};
+	std::vector<Task> m_tasks;
+
+	SDL_mutex *m_mutex;
+	SDL_cond *m_changed;
+	int m_next_worker;
+
+	bool Ready(const Task& task) const;
+	bool HandedOut() const;
+	bool Done() const;
+	Task *NextForWorker();
+	void RunTask(Task& task, int worker);
+
+	static int Worker(void *data);
+};
+
+#endif
@@ -49,6 +49,7 @@ private:
 StatsManager::StatsManager() : thread_(0), run_(true)
 {
 	entry_mutex_ = SDL_CreateMutex();
+	entry_added_ = SDL_CreateCond();
 
 	// do uploads in a separate thread
 	thread_ = SDL_CreateThread(Run, "StatsManager_uploadThread", this);
@@ -62,6 +63,7 @@ void StatsManager::Process()
 		ScopedMutex mutex(entry_mutex_);
 		busy_ = true;
 		entries_.push(entry);
+		SDL_CondSignal(entry_added_);
 	}
 }
 
@@ -114,6 +116,8 @@ static uint32 checksum_string(const std::string& s)
 int StatsManager::Run(void *pv)
 {
 	StatsManager* sm = reinterpret_cast<StatsManager*>(pv);
+
+	// one client for every upload, so they share a connection
 	HTTPClient client;
 
 	while (sm->run_)
@@ -124,6 +128,10 @@ int StatsManager::Run(void *pv)
 			if (sm->entries_.empty())
 			{
 				sm->busy_ = false;
+
+				// woken as soon as there's another; the timeout is for
+				// noticing we've been told to stop
+				SDL_CondWaitTimeout(sm->entry_added_, sm->entry_mutex_, 200);
 			}
 			else
 			{
@@ -154,11 +162,6 @@ int StatsManager::Run(void *pv)
 
 			client.Post(A1_STATSERVER_ADD_URL, entry->parameters);
 		}
-		else
-		{
-			SDL_Delay(200);
-		}
-		
 	}
 
 	return 0;
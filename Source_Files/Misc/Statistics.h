@@ -64,6 +64,7 @@ private:
 	// thread fun
 	SDL_Thread* thread_;
 	SDL_mutex* entry_mutex_;
+	SDL_cond* entry_added_;
 	bool run_;
 	bool busy_;
 	static int Run(void *);
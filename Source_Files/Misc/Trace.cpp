@@ -0,0 +1,248 @@
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  Tracer (see Trace.h)
+
+ */
+
+#include "Trace.h"
+
+#include "Logging.h"
+#ifndef A1_NETWORK_STANDALONE_HUB
+#include "Console.h"
+#include "FileHandler.h"
+#include "shell.h"
+#endif
+
+#include <SDL_mutex.h>
+#include <SDL_thread.h>
+#include <stdio.h>
+#include <vector>
+
+#ifndef A1_NETWORK_STANDALONE_HUB
+static const char *trace_name = "Trace.json";
+#endif
+
+// Spans a thread may keep, so that a forgotten trace can't take all memory
+enum { kMaximumSpansPerThread = 1 << 20 };
+
+struct TraceEvent {
+	const char *name;
+	uint64_t begin;
+	uint64_t end;
+};
+
+// Each thread's spans; its own thread adds to them, and the lock is only
+// ever contended while a trace is being written
+struct TraceBuffer {
+	TraceBuffer() : lock(0), id(0), full(false) { }
+
+	SDL_SpinLock lock;
+	SDL_threadID id;
+	std::string name;
+	std::vector<TraceEvent> events;
+	bool full;
+};
+
+SDL_atomic_t Tracer::active;
+
+static SDL_mutex *buffers_lock = NULL;
+static std::vector<TraceBuffer *> buffers;
+static uint64_t trace_start = 0;
+static thread_local TraceBuffer *thread_buffer = NULL;
+
+static TraceBuffer *get_thread_buffer()
+{
+	if (!thread_buffer)
+	{
+		// buffers outlive their threads, so that their spans can still be written
+		TraceBuffer *buffer = new TraceBuffer;
+		buffer->id = SDL_ThreadID();
+
+		SDL_LockMutex(buffers_lock);
+		buffers.push_back(buffer);
+		SDL_UnlockMutex(buffers_lock);
+		thread_buffer = buffer;
+	}
+	return thread_buffer;
+}
+
+void Tracer::Start()
+{
+	if (!buffers_lock)
+		buffers_lock = SDL_CreateMutex();
+
+	SDL_LockMutex(buffers_lock);
+	for (size_t i = 0; i < buffers.size(); i++)
+	{
+		SDL_AtomicLock(&buffers[i]->lock);
+		buffers[i]->events.clear();
+		buffers[i]->full = false;
+		SDL_AtomicUnlock(&buffers[i]->lock);
+	}
+	trace_start = SDL_GetPerformanceCounter();
+	SDL_UnlockMutex(buffers_lock);
+
+	SDL_AtomicSet(&active, 1);
+}
+
+void Tracer::Stop()
+{
+	SDL_AtomicSet(&active, 0);
+}
+
+void Tracer::NameThread(const char *name)
+{
+	if (!IsActive())
+		return;
+
+	TraceBuffer *buffer = get_thread_buffer();
+	if (buffer->name.empty())
+	{
+		SDL_AtomicLock(&buffer->lock);
+		buffer->name = name;
+		SDL_AtomicUnlock(&buffer->lock);
+	}
+}
+
+void Tracer::Record(const char *name, uint64_t begin, uint64_t end)
+{
+	// a span begun before the trace started belongs to no trace
+	if (!IsActive() || begin < trace_start)
+		return;
+
+	TraceBuffer *buffer = get_thread_buffer();
+	SDL_AtomicLock(&buffer->lock);
+	if (buffer->events.size() < kMaximumSpansPerThread)
+	{
+		TraceEvent event = { name, begin, end };
+		buffer->events.push_back(event);
+	}
+	else
+		buffer->full = true;
+	SDL_AtomicUnlock(&buffer->lock);
+}
+
+// Names are ours (string literals), but keep the JSON valid regardless
+static void write_json_string(FILE *file, const char *s)
+{
+	fputc('"', file);
+	for (; *s; s++)
+	{
+		if (*s == '"' || *s == '\\')
+			fputc('\\', file);
+		if (static_cast<unsigned char>(*s) >= 0x20)
+			fputc(*s, file);
+	}
+	fputc('"', file);
+}
+
+bool Tracer::Write(const std::string& path)
+{
+	if (!buffers_lock)
+		return false;
+
+	FILE *file = fopen(path.c_str(), "w");
+	if (!file)
+		return false;
+
+	double frequency = SDL_GetPerformanceFrequency() / 1000000.0;
+	bool first = true;
+	bool any_full = false;
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	SDL_LockMutex(buffers_lock);
+	for (size_t i = 0; i < buffers.size(); i++)
+	{
+		TraceBuffer *buffer = buffers[i];
+		SDL_AtomicLock(&buffer->lock);
+		std::vector<TraceEvent> events(buffer->events);
+		std::string name = buffer->name;
+		any_full = any_full || buffer->full;
+		SDL_AtomicUnlock(&buffer->lock);
+
+		if (events.empty())
+			continue;
+
+		unsigned long tid = static_cast<unsigned long>(buffer->id);
+		if (!name.empty())
+		{
+			fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":", first ? "" : ",\n", tid);
+			write_json_string(file, name.c_str());
+			fprintf(file, "}}");
+			first = false;
+		}
+
+		for (size_t j = 0; j < events.size(); j++)
+		{
+			fprintf(file, "%s{\"name\":", first ? "" : ",\n");
+			write_json_string(file, events[j].name);
+			fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f}",
+				tid, (events[j].begin - trace_start) / frequency, (events[j].end - events[j].begin) / frequency);
+			first = false;
+		}
+	}
+	SDL_UnlockMutex(buffers_lock);
+
+	fprintf(file, "\n]}\n");
+	bool success = !ferror(file);
+	fclose(file);
+
+	if (any_full)
+		logWarning("Trace: some threads stopped at %d spans", int(kMaximumSpansPerThread));
+	return success;
+}
+
+#ifndef A1_NETWORK_STANDALONE_HUB
+struct trace_start_command
+{
+	void operator() (const std::string&) const {
+		Tracer::Start();
+		screen_printf("Tracing");
+	}
+};
+
+struct trace_stop_command
+{
+	void operator() (const std::string&) const {
+		if (!Tracer::IsActive())
+		{
+			screen_printf("Not tracing");
+			return;
+		}
+
+		Tracer::Stop();
+		FileSpecifier fs;
+		fs.SetToLocalDataDir();
+		fs += trace_name;
+		if (Tracer::Write(fs.GetPath()))
+			screen_printf("Wrote trace to %s", utf8_to_mac_roman(fs.GetPath()).c_str());
+		else
+			screen_printf("Could not write %s", utf8_to_mac_roman(fs.GetPath()).c_str());
+	}
+};
+
+void Tracer::RegisterCommands()
+{
+	CommandParser traceParser;
+	traceParser.register_command("start", trace_start_command());
+	traceParser.register_command("stop", trace_stop_command());
+	Console::instance()->register_command("trace", traceParser);
+}
+#endif
@@ -0,0 +1,72 @@
+#ifndef __TRACE_H
+#define __TRACE_H
+
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  Tracer: spans of time on each thread, kept in that thread's own buffer
+  while tracing is on, and saved as Chrome tracing JSON (which
+  chrome://tracing and Perfetto open)
+
+ */
+
+#include "cseries.h"
+#include <SDL_atomic.h>
+#include <string>
+
+class Tracer
+{
+public:
+	// "trace start" and "trace stop", which saves the trace
+	static void RegisterCommands();
+
+	static bool IsActive() { return SDL_AtomicGet(&active) != 0; }
+	static void Start();
+	static void Stop();
+
+	// Everything recorded since Start(), with the threads' names
+	static bool Write(const std::string& path);
+
+	// What the calling thread is called in the trace
+	static void NameThread(const char *name);
+
+	// A span that began and ended at these SDL_GetPerformanceCounter() times
+	static void Record(const char *name, uint64_t begin, uint64_t end);
+
+private:
+	static SDL_atomic_t active;
+};
+
+// Times the rest of the enclosing block, when tracing is on; the name must
+// outlive the trace (a string literal)
+class TraceSpan
+{
+public:
+	TraceSpan(const char *name) : m_name(name), m_begin(Tracer::IsActive() ? SDL_GetPerformanceCounter() : 0) { }
+	~TraceSpan() { if (m_begin) Tracer::Record(m_name, m_begin, SDL_GetPerformanceCounter()); }
+
+private:
+	const char *m_name;
+	uint64_t m_begin;
+};
+
+#define TRACE_SPAN_NAME2(line) trace_span_ ## line
+#define TRACE_SPAN_NAME(line) TRACE_SPAN_NAME2(line)
+#define TRACE_SPAN(name) TraceSpan TRACE_SPAN_NAME(__LINE__)(name)
+
+#endif
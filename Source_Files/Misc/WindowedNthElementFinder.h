@@ -21,63 +21,205 @@
  *  Created by Woody Zenfell, III on Thu May 08 2003.
  *
  *  Finds the nth (0 is first) largest or nth smallest element from a window of recently inserted elements.
+ *
+ *  Oct 14, 2026: the window's elements are kept in a treap (a binary search tree, balanced
+ *  by random priorities) whose nodes are counted, so any nth element takes O(log n) steps
+ *  instead of a walk through a std::multiset; the nodes are the window's slots, allocated
+ *  by reset() only.  Equal elements are told apart by age, so the oldest is removed exactly.
  */
 
 #ifndef WINDOWEDNTHELEMENTFINDER_H
 #define WINDOWEDNTHELEMENTFINDER_H
 
-#include "CircularQueue.h"
-#include <set>
+#include "csalerts.h"  // need assert
+#include "cstypes.h"
+#include <vector>
 
 template <typename tElementType>
 class WindowedNthElementFinder {
 public:
-        WindowedNthElementFinder() : mQueue(0) {}
+        WindowedNthElementFinder() { reset(0); }
         
-        explicit WindowedNthElementFinder(unsigned int inWindowSize) : mQueue(inWindowSize) {}
+        explicit WindowedNthElementFinder(unsigned int inWindowSize) { reset(inWindowSize); }
 
 	void	reset() { reset(window_size()); }
-        void	reset(unsigned int inWindowSize) { mQueue.reset(inWindowSize);  mSortedElements.clear(); }
+        void	reset(unsigned int inWindowSize)
+        {
+                mNodes.resize(inWindowSize);
+                mRoot = kNoNode;
+                mOldest = 0;
+                mSize = 0;
+                mNextSequence = 0;
+        }
 
         void	insert(const tElementType& inNewElement)
         {
+                if(window_size() == 0)
+                        return;
+
+                int theSlot;
                 if(window_full())
                 {
-                        mSortedElements.erase(mSortedElements.find(mQueue.peek()));
-                        mQueue.dequeue();
+                        theSlot = mOldest;
+                        mRoot = erase_node(mRoot, theSlot);
+                        mOldest = (mOldest + 1) % window_size();
+                }
+                else
+                {
+                        theSlot = (mOldest + mSize) % window_size();
+                        mSize++;
                 }
-                mSortedElements.insert(inNewElement);
-                mQueue.enqueue(inNewElement);
+
+                Node& theNode = mNodes[theSlot];
+                theNode.mElement = inNewElement;
+                theNode.mSequence = mNextSequence++;
+                theNode.mPriority = scramble(theNode.mSequence);
+                theNode.mLeft = theNode.mRight = kNoNode;
+                theNode.mCount = 1;
+
+                int theLess, theGreater;
+                split(mRoot, theSlot, theLess, theGreater);
+                mRoot = merge(merge(theLess, theSlot), theGreater);
         }
 
         // 0-based indexing (not 1-based as name might imply)
         const tElementType&	nth_smallest_element(unsigned int n)
         {
                 assert(n < size());
-                typename std::multiset<tElementType>::const_iterator i = mSortedElements.begin();
-                for(unsigned int j = 0; j < n; ++j)
-                        ++i;
-                return *i;
+                int theNode = mRoot;
+                for(;;)
+                {
+                        unsigned int theLeftCount = count(mNodes[theNode].mLeft);
+                        if(n < theLeftCount)
+                                theNode = mNodes[theNode].mLeft;
+                        else if(n == theLeftCount)
+                                return mNodes[theNode].mElement;
+                        else
+                        {
+                                n -= theLeftCount + 1;
+                                theNode = mNodes[theNode].mRight;
+                        }
+                }
         }
 
         // 0-based indexing (not 1-based as name might imply)
         const tElementType&	nth_largest_element(unsigned int n)
         {
                 assert(n < size());
-		typename std::multiset<tElementType>::const_reverse_iterator i = mSortedElements.rbegin();
-                for(unsigned int j = 0; j < n; ++j)
-                        ++i;
-                return *i;
+                return nth_smallest_element(size() - 1 - n);
+        }
+
+        // Several at once, e.g. a few quantiles of the window: outElements[i] is the
+        // inN[i]th smallest
+        void	nth_smallest_elements(const unsigned int* inN, unsigned int inCount, tElementType* outElements)
+        {
+                for(unsigned int i = 0; i < inCount; ++i)
+                        outElements[i] = nth_smallest_element(inN[i]);
         }
         
         bool	window_full()		{ return size() == window_size(); }
 
-        unsigned int size()		{ return mQueue.getCountOfElements(); }
-        unsigned int window_size()	{ return mQueue.getTotalSpace(); }
+        unsigned int size()		{ return mSize; }
+        unsigned int window_size()	{ return static_cast<unsigned int>(mNodes.size()); }
 
 private:
-        CircularQueue<tElementType>	mQueue;
-        std::multiset<tElementType>	mSortedElements;
+        enum { kNoNode = -1 };
+
+        struct Node {
+                tElementType	mElement;
+                uint32		mSequence;	// insertion order, to tell equal elements apart
+                uint32		mPriority;	// heap order, from mSequence
+                int		mLeft, mRight;
+                unsigned int	mCount;		// nodes in this subtree
+        };
+
+        static uint32	scramble(uint32 x)
+        {
+                x ^= x >> 16; x *= 0x85ebca6b;
+                x ^= x >> 13; x *= 0xc2b2ae35;
+                x ^= x >> 16;
+                return x;
+        }
+
+        unsigned int	count(int inNode) const { return inNode == kNoNode ? 0 : mNodes[inNode].mCount; }
+
+        void	update(int inNode) { mNodes[inNode].mCount = 1 + count(mNodes[inNode].mLeft) + count(mNodes[inNode].mRight); }
+
+        bool	less(int a, int b) const
+        {
+                const Node& theA = mNodes[a];
+                const Node& theB = mNodes[b];
+                if(theA.mElement < theB.mElement)
+                        return true;
+                if(theB.mElement < theA.mElement)
+                        return false;
+                // sequence numbers wrap, but the window's are never half the range apart
+                return static_cast<int32>(theA.mSequence - theB.mSequence) < 0;
+        }
+
+        // Those of inTree before inKey go to outLess, the others to outGreater
+        void	split(int inTree, int inKey, int& outLess, int& outGreater)
+        {
+                if(inTree == kNoNode)
+                {
+                        outLess = outGreater = kNoNode;
+                        return;
+                }
+
+                if(less(inTree, inKey))
+                {
+                        split(mNodes[inTree].mRight, inKey, mNodes[inTree].mRight, outGreater);
+                        outLess = inTree;
+                }
+                else
+                {
+                        split(mNodes[inTree].mLeft, inKey, outLess, mNodes[inTree].mLeft);
+                        outGreater = inTree;
+                }
+                update(inTree);
+        }
+
+        // Everything in inLess comes before everything in inGreater
+        int	merge(int inLess, int inGreater)
+        {
+                if(inLess == kNoNode)
+                        return inGreater;
+                if(inGreater == kNoNode)
+                        return inLess;
+
+                if(mNodes[inLess].mPriority > mNodes[inGreater].mPriority)
+                {
+                        mNodes[inLess].mRight = merge(mNodes[inLess].mRight, inGreater);
+                        update(inLess);
+                        return inLess;
+                }
+                else
+                {
+                        mNodes[inGreater].mLeft = merge(inLess, mNodes[inGreater].mLeft);
+                        update(inGreater);
+                        return inGreater;
+                }
+        }
+
+        int	erase_node(int inTree, int inNode)
+        {
+                assert(inTree != kNoNode);
+                if(inTree == inNode)
+                        return merge(mNodes[inTree].mLeft, mNodes[inTree].mRight);
+
+                if(less(inNode, inTree))
+                        mNodes[inTree].mLeft = erase_node(mNodes[inTree].mLeft, inNode);
+                else
+                        mNodes[inTree].mRight = erase_node(mNodes[inTree].mRight, inNode);
+                update(inTree);
+                return inTree;
+        }
+
+        std::vector<Node>	mNodes;		// one per slot of the window
+        int			mRoot;
+        unsigned int		mOldest;	// slot of the oldest element
+        unsigned int		mSize;
+        uint32			mNextSequence;
 };
 
 #endif // WINDOWEDNTHELEMENTFINDER_H
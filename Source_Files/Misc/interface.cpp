@@ -145,6 +145,7 @@ extern TP2PerfGlobals perf_globals;
 #include "XML_LevelScript.h"
 #include "Music.h"
 #include "Movie.h"
+#include "interpolated_world.h"
 #include "QuickSave.h"
 #include "Plugins.h"
 #include "Statistics.h"
@@ -200,6 +201,7 @@ const short max_handled_recording= RECORDING_VERSION_ALEPH_ONE_1_2;
 #include "motion_sensor.h" // for reset_motion_sensor()
 
 #include "lua_hud_script.h"
+#include "Trace.h"
 
 using alephone::Screen;
 
@@ -1008,6 +1010,57 @@ bool handle_open_replay(FileSpecifier& File)
 	return success;
 }
 
+// A solo game at the given level of the current map, for benchmarks:
+// with a fixed seed, and without a film or chapter screens
+bool start_benchmark_game(
+	short level_number)
+{
+	struct entry_point entry;
+	struct player_start_data starts[MAXIMUM_NUMBER_OF_PLAYERS];
+	struct game_data game_information;
+	short number_of_players;
+
+	clear_game_error();
+	objlist_clear(starts, MAXIMUM_NUMBER_OF_PLAYERS);
+
+	if(!get_map_file().Exists())
+	{
+		set_game_error(systemError, ENOENT);
+		return false;
+	}
+
+	entry.level_number= level_number;
+	memset(entry.level_name,0,66);
+
+	standardize_player_behavior_modifiers();
+	construct_single_player_start(starts, &number_of_players);
+
+	game_information.game_time_remaining= INT32_MAX;
+	game_information.kill_limit = 0;
+	game_information.game_type= _game_of_kill_monsters;
+	game_information.game_options= _burn_items_on_death|_ammo_replenishes|_weapons_replenish|_monsters_replenish;
+	game_information.initial_random_seed= 0;
+	game_information.difficulty_level= get_difficulty_level();
+	game_information.cheat_flags= 0;
+	std::fill_n(game_information.parameters, 2, 0);
+
+	hide_cursor();
+	Plugins::instance()->set_mode(Plugins::kMode_Solo);
+	Crosshairs_SetActive(player_preferences->crosshairs_active);
+	LoadHUDLua();
+	RunLuaHUDScript();
+
+	bool success= new_game(number_of_players, false, &game_information, starts, &entry);
+	if(success)
+	{
+		start_game(_single_player, false);
+	} else {
+		clean_up_after_failed_game(false, false, true);
+	}
+
+	return success;
+}
+
 // Called from within update_world..
 bool check_level_change(
 	void)
@@ -1081,6 +1134,7 @@ void update_interface_display(
 
 bool idle_game_state(uint32 time)
 {
+	TRACE_SPAN("idle_game_state");
 	int machine_ticks_elapsed = time - game_state.last_ticks_on_idle;
 
 	if(machine_ticks_elapsed || game_state.phase==0)
@@ -1124,6 +1178,15 @@ bool idle_game_state(uint32 time)
 					{
 						case _replay:
 							finish_game(true);
+							if (timedemo_active())
+							{
+								finish_timedemo();
+								game_state.state= _quit_game;
+							}
+							else if (Movie::instance()->IsBatchExport())
+							{
+								game_state.state= _quit_game;
+							}
 							break;
 							
 						case _demo:
@@ -1147,7 +1210,7 @@ bool idle_game_state(uint32 time)
 
 				case _revert_game:
 					/* Reverting while in the update loop sounds sketchy.. */
-					if(revert_game())
+					if(replay_rewind_requested() ? revert_replay() : revert_game())
 					{
 						game_state.state= _game_in_progress;
 						game_state.phase = 15 * MACHINE_TICKS_PER_SECOND;
@@ -1193,13 +1256,28 @@ bool idle_game_state(uint32 time)
 		std::pair<bool, int16> theUpdateResult= update_world();
 		short ticks_elapsed= theUpdateResult.second;
 
-		if (get_keyboard_controller_status())
+		// Films and timedemos draw every tick as it is
+		bool interpolate = graphics_preferences->interpolate_world && !Movie::instance()->IsRecording() && !timedemo_active();
+		// Nothing is drawn while seeking in a film, or in a headless timedemo
+		bool seeking = replay_seek_active() || timedemo_headless();
+		if (interpolate && theUpdateResult.first)
+			record_interpolated_world();
+
+		if (get_keyboard_controller_status() && !seeking)
 		{
 			// ZZZ: I don't know for sure that render_screen works best with the number of _real_
 			// ticks elapsed rather than the number of (potentially predictive) ticks elapsed.
 			// This is a guess.
-			if (theUpdateResult.first)
+			if (theUpdateResult.first || interpolate)
+			{
+				if (interpolate)
+					enter_interpolated_world();
 				render_screen(ticks_elapsed);
+				if (interpolate)
+					exit_interpolated_world();
+				if (timedemo_active())
+					record_timedemo_frame();
+			}
 		}
 		
 		return theUpdateResult.first;
@@ -2323,6 +2401,9 @@ static void finish_game(
 	leaving_map();
 	CloseLuaHUDScript();
 	
+	// there's no next level to have read
+	cancel_level_preload();
+	
 	// LP: stop playing the background music if it was present
 	Music::instance()->StopLevelMusic();
 	
@@ -2714,7 +2795,7 @@ static void try_and_display_chapter_screen(
 	bool interface_table_is_valid,
 	bool text_block)
 {
-	if (Movie::instance()->IsRecording())
+	if (Movie::instance()->IsRecording() || timedemo_active())
 		return;
 	
 	short pict_resource_number = get_screen_data(_display_chapter_heading)->screen_base + level;
@@ -3052,13 +3133,89 @@ void movie_audio_callback(void *data, Uint8 *stream, int length)
 		SDL_UnlockMutex(movie_audio_mutex);
 	}
 }
+
+// A movie's frames are decoded, and scaled and converted for the screen, on a thread of
+// their own a few ahead, so that the main thread only has to put each up when its time comes
+static const int MOVIE_FRAME_QUEUE_SIZE = 4;
+
+struct movie_decoder
+{
+	SDL_ffmpegFile *file;
+	bool has_audio;
+	SDL_ffmpegVideoFrame *frames[MOVIE_FRAME_QUEUE_SIZE];
+	int frame_count;
+
+	// the decoded frames waiting, from first_frame on, and whether there are more to come
+	SDL_mutex *queue_mutex;
+	int first_frame, queued_frames;
+	bool video_finished;
+
+	SDL_atomic_t audio_finished;
+	SDL_atomic_t stop;
+};
+
+static int movie_decoder_thread(void *data)
+{
+	movie_decoder *decoder = static_cast<movie_decoder *>(data);
+	bool video_finished = decoder->frame_count == 0;
+
+	while (!SDL_AtomicGet(&decoder->stop))
+	{
+		bool busy = false;
+
+		if (decoder->has_audio && !SDL_AtomicGet(&decoder->audio_finished))
+		{
+			SDL_LockMutex(movie_audio_mutex);
+			for (int i = 0; i < AUDIO_BUF_SIZE; i++)
+			{
+				if (!aframes[i]->size)
+				{
+					SDL_ffmpegGetAudioFrame(decoder->file, aframes[i]);
+					busy = true;
+				}
+			}
+			if (!aframes[AUDIO_BUF_SIZE - 1]->size && aframes[AUDIO_BUF_SIZE - 1]->last)
+				SDL_AtomicSet(&decoder->audio_finished, 1);
+			SDL_UnlockMutex(movie_audio_mutex);
+		}
+
+		if (!video_finished)
+		{
+			SDL_LockMutex(decoder->queue_mutex);
+			int next_frame = -1;
+			if (decoder->queued_frames < decoder->frame_count)
+				next_frame = (decoder->first_frame + decoder->queued_frames) % decoder->frame_count;
+			SDL_UnlockMutex(decoder->queue_mutex);
+
+			if (next_frame >= 0)
+			{
+				// nobody else touches a frame until it's queued
+				SDL_ffmpegVideoFrame *frame = decoder->frames[next_frame];
+				SDL_ffmpegGetVideoFrame(decoder->file, frame);
+				video_finished = frame->last;
+
+				SDL_LockMutex(decoder->queue_mutex);
+				if (frame->ready)
+					decoder->queued_frames++;
+				decoder->video_finished = video_finished;
+				SDL_UnlockMutex(decoder->queue_mutex);
+				busy = true;
+			}
+		}
+
+		if (!busy)
+			SDL_Delay(2);
+	}
+
+	return 0;
+}
 #endif
 
 extern bool option_nosound;
 
 void show_movie(short index)
 {
-	if (Movie::instance()->IsRecording())
+	if (Movie::instance()->IsRecording() || timedemo_active())
 		return;
 	
 #if defined(HAVE_FFMPEG) || defined(HAVE_SMPEG)
@@ -3092,16 +3249,27 @@ void show_movie(short index)
 		SDL_ffmpegSelectAudioStream(sffile, 0);
 		SDL_ffmpegStream *astream = SDL_ffmpegGetAudioStream(sffile, 0);
 		
-		SDL_ffmpegVideoFrame *vframe = vstream ? SDL_ffmpegCreateVideoFrame() : NULL;
+		movie_sync = 0;
+		movie_decoder decoder;
+		decoder.file = sffile;
+		decoder.has_audio = false;
+		decoder.frame_count = 0;
+		decoder.first_frame = 0;
+		decoder.queued_frames = 0;
+		decoder.video_finished = false;
+		SDL_AtomicSet(&decoder.audio_finished, 0);
+		SDL_AtomicSet(&decoder.stop, 0);
 		
-		if (vframe)
+		for (int i = 0; vstream && i < MOVIE_FRAME_QUEUE_SIZE; i++)
 		{
+			SDL_ffmpegVideoFrame *vframe = SDL_ffmpegCreateVideoFrame();
 			vframe->surface = SDL_CreateRGBSurface(SDL_SWSURFACE, dst_rect.w, dst_rect.h, 32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000);
 			if (!vframe->surface)
 			{
 				SDL_ffmpegFreeVideoFrame(vframe);
-				vframe = NULL;
+				break;
 			}
+			decoder.frames[decoder.frame_count++] = vframe;
 		}
 		
 		
@@ -3117,6 +3285,7 @@ void show_movie(short index)
 					aframes[i] = SDL_ffmpegCreateAudioFrame(sffile, frameSize);
 					SDL_ffmpegGetAudioFrame(sffile, aframes[i]);
 				}
+				decoder.has_audio = true;
 			}
 		}
 				
@@ -3125,8 +3294,11 @@ void show_movie(short index)
 			OGL_ClearScreen();
 #endif
 		
+		decoder.queue_mutex = SDL_CreateMutex();
+		SDL_Thread *decoder_thread = SDL_CreateThread(movie_decoder_thread, "show_movie_decoderThread", &decoder);
+		
 		SDL_PauseAudio(false);
-		bool done = false;
+		bool done = !decoder_thread;
 		while (!done)
 		{
 			SDL_Event event;
@@ -3143,26 +3315,22 @@ void show_movie(short index)
 				}
 			}
 			
-			if (astream)
-			{
-				SDL_LockMutex(movie_audio_mutex);
-				for (int i = 0; i < AUDIO_BUF_SIZE; i++)
-				{
-					if (!aframes[i]->size)
-					{
-						SDL_ffmpegGetAudioFrame(sffile, aframes[i]);
-					}
-				}
-				if (!aframes[AUDIO_BUF_SIZE - 1]->size && aframes[AUDIO_BUF_SIZE - 1]->last)
-					done = true;
-				SDL_UnlockMutex(movie_audio_mutex);
-			}
+			if (SDL_AtomicGet(&decoder.audio_finished))
+				done = true;
 			
-			if (vframe)
+			if (decoder.frame_count)
 			{
-				if (!vframe->ready)
+				SDL_LockMutex(decoder.queue_mutex);
+				SDL_ffmpegVideoFrame *vframe = decoder.queued_frames ? decoder.frames[decoder.first_frame] : NULL;
+				bool video_finished = decoder.video_finished;
+				SDL_UnlockMutex(decoder.queue_mutex);
+				
+				if (!vframe)
 				{
-					SDL_ffmpegGetVideoFrame(sffile, vframe);
+					if (video_finished)
+						done = true;
+					else
+						SDL_Delay(1);
 				}
 				else if (vframe->pts <= movie_sync)
 				{
@@ -3181,9 +3349,13 @@ void show_movie(short index)
 						SDL_BlitSurface(vframe->surface, 0, MainScreenSurface(), &dst_rect);
 						MainScreenUpdateRects(1, &dst_rect);
 					}
-					vframe->ready = 0;
 					if (vframe->last)
 						done = true;
+					
+					SDL_LockMutex(decoder.queue_mutex);
+					decoder.first_frame = (decoder.first_frame + 1) % decoder.frame_count;
+					decoder.queued_frames--;
+					SDL_UnlockMutex(decoder.queue_mutex);
 				}
 				else 
 				{
@@ -3193,18 +3365,28 @@ void show_movie(short index)
 		}
 		
 		SDL_PauseAudio(true);
+		if (decoder_thread)
+		{
+			SDL_AtomicSet(&decoder.stop, 1);
+			SDL_WaitThread(decoder_thread, NULL);
+		}
+		SDL_DestroyMutex(decoder.queue_mutex);
+		
 		if (astream)
 		{
-			for (int i = 0; i < AUDIO_BUF_SIZE; i++)
+			if (decoder.has_audio)
 			{
-				SDL_ffmpegFreeAudioFrame(aframes[i]);
+				for (int i = 0; i < AUDIO_BUF_SIZE; i++)
+				{
+					SDL_ffmpegFreeAudioFrame(aframes[i]);
+				}
 			}
 			SDL_DestroyMutex(movie_audio_mutex);
 			movie_audio_mutex = NULL;
 		}
 				
-		if (vframe)
-			SDL_ffmpegFreeVideoFrame(vframe);
+		for (int i = 0; i < decoder.frame_count; i++)
+			SDL_ffmpegFreeVideoFrame(decoder.frames[i]);
 		SDL_ffmpegFree(sffile);
 		SDL_CloseAudio();
 
@@ -261,6 +261,7 @@ short get_game_controller(void);
 bool current_netgame_allows_microphone();
 void set_change_level_destination(short level_number);
 bool check_level_change(void);
+bool start_benchmark_game(short level_number);
 void pause_game(void);
 void resume_game(void);
 void portable_process_screen_click(short x, short y, bool cheatkeys_down);
@@ -319,23 +320,39 @@ struct shape_information_data *extended_get_shape_information(short collection_c
 
 void get_shape_hotpoint(shape_descriptor texture, short *x0, short *y0);
 struct shape_animation_data *get_shape_animation_data(shape_descriptor texture);
+// Changes whenever the pointers the shape accessors hand out may have
+uint32 get_shape_data_generation();
 void process_collection_sounds(short colleciton_code, void (*process_sound)(short sound_index));
 
 #define mark_collection_for_loading(c) mark_collection((c), true)
 #define mark_collection_for_unloading(c) mark_collection((c), false)
 void mark_collection(short collection_code, bool loading);
 void strip_collection(short collection_code);
-void load_collections(bool with_progress_bar, bool is_opengl);
+// With lazy collections, build this one at level start anyway
+void prefetch_collection(short collection_code);
+// With keep_loaded, collections already in memory stay as they are if they are just the
+// ones marked and nothing they were built for has changed (restoring on the same level)
+void load_collections(bool with_progress_bar, bool is_opengl, bool keep_loaded = false);
 int count_replacement_collections();
 void load_replacement_collections();
 void unload_all_collections(void);
 
+// Collections' data can be read ahead of load_collections(), on any thread,
+// from a separately opened shapes file; the next load_collections() parses
+// it from memory instead of the file.  The rest runs on the main thread
+bool get_shapes_file_for_staging(FileSpecifier& File);
+bool get_collection_extent(short collection_index, int32& offset, int32& length);
+// Takes over the malloc()ed data, read from File
+void stage_collection_data(short collection_index, const FileSpecifier& File, int32 offset, byte *data, int32 length);
+
 void set_shapes_patch_data(uint8 *data, size_t length);
 uint8* get_shapes_patch_data(size_t &length);
 
 // LP additions:
 // Whether or not collection is present
 bool is_collection_present(short collection_index);
+// Bytes the loaded collections and their shading tables hold
+size_t get_collections_memory_usage();
 // Number of texture frames in a collection (good for wall-texture error checking)
 short get_number_of_collection_frames(short collection_index);
 // Number of bitmaps in a collection (good for allocating texture information for OpenGL)
@@ -352,6 +369,7 @@ struct low_level_shape_definition *get_low_level_shape_definition(short collecti
 /* ---------- prototypes/PREPROCESS_MAP_MAC.C */
 void setup_revert_game_info(struct game_data *game_info, struct player_start_data *start, struct entry_point *entry);
 bool revert_game(void);
+bool revert_replay(void);
 bool load_game(bool use_last_load);
 bool save_game(void);
 bool save_game_full_auto(bool inOverwriteRecent);
@@ -377,8 +395,17 @@ void stop_replay(void);
 void move_replay(void);
 void check_recording_replaying(void);
 bool has_recording_file(void);
+bool game_is_being_replayed(void);
 void increment_replay_speed(void);
 void decrement_replay_speed(void);
+/* Seeking in the film being replayed, by ticks from its start: the ticks
+   between are run as fast as they can be, without being drawn; going back
+   starts the film over from its first level, at idle time */
+int32 get_replay_position(void);
+bool seek_replay(int32 tick);
+bool replay_seek_active(void);
+bool replay_rewind_requested(void);
+void rewind_replay(void);
 void reset_recording_and_playback_queues(void);
 uint32 parse_keymap(void);
 
@@ -161,10 +161,13 @@ OpenGLDialog::~OpenGLDialog()
 	delete m_transparentLiquidsWidget;
 	delete m_3DmodelsWidget;
 	delete m_blurWidget;
+	delete m_bloomQualityWidget;
+	delete m_dynamicResolutionWidget;
 	delete m_bumpWidget;
 	delete m_colourTheVoidWidget;
 	delete m_voidColourWidget;
 	delete m_fsaaWidget;
+	delete m_postAntialiasingWidget;
 	delete m_anisotropicWidget;
 	delete m_sRGBWidget;
 	delete m_geForceFixWidget;
@@ -203,6 +206,10 @@ void OpenGLDialog::OpenGLPrefsByRunning ()
 	binders.insert<bool> (m_3DmodelsWidget, &modelsPref);
 	BitPref blurPref (graphics_preferences->OGL_Configure.Flags, OGL_Flag_Blur);
 	binders.insert<bool> (m_blurWidget, &blurPref);
+	Int16Pref bloomQualityPref (graphics_preferences->OGL_Configure.BloomQuality);
+	binders.insert<int> (m_bloomQualityWidget, &bloomQualityPref);
+	Int16Pref dynamicResolutionPref (graphics_preferences->OGL_Configure.DynamicResolution);
+	binders.insert<int> (m_dynamicResolutionWidget, &dynamicResolutionPref);
 	BitPref bumpPref (graphics_preferences->OGL_Configure.Flags, OGL_Flag_BumpMap);
 	binders.insert<bool> (m_bumpWidget, &bumpPref);
 	
@@ -213,6 +220,8 @@ void OpenGLDialog::OpenGLPrefsByRunning ()
 	
 	TimesTwoPref fsaaPref (graphics_preferences->OGL_Configure.Multisamples);
 	binders.insert<int> (m_fsaaWidget, &fsaaPref);
+	BoolPref postAntialiasingPref (graphics_preferences->OGL_Configure.PostAntialiasing);
+	binders.insert<bool> (m_postAntialiasingWidget, &postAntialiasingPref);
 	
 	AnisotropyPref anisotropyPref (graphics_preferences->OGL_Configure.AnisotropyLevel);
 	binders.insert<int> (m_anisotropicWidget, &anisotropyPref);
@@ -372,6 +381,30 @@ public:
 			general_table->dual_add(blur_w->label("Bloom Effects"), m_dialog);
 			general_table->dual_add(blur_w, m_dialog);
 		}
+
+		w_select_popup *bloom_quality_w = new w_select_popup ();
+		if (theSelectedRenderer == _shader_acceleration) {
+			general_table->dual_add(bloom_quality_w->label("Bloom Quality"), m_dialog);
+			general_table->dual_add(bloom_quality_w, m_dialog);
+		}
+		vector<string> bloom_quality_strings;
+		bloom_quality_strings.push_back ("Classic");
+		bloom_quality_strings.push_back ("Low");
+		bloom_quality_strings.push_back ("Medium");
+		bloom_quality_strings.push_back ("High");
+		bloom_quality_w->set_labels (bloom_quality_strings);
+		
+		w_select_popup *dynamic_resolution_w = new w_select_popup ();
+		if (theSelectedRenderer == _shader_acceleration) {
+			general_table->dual_add(dynamic_resolution_w->label("Dynamic Resolution"), m_dialog);
+			general_table->dual_add(dynamic_resolution_w, m_dialog);
+		}
+		vector<string> dynamic_resolution_strings;
+		dynamic_resolution_strings.push_back ("Off");
+		dynamic_resolution_strings.push_back ("30 fps");
+		dynamic_resolution_strings.push_back ("60 fps");
+		dynamic_resolution_strings.push_back ("120 fps");
+		dynamic_resolution_w->set_labels (dynamic_resolution_strings);
 		
 		w_toggle *bump_w = new w_toggle(false);
 		if (theSelectedRenderer == _shader_acceleration) {
@@ -394,6 +427,12 @@ public:
 		fsaa_strings.push_back ("4x");
 		fsaa_w->set_labels (fsaa_strings);
 		
+		w_toggle *post_aa_w = new w_toggle(false);
+		if (theSelectedRenderer == _shader_acceleration) {
+			general_table->dual_add(post_aa_w->label("Post-Process Antialiasing"), m_dialog);
+			general_table->dual_add(post_aa_w, m_dialog);
+		}
+		
 		w_aniso_slider* aniso_w = new w_aniso_slider(6, 1);
 		general_table->dual_add(aniso_w->label("Anisotropic Filtering"),m_dialog);
 		general_table->dual_add(aniso_w, m_dialog);
@@ -592,12 +631,15 @@ public:
 		m_transparentLiquidsWidget = new ToggleWidget (liq_w);
 		m_3DmodelsWidget = new ToggleWidget (models_w);
 		m_blurWidget = new ToggleWidget (blur_w);
+		m_bloomQualityWidget = new PopupSelectorWidget (bloom_quality_w);
+		m_dynamicResolutionWidget = new PopupSelectorWidget (dynamic_resolution_w);
 		m_bumpWidget = new ToggleWidget (bump_w);
 
 		m_colourTheVoidWidget = 0;
 		m_voidColourWidget = 0;
 
 		m_fsaaWidget = new PopupSelectorWidget (fsaa_w);
+		m_postAntialiasingWidget = new ToggleWidget (post_aa_w);
 
 		m_anisotropicWidget = new SliderSelectorWidget (aniso_w);
 
@@ -50,12 +50,15 @@ protected:
 	ToggleWidget*		m_transparentLiquidsWidget;
 	ToggleWidget*		m_3DmodelsWidget;
 	ToggleWidget*		m_blurWidget;
+	SelectorWidget*		m_bloomQualityWidget;
+	SelectorWidget*		m_dynamicResolutionWidget;
 	ToggleWidget*		m_bumpWidget;
 	
 	ToggleWidget*		m_colourTheVoidWidget;
 	ColourPickerWidget*	m_voidColourWidget;
 	
 	SelectorWidget*		m_fsaaWidget;
+	ToggleWidget*		m_postAntialiasingWidget;
 	
 	SelectorWidget*		m_anisotropicWidget;
 
@@ -94,11 +94,16 @@ May 22, 2003 (Woody Zenfell):
 #include "Music.h"
 #include "HTTP.h"
 #include "alephversion.h"
+#include "WadImageCache.h"
+#include "MemoryAccounting.h"
 
 #include <cmath>
 #include <sstream>
 #include <boost/algorithm/hex.hpp>
 
+#include <SDL_mutex.h>
+#include <SDL_thread.h>
+
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
@@ -968,6 +973,14 @@ static const char *sw_sdl_driver_labels[5] = {
 	"Default", "None", "Direct3D", "OpenGL", NULL
 };
 
+static const char *sw_render_threads_labels[5] = {
+	"Off", "2", "4", "Automatic", NULL
+};
+
+static const char *sw_shading_labels[3] = {
+	"Full", "Compact", NULL
+};
+
 static const char *gamma_labels[9] = {
 	"Darkest", "Darker", "Dark", "Normal", "Light", "Really Light", "Even Lighter", "Lightest", NULL
 };
@@ -1042,6 +1055,14 @@ static void software_rendering_options_dialog(void* arg)
 	w_select *sw_driver_w = new w_select(graphics_preferences->software_sdl_driver, sw_sdl_driver_labels);
 	table->dual_add(sw_driver_w->label("Acceleration"), d);
 	table->dual_add(sw_driver_w, d);
+
+	w_select *sw_threads_w = new w_select(graphics_preferences->software_render_threads, sw_render_threads_labels);
+	table->dual_add(sw_threads_w->label("Rendering Threads"), d);
+	table->dual_add(sw_threads_w, d);
+
+	w_select *sw_shading_w = new w_select(graphics_preferences->software_shading, sw_shading_labels);
+	table->dual_add(sw_shading_w->label("32 Bit Shading"), d);
+	table->dual_add(sw_shading_w, d);
 	
 	placer->add(table, true);
 
@@ -1087,6 +1108,19 @@ static void software_rendering_options_dialog(void* arg)
 			graphics_preferences->software_sdl_driver = sw_driver_w->get_selection();
 			changed = true;
 		}
+
+		if (sw_threads_w->get_selection() != graphics_preferences->software_render_threads)
+		{
+			graphics_preferences->software_render_threads = sw_threads_w->get_selection();
+			changed = true;
+		}
+
+		if (sw_shading_w->get_selection() != graphics_preferences->software_shading)
+		{
+			graphics_preferences->software_shading = sw_shading_w->get_selection();
+			changed = true;
+			// like the depth, it takes effect when the collections are next loaded
+		}
 		
 		if (changed)
 			write_preferences();
@@ -1177,6 +1211,10 @@ static void graphics_dialog(void *arg)
 	w_toggle *bob_w = new w_toggle(graphics_preferences->screen_mode.camera_bob);
 	table->dual_add(bob_w->label("Camera Bobbing"), d);
 	table->dual_add(bob_w, d);
+
+	w_toggle *interpolate_w = new w_toggle(graphics_preferences->interpolate_world);
+	table->dual_add(interpolate_w->label("Smooth Motion"), d);
+	table->dual_add(interpolate_w, d);
 	
   	w_select_popup *gamma_w = new w_select_popup();
 	gamma_w->set_labels(build_stringvector_from_cstring_array(gamma_labels));
@@ -1320,6 +1358,12 @@ static void graphics_dialog(void *arg)
 			graphics_preferences->screen_mode.camera_bob = camera_bob;
 			changed = true;
 		}
+
+		bool interpolate_world = interpolate_w->get_selection() != 0;
+		if (interpolate_world != graphics_preferences->interpolate_world) {
+			graphics_preferences->interpolate_world = interpolate_world;
+			changed = true;
+		}
 		
 	    if (changed) {
 		    write_preferences();
@@ -1438,6 +1482,14 @@ static void sound_dialog(void *arg)
 	table->dual_add(zrd_w->label("Zero Restart Delay"), d);
 	table->dual_add(zrd_w, d);
 
+	w_toggle *convert_w = new w_toggle(TEST_FLAG(sound_preferences->flags, _convert_sounds_flag));
+	table->dual_add(convert_w->label("Pre-Convert Sounds"), d);
+	table->dual_add(convert_w, d);
+
+	w_toggle *low_latency_w = new w_toggle(TEST_FLAG(sound_preferences->flags, _low_latency_audio_flag));
+	table->dual_add(low_latency_w->label("Low Latency Audio"), d);
+	table->dual_add(low_latency_w, d);
+
 	placer->add(table, true);
 
 	placer->add(new w_spacer(), true);
@@ -1463,6 +1515,8 @@ static void sound_dialog(void *arg)
 		if (ambient_w->get_selection()) flags |= _ambient_sound_flag;
 		if (more_w->get_selection()) flags |= _more_sounds_flag;
 		if (zrd_w->get_selection()) flags |= _zero_restart_delay;
+		if (convert_w->get_selection()) flags |= _convert_sounds_flag;
+		if (low_latency_w->get_selection()) flags |= _low_latency_audio_flag;
 
 		if (flags != sound_preferences->flags) {
 			sound_preferences->flags = flags;
@@ -2555,6 +2609,34 @@ static void environment_dialog(void *arg)
 }
 
 
+// What the image cache keeps on disk
+static const size_t IMAGE_CACHE_LIMIT = 300000000;
+static const size_t LOW_MEMORY_IMAGE_CACHE_LIMIT = 20000000;
+
+void apply_low_memory_preference()
+{
+	SoundManager::instance()->SetLowMemory(environment_preferences->low_memory);
+	WadImageCache::instance()->set_limit(environment_preferences->low_memory ? LOW_MEMORY_IMAGE_CACHE_LIMIT : IMAGE_CACHE_LIMIT);
+}
+
+struct set_low_memory
+{
+	void operator() (const std::string& arg) const {
+		environment_preferences->low_memory = (atoi(arg.c_str()) != 0);
+		apply_low_memory_preference();
+		screen_printf("low memory mode is now %s; collections and shading follow from the next level", environment_preferences->low_memory ? "on" : "off");
+		write_preferences();
+	}
+};
+
+struct get_low_memory
+{
+	void operator() (const std::string&) const {
+		screen_printf("low memory mode is %s", environment_preferences->low_memory ? "on" : "off");
+		MemoryAccounting::ShowFootprint();
+	}
+};
+
 extern void hub_set_minimum_send_period(int32);
 extern int32& hub_get_minimum_send_period();
 
@@ -2574,6 +2656,66 @@ struct get_latency_tolerance
 	}
 };
 
+#ifdef HAVE_OPENGL
+extern int64_t OGL_TextureBytesLoaded();
+
+struct set_texture_memory_budget
+{
+	void operator() (const std::string& arg) const {
+		graphics_preferences->OGL_Configure.TextureMemoryBudget = PIN(atoi(arg.c_str()), 0, INT16_MAX);
+		screen_printf("texture memory budget is now %i MB", graphics_preferences->OGL_Configure.TextureMemoryBudget);
+		write_preferences();
+	}
+};
+
+struct get_texture_memory_budget
+{
+	void operator() (const std::string&) const {
+		screen_printf("texture memory budget is %i MB (0 is no limit); %i MB in use", graphics_preferences->OGL_Configure.TextureMemoryBudget, int(OGL_TextureBytesLoaded() >> 20));
+	}
+};
+
+extern void OGL_GetSurfaceSortCounts(int& batches, int& changes, int& unsorted_changes);
+
+struct set_sort_surfaces
+{
+	void operator() (const std::string& arg) const {
+		graphics_preferences->OGL_Configure.SortSurfaces = (atoi(arg.c_str()) != 0);
+		screen_printf("surface sorting is now %s", graphics_preferences->OGL_Configure.SortSurfaces ? "on" : "off");
+		write_preferences();
+	}
+};
+
+struct get_sort_surfaces
+{
+	void operator() (const std::string&) const {
+		int batches, changes, unsorted_changes;
+		OGL_GetSurfaceSortCounts(batches, changes, unsorted_changes);
+		screen_printf("surface sorting is %s; last frame drew %i surface batches with %i state changes (%i in discovery order)", graphics_preferences->OGL_Configure.SortSurfaces ? "on" : "off", batches, changes, unsorted_changes);
+	}
+};
+
+extern void OGL_GetOcclusionCounts(int& models, int& skipped);
+
+struct set_occlusion_culling
+{
+	void operator() (const std::string& arg) const {
+		graphics_preferences->OGL_Configure.OcclusionCulling = (atoi(arg.c_str()) != 0);
+		screen_printf("model occlusion culling is now %s", graphics_preferences->OGL_Configure.OcclusionCulling ? "on" : "off");
+		write_preferences();
+	}
+};
+
+struct get_occlusion_culling
+{
+	void operator() (const std::string&) const {
+		int models, skipped;
+		OGL_GetOcclusionCounts(models, skipped);
+		screen_printf("model occlusion culling is %s; last frame skipped %i of %i models", graphics_preferences->OGL_Configure.OcclusionCulling ? "on" : "off", skipped, models);
+	}
+};
+#endif
+
 void transition_preferences(const DirectorySpecifier& legacy_preferences_dir)
 {
 	FileSpecifier prefs;
@@ -2621,6 +2763,16 @@ void initialize_preferences(
 		PreferenceSetCommandParser.register_command("latency_tolerance", set_latency_tolerance());
 		CommandParser PreferenceGetCommandParser;
 		PreferenceGetCommandParser.register_command("latency_tolerance", get_latency_tolerance());
+		PreferenceSetCommandParser.register_command("low_memory", set_low_memory());
+		PreferenceGetCommandParser.register_command("low_memory", get_low_memory());
+#ifdef HAVE_OPENGL
+		PreferenceSetCommandParser.register_command("texture_memory_budget", set_texture_memory_budget());
+		PreferenceGetCommandParser.register_command("texture_memory_budget", get_texture_memory_budget());
+		PreferenceSetCommandParser.register_command("sort_surfaces", set_sort_surfaces());
+		PreferenceGetCommandParser.register_command("sort_surfaces", get_sort_surfaces());
+		PreferenceSetCommandParser.register_command("occlusion_culling", set_occlusion_culling());
+		PreferenceGetCommandParser.register_command("occlusion_culling", get_occlusion_culling());
+#endif
 
 		CommandParser PreferenceCommandParser;
 		PreferenceCommandParser.register_command("set", PreferenceSetCommandParser);
@@ -2628,6 +2780,7 @@ void initialize_preferences(
 		Console::instance()->register_command("preferences", PreferenceCommandParser);
 		
 		read_preferences ();
+		apply_low_memory_preference();
 	}
 }
 
@@ -2675,19 +2828,19 @@ void read_preferences ()
 			else if (version > A1_DATE_VERSION)
 				logWarning("Reading newer preferences of version %s. Preferences will be downgraded to version %s when saved. (%s)", version.c_str(), A1_DATE_VERSION, FileSpec.GetPath());
 			
-			BOOST_FOREACH(InfoTree child, root.children_named("graphics"))
+			BOOST_FOREACH(const InfoTree &child, root.children_named("graphics"))
 				parse_graphics_preferences(child, version);
-			BOOST_FOREACH(InfoTree child, root.children_named("player"))
+			BOOST_FOREACH(const InfoTree &child, root.children_named("player"))
 				parse_player_preferences(child, version);
-			BOOST_FOREACH(InfoTree child, root.children_named("input"))
+			BOOST_FOREACH(const InfoTree &child, root.children_named("input"))
 				parse_input_preferences(child, version);
-			BOOST_FOREACH(InfoTree child, root.children_named("sound"))
+			BOOST_FOREACH(const InfoTree &child, root.children_named("sound"))
 				parse_sound_preferences(child, version);
 #if !defined(DISABLE_NETWORKING)
-			BOOST_FOREACH(InfoTree child, root.children_named("network"))
+			BOOST_FOREACH(const InfoTree &child, root.children_named("network"))
 				parse_network_preferences(child, version);
 #endif
-			BOOST_FOREACH(InfoTree child, root.children_named("environment"))
+			BOOST_FOREACH(const InfoTree &child, root.children_named("environment"))
 				parse_environment_preferences(child, version);
 			
 		} catch (InfoTree::parse_error ex) {
@@ -2759,14 +2912,25 @@ InfoTree graphics_preferences_tree()
 	root.put_attr("ogl_flags", graphics_preferences->OGL_Configure.Flags);
 	root.put_attr("software_alpha_blending", graphics_preferences->software_alpha_blending);
 	root.put_attr("software_sdl_driver", graphics_preferences->software_sdl_driver);
+	root.put_attr("software_render_threads", graphics_preferences->software_render_threads);
+	root.put_attr("software_shading", graphics_preferences->software_shading);
 	root.put_attr("anisotropy_level", graphics_preferences->OGL_Configure.AnisotropyLevel);
 	root.put_attr("multisamples", graphics_preferences->OGL_Configure.Multisamples);
+	root.put_attr("texture_memory_budget", graphics_preferences->OGL_Configure.TextureMemoryBudget);
+	root.put_attr("sort_surfaces", graphics_preferences->OGL_Configure.SortSurfaces);
+	root.put_attr("bloom_quality", graphics_preferences->OGL_Configure.BloomQuality);
+	root.put_attr("occlusion_culling", graphics_preferences->OGL_Configure.OcclusionCulling);
+	root.put_attr("dynamic_resolution", graphics_preferences->OGL_Configure.DynamicResolution);
+	root.put_attr("post_antialiasing", graphics_preferences->OGL_Configure.PostAntialiasing);
 	root.put_attr("geforce_fix", graphics_preferences->OGL_Configure.GeForceFix);
 	root.put_attr("wait_for_vsync", graphics_preferences->OGL_Configure.WaitForVSync);
 	root.put_attr("gamma_corrected_blending", graphics_preferences->OGL_Configure.Use_sRGB);
 	root.put_attr("use_npot", graphics_preferences->OGL_Configure.Use_NPOT);
 	root.put_attr("double_corpse_limit", graphics_preferences->double_corpse_limit);
 	root.put_attr("hog_the_cpu", graphics_preferences->hog_the_cpu);
+	root.put_attr("late_input", graphics_preferences->late_input);
+	root.put_attr("interpolate_world", graphics_preferences->interpolate_world);
+	root.put_attr("lazy_collections", graphics_preferences->lazy_collections);
 	root.put_attr("movie_export_video_quality", graphics_preferences->movie_export_video_quality);
 	root.put_attr("movie_export_audio_quality", graphics_preferences->movie_export_audio_quality);
 	
@@ -3046,6 +3210,7 @@ InfoTree network_preferences_tree()
 	root.put_attr("autogather", network_preferences->autogather);
 	root.put_attr("join_by_address", network_preferences->join_by_address);
 	root.put_attr("join_address", network_preferences->join_address);
+	root.put_attr("hub_address", network_preferences->hub_address);
 	root.put_attr("local_game_port", network_preferences->game_port);
 	root.put_attr("game_protocol", sNetworkGameProtocolNames[network_preferences->game_protocol]);
 	root.put_attr("use_speex_netmic_encoder", network_preferences->use_speex_encoder);
@@ -3100,6 +3265,8 @@ InfoTree environment_preferences_tree()
 	root.put_attr("hide_alephone_extensions", environment_preferences->hide_extensions);
 	root.put_attr("film_profile", static_cast<uint32>(environment_preferences->film_profile));
 	root.put_attr("maximum_quick_saves", environment_preferences->maximum_quick_saves);
+	root.put_attr("compress_saved_games", environment_preferences->compress_saved_games);
+	root.put_attr("low_memory", environment_preferences->low_memory);
 
 	for (Plugins::iterator it = Plugins::instance()->begin(); it != Plugins::instance()->end(); ++it) {
 		if (it->compatible() && !it->enabled) {
@@ -3112,6 +3279,93 @@ InfoTree environment_preferences_tree()
 	return root;
 }
 
+// Writes go to disk on a thread of their own, a moment after the last of a
+// run of changes, so nothing that changes a preference waits on the file
+static const int32 PREFERENCES_WRITE_DELAY = 500; // ms
+
+static struct preferences_writer_data {
+	SDL_Thread *thread;
+	SDL_mutex *lock;
+	SDL_cond *cond;
+
+	FileSpecifier file;
+	std::string xml; // not yet written, if waiting
+	bool waiting;
+	uint32 due;
+	bool quit;
+} preferences_writer = { 0, 0, 0, FileSpecifier(), std::string(), false, 0, false };
+
+// Through a temporary file, so a write cut short leaves the old file whole
+static void save_preferences_xml(FileSpecifier& file, const std::string& xml)
+{
+	FileSpecifier temp_file;
+	temp_file.SetTempName(file);
+
+	bool written = false;
+	if (temp_file.Create(_typecode_preferences))
+	{
+		OpenedFile of;
+		if (temp_file.Open(of, true))
+		{
+			written = xml.empty() || of.Write(static_cast<int32>(xml.size()), const_cast<char *>(xml.data()));
+		}
+	}
+
+	if (!written || !temp_file.Rename(file))
+	{
+		logError("Error saving preferences file (%s)", file.GetPath());
+		temp_file.Delete();
+	}
+}
+
+static int preferences_writer_thread(void *)
+{
+	SDL_LockMutex(preferences_writer.lock);
+	while (true)
+	{
+		if (!preferences_writer.waiting)
+		{
+			if (preferences_writer.quit)
+				break;
+			SDL_CondWait(preferences_writer.cond, preferences_writer.lock);
+			continue;
+		}
+
+		int32 wait = static_cast<int32>(preferences_writer.due - SDL_GetTicks());
+		if (wait > 0 && !preferences_writer.quit)
+		{
+			SDL_CondWaitTimeout(preferences_writer.cond, preferences_writer.lock, wait);
+			continue;
+		}
+
+		FileSpecifier file = preferences_writer.file;
+		std::string xml;
+		xml.swap(preferences_writer.xml);
+		preferences_writer.waiting = false;
+
+		SDL_UnlockMutex(preferences_writer.lock);
+		save_preferences_xml(file, xml);
+		SDL_LockMutex(preferences_writer.lock);
+	}
+	SDL_UnlockMutex(preferences_writer.lock);
+	return 0;
+}
+
+void finish_writing_preferences()
+{
+	if (!preferences_writer.thread)
+		return;
+
+	SDL_LockMutex(preferences_writer.lock);
+	preferences_writer.quit = true;
+	SDL_CondBroadcast(preferences_writer.cond);
+	SDL_UnlockMutex(preferences_writer.lock);
+
+	SDL_WaitThread(preferences_writer.thread, NULL);
+	preferences_writer.thread = 0;
+	preferences_writer.quit = false;
+}
+
 void write_preferences()
 {
 	InfoTree root;
@@ -3133,13 +3387,37 @@ void write_preferences()
 	FileSpec.SetToPreferencesDir();
 	FileSpec += getcstr(temporary, strFILENAMES, filenamePREFERENCES);
 	
+	std::ostringstream xml;
 	try {
-		fileroot.save_xml(FileSpec);
+		fileroot.save_xml(xml);
 	} catch (InfoTree::parse_error ex) {
 		logError("Error saving preferences file (%s): %s", FileSpec.GetPath(), ex.what());
+		return;
 	} catch (InfoTree::unexpected_error ex) {
 		logError("Error saving preferences file (%s): %s", FileSpec.GetPath(), ex.what());
+		return;
+	}
+
+	if (!preferences_writer.lock) preferences_writer.lock = SDL_CreateMutex();
+	if (!preferences_writer.cond) preferences_writer.cond = SDL_CreateCond();
+	if (preferences_writer.lock && preferences_writer.cond && !preferences_writer.thread)
+		preferences_writer.thread = SDL_CreateThread(preferences_writer_thread, "write_preferences", NULL);
+
+	if (!preferences_writer.thread)
+	{
+		// as it always was
+		save_preferences_xml(FileSpec, xml.str());
+		return;
 	}
+
+	// a write still waiting takes this one's place
+	SDL_LockMutex(preferences_writer.lock);
+	preferences_writer.file = FileSpec;
+	preferences_writer.xml = xml.str();
+	preferences_writer.waiting = true;
+	preferences_writer.due = SDL_GetTicks() + PREFERENCES_WRITE_DELAY;
+	SDL_CondBroadcast(preferences_writer.cond);
+	SDL_UnlockMutex(preferences_writer.lock);
 }
 
 
@@ -3173,9 +3451,14 @@ static void default_graphics_preferences(graphics_preferences_data *preferences)
 
 	preferences->double_corpse_limit= false;
 	preferences->hog_the_cpu = false;
+	preferences->late_input = false;
+	preferences->interpolate_world = false;
+	preferences->lazy_collections = false;
 
 	preferences->software_alpha_blending = _sw_alpha_off;
 	preferences->software_sdl_driver = _sw_driver_default;
+	preferences->software_render_threads = _sw_threads_off;
+	preferences->software_shading = _sw_shading_full;
 
 	preferences->movie_export_video_quality = 50;
 	preferences->movie_export_audio_quality = 50;
@@ -3198,6 +3481,7 @@ static void default_network_preferences(network_preferences_data *preferences)
 	preferences->autogather= false;
 	preferences->join_by_address= false;
 	obj_clear(preferences->join_address);
+	obj_clear(preferences->hub_address);
 	preferences->game_port= DEFAULT_GAME_PORT;
 	preferences->game_protocol= _network_game_protocol_default;
 #if !defined(DISABLE_NETWORKING)
@@ -3317,6 +3601,8 @@ static void default_environment_preferences(environment_preferences_data *prefer
 	preferences->hide_extensions = true;
 	preferences->film_profile = FILM_PROFILE_DEFAULT;
 	preferences->maximum_quick_saves = 0;
+	preferences->compress_saved_games = false;
+	preferences->low_memory = false;
 }
 
 
@@ -3630,29 +3916,40 @@ void parse_graphics_preferences(InfoTree root, std::string version)
 	root.read_attr("ogl_flags", graphics_preferences->OGL_Configure.Flags);
 	root.read_attr("software_alpha_blending", graphics_preferences->software_alpha_blending);
 	root.read_attr("software_sdl_driver", graphics_preferences->software_sdl_driver);
+	root.read_attr("software_render_threads", graphics_preferences->software_render_threads);
+	root.read_attr("software_shading", graphics_preferences->software_shading);
 	root.read_attr("anisotropy_level", graphics_preferences->OGL_Configure.AnisotropyLevel);
 	root.read_attr("multisamples", graphics_preferences->OGL_Configure.Multisamples);
+	root.read_attr_bounded<int16>("texture_memory_budget", graphics_preferences->OGL_Configure.TextureMemoryBudget, 0, INT16_MAX);
+	root.read_attr("sort_surfaces", graphics_preferences->OGL_Configure.SortSurfaces);
+	root.read_attr_bounded<int16>("bloom_quality", graphics_preferences->OGL_Configure.BloomQuality, 0, NUMBER_OF_BLOOM_QUALITIES - 1);
+	root.read_attr("occlusion_culling", graphics_preferences->OGL_Configure.OcclusionCulling);
+	root.read_attr_bounded<int16>("dynamic_resolution", graphics_preferences->OGL_Configure.DynamicResolution, 0, NUMBER_OF_DYNAMIC_RESOLUTION_TARGETS - 1);
+	root.read_attr("post_antialiasing", graphics_preferences->OGL_Configure.PostAntialiasing);
 	root.read_attr("geforce_fix", graphics_preferences->OGL_Configure.GeForceFix);
 	root.read_attr("wait_for_vsync", graphics_preferences->OGL_Configure.WaitForVSync);
 	root.read_attr("gamma_corrected_blending", graphics_preferences->OGL_Configure.Use_sRGB);
 	root.read_attr("use_npot", graphics_preferences->OGL_Configure.Use_NPOT);
 	root.read_attr("double_corpse_limit", graphics_preferences->double_corpse_limit);
 	root.read_attr("hog_the_cpu", graphics_preferences->hog_the_cpu);
+	root.read_attr("late_input", graphics_preferences->late_input);
+	root.read_attr("interpolate_world", graphics_preferences->interpolate_world);
+	root.read_attr("lazy_collections", graphics_preferences->lazy_collections);
 	root.read_attr_bounded<int16>("movie_export_video_quality", graphics_preferences->movie_export_video_quality, 0, 100);
 	root.read_attr_bounded<int16>("movie_export_audio_quality", graphics_preferences->movie_export_audio_quality, 0, 100);
 	
 	
-	BOOST_FOREACH(InfoTree vtree, root.children_named("void"))
+	BOOST_FOREACH(const InfoTree &vtree, root.children_named("void"))
 	{
-		BOOST_FOREACH(InfoTree color, vtree.children_named("color"))
+		BOOST_FOREACH(const InfoTree &color, vtree.children_named("color"))
 		{
 			color.read_color(graphics_preferences->OGL_Configure.VoidColor);
 		}
 	}
 	
-	BOOST_FOREACH(InfoTree landscape, root.children_named("landscapes"))
+	BOOST_FOREACH(const InfoTree &landscape, root.children_named("landscapes"))
 	{
-		BOOST_FOREACH(InfoTree color, root.children_named("color"))
+		BOOST_FOREACH(const InfoTree &color, root.children_named("color"))
 		{
 			int16 index;
 			if (color.read_indexed("index", index, 8))
@@ -3660,7 +3957,7 @@ void parse_graphics_preferences(InfoTree root, std::string version)
 		}
 	}
 	
-	BOOST_FOREACH(InfoTree tex, root.children_named("texture"))
+	BOOST_FOREACH(const InfoTree &tex, root.children_named("texture"))
 	{
 		int16 index;
 		if (tex.read_indexed("index", index, OGL_NUMBER_OF_TEXTURE_TYPES+1))
@@ -3686,7 +3983,7 @@ void parse_player_preferences(InfoTree root, std::string version)
 	root.read_attr("bkgd_music", player_preferences->background_music_on);
 	root.read_attr("crosshairs_active", player_preferences->crosshairs_active);
 	
-	BOOST_FOREACH(InfoTree child, root.children_named("chase_cam"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("chase_cam"))
 	{
 		child.read_attr("behind", player_preferences->ChaseCam.Behind);
 		child.read_attr("upward", player_preferences->ChaseCam.Upward);
@@ -3697,7 +3994,7 @@ void parse_player_preferences(InfoTree root, std::string version)
 		child.read_attr("opacity", player_preferences->ChaseCam.Opacity);
 	}
 	
-	BOOST_FOREACH(InfoTree child, root.children_named("crosshairs"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("crosshairs"))
 	{
 		child.read_attr("thickness", player_preferences->Crosshairs.Thickness);
 		child.read_attr("from_center", player_preferences->Crosshairs.FromCenter);
@@ -3705,7 +4002,7 @@ void parse_player_preferences(InfoTree root, std::string version)
 		child.read_attr("shape", player_preferences->Crosshairs.Shape);
 		child.read_attr("opacity", player_preferences->Crosshairs.Opacity);
 		
-		BOOST_FOREACH(InfoTree color, child.children_named("color"))
+		BOOST_FOREACH(const InfoTree &color, child.children_named("color"))
 			color.read_color(player_preferences->Crosshairs.Color);
 	}
 }
@@ -3829,7 +4126,7 @@ void parse_input_preferences(InfoTree root, std::string version)
 	memset(seen_shell_key, 0, sizeof(seen_shell_key));
 	
 	// import old key bindings
-	BOOST_FOREACH(InfoTree key, root.children_named("sdl_key"))
+	BOOST_FOREACH(const InfoTree &key, root.children_named("sdl_key"))
 	{
 		int16 index;
 		if (key.read_indexed("index", index, NUMBER_OF_KEYS))
@@ -3865,7 +4162,7 @@ void parse_input_preferences(InfoTree root, std::string version)
 		}
 	}
 	
-	BOOST_FOREACH(InfoTree key, root.children_named("binding"))
+	BOOST_FOREACH(const InfoTree &key, root.children_named("binding"))
 	{
 		std::string action_name, pressed_name;
 		if (key.read_attr("action", action_name) &&
@@ -3928,6 +4225,7 @@ void parse_network_preferences(InfoTree root, std::string version)
 	root.read_attr("autogather", network_preferences->autogather);
 	root.read_attr("join_by_address", network_preferences->join_by_address);
 	root.read_cstr("join_address", network_preferences->join_address, 255);
+	root.read_cstr("hub_address", network_preferences->hub_address, 255);
 	root.read_attr("local_game_port", network_preferences->game_port);
 
 	std::string protocol;
@@ -3971,16 +4269,16 @@ void parse_network_preferences(InfoTree root, std::string version)
 	root.read_attr("join_metaserver_by_default", network_preferences->join_metaserver_by_default);
 	root.read_attr("allow_stats", network_preferences->allow_stats);
 
-	BOOST_FOREACH(InfoTree color, root.children_named("color"))
+	BOOST_FOREACH(const InfoTree &color, root.children_named("color"))
 	{
 		int16 index;
 		if (color.read_indexed("index", index, 2))
 			color.read_color(network_preferences->metaserver_colors[index]);
 	}
 	
-	BOOST_FOREACH(InfoTree child, root.children_named("star_protocol"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("star_protocol"))
 		StarGameProtocol::ParsePreferencesTree(child, version);
-	BOOST_FOREACH(InfoTree child, root.children_named("ring_protocol"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("ring_protocol"))
 		RingGameProtocol::ParsePreferencesTree(child, version);
 }
 
@@ -4009,8 +4307,10 @@ void parse_environment_preferences(InfoTree root, std::string version)
 		environment_preferences->film_profile = static_cast<FilmProfileType>(profile);
 	
 	root.read_attr("maximum_quick_saves", environment_preferences->maximum_quick_saves);
+	root.read_attr("compress_saved_games", environment_preferences->compress_saved_games);
+	root.read_attr("low_memory", environment_preferences->low_memory);
 	
-	BOOST_FOREACH(InfoTree plugin, root.children_named("disable_plugin"))
+	BOOST_FOREACH(const InfoTree &plugin, root.children_named("disable_plugin"))
 	{
 		char tempstr[256];
 		if (plugin.read_path("path", tempstr))
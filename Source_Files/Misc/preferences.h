@@ -76,6 +76,16 @@ enum {
 	_sw_driver_direct3d,
 	_sw_driver_opengl,
 };
+enum {
+	_sw_threads_off,
+	_sw_threads_2,
+	_sw_threads_4,
+	_sw_threads_automatic,
+};
+enum {
+	_sw_shading_full,
+	_sw_shading_compact, // 32-bit: fewer shading tables, blended between
+};
 
 struct graphics_preferences_data
 {
@@ -87,8 +97,13 @@ struct graphics_preferences_data
 
 	int16 software_alpha_blending;
 	int16 software_sdl_driver;
+	int16 software_render_threads;
+	int16 software_shading;
 
 	bool hog_the_cpu;
+	bool late_input; // with smooth motion, hold a frame back for a tick about to come due (shell.cpp)
+	bool interpolate_world; // draw frames between ticks (interpolated_world.h)
+	bool lazy_collections; // build collections the map doesn't use when first drawn (shapes.cpp)
 
 	int16 movie_export_video_quality;
     int16 movie_export_audio_quality;
@@ -116,6 +131,7 @@ struct network_preferences_data
 	bool autogather;
 	bool join_by_address;
 	char join_address[256];
+	char hub_address[256];	// standalone hub for star games we gather, as host[:port]; empty to host it ourselves
 	uint16 game_port;	// TCP and UDP port number used for game traffic (not player-location traffic)
 	uint16 game_protocol; // _network_game_protocol_star, etc.
 	bool use_speex_encoder;
@@ -249,6 +265,14 @@ struct environment_preferences_data
 
 	// how many auto-named save files to keep around (0 is unlimited)
 	uint32 maximum_quick_saves;
+
+	// deflate saved games' world data; older versions can't read them
+	bool compress_saved_games;
+
+	// smaller budgets and lazier loading throughout, for constrained devices:
+	// lazy collections, compact shading, and less kept of textures, sounds
+	// and cached images (see apply_low_memory_preference())
+	bool low_memory;
 };
 
 /* New preferences.. (this sorta defeats the purpose of this system, but not really) */
@@ -265,6 +289,10 @@ void initialize_preferences(void);
 void read_preferences();
 void handle_preferences(void);
 void write_preferences(void);
+// Passes environment_preferences->low_memory on to the subsystems that don't read it themselves
+void apply_low_memory_preference(void);
+// Waits for a write still to go out
+void finish_writing_preferences(void);
 
 void transition_preferences(const DirectorySpecifier& legacy_prefs_dir);
 
@@ -159,7 +159,7 @@ static void parse_theme_image(InfoTree root, int type, int state, int max_index)
 
 static void parse_theme_images(InfoTree root, int type, int state, int num_items = 1)
 {
-	BOOST_FOREACH(InfoTree img, root.children_named("image"))
+	BOOST_FOREACH(const InfoTree &img, root.children_named("image"))
 	{
 		parse_theme_image(img, type, state, num_items - 1);
 	}
@@ -186,7 +186,7 @@ static void parse_theme_color(InfoTree root, int type, int state, int max_index)
 
 static void parse_theme_colors(InfoTree root, int type, int state, int num_items = 1)
 {
-	BOOST_FOREACH(InfoTree color, root.children_named("color"))
+	BOOST_FOREACH(const InfoTree &color, root.children_named("color"))
 	{
 		parse_theme_color(color, type, state, num_items - 1);
 	}
@@ -222,7 +222,7 @@ static void parse_theme_font(InfoTree root, int type)
 
 static void parse_theme_fonts(InfoTree root, int type)
 {
-	BOOST_FOREACH(InfoTree child, root.children_named("font"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("font"))
 		parse_theme_font(child, type);
 }
 
@@ -273,17 +273,17 @@ static void parse_button(InfoTree root)
 	parse_theme_fonts(root, BUTTON_WIDGET);
 	parse_theme_images(root, BUTTON_WIDGET, DEFAULT_STATE, 3);
 	
-	BOOST_FOREACH(InfoTree child, root.children_named("active"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("active"))
 	{
 		parse_theme_colors(child, BUTTON_WIDGET, ACTIVE_STATE, 3);
 		parse_theme_images(child, BUTTON_WIDGET, ACTIVE_STATE, 3);
 	}
-	BOOST_FOREACH(InfoTree child, root.children_named("disabled"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("disabled"))
 	{
 		parse_theme_colors(child, BUTTON_WIDGET, DISABLED_STATE, 3);
 		parse_theme_images(child, BUTTON_WIDGET, DISABLED_STATE, 3);
 	}
-	BOOST_FOREACH(InfoTree child, root.children_named("pressed"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("pressed"))
 	{
 		parse_theme_colors(child, BUTTON_WIDGET, PRESSED_STATE, 3);
 		parse_theme_images(child, BUTTON_WIDGET, PRESSED_STATE, 3);
@@ -302,17 +302,17 @@ static void parse_tiny_button(InfoTree root)
 	parse_theme_fonts(root, TINY_BUTTON);
 	parse_theme_images(root, TINY_BUTTON, DEFAULT_STATE, 3);
 	
-	BOOST_FOREACH(InfoTree child, root.children_named("active"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("active"))
 	{
 		parse_theme_colors(child, TINY_BUTTON, ACTIVE_STATE, 3);
 		parse_theme_images(child, TINY_BUTTON, ACTIVE_STATE, 3);
 	}
-	BOOST_FOREACH(InfoTree child, root.children_named("disabled"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("disabled"))
 	{
 		parse_theme_colors(child, TINY_BUTTON, DISABLED_STATE, 3);
 		parse_theme_images(child, TINY_BUTTON, DISABLED_STATE, 3);
 	}
-	BOOST_FOREACH(InfoTree child, root.children_named("pressed"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("pressed"))
 	{
 		parse_theme_colors(child, TINY_BUTTON, PRESSED_STATE, 3);
 		parse_theme_images(child, TINY_BUTTON, PRESSED_STATE, 3);
@@ -326,15 +326,15 @@ static void parse_hyperlink(InfoTree root)
 	parse_theme_colors(root, HYPERLINK_WIDGET, DEFAULT_STATE, 3);
 	parse_theme_fonts(root, HYPERLINK_WIDGET);
 	
-	BOOST_FOREACH(InfoTree child, root.children_named("active"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("active"))
 	{
 		parse_theme_colors(child, HYPERLINK_WIDGET, ACTIVE_STATE, 3);
 	}
-	BOOST_FOREACH(InfoTree child, root.children_named("disabled"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("disabled"))
 	{
 		parse_theme_colors(child, HYPERLINK_WIDGET, DISABLED_STATE, 3);
 	}
-	BOOST_FOREACH(InfoTree child, root.children_named("pressed"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("pressed"))
 	{
 		parse_theme_colors(child, HYPERLINK_WIDGET, PRESSED_STATE, 3);
 	}
@@ -348,11 +348,11 @@ static void parse_item(InfoTree root)
 	parse_theme_colors(root, ITEM_WIDGET, DEFAULT_STATE);
 	parse_theme_fonts(root, ITEM_WIDGET);
 	
-	BOOST_FOREACH(InfoTree child, root.children_named("active"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("active"))
 	{
 		parse_theme_colors(child, ITEM_WIDGET, ACTIVE_STATE);
 	}
-	BOOST_FOREACH(InfoTree child, root.children_named("disabled"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("disabled"))
 	{
 		parse_theme_colors(child, ITEM_WIDGET, DISABLED_STATE);
 	}
@@ -365,11 +365,11 @@ static void parse_label(InfoTree root)
 	parse_theme_colors(root, LABEL_WIDGET, DEFAULT_STATE);
 	parse_theme_fonts(root, LABEL_WIDGET);
 	
-	BOOST_FOREACH(InfoTree child, root.children_named("active"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("active"))
 	{
 		parse_theme_colors(child, LABEL_WIDGET, ACTIVE_STATE);
 	}
-	BOOST_FOREACH(InfoTree child, root.children_named("disabled"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("disabled"))
 	{
 		parse_theme_colors(child, LABEL_WIDGET, DISABLED_STATE);
 	}
@@ -389,15 +389,15 @@ static void parse_text_entry(InfoTree root)
 	parse_theme_colors(root, TEXT_ENTRY_WIDGET, DEFAULT_STATE);
 	parse_theme_fonts(root, TEXT_ENTRY_WIDGET);
 	
-	BOOST_FOREACH(InfoTree child, root.children_named("active"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("active"))
 	{
 		parse_theme_colors(child, TEXT_ENTRY_WIDGET, ACTIVE_STATE);
 	}
-	BOOST_FOREACH(InfoTree child, root.children_named("disabled"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("disabled"))
 	{
 		parse_theme_colors(child, TEXT_ENTRY_WIDGET, DISABLED_STATE);
 	}
-	BOOST_FOREACH(InfoTree child, root.children_named("cursor"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("cursor"))
 	{
 		parse_theme_colors(child, TEXT_ENTRY_WIDGET, CURSOR_STATE);
 	}
@@ -423,14 +423,14 @@ static void parse_list(InfoTree root)
 	parse_theme_colors(root, LIST_WIDGET, DEFAULT_STATE, 3);
 	parse_theme_images(root, LIST_WIDGET, DEFAULT_STATE, 8);
 	
-	BOOST_FOREACH(InfoTree child, root.children_named("trough"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("trough"))
 	{
 		child.read_attr("top", dialog_theme[LIST_WIDGET].spaces[TROUGH_T_SPACE]);
 		child.read_attr("bottom", dialog_theme[LIST_WIDGET].spaces[TROUGH_B_SPACE]);
 		child.read_attr("right", dialog_theme[LIST_WIDGET].spaces[TROUGH_R_SPACE]);
 		child.read_attr("width", dialog_theme[LIST_WIDGET].spaces[TROUGH_WIDTH]);
 	}
-	BOOST_FOREACH(InfoTree child, root.children_named("thumb"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("thumb"))
 	{
 		start_parse_widget(LIST_THUMB);
 		parse_theme_colors(child, LIST_THUMB, DEFAULT_STATE, 3);
@@ -448,7 +448,7 @@ static void parse_slider(InfoTree root)
 	parse_theme_colors(root, SLIDER_WIDGET, DEFAULT_STATE, 3);
 	parse_theme_images(root, SLIDER_WIDGET, DEFAULT_STATE, 3);
 	
-	BOOST_FOREACH(InfoTree child, root.children_named("thumb"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("thumb"))
 	{
 		start_parse_widget(SLIDER_THUMB);
 		parse_theme_colors(child, SLIDER_THUMB, DEFAULT_STATE, 3);
@@ -465,11 +465,11 @@ static void parse_checkbox(InfoTree root)
 	parse_theme_fonts(root, CHECKBOX);
 	parse_theme_images(root, CHECKBOX, DEFAULT_STATE, 2);
 	
-	BOOST_FOREACH(InfoTree child, root.children_named("active"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("active"))
 	{
 		parse_theme_images(child, CHECKBOX, ACTIVE_STATE, 2);
 	}
-	BOOST_FOREACH(InfoTree child, root.children_named("disabled"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("disabled"))
 	{
 		parse_theme_images(child, CHECKBOX, DISABLED_STATE, 2);
 	}
@@ -489,17 +489,17 @@ static void parse_tab(InfoTree root)
 	parse_theme_fonts(root, TAB_WIDGET);
 	parse_theme_images(root, TAB_WIDGET, DEFAULT_STATE, 5);
 	
-	BOOST_FOREACH(InfoTree child, root.children_named("active"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("active"))
 	{
 		parse_theme_colors(child, TAB_WIDGET, ACTIVE_STATE, 3);
 		parse_theme_images(child, TAB_WIDGET, ACTIVE_STATE, 5);
 	}
-	BOOST_FOREACH(InfoTree child, root.children_named("disabled"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("disabled"))
 	{
 		parse_theme_colors(child, TAB_WIDGET, DISABLED_STATE, 3);
 		parse_theme_images(child, TAB_WIDGET, DISABLED_STATE, 5);
 	}
-	BOOST_FOREACH(InfoTree child, root.children_named("pressed"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("pressed"))
 	{
 		parse_theme_colors(child, TAB_WIDGET, PRESSED_STATE, 3);
 		parse_theme_images(child, TAB_WIDGET, PRESSED_STATE, 5);
@@ -509,7 +509,7 @@ static void parse_tab(InfoTree root)
 static void parse_metaserver(InfoTree root)
 {
 	start_parse_widget(METASERVER_WIDGETS);
-	BOOST_FOREACH(InfoTree child, root.children_named("games"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("games"))
 	{
 		start_parse_widget(METASERVER_GAMES);
 		child.read_attr("entries", dialog_theme[METASERVER_GAMES].spaces[w_games_in_room::GAME_ENTRIES]);
@@ -518,28 +518,28 @@ static void parse_metaserver(InfoTree root)
 		parse_theme_colors(child, METASERVER_GAMES, w_games_in_room::GAME, 3);
 		parse_theme_fonts(child, METASERVER_GAMES);
 		
-		BOOST_FOREACH(InfoTree gtype, child.children_named("selected"))
+		BOOST_FOREACH(const InfoTree &gtype, child.children_named("selected"))
 		{
 			parse_theme_colors(gtype, METASERVER_GAMES, w_games_in_room::SELECTED_GAME, 3);
 		}
-		BOOST_FOREACH(InfoTree gtype, child.children_named("running"))
+		BOOST_FOREACH(const InfoTree &gtype, child.children_named("running"))
 		{
 			parse_theme_colors(gtype, METASERVER_GAMES, w_games_in_room::RUNNING_GAME, 3);
-			BOOST_FOREACH(InfoTree stype, gtype.children_named("selected"))
+			BOOST_FOREACH(const InfoTree &stype, gtype.children_named("selected"))
 			{
 				parse_theme_colors(stype, METASERVER_GAMES, w_games_in_room::SELECTED_RUNNING_GAME, 3);
 			}
 		}
-		BOOST_FOREACH(InfoTree gtype, child.children_named("incompatible"))
+		BOOST_FOREACH(const InfoTree &gtype, child.children_named("incompatible"))
 		{
 			parse_theme_colors(gtype, METASERVER_GAMES, w_games_in_room::INCOMPATIBLE_GAME, 3);
-			BOOST_FOREACH(InfoTree stype, gtype.children_named("selected"))
+			BOOST_FOREACH(const InfoTree &stype, gtype.children_named("selected"))
 			{
 				parse_theme_colors(stype, METASERVER_GAMES, w_games_in_room::SELECTED_INCOMPATIBLE_GAME, 3);
 			}
 		}
 	}
-	BOOST_FOREACH(InfoTree child, root.children_named("players"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("players"))
 	{
 		start_parse_widget(METASERVER_PLAYERS);
 		child.read_attr("lines", dialog_theme[METASERVER_PLAYERS].spaces[0]);
@@ -556,39 +556,39 @@ static bool parse_theme_file(FileSpecifier& theme_mml)
 	try {
 		InfoTree root = InfoTree::load_xml(theme_mml).get_child("marathon.theme");
 		
-		BOOST_FOREACH(InfoTree child, root.children_named("default"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("default"))
 			parse_default(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("frame"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("frame"))
 			parse_frame(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("title"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("title"))
 			parse_title(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("spacer"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("spacer"))
 			parse_spacer(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("button"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("button"))
 			parse_button(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("tiny_button"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("tiny_button"))
 			parse_tiny_button(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("hyperlink"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("hyperlink"))
 			parse_hyperlink(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("item"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("item"))
 			parse_item(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("label"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("label"))
 			parse_label(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("message"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("message"))
 			parse_message(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("text_entry"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("text_entry"))
 			parse_text_entry(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("chat_entry"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("chat_entry"))
 			parse_chat_entry(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("list"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("list"))
 			parse_list(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("slider"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("slider"))
 			parse_slider(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("checkbox"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("checkbox"))
 			parse_checkbox(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("tab"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("tab"))
 			parse_tab(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("metaserver"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("metaserver"))
 			parse_metaserver(child);
 		
 		success = true;
@@ -1696,7 +1696,7 @@ void tab_placer::visible(bool visible)
 
 dialog::dialog() : active_widget(NULL), mouse_widget(0), active_widget_num(UNONE), done(false),
             cursor_was_visible(false), parent_dialog(NULL),
-		   processing_function(NULL), placer(0), last_redraw(0)
+		   processing_function(NULL), placer(0), last_redraw(0), blitter(NULL)
 {
 }
 
@@ -1718,6 +1718,10 @@ dialog::~dialog()
 		delete placer;
 		placer = 0;
 	}
+
+#ifdef HAVE_OPENGL
+	delete blitter;
+#endif
 }
 
 
@@ -1773,25 +1777,43 @@ void dialog::layout()
 
 void dialog::update(SDL_Rect r) const
 {
+	vector<SDL_Rect> rects(1, r);
+	update(rects);
+}
+
+void dialog::update(const vector<SDL_Rect>& rects) const
+{
+	if (rects.empty())
+		return;
+
 #ifdef HAVE_OPENGL
 	if (OGL_IsActive()) {
+		// The whole frame is swapped, so the whole dialog is drawn; its
+		// textures are only copied into, not made anew
 		OGL_Blitter::BoundScreen(false);
 		clear_screen(false);
-		OGL_Blitter blitter;
+		if (!blitter)
+			blitter = new OGL_Blitter;
 		SDL_Rect src = { 0, 0, rect.w, rect.h };
-		blitter.Load(*dialog_surface, src);
-		blitter.Draw(rect);
+		blitter->Load(*dialog_surface, src);
+		blitter->Draw(rect);
 
 		MainScreenSwap();
 	} else 
 #endif
 	{
+		// Only the parts that changed
 		SDL_Surface *video = MainScreenSurface();
-		SDL_Rect dst_rect = rect;
-		SDL_Rect src_rect = { 0, 0, rect.w, rect.h };
-		SDL_BlitSurface(dialog_surface, &src_rect, video, &dst_rect);
-		MainScreenUpdateRects(1, &dst_rect);
-
+		vector<SDL_Rect> dst_rects;
+		for (size_t i = 0; i < rects.size(); i++) {
+			SDL_Rect src_rect = rects[i];
+			SDL_Rect dst_rect = src_rect;
+			dst_rect.x += rect.x;
+			dst_rect.y += rect.y;
+			SDL_BlitSurface(dialog_surface, &src_rect, video, &dst_rect);
+			dst_rects.push_back(dst_rect);
+		}
+		MainScreenUpdateRects(dst_rects.size(), &dst_rects[0]);
 	}
 }
 
@@ -1862,11 +1884,17 @@ void
 dialog::draw_dirty_widgets() const
 {
 	if (top_dialog != this) return;
-        for (unsigned i=0; i<widgets.size(); i++)
+
+	// Draw every dirty widget first, then put them on screen together
+	vector<SDL_Rect> rects;
+	for (unsigned i=0; i<widgets.size(); i++)
 		if (widgets[i]->is_dirty())
 			if (widgets[i]->visible())
-				draw_widget(widgets[i]);
-	
+			{
+				draw_widget(widgets[i], false);
+				rects.push_back(widgets[i]->rect);
+			}
+	update(rects);
 }       
 
 /*
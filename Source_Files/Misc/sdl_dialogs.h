@@ -41,6 +41,7 @@ using std::vector;
 class widget;
 class font_info;
 class FileSpecifier;
+class OGL_Blitter;
 
 
 /*
@@ -244,6 +245,7 @@ public:
 private:
 	SDL_Surface *get_surface(void) const;
 	void update(SDL_Rect r) const;
+	void update(const vector<SDL_Rect>& rects) const;
 	void draw_widget(widget *w, bool do_update = true) const;
 	void deactivate_currently_active_widget();
 	void activate_first_widget(void);
@@ -277,6 +279,10 @@ private:
 	bool layout_for_fullscreen; // is the current layout for fullscreen?
 
 	Uint32 last_redraw;
+
+	// The dialog surface, as last uploaded for OpenGL; kept so that each
+	// redraw is copied into the same textures
+	mutable OGL_Blitter *blitter;
 };
 
 // Pointer to top-level dialog, NULL = no dialog active
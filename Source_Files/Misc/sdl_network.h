@@ -120,6 +120,16 @@ void NetDDPDisposeFrame(DDPFramePtr frame);
 
 OSErr NetDDPSendFrame(DDPFramePtr frame, NetAddrBlock *address, short protocolType, short socket);
 
+// Frames sent in between are handed to the system together at the flush, where the platform
+// lets us (Linux); call both with the mytm mutex held
+void NetDDPBeginBatch(void);
+OSErr NetDDPFlushBatch(void);
+
+// Incoming datagrams are held back, shuffled and lost as these say (network_conditions.h);
+// call before opening the socket
+struct NetworkConditions;
+void NetDDPSetConditions(const NetworkConditions& inConditions);
+
 /* ---------- prototypes/NETWORK_ADSP.C */
 
 // jkvw: removed - we use TCPMess now
@@ -74,11 +74,18 @@ Aug 26, 2000 (Loren Petrich):
 
 Feb 20, 2002 (Woody Zenfell):
     Uses GetRealActionQueues()->enqueueActionFlags() rather than queue_action_flags().
+
+Oct 14, 2026:
+	Added timedemo mode: a film replayed one rendered frame per tick, unpaced,
+	with frame and simulation timings reported at its end
 */
 
 #include "cseries.h"
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
 
 #include "map.h"
 #include "interface.h"
@@ -97,7 +104,12 @@ Feb 20, 2002 (Woody Zenfell):
 #include "Console.h"
 #include "joystick.h"
 #include "Movie.h"
+#include "Mixer.h"
 #include "InfoTree.h"
+#include "FrameProfiler.h"
+
+#include <SDL_mutex.h>
+#include <SDL_thread.h>
 
 /* ---------- constants */
 
@@ -125,12 +137,41 @@ static int32 heartbeat_count;
 static bool input_task_active;
 static timer_task_proc input_task;
 
+// Periodic task management (see install_timer_task())
+typedef bool (*timer_func)(void);
+
+static timer_func tm_func = NULL;	// The installed timer task
+static uint64_t tm_period;			// Performance counts between two calls of the timer task
+static uint64_t tm_last = 0, tm_accum = 0;
+static double tm_late = 0;			// Milliseconds after it was due that the call running now was made
+
 // LP: defined this here so it will work properly
 static FileSpecifier FilmFileSpec;
 static OpenedFile FilmFile;
 
 struct replay_private_data replay;
 
+// Tick of the film being replayed that a seek is heading for, or NONE
+static int32 replay_seek_target = NONE;
+static bool replay_rewind_pending = false;
+
+// Timedemo measurements, in milliseconds
+static bool timedemo_running = false;
+static bool timedemo_is_headless = false;
+static std::vector<float> timedemo_frame_times;
+static double timedemo_sim_time;
+static int32 timedemo_ticks;
+static uint32 timedemo_world_checksum;
+static uint64_t timedemo_last_frame;
+static uint64_t timedemo_start;
+static uint64_t timedemo_first_tick;
+static uint64_t timedemo_last_tick;
+static uint64_t timedemo_subsystem_counts[NUMBER_OF_TIMEDEMO_SUBSYSTEMS];
+
+static const char *timedemo_subsystem_names[NUMBER_OF_TIMEDEMO_SUBSYSTEMS] = {
+	"lua", "map", "players", "projectiles", "monsters", "objects", "presentation"
+};
+
 #ifdef DEBUG
 ActionQueue *get_player_recording_queue(
 	short player_index)
@@ -145,6 +186,10 @@ ActionQueue *get_player_recording_queue(
 /* ---------- private prototypes */
 static void remove_input_controller(void);
 static void save_recording_queue_chunk(short player_index);
+static void start_film_writer(void);
+static void write_film_data(const uint8 *data, int32 count);
+static void flush_film_writer(void);
+static void stop_film_writer(void);
 static void read_recording_queue_chunks(void);
 static bool pull_flags_from_recording(short count);
 // LP modifications for object-oriented file handling; returns a test for end-of-file
@@ -248,11 +293,222 @@ void decrement_replay_speed(
 	if (replay.replay_speed > MINIMUM_REPLAY_SPEED) replay.replay_speed--;
 }
 
+bool game_is_being_replayed(
+	void)
+{
+	return replay.game_is_being_replayed;
+}
+
+int32 get_replay_position(
+	void)
+{
+	return replay.game_is_being_replayed ? replay.position : 0;
+}
+
+bool seek_replay(
+	int32 tick)
+{
+	// films from resources can't be started over, and a movie being made of
+	// the replay would lose the ticks in between
+	if (!replay.game_is_being_replayed || replay.resource_data || Movie::instance()->IsRecording() || timedemo_running)
+		return false;
+	if (get_game_state() != _game_in_progress)
+		return false;
+
+	tick = MAX(tick, 0);
+	if (tick < replay.position)
+	{
+		// the world can only be run forward, so go back to the start of the
+		// film and run it up to the tick again
+		replay_rewind_pending = true;
+		replay_seek_target = tick;
+		set_game_state(_revert_game);
+	}
+	else
+	{
+		replay_seek_target = (tick > replay.position) ? tick : NONE;
+	}
+
+	return true;
+}
+
+bool replay_seek_active(
+	void)
+{
+	return replay_seek_target != NONE;
+}
+
+bool replay_rewind_requested(
+	void)
+{
+	return replay_rewind_pending;
+}
+
+void rewind_replay(
+	void)
+{
+	assert(replay.game_is_being_replayed && !replay.resource_data);
+
+	FilmFile.SetPosition(SIZEOF_recording_header);
+	replay.location_in_cache= NULL;
+	replay.bytes_in_cache= 0;
+	replay.have_read_last_chunk= false;
+	replay.position= 0;
+	replay_rewind_pending= false;
+	if (replay_seek_target == 0)
+		replay_seek_target= NONE;
+}
+
 void increment_heartbeat_count(int value)
 {
 	heartbeat_count+=value;
 }
 
+static double performance_counter_ms(uint64_t count)
+{
+	return count * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+void start_timedemo(
+	bool headless)
+{
+	timedemo_running = true;
+	timedemo_is_headless = headless;
+	timedemo_first_tick = timedemo_last_tick = 0;
+	obj_clear(timedemo_subsystem_counts);
+	timedemo_frame_times.clear();
+	timedemo_sim_time = 0;
+	timedemo_ticks = 0;
+	timedemo_world_checksum = 2166136261U;
+	timedemo_last_frame = timedemo_start = 0;
+	Mixer::instance()->StartTiming();
+}
+
+bool timedemo_active(
+	void)
+{
+	return timedemo_running;
+}
+
+bool timedemo_headless(
+	void)
+{
+	return timedemo_running && timedemo_is_headless;
+}
+
+void record_timedemo_tick(
+	double milliseconds)
+{
+	timedemo_sim_time += milliseconds;
+	timedemo_ticks++;
+
+	timedemo_last_tick = SDL_GetPerformanceCounter();
+	if (!timedemo_first_tick)
+		timedemo_first_tick = timedemo_last_tick;
+}
+
+void record_timedemo_subsystem(
+	int subsystem,
+	uint64_t counts)
+{
+	assert(subsystem >= 0 && subsystem < NUMBER_OF_TIMEDEMO_SUBSYSTEMS);
+	timedemo_subsystem_counts[subsystem] += counts;
+}
+
+static void report_timedemo_simulation(
+	void)
+{
+	double total = performance_counter_ms(timedemo_last_tick - timedemo_first_tick);
+
+	char report[512];
+	snprintf(report, sizeof(report),
+		"timedemo: %d ticks in %.3f s (%.1f ticks per second); simulation %.3f ms per tick; world checksum %08x",
+		int(timedemo_ticks), total / 1000.0, total > 0 ? timedemo_ticks * 1000.0 / total : 0.0,
+		timedemo_ticks ? timedemo_sim_time / timedemo_ticks : 0.0, timedemo_world_checksum);
+	logNote("%s", report);
+	printf("%s\n", report);
+}
+
+static void report_timedemo_subsystems(
+	void)
+{
+	char report[512];
+	int length = snprintf(report, sizeof(report), "timedemo simulation per tick:");
+	for (int i = 0; i < NUMBER_OF_TIMEDEMO_SUBSYSTEMS && length < int(sizeof(report)); i++)
+	{
+		length += snprintf(report + length, sizeof(report) - length, " %s %.4f ms%s",
+			timedemo_subsystem_names[i],
+			timedemo_ticks ? performance_counter_ms(timedemo_subsystem_counts[i]) / timedemo_ticks : 0.0,
+			i + 1 < NUMBER_OF_TIMEDEMO_SUBSYSTEMS ? "," : "");
+	}
+	logNote("%s", report);
+	printf("%s\n", report);
+}
+
+void record_timedemo_world_checksums(
+	const uint32 *checksums,
+	int count)
+{
+	for (int i = 0; i < count; i++)
+		timedemo_world_checksum = (timedemo_world_checksum ^ checksums[i]) * 16777619U;
+}
+
+void record_timedemo_frame(
+	void)
+{
+	uint64_t now = SDL_GetPerformanceCounter();
+	if (timedemo_last_frame)
+		timedemo_frame_times.push_back(performance_counter_ms(now - timedemo_last_frame));
+	else
+		timedemo_start = now;
+	timedemo_last_frame = now;
+}
+
+void finish_timedemo(
+	void)
+{
+	if (!timedemo_running) return;
+	timedemo_running = false;
+
+	// the film's sounds, as mixed for the channel counts they came to
+	std::vector<std::string> mixer_report = Mixer::instance()->StopTiming();
+
+	if (timedemo_is_headless)
+	{
+		report_timedemo_simulation();
+		report_timedemo_subsystems();
+		return;
+	}
+
+	size_t count = timedemo_frame_times.size();
+	if (count == 0)
+	{
+		logError("timedemo: no frames were rendered");
+		return;
+	}
+
+	std::vector<float> sorted(timedemo_frame_times);
+	std::sort(sorted.begin(), sorted.end());
+	double total = performance_counter_ms(timedemo_last_frame - timedemo_start);
+	double p99 = sorted[std::min(count - 1, size_t(count * 0.99))];
+
+	char report[512];
+	snprintf(report, sizeof(report),
+		"timedemo: %d frames in %.3f s (%.2f fps); frame time min %.3f ms, avg %.3f ms, p99 %.3f ms, max %.3f ms; simulation %.3f ms per tick over %d ticks; world checksum %08x",
+		int(count + 1), total / 1000.0, count * 1000.0 / total,
+		sorted.front(), total / count, p99, sorted.back(),
+		timedemo_ticks ? timedemo_sim_time / timedemo_ticks : 0.0, int(timedemo_ticks), timedemo_world_checksum);
+	logNote("%s", report);
+	printf("%s\n", report);
+	report_timedemo_subsystems();
+
+	for (size_t i = 0; i < mixer_report.size(); i++)
+	{
+		logNote("timedemo mixer: %s", mixer_report[i].c_str());
+		printf("timedemo mixer: %s\n", mixer_report[i].c_str());
+	}
+}
+
 bool has_recording_file(void)
 {
 	FileSpecifier File;
@@ -263,7 +519,7 @@ bool has_recording_file(void)
 bool input_controller(
 	void)
 {
-	if (input_task_active || Movie::instance()->IsRecording())
+	if (input_task_active || Movie::instance()->IsRecording() || timedemo_running)
 	{
 		if((heartbeat_count-dynamic_world->tick_count) < MAXIMUM_TIME_DIFFERENCE)
 		{
@@ -275,8 +531,43 @@ bool input_controller(
 			{
 				static short phase= 0; /* When this gets to 0, update the world */
 
+				if (replay_rewind_pending)
+				{
+					/* Waiting to be started over */
+				}
+				else if (replay_seek_target != NONE || timedemo_headless())
+				{
+					/* Seeking, or headless: as many ticks as the world may fall
+					   behind by, and as the queues hold, every time we're called */
+					int32 flag_count= MAXIMUM_TIME_DIFFERENCE - 1 - (heartbeat_count - dynamic_world->tick_count);
+					if (replay_seek_target != NONE)
+						flag_count= MIN(flag_count, replay_seek_target - replay.position);
+					for (short player_index= 0; player_index < dynamic_world->player_count; player_index++)
+						flag_count= MIN(flag_count, get_recording_queue_size(player_index));
+
+					if (flag_count > 0 && pull_flags_from_recording(flag_count))
+					{
+						heartbeat_count+= flag_count;
+					}
+					else if (replay.have_read_last_chunk && get_recording_queue_size(0) == 0)
+					{
+						if (replay_seek_target != NONE)
+						{
+							/* Sought past the end */
+							replay_seek_target= NONE;
+						}
+						else
+						{
+							assert(get_game_state()==_game_in_progress || get_game_state()==_switch_demo);
+							set_game_state(_switch_demo);
+						}
+					}
+
+					if (replay_seek_target != NONE && replay.position >= replay_seek_target)
+						replay_seek_target= NONE;
+				}
 				/* Minimum replay speed is a pause. */
-				if(replay.replay_speed != MINIMUM_REPLAY_SPEED)
+				else if(replay.replay_speed != MINIMUM_REPLAY_SPEED)
 				{
 					if (replay.replay_speed > 0 || (--phase<=0))
 					{
@@ -305,6 +596,7 @@ bool input_controller(
 			else // then getting input from the keyboard/mouse
 			{
 				uint32 action_flags= parse_keymap();
+				FrameProfiler::instance()->InputSampled(tm_late);
 				
 				process_action_flags(local_player_index, &action_flags, 1);
 				heartbeat_count++; // ba-doom
@@ -351,6 +643,130 @@ static void record_action_flags(
 	}
 }
 
+/*********************************************************************************************
+ *
+ * Film writer: chunks being recorded pile up in memory, and a thread writes them out,
+ * so that a slow disk holds up only it. After each batch the thread rewrites the header
+ * with the length written so far, so that a film cut off by a crash still replays up to
+ * its last batch.
+ *
+ *********************************************************************************************/
+
+static struct film_writer_data {
+	SDL_Thread *thread;
+	SDL_mutex *lock;
+	SDL_sem *work;
+	bool quit;
+	bool failed;
+	// what the thread hasn't written yet, and the header that goes with it
+	std::vector<uint8> pending;
+	uint8 header[SIZEOF_recording_header];
+	bool header_changed;
+} film_writer;
+
+static int film_writer_thread(void *)
+{
+	std::vector<uint8> data;
+	uint8 header[SIZEOF_recording_header];
+
+	for (;;)
+	{
+		SDL_SemWait(film_writer.work);
+
+		SDL_LockMutex(film_writer.lock);
+		bool quit = film_writer.quit;
+		bool write_header = film_writer.header_changed;
+		data.clear();
+		data.swap(film_writer.pending);
+		memcpy(header, film_writer.header, SIZEOF_recording_header);
+		film_writer.header_changed = false;
+		SDL_UnlockMutex(film_writer.lock);
+
+		bool success = true;
+		if (!data.empty())
+			success = FilmFile.Write(data.size(), &data[0]);
+		if (success && write_header)
+		{
+			int32 end;
+			success = FilmFile.GetPosition(end) && FilmFile.SetPosition(0) &&
+				FilmFile.Write(SIZEOF_recording_header, header) && FilmFile.SetPosition(end);
+		}
+		if (!success)
+			film_writer.failed = true;
+
+		if (quit)
+			break;
+	}
+
+	return 0;
+}
+
+static void start_film_writer(
+	void)
+{
+	assert(!film_writer.thread);
+	film_writer.quit = false;
+	film_writer.failed = false;
+	film_writer.header_changed = false;
+	film_writer.pending.clear();
+
+	if (!film_writer.lock)
+		film_writer.lock = SDL_CreateMutex();
+	if (!film_writer.work)
+		film_writer.work = SDL_CreateSemaphore(0);
+	if (film_writer.lock && film_writer.work)
+		film_writer.thread = SDL_CreateThread(film_writer_thread, "film_writer", NULL);
+	if (!film_writer.thread)
+		logWarning("Could not start the film writer thread; films will be written as they are recorded");
+}
+
+static void write_film_data(
+	const uint8 *data,
+	int32 count)
+{
+	if (!film_writer.thread)
+	{
+		FilmFile.Write(count, const_cast<uint8 *>(data));
+		return;
+	}
+
+	SDL_LockMutex(film_writer.lock);
+	film_writer.pending.insert(film_writer.pending.end(), data, data + count);
+	SDL_UnlockMutex(film_writer.lock);
+}
+
+// Hands the thread what has been recorded so far, with the header for it
+static void flush_film_writer(
+	void)
+{
+	if (!film_writer.thread)
+		return;
+
+	SDL_LockMutex(film_writer.lock);
+	pack_recording_header(film_writer.header, &replay.header, 1);
+	film_writer.header_changed = true;
+	SDL_UnlockMutex(film_writer.lock);
+	SDL_SemPost(film_writer.work);
+}
+
+// Waits for everything to be written; the film file is the caller's again after
+static void stop_film_writer(
+	void)
+{
+	if (!film_writer.thread)
+		return;
+
+	SDL_LockMutex(film_writer.lock);
+	film_writer.quit = true;
+	SDL_UnlockMutex(film_writer.lock);
+	SDL_SemPost(film_writer.work);
+	SDL_WaitThread(film_writer.thread, NULL);
+	film_writer.thread = NULL;
+
+	if (film_writer.failed)
+		logError("Could not write all of the film");
+}
+
 /*********************************************************************************************
  *
  * Function: save_recording_queue_chunk
@@ -419,7 +835,7 @@ void save_recording_queue_chunk(
 		num_flags_saved += RECORD_CHUNK_SIZE-max_flags;
 	}
 	
-	FilmFile.Write(count,buffer);
+	write_film_data(buffer, count);
 	replay.header.length+= count;
 		
 	vwarn(num_flags_saved == RECORD_CHUNK_SIZE,
@@ -470,6 +886,7 @@ static bool pull_flags_from_recording(
 				}
 			}
 		}
+		replay.position+= count;
 	}
 	
 	return success;
@@ -559,6 +976,7 @@ bool setup_for_replay_from_file(
 			replay.location_in_cache= NULL;
 			replay.bytes_in_cache= 0;
 			replay.replay_speed= 1;
+			replay.position= 0;
 			
 #ifdef DEBUG_REPLAY
 			open_stream_file();
@@ -599,6 +1017,8 @@ void start_recording(
 			byte Header[SIZEOF_recording_header];
 			pack_recording_header(Header,&replay.header,1);
 			FilmFile.Write(SIZEOF_recording_header,Header);
+
+			start_film_writer();
 		}
 	}
 }
@@ -618,6 +1038,7 @@ void stop_recording(
 		{
 			save_recording_queue_chunk(player_index);
 		}
+		stop_film_writer();
 
 		/* Rewrite the header, since it has the new length */
 		FilmFile.SetPosition(0);
@@ -651,6 +1072,7 @@ void rewind_recording(
 		FilmFile.SetPosition(sizeof(recording_header));
 		*/
 		// Alternative that does not use "SetLength", but instead creates and re-creates the file.
+		stop_film_writer();
 		FilmFile.SetPosition(0);
 		byte Header[SIZEOF_recording_header];
 		FilmFile.Read(SIZEOF_recording_header,Header);
@@ -662,6 +1084,7 @@ void rewind_recording(
 		
 		// Use the packed length here!!!
 		replay.header.length= SIZEOF_recording_header;
+		start_film_writer();
 	}
 }
 
@@ -696,6 +1119,7 @@ void check_recording_replaying(
 				{
 					save_recording_queue_chunk(player_index);
 				}
+				flush_film_writer();
 			}
 		}
 	}
@@ -738,6 +1162,8 @@ void stop_replay(
 		assert(replay.valid);
 
 		replay.game_is_being_replayed= false;
+		replay_seek_target= NONE;
+		replay_rewind_pending= false;
 		if (replay.resource_data)
 		{
 			delete []replay.resource_data;
@@ -955,7 +1381,7 @@ void parse_mml_keyboard(const InfoTree& root)
 	if (!root.read_indexed("set", which_set, NUMBER_OF_KEY_SETUPS))
 		return;
 	
-	BOOST_FOREACH(InfoTree ktree, root.children_named("key"))
+	BOOST_FOREACH(const InfoTree &ktree, root.children_named("key"))
 	{
 		int16 index;
 		if (!ktree.read_indexed("index", index, NUMBER_OF_STANDARD_KEY_DEFINITIONS))
@@ -1224,46 +1650,53 @@ bool setup_replay_from_random_resource(uint32 map_checksum)
  *  Periodic task management
  */
 
-typedef bool (*timer_func)(void);
-
-static timer_func tm_func = NULL;	// The installed timer task
-static uint32 tm_period;			// Ticks between two calls of the timer task
-static uint32 tm_last = 0, tm_accum = 0;
-
 timer_task_proc install_timer_task(short tasks_per_second, timer_func func)
 {
-	// We only handle one task, which is enough
-	tm_period = 1000 / tasks_per_second;
+	// We only handle one task, which is enough; the period is still a whole
+	// number of milliseconds, as it was when it was timed by SDL_GetTicks(),
+	// so that the game runs at the same speed
+	tm_period = uint64_t(1000 / tasks_per_second) * SDL_GetPerformanceFrequency() / 1000;
 	tm_func = func;
-	tm_last = SDL_GetTicks();
+	tm_last = SDL_GetPerformanceCounter();
 	tm_accum = 0;
 	return (timer_task_proc)tm_func;
 }
 
+uint64_t timer_task_due()
+{
+	return tm_last - tm_accum + tm_period;
+}
+
 void remove_timer_task(timer_task_proc proc)
 {
 	tm_func = NULL;
 }
 
-void execute_timer_tasks(uint32 time)
+void execute_timer_tasks(uint64_t time)
 {
 	if (tm_func) {
-		if (Movie::instance()->IsRecording()) {
+		if (Movie::instance()->IsRecording() || timedemo_running) {
 			tm_func();
 			return;
 		}
-		uint32 now = time;
+		if (replay_seek_target != NONE) {
+			tm_func();
+			// so that the heartbeat doesn't race to catch up once it's over
+			tm_last = time;
+			tm_accum = 0;
+			return;
+		}
+		uint64_t now = time;
 		tm_accum += now - tm_last;
 		tm_last = now;
-		bool first_time = true;
+		uint32 now_ticks = SDL_GetTicks();
 		while (tm_accum >= tm_period) {
 			tm_accum -= tm_period;
-			if (first_time) {
-				if(get_keyboard_controller_status())
-					mouse_idle(input_preferences->input_device);
-
-				first_time = false;
-			}
+			tm_late = tm_accum * 1000.0 / SDL_GetPerformanceFrequency();
+			// ticks caught up on together each get the motion from their own time;
+			// the last takes everything, so none of it waits for another
+			if(get_keyboard_controller_status())
+				mouse_idle(input_preferences->input_device, tm_accum >= tm_period ? now_ticks - static_cast<uint32>(tm_late) : now_ticks);
 			tm_func();
 		}
 	}
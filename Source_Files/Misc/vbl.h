@@ -49,6 +49,31 @@ void get_recording_header_data(short *number_of_players, short *level_number, ui
 bool input_controller(void);
 void increment_heartbeat_count(int value = 1);
 
+/* Timedemo: a film replayed with every tick rendered and nothing waiting on
+   the heartbeat; the frame and simulation times are logged when it ends, with
+   a checksum of the world along the way that a changed build should repeat.
+   A headless one draws nothing and runs ticks as fast as they simulate, to
+   measure the simulation alone */
+enum {
+	_timedemo_lua,
+	_timedemo_map,
+	_timedemo_players,
+	_timedemo_projectiles,
+	_timedemo_monsters,
+	_timedemo_objects,
+	_timedemo_presentation,
+	NUMBER_OF_TIMEDEMO_SUBSYSTEMS
+};
+
+void start_timedemo(bool headless = false);
+bool timedemo_active(void);
+bool timedemo_headless(void);
+void record_timedemo_tick(double milliseconds);
+void record_timedemo_subsystem(int subsystem, uint64_t counts);
+void record_timedemo_world_checksums(const uint32 *checksums, int count);
+void record_timedemo_frame(void);
+void finish_timedemo(void);
+
 /* ------------ prototypes/VBL_MACINTOSH.C */
 void initialize_keyboard_controller(void);
 
@@ -59,6 +59,9 @@ struct replay_private_data {
 	bool game_is_being_recorded;
 	bool have_read_last_chunk;
 	ActionQueue *recording_queues;
+
+	// ticks taken from the film so far, counted across levels
+	int32 position;
 	
 	// fileref recording_file_refnum;
 	char *fsread_buffer;
@@ -120,17 +120,17 @@ static void parse_dim3(const InfoTree& root, Model3D& Model)
 {
 	// ignored: Creator Center Light Shading Shadow_Box Effects
 	
-	BOOST_FOREACH(InfoTree bound_box, root.children_named("Bound_Box"))
+	BOOST_FOREACH(const InfoTree &bound_box, root.children_named("Bound_Box"))
 	{
 		parse_bounding_box(bound_box, Model);
 	}
-	BOOST_FOREACH(InfoTree view_box, root.children_named("View_Box"))
+	BOOST_FOREACH(const InfoTree &view_box, root.children_named("View_Box"))
 	{
 		parse_bounding_box(view_box, Model);
 	}
-	BOOST_FOREACH(InfoTree vertexes, root.children_named("Vertexes"))
+	BOOST_FOREACH(const InfoTree &vertexes, root.children_named("Vertexes"))
 	{
-		BOOST_FOREACH(InfoTree v, vertexes.children_named("v"))
+		BOOST_FOREACH(const InfoTree &v, vertexes.children_named("v"))
 		{
 			Model3D_VertexSource data;
 			data.Position[0] = data.Position[1] = data.Position[2] = 0;
@@ -168,9 +168,9 @@ static void parse_dim3(const InfoTree& root, Model3D& Model)
 			VertexBoneTags.push_back(bt);
 		}
 	}
-	BOOST_FOREACH(InfoTree bones, root.children_named("Bones"))
+	BOOST_FOREACH(const InfoTree &bones, root.children_named("Bones"))
 	{
-		BOOST_FOREACH(InfoTree bone, root.children_named("Bone"))
+		BOOST_FOREACH(const InfoTree &bone, root.children_named("Bone"))
 		{
 			Model3D_Bone data;
 			data.Position[0] = data.Position[1] = data.Position[2] = 0;
@@ -194,13 +194,13 @@ static void parse_dim3(const InfoTree& root, Model3D& Model)
 			BoneOwnTags.push_back(bt);
 		}
 	}
-	BOOST_FOREACH(InfoTree fills, root.children_named("Fills"))
+	BOOST_FOREACH(const InfoTree &fills, root.children_named("Fills"))
 	{
-		BOOST_FOREACH(InfoTree fill, fills.children_named("Fill"))
+		BOOST_FOREACH(const InfoTree &fill, fills.children_named("Fill"))
 		{
-			BOOST_FOREACH(InfoTree triangles, fill.children_named("Triangles"))
+			BOOST_FOREACH(const InfoTree &triangles, fill.children_named("Triangles"))
 			{
-				BOOST_FOREACH(InfoTree v, triangles.children_named("v"))
+				BOOST_FOREACH(const InfoTree &v, triangles.children_named("v"))
 				{
 					uint16 vid = static_cast<uint16>(NONE);
 					float txtr_x, txtr_y;
@@ -226,9 +226,9 @@ static void parse_dim3(const InfoTree& root, Model3D& Model)
 			}
 		}
 	}
-	BOOST_FOREACH(InfoTree poses, root.children_named("Poses"))
+	BOOST_FOREACH(const InfoTree &poses, root.children_named("Poses"))
 	{
-		BOOST_FOREACH(InfoTree pose, poses.children_named("Pose"))
+		BOOST_FOREACH(const InfoTree &pose, poses.children_named("Pose"))
 		{
 			vector<Model3D_Frame> read_frame;
 			size_t num_bones = Model.Bones.size();
@@ -241,9 +241,9 @@ static void parse_dim3(const InfoTree& root, Model3D& Model)
 			if (pose.read_attr("name", tempstr))
 				strncpy(nt.Tag, tempstr.c_str(), NameTagSize);
 			
-			BOOST_FOREACH(InfoTree bones, pose.children_named("Bones"))
+			BOOST_FOREACH(const InfoTree &bones, pose.children_named("Bones"))
 			{
-				BOOST_FOREACH(InfoTree bone, bones.children_named("Bone"))
+				BOOST_FOREACH(const InfoTree &bone, bones.children_named("Bone"))
 				{
 					Model3D_Frame data;
 					obj_clear(data);
@@ -291,13 +291,13 @@ static void parse_dim3(const InfoTree& root, Model3D& Model)
 			FrameTags.push_back(nt);
 		}
 	}
-	BOOST_FOREACH(InfoTree animations, root.children_named("Animations"))
+	BOOST_FOREACH(const InfoTree &animations, root.children_named("Animations"))
 	{
-		BOOST_FOREACH(InfoTree animation, animations.children_named("Animation"))
+		BOOST_FOREACH(const InfoTree &animation, animations.children_named("Animation"))
 		{
-			BOOST_FOREACH(InfoTree poses, animation.children_named("Poses"))
+			BOOST_FOREACH(const InfoTree &poses, animation.children_named("Poses"))
 			{
-				BOOST_FOREACH(InfoTree pose, poses.children_named("Pose"))
+				BOOST_FOREACH(const InfoTree &pose, poses.children_named("Pose"))
 				{
 					Model3D_SeqFrame data;
 					obj_clear(data);
@@ -368,7 +368,7 @@ bool LoadModel_Dim3(FileSpecifier& Spec, Model3D& Model, int WhichPass)
 	bool parse_error = false;
 	try {
 		InfoTree fileroot = InfoTree::load_xml(Spec);
-		BOOST_FOREACH(InfoTree root, fileroot.children_named("Model"))
+		BOOST_FOREACH(const InfoTree &root, fileroot.children_named("Model"))
 		{
 			parse_dim3(root, Model);
 		}
@@ -24,6 +24,7 @@
 
 #include <string.h>
 #include <math.h>
+#include <algorithm>
 
 #include "VecOps.h"
 #include "cseries.h"
@@ -79,6 +80,10 @@ static void FindBoneTransform(Model3D_Transform& T, Model3D_Bone& Bone,
 // Res = A * B, in that order
 static void TMatMultiply(Model3D_Transform& Res, Model3D_Transform& A, Model3D_Transform& B);
 
+// Fills BoneMatrices with the cumulative bone transforms for a frame
+static void FindBoneMatrices(Model3D& Model,
+	GLshort FrameIndex, GLfloat MixFrac, GLshort AddlFrameIndex);
+
 	
 // Trig-function conversion:
 const GLfloat TrigNorm = GLfloat(1)/GLfloat(TRIG_MAGNITUDE);
@@ -98,12 +103,37 @@ void Model3D::Clear()
 	InvVSIPointers.clear();
 	Bones.clear();
 	VertIndices.clear();
+	DepthSortedVIs.clear();
 	Frames.clear();
 	SeqFrames.clear();
 	SeqFrmPointers.clear();
 	FindBoundingBox();
 }
 
+size_t Model3D::MemoryUsage() const
+{
+	size_t SortedUsage = 0;
+	for (size_t k=0; k<DepthSortedVIs.size(); k++)
+		SortedUsage += DepthSortedVIs[k].capacity()*sizeof(GLushort);
+	
+	return SortedUsage +
+		Positions.capacity()*sizeof(GLfloat) +
+		TxtrCoords.capacity()*sizeof(GLfloat) +
+		Normals.capacity()*sizeof(GLfloat) +
+		Tangents.capacity()*sizeof(vec4) +
+		Colors.capacity()*sizeof(GLfloat) +
+		VtxSrcIndices.capacity()*sizeof(GLushort) +
+		VtxSources.capacity()*sizeof(Model3D_VertexSource) +
+		NormSources.capacity()*sizeof(GLfloat) +
+		InverseVSIndices.capacity()*sizeof(GLushort) +
+		InvVSIPointers.capacity()*sizeof(GLushort) +
+		Bones.capacity()*sizeof(Model3D_Bone) +
+		VertIndices.capacity()*sizeof(GLushort) +
+		Frames.capacity()*sizeof(Model3D_Frame) +
+		SeqFrames.capacity()*sizeof(Model3D_SeqFrame) +
+		SeqFrmPointers.capacity()*sizeof(GLushort);
+}
+
 // Normalize an individual normal; return whether the normal had a nonzero length
 static bool NormalizeNormal(GLfloat *Normal)
 {
@@ -219,6 +249,218 @@ void Model3D::CalculateTangents()
 }
 
 
+// For the vertex-cache optimization: Tom Forsyth's scoring, for a cache
+// of this many vertices (more than most hardware has, which does little harm)
+const int VertexCacheSize = 32;
+
+static float VertexCacheScore(int CachePosition, int Remaining)
+{
+	if (Remaining == 0) return -1;
+	
+	float Score = 0;
+	if (CachePosition >= 0)
+	{
+		// The last triangle's vertices are all equally good
+		if (CachePosition < 3)
+			Score = 0.75f;
+		else
+			Score = pow(1 - float(CachePosition - 3)/(VertexCacheSize - 3), 1.5f);
+	}
+	
+	// Finish off vertices with few triangles left, so they leave the cache for good
+	return Score + 2/sqrt(float(Remaining));
+}
+
+// Copies a per-vertex array in the new vertex order
+template<class T> static void ReorderVertexArray(vector<T>& Array, size_t Width, const vector<GLushort>& Order)
+{
+	if (Array.empty()) return;
+	
+	vector<T> NewArray(Order.size()*Width);
+	for (size_t k=0; k<Order.size(); k++)
+		for (size_t l=0; l<Width; l++)
+			NewArray[Width*k + l] = Array[Width*Order[k] + l];
+	Array.swap(NewArray);
+}
+
+struct VertexRowLess
+{
+	const vector<GLfloat>& Rows;
+	size_t Width;
+	VertexRowLess(const vector<GLfloat>& _Rows, size_t _Width) : Rows(_Rows), Width(_Width) {}
+	bool operator()(GLushort A, GLushort B) const
+	{
+		return memcmp(&Rows[Width*A], &Rows[Width*B], Width*sizeof(GLfloat)) < 0;
+	}
+};
+
+void Model3D::OptimizeForVertexCache()
+{
+	size_t NumVerts = Positions.size()/3;
+	size_t NumTris = VertIndices.size()/3;
+	if (NumVerts == 0 || NumTris == 0 || VertIndices.size() != 3*NumTris) return;
+	
+	// Every per-vertex array must be there for every vertex, or not at all
+	if (Positions.size() != 3*NumVerts) return;
+	if (!TxtrCoords.empty() && TxtrCoords.size() != 2*NumVerts) return;
+	if (!Normals.empty() && Normals.size() != 3*NumVerts) return;
+	if (!Tangents.empty() && Tangents.size() != NumVerts) return;
+	if (!Colors.empty() && Colors.size() != 3*NumVerts) return;
+	if (!VtxSrcIndices.empty() && VtxSrcIndices.size() != NumVerts) return;
+	if (!NormSources.empty() && NormSources.size() != 3*NumVerts) return;
+	for (size_t k=0; k<VertIndices.size(); k++)
+		if (VertIndices[k] >= NumVerts) return;
+	
+	// Weld: vertices the same in every array become one
+	size_t Width = 3 + (TxtrCoords.empty() ? 0 : 2) + (Normals.empty() ? 0 : 3) +
+		(Tangents.empty() ? 0 : 4) + (Colors.empty() ? 0 : 3) +
+		(VtxSrcIndices.empty() ? 0 : 1) + (NormSources.empty() ? 0 : 3);
+	vector<GLfloat> Rows(Width*NumVerts);
+	for (size_t k=0; k<NumVerts; k++)
+	{
+		GLfloat *Row = &Rows[Width*k];
+		objlist_copy(Row,&Positions[3*k],3); Row += 3;
+		if (!TxtrCoords.empty()) {objlist_copy(Row,&TxtrCoords[2*k],2); Row += 2;}
+		if (!Normals.empty()) {objlist_copy(Row,&Normals[3*k],3); Row += 3;}
+		if (!Tangents.empty()) {objlist_copy(Row,&Tangents[k][0],4); Row += 4;}
+		if (!Colors.empty()) {objlist_copy(Row,&Colors[3*k],3); Row += 3;}
+		if (!VtxSrcIndices.empty()) *(Row++) = VtxSrcIndices[k];
+		if (!NormSources.empty()) {objlist_copy(Row,&NormSources[3*k],3); Row += 3;}
+	}
+	
+	vector<GLushort> Sorted(NumVerts);
+	for (size_t k=0; k<NumVerts; k++)
+		Sorted[k] = k;
+	VertexRowLess Less(Rows,Width);
+	std::sort(Sorted.begin(),Sorted.end(),Less);
+	
+	vector<GLushort> Weld(NumVerts);
+	for (size_t k=0; k<NumVerts; k++)
+	{
+		if (k > 0 && !Less(Sorted[k-1],Sorted[k]))
+			Weld[Sorted[k]] = Weld[Sorted[k-1]];
+		else
+			Weld[Sorted[k]] = Sorted[k];
+	}
+	for (size_t k=0; k<VertIndices.size(); k++)
+		VertIndices[k] = Weld[VertIndices[k]];
+	
+	// Each vertex's triangles
+	vector<int> TriStart(NumVerts+1,0);
+	for (size_t k=0; k<VertIndices.size(); k++)
+		TriStart[VertIndices[k]+1]++;
+	for (size_t k=0; k<NumVerts; k++)
+		TriStart[k+1] += TriStart[k];
+	vector<int> VertTris(VertIndices.size());
+	vector<int> Remaining(NumVerts,0);
+	for (size_t t=0; t<NumTris; t++)
+		for (int c=0; c<3; c++)
+		{
+			GLushort v = VertIndices[3*t+c];
+			VertTris[TriStart[v] + Remaining[v]++] = t;
+		}
+	
+	vector<int> CachePosition(NumVerts,-1);
+	vector<float> VertScore(NumVerts);
+	for (size_t k=0; k<NumVerts; k++)
+		VertScore[k] = VertexCacheScore(-1,Remaining[k]);
+	
+	vector<float> TriScore(NumTris);
+	vector<bool> TriAdded(NumTris,false);
+	for (size_t t=0; t<NumTris; t++)
+		TriScore[t] = VertScore[VertIndices[3*t]] + VertScore[VertIndices[3*t+1]] + VertScore[VertIndices[3*t+2]];
+	
+	// Greedily take the best-scoring triangle among those using cached vertices
+	vector<GLushort> NewIndices;
+	NewIndices.reserve(VertIndices.size());
+	vector<int> Cache, NewCache;
+	size_t Cursor = 0;
+	int Best = NONE;
+	for (size_t Added=0; Added<NumTris; Added++)
+	{
+		if (Best == NONE)
+		{
+			while (TriAdded[Cursor]) Cursor++;
+			Best = Cursor;
+		}
+		
+		TriAdded[Best] = true;
+		NewCache.clear();
+		for (int c=0; c<3; c++)
+		{
+			GLushort v = VertIndices[3*Best+c];
+			NewIndices.push_back(v);
+			Remaining[v]--;
+			if (std::find(NewCache.begin(),NewCache.end(),v) == NewCache.end())
+				NewCache.push_back(v);
+		}
+		for (size_t k=0; k<Cache.size(); k++)
+			if (std::find(NewCache.begin(),NewCache.end(),Cache[k]) == NewCache.end())
+				NewCache.push_back(Cache[k]);
+		
+		// Those pushed out lose their cache score too
+		for (size_t k=0; k<NewCache.size(); k++)
+		{
+			int v = NewCache[k];
+			CachePosition[v] = (k < size_t(VertexCacheSize)) ? int(k) : -1;
+			VertScore[v] = VertexCacheScore(CachePosition[v],Remaining[v]);
+		}
+		if (NewCache.size() > size_t(VertexCacheSize))
+			NewCache.resize(VertexCacheSize);
+		Cache.swap(NewCache);
+		
+		Best = NONE;
+		float BestScore = -1;
+		for (size_t k=0; k<Cache.size(); k++)
+		{
+			int v = Cache[k];
+			for (int i=TriStart[v]; i<TriStart[v+1]; i++)
+			{
+				int t = VertTris[i];
+				if (TriAdded[t]) continue;
+				TriScore[t] = VertScore[VertIndices[3*t]] + VertScore[VertIndices[3*t+1]] + VertScore[VertIndices[3*t+2]];
+				if (TriScore[t] > BestScore)
+				{
+					BestScore = TriScore[t];
+					Best = t;
+				}
+			}
+		}
+	}
+	VertIndices.swap(NewIndices);
+	DepthSortedVIs.clear();
+	
+	// Vertices in the order the triangles first use them; unused ones are dropped
+	vector<int> NewIndex(NumVerts,NONE);
+	vector<GLushort> Order;
+	for (size_t k=0; k<VertIndices.size(); k++)
+	{
+		GLushort v = VertIndices[k];
+		if (NewIndex[v] == NONE)
+		{
+			NewIndex[v] = Order.size();
+			Order.push_back(v);
+		}
+		VertIndices[k] = NewIndex[v];
+	}
+	
+	ReorderVertexArray(Positions,3,Order);
+	ReorderVertexArray(TxtrCoords,2,Order);
+	ReorderVertexArray(Normals,3,Order);
+	ReorderVertexArray(Tangents,1,Order);
+	ReorderVertexArray(Colors,3,Order);
+	ReorderVertexArray(VtxSrcIndices,1,Order);
+	ReorderVertexArray(NormSources,3,Order);
+	
+	if (!VtxSrcIndices.empty())
+	{
+		InverseVSIndices.clear();
+		InvVSIPointers.clear();
+		BuildInverseVSIndices();
+	}
+}
+
+
 // Normalize the normals
 void Model3D::AdjustNormals(int NormalType, float SmoothThreshold)
 {
@@ -792,53 +1034,8 @@ bool Model3D::FindPositions_Frame(bool UseModelTransform,
 	size_t NumVertices = VtxSrcIndices.size();
 	Positions.resize(3*NumVertices);
 	
-	// Set sizes:
-	BoneMatrices.resize(NumBones);
-	BoneStack.resize(NumBones);
-	
-	// Find which frame; remember that frame data comes in [NumBones] sets
-	Model3D_Frame *FramePtr = &Frames[NumBones*FrameIndex];
-	Model3D_Frame *AddlFramePtr = &Frames[NumBones*AddlFrameIndex];
+	FindBoneMatrices(*this,FrameIndex,MixFrac,AddlFrameIndex);
 	
-	// Find the individual-bone transformation matrices:
-	for (size_t ib=0; ib<NumBones; ib++)
-		FindBoneTransform(BoneMatrices[ib],Bones[ib],
-			FramePtr[ib],MixFrac,AddlFramePtr[ib]);
-	
-	// Find the cumulative-bone transformation matrices:
-	int StackIndx = -1;
-	size_t Parent = UNONE;
-	for (unsigned int ib=0; ib<NumBones; ib++)
-	{
-		Model3D_Bone& Bone = Bones[ib];
-		
-		// Do the pop-push with the stack
-		// to get the bone's parent bone
-		if (TEST_FLAG(Bone.Flags,Model3D_Bone::Pop))
-		{
-			if (StackIndx >= 0)
-				Parent = BoneStack[StackIndx--];
-			else
-				Parent = UNONE;
-		}
-		if (TEST_FLAG(Bone.Flags,Model3D_Bone::Push))
-		{
-			StackIndx = MAX(StackIndx,-1);
-			BoneStack[++StackIndx] = Parent;
-		}
-		
-		// Do the transform!
-		if (Parent != UNONE)
-		{
-			Model3D_Transform Res;
-			TMatMultiply(Res,BoneMatrices[Parent],BoneMatrices[ib]);
-			obj_copy(BoneMatrices[ib],Res);
-		}
-	
-		// Default: parent of next bone is current bone
-		Parent = ib;
-	}
-		
 	bool NormalsPresent = !NormSources.empty();
 	if (NormalsPresent) Normals.resize(NormSources.size());
 	
@@ -1005,6 +1202,91 @@ bool Model3D::FindPositions_Sequence(bool UseModelTransform, GLshort SeqIndex,
 }
 
 
+void Model3D::FindSkinMatrices_Neutral(GLfloat *Matrices)
+{
+	Model3D_Transform T;
+	if (VtxSrcIndices.empty())
+		T.Identity();	// Static model: positions already transformed
+	else
+		obj_copy(T,TransformPos);
+	
+	for (size_t k=0; k<NumSkinMatrices(); k++)
+		objlist_copy(Matrices + 12*k,&T.M[0][0],12);
+}
+
+bool Model3D::FindSkinMatrices_Sequence(GLfloat *Matrices, GLshort SeqIndex,
+	GLshort FrameIndex, GLfloat MixFrac, GLshort AddlFrameIndex)
+{
+	// Bad inputs: do nothing and return false, as the position finders do
+	
+	GLshort NumSF = NumSeqFrames(SeqIndex);
+	if (NumSF <= 0) return false;
+	
+	if (FrameIndex < 0 || FrameIndex >= NumSF) return false;
+	
+	Model3D_Transform TSF;
+	
+	Model3D_SeqFrame& SF = SeqFrames[SeqFrmPointers[SeqIndex] + FrameIndex];
+	GLshort AddlFrame = SF.Frame;
+	
+	if (MixFrac != 0 && AddlFrameIndex != FrameIndex)
+	{
+		if (AddlFrameIndex < 0 || AddlFrameIndex >= NumSF) return false;
+		
+		Model3D_SeqFrame& ASF = SeqFrames[SeqFrmPointers[SeqIndex] + AddlFrameIndex];
+		FindFrameTransform(TSF,SF,MixFrac,ASF);
+		AddlFrame = ASF.Frame;
+	}
+	else
+	{
+		MixFrac = 0;
+		FindFrameTransform(TSF,SF,0,SF);
+	}
+	
+	if (Frames.empty()) return false;
+	
+	size_t NumBones = Bones.size();
+	if (SF.Frame < 0 || NumBones*SF.Frame >= Frames.size()) return false;
+	
+	FindBoneMatrices(*this,SF.Frame,MixFrac,AddlFrame);
+	
+	// The assumed root bone gets only the sequence and model transforms
+	Model3D_Transform TTot;
+	TMatMultiply(TTot,TransformPos,TSF);
+	objlist_copy(Matrices,&TTot.M[0][0],12);
+	
+	for (size_t ib=0; ib<NumBones; ib++)
+	{
+		Model3D_Transform T;
+		TMatMultiply(T,TTot,BoneMatrices[ib]);
+		objlist_copy(Matrices + 12*(ib+1),&T.M[0][0],12);
+	}
+	
+	return true;
+}
+
+void Model3D::FindSkinWeights(size_t VertIndex, GLfloat *Weights)
+{
+	// Default: the assumed root bone only
+	Weights[0] = Weights[1] = Weights[2] = 0;
+	
+	if (VertIndex >= VtxSrcIndices.size()) return;
+	size_t VSIndex = VtxSrcIndices[VertIndex];
+	if (VSIndex >= VtxSources.size()) return;
+	
+	// Same choices as in FindPositions_Frame()
+	Model3D_VertexSource& VS = VtxSources[VSIndex];
+	if (VS.Bone0 < 0) return;
+	
+	Weights[0] = Weights[1] = VS.Bone0 + 1;
+	if (VS.Bone1 >= 0)
+	{
+		Weights[1] = VS.Bone1 + 1;
+		Weights[2] = VS.Blend;
+	}
+}
+
+
 void Model3D_Transform::Identity()
 {
 	obj_clear(*this);
@@ -1145,4 +1427,59 @@ static void TMatMultiply(Model3D_Transform& Res, Model3D_Transform& A, Model3D_T
 }
 
 
+// Fills BoneMatrices with the cumulative bone transforms for a frame
+static void FindBoneMatrices(Model3D& Model,
+	GLshort FrameIndex, GLfloat MixFrac, GLshort AddlFrameIndex)
+{
+	size_t NumBones = Model.Bones.size();
+	
+	// Set sizes:
+	BoneMatrices.resize(NumBones);
+	BoneStack.resize(NumBones);
+	
+	// Find which frame; remember that frame data comes in [NumBones] sets
+	Model3D_Frame *FramePtr = &Model.Frames[NumBones*FrameIndex];
+	Model3D_Frame *AddlFramePtr = &Model.Frames[NumBones*AddlFrameIndex];
+	
+	// Find the individual-bone transformation matrices:
+	for (size_t ib=0; ib<NumBones; ib++)
+		FindBoneTransform(BoneMatrices[ib],Model.Bones[ib],
+			FramePtr[ib],MixFrac,AddlFramePtr[ib]);
+	
+	// Find the cumulative-bone transformation matrices:
+	int StackIndx = -1;
+	size_t Parent = UNONE;
+	for (unsigned int ib=0; ib<NumBones; ib++)
+	{
+		Model3D_Bone& Bone = Model.Bones[ib];
+		
+		// Do the pop-push with the stack
+		// to get the bone's parent bone
+		if (TEST_FLAG(Bone.Flags,Model3D_Bone::Pop))
+		{
+			if (StackIndx >= 0)
+				Parent = BoneStack[StackIndx--];
+			else
+				Parent = UNONE;
+		}
+		if (TEST_FLAG(Bone.Flags,Model3D_Bone::Push))
+		{
+			StackIndx = MAX(StackIndx,-1);
+			BoneStack[++StackIndx] = Parent;
+		}
+		
+		// Do the transform!
+		if (Parent != UNONE)
+		{
+			Model3D_Transform Res;
+			TMatMultiply(Res,BoneMatrices[Parent],BoneMatrices[ib]);
+			obj_copy(BoneMatrices[ib],Res);
+		}
+	
+		// Default: parent of next bone is current bone
+		Parent = ib;
+	}
+}
+
+
 #endif // def HAVE_OPENGL
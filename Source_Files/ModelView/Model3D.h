@@ -159,6 +159,12 @@ struct Model3D
 	GLushort *VIBase() {return &VertIndices[0];}
 	size_t NumVI() {return VertIndices.size();}
 	
+	// The triangles' vertex indices in farthest-to-nearest order, as seen from
+	// each of the directions ModelRenderer divides the horizontal into;
+	// each is made when it is first needed, and only for models without vertex sources,
+	// whose positions stay as they were loaded
+	vector< vector<GLushort> > DepthSortedVIs;
+	
 	// Frame array: each member is actually the transform to do on each bone;
 	// each frame has [number of bones] of these.
 	vector<Model3D_Frame> Frames;
@@ -215,9 +221,17 @@ struct Model3D
 	// So they all have length 1
 	void NormalizeNormals() {AdjustNormals(Original);}
 	void CalculateTangents();
+	
+	// Merges vertices that are the same in every array, orders the triangles
+	// for the post-transform vertex cache, then the vertices in the order the
+	// triangles first use them
+	void OptimizeForVertexCache();
 
 	// Erase everything
 	void Clear();
+
+	// Bytes the arrays hold
+	size_t MemoryUsage() const;
 	
 	// Build the trig tables for use in doing the transformations for frames and sequences;
 	// do this if build_trig_tables() in world.h was not already called elsewhere.
@@ -251,6 +265,23 @@ struct Model3D
 	bool FindPositions_Sequence(bool UseModelTransform, GLshort SeqIndex,
 		GLshort FrameIndex, GLfloat MixFrac = 0, GLshort AddlFrameIndex = 0);
 	
+	// For doing the above in a vertex shader instead: the transforms that the
+	// position finders would apply, with the model's overall transform included.
+	// There is one per bone plus one for the assumed root bone, which comes first;
+	// each is a Model3D_Transform's 3x4 matrix, row by row.
+	size_t NumSkinMatrices() {return Bones.size() + 1;}
+	
+	// Like FindPositions_Neutral(true); static models get identity matrices
+	void FindSkinMatrices_Neutral(GLfloat *Matrices);
+	
+	// Like FindPositions_Sequence(true,...); returns whether the indices were in range
+	bool FindSkinMatrices_Sequence(GLfloat *Matrices, GLshort SeqIndex,
+		GLshort FrameIndex, GLfloat MixFrac = 0, GLshort AddlFrameIndex = 0);
+	
+	// Which two skin matrices a vertex blends between, and by how much
+	// (first matrix index, second matrix index, blend factor)
+	void FindSkinWeights(size_t VertIndex, GLfloat *Weights);
+	
 	// Constructor
 	Model3D() {FindBoundingBox(); TransformPos.Identity(); TransformNorm.Identity();}
 };
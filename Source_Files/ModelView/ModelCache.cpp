@@ -0,0 +1,232 @@
+/*
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	Model cache
+*/
+
+#include "cseries.h"
+#include "ModelCache.h"
+
+#ifdef HAVE_OPENGL
+
+#include "crc.h"
+#include "Logging.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <SDL_atomic.h>
+
+// The second word is the layout of the model
+const uint32 ModelCacheMagic = FOUR_CHARS_TO_INT('A','1','M','D');
+const uint32 ModelCacheVersion = 2;
+
+// Past this, the least recently written entries are deleted, checked on
+// the first write and then every ModelCachePruneInterval bytes; models are
+// written from the loading threads
+const int64_t ModelCacheMaximumSize = 128 * 1024 * 1024;
+const int ModelCachePruneInterval = 8 * 1024 * 1024;
+static SDL_atomic_t ModelCacheWrittenSincePrune = { ModelCachePruneInterval };
+
+/*
+	After the header and the key, each of the model's arrays is its length
+	in elements, then its elements as they are in memory; then come the
+	transforms and the bounding box. All in native byte order, since the
+	cache never leaves the machine that wrote it.
+*/
+
+template<class T> static void PutArray(vector<char>& Out, const vector<T>& Array)
+{
+	uint32 Count = Array.size();
+	const char *Bytes = reinterpret_cast<const char *>(&Count);
+	Out.insert(Out.end(), Bytes, Bytes + sizeof(Count));
+	if (Count == 0) return;
+	Bytes = reinterpret_cast<const char *>(&Array[0]);
+	Out.insert(Out.end(), Bytes, Bytes + Count*sizeof(T));
+}
+
+static void PutBytes(vector<char>& Out, const void *Data, size_t Size)
+{
+	const char *Bytes = reinterpret_cast<const char *>(Data);
+	Out.insert(Out.end(), Bytes, Bytes + Size);
+}
+
+class ModelReader
+{
+public:
+	ModelReader(const vector<char>& Data) : Data(Data), Position(0) {}
+	
+	template<class T> bool GetArray(vector<T>& Array)
+	{
+		uint32 Count;
+		if (!GetBytes(&Count, sizeof(Count))) return false;
+		if ((Data.size() - Position)/sizeof(T) < Count) return false;
+		Array.resize(Count);
+		return Count == 0 || GetBytes(&Array[0], Count*sizeof(T));
+	}
+	
+	bool GetBytes(void *Buffer, size_t Size)
+	{
+		if (Data.size() - Position < Size) return false;
+		memcpy(Buffer, &Data[Position], Size);
+		Position += Size;
+		return true;
+	}
+	
+	bool AtEnd() const {return Position == Data.size();}
+	
+private:
+	const vector<char>& Data;
+	size_t Position;
+};
+
+void AddModelCacheSource(std::string& Key, FileSpecifier& File)
+{
+	if (File == FileSpecifier() || !File.Exists()) return;
+	
+	char Date[32];
+	sprintf(Date, "@%lld;", (long long) File.GetDate());
+	Key += File.GetPath();
+	Key += Date;
+}
+
+static DirectorySpecifier GetModelCacheDir()
+{
+	DirectorySpecifier Dir;
+	Dir.SetToLocalDataDir();
+	Dir += "Model Cache";
+	return Dir;
+}
+
+static bool GetModelCacheFile(const std::string& Key, FileSpecifier& File)
+{
+	DirectorySpecifier Dir = GetModelCacheDir();
+	if (!Dir.Exists() && !Dir.CreateDirectory()) return false;
+	
+	char Name[32];
+	sprintf(Name, "%08x.a1m", calculate_data_crc((unsigned char *) Key.data(), Key.size()));
+	File = Dir + Name;
+	return true;
+}
+
+static bool ReadModel(ModelReader& Reader, Model3D& Model)
+{
+	return Reader.GetArray(Model.Positions) &&
+		Reader.GetArray(Model.TxtrCoords) &&
+		Reader.GetArray(Model.Normals) &&
+		Reader.GetArray(Model.Tangents) &&
+		Reader.GetArray(Model.Colors) &&
+		Reader.GetArray(Model.VtxSrcIndices) &&
+		Reader.GetArray(Model.VtxSources) &&
+		Reader.GetArray(Model.NormSources) &&
+		Reader.GetArray(Model.InverseVSIndices) &&
+		Reader.GetArray(Model.InvVSIPointers) &&
+		Reader.GetArray(Model.Bones) &&
+		Reader.GetArray(Model.VertIndices) &&
+		Reader.GetArray(Model.Frames) &&
+		Reader.GetArray(Model.SeqFrames) &&
+		Reader.GetArray(Model.SeqFrmPointers) &&
+		Reader.GetBytes(&Model.TransformPos, sizeof(Model.TransformPos)) &&
+		Reader.GetBytes(&Model.TransformNorm, sizeof(Model.TransformNorm)) &&
+		Reader.GetBytes(Model.BoundingBox, sizeof(Model.BoundingBox)) &&
+		Reader.AtEnd();
+}
+
+bool ReadModelCache(const std::string& Key, Model3D& Model)
+{
+	FileSpecifier File;
+	if (!GetModelCacheFile(Key, File) || !File.Exists()) return false;
+	
+	OpenedFile OFile;
+	if (!File.Open(OFile)) return false;
+	
+	uint32 Header[4];
+	if (!OFile.Read(sizeof(Header), Header)) return false;
+	if (Header[0] != ModelCacheMagic || Header[1] != ModelCacheVersion || Header[2] != Key.size()) return false;
+	
+	std::string StoredKey(Header[2], '\0');
+	if (!OFile.Read(Header[2], &StoredKey[0]) || StoredKey != Key) return false;
+	
+	// The rest in one read
+	vector<char> Data(Header[3]);
+	if (Data.empty() || !OFile.Read(Data.size(), &Data[0])) return false;
+	
+	ModelReader Reader(Data);
+	if (!ReadModel(Reader, Model))
+	{
+		Model.Clear();
+		Model.Tangents.clear();
+		return false;
+	}
+	return true;
+}
+
+void WriteModelCache(const std::string& Key, Model3D& Model)
+{
+	vector<char> Data;
+	PutArray(Data, Model.Positions);
+	PutArray(Data, Model.TxtrCoords);
+	PutArray(Data, Model.Normals);
+	PutArray(Data, Model.Tangents);
+	PutArray(Data, Model.Colors);
+	PutArray(Data, Model.VtxSrcIndices);
+	PutArray(Data, Model.VtxSources);
+	PutArray(Data, Model.NormSources);
+	PutArray(Data, Model.InverseVSIndices);
+	PutArray(Data, Model.InvVSIPointers);
+	PutArray(Data, Model.Bones);
+	PutArray(Data, Model.VertIndices);
+	PutArray(Data, Model.Frames);
+	PutArray(Data, Model.SeqFrames);
+	PutArray(Data, Model.SeqFrmPointers);
+	PutBytes(Data, &Model.TransformPos, sizeof(Model.TransformPos));
+	PutBytes(Data, &Model.TransformNorm, sizeof(Model.TransformNorm));
+	PutBytes(Data, Model.BoundingBox, sizeof(Model.BoundingBox));
+	
+	FileSpecifier File;
+	if (!GetModelCacheFile(Key, File)) return;
+	
+	FileSpecifier TempFile;
+	TempFile.SetTempName(File);
+	if (!TempFile.Create(_typecode_unknown)) return;
+	
+	bool Written = false;
+	{
+		OpenedFile OFile;
+		if (TempFile.Open(OFile, true))
+		{
+			uint32 Header[4] = { ModelCacheMagic, ModelCacheVersion, uint32(Key.size()), uint32(Data.size()) };
+			Written = OFile.Write(sizeof(Header), Header) &&
+				OFile.Write(Key.size(), const_cast<char *>(Key.data())) &&
+				OFile.Write(Data.size(), &Data[0]);
+		}
+	}
+	
+	if (!Written || !TempFile.Rename(File))
+	{
+		logWarning("Could not write model cache entry %s", File.GetPath());
+		TempFile.Delete();
+		return;
+	}
+	
+	int Length = int(sizeof(uint32) * 4 + Key.size() + Data.size());
+	int SincePrune = SDL_AtomicAdd(&ModelCacheWrittenSincePrune, Length) + Length;
+	if (SincePrune >= ModelCachePruneInterval && SDL_AtomicCAS(&ModelCacheWrittenSincePrune, SincePrune, 0))
+		GetModelCacheDir().PruneDirectory(".a1m", ModelCacheMaximumSize);
+}
+
+#endif // def HAVE_OPENGL
@@ -0,0 +1,48 @@
+#ifndef MODEL_CACHE
+#define MODEL_CACHE
+/*
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	Model cache: models loaded with the Wavefront, 3DS and Dim3 loaders,
+	then transformed and optimized, are kept in the local data directory as
+	one compact binary file each, and read back from there as long as the
+	model's source files and its MML parameters are unchanged
+*/
+
+#include "cseries.h"
+
+#ifdef HAVE_OPENGL
+
+#include <string>
+#include "Model3D.h"
+#include "FileHandler.h"
+
+// A key is made of the loader's name and whatever else shapes the model,
+// then each source file it reads; a file is added by its path and
+// modification date
+void AddModelCacheSource(std::string& Key, FileSpecifier& File);
+
+// False if there is no entry for that key; the model is left empty then
+bool ReadModelCache(const std::string& Key, Model3D& Model);
+
+// Of a model ready to use
+void WriteModelCache(const std::string& Key, Model3D& Model);
+
+#endif // def HAVE_OPENGL
+
+#endif
@@ -34,7 +34,9 @@
 #endif
 
 #include "ModelRenderer.h"
+#include "FrameProfiler.h"
 #include <algorithm>
+#include <math.h>
 
 void ModelRenderer::Render(Model3D& Model, ModelRenderShader *Shaders, int NumShaders,
 	int NumSeparableShaders, bool Use_Z_Buffer)
@@ -57,6 +59,7 @@ void ModelRenderer::Render(Model3D& Model, ModelRenderShader *Shaders, int NumSh
 		for (int q=0; q<NumShaders; q++)
 		{
 			SetupRenderPass(Model,Shaders[q]);
+			FrameProfiler::CountDrawCall();
 			glDrawElements(GL_TRIANGLES,(GLsizei)Model.NumVI(),GL_UNSIGNED_SHORT,Model.VIBase());
 		}
 		return;			
@@ -67,29 +70,9 @@ void ModelRenderer::Render(Model3D& Model, ModelRenderShader *Shaders, int NumSh
 	// OpenGL != PowerVR
 	// (which can store polygons and depth-sort them in its hardware)
 	
-	// Find the centroids:
 	size_t NumTriangles = Model.NumVI()/3;
-	IndexedCentroidDepths.resize(NumTriangles);
-	
-	GLushort *VIPtr = Model.VIBase();
-	for (unsigned short k=0; k<NumTriangles; k++)
-	{
-		GLfloat Sum[3] = {0, 0, 0};
-		for (int v=0; v<3; v++)
-		{
-			GLfloat *Pos = &Model.Positions[3*(*VIPtr)];
-			Sum[0] += Pos[0];
-			Sum[1] += Pos[1];
-			Sum[2] += Pos[2];
-			VIPtr++;
-		}
-		IndexedCentroidDepths[k].index = k;
-		IndexedCentroidDepths[k].depth = 
-			Sum[0]*ViewDirection[0] + Sum[1]*ViewDirection[1] + Sum[2]*ViewDirection[2];
-	}
-	
-	// Sort!
-	std::sort(IndexedCentroidDepths.begin(), IndexedCentroidDepths.end());
+	if (NumTriangles == 0) return;
+	GLushort *SortedVIs = DepthSortedVIs(Model);
 	
 	// Optimization: a single nonseparable shader can be rendered as if it was separable,
 	// though it must still be depth-sorted.
@@ -98,26 +81,12 @@ void ModelRenderer::Render(Model3D& Model, ModelRenderShader *Shaders, int NumSh
 	
 	for (int q=0; q<NumSeparableShaders; q++)
 	{
-		// Need to do this only once
-		if (q == 0)
-		{
-			SortedVertIndices.resize(Model.NumVI());
-			GLushort *DestTriangle = &SortedVertIndices[0];
-			for (size_t k=0; k<NumTriangles; k++)
-			{
-				GLushort *SourceTriangle = &Model.VertIndices[3*IndexedCentroidDepths[k].index];
-				// Copy-over unrolled for speed
-				*(DestTriangle++) = *(SourceTriangle++);
-				*(DestTriangle++) = *(SourceTriangle++);
-				*(DestTriangle++) = *(SourceTriangle++);
-			}
-		}
-		
 		// Separable-shader optimization: render in one swell foop
 		SetupRenderPass(Model,Shaders[q]);
 				
 		// Go!
-		glDrawElements(GL_TRIANGLES,(GLsizei)Model.NumVI(),GL_UNSIGNED_SHORT,&SortedVertIndices[0]);
+		FrameProfiler::CountDrawCall();
+		glDrawElements(GL_TRIANGLES,(GLsizei)Model.NumVI(),GL_UNSIGNED_SHORT,SortedVIs);
 	}
 	
 	if (NumSeparableShaders < NumShaders)
@@ -125,10 +94,11 @@ void ModelRenderer::Render(Model3D& Model, ModelRenderShader *Shaders, int NumSh
 		// Multishader case: each triangle separately
 		for (size_t k=0; k<NumTriangles; k++)
 		{
-			GLushort *Triangle = &Model.VertIndices[3*IndexedCentroidDepths[k].index];
+			GLushort *Triangle = SortedVIs + 3*k;
 			for (int q=NumSeparableShaders; q<NumShaders; q++)
 			{
 				SetupRenderPass(Model,Shaders[q]);
+				FrameProfiler::CountDrawCall();
 				glDrawElements(GL_TRIANGLES,3,GL_UNSIGNED_SHORT,Triangle);
 			}
 		}
@@ -136,6 +106,109 @@ void ModelRenderer::Render(Model3D& Model, ModelRenderShader *Shaders, int NumSh
 }
 
 
+GLushort *ModelRenderer::DepthSortedVIs(Model3D& Model)
+{
+	// Animated models' positions change from frame to frame
+	if (!Model.VtxSrcIndices.empty())
+	{
+		SortTriangles(Model,ViewDirection,SortedVertIndices);
+		return &SortedVertIndices[0];
+	}
+	
+	// Which of the directions the view is nearest; the z-component is always 0
+	const double Sector = 8*atan(1.0)/NUMBER_OF_VIEW_DIRECTIONS;
+	double Angle = atan2(ViewDirection[1],ViewDirection[0]);
+	int Which = int(floor(Angle/Sector + 0.5)) % NUMBER_OF_VIEW_DIRECTIONS;
+	if (Which < 0) Which += NUMBER_OF_VIEW_DIRECTIONS;
+	
+	if (Model.DepthSortedVIs.size() != NUMBER_OF_VIEW_DIRECTIONS)
+		Model.DepthSortedVIs.assign(NUMBER_OF_VIEW_DIRECTIONS,vector<GLushort>());
+	
+	vector<GLushort>& SortedVIs = Model.DepthSortedVIs[Which];
+	if (SortedVIs.size() != Model.NumVI())
+	{
+		GLfloat Direction[3];
+		Direction[0] = GLfloat(cos(Which*Sector));
+		Direction[1] = GLfloat(sin(Which*Sector));
+		Direction[2] = 0;
+		SortTriangles(Model,Direction,SortedVIs);
+	}
+	return &SortedVIs[0];
+}
+
+
+// As an unsigned integer, a float's bits with the sign bit flipped sort like
+// the float for positive values, and all of them flipped for negative ones;
+// flipping the result again sorts the larger first
+static inline GLuint DescendingKey(GLfloat Depth)
+{
+	GLuint Bits;
+	memcpy(&Bits,&Depth,sizeof(Bits));
+	GLuint Ascending = (Bits & 0x80000000) ? ~Bits : (Bits | 0x80000000);
+	return ~Ascending;
+}
+
+void ModelRenderer::SortTriangles(Model3D& Model, const GLfloat *Direction, vector<GLushort>& SortedVIs)
+{
+	// Find the centroids:
+	size_t NumTriangles = Model.NumVI()/3;
+	IndexedCentroidDepths.resize(NumTriangles);
+	RadixScratch.resize(NumTriangles);
+	
+	GLushort *VIPtr = Model.VIBase();
+	for (size_t k=0; k<NumTriangles; k++)
+	{
+		GLfloat Sum[3] = {0, 0, 0};
+		for (int v=0; v<3; v++)
+		{
+			GLfloat *Pos = &Model.Positions[3*(*VIPtr)];
+			Sum[0] += Pos[0];
+			Sum[1] += Pos[1];
+			Sum[2] += Pos[2];
+			VIPtr++;
+		}
+		IndexedCentroidDepths[k].index = (unsigned short)k;
+		IndexedCentroidDepths[k].key = DescendingKey(
+			Sum[0]*Direction[0] + Sum[1]*Direction[1] + Sum[2]*Direction[2]);
+	}
+	
+	// Sort! Least significant 11 bits first, in three stable passes
+	IndexedCentroidDepth *Source = &IndexedCentroidDepths[0];
+	IndexedCentroidDepth *Dest = &RadixScratch[0];
+	for (int Shift=0; Shift<32; Shift+=11)
+	{
+		size_t Counts[2048];
+		memset(Counts,0,sizeof(Counts));
+		for (size_t k=0; k<NumTriangles; k++)
+			Counts[(Source[k].key >> Shift) & 0x7ff]++;
+		
+		size_t Start = 0;
+		for (int d=0; d<2048; d++)
+		{
+			size_t Count = Counts[d];
+			Counts[d] = Start;
+			Start += Count;
+		}
+		
+		for (size_t k=0; k<NumTriangles; k++)
+			Dest[Counts[(Source[k].key >> Shift) & 0x7ff]++] = Source[k];
+		
+		std::swap(Source,Dest);
+	}
+	
+	SortedVIs.resize(Model.NumVI());
+	GLushort *DestTriangle = &SortedVIs[0];
+	for (size_t k=0; k<NumTriangles; k++)
+	{
+		GLushort *SourceTriangle = &Model.VertIndices[3*Source[k].index];
+		// Copy-over unrolled for speed
+		*(DestTriangle++) = *(SourceTriangle++);
+		*(DestTriangle++) = *(SourceTriangle++);
+		*(DestTriangle++) = *(SourceTriangle++);
+	}
+}
+
+
 /* TODO: sRGB-correct model colors. This needs to be done in the loader. The
    lighting colors are already sRGB-corrected. -SB */
 void ModelRenderer::SetupRenderPass(Model3D& Model, ModelRenderShader& Shader)
@@ -215,6 +288,7 @@ void ModelRenderer::SetupRenderPass(Model3D& Model, ModelRenderShader& Shader)
 void ModelRenderer::Clear()
 {
 	IndexedCentroidDepths.clear();
+	RadixScratch.clear();
 	SortedVertIndices.clear();
 	ExtLightColors.clear();
 }
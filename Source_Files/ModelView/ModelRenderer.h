@@ -51,30 +51,38 @@ struct ModelRenderShader
 
 struct IndexedCentroidDepth
 {
-	// sort from farthest to nearest
-	bool operator<(const IndexedCentroidDepth& other) const {
-		return depth > other.depth;
-	}
-
-	GLfloat depth;
+	// the depth, as a key that sorts from farthest to nearest as an unsigned integer
+	GLuint key;
 	unsigned short index;
 };
 
 class ModelRenderer
 {
 	// Kept here to avoid unnecessary re-allocation
-	vector<IndexedCentroidDepth> IndexedCentroidDepths;
+	vector<IndexedCentroidDepth> IndexedCentroidDepths, RadixScratch;
 	vector<GLushort> SortedVertIndices;
 	vector<GLfloat> ExtLightColors;
 	
 	void SetupRenderPass(Model3D& Model, ModelRenderShader& Shader);
 	
+	// Radix-sorts the triangles by centroid along Direction, farthest first,
+	// and puts their vertex indices into SortedVIs in that order
+	void SortTriangles(Model3D& Model, const GLfloat *Direction, vector<GLushort>& SortedVIs);
+	
+	// The triangles' vertex indices in depth order for the current view direction
+	GLushort *DepthSortedVIs(Model3D& Model);
+	
 public:
 	
 	// Needed for depth-sorting the model triangles by centroid;
 	// it is in model coordinates.
 	GLfloat ViewDirection[3];
 	
+	// Models whose positions stay the same keep an order for each of this many
+	// horizontal directions, and are drawn in the one for the nearest;
+	// the others are sorted every time
+	enum {NUMBER_OF_VIEW_DIRECTIONS = 32};
+	
 	// External lighting now done with a shader callback
 		
 	// Render flags:
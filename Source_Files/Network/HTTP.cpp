@@ -43,24 +43,45 @@ size_t HTTPClient::WriteCallback(void* buffer, size_t size, size_t nmemb, void*
 	return size * nmemb;
 }
 
+// The client's handle, with the options of its last request cleared; curl
+// keeps the handle's connections open for the next request
+void* HTTPClient::Handle()
+{
+	if (handle_)
+	{
+		curl_easy_reset(handle_.get());
+	}
+	else
+	{
+		CURL* handle = curl_easy_init();
+		if (!handle)
+		{
+			logError("CURL init failed");
+			return 0;
+		}
+		handle_.reset(handle, curl_easy_cleanup);
+	}
+
+	return handle_.get();
+}
+
 bool HTTPClient::Get(const std::string& url)
 {
 	response_.clear();
 
-	boost::shared_ptr<CURL> handle(curl_easy_init(), curl_easy_cleanup);
+	CURL* handle = Handle();
 	if (!handle)
 	{
-		logError("CURL init failed");
 		return false;
 	}
 
-	curl_easy_setopt(handle.get(), CURLOPT_URL, url.c_str());
-	curl_easy_setopt(handle.get(), CURLOPT_WRITEFUNCTION, WriteCallback);
-	curl_easy_setopt(handle.get(), CURLOPT_WRITEDATA, this);
-	curl_easy_setopt(handle.get(), CURLOPT_SSL_VERIFYPEER, network_preferences->verify_https);
-	curl_easy_setopt(handle.get(), CURLOPT_FOLLOWLOCATION, 1);
+	curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+	curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, WriteCallback);
+	curl_easy_setopt(handle, CURLOPT_WRITEDATA, this);
+	curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, network_preferences->verify_https);
+	curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, 1);
 
-	CURLcode ret = curl_easy_perform(handle.get());
+	CURLcode ret = curl_easy_perform(handle);
 	if (ret == CURLE_OK) 
 	{
 		return true;
@@ -90,10 +111,9 @@ bool HTTPClient::Post(const std::string& url, const parameter_map& parameters)
 {
 	response_.clear();
 
-	boost::shared_ptr<CURL> handle(curl_easy_init(), curl_easy_cleanup);
+	CURL* handle = Handle();
 	if (!handle)
 	{
-		logError("CURL init failed");
 		return false;
 	}
 
@@ -105,19 +125,19 @@ bool HTTPClient::Post(const std::string& url, const parameter_map& parameters)
 		{
 			parameter_string.append("&");
 		}
-		parameter_string.append(escape(handle.get(), it->first));
+		parameter_string.append(escape(handle, it->first));
 		parameter_string.append("=");
-		parameter_string.append(escape(handle.get(), it->second));
+		parameter_string.append(escape(handle, it->second));
 	}
 
-	curl_easy_setopt(handle.get(), CURLOPT_URL, url.c_str());
-	curl_easy_setopt(handle.get(), CURLOPT_WRITEFUNCTION, WriteCallback);
-	curl_easy_setopt(handle.get(), CURLOPT_WRITEDATA, this);
-	curl_easy_setopt(handle.get(), CURLOPT_POST, 1L);
-	curl_easy_setopt(handle.get(), CURLOPT_SSL_VERIFYPEER, network_preferences->verify_https);
-	curl_easy_setopt(handle.get(), CURLOPT_POSTFIELDS, parameter_string.c_str());
+	curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+	curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, WriteCallback);
+	curl_easy_setopt(handle, CURLOPT_WRITEDATA, this);
+	curl_easy_setopt(handle, CURLOPT_POST, 1L);
+	curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, network_preferences->verify_https);
+	curl_easy_setopt(handle, CURLOPT_POSTFIELDS, parameter_string.c_str());
 
-	CURLcode ret = curl_easy_perform(handle.get());
+	CURLcode ret = curl_easy_perform(handle);
 	if (ret == CURLE_OK)
 	{
 		return true;
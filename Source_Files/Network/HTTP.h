@@ -20,11 +20,16 @@
 	http://www.gnu.org/licenses/gpl.html
 
 	HTTP utilities
+
+	A client keeps its connection open between requests, so a client
+	used for several requests to one server only connects once
 */
 
 #include <map>
 #include <string>
 
+#include <boost/shared_ptr.hpp>
+
 class HTTPClient
 {
 public:
@@ -39,7 +44,10 @@ public:
 
 private:
 	static size_t WriteCallback(void* buffer, size_t size, size_t nmemb, void* userp);
+	void* Handle();
+
 	std::string response_;
+	boost::shared_ptr<void> handle_;
 };
 
 #endif
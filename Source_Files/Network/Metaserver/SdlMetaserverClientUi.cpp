@@ -351,7 +351,10 @@ private:
 			games_in_room_w->refresh();
 		}
 		if (gMetaserverClient->isConnected())
+		{
 			MetaserverClient::pumpAll();
+			RefreshLists();
+		}
 		else if (!m_disconnected)
 		{ 
 			alert_user("Connection to room lost.", 0);
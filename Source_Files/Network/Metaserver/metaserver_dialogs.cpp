@@ -433,23 +433,19 @@ void MetaserverClientUi::JoinGame(const GameListMessage::GameListEntry& game)
 	Stop();
 }
 
+// How often the lists are redrawn while updates keep coming in
+const Uint32 kListRefreshInterval = 250;
+
 void MetaserverClientUi::playersInRoomChanged(const std::vector<MetaserverPlayerInfo> &playerChanges)
 {
-	std::vector<MetaserverPlayerInfo> sortedPlayers = gMetaserverClient->playersInRoom();
-	std::sort(sortedPlayers.begin(), sortedPlayers.end(), MetaserverPlayerInfo::sort);
-
-	m_playersInRoomWidget->SetItems(sortedPlayers);
-	UpdatePlayerButtons();
+	m_playersChanged = true;
 	GlobalMetaserverChatNotificationAdapter::playersInRoomChanged(playerChanges);
 
 }
 
 void MetaserverClientUi::gamesInRoomChanged(const std::vector<GameListMessage::GameListEntry> &gameChanges)
 {
-	std::vector<GameListMessage::GameListEntry> sortedGames = gMetaserverClient->gamesInRoom();
-	std::sort(sortedGames.begin(), sortedGames.end(), GameListMessage::GameListEntry::sort);
-	m_gamesInRoomWidget->SetItems(sortedGames);
-	UpdateGameButtons();
+	m_gamesChanged = true;
 	GlobalMetaserverChatNotificationAdapter::gamesInRoomChanged(gameChanges);
 	for (size_t i = 0; i < gameChanges.size(); i++) 
 	{
@@ -461,6 +457,36 @@ void MetaserverClientUi::gamesInRoomChanged(const std::vector<GameListMessage::G
 	}
 }
 
+void MetaserverClientUi::RefreshLists(bool force)
+{
+	if (!m_playersChanged && !m_gamesChanged)
+		return;
+
+	Uint32 ticks = SDL_GetTicks();
+	if (!force && ticks - m_lastListRefresh < kListRefreshInterval)
+		return;
+	m_lastListRefresh = ticks;
+
+	if (m_playersChanged)
+	{
+		std::vector<MetaserverPlayerInfo> sortedPlayers = gMetaserverClient->playersInRoom();
+		std::sort(sortedPlayers.begin(), sortedPlayers.end(), MetaserverPlayerInfo::sort);
+
+		m_playersInRoomWidget->SetItems(sortedPlayers);
+		UpdatePlayerButtons();
+		m_playersChanged = false;
+	}
+
+	if (m_gamesChanged)
+	{
+		std::vector<GameListMessage::GameListEntry> sortedGames = gMetaserverClient->gamesInRoom();
+		std::sort(sortedGames.begin(), sortedGames.end(), GameListMessage::GameListEntry::sort);
+		m_gamesInRoomWidget->SetItems(sortedGames);
+		UpdateGameButtons();
+		m_gamesChanged = false;
+	}
+}
+
 void MetaserverClientUi::sendChat()
 {
 	string message = m_chatEntryWidget->get_text();
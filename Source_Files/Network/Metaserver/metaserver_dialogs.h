@@ -75,7 +75,7 @@ public:
 	virtual ~MetaserverClientUi () {};
 
 protected:
-	MetaserverClientUi() : m_used (false), m_lastGameSelected(0) {}
+	MetaserverClientUi() : m_used (false), m_lastGameSelected(0), m_playersChanged(false), m_gamesChanged(false), m_lastListRefresh(0) {}
 
 	void delete_widgets ();
 
@@ -90,6 +90,9 @@ protected:
 	virtual void InfoClicked() { };
 	void playersInRoomChanged(const std::vector<MetaserverPlayerInfo> &playerChanges);
 	void gamesInRoomChanged(const std::vector<GameListMessage::GameListEntry> &gamesChanges);
+	// Lists that changed since the last call are redrawn, at most a few
+	// times a second unless forced, however many updates came in between
+	void RefreshLists(bool force = false);
 	void sendChat();
 	void ChatTextEntered (char character);
 	void handleCancel();
@@ -110,6 +113,10 @@ protected:
 
 	Uint32 m_lastGameSelected;
 	bool m_stay_selected; // doesn't deselect after PM
+
+	bool m_playersChanged;
+	bool m_gamesChanged;
+	Uint32 m_lastListRefresh;
 };
 
 #endif // METASERVER_DIALOGS_H
@@ -42,10 +42,19 @@ public:
 	virtual void	PacketHandler(DDPPacketBuffer* inPacket) = 0;
 	virtual		~NetworkGameProtocol() {}
 
-	// action flags we can use for prediction, but aren't authoritative yet
+	// action flags we can use for prediction, but aren't authoritative yet.
+	// update_world() runs the players ahead on these (the others' held at
+	// their last real flags) from a snapshot of the world, and puts the
+	// snapshot back before the next real tick; so a protocol that hands out
+	// its own flags here as soon as they're made gets rollback for free.
+	// Only player movement is predicted: running whole ticks ahead would
+	// need Lua, sounds and the path cache put back too.
 	virtual int32   GetUnconfirmedActionFlagsCount() = 0;
 	virtual uint32  PeekUnconfirmedActionFlag(int32 offset) = 0;
 	virtual void    UpdateUnconfirmedActionFlags() = 0;
+
+	// checksums of the world after inTick, for protocols that check sync
+	virtual void	ReportWorldChecksums(int32 inTick, const uint32* inChecksums, size_t inCount) {}
 	
 };
 
@@ -87,7 +87,9 @@
 // of the HAVE message ought to match that of the FIND message.  service_name of the HAVE message gives the name of
 // a service instance on the host.
 // In Aleph One, the service_name would be the name of the player.
-// A host is allowed to broadcast a HAVE message (once) when a service becomes available, to speed things up a little.
+// A host is allowed to broadcast a HAVE message when a service becomes available, to speed things up a little, and
+// to repeat it now and then while the service is available (no more often than FINDs would go out), so that hosts
+// already looking need not wait for their next FIND.  Lost HAVEs are no worse than lost FIND responses.
 // A host may unicast an unsolicited HAVE message if it thinks a host is looking for its service (e.g. if the host
 // was looking for the service a while ago, or a user "hints" the system that a named host probably wants to find
 // our service).  Heck, if the user bothered to hint us an address, it probably means the broadcast FIND messages
@@ -66,6 +66,13 @@
 // found service instances expire after not hearing from them for this many milliseconds
 #define SSLPINT_INSTANCE_TIMEOUT 20000
 
+// FINDs (while locating) and unsolicited HAVEs (while responding) go out as soon as we start, twice more
+// soon after in case one was lost, then every this many milliseconds.  Announcing ourselves keeps those
+// already locating from having to wait for their next FIND.
+#define SSLPINT_BROADCAST_PERIOD 5000
+static const Uint32 sBroadcastDelays[] = { 0, 250, 1000 };
+#define SSLPINT_QUICK_BROADCAST_COUNT (int)(sizeof(sBroadcastDelays) / sizeof(sBroadcastDelays[0]))
+
 
 
 
@@ -95,6 +102,8 @@ static SSLP_Service_Instance_Status_Changed_Callback	sFoundCallback = NULL;
 static SSLP_Service_Instance_Status_Changed_Callback	sLostCallback = NULL;
 static SSLP_Service_Instance_Status_Changed_Callback	sNameChangedCallback = NULL;
 static struct 	SSLPint_FoundInstance*			sFoundInstances = NULL;
+static Uint32						sLocatingStartTime = 0;
+static int						sFindsSent = 0;
 
 
 ////////// for services that may be discovered
@@ -104,6 +113,8 @@ static UDPpacket*					sHintPacket = NULL;		// sHintPacket->data does not change
 // the service_type in this packet to see if a response is warranted.
 // (the service_type in this packet is copied from the instance passed in to Allow_Service_Discovery().)
 static UDPpacket*					sResponsePacket = NULL;	// sResponsePacket->data does not change
+static Uint32						sRespondingStartTime = 0;
+static int						sAnnouncementsSent = 0;
 
 
 // Packing and unpacking:
@@ -141,6 +152,16 @@ template<class T> void PacketCopyOutList(unsigned char* &Ptr, T *List, int Count
 
 
 // FILE-LOCAL (STATIC) FUNCTIONS
+// milliseconds after starting that the broadcast numbered inCount should go out
+static Uint32
+SSLPint_BroadcastTime(int inCount) {
+    if(inCount < SSLPINT_QUICK_BROADCAST_COUNT)
+        return sBroadcastDelays[inCount];
+    else
+        return sBroadcastDelays[SSLPINT_QUICK_BROADCAST_COUNT - 1] + (inCount - SSLPINT_QUICK_BROADCAST_COUNT + 1) * SSLPINT_BROADCAST_PERIOD;
+}
+
+
 // returns a pointer if the instance was "new" - i.e. if we didn't have a record of it.
 // caller should notify anyone interested that a new instance was found (and should refer to it by the returned pointer).
 // if we already knew about the instance, returns NULL.  in any case, the caller may discard
@@ -559,8 +580,11 @@ SSLP_Locate_Service_Instances(const char* inServiceType, SSLP_Service_Instance_S
 	// Hmm, maybe memset is more widely available than bzero.
 	memset(theFindPacket->sslpp_service_name, 0, SSLP_MAX_NAME_LENGTH);
 	
-    // Allow receiving code to process incoming HAVE messages, and allow "find" broadcaster to broadcast.
+    // Allow receiving code to process incoming HAVE messages, and allow "find" broadcaster to broadcast
+    // (the first FIND goes out with the next SSLP_Pump()).
     sBehaviorsDesired		|= SSLPINT_LOCATING;
+    sLocatingStartTime		= SDL_GetTicks();
+    sFindsSent			= 0;
     
     // Load into the "real" packet
     PackPacket(sFindPacket->data,theFindPacket);
@@ -632,8 +656,10 @@ SSLP_Allow_Service_Discovery(const struct SSLP_ServiceInstance* inServiceInstanc
     // Load into the "real" packet
     PackPacket(sResponsePacket->data,theResponsePacket);
     
-    // Broadcast the HAVE once to speed things up, maybe
+    // Broadcast the HAVE once to speed things up; SSLP_Pump() repeats it
     SDLNetx_UDP_Broadcast(sSocketDescriptor, sResponsePacket);
+    sRespondingStartTime	= SDL_GetTicks();
+    sAnnouncementsSent		= 1;
     
     // Allow receiving code to respond to incoming FIND messages
     sBehaviorsDesired		|= SSLPINT_RESPONDING;
@@ -686,6 +712,9 @@ SSLP_Hint_Service_Discovery(const struct SSLP_ServiceInstance* inServiceInstance
     
     // Load into the "real" packet
     PackPacket(sHintPacket->data,theHintPacket);
+
+    // Send it once now; SSLP_Pump() repeats it along with our broadcasts
+    SDLNet_UDP_Send(sSocketDescriptor, -1, sHintPacket);
 }
 
 
@@ -755,26 +784,28 @@ SSLP_Pump() {
         
     logContext("pumping SSLP protocol activity");
     
-    static Uint32	theTimeLastWorked = 0;
-    
     Uint32		theCurrentTime = SDL_GetTicks();
     
-    if(sBehaviorsDesired & (SSLPINT_LOCATING | SSLPINT_HINTING)) {
+    // Do broadcasting work when it's due
+    if(sBehaviorsDesired & SSLPINT_LOCATING) {
+        if(theCurrentTime - sLocatingStartTime >= SSLPint_BroadcastTime(sFindsSent)) {
+            SDLNetx_UDP_Broadcast(sSocketDescriptor, sFindPacket);
+            SSLPint_RemoveTimedOutInstances();
+            sFindsSent++;
+        }
+    }
 
-        // Do some work only once every five seconds
-        if(theCurrentTime - theTimeLastWorked >= 5000) {
+    if(sBehaviorsDesired & SSLPINT_RESPONDING) {
+        if(theCurrentTime - sRespondingStartTime >= SSLPint_BroadcastTime(sAnnouncementsSent)) {
+            // (responses to FINDs leave the requester's address in the packet)
+            sResponsePacket->address.port = SDL_SwapBE16(SSLP_PORT);
+            SDLNetx_UDP_Broadcast(sSocketDescriptor, sResponsePacket);
 
-            // Do broadcasting work
-            if(sBehaviorsDesired & SSLPINT_LOCATING) {
-                SDLNetx_UDP_Broadcast(sSocketDescriptor, sFindPacket);
-                SSLPint_RemoveTimedOutInstances();
-            }
-            
             // Do hinting work
             if(sBehaviorsDesired & SSLPINT_HINTING)
                 SDLNet_UDP_Send(sSocketDescriptor, -1, sHintPacket);
 
-            theTimeLastWorked = theCurrentTime;
+            sAnnouncementsSent++;
         }
     }
     
@@ -24,6 +24,10 @@
  *
  *  May 27, 2003 (Woody Zenfell):
  *	Support for lossy streaming data distribution.
+ *
+ *  Oct 14, 2026:
+ *	Gatherer leaves hosting to a standalone hub when its topology entry names one.
+ *	World checksums go to the hub so it can tell when spokes fall out of sync.
  */
 
 #if !defined(DISABLE_NETWORKING)
@@ -125,7 +129,10 @@ StarGameProtocol::Sync(NetTopology* inTopology, int32 inSmallestGameTick, size_t
                 theConnectedPlayerStatus[i] = ((sTopology->players[i].identifier != NONE) && !sTopology->players[i].net_dead);
         }
 
-        if(inLocalPlayerIndex == inServerPlayerIndex)
+	// Our own entry only names another host when we are handing the game to a standalone hub
+	bool theGameIsOnStandaloneHub = (inLocalPlayerIndex == inServerPlayerIndex && sTopology->players[inServerPlayerIndex].ddpAddress.host != kNetLocalHostPlaceholder);
+
+        if(inLocalPlayerIndex == inServerPlayerIndex && !theGameIsOnStandaloneHub)
         {
 		sHubIsLocal = true;
 		
@@ -139,8 +146,11 @@ StarGameProtocol::Sync(NetTopology* inTopology, int32 inSmallestGameTick, size_t
 	else
 		sHubIsLocal = false;
 
+        if(theGameIsOnStandaloneHub)
+                spoke_announce_game_to_hub(inSmallestGameTick, sTopology->player_count, theConnectedPlayerStatus);
+
         spoke_initialize(sTopology->players[inServerPlayerIndex].ddpAddress, inSmallestGameTick, sTopology->player_count,
-                         sStarQueues, theConnectedPlayerStatus, inLocalPlayerIndex, sHubIsLocal);
+                         sStarQueues, theConnectedPlayerStatus, inLocalPlayerIndex, sHubIsLocal, NetStarCompressedFlagsOffered());
 
         *sNetStatePtr = netActive;
 
@@ -205,6 +215,12 @@ StarGameProtocol::UpdateUnconfirmedActionFlags()
 	}
 }
 
+void
+StarGameProtocol::ReportWorldChecksums(int32 inTick, const uint32* inChecksums, size_t inCount)
+{
+	spoke_report_world_checksums(inTick, inChecksums, inCount);
+}
+
 /* ZZZ addition:
 ---------------------------
 	make_player_really_net_dead
@@ -237,9 +253,9 @@ call_distribution_response_function_if_available(byte* inBuffer, uint16 inBuffer
 void
 StarGameProtocol::ParsePreferencesTree(InfoTree prefs, std::string version)
 {
-	BOOST_FOREACH(InfoTree child, prefs.children_named("hub"))
+	BOOST_FOREACH(const InfoTree &child, prefs.children_named("hub"))
 		HubParsePreferencesTree(child, version);
-	BOOST_FOREACH(InfoTree child, prefs.children_named("spoke"))
+	BOOST_FOREACH(const InfoTree &child, prefs.children_named("spoke"))
 		SpokeParsePreferencesTree(child, version);
 }
 
@@ -49,6 +49,8 @@ public:
 	int32   GetUnconfirmedActionFlagsCount();
 	uint32  PeekUnconfirmedActionFlag(int32 offset);
 	void    UpdateUnconfirmedActionFlags();
+
+	void	ReportWorldChecksums(int32 inTick, const uint32* inChecksums, size_t inCount);
 };
 
 extern void DefaultStarPreferences();
@@ -0,0 +1,397 @@
+/*
+ *  hub_main.cpp
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+ *  alephone-hub: runs the star protocol's hub for many games at once, with no
+ *  renderer, sound, input or game world.  Built with A1_NETWORK_STANDALONE_HUB.
+ *
+ *  A gatherer whose hub_address preference names us announces its game with a
+ *  kGathererToHubSetupPacket; we host that game until every player has left,
+ *  alongside any others under way.  Games are told apart by their players'
+ *  addresses, so a new game is only set up once every player of the last one
+ *  to start has been heard from.
+ *  With --stats-log, each game's network histograms are written out every second.
+ *  With --relay, we host nothing and pass the games of the hub named on to spectators
+ *  instead (see network_star_relay.cpp).
+ *  With --emulate, what arrives is delayed, shuffled and lost as on a poor connection
+ *  (see network_conditions.h); with --netbench, we host one game for simulated spokes
+ *  of our own and report how it went (see network_benchmark.h).
+ */
+
+#include "cseries.h"
+
+#include "network_star.h"
+#include "network_private.h"
+#include "network_conditions.h"
+#include "network_benchmark.h"
+#include "mytm.h"
+#include "AStream.h"
+#include "Logging.h"
+#include "crc.h"
+
+#include "SDL_net.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+extern void hub_set_minimum_send_period(int32 new_minimum);
+
+static volatile sig_atomic_t sQuitRequested = 0;
+
+// Filled in by the packet handler (with the mytm mutex held), taken by the main loop
+static bool sSetupPending = false;
+static int32 sSetupFirstTick;
+static uint16 sSetupNumberOfPlayers;
+static uint32 sSetupConnectedPlayers;
+
+static bool sRelaying = false;
+
+static FILE* sStatsLog = NULL;
+static bool sStatsLogNeedsHeader = true;
+
+
+// Assertions don't get a dialog here
+void _alephone_assert(const char *file, int32 line, const char *what)
+{
+	fprintf(stderr, "%s:%d: %s\n", file, line, what);
+	logFatal("%s:%d: %s", file, line, what);
+	GetCurrentLogger()->flush();
+	abort();
+}
+
+void _alephone_warn(const char *file, int32 line, const char *what)
+{
+	logWarning("%s:%d: %s", file, line, what);
+}
+
+
+static void
+received_setup_packet(DDPPacketBufferPtr inPacket)
+{
+	// The hub packet handler blanks the CRC in place; check ours the same way
+	uint16 thePacketCRC = (inPacket->datagramData[2] << 8) | inPacket->datagramData[3];
+	inPacket->datagramData[2] = 0;
+	inPacket->datagramData[3] = 0;
+	if(thePacketCRC != calculate_data_crc_ccitt(inPacket->datagramData, inPacket->datagramSize))
+		return;
+
+	AIStreamBE ps(inPacket->datagramData, inPacket->datagramSize, kStarPacketHeaderSize);
+
+	int32 theFirstTick;
+	uint16 theNumberOfPlayers;
+	uint32 theConnectedPlayers;
+	ps >> theFirstTick >> theNumberOfPlayers >> theConnectedPlayers;
+
+	if(theNumberOfPlayers < 1 || theNumberOfPlayers > MAXIMUM_NUMBER_OF_NETWORK_PLAYERS)
+		return;
+
+	theConnectedPlayers &= (theNumberOfPlayers < 32) ? ((((uint32)1) << theNumberOfPlayers) - 1) : 0xffffffff;
+	if(theConnectedPlayers == 0)
+		return;
+
+	// The gatherer repeats itself until the game is under way; a game's players
+	// have to be told from the next one's before that one can start
+	if(sSetupPending || hub_is_waiting_for_players() || hub_is_player_address(inPacket->sourceAddress))
+		return;
+
+	sSetupFirstTick = theFirstTick;
+	sSetupNumberOfPlayers = theNumberOfPlayers;
+	sSetupConnectedPlayers = theConnectedPlayers;
+	sSetupPending = true;
+}
+
+
+static void
+hub_packet_handler(DDPPacketBufferPtr inPacket)
+{
+	if(inPacket->datagramSize < kStarPacketHeaderSize)
+		return;
+
+	uint16 thePacketMagic = (inPacket->datagramData[0] << 8) | inPacket->datagramData[1];
+
+	try {
+		if(sRelaying)
+			relay_received_network_packet(inPacket);
+		else if(thePacketMagic == kGathererToHubSetupPacket)
+			received_setup_packet(inPacket);
+		else
+			hub_received_network_packet(inPacket);
+	}
+	catch (...)
+	{
+		// malformed packet; drop it
+	}
+}
+
+
+static void
+start_game()
+{
+	int32 theFirstTick;
+	size_t theNumberOfPlayers;
+	uint32 theConnectedPlayers;
+	{
+		MyTMMutexTaker mutex;
+		theFirstTick = sSetupFirstTick;
+		theNumberOfPlayers = sSetupNumberOfPlayers;
+		theConnectedPlayers = sSetupConnectedPlayers;
+		sSetupPending = false;
+	}
+
+	// hub_initialize() only looks at whether an address is there; the real ones
+	// arrive with each spoke's identification packet.
+	NetAddrBlock thePlaceholderAddress;
+	obj_clear(thePlaceholderAddress);
+	const NetAddrBlock* theAddresses[MAXIMUM_NUMBER_OF_NETWORK_PLAYERS];
+	size_t theReferencePlayer = theNumberOfPlayers;
+	for(size_t i = 0; i < theNumberOfPlayers; i++)
+	{
+		bool connected = (theConnectedPlayers & (((uint32)1) << i)) != 0;
+		theAddresses[i] = connected ? &thePlaceholderAddress : NULL;
+		if(connected && theReferencePlayer == theNumberOfPlayers)
+			theReferencePlayer = i;
+	}
+
+	logNote("starting a %d-player game at tick %d", (int)theNumberOfPlayers, theFirstTick);
+	hub_initialize(theFirstTick, theNumberOfPlayers, theAddresses, theReferencePlayer);
+}
+
+
+static void
+finish_game(size_t inGame)
+{
+	hub_cleanup_game(inGame);
+	logNote("game over");
+	GetCurrentLogger()->flush();
+
+	MyTMMutexTaker mutex;
+	// a setup that raced in with the end of a game may belong to that game; a new
+	// one's gatherer will send again
+	sSetupPending = false;
+}
+
+
+static void
+request_quit(int)
+{
+	sQuitRequested = 1;
+}
+
+
+static void
+usage(const char *name)
+{
+	printf("Usage: %s [--port <port>] [--latency-tolerance <ticks>] [--stats-log <file>] [--relay <host[:port]>]\n"
+	       "\t[--emulate <spec>] [--netbench <spec>]\n"
+	       "\t[--port <port>]               UDP port to listen on (default %d)\n"
+	       "\t[--latency-tolerance <ticks>] Hub latency tolerance (see <hub> preferences)\n"
+	       "\t[--stats-log <file>]          Append each player's network histograms (CSV) every second\n"
+	       "\t[--relay <host[:port]>]       Relay the games of the hub (or relay) there to spectators\n"
+	       "\t[--emulate <spec>]            Treat what arrives as a poor connection would, e.g.\n"
+	       "\t                              \"delay=60,jitter=20,loss=2,reorder=1\" (ms, ms, %%, %%)\n"
+	       "\t[--netbench <spec>]           Play one game with simulated spokes here, under those\n"
+	       "\t                              conditions each way, and report; e.g. \"players=8,ticks=1800,\n"
+	       "\t                              delay=60\" (or \"default\")\n",
+	       name, DEFAULT_GAME_PORT);
+}
+
+
+int main(int argc, char **argv)
+{
+	uint16 port = DEFAULT_GAME_PORT;
+	const char *relayTarget = NULL;
+	NetworkConditions theConditions;
+	network_benchmark_parameters theBenchmark;
+	bool benchmarking = false;
+
+	DefaultHubPreferences();
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--port") == 0 && i + 1 < argc)
+			port = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--latency-tolerance") == 0 && i + 1 < argc)
+			hub_set_minimum_send_period(atoi(argv[++i]));
+		else if(strcmp(argv[i], "--relay") == 0 && i + 1 < argc)
+			relayTarget = argv[++i];
+		else if(strcmp(argv[i], "--emulate") == 0 && i + 1 < argc)
+		{
+			if(!theConditions.parse(argv[++i]))
+			{
+				fprintf(stderr, "Couldn't read conditions %s\n", argv[i]);
+				return 1;
+			}
+		}
+		else if(strcmp(argv[i], "--netbench") == 0 && i + 1 < argc)
+		{
+			if(!parse_network_benchmark_parameters(argv[++i], theBenchmark))
+			{
+				fprintf(stderr, "Couldn't read benchmark %s\n", argv[i]);
+				return 1;
+			}
+			benchmarking = true;
+		}
+		else if(strcmp(argv[i], "--stats-log") == 0 && i + 1 < argc)
+		{
+			sStatsLog = fopen(argv[++i], "a");
+			if(!sStatsLog)
+			{
+				fprintf(stderr, "Couldn't open %s\n", argv[i]);
+				return 1;
+			}
+		}
+		else
+		{
+			usage(argv[0]);
+			return (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) ? 0 : 1;
+		}
+	}
+
+	if(port == 0 || (benchmarking && relayTarget))
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	if(SDL_Init(0) < 0)
+	{
+		fprintf(stderr, "Couldn't initialize SDL (%s)\n", SDL_GetError());
+		return 1;
+	}
+	if(SDLNet_Init() < 0)
+	{
+		fprintf(stderr, "Couldn't initialize SDL_net (%s)\n", SDLNet_GetError());
+		SDL_Quit();
+		return 1;
+	}
+	mytm_initialize();
+
+	NetAddrBlock theUpstreamAddress;
+	if(relayTarget)
+	{
+		std::string theHost = relayTarget;
+		uint16 theUpstreamPort = DEFAULT_GAME_PORT;
+		std::string::size_type theColon = theHost.rfind(':');
+		if(theColon != std::string::npos)
+		{
+			theUpstreamPort = atoi(theHost.c_str() + theColon + 1);
+			theHost.erase(theColon);
+		}
+		if(SDLNet_ResolveHost(&theUpstreamAddress, theHost.c_str(), theUpstreamPort) != 0)
+		{
+			fprintf(stderr, "Couldn't resolve %s\n", relayTarget);
+			SDLNet_Quit();
+			SDL_Quit();
+			return 1;
+		}
+	}
+
+	// the benchmark's conditions apply on the way in to both ends
+	if(benchmarking)
+		theConditions = theBenchmark.conditions;
+	NetDDPSetConditions(theConditions);
+
+	short theSocket = SDL_SwapBE16(port);
+	if(NetDDPOpen() != 0 || NetDDPOpenSocket(&theSocket, hub_packet_handler) != 0)
+	{
+		fprintf(stderr, "Couldn't open UDP port %d\n", port);
+		SDLNet_Quit();
+		SDL_Quit();
+		return 1;
+	}
+
+	if(benchmarking)
+	{
+		bool ran = run_network_benchmark(theBenchmark, port);
+		if(!ran)
+			fprintf(stderr, "Couldn't open the simulated spokes' sockets\n");
+
+		NetDDPCloseSocket(theSocket);
+		NetDDPClose();
+		SDLNet_Quit();
+		SDL_Quit();
+		return ran ? 0 : 1;
+	}
+
+	signal(SIGINT, request_quit);
+	signal(SIGTERM, request_quit);
+
+	if(relayTarget)
+	{
+		relay_initialize(theUpstreamAddress);
+		sRelaying = true;
+		logNote("relaying %s on port %d", relayTarget, port);
+		printf("relaying %s on port %d\n", relayTarget, port);
+	}
+	else
+	{
+		logNote("hub listening on port %d", port);
+		printf("hub listening on port %d\n", port);
+	}
+
+	uint32 theLastStatsTime = SDL_GetTicks();
+	while(!sQuitRequested)
+	{
+		SDL_Delay(50);
+
+		if(sStatsLog && SDL_GetTicks() - theLastStatsTime >= 1000)
+		{
+			theLastStatsTime = SDL_GetTicks();
+			MyTMMutexTaker mutex;
+			if(hub_game_count() > 0)
+			{
+				hub_write_histograms(sStatsLog, theLastStatsTime / 1000, sStatsLogNeedsHeader);
+				sStatsLogNeedsHeader = false;
+			}
+		}
+
+		// only this thread adds or removes games, so the count holds without the mutex
+		for(size_t i = hub_game_count(); i-- > 0; )
+		{
+			bool theGameIsActive;
+			{
+				MyTMMutexTaker mutex;
+				theGameIsActive = hub_game_is_active(i);
+			}
+			if(!theGameIsActive)
+				finish_game(i);
+		}
+
+		if(sSetupPending)
+			start_game();
+	}
+
+	while(hub_game_count() > 0)
+		finish_game(hub_game_count() - 1);
+
+	if(sRelaying)
+		relay_cleanup();
+
+	if(sStatsLog)
+		fclose(sStatsLog);
+
+	NetDDPCloseSocket(theSocket);
+	NetDDPClose();
+	SDLNet_Quit();
+	SDL_Quit();
+
+	return 0;
+}
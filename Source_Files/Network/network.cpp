@@ -94,6 +94,14 @@ July 03, 2003 (jkvw):
 September 17, 2004 (jkvw):
 	NAT-friendly networking.  That is, joiners behind firewalls should be able to play.
 	Also moved to TCPMess for TCP communications.
+
+Oct 14, 2026:
+	Star games can be hosted on a standalone hub (alephone-hub); the gatherer puts the hub's
+	address in its topology entry, and joiners keep it instead of the address they saw.
+	Map, physics and Lua stream to joiners in chunks that they inflate as they arrive;
+	joiners that already have the map say so, and aren't sent it.
+	Where the hub runs, "netstats" shows each player's network histograms, and
+	"netstats log <file>" writes them out every second.
 */
 
 #if defined(DISABLE_NETWORKING)
@@ -159,7 +167,7 @@ clearly this is all broken until we have packet types
 
 #include "lua_script.h"
 
-#include "libnat.h"
+#include "port_mapping.h"
 
 #include <boost/bind.hpp>
 
@@ -168,6 +176,7 @@ clearly this is all broken until we have packet types
 #include "network_sound.h"
 
 #include "ConnectPool.h"
+#include "FileHandler.h"
 
 /* ---------- globals */
 
@@ -191,9 +200,21 @@ static CommunicationsChannelFactory *server = NULL;
 
 typedef std::map<int, Client *> client_map_t;
 static client_map_t connections_to_clients;
+
+// Moves data on every joiner's channel at once, waiting up to inTimeout ms for some
+static void NetPumpClients(Uint32 inTimeout)
+{
+	std::vector<CommunicationsChannel*> channels;
+	channels.reserve(connections_to_clients.size());
+	for (client_map_t::iterator it = connections_to_clients.begin(); it != connections_to_clients.end(); ++it)
+		channels.push_back(it->second->channel);
+	CommunicationsChannel::multiplePump(channels, inTimeout);
+}
 typedef std::map<int, ClientChatInfo *> client_chat_info_map_t;
 static client_chat_info_map_t client_chat_info;
 static CommunicationsChannel *connection_to_server = NULL;
+static bool sGathererHasStarCompressedFlags = false;
+static bool sGathererHasStreamedGameData = false;
 static NonblockingConnect *server_nbc = 0;
 static bool nbc_is_resolving = false;
 static int next_stream_id = 1; // 0 is local player
@@ -207,13 +228,16 @@ static Capabilities my_capabilities;
 static GatherCallbacks *gatherCallbacks = NULL;
 static ChatCallbacks *chatCallbacks = NULL;
 
-static UpnpController *controller = NULL;
 extern MetaserverClient* gMetaserverClient;
 
 static std::vector<NetworkStats> sNetworkStats;
 const static NetworkStats sInvalidStats = {
 	NetworkStats::invalid,
 	NetworkStats::invalid,
+	0,
+	NetworkStats::invalid,
+	NetworkStats::invalid,
+	0,
 	0
 };
 uint32 last_network_stats_send = 0;
@@ -280,6 +304,41 @@ struct ignore_mic
 	}
 };
 
+static void NetShowHistograms();
+static bool NetStartHistogramsLog(const std::string& path);
+static void NetStopHistogramsLog();
+
+struct netstats_show
+{
+	void operator()(const std::string&) const {
+		NetShowHistograms();
+	}
+};
+
+struct netstats_log
+{
+	void operator()(const std::string& arg) const {
+		if (arg == "")
+		{
+			NetStopHistogramsLog();
+			screen_printf("Network histograms log closed");
+			return;
+		}
+
+		std::string filename = arg;
+		if (filename.find('.') == std::string::npos)
+			filename += ".csv";
+
+		FileSpecifier fs;
+		fs.SetToLocalDataDir();
+		fs += filename;
+		if (NetStartHistogramsLog(fs.GetPath()))
+			screen_printf("Writing network histograms to %s", utf8_to_mac_roman(fs.GetPath()).c_str());
+		else
+			screen_printf("Could not open %s", utf8_to_mac_roman(fs.GetPath()).c_str());
+	}
+};
+
 // ZZZ note: very few folks touch the streaming data, so the data-format issues outlined above with
 // datagrams (the data from which are passed around, interpreted, and touched by many functions)
 // don't matter as much.  Do observe, though, that users of the "distribution" mechanism will have
@@ -317,6 +376,7 @@ void NetInitializeSessionIdentifier(void);
 // For now, the only effect I see is a reduction in type-safety.  :)
 static void NetInitializeTopology(void *game_data, short game_data_size, void *player_data, short player_data_size);
 static void NetLocalAddrBlock(NetAddrBlock *address, short socketNumber);
+static bool NetResolveHubAddress(const char *host_and_port, NetAddrBlock& address);
 
 static int net_compare(void const *p1, void const *p2);
 
@@ -348,7 +408,7 @@ Client::~Client() {
 
 CheckPlayerProcPtr Client::check_player = 0;
 
-Client::Client(CommunicationsChannel *inChannel) : channel(inChannel), state(_connecting), network_version(0), mDispatcher(new MessageDispatcher())
+Client::Client(CommunicationsChannel *inChannel) : channel(inChannel), state(_connecting), network_version(0), has_map_checksum(false), map_checksum(0), mDispatcher(new MessageDispatcher())
 {
 	std::fill_n(name, MAX_NET_PLAYER_NAME_LENGTH, '\0');
 	mJoinerInfoMessageHandler.reset(newMessageHandlerMethod(this, &Client::handleJoinerInfoMessage));
@@ -356,6 +416,7 @@ Client::Client(CommunicationsChannel *inChannel) : channel(inChannel), state(_co
 	mAcceptJoinMessageHandler.reset(newMessageHandlerMethod(this, &Client::handleAcceptJoinMessage));
 	mChatMessageHandler.reset(newMessageHandlerMethod(this, &Client::handleChatMessage));
 	mChangeColorsMessageHandler.reset(newMessageHandlerMethod(this, &Client::handleChangeColorsMessage));
+	mMapChecksumMessageHandler.reset(newMessageHandlerMethod(this, &Client::handleMapChecksumMessage));
 	mUnexpectedMessageHandler.reset(newMessageHandlerMethod(this, &Client::unexpectedMessageHandler));
 	mDispatcher->setDefaultHandler(mUnexpectedMessageHandler.get());
 	mDispatcher->setHandlerForType(mJoinerInfoMessageHandler.get(), JoinerInfoMessage::kType);
@@ -363,6 +424,7 @@ Client::Client(CommunicationsChannel *inChannel) : channel(inChannel), state(_co
 	mDispatcher->setHandlerForType(mAcceptJoinMessageHandler.get(), AcceptJoinMessage::kType);
 	mDispatcher->setHandlerForType(mChatMessageHandler.get(), NetworkChatMessage::kType);
 	mDispatcher->setHandlerForType(mChangeColorsMessageHandler.get(), ChangeColorsMessage::kType);
+	mDispatcher->setHandlerForType(mMapChecksumMessageHandler.get(), MapChecksumMessage::kType);
 	channel->setMessageHandler(mDispatcher.get());
 }
 
@@ -499,6 +561,19 @@ bool Client::capabilities_indicate_player_is_gatherable(bool warn_joiner)
 		}
 	}
 
+	if (network_preferences->game_protocol == _network_game_protocol_star && network_preferences->hub_address[0])
+	{
+		if (capabilities[Capabilities::kStandaloneHub] < Capabilities::kStandaloneHubVersion)
+		{
+			if (warn_joiner)
+			{
+				ServerWarningMessage serverWarningMessage(expand_app_variables("The gatherer is hosting on a standalone hub, which this version of $appName$ cannot reach. You will not appear in the list of available players."), ServerWarningMessage::kJoinerUngatherable);
+				channel->enqueueOutgoingMessage(serverWarningMessage);
+			}
+			return false;
+		}
+	}
+
 	if (topology->game_data.net_game_type == _game_of_rugby)
 	{
 		if (capabilities[Capabilities::kRugby] == 0)
@@ -682,6 +757,17 @@ void Client::handleChangeColorsMessage(ChangeColorsMessage *changeColorsMessage,
 	}
 }
 
+void Client::handleMapChecksumMessage(MapChecksumMessage *mapChecksumMessage,
+				      CommunicationsChannel *)
+{
+	if (state == _awaiting_map || state == _ingame) {
+		map_checksum = mapChecksumMessage->value();
+		has_map_checksum = true;
+	} else {
+		logAnomaly("unexpected map checksum message received (state is %i)", state);
+	}
+}
+
 void Client::handleChatMessage(NetworkChatMessage* netChatMessage, 
 			       CommunicationsChannel *)
 {
@@ -771,6 +857,8 @@ static void handleCapabilitiesMessage(CapabilitiesMessage* capabilitiesMessage,
 {
 	if (handlerState == netJoining) {
 		Capabilities capabilities = *capabilitiesMessage->capabilities();
+		sGathererHasStarCompressedFlags = (capabilities[Capabilities::kStarCompressedFlags] >= Capabilities::kStarCompressedFlagsVersion);
+		sGathererHasStreamedGameData = (capabilities[Capabilities::kStreamedGameData] >= Capabilities::kStreamedGameDataVersion);
 		if (capabilities[Capabilities::kGameworld] < Capabilities::kGameworldVersion || (shapes_file_is_m1() && capabilities[Capabilities::kGameworldM1] < Capabilities::kGameworldM1Version) || (network_preferences->game_protocol == _network_game_protocol_star && capabilities[Capabilities::kStar] < Capabilities::kStarVersion))
 		{
 			// I'm not gatherable
@@ -941,6 +1029,69 @@ static void handlePhysicsMessage(BigChunkOfDataMessage *physicsMessage, Communic
 	}
 }
 
+// Streamed game data; each kind goes where its whole-message handler would put it
+static ZippedDataUnchunker handlerLuaChunks;
+static ZippedDataUnchunker handlerMapChunks;
+static ZippedDataUnchunker handlerPhysicsChunks;
+
+// true when the chunk completes its stream
+static bool addGameDataChunk(ZippedDataUnchunker& chunks, BigChunkOfDataMessage *chunkMessage, const char *what)
+{
+	if (netState != netStartingUp && netState != netDown) {
+		logAnomaly("unexpected %s chunk message received (netState is %i)", what, netState);
+		return false;
+	}
+
+	if (!chunks.add(*chunkMessage)) {
+		logWarning("error in streamed %s; discarding it", what);
+		return false;
+	}
+
+	return chunks.done();
+}
+
+static void handleLuaChunkMessage(BigChunkOfDataMessage *luaChunkMessage, CommunicationsChannel *) {
+	if (addGameDataChunk(handlerLuaChunks, luaChunkMessage, "lua")) {
+		if (handlerLuaBuffer) {
+			delete[] handlerLuaBuffer;
+			handlerLuaBuffer = NULL;
+		}
+		handlerLuaLength = handlerLuaChunks.length();
+		byte *buffer = handlerLuaChunks.release();
+		if (handlerLuaLength > 0) {
+			handlerLuaBuffer = new byte[handlerLuaLength];
+			memcpy(handlerLuaBuffer, buffer, handlerLuaLength);
+		}
+		free(buffer);
+	}
+}
+
+static void handleMapChunkMessage(BigChunkOfDataMessage *mapChunkMessage, CommunicationsChannel *) {
+	bool done = addGameDataChunk(handlerMapChunks, mapChunkMessage, "map");
+	if (handlerMapChunks.length() > 0)
+		draw_progress_bar(handlerMapChunks.received(), handlerMapChunks.length());
+
+	if (done) {
+		if (handlerMapBuffer) {
+			free(handlerMapBuffer);
+			handlerMapBuffer = NULL;
+		}
+		handlerMapLength = handlerMapChunks.length();
+		handlerMapBuffer = handlerMapChunks.release();
+	}
+}
+
+static void handlePhysicsChunkMessage(BigChunkOfDataMessage *physicsChunkMessage, CommunicationsChannel *) {
+	if (addGameDataChunk(handlerPhysicsChunks, physicsChunkMessage, "physics")) {
+		if (handlerPhysicsBuffer) {
+			free(handlerPhysicsBuffer);
+			handlerPhysicsBuffer = NULL;
+		}
+		handlerPhysicsLength = handlerPhysicsChunks.length();
+		handlerPhysicsBuffer = handlerPhysicsChunks.release();
+	}
+}
+
 /*
 static void handleScriptMessage(ScriptMessage* scriptMessage, CommunicationsChannel*) {
   if (netState == netJoining) {
@@ -987,7 +1138,8 @@ static void handleTopologyMessage(TopologyMessage* topologyMessage, Communicatio
       assert(theServerIndex != topology->player_count);
       
       topology->players[theServerIndex].dspAddress= address;
-      topology->players[theServerIndex].ddpAddress.host = address.host;
+      if (topology->players[theServerIndex].ddpAddress.host == kNetLocalHostPlaceholder)
+	      topology->players[theServerIndex].ddpAddress.host = address.host;
       
       NetUpdateTopology();
     
@@ -1052,6 +1204,9 @@ static TypedMessageHandlerFunction<BigChunkOfDataMessage> luaMessageHandler(&han
 static TypedMessageHandlerFunction<BigChunkOfDataMessage> mapMessageHandler(&handleMapMessage);
 static TypedMessageHandlerFunction<NetworkChatMessage> networkChatMessageHandler(&handleNetworkChatMessage);
 static TypedMessageHandlerFunction<BigChunkOfDataMessage> physicsMessageHandler(&handlePhysicsMessage);
+static TypedMessageHandlerFunction<BigChunkOfDataMessage> luaChunkMessageHandler(&handleLuaChunkMessage);
+static TypedMessageHandlerFunction<BigChunkOfDataMessage> mapChunkMessageHandler(&handleMapChunkMessage);
+static TypedMessageHandlerFunction<BigChunkOfDataMessage> physicsChunkMessageHandler(&handlePhysicsChunkMessage);
  static TypedMessageHandlerFunction<CapabilitiesMessage> capabilitiesMessageHandler(&handleCapabilitiesMessage);
 static TypedMessageHandlerFunction<TopologyMessage> topologyMessageHandler(&handleTopologyMessage);
 static TypedMessageHandlerFunction<ServerWarningMessage> serverWarningMessageHandler(&handleServerWarningMessage);
@@ -1197,6 +1352,10 @@ bool NetEnter(void)
 		inflater->learnPrototype(ClientInfoMessage());
 		inflater->learnPrototype(NetworkStatsMessage());
 		inflater->learnPrototype(GameSessionMessage());
+		inflater->learnPrototype(MapChunkMessage());
+		inflater->learnPrototype(PhysicsChunkMessage());
+		inflater->learnPrototype(LuaChunkMessage());
+		inflater->learnPrototype(MapChecksumMessage());
 	}
   
 	if (!joinDispatcher) {
@@ -1218,6 +1377,9 @@ bool NetEnter(void)
 		joinDispatcher->setHandlerForType(&topologyMessageHandler, TopologyMessage::kType);
 		joinDispatcher->setHandlerForType(&networkStatsMessageHandler, NetworkStatsMessage::kType);
 		joinDispatcher->setHandlerForType(&gameSessionMessageHandler, GameSessionMessage::kType);
+		joinDispatcher->setHandlerForType(&mapChunkMessageHandler, MapChunkMessage::kType);
+		joinDispatcher->setHandlerForType(&physicsChunkMessageHandler, PhysicsChunkMessage::kType);
+		joinDispatcher->setHandlerForType(&luaChunkMessageHandler, LuaChunkMessage::kType);
 	}
 
 	my_capabilities.clear();
@@ -1236,6 +1398,9 @@ bool NetEnter(void)
 	my_capabilities[Capabilities::kZippedData] = Capabilities::kZippedDataVersion;
 	my_capabilities[Capabilities::kNetworkStats] = Capabilities::kNetworkStatsVersion;
 	my_capabilities[Capabilities::kRugby] = Capabilities::kRugbyVersion;
+	my_capabilities[Capabilities::kStandaloneHub] = Capabilities::kStandaloneHubVersion;
+	my_capabilities[Capabilities::kStarCompressedFlags] = Capabilities::kStarCompressedFlagsVersion;
+	my_capabilities[Capabilities::kStreamedGameData] = Capabilities::kStreamedGameDataVersion;
 
 	// net commands!
 	sIgnoredPlayers.clear();
@@ -1250,6 +1415,11 @@ bool NetEnter(void)
 
 	Console::instance()->register_command("ignore", IgnoreParser);
 
+	CommandParser NetstatsParser;
+	NetstatsParser.register_command("", netstats_show());
+	NetstatsParser.register_command("log", netstats_log());
+	Console::instance()->register_command("netstats", NetstatsParser);
+
 	next_join_attempt = last_network_stats_send = machine_tick_count();
   
 	if (error) {
@@ -1331,17 +1501,16 @@ void NetExit(
 	delete gMetaserverClient;
 	gMetaserverClient = new MetaserverClient();
 	
-	if (controller)
+	if (PortMappingActive())
 	{
 		open_progress_dialog(_closing_router_ports);
-		LNat_Upnp_Remove_Port_Mapping(controller, GAME_PORT, "TCP");
-		LNat_Upnp_Remove_Port_Mapping(controller, GAME_PORT, "UDP");
-		LNat_Upnp_Controller_Free(&controller);
-		controller = NULL;
+		PortMappingStop();
 		close_progress_dialog();
 	}
 
 	Console::instance()->unregister_command("ignore");
+	Console::instance()->unregister_command("netstats");
+	NetStopHistogramsLog();
   
 	NetDDPClose();
 
@@ -1495,31 +1664,9 @@ bool NetGather(
 	NetInitializeTopology(game_data, game_data_size, player_data, player_data_size);
 	NetInitializeSessionIdentifier();
 	
+	// open the port! the gather dialog hears how it went (see GatherDialog::idle())
 	if (network_preferences->attempt_upnp)
-	{
-		// open the port!
-		open_progress_dialog(_opening_router_ports);
-		char public_ip[32];
-		int ret = 0;
-		if ((ret = LNat_Upnp_Discover(&controller)) != 0)
-			logWarning("LibNAT: Failed to discover UPnP controller");
-		if (ret == 0) 
-			if ((ret = LNat_Upnp_Get_Public_Ip(controller, public_ip, 32)) != 0)
-				logWarning("LibNAT: Failed to acquire public IP");
-		if (ret == 0)
-			if ((ret = LNat_Upnp_Set_Port_Mapping(controller, NULL, GAME_PORT, "TCP")) != 0)
-				logWarning("LibNAT: Failed to map port %d (TCP)", GAME_PORT);
-		if (ret == 0)
-			if ((ret = LNat_Upnp_Set_Port_Mapping(controller, NULL, GAME_PORT, "UDP")) != 0)
-				logWarning("LibNAT: Failed to map port %d (UDP)", GAME_PORT);
-		close_progress_dialog();
-		
-		if (ret != 0)
-		{
-			controller = 0;
-			alert_user(infoError, strNETWORK_ERRORS, netWarnUPnPConfigureFailed, ret);
-		}
-	}
+		PortMappingStart(GAME_PORT);
 	
 	// Start listening for joiners
 	server = new CommunicationsChannelFactory(GAME_PORT);
@@ -1567,6 +1714,19 @@ bool NetStart(
                 NetUpdateTopology();
         }
 
+	// Spokes (ourselves included) find the hub through the gatherer's entry
+	if (network_preferences->game_protocol == _network_game_protocol_star && network_preferences->hub_address[0])
+	{
+		NetAddrBlock hub_address;
+		if (NetResolveHubAddress(network_preferences->hub_address, hub_address))
+		{
+			topology->players[sServerPlayerIndex].ddpAddress = hub_address;
+			NetUpdateTopology();
+		}
+		else
+			logWarning("could not resolve standalone hub address %s; hosting the hub locally", network_preferences->hub_address);
+	}
+
 	NetDistributeTopology(resuming_saved_game ? tagRESUME_GAME : tagSTART_GAME);
 
 	return true;
@@ -1908,11 +2068,32 @@ static void NetLocalAddrBlock(
 	short socketNumber)
 {
 	
-	address->host = 0x7f000001;	//!! XXX (ZZZ) yeah, that's really bad.
+	address->host = kNetLocalHostPlaceholder;	//!! XXX (ZZZ) yeah, that's really bad.
 	address->port = socketNumber;	// OTOH, I guess others are set up to "stuff" the address they actually saw for us instead of
 					// this, anyway... right??  So maybe it's not that big a deal.......
 }
 
+// "host" or "host:port"; the hub listens on the default game port unless told otherwise
+static bool NetResolveHubAddress(
+	const char *host_and_port,
+	NetAddrBlock& address)
+{
+	std::string host = host_and_port;
+	uint16 port = DEFAULT_GAME_PORT;
+
+	std::string::size_type colon = host.rfind(':');
+	if (colon != std::string::npos)
+	{
+		port = atoi(host.c_str() + colon + 1);
+		host.erase(colon);
+	}
+
+	if (host.empty() || port == 0)
+		return false;
+
+	return SDLNet_ResolveHost(&address, host.c_str(), port) == 0;
+}
+
 
 
 static void NetUpdateTopology(
@@ -1940,6 +2121,52 @@ static bool NetSetSelfSend(
 
 /* ------ this needs to let the gatherer keep going if there was an error.. */
 /* Marathon Specific Code  */
+// Set while a joiner waits for a level it told the gatherer it has
+static struct entry_point *sLocalMapEntry = NULL;
+
+// Joiner: tell a streaming gatherer which map we have, so it can skip sending it
+static void NetSendMapChecksum(struct entry_point *entry)
+{
+	if (!sGathererHasStreamedGameData)
+		return;
+
+	uint32 checksum = 0;
+	if (use_map_file(((game_info *) NetGetGameData())->parent_checksum)) {
+		checksum = get_current_map_checksum();
+		sLocalMapEntry = entry;
+	}
+
+	MapChecksumMessage mapChecksumMessage(checksum);
+	connection_to_server->enqueueOutgoingMessage(mapChecksumMessage);
+}
+
+// Gatherer: give streaming joiners a moment to report their maps
+static void NetAwaitMapChecksums()
+{
+	uint32 initial_ticks = machine_tick_count();
+	for (;;) {
+		bool waiting = false;
+		for (short playerIndex = 0; playerIndex < topology->player_count; playerIndex++) {
+			NetPlayer& player = topology->players[playerIndex];
+			if (player.net_dead || player.identifier == NONE || playerIndex == localPlayerIndex)
+				continue;
+
+			Client *client = connections_to_clients[player.stream_id];
+			if (client->capabilities[Capabilities::kStreamedGameData] >= Capabilities::kStreamedGameDataVersion && !client->has_map_checksum && client->channel->isConnected())
+				waiting = true;
+		}
+
+		if (!waiting || machine_tick_count() - initial_ticks > MAP_CHECKSUM_TIME_OUT)
+			break;
+
+		NetPumpClients(10);
+		client_map_t::iterator it;
+		for (it = connections_to_clients.begin(); it != connections_to_clients.end(); it++) {
+			it->second->channel->dispatchIncomingMessages();
+		}
+	}
+}
+
 /* Returns error code.. */
 // ZZZ annotation: this function doesn't seem to belong here - maybe more like interface.cpp?
 bool NetChangeMap(
@@ -1962,9 +2189,12 @@ bool NetChangeMap(
 	    assert(wad);	      
 	    
 	    length= get_net_map_data_length(wad);
+	    NetAwaitMapChecksums();
 	    NetDistributeGameDataToAllPlayers(wad, length, true);
 	  } else { // wait for de damn map.
+	      NetSendMapChecksum(entry);
 	      wad = NetReceiveGameData(true);
+	      sLocalMapEntry = NULL;
 	      if(!wad) {
 		alert_user(infoError, strNETWORK_ERRORS, netErrCouldntReceiveMap, 0);
 		success= false;
@@ -1998,10 +2228,32 @@ void SetNetscriptStatus (bool status)
         do_netscript = status;
 }
 
+// Compresses one chunk at a time, and lets every channel send what it has between chunks,
+// so joiners are receiving and inflating the start while the rest is still being compressed
+static void NetStreamZippedData(std::vector<CommunicationsChannel *>& channels, MessageTypeID type, byte *buffer, int32 length)
+{
+	if (channels.empty())
+		return;
+
+	ZippedDataChunker chunker(type, buffer, length);
+	for (;;) {
+		std::unique_ptr<BigChunkOfDataMessage> chunk(chunker.next());
+		if (!chunk.get())
+			break;
+
+		std::for_each(channels.begin(), channels.end(), boost::bind(&CommunicationsChannel::enqueueOutgoingMessage, _1, *chunk));
+		CommunicationsChannel::multiplePump(channels);
+	}
+
+	if (chunker.failed())
+		logError("unable to compress streamed game data (type %i)", type);
+}
+
 // ZZZ this "ought" to distribute to all players simultaneously (by interleaving send calls)
 // in case the server bandwidth is much greater than the others' bandwidths.  But that would
 // take a fair amount of reworking of the streaming system, which only groks talking with one
 // machine at a time.
+// (Streaming joiners now get their data a chunk at a time from every channel together.)
 OSErr NetDistributeGameDataToAllPlayers(byte *wad_buffer, 
 					int32 wad_length,
 					bool do_physics)
@@ -2031,6 +2283,10 @@ OSErr NetDistributeGameDataToAllPlayers(byte *wad_buffer,
 	// also a list of who and who can not take compressed data
 	std::vector<CommunicationsChannel *> zipCapableChannels;
 	std::vector<CommunicationsChannel *> zipIncapableChannels;
+
+	// and who takes it streamed, and of those who still needs the map
+	std::vector<CommunicationsChannel *> streamingChannels;
+	std::vector<CommunicationsChannel *> streamingMapChannels;
 	for (playerIndex = 0; playerIndex < topology->player_count; playerIndex++)
 	{
 		NetPlayer player = topology->players[playerIndex];
@@ -2042,7 +2298,13 @@ OSErr NetDistributeGameDataToAllPlayers(byte *wad_buffer,
 		{
 			Client *client = connections_to_clients[player.stream_id];
 			channels.push_back(client->channel);
-			if (client->capabilities[Capabilities::kZippedData] >= my_capabilities[Capabilities::kZippedData])
+			if (client->capabilities[Capabilities::kStreamedGameData] >= Capabilities::kStreamedGameDataVersion)
+			{
+				streamingChannels.push_back(client->channel);
+				if (!client->has_map_checksum || client->map_checksum != get_current_map_checksum())
+					streamingMapChannels.push_back(client->channel);
+			}
+			else if (client->capabilities[Capabilities::kZippedData] >= my_capabilities[Capabilities::kZippedData])
 			{
 				zipCapableChannels.push_back(client->channel);
 			}
@@ -2072,6 +2334,8 @@ OSErr NetDistributeGameDataToAllPlayers(byte *wad_buffer,
 			PhysicsMessage physicsMessage(physics_buffer, physics_length);
 			std::for_each(zipIncapableChannels.begin(), zipIncapableChannels.end(), boost::bind(&CommunicationsChannel::enqueueOutgoingMessage, _1, physicsMessage));
 		}
+
+		NetStreamZippedData(streamingChannels, PhysicsChunkMessage::kType, physics_buffer, physics_length);
 	}
 	
 	{
@@ -2091,6 +2355,8 @@ OSErr NetDistributeGameDataToAllPlayers(byte *wad_buffer,
 			MapMessage mapMessage(wad_buffer, wad_length);
 			std::for_each(zipIncapableChannels.begin(), zipIncapableChannels.end(), boost::bind(&CommunicationsChannel::enqueueOutgoingMessage, _1, mapMessage));
 		}
+
+		NetStreamZippedData(streamingMapChannels, MapChunkMessage::kType, wad_buffer, wad_length);
 	}
 
 	if (do_netscript)
@@ -2107,6 +2373,8 @@ OSErr NetDistributeGameDataToAllPlayers(byte *wad_buffer,
 			LuaMessage luaMessage(deferred_script_data, deferred_script_length);
 			std::for_each(zipIncapableChannels.begin(), zipIncapableChannels.end(), boost::bind(&CommunicationsChannel::enqueueOutgoingMessage, _1, luaMessage));
 		}
+
+		NetStreamZippedData(streamingChannels, LuaChunkMessage::kType, deferred_script_data, deferred_script_length);
 	}
 
 	{
@@ -2119,6 +2387,8 @@ OSErr NetDistributeGameDataToAllPlayers(byte *wad_buffer,
 	for (playerIndex = 0; playerIndex < topology->player_count; playerIndex++) {
 		if (playerIndex != localPlayerIndex) {
 			connections_to_clients[topology->players[playerIndex].stream_id]->state = Client::_ingame;
+			// a checksum is good for one level change
+			connections_to_clients[topology->players[playerIndex].stream_id]->has_map_checksum = false;
 		}
 	}
 
@@ -2160,6 +2430,12 @@ byte *NetReceiveGameData(bool do_physics)
   // handlers will take care of all messages, and when they're done
   // the server will send us this:
   std::unique_ptr<EndGameDataMessage> endGameDataMessage(connection_to_server->receiveSpecificMessage<EndGameDataMessage>((Uint32) 60000, (Uint32) 30000));
+
+  // anything still streaming now never will finish
+  handlerLuaChunks.reset();
+  handlerMapChunks.reset();
+  handlerPhysicsChunks.reset();
+
   if (endGameDataMessage.get()) {
     // game data was received OK
 	  if (do_physics) {
@@ -2172,6 +2448,9 @@ byte *NetReceiveGameData(bool do_physics)
       map_buffer = handlerMapBuffer;
       handlerMapBuffer = NULL;
       handlerMapLength = 0;
+    } else if (sLocalMapEntry) {
+      // the gatherer agreed we have this map already
+      map_buffer = (byte *) get_map_for_net_transfer(sLocalMapEntry);
     }
     
     if (handlerLuaLength > 0) {
@@ -2228,6 +2507,87 @@ NetGetNetTime(void)
 }
 
 extern const NetworkStats& hub_stats(int player_index);
+extern const NetworkHistograms& hub_histograms(int player_index);
+extern void hub_write_histograms(FILE* inFile, int32 inTime, bool inWriteHeader);
+
+// Only the gatherer hosts the hub, and not even it when a standalone hub runs the game
+static bool NetHubIsLocal()
+{
+	return !connection_to_server && topology->players[sServerPlayerIndex].ddpAddress.host == kNetLocalHostPlaceholder;
+}
+
+static FILE* sHistogramsLog = NULL;
+static uint32 sHistogramsLogStart;
+static bool sHistogramsLogNeedsHeader;
+
+// The smallest value that at least inFraction of the histogram's counts don't exceed
+static int NetHistogramPercentile(const uint32* bins, double inFraction)
+{
+	uint32 total = 0;
+	for (int i = 0; i < NetworkHistograms::kBins; ++i)
+		total += bins[i];
+
+	uint32 count = 0;
+	for (int i = 0; i < NetworkHistograms::kBins; ++i)
+	{
+		count += bins[i];
+		if (count > 0 && count >= total * inFraction)
+			return i;
+	}
+	return 0;
+}
+
+static void NetShowHistograms()
+{
+	if (sCurrentGameProtocol != static_cast<NetworkGameProtocol*>(&sStarGameProtocol) || !NetHubIsLocal() || netState != netActive)
+	{
+		screen_printf("network histograms are kept where the hub runs");
+		return;
+	}
+
+	screen_printf("median/95th percentile: rtt (ticks); late flags, lost packets, resends (per second)");
+	MyTMMutexTaker mutex;
+	for (int playerIndex = 0; playerIndex < topology->player_count; ++playerIndex)
+	{
+		if (playerIndex == localPlayerIndex || topology->players[playerIndex].net_dead)
+			continue;
+
+		const NetworkHistograms& histograms = hub_histograms(playerIndex);
+		screen_printf("%d: rtt %d/%d late %d/%d lost %d/%d resent %d/%d", playerIndex,
+			      NetHistogramPercentile(histograms.rtt, 0.5), NetHistogramPercentile(histograms.rtt, 0.95),
+			      NetHistogramPercentile(histograms.late_flags, 0.5), NetHistogramPercentile(histograms.late_flags, 0.95),
+			      NetHistogramPercentile(histograms.packet_loss, 0.5), NetHistogramPercentile(histograms.packet_loss, 0.95),
+			      NetHistogramPercentile(histograms.resends, 0.5), NetHistogramPercentile(histograms.resends, 0.95));
+	}
+}
+
+static bool NetStartHistogramsLog(const std::string& path)
+{
+	NetStopHistogramsLog();
+
+	sHistogramsLog = fopen(path.c_str(), "w");
+	if (!sHistogramsLog)
+		return false;
+
+	sHistogramsLogStart = machine_tick_count();
+	sHistogramsLogNeedsHeader = true;
+	return true;
+}
+
+static void NetStopHistogramsLog()
+{
+	if (sHistogramsLog)
+	{
+		fclose(sHistogramsLog);
+		sHistogramsLog = NULL;
+	}
+}
+
+// A gatherer's hub (or a standalone hub) that can't read them just ignores the offer
+bool NetStarCompressedFlagsOffered()
+{
+	return !connection_to_server || sGathererHasStarCompressedFlags;
+}
 
 void NetProcessMessagesInGame() {
 	if (connection_to_server) {
@@ -2235,7 +2595,7 @@ void NetProcessMessagesInGame() {
 		connection_to_server->dispatchIncomingMessages();
 	} else {
 		// update stats
-		if (sCurrentGameProtocol == static_cast<NetworkGameProtocol*>(&sStarGameProtocol) && last_network_stats_send + network_stats_send_period < machine_tick_count())
+		if (sCurrentGameProtocol == static_cast<NetworkGameProtocol*>(&sStarGameProtocol) && NetHubIsLocal() && last_network_stats_send + network_stats_send_period < machine_tick_count())
 		{
 			std::vector<NetworkStats> stats(topology->player_count);
 			for (int playerIndex = 0; playerIndex < topology->player_count; ++playerIndex)
@@ -2243,6 +2603,13 @@ void NetProcessMessagesInGame() {
 				stats[playerIndex] = hub_stats(playerIndex);
 			}
 
+			if (sHistogramsLog)
+			{
+				MyTMMutexTaker mutex;
+				hub_write_histograms(sHistogramsLog, (machine_tick_count() - sHistogramsLogStart) / MACHINE_TICKS_PER_SECOND, sHistogramsLogNeedsHeader);
+				sHistogramsLogNeedsHeader = false;
+			}
+
 			NetworkStatsMessage statsMessage(stats);
 			for (int playerIndex = 0; playerIndex < topology->player_count; ++playerIndex)
 			{
@@ -2261,9 +2628,9 @@ void NetProcessMessagesInGame() {
 		}
 
 		// pump chat messages
+		NetPumpClients(0);
 		client_map_t::iterator it;
 		for (it = connections_to_clients.begin(); it != connections_to_clients.end(); it++) {
-			it->second->channel->pump();
 			it->second->channel->dispatchIncomingMessages();
 		}
 	}
@@ -2289,10 +2656,10 @@ bool NetCheckForNewJoiner (prospective_joiner_info &info)
 	}
 	
 	{
+		NetPumpClients(0);
 		client_map_t::iterator it = connections_to_clients.begin();
 		while (it != connections_to_clients.end()) {
 			if (it->second->channel->isConnected()) {
-				it->second->channel->pump();
 				it->second->channel->dispatchIncomingMessages();
 				++it;
 			} else {
@@ -2549,16 +2916,17 @@ bool NetAllowOverlayMap() {
 
 
 extern int32 spoke_latency();
+extern void spoke_lossy_byte_stream_stats(NetworkStats& ioStats);
 
 int32 NetGetLatency() {
-	if (sCurrentGameProtocol == static_cast<NetworkGameProtocol*>(&sStarGameProtocol) && connection_to_server) {
+	if (sCurrentGameProtocol == static_cast<NetworkGameProtocol*>(&sStarGameProtocol) && !NetHubIsLocal()) {
 		return spoke_latency();
 	} else {
 		return NetworkStats::invalid;
 	}
 }
 
-const NetworkStats& NetGetStats(int player_index)
+static const NetworkStats& star_stats(int player_index)
 {
 	if (sCurrentGameProtocol == static_cast<NetworkGameProtocol*>(&sStarGameProtocol))
 	{
@@ -2573,10 +2941,14 @@ const NetworkStats& NetGetStats(int player_index)
 				return sInvalidStats;
 			}
 		}
-		else
+		else if (NetHubIsLocal())
 		{
 			return hub_stats(player_index);
 		}
+		else
+		{
+			return sInvalidStats;
+		}
 	}
 	else
 	{
@@ -2584,6 +2956,19 @@ const NetworkStats& NetGetStats(int player_index)
 	}
 }
 
+const NetworkStats& NetGetStats(int player_index)
+{
+	const NetworkStats& stats = star_stats(player_index);
+	if (player_index != localPlayerIndex || sCurrentGameProtocol != static_cast<NetworkGameProtocol*>(&sStarGameProtocol))
+		return stats;
+
+	// our own spoke knows what became of our lossy streaming data
+	static NetworkStats sLocalPlayerStats;
+	sLocalPlayerStats = stats;
+	spoke_lossy_byte_stream_stats(sLocalPlayerStats);
+	return sLocalPlayerStats;
+}
+
 int32 NetGetUnconfirmedActionFlagsCount()
 {
 	assert (sCurrentGameProtocol);
@@ -2602,5 +2987,11 @@ void NetUpdateUnconfirmedActionFlags()
 	return sCurrentGameProtocol->UpdateUnconfirmedActionFlags();
 }
 
+void NetReportWorldChecksums(int32 tick, const uint32 *checksums, size_t count)
+{
+	assert (sCurrentGameProtocol);
+	sCurrentGameProtocol->ReportWorldChecksums(tick, checksums, count);
+}
+
 #endif // !defined(DISABLE_NETWORKING)
 
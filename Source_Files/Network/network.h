@@ -289,6 +289,7 @@ bool NetAllowSavingLevel();
 int32 NetGetUnconfirmedActionFlagsCount(); // how many flags can we use for prediction?
 uint32 NetGetUnconfirmedActionFlag(int32 offset); // offset < GetUnconfirmedActionFlagsCount
 void NetUpdateUnconfirmedActionFlags();
+void NetReportWorldChecksums(int32 tick, const uint32 *checksums, size_t count); // see world_snapshot.h
 
 struct NetworkStats
 {
@@ -300,6 +301,29 @@ struct NetworkStats
 	int16 latency;
 	int16 jitter;
 	uint16 errors;
+
+	// the hub's adaptive pacing decisions; only known where the hub runs,
+	// invalid elsewhere (not sent in NetworkStatsMessage)
+	int16 late_tolerance; // ms
+	int16 nth_element;
+
+	// lossy streaming data (network microphone) the spoke sent, and gave up
+	// on rather than delay action flags for it; only known for the local
+	// player, zero elsewhere (not sent in NetworkStatsMessage)
+	uint32 lossy_bytes_sent;
+	uint32 lossy_chunks_dropped;
+};
+
+// Kept by the hub for each player since the game began; each bin counts how
+// often a value was seen, and the last bin also takes everything larger
+struct NetworkHistograms
+{
+	enum { kBins = 16 };
+
+	uint32 rtt[kBins];		// ticks from our first sending a tick to his ACK of it
+	uint32 late_flags[kBins];	// flags made up for him, per second
+	uint32 packet_loss[kBins];	// packets of his we think we never got, per second
+	uint32 resends[kBins];		// flags we sent him again, per second
 };
 
 // returns latency in ms, or kNetLatencyInvalid or kNetLatencyDisconnected
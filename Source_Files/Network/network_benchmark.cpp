@@ -0,0 +1,448 @@
+/*
+ *  network_benchmark.cpp
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+ *  Network protocol benchmark for alephone-hub (see network_benchmark.h)
+ *
+ *  The simulated spokes speak V1 (uncompressed flags) and nothing else: no lossy
+ *  streaming data, world checksums or pings.  Like real spokes, they follow the
+ *  hub's timing adjustments, keep at most half a second of flags unacknowledged
+ *  and resend all of those every time.
+ */
+
+#include "cseries.h"
+
+#include "network_benchmark.h"
+#include "network_star.h"
+#include "network_private.h"
+#include "network.h"
+#include "mytm.h"
+#include "AStream.h"
+#include "Logging.h"
+#include "crc.h"
+
+#include "SDL_net.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+enum {
+	kMaximumUnacknowledgedTicks = TICKS_PER_SECOND / 2,	// as a spoke's outgoing flags queue
+	kRecoverySendPeriod = TICKS_PER_SECOND / 2,
+	kIdentificationPeriod = TICKS_PER_SECOND,
+	kRealGameTick = kPregameTicks	// the hub's first tick is 0
+};
+
+struct SimulatedSpoke
+{
+	UDPsocket mSocket;
+	UDPpacket* mPacket;
+	NetworkConditionEmulator mIncoming;
+
+	bool mHeardFromHub;
+	int32 mLastTickSent;
+
+	// our flags, from the smallest tick the hub hasn't acknowledged
+	int32 mSmallestUnacknowledgedTick;
+	std::deque<action_flags_t> mUnacknowledgedFlags;
+
+	// everyone else's flags are in below this
+	int32 mSmallestUnreceivedTick;
+	std::deque<uint32> mMadeAt; // ms each tick from mSmallestUnreceivedTick was made
+
+	int mOutstandingTimingAdjustment;
+	int mRequestedTimingAdjustment;
+	std::vector<int32> mNetDeadTick; // per player, INT32_MAX for the living
+
+	std::vector<uint16> mLatencies; // ms from making flags to having everyone's
+	uint32 mPacketsReceived;
+};
+
+static bool parse_parameter(const char *key, int value, network_benchmark_parameters& parameters)
+{
+	if (strcmp(key, "players") == 0)
+		parameters.player_count = static_cast<int16>(PIN(value, 2, MAXIMUM_NUMBER_OF_NETWORK_PLAYERS));
+	else if (strcmp(key, "ticks") == 0)
+		parameters.tick_count = PIN(value, 1, INT32_MAX);
+	else
+		return parameters.conditions.set(key, value);
+	return true;
+}
+
+bool parse_network_benchmark_parameters(const char *spec, network_benchmark_parameters& parameters)
+{
+	if (strcmp(spec, "default") == 0)
+		return true;
+
+	while (*spec)
+	{
+		const char *equals = strchr(spec, '=');
+		if (!equals || equals - spec >= 16)
+			return false;
+
+		char key[16];
+		memcpy(key, spec, equals - spec);
+		key[equals - spec] = '\0';
+
+		char *end;
+		long value = strtol(equals + 1, &end, 10);
+		if (end == equals + 1 || (*end && *end != ','))
+			return false;
+		if (!parse_parameter(key, static_cast<int>(PIN(value, 0L, long(INT32_MAX))), parameters))
+			return false;
+
+		spec = *end ? end + 1 : end;
+	}
+	return true;
+}
+
+
+static void send_datagram(SimulatedSpoke& spoke, const NetAddrBlock& inHubAddress, byte* inData, size_t inLength)
+{
+	// blank out the CRC field before calculating
+	inData[2] = 0;
+	inData[3] = 0;
+	uint16 crc = calculate_data_crc_ccitt(inData, inLength);
+	inData[2] = crc >> 8;
+	inData[3] = crc & 0xff;
+
+	memcpy(spoke.mPacket->data, inData, inLength);
+	spoke.mPacket->len = static_cast<int>(inLength);
+	spoke.mPacket->address = inHubAddress;
+	SDLNet_UDP_Send(spoke.mSocket, -1, spoke.mPacket);
+}
+
+static void send_identification(SimulatedSpoke& spoke, const NetAddrBlock& inHubAddress, int16 inIndex)
+{
+	byte theData[kStarPacketHeaderSize + sizeof(int16)];
+	AOStreamBE ps(theData, sizeof(theData));
+	ps << (uint16)kSpokeToHubIdentification << (uint16)0 << inIndex;
+	send_datagram(spoke, inHubAddress, theData, ps.tellp());
+}
+
+static void send_game_data(SimulatedSpoke& spoke, const NetAddrBlock& inHubAddress)
+{
+	byte theData[ddpMaxData];
+	AOStreamBE ps(theData, sizeof(theData));
+	ps << (uint16)kSpokeToHubGameDataPacketV1Magic << (uint16)0
+	   << spoke.mSmallestUnreceivedTick
+	   << (uint16)kEndOfMessagesMessageType;
+
+	if (!spoke.mUnacknowledgedFlags.empty())
+	{
+		ps << spoke.mSmallestUnacknowledgedTick;
+		for (size_t i = 0; i < spoke.mUnacknowledgedFlags.size(); i++)
+			ps << spoke.mUnacknowledgedFlags[i];
+	}
+
+	send_datagram(spoke, inHubAddress, theData, ps.tellp());
+}
+
+static void received_packet(SimulatedSpoke& spoke, size_t inIndex, DDPPacketBuffer& inPacket, uint32 inNow)
+{
+	if (inPacket.datagramSize < kStarPacketHeaderSize)
+		return;
+
+	uint16 theCRC = (inPacket.datagramData[2] << 8) | inPacket.datagramData[3];
+	inPacket.datagramData[2] = 0;
+	inPacket.datagramData[3] = 0;
+	if (theCRC != calculate_data_crc_ccitt(inPacket.datagramData, inPacket.datagramSize))
+		return;
+
+	AIStreamBE ps(inPacket.datagramData, inPacket.datagramSize);
+	uint16 theMagic;
+	ps >> theMagic >> theCRC;
+	if (theMagic != kHubToSpokeGameDataPacketV1Magic && theMagic != kHubToSpokeGameDataPacketWithSpokeFlagsV1Magic)
+		return;
+	bool reflected = (theMagic == kHubToSpokeGameDataPacketWithSpokeFlagsV1Magic);
+
+	spoke.mHeardFromHub = true;
+	spoke.mPacketsReceived++;
+
+	int32 theAcknowledgedTick;
+	ps >> theAcknowledgedTick;
+	while (spoke.mSmallestUnacknowledgedTick < theAcknowledgedTick && !spoke.mUnacknowledgedFlags.empty())
+	{
+		spoke.mUnacknowledgedFlags.pop_front();
+		spoke.mSmallestUnacknowledgedTick++;
+	}
+
+	bool gotTimingAdjustment = false;
+	for (;;)
+	{
+		uint16 theMessageType;
+		ps >> theMessageType;
+		if (theMessageType == kEndOfMessagesMessageType)
+			break;
+
+		if (theMessageType == kTimingAdjustmentMessageType)
+		{
+			int8 theAdjustment;
+			ps >> theAdjustment;
+			gotTimingAdjustment = true;
+			if (theAdjustment != spoke.mRequestedTimingAdjustment)
+			{
+				spoke.mOutstandingTimingAdjustment = theAdjustment;
+				spoke.mRequestedTimingAdjustment = theAdjustment;
+			}
+		}
+		else if (theMessageType == kPlayerNetDeadMessageType)
+		{
+			uint8 thePlayer;
+			int32 theTick;
+			ps >> thePlayer >> theTick;
+			if (thePlayer < spoke.mNetDeadTick.size())
+				spoke.mNetDeadTick[thePlayer] = theTick;
+		}
+		else
+		{
+			uint16 theLength;
+			ps >> theLength;
+			ps.ignore(theLength);
+		}
+	}
+	if (!gotTimingAdjustment)
+		spoke.mRequestedTimingAdjustment = 0;
+
+	if (ps.tellg() >= ps.maxg())
+		return;
+
+	int32 theStartTick;
+	ps >> theStartTick;
+	if (theStartTick > spoke.mSmallestUnreceivedTick)
+		return;
+
+	// tick-major, one action_flags_t from each player still sending
+	int32 theTick = theStartTick;
+	while (ps.tellg() < ps.maxg())
+	{
+		for (size_t i = 0; i < spoke.mNetDeadTick.size(); i++)
+		{
+			if ((i != inIndex || reflected) && theTick < spoke.mNetDeadTick[i])
+			{
+				action_flags_t theFlags;
+				ps >> theFlags;
+			}
+		}
+		theTick++;
+	}
+
+	while (spoke.mSmallestUnreceivedTick < theTick && !spoke.mMadeAt.empty())
+	{
+		// the pregame's timing isn't what we're after
+		if (spoke.mSmallestUnreceivedTick >= kRealGameTick)
+			spoke.mLatencies.push_back(static_cast<uint16>(MIN(inNow - spoke.mMadeAt.front(), 65535U)));
+		spoke.mMadeAt.pop_front();
+		spoke.mSmallestUnreceivedTick++;
+	}
+}
+
+static void spoke_benchmark_tick(SimulatedSpoke& spoke, size_t inIndex, const NetAddrBlock& inHubAddress, int32 inNetworkTick, uint32 inNow)
+{
+	DDPPacketBuffer theBuffer;
+	while (SDLNet_UDP_Recv(spoke.mSocket, spoke.mPacket) > 0)
+	{
+		if (spoke.mPacket->len <= 0 || spoke.mPacket->len > ddpMaxData)
+			continue;
+		theBuffer.datagramSize = spoke.mPacket->len;
+		memcpy(theBuffer.datagramData, spoke.mPacket->data, spoke.mPacket->len);
+		theBuffer.sourceAddress = spoke.mPacket->address;
+		spoke.mIncoming.arrived(theBuffer, inNow);
+	}
+	while (spoke.mIncoming.deliver(inNow, theBuffer))
+	{
+		try {
+			received_packet(spoke, inIndex, theBuffer, inNow);
+		}
+		catch (...)
+		{
+			// malformed packet; drop it
+		}
+	}
+
+	if (!spoke.mHeardFromHub)
+	{
+		if (inNetworkTick % kIdentificationPeriod == 0)
+			send_identification(spoke, inHubAddress, static_cast<int16>(inIndex));
+		return;
+	}
+
+	// the same timing adjustments as a real spoke
+	bool madeFlags = false;
+	if (spoke.mOutstandingTimingAdjustment <= 0)
+	{
+		int theNumberOfFlagsToProvide = -spoke.mOutstandingTimingAdjustment + 1;
+		while (theNumberOfFlagsToProvide > 0 && spoke.mUnacknowledgedFlags.size() < kMaximumUnacknowledgedTicks)
+		{
+			int32 theTick = spoke.mSmallestUnacknowledgedTick + static_cast<int32>(spoke.mUnacknowledgedFlags.size());
+			spoke.mUnacknowledgedFlags.push_back(static_cast<action_flags_t>(theTick * 31 + inIndex));
+			if (theTick >= spoke.mSmallestUnreceivedTick + static_cast<int32>(spoke.mMadeAt.size()))
+				spoke.mMadeAt.push_back(inNow);
+			madeFlags = true;
+			theNumberOfFlagsToProvide--;
+		}
+		if (theNumberOfFlagsToProvide != -spoke.mOutstandingTimingAdjustment + 1)
+			spoke.mOutstandingTimingAdjustment = -theNumberOfFlagsToProvide;
+	}
+	else
+		spoke.mOutstandingTimingAdjustment--;
+
+	if (madeFlags || inNetworkTick - spoke.mLastTickSent >= kRecoverySendPeriod)
+	{
+		send_game_data(spoke, inHubAddress);
+		spoke.mLastTickSent = inNetworkTick;
+	}
+}
+
+
+static double histogram_mean(const uint32* inBins)
+{
+	uint32 theCount = 0;
+	uint64_t theSum = 0;
+	for (int i = 0; i < NetworkHistograms::kBins; i++)
+	{
+		theCount += inBins[i];
+		theSum += static_cast<uint64_t>(inBins[i]) * i;
+	}
+	return theCount ? double(theSum) / theCount : 0.0;
+}
+
+static void report(const char *inLine)
+{
+	logNote("%s", inLine);
+	printf("%s\n", inLine);
+}
+
+bool run_network_benchmark(const network_benchmark_parameters& parameters, uint16 inPort)
+{
+	size_t theNumberOfPlayers = parameters.player_count;
+
+	NetAddrBlock theHubAddress;
+	if (SDLNet_ResolveHost(&theHubAddress, "127.0.0.1", inPort) != 0)
+		return false;
+
+	std::vector<SimulatedSpoke> theSpokes(theNumberOfPlayers);
+	bool opened = true;
+	for (size_t i = 0; i < theNumberOfPlayers; i++)
+	{
+		SimulatedSpoke& spoke = theSpokes[i];
+		spoke.mSocket = SDLNet_UDP_Open(0);
+		spoke.mPacket = SDLNet_AllocPacket(ddpMaxData);
+		opened = opened && spoke.mSocket && spoke.mPacket;
+
+		spoke.mIncoming.setConditions(parameters.conditions);
+		spoke.mHeardFromHub = false;
+		spoke.mLastTickSent = 0;
+		spoke.mOutstandingTimingAdjustment = 0;
+		spoke.mRequestedTimingAdjustment = 0;
+		spoke.mNetDeadTick.assign(theNumberOfPlayers, INT32_MAX);
+		spoke.mPacketsReceived = 0;
+	}
+
+	if (opened)
+	{
+		// The same setup alephone-hub makes for a gatherer: the real addresses
+		// arrive with the spokes' identification packets
+		NetAddrBlock thePlaceholderAddress;
+		obj_clear(thePlaceholderAddress);
+		const NetAddrBlock* theAddresses[MAXIMUM_NUMBER_OF_NETWORK_PLAYERS];
+		for (size_t i = 0; i < theNumberOfPlayers; i++)
+			theAddresses[i] = &thePlaceholderAddress;
+
+		hub_initialize(kRealGameTick, theNumberOfPlayers, theAddresses, 0);
+		for (size_t i = 0; i < theNumberOfPlayers; i++)
+			theSpokes[i].mSmallestUnacknowledgedTick = theSpokes[i].mSmallestUnreceivedTick = kRealGameTick - kPregameTicks;
+
+		int32 theTickCount = kPregameTicks + parameters.tick_count;
+		clock_t theStartClock = clock();
+		uint32 theStartTime = SDL_GetTicks();
+		for (int32 tick = 0; tick < theTickCount; tick++)
+		{
+			uint32 theDeadline = theStartTime + static_cast<uint32>((static_cast<int64_t>(tick) * 1000) / TICKS_PER_SECOND);
+			int32 theWait = static_cast<int32>(theDeadline - SDL_GetTicks());
+			if (theWait > 0)
+				SDL_Delay(theWait);
+
+			uint32 theNow = SDL_GetTicks();
+			for (size_t i = 0; i < theNumberOfPlayers; i++)
+				spoke_benchmark_tick(theSpokes[i], i, theHubAddress, tick, theNow);
+		}
+		double theSeconds = (SDL_GetTicks() - theStartTime) / 1000.0;
+		double theCPUSeconds = double(clock() - theStartClock) / CLOCKS_PER_SEC;
+
+		char line[256];
+		const NetworkConditions& theConditions = parameters.conditions;
+		snprintf(line, sizeof(line), "netbench: %d players, %d ticks in %.1f s; delay %d ms, jitter %d ms, loss %d%%, reorder %d%% each way",
+			(int)theNumberOfPlayers, (int)parameters.tick_count, theSeconds,
+			theConditions.delay, theConditions.jitter, theConditions.loss, theConditions.reorder);
+		report(line);
+
+		std::vector<uint16> theAllLatencies;
+		{
+			MyTMMutexTaker mutex;
+			for (size_t i = 0; i < theNumberOfPlayers; i++)
+			{
+				SimulatedSpoke& spoke = theSpokes[i];
+				std::vector<uint16>& theLatencies = spoke.mLatencies;
+				theAllLatencies.insert(theAllLatencies.end(), theLatencies.begin(), theLatencies.end());
+				std::sort(theLatencies.begin(), theLatencies.end());
+
+				NetworkStats theStats;
+				NetworkHistograms theHistograms;
+				hub_player_stats(0, i, theStats, theHistograms);
+				snprintf(line, sizeof(line), "netbench player %d: %d ticks confirmed, %d ms median, %d ms 95th; hub sees latency %d ms, jitter %d ms, %.2f late flags, %.2f packets lost, %.2f resends per second",
+					(int)i, (int)theLatencies.size(),
+					theLatencies.empty() ? 0 : theLatencies[theLatencies.size() / 2],
+					theLatencies.empty() ? 0 : theLatencies[theLatencies.size() * 95 / 100],
+					theStats.latency, theStats.jitter,
+					histogram_mean(theHistograms.late_flags), histogram_mean(theHistograms.packet_loss),
+					histogram_mean(theHistograms.resends));
+				report(line);
+			}
+
+			uint64_t theHubCounts;
+			uint32 theHubTicks;
+			hub_tick_time(theHubCounts, theHubTicks);
+			std::sort(theAllLatencies.begin(), theAllLatencies.end());
+			snprintf(line, sizeof(line), "netbench: flags to everyone's %d ms median, %d ms 95th, %d ms worst; hub %.4f ms per tick; process %.4f ms CPU per tick",
+				theAllLatencies.empty() ? 0 : theAllLatencies[theAllLatencies.size() / 2],
+				theAllLatencies.empty() ? 0 : theAllLatencies[theAllLatencies.size() * 95 / 100],
+				theAllLatencies.empty() ? 0 : theAllLatencies.back(),
+				theHubTicks ? theHubCounts * 1000.0 / SDL_GetPerformanceFrequency() / theHubTicks : 0.0,
+				theCPUSeconds * 1000.0 / theTickCount);
+			report(line);
+		}
+
+		hub_cleanup_game(0);
+	}
+
+	for (size_t i = 0; i < theNumberOfPlayers; i++)
+	{
+		if (theSpokes[i].mPacket)
+			SDLNet_FreePacket(theSpokes[i].mPacket);
+		if (theSpokes[i].mSocket)
+			SDLNet_UDP_Close(theSpokes[i].mSocket);
+	}
+
+	return opened;
+}
@@ -0,0 +1,50 @@
+#ifndef NETWORK_BENCHMARK_H
+#define NETWORK_BENCHMARK_H
+
+/*
+ *  network_benchmark.h
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+ *  alephone-hub --netbench: a game on this hub for simulated spokes on loopback
+ *  sockets, each sending flags every tick the way a real one does, with both ends
+ *  seeing the emulated network conditions (see network_conditions.h).  Reports the
+ *  time from a spoke's making its flags to its having everyone's for that tick,
+ *  the hub's view of each player and the hub's time per tick.
+ */
+
+#include "cseries.h"
+#include "network_conditions.h"
+
+struct network_benchmark_parameters
+{
+	int16 player_count;
+	int32 tick_count;
+	NetworkConditions conditions;
+
+	network_benchmark_parameters() : player_count(8), tick_count(30*60) { }
+};
+
+// Reads "key=value,key=value..." (players, ticks, and the conditions' delay,
+// jitter, loss, reorder) over the defaults; "default" keeps them
+bool parse_network_benchmark_parameters(const char *spec, network_benchmark_parameters& parameters);
+
+// With the hub's socket open on inPort (and its conditions set before that);
+// logs and prints the results, and returns whether the spokes' sockets opened
+bool run_network_benchmark(const network_benchmark_parameters& parameters, uint16 inPort);
+
+#endif // NETWORK_BENCHMARK_H
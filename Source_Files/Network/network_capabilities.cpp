@@ -31,5 +31,8 @@ const string Capabilities::kGatherable = "Gatherable";
 const string Capabilities::kZippedData = "ZippedData";
 const string Capabilities::kNetworkStats = "NetworkStats";
 const string Capabilities::kRugby = "Rugby";
+const string Capabilities::kStandaloneHub = "StandaloneHub";
+const string Capabilities::kStarCompressedFlags = "StarCompressedFlags";
+const string Capabilities::kStreamedGameData = "StreamedGameData";
 
 
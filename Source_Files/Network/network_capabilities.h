@@ -47,6 +47,9 @@ class Capabilities : public capabilities_t
   static const int kZippedDataVersion = 1; // map, lua, physics
   static const int kNetworkStatsVersion = 1; // latency, jitter, errors
   static const int kRugbyVersion = 1; // sane score limit
+  static const int kStandaloneHubVersion = 1;
+  static const int kStarCompressedFlagsVersion = 1;
+  static const int kStreamedGameDataVersion = 1;
 
   static const string kGameworld;    // the PRNG, physics, etc.
   static const string kGameworldM1;  // like gameworld, but for Marathon 1 compatibility
@@ -59,6 +62,10 @@ class Capabilities : public capabilities_t
   static const string kZippedData;   // can receive zipped data
   static const string kNetworkStats; // can receive network stats
   static const string kRugby;        // rugby version
+  static const string kStandaloneHub; // takes the star hub's address from the topology
+  static const string kStarCompressedFlags; // star V2 packets (run-length coded flags)
+  static const string kStreamedGameData; // map, physics and Lua in chunks; map
+                                         // skipped if the joiner has it
   
   uint32& operator[](const string& k) { 
     assert(k.length() < kMaxKeySize);
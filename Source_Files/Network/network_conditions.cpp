@@ -0,0 +1,112 @@
+/*
+ *  network_conditions.cpp
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+ *  Network condition emulation (see network_conditions.h)
+ */
+
+#if !defined(DISABLE_NETWORKING)
+
+#include "network_conditions.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool NetworkConditions::set(const char *key, int value)
+{
+	int16 theValue = static_cast<int16>(PIN(value, 0, INT16_MAX));
+	if (strcmp(key, "delay") == 0)
+		delay = theValue;
+	else if (strcmp(key, "jitter") == 0)
+		jitter = theValue;
+	else if (strcmp(key, "loss") == 0)
+		loss = MIN(theValue, 100);
+	else if (strcmp(key, "reorder") == 0)
+		reorder = MIN(theValue, 100);
+	else
+		return false;
+	return true;
+}
+
+bool NetworkConditions::parse(const char *spec)
+{
+	while (*spec)
+	{
+		const char *equals = strchr(spec, '=');
+		if (!equals || equals - spec >= 16)
+			return false;
+
+		char key[16];
+		memcpy(key, spec, equals - spec);
+		key[equals - spec] = '\0';
+
+		char *end;
+		long value = strtol(equals + 1, &end, 10);
+		if (end == equals + 1 || (*end && *end != ','))
+			return false;
+		if (!set(key, static_cast<int>(PIN(value, 0L, 100000L))))
+			return false;
+
+		spec = *end ? end + 1 : end;
+	}
+	return true;
+}
+
+
+int32 NetworkConditionEmulator::random(int32 inRange)
+{
+	// xorshift; nothing here may touch the game's random numbers
+	mRandom ^= mRandom << 13;
+	mRandom ^= mRandom >> 17;
+	mRandom ^= mRandom << 5;
+	return inRange > 0 ? static_cast<int32>(mRandom % static_cast<uint32>(inRange)) : 0;
+}
+
+void NetworkConditionEmulator::arrived(const DDPPacketBuffer& inPacket, uint32 inNow)
+{
+	if (mConditions.loss > 0 && random(100) < mConditions.loss)
+		return;
+
+	int32 theDelay = mConditions.delay;
+	if (mConditions.jitter > 0)
+		theDelay += random(2 * mConditions.jitter + 1) - mConditions.jitter;
+	if (mConditions.reorder > 0 && random(100) < mConditions.reorder)
+		theDelay += MAX(mConditions.delay, 2 * mConditions.jitter) + 1;
+
+	mHeld.insert(std::make_pair(inNow + MAX(theDelay, 0), inPacket));
+}
+
+bool NetworkConditionEmulator::deliver(uint32 inNow, DDPPacketBuffer& outPacket)
+{
+	if (mHeld.empty() || static_cast<int32>(mHeld.begin()->first - inNow) > 0)
+		return false;
+
+	outPacket = mHeld.begin()->second;
+	mHeld.erase(mHeld.begin());
+	return true;
+}
+
+int32 NetworkConditionEmulator::timeUntilNext(uint32 inNow) const
+{
+	if (mHeld.empty())
+		return -1;
+
+	return MAX(static_cast<int32>(mHeld.begin()->first - inNow), 0);
+}
+
+#endif // !defined(DISABLE_NETWORKING)
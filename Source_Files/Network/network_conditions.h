@@ -0,0 +1,77 @@
+#ifndef NETWORK_CONDITIONS_H
+#define NETWORK_CONDITIONS_H
+
+/*
+ *  network_conditions.h
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+ *  Network condition emulation: incoming datagrams are held back, shuffled and lost
+ *  the way a poor connection would, so the protocols can be tried against one on a LAN.
+ */
+
+#include "cseries.h"
+#include "sdl_network.h"
+
+#include <map>
+
+struct NetworkConditions
+{
+	int16 delay;	// ms each datagram is held back
+	int16 jitter;	// ms more or less, at random
+	int16 loss;	// percent of datagrams lost
+	int16 reorder;	// percent held back another delay, so later ones pass them
+
+	NetworkConditions() : delay(0), jitter(0), loss(0), reorder(0) { }
+
+	bool active() const { return delay > 0 || jitter > 0 || loss > 0 || reorder > 0; }
+
+	// Takes one "key=value" (delay, jitter, loss, reorder); false if the key isn't ours
+	bool set(const char *key, int value);
+
+	// Reads "key=value,key=value..." over what's there
+	bool parse(const char *spec);
+};
+
+class NetworkConditionEmulator
+{
+public:
+	NetworkConditionEmulator() : mRandom(0x2545f491) { }
+
+	void setConditions(const NetworkConditions& inConditions) { mConditions = inConditions; }
+	const NetworkConditions& getConditions() const { return mConditions; }
+
+	// Takes a copy of a datagram that arrived at inNow (ms), unless it is to be lost
+	void arrived(const DDPPacketBuffer& inPacket, uint32 inNow);
+
+	// Hands back the next datagram whose time has come, if any
+	bool deliver(uint32 inNow, DDPPacketBuffer& outPacket);
+
+	// ms until the next datagram is due, or -1 if none is waiting
+	int32 timeUntilNext(uint32 inNow) const;
+
+	void reset() { mHeld.clear(); }
+
+private:
+	int32 random(int32 inRange); // [0, inRange)
+
+	NetworkConditions			mConditions;
+	std::multimap<uint32, DDPPacketBuffer>	mHeld; // by when each is due
+	uint32					mRandom;
+};
+
+#endif // NETWORK_CONDITIONS_H
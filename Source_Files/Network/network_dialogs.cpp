@@ -86,6 +86,7 @@ Apr 10, 2003 (Woody Zenfell):
 #include	<sstream>
 #include	"network_private.h" // actually just need "network_dialogs_private.h"
 #include	"SSLP_API.h"
+#include	"port_mapping.h"
 
 // for game types...
 #include "network_dialogs.h"
@@ -351,6 +352,10 @@ void GatherDialog::idle ()
 {
 	MetaserverClient::pumpAll();
 	
+	int upnp_error;
+	if (PortMappingTakeFailure(upnp_error))
+		alert_user(infoError, strNETWORK_ERRORS, netWarnUPnPConfigureFailed, upnp_error);
+	
 	prospective_joiner_info info;
 	if (player_search(info)) {
 		m_ungathered_players[info.stream_id] = info;
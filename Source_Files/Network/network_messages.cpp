@@ -37,14 +37,17 @@ static void write_string(AOStream& outputStream, const char *s) {
 }
 
 static void read_string(AIStream& inputStream, char *s, size_t length) {
-  char c;
+  // copy straight out of the stream, up to the terminator or as much as
+  // fits; what's read is that and the byte after it, as one at a time
+  const char *text = reinterpret_cast<const char *>(inputStream.read_view(0));
+  size_t available = inputStream.maxg() - inputStream.tellg();
+  size_t limit = std::min(length - 1, available);
   size_t i = 0;
-  inputStream >> (int8&) c;
-  while (c != '\0' && i < length - 1) {
-    s[i++] = c;
-    inputStream >> (int8&) c;
-  }
+  while (i < limit && text[i] != '\0')
+    i++;
+  memcpy(s, text, i);
   s[i] = '\0';
+  inputStream.ignore(i + 1);
 }
 
 // ghs: if you're trying to preserve network compatibility, and you want
@@ -144,6 +147,156 @@ UninflatedMessage* BigChunkOfZippedDataMessage::deflate() const
 	return theMessage;
 }
 
+ZippedDataChunker::ZippedDataChunker(MessageTypeID inType, const Uint8* inBuffer, size_t inLength) :
+	mType(inType), mLength(inLength), mStream(new z_stream), mStarted(false), mDone(false), mFailed(false)
+{
+	memset(mStream, 0, sizeof(z_stream));
+	mStream->next_in = const_cast<Bytef*>(inBuffer);
+	mStream->avail_in = inLength;
+	if (deflateInit(mStream, Z_DEFAULT_COMPRESSION) != Z_OK)
+	{
+		mDone = mFailed = true;
+	}
+	else
+	{
+		mStarted = true;
+	}
+}
+
+ZippedDataChunker::~ZippedDataChunker()
+{
+	if (mStarted)
+		deflateEnd(mStream);
+	delete mStream;
+}
+
+BigChunkOfDataMessage* ZippedDataChunker::next()
+{
+	if (mDone)
+		return 0;
+
+	// the first chunk starts with the inflated length, as in a zipped message
+	std::vector<byte> temp(kChunkSize);
+	size_t offset = 0;
+	if (mStream->total_out == 0)
+	{
+		AOStreamBE outputStream(&temp[0], 4);
+		outputStream << ((uint32) mLength);
+		offset = 4;
+	}
+
+	mStream->next_out = &temp[offset];
+	mStream->avail_out = kChunkSize - offset;
+	int ret = deflate(mStream, Z_FINISH);
+	if (ret == Z_STREAM_END)
+	{
+		mDone = true;
+	}
+	else if (ret != Z_OK)
+	{
+		logWarning("Error compressing streamed data; result is %i", ret);
+		mDone = mFailed = true;
+		return 0;
+	}
+
+	return new BigChunkOfDataMessage(mType, &temp[0], kChunkSize - mStream->avail_out);
+}
+
+ZippedDataUnchunker::ZippedDataUnchunker() :
+	mStream(0), mBuffer(0), mLength(0), mStarted(false), mDone(false)
+{
+}
+
+bool ZippedDataUnchunker::add(const BigChunkOfDataMessage& inChunk)
+{
+	if (mDone)
+		reset();
+
+	const Uint8* data = inChunk.buffer();
+	size_t length = inChunk.length();
+
+	if (!mStarted)
+	{
+		if (length < 4)
+			return false;
+
+		uint32 temp_size;
+		AIStreamBE inputStream(data, 4);
+		inputStream >> temp_size;
+		data += 4;
+		length -= 4;
+
+		// one spare byte catches a stream that inflates to more than it said
+		mLength = temp_size;
+		mBuffer = reinterpret_cast<Uint8*>(malloc(mLength + 1));
+		if (!mBuffer)
+			return false;
+
+		mStream = new z_stream;
+		memset(mStream, 0, sizeof(z_stream));
+		if (inflateInit(mStream) != Z_OK)
+		{
+			delete mStream;
+			mStream = 0;
+			reset();
+			return false;
+		}
+		mStream->next_out = mBuffer;
+		mStream->avail_out = mLength + 1;
+		mStarted = true;
+	}
+
+	mStream->next_in = const_cast<Bytef*>(data);
+	mStream->avail_in = length;
+	int ret = inflate(mStream, Z_NO_FLUSH);
+	if (ret == Z_STREAM_END && mStream->total_out == mLength)
+	{
+		mDone = true;
+		return true;
+	}
+	else if (ret == Z_OK || (ret == Z_BUF_ERROR && length == 0))
+	{
+		return true;
+	}
+	else
+	{
+		logWarning("Error decompressing streamed data; result is %i", ret);
+		reset();
+		return false;
+	}
+}
+
+size_t ZippedDataUnchunker::received() const
+{
+	return mStarted ? mStream->total_out : 0;
+}
+
+Uint8* ZippedDataUnchunker::release()
+{
+	Uint8* buffer = mBuffer;
+	mBuffer = 0;
+	reset();
+	return buffer;
+}
+
+void ZippedDataUnchunker::reset()
+{
+	if (mStream)
+	{
+		inflateEnd(mStream);
+		delete mStream;
+		mStream = 0;
+	}
+	if (mBuffer)
+	{
+		free(mBuffer);
+		mBuffer = 0;
+	}
+	mLength = 0;
+	mStarted = false;
+	mDone = false;
+}
+
 void AcceptJoinMessage::reallyDeflateTo(AOStream& outputStream) const {
   outputStream << (Uint8) mAccepted;
   deflateNetPlayer(outputStream, mPlayer);
@@ -264,6 +417,10 @@ bool NetworkStatsMessage::reallyInflateFrom(AIStream& inputStream) {
 		inputStream >> stats.latency;
 		inputStream >> stats.jitter;
 		inputStream >> stats.errors;
+		stats.late_tolerance = NetworkStats::invalid;
+		stats.nth_element = NetworkStats::invalid;
+		stats.lossy_bytes_sent = 0;
+		stats.lossy_chunks_dropped = 0;
 
 		mStats.push_back(stats);
 	}
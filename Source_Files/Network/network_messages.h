@@ -52,7 +52,11 @@ enum {
   kZIPPED_PHYSICS_MESSAGE,
   kZIPPED_LUA_MESSAGE,
   kNETWORK_STATS_MESSAGE,
-  kGAME_SESSION_MESSAGE
+  kGAME_SESSION_MESSAGE,
+  kMAP_CHUNK_MESSAGE,
+  kPHYSICS_CHUNK_MESSAGE,
+  kLUA_CHUNK_MESSAGE,
+  kMAP_CHECKSUM_MESSAGE
 };
 
 template <MessageTypeID tMessageType, typename tValueType>
@@ -297,6 +301,70 @@ typedef TemplatizedDataMessage<kZIPPED_PHYSICS_MESSAGE, BigChunkOfZippedDataMess
 typedef TemplatizedDataMessage<kLUA_MESSAGE, BigChunkOfDataMessage> LuaMessage;
 typedef TemplatizedDataMessage<kZIPPED_LUA_MESSAGE, BigChunkOfZippedDataMessage> ZippedLuaMessage;
 
+// Streamed game data: what a zipped message would carry, cut into chunks so the
+// receiver can inflate each as it arrives
+typedef TemplatizedDataMessage<kMAP_CHUNK_MESSAGE, BigChunkOfDataMessage> MapChunkMessage;
+typedef TemplatizedDataMessage<kPHYSICS_CHUNK_MESSAGE, BigChunkOfDataMessage> PhysicsChunkMessage;
+typedef TemplatizedDataMessage<kLUA_CHUNK_MESSAGE, BigChunkOfDataMessage> LuaChunkMessage;
+
+// joiner's map file checksum at a level change (0 if it has no such map)
+typedef TemplatizedSimpleMessage<kMAP_CHECKSUM_MESSAGE, uint32> MapChecksumMessage;
+
+struct z_stream_s;
+
+// compresses as it goes, one chunk message at a time
+class ZippedDataChunker
+{
+public:
+	enum { kChunkSize = 64 * 1024 };
+
+	ZippedDataChunker(MessageTypeID inType, const Uint8* inBuffer, size_t inLength);
+	~ZippedDataChunker();
+
+	// NULL once the whole stream has been returned, or if compression failed
+	BigChunkOfDataMessage* next();
+	bool failed() const { return mFailed; }
+
+private:
+	ZippedDataChunker(const ZippedDataChunker&);
+	ZippedDataChunker& operator =(const ZippedDataChunker&);
+
+	MessageTypeID mType;
+	size_t mLength;
+	z_stream_s* mStream;
+	bool mStarted;
+	bool mDone;
+	bool mFailed;
+};
+
+// inflates chunks in the order they arrive
+class ZippedDataUnchunker
+{
+public:
+	ZippedDataUnchunker();
+	~ZippedDataUnchunker() { reset(); }
+
+	// false (and reset) if the stream is corrupt
+	bool add(const BigChunkOfDataMessage& inChunk);
+	bool done() const { return mDone; }
+	size_t length() const { return mLength; }
+	size_t received() const;
+
+	// the inflated data, malloc()ed and now the caller's; ready for another stream
+	Uint8* release();
+	void reset();
+
+private:
+	ZippedDataUnchunker(const ZippedDataUnchunker&);
+	ZippedDataUnchunker& operator =(const ZippedDataUnchunker&);
+
+	z_stream_s* mStream;
+	Uint8* mBuffer;
+	size_t mLength;
+	bool mStarted;
+	bool mDone;
+};
+
 
 class NetworkChatMessage : public SmallMessageHelper
 {
@@ -447,6 +515,10 @@ struct Client {
 	Capabilities capabilities;
 	char name[MAX_NET_PLAYER_NAME_LENGTH];
 
+	// set when a streaming joiner tells us which map it has
+	bool has_map_checksum;
+	uint32 map_checksum;
+
 	static CheckPlayerProcPtr check_player;
 
 	~Client();
@@ -466,6 +538,7 @@ struct Client {
 	void handleAcceptJoinMessage(AcceptJoinMessage*, CommunicationsChannel*);
 	void handleChatMessage(NetworkChatMessage*, CommunicationsChannel*);
 	void handleChangeColorsMessage(ChangeColorsMessage*, CommunicationsChannel*);
+	void handleMapChecksumMessage(MapChecksumMessage*, CommunicationsChannel*);
 
 	std::unique_ptr<MessageDispatcher> mDispatcher;
 	std::unique_ptr<MessageHandler> mJoinerInfoMessageHandler;
@@ -474,6 +547,7 @@ struct Client {
 	std::unique_ptr<MessageHandler> mAcceptJoinMessageHandler;
 	std::unique_ptr<MessageHandler> mChatMessageHandler;
 	std::unique_ptr<MessageHandler> mChangeColorsMessageHandler;
+	std::unique_ptr<MessageHandler> mMapChecksumMessageHandler;
 };
 
 typedef TemplatizedDataMessage<kGAME_SESSION_MESSAGE, BigChunkOfDataMessage> GameSessionMessage;
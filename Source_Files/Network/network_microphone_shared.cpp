@@ -42,10 +42,16 @@
 
 #include	<algorithm>	// for STL pair<> type
 
+#include "network_microphone_shared.h"
+
 #ifdef SPEEX
 #include "speex/speex.h"
 #include "preferences.h"
 #include "network_speex.h"
+
+#include <SDL_atomic.h>
+#include <SDL_mutex.h>
+#include <SDL_thread.h>
 #endif
 
 #include "map.h" // _force_unique_teams!
@@ -122,17 +128,34 @@ inline int16 getSample(void *data)
 }
 
 #ifdef SPEEX
+enum {
+	kFrameSamples = 160, // one Speex narrowband frame
+	kFramesPerPacket = kNetworkAudioSamplesPerPacket / kFrameSamples,
+	kFrameQueueSize = 64, // a little over a second
+	kPartialPacketWait = 60 // ms without new frames before a short packet goes out
+};
+
+// Frames resampled by the capture callback, for the encoder thread; one
+// producer and one consumer, which only share the indices
+static int16 sFrameQueue[kFrameQueueSize][kFrameSamples];
+static SDL_atomic_t sFrameQueueWrite;
+static SDL_atomic_t sFrameQueueRead;
+static SDL_sem* sFramesWaiting = NULL;
+static SDL_Thread* sEncoderThread = NULL;
+static SDL_atomic_t sStopEncoder;
+
 template <bool stereo, bool sixteenBit>
-int32 copy_and_speex_encode_template(uint8* outStorage, void* inStorage, int32 inCount)
+void copy_and_queue_frames_template(void* inStorage, int32 inCount)
 {
-	static int16 frame[160];
 	static int storedSamples = 0;
-	int bytesWritten = 0;
 
 	while (inCount > 0)
 	{
+		int write = SDL_AtomicGet(&sFrameQueueWrite);
+		int16* frame = sFrameQueue[write];
 		int16 left_sample = getSample<stereo, sixteenBit>(inStorage);
 
+		// interpolate
 		if (inCount > sNumberOfBytesPerSample)
 		{
 			uint8* data = (uint8 *) inStorage + sNumberOfBytesPerSample;
@@ -148,6 +171,7 @@ int32 copy_and_speex_encode_template(uint8* outStorage, void* inStorage, int32 i
 			
 		// advance data
 		counter += rate;
+		
 		if (counter >= 0x10000) 
 		{
 			int count = counter >> 16;
@@ -156,47 +180,44 @@ int32 copy_and_speex_encode_template(uint8* outStorage, void* inStorage, int32 i
 			inCount -= sNumberOfBytesPerSample * count;
 		}
 
-		if (storedSamples >= 160)
+		if (storedSamples >= kFrameSamples)
 		{
-			// encode the frame
-			speex_bits_reset(&gEncoderBits);
-			speex_encode_int(gEncoderState, frame, &gEncoderBits);
-			uint8 nbytes = speex_bits_write(&gEncoderBits, reinterpret_cast<char *>(outStorage) + 1, 200);
-			bytesWritten += nbytes + 1;
-			// first put the size of this frame in storage
-			*(outStorage) = nbytes;
-			outStorage += nbytes + 1;
+			// hand the frame to the encoder; if it's that far behind, the
+			// frame is simply filled again
+			int next = (write + 1) % kFrameQueueSize;
+			if (next != SDL_AtomicGet(&sFrameQueueRead))
+			{
+				SDL_AtomicSet(&sFrameQueueWrite, next);
+				SDL_SemPost(sFramesWaiting);
+			}
 
 			storedSamples = 0;
 		}
-		
 	}
-
-	return bytesWritten;
 }
 
-int32 copy_and_speex_encode(uint8* outStorage, void *inStorage, int32 inCount)
+static void copy_and_queue_frames(void *inStorage, int32 inCount)
 {
 	if (sStereo) 
 	{
 		if (s16Bit)
 		{
-			return copy_and_speex_encode_template<true, true>(outStorage, inStorage, inCount);
+			copy_and_queue_frames_template<true, true>(inStorage, inCount);
 		}
 		else
 		{
-			return copy_and_speex_encode_template<true, false>(outStorage, inStorage, inCount);
+			copy_and_queue_frames_template<true, false>(inStorage, inCount);
 		}
 	}
 	else
 	{
 		if (s16Bit)
 		{
-			return copy_and_speex_encode_template<false, true>(outStorage, inStorage, inCount);
+			copy_and_queue_frames_template<false, true>(inStorage, inCount);
 		}
 		else
 		{
-			return copy_and_speex_encode_template<false, false>(outStorage, inStorage, inCount);
+			copy_and_queue_frames_template<false, false>(inStorage, inCount);
 		}
 	}
 }
@@ -211,6 +232,82 @@ send_audio_data(void* inData, short inSize) {
 #endif
 }
 
+
+// Encodes the queued frames and sends them kFramesPerPacket at a time, or
+// fewer once the microphone has gone quiet
+static int encoder_thread(void *)
+{
+	// assume Speex will not encode kNetworkAudioSamplesPerPacket samples to be larger than kNetworkAudioSamplesPerPacket * kNetworkAudioBytesPerFrame!
+	static uint8 sOutgoingPacketBuffer[kNetworkAudioSamplesPerPacket * kNetworkAudioBytesPerFrame + SIZEOF_network_audio_header];
+
+	network_audio_header    theHeader;
+	theHeader.mReserved = 1;
+	theHeader.mFlags    = 0;
+
+	network_audio_header_NET*   theHeader_NET = (network_audio_header_NET*) sOutgoingPacketBuffer;
+
+	netcpy(theHeader_NET, &theHeader);
+
+	uint8* theOutgoingAudioData = &sOutgoingPacketBuffer[SIZEOF_network_audio_header];
+	int theFrameCount = 0;
+	int theBytesEncoded = 0;
+
+	while (!SDL_AtomicGet(&sStopEncoder))
+	{
+		bool theQueueWentQuiet = (SDL_SemWaitTimeout(sFramesWaiting, kPartialPacketWait) == SDL_MUTEX_TIMEDOUT);
+
+		int read = SDL_AtomicGet(&sFrameQueueRead);
+		while (read != SDL_AtomicGet(&sFrameQueueWrite))
+		{
+			speex_bits_reset(&gEncoderBits);
+			speex_encode_int(gEncoderState, sFrameQueue[read], &gEncoderBits);
+			read = (read + 1) % kFrameQueueSize;
+			SDL_AtomicSet(&sFrameQueueRead, read);
+
+			// first put the size of this frame in storage
+			uint8 nbytes = speex_bits_write(&gEncoderBits, reinterpret_cast<char *>(theOutgoingAudioData + theBytesEncoded) + 1, 200);
+			theOutgoingAudioData[theBytesEncoded] = nbytes;
+			theBytesEncoded += nbytes + 1;
+
+			if (++theFrameCount == kFramesPerPacket)
+			{
+				send_audio_data((void *) sOutgoingPacketBuffer, SIZEOF_network_audio_header + theBytesEncoded);
+				theFrameCount = theBytesEncoded = 0;
+			}
+		}
+
+		if (theQueueWentQuiet && theFrameCount)
+		{
+			send_audio_data((void *) sOutgoingPacketBuffer, SIZEOF_network_audio_header + theBytesEncoded);
+			theFrameCount = theBytesEncoded = 0;
+		}
+	}
+
+	return 0;
+}
+
+void start_network_audio_encoder()
+{
+	if (sEncoderThread) return;
+
+	if (!sFramesWaiting) sFramesWaiting = SDL_CreateSemaphore(0);
+	SDL_AtomicSet(&sFrameQueueWrite, 0);
+	SDL_AtomicSet(&sFrameQueueRead, 0);
+	SDL_AtomicSet(&sStopEncoder, 0);
+	if (sFramesWaiting)
+		sEncoderThread = SDL_CreateThread(encoder_thread, "NetworkMicrophone_encoderThread", NULL);
+}
+
+void stop_network_audio_encoder()
+{
+	if (!sEncoderThread) return;
+
+	SDL_AtomicSet(&sStopEncoder, 1);
+	SDL_SemPost(sFramesWaiting);
+	SDL_WaitThread(sEncoderThread, NULL);
+	sEncoderThread = NULL;
+}
+
 #endif
 
 int32
@@ -234,74 +331,17 @@ copy_and_send_audio_data(uint8* inFirstChunkReadPosition, int32 inFirstChunkByte
     }
 
 #ifdef SPEEX
-    // Let runtime system worry about allocating and freeing the buffer (and don't do it on the stack).
-    // assume Speex will not encode kNetworkAudioSamplesPerPacket samples to be larger than kNetworkAudioSamplesPerPacket * kNetworkAudioBytesPerFrame!
-    static uint8 sOutgoingPacketBuffer[kNetworkAudioSamplesPerPacket * kNetworkAudioBytesPerFrame + SIZEOF_network_audio_header];
+	// without the encoder, the audio has nowhere to go
+	if (!sEncoderThread)
+		return inFirstChunkBytesRemaining + inSecondChunkBytesRemaining;
 
-    network_audio_header    theHeader;
-    theHeader.mReserved = 1;
-	theHeader.mFlags    = 0;
+	if (!inForceSend && inFirstChunkBytesRemaining + inSecondChunkBytesRemaining < sCaptureBytesPerPacket)
+		return 0;
 
-	network_audio_header_NET*   theHeader_NET = (network_audio_header_NET*) sOutgoingPacketBuffer;
-	
-	netcpy(theHeader_NET, &theHeader);
-	
-	uint8*   theOutgoingAudioData = &sOutgoingPacketBuffer[SIZEOF_network_audio_header];
-	
-	// Do the copying and sending
-	pair<int32, int32>  theBytesConsumed;
-	int32 theTotalCaptureBytesConsumed = 0;
-	
-	// Keep sending if we have data and either we're squeezing out the last drop or we have a packet's-worth.
-	while(inFirstChunkBytesRemaining >= static_cast<int32>(sNumberOfBytesPerSample) &&
-	      (inForceSend || inFirstChunkBytesRemaining + inSecondChunkBytesRemaining >= (int32)sCaptureBytesPerPacket)) {
-		
-		int captureBytesToCopy = std::min(inFirstChunkBytesRemaining, sCaptureBytesPerPacket);
-		int bytesCopied = copy_and_speex_encode(theOutgoingAudioData, inFirstChunkReadPosition, captureBytesToCopy);
-		
-		theTotalCaptureBytesConsumed += captureBytesToCopy;
-		
-		// If there's space left in the packet and we have a second chunk, start on it.
-		if(captureBytesToCopy < sCaptureBytesPerPacket && inSecondChunkBytesRemaining > 0) {
-			int secondCaptureBytesToCopy = std::min(sCaptureBytesPerPacket - captureBytesToCopy, inSecondChunkBytesRemaining);
-			
-			int secondBytesCopied = copy_and_speex_encode(&theOutgoingAudioData[bytesCopied], inSecondChunkReadPosition, secondCaptureBytesToCopy);
-			theTotalCaptureBytesConsumed += secondCaptureBytesToCopy;
-			
-			send_audio_data((void *) sOutgoingPacketBuffer,
-					SIZEOF_network_audio_header + bytesCopied + secondBytesCopied);
-			
-			// Update the second chunk position and length
-			inSecondChunkReadPosition += secondCaptureBytesToCopy;
-			inSecondChunkBytesRemaining -= secondCaptureBytesToCopy;
-		}
-		// Else, either we've filled up a packet or exhausted the buffer (or both).
-		else {
-			send_audio_data((void *) sOutgoingPacketBuffer, SIZEOF_network_audio_header + bytesCopied);
-		}
-		
-		// Update the first chunk position and length
-		inFirstChunkReadPosition += captureBytesToCopy;
-		inFirstChunkBytesRemaining -= captureBytesToCopy;
-    }
-	
-	// Now, the first chunk is exhausted.  See if there's any left in the second chunk.  Same rules apply.
-	while(inSecondChunkBytesRemaining >= static_cast<int32>(sNumberOfBytesPerSample) &&
-	      (inForceSend || inSecondChunkBytesRemaining >= (int32) sCaptureBytesPerPacket)) {
-		
-		int captureBytesToCopy = std::min(inSecondChunkBytesRemaining, sCaptureBytesPerPacket);
-		
-		int bytesCopied = copy_and_speex_encode(theOutgoingAudioData, inSecondChunkReadPosition, captureBytesToCopy);
-		
-		theTotalCaptureBytesConsumed += captureBytesToCopy;
-		
-		send_audio_data((void *) sOutgoingPacketBuffer, SIZEOF_network_audio_header + bytesCopied);
-		
-		inSecondChunkReadPosition += captureBytesToCopy;
-		inSecondChunkBytesRemaining -= captureBytesToCopy;
-	}
-	
-	return theTotalCaptureBytesConsumed;
+	copy_and_queue_frames(inFirstChunkReadPosition, inFirstChunkBytesRemaining);
+	copy_and_queue_frames(inSecondChunkReadPosition, inSecondChunkBytesRemaining);
+
+	return inFirstChunkBytesRemaining + inSecondChunkBytesRemaining;
 #else
 	return inFirstChunkBytesRemaining + inSecondChunkBytesRemaining; // eat the entire thing, we only support speex
 #endif
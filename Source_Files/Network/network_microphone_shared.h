@@ -56,4 +56,9 @@ int32 copy_and_send_audio_data(uint8* inFirstChunkReadPosition, int32 inFirstChu
 // Calling this without specifying a capture format is an error.
 int32 get_capture_byte_count_per_packet();
 
+// Speex encoding happens on a thread of its own, which copy_and_send() only
+// hands frames to; it runs for as long as the Speex encoder exists
+void start_network_audio_encoder();
+void stop_network_audio_encoder();
+
 #endif // NETWORK_MICROPHONE_SHARED_H
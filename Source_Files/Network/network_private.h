@@ -51,6 +51,10 @@ Feb 27, 2002 (Br'fin (Jeremy Parsons)):
 
 #define	GAME_PORT (network_preferences->game_port)
 
+// The gatherer's own entry in the topology carries this host; joiners fill in the address
+// they actually reached the gatherer at.  Any other host there is a standalone hub's.
+#define kNetLocalHostPlaceholder 0x7f000001
+
 // (ZZZ:) Moved here from sdl_network.h and macintosh_network.h
 
 /* ---------- constants */
@@ -103,6 +107,7 @@ enum /* error string for user */
 
 #define STREAM_TRANSFER_CHUNK_SIZE (10000)
 #define MAP_TRANSFER_TIME_OUT   (MACHINE_TICKS_PER_SECOND*70) // 70 seconds to wait for map.
+#define MAP_CHECKSUM_TIME_OUT   (MACHINE_TICKS_PER_SECOND*5) // 5 seconds for joiners to say which map they have.
 #define NET_SYNC_TIME_OUT       (MACHINE_TICKS_PER_SECOND*50) // 50 seconds to time out of syncing. 
 
 #define kACK_TIMEOUT 40
@@ -298,6 +303,9 @@ class Message;
 
 const NetDistributionInfo* NetGetDistributionInfoForType(int16 inType);
 
+// Whether our spoke should offer the hub run-length coded action_flags
+bool NetStarCompressedFlagsOffered();
+
 struct ClientChatInfo
 {
 	std::string name;
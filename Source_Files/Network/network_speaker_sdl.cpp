@@ -39,7 +39,7 @@
 #include    "network_speaker_sdl.h"
 
 #include    "network_distribution_types.h"
-#include    "CircularQueue.h"
+#include    "SPSCQueue.h"
 #include    "world.h"   // local_random()
 #include "Mixer.h"
 
@@ -53,14 +53,17 @@ enum {
     kMaxDryDequeues = 1,            // how many consecutive empty-buffers before we stop playing?
     kNumPumpPrimes = 1,             // how many noise-buffers should we start with while buffering incoming data?
     kNumSoundDataBuffers = 8,		// how many actual audio storage buffers should we have?
-    kSoundDataBufferSize = 2048 * 2		// how big will each audio storage buffer be?
+    kSoundDataBufferSize = 2048 * 2,		// how big will each audio storage buffer be?
+    kJitterBufferBytes = 2 * 800 * 2,   // how much audio to hold back before starting to play it (two packets)
+    kJitterBufferTicks = 150            // or how long to wait for that much (ms)
 };
 
 // "Send queue" of buffers from us to audio code (with descriptors)
-static  CircularQueue<NetworkSpeakerSoundBufferDescriptor>    sSoundBuffers(kSoundBufferQueueSize);
+// Both queues cross between the audio callback and us, so neither locks
+static  SPSCQueue<NetworkSpeakerSoundBufferDescriptor>    sSoundBuffers(kSoundBufferQueueSize);
 
 // "Return queue" of buffers from audio code to us for reuse
-static	CircularQueue<byte*>				sSoundDataBuffers(kNumSoundDataBuffers + 2);  // +2: breathing room
+static	SPSCQueue<byte*>				sSoundDataBuffers(kNumSoundDataBuffers + 2);  // +2: breathing room
 
 // We can provide static noise instead of a "real" buffer once in a while if we need to.
 // Also, we provide kNumPumpPrimes of static noise before getting to the "meat" as well.
@@ -69,6 +72,11 @@ static  NetworkSpeakerSoundBufferDescriptor	sNoiseBufferDesc;
 static  int                         		sDryDequeues = 0;
 static  bool                        		sSpeakerIsOn = false;
 
+// Jitter buffer: audio arriving while the speaker is off is held until
+// there's enough of it to ride out uneven packet arrival
+static  int32                       		sBufferedBytes = 0;
+static  uint32                      		sBufferingStarted = 0;
+
 
 OSErr
 open_network_speaker() {
@@ -104,6 +112,7 @@ open_network_speaker() {
     // Reset a couple others to sane values
     sDryDequeues    = 0;
     sSpeakerIsOn    = false;
+    sBufferedBytes  = 0;
     
 #ifdef SPEEX
         init_speex_decoder();
@@ -115,11 +124,9 @@ open_network_speaker() {
 void
 queue_network_speaker_data(byte* inData, short inLength) {
     if(inLength > 0) {
-        if(sSoundDataBuffers.getCountOfElements() > 0) {
-            // Fill out a descriptor for a new chunk of storage
-            NetworkSpeakerSoundBufferDescriptor theBufferDesc;
-            theBufferDesc.mData     = sSoundDataBuffers.peek();
-            sSoundDataBuffers.dequeue();
+        // Fill out a descriptor for a new chunk of storage
+        NetworkSpeakerSoundBufferDescriptor theBufferDesc;
+        if(sSoundDataBuffers.dequeue(theBufferDesc.mData)) {
             theBufferDesc.mLength   = inLength;
             theBufferDesc.mFlags    = kSoundDataIsDisposable;
     
@@ -127,16 +134,26 @@ queue_network_speaker_data(byte* inData, short inLength) {
             memcpy(theBufferDesc.mData, inData, inLength);
     
             // If we're just turning on, prime the queue with a few buffers of noise.
-            if(!sSpeakerIsOn) {
+            if(!sSpeakerIsOn && sBufferedBytes == 0) {
                 for(int i = 0; i < kNumPumpPrimes; i++) {
                     sSoundBuffers.enqueue(sNoiseBufferDesc);
                 }
-    
-                sSpeakerIsOn = true;
+
+                sBufferingStarted = machine_tick_count();
             }
     
             // Enqueue the actual sound data.
             sSoundBuffers.enqueue(theBufferDesc);
+
+            // Don't start playing until the jitter buffer fills (or we run
+            // out of buffers to fill it with)
+            if(!sSpeakerIsOn) {
+                sBufferedBytes += inLength;
+                if(sBufferedBytes >= kJitterBufferBytes || sSoundDataBuffers.getCountOfElements() == 0) {
+                    sBufferedBytes = 0;
+                    sSpeakerIsOn = true;
+                }
+            }
         }
         else {
             fdprintf("No sound data buffer space available - audio discarded");
@@ -147,6 +164,12 @@ queue_network_speaker_data(byte* inData, short inLength) {
 
 void
 network_speaker_idle_proc() {
+    // a short burst shouldn't wait for more that isn't coming
+    if(!sSpeakerIsOn && sBufferedBytes > 0 && machine_tick_count() - sBufferingStarted >= kJitterBufferTicks) {
+        sBufferedBytes = 0;
+        sSpeakerIsOn = true;
+    }
+
     if(sSpeakerIsOn)
 	    Mixer::instance()->EnsureNetworkAudioPlaying();
 }
@@ -158,10 +181,8 @@ dequeue_network_speaker_data() {
     static NetworkSpeakerSoundBufferDescriptor    sBufferDesc;
 
     // If there is actual sound data, reset the "ran dry" count and return a pointer to the buffer descriptor
-    if(sSoundBuffers.getCountOfElements() > 0) {
+    if(sSoundBuffers.dequeue(sBufferDesc)) {
         sDryDequeues = 0;
-        sBufferDesc = sSoundBuffers.peek();
-        sSoundBuffers.dequeue();
         return &sBufferDesc;
     }
     // If there's no data available, inc the "ran dry" count and return either a noise buffer or NULL.
@@ -190,10 +211,9 @@ close_network_speaker() {
     }
     
     // Free the sound data buffers
-    while(sSoundDataBuffers.getCountOfElements() > 0) {
-        byte* theBuffer = sSoundDataBuffers.peek();
+    byte* theBuffer;
+    while(sSoundDataBuffers.dequeue(theBuffer)) {
         delete [] theBuffer;
-        sSoundDataBuffers.dequeue();
     }
 
     // Free the noise buffer and restore some values
@@ -203,6 +223,7 @@ close_network_speaker() {
     }
     sDryDequeues    = 0;
     sSpeakerIsOn    = false;
+    sBufferedBytes  = 0;
     
     #ifdef SPEEX
     destroy_speex_decoder();
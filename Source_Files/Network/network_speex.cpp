@@ -29,6 +29,7 @@
 #ifdef SPEEX
 #include "network_speex.h"
 #include "network_audio_shared.h"
+#include "network_microphone_shared.h"
 #include "preferences.h"
 
 #include <speex/speex_preprocess.h>
@@ -63,10 +64,13 @@ void init_speex_encoder() {
 	float agc_level = 32768.0 * 0.7;
 	speex_preprocess_ctl(gPreprocessState, SPEEX_PREPROCESS_SET_AGC_LEVEL, &agc_level);
     }
-    
+
+    start_network_audio_encoder();
 }
 
 void destroy_speex_encoder() {
+    stop_network_audio_encoder();
+
     if (gEncoderState != NULL) {
         speex_encoder_destroy(gEncoderState);
         speex_bits_destroy(&gEncoderBits);
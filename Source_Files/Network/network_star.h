@@ -46,18 +46,50 @@ enum {
         kPlayerNetDeadMessageType = 0x4e44,	// 'ND'
 	kSpokeToHubLossyByteStreamMessageType = 0x534c,	// 'SL'
 	kHubToSpokeLossyByteStreamMessageType = 0x484c, // 'HL'
+	// Every so often a spoke reports checksums of its world after a tick: int32 tick,
+	// uint8 count, then count uint32s in the order of world_snapshot.h.  The hub logs
+	// the first tick where two spokes disagree.
+	kSpokeToHubWorldChecksumMessageType = 0x5743, // 'WC'
+	kMaximumWorldChecksums = 16,
 
 	kSpokeToHubIdentification = 0x4944,   // 'ID'
 	kSpokeToHubGameDataPacketV1Magic = 0x5331, // 'S1'
 	kHubToSpokeGameDataPacketV1Magic = 0x4831, // 'H1'
 	kHubToSpokeGameDataPacketWithSpokeFlagsV1Magic = 0x4631, // 'F1'
+	// V2 packets are V1 packets with run-length coded action_flags: for each player, a uint8
+	// count of the following ticks (in the packet) that repeat the flags, then the flags.
+	// The hub sends V2 only to spokes that offer it by identification; a spoke sends V2
+	// once its hub has.
+	kSpokeToHubGameDataPacketV2Magic = 0x5332, // 'S2'
+	kHubToSpokeGameDataPacketV2Magic = 0x4832, // 'H2'
+	kHubToSpokeGameDataPacketWithSpokeFlagsV2Magic = 0x4632, // 'F2'
 	kPingRequestPacket = 0x5051, // 'PQ'
 	kPingResponsePacket = 0x5052, // 'PR'
 
+	// Sent by the gatherer's spoke, along with its identification, to a standalone hub:
+	// int32 starting tick, uint16 player count, uint32 connected players bitmask
+	kGathererToHubSetupPacket = 0x4853, // 'HS'
+
+	// Spectator relays (network_star_relay.cpp) ask a hub for everything it confirms, and
+	// spectators (or further relays) ask a relay the same way.
+	// Request: uint32 game identifier (0 if none yet), int32 smallest tick still wanted.
+	// Flags: uint32 game identifier, int32 first tick of the game, int32 first real tick,
+	// int32 start tick, int32 end tick, uint8 player count, then for each player the
+	// smallest tick in the packet we have no flags for (less than the end tick only once
+	// he's netdead), then the flags in tick-major order.
+	kRelayFlagsRequestPacket = 0x5251, // 'RQ'
+	kRelayFlagsPacket = 0x5246, // 'RF'
+
         kPregameTicks = TICKS_PER_SECOND * 3,	// Synchronization/timing adjustment before real data
         kActionFlagsSerializedLength = 4,	// bytes for each serialized action_flags_t (should be elsewhere)
+	kActionFlagsRunSerializedLength = 5,	// bytes for each run of action_flags_t in V2 packets
+	kMaximumActionFlagsRunLength = 255,	// repeats in one run
+
+	// optional trailing byte of the identification packet
+	kIdentificationOffersCompressedFlags = 0x01,
 	
 	kStarPacketHeaderSize = 4, // 2 bytes for packet magic, 2 for CRC
+	kRelayFlagsPacketHeaderSize = kStarPacketHeaderSize + 21, // through the player count
 };
 
 typedef uint32 action_flags_t;	// (should be elsewhere)
@@ -66,15 +98,41 @@ typedef WritableTickBasedCircularQueue<action_flags_t> WritableTickBasedActionQu
 
 
 class InfoTree;
+struct NetworkStats;
+struct NetworkHistograms;
 
 extern void hub_initialize(int32 inStartingTick, size_t inNumPlayers, const NetAddrBlock* const* inPlayerAddresses, size_t inLocalPlayerIndex);
 extern void hub_cleanup(bool inGraceful, int32 inSmallestPostGameTick);
 extern void hub_received_network_packet(DDPPacketBufferPtr inPacket);
+#ifdef A1_NETWORK_STANDALONE_HUB
+// A standalone hub hosts several games at once, each stopping being active
+// once every one of its players has left
+extern size_t hub_game_count();
+extern bool hub_game_is_active(size_t inGame);
+extern void hub_cleanup_game(size_t inGame);
+// Players of the newest game the hub has yet to hear from; only then can it
+// tell whose packets are whose without asking
+extern bool hub_is_waiting_for_players();
+extern bool hub_is_player_address(const NetAddrBlock& inAddress);
+extern void hub_player_stats(size_t inGame, size_t inPlayerIndex, NetworkStats& outStats, NetworkHistograms& outHistograms);
+// SDL performance counts the tick task has taken, over every game, and its ticks
+extern void hub_tick_time(uint64_t& outCounts, uint32& outTicks);
+#endif
+#ifdef A1_NETWORK_STANDALONE_HUB
+// alephone-hub --relay: pass each game on inUpstreamAddress on to spectators
+extern void relay_initialize(const NetAddrBlock& inUpstreamAddress);
+extern void relay_cleanup();
+extern void relay_received_network_packet(DDPPacketBufferPtr inPacket);
+#endif
+// One CSV row per connected player and histogram
+extern void hub_write_histograms(FILE* inFile, int32 inTime, bool inWriteHeader);
 extern void DefaultHubPreferences();
 extern InfoTree HubPreferencesTree();
 extern void HubParsePreferencesTree(InfoTree prefs, std::string version);
 
-extern void spoke_initialize(const NetAddrBlock& inHubAddress, int32 inFirstTick, size_t inNumberOfPlayers, WritableTickBasedActionQueue* const inPlayerQueues[], bool inPlayerConnectedStatus[], size_t inLocalPlayerIndex, bool inHubIsLocal);
+extern void spoke_initialize(const NetAddrBlock& inHubAddress, int32 inFirstTick, size_t inNumberOfPlayers, WritableTickBasedActionQueue* const inPlayerQueues[], bool inPlayerConnectedStatus[], size_t inLocalPlayerIndex, bool inHubIsLocal, bool inOfferCompressedFlags);
+// Gatherer of a game on a standalone hub: ask the hub to set the game up
+extern void spoke_announce_game_to_hub(int32 inFirstTick, size_t inNumberOfPlayers, const bool inPlayerConnectedStatus[]);
 extern void spoke_cleanup(bool inGraceful);
 extern void spoke_received_network_packet(DDPPacketBufferPtr inPacket);
 extern int32 spoke_get_net_time();
@@ -87,6 +145,7 @@ extern int32 spoke_latency(); // in ms, kNetLatencyInvalid if not yet valid
 extern int32 hub_latency(int player_index); // in ms, kNetLatencyInvalid if not valid, kNetLatencyDisconnected if d/c
 extern TickBasedActionQueue* spoke_get_unconfirmed_flags_queue();
 extern int32 spoke_get_smallest_unconfirmed_tick();
+extern void spoke_report_world_checksums(int32 inTick, const uint32* inChecksums, size_t inCount);
 extern void DefaultSpokePreferences();
 extern InfoTree SpokePreferencesTree();
 extern void SpokeParsePreferencesTree(InfoTree prefs, std::string version);
@@ -40,6 +40,18 @@
  *	NAT-friendly networking - we no longer get spoke addresses form topology -
  *	instead spokes send identification packets to hub with player ID.
  *	Hub can then associate the ID in the identification packet with the paket's source address.
+ *
+ *  Oct 14, 2026:
+ *	Standalone hub builds again (alephone-hub, see hub_main.cpp); it carries on with
+ *	another reference player when the one it has goes netdead, and stops when everyone has.
+ *	Each tick's packets to the spokes go out as one batch.
+ *	Run-length coded action_flags (V2 packets) for spokes that offer them.
+ *	Adaptive pacing: each player's timing adjustment and late-flags tolerance follow
+ *	the jitter of his ACK round trips (see adapt_player_pacing()).
+ *	Per-player histograms of round trips, late flags, packet loss and resends
+ *	(hub_histograms(), hub_write_histograms()).
+ *	Spectator relays can ask for every confirmed tick (kRelayFlagsRequestPacket).
+ *	Spokes' world checksums are compared; the first tick they disagree on is logged.
  */
 
 #if !defined(DISABLE_NETWORKING)
@@ -54,7 +66,9 @@
 #include "Logging.h"
 #include "WindowedNthElementFinder.h"
 #include "CircularByteBuffer.h"
+#ifndef A1_NETWORK_STANDALONE_HUB
 #include "InfoTree.h"
+#endif
 #include "SDL_timer.h" // SDL_Delay()
 
 #include <vector>
@@ -145,7 +159,15 @@ enum {
 
 	kLatencyBufferSize = TICKS_PER_SECOND * 5, // store 5 seconds of ping counts
 	kDisplayLatencyWindow = TICKS_PER_SECOND * 1, // display last second's ping
-	kJitterUpdateInterval = TICKS_PER_SECOND * 1 / 2
+	kJitterUpdateInterval = TICKS_PER_SECOND * 1 / 2,
+
+	// adaptive pacing lets a steady player's in-game nth element rise to this many
+	// times the preference (but no further than a quarter of the window)
+	kMaximumNthElementScale = 4,
+
+	kMaximumRelays = 4,
+	kWorldChecksumTicksKept = 32,	// ticks whose first checksum report we remember
+	kRelayTimeout = TICKS_PER_SECOND * 5 // ticks without a request before we forget a relay
 };
 
 
@@ -161,6 +183,7 @@ struct HubPreferences {
 	int32	mRecoverySendPeriod;
 	int32   mMinimumSendPeriod;
 	bool    mBandwidthReduction;
+	bool    mAdaptivePacing;
 };
 
 static HubPreferences sHubPreferences;
@@ -169,39 +192,13 @@ int32& hub_get_minimum_send_period() { return sHubPreferences.mMinimumSendPeriod
 
 void hub_set_minimum_send_period(int32 new_minimum) { sHubPreferences.mMinimumSendPeriod = new_minimum; }
 
-// sNetworkTicker advances even if the game clock doesn't.
-// sLastNetworkTickSent is used to force us to resend packets (at a lower rate) even if we're no longer
-// getting new data.
-static int32 sNetworkTicker;
-static int32 sLastNetworkTickSent;
-
-// We have a pregame startup period to help establish (via standard adjustment mechanism) everyone's
-// timing.  Ticks smaller than sSmallestRealGameTick are part of this startup period.  They smell
-// just like real in-game ticks, except that spokes won't enqueue them on player_queues, and we
-// may have different adjustment window sizes and timeout periods for pre-game and in-game ticks.
-static int32 sSmallestRealGameTick;
-
-// Once everyone ACKs this tick, we're satisfied the game is ended.  (They should all agree on which
-// tick is last due to the symmetric execution model.)
-static int32 sSmallestPostGameTick;
-
-// The sFlagsQueues hold all flags for ticks for which we've received data from at least one
-// station, but for which we haven't received an ACK from all stations.
-// sFlagsQueues[all].getReadIndex() == sPlayerDataDisposition.getReadIndex();
-// max(sFlagsQueues[all].getWriteIndex()) == sPlayerDataDisposition.getWriteIndex();
-// min(sFlagsQueues[all].getWriteIndex()) == sSmallestIncompleteTick;
 typedef std::vector<TickBasedActionQueue> TickBasedActionQueueCollection;
-static TickBasedActionQueueCollection	sFlagsQueues;
-
-// tracks the net ticks each flags tick was *first* sent out at
-static ConcreteTickBasedCircularQueue<int32> sFlagSendTimeQueue(kFlagsQueueSize);
-static int32 sLastRealUpdate;
 
 struct NetworkPlayer_hub {
         NetAddrBlock	mAddress;		// network address of player
 	bool		mAddressKnown;		// did player tell us his address yet?
         bool		mConnected;		// is player still connected?
-        int32		mLastNetworkTickHeard;	// our sNetworkTicker last time we got a packet from them
+        int32		mLastNetworkTickHeard;	// our mNetworkTicker last time we got a packet from them
         int32		mSmallestUnacknowledgedTick;
 
 	WindowedNthElementFinder<int32>	mNthElementFinder;
@@ -210,7 +207,7 @@ struct NetworkPlayer_hub {
 
         // When we decide a timing adjustment is needed, we include the timing adjustment
         // request in every packet outbound to the player until we're sure he's seen it.
-        // In particular, mTimingAdjustmentTick is set to the sSmallestIncompleteTick, so we
+        // In particular, mTimingAdjustmentTick is set to the mSmallestIncompleteTick, so we
         // know nobody's received data for that tick yet.  We continue to send the message
         // until the station ACKs past that tick; at that point we know he must have seen
         // our message.
@@ -231,6 +228,23 @@ struct NetworkPlayer_hub {
 	// the last time a recovery set of flags was sent instead of incremental
 	int32           mLastRecoverySend;
 
+	// player's identification offered V2 packets
+	bool		mCompressedFlags;
+
+	// adaptive pacing, from the jitter of the player's round trips:
+	// the in-game nth element we time him by, and how many ticks we wait
+	// on his flags before making them up
+	int32		mInGameNthElement;
+	int32		mLateTolerance;
+
+	// diagnostics; the counts for the current second go into the histograms
+	// once it's over
+	NetworkHistograms mHistograms;
+	int32		mSmallestUnsentTick;	// we've never sent him flags for this tick or later
+	int32		mLateFlagsThisSecond;
+	int32		mPacketsLostThisSecond;
+	int32		mResendsThisSecond;
+
 	// latency stuff
 	int32 mLatencyTicks; // sum of the latency ticks from the last second
 	std::deque<int32> mLatencyBuffer;
@@ -238,42 +252,6 @@ struct NetworkPlayer_hub {
 	NetworkStats mStats;
 };
 
-// Housekeeping queues:
-// sPlayerDataDisposition holds an element for every tick for which data has been received from
-// someone, but which at least one player has not yet acknowledged.
-// sPlayerDataDisposition.getReadIndex() <= sSmallestIncompleteTick <= sPlayerDataDisposition.getWriteIndex()
-// sSmallestIncompleteTick indexes into sPlayerDataDisposition also; it divides the queue into ticks
-// for which data has been received from someone but not yet everyone (>= sSmallestIncompleteTick) and
-// ticks for which data has been sent out (to everyone) but for which someone hasn't yet acknowledged
-// (< sSmallestIncompleteTick).
-
-// The value of a queue element is a bit-set (indexed by player index) with a 1 bit for each player
-// that we're waiting on.  So, we can mask out successive players' bits as their traffic reaches us;
-// when the value hits 0, all players have checked in and we can advance an index.
-// sConnectedPlayersBitmask has '1' set for every connected player.
-static MutableElementsTickBasedCircularQueue<uint32>	sPlayerDataDisposition(kFlagsQueueSize);
-static int32 sSmallestIncompleteTick;
-static uint32 sConnectedPlayersBitmask;
-static uint32 sLaggingPlayersBitmask;
-
-
-// sPlayerReflectedFlags holds an element for every tick for which data has been
-// sent but at least one player has not yet acknowledged
-//
-// the value of a queue element is a bit-set (indexed by player index) with a 1
-// bit for each player we've altered flags and need to reflect flags for
-static MutableElementsTickBasedCircularQueue<uint32> sPlayerReflectedFlags(kFlagsQueueSize);
-
-// sLateFlagsQueues hold late flags we've received from lagging players
-static TickBasedActionQueueCollection sLateFlagsQueues;
-
-// holds the last real flags we received from this player
-static vector<action_flags_t> sLastFlagsReceived;
-
-// sSmallestUnsentTick is used for reducing the number of packets sent: we won't send a packet unless
-// sSmallestIncompleteTick - sSmallestUnsentTick >= sHubPreferences.mSendPeriod
-static int32 sSmallestUnsentTick;
-
 struct NetAddrBlockCompare
 {
 
@@ -287,22 +265,8 @@ struct NetAddrBlockCompare
 };
 
   typedef std::map<NetAddrBlock, int, NetAddrBlockCompare>	AddressToPlayerIndexType;
-static AddressToPlayerIndexType	sAddressToPlayerIndex;
 
 typedef std::vector<NetworkPlayer_hub>	NetworkPlayerCollection;
-static NetworkPlayerCollection	sNetworkPlayers;
-
-// Local player index is used to decide how to send a packet; ref is used for timing.
-static size_t			sLocalPlayerIndex;
-static size_t			sReferencePlayerIndex;
-
-static DDPFramePtr	sOutgoingFrame = NULL;
-
-#ifndef A1_NETWORK_STANDALONE_HUB
-static DDPPacketBuffer	sLocalOutgoingBuffer;
-static bool		sNeedToSendLocalOutgoingBuffer = false;
-#endif
-
 
 struct HubLossyByteStreamChunkDescriptor
 {
@@ -312,34 +276,163 @@ struct HubLossyByteStreamChunkDescriptor
 	uint8	mSender;
 };
 
-// This holds outgoing lossy byte stream data
-static CircularByteBuffer sOutgoingLossyByteStreamData(kLossyByteStreamDataBufferSize);
+// Spectator relays get each tick once everyone's flags for it are in; they don't hold
+// up the game, so one that falls further behind than we keep flags is dropped.
+struct RelaySubscriber {
+	NetAddrBlock	mAddress;
+	int32		mSmallestUnacknowledgedTick;
+	int32		mLastNetworkTickHeard;
+};
+
+// The first report for each recent tick; later ones are compared with it
+struct WorldChecksumReport {
+	int		mReporter;
+	uint8		mCount;
+	uint32		mChecksums[kMaximumWorldChecksums];
+};
+
+// Everything about one game.  The hub in a game client has one at a time; a standalone
+// hub may host several, each ticked and fed its own players' packets in turn.
+struct HubGame {
+	HubGame() :
+		mFlagSendTimeQueue(kFlagsQueueSize),
+		mPlayerDataDisposition(kFlagsQueueSize),
+		mPlayerReflectedFlags(kFlagsQueueSize),
+		mOutgoingLossyByteStreamData(kLossyByteStreamDataBufferSize),
+		mOutgoingLossyByteStreamDescriptors(kLossyByteStreamDescriptorCount),
+		mGameIdentifier(0),
+		mHubActive(false)
+	{ }
+
+	// mNetworkTicker advances even if the game clock doesn't.
+	// mLastNetworkTickSent is used to force us to resend packets (at a lower rate) even if we're no longer
+	// getting new data.
+	int32 mNetworkTicker;
+	int32 mLastNetworkTickSent;
+
+	// We have a pregame startup period to help establish (via standard adjustment mechanism) everyone's
+	// timing.  Ticks smaller than mSmallestRealGameTick are part of this startup period.  They smell
+	// just like real in-game ticks, except that spokes won't enqueue them on player_queues, and we
+	// may have different adjustment window sizes and timeout periods for pre-game and in-game ticks.
+	int32 mSmallestRealGameTick;
+
+	// Once everyone ACKs this tick, we're satisfied the game is ended.  (They should all agree on which
+	// tick is last due to the symmetric execution model.)
+	int32 mSmallestPostGameTick;
+
+	// The mFlagsQueues hold all flags for ticks for which we've received data from at least one
+	// station, but for which we haven't received an ACK from all stations.
+	// mFlagsQueues[all].getReadIndex() == mPlayerDataDisposition.getReadIndex();
+	// max(mFlagsQueues[all].getWriteIndex()) == mPlayerDataDisposition.getWriteIndex();
+	// min(mFlagsQueues[all].getWriteIndex()) == mSmallestIncompleteTick;
+	TickBasedActionQueueCollection	mFlagsQueues;
+
+	// tracks the net ticks each flags tick was *first* sent out at
+	ConcreteTickBasedCircularQueue<int32> mFlagSendTimeQueue;
+	int32 mLastRealUpdate;
+
+	// Housekeeping queues:
+	// mPlayerDataDisposition holds an element for every tick for which data has been received from
+	// someone, but which at least one player has not yet acknowledged.
+	// mPlayerDataDisposition.getReadIndex() <= mSmallestIncompleteTick <= mPlayerDataDisposition.getWriteIndex()
+	// mSmallestIncompleteTick indexes into mPlayerDataDisposition also; it divides the queue into ticks
+	// for which data has been received from someone but not yet everyone (>= mSmallestIncompleteTick) and
+	// ticks for which data has been sent out (to everyone) but for which someone hasn't yet acknowledged
+	// (< mSmallestIncompleteTick).
+
+	// The value of a queue element is a bit-set (indexed by player index) with a 1 bit for each player
+	// that we're waiting on.  So, we can mask out successive players' bits as their traffic reaches us;
+	// when the value hits 0, all players have checked in and we can advance an index.
+	// mConnectedPlayersBitmask has '1' set for every connected player.
+	MutableElementsTickBasedCircularQueue<uint32>	mPlayerDataDisposition;
+	int32 mSmallestIncompleteTick;
+	uint32 mConnectedPlayersBitmask;
+	uint32 mLaggingPlayersBitmask;
+
+	// mPlayerReflectedFlags holds an element for every tick for which data has been
+	// sent but at least one player has not yet acknowledged
+	//
+	// the value of a queue element is a bit-set (indexed by player index) with a 1
+	// bit for each player we've altered flags and need to reflect flags for
+	MutableElementsTickBasedCircularQueue<uint32> mPlayerReflectedFlags;
+
+	// mLateFlagsQueues hold late flags we've received from lagging players
+	TickBasedActionQueueCollection mLateFlagsQueues;
+
+	// holds the last real flags we received from this player
+	vector<action_flags_t> mLastFlagsReceived;
+
+	// mSmallestUnsentTick is used for reducing the number of packets sent: we won't send a packet unless
+	// mSmallestIncompleteTick - mSmallestUnsentTick >= sHubPreferences.mSendPeriod
+	int32 mSmallestUnsentTick;
+
+	AddressToPlayerIndexType	mAddressToPlayerIndex;
+	NetworkPlayerCollection	mNetworkPlayers;
+
+	// Local player index is used to decide how to send a packet; ref is used for timing.
+	size_t			mLocalPlayerIndex;
+	size_t			mReferencePlayerIndex;
+
+	// This holds outgoing lossy byte stream data
+	CircularByteBuffer mOutgoingLossyByteStreamData;
+
+	// This holds a descriptor for each chunk of lossy byte stream data held in the above buffer
+	CircularQueue<HubLossyByteStreamChunkDescriptor> mOutgoingLossyByteStreamDescriptors;
+
+	std::vector<RelaySubscriber> mRelays;
+	uint32		mGameIdentifier;	// tells relays one game from the next
+	int32		mFirstTick;
+
+	std::map<int32, WorldChecksumReport> mWorldChecksumReports;
+	bool		mWorldChecksumsDiverged;
+
+	bool		mHubActive;	// used to enable the packet handler
+};
+
+// Every game we're hosting, oldest first, and the one being worked on; both only
+// change with the mytm mutex held
+static std::vector<HubGame*>	sHubGames;
+static HubGame*		sHub = NULL;
+
+static DDPFramePtr	sOutgoingFrame = NULL;
 
-// This holds a descriptor for each chunk of lossy byte stream data held in the above buffer
-static CircularQueue<HubLossyByteStreamChunkDescriptor> sOutgoingLossyByteStreamDescriptors(kLossyByteStreamDescriptorCount);
+#ifndef A1_NETWORK_STANDALONE_HUB
+static DDPPacketBuffer	sLocalOutgoingBuffer;
+static bool		sNeedToSendLocalOutgoingBuffer = false;
+#endif
 
 // This is used to copy between AStream and CircularByteBuffer
 // It's used in both directions, but that's ok because the routines that do so are mutex.
 static byte sScratchBuffer[kLossyByteStreamDataBufferSize];
 
+// V2 packets' flags, expanded to read like V1's; no more than a V1 packet could hold
+static byte sExpandedFlags[ddpMaxData];
 
+// One task ticks every game
 static myTMTaskPtr	sHubTickTask = NULL;
-static bool		sHubActive = false;	// used to enable the packet handler
-static bool		sHubInitialized = false;
+static uint32		sGamesHosted = 0;
+#ifdef A1_NETWORK_STANDALONE_HUB
+static uint64_t	sHubTickCounts = 0;
+static uint32		sHubTicksTimed = 0;
+#endif
 
 
 
 static void hub_check_for_completion();
 static void player_acknowledged_up_to_tick(size_t inPlayerIndex, int32 inSmallestUnacknowledgedTick);
 static bool player_provided_flags_from_tick_to_tick(size_t inPlayerIndex, int32 inFirstNewTick, int32 inSmallestUnreceivedTick);
-static void hub_received_game_data_packet_v1(AIStream& ps, int inSenderIndex);
+static void hub_received_game_data_packet_v1(AIStream& ps, int inSenderIndex, bool inCompressedFlags);
 static void hub_received_identification_packet(AIStream& ps, NetAddrBlock address);
 static void hub_received_ping_request(AIStream& ps, NetAddrBlock address);
 static void hub_received_ping_response(AIStream& ps, NetAddrBlock address);
+static void hub_received_relay_request(AIStream& ps, NetAddrBlock address);
+static void send_packets_to_relays();
 static void process_messages(AIStream& ps, int inSenderIndex);
 static void process_optional_message(AIStream& ps, int inSenderIndex, uint16 inMessageType);
+static void process_world_checksum_message(AIStream& ps, int inSenderIndex, uint16 inLength);
 static void make_player_netdead(int inPlayerIndex);
 static bool hub_tick();
+static bool hub_tick_games();
 static void send_packets();
 
 
@@ -349,22 +442,22 @@ static void send_packets();
 static inline NetworkPlayer_hub&
 getNetworkPlayer(size_t inIndex)
 {
-        assert(inIndex < sNetworkPlayers.size());
-        return sNetworkPlayers[inIndex];
+        assert(inIndex < sHub->mNetworkPlayers.size());
+        return sHub->mNetworkPlayers[inIndex];
 }
 
 static inline TickBasedActionQueue&
 getFlagsQueue(size_t inIndex)
 {
-        assert(inIndex < sFlagsQueues.size());
-        return sFlagsQueues[inIndex];
+        assert(inIndex < sHub->mFlagsQueues.size());
+        return sHub->mFlagsQueues[inIndex];
 }
 
 static inline TickBasedActionQueue&
 getLateFlagsQueue(size_t inIndex)
 {
-	assert(inIndex < sFlagsQueues.size());
-	return sLateFlagsQueues[inIndex];
+	assert(inIndex < sHub->mFlagsQueues.size());
+	return sHub->mLateFlagsQueues[inIndex];
 }
 
 
@@ -394,6 +487,14 @@ send_frame_to_local_spoke(DDPFramePtr frame, NetAddrBlock *address, short protoc
 
 
 
+static inline void
+add_to_histogram(uint32* ioBins, int32 inValue)
+{
+	ioBins[std::max(0, std::min(inValue, static_cast<int32>(NetworkHistograms::kBins - 1)))]++;
+}
+
+
+
 static inline void
 check_send_packet_to_spoke()
 {
@@ -429,11 +530,15 @@ hub_initialize(int32 inStartingTick, size_t inNumPlayers, const NetAddrBlock* co
 
 //        sNetworkState = eNetworkJustStartingUp;
 
+	// Other games may be under way; they wait while we set this one up
+	MyTMMutexTaker theMutex;
+
 #ifdef DEBUG_TIMING_ADJUSTMENTS
+	// (for the first of the games only)
 	FileSpecifier fs;
 	fs.SetToLocalDataDir();
 	fs.AddPart("TimingDebug");
-	if (fs.Exists() && fs.IsDir())
+	if (sHubGames.empty() && fs.Exists() && fs.IsDir())
 	{
 		time_t t;
 		struct tm* now;
@@ -453,24 +558,36 @@ hub_initialize(int32 inStartingTick, size_t inNumPlayers, const NetAddrBlock* co
 		dout << "Latency Tolerance: " << sHubPreferences.mMinimumSendPeriod << std::endl;
 		debug_timing_adjustments = true;
 	}
-	else
+	else if (sHubGames.empty())
 	{
 		debug_timing_adjustments = false;
 	}
 #endif
 
         assert(inLocalPlayerIndex < inNumPlayers);
-        sLocalPlayerIndex = inLocalPlayerIndex;
-	sReferencePlayerIndex = sLocalPlayerIndex;
+	sHub = new HubGame;
+	sHubGames.push_back(sHub);
+
+        sHub->mLocalPlayerIndex = inLocalPlayerIndex;
+	sHub->mReferencePlayerIndex = sHub->mLocalPlayerIndex;
 
 #ifdef A1_NETWORK_STANDALONE_HUB
 	// There is no local player on standalone hub.
-	sLocalPlayerIndex = (size_t)NONE;
+	sHub->mLocalPlayerIndex = (size_t)NONE;
 #endif
 
-	sSmallestPostGameTick = INT32_MAX;
-        sSmallestRealGameTick = inStartingTick;
+	sHub->mSmallestPostGameTick = INT32_MAX;
+        sHub->mSmallestRealGameTick = inStartingTick;
         int32 theFirstTick = inStartingTick - kPregameTicks;
+	sHub->mFirstTick = theFirstTick;
+
+	sHub->mWorldChecksumReports.clear();
+	sHub->mWorldChecksumsDiverged = false;
+
+	// Relays ask for the game by this, and the hub sorts their packets by it
+	sHub->mGameIdentifier = ((SDL_GetTicks() << 8) | (++sGamesHosted & 0xff));
+	if(sHub->mGameIdentifier == 0)
+		sHub->mGameIdentifier = 1;
 
         if(sOutgoingFrame == NULL)
                 sOutgoingFrame = NetDDPNewFrame();
@@ -479,35 +596,28 @@ hub_initialize(int32 inStartingTick, size_t inNumPlayers, const NetAddrBlock* co
         sNeedToSendLocalOutgoingBuffer = false;
 #endif
 
-        sNetworkPlayers.clear();
-        sFlagsQueues.clear();
-	sLateFlagsQueues.clear();
-        sNetworkPlayers.resize(inNumPlayers);
-        sFlagsQueues.resize(inNumPlayers, TickBasedActionQueue(kFlagsQueueSize));
-	sLateFlagsQueues.resize(inNumPlayers, TickBasedActionQueue(kFlagsQueueSize));
-
-        sAddressToPlayerIndex.clear();
-        sConnectedPlayersBitmask = 0;
+        sHub->mNetworkPlayers.resize(inNumPlayers);
+        sHub->mFlagsQueues.resize(inNumPlayers, TickBasedActionQueue(kFlagsQueueSize));
+	sHub->mLateFlagsQueues.resize(inNumPlayers, TickBasedActionQueue(kFlagsQueueSize));
 
-	sOutgoingLossyByteStreamDescriptors.reset();
-	sOutgoingLossyByteStreamData.reset();
+        sHub->mConnectedPlayersBitmask = 0;
 
         for(size_t i = 0; i < inNumPlayers; i++)
         {
-                NetworkPlayer_hub& thePlayer = sNetworkPlayers[i];
+                NetworkPlayer_hub& thePlayer = sHub->mNetworkPlayers[i];
 
                 if(inPlayerAddresses[i] != NULL)
                 {
                         thePlayer.mConnected = true;
-                        sConnectedPlayersBitmask |= (((uint32)1) << i);
+                        sHub->mConnectedPlayersBitmask |= (((uint32)1) << i);
 			thePlayer.mAddressKnown = false;
                         // thePlayer.mAddress = *(inPlayerAddresses[i]); (jkvw: see note below)
                         // Currently, all-0 address is cue for local spoke.
 			// jkvw: The "real" addresses for spokes won't be known unti we get some UDP traffic
 			//	 from them - we'll update as they become known.
-                        if(i == sLocalPlayerIndex) { // jkvw: I don't need this, do I?
+                        if(i == sHub->mLocalPlayerIndex) { // jkvw: I don't need this, do I?
                                 obj_clear(thePlayer.mAddress);
-				sAddressToPlayerIndex[thePlayer.mAddress] = i;
+				sHub->mAddressToPlayerIndex[thePlayer.mAddress] = i;
 				thePlayer.mAddressKnown = true;
 			}
                 }
@@ -518,6 +628,14 @@ hub_initialize(int32 inStartingTick, size_t inNumPlayers, const NetAddrBlock* co
 
                 thePlayer.mLastNetworkTickHeard = 0;
 		thePlayer.mLastRecoverySend = 0;
+		thePlayer.mCompressedFlags = false;
+		thePlayer.mInGameNthElement = sHubPreferences.mInGameNthElement;
+		thePlayer.mLateTolerance = sHubPreferences.mMinimumSendPeriod;
+		obj_clear(thePlayer.mHistograms);
+		thePlayer.mSmallestUnsentTick = theFirstTick;
+		thePlayer.mLateFlagsThisSecond = 0;
+		thePlayer.mPacketsLostThisSecond = 0;
+		thePlayer.mResendsThisSecond = 0;
                 thePlayer.mSmallestUnacknowledgedTick = theFirstTick;
 		thePlayer.mSmallestUnheardTick = theFirstTick;
 		thePlayer.mNthElementFinder.reset(sHubPreferences.mPregameWindowSize);
@@ -531,81 +649,82 @@ hub_initialize(int32 inStartingTick, size_t inNumPlayers, const NetAddrBlock* co
 		thePlayer.mStats.latency = NetworkStats::invalid;
 		thePlayer.mStats.jitter = NetworkStats::invalid;
 		thePlayer.mStats.errors = 0;
+		thePlayer.mStats.late_tolerance = NetworkStats::invalid;
+		thePlayer.mStats.nth_element = NetworkStats::invalid;
+		thePlayer.mStats.lossy_bytes_sent = 0;
+		thePlayer.mStats.lossy_chunks_dropped = 0;
 
-                sFlagsQueues[i].reset(theFirstTick);
-		sLateFlagsQueues[i].reset(theFirstTick);
+                sHub->mFlagsQueues[i].reset(theFirstTick);
+		sHub->mLateFlagsQueues[i].reset(theFirstTick);
         }
         
-        sPlayerDataDisposition.reset(theFirstTick);
-	sPlayerReflectedFlags.reset(theFirstTick);
-	sLastFlagsReceived.resize(inNumPlayers);
-	sFlagSendTimeQueue.reset(theFirstTick);
-        sSmallestIncompleteTick = theFirstTick;
-	sSmallestUnsentTick = theFirstTick;
-        sNetworkTicker = 0;
-        sLastNetworkTickSent = 0;
-	sLastRealUpdate = 0;
-	sLaggingPlayersBitmask = 0;
-
-        sHubActive = true;
-
-        sHubTickTask = myXTMSetup(1000/TICKS_PER_SECOND, hub_tick);
-
-	sHubInitialized = true;
+        sHub->mPlayerDataDisposition.reset(theFirstTick);
+	sHub->mPlayerReflectedFlags.reset(theFirstTick);
+	sHub->mLastFlagsReceived.resize(inNumPlayers);
+	sHub->mFlagSendTimeQueue.reset(theFirstTick);
+        sHub->mSmallestIncompleteTick = theFirstTick;
+	sHub->mSmallestUnsentTick = theFirstTick;
+        sHub->mNetworkTicker = 0;
+        sHub->mLastNetworkTickSent = 0;
+	sHub->mLastRealUpdate = 0;
+	sHub->mLaggingPlayersBitmask = 0;
+
+        sHub->mHubActive = true;
+
+	if(sHubTickTask == NULL)
+		sHubTickTask = myXTMSetup(1000/TICKS_PER_SECOND, hub_tick_games);
 }
 
 
 
-void
-hub_cleanup(bool inGraceful, int32 inSmallestPostGameTick)
+static void
+cleanup_game(HubGame* inGame, bool inGraceful, int32 inSmallestPostGameTick)
 {
-	if(sHubInitialized)
+	if(inGraceful)
 	{
-		if(inGraceful)
+		// We have to do a check now in case the conditions are already met
+		if(take_mytm_mutex())
 		{
 			// Signal our demise
-			sSmallestPostGameTick = inSmallestPostGameTick;
+			sHub = inGame;
+			sHub->mSmallestPostGameTick = inSmallestPostGameTick;
 
-			// We have to do a check now in case the conditions are already met
-			if(take_mytm_mutex())
-			{
-				hub_check_for_completion();
-				release_mytm_mutex();
-			}
-			
-			// Now we should wait/sleep for the rest of the machinery to wind down
-			// Packet handler will set sHubActive = false once it has acks from all connected players;
-			while(sHubActive)
-			{
-// Here we try to isolate the "Classic" Mac OS (we can only sleep on the others)
-				SDL_Delay(10);
-			}
+			hub_check_for_completion();
+			release_mytm_mutex();
 		}
-		else
-		{		
-			// Stop processing incoming packets (packet processor won't start processing another packet
-			// due to sHubActive = false, and we know it's not in the middle of processing one because
-			// we take the mutex).
-			if(take_mytm_mutex())
-			{
-				sHubActive = false;
-				release_mytm_mutex();
-			}
+
+		// Now we should wait/sleep for the rest of the machinery to wind down
+		// Packet handler will set mHubActive = false once it has acks from all connected players;
+		while(inGame->mHubActive)
+		{
+// Here we try to isolate the "Classic" Mac OS (we can only sleep on the others)
+			SDL_Delay(10);
 		}
-	
+	}
+
+	// Stop processing incoming packets and ticks for the game (neither will pick it up
+	// again, and we know neither is in the middle of it because we take the mutex).
+	bool theLastGame = false;
+	if(take_mytm_mutex())
+	{
+		inGame->mHubActive = false;
+		sHubGames.erase(std::find(sHubGames.begin(), sHubGames.end(), inGame));
+		if(sHub == inGame)
+			sHub = NULL;
+		theLastGame = sHubGames.empty();
+		release_mytm_mutex();
+	}
+
+	if(theLastGame)
+	{
 		// Mark the tick task for cancellation (it won't start running again after this returns).
 		myTMRemove(sHubTickTask);
 		sHubTickTask = NULL;
-	
+
 		// This waits for the tick task to actually finish - so we know the tick task isn't in
 		// the middle of processing when we do the rest of the cleanup below.
 		myTMCleanup(true);
-		
-		sNetworkPlayers.clear();
-		sFlagsQueues.clear();
-		sLateFlagsQueues.clear();
 
-		sAddressToPlayerIndex.clear();
 		NetDDPDisposeFrame(sOutgoingFrame);
 		sOutgoingFrame = NULL;
 
@@ -616,6 +735,45 @@ hub_cleanup(bool inGraceful, int32 inSmallestPostGameTick)
 		}
 #endif
 	}
+
+	delete inGame;
+}
+
+
+
+void
+hub_cleanup(bool inGraceful, int32 inSmallestPostGameTick)
+{
+	// A game client's hub has the one game
+	while(!sHubGames.empty())
+		cleanup_game(sHubGames.back(), inGraceful, inSmallestPostGameTick);
+}
+
+
+
+// Ticks every game, in the order they started; their packets go out together
+static bool
+hub_tick_games()
+{
+#ifdef A1_NETWORK_STANDALONE_HUB
+	uint64_t theStart = SDL_GetPerformanceCounter();
+#endif
+
+	NetDDPBeginBatch();
+	for(size_t i = 0; i < sHubGames.size(); i++)
+	{
+		sHub = sHubGames[i];
+		hub_tick();
+	}
+	NetDDPFlushBatch();
+
+#ifdef A1_NETWORK_STANDALONE_HUB
+	sHubTickCounts += SDL_GetPerformanceCounter() - theStart;
+	sHubTicksTimed++;
+#endif
+
+	// We want to run again.
+	return true;
 }
 
 
@@ -623,14 +781,14 @@ hub_cleanup(bool inGraceful, int32 inSmallestPostGameTick)
 static void
 hub_check_for_completion()
 {
-	// When all players (including the local spoke) have either ACKed up to sSmallestPostGameTick
+	// When all players (including the local spoke) have either ACKed up to sHub->mSmallestPostGameTick
 	// or become disconnected, we're clear to cleanup.  (In other words, we should avoid cleaning
 	// up if there are connected players that haven't ACKed up to the game's end tick.)
 	bool someoneStillActive = false;
-	for(size_t i = 0; i < sNetworkPlayers.size(); i++)
+	for(size_t i = 0; i < sHub->mNetworkPlayers.size(); i++)
 	{
-		NetworkPlayer_hub& thePlayer = sNetworkPlayers[i];
-		if(thePlayer.mConnected && thePlayer.mSmallestUnacknowledgedTick < sSmallestPostGameTick)
+		NetworkPlayer_hub& thePlayer = sHub->mNetworkPlayers[i];
+		if(thePlayer.mConnected && thePlayer.mSmallestUnacknowledgedTick < sHub->mSmallestPostGameTick)
 		{
 			someoneStillActive = true;
 			break;
@@ -638,11 +796,43 @@ hub_check_for_completion()
 	}
 
 	if(!someoneStillActive)
-		sHubActive = false;
+		sHub->mHubActive = false;
 }
 		
 
 
+// The game a packet is for: the one its sender plays in, failing that the one
+// a relay names, failing that the newest (whose players' addresses may not be
+// known yet)
+static HubGame*
+game_for_packet(uint16 inPacketMagic, DDPPacketBufferPtr inPacket)
+{
+	if(sHubGames.size() <= 1)
+		return sHubGames.empty() ? NULL : sHubGames.front();
+
+	for(size_t i = 0; i < sHubGames.size(); i++)
+	{
+		if(sHubGames[i]->mAddressToPlayerIndex.count(inPacket->sourceAddress))
+			return sHubGames[i];
+	}
+
+	if(inPacketMagic == kRelayFlagsRequestPacket && inPacket->datagramSize >= kStarPacketHeaderSize + 4)
+	{
+		const byte* theIdentifierBytes = inPacket->datagramData + kStarPacketHeaderSize;
+		uint32 theGameIdentifier = (uint32(theIdentifierBytes[0]) << 24) | (uint32(theIdentifierBytes[1]) << 16) |
+			(uint32(theIdentifierBytes[2]) << 8) | uint32(theIdentifierBytes[3]);
+		for(size_t i = 0; i < sHubGames.size(); i++)
+		{
+			if(sHubGames[i]->mGameIdentifier == theGameIdentifier)
+				return sHubGames[i];
+		}
+	}
+
+	return sHubGames.back();
+}
+
+
+
 void
 hub_received_network_packet(DDPPacketBufferPtr inPacket)
 {
@@ -654,8 +844,10 @@ hub_received_network_packet(DDPPacketBufferPtr inPacket)
 		uint16	thePacketMagic;
 		ps >> thePacketMagic;
 
-		// Processing packets?
-		if(!sHubActive &&
+		sHub = game_for_packet(thePacketMagic, inPacket);
+
+		// Processing packets? (pings are answered for any game, or none)
+		if((sHub == NULL || !sHub->mHubActive) &&
 		   thePacketMagic != kPingRequestPacket &&
 		   thePacketMagic != kPingResponsePacket)
 			return;
@@ -669,10 +861,10 @@ hub_received_network_packet(DDPPacketBufferPtr inPacket)
 
 		if (thePacketCRC != calculate_data_crc_ccitt(inPacket->datagramData, inPacket->datagramSize))
 		{
-			if (thePacketMagic == kSpokeToHubGameDataPacketV1Magic)
+			if (thePacketMagic == kSpokeToHubGameDataPacketV1Magic || thePacketMagic == kSpokeToHubGameDataPacketV2Magic)
 			{
-				AddressToPlayerIndexType::iterator theEntry = sAddressToPlayerIndex.find(inPacket->sourceAddress);
-				if (theEntry != sAddressToPlayerIndex.end())
+				AddressToPlayerIndexType::iterator theEntry = sHub->mAddressToPlayerIndex.find(inPacket->sourceAddress);
+				if (theEntry != sHub->mAddressToPlayerIndex.end())
 				{
 					int theSenderIndex = theEntry->second;
 					getNetworkPlayer(theSenderIndex).mStats.errors++;
@@ -684,21 +876,22 @@ hub_received_network_packet(DDPPacketBufferPtr inPacket)
                 switch(thePacketMagic)
                 {
                         case kSpokeToHubGameDataPacketV1Magic:
+                        case kSpokeToHubGameDataPacketV2Magic:
 			{
 				// Find sender
-				AddressToPlayerIndexType::iterator theEntry = sAddressToPlayerIndex.find(inPacket->sourceAddress);
-				if(theEntry == sAddressToPlayerIndex.end())
+				AddressToPlayerIndexType::iterator theEntry = sHub->mAddressToPlayerIndex.find(inPacket->sourceAddress);
+				if(theEntry == sHub->mAddressToPlayerIndex.end())
 					return;
 				
 				int theSenderIndex = theEntry->second;
 				
 				if (getNetworkPlayer(theSenderIndex).mConnected)
 				{
-					hub_received_game_data_packet_v1(ps, theSenderIndex);
+					hub_received_game_data_packet_v1(ps, theSenderIndex, thePacketMagic == kSpokeToHubGameDataPacketV2Magic);
 				}
 				else
 				{
-					// Unconnected players should not have entries in sAddressToPlayerIndex
+					// Unconnected players should not have entries in sHub->mAddressToPlayerIndex
 					logWarningNMT("received game data packet from disconnected player %i; ignoring", theSenderIndex);
 				}
 			}
@@ -711,6 +904,10 @@ hub_received_network_packet(DDPPacketBufferPtr inPacket)
 					case kPingRequestPacket:
 						hub_received_ping_request(ps, inPacket->sourceAddress);
 						break;
+
+			case kRelayFlagsRequestPacket:
+				hub_received_relay_request(ps, inPacket->sourceAddress);
+				break;
 						
 					case kPingResponsePacket:
 						hub_received_ping_response(ps, inPacket->sourceAddress);
@@ -734,11 +931,25 @@ hub_received_identification_packet(AIStream& ps, NetAddrBlock address)
 {
 	int16 theSenderIndex;
 	ps >> theSenderIndex;
+
+	if (theSenderIndex < 0 || theSenderIndex >= (int16)sHub->mNetworkPlayers.size())
+		return;
 	
-	if (!sNetworkPlayers[theSenderIndex].mAddressKnown) {
-		sAddressToPlayerIndex[address] = theSenderIndex;
-		sNetworkPlayers[theSenderIndex].mAddressKnown = true;
-		sNetworkPlayers[theSenderIndex].mAddress = address;
+	if (!sHub->mNetworkPlayers[theSenderIndex].mAddressKnown) {
+		sHub->mAddressToPlayerIndex[address] = theSenderIndex;
+		sHub->mNetworkPlayers[theSenderIndex].mAddressKnown = true;
+		sHub->mNetworkPlayers[theSenderIndex].mAddress = address;
+	}
+
+	// Options, from spokes new enough to send them
+	if (ps.tellg() < ps.maxg())
+	{
+		uint8 theOptions;
+		ps >> theOptions;
+
+		AddressToPlayerIndexType::iterator theEntry = sHub->mAddressToPlayerIndex.find(address);
+		if (theEntry != sHub->mAddressToPlayerIndex.end() && theEntry->second == theSenderIndex)
+			sHub->mNetworkPlayers[theSenderIndex].mCompressedFlags = (theOptions & kIdentificationOffersCompressedFlags) != 0;
 	}
 
 } // hub_received_idetification_packet()
@@ -799,20 +1010,63 @@ hub_received_ping_response(AIStream& ps, NetAddrBlock address)
 } // hub_received_ping_response()
 
 
+static void
+hub_received_relay_request(AIStream& ps, NetAddrBlock address)
+{
+	uint32 theGameIdentifier;
+	int32 theSmallestUnacknowledgedTick;
+	ps >> theGameIdentifier >> theSmallestUnacknowledgedTick;
+
+	std::vector<RelaySubscriber>::iterator theRelay = sHub->mRelays.begin();
+	while(theRelay != sHub->mRelays.end() && !(theRelay->mAddress.host == address.host && theRelay->mAddress.port == address.port))
+		++theRelay;
+
+	// a new subscriber starts at the very beginning, so its spectators can too
+	if(theGameIdentifier != sHub->mGameIdentifier || theRelay == sHub->mRelays.end())
+		theSmallestUnacknowledgedTick = sHub->mFirstTick;
+
+	if(theSmallestUnacknowledgedTick < sHub->mPlayerDataDisposition.getReadTick() || theSmallestUnacknowledgedTick > sHub->mSmallestIncompleteTick)
+	{
+		if(theRelay != sHub->mRelays.end())
+		{
+			logWarningNMT("relay fell behind at tick %d; dropping it", theSmallestUnacknowledgedTick);
+			sHub->mRelays.erase(theRelay);
+		}
+		return;
+	}
+
+	if(theRelay == sHub->mRelays.end())
+	{
+		if(sHub->mRelays.size() >= kMaximumRelays)
+			return;
+
+		logNoteNMT("relay subscribed");
+		RelaySubscriber theNewRelay;
+		theNewRelay.mAddress = address;
+		theNewRelay.mSmallestUnacknowledgedTick = theSmallestUnacknowledgedTick;
+		sHub->mRelays.push_back(theNewRelay);
+		theRelay = sHub->mRelays.end() - 1;
+	}
+
+	theRelay->mSmallestUnacknowledgedTick = std::max(theRelay->mSmallestUnacknowledgedTick, theSmallestUnacknowledgedTick);
+	theRelay->mLastNetworkTickHeard = sHub->mNetworkTicker;
+} // hub_received_relay_request()
+
+
 // I suppose to be safer, this should check the entire packet before acting on any of it.
 // As it stands, a malformed packet could have have a well-formed prefix of it interpreted
 // before the remainder is discarded.
 static void
-hub_received_game_data_packet_v1(AIStream& ps, int inSenderIndex)
+hub_received_game_data_packet_v1(AIStream& ps, int inSenderIndex, bool inCompressedFlags)
 {
         // Process the piggybacked acknowledgement
         int32	theSmallestUnacknowledgedTick;
         ps >> theSmallestUnacknowledgedTick;
 
         // If ack is too soon we throw out the entire packet to be safer
-        if(theSmallestUnacknowledgedTick > sSmallestIncompleteTick)
+        if(theSmallestUnacknowledgedTick > sHub->mSmallestIncompleteTick)
         {
-                logAnomalyNMT("received ack from player %d for tick %d; have only sent up to %d", inSenderIndex, theSmallestUnacknowledgedTick, sSmallestIncompleteTick);
+                logAnomalyNMT("received ack from player %d for tick %d; have only sent up to %d", inSenderIndex, theSmallestUnacknowledgedTick, sHub->mSmallestIncompleteTick);
                 return;
         }                
 
@@ -833,8 +1087,26 @@ hub_received_game_data_packet_v1(AIStream& ps, int inSenderIndex)
         int32	theStartTick;
         ps >> theStartTick;
 
+	// Runs of flags are expanded first, so everything from here on reads plain flags
+	uint32	theExpandedLength = 0;
+	if(inCompressedFlags)
+	{
+		AOStreamBE theExpander(sExpandedFlags, sizeof(sExpandedFlags));
+		while(ps.tellg() < ps.maxg())
+		{
+			uint8 theRepeats;
+			action_flags_t theActionFlags;
+			ps >> theRepeats >> theActionFlags;
+			for(int i = 0; i <= theRepeats; i++)
+				theExpander << theActionFlags;
+		}
+		theExpandedLength = theExpander.tellp();
+	}
+	AIStreamBE theExpandedFlagsStream(sExpandedFlags, theExpandedLength);
+	AIStream& fs = inCompressedFlags ? theExpandedFlagsStream : ps;
+
         // Make sure there's an integral number of action_flags
-        int	theRemainingDataLength = ps.maxg() - ps.tellg();
+        int	theRemainingDataLength = fs.maxg() - fs.tellg();
         if(theRemainingDataLength % kActionFlagsSerializedLength != 0)
                 return;
 
@@ -853,7 +1125,7 @@ hub_received_game_data_packet_v1(AIStream& ps, int inSenderIndex)
 	{
 		while (theLateQueue.getWriteTick() < theQueue.getWriteTick())
 		{
-			theLateQueue.enqueue(sLastFlagsReceived[inSenderIndex]);
+			theLateQueue.enqueue(sHub->mLastFlagsReceived[inSenderIndex]);
 			theLateQueue.dequeue();
 		}
 	}
@@ -862,7 +1134,7 @@ hub_received_game_data_packet_v1(AIStream& ps, int inSenderIndex)
 //        int	theRedundantActionFlagsCount = std::min(theQueue.getWriteTick() - theStartTick, theActionFlagsCount);
 	int     theRedundantActionFlagsCount = std::min(theLateQueue.getWriteTick() - theStartTick, theActionFlagsCount);
 	int	theRedundantDataLength = theRedundantActionFlagsCount * kActionFlagsSerializedLength;
-	ps.ignore(theRedundantDataLength);
+	fs.ignore(theRedundantDataLength);
 
 	assert(theQueue.getWriteTick() >= theLateQueue.getWriteTick());
 	// Enqueue late flags
@@ -870,15 +1142,15 @@ hub_received_game_data_packet_v1(AIStream& ps, int inSenderIndex)
 	for (int i = 0; i < theLateActionFlagsCount; i++)
 	{
 		action_flags_t theActionFlags;
-		ps >> theActionFlags;
+		fs >> theActionFlags;
 		// we consume these faster than we enqueue them (hopefully)
 		// so, not checking for capacity though we probably should
 		theLateQueue.enqueue(theActionFlags);
-		sLastFlagsReceived[inSenderIndex] = theActionFlags;
+		sHub->mLastFlagsReceived[inSenderIndex] = theActionFlags;
 	}
 
         // Enqueue flags that are new to us
-        int	theRemainingQueueSpace = (sPlayerDataDisposition.getReadTick() < sSmallestRealGameTick && theQueue.size() > sHubPreferences.mPregameWindowSize) ? 0 : theQueue.availableCapacity();
+        int	theRemainingQueueSpace = (sHub->mPlayerDataDisposition.getReadTick() < sHub->mSmallestRealGameTick && theQueue.size() > sHubPreferences.mPregameWindowSize) ? 0 : theQueue.availableCapacity();
 	int theUsefulActionFlagsCount = theActionFlagsCount - theRedundantActionFlagsCount - theLateActionFlagsCount;
         int	theEnqueueableFlagsCount = std::min(theUsefulActionFlagsCount, theRemainingQueueSpace);
 
@@ -887,15 +1159,21 @@ hub_received_game_data_packet_v1(AIStream& ps, int inSenderIndex)
         for(int i = 0; i < theEnqueueableFlagsCount; i++)
         {
                 action_flags_t theActionFlags;
-                ps >> theActionFlags;
+                fs >> theActionFlags;
                 theQueue.enqueue(theActionFlags);
 		theLateQueue.enqueue(theActionFlags);
-		sLastFlagsReceived[inSenderIndex] = theActionFlags;
+		sHub->mLastFlagsReceived[inSenderIndex] = theActionFlags;
         }
 
 	// Update timing data
 	NetworkPlayer_hub& thePlayer = getNetworkPlayer(inSenderIndex);
-	NetworkPlayer_hub& theReferencePlayer = getNetworkPlayer(sReferencePlayerIndex);
+	NetworkPlayer_hub& theReferencePlayer = getNetworkPlayer(sHub->mReferencePlayerIndex);
+
+	// The spoke sends a packet every tick with all the flags we haven't ACKed, so
+	// more than one new tick in a packet means the ones in between went missing
+	if(theStartTick + theActionFlagsCount > thePlayer.mSmallestUnheardTick + 1)
+		thePlayer.mPacketsLostThisSecond += theStartTick + theActionFlagsCount - thePlayer.mSmallestUnheardTick - 1;
+
 	while(thePlayer.mSmallestUnheardTick < theStartTick + theActionFlagsCount)
 	{
 		int32 theReferenceTick = theReferencePlayer.mSmallestUnheardTick;
@@ -906,28 +1184,28 @@ hub_received_game_data_packet_v1(AIStream& ps, int inSenderIndex)
 	}
 
         // Make the pregame -> ingame transition
-        if(thePlayer.mSmallestUnheardTick >= sSmallestRealGameTick && static_cast<int32>(thePlayer.mNthElementFinder.window_size()) != sHubPreferences.mInGameWindowSize)
+        if(thePlayer.mSmallestUnheardTick >= sHub->mSmallestRealGameTick && static_cast<int32>(thePlayer.mNthElementFinder.window_size()) != sHubPreferences.mInGameWindowSize)
 		thePlayer.mNthElementFinder.reset(sHubPreferences.mInGameWindowSize);
 
 	if(thePlayer.mOutstandingTimingAdjustment == 0 && thePlayer.mNthElementFinder.window_full())
 	{
-		thePlayer.mOutstandingTimingAdjustment = thePlayer.mNthElementFinder.nth_smallest_element((thePlayer.mSmallestUnheardTick >= sSmallestRealGameTick) ? sHubPreferences.mInGameNthElement : sHubPreferences.mPregameNthElement);
+		thePlayer.mOutstandingTimingAdjustment = thePlayer.mNthElementFinder.nth_smallest_element((thePlayer.mSmallestUnheardTick >= sHub->mSmallestRealGameTick) ? thePlayer.mInGameNthElement : sHubPreferences.mPregameNthElement);
 
 		if(thePlayer.mOutstandingTimingAdjustment != 0)
 		{
-			thePlayer.mTimingAdjustmentTick = sSmallestIncompleteTick;
-			logTraceNMT("tick %d: asking player %d to adjust timing by %d", sSmallestIncompleteTick, inSenderIndex, thePlayer.mOutstandingTimingAdjustment);
+			thePlayer.mTimingAdjustmentTick = sHub->mSmallestIncompleteTick;
+			logTraceNMT("tick %d: asking player %d to adjust timing by %d", sHub->mSmallestIncompleteTick, inSenderIndex, thePlayer.mOutstandingTimingAdjustment);
 
 #ifdef DEBUG_TIMING_ADJUSTMENTS
-			if (debug_timing_adjustments && thePlayer.mSmallestUnheardTick >= sSmallestRealGameTick)
+			if (debug_timing_adjustments && thePlayer.mSmallestUnheardTick >= sHub->mSmallestRealGameTick)
 			{
-				dout << sNetworkTicker
+				dout << sHub->mNetworkTicker
 				     << ": "
 				     << "P" << inSenderIndex
 				     << " "
 				     << "H" << thePlayer.mLastNetworkTickHeard
 				     << " "
-				     << "T" << sSmallestIncompleteTick
+				     << "T" << sHub->mSmallestIncompleteTick
 				     << " "
 				     << "A" << thePlayer.mSmallestUnacknowledgedTick
 				     << " "
@@ -940,25 +1218,23 @@ hub_received_game_data_packet_v1(AIStream& ps, int inSenderIndex)
 				     << thePlayer.mStats.jitter
 				     << " " << reinterpret_cast<player_info*>(NetGetPlayerData(inSenderIndex))->name
 				     << std::endl;
-				dout << "S";
+				// the smallest, middle and largest 20, in one go
+				unsigned int theWindowSize = thePlayer.mNthElementFinder.window_size();
+				unsigned int theIndices[60];
+				int32 theElements[60];
 				for (int i = 0; i < 20; ++i)
 				{
-					dout << std::setw(3) 
-					     << thePlayer.mNthElementFinder.nth_smallest_element(i)
-					     << " ";
-				}
-				dout << "M";
-				for (int i = kDefaultInGameWindowSize / 2 - 10; i < kDefaultInGameWindowSize / 2 + 10; ++i)
-				{
-					dout << std::setw(3)
-					     << thePlayer.mNthElementFinder.nth_smallest_element(i)
-					     << " ";
+					theIndices[i] = i;
+					theIndices[20 + i] = kDefaultInGameWindowSize / 2 - 10 + i;
+					theIndices[40 + i] = theWindowSize - 20 + i;
 				}
-				dout << "L";
-				for (int i = 19; i >= 0; --i)
+				thePlayer.mNthElementFinder.nth_smallest_elements(theIndices, 60, theElements);
+				for (int i = 0; i < 60; ++i)
 				{
+					if (i % 20 == 0)
+						dout << "SML"[i / 20];
 					dout << std::setw(3)
-					     << thePlayer.mNthElementFinder.nth_largest_element(i)
+					     << theElements[i]
 					     << " ";
 				}
 				dout << std::endl;
@@ -972,9 +1248,9 @@ hub_received_game_data_packet_v1(AIStream& ps, int inSenderIndex)
         // Do any needed post-processing
         if(theEnqueueableFlagsCount > 0)
         {
-		// Actually the shouldSend business is probably unnecessary now with sSmallestUnsentTick
+		// Actually the shouldSend business is probably unnecessary now with sHub->mSmallestUnsentTick
                 bool shouldSend = player_provided_flags_from_tick_to_tick(inSenderIndex, theStartTick + theRedundantActionFlagsCount + theLateActionFlagsCount, theStartTick + theRedundantActionFlagsCount + theEnqueueableFlagsCount + theLateActionFlagsCount);
-                if(shouldSend && (sSmallestIncompleteTick - sSmallestUnsentTick >= sHubPreferences.mSendPeriod))
+                if(shouldSend && (sHub->mSmallestIncompleteTick - sHub->mSmallestUnsentTick >= sHubPreferences.mSendPeriod))
                         send_packets();
         }
 } // hub_received_game_data_packet_v1()
@@ -992,18 +1268,18 @@ player_acknowledged_up_to_tick(size_t inPlayerIndex, int32 inSmallestUnacknowled
                 return;
 
         // We've heard from this player
-        thePlayer.mLastNetworkTickHeard = sNetworkTicker;
+        thePlayer.mLastNetworkTickHeard = sHub->mNetworkTicker;
 
         // Mark us ACKed for each intermediate tick
         for(int theTick = thePlayer.mSmallestUnacknowledgedTick; theTick < inSmallestUnacknowledgedTick; theTick++)
         {
-		logDumpNMT("tick %d: sPlayerDataDisposition=%d", theTick, sPlayerDataDisposition[theTick]);
+		logDumpNMT("tick %d: sHub->mPlayerDataDisposition=%d", theTick, sHub->mPlayerDataDisposition[theTick]);
 		
-                assert(sPlayerDataDisposition[theTick] & (((uint32)1) << inPlayerIndex));
-                sPlayerDataDisposition[theTick] &= ~(((uint32)1) << inPlayerIndex);
-		if (inPlayerIndex != sLocalPlayerIndex) 
+                assert(sHub->mPlayerDataDisposition[theTick] & (((uint32)1) << inPlayerIndex));
+                sHub->mPlayerDataDisposition[theTick] &= ~(((uint32)1) << inPlayerIndex);
+		if (inPlayerIndex != sHub->mLocalPlayerIndex) 
 		{
-			assert(theTick < sFlagSendTimeQueue.getWriteTick());
+			assert(theTick < sHub->mFlagSendTimeQueue.getWriteTick());
 
 			// update the latency calculations
 			if (thePlayer.mLatencyBuffer.size() >= kDisplayLatencyWindow)
@@ -1015,27 +1291,28 @@ player_acknowledged_up_to_tick(size_t inPlayerIndex, int32 inSmallestUnacknowled
 			{
 				thePlayer.mLatencyBuffer.pop_back();
 			}
-			int32 latency = sNetworkTicker - sFlagSendTimeQueue.peek(theTick);
+			int32 latency = sHub->mNetworkTicker - sHub->mFlagSendTimeQueue.peek(theTick);
 			thePlayer.mLatencyBuffer.push_front(latency);
 			thePlayer.mLatencyTicks += latency;
+			add_to_histogram(thePlayer.mHistograms.rtt, latency);
 
 		}
 			
-                if(sPlayerDataDisposition[theTick] == 0)
+                if(sHub->mPlayerDataDisposition[theTick] == 0)
                 {
-                        assert(theTick == sPlayerDataDisposition.getReadTick());
-			assert(theTick == sFlagSendTimeQueue.getReadTick());
-			assert(theTick == sPlayerReflectedFlags.getReadTick());
+                        assert(theTick == sHub->mPlayerDataDisposition.getReadTick());
+			assert(theTick == sHub->mFlagSendTimeQueue.getReadTick());
+			assert(theTick == sHub->mPlayerReflectedFlags.getReadTick());
                         
-                        sPlayerDataDisposition.dequeue();
-			sFlagSendTimeQueue.dequeue();
-			sPlayerReflectedFlags.dequeue();
-                        for(size_t i = 0; i < sFlagsQueues.size(); i++)
+                        sHub->mPlayerDataDisposition.dequeue();
+			sHub->mFlagSendTimeQueue.dequeue();
+			sHub->mPlayerReflectedFlags.dequeue();
+                        for(size_t i = 0; i < sHub->mFlagsQueues.size(); i++)
                         {
-                                if(sFlagsQueues[i].size() > 0)
+                                if(sHub->mFlagsQueues[i].size() > 0)
                                 {
-                                        assert(sFlagsQueues[i].getReadTick() == theTick);
-                                        sFlagsQueues[i].dequeue();
+                                        assert(sHub->mFlagsQueues[i].getReadTick() == theTick);
+                                        sHub->mFlagsQueues[i].dequeue();
                                 }
                         }
                 }
@@ -1059,31 +1336,31 @@ static bool make_up_flags_for_first_incomplete_tick()
 {
 	// find the smallest incomplete tick, and make up flags for anybody in that tick!
 	
-	if (sPlayerDataDisposition.getWriteTick() == sSmallestIncompleteTick) 
+	if (sHub->mPlayerDataDisposition.getWriteTick() == sHub->mSmallestIncompleteTick) 
 		// we don't have flags for anybody!
 		return false;
 
 	// never make up flags for ourself
-	if (getFlagsQueue(sLocalPlayerIndex).getWriteTick() == sSmallestIncompleteTick)
+	if (sHub->mLocalPlayerIndex != (size_t)NONE && getFlagsQueue(sHub->mLocalPlayerIndex).getWriteTick() == sHub->mSmallestIncompleteTick)
 		return false;
 
 	// check to make sure everyone we want to make up flags for is in the lagging players bitmask
-	for (int i = 0; i < sNetworkPlayers.size(); i++)
+	for (int i = 0; i < sHub->mNetworkPlayers.size(); i++)
 	{
-		if (getFlagsQueue(i).getWriteTick() == sSmallestIncompleteTick && !(sLaggingPlayersBitmask & (1 << i)))
+		if (getFlagsQueue(i).getWriteTick() == sHub->mSmallestIncompleteTick && !(sHub->mLaggingPlayersBitmask & (1 << i)))
 			return false;
 	}
 
-	logTraceNMT("making up flags for tick %i", sSmallestIncompleteTick);
+	logTraceNMT("making up flags for tick %i", sHub->mSmallestIncompleteTick);
 
-	for (int i = 0; i < sNetworkPlayers.size(); i++)
+	for (int i = 0; i < sHub->mNetworkPlayers.size(); i++)
 	{
-		if (getFlagsQueue(i).getWriteTick() == sSmallestIncompleteTick)
+		if (getFlagsQueue(i).getWriteTick() == sHub->mSmallestIncompleteTick)
 		{
 			// network code shouldn't figure this out, someone else should
 			action_flags_t motionFlags;
 			TickBasedActionQueue& theLateQueue = getLateFlagsQueue(i);
-			if (sLaggingPlayersBitmask & (1 << i) && theLateQueue.getWriteTick() > theLateQueue.getReadTick())
+			if (sHub->mLaggingPlayersBitmask & (1 << i) && theLateQueue.getWriteTick() > theLateQueue.getReadTick())
 			{
 				uint32 midpoint = ((theLateQueue.getWriteTick() - theLateQueue.getReadTick()) / 2 + theLateQueue.getReadTick());
 				// collapse the queue up to the midpoint
@@ -1101,16 +1378,17 @@ static bool make_up_flags_for_first_incomplete_tick()
 			} 
 			else
 			{
-				motionFlags = sLastFlagsReceived[i] & (_moving | _sidestepping);
-				if (local_random() % 10 > 8) sLastFlagsReceived[i] = 0;
+				motionFlags = sHub->mLastFlagsReceived[i] & (_moving | _sidestepping);
+				if (local_random() % 10 > 8) sHub->mLastFlagsReceived[i] = 0;
 			}
-			sPlayerReflectedFlags[sSmallestIncompleteTick] |= (1 << i);
+			sHub->mPlayerReflectedFlags[sHub->mSmallestIncompleteTick] |= (1 << i);
 			getFlagsQueue(i).enqueue(motionFlags);
+			sHub->mNetworkPlayers[i].mLateFlagsThisSecond++;
 		}
 	}
-	sPlayerDataDisposition[sSmallestIncompleteTick] = sConnectedPlayersBitmask;
-	sSmallestIncompleteTick++;
-	sLastRealUpdate = sNetworkTicker;
+	sHub->mPlayerDataDisposition[sHub->mSmallestIncompleteTick] = sHub->mConnectedPlayersBitmask;
+	sHub->mSmallestIncompleteTick++;
+	sHub->mLastRealUpdate = sHub->mNetworkTicker;
 	return true;
 }
 
@@ -1122,38 +1400,38 @@ player_provided_flags_from_tick_to_tick(size_t inPlayerIndex, int32 inFirstNewTi
 	
         bool shouldSend = false;
 
-	assert(sPlayerDataDisposition.getWriteTick() == sPlayerReflectedFlags.getWriteTick());
+	assert(sHub->mPlayerDataDisposition.getWriteTick() == sHub->mPlayerReflectedFlags.getWriteTick());
 
-        for(int i = sPlayerDataDisposition.getWriteTick(); i < inSmallestUnreceivedTick; i++)
+        for(int i = sHub->mPlayerDataDisposition.getWriteTick(); i < inSmallestUnreceivedTick; i++)
         {
-		logDumpNMT("tick %d: enqueueing sPlayerDataDisposition %d", i, sConnectedPlayersBitmask);
-                sPlayerDataDisposition.enqueue(sConnectedPlayersBitmask);
-		sPlayerReflectedFlags.enqueue(0);
+		logDumpNMT("tick %d: enqueueing sHub->mPlayerDataDisposition %d", i, sHub->mConnectedPlayersBitmask);
+                sHub->mPlayerDataDisposition.enqueue(sHub->mConnectedPlayersBitmask);
+		sHub->mPlayerReflectedFlags.enqueue(0);
         }
 
         for(int i = inFirstNewTick; i < inSmallestUnreceivedTick; i++)
         {
-		logDumpNMT("tick %d: sPlayerDataDisposition=%d", i, sPlayerDataDisposition[i]);
+		logDumpNMT("tick %d: sHub->mPlayerDataDisposition=%d", i, sHub->mPlayerDataDisposition[i]);
 		
-                assert(sPlayerDataDisposition[i] & (((uint32)1) << inPlayerIndex));
-                sPlayerDataDisposition[i] &= ~(((uint32)1) << inPlayerIndex);
+                assert(sHub->mPlayerDataDisposition[i] & (((uint32)1) << inPlayerIndex));
+                sHub->mPlayerDataDisposition[i] &= ~(((uint32)1) << inPlayerIndex);
 		
 		// remove the player from the list of lagging players, and
 		// dequeue his late flags
-		sLaggingPlayersBitmask &= ~(((uint32)1) << inPlayerIndex);
+		sHub->mLaggingPlayersBitmask &= ~(((uint32)1) << inPlayerIndex);
 		TickBasedActionQueue& theLateQueue = getLateFlagsQueue(inPlayerIndex);
 		while (theLateQueue.getReadTick() < theLateQueue.getWriteTick())
 			theLateQueue.dequeue();
 
-                if(sPlayerDataDisposition[i] == 0)
+                if(sHub->mPlayerDataDisposition[i] == 0)
                 {
-                        assert(sSmallestIncompleteTick == i);
-                        sSmallestIncompleteTick++;
-			sLastRealUpdate = sNetworkTicker;
+                        assert(sHub->mSmallestIncompleteTick == i);
+                        sHub->mSmallestIncompleteTick++;
+			sHub->mLastRealUpdate = sHub->mNetworkTicker;
                         shouldSend = true;
 
                         // Now people need to ACK
-                        sPlayerDataDisposition[i] = sConnectedPlayersBitmask;
+                        sHub->mPlayerDataDisposition[i] = sHub->mConnectedPlayersBitmask;
                 }
 
         } // loop over ticks with new data
@@ -1192,7 +1470,7 @@ process_messages(AIStream& ps, int inSenderIndex)
 static void
 process_lossy_byte_stream_message(AIStream& ps, int inSenderIndex, uint16 inLength)
 {
-	assert(inSenderIndex >= 0 && inSenderIndex < static_cast<int>(sNetworkPlayers.size()));
+	assert(inSenderIndex >= 0 && inSenderIndex < static_cast<int>(sHub->mNetworkPlayers.size()));
 
 	HubLossyByteStreamChunkDescriptor theDescriptor;
 
@@ -1205,14 +1483,14 @@ process_lossy_byte_stream_message(AIStream& ps, int inSenderIndex, uint16 inLeng
 
 	bool canEnqueue = true;
 	
-	if(sOutgoingLossyByteStreamDescriptors.getRemainingSpace() < 1)
+	if(sHub->mOutgoingLossyByteStreamDescriptors.getRemainingSpace() < 1)
 	{
 		logNoteNMT("no descriptor space remains; discarding (%uh) bytes of lossy streaming data of distribution type %hd from player %hu destined for 0x%lx", theDescriptor.mLength, theDescriptor.mType, theDescriptor.mSender, theDescriptor.mDestinations);
 		canEnqueue = false;
 	}
 
 	// We avoid enqueueing a partial chunk to make things easier on code that uses us
-	if(theDescriptor.mLength > sOutgoingLossyByteStreamData.getRemainingSpace())
+	if(theDescriptor.mLength > sHub->mOutgoingLossyByteStreamData.getRemainingSpace())
 	{
 		logNoteNMT("insufficient buffer space for %uh bytes of lossy streaming data of distribution type %hd from player %hu destined for 0x%lx; discarded", theDescriptor.mLength, theDescriptor.mType, theDescriptor.mSender, theDescriptor.mDestinations);
 		canEnqueue = false;
@@ -1230,8 +1508,8 @@ process_lossy_byte_stream_message(AIStream& ps, int inSenderIndex, uint16 inLeng
 			// XXX extraneous copy, needed given the current interfaces to these things
 			ps.read(sScratchBuffer, theDescriptor.mLength);
 	
-			sOutgoingLossyByteStreamData.enqueueBytes(sScratchBuffer, theDescriptor.mLength);
-			sOutgoingLossyByteStreamDescriptors.enqueue(theDescriptor);
+			sHub->mOutgoingLossyByteStreamData.enqueueBytes(sScratchBuffer, theDescriptor.mLength);
+			sHub->mOutgoingLossyByteStreamDescriptors.enqueue(theDescriptor);
 		}
 	}
 	else
@@ -1241,6 +1519,57 @@ process_lossy_byte_stream_message(AIStream& ps, int inSenderIndex, uint16 inLeng
 
 
 
+static void
+process_world_checksum_message(AIStream& ps, int inSenderIndex, uint16 inLength)
+{
+	size_t theMessageEnd = ps.tellg() + inLength;
+
+	int32 theTick;
+	WorldChecksumReport theReport;
+	ps >> theTick >> theReport.mCount;
+	if(theReport.mCount > kMaximumWorldChecksums)
+	{
+		ps.ignore(theMessageEnd - ps.tellg());
+		return;
+	}
+	for(int i = 0; i < theReport.mCount; i++)
+		ps >> theReport.mChecksums[i];
+	theReport.mReporter = inSenderIndex;
+
+	ps.ignore(theMessageEnd - ps.tellg());
+
+	std::map<int32, WorldChecksumReport>::iterator theFirstReport = sHub->mWorldChecksumReports.find(theTick);
+	if(theFirstReport == sHub->mWorldChecksumReports.end())
+	{
+		if(sHub->mWorldChecksumReports.size() >= kWorldChecksumTicksKept)
+		{
+			// a tick older than all we keep is no use as a first report
+			if(theTick < sHub->mWorldChecksumReports.begin()->first)
+				return;
+			sHub->mWorldChecksumReports.erase(sHub->mWorldChecksumReports.begin());
+		}
+		sHub->mWorldChecksumReports[theTick] = theReport;
+		return;
+	}
+
+	// one desync makes everything after it disagree too
+	const WorldChecksumReport& theOther = theFirstReport->second;
+	if(sHub->mWorldChecksumsDiverged || theOther.mCount != theReport.mCount)
+		return;
+
+	for(int i = 0; i < theReport.mCount; i++)
+	{
+		if(theOther.mChecksums[i] != theReport.mChecksums[i])
+		{
+			logWarningNMT("out of sync: players %d and %d disagree about part %d of the world at tick %d", theOther.mReporter, inSenderIndex, i, theTick);
+			sHub->mWorldChecksumsDiverged = true;
+			break;
+		}
+	}
+}
+
+
+
 static void
 process_optional_message(AIStream& ps, int inSenderIndex, uint16 inMessageType)
 {
@@ -1252,6 +1581,8 @@ process_optional_message(AIStream& ps, int inSenderIndex, uint16 inMessageType)
 
 	if(inMessageType == kSpokeToHubLossyByteStreamMessageType)
 		process_lossy_byte_stream_message(ps, inSenderIndex, theMessageLength);
+	else if(inMessageType == kSpokeToHubWorldChecksumMessageType)
+		process_world_checksum_message(ps, inSenderIndex, theMessageLength);
 	else
 	{
 		// Currently we ignore (skip) all optional messages
@@ -1271,19 +1602,38 @@ make_player_netdead(int inPlayerIndex)
 	// make sure we're not processing a packet
 	{
 		MyTMMutexTaker mutex;
-		thePlayer.mNetDeadTick = sSmallestIncompleteTick;
+		thePlayer.mNetDeadTick = sHub->mSmallestIncompleteTick;
 		thePlayer.mConnected = false;
-		sConnectedPlayersBitmask &= ~(((uint32)1) << inPlayerIndex);
-		sAddressToPlayerIndex.erase(thePlayer.mAddress);
+		sHub->mConnectedPlayersBitmask &= ~(((uint32)1) << inPlayerIndex);
+		sHub->mAddressToPlayerIndex.erase(thePlayer.mAddress);
+	}
+
+#ifdef A1_NETWORK_STANDALONE_HUB
+	// No local player to fall back on: time everyone against someone who is still here,
+	// and once nobody is, the game is over as far as we are concerned.
+	if(inPlayerIndex == sHub->mReferencePlayerIndex)
+	{
+		for(size_t i = 0; i < sHub->mNetworkPlayers.size(); i++)
+		{
+			if(sHub->mNetworkPlayers[i].mConnected)
+			{
+				sHub->mReferencePlayerIndex = i;
+				break;
+			}
+		}
 	}
 
+	if(sHub->mConnectedPlayersBitmask == 0)
+		sHub->mHubActive = false;
+#endif
+
 	// We save this off because player_provided... call below may change it.
-	int32 theSavedIncompleteTick = sSmallestIncompleteTick;
+	int32 theSavedIncompleteTick = sHub->mSmallestIncompleteTick;
 	
         // Pretend for housekeeping that he's provided data for all currently known ticks
         // We go from the first tick for which we don't actually have his data through the last
         // tick we actually know about.
-        player_provided_flags_from_tick_to_tick(inPlayerIndex, getFlagsQueue(inPlayerIndex).getWriteTick(), sPlayerDataDisposition.getWriteTick());
+        player_provided_flags_from_tick_to_tick(inPlayerIndex, getFlagsQueue(inPlayerIndex).getWriteTick(), sHub->mPlayerDataDisposition.getWriteTick());
 
         // Pretend for housekeeping that he's already acknowledged all sent ticks
         player_acknowledged_up_to_tick(inPlayerIndex, theSavedIncompleteTick);
@@ -1291,27 +1641,58 @@ make_player_netdead(int inPlayerIndex)
 
 static int add_squares(int x, int y) { return x + y * y; }
 
+// A player whose round trips hardly vary can be timed closer to the edge, so his
+// flags arrive just in time instead of sitting at the hub; and if his flags are
+// late we needn't wait the full latency tolerance to know he won't make it.
+// inDeviation is the standard deviation of his round trips, in ticks.
+static void
+adapt_player_pacing(NetworkPlayer_hub& thePlayer, double inDeviation)
+{
+	int32 theNthElement = sHubPreferences.mInGameNthElement;
+	int32 theLateTolerance = sHubPreferences.mMinimumSendPeriod;
+
+	if (sHubPreferences.mAdaptivePacing)
+	{
+		// full scale with no jitter, none from a tick of jitter on
+		double theScale = 1 + (kMaximumNthElementScale - 1) * (1 - std::min(inDeviation, 1.0));
+		int32 theScaledNthElement = std::min(static_cast<int32>(theNthElement * theScale), sHubPreferences.mInGameWindowSize / 4);
+		theNthElement = std::max(theNthElement, theScaledNthElement);
+
+		// three standard deviations, but at least half the preference
+		int32 theJitterTolerance = 1 + static_cast<int32>(std::ceil(3 * inDeviation));
+		theLateTolerance = std::max((theLateTolerance + 1) / 2, std::min(theLateTolerance, theJitterTolerance));
+	}
+
+	if (theNthElement != thePlayer.mInGameNthElement || theLateTolerance != thePlayer.mLateTolerance)
+		logDumpNMT("adaptive pacing: nth element %d, late tolerance %d (deviation %.2f ticks)", theNthElement, theLateTolerance, inDeviation);
+
+	thePlayer.mInGameNthElement = theNthElement;
+	thePlayer.mLateTolerance = theLateTolerance;
+	thePlayer.mStats.nth_element = static_cast<int16>(theNthElement);
+	thePlayer.mStats.late_tolerance = static_cast<int16>(theLateTolerance * 1000 / TICKS_PER_SECOND);
+}
+
 static bool
 hub_tick()
 {
-        sNetworkTicker++;
+        sHub->mNetworkTicker++;
 
-	logContextNMT("performing hub_tick %d", sNetworkTicker);
+	logContextNMT("performing hub_tick %d", sHub->mNetworkTicker);
 
         // Check for newly netdead players
         bool shouldSend = false;
-        for(size_t i = 0; i < sNetworkPlayers.size(); i++)
+        for(size_t i = 0; i < sHub->mNetworkPlayers.size(); i++)
         {
-                int theSilentTicksBeforeNetDeath = (sNetworkPlayers[i].mSmallestUnacknowledgedTick < sSmallestRealGameTick) ? sHubPreferences.mPregameTicksBeforeNetDeath : sHubPreferences.mInGameTicksBeforeNetDeath;
-                if (sNetworkPlayers[i].mConnected && sNetworkTicker - sNetworkPlayers[i].mLastNetworkTickHeard > theSilentTicksBeforeNetDeath)
+                int theSilentTicksBeforeNetDeath = (sHub->mNetworkPlayers[i].mSmallestUnacknowledgedTick < sHub->mSmallestRealGameTick) ? sHubPreferences.mPregameTicksBeforeNetDeath : sHubPreferences.mInGameTicksBeforeNetDeath;
+                if (sHub->mNetworkPlayers[i].mConnected && sHub->mNetworkTicker - sHub->mNetworkPlayers[i].mLastNetworkTickHeard > theSilentTicksBeforeNetDeath)
                 {
                         make_player_netdead(i);
                         shouldSend = true;
                 }
 		// if this guy's last ACK was longer ago than the queues have space to store things, I guess dump him
-		else if (i != sLocalPlayerIndex && sNetworkPlayers[i].mConnected && sNetworkPlayers[i].mSmallestUnacknowledgedTick >= sSmallestRealGameTick && (sNetworkPlayers[sReferencePlayerIndex].mSmallestUnacknowledgedTick - sNetworkPlayers[i].mSmallestUnacknowledgedTick) >= kFlagsQueueSize) {
+		else if (i != sHub->mLocalPlayerIndex && sHub->mNetworkPlayers[i].mConnected && sHub->mNetworkPlayers[i].mSmallestUnacknowledgedTick >= sHub->mSmallestRealGameTick && (sHub->mNetworkPlayers[sHub->mReferencePlayerIndex].mSmallestUnacknowledgedTick - sHub->mNetworkPlayers[i].mSmallestUnacknowledgedTick) >= kFlagsQueueSize) {
 			{
-				logWarningNMT("Disconnecting player %i for late ACKs (last ACK %i, reference ACK %i", i, sNetworkPlayers[i].mSmallestUnacknowledgedTick, sNetworkPlayers[sReferencePlayerIndex].mSmallestUnacknowledgedTick);
+				logWarningNMT("Disconnecting player %i for late ACKs (last ACK %i, reference ACK %i", i, sHub->mNetworkPlayers[i].mSmallestUnacknowledgedTick, sHub->mNetworkPlayers[sHub->mReferencePlayerIndex].mSmallestUnacknowledgedTick);
 				make_player_netdead(i);
 				shouldSend = true;
 			}
@@ -1321,33 +1702,34 @@ hub_tick()
 			
 	// if we're getting behind, make up flags
 	
-	if (sHubPreferences.mBandwidthReduction && sPlayerDataDisposition.getReadTick() >= sSmallestRealGameTick)
+	if (sHubPreferences.mBandwidthReduction && sHub->mPlayerDataDisposition.getReadTick() >= sHub->mSmallestRealGameTick)
 	{
-		if (sHubPreferences.mMinimumSendPeriod >= sHubPreferences.mSendPeriod && sSmallestIncompleteTick < sPlayerDataDisposition.getWriteTick())
+		if (sHubPreferences.mMinimumSendPeriod >= sHubPreferences.mSendPeriod && sHub->mSmallestIncompleteTick < sHub->mPlayerDataDisposition.getWriteTick())
 		{
 			
-			if (sNetworkTicker - sLastRealUpdate >= sHubPreferences.mMinimumSendPeriod)
+			// add anybody holding us back for longer than we tolerate from him
+			// to the lagging player bitmask
+			for (int i = 0; i < sHub->mNetworkPlayers.size(); i++)
 			{
-				// add anybody holding us back to the lagging player bitmask
-				for (int i = 0; i < sNetworkPlayers.size(); i++)
+				if (sHub->mNetworkTicker - sHub->mLastRealUpdate >= sHub->mNetworkPlayers[i].mLateTolerance)
 				{
-					if (i != sLocalPlayerIndex && sNetworkPlayers[i].mConnected && sSmallestRealGameTick > sNetworkPlayers[i].mNetDeadTick)
+					if (i != sHub->mLocalPlayerIndex && sHub->mNetworkPlayers[i].mConnected && sHub->mSmallestRealGameTick > sHub->mNetworkPlayers[i].mNetDeadTick)
 					{
-						if (sPlayerDataDisposition[sSmallestIncompleteTick] & (1 << i))
-							sLaggingPlayersBitmask |= (1 << i);
+						if (sHub->mPlayerDataDisposition[sHub->mSmallestIncompleteTick] & (1 << i))
+							sHub->mLaggingPlayersBitmask |= (1 << i);
 					}
 				}
 			}
 			
-			if (sLaggingPlayersBitmask) {
+			if (sHub->mLaggingPlayersBitmask) {
 				// make up flags if a majority of players are ready to go
 				int readyPlayers = 0;
 				int nonReadyPlayers = 0;
-				for (int i = 0; i < sNetworkPlayers.size(); i++)
+				for (int i = 0; i < sHub->mNetworkPlayers.size(); i++)
 				{
-					if (sNetworkPlayers[i].mConnected && sSmallestRealGameTick > sNetworkPlayers[i].mNetDeadTick)
+					if (sHub->mNetworkPlayers[i].mConnected && sHub->mSmallestRealGameTick > sHub->mNetworkPlayers[i].mNetDeadTick)
 					{
-						if (sPlayerDataDisposition[sSmallestIncompleteTick] & (1 << i))
+						if (sHub->mPlayerDataDisposition[sHub->mSmallestIncompleteTick] & (1 << i))
 							nonReadyPlayers++;
 						else
 							readyPlayers++;
@@ -1369,7 +1751,7 @@ hub_tick()
 		else
 		{
 			// Make sure we send at least every once in a while to keep things going
-			if(sNetworkTicker > sLastNetworkTickSent && (sNetworkTicker - sLastNetworkTickSent) >= sHubPreferences.mRecoverySendPeriod)
+			if(sHub->mNetworkTicker > sHub->mLastNetworkTickSent && (sHub->mNetworkTicker - sHub->mLastNetworkTickSent) >= sHubPreferences.mRecoverySendPeriod)
 				send_packets();
 		}
 		
@@ -1377,13 +1759,13 @@ hub_tick()
         check_send_packet_to_spoke();
 
 	// calculate standard deviation
-	if (sNetworkTicker % kJitterUpdateInterval == 0)
+	if (sHub->mNetworkTicker % kJitterUpdateInterval == 0)
 	{
-		for (int i = 0; i < sNetworkPlayers.size(); ++i)
+		for (int i = 0; i < sHub->mNetworkPlayers.size(); ++i)
 		{
-			if (i != sLocalPlayerIndex)
+			if (i != sHub->mLocalPlayerIndex)
 			{
-				NetworkPlayer_hub& thePlayer = sNetworkPlayers[i];
+				NetworkPlayer_hub& thePlayer = sHub->mNetworkPlayers[i];
 				if (thePlayer.mConnected)
 				{
 					if (thePlayer.mLatencyBuffer.size())
@@ -1391,8 +1773,9 @@ hub_tick()
 						double average = accumulate(thePlayer.mLatencyBuffer.begin(), thePlayer.mLatencyBuffer.end(), 0) / thePlayer.mLatencyBuffer.size();
 						double squares = accumulate(thePlayer.mLatencyBuffer.begin(), thePlayer.mLatencyBuffer.end(), 0, add_squares);
 						
-						double deviation = std::sqrt(squares / thePlayer.mLatencyBuffer.size() - average * average);
+						double deviation = std::sqrt(std::max(squares / thePlayer.mLatencyBuffer.size() - average * average, 0.0));
 						thePlayer.mStats.jitter = static_cast<int16>(std::floor(deviation * 1000 / TICKS_PER_SECOND));
+						adapt_player_pacing(thePlayer, deviation);
 					} 
 				}
 				else if (thePlayer.mStats.jitter != NetworkStats::disconnected)
@@ -1403,18 +1786,36 @@ hub_tick()
 		}
 	}
 
+	// close out this second's counts
+	if (sHub->mNetworkTicker % TICKS_PER_SECOND == 0 && sHub->mPlayerDataDisposition.getReadTick() >= sHub->mSmallestRealGameTick)
+	{
+		for (int i = 0; i < sHub->mNetworkPlayers.size(); ++i)
+		{
+			NetworkPlayer_hub& thePlayer = sHub->mNetworkPlayers[i];
+			if (i != sHub->mLocalPlayerIndex && thePlayer.mConnected)
+			{
+				add_to_histogram(thePlayer.mHistograms.late_flags, thePlayer.mLateFlagsThisSecond);
+				add_to_histogram(thePlayer.mHistograms.packet_loss, thePlayer.mPacketsLostThisSecond);
+				add_to_histogram(thePlayer.mHistograms.resends, thePlayer.mResendsThisSecond);
+			}
+			thePlayer.mLateFlagsThisSecond = 0;
+			thePlayer.mPacketsLostThisSecond = 0;
+			thePlayer.mResendsThisSecond = 0;
+		}
+	}
+
 	// calculate ping
-	for (int i = 0; i < sNetworkPlayers.size(); ++i)
+	for (int i = 0; i < sHub->mNetworkPlayers.size(); ++i)
 	{
-		NetworkPlayer_hub& thePlayer = sNetworkPlayers[i];
-		if (i != sLocalPlayerIndex)
+		NetworkPlayer_hub& thePlayer = sHub->mNetworkPlayers[i];
+		if (i != sHub->mLocalPlayerIndex)
 		{
 			if (thePlayer.mConnected)
 			{
 				if (thePlayer.mLatencyBuffer.size())
 				{
 					int32 samples = std::min(thePlayer.mLatencyBuffer.size(), static_cast<size_t>(kDisplayLatencyWindow));
-					int32 latency_ticks = std::max(thePlayer.mLatencyTicks, ((sNetworkTicker - thePlayer.mLastNetworkTickHeard) * samples));
+					int32 latency_ticks = std::max(thePlayer.mLatencyTicks, ((sHub->mNetworkTicker - thePlayer.mLastNetworkTickHeard) * samples));
 					thePlayer.mStats.latency = (latency_ticks * 1000 / TICKS_PER_SECOND / samples);
 				}
 			}
@@ -1443,26 +1844,29 @@ send_packets()
 	// we do some processing here outside the loop since the results'd be the same every time.
 	HubLossyByteStreamChunkDescriptor theDescriptor = { 0, 0, 0, 0 };
 	bool haveLossyData = false;
-	if(sOutgoingLossyByteStreamDescriptors.getCountOfElements() > 0)
+	if(sHub->mOutgoingLossyByteStreamDescriptors.getCountOfElements() > 0)
 	{
 		haveLossyData = true;
-		theDescriptor = sOutgoingLossyByteStreamDescriptors.peek();
+		theDescriptor = sHub->mOutgoingLossyByteStreamDescriptors.peek();
 
 		// XXX extraneous copy due to limited interfaces
 		// We assert here; the real "test" happened when it was enqueued.
 		assert(theDescriptor.mLength <= sizeof(sScratchBuffer));
-		sOutgoingLossyByteStreamData.peekBytes(sScratchBuffer, theDescriptor.mLength);
+		sHub->mOutgoingLossyByteStreamData.peekBytes(sScratchBuffer, theDescriptor.mLength);
 	}
 
 	// remember when we sent flags for the first time
-	for (int32 i = sFlagSendTimeQueue.getWriteTick(); i < sSmallestIncompleteTick; i++) 
+	for (int32 i = sHub->mFlagSendTimeQueue.getWriteTick(); i < sHub->mSmallestIncompleteTick; i++) 
 	{
-		sFlagSendTimeQueue.enqueue(sNetworkTicker);
+		sHub->mFlagSendTimeQueue.enqueue(sHub->mNetworkTicker);
 	}
+
+	// One system call for the whole tick's worth of spoke packets, where we can
+	NetDDPBeginBatch();
 		
-        for(size_t i = 0; i < sNetworkPlayers.size(); i++)
+        for(size_t i = 0; i < sHub->mNetworkPlayers.size(); i++)
         {
-                NetworkPlayer_hub& thePlayer = sNetworkPlayers[i];
+                NetworkPlayer_hub& thePlayer = sHub->mNetworkPlayers[i];
                 if(thePlayer.mConnected && thePlayer.mAddressKnown)
                 {
 			AOStreamBE hdr(sOutgoingFrame->data, kStarPacketHeaderSize);
@@ -1482,13 +1886,13 @@ send_packets()
                                 }
         
                                 // Netdead players?
-                                for(size_t j = 0; j < sNetworkPlayers.size(); j++)
+                                for(size_t j = 0; j < sHub->mNetworkPlayers.size(); j++)
                                 {
-                                        if(thePlayer.mSmallestUnacknowledgedTick <= sNetworkPlayers[j].mNetDeadTick)
+                                        if(thePlayer.mSmallestUnacknowledgedTick <= sHub->mNetworkPlayers[j].mNetDeadTick)
                                         {
                                                 ps << (uint16)kPlayerNetDeadMessageType
                                                         << (uint8)j	// dead player index
-                                                        << sNetworkPlayers[j].mNetDeadTick;
+                                                        << sHub->mNetworkPlayers[j].mNetDeadTick;
                                         }
                                 }
 
@@ -1518,7 +1922,7 @@ send_packets()
 				int32 startTick;
 				int32 endTick;
 
-				if (sHubPreferences.mBandwidthReduction && sPlayerDataDisposition.getReadTick() >= sSmallestRealGameTick)
+				if (sHubPreferences.mBandwidthReduction && sHub->mPlayerDataDisposition.getReadTick() >= sHub->mSmallestRealGameTick)
 				{
 					// never send fewer than 2 full updates per second, or more than 15
 					int32 latencyCount = std::min(thePlayer.mLatencyBuffer.size(), static_cast<size_t>(kDisplayLatencyWindow));
@@ -1532,51 +1936,56 @@ send_packets()
 						effectiveLatency = TICKS_PER_SECOND / 2;
 					}
 					
-					if (sNetworkTicker - thePlayer.mLastRecoverySend >= effectiveLatency)
+					if (sHub->mNetworkTicker - thePlayer.mLastRecoverySend >= effectiveLatency)
 					{
 						// send a large update
-						thePlayer.mLastRecoverySend = sNetworkTicker;
+						thePlayer.mLastRecoverySend = sHub->mNetworkTicker;
 						
 						// we want to send 4 seconds worth of flags per second
 						int maxTicks = 4 * effectiveLatency;
 
 						int bytesAvailableForFlags = ps.maxp() - ps.tellp() - 4; // have to encode the tick
 						// don't run out of room in the packet, though
-						if (maxTicks * sNetworkPlayers.size() * 4 > bytesAvailableForFlags) 
+						int maximumBytesPerFlags = thePlayer.mCompressedFlags ? kActionFlagsRunSerializedLength : kActionFlagsSerializedLength;
+						if (maxTicks * sHub->mNetworkPlayers.size() * maximumBytesPerFlags > bytesAvailableForFlags) 
 						{
-							int maximumBytesPerTick = sNetworkPlayers.size() * 4;
+							int maximumBytesPerTick = sHub->mNetworkPlayers.size() * maximumBytesPerFlags;
 							maxTicks = bytesAvailableForFlags / maximumBytesPerTick;
 						}
 
 						startTick = thePlayer.mSmallestUnacknowledgedTick;
-						endTick = (startTick + maxTicks < sSmallestIncompleteTick) ? startTick + maxTicks : sSmallestIncompleteTick;
+						endTick = (startTick + maxTicks < sHub->mSmallestIncompleteTick) ? startTick + maxTicks : sHub->mSmallestIncompleteTick;
 					}
 					else
 					{
 						// send the last 3 flags
-						startTick = std::max(sSmallestIncompleteTick - 3, thePlayer.mSmallestUnacknowledgedTick);
-						endTick = sSmallestIncompleteTick;
+						startTick = std::max(sHub->mSmallestIncompleteTick - 3, thePlayer.mSmallestUnacknowledgedTick);
+						endTick = sHub->mSmallestIncompleteTick;
 					}
 				}
 				else 
 				{
 					startTick = thePlayer.mSmallestUnacknowledgedTick;
-					endTick = sSmallestIncompleteTick;
+					endTick = sHub->mSmallestIncompleteTick;
 				}
 
+				if (startTick < thePlayer.mSmallestUnsentTick)
+					thePlayer.mResendsThisSecond += std::min(endTick, thePlayer.mSmallestUnsentTick) - startTick;
+				thePlayer.mSmallestUnsentTick = std::max(thePlayer.mSmallestUnsentTick, endTick);
+
 				bool reflectFlags = false;
 				// find out if we need to reflect flags
 				for (int32 tick = startTick; tick < endTick && !reflectFlags; tick++)
 				{
-					if (sPlayerReflectedFlags.peek(tick) & (1 << i)) reflectFlags = true;
+					if (sHub->mPlayerReflectedFlags.peek(tick) & (1 << i)) reflectFlags = true;
 				}
         
                                 // Action_flags!!
                                 // First, preprocess the players to figure out at what tick they'll each stop
                                 // contributing
 				std::vector<int32> theSmallestTickWeWontSend;
-                                theSmallestTickWeWontSend.resize(sNetworkPlayers.size());
-                                for(size_t j = 0; j < sNetworkPlayers.size(); j++)
+                                theSmallestTickWeWontSend.resize(sHub->mNetworkPlayers.size());
+                                for(size_t j = 0; j < sHub->mNetworkPlayers.size(); j++)
                                 {
                                         // Don't encode our own flags
                                         if(j == i && !reflectFlags)
@@ -1585,8 +1994,8 @@ send_packets()
                                                 continue;
                                         }
         
-                                        theSmallestTickWeWontSend[j] = sSmallestIncompleteTick;
-                                        NetworkPlayer_hub& theOtherPlayer = sNetworkPlayers[j];
+                                        theSmallestTickWeWontSend[j] = sHub->mSmallestIncompleteTick;
+                                        NetworkPlayer_hub& theOtherPlayer = sHub->mNetworkPlayers[j];
         
                                         // Don't send flags for netdead people
                                         if(!theOtherPlayer.mConnected && theSmallestTickWeWontSend[j] > theOtherPlayer.mNetDeadTick)
@@ -1595,9 +2004,11 @@ send_packets()
         
                                 // Now, encode the flags in tick-major order (this is much easier to decode
                                 // at the other end)
+				// In V2, a player's flags start a run only when the last run has been used up
+				std::vector<int32> theSmallestTickOutsideRun(sHub->mNetworkPlayers.size(), startTick);
                                 for(int32 tick = startTick; tick < endTick; tick++)
                                 {
-                                        for(size_t j = 0; j < sNetworkPlayers.size(); j++)
+                                        for(size_t j = 0; j < sHub->mNetworkPlayers.size(); j++)
                                         {
                                                 if(tick < theSmallestTickWeWontSend[j])
                                                 {
@@ -1606,12 +2017,29 @@ send_packets()
                                                                 ps << tick;
                                                                 haveSentStartTick = true;
                                                         }
-                                                        ps << getFlagsQueue(j).peek(tick);
+
+							action_flags_t theFlags = getFlagsQueue(j).peek(tick);
+							if(thePlayer.mCompressedFlags)
+							{
+								if(tick < theSmallestTickOutsideRun[j])
+									continue;
+
+								int32 theRunEnd = std::min(endTick, theSmallestTickWeWontSend[j]);
+								uint8 theRepeats = 0;
+								while(theRepeats < kMaximumActionFlagsRunLength && tick + theRepeats + 1 < theRunEnd && getFlagsQueue(j).peek(tick + theRepeats + 1) == theFlags)
+									theRepeats++;
+								theSmallestTickOutsideRun[j] = tick + theRepeats + 1;
+								ps << theRepeats;
+							}
+                                                        ps << theFlags;
                                                 }
                                         }
                                 }
 				
-				hdr << (uint16) (reflectFlags ? kHubToSpokeGameDataPacketWithSpokeFlagsV1Magic : kHubToSpokeGameDataPacketV1Magic);
+				if (thePlayer.mCompressedFlags)
+					hdr << (uint16) (reflectFlags ? kHubToSpokeGameDataPacketWithSpokeFlagsV2Magic : kHubToSpokeGameDataPacketV2Magic);
+				else
+					hdr << (uint16) (reflectFlags ? kHubToSpokeGameDataPacketWithSpokeFlagsV1Magic : kHubToSpokeGameDataPacketV1Magic);
 
 				// blank out the CRC field before calculating
 				sOutgoingFrame->data[2] = 0;
@@ -1622,7 +2050,7 @@ send_packets()
         
                                 // Send the packet
                                 sOutgoingFrame->data_size = ps.tellp();
-                                if(i == sLocalPlayerIndex)
+                                if(i == sHub->mLocalPlayerIndex)
                                         send_frame_to_local_spoke(sOutgoingFrame, &thePlayer.mAddress, kPROTOCOL_TYPE, 0 /* ignored */);
                                 else
                                         NetDDPSendFrame(sOutgoingFrame, &thePlayer.mAddress, kPROTOCOL_TYPE, 0 /* ignored */);
@@ -1636,22 +2064,146 @@ send_packets()
 
         } // iterate over players
 
-        sLastNetworkTickSent = sNetworkTicker;
-	sSmallestUnsentTick = sSmallestIncompleteTick;
+	send_packets_to_relays();
+
+	NetDDPFlushBatch();
+
+        sHub->mLastNetworkTickSent = sHub->mNetworkTicker;
+	sHub->mSmallestUnsentTick = sHub->mSmallestIncompleteTick;
 
 	if(haveLossyData)
 	{
-		sOutgoingLossyByteStreamData.dequeue(theDescriptor.mLength);
-		sOutgoingLossyByteStreamDescriptors.dequeue();
+		sHub->mOutgoingLossyByteStreamData.dequeue(theDescriptor.mLength);
+		sHub->mOutgoingLossyByteStreamDescriptors.dequeue();
 	}
 	
 } // send_packets()
 
+// Everything confirmed that each relay hasn't acknowledged, as much as fits
+static void
+send_packets_to_relays()
+{
+	int32 thePlayerCount = sHub->mNetworkPlayers.size();
+	int32 theMaximumTicks = (ddpMaxData - kRelayFlagsPacketHeaderSize - 4 * thePlayerCount) / (kActionFlagsSerializedLength * thePlayerCount);
+
+	std::vector<RelaySubscriber>::iterator theRelay = sHub->mRelays.begin();
+	while(theRelay != sHub->mRelays.end())
+	{
+		if(sHub->mNetworkTicker - theRelay->mLastNetworkTickHeard > kRelayTimeout)
+		{
+			logNoteNMT("relay went away");
+			theRelay = sHub->mRelays.erase(theRelay);
+			continue;
+		}
+
+		int32 theStartTick = theRelay->mSmallestUnacknowledgedTick;
+		int32 theEndTick = std::min(sHub->mSmallestIncompleteTick, theStartTick + theMaximumTicks);
+		if(theStartTick < sHub->mPlayerDataDisposition.getReadTick() || theStartTick >= theEndTick)
+		{
+			++theRelay;
+			continue;
+		}
+
+		AOStreamBE hdr(sOutgoingFrame->data, kStarPacketHeaderSize);
+		AOStreamBE ps(sOutgoingFrame->data, ddpMaxData, kStarPacketHeaderSize);
+
+		try {
+			hdr << (uint16)kRelayFlagsPacket;
+			ps << sHub->mGameIdentifier << sHub->mFirstTick << sHub->mSmallestRealGameTick << theStartTick << theEndTick << (uint8)thePlayerCount;
+
+			std::vector<int32> theSmallestTickWeWontSend(thePlayerCount, theEndTick);
+			for(int32 j = 0; j < thePlayerCount; j++)
+			{
+				if(!sHub->mNetworkPlayers[j].mConnected && theSmallestTickWeWontSend[j] > sHub->mNetworkPlayers[j].mNetDeadTick)
+					theSmallestTickWeWontSend[j] = sHub->mNetworkPlayers[j].mNetDeadTick;
+				ps << theSmallestTickWeWontSend[j];
+			}
+
+			for(int32 tick = theStartTick; tick < theEndTick; tick++)
+			{
+				for(int32 j = 0; j < thePlayerCount; j++)
+				{
+					if(tick < theSmallestTickWeWontSend[j])
+						ps << getFlagsQueue(j).peek(tick);
+				}
+			}
+
+			// blank out the CRC field before calculating
+			sOutgoingFrame->data[2] = 0;
+			sOutgoingFrame->data[3] = 0;
+
+			uint16 crc = calculate_data_crc_ccitt(sOutgoingFrame->data, ps.tellp());
+			hdr << crc;
+
+			sOutgoingFrame->data_size = ps.tellp();
+			NetDDPSendFrame(sOutgoingFrame, &theRelay->mAddress, kPROTOCOL_TYPE, 0 /* ignored */);
+		}
+		catch (...)
+		{
+			logWarningNMT("Caught exception while constructing/sending relay packet");
+		}
+
+		++theRelay;
+	}
+}
+
+
+
 const NetworkStats& hub_stats(int player_index)
 {
 	return getNetworkPlayer(player_index).mStats;
 }
 
+const NetworkHistograms& hub_histograms(int player_index)
+{
+	return getNetworkPlayer(player_index).mHistograms;
+}
+
+static void
+write_histogram(FILE* inFile, int32 inTime, size_t inPlayerIndex, const char* inName, const uint32* inBins)
+{
+#ifdef A1_NETWORK_STANDALONE_HUB
+	fprintf(inFile, "%d,%u,%d,%s", (int)inTime, (unsigned)sHub->mGameIdentifier, (int)inPlayerIndex, inName);
+#else
+	fprintf(inFile, "%d,%d,%s", (int)inTime, (int)inPlayerIndex, inName);
+#endif
+	for (int i = 0; i < NetworkHistograms::kBins; i++)
+		fprintf(inFile, ",%u", inBins[i]);
+	fprintf(inFile, "\n");
+}
+
+void hub_write_histograms(FILE* inFile, int32 inTime, bool inWriteHeader)
+{
+	if (inWriteHeader)
+	{
+#ifdef A1_NETWORK_STANDALONE_HUB
+		fprintf(inFile, "seconds,game,player,histogram");
+#else
+		fprintf(inFile, "seconds,player,histogram");
+#endif
+		for (int i = 0; i < NetworkHistograms::kBins; i++)
+			fprintf(inFile, ",%d%s", i, (i == NetworkHistograms::kBins - 1) ? "+" : "");
+		fprintf(inFile, "\n");
+	}
+
+	for (size_t theGame = 0; theGame < sHubGames.size(); theGame++)
+	{
+		sHub = sHubGames[theGame];
+		for (size_t i = 0; i < sHub->mNetworkPlayers.size(); i++)
+		{
+			if (i == sHub->mLocalPlayerIndex || !sHub->mNetworkPlayers[i].mConnected)
+				continue;
+
+			const NetworkHistograms& theHistograms = sHub->mNetworkPlayers[i].mHistograms;
+			write_histogram(inFile, inTime, i, "rtt", theHistograms.rtt);
+			write_histogram(inFile, inTime, i, "late_flags", theHistograms.late_flags);
+			write_histogram(inFile, inTime, i, "packet_loss", theHistograms.packet_loss);
+			write_histogram(inFile, inTime, i, "resends", theHistograms.resends);
+		}
+	}
+	fflush(inFile);
+}
+
 enum {
 	// kOutgoingFlagsQueueSizeAttribute,
 	kPregameTicksBeforeNetDeathAttribute,
@@ -1707,6 +2259,69 @@ static const int32 sDefaultHubPreferences[kNumAttributes] = {
 };
 
 
+#ifdef A1_NETWORK_STANDALONE_HUB
+// Call these with the mytm mutex held
+size_t hub_game_count()
+{
+	return sHubGames.size();
+}
+
+bool hub_game_is_active(size_t inGame)
+{
+	return sHubGames[inGame]->mHubActive;
+}
+
+bool hub_is_waiting_for_players()
+{
+	if (sHubGames.empty())
+		return false;
+
+	const HubGame* theGame = sHubGames.back();
+	for (size_t i = 0; i < theGame->mNetworkPlayers.size(); i++)
+	{
+		if (theGame->mNetworkPlayers[i].mConnected && !theGame->mNetworkPlayers[i].mAddressKnown)
+			return true;
+	}
+	return false;
+}
+
+void hub_player_stats(size_t inGame, size_t inPlayerIndex, NetworkStats& outStats, NetworkHistograms& outHistograms)
+{
+	const NetworkPlayer_hub& thePlayer = sHubGames[inGame]->mNetworkPlayers[inPlayerIndex];
+	outStats = thePlayer.mStats;
+	outHistograms = thePlayer.mHistograms;
+}
+
+void hub_tick_time(uint64_t& outCounts, uint32& outTicks)
+{
+	outCounts = sHubTickCounts;
+	outTicks = sHubTicksTimed;
+}
+
+bool hub_is_player_address(const NetAddrBlock& inAddress)
+{
+	for (size_t i = 0; i < sHubGames.size(); i++)
+	{
+		if (sHubGames[i]->mAddressToPlayerIndex.count(inAddress))
+			return true;
+	}
+	return false;
+}
+
+// Call this one without it
+void hub_cleanup_game(size_t inGame)
+{
+	HubGame* theGame = NULL;
+	if (take_mytm_mutex())
+	{
+		theGame = sHubGames[inGame];
+		release_mytm_mutex();
+	}
+
+	if (theGame)
+		cleanup_game(theGame, false, 0);
+}
+#else
 void HubParsePreferencesTree(InfoTree prefs, std::string version)
 {
 	for (size_t i = 0; i < kNumAttributes; ++i)
@@ -1738,6 +2353,7 @@ void HubParsePreferencesTree(InfoTree prefs, std::string version)
 	}
 
 	prefs.read_attr("use_bandwidth_reduction", sHubPreferences.mBandwidthReduction);
+	prefs.read_attr("use_adaptive_pacing", sHubPreferences.mAdaptivePacing);
 
 		
 	// The checks above are not sufficient to catch all bad cases; if user specified a window size
@@ -1762,9 +2378,11 @@ InfoTree HubPreferencesTree()
 	for (size_t i = 0; i < kNumAttributes; ++i)
 		root.put_attr(sAttributeStrings[i], *(sAttributeDestinations[i]));
 	root.put_attr("use_bandwidth_reduction", sHubPreferences.mBandwidthReduction);
+	root.put_attr("use_adaptive_pacing", sHubPreferences.mAdaptivePacing);
 	
 	return root;
 }
+#endif // A1_NETWORK_STANDALONE_HUB
 
 
 
@@ -1774,6 +2392,7 @@ DefaultHubPreferences()
 	for(size_t i = 0; i < kNumAttributes; i++)
 		*(sAttributeDestinations[i]) = sDefaultHubPreferences[i];
 	sHubPreferences.mBandwidthReduction = true;
+	sHubPreferences.mAdaptivePacing = true;
 /*
 	sHubPreferences.mPregameWindowSize = kDefaultPregameWindowSize;
 	sHubPreferences.mInGameWindowSize = kDefaultInGameWindowSize;
@@ -0,0 +1,368 @@
+/*
+ *  network_star_relay.cpp
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+ *  Spectator relay (alephone-hub --relay): subscribes to a hub's confirmed action_flags
+ *  and hands them on to any number of spectators.  A spectator asks us exactly as we ask
+ *  the hub (kRelayFlagsRequestPacket), so relays can feed relays.
+ *
+ *  We keep every tick of the game, so a spectator (or a relay) can join at any point and
+ *  still start from the beginning; the game itself never waits for any of them.
+ */
+
+#if !defined(DISABLE_NETWORKING)
+
+#include "cseries.h"
+
+#include "network_star.h"
+#include "network_private.h"
+#include "mytm.h"
+#include "AStream.h"
+#include "Logging.h"
+#include "crc.h"
+
+#include <vector>
+#include <map>
+#include <algorithm>
+
+enum {
+	kMaximumSpectators = 256,
+	kSpectatorTimeout = TICKS_PER_SECOND * 10,	// ticks without a request before we forget a spectator
+	kSpectatorRecoveryPeriod = TICKS_PER_SECOND / 2	// resend from the ack if it hasn't moved for this long
+};
+
+struct Spectator {
+	NetAddrBlock	mAddress;
+	int32		mSmallestUnacknowledgedTick;
+	int32		mSmallestUnsentTick;
+	int32		mLastNetworkTickHeard;
+	int32		mLastNetworkTickProgressed;
+};
+
+typedef std::pair<uint32, uint16> AddressKey;
+typedef std::map<AddressKey, Spectator> SpectatorMap;
+
+static NetAddrBlock	sUpstreamAddress;
+static myTMTaskPtr	sRelayTickTask = NULL;
+static DDPFramePtr	sOutgoingFrame = NULL;
+static int32		sNetworkTicker;
+
+static uint32		sGameIdentifier;	// 0 until the first game arrives
+static int32		sFirstTick;
+static int32		sFirstRealGameTick;
+static int32		sSmallestMissingTick;
+// each player's flags from sFirstTick; a netdead player's stop where he did
+static std::vector<std::vector<action_flags_t> > sPlayerFlags;
+static std::vector<bool> sPlayerNetDead;
+
+static SpectatorMap	sSpectators;
+
+
+static AddressKey
+key_for_address(const NetAddrBlock& inAddress)
+{
+	return AddressKey(inAddress.host, inAddress.port);
+}
+
+
+static void
+send_frame(AOStreamBE& hdr, AOStreamBE& ps, const NetAddrBlock& inAddress)
+{
+	// blank out the CRC field before calculating
+	sOutgoingFrame->data[2] = 0;
+	sOutgoingFrame->data[3] = 0;
+
+	uint16 crc = calculate_data_crc_ccitt(sOutgoingFrame->data, ps.tellp());
+	hdr << crc;
+
+	sOutgoingFrame->data_size = ps.tellp();
+	NetDDPSendFrame(sOutgoingFrame, const_cast<NetAddrBlock*>(&inAddress), kPROTOCOL_TYPE, 0 /* ignored */);
+}
+
+
+static void
+send_request_upstream()
+{
+	AOStreamBE hdr(sOutgoingFrame->data, kStarPacketHeaderSize);
+	AOStreamBE ps(sOutgoingFrame->data, ddpMaxData, kStarPacketHeaderSize);
+
+	try {
+		hdr << (uint16)kRelayFlagsRequestPacket;
+		ps << sGameIdentifier << sSmallestMissingTick;
+		send_frame(hdr, ps, sUpstreamAddress);
+	}
+	catch (...)
+	{
+		logWarningNMT("Caught exception while constructing/sending relay request");
+	}
+}
+
+
+// Returns the tick after the last one sent
+static int32
+send_flags_to_spectator(const Spectator& inSpectator)
+{
+	int32 thePlayerCount = sPlayerFlags.size();
+	int32 theMaximumTicks = (ddpMaxData - kRelayFlagsPacketHeaderSize - 4 * thePlayerCount) / (kActionFlagsSerializedLength * thePlayerCount);
+	int32 theStartTick = inSpectator.mSmallestUnsentTick;
+	int32 theEndTick = std::min(sSmallestMissingTick, theStartTick + theMaximumTicks);
+
+	AOStreamBE hdr(sOutgoingFrame->data, kStarPacketHeaderSize);
+	AOStreamBE ps(sOutgoingFrame->data, ddpMaxData, kStarPacketHeaderSize);
+
+	try {
+		hdr << (uint16)kRelayFlagsPacket;
+		ps << sGameIdentifier << sFirstTick << sFirstRealGameTick << theStartTick << theEndTick << (uint8)thePlayerCount;
+
+		std::vector<int32> theSmallestTickWeWontSend(thePlayerCount);
+		for(int32 j = 0; j < thePlayerCount; j++)
+		{
+			theSmallestTickWeWontSend[j] = std::min(theEndTick, (int32)(sFirstTick + sPlayerFlags[j].size()));
+			ps << theSmallestTickWeWontSend[j];
+		}
+
+		for(int32 tick = theStartTick; tick < theEndTick; tick++)
+		{
+			for(int32 j = 0; j < thePlayerCount; j++)
+			{
+				if(tick < theSmallestTickWeWontSend[j])
+					ps << sPlayerFlags[j][tick - sFirstTick];
+			}
+		}
+
+		send_frame(hdr, ps, inSpectator.mAddress);
+	}
+	catch (...)
+	{
+		logWarningNMT("Caught exception while constructing/sending spectator packet");
+	}
+
+	return theEndTick;
+}
+
+
+static bool
+relay_tick()
+{
+	sNetworkTicker++;
+
+	// the request doubles as our ack, so the hub resends only what we're missing
+	send_request_upstream();
+
+	if(sGameIdentifier == 0)
+		return true;
+
+	NetDDPBeginBatch();
+	SpectatorMap::iterator i = sSpectators.begin();
+	while(i != sSpectators.end())
+	{
+		Spectator& theSpectator = i->second;
+		if(sNetworkTicker - theSpectator.mLastNetworkTickHeard > kSpectatorTimeout)
+		{
+			logNoteNMT("spectator went away");
+			sSpectators.erase(i++);
+			continue;
+		}
+
+		// go back N: whatever was sent but not acknowledged in a while is presumed lost
+		if(theSpectator.mSmallestUnacknowledgedTick < theSpectator.mSmallestUnsentTick
+			&& sNetworkTicker - theSpectator.mLastNetworkTickProgressed >= kSpectatorRecoveryPeriod)
+		{
+			theSpectator.mSmallestUnsentTick = theSpectator.mSmallestUnacknowledgedTick;
+			theSpectator.mLastNetworkTickProgressed = sNetworkTicker;
+		}
+
+		if(theSpectator.mSmallestUnsentTick < sSmallestMissingTick)
+			theSpectator.mSmallestUnsentTick = send_flags_to_spectator(theSpectator);
+
+		++i;
+	}
+	NetDDPFlushBatch();
+
+	return true;
+}
+
+
+static void
+relay_received_flags(AIStream& ps)
+{
+	uint32 theGameIdentifier;
+	int32 theFirstTick, theFirstRealGameTick, theStartTick, theEndTick;
+	uint8 thePlayerCount;
+	ps >> theGameIdentifier >> theFirstTick >> theFirstRealGameTick >> theStartTick >> theEndTick >> thePlayerCount;
+
+	if(thePlayerCount < 1 || thePlayerCount > MAXIMUM_NUMBER_OF_NETWORK_PLAYERS || theEndTick < theStartTick)
+		return;
+
+	if(theGameIdentifier != sGameIdentifier)
+	{
+		// a new game only counts from its beginning; the hub will start us there
+		if(theStartTick != theFirstTick)
+			return;
+
+		logNoteNMT("relaying a %d-player game from tick %d", (int)thePlayerCount, theFirstTick);
+		sGameIdentifier = theGameIdentifier;
+		sFirstTick = theFirstTick;
+		sSmallestMissingTick = theFirstTick;
+		sPlayerFlags.assign(thePlayerCount, std::vector<action_flags_t>());
+		sPlayerNetDead.assign(thePlayerCount, false);
+
+		// spectators' ticks belong to the last game
+		for(SpectatorMap::iterator i = sSpectators.begin(); i != sSpectators.end(); ++i)
+			i->second.mSmallestUnacknowledgedTick = i->second.mSmallestUnsentTick = theFirstTick;
+	}
+
+	if(thePlayerCount != sPlayerFlags.size() || theStartTick > sSmallestMissingTick || theEndTick <= sSmallestMissingTick)
+		return;
+
+	sFirstRealGameTick = theFirstRealGameTick;
+
+	std::vector<int32> theSmallestTickNotSent(thePlayerCount);
+	for(int32 j = 0; j < thePlayerCount; j++)
+		ps >> theSmallestTickNotSent[j];
+
+	for(int32 tick = theStartTick; tick < theEndTick; tick++)
+	{
+		for(int32 j = 0; j < thePlayerCount; j++)
+		{
+			if(tick >= theSmallestTickNotSent[j])
+				continue;
+
+			action_flags_t theFlags;
+			ps >> theFlags;
+			if(tick >= sSmallestMissingTick && !sPlayerNetDead[j])
+				sPlayerFlags[j].push_back(theFlags);
+		}
+	}
+
+	for(int32 j = 0; j < thePlayerCount; j++)
+	{
+		if(theSmallestTickNotSent[j] < theEndTick && !sPlayerNetDead[j])
+		{
+			logNoteNMT("player %d netdead at tick %d", j, theSmallestTickNotSent[j]);
+			sPlayerNetDead[j] = true;
+		}
+	}
+
+	sSmallestMissingTick = theEndTick;
+}
+
+
+static void
+relay_received_request(AIStream& ps, const NetAddrBlock& inAddress)
+{
+	uint32 theGameIdentifier;
+	int32 theSmallestUnacknowledgedTick;
+	ps >> theGameIdentifier >> theSmallestUnacknowledgedTick;
+
+	if(sGameIdentifier == 0)
+		return;
+
+	SpectatorMap::iterator i = sSpectators.find(key_for_address(inAddress));
+	if(i == sSpectators.end())
+	{
+		if(sSpectators.size() >= kMaximumSpectators)
+			return;
+
+		logNoteNMT("spectator subscribed");
+		Spectator theSpectator;
+		theSpectator.mAddress = inAddress;
+		theSpectator.mSmallestUnacknowledgedTick = theSpectator.mSmallestUnsentTick = sFirstTick;
+		theSpectator.mLastNetworkTickProgressed = sNetworkTicker;
+		i = sSpectators.insert(SpectatorMap::value_type(key_for_address(inAddress), theSpectator)).first;
+	}
+
+	Spectator& theSpectator = i->second;
+	theSpectator.mLastNetworkTickHeard = sNetworkTicker;
+
+	if(theGameIdentifier != sGameIdentifier || theSmallestUnacknowledgedTick > theSpectator.mSmallestUnsentTick)
+		return;
+
+	if(theSmallestUnacknowledgedTick > theSpectator.mSmallestUnacknowledgedTick)
+	{
+		theSpectator.mSmallestUnacknowledgedTick = theSmallestUnacknowledgedTick;
+		theSpectator.mLastNetworkTickProgressed = sNetworkTicker;
+	}
+}
+
+
+void
+relay_received_network_packet(DDPPacketBufferPtr inPacket)
+{
+	if(inPacket->datagramSize < kStarPacketHeaderSize)
+		return;
+
+	uint16 thePacketCRC = (inPacket->datagramData[2] << 8) | inPacket->datagramData[3];
+	inPacket->datagramData[2] = 0;
+	inPacket->datagramData[3] = 0;
+	if(thePacketCRC != calculate_data_crc_ccitt(inPacket->datagramData, inPacket->datagramSize))
+		return;
+
+	AIStreamBE ps(inPacket->datagramData, inPacket->datagramSize, kStarPacketHeaderSize);
+	uint16 thePacketMagic = (inPacket->datagramData[0] << 8) | inPacket->datagramData[1];
+
+	try {
+		bool fromUpstream = (inPacket->sourceAddress.host == sUpstreamAddress.host && inPacket->sourceAddress.port == sUpstreamAddress.port);
+		if(thePacketMagic == kRelayFlagsPacket && fromUpstream)
+			relay_received_flags(ps);
+		else if(thePacketMagic == kRelayFlagsRequestPacket && !fromUpstream)
+			relay_received_request(ps, inPacket->sourceAddress);
+	}
+	catch (...)
+	{
+		// malformed packet; drop it
+	}
+}
+
+
+void
+relay_initialize(const NetAddrBlock& inUpstreamAddress)
+{
+	sUpstreamAddress = inUpstreamAddress;
+	sNetworkTicker = 0;
+	sGameIdentifier = 0;
+	sPlayerFlags.clear();
+	sPlayerNetDead.clear();
+	sSpectators.clear();
+
+	if(sOutgoingFrame == NULL)
+		sOutgoingFrame = NetDDPNewFrame();
+
+	sRelayTickTask = myXTMSetup(1000/TICKS_PER_SECOND, relay_tick);
+}
+
+
+void
+relay_cleanup()
+{
+	if(sRelayTickTask != NULL)
+	{
+		myTMRemove(sRelayTickTask);
+		sRelayTickTask = NULL;
+		myTMCleanup(true);
+	}
+
+	sSpectators.clear();
+	sPlayerFlags.clear();
+	sPlayerNetDead.clear();
+
+	NetDDPDisposeFrame(sOutgoingFrame);
+	sOutgoingFrame = NULL;
+}
+
+#endif // !defined(DISABLE_NETWORKING)
@@ -31,6 +31,11 @@
  *	NAT-friendly networking - we no longer get spoke addresses form topology -
  *	instead spokes send identification packets to hub with player ID.
  *	Hub can then associate the ID in the identification packet with the paket's source address.
+ *
+ *  Oct 14, 2026:
+ *	Gatherer's spoke can announce the game to a standalone hub along with its identification.
+ *	Run-length coded action_flags (V2 packets) when both ends support them.
+ *	World checksums reported by the game go to the hub (kSpokeToHubWorldChecksumMessageType).
  */
 
 #if !defined(DISABLE_NETWORKING)
@@ -48,6 +53,7 @@
 #include "InfoTree.h"
 
 #include <map>
+#include <algorithm>
 
 extern void make_player_really_net_dead(size_t inPlayerIndex);
 extern void call_distribution_response_function_if_available(byte* inBuffer, uint16 inBufferSize, int16 inDistributionType, uint8 inSendingPlayerIndex);
@@ -62,7 +68,12 @@ enum {
 	kDefaultTimingNthElement = kDefaultTimingWindowSize / 2,
 	kLossyByteStreamDataBufferSize = 1280,
 	kTypicalLossyByteStreamChunkSize = 56,
-	kLossyByteStreamDescriptorCount = kLossyByteStreamDataBufferSize / kTypicalLossyByteStreamChunkSize
+	kLossyByteStreamDescriptorCount = kLossyByteStreamDataBufferSize / kTypicalLossyByteStreamChunkSize,
+	// Lossy streaming data takes what room the action flags leave, up to this much per packet...
+	kMaximumLossyByteStreamBytesPerPacket = 256,
+	// ...and is dropped once it has waited this long (network ticks); late voice is no use
+	kMaximumLossyByteStreamChunkAge = TICKS_PER_SECOND / 4,
+	kWorldChecksumReportCount = 4
 };
 
 struct SpokePreferences
@@ -103,6 +114,10 @@ struct NetworkPlayer_spoke {
         bool				mConnected;
         int32				mNetDeadTick;
         WritableTickBasedActionQueue* 	mQueue;
+
+	// V2 packets: repeats left in the run being read, and its flags
+	uint8				mFlagsRunRemaining;
+	action_flags_t			mFlagsRunFlags;
 };
 
 static vector<NetworkPlayer_spoke> sNetworkPlayers;
@@ -123,6 +138,14 @@ static WindowedNthElementFinder<int32> sNthElementFinder(kDefaultTimingWindowSiz
 static bool sTimingMeasurementValid;
 static int32 sTimingMeasurement;
 static bool sHeardFromHub = false;
+static bool sOfferCompressedFlags = false;	// say so in our identification packets
+static bool sHubSendsCompressedFlags = false;	// hub has sent V2, so it reads V2 too
+
+// Set on the gatherer when the hub is a standalone one that has to be told about the game
+static bool sAnnounceGameToHub = false;
+static int32 sAnnouncedFirstTick;
+static uint16 sAnnouncedNumberOfPlayers;
+static uint32 sAnnouncedConnectedPlayers;
 
 static vector<int32> sDisplayLatencyBuffer; // stores the last 30 latency calculations, in ticks
 static uint32 sDisplayLatencyCount = 0;
@@ -135,6 +158,7 @@ struct SpokeLossyByteStreamChunkDescriptor
 	uint16	mLength;
 	int16	mType;
 	uint32	mDestinations;
+	int32	mNetworkTick; // of its arrival
 };
 
 // This holds outgoing lossy byte stream data
@@ -143,12 +167,26 @@ static CircularByteBuffer sOutgoingLossyByteStreamData(kLossyByteStreamDataBuffe
 // This holds a descriptor for each chunk of lossy byte stream data held in the above buffer
 static CircularQueue<SpokeLossyByteStreamChunkDescriptor> sOutgoingLossyByteStreamDescriptors(kLossyByteStreamDescriptorCount);
 
+// What became of it, since the game began
+static uint32 sLossyByteStreamBytesSent = 0;
+static uint32 sLossyByteStreamChunksDropped = 0;
+
+struct SpokeWorldChecksumReport
+{
+	int32	mTick;
+	uint8	mCount;
+	uint32	mChecksums[kMaximumWorldChecksums];
+};
+
+// Like lossy streaming data, a report goes out once; losing one now and then is harmless
+static CircularQueue<SpokeWorldChecksumReport> sOutgoingWorldChecksumReports(kWorldChecksumReportCount);
+
 // This is currently used only to hold incoming streaming data until it's passed to the upper-level code
 static byte sScratchBuffer[kLossyByteStreamDataBufferSize];
 
 
 static void spoke_became_disconnected();
-static void spoke_received_game_data_packet_v1(AIStream& ps, bool reflected_flags);
+static void spoke_received_game_data_packet_v1(AIStream& ps, bool reflected_flags, bool compressed_flags);
 static void spoke_received_ping_request(AIStream& ps, NetAddrBlock address);
 static void spoke_received_ping_response(AIStream& ps, NetAddrBlock address);
 static void process_messages(AIStream& ps, IncomingGameDataPacketProcessingContext& context);
@@ -160,6 +198,7 @@ static void process_optional_message(AIStream& ps, IncomingGameDataPacketProcess
 static bool spoke_tick();
 static void send_packet();
 static void send_identification_packet();
+static void send_hub_setup_packet();
 
 
 static inline NetworkPlayer_spoke&
@@ -208,7 +247,7 @@ check_send_packet_to_hub()
 
 
 void
-spoke_initialize(const NetAddrBlock& inHubAddress, int32 inFirstTick, size_t inNumberOfPlayers, WritableTickBasedActionQueue* const inPlayerQueues[], bool inPlayerConnected[], size_t inLocalPlayerIndex, bool inHubIsLocal)
+spoke_initialize(const NetAddrBlock& inHubAddress, int32 inFirstTick, size_t inNumberOfPlayers, WritableTickBasedActionQueue* const inPlayerQueues[], bool inPlayerConnected[], size_t inLocalPlayerIndex, bool inHubIsLocal, bool inOfferCompressedFlags)
 {
         assert(inNumberOfPlayers >= 1);
         assert(inLocalPlayerIndex < inNumberOfPlayers);
@@ -220,6 +259,9 @@ spoke_initialize(const NetAddrBlock& inHubAddress, int32 inFirstTick, size_t inN
 
         sLocalPlayerIndex = inLocalPlayerIndex;
 
+	sOfferCompressedFlags = inOfferCompressedFlags;
+	sHubSendsCompressedFlags = false;
+
         sOutgoingFrame = NetDDPNewFrame();
 
         sSmallestRealGameTick = inFirstTick;
@@ -260,6 +302,9 @@ spoke_initialize(const NetAddrBlock& inHubAddress, int32 inFirstTick, size_t inN
 
 	sOutgoingLossyByteStreamDescriptors.reset();
 	sOutgoingLossyByteStreamData.reset();
+	sLossyByteStreamBytesSent = 0;
+	sLossyByteStreamChunksDropped = 0;
+	sOutgoingWorldChecksumReports.reset();
 
         sMessageTypeToMessageHandler.clear();
         sMessageTypeToMessageHandler[kEndOfMessagesMessageType] = handle_end_of_messages_message;
@@ -281,6 +326,23 @@ spoke_initialize(const NetAddrBlock& inHubAddress, int32 inFirstTick, size_t inN
 
 
 
+void
+spoke_announce_game_to_hub(int32 inFirstTick, size_t inNumberOfPlayers, const bool inPlayerConnectedStatus[])
+{
+	sAnnouncedFirstTick = inFirstTick;
+	sAnnouncedNumberOfPlayers = inNumberOfPlayers;
+	sAnnouncedConnectedPlayers = 0;
+	for(size_t i = 0; i < inNumberOfPlayers; i++)
+	{
+		if(inPlayerConnectedStatus[i])
+			sAnnouncedConnectedPlayers |= (((uint32)1) << i);
+	}
+
+	sAnnounceGameToHub = true;
+}
+
+
+
 void
 spoke_cleanup(bool inGraceful)
 {
@@ -304,6 +366,9 @@ spoke_cleanup(bool inGraceful)
 
         // This waits for the tick task to actually finish
         myTMCleanup(true);
+
+	if(sLossyByteStreamBytesSent > 0 || sLossyByteStreamChunksDropped > 0)
+		logNote("spoke sent %u bytes of lossy streaming data, dropped %u chunks", sLossyByteStreamBytesSent, sLossyByteStreamChunksDropped);
         
         sMessageTypeToMessageHandler.clear();
         sNetworkPlayers.clear();
@@ -311,6 +376,7 @@ spoke_cleanup(bool inGraceful)
 	sDisplayLatencyBuffer.clear();
         NetDDPDisposeFrame(sOutgoingFrame);
         sOutgoingFrame = NULL;
+	sAnnounceGameToHub = false;
 }
 
 
@@ -374,12 +440,14 @@ spoke_distribute_lossy_streaming_bytes(int16 inDistributionType, uint32 inDestin
 	if(inLength > sOutgoingLossyByteStreamData.getRemainingSpace())
 	{
 		logNoteNMT("spoke has insufficient buffer space for %hu bytes of outgoing lossy streaming type %hd; discarded", inLength, inDistributionType);
+		sLossyByteStreamChunksDropped++;
 		return;
 	}
 
 	if(sOutgoingLossyByteStreamDescriptors.getRemainingSpace() < 1)
 	{
 		logNoteNMT("spoke has exhausted descriptor buffer space; discarding %hu bytes of outgoing lossy streaming type %hd", inLength, inDistributionType);
+		sLossyByteStreamChunksDropped++;
 		return;
 	}
 	
@@ -387,6 +455,7 @@ spoke_distribute_lossy_streaming_bytes(int16 inDistributionType, uint32 inDestin
 	theDescriptor.mLength = inLength;
 	theDescriptor.mDestinations = inDestinationsBitmask;
 	theDescriptor.mType = inDistributionType;
+	theDescriptor.mNetworkTick = sNetworkTicker;
 
 	logDumpNMT("spoke application decided to send %d bytes of lossy streaming type %d destined for players 0x%x", inLength, inDistributionType, inDestinationsBitmask);
 	
@@ -396,6 +465,24 @@ spoke_distribute_lossy_streaming_bytes(int16 inDistributionType, uint32 inDestin
 
 
 
+void
+spoke_report_world_checksums(int32 inTick, const uint32* inChecksums, size_t inCount)
+{
+	// the oldest report makes way for the newest
+	if(sOutgoingWorldChecksumReports.getRemainingSpace() < 1)
+		sOutgoingWorldChecksumReports.dequeue();
+
+	SpokeWorldChecksumReport theReport;
+	theReport.mTick = inTick;
+	theReport.mCount = std::min(inCount, static_cast<size_t>(kMaximumWorldChecksums));
+	for(int i = 0; i < theReport.mCount; i++)
+		theReport.mChecksums[i] = inChecksums[i];
+
+	sOutgoingWorldChecksumReports.enqueue(theReport);
+}
+
+
+
 static void
 spoke_became_disconnected()
 {
@@ -446,11 +533,19 @@ spoke_received_network_packet(DDPPacketBufferPtr inPacket)
                 switch(thePacketMagic)
                 {
 		case kHubToSpokeGameDataPacketV1Magic:
-			spoke_received_game_data_packet_v1(ps, false);
+			spoke_received_game_data_packet_v1(ps, false, false);
 			break;
 
 		case kHubToSpokeGameDataPacketWithSpokeFlagsV1Magic:
-			spoke_received_game_data_packet_v1(ps, true);
+			spoke_received_game_data_packet_v1(ps, true, false);
+			break;
+
+		case kHubToSpokeGameDataPacketV2Magic:
+			spoke_received_game_data_packet_v1(ps, false, true);
+			break;
+
+		case kHubToSpokeGameDataPacketWithSpokeFlagsV2Magic:
+			spoke_received_game_data_packet_v1(ps, true, true);
 			break;
 		
 		case kPingRequestPacket:
@@ -476,10 +571,13 @@ spoke_received_network_packet(DDPPacketBufferPtr inPacket)
 
 
 static void
-spoke_received_game_data_packet_v1(AIStream& ps, bool reflected_flags)
+spoke_received_game_data_packet_v1(AIStream& ps, bool reflected_flags, bool compressed_flags)
 {
 	sHeardFromHub = true;
 
+	if(compressed_flags)
+		sHubSendsCompressedFlags = true;
+
         IncomingGameDataPacketProcessingContext context;
         
         // Piggybacked ACK
@@ -618,6 +716,9 @@ spoke_received_game_data_packet_v1(AIStream& ps, bool reflected_flags)
 
 	logDumpNMT("%d queue space available", theSmallestQueueSpace);
 
+	for(size_t i = 0; i < sNetworkPlayers.size(); i++)
+		sNetworkPlayers[i].mFlagsRunRemaining = 0;
+
         // Read and enqueue the actual action_flags from the packet
         // The body of this loop is a bit more convoluted than you might
         // expect, because the same loop is used to skip already-seen action_flags
@@ -681,7 +782,18 @@ spoke_received_game_data_packet_v1(AIStream& ps, bool reflected_flags)
                                 // We should have a flag for this player for this tick!
 				try 
 				{
-					ps >> theFlags;
+					if(!compressed_flags)
+						ps >> theFlags;
+					else if(thePlayer.mFlagsRunRemaining > 0)
+					{
+						theFlags = thePlayer.mFlagsRunFlags;
+						thePlayer.mFlagsRunRemaining--;
+					}
+					else
+					{
+						ps >> thePlayer.mFlagsRunRemaining >> theFlags;
+						thePlayer.mFlagsRunFlags = theFlags;
+					}
 				}
 				catch (const AStream::failure& f)
 				{
@@ -978,7 +1090,11 @@ spoke_tick()
 				send_packet();
 		} else {
 			if (!(sNetworkTicker % 30))
+			{
+				if (sAnnounceGameToHub)
+					send_hub_setup_packet();
 				send_identification_packet();
+			}
 		}
 	}
 	else
@@ -1028,26 +1144,48 @@ send_packet()
                 AOStreamBE ps(sOutgoingFrame->data, ddpMaxData, kStarPacketHeaderSize);
         
                 // Packet type
-                hdr << (uint16)kSpokeToHubGameDataPacketV1Magic;
+                hdr << (uint16)(sHubSendsCompressedFlags ? kSpokeToHubGameDataPacketV2Magic : kSpokeToHubGameDataPacketV1Magic);
 
                 // Acknowledgement
                 ps << sSmallestUnreceivedTick;
         
                 // Messages
-		// Outstanding lossy streaming bytes?
-		if(sOutgoingLossyByteStreamDescriptors.getCountOfElements() > 0)
+		// Outstanding lossy streaming bytes?  They get what room is left once
+		// everything else (above all the action flags) is accounted for.
+		int theRoomForLossyBytes = ddpMaxData - static_cast<int>(ps.tellp()) - 2 /* end of messages */;
+		if(sOutgoingWorldChecksumReports.getCountOfElements() > 0)
+			theRoomForLossyBytes -= 4 + 5 + sOutgoingWorldChecksumReports.peek().mCount * 4;
+		if(sOutgoingFlags.size() > 0)
+			theRoomForLossyBytes -= 4 + sOutgoingFlags.size() * (sHubSendsCompressedFlags ? 5 : 4);
+		int theLossyBytesThisPacket = 0;
+
+		while(sOutgoingLossyByteStreamDescriptors.getCountOfElements() > 0)
 		{
+			SpokeLossyByteStreamChunkDescriptor theDescriptor = sOutgoingLossyByteStreamDescriptors.peek();
+			uint16 theMessageLength = theDescriptor.mLength + sizeof(theDescriptor.mType) + sizeof(theDescriptor.mDestinations);
+			int theSpaceNeeded = 4 + theMessageLength;
+			bool isStale = sNetworkTicker - theDescriptor.mNetworkTick > kMaximumLossyByteStreamChunkAge;
+			// (the first chunk may go over the cap, or one too big for it would never go)
+			if(!isStale && (theSpaceNeeded > theRoomForLossyBytes ||
+					(theLossyBytesThisPacket > 0 && theLossyBytesThisPacket + theSpaceNeeded > kMaximumLossyByteStreamBytesPerPacket)))
+				break;
+
 			// Note: we make a conscious decision here to dequeue these things before
 			// writing to ps, so that if the latter operation exhausts ps's buffer and
 			// throws, we have less data to mess with next time, and shouldn't end up
 			// throwing every time we try to send here.
-			// If we eventually got smarter about managing packet space, we could try
-			// harder to preserve and pace data - e.g. change the 'if' immediately before this
-			// comment to a 'while', only put in as much data as we think we can fit, etc.
-			SpokeLossyByteStreamChunkDescriptor theDescriptor = sOutgoingLossyByteStreamDescriptors.peek();
 			sOutgoingLossyByteStreamDescriptors.dequeue();
-			
-			uint16 theMessageLength = theDescriptor.mLength + sizeof(theDescriptor.mType) + sizeof(theDescriptor.mDestinations);
+
+			if(isStale)
+			{
+				logDumpNMT("dropping %d bytes of lossy streaming type %d after %d ticks", theDescriptor.mLength, theDescriptor.mType, sNetworkTicker - theDescriptor.mNetworkTick);
+				sOutgoingLossyByteStreamData.dequeue(theDescriptor.mLength);
+				sLossyByteStreamChunksDropped++;
+				continue;
+			}
+			theRoomForLossyBytes -= theSpaceNeeded;
+			theLossyBytesThisPacket += theSpaceNeeded;
+			sLossyByteStreamBytesSent += theDescriptor.mLength;
 
 			ps << (uint16)kSpokeToHubLossyByteStreamMessageType
 				<< theMessageLength
@@ -1061,6 +1199,21 @@ send_packet()
 
 			ps.write(sScratchBuffer, theDescriptor.mLength);
 		}
+
+		// A world checksum report?
+		if(sOutgoingWorldChecksumReports.getCountOfElements() > 0)
+		{
+			SpokeWorldChecksumReport theReport = sOutgoingWorldChecksumReports.peek();
+			sOutgoingWorldChecksumReports.dequeue();
+
+			uint16 theMessageLength = sizeof(theReport.mTick) + sizeof(theReport.mCount) + theReport.mCount * sizeof(uint32);
+			ps << (uint16)kSpokeToHubWorldChecksumMessageType
+				<< theMessageLength
+				<< theReport.mTick
+				<< theReport.mCount;
+			for(int i = 0; i < theReport.mCount; i++)
+				ps << theReport.mChecksums[i];
+		}
 		
                 // No more messages
                 ps << (uint16)kEndOfMessagesMessageType;
@@ -1070,7 +1223,20 @@ send_packet()
                 {
                         ps << sOutgoingFlags.getReadTick();
                         for(int32 tick = sOutgoingFlags.getReadTick(); tick < sOutgoingFlags.getWriteTick(); tick++)
-                                ps << sOutgoingFlags.peek(tick);
+			{
+				action_flags_t theFlags = sOutgoingFlags.peek(tick);
+				if(sHubSendsCompressedFlags)
+				{
+					uint8 theRepeats = 0;
+					while(theRepeats < kMaximumActionFlagsRunLength && tick + 1 < sOutgoingFlags.getWriteTick() && sOutgoingFlags.peek(tick + 1) == theFlags)
+					{
+						theRepeats++;
+						tick++;
+					}
+					ps << theRepeats;
+				}
+                                ps << theFlags;
+			}
                 }
 
 		logDumpNMT("preparing to send packet: ACK %d, flags [%d,%d)", sSmallestUnreceivedTick, sOutgoingFlags.getReadTick(), sOutgoingFlags.getWriteTick());
@@ -1111,6 +1277,10 @@ send_identification_packet()
                 // ID
                 ps << (uint16)sLocalPlayerIndex;
 
+		// Options (older hubs don't read this far)
+		if(sOfferCompressedFlags)
+			ps << (uint8)kIdentificationOffersCompressedFlags;
+
 		// blank out the CRC field before calculating
 		sOutgoingFrame->data[2] = 0;
 		sOutgoingFrame->data[3] = 0;
@@ -1129,11 +1299,46 @@ send_identification_packet()
         }
 }
 
+static void
+send_hub_setup_packet()
+{
+        try {
+		AOStreamBE hdr(sOutgoingFrame->data, kStarPacketHeaderSize);
+                AOStreamBE ps(sOutgoingFrame->data, ddpMaxData, kStarPacketHeaderSize);
+
+		hdr << (uint16) kGathererToHubSetupPacket;
+
+		ps << sAnnouncedFirstTick;
+		ps << sAnnouncedNumberOfPlayers;
+		ps << sAnnouncedConnectedPlayers;
+
+		// blank out the CRC field before calculating
+		sOutgoingFrame->data[2] = 0;
+		sOutgoingFrame->data[3] = 0;
+
+		uint16 crc = calculate_data_crc_ccitt(sOutgoingFrame->data, ps.tellp());
+		hdr << crc;
+
+                sOutgoingFrame->data_size = ps.tellp();
+                NetDDPSendFrame(sOutgoingFrame, &sHubAddress, kPROTOCOL_TYPE, 0 /* ignored */);
+        }
+        catch (...) {
+        }
+}
+
+
+
 int32 spoke_latency()
 {
 	return (sDisplayLatencyCount >= TICKS_PER_SECOND) ? sDisplayLatencyTicks * 1000 / TICKS_PER_SECOND / sDisplayLatencyBuffer.size() : NetworkStats::invalid;
 }
 
+void spoke_lossy_byte_stream_stats(NetworkStats& ioStats)
+{
+	ioStats.lossy_bytes_sent = sLossyByteStreamBytesSent;
+	ioStats.lossy_chunks_dropped = sLossyByteStreamChunksDropped;
+}
+
 TickBasedActionQueue* spoke_get_unconfirmed_flags_queue()
 {
 	return &sUnconfirmedFlags;
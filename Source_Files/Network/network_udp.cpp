@@ -27,6 +27,11 @@
  *  Sept-Nov 2001 (Woody Zenfell): a few additions to implement socket-listening thread.
  *
  *  May 18, 2003 (Woody Zenfell): now uses passed-in port number for local socket.
+ *
+ *  Oct 14, 2026: on Linux, our own socket with recvmmsg()/sendmmsg(), so a burst of
+ *	datagrams costs one system call each way; NetDDPBeginBatch()/NetDDPFlushBatch().
+ *	Frames come from a fixed pool, and batched datagrams are received in place.
+ *	Incoming datagrams can be held back, shuffled and lost (NetDDPSetConditions()).
  */
 
 #if !defined(DISABLE_NETWORKING)
@@ -36,16 +41,30 @@
 #include "network_private.h"
 
 #include <SDL_thread.h>
+#include <SDL_atomic.h>
 
 #include "thread_priority_sdl.h"
 #include "mytm.h" // mytm_mutex stuff
+#include "Trace.h"
+#include "network_conditions.h"
+
+#if defined(__linux__)
+#define HAVE_BATCHED_UDP
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
 
 // Global variables (most comments and "sSomething" variables are ZZZ)
 // Storage for incoming packet data
 static UDPpacket*		sUDPPacketBuffer	= NULL;
 
+#ifndef HAVE_BATCHED_UDP
 // Storage for the DDP packet we pass back to the handler proc
 static DDPPacketBuffer		ddpPacketBuffer;
+#endif
 
 // Keep track of our one sending/receiving socket
 static UDPsocket 		sSocket			= NULL;
@@ -62,22 +81,167 @@ static SDL_Thread*		sReceivingThread	= NULL;
 // See if the receiving thread should exit
 static volatile bool		sKeepListening		= false;
 
+// Only the receiving thread touches these while the socket is open
+static NetworkConditionEmulator	sConditionEmulator;
+static bool			sEmulatingConditions	= false;
+static DDPPacketBuffer		sEmulatedPacket;
+
+// How long the receiving thread may wait for datagrams; less when held ones come due
+static int
+receive_timeout() {
+    int theTimeout = 1000;
+    if(sEmulatingConditions) {
+        int32 theTimeUntilNext = sConditionEmulator.timeUntilNext(SDL_GetTicks());
+        if(theTimeUntilNext >= 0 && theTimeUntilNext < theTimeout)
+            theTimeout = theTimeUntilNext;
+    }
+    return theTimeout;
+}
+
+// Call with the mytm mutex held
+static void
+deliver_held_packets() {
+    if(!sEmulatingConditions)
+        return;
+
+    uint32 theNow = SDL_GetTicks();
+    while(sConditionEmulator.deliver(theNow, sEmulatedPacket))
+        sPacketHandler(&sEmulatedPacket);
+}
+
+#ifdef HAVE_BATCHED_UDP
+// Datagrams moved per system call
+enum { kBatchSize = 32 };
+
+// SDL_net doesn't hand out its descriptor, so we keep a socket of our own
+static int			sSocketDescriptor	= -1;
+
+struct DatagramBatch
+{
+	struct mmsghdr		messages[kBatchSize];
+	struct iovec		vectors[kBatchSize];
+	struct sockaddr_in	addresses[kBatchSize];
+};
+
+// Datagrams are received straight into the buffers handed to the packet handler
+static DatagramBatch		sReceiveBatch;
+static DDPPacketBuffer		sReceivedPackets[kBatchSize];
+
+// Outgoing frames wait here between NetDDPBeginBatch() and NetDDPFlushBatch();
+// like sUDPPacketBuffer, only to be touched with the mytm mutex held
+static DatagramBatch		sSendBatch;
+static byte			sSendData[kBatchSize][ddpMaxData];
+static int			sSendBatchCount		= 0;
+static bool			sBatchingSends		= false;
+static int			sBatchDepth		= 0; // batches may be nested; the outermost flush sends
+
+static OSErr
+send_batch()
+{
+	OSErr theError = 0;
+	int theSent = 0;
+	while (theSent < sSendBatchCount) {
+		int theResult = sendmmsg(sSocketDescriptor, sSendBatch.messages + theSent, sSendBatchCount - theSent, 0);
+		if (theResult <= 0) {
+			// datagrams get lost anyway; the protocols above us cope
+			theError = -1;
+			break;
+		}
+		theSent += theResult;
+	}
+	sSendBatchCount = 0;
+	return theError;
+}
+
+static void
+prepare_batch_entry(DatagramBatch& batch, int i, byte *data, size_t length)
+{
+	batch.vectors[i].iov_base = data;
+	batch.vectors[i].iov_len = length;
+	memset(&batch.messages[i].msg_hdr, 0, sizeof(batch.messages[i].msg_hdr));
+	batch.messages[i].msg_hdr.msg_name = &batch.addresses[i];
+	batch.messages[i].msg_hdr.msg_namelen = sizeof(batch.addresses[i]);
+	batch.messages[i].msg_hdr.msg_iov = &batch.vectors[i];
+	batch.messages[i].msg_hdr.msg_iovlen = 1;
+	batch.messages[i].msg_len = 0;
+}
+#endif
+
 
 // ZZZ: the socket listening thread loops in this function.  It calls the registered
 // packet handler when it gets something.
+#ifdef HAVE_BATCHED_UDP
 static int
 receive_thread_function(void*) {
     while(true) {
         // We listen with a timeout so we can shut ourselves down when needed.
-        int theResult = SDLNet_CheckSockets(sSocketSet, 1000);
+        struct pollfd thePollDescriptor;
+        thePollDescriptor.fd = sSocketDescriptor;
+        thePollDescriptor.events = POLLIN;
+        thePollDescriptor.revents = 0;
+        int theResult = poll(&thePollDescriptor, 1, receive_timeout());
+
+        if(!sKeepListening)
+            break;
+
+        int theCount = 0;
+        if(theResult > 0 && (thePollDescriptor.revents & POLLIN)) {
+            for(int i = 0; i < kBatchSize; i++)
+                prepare_batch_entry(sReceiveBatch, i, sReceivedPackets[i].datagramData, ddpMaxData);
+
+            theCount = recvmmsg(sSocketDescriptor, sReceiveBatch.messages, kBatchSize, MSG_DONTWAIT, NULL);
+        }
+
+        for(int i = 0; i < theCount; i++) {
+            DDPPacketBuffer& thePacket	= sReceivedPackets[i];
+            thePacket.protocolType		= kPROTOCOL_TYPE;
+            thePacket.sourceAddress.host	= sReceiveBatch.addresses[i].sin_addr.s_addr;
+            thePacket.sourceAddress.port	= sReceiveBatch.addresses[i].sin_port;
+            thePacket.datagramSize		= sReceiveBatch.messages[i].msg_len;
+        }
+
+        if(sEmulatingConditions) {
+            uint32 theNow = SDL_GetTicks();
+            for(int i = 0; i < theCount; i++)
+                sConditionEmulator.arrived(sReceivedPackets[i], theNow);
+            theCount = 0;
+        }
+        else if(theCount <= 0)
+            continue;
+
+        Tracer::NameThread("network receive");
+        TRACE_SPAN("receive packets");
+        if(take_mytm_mutex()) {
+            for(int i = 0; i < theCount; i++)
+                sPacketHandler(&sReceivedPackets[i]);
+            deliver_held_packets();
+
+            release_mytm_mutex();
+        }
+        else
+            fdprintf("could not take mytm mutex - incoming packets dropped");
+    }
+
+    return 0;
+}
+#else
+static int
+receive_thread_function(void*) {
+    while(true) {
+        // We listen with a timeout so we can shut ourselves down when needed.
+        int theResult = SDLNet_CheckSockets(sSocketSet, receive_timeout());
         
         if(!sKeepListening)
             break;
         
-        if(theResult > 0) {
+        if(theResult > 0)
             theResult = SDLNet_UDP_Recv(sSocket, sUDPPacketBuffer);
-            if(theResult > 0) {
-                if(take_mytm_mutex()) {
+
+        if(theResult > 0 || sEmulatingConditions) {
+            Tracer::NameThread("network receive");
+            TRACE_SPAN("receive packet");
+            if(take_mytm_mutex()) {
+                if(theResult > 0) {
                     ddpPacketBuffer.protocolType	= kPROTOCOL_TYPE;
                     ddpPacketBuffer.sourceAddress	= sUDPPacketBuffer->address;
                     ddpPacketBuffer.datagramSize	= sUDPPacketBuffer->len;
@@ -86,18 +250,23 @@ receive_thread_function(void*) {
                     // (As I recall, all uses happen in sPacketHandler and its progeny, so we should be fine.)
                     memcpy(ddpPacketBuffer.datagramData, sUDPPacketBuffer->data, sUDPPacketBuffer->len);
                     
-                    sPacketHandler(&ddpPacketBuffer);
-                    
-                    release_mytm_mutex();
+                    if(sEmulatingConditions)
+                        sConditionEmulator.arrived(ddpPacketBuffer, SDL_GetTicks());
+                    else
+                        sPacketHandler(&ddpPacketBuffer);
                 }
-                else
-                    fdprintf("could not take mytm mutex - incoming packet dropped");
+                deliver_held_packets();
+                
+                release_mytm_mutex();
             }
+            else
+                fdprintf("could not take mytm mutex - incoming packet dropped");
         }
     }
     
     return 0;
 }
+#endif // HAVE_BATCHED_UDP
 
 
 /*
@@ -129,6 +298,31 @@ OSErr NetDDPOpenSocket(short *ioPortNumber, PacketHandlerProcPtr packetHandler)
 //fdprintf("NetDDPOpenSocket\n");
 	assert(packetHandler);
 
+#ifdef HAVE_BATCHED_UDP
+	assert(sSocketDescriptor < 0);
+	sSocketDescriptor = socket(AF_INET, SOCK_DGRAM, 0);
+	if (sSocketDescriptor < 0)
+		return -1;
+
+	// SDL_net allows broadcast on its UDP sockets; so do we
+	int theBroadcastFlag = 1;
+	setsockopt(sSocketDescriptor, SOL_SOCKET, SO_BROADCAST, &theBroadcastFlag, sizeof(theBroadcastFlag));
+
+	struct sockaddr_in theLocalAddress;
+	memset(&theLocalAddress, 0, sizeof(theLocalAddress));
+	theLocalAddress.sin_family = AF_INET;
+	theLocalAddress.sin_addr.s_addr = htonl(INADDR_ANY);
+	theLocalAddress.sin_port = *ioPortNumber;
+	if (bind(sSocketDescriptor, (struct sockaddr *)&theLocalAddress, sizeof(theLocalAddress)) < 0) {
+		close(sSocketDescriptor);
+		sSocketDescriptor = -1;
+		return -1;
+	}
+
+	sSendBatchCount = 0;
+	sBatchingSends = false;
+	sBatchDepth = 0;
+#else
 	// Allocate packet buffer (this is Christian's part)
 	assert(!sUDPPacketBuffer);
 	sUDPPacketBuffer = SDLNet_AllocPacket(ddpMaxData);
@@ -149,6 +343,7 @@ OSErr NetDDPOpenSocket(short *ioPortNumber, PacketHandlerProcPtr packetHandler)
         // Set up socket set
         sSocketSet = SDLNet_AllocSocketSet(1);
         SDLNet_UDP_AddSocket(sSocketSet, sSocket);
+#endif // HAVE_BATCHED_UDP
         
         // Set up receiver
         sKeepListening		= true;
@@ -181,7 +376,17 @@ OSErr NetDDPCloseSocket(short portNumber)
             SDL_WaitThread(sReceivingThread, NULL);
             sReceivingThread	= NULL;
         }
+        sConditionEmulator.reset();
 
+#ifdef HAVE_BATCHED_UDP
+	if (sSocketDescriptor >= 0) {
+		close(sSocketDescriptor);
+		sSocketDescriptor = -1;
+	}
+	sSendBatchCount = 0;
+	sBatchingSends = false;
+	sBatchDepth = 0;
+#else
         if(sSocketSet) {
             SDLNet_FreeSocketSet(sSocketSet);
             sSocketSet = NULL;
@@ -195,6 +400,7 @@ OSErr NetDDPCloseSocket(short portNumber)
 		SDLNet_UDP_Close(sSocket);
 		sSocket = NULL;
 	}
+#endif // HAVE_BATCHED_UDP
 	return 0;
 }
 
@@ -203,10 +409,24 @@ OSErr NetDDPCloseSocket(short portNumber)
  *  Allocate frame
  */
 
+// Frames come out of a small fixed pool, claimed with an atomic compare-and-swap so that
+// the receiving thread and the tick tasks can share it without locking; the heap only
+// sees requests beyond the pool's size.
+enum { kFramePoolSize = 8 };
+static DDPFrame		sFramePool[kFramePoolSize];
+static SDL_atomic_t	sFramePoolInUse[kFramePoolSize];
+
 DDPFramePtr NetDDPNewFrame(void)
 {
 //fdprintf("NetDDPNewFrame\n");
-	DDPFramePtr frame = (DDPFramePtr)malloc(sizeof(DDPFrame));
+	DDPFramePtr frame = NULL;
+	for (int i = 0; i < kFramePoolSize && !frame; i++) {
+		if (SDL_AtomicCAS(&sFramePoolInUse[i], 0, 1))
+			frame = &sFramePool[i];
+	}
+	if (!frame)
+		frame = (DDPFramePtr)malloc(sizeof(DDPFrame));
+
 	if (frame) {
 		memset(frame, 0, sizeof(DDPFrame));
 		frame->socket = sSocket;
@@ -222,7 +442,9 @@ DDPFramePtr NetDDPNewFrame(void)
 void NetDDPDisposeFrame(DDPFramePtr frame)
 {
 //fdprintf("NetDDPDisposeFrame\n");
-	if (frame)
+	if (frame >= sFramePool && frame < sFramePool + kFramePoolSize)
+		SDL_AtomicSet(&sFramePoolInUse[frame - sFramePool], 0);
+	else if (frame)
 		free(frame);
 }
 
@@ -236,11 +458,76 @@ OSErr NetDDPSendFrame(DDPFramePtr frame, NetAddrBlock *address, short protocolTy
 //fdprintf("NetDDPSendFrame\n");
 	assert(frame->data_size <= ddpMaxData);
 
+#ifdef HAVE_BATCHED_UDP
+	if (sSocketDescriptor < 0)
+		return -1;
+
+	if (sBatchingSends) {
+		if (sSendBatchCount == kBatchSize)
+			send_batch();
+
+		int i = sSendBatchCount++;
+		prepare_batch_entry(sSendBatch, i, sSendData[i], frame->data_size);
+		memcpy(sSendData[i], frame->data, frame->data_size);
+		memset(&sSendBatch.addresses[i], 0, sizeof(sSendBatch.addresses[i]));
+		sSendBatch.addresses[i].sin_family = AF_INET;
+		sSendBatch.addresses[i].sin_addr.s_addr = address->host;
+		sSendBatch.addresses[i].sin_port = address->port;
+		return 0;
+	}
+
+	struct sockaddr_in theAddress;
+	memset(&theAddress, 0, sizeof(theAddress));
+	theAddress.sin_family = AF_INET;
+	theAddress.sin_addr.s_addr = address->host;
+	theAddress.sin_port = address->port;
+	return sendto(sSocketDescriptor, frame->data, frame->data_size, 0, (struct sockaddr *)&theAddress, sizeof(theAddress)) == frame->data_size ? 0 : -1;
+#else
 	sUDPPacketBuffer->channel = -1;
 	memcpy(sUDPPacketBuffer->data, frame->data, frame->data_size);
 	sUDPPacketBuffer->len = frame->data_size;
 	sUDPPacketBuffer->address = *address;
 	return SDLNet_UDP_Send(sSocket, -1, sUDPPacketBuffer) ? 0 : -1;
+#endif
+}
+
+
+/*
+ *  Network condition emulation, for incoming datagrams
+ */
+
+void NetDDPSetConditions(const NetworkConditions& inConditions)
+{
+	assert(!sReceivingThread);
+	sConditionEmulator.setConditions(inConditions);
+	sConditionEmulator.reset();
+	sEmulatingConditions = inConditions.active();
+}
+
+
+/*
+ *  Batched sending: frames sent in between go out together at the flush
+ *  (where there is no batched system call, they simply go out as sent)
+ */
+
+void NetDDPBeginBatch(void)
+{
+#ifdef HAVE_BATCHED_UDP
+	sBatchDepth++;
+	sBatchingSends = true;
+#endif
+}
+
+OSErr NetDDPFlushBatch(void)
+{
+#ifdef HAVE_BATCHED_UDP
+	if (sBatchDepth > 0 && --sBatchDepth > 0)
+		return 0;
+	sBatchingSends = false;
+	return send_batch();
+#else
+	return 0;
+#endif
 }
 
 #endif // !defined(DISABLE_NETWORKING)
@@ -0,0 +1,192 @@
+/*
+ *  port_mapping.cpp
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+ *  UPnP port mapping on a thread of its own (see port_mapping.h)
+ */
+
+#if !defined(DISABLE_NETWORKING)
+
+#include "port_mapping.h"
+#include "libnat.h"
+#include "Logging.h"
+
+#include <SDL_thread.h>
+#include <SDL_timer.h>
+
+// How long the gatherer waits to hear from the router before telling the user it won't;
+// LibNAT's own timeouts can add up to more than this on a network without UPnP
+static const uint32 kPortMappingPatience = 8000;
+
+static SDL_Thread *sThread = NULL;
+static SDL_mutex *sLock = NULL;
+
+// Guarded by sLock while the thread runs
+static PortMappingStatus sStatus = kPortMappingOff;
+static int sError = 0;
+
+// The thread's own while it runs, ours otherwise
+static UpnpController *sRouter = NULL; // kept from game to game
+static uint16 sPort = 0;
+
+static uint32 sStartTicks = 0;
+static bool sFailureTaken = false;
+
+static void set_status(PortMappingStatus inStatus, int inError)
+{
+	SDL_LockMutex(sLock);
+	sStatus = inStatus;
+	sError = inError;
+	SDL_UnlockMutex(sLock);
+}
+
+static int map_port(UpnpController *inRouter, uint16 inPort)
+{
+	int ret;
+	if ((ret = LNat_Upnp_Set_Port_Mapping(inRouter, NULL, inPort, "TCP")) != 0)
+	{
+		logWarning("LibNAT: Failed to map port %d (TCP)", inPort);
+		return ret;
+	}
+	if ((ret = LNat_Upnp_Set_Port_Mapping(inRouter, NULL, inPort, "UDP")) != 0)
+	{
+		logWarning("LibNAT: Failed to map port %d (UDP)", inPort);
+		LNat_Upnp_Remove_Port_Mapping(inRouter, inPort, "TCP");
+		return ret;
+	}
+	return 0;
+}
+
+static int port_mapping_thread(void *)
+{
+	int ret = LNAT_ERROR;
+
+	// The router that took it last time most likely still will
+	if (sRouter)
+	{
+		if ((ret = map_port(sRouter, sPort)) != 0)
+		{
+			logNote("LibNAT: looking for the UPnP controller again");
+			LNat_Upnp_Controller_Free(&sRouter);
+			sRouter = NULL;
+		}
+	}
+
+	if (ret != 0)
+	{
+		char public_ip[32];
+		if ((ret = LNat_Upnp_Discover(&sRouter)) != 0)
+		{
+			logWarning("LibNAT: Failed to discover UPnP controller");
+			sRouter = NULL;
+		}
+		else if ((ret = LNat_Upnp_Get_Public_Ip(sRouter, public_ip, sizeof(public_ip))) != 0)
+			logWarning("LibNAT: Failed to acquire public IP");
+		else
+			ret = map_port(sRouter, sPort);
+
+		if (ret != 0 && sRouter)
+		{
+			LNat_Upnp_Controller_Free(&sRouter);
+			sRouter = NULL;
+		}
+	}
+
+	if (ret == 0 && SDL_GetTicks() - sStartTicks > kPortMappingPatience)
+		logNote("LibNAT: port %d mapped after all", sPort);
+
+	set_status(ret == 0 ? kPortMappingOpen : kPortMappingFailed, ret);
+	return 0;
+}
+
+static void wait_for_thread()
+{
+	if (sThread)
+	{
+		SDL_WaitThread(sThread, NULL);
+		sThread = NULL;
+	}
+}
+
+void PortMappingStart(uint16 inPort)
+{
+	PortMappingStop();
+
+	if (!sLock) sLock = SDL_CreateMutex();
+
+	sPort = inPort;
+	sStartTicks = SDL_GetTicks();
+	sFailureTaken = false;
+	set_status(kPortMappingWorking, 0);
+
+	sThread = SDL_CreateThread(port_mapping_thread, "PortMapping_thread", NULL);
+	if (!sThread)
+		port_mapping_thread(NULL);
+}
+
+PortMappingStatus PortMappingGetStatus()
+{
+	if (!sLock) return kPortMappingOff;
+
+	SDL_LockMutex(sLock);
+	PortMappingStatus theStatus = sStatus;
+	SDL_UnlockMutex(sLock);
+	return theStatus;
+}
+
+bool PortMappingTakeFailure(int& outError)
+{
+	if (sFailureTaken || !sLock) return false;
+
+	SDL_LockMutex(sLock);
+	PortMappingStatus theStatus = sStatus;
+	outError = sError;
+	SDL_UnlockMutex(sLock);
+
+	if (theStatus == kPortMappingWorking && SDL_GetTicks() - sStartTicks > kPortMappingPatience)
+	{
+		logWarning("LibNAT: gave up waiting for the UPnP controller");
+		outError = SOCKET_RECV_TIMEOUT;
+	}
+	else if (theStatus != kPortMappingFailed)
+		return false;
+
+	sFailureTaken = true;
+	return true;
+}
+
+bool PortMappingActive()
+{
+	return sThread || PortMappingGetStatus() == kPortMappingOpen;
+}
+
+void PortMappingStop()
+{
+	wait_for_thread();
+
+	if (PortMappingGetStatus() == kPortMappingOpen)
+	{
+		LNat_Upnp_Remove_Port_Mapping(sRouter, sPort, "TCP");
+		LNat_Upnp_Remove_Port_Mapping(sRouter, sPort, "UDP");
+	}
+
+	if (sLock)
+		set_status(kPortMappingOff, 0);
+}
+
+#endif // !defined(DISABLE_NETWORKING)
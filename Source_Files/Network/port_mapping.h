@@ -0,0 +1,53 @@
+#ifndef PORT_MAPPING_H
+#define PORT_MAPPING_H
+
+/*
+ *  port_mapping.h
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+ *  Opening the game port on a UPnP router (LibNAT) without holding up the gatherer:
+ *  finding the router and asking it for the port happen on a thread of their own,
+ *  and the router found is remembered for the games after, so it needn't be looked for again.
+ */
+
+#include "cseries.h"
+
+enum PortMappingStatus
+{
+	kPortMappingOff,	// nothing asked for, or closed again
+	kPortMappingWorking,	// still finding the router or asking it
+	kPortMappingOpen,	// the router forwards the port, TCP and UDP
+	kPortMappingFailed
+};
+
+// Starts opening inPort; returns at once
+void PortMappingStart(uint16 inPort);
+
+PortMappingStatus PortMappingGetStatus();
+
+// True, only the once, if opening the port failed or has taken too long to wait for;
+// outError is LibNAT's error code
+bool PortMappingTakeFailure(int& outError);
+
+// Whether PortMappingStop() has anything to do (and may take a moment doing it)
+bool PortMappingActive();
+
+// Waits for a start still at work, and closes the port again if it was opened
+void PortMappingStop();
+
+#endif // PORT_MAPPING_H
@@ -66,9 +66,9 @@ public:
 	// Load from list:
 	void Load(vector<short>& _FrameList);
 	
-	// Translate the frame; indicate whether the frame was translated.
-	// Its argument is the frame ID, which gets changed in place
-	bool Translate(short& Frame);
+	// Write the translation of every frame it translates into a table by frame ID;
+	// if selecting all, a frame is translated by its place in the list
+	void Remap(vector<short>& Table);
 	
 	// Set the timing info: number of ticks per frame, and tick and frame phases
 	void SetTiming(short _NumTicks, size_t _FramePhase, size_t _TickPhase);
@@ -110,34 +110,25 @@ void AnimTxtr::Load(vector<short>& _FrameList)
 }
 
 
-bool AnimTxtr::Translate(short& Frame)
+void AnimTxtr::Remap(vector<short>& Table)
 {
-	// Sanity check
 	size_t NumFrames = FrameList.size();
-	if (NumFrames == 0) return false;
-
-	// Find the index in the loop; default: first one.
-	size_t FrameIndex = 0;
+	if (NumFrames == 0) return;
+	
 	if (Select >= 0)
 	{
-		if (Frame != Select) return false;
+		if (static_cast<size_t>(Select) < Table.size())
+			Table[Select] = FrameList[FramePhase % NumFrames];
+		return;
 	}
-	else
+	
+	// Where a frame is listed more than once, the last listing wins
+	for (size_t f=0; f<NumFrames; f++)
 	{
-		bool FrameFound = false;
-		for (size_t f=0; f<NumFrames; f++)
-			if (FrameList[f] == Frame)
-			{
-				FrameFound = true;
-				FrameIndex = f;
-			}
-		if (!FrameFound) return false;
-	}	
-	FrameIndex += FramePhase;
-	FrameIndex %= NumFrames;
-		
-	Frame = FrameList[FrameIndex];
-	return true;
+		short Frame = FrameList[f];
+		if (Frame >= 0 && static_cast<size_t>(Frame) < Table.size())
+			Table[Frame] = FrameList[(f + FramePhase) % NumFrames];
+	}
 }
 
 
@@ -201,11 +192,38 @@ void AnimTxtr::Update()
 // to speed up searching
 static vector<AnimTxtr> AnimTxtrList[NUMBER_OF_COLLECTIONS];
 
+// What each frame of a collection is translated into at the current phases,
+// by frame ID; empty for a collection with no sequences
+const size_t NUMBER_OF_REMAPPED_FRAMES = MAXIMUM_SHAPES_PER_COLLECTION;
+static vector<short> FrameRemap[NUMBER_OF_COLLECTIONS];
+
+
+// Rebuilds a collection's frame table from its sequences
+static void ATRemap(int c)
+{
+	vector<AnimTxtr>& ATL = AnimTxtrList[c];
+	vector<short>& Table = FrameRemap[c];
+	if (ATL.empty())
+	{
+		Table.clear();
+		return;
+	}
+	
+	Table.resize(NUMBER_OF_REMAPPED_FRAMES);
+	for (size_t f=0; f<NUMBER_OF_REMAPPED_FRAMES; f++)
+		Table[f] = static_cast<short>(f);
+	
+	// The first sequence to translate a frame wins, so it gets the last word
+	for (vector<AnimTxtr>::reverse_iterator ATIter = ATL.rbegin(); ATIter != ATL.rend(); ++ATIter)
+		ATIter->Remap(Table);
+}
+
 
 // Deletes a collection's animated-texture sequences
 static void ATDelete(int c)
 {
 	AnimTxtrList[c].clear();
+	ATRemap(c);
 }
 
 
@@ -222,8 +240,10 @@ void AnimTxtr_Update()
 	for (int c=0; c<NUMBER_OF_COLLECTIONS; c++)
 	{
 		vector<AnimTxtr>& ATL = AnimTxtrList[c];
+		if (ATL.empty()) continue;
 		for (vector<AnimTxtr>::iterator ATIter = ATL.begin(); ATIter < ATL.end(); ATIter++)
 			ATIter->Update();
+		ATRemap(c);
 	}
 }
 
@@ -243,9 +263,9 @@ shape_descriptor AnimTxtr_Translate(shape_descriptor Texture)
 	// that could be handled as map preprocessing, by turning
 	// all shape descriptors that refer to unloaded shapes to NONE
 	
-	vector<AnimTxtr>& ATL = AnimTxtrList[Collection];
-	for (vector<AnimTxtr>::iterator ATIter = ATL.begin(); ATIter < ATL.end(); ATIter++)
-		if (ATIter->Translate(Frame)) break;
+	const vector<short>& Table = FrameRemap[Collection];
+	if (!Table.empty())
+		Frame = Table[Frame];
 	
 	// Check the frame for being in range
 	if (Frame < 0) return UNONE;
@@ -286,7 +306,7 @@ void parse_mml_animated_textures(const InfoTree& root)
 				continue;
 			
 			vector<short> frames;
-			BOOST_FOREACH(InfoTree frame, child.children_named("frame"))
+			BOOST_FOREACH(const InfoTree &frame, child.children_named("frame"))
 			{
 				int16 index = -1;
 				if (frame.read_indexed("index", index, 255))
@@ -307,6 +327,7 @@ void parse_mml_animated_textures(const InfoTree& root)
 			new_anim.SetTiming(numticks, frame_phase, tick_phase);
 			new_anim.Select = select;
 			AnimTxtrList[coll].push_back(new_anim);
+			ATRemap(coll);
 		}
 	}
 }
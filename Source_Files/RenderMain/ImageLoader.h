@@ -91,6 +91,11 @@ public:
 	void PremultiplyAlpha();
 	bool PremultipliedAlpha; // public so find silhouette version can unset
 
+	// Raw copy of the processed image and its mipmaps, for the texture cache;
+	// only meaningful on the machine that wrote it
+	bool ReadCached(OpenedFile& File);
+	bool WriteCached(OpenedFile& File) const;
+
 	// Clearing
 	void Clear()
 		{Width = Height = Size = 0; delete []Pixels; Pixels = NULL;}
@@ -175,6 +180,14 @@ public:
         return _copy;
 	}
 
+	// gives up possession of the copy, if any
+	T* release() {
+		T* copy = _copy;
+		_copy = NULL;
+		_original = NULL;
+		return copy;
+	}
+
 	~copy_on_edit() {
 		if (_copy) {
 			delete _copy;
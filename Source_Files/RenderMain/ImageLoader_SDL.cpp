@@ -83,6 +83,7 @@ bool ImageDescriptor::LoadFromFile(FileSpecifier& File, int ImgMode, int flags,
 	switch (ImgMode) {
 		case ImageLoader_Colors:
 			Resize(Width, Height);
+			Format = RGBA8;
 			VScale = ((double) OriginalWidth / (double) Width);
 			UScale = ((double) OriginalHeight / (double) Height);
 			MipMapCount = 0;
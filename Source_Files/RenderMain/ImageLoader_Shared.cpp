@@ -201,6 +201,60 @@ ImageDescriptor::ImageDescriptor(int _Width, int _Height, uint32 *_Pixels) :
 	Size = _Width * _Height * 4;
 }
 
+// Past any texture's, so entries claiming more are corrupt
+static const int kMaximumCachedDimension = 16384;
+static const int kMaximumCachedMipMaps = 16;
+
+bool ImageDescriptor::ReadCached(OpenedFile& File)
+{
+	int32 Header[6];
+	if (!File.Read(sizeof(Header), Header)) return false;
+	if (!File.Read(sizeof(VScale), &VScale)) return false;
+	if (!File.Read(sizeof(UScale), &UScale)) return false;
+
+	if (Header[0] <= 0 || Header[1] <= 0 || Header[2] <= 0) return false;
+	if (Header[0] > kMaximumCachedDimension || Header[1] > kMaximumCachedDimension) return false;
+	if (Header[3] < 0 || Header[3] > kMaximumCachedMipMaps) return false;
+	if (Header[4] < RGBA8 || Header[4] >= Unknown) return false;
+
+	// a stale or corrupt entry mustn't choose what we allocate and read
+	Width = Header[0];
+	Height = Header[1];
+	Format = (ImageFormat) Header[4];
+	int ExpectedSize = 0;
+	for (int i = 0; i < MAX(1, Header[3]); i++) {
+		if (Width >> i == 0 && Height >> i == 0) break;
+		ExpectedSize += GetMipMapSize(i);
+	}
+	if (Header[2] != ExpectedSize)
+	{
+		Clear();
+		return false;
+	}
+	
+	Resize(Header[0], Header[1], Header[2]);
+	MipMapCount = Header[3];
+	PremultipliedAlpha = (Header[5] != 0);
+
+	if (!File.Read(Size, Pixels))
+	{
+		Clear();
+		return false;
+	}
+	return true;
+}
+
+bool ImageDescriptor::WriteCached(OpenedFile& File) const
+{
+	if (!IsPresent()) return false;
+	
+	int32 Header[6] = { Width, Height, Size, MipMapCount, Format, PremultipliedAlpha };
+	double Scales[2] = { VScale, UScale };
+	return File.Write(sizeof(Header), Header) &&
+		File.Write(sizeof(Scales), Scales) &&
+		File.Write(Size, Pixels);
+}
+
 static inline int padfour(int x)
 {
 	return (x + 3) / 4 * 4;
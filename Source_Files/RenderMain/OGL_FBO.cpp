@@ -27,6 +27,7 @@
 
 #include "OGL_Setup.h"
 #include "OGL_Render.h"
+#include "OGL_Textures.h"
 
 std::vector<FBO *> FBO::active_chain;
 
@@ -184,10 +185,10 @@ void FBOSwapper::blend_multisample(FBO& other) {
 	activate();
 	
 	// set up FBO passed in as texture #1
-	glActiveTextureARB(GL_TEXTURE1_ARB);
+	OGL_ActiveTexture(GL_TEXTURE1_ARB);
 	glBindTexture(GL_TEXTURE_RECTANGLE_ARB, other.texID);
 	glEnable(GL_TEXTURE_RECTANGLE_ARB);
-	glActiveTextureARB(GL_TEXTURE0_ARB);
+	OGL_ActiveTexture(GL_TEXTURE0_ARB);
 	
 	glClientActiveTextureARB(GL_TEXTURE1_ARB);
 	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
@@ -198,9 +199,9 @@ void FBOSwapper::blend_multisample(FBO& other) {
 	draw(true);
 	
 	// tear down multitexture stuff
-	glActiveTextureARB(GL_TEXTURE1_ARB);
+	OGL_ActiveTexture(GL_TEXTURE1_ARB);
 	glDisable(GL_TEXTURE_RECTANGLE_ARB);
-	glActiveTextureARB(GL_TEXTURE0_ARB);
+	OGL_ActiveTexture(GL_TEXTURE0_ARB);
 	
 	glClientActiveTextureARB(GL_TEXTURE1_ARB);
 	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
@@ -31,6 +31,7 @@
 #include "OGL_Render.h"
 #include "OGL_Setup.h"
 #include "OGL_Faders.h"
+#include "OGL_StreamBuffer.h"
 
 #ifdef HAVE_OPENGL
 
@@ -57,6 +58,9 @@ bool OGL_FaderActive()
 
 static OGL_Fader FaderQueue[NUMBER_OF_FADER_QUEUE_ENTRIES];
 
+// How many of the queue's entries the shader has done this frame
+static int ShaderFaders = 0;
+
 OGL_Fader *GetOGL_FaderQueueEntry(int Index)
 {
 	assert(Index >= 0 && Index < NUMBER_OF_FADER_QUEUE_ENTRIES);
@@ -85,10 +89,147 @@ inline void ComplementColor(GLfloat *InColor, GLfloat *OutColor)
 }
 
 
+// The flat-static color, with the opacity
+static void NextFlatStaticColor(float Alpha)
+{
+	for (int c=0; c<3; c++)
+		FlatStaticColor[c] = FlatStaticRandom.KISS() + FlatStaticRandom.LFIB4();
+	FlatStaticColor[3] = PIN(int(65535*Alpha+0.5),0,65535);
+}
+
+
+// Each step is what one blended quad does to the color already there
+static void SetFaderStep(float Scale[4], float Offset[4], const GLfloat *InScale, const GLfloat *InOffset)
+{
+	for (int c=0; c<3; c++)
+	{
+		Scale[c] = InScale[c];
+		Offset[c] = InOffset[c];
+	}
+	Scale[3] = 1;
+	Offset[3] = 0;
+}
+
+bool OGL_FaderSteps(float Scale[MAXIMUM_FADER_STEPS][4], float Offset[MAXIMUM_FADER_STEPS][4])
+{
+	const GLfloat One[3] = {1, 1, 1};
+	const GLfloat Zero[3] = {0, 0, 0};
+	
+	int Steps = 0;
+	ShaderFaders = 0;
+	
+	if (OGL_FaderActive())
+	{
+		for (int f=0; f<NUMBER_OF_FADER_QUEUE_ENTRIES; f++)
+		{
+			OGL_Fader& Fader = FaderQueue[f];
+			GLfloat *Color = Fader.Color;
+			GLfloat Alpha = Color[3];
+			GLfloat StepScale[3], StepOffset[3];
+			
+			// Each kind needs at most two steps
+			if (Steps + 2 > MAXIMUM_FADER_STEPS) break;
+			
+			bool Done = true;
+			switch(Fader.Type)
+			{
+			case NONE:
+				break;
+			
+			case _tint_fader_type:
+				for (int c=0; c<3; c++)
+				{
+					StepScale[c] = 1 - Alpha;
+					StepOffset[c] = Color[c]*Alpha;
+				}
+				SetFaderStep(Scale[Steps], Offset[Steps], StepScale, StepOffset);
+				Steps++;
+				break;
+			
+			case _randomize_fader_type:
+				// The logic-op effect needs the framebuffer's bits, so it stays a quad
+				UseFlatStatic = TEST_FLAG(Get_OGL_ConfigureData().Flags,OGL_Flag_FlatStatic);
+				if (!UseFlatStatic)
+				{
+					Done = false;
+					break;
+				}
+				NextFlatStaticColor(Alpha);
+				Alpha = FlatStaticColor[3]/65535.0F;
+				for (int c=0; c<3; c++)
+				{
+					StepScale[c] = 1 - Alpha;
+					StepOffset[c] = (FlatStaticColor[c]/65535.0F)*Alpha;
+				}
+				SetFaderStep(Scale[Steps], Offset[Steps], StepScale, StepOffset);
+				Steps++;
+				break;
+			
+			case _negate_fader_type:
+				for (int c=0; c<3; c++)
+				{
+					StepScale[c] = 1 - Alpha - Color[c]*Alpha;
+					StepOffset[c] = Color[c]*Alpha;
+				}
+				SetFaderStep(Scale[Steps], Offset[Steps], StepScale, StepOffset);
+				Steps++;
+				break;
+			
+			case _dodge_fader_type:
+				for (int c=0; c<3; c++)
+				{
+					GLfloat Blend = (1 - Color[c])*Alpha;
+					StepScale[c] = (Blend + 1 - Alpha)*(1 + Blend);
+				}
+				SetFaderStep(Scale[Steps], Offset[Steps], StepScale, Zero);
+				Steps++;
+				break;
+			
+			case _burn_fader_type:
+				for (int c=0; c<3; c++)
+				{
+					StepScale[c] = 1 + Color[c]*Alpha;
+					StepOffset[c] = (1 - Color[c])*Alpha*Alpha;
+				}
+				SetFaderStep(Scale[Steps], Offset[Steps], StepScale, Zero);
+				Steps++;
+				SetFaderStep(Scale[Steps], Offset[Steps], One, StepOffset);
+				Steps++;
+				break;
+			
+			case _soft_tint_fader_type:
+				for (int c=0; c<3; c++)
+					StepScale[c] = Color[c]*Alpha + 1 - Alpha;
+				SetFaderStep(Scale[Steps], Offset[Steps], StepScale, Zero);
+				Steps++;
+				break;
+			}
+			if (!Done) break;
+			ShaderFaders++;
+		}
+	}
+	
+	bool Any = (Steps > 0);
+	for (; Steps<MAXIMUM_FADER_STEPS; Steps++)
+		SetFaderStep(Scale[Steps], Offset[Steps], One, Zero);
+	
+	return Any;
+}
+
+
 bool OGL_DoFades(float Left, float Top, float Right, float Bottom)
 {
+	int First = ShaderFaders;
+	ShaderFaders = 0;
+	
 	if (!OGL_FaderActive()) return false;
 	
+	// Nothing left for the quads to do
+	int Next = First;
+	while (Next < NUMBER_OF_FADER_QUEUE_ENTRIES && FaderQueue[Next].Type == NONE)
+		Next++;
+	if (Next == NUMBER_OF_FADER_QUEUE_ENTRIES) return true;
+	
 	// Set up the vertices
 	GLfloat Vertices[4][2];
 	Vertices[0][0] = Left;
@@ -100,7 +241,7 @@ bool OGL_DoFades(float Left, float Top, float Right, float Bottom)
 	Vertices[3][0] = Left;
 	Vertices[3][1] = Bottom;
 	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-	glVertexPointer(2,GL_FLOAT,0,Vertices[0]);
+	glVertexPointer(2,GL_FLOAT,0,OGL_StreamArray(Vertices[0],sizeof(Vertices)));
 	
 	// Do real blending
 	glDisable(GL_ALPHA_TEST);
@@ -110,7 +251,7 @@ bool OGL_DoFades(float Left, float Top, float Right, float Bottom)
 	// Modified color:
 	GLfloat BlendColor[4];	
 	
-	for (int f=0; f<NUMBER_OF_FADER_QUEUE_ENTRIES; f++)
+	for (int f=First; f<NUMBER_OF_FADER_QUEUE_ENTRIES; f++)
 	{
 		OGL_Fader& Fader = FaderQueue[f];
 		
@@ -129,9 +270,7 @@ bool OGL_DoFades(float Left, float Top, float Right, float Bottom)
 			UseFlatStatic = TEST_FLAG(Get_OGL_ConfigureData().Flags,OGL_Flag_FlatStatic);
 			if (UseFlatStatic)
 			{
-				for (int c=0; c<3; c++)
-					FlatStaticColor[c] = FlatStaticRandom.KISS() + FlatStaticRandom.LFIB4();
-				FlatStaticColor[3] = PIN(int(65535*Fader.Color[3]+0.5),0,65535);
+				NextFlatStaticColor(Fader.Color[3]);
 				glDisable(GL_ALPHA_TEST);
 				glEnable(GL_BLEND);
 				glColor4usv(FlatStaticColor);
@@ -206,6 +345,7 @@ bool OGL_DoFades(float Left, float Top, float Right, float Bottom)
 			break;
 		}		
 	}
+	OGL_StreamDone(4);
 	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
 	
 	return true;
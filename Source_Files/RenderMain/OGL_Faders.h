@@ -54,6 +54,15 @@ struct OGL_Fader
 OGL_Fader *GetOGL_FaderQueueEntry(int Index);
 
 // Fader renderer; returns whether or not OpenGL faders were active.
+// Faders already handed to a shader by OGL_FaderSteps() are skipped.
 bool OGL_DoFades(float Left, float Top, float Right, float Bottom);
 
+// How many steps a post-process shader applies
+const int MAXIMUM_FADER_STEPS = 4;
+
+// Puts as many of the queued faders as it can, from the first, as steps of
+// color = clamp(color * Scale + Offset, 0, 1), for the shader renderer's final pass;
+// the steps not needed change nothing. Returns whether any faders were put.
+bool OGL_FaderSteps(float Scale[MAXIMUM_FADER_STEPS][4], float Offset[MAXIMUM_FADER_STEPS][4]);
+
 #endif
@@ -31,10 +31,16 @@
 #ifdef HAVE_OPENGL
 
 #include <cmath>
+#include <SDL_atomic.h>
+#include <SDL_cpuinfo.h>
+#include <SDL_thread.h>
+
+#include "OGL_Textures.h"
 
 #include "Dim3_Loader.h"
 #include "StudioLoader.h"
 #include "WavefrontLoader.h"
+#include "ModelCache.h"
 #include "InfoTree.h"
 
 
@@ -44,6 +50,10 @@
 static OGL_ModelData DefaultModelData;
 static OGL_SkinData DefaultSkinData;
 
+// The model loaders keep their parse state in file statics, so only one
+// runs at a time while models are loaded in parallel
+static SDL_mutex *LoaderMutex = NULL;
+
 
 // For mapping Marathon-physics sequences onto model sequences
 struct SequenceMapEntry
@@ -219,7 +229,7 @@ void OGL_SkinManager::Reset(bool Clear_OGL_Txtrs)
 			for (int l=0; l<NUMBER_OF_TEXTURES; l++)
 			{
 				if (IDsInUse[k][l])
-					glDeleteTextures(1,&IDs[k][l]);
+					OGL_DeleteTextures(1,&IDs[k][l]);
 			}
 	}
 	
@@ -280,7 +290,7 @@ bool OGL_SkinManager::Use(short CLUT, short Which)
 		InUse = true;
 		LoadSkin = true;
 	}
-	glBindTexture(GL_TEXTURE_2D,TxtrID);
+	OGL_BindTexture(TxtrID);
 	return LoadSkin;
 }
 
@@ -370,60 +380,77 @@ static bool StringsEqual(const char *String1, const char *String2, int MaxStrLen
 }
 
 
-void OGL_ModelData::Load()
+bool OGL_ModelData::LoadMesh(Model3D& Mesh, FileSpecifier& MeshFile,
+	FileSpecifier& MeshFile1, FileSpecifier& MeshFile2, vector<char>& MeshType)
 {
-	// Already loaded?
-	if (ModelPresent()) return;
-	
 	// Load the model
-	Model.Clear();
+	Mesh.Clear();
 
-	if (ModelFile == FileSpecifier()) return;
-	if (!ModelFile.Exists()) return;
+	if (MeshFile == FileSpecifier()) return false;
+	if (!MeshFile.Exists()) return false;
 
 	bool Success = false;
 	
-	char *Type = &ModelType[0];
+	char *Type = &MeshType[0];
+	
+	// The finished mesh is cached, so everything that goes into it is in the key
+	std::string CacheKey = Type;
+	{
+		char Params[192];
+		sprintf(Params, ";%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%d,%.9g;",
+			Scale, XRot, YRot, ZRot, XShift, YShift, ZShift, int(NormalType), NormalSplit);
+		CacheKey += Params;
+	}
+	AddModelCacheSource(CacheKey,MeshFile);
+	if (StringsEqual(Type,"dim3",4))
+	{
+		AddModelCacheSource(CacheKey,MeshFile1);
+		AddModelCacheSource(CacheKey,MeshFile2);
+	}
+	
+	if (ReadModelCache(CacheKey,Mesh)) return true;
+	
+	if (LoaderMutex) SDL_LockMutex(LoaderMutex);
 	if (StringsEqual(Type,"wave",4))
 	{
 		// Alias|Wavefront, backward compatible version
-		Success = LoadModel_Wavefront(ModelFile, Model);
+		Success = LoadModel_Wavefront(MeshFile, Mesh);
 	}
 	else if (StringsEqual(Type,"obj",3))
 	{
 		// Alias|Wavefront, but with coordinate system conversion.
-		Success = LoadModel_Wavefront_RightHand(ModelFile, Model);
+		Success = LoadModel_Wavefront_RightHand(MeshFile, Mesh);
 	}
 	else if (StringsEqual(Type,"3ds",3))
 	{
 		// 3D Studio Max, backward compatible version
-		Success = LoadModel_Studio(ModelFile, Model);
+		Success = LoadModel_Studio(MeshFile, Mesh);
 	}
 	else if (StringsEqual(Type,"max",3))
 	{
 		// 3D Studio Max, but with coordinate system conversion.
-		Success = LoadModel_Studio_RightHand(ModelFile, Model);
+		Success = LoadModel_Studio_RightHand(MeshFile, Mesh);
 	}
 	else if (StringsEqual(Type,"dim3",4))
 	{
 		// Brian Barnes's "Dim3" model format (first pass: model geometry)
-		Success = LoadModel_Dim3(ModelFile, Model, LoadModelDim3_First);
+		Success = LoadModel_Dim3(MeshFile, Mesh, LoadModelDim3_First);
 		
 		// Second and third passes: frames and sequences
 		try
 		{
-			if (ModelFile1 == FileSpecifier()) throw 0;
-			if (!ModelFile1.Exists()) throw 0;
-			if (!LoadModel_Dim3(ModelFile1, Model, LoadModelDim3_Rest)) throw 0;
+			if (MeshFile1 == FileSpecifier()) throw 0;
+			if (!MeshFile1.Exists()) throw 0;
+			if (!LoadModel_Dim3(MeshFile1, Mesh, LoadModelDim3_Rest)) throw 0;
 		}
 		catch(...)
 		{}
 		//
 		try
 		{
-			if (ModelFile2 == FileSpecifier()) throw 0;
-			if (!ModelFile2.Exists()) throw 0;
-			if (!LoadModel_Dim3(ModelFile2, Model, LoadModelDim3_Rest)) throw 0;
+			if (MeshFile2 == FileSpecifier()) throw 0;
+			if (!MeshFile2.Exists()) throw 0;
+			if (!LoadModel_Dim3(MeshFile2, Mesh, LoadModelDim3_Rest)) throw 0;
 		}
 		catch(...)
 		{}
@@ -432,14 +459,15 @@ void OGL_ModelData::Load()
 	else if (StringsEqual(Type,"qd3d") || StringsEqual(Type,"3dmf") || StringsEqual(Type,"quesa"))
 	{
 		// QuickDraw 3D / Quesa
-		Success = LoadModel_QD3D(ModelFile, Model);
+		Success = LoadModel_QD3D(MeshFile, Mesh);
 	}
 #endif
+	if (LoaderMutex) SDL_UnlockMutex(LoaderMutex);
 	
 	if (!Success)
 	{
-		Model.Clear();
-		return;
+		Mesh.Clear();
+		return false;
 	}
 	
 	// Calculate transformation matrix
@@ -485,19 +513,19 @@ void OGL_ModelData::Load()
 	
 	// Is model animated or static?
 	// Test by trying to find neutral positions (useful for working with the normals later on)
-	if (Model.FindPositions_Neutral(false))
+	if (Mesh.FindPositions_Neutral(false))
 	{
 		// Copy over the vector and normal transformation matrices:
 		for (int k=0; k<3; k++)
 			for (int l=0; l<3; l++)
 			{
-				Model.TransformPos.M[k][l] = NewRotMatrix[k][l];
-				Model.TransformNorm.M[k][l] = RotMatrix[k][l];
+				Mesh.TransformPos.M[k][l] = NewRotMatrix[k][l];
+				Mesh.TransformNorm.M[k][l] = RotMatrix[k][l];
 			}
 		
-		Model.TransformPos.M[0][3] = XShift;
-		Model.TransformPos.M[1][3] = YShift;
-		Model.TransformPos.M[2][3] = ZShift;
+		Mesh.TransformPos.M[0][3] = XShift;
+		Mesh.TransformPos.M[1][3] = YShift;
+		Mesh.TransformPos.M[2][3] = ZShift;
 		
 		// Find the transformed bounding box:
 		bool RestOfCorners = false;
@@ -506,18 +534,18 @@ void OGL_ModelData::Load()
 		// to get coordinates from
 		for (int i1=0; i1<2; i1++)
 		{
-			GLfloat X = Model.BoundingBox[i1][0];
+			GLfloat X = Mesh.BoundingBox[i1][0];
 			for (int i2=0; i2<2; i2++)
 			{
-				GLfloat Y = Model.BoundingBox[i2][0];
+				GLfloat Y = Mesh.BoundingBox[i2][0];
 				for (int i3=0; i3<2; i3++)
 				{
-					GLfloat Z = Model.BoundingBox[i3][0];
+					GLfloat Z = Mesh.BoundingBox[i3][0];
 					
 					GLfloat Corner[3];
 					for (int ic=0; ic<3; ic++)
 					{
-						GLfloat *Row = Model.TransformPos.M[ic];
+						GLfloat *Row = Mesh.TransformPos.M[ic];
 						Corner[ic] = Row[0]*X + Row[1]*Y + Row[2]*Z + Row[3];
 					}
 					
@@ -542,16 +570,16 @@ void OGL_ModelData::Load()
 		}
 		
 		for (int ic=0; ic<2; ic++)
-			objlist_copy(Model.BoundingBox[ic],NewBoundingBox[ic],3);
+			objlist_copy(Mesh.BoundingBox[ic],NewBoundingBox[ic],3);
 	}
 	else
 	{
 		// Static model
-		size_t NumVerts = Model.Positions.size()/3;
+		size_t NumVerts = Mesh.Positions.size()/3;
 		
 		for (size_t k=0; k<NumVerts; k++)
 		{
-			GLfloat *Pos = Model.PosBase() + 3*k;
+			GLfloat *Pos = Mesh.PosBase() + 3*k;
 			GLfloat NewPos[3];
 			MatVecMult(NewRotMatrix,Pos,NewPos);	// Has the scaling
 			Pos[0] = NewPos[0] + XShift;
@@ -559,21 +587,41 @@ void OGL_ModelData::Load()
 			Pos[2] = NewPos[2] + ZShift;
 		}
 		
-		size_t NumNorms = Model.Normals.size()/3;
+		size_t NumNorms = Mesh.Normals.size()/3;
 		for (size_t k=0; k<NumNorms; k++)
 		{
-			GLfloat *Norms = Model.NormBase() + 3*k;
+			GLfloat *Norms = Mesh.NormBase() + 3*k;
 			GLfloat NewNorms[3];
 			MatVecMult(RotMatrix,Norms,NewNorms);	// Not scaled
 			objlist_copy(Norms,NewNorms,3);
 		}	
 	
 		// So as to be consistent with the new points
-		Model.FindBoundingBox();
+		Mesh.FindBoundingBox();
 	}	
 	
-	Model.AdjustNormals(NormalType,NormalSplit);
-	Model.CalculateTangents();
+	Mesh.AdjustNormals(NormalType,NormalSplit);
+	Mesh.CalculateTangents();
+	Mesh.OptimizeForVertexCache();
+	
+	WriteModelCache(CacheKey,Mesh);
+	return true;
+}
+
+
+void OGL_ModelData::Load()
+{
+	// Already loaded?
+	if (ModelPresent()) return;
+	
+	if (!LoadMesh(Model,ModelFile,ModelFile1,ModelFile2,ModelType)) return;
+	
+	// The lower levels of detail; any that fail to load are skipped when rendering
+	for (vector<OGL_ModelLOD>::iterator LODIter = LODs.begin(); LODIter < LODs.end(); LODIter++)
+	{
+		vector<char>& LODType = LODIter->ModelType.empty() ? ModelType : LODIter->ModelType;
+		LoadMesh(LODIter->Model,LODIter->ModelFile,LODIter->ModelFile1,LODIter->ModelFile2,LODType);
+	}
 	
 	// Don't forget the skins
 	OGL_SkinManager::Load();
@@ -583,12 +631,122 @@ void OGL_ModelData::Load()
 void OGL_ModelData::Unload()
 {
 	Model.Clear();
+	for (vector<OGL_ModelLOD>::iterator LODIter = LODs.begin(); LODIter < LODs.end(); LODIter++)
+		LODIter->Model.Clear();
 	OGL_ResetForceSpriteDepth();
 	
+	// The buffers' contents are gone
+	ResetBuffers(OGL_IsActive());
+	
 	// Don't forget the skins
 	OGL_SkinManager::Unload();
 }
 
+
+// Creates and binds a model's buffers
+static bool BindModelBuffers(Model3D& Model, GLuint& VertexBuffer, GLuint& IndexBuffer)
+{
+	if (VertexBuffer)
+	{
+		glBindBufferARB(GL_ARRAY_BUFFER_ARB,VertexBuffer);
+		glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB,IndexBuffer);
+		return true;
+	}
+	
+	if (Model.VertIndices.empty()) return false;
+	if (!OGL_CheckExtension("GL_ARB_vertex_buffer_object")) return false;
+	
+	// Boned models are taken from their vertex and normal sources,
+	// since the fixed-function renderer overwrites the positions and normals
+	bool Boned = !Model.VtxSrcIndices.empty();
+	size_t NumVerts = Boned ? Model.VtxSrcIndices.size() : Model.Positions.size()/3;
+	if (NumVerts == 0) return false;
+	
+	vector<GLfloat>& Norms = Model.NormSources.empty() ? Model.Normals : Model.NormSources;
+	
+	vector<OGL_ModelVertex> Verts(NumVerts);
+	for (size_t k=0; k<NumVerts; k++)
+	{
+		OGL_ModelVertex& Vert = Verts[k];
+		obj_clear(Vert);
+		
+		if (!Boned)
+			objlist_copy(Vert.Position,&Model.Positions[3*k],3);
+		else if (Model.VtxSrcIndices[k] < Model.VtxSources.size())
+			objlist_copy(Vert.Position,Model.VtxSources[Model.VtxSrcIndices[k]].Position,3);
+		
+		if (3*k < Norms.size())
+			objlist_copy(Vert.Normal,&Norms[3*k],3);
+		if (k < Model.Tangents.size())
+			objlist_copy(Vert.Tangent,&Model.Tangents[k][0],4);
+		if (2*k < Model.TxtrCoords.size())
+			objlist_copy(Vert.TxtrCoord,&Model.TxtrCoords[2*k],2);
+		
+		Model.FindSkinWeights(k,Vert.SkinWeights);
+	}
+	
+	glGenBuffersARB(1,&VertexBuffer);
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB,VertexBuffer);
+	glBufferDataARB(GL_ARRAY_BUFFER_ARB,NumVerts*sizeof(OGL_ModelVertex),&Verts[0],GL_STATIC_DRAW_ARB);
+	
+	glGenBuffersARB(1,&IndexBuffer);
+	glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB,IndexBuffer);
+	glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB,Model.NumVI()*sizeof(GLushort),Model.VIBase(),GL_STATIC_DRAW_ARB);
+	
+	return true;
+}
+
+
+static void DeleteModelBuffers(GLuint& VertexBuffer, GLuint& IndexBuffer, bool Clear_OGL_Buffers)
+{
+	if (VertexBuffer)
+	{
+		if (Clear_OGL_Buffers)
+		{
+			glDeleteBuffersARB(1,&VertexBuffer);
+			glDeleteBuffersARB(1,&IndexBuffer);
+		}
+		VertexBuffer = IndexBuffer = 0;
+	}
+}
+
+
+bool OGL_ModelData::BindBuffers(short LOD)
+{
+	if (LOD >= 0 && LOD < short(LODs.size()))
+		return BindModelBuffers(LODs[LOD].Model,LODs[LOD].VertexBuffer,LODs[LOD].IndexBuffer);
+	
+	return BindModelBuffers(Model,VertexBuffer,IndexBuffer);
+}
+
+
+short OGL_ModelData::FindLOD(int ProjHeight)
+{
+	// The coarsest that is allowed at this height and was loaded
+	short Choice = NONE;
+	for (size_t k=0; k<LODs.size(); k++)
+	{
+		if (ProjHeight > LODs[k].MaxHeight) break;
+		if (!LODs[k].Model.VertIndices.empty()) Choice = k;
+	}
+	return Choice;
+}
+
+
+void OGL_ModelData::Reset(bool Clear_OGL_Txtrs)
+{
+	ResetBuffers(Clear_OGL_Txtrs);
+	OGL_SkinManager::Reset(Clear_OGL_Txtrs);
+}
+
+
+void OGL_ModelData::ResetBuffers(bool Clear_OGL_Buffers)
+{
+	DeleteModelBuffers(VertexBuffer,IndexBuffer,Clear_OGL_Buffers);
+	for (vector<OGL_ModelLOD>::iterator LODIter = LODs.begin(); LODIter < LODs.end(); LODIter++)
+		DeleteModelBuffers(LODIter->VertexBuffer,LODIter->IndexBuffer,Clear_OGL_Buffers);
+}
+
 int OGL_CountModels(short Collection)
 {
 	return MdlList[Collection].size();
@@ -601,17 +759,73 @@ void OGL_ResetForceSpriteDepth() { ForcingSpriteDepth = false; }
 bool OGL_ForceSpriteDepth() { return ForcingSpriteDepth; }
 
 // for managing the model and image loading and unloading
+enum {
+	MAXIMUM_MODEL_LOADERS = 8
+};
+
+struct ModelLoadJobs
+{
+	vector<ModelDataEntry> *Models;
+	SDL_atomic_t Next;
+	SDL_atomic_t Done;
+};
+
+static int ModelLoadWorker(void *Data)
+{
+	ModelLoadJobs *Jobs = (ModelLoadJobs *) Data;
+	int Job;
+	while ((Job = SDL_AtomicAdd(&Jobs->Next,1)) < int(Jobs->Models->size()))
+	{
+		// Parsing, normals, tangents and skin decoding; nothing here touches OpenGL,
+		// since the buffers and textures are made when first rendered
+		(*Jobs->Models)[Job].ModelData.Load();
+		SDL_AtomicAdd(&Jobs->Done,1);
+	}
+	return 0;
+}
+
 void OGL_LoadModels(short Collection)
 {
 	vector<ModelDataEntry>& ML = MdlList[Collection];
+	
+	ModelLoadJobs Jobs;
+	Jobs.Models = &ML;
+	SDL_AtomicSet(&Jobs.Next,0);
+	SDL_AtomicSet(&Jobs.Done,0);
+	
+	SDL_Thread *Workers[MAXIMUM_MODEL_LOADERS];
+	int Started = 0;
+	if (ML.size() > 1)
+	{
+		if (!LoaderMutex) LoaderMutex = SDL_CreateMutex();
+		int WorkerCount = MIN(MIN(SDL_GetCPUCount() - 1, int(ML.size()) - 1), int(MAXIMUM_MODEL_LOADERS));
+		for (int k=0; LoaderMutex && k<WorkerCount; k++)
+		{
+			Workers[Started] = SDL_CreateThread(ModelLoadWorker,"model_loader",&Jobs);
+			if (Workers[Started]) Started++;
+		}
+	}
+	
+	// This thread takes jobs too, and keeps the progress bar going
+	int Reported = 0;
+	int Job;
+	while ((Job = SDL_AtomicAdd(&Jobs.Next,1)) < int(ML.size()))
+	{
+		ML[Job].ModelData.Load();
+		int Done = SDL_AtomicAdd(&Jobs.Done,1) + 1;
+		OGL_ProgressCallback(Done - Reported);
+		Reported = Done;
+	}
+	for (int k=0; k<Started; k++)
+		SDL_WaitThread(Workers[k],NULL);
+	OGL_ProgressCallback(int(ML.size()) - Reported);
+	
 	for (vector<ModelDataEntry>::iterator MdlIter = ML.begin(); MdlIter < ML.end(); MdlIter++)
 	{
-		MdlIter->ModelData.Load();
 		if (MdlIter->ModelData.ForceSpriteDepth)
 		{
 			ForcingSpriteDepth = true;
 		}
-		OGL_ProgressCallback(1);
 	}
 }
 
@@ -624,6 +838,22 @@ void OGL_UnloadModels(short Collection)
 	}
 }
 
+size_t OGL_ModelMemoryUsage()
+{
+	size_t Bytes = 0;
+	for (int ic=0; ic<NUMBER_OF_COLLECTIONS; ic++)
+	{
+		vector<ModelDataEntry>& ML = MdlList[ic];
+		for (vector<ModelDataEntry>::iterator MdlIter = ML.begin(); MdlIter < ML.end(); MdlIter++)
+		{
+			Bytes += MdlIter->ModelData.Model.MemoryUsage();
+			for (size_t k=0; k<MdlIter->ModelData.LODs.size(); k++)
+				Bytes += MdlIter->ModelData.LODs[k].Model.MemoryUsage();
+		}
+	}
+	return Bytes;
+}
+
 
 // Reset model skins; used in OGL_ResetTextures() in OGL_Textures.cpp
 void OGL_ResetModelSkins(bool Clear_OGL_Txtrs)
@@ -653,6 +883,12 @@ void parse_mml_opengl_model_clear(const InfoTree& root)
 		MdlDeleteAll();
 }
 
+// For keeping the levels of detail with the more detailed ones first
+static bool LODMoreDetailed(const OGL_ModelLOD& a, const OGL_ModelLOD& b)
+{
+	return a.MaxHeight > b.MaxHeight;
+}
+
 static bool read_sign_val(const InfoTree& root, std::string key, int16& val)
 {
 	std::string sign;
@@ -709,7 +945,7 @@ void parse_mml_opengl_model(const InfoTree& root)
 		def.ModelType.push_back('\0');
 	}
 	
-	BOOST_FOREACH(InfoTree seqmap, root.children_named("seq_map"))
+	BOOST_FOREACH(const InfoTree &seqmap, root.children_named("seq_map"))
 	{
 		SequenceMapEntry e;
 		if (!seqmap.read_indexed("seq", e.Sequence, MAXIMUM_SHAPES_PER_COLLECTION))
@@ -719,7 +955,27 @@ void parse_mml_opengl_model(const InfoTree& root)
 		entry.SequenceMap.push_back(e);
 	}
 	
-	BOOST_FOREACH(InfoTree skin, root.children_named("skin"))
+	BOOST_FOREACH(const InfoTree &lod, root.children_named("lod"))
+	{
+		OGL_ModelLOD ldef;
+		if (!lod.read_attr_bounded<int16>("max_height", ldef.MaxHeight, 0, INT16_MAX))
+			continue;
+		if (!lod.read_path("file", ldef.ModelFile))
+			continue;
+		lod.read_path("file1", ldef.ModelFile1);
+		lod.read_path("file2", ldef.ModelFile2);
+		
+		std::string ltype;
+		if (lod.read_attr("type", ltype))
+		{
+			ldef.ModelType.assign(ltype.begin(), ltype.end());
+			ldef.ModelType.push_back('\0');
+		}
+		def.LODs.push_back(ldef);
+	}
+	std::stable_sort(def.LODs.begin(), def.LODs.end(), LODMoreDetailed);
+	
+	BOOST_FOREACH(const InfoTree &skin, root.children_named("skin"))
 	{
 		int16 clut = ALL_CLUTS;
 		skin.read_attr_bounded<int16>("clut", clut, ALL_CLUTS, SILHOUETTE_BITMAP_SET);
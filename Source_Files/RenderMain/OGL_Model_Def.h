@@ -87,6 +87,36 @@ enum
 };
 
 
+// One vertex of a model's static vertex buffer;
+// the skin weights are those of Model3D::FindSkinWeights()
+struct OGL_ModelVertex
+{
+	GLfloat Position[3];
+	GLfloat Normal[3];
+	GLfloat Tangent[4];
+	GLfloat TxtrCoord[2];
+	GLfloat SkinWeights[3];
+};
+
+
+// A lower-detail version of a model, for when it appears small on the screen;
+// it gets the same transforms and skins as the full model
+struct OGL_ModelLOD
+{
+	// Like the full model's
+	FileSpecifier ModelFile, ModelFile1, ModelFile2;
+	vector<char> ModelType;		// the full model's type if empty
+	
+	// Used when the model's projected height is at most this many pixels
+	int16 MaxHeight;
+	
+	Model3D Model;
+	GLuint VertexBuffer, IndexBuffer;
+	
+	OGL_ModelLOD(): MaxHeight(0), VertexBuffer(0), IndexBuffer(0) {}
+};
+
+
 // Static 3D-Model Data and Options
 class OGL_ModelData: public OGL_SkinManager
 {
@@ -119,13 +149,37 @@ public:
 	Model3D Model;
 	bool ModelPresent() {return !Model.VertIndices.empty();}
 	
+	// Levels of detail, in order of decreasing maximum height
+	vector<OGL_ModelLOD> LODs;
+	
+	// Which to use for a projected height in pixels; NONE is the full model
+	short FindLOD(int ProjHeight);
+	Model3D& GetModel(short LOD) {return (LOD >= 0 && LOD < short(LODs.size())) ? LODs[LOD].Model : Model;}
+	
 	// For convenience
 	void Load();
 	void Unload();
 	
+	// The model's vertices in their neutral pose and its vertex indices,
+	// kept in buffer objects for the shader renderer, which does any animating.
+	// Binds them, creating them if needed; returns whether they are available.
+	bool BindBuffers(short LOD = NONE);
+	
+	// Also takes care of the buffers
+	void Reset(bool Clear_OGL_Txtrs);
+	
 	OGL_ModelData():
 		Scale(1), XRot(0), YRot(0), ZRot(0), XShift(0), YShift(0), ZShift(0), Sidedness(1),
-			NormalType(1), NormalSplit(0.5), LightType(0), DepthType(0), ForceSpriteDepth(false) {}
+			NormalType(1), NormalSplit(0.5), LightType(0), DepthType(0), ForceSpriteDepth(false),
+			VertexBuffer(0), IndexBuffer(0) {}
+
+private:
+	GLuint VertexBuffer, IndexBuffer;
+	void ResetBuffers(bool Clear_OGL_Buffers);
+	
+	// Loads one model or level of detail and applies the transforms
+	bool LoadMesh(Model3D& Mesh, FileSpecifier& MeshFile,
+		FileSpecifier& MeshFile1, FileSpecifier& MeshFile2, vector<char>& MeshType);
 };
 
 
@@ -141,6 +195,9 @@ int OGL_CountModels(short Collection);
 void OGL_LoadModels(short Collection);
 void OGL_UnloadModels(short Collection);
 
+// Bytes the loaded models and their levels of detail hold
+size_t OGL_ModelMemoryUsage();
+
 // for managing the sprite depth-buffer override (see ForceSpriteDepth above)
 void OGL_ResetForceSpriteDepth();  // to clear before calling OGL_LoadModels
 bool OGL_ForceSpriteDepth();
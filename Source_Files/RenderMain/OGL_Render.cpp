@@ -161,6 +161,10 @@ May 3, 2003 (Br'fin (Jeremy Parsons))
 #include "Logging.h"
 #include "screen.h"
 #include "OGL_Shader.h"
+#include "OGL_StreamBuffer.h"
+#include "FrameProfiler.h"
+#include "overhead_map.h"
+#include "game_window.h"
 
 #include <cmath>
 
@@ -657,7 +661,10 @@ bool OGL_StopRun()
 {
 	if (!OGL_IsActive() || !_OGL_IsActive) return false;
 	
+	FrameProfiler::instance()->ResetGPU();
 	OGL_StopTextures();
+	OGL_ResetMapBuffers();
+	OGL_ResetHUDBuffer();
 	Shader::unloadAll();
 	
 	Wanting_sRGB = false;
@@ -837,6 +844,8 @@ bool OGL_StartMain()
 {
 	if (!OGL_IsActive()) return false;
 	
+	OGL_TrackTextureBindings(true);
+	
 	// One-sidedness necessary for correct rendering
 	glEnable(GL_CULL_FACE);
 	glCullFace(GL_BACK);
@@ -923,6 +932,8 @@ bool OGL_EndMain()
 {
 	if (!OGL_IsActive()) return false;
 
+	OGL_TrackTextureBindings(false);
+
 	if (Wanting_sRGB)
 	{
 		glDisable(GL_FRAMEBUFFER_SRGB_EXT);
@@ -1630,12 +1641,14 @@ static bool RenderAsRealWall(polygon_definition& RenderPolygon, bool IsVertical)
 
 		if (UseFlatStatic)
 		{
+			FrameProfiler::CountDrawCall();
 			glDrawArrays(GL_POLYGON,0,NumVertices);
 		} else {
 			// Do multitextured stippling to create the static effect
 			for (int k=0; k<StaticEffectPasses; k++)
 			{
 				StaticModeIndivSetup(k);
+				FrameProfiler::CountDrawCall();
 				glDrawArrays(GL_POLYGON,0,NumVertices);
 			}
 		}
@@ -1764,15 +1777,19 @@ static bool RenderAsRealWall(polygon_definition& RenderPolygon, bool IsVertical)
 		}
 		
 		// Now, go!
+		FrameProfiler::CountDrawCall();
 		glDrawElements(GL_TRIANGLES,3*(NumVertices-2),GL_UNSIGNED_INT,VertIndices);
 		
 		// Switch off
 		glDisableClientState(GL_COLOR_ARRAY);
 	}
 	else
+	{
 		// Go!
 		// Don't care about triangulation here, because the polygon never got split
+		FrameProfiler::CountDrawCall();
 		glDrawArrays(GL_POLYGON,0,NumVertices);
+	}
 	
 	// Do textured rendering
 	if (TMgr.IsGlowMapped())
@@ -1794,12 +1811,14 @@ static bool RenderAsRealWall(polygon_definition& RenderPolygon, bool IsVertical)
 		{
 			glEnableClientState(GL_COLOR_ARRAY);
 			glColorPointer(3,GL_FLOAT,sizeof(ExtendedVertexData),ExtendedVertexList[0].GlowColor);
+			FrameProfiler::CountDrawCall();
 			glDrawElements(GL_TRIANGLES,3*(NumVertices-2),GL_UNSIGNED_INT,VertIndices);
 			glDisableClientState(GL_COLOR_ARRAY);
 		}
 		else
 		{
 			SglColor3f(GlowColor,GlowColor,GlowColor);
+			FrameProfiler::CountDrawCall();
 			glDrawArrays(GL_POLYGON,0,NumVertices);
 		}
 	}
@@ -1860,6 +1879,7 @@ static bool RenderAsLandscape(polygon_definition& RenderPolygon)
 		glVertexPointer(3,GL_SHORT,sizeof(AltExtendedVertexData),AltEVList[0].Vertex);
 		
 		// Go!
+		FrameProfiler::CountDrawCall();
 		glDrawArrays(GL_POLYGON,0,NumVertices);
 		
 		// Restore
@@ -1981,6 +2001,7 @@ static bool RenderAsLandscape(polygon_definition& RenderPolygon)
 	TMgr.RenderNormal();
 	
 	// Go!
+	FrameProfiler::CountDrawCall();
 	glDrawArrays(GL_POLYGON,0,NumVertices);
 	
 	// Cribbed from RenderAsRealWall()
@@ -1999,6 +2020,7 @@ static bool RenderAsLandscape(polygon_definition& RenderPolygon)
 		
 		TMgr.RenderGlowing();
 		SetBlend(TMgr.GlowBlend());
+		FrameProfiler::CountDrawCall();
 		glDrawArrays(GL_POLYGON,0,NumVertices);
 	}
 	
@@ -2193,12 +2215,14 @@ bool OGL_RenderSprite(rectangle_definition& RenderRectangle)
 		if (UseFlatStatic)
 		{
 			if (Z_Buffering) glDisable(GL_DEPTH_TEST);
+			FrameProfiler::CountDrawCall();
 			glDrawArrays(GL_POLYGON,0,4);
 		} else {
 			// Do multitextured stippling to create the static effect
 			for (int k=0; k<StaticEffectPasses; k++)
 			{
 				StaticModeIndivSetup(k);
+				FrameProfiler::CountDrawCall();
 				glDrawArrays(GL_POLYGON,0,4);
 			}
 		}
@@ -2210,6 +2234,7 @@ bool OGL_RenderSprite(rectangle_definition& RenderRectangle)
 		SetBlend(TMgr.NormalBlend());
 
 		// Do textured rendering
+		FrameProfiler::CountDrawCall();
 		glDrawArrays(GL_POLYGON,0,4);
 		
 		if (TMgr.IsGlowMapped())
@@ -2225,6 +2250,7 @@ bool OGL_RenderSprite(rectangle_definition& RenderRectangle)
 			
 			TMgr.RenderGlowing();
 			SetBlend(TMgr.GlowBlend());
+			FrameProfiler::CountDrawCall();
 			glDrawArrays(GL_POLYGON,0,4);
 		}
 	}
@@ -2243,11 +2269,12 @@ bool RenderModelSetup(rectangle_definition& RenderRectangle)
 {
 	OGL_ModelData *ModelPtr = RenderRectangle.ModelPtr;
 	assert(ModelPtr);
+	Model3D& Model = ModelPtr->GetModel(RenderRectangle.ModelLOD);
 	
 	// Initial clip check: where relative to the liquid?
 	float Scale = RenderRectangle.Scale;
-	GLfloat ModelFloor = Scale*ModelPtr->Model.BoundingBox[0][2];
-	GLfloat ModelCeiling = Scale*ModelPtr->Model.BoundingBox[1][2];
+	GLfloat ModelFloor = Scale*Model.BoundingBox[0][2];
+	GLfloat ModelCeiling = Scale*Model.BoundingBox[1][2];
 	short LiquidRelHeight = RenderRectangle.LiquidRelHeight;
 	
 	if (RenderRectangle.BelowLiquid)
@@ -2271,20 +2298,20 @@ bool RenderModelSetup(rectangle_definition& RenderRectangle)
 	short ModelSequence = RenderRectangle.ModelSequence;
 	if (ModelSequence >= 0)
 	{
-		int NumFrames = ModelPtr->Model.NumSeqFrames(ModelSequence);
+		int NumFrames = Model.NumSeqFrames(ModelSequence);
 		if (NumFrames > 0)
 		{
 			short ModelFrame = PIN(RenderRectangle.ModelFrame,0,NumFrames-1);
 			short NextModelFrame = PIN(RenderRectangle.NextModelFrame,0,NumFrames-1);
 			float MixFrac = RenderRectangle.MixFrac;
-			ModelPtr->Model.FindPositions_Sequence(true,
+			Model.FindPositions_Sequence(true,
 				ModelSequence,ModelFrame,MixFrac,NextModelFrame);
 		}
 		else
-			ModelPtr->Model.FindPositions_Neutral(true);	// Fallback: neutral
+			Model.FindPositions_Neutral(true);	// Fallback: neutral
 	}
 	else
-		ModelPtr->Model.FindPositions_Neutral(true);	// Fallback: neutral (will do nothing for static models)
+		Model.FindPositions_Neutral(true);	// Fallback: neutral (will do nothing for static models)
 	
 	// For finding the clip planes: 0, 1, 2, 3, and 4
 	bool ClipLeft = false, ClipRight = false, ClipTop = false, ClipBottom = false, ClipLiquid = false;
@@ -2394,6 +2421,7 @@ bool RenderModel(rectangle_definition& RenderRectangle, short Collection, short
 {
 	OGL_ModelData *ModelPtr = RenderRectangle.ModelPtr;
 	assert(ModelPtr);
+	Model3D& Model = ModelPtr->GetModel(RenderRectangle.ModelLOD);
 	
 	// Get the skin; test for whether one was actually found
 	OGL_SkinData *SkinPtr = ModelPtr->GetSkin(CLUT);
@@ -2439,11 +2467,11 @@ bool RenderModel(rectangle_definition& RenderRectangle, short Collection, short
 		{
 			// Do explicit depth sort because these textures are semitransparent
 			StandardShaders[0].Flags = ModelRenderer::Textured;
-			ModelRenderObject.Render(ModelPtr->Model, StandardShaders,
+			ModelRenderObject.Render(Model, StandardShaders,
 				1, 0, Z_Buffering);
 		} else {
 			// Do multitextured stippling to create the static effect
-			ModelRenderObject.Render(ModelPtr->Model, StaticModeShaders,
+			ModelRenderObject.Render(Model, StaticModeShaders,
 				StaticEffectPasses, SeparableStaticEffectPasses, Z_Buffering);
 		}
 		TeardownStaticMode();
@@ -2510,7 +2538,7 @@ bool RenderModel(rectangle_definition& RenderRectangle, short Collection, short
 			}
 		}
 		
-		ModelRenderObject.Render(ModelPtr->Model, StandardShaders, NumShaders,
+		ModelRenderObject.Render(Model, StandardShaders, NumShaders,
 			NumSeparableShaders, Z_Buffering);
 		
 		// Revert to default blend
@@ -2780,7 +2808,7 @@ void StaticModeShader(void *Data)
 	else
 	{
 		// For the static effect
-		glBindTexture(GL_TEXTURE_2D,0);
+		OGL_BindTexture(0);
 		
 		const int TxSize = 64;
 		const int TxPxls = TxSize*TxSize;
@@ -2998,8 +3026,9 @@ bool OGL_RenderCrosshairs()
 					LenMin + WidthMin, LenMax + HeightMin,
 					LenMin + WidthMin, LenMax + HeightMax
 				};
-				glVertexPointer(2, GL_INT, 0, vertices);
+				glVertexPointer(2, GL_INT, 0, OGL_StreamArray(vertices, sizeof(vertices)));
 				glDrawArrays(GL_TRIANGLE_STRIP, 0, 8);
+				OGL_StreamDone(8);
 			}
 			break;
 		}
@@ -3091,8 +3120,9 @@ void OGL_RenderRect(float x, float y, float w, float h)
 	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 	
 	GLfloat vertices[8] = { x, y, x + w, y, x + w, y + h, x, y + h };
-	glVertexPointer(2, GL_FLOAT, 0, vertices);
+	glVertexPointer(2, GL_FLOAT, 0, OGL_StreamArray(vertices, sizeof(vertices)));
 	glDrawArrays(GL_POLYGON, 0, 4);
+	OGL_StreamDone(4);
 
 	glEnable(GL_TEXTURE_2D);
 	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
@@ -3107,9 +3137,11 @@ void OGL_RenderTexturedRect(float x, float y, float w, float h, float tleft, flo
 {	
 	GLfloat vertices[8] = { x, y, x + w, y, x + w, y + h, x, y + h };
 	GLfloat texcoords[8] = { tleft, ttop, tright, ttop, tright, tbottom, tleft, tbottom };
-    glVertexPointer(2, GL_FLOAT, 0, vertices);
-	glTexCoordPointer(2, GL_FLOAT, 0, texcoords);
+	OGL_StreamReserve(sizeof(vertices) + sizeof(texcoords), 2);
+	glVertexPointer(2, GL_FLOAT, 0, OGL_StreamArray(vertices, sizeof(vertices)));
+	glTexCoordPointer(2, GL_FLOAT, 0, OGL_StreamArray(texcoords, sizeof(texcoords)));
 	glDrawArrays(GL_POLYGON, 0, 4);
+	OGL_StreamDone(4);
 }
 
 void OGL_RenderTexturedRect(const SDL_Rect& rect, float tleft, float ttop, float tright, float tbottom)
@@ -3134,8 +3166,9 @@ void OGL_RenderFrame(float x, float y, float w, float h, float t)
 		x,		   y,
 		x + t,	   y + t
 	};
-	glVertexPointer(2, GL_FLOAT, 0, vertices);
+	glVertexPointer(2, GL_FLOAT, 0, OGL_StreamArray(vertices, sizeof(vertices)));
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 10);
+	OGL_StreamDone(10);
 	
 	glEnable(GL_TEXTURE_2D);
 	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
@@ -3175,8 +3208,9 @@ void OGL_RenderLines(const std::vector<world_point2d>& points, float thickness)
 		coords.push_back(cur.x - yd);
 		coords.push_back(cur.y + xd);
 	}
-	glVertexPointer(2, GL_FLOAT, 0, &coords.front());
+	glVertexPointer(2, GL_FLOAT, 0, OGL_StreamArray(&coords.front(), coords.size() * sizeof(GLfloat)));
 	glDrawArrays(GL_TRIANGLES, 0, coords.size() / 2);
+	OGL_StreamDone(coords.size() / 2);
 	
 	glEnable(GL_TEXTURE_2D);
 	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
@@ -67,6 +67,10 @@ Jan 25, 2002 (Br'fin (Jeremy Parsons)):
 
 Feb 5, 2002 (Br'fin (Jeremy Parsons)):
 	Refined OGL default preferences for Carbon
+
+Oct 14, 2026:
+	Processed substitute textures are kept in an on-disk cache,
+	so later launches skip decoding, masking and minifying them
 */
 
 #include <vector>
@@ -86,6 +90,10 @@ Feb 5, 2002 (Br'fin (Jeremy Parsons)):
 #include "OGL_LoadScreen.h"
 #include "progress.h"
 #include "InfoTree.h"
+#include "crc.h"
+#include "Logging.h"
+
+#include <SDL_atomic.h>
 
 // Whether or not OpenGL is present and usable
 static bool _OGL_IsPresent = false;
@@ -244,6 +252,12 @@ void OGL_SetDefaults(OGL_ConfigureData& Data)
 
         Data.AnisotropyLevel = 0.0; // off
 	Data.Multisamples = 0; // off
+	Data.TextureMemoryBudget = 0; // no limit
+	Data.SortSurfaces = true;
+	Data.BloomQuality = OGL_Bloom_Medium;
+	Data.OcclusionCulling = false;
+	Data.DynamicResolution = OGL_DynamicResolution_Off;
+	Data.PostAntialiasing = false;
 	
 	Data.VoidColor = rgb_black;			// Self-explanatory
 	for (int il=0; il<4; il++)
@@ -267,6 +281,113 @@ inline bool StringPresent(vector<char>& String)
 GLint glMaxTextureSize = 0;
 bool hasS3TC = false;
 
+// On-disk cache of loaded substitute textures;
+// each entry is named after a checksum of everything that went into making it,
+// and carries that description so that checksum collisions are harmless
+const uint32 TextureCacheMagic = FOUR_CHARS_TO_INT('A','1','T','C');
+const uint32 TextureCacheVersion = 1;
+// past this, the least recently written entries are deleted, checked
+// every TextureCachePruneInterval bytes written (and on the first write);
+// skins are written from the model loading threads
+const int64_t TextureCacheMaximumSize = 256 * 1024 * 1024;
+const int TextureCachePruneInterval = 16 * 1024 * 1024;
+static SDL_atomic_t TextureCacheWrittenSincePrune = { TextureCachePruneInterval };
+
+static void AddTextureCacheSource(std::string& Key, FileSpecifier& File)
+{
+	if (File == FileSpecifier() || !File.Exists()) return;
+	
+	char Date[32];
+	sprintf(Date, "@%lld;", (long long) File.GetDate());
+	Key += File.GetPath();
+	Key += Date;
+}
+
+static DirectorySpecifier GetTextureCacheDir()
+{
+	DirectorySpecifier Dir;
+	Dir.SetToImageCacheDir();
+	Dir += "Textures";
+	return Dir;
+}
+
+static bool GetTextureCacheFile(const std::string& Key, FileSpecifier& File)
+{
+	DirectorySpecifier Dir = GetTextureCacheDir();
+	if (!Dir.Exists() && !Dir.CreateDirectory()) return false;
+	
+	char Name[32];
+	sprintf(Name, "%08x.a1t", calculate_data_crc((unsigned char *) Key.data(), Key.size()));
+	File = Dir + Name;
+	return true;
+}
+
+static bool ReadTextureCache(const std::string& Key, ImageDescriptor* Images[], int NumImages)
+{
+	FileSpecifier File;
+	if (!GetTextureCacheFile(Key, File) || !File.Exists()) return false;
+
+	OpenedFile OFile;
+	if (!File.Open(OFile)) return false;
+
+	uint32 Header[4];
+	if (!OFile.Read(sizeof(Header), Header)) return false;
+	if (Header[0] != TextureCacheMagic || Header[1] != TextureCacheVersion || Header[2] != Key.size()) return false;
+
+	std::string StoredKey(Header[2], '\0');
+	if (!OFile.Read(Header[2], &StoredKey[0]) || StoredKey != Key) return false;
+
+	for (int i = 0; i < NumImages; i++)
+	{
+		if (!(Header[3] & (1 << i))) continue;
+		if (!Images[i]->ReadCached(OFile))
+		{
+			for (int j = 0; j < NumImages; j++) Images[j]->Clear();
+			return false;
+		}
+	}
+	return true;
+}
+
+static void WriteTextureCache(const std::string& Key, ImageDescriptor* Images[], int NumImages)
+{
+	FileSpecifier File;
+	if (!GetTextureCacheFile(Key, File)) return;
+
+	FileSpecifier TempFile;
+	TempFile.SetTempName(File);
+	if (!TempFile.Create(_typecode_unknown)) return;
+
+	bool Written = false;
+	int32 Length = 0;
+	{
+		OpenedFile OFile;
+		if (TempFile.Open(OFile, true))
+		{
+			uint32 Header[4] = { TextureCacheMagic, TextureCacheVersion, uint32(Key.size()), 0 };
+			for (int i = 0; i < NumImages; i++)
+				if (Images[i]->IsPresent()) Header[3] |= (1 << i);
+			
+			Written = OFile.Write(sizeof(Header), Header) &&
+				OFile.Write(Key.size(), const_cast<char *>(Key.data()));
+			for (int i = 0; i < NumImages && Written; i++)
+				if (Images[i]->IsPresent()) Written = Images[i]->WriteCached(OFile);
+			if (Written) OFile.GetPosition(Length);
+		}
+	}
+
+	if (!Written || !TempFile.Rename(File))
+	{
+		logWarning("Could not write texture cache entry %s", File.GetPath());
+		TempFile.Delete();
+		return;
+	}
+
+	int SincePrune = SDL_AtomicAdd(&TextureCacheWrittenSincePrune, Length) + Length;
+	if (SincePrune >= TextureCachePruneInterval && SDL_AtomicCAS(&TextureCacheWrittenSincePrune, SincePrune, 0))
+		GetTextureCacheDir().PruneDirectory(".a1t", TextureCacheMaximumSize);
+}
+
 void OGL_TextureOptionsBase::Load()
 {
 	FileSpecifier File;
@@ -301,6 +422,24 @@ void OGL_TextureOptionsBase::Load()
 	if (NormalImg.IsPresent()) return;
 
 	NormalImg.Clear();
+
+	// Everything that affects the result goes into the cache key
+	std::string CacheKey;
+	{
+		char Params[64];
+		sprintf(Params, "%d,%d,%d,%d,%d,%d;", flags, int(maxTextureSize), actual_width, actual_height, NormalIsPremultiplied, GlowIsPremultiplied);
+		CacheKey = Params;
+	}
+	AddTextureCacheSource(CacheKey, NormalColors);
+	AddTextureCacheSource(CacheKey, NormalMask);
+	AddTextureCacheSource(CacheKey, GlowColors);
+	AddTextureCacheSource(CacheKey, GlowMask);
+	AddTextureCacheSource(CacheKey, OffsetMap);
+	
+	ImageDescriptor* CachedImages[3] = { &NormalImg, &GlowImg, &OffsetImg };
+	if (ReadTextureCache(CacheKey, CachedImages, 3)) return;
+	GlowImg.Clear();
+	OffsetImg.Clear();
 	
 	// Load the normal image if it has a filename specified for it
 	if (NormalColors != FileSpecifier() && NormalColors.Exists())
@@ -390,6 +529,8 @@ void OGL_TextureOptionsBase::Load()
 		GlowImg.Clear();
 	}
 
+	if (NormalImg.IsPresent())
+		WriteTextureCache(CacheKey, CachedImages, 3);
 }
 
 void OGL_TextureOptionsBase::Unload()
@@ -511,12 +652,12 @@ void parse_mml_opengl(const InfoTree& root)
 			parse_mml_opengl_model_clear(v.second);
 	}
 	
-	BOOST_FOREACH(InfoTree shader, root.children_named("shader"))
+	BOOST_FOREACH(const InfoTree &shader, root.children_named("shader"))
 	{
 		parse_mml_opengl_shader(shader);
 	}
 	
-	BOOST_FOREACH(InfoTree fog, root.children_named("fog"))
+	BOOST_FOREACH(const InfoTree &fog, root.children_named("fog"))
 	{
 		int16 type = 0;
 		fog.read_indexed("type", type, OGL_NUMBER_OF_FOG_TYPES);
@@ -526,7 +667,7 @@ void parse_mml_opengl(const InfoTree& root)
 		fog.read_attr("depth", def.Depth);
 		fog.read_attr("landscapes", def.AffectsLandscapes);
 		
-		BOOST_FOREACH(InfoTree color, fog.children_named("color"))
+		BOOST_FOREACH(const InfoTree &color, fog.children_named("color"))
 		{
 			color.read_color(def.Color);
 		}
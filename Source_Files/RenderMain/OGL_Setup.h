@@ -225,6 +225,28 @@ enum
 	OGL_Flag_BumpMap	= 0x2000,   // Whether to use bump mapping
 };
 
+// Bloom qualities: the classic blur, at the glow buffer's size, or a chain
+// of half-size buffers three, four or five deep
+enum
+{
+	OGL_Bloom_Classic,
+	OGL_Bloom_Low,
+	OGL_Bloom_Medium,
+	OGL_Bloom_High,
+	NUMBER_OF_BLOOM_QUALITIES
+};
+
+// Dynamic resolution: off, or the frame rate the shader renderer keeps to
+// by drawing the world view at less than full resolution
+enum
+{
+	OGL_DynamicResolution_Off,
+	OGL_DynamicResolution_30,
+	OGL_DynamicResolution_60,
+	OGL_DynamicResolution_120,
+	NUMBER_OF_DYNAMIC_RESOLUTION_TARGETS
+};
+
 struct OGL_ConfigureData
 {
 	// Configure textures
@@ -248,6 +270,27 @@ struct OGL_ConfigureData
 	// Anisotropy setting
 	float AnisotropyLevel;
 	int16 Multisamples;
+	
+	// Most texture memory to use, in megabytes; 0 is no limit
+	int16 TextureMemoryBudget;
+	
+	// Whether the shader renderer draws each node's opaque surfaces
+	// grouped by shader and texture rather than in the order found
+	bool SortSurfaces;
+
+	// How the shader renderer blurs glowing surfaces for bloom
+	int16 BloomQuality;
+
+	// Whether the shader renderer skips 3D models whose bounding boxes
+	// were hidden behind what was drawn in the frame before
+	bool OcclusionCulling;
+
+	// What frame rate, if any, the shader renderer scales the world view for
+	int16 DynamicResolution;
+
+	// Whether the shader renderer smooths the world view's edges with FXAA,
+	// a pass over the finished view, instead of (or as well as) multisampling
+	bool PostAntialiasing;
 
 	bool GeForceFix;
 	bool WaitForVSync;
@@ -18,6 +18,14 @@
  http://www.gnu.org/licenses/gpl.html
  
  Implements OpenGL vertex/fragment shader class
+
+ Oct 14, 2026:
+	Linked programs are cached on disk with glGetProgramBinary,
+	keyed by the driver and the full shader source
+
+ Oct 14, 2026:
+	Added model variants of the wall, bump, invincible and invisible shaders
+	that do the bone and frame transforms of Model3D in the vertex program
  */
 #include <algorithm>
 #include <iostream>
@@ -26,6 +34,9 @@
 #include "FileHandler.h"
 #include "OGL_Setup.h"
 #include "InfoTree.h"
+#include "crc.h"
+#include "Logging.h"
+#include "SDL.h"
 
 
 // gl_ClipVertex workaround
@@ -85,7 +96,12 @@ const char* Shader::_uniform_names[NUMBER_OF_UNIFORM_LOCATIONS] =
 	"yaw",
 	"pitch",
 	"selfLuminosity",
-	"gammaAdjust"
+	"gammaAdjust",
+	"infravisionTint",
+	"modelBones",
+	"opacityAdjust",
+	"fadeScale",
+	"fadeOffset"
 };
 
 const char* Shader::_shader_names[NUMBER_OF_SHADER_TYPES] = 
@@ -104,7 +120,16 @@ const char* Shader::_shader_names[NUMBER_OF_SHADER_TYPES] =
 	"wall_bloom",
 	"bump",
 	"bump_bloom",
-	"gamma"
+	"gamma",
+	"model_wall",
+	"model_wall_bloom",
+	"model_bump",
+	"model_bump_bloom",
+	"model_invincible",
+	"model_invincible_bloom",
+	"model_invisible",
+	"model_invisible_bloom",
+	"fxaa"
 };
 
 
@@ -175,25 +200,33 @@ void parseFile(FileSpecifier& fileSpec, std::string& s) {
 }
 
 
-GLhandleARB parseShader(const GLcharARB* str, GLenum shaderType) {
-
-	GLint status;
-	GLhandleARB shader = glCreateShaderObjectARB(shaderType);
-
-	std::vector<const GLcharARB*> source;
+// Preprocessor settings put in front of every shader
+static std::string shaderDefines() {
 
+	std::string defines;
 	if (DisableClipVertex())
 	{
-		source.push_back("#define DISABLE_CLIP_VERTEX\n");
+		defines += "#define DISABLE_CLIP_VERTEX\n";
 	}
 	if (Wanting_sRGB)
 	{
-		source.push_back("#define GAMMA_CORRECTED_BLENDING\n");
+		defines += "#define GAMMA_CORRECTED_BLENDING\n";
 	}
 	if (Bloom_sRGB)
 	{
-		source.push_back("#define BLOOM_SRGB_FRAMEBUFFER\n");
+		defines += "#define BLOOM_SRGB_FRAMEBUFFER\n";
 	}
+	return defines;
+}
+
+GLhandleARB parseShader(const GLcharARB* str, GLenum shaderType) {
+
+	GLint status;
+	GLhandleARB shader = glCreateShaderObjectARB(shaderType);
+
+	std::string defines = shaderDefines();
+	std::vector<const GLcharARB*> source;
+	source.push_back(defines.c_str());
 	source.push_back(str);
 
 	glShaderSourceARB(shader, source.size(), &source[0], NULL);
@@ -209,6 +242,136 @@ GLhandleARB parseShader(const GLcharARB* str, GLenum shaderType) {
 	}
 }
 
+// Cache of linked programs, so that drivers which are slow to compile
+// need only do it once; any failure just means compiling from source.
+// Apple's legacy contexts lack program binaries, and their ARB handles
+// aren't program names.
+#if !(defined(__APPLE__) && defined(__MACH__))
+#define HAVE_PROGRAM_BINARY_CACHE 1
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+
+typedef void (APIENTRY *GetProgramBinaryProc)(GLuint, GLsizei, GLsizei *, GLenum *, void *);
+typedef void (APIENTRY *ProgramBinaryProc)(GLuint, GLenum, const void *, GLsizei);
+typedef void (APIENTRY *ProgramParameteriProc)(GLuint, GLenum, GLint);
+
+static GetProgramBinaryProc getProgramBinary = NULL;
+static ProgramBinaryProc programBinary = NULL;
+static ProgramParameteriProc programParameteri = NULL;
+
+static bool programBinariesAvailable() {
+	static bool checked = false;
+	if (!checked) {
+		checked = true;
+		if (OGL_CheckExtension("GL_ARB_get_program_binary")) {
+			getProgramBinary = reinterpret_cast<GetProgramBinaryProc>(SDL_GL_GetProcAddress("glGetProgramBinary"));
+			programBinary = reinterpret_cast<ProgramBinaryProc>(SDL_GL_GetProcAddress("glProgramBinary"));
+			programParameteri = reinterpret_cast<ProgramParameteriProc>(SDL_GL_GetProcAddress("glProgramParameteri"));
+		}
+	}
+	return getProgramBinary && programBinary && programParameteri;
+}
+
+static const uint32 programCacheMagic = FOUR_CHARS_TO_INT('A','1','S','C');
+
+static std::string programCacheKey(const std::string& vert, const std::string& frag) {
+
+	std::string key;
+	const GLenum strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	for (int i = 0; i < 3; ++i) {
+		const GLubyte* s = glGetString(strings[i]);
+		if (s) { key += reinterpret_cast<const char*>(s); }
+		key += '\n';
+	}
+	key += shaderDefines();
+	key += vert;
+	key += '\0';
+	key += frag;
+	return key;
+}
+
+static bool programCacheFile(const std::string& key, FileSpecifier& file) {
+
+	DirectorySpecifier dir;
+	dir.SetToLocalDataDir();
+	dir += "Shader Cache";
+	if (!dir.Exists() && !dir.CreateDirectory()) { return false; }
+
+	char name[32];
+	sprintf(name, "%08x.bin", calculate_data_crc((unsigned char *) key.data(), key.size()));
+	file = dir + name;
+	return true;
+}
+
+static bool loadProgramBinary(GLuint program, const std::string& key) {
+
+	FileSpecifier file;
+	if (!programCacheFile(key, file) || !file.Exists()) { return false; }
+
+	OpenedFile of;
+	if (!file.Open(of)) { return false; }
+
+	uint32 header[4];
+	if (!of.Read(sizeof(header), header)) { return false; }
+	if (header[0] != programCacheMagic || header[1] != key.size()) { return false; }
+
+	std::string storedKey(header[1], '\0');
+	if (!of.Read(header[1], &storedKey[0]) || storedKey != key) { return false; }
+
+	std::vector<char> binary(header[3]);
+	if (binary.empty() || !of.Read(binary.size(), &binary[0])) { return false; }
+
+	programBinary(program, header[2], &binary[0], binary.size());
+
+	GLint status = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	return status != 0;
+}
+
+static void saveProgramBinary(GLuint program, const std::string& key) {
+
+	GLint status = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (!status) { return; }
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) { return; }
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	getProgramBinary(program, length, &length, &format, &binary[0]);
+	if (length <= 0) { return; }
+
+	FileSpecifier file;
+	if (!programCacheFile(key, file)) { return; }
+	FileSpecifier tempFile;
+	tempFile.SetTempName(file);
+	if (!tempFile.Create(_typecode_unknown)) { return; }
+
+	bool written = false;
+	{
+		OpenedFile of;
+		if (tempFile.Open(of, true)) {
+			uint32 header[4] = { programCacheMagic, uint32(key.size()), format, uint32(length) };
+			written = of.Write(sizeof(header), header) &&
+				of.Write(key.size(), const_cast<char *>(key.data())) &&
+				of.Write(length, &binary[0]);
+		}
+	}
+
+	if (!written || !tempFile.Rename(file)) {
+		logWarning("Could not write shader cache entry %s", file.GetPath());
+		tempFile.Delete();
+	}
+}
+#endif
+
 void Shader::loadAll() {
 	initDefaultPrograms();
 	if (!_shaders.size()) 
@@ -228,7 +391,7 @@ void Shader::unloadAll() {
 	}
 }
 
-Shader::Shader(const std::string& name) : _programObj(0), _passes(-1), _loaded(false) {
+Shader::Shader(const std::string& name) : _programObj(0), _passes(-1), _loaded(false), _default(true) {
     initDefaultPrograms();
     if (defaultVertexPrograms.count(name) > 0) {
 	    _vert = defaultVertexPrograms[name];
@@ -252,6 +415,30 @@ Shader::Shader(const std::string& name, FileSpecifier& vert, FileSpecifier& frag
 	{
 		_frag = defaultFragmentPrograms[name];
 	}
+
+	_default = (_vert == defaultVertexPrograms[name] && _frag == defaultFragmentPrograms[name]);
+}
+
+Shader* Shader::getSkinned(ShaderType type) {
+
+	ShaderType skinned;
+	switch (type) {
+		case S_Wall: skinned = S_ModelWall; break;
+		case S_WallBloom: skinned = S_ModelWallBloom; break;
+		case S_Bump: skinned = S_ModelBump; break;
+		case S_BumpBloom: skinned = S_ModelBumpBloom; break;
+		case S_Invincible: skinned = S_ModelInvincible; break;
+		case S_InvincibleBloom: skinned = S_ModelInvincibleBloom; break;
+		case S_Invisible: skinned = S_ModelInvisible; break;
+		case S_InvisibleBloom: skinned = S_ModelInvisibleBloom; break;
+		default: return NULL;
+	}
+
+	// keep a replacement's look; models will be animated on the CPU for it
+	if (!_shaders[type]._default && _shaders[skinned]._default) {
+		return NULL;
+	}
+	return &_shaders[skinned];
 }
 
 void Shader::init() {
@@ -262,22 +449,44 @@ void Shader::init() {
 	_loaded = true;
 
 	_programObj = glCreateProgramObjectARB();
+	assert(_programObj);
+
+	bool linked = false;
+#ifdef HAVE_PROGRAM_BINARY_CACHE
+	std::string cacheKey;
+	if (programBinariesAvailable()) {
+		cacheKey = programCacheKey(_vert, _frag);
+		linked = loadProgramBinary(_programObj, cacheKey);
+		if (!linked) {
+			// a rejected binary can leave the object unusable
+			glDeleteObjectARB(_programObj);
+			_programObj = glCreateProgramObjectARB();
+			programParameteri(_programObj, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+	}
+#endif
 
-	assert(!_vert.empty());
-	GLhandleARB vertexShader = parseShader(_vert.c_str(), GL_VERTEX_SHADER_ARB);
-	assert(vertexShader);
-	glAttachObjectARB(_programObj, vertexShader);
-	glDeleteObjectARB(vertexShader);
-
-	assert(!_frag.empty());
-	GLhandleARB fragmentShader = parseShader(_frag.c_str(), GL_FRAGMENT_SHADER_ARB);
-	assert(fragmentShader);
-	glAttachObjectARB(_programObj, fragmentShader);
-	glDeleteObjectARB(fragmentShader);
+	if (!linked) {
+		assert(!_vert.empty());
+		GLhandleARB vertexShader = parseShader(_vert.c_str(), GL_VERTEX_SHADER_ARB);
+		assert(vertexShader);
+		glAttachObjectARB(_programObj, vertexShader);
+		glDeleteObjectARB(vertexShader);
+
+		assert(!_frag.empty());
+		GLhandleARB fragmentShader = parseShader(_frag.c_str(), GL_FRAGMENT_SHADER_ARB);
+		assert(fragmentShader);
+		glAttachObjectARB(_programObj, fragmentShader);
+		glDeleteObjectARB(fragmentShader);
 	
-	glLinkProgramARB(_programObj);
+		glLinkProgramARB(_programObj);
 
-	assert(_programObj);
+#ifdef HAVE_PROGRAM_BINARY_CACHE
+		if (!cacheKey.empty()) {
+			saveProgramBinary(_programObj, cacheKey);
+		}
+#endif
+	}
 
 	glUseProgramObjectARB(_programObj);
 
@@ -299,6 +508,11 @@ void Shader::setFloat(UniformName name, float f) {
 	}
 }
 
+void Shader::setVec4(UniformName name, const float *f, int count) {
+
+	glUniform4fvARB(getUniformLocation(name), count, f);
+}
+
 void Shader::setMatrix4(UniformName name, float *f) {
 
 	glUniformMatrix4fvARB(getUniformLocation(name), 1, false, f);
@@ -343,9 +557,47 @@ void initDefaultPrograms() {
 	defaultFragmentPrograms["gamma"] = ""
 	"uniform sampler2DRect texture0;\n"
 	"uniform float gammaAdjust;\n"
+	"uniform vec4 fadeScale[4];\n"
+	"uniform vec4 fadeOffset[4];\n"
 	"void main (void) {\n"
 	"	vec4 color0 = texture2DRect(texture0, gl_TexCoord[0].xy);\n"
-	"	gl_FragColor = vec4(pow(color0.r, gammaAdjust), pow(color0.g, gammaAdjust), pow(color0.b, gammaAdjust), 1.0);\n"
+	"	vec3 color = pow(color0.rgb, vec3(gammaAdjust));\n"
+	"	for (int i = 0; i < 4; ++i) {\n"
+	"		color = clamp(color * fadeScale[i].rgb + fadeOffset[i].rgb, 0.0, 1.0);\n"
+	"	}\n"
+	"	gl_FragColor = vec4(color, 1.0);\n"
+	"}\n";
+	
+	// FXAA, after Timothy Lottes' console version: each pixel whose neighbors'
+	// luma says it's on an edge is blended along the edge; texture0 is the
+	// world view's FBO, which is filtered linearly, so a half-pixel offset
+	// takes the average of four pixels
+	defaultVertexPrograms["fxaa"] = defaultVertexPrograms["gamma"];
+	defaultFragmentPrograms["fxaa"] = ""
+	"uniform sampler2DRect texture0;\n"
+	"const float spanMax = 8.0;\n"
+	"const float reduceMul = 1.0 / 8.0;\n"
+	"const float reduceMin = 1.0 / 128.0;\n"
+	"const vec3 lumaWeights = vec3(0.299, 0.587, 0.114);\n"
+	"vec3 fetch(vec2 p) { return texture2DRect(texture0, p).rgb; }\n"
+	"void main (void) {\n"
+	"	vec2 p = gl_TexCoord[0].xy;\n"
+	"	float lumaNW = dot(fetch(p + vec2(-0.5, -0.5)), lumaWeights);\n"
+	"	float lumaNE = dot(fetch(p + vec2(0.5, -0.5)), lumaWeights);\n"
+	"	float lumaSW = dot(fetch(p + vec2(-0.5, 0.5)), lumaWeights);\n"
+	"	float lumaSE = dot(fetch(p + vec2(0.5, 0.5)), lumaWeights);\n"
+	"	vec3 rgbM = fetch(p);\n"
+	"	float lumaM = dot(rgbM, lumaWeights);\n"
+	"	float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));\n"
+	"	float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));\n"
+	"	vec2 dir = vec2((lumaSW + lumaSE) - (lumaNW + lumaNE), (lumaNW + lumaSW) - (lumaNE + lumaSE));\n"
+	"	float dirReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * (0.25 * reduceMul), reduceMin);\n"
+	"	float rcpDirMin = 1.0 / (min(abs(dir.x), abs(dir.y)) + dirReduce);\n"
+	"	dir = clamp(dir * rcpDirMin, vec2(-spanMax), vec2(spanMax));\n"
+	"	vec3 rgbA = 0.5 * (fetch(p + dir * (1.0 / 3.0 - 0.5)) + fetch(p + dir * (2.0 / 3.0 - 0.5)));\n"
+	"	vec3 rgbB = rgbA * 0.5 + 0.25 * (fetch(p - dir * 0.5) + fetch(p + dir * 0.5));\n"
+	"	float lumaB = dot(rgbB, lumaWeights);\n"
+	"	gl_FragColor = vec4((lumaB < lumaMin || lumaB > lumaMax) ? rgbA : rgbB, 1.0);\n"
 	"}\n";
 	
     defaultVertexPrograms["blur"] = ""
@@ -430,6 +682,8 @@ void initDefaultPrograms() {
         "}\n";
     defaultFragmentPrograms["landscape"] = ""
         "uniform sampler2D texture0;\n"
+        "uniform vec4 opacityAdjust;\n"
+        "uniform vec4 infravisionTint;\n"
         "uniform float usefog;\n"
         "uniform float scalex;\n"
         "uniform float scaley;\n"
@@ -447,6 +701,8 @@ void initDefaultPrograms() {
         "	float x = relv.x / (relv.z * zoom) + atan(facev.x, facev.y);\n"
         "	float y = relv.y / (relv.z * zoom) - (facev.z * pitch_adjust);\n"
         "	vec4 color = texture2D(texture0, vec2(offsetx - x * scalex, offsety - y * scaley));\n"
+        "	color.a = clamp(dot(vec3(color.a, (color.r + color.g + color.b) / 3.0, max(max(color.r, color.g), color.b)), vec3(1.0 - opacityAdjust.z - opacityAdjust.w, opacityAdjust.zw)) * (1.0 + opacityAdjust.x) + opacityAdjust.y, 0.0, 1.0);\n"
+        "	color.rgb = mix(color.rgb, infravisionTint.rgb * ((color.r + color.g + color.b) / 3.0), infravisionTint.a);\n"
         "	vec3 intensity = color.rgb;\n"
         "	if (usefog > 0.0) {\n"
         "		intensity = gl_Fog.color.rgb;\n"
@@ -456,6 +712,8 @@ void initDefaultPrograms() {
     defaultVertexPrograms["landscape_bloom"] = defaultVertexPrograms["landscape"];
     defaultFragmentPrograms["landscape_bloom"] = ""
         "uniform sampler2D texture0;\n"
+        "uniform vec4 opacityAdjust;\n"
+        "uniform vec4 infravisionTint;\n"
         "uniform float usefog;\n"
         "uniform float scalex;\n"
         "uniform float scaley;\n"
@@ -474,6 +732,8 @@ void initDefaultPrograms() {
         "	float x = relv.x / (relv.z * zoom) + atan(facev.x, facev.y);\n"
         "	float y = relv.y / (relv.z * zoom) - (facev.z * pitch_adjust);\n"
         "	vec4 color = texture2D(texture0, vec2(offsetx - x * scalex, offsety - y * scaley));\n"
+        "	color.a = clamp(dot(vec3(color.a, (color.r + color.g + color.b) / 3.0, max(max(color.r, color.g), color.b)), vec3(1.0 - opacityAdjust.z - opacityAdjust.w, opacityAdjust.zw)) * (1.0 + opacityAdjust.x) + opacityAdjust.y, 0.0, 1.0);\n"
+        "	color.rgb = mix(color.rgb, infravisionTint.rgb * ((color.r + color.g + color.b) / 3.0), infravisionTint.a);\n"
         "	float intensity = clamp(bloomScale, 0.0, 1.0);\n"
         "	if (usefog > 0.0) {\n"
         "		intensity = 0.0;\n"
@@ -508,6 +768,8 @@ void initDefaultPrograms() {
         "}\n";    
     defaultFragmentPrograms["sprite"] = ""
         "uniform sampler2D texture0;\n"
+        "uniform vec4 opacityAdjust;\n"
+        "uniform vec4 infravisionTint;\n"
         "uniform float glow;\n"
         "uniform float flare;\n"
         "uniform float selfLuminosity;\n"
@@ -528,12 +790,16 @@ void initDefaultPrograms() {
         "	intensity = intensity * intensity; // approximation of pow(intensity, 2.2)\n"
         "#endif\n"
         "	vec4 color = texture2D(texture0, gl_TexCoord[0].xy);\n"
+        "	color.a = clamp(dot(vec3(color.a, (color.r + color.g + color.b) / 3.0, max(max(color.r, color.g), color.b)), vec3(1.0 - opacityAdjust.z - opacityAdjust.w, opacityAdjust.zw)) * (1.0 + opacityAdjust.x) + opacityAdjust.y, 0.0, 1.0);\n"
+        "	color.rgb = mix(color.rgb, infravisionTint.rgb * ((color.r + color.g + color.b) / 3.0), infravisionTint.a);\n"
         "	float fogFactor = clamp(exp2(FDxLOG2E * length(viewDir)), 0.0, 1.0);\n"
         "	gl_FragColor = vec4(mix(gl_Fog.color.rgb, color.rgb * intensity, fogFactor), vertexColor.a * color.a);\n"
         "}\n";
     defaultVertexPrograms["sprite_bloom"] = defaultVertexPrograms["sprite"];
     defaultFragmentPrograms["sprite_bloom"] = ""
         "uniform sampler2D texture0;\n"
+        "uniform vec4 opacityAdjust;\n"
+        "uniform vec4 infravisionTint;\n"
         "uniform float glow;\n"
         "uniform float bloomScale;\n"
         "uniform float bloomShift;\n"
@@ -543,6 +809,8 @@ void initDefaultPrograms() {
         "varying float classicDepth;\n"
         "void main (void) {\n"
         "	vec4 color = texture2D(texture0, gl_TexCoord[0].xy);\n"
+        "	color.a = clamp(dot(vec3(color.a, (color.r + color.g + color.b) / 3.0, max(max(color.r, color.g), color.b)), vec3(1.0 - opacityAdjust.z - opacityAdjust.w, opacityAdjust.zw)) * (1.0 + opacityAdjust.x) + opacityAdjust.y, 0.0, 1.0);\n"
+        "	color.rgb = mix(color.rgb, infravisionTint.rgb * ((color.r + color.g + color.b) / 3.0), infravisionTint.a);\n"
         "	vec3 intensity = clamp(vertexColor.rgb, glow, 1.0);\n"
         "	//intensity = intensity * clamp(2.0 - length(viewDir)/8192.0, 0.0, 1.0);\n"
         "	intensity = clamp(intensity * bloomScale + bloomShift, 0.0, 1.0);\n"
@@ -559,6 +827,7 @@ void initDefaultPrograms() {
     defaultVertexPrograms["invincible"] = defaultVertexPrograms["sprite"];
     defaultFragmentPrograms["invincible"] = ""
         "uniform sampler2D texture0;\n"
+        "uniform vec4 opacityAdjust;\n"
         "uniform float time;\n"
         "uniform float usestatic;\n"
         "varying vec3 viewDir;\n"
@@ -569,6 +838,7 @@ void initDefaultPrograms() {
         "	float b = fract(sin(usestatic*(gl_TexCoord[0].x * 2331.0 + gl_TexCoord[0].y * 63.0) + time * 3.0) * 32451.0); \n"
         "	float c = fract(sin(usestatic*(gl_TexCoord[0].x * 41.0 + gl_TexCoord[0].y * 12911.0) + time * 31.0) * 34563.0);\n"
         "	vec4 color = texture2D(texture0, gl_TexCoord[0].xy);\n"
+        "	color.a = clamp(dot(vec3(color.a, (color.r + color.g + color.b) / 3.0, max(max(color.r, color.g), color.b)), vec3(1.0 - opacityAdjust.z - opacityAdjust.w, opacityAdjust.zw)) * (1.0 + opacityAdjust.x) + opacityAdjust.y, 0.0, 1.0);\n"
         "	vec3 intensity = vec3(a, b, c);\n"
         "#ifdef GAMMA_CORRECTED_BLENDING\n"
         "	intensity = intensity * intensity;  // approximation of pow(intensity, 2.2)\n"
@@ -579,6 +849,7 @@ void initDefaultPrograms() {
     defaultVertexPrograms["invincible_bloom"] = defaultVertexPrograms["invincible"];
     defaultFragmentPrograms["invincible_bloom"] = ""
         "uniform sampler2D texture0;\n"
+        "uniform vec4 opacityAdjust;\n"
         "uniform float time;\n"
         "uniform float usestatic;\n"
         "uniform float bloomScale;\n"
@@ -588,6 +859,7 @@ void initDefaultPrograms() {
         "varying float FDxLOG2E;\n"
         "void main(void) {\n"
         "	vec4 color = texture2D(texture0, gl_TexCoord[0].xy);\n"
+        "	color.a = clamp(dot(vec3(color.a, (color.r + color.g + color.b) / 3.0, max(max(color.r, color.g), color.b)), vec3(1.0 - opacityAdjust.z - opacityAdjust.w, opacityAdjust.zw)) * (1.0 + opacityAdjust.x) + opacityAdjust.y, 0.0, 1.0);\n"
         "	vec3 intensity = vec3(0.0, 0.0, 0.0);\n"
         "	float fogFactor = exp2(FDxLOG2E * length(viewDir));\n"
         "	gl_FragColor = vec4(mix(vec3(0.0, 0.0, 0.0), intensity, fogFactor), vertexColor.a * color.a);\n"
@@ -596,12 +868,14 @@ void initDefaultPrograms() {
     defaultVertexPrograms["invisible"] = defaultVertexPrograms["sprite"];
     defaultFragmentPrograms["invisible"] = ""
         "uniform sampler2D texture0;\n"
+        "uniform vec4 opacityAdjust;\n"
         "uniform float visibility;\n"
         "varying vec3 viewDir;\n"
         "varying vec4 vertexColor;\n"
         "varying float FDxLOG2E;\n"
         "void main(void) {\n"
         "	vec4 color = texture2D(texture0, gl_TexCoord[0].xy);\n"
+        "	color.a = clamp(dot(vec3(color.a, (color.r + color.g + color.b) / 3.0, max(max(color.r, color.g), color.b)), vec3(1.0 - opacityAdjust.z - opacityAdjust.w, opacityAdjust.zw)) * (1.0 + opacityAdjust.x) + opacityAdjust.y, 0.0, 1.0);\n"
         "   vec3 intensity = vec3(0.0, 0.0, 0.0);\n"
         "	float fogFactor = clamp(exp2(FDxLOG2E * length(viewDir)), 0.0, 1.0);\n"
         "	gl_FragColor = vec4(mix(gl_Fog.color.rgb, intensity, fogFactor), vertexColor.a * color.a * visibility);\n"
@@ -609,12 +883,14 @@ void initDefaultPrograms() {
     defaultVertexPrograms["invisible_bloom"] = defaultVertexPrograms["invisible"];
     defaultFragmentPrograms["invisible_bloom"] = ""
         "uniform sampler2D texture0;\n"
+        "uniform vec4 opacityAdjust;\n"
         "uniform float visibility;\n"
         "varying vec3 viewDir;\n"
         "varying vec4 vertexColor;\n"
         "varying float FDxLOG2E;\n"
         "void main(void) {\n"
         "	vec4 color = texture2D(texture0, gl_TexCoord[0].xy);\n"
+        "	color.a = clamp(dot(vec3(color.a, (color.r + color.g + color.b) / 3.0, max(max(color.r, color.g), color.b)), vec3(1.0 - opacityAdjust.z - opacityAdjust.w, opacityAdjust.zw)) * (1.0 + opacityAdjust.x) + opacityAdjust.y, 0.0, 1.0);\n"
         "   vec3 intensity = vec3(0.0, 0.0, 0.0);\n"
         "	float fogFactor = clamp(exp2(FDxLOG2E * length(viewDir)), 0.0, 1.0);\n"
         "	gl_FragColor = vec4(mix(vec3(0.0, 0.0, 0.0), intensity, fogFactor), vertexColor.a * color.a * visibility);\n"
@@ -651,6 +927,8 @@ void initDefaultPrograms() {
         "}\n";
     defaultFragmentPrograms["wall"] = ""
         "uniform sampler2D texture0;\n"
+        "uniform vec4 opacityAdjust;\n"
+        "uniform vec4 infravisionTint;\n"
         "uniform float pulsate;\n"
         "uniform float wobble;\n"
         "uniform float glow;\n"
@@ -678,12 +956,16 @@ void initDefaultPrograms() {
         "	intensity = intensity * intensity; // approximation of pow(intensity, 2.2)\n"
         "#endif\n"
         "	vec4 color = texture2D(texture0, texCoords.xy);\n"
+        "	color.a = clamp(dot(vec3(color.a, (color.r + color.g + color.b) / 3.0, max(max(color.r, color.g), color.b)), vec3(1.0 - opacityAdjust.z - opacityAdjust.w, opacityAdjust.zw)) * (1.0 + opacityAdjust.x) + opacityAdjust.y, 0.0, 1.0);\n"
+        "	color.rgb = mix(color.rgb, infravisionTint.rgb * ((color.r + color.g + color.b) / 3.0), infravisionTint.a);\n"
         "	float fogFactor = clamp(exp2(FDxLOG2E * length(viewDir)), 0.0, 1.0);\n"
         "	gl_FragColor = vec4(mix(gl_Fog.color.rgb, color.rgb * intensity, fogFactor), vertexColor.a * color.a);\n"
         "}\n";
     defaultVertexPrograms["wall_bloom"] = defaultVertexPrograms["wall"];
     defaultFragmentPrograms["wall_bloom"] = ""
         "uniform sampler2D texture0;\n"
+        "uniform vec4 opacityAdjust;\n"
+        "uniform vec4 infravisionTint;\n"
         "uniform float pulsate;\n"
         "uniform float wobble;\n"
         "uniform float glow;\n"
@@ -700,6 +982,8 @@ void initDefaultPrograms() {
         "	texCoords += vec3(normXY.y * -pulsate, normXY.x * pulsate, 0.0);\n"
         "	texCoords += vec3(normXY.y * -wobble * texCoords.y, wobble * texCoords.y, 0.0);\n"
         "	vec4 color = texture2D(texture0, texCoords.xy);\n"
+        "	color.a = clamp(dot(vec3(color.a, (color.r + color.g + color.b) / 3.0, max(max(color.r, color.g), color.b)), vec3(1.0 - opacityAdjust.z - opacityAdjust.w, opacityAdjust.zw)) * (1.0 + opacityAdjust.x) + opacityAdjust.y, 0.0, 1.0);\n"
+        "	color.rgb = mix(color.rgb, infravisionTint.rgb * ((color.r + color.g + color.b) / 3.0), infravisionTint.a);\n"
         "	vec3 intensity = clamp(vertexColor.rgb, glow, 1.0);\n"
         "	float diffuse = abs(dot(vec3(0.0, 0.0, 1.0), normalize(viewDir)));\n"
         "	intensity = clamp(intensity * bloomScale + bloomShift, 0.0, 1.0);\n"
@@ -713,6 +997,8 @@ void initDefaultPrograms() {
     defaultVertexPrograms["bump"] = defaultVertexPrograms["wall"];
     defaultFragmentPrograms["bump"] = ""
         "uniform sampler2D texture0;\n"
+        "uniform vec4 opacityAdjust;\n"
+        "uniform vec4 infravisionTint;\n"
         "uniform sampler2D texture1;\n"
         "uniform float pulsate;\n"
         "uniform float wobble;\n"
@@ -750,6 +1036,8 @@ void initDefaultPrograms() {
         "       diffuse = 1.0;\n"
         "   }\n"
         "	vec4 color = texture2D(texture0, texCoords.xy);\n"
+        "	color.a = clamp(dot(vec3(color.a, (color.r + color.g + color.b) / 3.0, max(max(color.r, color.g), color.b)), vec3(1.0 - opacityAdjust.z - opacityAdjust.w, opacityAdjust.zw)) * (1.0 + opacityAdjust.x) + opacityAdjust.y, 0.0, 1.0);\n"
+        "	color.rgb = mix(color.rgb, infravisionTint.rgb * ((color.r + color.g + color.b) / 3.0), infravisionTint.a);\n"
         "	intensity = clamp(intensity * diffuse, glow, 1.0);\n"
         "#ifdef GAMMA_CORRECTED_BLENDING\n"
         "	intensity = intensity * intensity; // approximation of pow(intensity, 2.2)\n"
@@ -760,6 +1048,8 @@ void initDefaultPrograms() {
     defaultVertexPrograms["bump_bloom"] = defaultVertexPrograms["bump"];
     defaultFragmentPrograms["bump_bloom"] = ""
         "uniform sampler2D texture0;\n"
+        "uniform vec4 opacityAdjust;\n"
+        "uniform vec4 infravisionTint;\n"
         "uniform sampler2D texture1;\n"
         "uniform float pulsate;\n"
         "uniform float wobble;\n"
@@ -792,6 +1082,8 @@ void initDefaultPrograms() {
         "       diffuse = 1.0;\n"
         "   }\n"
         "	vec4 color = texture2D(texture0, texCoords.xy);\n"
+        "	color.a = clamp(dot(vec3(color.a, (color.r + color.g + color.b) / 3.0, max(max(color.r, color.g), color.b)), vec3(1.0 - opacityAdjust.z - opacityAdjust.w, opacityAdjust.zw)) * (1.0 + opacityAdjust.x) + opacityAdjust.y, 0.0, 1.0);\n"
+        "	color.rgb = mix(color.rgb, infravisionTint.rgb * ((color.r + color.g + color.b) / 3.0), infravisionTint.a);\n"
         "	vec3 intensity = clamp(vertexColor.rgb, glow, 1.0);\n"
         "	intensity = clamp(intensity * bloomScale + bloomShift, 0.0, 1.0);\n"
         "#ifdef GAMMA_CORRECTED_BLENDING\n"
@@ -800,5 +1092,90 @@ void initDefaultPrograms() {
         "	float fogFactor = clamp(exp2(FDxLOG2E * length(viewDir)), 0.0, 1.0);\n"
         "	gl_FragColor = vec4(mix(vec3(0.0, 0.0, 0.0), color.rgb * intensity, fogFactor), vertexColor.a * color.a);\n"
         "}\n";
+
+    // The model shaders: the wall and sprite vertex programs, with each vertex
+    // carried by the skin matrices named in gl_MultiTexCoord2 (two matrix
+    // indices and a blend factor between them; see Model3D::FindSkinWeights())
+    std::string skinFunctions = ""
+        "uniform vec4 modelBones[96];	// 3 rows * Shader::MAX_SKIN_MATRICES\n"
+        "vec3 skinPoint(int i, vec4 p) {\n"
+        "	return vec3(dot(modelBones[i], p), dot(modelBones[i+1], p), dot(modelBones[i+2], p));\n"
+        "}\n"
+        "vec3 skinVector(int i, vec3 v) {\n"
+        "	return vec3(dot(modelBones[i].xyz, v), dot(modelBones[i+1].xyz, v), dot(modelBones[i+2].xyz, v));\n"
+        "}\n";
+    std::string skinVertex = ""
+        "	int b0 = 3 * int(gl_MultiTexCoord2.x + 0.5);\n"
+        "	int b1 = 3 * int(gl_MultiTexCoord2.y + 0.5);\n"
+        "	float blend = gl_MultiTexCoord2.z;\n"
+        "	vec4 vertex = vec4(mix(skinPoint(b0, gl_Vertex), skinPoint(b1, gl_Vertex), blend), 1.0);\n";
+
+    defaultVertexPrograms["model_wall"] = skinFunctions + ""
+        "uniform float depth;\n"
+        "varying vec3 viewXY;\n"
+        "varying vec3 viewDir;\n"
+        "varying vec4 vertexColor;\n"
+        "varying float FDxLOG2E;\n"
+        "varying float classicDepth;\n"
+        "void main(void) {\n"
+        + skinVertex +
+        "	vec3 normal = mix(skinVector(b0, gl_Normal), skinVector(b1, gl_Normal), blend);\n"
+        "	vec3 tangent = mix(skinVector(b0, gl_MultiTexCoord1.xyz), skinVector(b1, gl_MultiTexCoord1.xyz), blend);\n"
+        "	gl_Position  = gl_ModelViewProjectionMatrix * vertex;\n"
+        "	gl_Position.z = gl_Position.z + depth*gl_Position.z/65536.0;\n"
+        "	classicDepth = gl_Position.z / 8192.0;\n"
+        "#ifndef DISABLE_CLIP_VERTEX\n"
+        "	gl_ClipVertex = gl_ModelViewMatrix * vertex;\n"
+        "#endif\n"
+        "	gl_TexCoord[0] = gl_TextureMatrix[0] * gl_MultiTexCoord0;\n"
+        "	/* SETUP TBN MATRIX in normal matrix coords, gl_MultiTexCoord1 = tangent vector */\n"
+        "	vec3 n = normalize(gl_NormalMatrix * normal);\n"
+        "	vec3 t = normalize(gl_NormalMatrix * tangent);\n"
+        "	vec3 b = normalize(cross(n, t) * gl_MultiTexCoord1.w);\n"
+        "	/* (column wise) */\n"
+        "	mat3 tbnMatrix = mat3(t.x, b.x, n.x, t.y, b.y, n.y, t.z, b.z, n.z);\n"
+        "	\n"
+        "	/* SETUP VIEW DIRECTION in unprojected local coords */\n"
+        "	viewDir = tbnMatrix * (gl_ModelViewMatrix * vertex).xyz;\n"
+        "	viewXY = -(gl_TextureMatrix[0] * vec4(viewDir.xyz, 1.0)).xyz;\n"
+        "	viewDir = -viewDir;\n"
+        "	vertexColor = gl_Color;\n"
+        "	FDxLOG2E = -gl_Fog.density * 1.442695;\n"
+        "}\n";
+    defaultVertexPrograms["model_wall_bloom"] = defaultVertexPrograms["model_wall"];
+    defaultVertexPrograms["model_bump"] = defaultVertexPrograms["model_wall"];
+    defaultVertexPrograms["model_bump_bloom"] = defaultVertexPrograms["model_wall"];
+
+    defaultVertexPrograms["model_invincible"] = skinFunctions + ""
+        "uniform float depth;\n"
+        "uniform float strictDepthMode;\n"
+        "varying vec3 viewDir;\n"
+        "varying vec4 vertexColor;\n"
+        "varying float FDxLOG2E;\n"
+        "varying float classicDepth;\n"
+        "void main(void) {\n"
+        + skinVertex +
+        "	gl_Position = gl_ModelViewProjectionMatrix * vertex;\n"
+        "	classicDepth = gl_Position.z / 8192.0;\n"
+        "#ifndef DISABLE_CLIP_VERTEX\n"
+        "	gl_ClipVertex = gl_ModelViewMatrix * vertex;\n"
+        "#endif\n"
+        "	vec4 v = gl_ModelViewMatrixInverse * vec4(0.0, 0.0, 0.0, 1.0);\n"
+        "	viewDir = (vertex - v).xyz;\n"
+        "	gl_TexCoord[0] = gl_TextureMatrix[0] * gl_MultiTexCoord0;\n"
+        "	vertexColor = gl_Color;\n"
+        "	FDxLOG2E = -gl_Fog.density * 1.442695;\n"
+        "}\n";
+    defaultVertexPrograms["model_invincible_bloom"] = defaultVertexPrograms["model_invincible"];
+    defaultVertexPrograms["model_invisible"] = defaultVertexPrograms["model_invincible"];
+    defaultVertexPrograms["model_invisible_bloom"] = defaultVertexPrograms["model_invincible"];
+
+    const char *skinnedBases[] = {
+        "wall", "wall_bloom", "bump", "bump_bloom",
+        "invincible", "invincible_bloom", "invisible", "invisible_bloom"
+    };
+    for (size_t i = 0; i < sizeof(skinnedBases) / sizeof(skinnedBases[0]); ++i) {
+        defaultFragmentPrograms[std::string("model_") + skinnedBases[i]] = defaultFragmentPrograms[skinnedBases[i]];
+    }
 }
     
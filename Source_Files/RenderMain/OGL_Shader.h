@@ -60,6 +60,11 @@ public:
 		U_Pitch,
 		U_SelfLuminosity,
 		U_GammaAdjust,
+		U_InfravisionTint,
+		U_ModelBones,
+		U_OpacityAdjust,
+		U_FadeScale,
+		U_FadeOffset,
 		NUMBER_OF_UNIFORM_LOCATIONS
 	};
 
@@ -79,8 +84,20 @@ public:
 		S_Bump,
 		S_BumpBloom,
 		S_Gamma,
+		S_ModelWall,
+		S_ModelWallBloom,
+		S_ModelBump,
+		S_ModelBumpBloom,
+		S_ModelInvincible,
+		S_ModelInvincibleBloom,
+		S_ModelInvisible,
+		S_ModelInvisibleBloom,
+		S_FXAA,
 		NUMBER_OF_SHADER_TYPES
 	};
+
+	// How many 3x4 matrices the model shaders' U_ModelBones holds
+	enum { MAX_SKIN_MATRICES = 32 };
 private:
 
 	GLhandleARB _programObj;
@@ -88,6 +105,7 @@ private:
 	std::string _frag;
 	int16 _passes;
 	bool _loaded;
+	bool _default;	// both programs are the built-in ones
 
 	static const char* _shader_names[NUMBER_OF_SHADER_TYPES];
 	static std::vector<Shader> _shaders;
@@ -106,10 +124,14 @@ private:
 public:
 
 	static Shader* get(ShaderType type) { return &_shaders[type]; }
+
+	// The model-skinning counterpart of a wall, bump, invincible or invisible shader;
+	// NULL if there is none, or if MML has replaced only the original
+	static Shader* getSkinned(ShaderType type);
 	static void loadAll();
 	static void unloadAll();
 	
-	Shader() : _programObj(0), _passes(-1), _loaded(false) {}
+	Shader() : _programObj(0), _passes(-1), _loaded(false), _default(false) {}
 	Shader(const std::string& name);
 	Shader(const std::string& name, FileSpecifier& vert, FileSpecifier& frag, int16& passes);
 	~Shader();
@@ -119,8 +141,13 @@ public:
 	void enable();
 	void unload();
 	void setFloat(UniformName name, float); // shader must be enabled
+	void setVec4(UniformName name, const float *f, int count = 1);
 	void setMatrix4(UniformName name, float *f);
 
+	// Whether the fragment program mentions a uniform at all;
+	// lets MML-replaced shaders that predate it be detected
+	bool declares(UniformName name) const { return _frag.find(_uniform_names[name]) != std::string::npos; }
+
 	int16 passes();
 
 	static void disable();
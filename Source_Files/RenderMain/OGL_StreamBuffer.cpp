@@ -0,0 +1,101 @@
+/*
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	Streaming vertex buffer
+*/
+
+#include "cseries.h"
+#include "OGL_StreamBuffer.h"
+
+#ifdef HAVE_OPENGL
+
+#include "OGL_Setup.h"
+#include "FrameProfiler.h"
+
+// Storage is given out in pieces aligned to this
+const size_t kStreamAlignment = 16;
+const size_t kStreamSize = 1 << 20;
+
+static bool StreamChecked = false;
+static GLuint StreamBuffer = 0;
+static size_t StreamSize = 0;
+static size_t StreamOffset = 0;
+
+static bool StreamAvailable()
+{
+	if (!StreamChecked)
+	{
+		StreamChecked = true;
+		if (OGL_CheckExtension("GL_ARB_vertex_buffer_object"))
+			glGenBuffersARB(1, &StreamBuffer);
+		StreamSize = StreamOffset = 0;
+	}
+	return StreamBuffer != 0;
+}
+
+static size_t Aligned(size_t bytes)
+{
+	return (bytes + kStreamAlignment - 1) & ~(kStreamAlignment - 1);
+}
+
+void OGL_StreamReserve(size_t bytes, int arrays)
+{
+	if (!StreamAvailable()) return;
+
+	// Each array starts aligned
+	bytes = Aligned(bytes) + (arrays - 1) * kStreamAlignment;
+
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB, StreamBuffer);
+	if (StreamOffset + bytes > StreamSize)
+	{
+		// New storage; the driver keeps the old until the draws that read
+		// it are done, so nothing waits for them
+		StreamSize = MAX(kStreamSize, bytes);
+		glBufferDataARB(GL_ARRAY_BUFFER_ARB, StreamSize, NULL, GL_STREAM_DRAW_ARB);
+		StreamOffset = 0;
+	}
+}
+
+const GLvoid *OGL_StreamArray(const void *data, size_t bytes)
+{
+	if (!StreamAvailable()) return data;
+
+	OGL_StreamReserve(bytes);
+	glBufferSubDataARB(GL_ARRAY_BUFFER_ARB, StreamOffset, bytes, data);
+	const char *offset = NULL;
+	offset += StreamOffset;
+	StreamOffset += Aligned(bytes);
+	return offset;
+}
+
+void OGL_StreamDone(GLsizei vertex_count)
+{
+	if (StreamBuffer)
+		glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+	FrameProfiler::CountStreamedVertices(vertex_count);
+}
+
+void OGL_StopStream()
+{
+	if (StreamBuffer)
+		glDeleteBuffersARB(1, &StreamBuffer);
+	StreamBuffer = 0;
+	StreamChecked = false;
+}
+
+#endif // def HAVE_OPENGL
@@ -0,0 +1,51 @@
+#ifndef _OGL_STREAMBUFFER_
+#define _OGL_STREAMBUFFER_
+/*
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	Streaming vertex buffer: vertex arrays that are drawn once (the faders,
+	the 2D interface, the classic renderer's polygons) are copied into one
+	shared buffer object, given new storage whenever it fills up, rather
+	than read by the driver from client memory on each draw
+*/
+
+#include "cseries.h"
+
+#ifdef HAVE_OPENGL
+
+#include "OGL_Headers.h"
+
+// Makes room in the same storage for a draw that reads more than one
+// streamed array: this many, adding up to this many bytes
+void OGL_StreamReserve(size_t bytes, int arrays = 1);
+
+// Copies an array in and leaves the buffer bound; returns what to hand
+// gl*Pointer(), an offset into the buffer, or the data itself where the
+// driver has no buffer objects
+const GLvoid *OGL_StreamArray(const void *data, size_t bytes);
+
+// Unbinds the buffer once the arrays have been drawn, for what's drawn from
+// client memory afterwards, and counts the vertices streamed
+void OGL_StreamDone(GLsizei vertex_count);
+
+// Call while the OpenGL context the buffer belongs to still exists
+void OGL_StopStream();
+
+#endif // def HAVE_OPENGL
+
+#endif
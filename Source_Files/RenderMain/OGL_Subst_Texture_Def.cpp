@@ -44,10 +44,14 @@ typedef std::pair<short, short> TOKey;
 typedef boost::unordered_map<TOKey, OGL_TextureOptions> TOHash;
 static TOHash Collections[NUMBER_OF_COLLECTIONS];
 
+// Bumped whenever an option set is added or deleted, which can change what a lookup finds
+static uint32 TOGeneration = 1;
+
 // Deletes a collection's texture-options sequences
 void TODelete(short Collection)
 {
 	Collections[Collection].clear();
+	TOGeneration++;
 }
 
 // Deletes all of them
@@ -119,6 +123,11 @@ OGL_TextureOptions *OGL_GetTextureOptions(short Collection, short CLUT, short Bi
 	return &DefaultTextureOptions;
 }
 
+uint32 OGL_TextureOptionsGeneration()
+{
+	return TOGeneration;
+}
+
 
 void reset_mml_opengl_texture()
 {
@@ -181,6 +190,7 @@ void parse_mml_opengl_texture(const InfoTree& root)
 		{
 			Collections[coll][TOKey(actual_clut, bitmap)] = DefaultTextureOptions;
 			it = Collections[coll].find(TOKey(actual_clut, bitmap));
+			TOGeneration++;
 		}
 		
 		OGL_TextureOptions& def = it->second;
@@ -48,6 +48,9 @@ struct OGL_TextureOptions: public OGL_TextureOptionsBase
 // Get the texture options that are currently set
 OGL_TextureOptions *OGL_GetTextureOptions(short Collection, short CLUT, short Bitmap);
 
+// Changes whenever what OGL_GetTextureOptions() finds may have
+uint32 OGL_TextureOptionsGeneration();
+
 // for managing the texture loading and unloading;
 int OGL_CountTextures(short Collection);
 void OGL_LoadTextures(short Collection);
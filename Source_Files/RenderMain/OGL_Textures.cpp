@@ -73,6 +73,17 @@ Jan 25, 2002 (Br'fin (Jeremy Parsons)):
 May 3, 2003 (Br'fin (Jeremy Parsons))
 	Added LowLevelShape workaround for passing LowLevelShape info of sprites
 	instead of abusing/overflowing shape_descriptors
+
+Oct 14, 2026:
+	Added texture-binding tracking while the world is drawn, so that walls
+	and sprites sharing a texture no longer rebind it;
+	substitute textures needing opacity, infravision, silhouette or shrinking
+	passes are now prepared on background threads while the shapes bitmap
+	stands in for them;
+	uploaded bytes are counted, and the least recently used textures are dropped
+	when over the configured memory budget;
+	the shader renderer draws infravision and silhouette substitutes
+	from the normal texture, tinted in the shader, instead of making copies
 */
 
 #include <string.h>
@@ -80,6 +91,9 @@ May 3, 2003 (Br'fin (Jeremy Parsons))
 #include <stdarg.h>
 #include <math.h>
 #include <list>
+#include <deque>
+#include <vector>
+#include <algorithm>
 
 #include "cseries.h"
 
@@ -96,10 +110,12 @@ May 3, 2003 (Br'fin (Jeremy Parsons))
 #include "map.h"
 #include "collection_definition.h"
 #include "OGL_Blitter.h"
+#include "OGL_StreamBuffer.h"
 #include "OGL_Setup.h"
 #include "OGL_Render.h"
 #include "OGL_Textures.h"
 #include "screen.h"
+#include "FrameProfiler.h"
 
 using std::min;
 using std::max;
@@ -125,12 +141,6 @@ static bool useMirroredRepeat = false;
 // Infravision: use algorithm (red + green + blue)/3 to compose intensity,
 // then shade with these colors, one color for each collection.
 
-struct InfravisionData
-{
-	GLfloat Red, Green, Blue;	// Infravision tint components: 0 to 1
-	bool IsTinted;				// whether to use infravision with this collection
-};
-
 struct InfravisionData IVDataList[NUMBER_OF_COLLECTIONS] =
 {
 	{1,1,1,false},
@@ -170,8 +180,263 @@ struct InfravisionData IVDataList[NUMBER_OF_COLLECTIONS] =
 // Is infravision currently active?
 static bool InfravisionActive = false;
 
+// Low memory mode keeps at most this many MB, and lets go of unused textures this much sooner
+static const int LowMemoryTextureBudget = 64;
+static const int LowMemoryPatience = 4;
+
 static std::list<TextureState*> sgActiveTextureStates;
 
+// Uploaded bytes over all the texture states, and the frame count for their last uses
+static int64_t TotalTextureBytes = 0;
+static uint32 TextureFrame = 1;
+
+int64_t OGL_TextureBytesLoaded()
+{
+	return TotalTextureBytes;
+}
+
+// What is bound to the first few texture units, if known;
+// only tracked between OGL_TrackTextureBindings(true) and (false)
+const int MAXIMUM_TRACKED_TEXTURE_UNITS = 4;
+static bool TrackingBindings = false;
+static int ActiveUnit = NONE;
+static bool BindingKnown[MAXIMUM_TRACKED_TEXTURE_UNITS];
+static GLuint BoundTextureIDs[MAXIMUM_TRACKED_TEXTURE_UNITS];
+
+void OGL_TrackTextureBindings(bool Track)
+{
+	TrackingBindings = Track;
+	ActiveUnit = NONE;
+	objlist_clear(BindingKnown, MAXIMUM_TRACKED_TEXTURE_UNITS);
+
+	// Start from a known unit
+	if (Track)
+		OGL_ActiveTexture(GL_TEXTURE0_ARB);
+}
+
+void OGL_ActiveTexture(GLenum Unit)
+{
+	int Index = Unit - GL_TEXTURE0_ARB;
+	if (TrackingBindings && ActiveUnit != NONE && Index == ActiveUnit) return;
+	
+	glActiveTextureARB(Unit);
+	ActiveUnit = (TrackingBindings && Index >= 0 && Index < MAXIMUM_TRACKED_TEXTURE_UNITS) ? Index : NONE;
+}
+
+void OGL_BindTexture(GLuint TxtrID)
+{
+	if (ActiveUnit != NONE)
+	{
+		if (BindingKnown[ActiveUnit] && BoundTextureIDs[ActiveUnit] == TxtrID) return;
+		BindingKnown[ActiveUnit] = true;
+		BoundTextureIDs[ActiveUnit] = TxtrID;
+	}
+	FrameProfiler::CountTextureBind();
+	glBindTexture(GL_TEXTURE_2D,TxtrID);
+}
+
+void OGL_DeleteTextures(GLsizei Count, const GLuint *TxtrIDs)
+{
+	// Deleting a texture unbinds it from every unit, and its ID may be handed out again
+	for (int u=0; u<MAXIMUM_TRACKED_TEXTURE_UNITS; u++)
+		for (int k=0; k<Count; k++)
+			if (BindingKnown[u] && BoundTextureIDs[u] == TxtrIDs[k])
+				BoundTextureIDs[u] = 0;
+	glDeleteTextures(Count,TxtrIDs);
+}
+
+
+// Substitute textures whose opacity, infravision, silhouette or shrinking passes
+// would stall a frame are prepared on a few background threads instead.
+// The workers only ever touch the images in their job; the jobs and texture states
+// are otherwise handled on the main thread.
+struct SubstituteTextureJob
+{
+	TextureState *State;
+	
+	// Private copies of the substitute images, edited in place
+	ImageDescriptorManager NormalImage, GlowImage, OffsetImage;
+	
+	// What to do to them
+	OGL_TextureOptions Options;		// only the opacity settings are used
+	bool Opacity, Infravision, Silhouette;
+	InfravisionData IVData;
+	int MaxWidth, MaxHeight;
+	
+	// Set on the main thread once the job has come back from the workers
+	bool Done;
+};
+
+const int MAXIMUM_TEXTURE_WORKERS = 2;
+static int TextureWorkerCount = 0;
+static SDL_Thread *TextureWorkers[MAXIMUM_TEXTURE_WORKERS];
+static SDL_mutex *TextureJobLock = NULL;
+static SDL_sem *TextureJobsWaiting = NULL;
+static bool StopTextureWorkers = false;
+static std::deque<SubstituteTextureJob *> PendingTextureJobs, FinishedTextureJobs;
+
+static void ApplyInfravision(const InfravisionData& IVData, ImageDescriptorManager &imageManager);
+static void FindInfravisionVersionRGBA(const InfravisionData& IVData, int NumPixels, uint32 *Pixels);
+static void MinifyImages(ImageDescriptorManager &NormalImage, ImageDescriptorManager &GlowImage,
+	ImageDescriptorManager &OffsetImage, int MaxWidth, int MaxHeight);
+
+// Whether the opacity settings change anything
+static bool HasOpacityEdit(const OGL_TextureOptions& Options)
+{
+	return Options.OpacityType == OGL_OpacType_Avg || Options.OpacityType == OGL_OpacType_Max ||
+		Options.OpacityScale != 1.0 || Options.OpacityShift != 0.0;
+}
+
+// The slow steps of loading a substitute texture, in the order they have always been done
+static void PrepareSubstituteImages(OGL_TextureOptions& Options, bool Opacity, bool Infravision, const InfravisionData& IVData,
+	bool Silhouette, ImageDescriptorManager &NormalImage, ImageDescriptorManager &GlowImage,
+	ImageDescriptorManager &OffsetImage)
+{
+	// Use the Tomb Raider opacity hack if selected
+	if (Opacity)
+		SetPixelOpacities(Options, NormalImage);
+	
+	// Modify if infravision is active
+	if (Infravision)
+	{
+		ApplyInfravision(IVData, NormalImage);
+
+		// Infravision textures don't glow
+		GlowImage.set((ImageDescriptor *) NULL);
+		
+		// FIXME: bump maps don't load properly under infravision
+		OffsetImage.set((ImageDescriptor *) NULL);
+	}
+	else if (Silhouette)
+	{
+		FindSilhouetteVersion(NormalImage);
+		GlowImage.set((ImageDescriptor *) NULL);
+	}
+}
+
+static int TextureWorkerLoop(void *)
+{
+	while (true)
+	{
+		SDL_SemWait(TextureJobsWaiting);
+		
+		SDL_LockMutex(TextureJobLock);
+		if (StopTextureWorkers || PendingTextureJobs.empty())
+		{
+			SDL_UnlockMutex(TextureJobLock);
+			if (StopTextureWorkers) break;
+			continue;
+		}
+		SubstituteTextureJob *Job = PendingTextureJobs.front();
+		PendingTextureJobs.pop_front();
+		SDL_UnlockMutex(TextureJobLock);
+		
+		PrepareSubstituteImages(Job->Options, Job->Opacity, Job->Infravision, Job->IVData, Job->Silhouette,
+			Job->NormalImage, Job->GlowImage, Job->OffsetImage);
+		MinifyImages(Job->NormalImage, Job->GlowImage, Job->OffsetImage, Job->MaxWidth, Job->MaxHeight);
+		
+		SDL_LockMutex(TextureJobLock);
+		FinishedTextureJobs.push_back(Job);
+		SDL_UnlockMutex(TextureJobLock);
+	}
+	return 0;
+}
+
+// Start the workers the first time they are wanted; returns whether there are any
+static bool StartTextureWorkers()
+{
+	if (TextureWorkerCount > 0) return true;
+	if (StopTextureWorkers) return false;
+	
+	int Count = PIN(SDL_GetCPUCount() - 1, 1, MAXIMUM_TEXTURE_WORKERS);
+	if (!TextureJobLock) TextureJobLock = SDL_CreateMutex();
+	if (!TextureJobsWaiting) TextureJobsWaiting = SDL_CreateSemaphore(0);
+	if (!TextureJobLock || !TextureJobsWaiting) return false;
+	
+	while (TextureWorkerCount < Count)
+	{
+		SDL_Thread *Worker = SDL_CreateThread(TextureWorkerLoop, "OGL_Textures_worker", NULL);
+		if (!Worker) break;
+		TextureWorkers[TextureWorkerCount++] = Worker;
+	}
+	return TextureWorkerCount > 0;
+}
+
+// Wait for the workers to quit, and throw away every job that has not been picked up
+static void StopTextureJobs()
+{
+	if (TextureWorkerCount > 0)
+	{
+		SDL_LockMutex(TextureJobLock);
+		StopTextureWorkers = true;
+		SDL_UnlockMutex(TextureJobLock);
+		
+		for (int k=0; k<TextureWorkerCount; k++)
+			SDL_SemPost(TextureJobsWaiting);
+		for (int k=0; k<TextureWorkerCount; k++)
+			SDL_WaitThread(TextureWorkers[k], NULL);
+		TextureWorkerCount = 0;
+	}
+	
+	while (!PendingTextureJobs.empty())
+	{
+		SubstituteTextureJob *Job = PendingTextureJobs.front();
+		PendingTextureJobs.pop_front();
+		Job->State->Job = NULL;
+		delete Job;
+	}
+	while (!FinishedTextureJobs.empty())
+	{
+		SubstituteTextureJob *Job = FinishedTextureJobs.front();
+		FinishedTextureJobs.pop_front();
+		Job->State->Job = NULL;
+		delete Job;
+	}
+	
+	if (TextureJobsWaiting)
+	{
+		SDL_DestroySemaphore(TextureJobsWaiting);
+		TextureJobsWaiting = NULL;
+	}
+	StopTextureWorkers = false;
+}
+
+// Pick up what the workers have finished; the placeholders for them get dropped,
+// so the next use of each of those textures loads the prepared images
+static void CollectTextureJobs()
+{
+	if (TextureWorkerCount == 0) return;
+	
+	std::deque<SubstituteTextureJob *> Finished;
+	SDL_LockMutex(TextureJobLock);
+	Finished.swap(FinishedTextureJobs);
+	SDL_UnlockMutex(TextureJobLock);
+	
+	for (size_t k=0; k<Finished.size(); k++)
+	{
+		SubstituteTextureJob *Job = Finished[k];
+		Job->Done = true;
+		if (Job->State->IsUsed)
+			Job->State->Reset();
+	}
+}
+
+// Upload one level of a texture; returns the bytes uploaded
+static int UploadTextureLevel(GLint Level, GLenum InternalFormat, const ImageDescriptor *Image, bool Compressed)
+{
+	int Width = max(1, Image->GetWidth() >> Level);
+	int Height = max(1, Image->GetHeight() >> Level);
+	int Bytes = Image->GetMipMapSize(Level);
+	const GLvoid *Pixels = Image->GetMipMapPtr(Level);
+	
+	if (Compressed)
+		glCompressedTexImage2DARB(GL_TEXTURE_2D, Level, InternalFormat, Width, Height, 0, Bytes, Pixels);
+	else
+		glTexImage2D(GL_TEXTURE_2D, Level, InternalFormat, Width, Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, Pixels);
+	
+	return Bytes;
+}
+
 
 // Allocate some textures and indicate whether an allocation had happened.
 bool TextureState::Allocate(short txType)
@@ -192,14 +457,23 @@ bool TextureState::Allocate(short txType)
 // Use a texture and indicate whether to load it
 bool TextureState::Use(int Which)
 {
-	glBindTexture(GL_TEXTURE_2D,IDs[Which]);
+	OGL_BindTexture(IDs[Which]);
 	bool result = !TexGened[Which];
 	TexGened[Which] = true;
 	IDUsage[Which]++;
+	LastUsedFrame = TextureFrame;
 	return result;
 }
 
 
+TextureState::~TextureState()
+{
+	Reset();
+	
+	// Any job still around has come back from the workers
+	delete Job;
+}
+
 // Resets the object's texture state
 void TextureState::Reset()
 {
@@ -207,9 +481,11 @@ void TextureState::Reset()
 	{
 		sgActiveTextureStates.remove(this);
 		gGLTxStats.inUse--;
-		glDeleteTextures(NUMBER_OF_TEXTURES,IDs);
+		OGL_DeleteTextures(NUMBER_OF_TEXTURES,IDs);
+		TotalTextureBytes -= TextureBytes;
 	}
-	IsUsed = IsGlowing = IsBumped = TexGened[Normal] = TexGened[Glowing] = TexGened[Bump] = false;
+	TextureBytes = 0;
+	IsUsed = IsGlowing = IsBumped = ShaderOpacity = TexGened[Normal] = TexGened[Glowing] = TexGened[Bump] = false;
 	IDUsage[Normal] = IDUsage[Glowing] = IDUsage[Bump] = unusedFrames = 0;
 }
 
@@ -229,18 +505,19 @@ void TextureState::FrameTick() {
 	} else {
 		unusedFrames++;
 		assert(TextureType != NONE);
+		int Patience = environment_preferences->low_memory ? LowMemoryPatience : 1;
 		switch (TextureType) {
 		case OGL_Txtr_Wall:
-				if (unusedFrames > 300) Reset(); // at least 10 seconds till wall textures are released
+				if (unusedFrames > 300 / Patience) Reset(); // at least 10 seconds till wall textures are released
 				break;
 		case OGL_Txtr_Landscape:
 				// never release landscapes
 				break;
 		case OGL_Txtr_Inhabitant:
-				if (unusedFrames > 450) Reset(); // release unused sprites in 15 seconds
+				if (unusedFrames > 450 / Patience) Reset(); // release unused sprites in 15 seconds
 				break;
 		case OGL_Txtr_WeaponsInHand:
-				if (unusedFrames > 600) Reset(); // release weapons in hand in 20 seconds
+				if (unusedFrames > 600 / Patience) Reset(); // release weapons in hand in 20 seconds
 				break;
 		}
 	}
@@ -256,7 +533,7 @@ void FlatBumpTexture() {
 	if (flatBumpTextureID == 0)
 	{
 		glGenTextures(1, &flatBumpTextureID);
-		glBindTexture(GL_TEXTURE_2D, flatBumpTextureID);
+		OGL_BindTexture(flatBumpTextureID);
 		
 		GLubyte flatTextureData[4] = {0x80, 0x80, 0xFF, 0x80};
 		
@@ -268,7 +545,7 @@ void FlatBumpTexture() {
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, flatTextureData);
 	}
 	else
-		glBindTexture(GL_TEXTURE_2D, flatBumpTextureID);
+		OGL_BindTexture(flatBumpTextureID);
 }
 
 
@@ -378,6 +655,9 @@ void OGL_StartTextures()
 // Done with the texture accounting
 void OGL_StopTextures()
 {
+	// The workers may still be editing copies for some texture states
+	StopTextureJobs();
+	
 	// Clear the texture accounting
 	for (int it=0; it<OGL_NUMBER_OF_TEXTURE_TYPES; it++)
 		for (int ic=0; ic<MAXIMUM_COLLECTIONS; ic++)
@@ -385,22 +665,56 @@ void OGL_StopTextures()
 
 	// clear blitters and fonts
 	OGL_Blitter::StopTextures();
+	OGL_StopStream();
 	FontSpecifier::OGL_ResetFonts(false);
 	
-	glDeleteTextures(1, &flatBumpTextureID);
+	OGL_DeleteTextures(1, &flatBumpTextureID);
 	flatBumpTextureID = 0;
     
     // clear leftover infravision
     InfravisionActive = false;
 }
 
+static bool LeastRecentlyUsed(const TextureState *A, const TextureState *B)
+{
+	return A->LastUsedFrame < B->LastUsedFrame;
+}
+
+int OGL_TextureMemoryBudget()
+{
+	int Budget = Get_OGL_ConfigureData().TextureMemoryBudget;
+	if (environment_preferences->low_memory)
+		Budget = (Budget > 0) ? MIN(Budget, LowMemoryTextureBudget) : LowMemoryTextureBudget;
+	return Budget;
+}
+
 void OGL_FrameTickTextures()
 {
+	CollectTextureJobs();
+	
 	std::list<TextureState*>::iterator i;
 	
 	for (i=sgActiveTextureStates.begin() ; i!= sgActiveTextureStates.end() ; i++) {
 		(*i)->FrameTick();
 	}
+	
+	// Over budget: drop what has gone unused the longest,
+	// but never what was drawn this frame, nor landscapes
+	int64_t Budget = int64_t(OGL_TextureMemoryBudget()) << 20;
+	if (Budget > 0 && TotalTextureBytes > Budget)
+	{
+		std::vector<TextureState*> Candidates;
+		for (i=sgActiveTextureStates.begin() ; i!= sgActiveTextureStates.end() ; i++) {
+			if ((*i)->LastUsedFrame != TextureFrame && (*i)->TextureType != OGL_Txtr_Landscape)
+				Candidates.push_back(*i);
+		}
+		std::sort(Candidates.begin(), Candidates.end(), LeastRecentlyUsed);
+		
+		for (size_t k=0; k<Candidates.size() && TotalTextureBytes > Budget; k++)
+			Candidates[k]->Reset();
+	}
+	
+	TextureFrame++;
 }
 
 // Find an OpenGL-friendly color table from a Marathon shading table
@@ -482,6 +796,19 @@ short ModifyCLUT(short TransferMode, short CLUT)
 	It uses the transfer mode and the transfer data to work out
 	what transfer modes to use (invisibility is a special case of tinted)
 */
+// The options for one of a bitmap's color tables, looked up only once per change to the MML
+OGL_TextureOptions *TextureManager::GetTextureOptions(CollBitmapTextureState& CBTS, short ColorTable)
+{
+	TextureState& State = CBTS.CTStates[ColorTable];
+	uint32 Generation = OGL_TextureOptionsGeneration();
+	if (State.OptionsGeneration != Generation)
+	{
+		State.Options = OGL_GetTextureOptions(Collection,ColorTable,Bitmap);
+		State.OptionsGeneration = Generation;
+	}
+	return State.Options;
+}
+
 bool TextureManager::Setup()
 {
 
@@ -499,11 +826,25 @@ bool TextureManager::Setup()
 	if (CBTSList == NULL) return false;
 	CollBitmapTextureState& CBTS = CBTSList[Bitmap];
 	
+	// A substitute without its own infravision or silhouette version
+	// can share the normal one's texture, and have the shader tint it
+	ShaderTint = ShaderTint_None;
+	short BaseCTable = GET_COLLECTION_CLUT(CollColor);
+	if (ShaderTinting && CTable != BaseCTable && Texture && !(Texture->flags & _PATCHED_BIT))
+	{
+		OGL_TextureOptions *BaseOptsPtr = GetTextureOptions(CBTS,BaseCTable);
+		if (BaseOptsPtr->NormalImg.IsPresent() && BaseOptsPtr == GetTextureOptions(CBTS,CTable))
+		{
+			ShaderTint = IsInfravisionTable(CTable) ? ShaderTint_Infravision : ShaderTint_Silhouette;
+			CTable = BaseCTable;
+		}
+	}
+	
 	// Get the control info for this texture type:
 	TxtrTypeInfoData& TxtrTypeInfo = TxtrTypeInfoList[TextureType];
 	
 	// Get the rendering options for this texture:
-	TxtrOptsPtr = OGL_GetTextureOptions(Collection,CTable,Bitmap);
+	TxtrOptsPtr = GetTextureOptions(CBTS,CTable);
 	
 	// Get the texture-state info: per-color-table -- be sure to preserve this for later
 	// Set the texture ID, and load the texture if necessary
@@ -542,6 +883,7 @@ bool TextureManager::Setup()
 		}
 		
 		CTState.IsGlowing = IsGlowing;
+		CTState.ShaderOpacity = OpacityInShader;
 		
 		if (substitute && OffsetImage.get() && OffsetImage.get()->IsPresent()) {
 			CTState.IsBumped = true;
@@ -577,16 +919,7 @@ bool TextureManager::Setup()
 			LoadedHeight >>= 1;
 		}
 
-		while (NormalImage.get()->GetWidth() > MaxWidth || NormalImage.get()->GetHeight() > MaxHeight)
-		{
-			if (!NormalImage.edit()->Minify()) break;
-			if (GlowImage.get() && GlowImage.get()->IsPresent()) {
-				if (!GlowImage.edit()->Minify()) break;
-			}
-			if (OffsetImage.get() && OffsetImage.get()->IsPresent()) {
-				if (!OffsetImage.edit()->Minify()) break;
-			}			
-		}
+		MinifyImages(NormalImage, GlowImage, OffsetImage, MaxWidth, MaxHeight);
 		
 		// Kludge for making top and bottom look flat
 		/*
@@ -607,13 +940,46 @@ bool TextureManager::Setup()
 		
 		// Get glow state
 		IsGlowing = CTState.IsGlowing;
+		OpacityInShader = CTState.ShaderOpacity;
 	}
+	
+	// Neither infravision nor silhouettes glow
+	if (ShaderTint != ShaderTint_None) IsGlowing = false;
 		
 	// Done!!!
 	return true;
 }
 
 
+void TextureManager::GetOpacityAdjust(GLfloat *Adjust)
+{
+	if (OpacityInShader)
+	{
+		Adjust[0] = TxtrOptsPtr->OpacityScale - 1;
+		Adjust[1] = TxtrOptsPtr->OpacityShift;
+		Adjust[2] = (TxtrOptsPtr->OpacityType == OGL_OpacType_Avg) ? 1 : 0;
+		Adjust[3] = (TxtrOptsPtr->OpacityType == OGL_OpacType_Max) ? 1 : 0;
+	}
+	else
+		Adjust[0] = Adjust[1] = Adjust[2] = Adjust[3] = 0;
+}
+
+
+void TextureManager::GetInfravisionTint(GLfloat *Tint)
+{
+	const InfravisionData& IVData = IVDataList[Collection];
+	if (ShaderTint == ShaderTint_Infravision && InfravisionActive && IVData.IsTinted)
+	{
+		Tint[0] = IVData.Red;
+		Tint[1] = IVData.Green;
+		Tint[2] = IVData.Blue;
+		Tint[3] = 1;
+	}
+	else
+		Tint[0] = Tint[1] = Tint[2] = Tint[3] = 0;
+}
+
+
 inline bool WhetherTextureFix()
 {
 	OGL_ConfigureData& ConfigureData = Get_OGL_ConfigureData();
@@ -668,6 +1034,8 @@ bool TextureManager::LoadSubstituteTexture()
 	NormalImage.set(&TxtrOptsPtr->NormalImg);
 	GlowImage.set(&TxtrOptsPtr->GlowImg);
 	OffsetImage.set(&TxtrOptsPtr->OffsetImg);
+	
+	bool WasSubstituted = TxtrOptsPtr->Substitution;
 
 	int Width = NormalImg.GetWidth();
 	int Height = NormalImg.GetHeight();
@@ -730,28 +1098,121 @@ bool TextureManager::LoadSubstituteTexture()
 		break;
 	}
 	
-	// Use the Tomb Raider opacity hack if selected
-	SetPixelOpacities(*TxtrOptsPtr, NormalImage);
+	InfravisionData IVData = IVDataList[Collection];
+	if (!InfravisionActive) IVData.IsTinted = false;
 	
-	// Modify if infravision is active
-	if (IsInfravisionTable(CTable))
+	// Compressed images would have to be decompressed to change their opacity;
+	// the shader can do it instead, so they go up as loaded
+	int Format = NormalImg.GetFormat();
+	OpacityInShader = ShaderOpacity && HasOpacityEdit(*TxtrOptsPtr) &&
+		(Format == ImageDescriptor::DXTC1 || Format == ImageDescriptor::DXTC3 || Format == ImageDescriptor::DXTC5);
+	
+	TxtrTypeInfoData& TxtrTypeInfo = TxtrTypeInfoList[TextureType];
+	int MaxWidth = MAX(TxtrWidth >> TxtrTypeInfo.Resolution, 1);
+	int MaxHeight = MAX(TxtrHeight >> TxtrTypeInfo.Resolution, 1);
+	
+	// Draw the shapes bitmap while the workers prepare the substitute;
+	// if some other color table already shows the substitute, its texture
+	// matrix is the substitute's, so load this one right away instead
+	SubstituteTextureJob *Job = TxtrStatePtr->Job;
+	bool Placeholder = false;
+	if (Job)
 	{
-		FindInfravisionVersion(Collection, NormalImage);
-
-		// Infravision textures don't glow
-		GlowImage.set((ImageDescriptor *) NULL);
-		
-		// FIXME: bump maps don't load properly under infravision
-		OffsetImage.set((ImageDescriptor *) NULL);
+		if (Job->Done)
+		{
+			NormalImage.edit(Job->NormalImage.release());
+			if (Job->GlowImage.get())
+				GlowImage.edit(Job->GlowImage.release());
+			else
+				GlowImage.set((ImageDescriptor *) NULL);
+			if (Job->OffsetImage.get())
+				OffsetImage.edit(Job->OffsetImage.release());
+			else
+				OffsetImage.set((ImageDescriptor *) NULL);
+			
+			OpacityInShader = !Job->Opacity && HasOpacityEdit(*TxtrOptsPtr);
+			TxtrStatePtr->Job = NULL;
+			delete Job;
+			return true;
+		}
+		Placeholder = !WasSubstituted;
 	}
-	else if (IsSilhouetteTable(CTable))
+	else if (!WasSubstituted)
+		Placeholder = QueueSubstituteTexture(IVData, MaxWidth, MaxHeight);
+	
+	if (Placeholder)
 	{
-		FindSilhouetteVersion(NormalImage);
+		OpacityInShader = false;
+		TxtrOptsPtr->Substitution = false;
+		U_Scale = V_Scale = 1;
+		U_Offset = V_Offset = 0;
+		NormalImage.set((ImageDescriptor *) NULL);
 		GlowImage.set((ImageDescriptor *) NULL);
+		OffsetImage.set((ImageDescriptor *) NULL);
+		return false;
 	}
+	
+	PrepareSubstituteImages(*TxtrOptsPtr, !OpacityInShader, IsInfravisionTable(CTable), IVData, IsSilhouetteTable(CTable),
+		NormalImage, GlowImage, OffsetImage);
+	return true;
+}
+
+// Hands the substitute images to the workers if preparing them would take a while;
+// returns whether it did
+bool TextureManager::QueueSubstituteTexture(const InfravisionData& IVData, int MaxWidth, int MaxHeight)
+{
+	const ImageDescriptor *Normal = NormalImage.get();
+	bool Opacity = HasOpacityEdit(*TxtrOptsPtr) && !OpacityInShader;
+	bool Infravision = IsInfravisionTable(CTable);
+	bool Silhouette = IsSilhouetteTable(CTable);
+	bool Shrink = Normal->GetWidth() > MaxWidth || Normal->GetHeight() > MaxHeight;
+	if (!Opacity && !(Infravision && IVData.IsTinted) && !(Silhouette && !Infravision) && !Shrink)
+		return false;
+	
+	if (!StartTextureWorkers()) return false;
+	
+	SubstituteTextureJob *Job = new SubstituteTextureJob;
+	Job->State = TxtrStatePtr;
+	Job->NormalImage.edit(new ImageDescriptor(*Normal));
+	if (GlowImage.get() && GlowImage.get()->IsPresent())
+		Job->GlowImage.edit(new ImageDescriptor(*GlowImage.get()));
+	if (OffsetImage.get() && OffsetImage.get()->IsPresent())
+		Job->OffsetImage.edit(new ImageDescriptor(*OffsetImage.get()));
+	Job->Options.OpacityType = TxtrOptsPtr->OpacityType;
+	Job->Options.OpacityScale = TxtrOptsPtr->OpacityScale;
+	Job->Options.OpacityShift = TxtrOptsPtr->OpacityShift;
+	Job->Opacity = Opacity;
+	Job->Infravision = Infravision;
+	Job->Silhouette = Silhouette;
+	Job->IVData = IVData;
+	Job->MaxWidth = MaxWidth;
+	Job->MaxHeight = MaxHeight;
+	Job->Done = false;
+	TxtrStatePtr->Job = Job;
+	
+	SDL_LockMutex(TextureJobLock);
+	PendingTextureJobs.push_back(Job);
+	SDL_UnlockMutex(TextureJobLock);
+	SDL_SemPost(TextureJobsWaiting);
 	return true;
 }
 
+// Shrink the images in step until they fit
+static void MinifyImages(ImageDescriptorManager &NormalImage, ImageDescriptorManager &GlowImage,
+	ImageDescriptorManager &OffsetImage, int MaxWidth, int MaxHeight)
+{
+	while (NormalImage.get()->GetWidth() > MaxWidth || NormalImage.get()->GetHeight() > MaxHeight)
+	{
+		if (!NormalImage.edit()->Minify()) break;
+		if (GlowImage.get() && GlowImage.get()->IsPresent()) {
+			if (!GlowImage.edit()->Minify()) break;
+		}
+		if (OffsetImage.get() && OffsetImage.get()->IsPresent()) {
+			if (!OffsetImage.edit()->Minify()) break;
+		}			
+	}
+}
+
 bool TextureManager::SetupTextureGeometry()
 {	
 	// How many rows (scanlines) and columns
@@ -1214,6 +1675,7 @@ void TextureManager::PlaceTexture(const ImageDescriptor *Image, bool normal_map)
 {
 
 	bool mipmapsLoaded = false;
+	int UploadedBytes = 0;
 
 	TxtrTypeInfoData& TxtrTypeInfo = TxtrTypeInfoList[TextureType];
 
@@ -1280,7 +1742,7 @@ void TextureManager::PlaceTexture(const ImageDescriptor *Image, bool normal_map)
 		{
 		case GL_NEAREST:
 		case GL_LINEAR:
-			glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, Image->GetWidth(), Image->GetHeight(), 0, GL_RGBA, GL_UNSIGNED_BYTE, Image->GetBuffer());
+			UploadedBytes += UploadTextureLevel(0, internalFormat, Image, false);
 			break;
 		case GL_NEAREST_MIPMAP_NEAREST:
 		case GL_LINEAR_MIPMAP_NEAREST:
@@ -1294,18 +1756,19 @@ void TextureManager::PlaceTexture(const ImageDescriptor *Image, bool normal_map)
 #endif
 				int i = 0;
 				for (i = 0; i < Image->GetMipMapCount(); i++) {
-					glTexImage2D(GL_TEXTURE_2D, i, internalFormat, max(1, Image->GetWidth() >> i), max(1, Image->GetHeight() >> i), 0, GL_RGBA, GL_UNSIGNED_BYTE, Image->GetMipMapPtr(i));
+					UploadedBytes += UploadTextureLevel(i, internalFormat, Image, false);
 				}
 				mipmapsLoaded = true;
 			} else {
 #ifdef GL_SGIS_generate_mipmap
 			if (useSGISMipmaps) {
 				glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP_SGIS, GL_TRUE);
-				glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, Image->GetWidth(), Image->GetHeight(), 0, GL_RGBA, GL_UNSIGNED_BYTE, Image->GetBuffer());
+				UploadedBytes += UploadTextureLevel(0, internalFormat, Image, false);
 			} else 
 #endif
 			{
 				gluBuild2DMipmaps(GL_TEXTURE_2D, internalFormat, Image->GetWidth(), Image->GetHeight(), GL_RGBA, GL_UNSIGNED_BYTE, Image->GetBuffer());
+				UploadedBytes += Image->GetMipMapSize(0);
 			}
 			mipmapsLoaded = true;
 			}
@@ -1329,7 +1792,7 @@ void TextureManager::PlaceTexture(const ImageDescriptor *Image, bool normal_map)
 		{
 		case GL_NEAREST:
 		case GL_LINEAR:
-			glCompressedTexImage2DARB(GL_TEXTURE_2D, 0, internalFormat, Image->GetWidth(), Image->GetHeight(), 0, Image->GetMipMapSize(0), Image->GetBuffer());
+			UploadedBytes += UploadTextureLevel(0, internalFormat, Image, true);
 			break;
 		case GL_NEAREST_MIPMAP_NEAREST:
 		case GL_LINEAR_MIPMAP_NEAREST:
@@ -1343,7 +1806,7 @@ void TextureManager::PlaceTexture(const ImageDescriptor *Image, bool normal_map)
 #endif
 				int i = 0;
 				for (i = 0; i < Image->GetMipMapCount(); i++) {
-					glCompressedTexImage2DARB(GL_TEXTURE_2D, i, internalFormat, max(1, Image->GetWidth() >> i), max(1, Image->GetHeight() >> i), 0, Image->GetMipMapSize(i), Image->GetMipMapPtr(i));
+					UploadedBytes += UploadTextureLevel(i, internalFormat, Image, true);
 				}
 				mipmapsLoaded = true;
 			} else {
@@ -1353,7 +1816,7 @@ void TextureManager::PlaceTexture(const ImageDescriptor *Image, bool normal_map)
 					mipmapsLoaded = true;
 				}  
 #endif
-				glCompressedTexImage2DARB(GL_TEXTURE_2D, 0, internalFormat, Image->GetWidth(), Image->GetHeight(), 0, Image->GetMipMapSize(0), Image->GetBuffer());
+				UploadedBytes += UploadTextureLevel(0, internalFormat, Image, true);
 			}
 			break;
 			
@@ -1366,6 +1829,12 @@ void TextureManager::PlaceTexture(const ImageDescriptor *Image, bool normal_map)
 #endif
 	}
 	
+	// Mipmaps made by OpenGL add about a third
+	if (mipmapsLoaded && Image->GetMipMapCount() <= 1)
+		UploadedBytes += UploadedBytes / 3;
+	TxtrStatePtr->TextureBytes += UploadedBytes;
+	TotalTextureBytes += UploadedBytes;
+	
 	// Set texture-mapping features
 	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, TxtrTypeInfo.NearFilter);
@@ -1555,6 +2024,10 @@ TextureManager::TextureManager()
 	TxtrOptsPtr = 0;
 
 	FastPath = 0;
+	ShaderTinting = false;
+	ShaderTint = ShaderTint_None;
+	ShaderOpacity = false;
+	OpacityInShader = false;
 	
 	LowLevelShape = 0;
 	
@@ -1599,8 +2072,9 @@ void OGL_ResetTextures()
 	
 	// Reset blitters
 	OGL_Blitter::StopTextures();
+	OGL_StopStream();
 
-	glDeleteTextures(1, &flatBumpTextureID);
+	OGL_DeleteTextures(1, &flatBumpTextureID);
 	flatBumpTextureID = 0;
 }
 
@@ -1670,7 +2144,7 @@ void LoadModelSkin(ImageDescriptor& SkinImage, short Collection, short CLUT)
 				int i = 0;
 				for (i = 0; i < Image.get()->GetMipMapCount(); i++) 
 				{
-					glTexImage2D(GL_TEXTURE_2D, i, internalFormat, max(1, Image.get()->GetWidth() >> i), max(1, Image.get()->GetHeight() >> i), 0, GL_RGBA, GL_UNSIGNED_BYTE, Image.get()->GetMipMapPtr(i));
+					UploadTextureLevel(i, internalFormat, Image.get(), false);
 				}
 				mipmapsLoaded = true;
 			}
@@ -1680,7 +2154,7 @@ void LoadModelSkin(ImageDescriptor& SkinImage, short Collection, short CLUT)
 				if (useSGISMipmaps)
 				{
 					glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP_SGIS, GL_TRUE);
-					glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, Image.get()->GetWidth(), Image.get()->GetHeight(), 0, GL_RGBA, GL_UNSIGNED_BYTE, Image.get()->GetBuffer());
+					UploadTextureLevel(0, internalFormat, Image.get(), false);
 				}
 				else
 #endif
@@ -1713,7 +2187,7 @@ void LoadModelSkin(ImageDescriptor& SkinImage, short Collection, short CLUT)
 		{
 		case GL_NEAREST:
 		case GL_LINEAR:
-			glCompressedTexImage2DARB(GL_TEXTURE_2D, 0, internalFormat, Image.get()->GetWidth(), Image.get()->GetHeight(), 0, Image.get()->GetMipMapSize(0), Image.get()->GetBuffer());
+			UploadTextureLevel(0, internalFormat, Image.get(), true);
 			break;
 		case GL_NEAREST_MIPMAP_NEAREST:
 		case GL_LINEAR_MIPMAP_NEAREST:
@@ -1730,7 +2204,7 @@ void LoadModelSkin(ImageDescriptor& SkinImage, short Collection, short CLUT)
 				int i = 0;
 				for (i = 0; i < Image.get()->GetMipMapCount(); i++)
 				{
-					glCompressedTexImage2DARB(GL_TEXTURE_2D, i, internalFormat, max(1, Image.get()->GetWidth() >> i), max(1, Image.get()->GetHeight() >> i), 0, Image.get()->GetMipMapSize(i), Image.get()->GetMipMapPtr(i));
+					UploadTextureLevel(i, internalFormat, Image.get(), true);
 				}
 				mipmapsLoaded = true;
 			}
@@ -1743,7 +2217,7 @@ void LoadModelSkin(ImageDescriptor& SkinImage, short Collection, short CLUT)
 					mipmapsLoaded = true;
 				}
 #endif
-				glCompressedTexImage2DARB(GL_TEXTURE_2D, 0, internalFormat, Image.get()->GetWidth(), Image.get()->GetHeight(), 0, Image.get()->GetMipMapSize(0), Image.get()->GetBuffer());
+				UploadTextureLevel(0, internalFormat, Image.get(), true);
 			}
 			break;
 
@@ -1820,6 +2294,11 @@ void FindInfravisionVersionRGBA(short Collection, int NumPixels, uint32 *Pixels)
 	InfravisionData& IVData = IVDataList[Collection];
 	if (!IVData.IsTinted) return;
 	
+	FindInfravisionVersionRGBA(IVData, NumPixels, Pixels);
+}
+
+static void FindInfravisionVersionRGBA(const InfravisionData& IVData, int NumPixels, uint32 *Pixels)
+{
 	// OK to use marching-pointer optimization here;
 	// the float-to-int and int-to-float conversions have been simplified,
 	// because the infravision-value-finding does not care if the values
@@ -1845,7 +2324,7 @@ static inline uint16 FindInfravisionVersionDXTCColor(SDL_Color tint, uint16 colo
 	return (r << 11) | (g << 6) | (g > 15 ? 0x20 : 0) | b;
 }
 
-void FindInfravisionVersionDXTC1(InfravisionData& IVData, int NumBytes, unsigned char *buffer)
+void FindInfravisionVersionDXTC1(const InfravisionData& IVData, int NumBytes, unsigned char *buffer)
 {
 	assert(NumBytes % 8 == 0);
 
@@ -1888,7 +2367,7 @@ void FindInfravisionVersionDXTC1(InfravisionData& IVData, int NumBytes, unsigned
 	}
 }
 
-void FindInfavisionVersionDXTC35(InfravisionData &IVData, int NumBytes, unsigned char *buffer)
+void FindInfavisionVersionDXTC35(const InfravisionData &IVData, int NumBytes, unsigned char *buffer)
 {
 	assert(NumBytes % 16 == 0);
 
@@ -1915,14 +2394,18 @@ void FindInfavisionVersionDXTC35(InfravisionData &IVData, int NumBytes, unsigned
 void FindInfravisionVersion(short Collection, ImageDescriptorManager &imageManager)
 {
 	if (!InfravisionActive) return;
-	InfravisionData& IVData = IVDataList[Collection];
+	ApplyInfravision(IVDataList[Collection], imageManager);
+}
+
+static void ApplyInfravision(const InfravisionData& IVData, ImageDescriptorManager &imageManager)
+{
 	if (!IVData.IsTinted) return;
 
 	if (!imageManager.get() || !imageManager.get()->IsPresent())
 		return;
 
 	if (imageManager.get()->GetFormat() == ImageDescriptor::RGBA8) {
-		FindInfravisionVersionRGBA(Collection, imageManager.edit()->GetBufferSize() / 4, imageManager.edit()->GetBuffer());
+		FindInfravisionVersionRGBA(IVData, imageManager.edit()->GetBufferSize() / 4, imageManager.edit()->GetBuffer());
 	} else if (imageManager.get()->GetFormat() == ImageDescriptor::DXTC1) {
 		FindInfravisionVersionDXTC1(IVData, imageManager.edit()->GetBufferSize(), (unsigned char *) imageManager.edit()->GetBuffer());
 	} else if (imageManager.get()->GetFormat() == ImageDescriptor::DXTC3 || imageManager.get()->GetFormat() == ImageDescriptor::DXTC5) {
@@ -2071,7 +2554,7 @@ void SetPixelOpacitiesDXTC5(OGL_TextureOptions& Options, int NumBytes, unsigned
 
 void SetPixelOpacities(OGL_TextureOptions& Options, ImageDescriptorManager &imageManager)
 {
-	if (Options.OpacityType != OGL_OpacType_Avg && Options.OpacityType != OGL_OpacType_Max && Options.OpacityScale == 1.0 && Options.OpacityShift == 0.0)
+	if (!HasOpacityEdit(Options))
 		return;
 
 	if (imageManager.get()->GetFormat() == ImageDescriptor::RGBA8) {
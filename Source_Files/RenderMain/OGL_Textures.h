@@ -44,9 +44,26 @@ void OGL_StartTextures();
 // Done with the texture accounting
 void OGL_StopTextures();
 
-// Call this after every frame for housekeeping stuff
+// Call this after every frame for housekeeping stuff;
+// it also drops the least recently used textures when over the memory budget
 void OGL_FrameTickTextures();
 
+// How many bytes of wall, landscape and sprite textures have been uploaded
+int64_t OGL_TextureBytesLoaded();
+// In MB, 0 for no limit: what's configured, or less in low memory mode
+int OGL_TextureMemoryBudget();
+
+// While the world is being drawn, remember which 2D texture is bound to each
+// texture unit, so that binding it again can be skipped;
+// anything else that binds textures in that time must go through these
+void OGL_TrackTextureBindings(bool Track);
+void OGL_ActiveTexture(GLenum Unit);
+void OGL_BindTexture(GLuint TxtrID);
+void OGL_DeleteTextures(GLsizei Count, const GLuint *TxtrIDs);
+
+// Substitute texture being prepared by a background thread
+struct SubstituteTextureJob;
+
 // State of an individual texture set:
 struct TextureState
 {
@@ -62,18 +79,24 @@ struct TextureState
 	bool IsUsed;						// Is the texture set being used?
 	bool IsGlowing;						// Does the texture have a glow map?
 	bool IsBumped;						// Does the texture have a bump map?
+	bool ShaderOpacity;					// Is its opacity adjusted by the shader?
 	bool TexGened[NUMBER_OF_TEXTURES];	// Which ID's have had their textures generated?
 	int IDUsage[NUMBER_OF_TEXTURES];	// Which ID's are being used?  Reset every frame.
 	int unusedFrames;					// How many frames have passed since we were last used.
 	short TextureType;
+	SubstituteTextureJob *Job;			// Substitute being prepared for this set, if any
+	int TextureBytes;					// How much has been uploaded for this set
+	uint32 LastUsedFrame;				// When this set was last drawn, for eviction
+	OGL_TextureOptions *Options;		// This set's options, as found when
+	uint32 OptionsGeneration;			// OGL_TextureOptionsGeneration() was this
     
     GLdouble U_Scale;
     GLdouble V_Scale;
     GLdouble U_Offset;
     GLdouble V_Offset;
 	
-	TextureState() {IsUsed = false; Reset(); TextureType = NONE; U_Scale = V_Scale = 1; U_Offset = V_Offset = 0;}
-	~TextureState() {Reset();}
+	TextureState() {IsUsed = false; Reset(); TextureType = NONE; Job = NULL; LastUsedFrame = 0; Options = NULL; OptionsGeneration = 0; U_Scale = V_Scale = 1; U_Offset = V_Offset = 0;}
+	~TextureState();
 	
 	// Allocate some textures and indicate whether an allocation had happened.
 	bool Allocate(short txType);
@@ -110,6 +133,14 @@ struct CollBitmapTextureState
 };
 
 
+// Infravision tint for a shapes collection
+struct InfravisionData
+{
+	GLfloat Red, Green, Blue;	// Infravision tint components: 0 to 1
+	bool IsTinted;				// whether to use infravision with this collection
+};
+
+
 // Modify color-table index if necessary;
 // makes it the infravision or silhouette one if necessary
 short ModifyCLUT(short TransferMode, short CLUT);
@@ -139,6 +170,19 @@ class TextureManager
 
 	// Info transmitted from the setting-up phase
 	bool IsGlowing;
+
+	// Which look the shader has to give the normal texture, if any
+	enum
+	{
+		ShaderTint_None,
+		ShaderTint_Infravision,
+		ShaderTint_Silhouette
+	};
+	short ShaderTint;
+	
+	// Whether the normal texture was left compressed, for the shader
+	// to adjust its opacity
+	bool OpacityInShader;
 			
 	// Width and height and whether to do RLE
 	// These are, in order, for the original texture, for the OpenGL texture,
@@ -170,7 +214,13 @@ class TextureManager
 	
 	// This one tries to load substitute textures into NormalBuffer and GlowBuffer;
 	// it returns whether such textures were loaded.
+	// Substitutes needing slow preparation are handed to a background thread,
+	// and the shapes bitmap stands in for them until they are ready.
 	bool LoadSubstituteTexture();
+	bool QueueSubstituteTexture(const InfravisionData& IVData, int MaxWidth, int MaxHeight);
+	
+	// The texture options for the bitmap in one of its color tables
+	OGL_TextureOptions *GetTextureOptions(CollBitmapTextureState& CBTS, short ColorTable);
 	
 	// This one finds the width, height, etc. of a texture type;
 	// it returns "false" if some texture's dimensions do not fit.
@@ -208,6 +258,14 @@ public:
 	bool LandscapeVertRepeat;
 
 	bool FastPath;
+
+	// The shader can do infravision and silhouettes itself,
+	// so substitute textures need not be copied for them
+	bool ShaderTinting;
+	
+	// The shader can adjust opacity itself, so compressed substitute
+	// textures need not be decompressed for it
+	bool ShaderOpacity;
 	
 	// The width of a landscape texture will be 2^(-Landscape_AspRatExp) * (the height)
 	short Landscape_AspRatExp;
@@ -238,6 +296,14 @@ public:
 	float GlowBloomScale() {return (TxtrOptsPtr->GlowBloomScale);}
 	float GlowBloomShift() {return (TxtrOptsPtr->GlowBloomShift);}
 	float LandscapeBloom() {return (TxtrOptsPtr->LandscapeBloom);}
+
+	// Infravision tint for the shader: color, and 1 in the last component
+	// if it is to be applied; all zero otherwise
+	void GetInfravisionTint(GLfloat *Tint);
+	
+	// Opacity adjustment for the shader: scale minus 1, shift, and the
+	// weights of the color average and maximum; all zero for none
+	void GetOpacityAdjust(GLfloat *Adjust);
 	
 	// Scaling and offset of the current texture;
 	// important for sprites, which will be padded to make them OpenGL-friendly.
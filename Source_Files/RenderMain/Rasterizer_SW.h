@@ -22,12 +22,54 @@
 	Rasterizer software impementation (plugs into scottish_textures files)
 	by Loren Petrich,
 	August 7, 2000
-	
+
+Oct 14, 2026:
+	Added drawing in vertical screen strips on several threads at once
+	Queued calls that later opaque ones paint over entirely are skipped
+	Shading tables blended between compact 32-bit ones are kept per strip
 */
 
+#include <vector>
 #include "Rasterizer.h"
 
 
+// Scratch storage for the texture mappers, and the screen columns [x0, x1)
+// they may write to; every rendering thread has its own
+enum { SW_LANDSCAPE_KEY_LENGTH = 9 };
+enum
+{
+	SW_BLEND_SOURCE_COUNT = 8,	// collection shading tables blended from at once
+	SW_BLEND_BLOCK_LENGTH = 16	// blended tables per allocation
+};
+
+// The blended tables made from one collection's compact 32-bit ones
+struct sw_blend_source
+{
+	void *shading_tables;
+	short tables[FULL_SHADING_TABLES32]; // the pool's table for each level, or NONE
+};
+
+struct sw_texture_strip
+{
+	short x0, x1;
+	short *scratch_table0, *scratch_table1;
+	void *precalculation_table;
+	
+	// The landscape row of each screen row (from landscape_first_row on) for
+	// the last landscape drawn, and what those depend on
+	std::vector<short> landscape_rows;
+	int32 landscape_first_row;
+	int32 landscape_key[SW_LANDSCAPE_KEY_LENGTH];
+	
+	// This frame's blended shading tables; the pool's blocks never move, so a
+	// call's tables stay put while it draws
+	sw_blend_source blend_sources[SW_BLEND_SOURCE_COUNT];
+	short blend_source_count, blend_source_last;
+	short blend_table_count;
+	std::vector<pixel32 *> blend_blocks;
+};
+
+
 class Rasterizer_SW_Class: public RasterizerClass
 {
 public:
@@ -49,6 +91,59 @@ public:
 	void texture_vertical_polygon(polygon_definition& textured_polygon);
 	
 	void texture_rectangle(rectangle_definition& textured_rectangle);
+	
+	// The calls between these are queued; End() drops what later opaque surfaces
+	// paint over entirely, and draws the rest with each thread doing its own strip
+	void Begin();
+	void End();
+	
+	Rasterizer_SW_Class(): view(NULL), screen(NULL), QueueCalls(false), StripWidth(1) {}
+	
+	// Draws the queued calls into one strip
+	void draw_queued_calls(sw_texture_strip& strip);
+
+private:
+	void texture_horizontal_polygon(polygon_definition& textured_polygon, sw_texture_strip& strip);
+	void texture_vertical_polygon(polygon_definition& textured_polygon, sw_texture_strip& strip);
+	void texture_rectangle(rectangle_definition& textured_rectangle, sw_texture_strip& strip);
+	
+	enum
+	{
+		_queued_horizontal_polygon,
+		_queued_vertical_polygon,
+		_queued_rectangle
+	};
+	
+	struct queued_call
+	{
+		int16 type;
+		int32 index; // into QueuedPolygons or QueuedRectangles
+		uint32 covered_strips; // bit i: nothing drawn in strip i will survive
+	};
+	
+	// Going from the last call to the first, gathers in each screen column the rows
+	// that opaque calls will have painted over, and marks the strips in which each
+	// call draws only rows that are painted over after it
+	void find_covered_calls(int strip_count);
+	
+	// The rows of one column that a call may draw to (outer)
+	// and that it is sure to draw to, if it is opaque (inner)
+	struct column_span
+	{
+		short outer_top, outer_bottom;
+		short inner_top, inner_bottom;
+	};
+	bool find_polygon_spans(const polygon_definition& polygon, short& x0, short& x1);
+	
+	bool QueueCalls;
+	int StripWidth;
+	std::vector<queued_call> QueuedCalls;
+	std::vector<polygon_definition> QueuedPolygons;
+	std::vector<rectangle_definition> QueuedRectangles;
+	
+	std::vector<short> CoveredTop, CoveredBottom; // rows [top, bottom) of each column
+	std::vector<short> SampleTop, SampleBottom; // of a polygon, where it crosses each column's left edge
+	std::vector<column_span> Spans; // of a polygon, from its left column on
 };
 
 
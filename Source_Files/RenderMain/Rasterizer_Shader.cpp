@@ -25,6 +25,7 @@
 #include "preferences.h"
 #include "fades.h"
 #include "screen.h"
+#include "FrameProfiler.h"
 
 #define MAXIMUM_VERTICES_PER_WORLD_POLYGON (MAXIMUM_VERTICES_PER_POLYGON+4)
 
@@ -45,14 +46,60 @@ const GLdouble kViewBaseMatrixInverse[16] = {
 Rasterizer_Shader_Class::Rasterizer_Shader_Class() = default;
 Rasterizer_Shader_Class::~Rasterizer_Shader_Class() = default;
 
+// Frames to wait after a change of resolution, for the frame times
+// (read a few frames late, and smoothed) to catch up with it
+const short kFramesBetweenResolutionSteps = 30;
+
+short Rasterizer_Shader_Class::NextResolutionStep()
+{
+	static const double kTargetFrameRates[NUMBER_OF_DYNAMIC_RESOLUTION_TARGETS] = { 0, 30, 60, 120 };
+	
+	int target = PIN(Get_OGL_ConfigureData().DynamicResolution, 0, NUMBER_OF_DYNAMIC_RESOLUTION_TARGETS - 1);
+	FrameProfiler *profiler = FrameProfiler::instance();
+	profiler->KeepTiming(target != OGL_DynamicResolution_Off);
+	if (target == OGL_DynamicResolution_Off)
+		return RESOLUTION_STEPS;
+	
+	if (++frames_at_step < kFramesBetweenResolutionSteps)
+		return resolution_step;
+	
+	// The GPU's time if it can be had; otherwise the CPU's
+	double frame_time = profiler->GPUTime(FrameProfiler::FRAME);
+	if (frame_time < 0)
+		frame_time = profiler->CPUTime(FrameProfiler::FRAME);
+	if (frame_time < 0)
+		return resolution_step;
+	
+	double budget = 1000.0 / kTargetFrameRates[target];
+	if (frame_time > 0.95 * budget)
+		return MAX(resolution_step - 1, MINIMUM_RESOLUTION_STEP);
+	
+	// Go up only if the frame, taken to cost as much more as the
+	// world view's area grows, still fits with room to spare
+	if (resolution_step < RESOLUTION_STEPS)
+	{
+		double growth = (resolution_step + 1) / double(resolution_step);
+		if (frame_time * growth * growth < 0.85 * budget)
+			return resolution_step + 1;
+	}
+	return resolution_step;
+}
+
 void Rasterizer_Shader_Class::SetView(view_data& view) {
 	OGL_SetView(view);
 	
-	if (view.screen_width != view_width || view.screen_height != view_height) {
+	short step = NextResolutionStep();
+	if (view.screen_width != view_width || view.screen_height != view_height || step != resolution_step) {
 		view_width = view.screen_width;
 		view_height = view.screen_height;
+		resolution_step = step;
+		frames_at_step = 0;
+		
+		// The FBO is drawn stretched over the view, so only the world
+		// view loses resolution; the HUD and terminals are drawn after it
+		float scale = MainScreenPixelScale() * resolution_step / float(RESOLUTION_STEPS);
 		swapper.reset();
-		swapper.reset(new FBOSwapper(view_width * MainScreenPixelScale(), view_height * MainScreenPixelScale(), false));
+		swapper.reset(new FBOSwapper(MAX(1, int(view_width * scale)), MAX(1, int(view_height * scale)), false));
 	}
 	
 	float aspect = view.screen_width / float(view.screen_height);
@@ -124,6 +171,8 @@ void Rasterizer_Shader_Class::setupGL()
 {
 	view_width = 0;
 	view_height = 0;
+	resolution_step = RESOLUTION_STEPS;
+	frames_at_step = 0;
 	swapper.reset();
 	
 	smear_the_void = false;
@@ -142,14 +191,35 @@ void Rasterizer_Shader_Class::Begin()
 
 void Rasterizer_Shader_Class::End()
 {
+	OGL_TrackTextureBindings(false);
+	
 	swapper->deactivate();
 	swapper->swap();
 	
+	// at the world view's own resolution, before it's stretched over the screen
+	if (Get_OGL_ConfigureData().PostAntialiasing) {
+		Shader::get(Shader::S_FXAA)->enable();
+		swapper->filter();
+		Shader::disable();
+	}
+	
 	float gamma_adj = get_actual_gamma_adjust(graphics_preferences->screen_mode.gamma_level);
-	if (gamma_adj < 0.99f || gamma_adj > 1.01f) {
-		Shader *s = Shader::get(Shader::S_Gamma);
+	bool adjust_gamma = (gamma_adj < 0.99f || gamma_adj > 1.01f);
+	
+	// the faders are applied on the way out too, instead of as quads blended over
+	// the whole view afterward; an MML gamma program that predates them is left alone
+	Shader *s = Shader::get(Shader::S_Gamma);
+	float fade_scale[MAXIMUM_FADER_STEPS][4], fade_offset[MAXIMUM_FADER_STEPS][4];
+	bool fade_steps = s->declares(Shader::U_FadeScale);
+	bool fade = fade_steps && OGL_FaderSteps(fade_scale, fade_offset);
+	
+	if (adjust_gamma || fade) {
 		s->enable();
-		s->setFloat(Shader::U_GammaAdjust, gamma_adj);
+		s->setFloat(Shader::U_GammaAdjust, adjust_gamma ? gamma_adj : 1.0f);
+		if (fade_steps) {
+			s->setVec4(Shader::U_FadeScale, fade_scale[0], MAXIMUM_FADER_STEPS);
+			s->setVec4(Shader::U_FadeOffset, fade_offset[0], MAXIMUM_FADER_STEPS);
+		}
 	}
 	swapper->draw();
 	Shader::disable();
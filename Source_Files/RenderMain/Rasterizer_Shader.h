@@ -25,6 +25,13 @@ protected:
 	short view_width;
 	short view_height;
 
+	// The world view is drawn at resolution_step / RESOLUTION_STEPS of the
+	// view's size along each side, and stretched to fill it
+	enum { RESOLUTION_STEPS = 8, MINIMUM_RESOLUTION_STEP = 4 };
+	short resolution_step;
+	short frames_at_step;
+	short NextResolutionStep();
+
 public:
 
 	Rasterizer_Shader_Class();
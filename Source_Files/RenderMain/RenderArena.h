@@ -0,0 +1,85 @@
+#ifndef _RENDER_ARENA_
+#define _RENDER_ARENA_
+/*
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	Linear per-frame storage for the render pipeline's nodes, clips, windows and objects.
+
+	Elements live in fixed-size blocks, so adding one never moves the others, and
+	the pointers the renderer keeps between them stay good without any fixing up.
+	Clearing only rewinds it; the blocks stay for the next frame to fill again,
+	so after a view has opened up once, the views after it allocate nothing.
+*/
+
+#include <stddef.h>
+#include <vector>
+#include "csalerts.h"
+
+template<typename T, size_t BlockLength = 256>
+class RenderArena
+{
+public:
+	RenderArena() : mSize(0) {}
+	~RenderArena() { for (size_t i = 0; i < mBlocks.size(); i++) delete [] mBlocks[i]; }
+
+	size_t size() const { return mSize; }
+	bool empty() const { return mSize == 0; }
+	size_t capacity() const { return mBlocks.size() * BlockLength; }
+
+	// O(1): everything handed out so far is given out again
+	void clear() { mSize = 0; }
+
+	void reserve(size_t inCount) {
+		while (capacity() < inCount)
+			mBlocks.push_back(new T[BlockLength]);
+	}
+
+	void push_back(const T& inData) {
+		if (mSize == capacity())
+			mBlocks.push_back(new T[BlockLength]);
+		(*this)[mSize++] = inData;
+	}
+
+	T& operator[](size_t inIndex) { return mBlocks[inIndex / BlockLength][inIndex % BlockLength]; }
+	const T& operator[](size_t inIndex) const { return mBlocks[inIndex / BlockLength][inIndex % BlockLength]; }
+
+	T& front() { assert(mSize > 0); return (*this)[0]; }
+	T& back() { assert(mSize > 0); return (*this)[mSize - 1]; }
+
+	// Where inData is among the elements in use, or size() if it isn't one of them;
+	// the blocks aren't in address order, so this stands in for comparing pointers
+	size_t index_of(const T* inData) const {
+		for (size_t i = 0; i < mBlocks.size() && i * BlockLength < mSize; i++) {
+			if (inData >= mBlocks[i] && inData < mBlocks[i] + BlockLength) {
+				size_t theIndex = i * BlockLength + (inData - mBlocks[i]);
+				return theIndex < mSize ? theIndex : mSize;
+			}
+		}
+		return mSize;
+	}
+
+private:
+	std::vector<T *> mBlocks;
+	size_t mSize;
+
+	// Copying would leave the copy's pointers into this one's blocks
+	RenderArena(const RenderArena&);
+	RenderArena& operator =(const RenderArena&);
+};
+
+#endif
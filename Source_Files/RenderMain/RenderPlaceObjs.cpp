@@ -108,15 +108,16 @@ void RenderPlaceObjsClass::build_render_object_list()
 	assert(RSPtr);
 	sorted_node_data *sorted_node;
 	// LP: reference to simplify the code
-	vector<sorted_node_data>& SortedNodes = RSPtr->SortedNodes;
+	RenderArena<sorted_node_data>& SortedNodes = RSPtr->SortedNodes;
 	
 	// What's the object index of oneself in the game?
 	short self_index = current_player->object_index;
 
 	initialize_render_object_list();
 	
-	for (sorted_node = &SortedNodes.back(); sorted_node >= &SortedNodes.front(); --sorted_node)
+	for (size_t k = SortedNodes.size(); k > 0; --k)
 	{
+		sorted_node = &SortedNodes[k-1];
 		polygon_data *polygon= get_polygon_data(sorted_node->polygon_index);
 		_fixed floor_intensity= get_light_intensity(polygon->floor_lightsource_index);
 		_fixed ceiling_intensity = get_light_intensity(polygon->ceiling_lightsource_index);
@@ -155,8 +156,6 @@ render_object_data *RenderPlaceObjsClass::build_render_object(
 {
 	render_object_data *render_object= NULL;
 	object_data *object= get_object_data(object_index);
-	// LP: reference to simplify the code
-	vector<sorted_node_data>& SortedNodes = RSPtr->SortedNodes;
 	
 	// LP change: removed upper limit on number (restored it later)
 	if (!OBJECT_IS_INVISIBLE(object) && int(RenderObjects.size())<get_dynamic_limit(_dynamic_limit_rendered))
@@ -273,34 +272,14 @@ render_object_data *RenderPlaceObjsClass::build_render_object(
 			{
 				// LP Change:
 				size_t Length = RenderObjects.size();
-				POINTER_DATA OldROPointer = POINTER_CAST(&RenderObjects.front());
 				
-				// Add a dummy object and check if the pointer got changed
+				// Add a dummy object; the objects and sorted nodes pointing at the others stay good
 				render_object_data Dummy;
 				Dummy.node = NULL;				// Fake initialization to shut up CW
 				RenderObjects.push_back(Dummy);
-				POINTER_DATA NewROPointer = POINTER_CAST(&RenderObjects.front());
-				
-				if (NewROPointer != OldROPointer)
-				{
-					// Get the render objects and sorted nodes into sync
-					for (size_t k=0; k<Length; k++)
-					{
-						render_object_data &RenderObject = RenderObjects[k];
-						if (RenderObject.next_object != NULL)
-							RenderObject.next_object = (render_object_data *)(NewROPointer + (POINTER_CAST(RenderObject.next_object) - OldROPointer));
-					}
-					for (size_t k=0; k<SortedNodes.size(); k++)
-					{
-						sorted_node_data &SortedNode = SortedNodes[k];
-						if (SortedNode.interior_objects != NULL)
-							SortedNode.interior_objects = (render_object_data *)(NewROPointer + (POINTER_CAST(SortedNode.interior_objects) - OldROPointer));
-						if (SortedNode.exterior_objects != NULL)
-							SortedNode.exterior_objects = (render_object_data *)(NewROPointer + (POINTER_CAST(SortedNode.exterior_objects) - OldROPointer));
-					}
-				}
 				render_object= &RenderObjects[Length];
 				
+				render_object->object_index= object_index;
 				render_object->rectangle.flags= 0;
 				
 				// Clamp to short values
@@ -344,6 +323,8 @@ render_object_data *RenderPlaceObjsClass::build_render_object(
 				render_object->rectangle.ModelPtr = ModelPtr;
 				if (ModelPtr)
 				{
+					// Distant models can be drawn with less detail
+					render_object->rectangle.ModelLOD = ModelPtr->FindLOD(y1 - y0);
 					render_object->rectangle.ModelSequence = ModelSequence;
 					render_object->rectangle.ModelFrame = data.Frame;
 					render_object->rectangle.NextModelFrame = data.NextFrame;
@@ -447,7 +428,7 @@ void RenderPlaceObjsClass::sort_render_object_into_tree(
 	sorted_node_data *desired_node;
 	short i;
 	// LP: reference to simplify the code
-	vector<sorted_node_data>& SortedNodes = RSPtr->SortedNodes;
+	RenderArena<sorted_node_data>& SortedNodes = RSPtr->SortedNodes;
 
 	/* find the last render_object in the given list of new objects */
 	for (last_new_render_object= new_render_object;
@@ -456,8 +437,9 @@ void RenderPlaceObjsClass::sort_render_object_into_tree(
 		;
 
 	/* find the two objects we must be lie between */
-	for (render_object = &RenderObjects.front(); render_object <= &RenderObjects.back(); ++render_object)
+	for (size_t k = 0; k < RenderObjects.size(); ++k)
 	{
+		render_object = &RenderObjects[k];
 		/* if these two objects intersect... */
 		if (render_object->rectangle.x1>new_render_object->rectangle.x0 && render_object->rectangle.x0<new_render_object->rectangle.x1 &&
 			render_object->rectangle.y1>new_render_object->rectangle.y0 && render_object->rectangle.y0<new_render_object->rectangle.y1)
@@ -485,15 +467,16 @@ void RenderPlaceObjsClass::sort_render_object_into_tree(
 
 	/* find the node wed like to be in (that is, the node closest to the viewer of all the nodes
 		we cross and therefore the latest one in the sorted node list) */
-	desired_node= base_nodes[0];
-	for (i= 1; i<base_node_count; ++i) if (base_nodes[i]>desired_node) desired_node= base_nodes[i];
-	assert((desired_node >= &SortedNodes.front()) && (desired_node <= &SortedNodes.back()));
+	size_t desired_node_index= SortedNodes.index_of(base_nodes[0]);
+	for (i= 1; i<base_node_count; ++i) desired_node_index= MAX(desired_node_index, SortedNodes.index_of(base_nodes[i]));
+	assert(desired_node_index<SortedNodes.size());
+	desired_node= &SortedNodes[desired_node_index];
 	
 	/* adjust desired node based on the nodes of the deep and shallow render object; only
 		one of deep_render_object and shallow_render_object will be non-null after this if
 		block.  the current object must be sorted with respect to this non-null object inside
 		the object list of the desired_node */
-	if (shallow_render_object && desired_node>=shallow_render_object->node)
+	if (shallow_render_object && desired_node_index>=SortedNodes.index_of(shallow_render_object->node))
 	{
 		/* we tried to sort too close to the front of the node list */
 		desired_node= shallow_render_object->node;
@@ -501,7 +484,7 @@ void RenderPlaceObjsClass::sort_render_object_into_tree(
 	}
 	else
 	{
-		if (deep_render_object && desired_node<=deep_render_object->node)
+		if (deep_render_object && desired_node_index<=SortedNodes.index_of(deep_render_object->node))
 		{
 			/* we tried to sort too close to the back of the node list */
 			desired_node= deep_render_object->node;
@@ -710,9 +693,8 @@ void RenderPlaceObjsClass::build_aggregate_render_object_clipping_window(
 	short base_node_count)
 {
 	clipping_window_data *first_window= NULL;
-	// LP: references to simplify the code
-	vector<clipping_window_data>& ClippingWindows = RVPtr->ClippingWindows;
-	vector<sorted_node_data>& SortedNodes = RSPtr->SortedNodes;
+	// LP: reference to simplify the code
+	RenderArena<clipping_window_data>& ClippingWindows = RVPtr->ClippingWindows;
 	
 	if (base_node_count==1)
 	{
@@ -799,39 +781,11 @@ void RenderPlaceObjsClass::build_aggregate_render_object_clipping_window(
 				{
 					/* allocate it */
 					size_t Length = ClippingWindows.size();
-					POINTER_DATA OldCWPointer = POINTER_CAST(&ClippingWindows.front());
 					
-					// Add a dummy object and check if the pointer got changed
+					// Add a dummy object; what points at the other windows stays good
 					clipping_window_data Dummy;
 					Dummy.next_window = NULL;			// Fake initialization to shut up CW
 					ClippingWindows.push_back(Dummy);
-					POINTER_DATA NewCWPointer = POINTER_CAST(&ClippingWindows.front());
-				
-					if (NewCWPointer != OldCWPointer)
-					{
-						// Get the sorted nodes into sync
-						// Also, the render objects and the parent window
-						for (size_t k=0; k<Length; k++)
-						{
-							clipping_window_data &ClippingWindow = ClippingWindows[k];
-							if (ClippingWindow.next_window != NULL)
-								ClippingWindow.next_window = (clipping_window_data *)(NewCWPointer + (POINTER_CAST(ClippingWindow.next_window) - OldCWPointer));
-						}
-						for (size_t k=0; k<SortedNodes.size(); k++)
-						{
-							sorted_node_data &SortedNode = SortedNodes[k];
-							if (SortedNode.clipping_windows != NULL)
-								SortedNode.clipping_windows = (clipping_window_data *)(NewCWPointer + (POINTER_CAST(SortedNode.clipping_windows) - OldCWPointer));
-						}
-						for (unsigned k=0; k<RenderObjects.size(); k++)
-						{
-							render_object_data &RenderObject = RenderObjects[k];
-							if (RenderObject.clipping_windows != NULL)
-								RenderObject.clipping_windows = (clipping_window_data *)(NewCWPointer + (POINTER_CAST(RenderObject.clipping_windows) - OldCWPointer));
-						}
-						if (first_window != NULL)
-							first_window = (clipping_window_data *)(NewCWPointer + (POINTER_CAST(first_window) - OldCWPointer));
-					}
 					window= &ClippingWindows[Length];
 					
 					/* build it */
@@ -51,6 +51,8 @@ struct render_object_data
 	struct rectangle_definition rectangle;
 	
 	int16 ymedia;
+	
+	int16 object_index; /* the map object drawn */
 };
 
 
@@ -83,7 +85,7 @@ public:
 	// LP additions: growable list of render objects; these are all the inhabitants
 	// Length changed in build_render_object()
 	// keep SortedNodes in sync
-	vector<render_object_data> RenderObjects;
+	RenderArena<render_object_data> RenderObjects;
 	
 	// Pointers to view and calculated visibility tree and sorted polygons
 	view_data *view;
@@ -72,16 +72,15 @@ void RenderRasterizerClass::render_tree(RenderStep renderStep)
 	assert(view);	// Idiot-proofing
 	assert(RSPtr);
 	assert(RasPtr);
-	vector<sorted_node_data>::iterator node;
 	// LP: reference to simplify the code
-	vector<sorted_node_data>& SortedNodes = RSPtr->SortedNodes;
+	RenderArena<sorted_node_data>& SortedNodes = RSPtr->SortedNodes;
 	
 	// LP change: added support for semitransparent liquids
 	bool SeeThruLiquids = get_screen_mode()->acceleration != _no_acceleration ? TEST_FLAG(Get_OGL_ConfigureData().Flags,OGL_Flag_LiqSeeThru) : graphics_preferences->software_alpha_blending != _sw_alpha_off;
 	
 	/* walls, ceilings, interior objects, floors, exterior objects for all nodes, back to front */
-	for (node= SortedNodes.begin(); node != SortedNodes.end(); ++node)
-		render_node(&*node, SeeThruLiquids, renderStep);
+	for (size_t k= 0; k<SortedNodes.size(); ++k)
+		render_node(&SortedNodes[k], SeeThruLiquids, renderStep);
 }
 
 void RenderRasterizerClass::render_node(
@@ -210,6 +209,7 @@ void RenderRasterizerClass::render_node(
 					store_endpoint(get_endpoint_data(polygon->endpoint_indexes[i]), surface.p0);
 					store_endpoint(get_endpoint_data(polygon->endpoint_indexes[WRAP_HIGH(i, polygon->vertex_count-1)]), surface.p1);
 					surface.ambient_delta= side->ambient_delta;
+					surface.side_index= side_index;
 					
 					// LP change: indicate in all cases whether the void is on the other side;
 					// added a workaround for full-side textures with a polygon on the other side
@@ -76,6 +76,8 @@ struct vertical_surface_data
 	
 	struct side_texture_definition *texture_definition;
 	short transfer_mode;
+	
+	short side_index;
 };
 
 typedef enum {
@@ -8,6 +8,8 @@
 
 #include "OGL_Headers.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
 
 #include "RenderRasterize_Shader.h"
@@ -22,6 +24,7 @@
 #include "OGL_Shader.h"
 #include "ChaseCam.h"
 #include "preferences.h"
+#include "FrameProfiler.h"
 
 #define MAXIMUM_VERTICES_PER_WORLD_POLYGON (MAXIMUM_VERTICES_PER_POLYGON+4)
 
@@ -34,21 +37,27 @@ private:
 	Shader *_shader_blur;
 	Shader *_shader_bloom;
 
-public:
-
-	Blur(GLuint w, GLuint h, Shader* s_blur, Shader* s_bloom)
-	: _swapper(w, h, Bloom_sRGB), _shader_blur(s_blur), _shader_bloom(s_bloom) {}
-
-	void begin() {
-		_swapper.activate();
-		glDisable(GL_FRAMEBUFFER_SRGB_EXT); // don't blend for initial
-	}
-
-	void end() {
-		_swapper.swap();
+	// Each half the size of the one before, starting from _swapper;
+	// empty for the classic blur
+	std::vector<std::unique_ptr<FBOSwapper> > _levels;
+
+	void filter(FBOSwapper& swapper, int pass) {
+		_shader_blur->enable();
+		_shader_blur->setFloat(Shader::U_OffsetX, 1);
+		_shader_blur->setFloat(Shader::U_OffsetY, 0);
+		_shader_blur->setFloat(Shader::U_Pass, pass);
+		swapper.filter(false);
+
+		_shader_blur->setFloat(Shader::U_OffsetX, 0);
+		_shader_blur->setFloat(Shader::U_OffsetY, 1);
+		_shader_blur->setFloat(Shader::U_Pass, pass);
+		swapper.filter(false);
+		Shader::disable();
 	}
 
-	void draw(FBOSwapper& dest) {
+	// Five passes at the glow buffer's size, each blended into the
+	// frame at full size
+	void draw_classic(FBOSwapper& dest) {
 		
 		int passes = _shader_bloom->passes();
 		if (passes < 0)
@@ -56,16 +65,7 @@ public:
 
 		glBlendFunc(GL_SRC_ALPHA,GL_ONE);
 		for (int i = 0; i < passes; i++) {
-			_shader_blur->enable();
-			_shader_blur->setFloat(Shader::U_OffsetX, 1);
-			_shader_blur->setFloat(Shader::U_OffsetY, 0);
-			_shader_blur->setFloat(Shader::U_Pass, i + 1);
-			_swapper.filter(false);
-
-			_shader_blur->setFloat(Shader::U_OffsetX, 0);
-			_shader_blur->setFloat(Shader::U_OffsetY, 1);
-			_shader_blur->setFloat(Shader::U_Pass, i + 1);
-			_swapper.filter(false);
+			filter(_swapper, i + 1);
 
 			_shader_bloom->enable();
 			_shader_bloom->setFloat(Shader::U_Pass, i + 1);
@@ -79,10 +79,132 @@ public:
 		
 		glBlendFunc(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
 	}
+
+	// The glow scaled down level by level, blurred once at each; then added
+	// back up the chain, so that only one pass is at the frame's size
+	void draw_mip_chain(FBOSwapper& dest) {
+
+		FBO *source = &_swapper.current_contents();
+		for (size_t i = 0; i < _levels.size(); i++) {
+			_levels[i]->copy(*source);
+			filter(*_levels[i], i + 1);
+			source = &_levels[i]->current_contents();
+		}
+
+		glBlendFunc(GL_SRC_ALPHA,GL_ONE);
+		for (size_t i = _levels.size() - 1; i > 0; i--) {
+			FBO& target = _levels[i - 1]->current_contents();
+			target.activate();
+			_levels[i]->current_contents().draw_full(true);
+			target.deactivate();
+		}
+
+		_shader_bloom->enable();
+		_shader_bloom->setFloat(Shader::U_Pass, 1);
+		dest.blend_multisample(_levels[0]->current_contents());
+		Shader::disable();
+
+		glBlendFunc(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
+	}
+
+public:
+
+	// levels of 0 is the classic blur
+	Blur(GLuint w, GLuint h, Shader* s_blur, Shader* s_bloom, int levels)
+	: _swapper(w, h, Bloom_sRGB), _shader_blur(s_blur), _shader_bloom(s_bloom) {
+		for (int i = 0; i < levels; i++) {
+			w = std::max(w / 2, 1U);
+			h = std::max(h / 2, 1U);
+			_levels.push_back(std::unique_ptr<FBOSwapper>(new FBOSwapper(w, h, Bloom_sRGB)));
+		}
+	}
+
+	void begin() {
+		_swapper.activate();
+		glDisable(GL_FRAMEBUFFER_SRGB_EXT); // don't blend for initial
+	}
+
+	void end() {
+		_swapper.swap();
+	}
+
+	void draw(FBOSwapper& dest) {
+		if (_levels.empty())
+			draw_classic(dest);
+		else
+			draw_mip_chain(dest);
+	}
+};
+
+
+// surface batches drawn and state changes between them, per frame
+static int SurfaceBatchCount = 0;
+static int SortedStateChanges = 0;
+static int UnsortedStateChanges = 0;
+static int LastSurfaceBatchCount = 0;
+static int LastSortedStateChanges = 0;
+static int LastUnsortedStateChanges = 0;
+
+void OGL_GetSurfaceSortCounts(int& batches, int& changes, int& unsorted_changes)
+{
+	batches = LastSurfaceBatchCount;
+	changes = LastSortedStateChanges;
+	unsorted_changes = LastUnsortedStateChanges;
+}
+
+// models tested for occlusion, and those skipped, per frame
+static int OcclusionModelCount = 0;
+static int OcclusionSkippedCount = 0;
+static int LastOcclusionModelCount = 0;
+static int LastOcclusionSkippedCount = 0;
+
+void OGL_GetOcclusionCounts(int& models, int& skipped)
+{
+	models = LastOcclusionModelCount;
+	skipped = LastOcclusionSkippedCount;
+}
+
+// which of the wall shaders setupWallTexture() picks for a transfer mode
+static int surface_shader(short transferMode)
+{
+	switch (transferMode) {
+		case _xfer_static:
+			return 2;
+		case _xfer_landscape:
+		case _xfer_big_landscape:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+// the ordering of sortable batches: shader, then texture, then transfer mode
+bool RenderRasterize_Shader::batch_before(const SurfaceBatch *a, const SurfaceBatch *b)
+{
+	int a_shader = surface_shader(a->transfer_mode);
+	int b_shader = surface_shader(b->transfer_mode);
+	if (a_shader != b_shader) return a_shader < b_shader;
+	if (a->texture != b->texture) return a->texture < b->texture;
+	return a->transfer_mode < b->transfer_mode;
+}
+
+// the texture and transfer mode (and so the shader) last drawn, and the one
+// last queued, which is what drawing in discovery order would have used
+struct SurfaceState {
+	shape_descriptor texture;
+	short transfer_mode;
 };
+static SurfaceState LastDrawnState, LastQueuedState;
 
+static bool change_state(SurfaceState& state, shape_descriptor texture, short transfer_mode)
+{
+	bool changed = (texture != state.texture || transfer_mode != state.transfer_mode);
+	state.texture = texture;
+	state.transfer_mode = transfer_mode;
+	return changed;
+}
 
-RenderRasterize_Shader::RenderRasterize_Shader() = default;
+RenderRasterize_Shader::RenderRasterize_Shader() : batchCount(0), batchBuffer(0), surfaceCacheMap(0), nodePolygonIndex(NONE), shaderTinting(false), shaderOpacity(false), objectMediaClipped(false), occlusionFrame(0), occlusionQueries(false) {}
 RenderRasterize_Shader::~RenderRasterize_Shader() = default;
 
 /*
@@ -98,10 +220,67 @@ void RenderRasterize_Shader::setupGL(Rasterizer_Shader_Class& Rasterizer) {
 	Shader* s_blur = Shader::get(Shader::S_Blur);
 	Shader* s_bloom = Shader::get(Shader::S_Bloom);
 
+	// infravision and silhouettes are drawn from the normal textures
+	// unless some replacement shader can't tint them
+	const Shader::ShaderType tintedShaders[] = {
+		Shader::S_Landscape, Shader::S_LandscapeBloom,
+		Shader::S_Sprite, Shader::S_SpriteBloom,
+		Shader::S_Wall, Shader::S_WallBloom,
+		Shader::S_Bump, Shader::S_BumpBloom
+	};
+	shaderTinting = true;
+	for (size_t i = 0; i < sizeof(tintedShaders) / sizeof(tintedShaders[0]); ++i) {
+		if (!Shader::get(tintedShaders[i])->declares(Shader::U_InfravisionTint)) {
+			shaderTinting = false;
+		}
+	}
+
+	// and the opacity of compressed substitutes is adjusted as they're drawn,
+	// by every program that reads their alpha
+	const Shader::ShaderType opacityShaders[] = {
+		Shader::S_Landscape, Shader::S_LandscapeBloom,
+		Shader::S_Sprite, Shader::S_SpriteBloom,
+		Shader::S_Invincible, Shader::S_InvincibleBloom,
+		Shader::S_Invisible, Shader::S_InvisibleBloom,
+		Shader::S_Wall, Shader::S_WallBloom,
+		Shader::S_Bump, Shader::S_BumpBloom
+	};
+	shaderOpacity = true;
+	for (size_t i = 0; i < sizeof(opacityShaders) / sizeof(opacityShaders[0]); ++i) {
+		if (!Shader::get(opacityShaders[i])->declares(Shader::U_OpacityAdjust)) {
+			shaderOpacity = false;
+		}
+	}
+
+	// surfaces are streamed through a buffer object when the driver has them,
+	// and drawn from client memory otherwise
+	if (batchBuffer) {
+		glDeleteBuffersARB(1, &batchBuffer);
+		batchBuffer = 0;
+	}
+	if (OGL_CheckExtension("GL_ARB_vertex_buffer_object")) {
+		glGenBuffersARB(1, &batchBuffer);
+	}
+	batchCount = 0;
+
+	// models are culled only where the driver can count the samples
+	// their bounding boxes would draw
+	for (size_t i = 0; i < modelOcclusion.size(); ++i) {
+		if (modelOcclusion[i].query) {
+			glDeleteQueriesARB(1, &modelOcclusion[i].query);
+		}
+	}
+	modelOcclusion.clear();
+	occlusionTests.clear();
+	occlusionQueries = OGL_CheckExtension("GL_ARB_occlusion_query");
+
 	blur.reset();
 	if(TEST_FLAG(Get_OGL_ConfigureData().Flags, OGL_Flag_Blur)) {
 		if(s_blur && s_bloom) {
-			blur.reset(new Blur(640., 640. * graphics_preferences->screen_mode.height / graphics_preferences->screen_mode.width, s_blur, s_bloom));
+			// levels in the mip chain, by quality
+			static const int bloom_levels[NUMBER_OF_BLOOM_QUALITIES] = { 0, 3, 4, 5 };
+			int quality = PIN(Get_OGL_ConfigureData().BloomQuality, 0, NUMBER_OF_BLOOM_QUALITIES - 1);
+			blur.reset(new Blur(640., 640. * graphics_preferences->screen_mode.height / graphics_preferences->screen_mode.width, s_blur, s_bloom, bloom_levels[quality]));
 		}
 	}
 	
@@ -119,6 +298,26 @@ const float AngleConvert = TWO_PI/float(FULL_CIRCLE);
 
 void RenderRasterize_Shader::render_tree() {
 
+	LastSurfaceBatchCount = SurfaceBatchCount;
+	LastSortedStateChanges = SortedStateChanges;
+	LastUnsortedStateChanges = UnsortedStateChanges;
+	SurfaceBatchCount = SortedStateChanges = UnsortedStateChanges = 0;
+	LastOcclusionModelCount = OcclusionModelCount;
+	LastOcclusionSkippedCount = OcclusionSkippedCount;
+	OcclusionModelCount = OcclusionSkippedCount = 0;
+	++occlusionFrame;
+	occlusionTests.clear();
+
+	if (surfaceCacheMap != map_load_count) {
+		polygonSurfaces.clear();
+		polygonSurfaces.resize(dynamic_world->polygon_count * NUMBER_OF_POLYGON_SURFACES);
+		sideSurfaces.clear();
+		sideSurfaces.resize(dynamic_world->side_count * NUMBER_OF_SIDE_SURFACES);
+		surfaceCacheMap = map_load_count;
+	}
+	LastDrawnState.texture = LastQueuedState.texture = UNONE;
+	LastDrawnState.transfer_mode = LastQueuedState.transfer_mode = NONE;
+
 	weaponFlare = PIN(view->maximum_depth_intensity - NATURAL_LIGHT_INTENSITY, 0, FIXED_ONE)/float(FIXED_ONE);
 	selfLuminosity = PIN(NATURAL_LIGHT_INTENSITY, 0, FIXED_ONE)/float(FIXED_ONE);
 
@@ -133,8 +332,9 @@ void RenderRasterize_Shader::render_tree() {
 
 	short leftmost = INT16_MAX;
 	short rightmost = INT16_MIN;
-	vector<clipping_window_data>& windows = RSPtr->RVPtr->ClippingWindows;
-	for (vector<clipping_window_data>::const_iterator it = windows.begin(); it != windows.end(); ++it) {
+	RenderArena<clipping_window_data>& windows = RSPtr->RVPtr->ClippingWindows;
+	for (size_t i = 0; i < windows.size(); ++i) {
+		const clipping_window_data *it = &windows[i];
 		if (it->x0 < leftmost) {
 			leftmost = it->x0;
 			leftmost_clip = it->left;
@@ -170,14 +370,19 @@ void RenderRasterize_Shader::render_tree() {
 	Shader::disable();
 
 	RenderRasterizerClass::render_tree(kDiffuse);
+	flush_sprite_batch();
+	test_model_occlusion();
 
 	if (TEST_FLAG(Get_OGL_ConfigureData().Flags, OGL_Flag_Blur) && blur.get()) {
+		FrameProfiler::instance()->Begin(FrameProfiler::GLOW);
 		blur->begin();
 		RenderRasterizerClass::render_tree(kGlow);
+		flush_sprite_batch();
 		blur->end();
 		RasPtr->swapper->deactivate();
 		blur->draw(*RasPtr->swapper);
 		RasPtr->swapper->activate();
+		FrameProfiler::instance()->End(FrameProfiler::GLOW);
 	}
 
 	glAlphaFunc(GL_GREATER, 0.5);
@@ -189,13 +394,144 @@ void RenderRasterize_Shader::render_node(sorted_node_data *node, bool SeeThruLiq
     objectCount = 0;
     objectY = 0;
 
+    nodePolygonIndex = node->polygon_index;
     RenderRasterizerClass::render_node(node, SeeThruLiquids, renderStep);
+	flush_surface_batches();
 
 	// turn off clipping planes
 	glDisable(GL_CLIP_PLANE0);
 	glDisable(GL_CLIP_PLANE1);
 }
 
+// How much bigger than its neutral pose a model's box is taken to be,
+// for the animations that reach out of it
+const GLfloat kOcclusionBoxGrowth = 1.25;
+
+bool RenderRasterize_Shader::model_occluded(render_object_data *object)
+{
+	if (!occlusionQueries || !Get_OGL_ConfigureData().OcclusionCulling ||
+		!TEST_FLAG(Get_OGL_ConfigureData().Flags, OGL_Flag_ZBuffer) || object->object_index < 0) {
+		return false;
+	}
+
+	if (size_t(object->object_index) >= modelOcclusion.size()) {
+		ModelOcclusion none = { 0, 0, 0, false };
+		modelOcclusion.resize(object->object_index + 1, none);
+	}
+	ModelOcclusion& occlusion = modelOcclusion[object->object_index];
+	if (occlusion.frameDecided == occlusionFrame) {
+		return occlusion.occluded;
+	}
+	occlusion.frameDecided = occlusionFrame;
+	occlusion.occluded = false;
+
+	// liquids are in the depth buffer even where they can be seen through
+	if (get_polygon_data(object->node->polygon_index)->media_index != NONE) {
+		return false;
+	}
+
+	rectangle_definition& rect = object->rectangle;
+	OcclusionTest test;
+	test.objectIndex = object->object_index;
+	test.position = rect.Position;
+	test.azimuth = rect.Azimuth;
+	test.horizScale = rect.Scale * rect.HorizScale;
+	test.scale = rect.Scale;
+	const GLfloat (*box)[3] = rect.ModelPtr->Model.BoundingBox;
+	GLfloat reach = 0;
+	for (int i = 0; i < 3; ++i) {
+		GLfloat center = (box[0][i] + box[1][i]) / 2;
+		GLfloat half = (box[1][i] - box[0][i]) / 2 * kOcclusionBoxGrowth;
+		test.box[0][i] = center - half;
+		test.box[1][i] = center + half;
+		GLfloat extent = MAX(fabs(test.box[0][i]), fabs(test.box[1][i])) * (i < 2 ? test.horizScale : test.scale);
+		reach += extent * extent;
+	}
+
+	// a box around the view, or cut by the near plane, shows too little
+	const GLfloat nearVal = 64.0;
+	GLfloat dx = rect.Position.x - view->origin.x;
+	GLfloat dy = rect.Position.y - view->origin.y;
+	GLfloat dz = rect.Position.z - view->origin.z;
+	if (sqrt(dx * dx + dy * dy + dz * dz) < sqrt(reach) + nearVal) {
+		return false;
+	}
+
+	++OcclusionModelCount;
+	if (occlusion.frameQueried && occlusion.frameQueried == occlusionFrame - 1) {
+		// a result not in yet counts as seen, rather than waiting for it
+		GLuint available = 0;
+		glGetQueryObjectuivARB(occlusion.query, GL_QUERY_RESULT_AVAILABLE_ARB, &available);
+		if (available) {
+			GLuint samples = 1;
+			glGetQueryObjectuivARB(occlusion.query, GL_QUERY_RESULT_ARB, &samples);
+			occlusion.occluded = (samples == 0);
+		}
+	}
+	if (occlusion.occluded) {
+		++OcclusionSkippedCount;
+	}
+
+	occlusionTests.push_back(test);
+	return occlusion.occluded;
+}
+
+void RenderRasterize_Shader::test_model_occlusion()
+{
+	if (occlusionTests.empty()) {
+		return;
+	}
+
+	// the box's corners, by bits: x from the first bit, y the second, z the third
+	static const GLubyte faces[24] = {
+		0, 2, 3, 1,  4, 5, 7, 6,
+		0, 1, 5, 4,  2, 6, 7, 3,
+		0, 4, 6, 2,  1, 3, 7, 5
+	};
+
+	Shader::disable();
+	glDisable(GL_TEXTURE_2D);
+	glDisable(GL_BLEND);
+	glDisable(GL_ALPHA_TEST);
+	glDisable(GL_CULL_FACE);
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthMask(GL_FALSE);
+	glClientActiveTextureARB(GL_TEXTURE0_ARB);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+
+	GLfloat corners[8][3];
+	glVertexPointer(3, GL_FLOAT, 0, corners);
+	for (size_t t = 0; t < occlusionTests.size(); ++t) {
+		const OcclusionTest& test = occlusionTests[t];
+		ModelOcclusion& occlusion = modelOcclusion[test.objectIndex];
+		if (!occlusion.query) {
+			glGenQueriesARB(1, &occlusion.query);
+		}
+
+		for (int c = 0; c < 8; ++c) {
+			corners[c][0] = test.box[c & 1][0];
+			corners[c][1] = test.box[(c >> 1) & 1][1];
+			corners[c][2] = test.box[(c >> 2) & 1][2];
+		}
+
+		glPushMatrix();
+		glTranslated(test.position.x, test.position.y, test.position.z);
+		glRotated((360.0/FULL_CIRCLE)*test.azimuth,0,0,1);
+		glScalef(test.horizScale,test.horizScale,test.scale);
+		glBeginQueryARB(GL_SAMPLES_PASSED_ARB, occlusion.query);
+		glDrawElements(GL_QUADS, 24, GL_UNSIGNED_BYTE, faces);
+		glEndQueryARB(GL_SAMPLES_PASSED_ARB);
+		glPopMatrix();
+		occlusion.frameQueried = occlusionFrame;
+	}
+
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDepthMask(GL_TRUE);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glEnable(GL_CULL_FACE);
+	glEnable(GL_TEXTURE_2D);
+}
+
 void RenderRasterize_Shader::clip_to_window(clipping_window_data *win)
 {
     GLdouble clip[] = { 0., 0., 0., 0. };
@@ -237,12 +573,37 @@ void RenderRasterize_Shader::store_endpoint(
 }
 
 
+// the color a sprite is drawn in, by its lighting and transfer mode
+static void sprite_color(const rectangle_definition& rect, RenderStep renderStep, GLfloat color[4]) {
+
+	GLfloat shade = PIN(static_cast<GLfloat>(rect.ambient_shade)/static_cast<GLfloat>(FIXED_ONE),0,1);
+	color[0] = color[1] = color[2] = shade;
+	color[3] = 1;
+
+	switch(rect.transfer_mode) {
+		case _static_transfer:
+		case _tinted_transfer:
+			break;
+		case _solid_transfer:
+			color[0] = color[2] = 0;
+			color[1] = 1;
+			break;
+		case _textured_transfer:
+			if(rect.flags&_SHADELESS_BIT) {
+				color[0] = color[1] = color[2] = (renderStep == kDiffuse) ? 1 : 0;
+			}
+			break;
+		default:
+			color[0] = color[1] = 0;
+			color[2] = 1;
+	}
+}
+
 TextureManager RenderRasterize_Shader::setupSpriteTexture(const rectangle_definition& rect, short type, float offset, RenderStep renderStep) {
 
 	Shader *s = NULL;
-	GLfloat color[3];
-	GLdouble shade = PIN(static_cast<GLfloat>(rect.ambient_shade)/static_cast<GLfloat>(FIXED_ONE),0,1);
-	color[0] = color[1] = color[2] = shade;
+	GLfloat color[4];
+	sprite_color(rect, renderStep, color);
 
 	TextureManager TMgr;
 
@@ -254,11 +615,13 @@ TextureManager RenderRasterize_Shader::setupSpriteTexture(const rectangle_defini
 	TMgr.TransferData = rect.transfer_data;
 	TMgr.IsShadeless = (rect.flags&_SHADELESS_BIT) != 0;
 	TMgr.TextureType = type;
+	TMgr.ShaderTinting = shaderTinting;
+	TMgr.ShaderOpacity = shaderOpacity;
 
 	float flare = weaponFlare;
 
 	glEnable(GL_TEXTURE_2D);
-	glColor4f(color[0], color[1], color[2], 1);
+	glColor4fv(color);
 
 	switch(TMgr.TransferMode) {
 		case _static_transfer:
@@ -273,21 +636,11 @@ TextureManager RenderRasterize_Shader::setupSpriteTexture(const rectangle_defini
 			s->enable();
 			s->setFloat(Shader::U_Visibility, 1.0 - rect.transfer_data/32.0f);
 			break;
-		case _solid_transfer:
-			glColor4f(0,1,0,1);
-			break;
 		case _textured_transfer:
 			if(TMgr.IsShadeless) {
-				if (renderStep == kDiffuse) {
-					glColor4f(1,1,1,1);
-				} else {
-					glColor4f(0,0,0,1);
-				}
 				flare = -1;
 			}
 			break;
-		default:
-			glColor4f(0,0,1,1);
 	}
 
 	if(s == NULL) {
@@ -304,6 +657,17 @@ TextureManager RenderRasterize_Shader::setupSpriteTexture(const rectangle_defini
 
 	TMgr.SetupTextureMatrix();
 
+	if (shaderTinting && TMgr.TransferMode != _static_transfer && TMgr.TransferMode != _tinted_transfer) {
+		GLfloat tint[4];
+		TMgr.GetInfravisionTint(tint);
+		s->setVec4(Shader::U_InfravisionTint, tint);
+	}
+	if (shaderOpacity) {
+		GLfloat adjust[4];
+		TMgr.GetOpacityAdjust(adjust);
+		s->setVec4(Shader::U_OpacityAdjust, adjust);
+	}
+
 	if (renderStep == kGlow) {
 		s->setFloat(Shader::U_BloomScale, TMgr.BloomScale());
 		s->setFloat(Shader::U_BloomShift, TMgr.BloomShift());
@@ -336,6 +700,8 @@ TextureManager RenderRasterize_Shader::setupWallTexture(const shape_descriptor&
 	TMgr.TransferMode = _textured_transfer;
 	TMgr.IsShadeless = current_player->infravision_duration ? 1 : 0;
 	TMgr.TransferData = 0;
+	TMgr.ShaderTinting = shaderTinting;
+	TMgr.ShaderOpacity = shaderOpacity;
 
 	float flare = weaponFlare;
 
@@ -387,9 +753,9 @@ TextureManager RenderRasterize_Shader::setupWallTexture(const shape_descriptor&
 	if(TMgr.Setup()) {
 		TMgr.RenderNormal(); // must allocate first
 		if (TEST_FLAG(Get_OGL_ConfigureData().Flags, OGL_Flag_BumpMap)) {
-			glActiveTextureARB(GL_TEXTURE1_ARB);
+			OGL_ActiveTexture(GL_TEXTURE1_ARB);
 			TMgr.RenderBump();
-			glActiveTextureARB(GL_TEXTURE0_ARB);
+			OGL_ActiveTexture(GL_TEXTURE0_ARB);
 		}
 	} else {
 		TMgr.ShapeDesc = UNONE;
@@ -397,6 +763,17 @@ TextureManager RenderRasterize_Shader::setupWallTexture(const shape_descriptor&
 	}
 
 	TMgr.SetupTextureMatrix();
+
+	if (shaderTinting && TMgr.TransferMode != _static_transfer) {
+		GLfloat tint[4];
+		TMgr.GetInfravisionTint(tint);
+		s->setVec4(Shader::U_InfravisionTint, tint);
+	}
+	if (shaderOpacity) {
+		GLfloat adjust[4];
+		TMgr.GetOpacityAdjust(adjust);
+		s->setVec4(Shader::U_OpacityAdjust, adjust);
+	}
 	
 	if (TMgr.TextureType == OGL_Txtr_Landscape && opts) {
 		double TexScale = ABS(TMgr.U_Scale);
@@ -521,6 +898,9 @@ bool setupGlow(struct view_data *view, TextureManager &TMgr, float wobble, float
 		glAlphaFunc(GL_GREATER, 0.001);
 
 		s->enable();
+		// the glow map has its own opacity
+		const GLfloat noAdjust[4] = { 0, 0, 0, 0 };
+		s->setVec4(Shader::U_OpacityAdjust, noAdjust);
 		if (renderStep == kGlow) {
 			s->setFloat(Shader::U_BloomScale, TMgr.GlowBloomScale());
 			s->setFloat(Shader::U_BloomShift, TMgr.GlowBloomShift());
@@ -545,19 +925,7 @@ void RenderRasterize_Shader::render_node_floor_or_ceiling(clipping_window_data *
 	float wobble = calcWobble(surface->transfer_mode, view->tick_count);
 	// note: wobble and pulsate behave the same way on floors and ceilings
 	// note 2: stronger wobble looks more like classic with default shaders
-	TextureManager TMgr = setupWallTexture(texture, surface->transfer_mode, wobble * 4.0, 0, intensity, offset, renderStep);
-	if(TMgr.ShapeDesc == UNONE) { return; }
-
-	if (TMgr.IsBlended()) {
-		glEnable(GL_BLEND);
-		setupBlendFunc(TMgr.NormalBlend());
-		glEnable(GL_ALPHA_TEST);
-		glAlphaFunc(GL_GREATER, 0.001);
-	} else {
-		glDisable(GL_BLEND);
-		glEnable(GL_ALPHA_TEST);
-		glAlphaFunc(GL_GREATER, 0.5);
-	}
+	if (texture == UNONE) { return; }
 
 //	if (void_present) {
 //		glDisable(GL_BLEND);
@@ -567,66 +935,46 @@ void RenderRasterize_Shader::render_node_floor_or_ceiling(clipping_window_data *
 	short vertex_count = polygon->vertex_count;
 
 	if (vertex_count) {
-        clip_to_window(window);
-
 		world_distance x = 0.0, y = 0.0;
 		instantiate_transfer_mode(view, surface->transfer_mode, x, y);
 
-		vec3 N;
-		vec3 T;
-		float sign;
-		if(ceil) {
-			N = vec3(0,0,-1);
-			T = vec3(0,1,0);
-			sign = 1;
-		} else {
-			N = vec3(0,0,1);
-			T = vec3(0,1,0);
-			sign = -1;
-		}
-		glNormal3f(N[0], N[1], N[2]);
-		glMultiTexCoord4fARB(GL_TEXTURE1_ARB, T[0], T[1], T[2], sign);
+		// liquids are the surfaces without the void behind them
+		int which = void_present ? (ceil ? kCeilingSurface : kFloorSurface) : kMediaSurface;
+		const int32 key[SURFACE_KEY_LENGTH] = { surface->height, ceil };
+		CachedSurface *cached;
+		if (!find_cached_surface(polygonSurfaces, nodePolygonIndex * NUMBER_OF_POLYGON_SURFACES + which, key, cached)) {
+			vec3 N;
+			vec3 T;
+			float sign;
+			if(ceil) {
+				N = vec3(0,0,-1);
+				T = vec3(0,1,0);
+				sign = 1;
+			} else {
+				N = vec3(0,0,1);
+				T = vec3(0,1,0);
+				sign = -1;
+			}
 
-		GLfloat vertex_array[MAXIMUM_VERTICES_PER_POLYGON * 3];
-		GLfloat texcoord_array[MAXIMUM_VERTICES_PER_POLYGON * 2];
+			GLfloat vertex_array[MAXIMUM_VERTICES_PER_POLYGON * 3];
+			GLfloat texcoord_array[MAXIMUM_VERTICES_PER_POLYGON * 2];
 
-		GLfloat* vp = vertex_array;
-		GLfloat* tp = texcoord_array;
-		if (ceil)
-		{
+			GLfloat* vp = vertex_array;
+			GLfloat* tp = texcoord_array;
 			for(short i = 0; i < vertex_count; ++i) {
-				world_point2d vertex = get_endpoint_data(polygon->endpoint_indexes[vertex_count - 1 - i])->vertex;
-				*vp++ = vertex.x;
-				*vp++ = vertex.y;
-				*vp++ = surface->height;
-				*tp++ = (vertex.x + surface->origin.x + x) / float(WORLD_ONE);
-				*tp++ = (vertex.y + surface->origin.y + y) / float(WORLD_ONE);
-			}
-		}
-		else
-		{
-			for(short i=0; i<vertex_count; ++i) {
-				world_point2d vertex = get_endpoint_data(polygon->endpoint_indexes[i])->vertex;
+				short endpoint = ceil ? vertex_count - 1 - i : i;
+				world_point2d vertex = get_endpoint_data(polygon->endpoint_indexes[endpoint])->vertex;
 				*vp++ = vertex.x;
 				*vp++ = vertex.y;
 				*vp++ = surface->height;
-				*tp++ = (vertex.x + surface->origin.x + x) / float(WORLD_ONE);
-				*tp++ = (vertex.y + surface->origin.y + y) / float(WORLD_ONE);
+				*tp++ = vertex.x / float(WORLD_ONE);
+				*tp++ = vertex.y / float(WORLD_ONE);
 			}
-		}
-		glVertexPointer(3, GL_FLOAT, 0, vertex_array);
-		glTexCoordPointer(2, GL_FLOAT, 0, texcoord_array);
-
-		glDrawArrays(GL_POLYGON, 0, vertex_count);
-
-		if (setupGlow(view, TMgr, wobble, intensity, weaponFlare, selfLuminosity, offset, renderStep)) {
-			glDrawArrays(GL_POLYGON, 0, vertex_count);
+			build_surface(*cached, vertex_array, texcoord_array, vertex_count, N, T, sign);
 		}
 
-		Shader::disable();
-		glMatrixMode(GL_TEXTURE);
-		glLoadIdentity();
-		glMatrixMode(GL_MODELVIEW);
+		queue_surface(window, texture, surface->transfer_mode, wobble * 4.0, 0, wobble, intensity, offset, renderStep,
+			*cached, (surface->origin.x + x) / float(WORLD_ONE), (surface->origin.y + y) / float(WORLD_ONE), void_present);
 	}
 }
 
@@ -645,19 +993,7 @@ void RenderRasterize_Shader::render_node_side(clipping_window_data *window, vert
 		pulsate = wobble;
 		wobble = 0;
 	}
-	TextureManager TMgr = setupWallTexture(texture, surface->transfer_mode, pulsate, wobble, intensity, offset, renderStep);
-	if(TMgr.ShapeDesc == UNONE) { return; }
-
-	if (TMgr.IsBlended()) {
-		glEnable(GL_BLEND);
-		setupBlendFunc(TMgr.NormalBlend());
-		glEnable(GL_ALPHA_TEST);
-		glAlphaFunc(GL_GREATER, 0.001);
-	} else {
-		glDisable(GL_BLEND);
-		glEnable(GL_ALPHA_TEST);
-		glAlphaFunc(GL_GREATER, 0.5);
-	}
+	if (texture == UNONE) { return; }
 
 //	if (void_present) {
 //		glDisable(GL_BLEND);
@@ -668,6 +1004,27 @@ void RenderRasterize_Shader::render_node_side(clipping_window_data *window, vert
 
 	if (h>surface->h0) {
 
+		world_distance x0 = WORLD_FRACTIONAL_PART(surface->texture_definition->x0);
+		world_distance y0 = WORLD_FRACTIONAL_PART(surface->texture_definition->y0);
+
+		world_distance x = 0.0, y = 0.0;
+		instantiate_transfer_mode(view, surface->transfer_mode, x, y);
+
+		side_data *side = get_side_data(surface->side_index);
+		int which = kPrimarySurface;
+		if (surface->texture_definition == &side->secondary_texture) {
+			which = kSecondarySurface;
+		} else if (surface->texture_definition == &side->transparent_texture) {
+			which = kTransparentSurface;
+		}
+		const int32 key[SURFACE_KEY_LENGTH] = { surface->h0 + view->origin.z, h + view->origin.z, surface->h1 + view->origin.z };
+		CachedSurface *cached;
+		if (find_cached_surface(sideSurfaces, surface->side_index * NUMBER_OF_SIDE_SURFACES + which, key, cached)) {
+			queue_surface(window, texture, surface->transfer_mode, pulsate, wobble, wobble, intensity, offset, renderStep,
+				*cached, (y0 - y) / float(WORLD_ONE), (x0 - x) / float(WORLD_ONE), void_present);
+			return;
+		}
+
 		world_point2d vertex[2];
 		uint16 flags;
 		flagged_world_point3d vertices[MAXIMUM_VERTICES_PER_WORLD_POLYGON];
@@ -679,8 +1036,6 @@ void RenderRasterize_Shader::render_node_side(clipping_window_data *window, vert
 		long_to_overflow_short_2d(surface->p1, vertex[1], flags);
 
 		if (vertex_count) {
-            clip_to_window(window);
-
 			vertex_count= 4;
 			vertices[0].z= vertices[1].z= h + view->origin.z;
 			vertices[2].z= vertices[3].z= surface->h0 + view->origin.z;
@@ -693,22 +1048,11 @@ void RenderRasterize_Shader::render_node_side(clipping_window_data *window, vert
 			double dx = (surface->p1.i - surface->p0.i) / double(surface->length);
 			double dy = (surface->p1.j - surface->p0.j) / double(surface->length);
 
-			world_distance x0 = WORLD_FRACTIONAL_PART(surface->texture_definition->x0);
-			world_distance y0 = WORLD_FRACTIONAL_PART(surface->texture_definition->y0);
-
-			double tOffset = surface->h1 + view->origin.z + y0;
+			double tOffset = surface->h1 + view->origin.z;
 
 			vec3 N(-dy, dx, 0);
 			vec3 T(dx, dy, 0);
 			float sign = 1;
-			glNormal3f(N[0], N[1], N[2]);
-			glMultiTexCoord4fARB(GL_TEXTURE1_ARB, T[0], T[1], T[2], sign);
-
-			world_distance x = 0.0, y = 0.0;
-			instantiate_transfer_mode(view, surface->transfer_mode, x, y);
-
-			x0 -= x;
-			tOffset -= y;
 
 			GLfloat vertex_array[12];
 			GLfloat texcoord_array[8];
@@ -724,23 +1068,236 @@ void RenderRasterize_Shader::render_node_side(clipping_window_data *window, vert
 				*vp++ = vertices[i].y;
 				*vp++ = vertices[i].z;
 				*tp++ = (tOffset - vertices[i].z) / div;
-				*tp++ = (x0+p2) / div;
+				*tp++ = p2 / div;
 			}
-			glVertexPointer(3, GL_FLOAT, 0, vertex_array);
-			glTexCoordPointer(2, GL_FLOAT, 0, texcoord_array);
-			
-			glDrawArrays(GL_QUADS, 0, vertex_count);
 
-			if (setupGlow(view, TMgr, wobble, intensity, weaponFlare, selfLuminosity, offset, renderStep)) {
-				glDrawArrays(GL_QUADS, 0, vertex_count);
-			}
+			build_surface(*cached, vertex_array, texcoord_array, vertex_count, N, T, sign);
+			queue_surface(window, texture, surface->transfer_mode, pulsate, wobble, wobble, intensity, offset, renderStep,
+				*cached, (y0 - y) / float(WORLD_ONE), (x0 - x) / float(WORLD_ONE), void_present);
+		}
+	}
+}
 
-			Shader::disable();
-			glMatrixMode(GL_TEXTURE);
-			glLoadIdentity();
-			glMatrixMode(GL_MODELVIEW);
+/*
+ * find a surface kept from an earlier frame, or make room to build it;
+ * returns whether it was built from what the key holds
+ */
+bool RenderRasterize_Shader::find_cached_surface(std::vector<CachedSurface>& cache, size_t index,
+	const int32 *key, CachedSurface *&surface) {
+
+	if (index >= cache.size()) {
+		cache.resize(index + 1);
+	}
+
+	surface = &cache[index];
+	if (surface->built && std::equal(key, key + SURFACE_KEY_LENGTH, surface->key)) {
+		return true;
+	}
+	std::copy(key, key + SURFACE_KEY_LENGTH, surface->key);
+	surface->built = true;
+	return false;
+}
+
+void RenderRasterize_Shader::build_surface(CachedSurface& surface,
+	const GLfloat *vertex_array, const GLfloat *texcoord_array, short vertex_count,
+	const vec3& N, const vec3& T, float sign) {
+
+	BatchVertex polygon[MAXIMUM_VERTICES_PER_POLYGON];
+	for (short i = 0; i < vertex_count; ++i) {
+		BatchVertex& v = polygon[i];
+		v.vertex[0] = vertex_array[3 * i];
+		v.vertex[1] = vertex_array[3 * i + 1];
+		v.vertex[2] = vertex_array[3 * i + 2];
+		v.texcoord[0] = texcoord_array[2 * i];
+		v.texcoord[1] = texcoord_array[2 * i + 1];
+		v.color[0] = v.color[1] = v.color[2] = v.color[3] = 1.0;
+		v.normal[0] = N[0];
+		v.normal[1] = N[1];
+		v.normal[2] = N[2];
+		v.tangent[0] = T[0];
+		v.tangent[1] = T[1];
+		v.tangent[2] = T[2];
+		v.tangent[3] = sign;
+	}
+
+	// fan out from the first vertex, as GL_POLYGON and GL_QUADS do
+	surface.triangles.clear();
+	for (short i = 1; i + 1 < vertex_count; ++i) {
+		surface.triangles.push_back(polygon[0]);
+		surface.triangles.push_back(polygon[i]);
+		surface.triangles.push_back(polygon[i + 1]);
+	}
+}
+
+/*
+ * queue a wall, floor or ceiling for drawing
+ *
+ * surfaces with the void behind them never overlap others of the same
+ * node, so when sorting is on they join any queued batch with the same
+ * state, and the node's batches are drawn grouped by shader and texture;
+ * other surfaces (liquids, transparent sides) are drawn in the order they
+ * are queued, and a run of them sharing everything but lighting and
+ * orientation becomes one list of triangles
+ */
+void RenderRasterize_Shader::queue_surface(clipping_window_data *window, const shape_descriptor& texture, short transferMode,
+	float pulsate, float wobble, float glowWobble, float intensity, float offset, RenderStep renderStep,
+	const CachedSurface& surface, GLfloat sOffset, GLfloat tOffset, bool sortable) {
+
+	sortable = sortable && Get_OGL_ConfigureData().SortSurfaces;
+	if (change_state(LastQueuedState, texture, transferMode)) {
+		UnsortedStateChanges++;
+	}
+
+	// a surface that must keep its place goes after everything queued
+	// before it, and one that may move must not go before such a surface
+	if (batchCount > 0 && batches[batchCount - 1].sortable != sortable) {
+		flush_surface_batches();
+	}
+
+	SurfaceBatch *batch = NULL;
+	for (size_t i = batchCount; i > 0; --i) {
+		SurfaceBatch& b = batches[i - 1];
+		if (b.window == window && b.texture == texture && b.transfer_mode == transferMode &&
+		    b.pulsate == pulsate && b.wobble == wobble && b.glow_wobble == glowWobble &&
+		    b.offset == offset && b.renderStep == renderStep) {
+			batch = &b;
+			break;
+		}
+		if (!sortable) {
+			break;
+		}
+	}
+
+	if (!batch) {
+		if (!sortable && batchCount > 0) {
+			flush_surface_batches();
 		}
+		if (batchCount == batches.size()) {
+			batches.resize(batchCount + 1);
+		}
+		batch = &batches[batchCount++];
+		batch->window = window;
+		batch->texture = texture;
+		batch->transfer_mode = transferMode;
+		batch->pulsate = pulsate;
+		batch->wobble = wobble;
+		batch->glow_wobble = glowWobble;
+		batch->intensity = intensity;
+		batch->offset = offset;
+		batch->renderStep = renderStep;
+		batch->sortable = sortable;
+		batch->vertices.clear();
+	}
+
+	// the color setupWallTexture() would have set for this surface
+	float shade = intensity;
+	if (current_player->infravision_duration && transferMode != _xfer_static &&
+	    transferMode != _xfer_landscape && transferMode != _xfer_big_landscape) {
+		shade = (renderStep == kDiffuse) ? 1 : 0;
+	}
+
+	size_t first = batch->vertices.size();
+	batch->vertices.insert(batch->vertices.end(), surface.triangles.begin(), surface.triangles.end());
+	for (size_t i = first; i < batch->vertices.size(); ++i) {
+		BatchVertex& v = batch->vertices[i];
+		v.texcoord[0] += sOffset;
+		v.texcoord[1] += tOffset;
+		v.color[0] = v.color[1] = v.color[2] = shade;
+	}
+}
+
+void RenderRasterize_Shader::flush_surface_batches() {
+
+	if (batchCount == 0) { return; }
+
+	// sprites still queued came before these surfaces
+	flush_sprite_batch();
+
+	drawOrder.clear();
+	for (size_t i = 0; i < batchCount; ++i) {
+		drawOrder.push_back(&batches[i]);
+	}
+	if (batches[0].sortable) {
+		std::stable_sort(drawOrder.begin(), drawOrder.end(), batch_before);
+	}
+
+	for (size_t i = 0; i < drawOrder.size(); ++i) {
+		draw_surface_batch(*drawOrder[i]);
+	}
+	batchCount = 0;
+}
+
+void RenderRasterize_Shader::draw_surface_batch(SurfaceBatch& batch) {
+
+	if (batch.vertices.empty()) { return; }
+
+	SurfaceBatchCount++;
+	if (change_state(LastDrawnState, batch.texture, batch.transfer_mode)) {
+		SortedStateChanges++;
+	}
+
+	TextureManager TMgr = setupWallTexture(batch.texture, batch.transfer_mode, batch.pulsate, batch.wobble, batch.intensity, batch.offset, batch.renderStep);
+	if(TMgr.ShapeDesc == UNONE) { return; }
+
+	if (TMgr.IsBlended()) {
+		glEnable(GL_BLEND);
+		setupBlendFunc(TMgr.NormalBlend());
+		glEnable(GL_ALPHA_TEST);
+		glAlphaFunc(GL_GREATER, 0.001);
+	} else {
+		glDisable(GL_BLEND);
+		glEnable(GL_ALPHA_TEST);
+		glAlphaFunc(GL_GREATER, 0.5);
+	}
+
+	clip_to_window(batch.window);
+
+	const char *base = reinterpret_cast<const char *>(&batch.vertices[0]);
+	if (batchBuffer) {
+		glBindBufferARB(GL_ARRAY_BUFFER_ARB, batchBuffer);
+		glBufferDataARB(GL_ARRAY_BUFFER_ARB, batch.vertices.size() * sizeof(BatchVertex), base, GL_STREAM_DRAW_ARB);
+		base = NULL;
+	}
+
+	const GLsizei stride = sizeof(BatchVertex);
+	glVertexPointer(3, GL_FLOAT, stride, base + offsetof(BatchVertex, vertex));
+	glTexCoordPointer(2, GL_FLOAT, stride, base + offsetof(BatchVertex, texcoord));
+	glEnableClientState(GL_COLOR_ARRAY);
+	glColorPointer(4, GL_FLOAT, stride, base + offsetof(BatchVertex, color));
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glNormalPointer(GL_FLOAT, stride, base + offsetof(BatchVertex, normal));
+	glClientActiveTextureARB(GL_TEXTURE1_ARB);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glTexCoordPointer(4, GL_FLOAT, stride, base + offsetof(BatchVertex, tangent));
+	glClientActiveTextureARB(GL_TEXTURE0_ARB);
+
+	GLsizei count = batch.vertices.size();
+	FrameProfiler::CountDrawCall();
+	glDrawArrays(GL_TRIANGLES, 0, count);
+
+	if (setupGlow(view, TMgr, batch.glow_wobble, batch.intensity, weaponFlare, selfLuminosity, batch.offset, batch.renderStep)) {
+		FrameProfiler::CountDrawCall();
+		glDrawArrays(GL_TRIANGLES, 0, count);
+	}
+
+	glClientActiveTextureARB(GL_TEXTURE1_ARB);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glClientActiveTextureARB(GL_TEXTURE0_ARB);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_COLOR_ARRAY);
+	if (batchBuffer) {
+		glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
 	}
+
+	// sprites drawn after this still see the last surface's normal and tangent
+	const BatchVertex& last = batch.vertices.back();
+	glNormal3f(last.normal[0], last.normal[1], last.normal[2]);
+	glMultiTexCoord4fARB(GL_TEXTURE1_ARB, last.tangent[0], last.tangent[1], last.tangent[2], last.tangent[3]);
+
+	Shader::disable();
+	glMatrixMode(GL_TEXTURE);
+	glLoadIdentity();
+	glMatrixMode(GL_MODELVIEW);
 }
 
 extern void FlatBumpTexture(); // from OGL_Textures.cpp
@@ -778,19 +1335,16 @@ bool RenderModel(rectangle_definition& RenderRectangle, short Collection, short
 	color[0] = color[1] = color[2] = shade;
 	glColor4f(color[0], color[1], color[2], 1.0);
 
-	Shader *s = NULL;
+	Shader::ShaderType shaderType = Shader::NUMBER_OF_SHADER_TYPES;
 	bool canGlow = false;
 	switch(RenderRectangle.transfer_mode) {
 		case _static_transfer:
 			flare = -1;
-			s = Shader::get(renderStep == kGlow ? Shader::S_InvincibleBloom : Shader::S_Invincible);
-			s->enable();
+			shaderType = renderStep == kGlow ? Shader::S_InvincibleBloom : Shader::S_Invincible;
 			break;
 		case _tinted_transfer:
 			flare = -1;
-			s = Shader::get(renderStep == kGlow ? Shader::S_InvisibleBloom : Shader::S_Invisible);
-			s->enable();
-			s->setFloat(Shader::U_Visibility, 1.0 - RenderRectangle.transfer_data/32.0f);
+			shaderType = renderStep == kGlow ? Shader::S_InvisibleBloom : Shader::S_Invisible;
 			break;
 		case _solid_transfer:
 			glColor4f(0,1,0,1);
@@ -811,13 +1365,63 @@ bool RenderModel(rectangle_definition& RenderRectangle, short Collection, short
 			glColor4f(0,0,1,1);
 	}
 
-	if(s == NULL) {
+	if(shaderType == Shader::NUMBER_OF_SHADER_TYPES) {
 		if(TEST_FLAG(Get_OGL_ConfigureData().Flags, OGL_Flag_BumpMap)) {
-			s = Shader::get(renderStep == kGlow ? Shader::S_BumpBloom : Shader::S_Bump);
+			shaderType = renderStep == kGlow ? Shader::S_BumpBloom : Shader::S_Bump;
 		} else {
-			s = Shader::get(renderStep == kGlow ? Shader::S_WallBloom : Shader::S_Wall);
+			shaderType = renderStep == kGlow ? Shader::S_WallBloom : Shader::S_Wall;
+		}
+	}
+
+	// Animate the model in the vertex shader, from its static buffers, when it
+	// has few enough bones; otherwise find its vertices here, as OGL_Render does
+	Model3D& Model = ModelPtr->GetModel(RenderRectangle.ModelLOD);
+	GLfloat skinMatrices[12*Shader::MAX_SKIN_MATRICES];
+	Shader *s = NULL;
+	if (Model.NumSkinMatrices() <= Shader::MAX_SKIN_MATRICES) {
+		s = Shader::getSkinned(shaderType);
+	}
+	if (s && !ModelPtr->BindBuffers(RenderRectangle.ModelLOD)) {
+		s = NULL;
+	}
+	bool skinned = (s != NULL);
+
+	bool posed = false;
+	short ModelSequence = RenderRectangle.ModelSequence;
+	if (ModelSequence >= 0) {
+		int NumFrames = Model.NumSeqFrames(ModelSequence);
+		if (NumFrames > 0) {
+			short ModelFrame = PIN(RenderRectangle.ModelFrame,0,NumFrames-1);
+			short NextModelFrame = PIN(RenderRectangle.NextModelFrame,0,NumFrames-1);
+			float MixFrac = RenderRectangle.MixFrac;
+			if (skinned) {
+				posed = Model.FindSkinMatrices_Sequence(skinMatrices,
+					ModelSequence,ModelFrame,MixFrac,NextModelFrame);
+			} else {
+				Model.FindPositions_Sequence(true,
+					ModelSequence,ModelFrame,MixFrac,NextModelFrame);
+				posed = true;
+			}
+		}
+	}
+	if (!posed) {
+		// Fallback: neutral (does nothing for static models on the CPU)
+		if (skinned) {
+			Model.FindSkinMatrices_Neutral(skinMatrices);
+		} else {
+			Model.FindPositions_Neutral(true);
 		}
-		s->enable();
+	}
+
+	if (!skinned) {
+		s = Shader::get(shaderType);
+	}
+	s->enable();
+	if (skinned) {
+		s->setVec4(Shader::U_ModelBones, skinMatrices, 3*Model.NumSkinMatrices());
+	}
+	if (RenderRectangle.transfer_mode == _tinted_transfer) {
+		s->setFloat(Shader::U_Visibility, 1.0 - RenderRectangle.transfer_data/32.0f);
 	}
 
 	if (renderStep == kGlow) {
@@ -830,37 +1434,60 @@ bool RenderModel(rectangle_definition& RenderRectangle, short Collection, short
 	s->setFloat(Shader::U_Depth, 0);
 	s->setFloat(Shader::U_Glow, 0);
 
-	glVertexPointer(3,GL_FLOAT,0,ModelPtr->Model.PosBase());
-	glClientActiveTextureARB(GL_TEXTURE0_ARB);
-	if (ModelPtr->Model.TxtrCoords.empty()) {
-		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	const GLvoid *indices = NULL;
+	if (skinned) {
+		// offsets into the bound buffers
+		const GLsizei stride = sizeof(OGL_ModelVertex);
+		const char *base = NULL;
+		glVertexPointer(3,GL_FLOAT,stride,base + offsetof(OGL_ModelVertex,Position));
+		glClientActiveTextureARB(GL_TEXTURE0_ARB);
+		glTexCoordPointer(2,GL_FLOAT,stride,base + offsetof(OGL_ModelVertex,TxtrCoord));
+
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glNormalPointer(GL_FLOAT,stride,base + offsetof(OGL_ModelVertex,Normal));
+
+		glClientActiveTextureARB(GL_TEXTURE1_ARB);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glTexCoordPointer(4,GL_FLOAT,stride,base + offsetof(OGL_ModelVertex,Tangent));
+
+		glClientActiveTextureARB(GL_TEXTURE2_ARB);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glTexCoordPointer(3,GL_FLOAT,stride,base + offsetof(OGL_ModelVertex,SkinWeights));
 	} else {
-		glTexCoordPointer(2,GL_FLOAT,0,ModelPtr->Model.TCBase());
-	}
+		indices = Model.VIBase();
+		glVertexPointer(3,GL_FLOAT,0,Model.PosBase());
+		glClientActiveTextureARB(GL_TEXTURE0_ARB);
+		if (Model.TxtrCoords.empty()) {
+			glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+		} else {
+			glTexCoordPointer(2,GL_FLOAT,0,Model.TCBase());
+		}
 
-	glEnableClientState(GL_NORMAL_ARRAY);
-	glNormalPointer(GL_FLOAT,0,ModelPtr->Model.NormBase());
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glNormalPointer(GL_FLOAT,0,Model.NormBase());
 
-	glClientActiveTextureARB(GL_TEXTURE1_ARB);
-	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-	glTexCoordPointer(4,GL_FLOAT,sizeof(vec4),ModelPtr->Model.TangentBase());
+		glClientActiveTextureARB(GL_TEXTURE1_ARB);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glTexCoordPointer(4,GL_FLOAT,sizeof(vec4),Model.TangentBase());
+	}
 
 	if(ModelPtr->Use(CLUT,OGL_SkinManager::Normal)) {
 		LoadModelSkin(SkinPtr->NormalImg, Collection, CLUT);
 	}
 
 	if(TEST_FLAG(Get_OGL_ConfigureData().Flags, OGL_Flag_BumpMap)) {
-		glActiveTextureARB(GL_TEXTURE1_ARB);
+		OGL_ActiveTexture(GL_TEXTURE1_ARB);
 		if(ModelPtr->Use(CLUT,OGL_SkinManager::Bump)) {
 			LoadModelSkin(SkinPtr->OffsetImg, Collection, CLUT);
 		}
 		if (!SkinPtr->OffsetImg.IsPresent()) {
 			FlatBumpTexture();
 		}
-		glActiveTextureARB(GL_TEXTURE0_ARB);
+		OGL_ActiveTexture(GL_TEXTURE0_ARB);
 	}
 
-	glDrawElements(GL_TRIANGLES,(GLsizei)ModelPtr->Model.NumVI(),GL_UNSIGNED_SHORT,ModelPtr->Model.VIBase());
+	FrameProfiler::CountDrawCall();
+	glDrawElements(GL_TRIANGLES,(GLsizei)Model.NumVI(),GL_UNSIGNED_SHORT,indices);
 
 	if (canGlow && SkinPtr->GlowImg.IsPresent()) {
 		glEnable(GL_BLEND);
@@ -878,13 +1505,20 @@ bool RenderModel(rectangle_definition& RenderRectangle, short Collection, short
 		if(ModelPtr->Use(CLUT,OGL_SkinManager::Glowing)) {
 			LoadModelSkin(SkinPtr->GlowImg, Collection, CLUT);
 		}
-		glDrawElements(GL_TRIANGLES,(GLsizei)ModelPtr->Model.NumVI(),GL_UNSIGNED_SHORT,ModelPtr->Model.VIBase());
+		FrameProfiler::CountDrawCall();
+		glDrawElements(GL_TRIANGLES,(GLsizei)Model.NumVI(),GL_UNSIGNED_SHORT,indices);
 	}
 
 	glDisableClientState(GL_NORMAL_ARRAY);
 	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	if (skinned) {
+		glClientActiveTextureARB(GL_TEXTURE1_ARB);
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+		glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+		glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+	}
 	glClientActiveTextureARB(GL_TEXTURE0_ARB);
-	if (ModelPtr->Model.TxtrCoords.empty()) {
+	if (!skinned && Model.TxtrCoords.empty()) {
 		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
 	}
 
@@ -897,6 +1531,9 @@ bool RenderModel(rectangle_definition& RenderRectangle, short Collection, short
 
 void RenderRasterize_Shader::render_node_object(render_object_data *object, bool other_side_of_media, RenderStep renderStep) {
 
+	// surfaces queued so far must be behind this object
+	flush_surface_batches();
+
     if (!object->clipping_windows)
         return;
 
@@ -907,15 +1544,16 @@ void RenderRasterize_Shader::render_node_object(render_object_data *object, bool
 	// software renderer.
 	short media_index = get_polygon_data(object->node->polygon_index)->media_index;
 	media_data *media = (media_index != NONE) ? get_media_data(media_index) : NULL;
+	objectMediaClipped = (media != NULL);
 	if (media) {
 		float h = media->height;
-		GLdouble plane[] = { 0.0, 0.0, 1.0, -h };
+		objectMediaPlane[0] = objectMediaPlane[1] = 0.0;
+		objectMediaPlane[2] = 1.0;
+		objectMediaPlane[3] = -h;
 		if (view->under_media_boundary ^ other_side_of_media) {
-			plane[2] = -1.0;
-			plane[3] = h;
+			objectMediaPlane[2] = -1.0;
+			objectMediaPlane[3] = h;
 		}
-		glClipPlane(GL_CLIP_PLANE5, plane);
-		glEnable(GL_CLIP_PLANE5);
 	} else if (other_side_of_media) {
 		// When there's no media present, we can skip the second pass.
 		return;
@@ -923,19 +1561,25 @@ void RenderRasterize_Shader::render_node_object(render_object_data *object, bool
 
     for (win = object->clipping_windows; win; win = win->next_window)
     {
-        clip_to_window(win);
-        _render_node_object_helper(object, renderStep);
+        _render_node_object_helper(object, win, renderStep);
     }
-    
-    glDisable(GL_CLIP_PLANE5);
 }
 
-void RenderRasterize_Shader::_render_node_object_helper(render_object_data *object, RenderStep renderStep) {
+void RenderRasterize_Shader::_render_node_object_helper(render_object_data *object, clipping_window_data *win, RenderStep renderStep) {
 
 	rectangle_definition& rect = object->rectangle;
 	const world_point3d& pos = rect.Position;
     
 	if(rect.ModelPtr) {
+		if (model_occluded(object)) {
+			return;
+		}
+		flush_sprite_batch();
+		clip_to_window(win);
+		if (objectMediaClipped) {
+			glClipPlane(GL_CLIP_PLANE5, objectMediaPlane);
+			glEnable(GL_CLIP_PLANE5);
+		}
 		glPushMatrix();
 		glTranslated(pos.x, pos.y, pos.z);
 		glRotated((360.0/FULL_CIRCLE)*rect.Azimuth,0,0,1);
@@ -948,15 +1592,10 @@ void RenderRasterize_Shader::_render_node_object_helper(render_object_data *obje
 
 		RenderModel(rect, collection, clut, weaponFlare, selfLuminosity, renderStep);
 		glPopMatrix();
+		glDisable(GL_CLIP_PLANE5);
 		return;
 	}
 
-	glPushMatrix();
-	glTranslated(pos.x, pos.y, pos.z);
-
-	double yaw = view->yaw * 360.0 / float(NUMBER_OF_ANGLES);
-	glRotated(yaw, 0.0, 0.0, 1.0);
-
 	float offset = 0;
 	if (OGL_ForceSpriteDepth()) {
 		// look for parasitic objects based on y position,
@@ -968,79 +1607,159 @@ void RenderRasterize_Shader::_render_node_object_helper(render_object_data *obje
 			objectCount = 0;
 			objectY = pos.y;
 		}
-	} else {
-		glDisable(GL_DEPTH_TEST);
 	}
 
-	TextureManager TMgr = setupSpriteTexture(rect, OGL_Txtr_Inhabitant, offset, renderStep);
-	if (TMgr.ShapeDesc == UNONE) { glPopMatrix(); return; }
+	queue_sprite(rect, win, offset, renderStep);
+}
 
-	float texCoords[2][2];
+static bool same_window(const clipping_window_data *a, const clipping_window_data *b)
+{
+	return a == b || (a->left.i == b->left.i && a->left.j == b->left.j &&
+	                  a->right.i == b->right.i && a->right.j == b->right.j);
+}
 
-	if(rect.flip_vertical) {
-		texCoords[0][1] = TMgr.U_Offset;
-		texCoords[0][0] = TMgr.U_Scale+TMgr.U_Offset;
-	} else {
-		texCoords[0][0] = TMgr.U_Offset;
-		texCoords[0][1] = TMgr.U_Scale+TMgr.U_Offset;
+/*
+ * queue a sprite for drawing
+ *
+ * sprites are drawn in the order they come, without depth testing unless
+ * sprite depth is forced, so only a run of them with the same texture,
+ * transfer mode and clipping becomes one list of triangles; each is
+ * turned to face the view here rather than by the modelview matrix
+ */
+void RenderRasterize_Shader::queue_sprite(const rectangle_definition& rect, clipping_window_data *win, float offset, RenderStep renderStep) {
+
+	SpriteBatch& batch = spriteBatch;
+	if (!batch.vertices.empty()) {
+		const rectangle_definition& first = batch.rect;
+		bool same = first.ShapeDesc == rect.ShapeDesc && first.LowLevelShape == rect.LowLevelShape &&
+			first.texture == rect.texture && first.shading_tables == rect.shading_tables &&
+			first.transfer_mode == rect.transfer_mode && first.transfer_data == rect.transfer_data &&
+			(first.flags&_SHADELESS_BIT) == (rect.flags&_SHADELESS_BIT) &&
+			batch.offset == offset && batch.renderStep == renderStep &&
+			same_window(batch.window, win) && batch.mediaClipped == objectMediaClipped &&
+			(!objectMediaClipped || (batch.mediaPlane[2] == objectMediaPlane[2] && batch.mediaPlane[3] == objectMediaPlane[3]));
+		if (!same) {
+			flush_sprite_batch();
+		}
 	}
 
-	if(rect.flip_horizontal) {
-		texCoords[1][1] = TMgr.V_Offset;
-		texCoords[1][0] = TMgr.V_Scale+TMgr.V_Offset;
-	} else {
-		texCoords[1][0] = TMgr.V_Offset;
-		texCoords[1][1] = TMgr.V_Scale+TMgr.V_Offset;
+	if (batch.vertices.empty()) {
+		batch.rect = rect;
+		batch.window = win;
+		batch.offset = offset;
+		batch.renderStep = renderStep;
+		batch.mediaClipped = objectMediaClipped;
+		for (int i = 0; i < 4; ++i) {
+			batch.mediaPlane[i] = objectMediaPlane[i];
+		}
 	}
 
-	if(TMgr.IsBlended() || TMgr.TransferMode == _tinted_transfer) {
-		glEnable(GL_BLEND);
-		setupBlendFunc(TMgr.NormalBlend());
-		glEnable(GL_ALPHA_TEST);
-		glAlphaFunc(GL_GREATER, 0.001);
-	} else {
-		glDisable(GL_BLEND);
-		glEnable(GL_ALPHA_TEST);
-		glAlphaFunc(GL_GREATER, 0.5);
-	}
+	GLfloat color[4];
+	sprite_color(rect, renderStep, color);
 
-	GLfloat vertex_array[12] = {
-		0,
-		rect.WorldLeft * rect.HorizScale * rect.Scale,
-		rect.WorldTop * rect.Scale,
-		0,
-		rect.WorldRight * rect.HorizScale * rect.Scale,
-		rect.WorldTop * rect.Scale,
-		0,
-		rect.WorldRight * rect.HorizScale * rect.Scale,
-		rect.WorldBottom * rect.Scale,
-		0,
-		rect.WorldLeft * rect.HorizScale * rect.Scale,
-		rect.WorldBottom * rect.Scale
+	// in texture units; flipped to the texture's scale and offset once
+	// it is set up
+	GLfloat u0 = rect.flip_vertical ? 1 : 0;
+	GLfloat v0 = rect.flip_horizontal ? 1 : 0;
+	const GLfloat texcoords[4][2] = {
+		{ u0, v0 }, { u0, 1 - v0 }, { 1 - u0, 1 - v0 }, { 1 - u0, v0 }
 	};
 
-	GLfloat texcoord_array[8] = {
-		texCoords[0][0],
-		texCoords[1][0],
-		texCoords[0][0],
-		texCoords[1][1],
-		texCoords[0][1],
-		texCoords[1][1],
-		texCoords[0][1],
-		texCoords[1][0]
+	GLfloat left = rect.WorldLeft * rect.HorizScale * rect.Scale;
+	GLfloat right = rect.WorldRight * rect.HorizScale * rect.Scale;
+	GLfloat top = rect.WorldTop * rect.Scale;
+	GLfloat bottom = rect.WorldBottom * rect.Scale;
+	const GLfloat corners[4][2] = {
+		{ left, top }, { right, top }, { right, bottom }, { left, bottom }
 	};
 
-	glVertexPointer(3, GL_FLOAT, 0, vertex_array);
-	glTexCoordPointer(2, GL_FLOAT, 0, texcoord_array);
+	double yaw = view->yaw * TWO_PI / double(NUMBER_OF_ANGLES);
+	GLfloat c = cos(yaw);
+	GLfloat s = sin(yaw);
+
+	SpriteVertex quad[4];
+	for (int i = 0; i < 4; ++i) {
+		SpriteVertex& v = quad[i];
+		v.vertex[0] = rect.Position.x - corners[i][0] * s;
+		v.vertex[1] = rect.Position.y + corners[i][0] * c;
+		v.vertex[2] = rect.Position.z + corners[i][1];
+		v.texcoord[0] = texcoords[i][0];
+		v.texcoord[1] = texcoords[i][1];
+		for (int j = 0; j < 4; ++j) {
+			v.color[j] = color[j];
+		}
+	}
+
+	const int fan[6] = { 0, 1, 2, 0, 2, 3 };
+	for (int i = 0; i < 6; ++i) {
+		batch.vertices.push_back(quad[fan[i]]);
+	}
+}
+
+void RenderRasterize_Shader::flush_sprite_batch() {
+
+	SpriteBatch& batch = spriteBatch;
+	if (batch.vertices.empty()) { return; }
+
+	if (batch.mediaClipped) {
+		glClipPlane(GL_CLIP_PLANE5, batch.mediaPlane);
+		glEnable(GL_CLIP_PLANE5);
+	}
+	clip_to_window(batch.window);
+	if (!OGL_ForceSpriteDepth()) {
+		glDisable(GL_DEPTH_TEST);
+	}
+
+	TextureManager TMgr = setupSpriteTexture(batch.rect, OGL_Txtr_Inhabitant, batch.offset, batch.renderStep);
+	if (TMgr.ShapeDesc != UNONE) {
+		for (size_t i = 0; i < batch.vertices.size(); ++i) {
+			SpriteVertex& v = batch.vertices[i];
+			v.texcoord[0] = v.texcoord[0] * TMgr.U_Scale + TMgr.U_Offset;
+			v.texcoord[1] = v.texcoord[1] * TMgr.V_Scale + TMgr.V_Offset;
+		}
+
+		if(TMgr.IsBlended() || TMgr.TransferMode == _tinted_transfer) {
+			glEnable(GL_BLEND);
+			setupBlendFunc(TMgr.NormalBlend());
+			glEnable(GL_ALPHA_TEST);
+			glAlphaFunc(GL_GREATER, 0.001);
+		} else {
+			glDisable(GL_BLEND);
+			glEnable(GL_ALPHA_TEST);
+			glAlphaFunc(GL_GREATER, 0.5);
+		}
+
+		const char *base = reinterpret_cast<const char *>(&batch.vertices[0]);
+		if (batchBuffer) {
+			glBindBufferARB(GL_ARRAY_BUFFER_ARB, batchBuffer);
+			glBufferDataARB(GL_ARRAY_BUFFER_ARB, batch.vertices.size() * sizeof(SpriteVertex), base, GL_STREAM_DRAW_ARB);
+			base = NULL;
+		}
+
+		const GLsizei stride = sizeof(SpriteVertex);
+		glVertexPointer(3, GL_FLOAT, stride, base + offsetof(SpriteVertex, vertex));
+		glTexCoordPointer(2, GL_FLOAT, stride, base + offsetof(SpriteVertex, texcoord));
+		glEnableClientState(GL_COLOR_ARRAY);
+		glColorPointer(4, GL_FLOAT, stride, base + offsetof(SpriteVertex, color));
 
-	glDrawArrays(GL_QUADS, 0, 4);
+		GLsizei count = batch.vertices.size();
+		FrameProfiler::CountDrawCall();
+		glDrawArrays(GL_TRIANGLES, 0, count);
 
-	if (setupGlow(view, TMgr, 0, 1, weaponFlare, selfLuminosity, offset, renderStep)) {
-		glDrawArrays(GL_QUADS, 0, 4);
+		if (setupGlow(view, TMgr, 0, 1, weaponFlare, selfLuminosity, batch.offset, batch.renderStep)) {
+			FrameProfiler::CountDrawCall();
+			glDrawArrays(GL_TRIANGLES, 0, count);
+		}
+
+		glDisableClientState(GL_COLOR_ARRAY);
+		if (batchBuffer) {
+			glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+		}
 	}
 
 	glEnable(GL_DEPTH_TEST);
-	glPopMatrix();
+	glDisable(GL_CLIP_PLANE5);
 	Shader::disable();
 	TMgr.RestoreTextureMatrix();
+	batch.vertices.clear();
 }
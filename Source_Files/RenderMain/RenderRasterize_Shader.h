@@ -16,8 +16,10 @@
 #include "OGL_FBO.h"
 #include "OGL_Textures.h"
 #include "Rasterizer_Shader.h"
+#include "vec3.h"
 
 #include <memory>
+#include <vector>
 
 class Blur;
 class RenderRasterize_Shader : public RenderRasterizerClass {
@@ -32,6 +34,118 @@ class RenderRasterize_Shader : public RenderRasterizerClass {
 	
 	long_vector2d leftmost_clip, rightmost_clip;
 
+	// One vertex of a queued wall, floor or ceiling; intensity, normal and
+	// tangent are carried per vertex so that surfaces lit differently can
+	// still share a draw call
+	struct BatchVertex {
+		GLfloat vertex[3];
+		GLfloat texcoord[2];
+		GLfloat color[4];
+		GLfloat normal[3];
+		GLfloat tangent[4];
+	};
+
+	// Surfaces of a node which share texture, shader and clipping state,
+	// drawn as one list of triangles; sortable batches may be drawn in any
+	// order with respect to each other
+	struct SurfaceBatch {
+		clipping_window_data *window;
+		shape_descriptor texture;
+		short transfer_mode;
+		float pulsate, wobble, glow_wobble;
+		float intensity;
+		float offset;
+		RenderStep renderStep;
+		bool sortable;
+		std::vector<BatchVertex> vertices;
+	};
+
+	// batches waiting to be drawn; only the first batchCount are in use,
+	// the rest keep their storage for later nodes
+	std::vector<SurfaceBatch> batches;
+	size_t batchCount;
+	std::vector<SurfaceBatch *> drawOrder;
+	static bool batch_before(const SurfaceBatch *a, const SurfaceBatch *b);
+
+	GLuint batchBuffer;
+
+	// Walls, floors, ceilings and liquid surfaces as they are queued, but
+	// for lighting and texture offsets; kept from frame to frame, and built
+	// again only once the heights they were built from have changed
+	enum { SURFACE_KEY_LENGTH = 3 };
+	struct CachedSurface {
+		bool built;
+		int32 key[SURFACE_KEY_LENGTH];
+		std::vector<BatchVertex> triangles;
+	};
+	enum { kFloorSurface, kCeilingSurface, kMediaSurface, NUMBER_OF_POLYGON_SURFACES };
+	enum { kPrimarySurface, kSecondarySurface, kTransparentSurface, NUMBER_OF_SIDE_SURFACES };
+	std::vector<CachedSurface> polygonSurfaces; // by polygon, then surface
+	std::vector<CachedSurface> sideSurfaces; // by side, then surface
+	uint32 surfaceCacheMap; // map_load_count when they were kept
+	short nodePolygonIndex;
+	bool find_cached_surface(std::vector<CachedSurface>& cache, size_t index,
+		const int32 *key, CachedSurface *&surface);
+	static void build_surface(CachedSurface& surface,
+		const GLfloat *vertex_array, const GLfloat *texcoord_array, short vertex_count,
+		const vec3& N, const vec3& T, float sign);
+
+	// whether every textured shader takes the infravision tint uniform
+	bool shaderTinting;
+
+	// whether every program that reads a substitute's alpha takes the
+	// opacity adjustment uniform
+	bool shaderOpacity;
+
+	// One corner of a queued sprite, already turned to face the view
+	struct SpriteVertex {
+		GLfloat vertex[3];
+		GLfloat texcoord[2];
+		GLfloat color[4];
+	};
+
+	// A run of sprites drawn one after another with the same texture,
+	// transfer mode and clipping, drawn as one list of triangles
+	struct SpriteBatch {
+		rectangle_definition rect; // the first sprite's
+		clipping_window_data *window;
+		float offset;
+		RenderStep renderStep;
+		bool mediaClipped;
+		GLdouble mediaPlane[4];
+		std::vector<SpriteVertex> vertices;
+	};
+	SpriteBatch spriteBatch;
+
+	// the liquid surface clipping the object being drawn, if any
+	bool objectMediaClipped;
+	GLdouble objectMediaPlane[4];
+
+	// Occlusion culling of models: each model's bounding box is tested
+	// against the depth buffer once the world is drawn, and a model whose
+	// box showed nothing in one frame is skipped in the next
+	struct ModelOcclusion {
+		GLuint query;
+		uint32 frameQueried; // whose result the query holds; 0 for none
+		uint32 frameDecided;
+		bool occluded;
+	};
+	std::vector<ModelOcclusion> modelOcclusion; // by object index
+
+	// models to test at the end of this frame, and where they are
+	struct OcclusionTest {
+		short objectIndex;
+		world_point3d position;
+		angle azimuth;
+		GLfloat horizScale, scale;
+		GLfloat box[2][3];
+	};
+	std::vector<OcclusionTest> occlusionTests;
+	uint32 occlusionFrame;
+	bool occlusionQueries;
+	bool model_occluded(render_object_data *object);
+	void test_model_occlusion();
+
 protected:
 	virtual void render_node(sorted_node_data *node, bool SeeThruLiquids, RenderStep renderStep);	
 	virtual void store_endpoint(endpoint_data *endpoint, long_vector2d& p);
@@ -46,7 +160,15 @@ protected:
 	virtual void render_node_object(render_object_data *object, bool other_side_of_media, RenderStep renderStep);
 	
 	virtual void clip_to_window(clipping_window_data *win);
-	virtual void _render_node_object_helper(render_object_data *object, RenderStep renderStep);
+	virtual void _render_node_object_helper(render_object_data *object, clipping_window_data *win, RenderStep renderStep);
+
+	void queue_surface(clipping_window_data *window, const shape_descriptor& texture, short transferMode,
+		float pulsate, float wobble, float glowWobble, float intensity, float offset, RenderStep renderStep,
+		const CachedSurface& surface, GLfloat sOffset, GLfloat tOffset, bool sortable);
+	void flush_surface_batches();
+	void draw_surface_batch(SurfaceBatch& batch);
+	void queue_sprite(const rectangle_definition& rect, clipping_window_data *win, float offset, RenderStep renderStep);
+	void flush_sprite_batch();
 	
 public:
 
@@ -178,22 +178,11 @@ void RenderSortPolyClass::sort_render_tree()
 //			dprintf("removed polygon #%d (#%d aliases)", leaf->polygon_index, alias_count);
 			
 			size_t Length = SortedNodes.size();
-			POINTER_DATA OldSNPointer = POINTER_CAST(&SortedNodes.front());
 				
-			// Add a dummy object and check if the pointer got changed
+			// Add a dummy object; the ones before it stay where they are
 			sorted_node_data Dummy;
 			Dummy.polygon_index = NONE;			// Fake initialization to shut up CW
 			SortedNodes.push_back(Dummy);
-			POINTER_DATA NewSNPointer = POINTER_CAST(&SortedNodes.front());
-				
-			if (NewSNPointer != OldSNPointer)
-			{
-				// Update what uses the sorted-node pointers
-				for (size_t k=0; k<Length; k++) {
-					sorted_node = &SortedNodes[k];
-					polygon_index_to_sorted_node[sorted_node->polygon_index]= sorted_node;
-				}
-			}
 			sorted_node = &SortedNodes[Length];
 			
 			sorted_node->polygon_index= leaf->polygon_index;
@@ -248,9 +237,9 @@ clipping_window_data *RenderSortPolyClass::build_clipping_windows(
 	short i, j;
 
 	// LP: references to simplify the code
-	vector<endpoint_clip_data>& EndpointClips = RVPtr->EndpointClips;
-	vector<line_clip_data>& LineClips = RVPtr->LineClips;
-	vector<clipping_window_data>& ClippingWindows = RVPtr->ClippingWindows;
+	RenderArena<endpoint_clip_data>& EndpointClips = RVPtr->EndpointClips;
+	RenderArena<line_clip_data>& LineClips = RVPtr->LineClips;
+	RenderArena<clipping_window_data>& ClippingWindows = RVPtr->ClippingWindows;
 	vector<short>& endpoint_x_coordinates = RVPtr->endpoint_x_coordinates;
 	
 	/* calculate x0,x1 (real left and right borders of this node) in case the left and right borders
@@ -393,30 +382,11 @@ clipping_window_data *RenderSortPolyClass::build_clipping_windows(
 				{
 					// LP change: clipping windows are in growable list
 					size_t Length = ClippingWindows.size();
-					POINTER_DATA OldCWPointer = POINTER_CAST(&ClippingWindows.front());
 					
-					// Add a dummy object and check if the pointer got changed
+					// Add a dummy object; the windows and sorted nodes pointing at the others stay good
 					clipping_window_data Dummy;
 					Dummy.next_window = NULL;			// Fake initialization to shut up CW
 					ClippingWindows.push_back(Dummy);
-					POINTER_DATA NewCWPointer = POINTER_CAST(&ClippingWindows.front());
-				
-					if (NewCWPointer != OldCWPointer)
-					{
-						// Get the clipping windows and sorted nodes into sync; no render objects yet
-						for (size_t k=0; k<Length; k++)
-						{
-							clipping_window_data &ClippingWindow = ClippingWindows[k];
-							if (ClippingWindow.next_window != NULL)
-								ClippingWindow.next_window = (clipping_window_data *)(NewCWPointer + (POINTER_CAST(ClippingWindow.next_window) - OldCWPointer));
-						}
-						for (size_t k=0; k<SortedNodes.size(); k++)
-						{
-							sorted_node_data &SortedNode = SortedNodes[k];
-							if (SortedNode.clipping_windows != NULL)
-								SortedNode.clipping_windows = (clipping_window_data *)(NewCWPointer + (POINTER_CAST(SortedNode.clipping_windows) - OldCWPointer));
-						}
-					}
 					clipping_window_data *window= &ClippingWindows[Length];
 					
 					/* handle maintaining the linked list of clipping windows */
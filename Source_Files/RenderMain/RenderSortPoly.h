@@ -73,7 +73,7 @@ public:
 	// LP additions: growable list of sorted nodes
 	// Length changed in initialize_sorted_render_tree() and sort_render_tree()
 	// When being built, the render objects are yet to be listed
-	vector<sorted_node_data> SortedNodes;
+	RenderArena<sorted_node_data> SortedNodes;
 	
 	// LP addition: growable lists of accumulations of endpoint and line clips
 	// used in build_clipping_windows()
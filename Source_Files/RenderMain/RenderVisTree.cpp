@@ -38,6 +38,8 @@ Oct 13, 2000
 #include "map.h"
 #include "RenderVisTree.h"
 
+#include <algorithm>
+
 
 // LP: "recommended" sizes of stuff in growable lists
 #define POLYGON_QUEUE_SIZE 256
@@ -83,6 +85,7 @@ inline void INITIALIZE_NODE(node_data *node, short node_polygon_index, uint16 no
 
 // Inits everything
 RenderVisTreeClass::RenderVisTreeClass():
+	tree_kept(false), kept_map_load_count(0),
 	view(NULL), mark_as_explored(false), add_to_automap(true)
 {
 	PolygonQueue.reserve(POLYGON_QUEUE_SIZE);
@@ -110,6 +113,7 @@ void RenderVisTreeClass::PUSH_POLYGON_INDEX(short polygon_index)
 		else
 			PolygonQueue.push_back(polygon_index);
 		polygon_queue_size++;
+		VisitedPolygons.push_back(polygon_index);
 		
 		// polygon_queue[polygon_queue_size++]= polygon_index;
 		SET_RENDER_FLAG(polygon_index, _polygon_is_visible);
@@ -121,6 +125,11 @@ void RenderVisTreeClass::build_render_tree()
 {
 	assert(view);	// Idiot-proofing
 
+	if (restore_render_tree()) return;
+	VisitedPolygons.clear();
+	AutomapLines.clear();
+	KeptEndpoints.clear();
+
 	/* initialize the queue where we remember polygons we need to fire at */
 	initialize_polygon_queue();
 
@@ -188,9 +197,134 @@ void RenderVisTreeClass::build_render_tree()
 				}
 				
 				SET_RENDER_FLAG(endpoint_index, _endpoint_has_been_visited);
+				kept_endpoint_data kept= { endpoint_index, ENDPOINT_IS_TRANSPARENT(endpoint) != 0 };
+				KeptEndpoints.push_back(kept);
 			}
 		}
 	}
+	
+	keep_render_tree();
+}
+
+static bool same_vector(const world_vector2d& a, const world_vector2d& b)
+{
+	return a.i==b.i && a.j==b.j;
+}
+
+/* whether two views see the same tree: everything build_render_tree() reads from them */
+static bool same_view_for_tree(const view_data& a, const view_data& b)
+{
+	return a.origin.x==b.origin.x && a.origin.y==b.origin.y && a.origin.z==b.origin.z &&
+		a.origin_polygon_index==b.origin_polygon_index && a.yaw==b.yaw && a.dtanpitch==b.dtanpitch &&
+		a.screen_width==b.screen_width && a.screen_height==b.screen_height &&
+		a.half_screen_width==b.half_screen_width && a.half_screen_height==b.half_screen_height &&
+		a.world_to_screen_x==b.world_to_screen_x && a.world_to_screen_y==b.world_to_screen_y &&
+		same_vector(a.untransformed_left_edge, b.untransformed_left_edge) &&
+		same_vector(a.untransformed_right_edge, b.untransformed_right_edge) &&
+		same_vector(a.left_edge, b.left_edge) && same_vector(a.right_edge, b.right_edge) &&
+		same_vector(a.top_edge, b.top_edge) && same_vector(a.bottom_edge, b.bottom_edge);
+}
+
+/* remember the tree just built, and what it was built from */
+void RenderVisTreeClass::keep_render_tree()
+{
+	tree_kept= false;
+	if (mark_as_explored) return;
+	
+	KeptPolygons.clear();
+	KeptLines.clear();
+	for (size_t i= 0; i<VisitedPolygons.size(); ++i)
+	{
+		polygon_data *polygon= get_polygon_data(VisitedPolygons[i]);
+		kept_polygon_data kept_polygon= { VisitedPolygons[i], polygon->floor_height, polygon->ceiling_height };
+		KeptPolygons.push_back(kept_polygon);
+		
+		for (short j= 0; j<polygon->vertex_count; ++j)
+		{
+			line_data *line= get_line_data(polygon->line_indexes[j]);
+			kept_line_data kept_line= { polygon->line_indexes[j], line->flags, line->highest_adjacent_floor, line->lowest_adjacent_ceiling };
+			KeptLines.push_back(kept_line);
+		}
+	}
+	
+	KeptNodes.resize(Nodes.size());
+	for (size_t i= 0; i<Nodes.size(); ++i)
+		KeptNodes[i]= Nodes[i];
+	KeptRenderFlags= RenderFlagList;
+	kept_view= *view;
+	kept_map_load_count= map_load_count;
+	tree_kept= true;
+}
+
+/* if the last tree built would be built again for this view, put it back and return true */
+bool RenderVisTreeClass::restore_render_tree()
+{
+	if (!tree_kept || mark_as_explored || kept_map_load_count!=map_load_count ||
+		!same_view_for_tree(*view, kept_view) || KeptNodes.size()!=Nodes.size() ||
+		KeptRenderFlags.size()!=RenderFlagList.size())
+	{
+		return false;
+	}
+	
+	/* platforms, doors and scripts change heights and which lines can be seen through */
+	for (size_t i= 0; i<KeptPolygons.size(); ++i)
+	{
+		const kept_polygon_data& kept= KeptPolygons[i];
+		polygon_data *polygon= get_polygon_data(kept.polygon_index);
+		
+		if (polygon->floor_height!=kept.floor_height || polygon->ceiling_height!=kept.ceiling_height)
+		{
+			tree_kept= false;
+			return false;
+		}
+	}
+	for (size_t i= 0; i<KeptLines.size(); ++i)
+	{
+		const kept_line_data& kept= KeptLines[i];
+		line_data *line= get_line_data(kept.line_index);
+		
+		if (line->flags!=kept.flags || line->highest_adjacent_floor!=kept.highest_adjacent_floor ||
+			line->lowest_adjacent_ceiling!=kept.lowest_adjacent_ceiling)
+		{
+			tree_kept= false;
+			return false;
+		}
+	}
+	for (size_t i= 0; i<KeptEndpoints.size(); ++i)
+	{
+		const kept_endpoint_data& kept= KeptEndpoints[i];
+		
+		if ((ENDPOINT_IS_TRANSPARENT(get_endpoint_data(kept.endpoint_index)) != 0)!=kept.transparent)
+		{
+			tree_kept= false;
+			return false;
+		}
+	}
+	
+	/* the nodes point at each other where they are now, which is where they were kept from */
+	for (size_t i= 0; i<KeptNodes.size(); ++i)
+		Nodes[i]= KeptNodes[i];
+	RenderFlagList= KeptRenderFlags;
+	ClippingWindows.clear();
+	polygon_queue_size= 0;
+	
+	/* another tree (the exploration check) may have transformed the endpoints since */
+	for (size_t i= 0; i<KeptEndpoints.size(); ++i)
+	{
+		endpoint_data *endpoint= get_endpoint_data(KeptEndpoints[i].endpoint_index);
+		
+		endpoint->transformed= endpoint->vertex;
+		transform_overflow_point2d(&endpoint->transformed, (world_point2d *) &view->origin, view->yaw, &endpoint->flags);
+	}
+	
+	/* and the automap may have been cleared */
+	if (add_to_automap)
+	{
+		for (size_t i= 0; i<VisitedPolygons.size(); ++i) ADD_POLYGON_TO_AUTOMAP(VisitedPolygons[i]);
+		for (size_t i= 0; i<AutomapLines.size(); ++i) ADD_LINE_TO_AUTOMAP(AutomapLines[i]);
+	}
+	
+	return true;
 }
 
 /* ---------- building the render tree */
@@ -477,7 +611,11 @@ uint16 RenderVisTreeClass::next_polygon_along_line(
 		line_data *line= get_line_data(crossed_line_index);
 
 		/* add the line we crossed to the automap */
-		if (add_to_automap) ADD_LINE_TO_AUTOMAP(crossed_line_index);
+		if (add_to_automap)
+		{
+			ADD_LINE_TO_AUTOMAP(crossed_line_index);
+			AutomapLines.push_back(crossed_line_index);
+		}
 
 		/* if the line has a side facing this polygon, mark the side as visible */
 		if (crossed_side_index!=NONE) SET_RENDER_FLAG(crossed_side_index, _side_is_visible);
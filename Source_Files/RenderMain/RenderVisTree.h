@@ -37,10 +37,10 @@ Oct 13, 2000
 	LP: replaced GrowableLists and ResizableLists with STL vectors
 */
 
-#include <deque>
 #include <vector>
 #include "map.h"
 #include "render.h"
+#include "RenderArena.h"
 
 
 // Made pointers more general
@@ -188,6 +188,39 @@ class RenderVisTreeClass
 	
 	void ResetLineClips();
 	
+	// The tree last built, kept so that a view which has not moved gets it back for as
+	// long as none of the polygons, lines and endpoints it was built from have changed;
+	// it is put back as it was built, before the polygon sorter took it apart
+	struct kept_polygon_data
+	{
+		short polygon_index;
+		world_distance floor_height, ceiling_height;
+	};
+	struct kept_line_data
+	{
+		short line_index;
+		uint16 flags;
+		world_distance highest_adjacent_floor, lowest_adjacent_ceiling;
+	};
+	struct kept_endpoint_data
+	{
+		short endpoint_index;
+		bool transparent;
+	};
+	bool tree_kept;
+	uint32 kept_map_load_count;
+	view_data kept_view;
+	vector<node_data> KeptNodes;
+	vector<uint16> KeptRenderFlags;
+	vector<short> VisitedPolygons;
+	vector<short> AutomapLines;
+	vector<kept_polygon_data> KeptPolygons;
+	vector<kept_line_data> KeptLines;
+	vector<kept_endpoint_data> KeptEndpoints;
+	
+	void keep_render_tree();
+	bool restore_render_tree();
+	
 public:
 
 	/* gives screen x-coordinates for a map endpoint (only valid if _endpoint_is_visible) */
@@ -196,24 +229,24 @@ public:
 	/* every time we find a unique endpoint which clips something, we build one of these for it */
 	// LP addition: growable list
 	// Length changed in calculate_endpoint_clipping_information() and ResetEndpointClips()
-	vector<endpoint_clip_data> EndpointClips;
+	RenderArena<endpoint_clip_data> EndpointClips;
 
 	/* every time we find a unique line which clips something, we build one of these for it (notice
 		the translation table from line_indexes on the map to line_clip_indexes in our table for when
 		we cross the same clip line again */
 	// LP addition: growable list
 	// Length changed in calculate_line_clipping_information() and ResetLineClips()
-	vector<line_clip_data> LineClips;
+	RenderArena<line_clip_data> LineClips;
 
 	// Growable list of clipping windows
 	// Length changed in build_clipping_windows(), initialize_clip_data(),
 	// and build_aggregate_render_object_clipping_window();
-	// keep sorted-node clipping-window pointers in sync with render-object ones
-	vector<clipping_window_data> ClippingWindows;
+	// it never moves, so the sorted nodes and render objects can point into it
+	RenderArena<clipping_window_data> ClippingWindows;
 	
 	// Growable list of node_data values
 	// Length changed in cast_render_ray() and initialize_render_tree()
-	typedef std::deque<node_data> NodeList;
+	typedef RenderArena<node_data> NodeList;
 	NodeList Nodes;
 	
 	// Pointer to view
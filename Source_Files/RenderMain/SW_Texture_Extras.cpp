@@ -152,7 +152,7 @@ void reset_mml_software()
 
 void parse_mml_software(const InfoTree& root)
 {
-	BOOST_FOREACH(InfoTree ttree, root.children_named("texture"))
+	BOOST_FOREACH(const InfoTree &ttree, root.children_named("texture"))
 	{
 		int16 coll, bitmap;
 		if (!ttree.read_indexed("coll", coll, NUMBER_OF_COLLECTIONS) ||
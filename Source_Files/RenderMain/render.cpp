@@ -195,6 +195,10 @@ Nov 29, 2000 (Loren Petrich):
 
 Jan 17, 2001 (Loren Petrich):
 	Added vertical flipping
+
+Oct 14, 2026:
+	Added per-polygon potentially visible sets, found when first needed, so that M1
+	exploration checks can skip views which cannot see anything left to explore
 */
 
 
@@ -211,6 +215,7 @@ Jan 17, 2001 (Loren Petrich):
 #include "media.h"
 #include "weapons.h"
 #include "player.h"
+#include "platforms.h"
 
 // LP additions
 #include "dynamic_limits.h"
@@ -241,6 +246,7 @@ extern WindowPtr screen_window;
 #endif
 #include "preferences.h"
 #include "screen.h"
+#include "FrameProfiler.h"
 
 /* use native alignment */
 #if defined (powerc) || defined (__powerc)
@@ -305,6 +311,26 @@ static const int TICKS_PER_EXPLORE = 4;
 static struct view_data explore_view;
 static RenderVisTreeClass explore_tree;
 
+// Polygons which could be seen from somewhere inside each polygon; these are conservative,
+// so anything build_render_tree() reaches from a view origin inside a polygon is in its set
+static vector<vector<int16> > PotentiallyVisibleSets;
+static vector<bool> PotentiallyVisibleSetBuilt;
+static vector<bool> LineMayBeTransparent;
+
+// After this many line crossings while finding one polygon's set, give up on clipping
+// and settle for every polygon reachable through lines which may be transparent
+static const int MAXIMUM_PVS_LINE_CROSSINGS = 16384;
+static const int MAXIMUM_PVS_CHAIN_LENGTH = 256;
+
+// Slack (in world units) allowed when clipping, so that lines which are only grazed
+// by a line of sight are kept
+static const double PVS_CLIP_SLACK = 1.0;
+
+struct pvs_segment
+{
+	double x0, y0, x1, y1;
+};
+
 void OGL_Rasterizer_Init() {
 	
 #ifdef HAVE_OPENGL
@@ -321,6 +347,8 @@ static void update_view_data(struct view_data *view);
 static void update_render_effect(struct view_data *view);
 static void shake_view_origin(struct view_data *view, world_distance delta);
 
+static const vector<int16>& get_potentially_visible_set(short polygon_index);
+
 static void render_viewer_sprite_layer(view_data *view, RasterizerClass *RasPtr);
 static void position_sprite_axis(short *x0, short *x1, short scale_width, short screen_width,
 	short positioning_mode, _fixed position, bool flip, world_distance world_left, world_distance world_right);
@@ -445,8 +473,15 @@ void render_view(
 		
 		// LP: now from the visibility-tree class
 		/* build the render tree, regardless of map mode, so the automap updates while active */
+		/* each stage reads what the last one left, and all of them read the world, which is
+			only settled once this tick's update is done; none of them can start early or
+			run alongside another, and the GPU already works on the frame once it is handed
+			over */
+		FrameProfiler *Profiler = FrameProfiler::instance();
+		Profiler->Begin(FrameProfiler::VIS_TREE);
 		RenderVisTree.view = view;
 		RenderVisTree.build_render_tree();
+		Profiler->End(FrameProfiler::VIS_TREE);
 		
 		/* do something complicated and difficult to explain */
 		if (!view->overhead_map_active || map_is_translucent())
@@ -454,13 +489,17 @@ void render_view(
 			// LP: now from the polygon-sorter class
 			/* sort the render tree (so we have a depth-ordering of polygons) and accumulate
 				clipping information for each polygon */
+			Profiler->Begin(FrameProfiler::SORT);
 			RenderSortPoly.view = view;
 			RenderSortPoly.sort_render_tree();
+			Profiler->End(FrameProfiler::SORT);
 			
 			// LP: now from the object-placement class
 			/* build the render object list by looking at the sorted render tree */
+			Profiler->Begin(FrameProfiler::OBJECTS);
 			RenderPlaceObjs.view = view;
 			RenderPlaceObjs.build_render_object_list();
+			Profiler->End(FrameProfiler::OBJECTS);
 			
 			// LP addition: set the current rasterizer to whichever is appropriate here
 			RasterizerClass *RasPtr;
@@ -481,6 +520,7 @@ void render_view(
 			RasPtr->SetView(*view);
 			
 			// Start rendering main view
+			Profiler->Begin(FrameProfiler::RASTERIZE);
 			RasPtr->Begin();
 			
 			// LP: now from the clipping/rasterizer class
@@ -501,12 +541,15 @@ void render_view(
 			
 			// Finish rendering main view
 			RasPtr->End();
+			Profiler->End(FrameProfiler::RASTERIZE);
 		}
 
 		if (view->overhead_map_active)
 		{
 			/* if the overhead map is active, render it */
+			Profiler->Begin(FrameProfiler::MAP);
 			render_overhead_map(view);
+			Profiler->End(FrameProfiler::MAP);
 		}
 	}
 }
@@ -582,6 +625,25 @@ void check_m1_exploration(void)
 		explore_view.origin_polygon_index = explore_player->camera_polygon_index;
 
 		update_view_data(&explore_view);
+
+		// Nothing can be marked if no polygon left to explore is visible from here
+		if (point_in_polygon(explore_view.origin_polygon_index, (world_point2d *) &explore_view.origin))
+		{
+			const vector<int16>& visible_polygons= get_potentially_visible_set(explore_view.origin_polygon_index);
+			bool may_see_unexplored= false;
+			
+			for (size_t j= 0; j<visible_polygons.size(); ++j)
+			{
+				if (get_polygon_data(visible_polygons[j])->type == _polygon_must_be_explored)
+				{
+					may_see_unexplored= true;
+					break;
+				}
+			}
+			if (!may_see_unexplored)
+				continue;
+		}
+
 		objlist_clear(render_flags, RENDER_FLAGS_BUFFER_SIZE);
         // build_render_tree() actually marks the polygons
 		explore_tree.build_render_tree();
@@ -589,8 +651,204 @@ void check_m1_exploration(void)
 }
 
 
+/* call when a new map is loaded */
+void reset_potentially_visible_sets(
+	void)
+{
+	PotentiallyVisibleSets.clear();
+	PotentiallyVisibleSetBuilt.clear();
+	LineMayBeTransparent.clear();
+}
+
+
 /* ---------- private code */
 
+/* lines which are transparent now, or which platforms might make transparent later */
+static void find_lines_which_may_be_transparent(
+	void)
+{
+	short line_index, platform_index;
+	
+	LineMayBeTransparent.assign(dynamic_world->line_count, false);
+	for (line_index= 0; line_index<dynamic_world->line_count; ++line_index)
+	{
+		if (LINE_IS_TRANSPARENT(get_line_data(line_index))) LineMayBeTransparent[line_index]= true;
+	}
+	
+	for (platform_index= 0; platform_index<dynamic_world->platform_count; ++platform_index)
+	{
+		struct polygon_data *polygon= get_polygon_data(get_platform_data(platform_index)->polygon_index);
+		
+		for (short i= 0; i<polygon->vertex_count; ++i) LineMayBeTransparent[polygon->line_indexes[i]]= true;
+	}
+}
+
+/* clip the segment to what could be seen through both the source and target segments: the
+	part on the target's side of each line through one endpoint of each that separates them;
+	false if nothing is left */
+static bool clip_to_separating_lines(
+	const pvs_segment& source,
+	const pvs_segment& target,
+	pvs_segment& segment)
+{
+	const double source_x[2]= {source.x0, source.x1}, source_y[2]= {source.y0, source.y1};
+	const double target_x[2]= {target.x0, target.x1}, target_y[2]= {target.y0, target.y1};
+	
+	for (int i= 0; i<2; ++i)
+	{
+		for (int j= 0; j<2; ++j)
+		{
+			double dx= target_x[j]-source_x[i], dy= target_y[j]-source_y[i];
+			double length= sqrt(dx*dx + dy*dy);
+			
+			/* endpoints (nearly) shared; there is no separating line here */
+			if (length<PVS_CLIP_SLACK) continue;
+			dx/= length, dy/= length;
+			
+			/* signed distances of the other endpoints from the line */
+			double source_side= (source_x[1-i]-source_x[i])*dy - (source_y[1-i]-source_y[i])*dx;
+			double target_side= (target_x[1-j]-source_x[i])*dy - (target_y[1-j]-source_y[i])*dx;
+			
+			/* skipping a line only keeps more, so skip the doubtful ones */
+			if (fabs(source_side)<PVS_CLIP_SLACK || fabs(target_side)<PVS_CLIP_SLACK) continue;
+			if ((source_side<0) == (target_side<0)) continue;
+			
+			double sign= (target_side<0) ? -1.0 : 1.0;
+			double d0= sign*((segment.x0-source_x[i])*dy - (segment.y0-source_y[i])*dx);
+			double d1= sign*((segment.x1-source_x[i])*dy - (segment.y1-source_y[i])*dx);
+			
+			if (d0<-PVS_CLIP_SLACK && d1<-PVS_CLIP_SLACK) return false;
+			if (d0<-PVS_CLIP_SLACK)
+			{
+				double u= (-PVS_CLIP_SLACK-d0)/(d1-d0);
+				segment.x0+= u*(segment.x1-segment.x0), segment.y0+= u*(segment.y1-segment.y0);
+			}
+			else if (d1<-PVS_CLIP_SLACK)
+			{
+				double u= (-PVS_CLIP_SLACK-d1)/(d0-d1);
+				segment.x1+= u*(segment.x0-segment.x1), segment.y1+= u*(segment.y0-segment.y1);
+			}
+		}
+	}
+	
+	return true;
+}
+
+/* follow every chain of lines out of the given polygon which one line of sight could
+	cross after having left the source polygon through the source segment */
+static void walk_potentially_visible_polygons(
+	short polygon_index,
+	short entry_line_index,
+	const pvs_segment& source,
+	const pvs_segment& target,
+	vector<bool>& visible,
+	int& crossings_left,
+	int chain_length)
+{
+	struct polygon_data *polygon= get_polygon_data(polygon_index);
+	
+	if (chain_length>=MAXIMUM_PVS_CHAIN_LENGTH)
+	{
+		crossings_left= 0;
+		return;
+	}
+	
+	for (short i= 0; i<polygon->vertex_count && crossings_left>0; ++i)
+	{
+		short line_index= polygon->line_indexes[i];
+		short adjacent_polygon_index= polygon->adjacent_polygon_indexes[i];
+		
+		if (line_index==entry_line_index || adjacent_polygon_index==NONE || !LineMayBeTransparent[line_index]) continue;
+		crossings_left-= 1;
+		
+		world_point2d *e0= &get_endpoint_data(polygon->endpoint_indexes[i])->vertex;
+		world_point2d *e1= &get_endpoint_data(polygon->endpoint_indexes[(i+1)%polygon->vertex_count])->vertex;
+		pvs_segment segment= {double(e0->x), double(e0->y), double(e1->x), double(e1->y)};
+		
+		if (clip_to_separating_lines(source, target, segment))
+		{
+			visible[adjacent_polygon_index]= true;
+			walk_potentially_visible_polygons(adjacent_polygon_index, line_index, source, segment, visible, crossings_left, chain_length+1);
+		}
+	}
+}
+
+static void build_potentially_visible_set(
+	short polygon_index)
+{
+	vector<bool> visible(dynamic_world->polygon_count, false);
+	struct polygon_data *polygon= get_polygon_data(polygon_index);
+	int crossings_left= MAXIMUM_PVS_LINE_CROSSINGS;
+	
+	visible[polygon_index]= true;
+	for (short i= 0; i<polygon->vertex_count; ++i)
+	{
+		short line_index= polygon->line_indexes[i];
+		short adjacent_polygon_index= polygon->adjacent_polygon_indexes[i];
+		
+		if (adjacent_polygon_index==NONE || !LineMayBeTransparent[line_index]) continue;
+		
+		/* from somewhere inside this polygon, all of the next one can be seen */
+		world_point2d *e0= &get_endpoint_data(polygon->endpoint_indexes[i])->vertex;
+		world_point2d *e1= &get_endpoint_data(polygon->endpoint_indexes[(i+1)%polygon->vertex_count])->vertex;
+		pvs_segment source= {double(e0->x), double(e0->y), double(e1->x), double(e1->y)};
+		
+		visible[adjacent_polygon_index]= true;
+		walk_potentially_visible_polygons(adjacent_polygon_index, line_index, source, source, visible, crossings_left, 1);
+	}
+	
+	if (crossings_left<=0)
+	{
+		/* too many or too long chains to follow; fall back on everything that can be reached at all */
+		vector<int16> stack(1, polygon_index);
+		
+		visible.assign(dynamic_world->polygon_count, false);
+		visible[polygon_index]= true;
+		while (!stack.empty())
+		{
+			struct polygon_data *reached_polygon= get_polygon_data(stack.back());
+			stack.pop_back();
+			
+			for (short i= 0; i<reached_polygon->vertex_count; ++i)
+			{
+				short adjacent_polygon_index= reached_polygon->adjacent_polygon_indexes[i];
+				
+				if (adjacent_polygon_index!=NONE && !visible[adjacent_polygon_index] &&
+					LineMayBeTransparent[reached_polygon->line_indexes[i]])
+				{
+					visible[adjacent_polygon_index]= true;
+					stack.push_back(adjacent_polygon_index);
+				}
+			}
+		}
+	}
+	
+	vector<int16>& visible_polygons= PotentiallyVisibleSets[polygon_index];
+	visible_polygons.clear();
+	for (short i= 0; i<dynamic_world->polygon_count; ++i)
+	{
+		if (visible[i]) visible_polygons.push_back(i);
+	}
+	PotentiallyVisibleSetBuilt[polygon_index]= true;
+}
+
+static const vector<int16>& get_potentially_visible_set(
+	short polygon_index)
+{
+	if (PotentiallyVisibleSets.size()!=static_cast<size_t>(dynamic_world->polygon_count))
+	{
+		PotentiallyVisibleSets.assign(dynamic_world->polygon_count, vector<int16>());
+		PotentiallyVisibleSetBuilt.assign(dynamic_world->polygon_count, false);
+	}
+	if (LineMayBeTransparent.size()!=static_cast<size_t>(dynamic_world->line_count))
+		find_lines_which_may_be_transparent();
+	
+	if (!PotentiallyVisibleSetBuilt[polygon_index])
+		build_potentially_visible_set(polygon_index);
+	
+	return PotentiallyVisibleSets[polygon_index];
+}
+
 static void update_view_data(
 	struct view_data *view)
 {
@@ -973,6 +1231,7 @@ static void render_viewer_sprite_layer(view_data *view, RasterizerClass *RasPtr)
 		textured_rectangle.ModelPtr = ModelPtr;
 		if (ModelPtr)
 		{
+			textured_rectangle.ModelLOD = NONE;
 			textured_rectangle.ModelSequence = ModelSequence;
 			textured_rectangle.ModelFrame = display_data.Frame;
 			textured_rectangle.NextModelFrame = display_data.NextFrame;
@@ -183,6 +183,7 @@ void render_view(struct view_data *view, struct bitmap_definition *destination);
 void start_render_effect(struct view_data *view, short effect);
 
 void check_m1_exploration(void);
+void reset_potentially_visible_sets(void);
 
 
 /* ----------- prototypes/SCREEN.C */
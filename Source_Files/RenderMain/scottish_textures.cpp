@@ -96,6 +96,16 @@ Aug 9, 2000 (Loren Petrich):
 
 May 16, 2002 (Woody Zenfell):
     MSVC doesn't like "void f();  void g() { return f(); }"... fixed.
+
+Oct 14, 2026:
+	The mappers now only write to the columns of a strip of the screen, each strip with its
+	own scratch tables; with more than one rendering thread, a frame's calls are queued and
+	drawn by all the threads at once, one strip each
+	Every frame's calls are queued now, and a pass from the nearest back finds the
+	surfaces that opaque walls, floors and landscapes drawn after them paint over in
+	every column, so that nothing is textured only to be overwritten
+	With compact 32-bit shading, the levels between the stored tables are blended from the
+	two around them, once a frame for each strip
 */
 
 /*
@@ -120,6 +130,7 @@ not only that, but texture_horizontal_polygon() is actually faster than texture_
 
 #include "preferences.h"
 #include "SW_Texture_Extras.h"
+#include "FrameProfiler.h"
 
 
 /* ---------- constants */
@@ -133,6 +144,10 @@ not only that, but texture_horizontal_polygon() is actually faster than texture_
 
 #define LARGEST_N 24
 
+// Most threads to draw with, and the fewest columns worth giving one
+#define MAXIMUM_RENDER_THREADS 8
+#define MINIMUM_STRIP_WIDTH 64
+
 /* ---------- macros */
 
 #if defined(DEBUG) && defined(DEBUG_FAST_CODE)
@@ -141,23 +156,114 @@ not only that, but texture_horizontal_polygon() is actually faster than texture_
 #define VHALT_DEBUG(message) ((void)0)
 #endif
 
+/* compact 32-bit shading: the table a fraction weight/256 of the way from lower to upper */
+static void blend_shading_tables32(pixel32 *result, const pixel32 *lower, const pixel32 *upper, short weight)
+{
+	int i= 0;
+	
+#if defined(SW_SIMD_SSE2)
+	const __m128i zero= _mm_setzero_si128();
+	const __m128i lower_weight= _mm_set1_epi16(256-weight), upper_weight= _mm_set1_epi16(weight);
+	
+	for (; i+4<=MAXIMUM_SHADING_TABLE_INDEXES; i+= 4)
+	{
+		__m128i a= _mm_loadu_si128((const __m128i *) (lower+i));
+		__m128i b= _mm_loadu_si128((const __m128i *) (upper+i));
+		__m128i low= _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), lower_weight),
+			_mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), upper_weight));
+		__m128i high= _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), lower_weight),
+			_mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), upper_weight));
+		_mm_storeu_si128((__m128i *) (result+i), _mm_packus_epi16(_mm_srli_epi16(low, 8), _mm_srli_epi16(high, 8)));
+	}
+#elif defined(SW_SIMD_NEON)
+	// weight is never 0 here, so both weights fit in a byte
+	const uint8x8_t lower_weight= vdup_n_u8((uint8_t) (256-weight)), upper_weight= vdup_n_u8((uint8_t) weight);
+	
+	for (; i+2<=MAXIMUM_SHADING_TABLE_INDEXES; i+= 2)
+	{
+		uint16x8_t sum= vmull_u8(vld1_u8((const uint8_t *) (lower+i)), lower_weight);
+		sum= vmlal_u8(sum, vld1_u8((const uint8_t *) (upper+i)), upper_weight);
+		vst1_u8((uint8_t *) (result+i), vshrn_n_u16(sum, 8));
+	}
+#endif
+	
+	// every byte on its own, as above
+	for (; i<MAXIMUM_SHADING_TABLE_INDEXES; ++i)
+	{
+		uint32 a= lower[i], b= upper[i];
+		uint32 even= ((a&0x00ff00ff)*(256-weight) + (b&0x00ff00ff)*weight)>>8;
+		uint32 odd= ((a>>8)&0x00ff00ff)*(256-weight) + ((b>>8)&0x00ff00ff)*weight;
+		result[i]= (even&0x00ff00ff) | (odd&0xff00ff00);
+	}
+}
+
+/* compact 32-bit shading: the table for one of FULL_SHADING_TABLES32 levels, blended from
+	the two stored ones around it into the strip's pool the first time this frame it's wanted.
+	a call only ever shades from one collection's tables, so when there's no room for a new
+	collection's, the pool starts over without taking any from under one being drawn */
+static pixel32 *get_blended_shading_table32(sw_texture_strip& strip, pixel32 *shading_tables, short level)
+{
+	int32 position= (level*(COMPACT_SHADING_TABLES32-1)*256)/(FULL_SHADING_TABLES32-1);
+	pixel32 *lower= shading_tables + MAXIMUM_SHADING_TABLE_INDEXES*(position>>8);
+	short weight= position&0xff;
+	
+	if (!weight) return lower;
+	
+	if (strip.blend_source_last==NONE || strip.blend_sources[strip.blend_source_last].shading_tables!=shading_tables)
+	{
+		short source_index;
+		
+		for (source_index= 0; source_index<strip.blend_source_count; ++source_index)
+		{
+			if (strip.blend_sources[source_index].shading_tables==shading_tables) break;
+		}
+		if (source_index==strip.blend_source_count)
+		{
+			if (source_index==SW_BLEND_SOURCE_COUNT)
+			{
+				strip.blend_table_count= 0;
+				source_index= 0;
+			}
+			strip.blend_source_count= source_index+1;
+			strip.blend_sources[source_index].shading_tables= shading_tables;
+			objlist_set(strip.blend_sources[source_index].tables, NONE, FULL_SHADING_TABLES32);
+		}
+		strip.blend_source_last= source_index;
+	}
+	
+	short& table_index= strip.blend_sources[strip.blend_source_last].tables[level];
+	bool blended= table_index!=NONE;
+	if (!blended)
+	{
+		table_index= strip.blend_table_count++;
+		if (table_index/SW_BLEND_BLOCK_LENGTH>=(short)strip.blend_blocks.size())
+			strip.blend_blocks.push_back(new pixel32[SW_BLEND_BLOCK_LENGTH*MAXIMUM_SHADING_TABLE_INDEXES]);
+	}
+	
+	pixel32 *table= strip.blend_blocks[table_index/SW_BLEND_BLOCK_LENGTH] +
+		MAXIMUM_SHADING_TABLE_INDEXES*(table_index%SW_BLEND_BLOCK_LENGTH);
+	if (!blended) blend_shading_tables32(table, lower, lower+MAXIMUM_SHADING_TABLE_INDEXES, weight);
+	
+	return table;
+}
+
 // i0 + i1 == MAX(i0, i1) + MIN(i0, i1)/2
 //#define calculate_shading_table(result, view, shading_tables, depth, ambient_shade)
-static void calculate_shading_table(void * &result,view_data *view, void *shading_tables, short depth,_fixed ambient_shade)
+static void calculate_shading_table(void * &result, sw_texture_strip& strip, view_data *view, void *shading_tables, short depth,_fixed ambient_shade)
 { 
-	short table_index; 
 	_fixed shade; 
 	 
 	if ((ambient_shade)<0) 
 	{ 
-		table_index= SHADE_TO_SHADING_TABLE_INDEX(-(ambient_shade)); 
+		shade= -(ambient_shade); 
 	} 
 	else 
 	{ 
 		shade= (view)->maximum_depth_intensity - DEPTH_TO_SHADE(depth); 
 		shade= PIN(shade, 0, FIXED_ONE); 
-		table_index= SHADE_TO_SHADING_TABLE_INDEX((ambient_shade>shade) ? (ambient_shade + (shade>>1)) : (shade + (ambient_shade>>1))); 
+		shade= (ambient_shade>shade) ? (ambient_shade + (shade>>1)) : (shade + (ambient_shade>>1)); 
 	} 
+	short table_index= SHADE_TO_SHADING_TABLE_INDEX(shade); 
 	 
 	switch (bit_depth) 
 	{ 
@@ -165,7 +271,14 @@ static void calculate_shading_table(void * &result,view_data *view, void *shadin
 			CEILING(table_index, number_of_shading_tables-1); break; 
 		case 16: result= ((byte*)(shading_tables)) + MAXIMUM_SHADING_TABLE_INDEXES*sizeof(pixel16)* 
 			CEILING(table_index, number_of_shading_tables-1); break; 
-		case 32: result= ((byte*)(shading_tables)) + MAXIMUM_SHADING_TABLE_INDEXES*sizeof(pixel32)* 
+		case 32:
+			if (number_of_shading_tables<FULL_SHADING_TABLES32)
+			{
+				short level= shade>>(FIXED_FRACTIONAL_BITS-8);
+				result= get_blended_shading_table32(strip, (pixel32 *) shading_tables, CEILING(level, FULL_SHADING_TABLES32-1));
+				break;
+			}
+			result= ((byte*)(shading_tables)) + MAXIMUM_SHADING_TABLE_INDEXES*sizeof(pixel32)* 
 			CEILING(table_index, number_of_shading_tables-1); break; 
 	} 
 }
@@ -176,27 +289,49 @@ static void calculate_shading_table(void * &result,view_data *view, void *shadin
 	right lines of the current polygon), the trapezoid rasterizer (to store the y-coordinates
 	of the top and bottom of the current trapezoid) and the rectangle mapper (for its
 	vertical and if necessary horizontal distortion tables).  these are not necessary as
-	globals, just as global storage. */
-static short *scratch_table0 = NULL, *scratch_table1 = NULL;
-static void *precalculation_table = NULL;
+	globals, just as global storage.  these are the main thread's; the other rendering
+	threads have their own. */
+static sw_texture_strip main_thread_strip = {0, 0, NULL, NULL, NULL};
+
+/* threads which draw strips of queued frames */
+struct render_thread_data
+{
+	SDL_Thread *thread;
+	SDL_sem *start;
+	sw_texture_strip strip;
+	Rasterizer_SW_Class *rasterizer;
+};
+
+static render_thread_data render_threads[MAXIMUM_RENDER_THREADS];
+static int render_thread_count = 0; /* not counting the main thread */
+static bool render_threads_quit = false;
+static SDL_sem *render_threads_done = NULL;
 
 /* ---------- private prototypes */
 
-static void _pretexture_horizontal_polygon_lines(struct polygon_definition *polygon,
+static void _pretexture_horizontal_polygon_lines(sw_texture_strip& strip, struct polygon_definition *polygon,
 	struct bitmap_definition *screen, struct view_data *view, struct _horizontal_polygon_line_data *data,
 	short y0, short *x0_table, short *x1_table, short line_count);
 
-static void _pretexture_vertical_polygon_lines(struct polygon_definition *polygon,
+static void _pretexture_vertical_polygon_lines(sw_texture_strip& strip, struct polygon_definition *polygon,
 	struct bitmap_definition *screen, struct view_data *view, struct _vertical_polygon_data *data,
 	short x0, short *y0_table, short *y1_table, short line_count);
 
 static short *build_x_table(short *table, short x0, short y0, short x1, short y1);
 static short *build_y_table(short *table, short x0, short y0, short x1, short y1);
 
-static void _prelandscape_horizontal_polygon_lines(struct polygon_definition *polygon,
+static void _prelandscape_horizontal_polygon_lines(sw_texture_strip& strip, struct polygon_definition *polygon,
 	struct bitmap_definition *screen, struct view_data *view, struct _horizontal_polygon_line_data *data,
 	short y0, short *x0_table, short *x1_table, short line_count);
 
+static void clip_horizontal_polygon_lines(sw_texture_strip& strip, struct _horizontal_polygon_line_data *data,
+	short *x0_table, short *x1_table, short line_count, bool advance_source_y);
+
+static void allocate_strip_tables(sw_texture_strip& strip);
+static int wanted_render_thread_count(short screen_width);
+static void set_render_thread_count(int count);
+static int render_thread_loop(void *data);
+
 /* ---------- code */
 
 /* set aside memory at launch for two line tables (remember, we precalculate all the y-values
@@ -204,23 +339,337 @@ static void _prelandscape_horizontal_polygon_lines(struct polygon_definition *po
 void allocate_texture_tables(
 	void)
 {
-	scratch_table0= new short[MAXIMUM_SCRATCH_TABLE_ENTRIES];
-	scratch_table1= new short[MAXIMUM_SCRATCH_TABLE_ENTRIES];
-	precalculation_table= (void*)new char[MAXIMUM_PRECALCULATION_TABLE_ENTRY_SIZE*MAXIMUM_SCRATCH_TABLE_ENTRIES];
-	fc_assert(scratch_table0&&scratch_table1&&precalculation_table);
+	allocate_strip_tables(main_thread_strip);
+}
+
+void Rasterizer_SW_Class::Begin()
+{
+	int thread_count= wanted_render_thread_count(screen->width);
+	
+	if (thread_count-1!=render_thread_count) set_render_thread_count(thread_count-1);
+	QueueCalls= true;
+	
+	/* make sure nothing gets created lazily while the threads are drawing */
+	SW_Texture_Extras::instance();
+}
+
+void Rasterizer_SW_Class::End()
+{
+	if (!QueueCalls) return;
+	
+	/* split the screen into strips with widths that are multiples of four,
+		so that the vertical mapper's four-column runs are unchanged */
+	int strip_count= render_thread_count+1;
+	int strip_width= ((screen->width+strip_count-1)/strip_count + 3)&~3;
+	
+	StripWidth= strip_width;
+	find_covered_calls(strip_count);
+	
+	main_thread_strip.x0= 0;
+	main_thread_strip.x1= MIN(strip_width, screen->width);
+	for (int i= 0; i<render_thread_count; ++i)
+	{
+		render_thread_data& data= render_threads[i];
+		
+		data.strip.x0= MIN((i+1)*strip_width, screen->width);
+		data.strip.x1= MIN((i+2)*strip_width, screen->width);
+		data.rasterizer= this;
+		SDL_SemPost(data.start);
+	}
+	
+	draw_queued_calls(main_thread_strip);
+	for (int i= 0; i<render_thread_count; ++i) SDL_SemWait(render_threads_done);
+	
+	QueuedCalls.clear();
+	QueuedPolygons.clear();
+	QueuedRectangles.clear();
+	QueueCalls= false;
+}
+
+void Rasterizer_SW_Class::draw_queued_calls(sw_texture_strip& strip)
+{
+	uint32 strip_bit= 1<<(strip.x0/StripWidth);
+	
+	// Collections' tables may have moved since last frame
+	strip.blend_source_count= 0;
+	strip.blend_source_last= NONE;
+	strip.blend_table_count= 0;
+	
+	for (size_t i= 0; i<QueuedCalls.size(); ++i)
+	{
+		queued_call& call= QueuedCalls[i];
+		
+		if (call.covered_strips&strip_bit) continue;
+		switch (call.type)
+		{
+			case _queued_horizontal_polygon:
+				texture_horizontal_polygon(QueuedPolygons[call.index], strip);
+				break;
+			
+			case _queued_vertical_polygon:
+				texture_vertical_polygon(QueuedPolygons[call.index], strip);
+				break;
+			
+			case _queued_rectangle:
+			{
+				/* the mapper clips the rectangle in place */
+				rectangle_definition rectangle= QueuedRectangles[call.index];
+				texture_rectangle(rectangle, strip);
+				break;
+			}
+		}
+	}
+}
+
+/* whether a polygon handed to the mappers writes every pixel inside it */
+static bool polygon_is_opaque(
+	const polygon_definition& polygon)
+{
+	switch (polygon.transfer_mode)
+	{
+		case _big_landscaped_transfer:
+			return true;
+		
+		case _textured_transfer:
+			if (polygon.texture->flags&_TRANSPARENT_BIT) return false;
+			if (bit_depth>8 && graphics_preferences->software_alpha_blending && !polygon.VoidPresent)
+			{
+				SW_Texture *sw_texture= SW_Texture_Extras::instance()->GetTexture(polygon.ShapeDesc);
+				if (sw_texture && sw_texture->opac_type()) return false;
+			}
+			return true;
+		
+		default:
+			return false;
+	}
+}
+
+/* y of the edge between p0 and p1 (p0.x!=p1.x) where it crosses x, rounded down and up */
+static void edge_y_at(
+	const point2d& p0,
+	const point2d& p1,
+	short x,
+	short& y_low,
+	short& y_high)
+{
+	if (p1.x<p0.x)
+	{
+		edge_y_at(p1, p0, x, y_low, y_high);
+		return;
+	}
+	
+	int32 dx= p1.x-p0.x, n= int32(p1.y-p0.y)*(x-p0.x);
+	int32 quotient= n>=0 ? n/dx : -((-n+dx-1)/dx);
+	
+	y_low= p0.y+quotient;
+	y_high= y_low + ((n-quotient*dx)!=0);
+}
+
+/* finds the rows a polygon may cover and is sure to cover in each column from x0 to x1 (exclusive);
+	the mappers' edges are within a pixel of the true ones, so the outer spans take in the columns
+	and rows around them and the inner ones leave them out.  false if it would not be drawn at all
+	(vertices off the screen, or not convex and clockwise, for which the mappers draw nothing) */
+bool Rasterizer_SW_Class::find_polygon_spans(
+	const polygon_definition& polygon,
+	short& x0,
+	short& x1)
+{
+	const point2d *vertices= polygon.vertices;
+	short vertex_count= polygon.vertex_count;
+	short x_min= SHRT_MAX, x_max= SHRT_MIN;
+	int32 area= 0;
+	
+	if (vertex_count<MINIMUM_VERTICES_PER_SCREEN_POLYGON) return false;
+	for (short i= 0; i<vertex_count; ++i)
+	{
+		const point2d& p0= vertices[i];
+		const point2d& p1= vertices[i+1<vertex_count ? i+1 : 0];
+		const point2d& p2= vertices[i+2<vertex_count ? i+2 : i+2-vertex_count];
+		
+		if (!(p0.x>=0 && p0.x<=screen->width && p0.y>=0 && p0.y<=screen->height)) return false;
+		if (int32(p1.x-p0.x)*(p2.y-p1.y) - int32(p1.y-p0.y)*(p2.x-p1.x) < 0) return false;
+		area+= int32(p0.x)*p1.y - int32(p1.x)*p0.y;
+		x_min= MIN(x_min, p0.x), x_max= MAX(x_max, p0.x);
+	}
+	if (area<=0) return false;
+	
+	/* where the edges cross the left edge of each column */
+	short sample_count= x_max-x_min+1;
+	if (SampleTop.size()<size_t(sample_count)) SampleTop.resize(sample_count), SampleBottom.resize(sample_count);
+	for (short x= 0; x<sample_count; ++x) SampleTop[x]= SHRT_MAX, SampleBottom[x]= SHRT_MIN;
+	for (short i= 0; i<vertex_count; ++i)
+	{
+		const point2d& p0= vertices[i];
+		const point2d& p1= vertices[i+1<vertex_count ? i+1 : 0];
+		short left= MIN(p0.x, p1.x), right= MAX(p0.x, p1.x);
+		
+		for (short x= left; x<=right; ++x)
+		{
+			short y_low, y_high;
+			
+			if (p0.x==p1.x) y_low= MIN(p0.y, p1.y), y_high= MAX(p0.y, p1.y);
+			else edge_y_at(p0, p1, x, y_low, y_high);
+			SampleTop[x-x_min]= MIN(SampleTop[x-x_min], y_low);
+			SampleBottom[x-x_min]= MAX(SampleBottom[x-x_min], y_high);
+		}
+	}
+	
+	/* the columns on either side may get a pixel too */
+	x0= MAX(x_min-1, 0), x1= MIN(x_max+1, screen->width);
+	if (Spans.size()<size_t(x1-x0)) Spans.resize(x1-x0);
+	for (short x= x0; x<x1; ++x)
+	{
+		column_span& span= Spans[x-x0];
+		short first= MAX(x-1, x_min), last= MIN(x+2, x_max);
+		bool inner= x-1>=x_min && x+2<=x_max;
+		
+		span.outer_top= SHRT_MAX, span.outer_bottom= SHRT_MIN;
+		span.inner_top= SHRT_MIN, span.inner_bottom= SHRT_MAX;
+		for (short sample= first; sample<=last; ++sample)
+		{
+			span.outer_top= MIN(span.outer_top, SampleTop[sample-x_min]);
+			span.outer_bottom= MAX(span.outer_bottom, SampleBottom[sample-x_min]);
+			span.inner_top= MAX(span.inner_top, SampleTop[sample-x_min]);
+			span.inner_bottom= MIN(span.inner_bottom, SampleBottom[sample-x_min]);
+		}
+		span.outer_top= MAX(span.outer_top-1, 0);
+		span.outer_bottom= MIN(span.outer_bottom+1, screen->height);
+		if (inner) span.inner_top+= 1, span.inner_bottom-= 1;
+		else span.inner_top= span.inner_bottom= 0;
+	}
+	
+	return true;
+}
+
+void Rasterizer_SW_Class::find_covered_calls(
+	int strip_count)
+{
+	uint32 all_strips= (strip_count<32) ? ((1<<strip_count)-1) : 0xffffffff;
+	
+	CoveredTop.assign(screen->width, 0);
+	CoveredBottom.assign(screen->width, 0);
+	for (size_t i= QueuedCalls.size(); i>0; --i)
+	{
+		queued_call& call= QueuedCalls[i-1];
+		short x0, x1;
+		uint32 uncovered= 0;
+		
+		call.covered_strips= 0;
+		if (call.type==_queued_rectangle)
+		{
+			const rectangle_definition& rectangle= QueuedRectangles[call.index];
+			short y0= MAX(MAX(rectangle.y0, rectangle.clip_top)-1, 0);
+			short y1= MIN(MIN(rectangle.y1, rectangle.clip_bottom)+1, screen->height);
+			
+			x0= MAX(MAX(rectangle.x0, rectangle.clip_left)-1, 0);
+			x1= MIN(MIN(rectangle.x1, rectangle.clip_right)+1, screen->width);
+			for (short x= x0; x<x1; ++x)
+				if (CoveredTop[x]>y0 || CoveredBottom[x]<y1) uncovered|= 1<<(x/StripWidth);
+		}
+		else
+		{
+			const polygon_definition& polygon= QueuedPolygons[call.index];
+			
+			if (!find_polygon_spans(polygon, x0, x1))
+			{
+				/* the mappers will bail out of this one anyway */
+				continue;
+			}
+			for (short x= x0; x<x1; ++x)
+			{
+				const column_span& span= Spans[x-x0];
+				
+				if (span.outer_top<span.outer_bottom && (CoveredTop[x]>span.outer_top || CoveredBottom[x]<span.outer_bottom))
+					uncovered|= 1<<(x/StripWidth);
+			}
+			
+			if (polygon_is_opaque(polygon))
+			{
+				for (short x= x0; x<x1; ++x)
+				{
+					const column_span& span= Spans[x-x0];
+					short& top= CoveredTop[x];
+					short& bottom= CoveredBottom[x];
+					
+					if (span.inner_top>=span.inner_bottom) continue;
+					if (span.inner_top<=bottom && top<=span.inner_bottom)
+					{
+						/* overlapping or touching; one run of rows */
+						top= MIN(top, span.inner_top), bottom= MAX(bottom, span.inner_bottom);
+					}
+					else if (span.inner_bottom-span.inner_top > bottom-top)
+					{
+						/* keep the longer run */
+						top= span.inner_top, bottom= span.inner_bottom;
+					}
+				}
+			}
+		}
+		
+		call.covered_strips= all_strips&~uncovered;
+	}
 }
 
 void Rasterizer_SW_Class::texture_horizontal_polygon(polygon_definition& textured_polygon)
+{
+	FrameProfiler::CountDrawCall();
+	if (QueueCalls)
+	{
+		queued_call call= {_queued_horizontal_polygon, static_cast<int32>(QueuedPolygons.size()), 0};
+		QueuedPolygons.push_back(textured_polygon);
+		QueuedCalls.push_back(call);
+	}
+	else
+	{
+		main_thread_strip.x0= 0, main_thread_strip.x1= screen->width;
+		texture_horizontal_polygon(textured_polygon, main_thread_strip);
+	}
+}
+
+void Rasterizer_SW_Class::texture_vertical_polygon(polygon_definition& textured_polygon)
+{
+	FrameProfiler::CountDrawCall();
+	if (QueueCalls)
+	{
+		queued_call call= {_queued_vertical_polygon, static_cast<int32>(QueuedPolygons.size()), 0};
+		QueuedPolygons.push_back(textured_polygon);
+		QueuedCalls.push_back(call);
+	}
+	else
+	{
+		main_thread_strip.x0= 0, main_thread_strip.x1= screen->width;
+		texture_vertical_polygon(textured_polygon, main_thread_strip);
+	}
+}
+
+void Rasterizer_SW_Class::texture_rectangle(rectangle_definition& textured_rectangle)
+{
+	FrameProfiler::CountDrawCall();
+	if (QueueCalls)
+	{
+		queued_call call= {_queued_rectangle, static_cast<int32>(QueuedRectangles.size()), 0};
+		QueuedRectangles.push_back(textured_rectangle);
+		QueuedCalls.push_back(call);
+	}
+	else
+	{
+		main_thread_strip.x0= 0, main_thread_strip.x1= screen->width;
+		texture_rectangle(textured_rectangle, main_thread_strip);
+	}
+}
+
+void Rasterizer_SW_Class::texture_horizontal_polygon(polygon_definition& textured_polygon, sw_texture_strip& strip)
 {
 	polygon_definition *polygon = &textured_polygon;	// Reference to pointer
 	short vertex, highest_vertex, lowest_vertex;
 	point2d *vertices= polygon->vertices;
+	void *precalculation_table= strip.precalculation_table;
 
 	fc_assert(polygon->vertex_count>=MINIMUM_VERTICES_PER_SCREEN_POLYGON&&polygon->vertex_count<MAXIMUM_VERTICES_PER_SCREEN_POLYGON);
 
 	/* if we get static, tinted or landscaped transfer modes punt to the vertical polygon mapper */
 	if (polygon->transfer_mode == _static_transfer) {
-		texture_vertical_polygon(textured_polygon);
+		texture_vertical_polygon(textured_polygon, strip);
 		return;
 	}
 
@@ -243,7 +692,7 @@ void Rasterizer_SW_Class::texture_horizontal_polygon(polygon_definition& texture
 		short left_line_count, right_line_count, total_line_count;
 		short aggregate_left_line_count, aggregate_right_line_count, aggregate_total_line_count;
 		short left_vertex, right_vertex;
-		short *left_table= scratch_table0, *right_table= scratch_table1;
+		short *left_table= strip.scratch_table0, *right_table= strip.scratch_table1;
 
 		left_line_count= right_line_count= 0; /* zero counts so the left and right lines get initialized */
 		aggregate_left_line_count= aggregate_right_line_count= 0; /* weve precalculated nothing initially */
@@ -308,15 +757,19 @@ void Rasterizer_SW_Class::texture_horizontal_polygon(polygon_definition& texture
 		switch (polygon->transfer_mode)
 		{
 			case _textured_transfer:
-				_pretexture_horizontal_polygon_lines(polygon, screen, view, (struct _horizontal_polygon_line_data *)precalculation_table,
+				_pretexture_horizontal_polygon_lines(strip, polygon, screen, view, (struct _horizontal_polygon_line_data *)precalculation_table,
 					vertices[highest_vertex].y, left_table, right_table,
 					aggregate_total_line_count);
+				clip_horizontal_polygon_lines(strip, (struct _horizontal_polygon_line_data *)precalculation_table,
+					left_table, right_table, aggregate_total_line_count, true);
 				break;
 
 			case _big_landscaped_transfer:
-				_prelandscape_horizontal_polygon_lines(polygon, screen, view, (struct _horizontal_polygon_line_data *)precalculation_table,
+				_prelandscape_horizontal_polygon_lines(strip, polygon, screen, view, (struct _horizontal_polygon_line_data *)precalculation_table,
 					vertices[highest_vertex].y, left_table, right_table,
 					aggregate_total_line_count);
+				clip_horizontal_polygon_lines(strip, (struct _horizontal_polygon_line_data *)precalculation_table,
+					left_table, right_table, aggregate_total_line_count, false);
 				break;
 			
 			default:
@@ -427,16 +880,17 @@ void Rasterizer_SW_Class::texture_horizontal_polygon(polygon_definition& texture
 	}
 }
 
-void Rasterizer_SW_Class::texture_vertical_polygon(polygon_definition& textured_polygon)
+void Rasterizer_SW_Class::texture_vertical_polygon(polygon_definition& textured_polygon, sw_texture_strip& strip)
 {
 	polygon_definition *polygon = &textured_polygon;	// Reference to pointer
 	short vertex, highest_vertex, lowest_vertex;
 	point2d *vertices= polygon->vertices;
+	void *precalculation_table= strip.precalculation_table;
 
 	fc_assert(polygon->vertex_count>=MINIMUM_VERTICES_PER_SCREEN_POLYGON&&polygon->vertex_count<MAXIMUM_VERTICES_PER_SCREEN_POLYGON);
 
     if (polygon->transfer_mode == _big_landscaped_transfer) {
-        texture_horizontal_polygon(textured_polygon);
+        texture_horizontal_polygon(textured_polygon, strip);
         return;
     }
      
@@ -463,7 +917,7 @@ void Rasterizer_SW_Class::texture_vertical_polygon(polygon_definition& textured_
 		short left_line_count, right_line_count, total_line_count;
 		short aggregate_left_line_count, aggregate_right_line_count, aggregate_total_line_count;
 		short left_vertex, right_vertex;
-		short *left_table= scratch_table0, *right_table= scratch_table1;
+		short *left_table= strip.scratch_table0, *right_table= strip.scratch_table1;
 
 		left_line_count= right_line_count= 0; /* zero counts so the left and right lines get initialized */
 		aggregate_left_line_count= aggregate_right_line_count= 0; /* weve precalculated nothing initially */
@@ -522,11 +976,17 @@ void Rasterizer_SW_Class::texture_vertical_polygon(polygon_definition& textured_
 		fc_assert(aggregate_right_line_count==aggregate_total_line_count);
 		fc_assert(aggregate_left_line_count==aggregate_total_line_count);
 
+		/* only the columns inside our strip get precalculated and drawn */
+		short first_line= MAX(0, strip.x0-vertices[highest_vertex].x);
+		short last_line= MIN(aggregate_total_line_count, strip.x1-vertices[highest_vertex].x);
+		if (first_line>=last_line) return;
+		left_table+= first_line, right_table+= first_line;
+
 		/* precalculate mode-specific data */
 
           if ((polygon->transfer_mode == _textured_transfer) || (polygon->transfer_mode == _static_transfer))
           {
-              _pretexture_vertical_polygon_lines(polygon, screen, view, (struct _vertical_polygon_data *)precalculation_table, vertices[highest_vertex].x, left_table, right_table, aggregate_total_line_count);
+              _pretexture_vertical_polygon_lines(strip, polygon, screen, view, (struct _vertical_polygon_data *)precalculation_table, vertices[highest_vertex].x+first_line, left_table, right_table, last_line-first_line);
           }
           else VHALT_DEBUG(csprintf(temporary, "vertical_polygons dont support mode #%d", polygon->transfer_mode));
           
@@ -656,15 +1116,19 @@ void Rasterizer_SW_Class::texture_vertical_polygon(polygon_definition& textured_
 	}
 }
 
-void Rasterizer_SW_Class::texture_rectangle(rectangle_definition& textured_rectangle)
+void Rasterizer_SW_Class::texture_rectangle(rectangle_definition& textured_rectangle, sw_texture_strip& strip)
 {
 	rectangle_definition *rectangle = &textured_rectangle;	// Reference to pointer
+	short *scratch_table0= strip.scratch_table0, *scratch_table1= strip.scratch_table1;
+	void *precalculation_table= strip.precalculation_table;
 
 	if (rectangle->x0<rectangle->x1 && rectangle->y0<rectangle->y1)
 	{
-		/* subsume screen boundaries into clipping parameters */
+		/* subsume screen (and strip) boundaries into clipping parameters */
 		if (rectangle->clip_left<0) rectangle->clip_left= 0;
 		if (rectangle->clip_right>screen->width) rectangle->clip_right= screen->width;
+		if (rectangle->clip_left<strip.x0) rectangle->clip_left= strip.x0;
+		if (rectangle->clip_right>strip.x1) rectangle->clip_right= strip.x1;
 		if (rectangle->clip_top<0) rectangle->clip_top= 0;
 		if (rectangle->clip_bottom>screen->height) rectangle->clip_bottom= screen->height;
 	
@@ -746,7 +1210,7 @@ void Rasterizer_SW_Class::texture_rectangle(rectangle_definition& textured_recta
 						{
 							// LP change:
 							// Made this more long-distance friendly
-							calculate_shading_table(shading_table, view, rectangle->shading_tables, (short)MIN(rectangle->depth, SHRT_MAX), rectangle->ambient_shade);
+							calculate_shading_table(shading_table, strip, view, rectangle->shading_tables, (short)MIN(rectangle->depth, SHRT_MAX), rectangle->ambient_shade);
 							break;
 						}
 						/* if shadeless, fall through to a single shading table, ignoring depth */
@@ -888,9 +1352,120 @@ void Rasterizer_SW_Class::texture_rectangle(rectangle_definition& textured_recta
 
 /* ---------- private code */
 
+static void allocate_strip_tables(
+	sw_texture_strip& strip)
+{
+	strip.scratch_table0= new short[MAXIMUM_SCRATCH_TABLE_ENTRIES];
+	strip.scratch_table1= new short[MAXIMUM_SCRATCH_TABLE_ENTRIES];
+	strip.precalculation_table= (void*)new char[MAXIMUM_PRECALCULATION_TABLE_ENTRY_SIZE*MAXIMUM_SCRATCH_TABLE_ENTRIES];
+	fc_assert(strip.scratch_table0&&strip.scratch_table1&&strip.precalculation_table);
+}
+
+/* how many threads (including the main one) the preferences ask for at this width */
+static int wanted_render_thread_count(
+	short screen_width)
+{
+	int count;
+	
+	switch (graphics_preferences->software_render_threads)
+	{
+		case _sw_threads_2: count= 2; break;
+		case _sw_threads_4: count= 4; break;
+		case _sw_threads_automatic: count= SDL_GetCPUCount(); break;
+		default: count= 1; break;
+	}
+	
+	count= MIN(count, screen_width/MINIMUM_STRIP_WIDTH);
+	return PIN(count, 1, MAXIMUM_RENDER_THREADS);
+}
+
+/* start or stop threads until there are this many besides the main thread */
+static void set_render_thread_count(
+	int count)
+{
+	if (render_thread_count>0)
+	{
+		render_threads_quit= true;
+		for (int i= 0; i<render_thread_count; ++i)
+		{
+			SDL_SemPost(render_threads[i].start);
+			SDL_WaitThread(render_threads[i].thread, NULL);
+			SDL_DestroySemaphore(render_threads[i].start);
+		}
+		render_threads_quit= false;
+		render_thread_count= 0;
+	}
+	
+	if (!render_threads_done) render_threads_done= SDL_CreateSemaphore(0);
+	
+	for (int i= 0; i<count; ++i)
+	{
+		render_thread_data& data= render_threads[i];
+		
+		/* the tables stay allocated for when the thread is next started */
+		if (!data.strip.scratch_table0) allocate_strip_tables(data.strip);
+		data.start= SDL_CreateSemaphore(0);
+		data.thread= SDL_CreateThread(render_thread_loop, "Rasterizer_SW_renderThread", &data);
+		if (!data.thread)
+		{
+			SDL_DestroySemaphore(data.start);
+			break;
+		}
+		render_thread_count= i+1;
+	}
+}
+
+static int render_thread_loop(
+	void *data)
+{
+	render_thread_data *thread= (render_thread_data *) data;
+	
+	while (true)
+	{
+		SDL_SemWait(thread->start);
+		if (render_threads_quit) break;
+		
+		thread->rasterizer->draw_queued_calls(thread->strip);
+		SDL_SemPost(render_threads_done);
+	}
+	
+	return 0;
+}
+
+/* limit each line of a horizontal polygon to the strip, advancing its texture coordinates
+	past any pixels cut off at the left */
+static void clip_horizontal_polygon_lines(
+	sw_texture_strip& strip,
+	struct _horizontal_polygon_line_data *data,
+	short *x0_table,
+	short *x1_table,
+	short line_count,
+	bool advance_source_y)
+{
+	while ((line_count-= 1)>=0)
+	{
+		short x0= *x0_table, x1= *x1_table;
+		
+		if (x0<strip.x0)
+		{
+			uint32 delta= strip.x0-x0;
+			
+			data->source_x+= delta*data->source_dx;
+			if (advance_source_y) data->source_y+= delta*data->source_dy;
+			x0= strip.x0;
+		}
+		if (x1>strip.x1) x1= strip.x1;
+		if (x1<x0) x1= x0;
+		
+		*x0_table++= x0, *x1_table++= x1;
+		data+= 1;
+	}
+}
+
 /* starting at x0 and for line_count vertical lines between *y0 and *y1, precalculate all the
 	information _texture_vertical_polygon_lines will need to work */
 static void _pretexture_vertical_polygon_lines(
+	sw_texture_strip& strip,
 	struct polygon_definition *polygon,
 	struct bitmap_definition *screen,
 	struct view_data *view,
@@ -990,7 +1565,7 @@ static void _pretexture_vertical_polygon_lines(
 		else
 		{
 			// LP change: made this more long-distance friendly
-			calculate_shading_table(line->shading_table, view, polygon->shading_tables, (short)MIN(world_x, SHRT_MAX), polygon->ambient_shade);
+			calculate_shading_table(line->shading_table, strip, view, polygon->shading_tables, (short)MIN(world_x, SHRT_MAX), polygon->ambient_shade);
 			// calculate_shading_table(line->shading_table, view, polygon->shading_tables, world_x, polygon->ambient_shade);
 		}
 
@@ -1013,6 +1588,7 @@ static void _pretexture_vertical_polygon_lines(
 }
 
 static void _pretexture_horizontal_polygon_lines(
+	sw_texture_strip& strip,
 	struct polygon_definition *polygon,
 	struct bitmap_definition *screen,
 	struct view_data *view,
@@ -1088,7 +1664,7 @@ static void _pretexture_horizontal_polygon_lines(
 		}
 		else
 		{
-			calculate_shading_table(data->shading_table, view, polygon->shading_tables, (short)MIN(depth, SHRT_MAX), polygon->ambient_shade);
+			calculate_shading_table(data->shading_table, strip, view, polygon->shading_tables, (short)MIN(depth, SHRT_MAX), polygon->ambient_shade);
 		}
 		
 		data++;
@@ -1100,6 +1676,7 @@ static void _pretexture_horizontal_polygon_lines(
 // height must be determined emperically (texture is vertically centered at 0)
 // #define LANDSCAPE_REPEAT_BITS 1
 static void _prelandscape_horizontal_polygon_lines(
+	sw_texture_strip& strip,
 	struct polygon_definition *polygon,
 	struct bitmap_definition *screen,
 	struct view_data *view,
@@ -1134,7 +1711,7 @@ static void _prelandscape_horizontal_polygon_lines(
 	}
 	else
 	{
-		calculate_shading_table(shading_table, view, polygon->shading_tables, 0, ambient_shade);
+		calculate_shading_table(shading_table, strip, view, polygon->shading_tables, 0, ambient_shade);
 	}
 	
 	// Find the height to repeat over; use value used for OpenGL texture setup
@@ -1145,27 +1722,48 @@ static void _prelandscape_horizontal_polygon_lines(
 	short height_shift = texture_height >> 1;
 	short height_repeat_mask = repeat_texture_height - 1;
 	short height_repeat_shift = repeat_texture_height >> 1;
+	short horizon= view->half_screen_height + view->dtanpitch;
+	
+	/* the landscape row for each screen row only changes with pitch, field of view, screen
+		size and the landscape itself, so it is kept from one polygon (and frame) to the next */
+	int32 key[SW_LANDSCAPE_KEY_LENGTH]= {
+		polygon->texture->width, polygon->texture->height, LandOpts->VertExp, LandOpts->VertRepeat,
+		LandOpts->OGL_AspRatExp, view->half_cone, view->standard_screen_width, horizon, screen->height };
+	std::vector<short>& rows= strip.landscape_rows;
+	int32 first_row= strip.landscape_first_row;
+	if (rows.empty() || memcmp(key, strip.landscape_key, sizeof(key)) ||
+		y0<first_row || y0+line_count>first_row+static_cast<int32>(rows.size()))
+	{
+		/* the whole screen, and any rows of this polygon off it */
+		first_row= MIN(0, y0);
+		rows.resize(MAX(screen->height, y0+line_count)-first_row);
+		for (int32 y= first_row; y<first_row+static_cast<int32>(rows.size()); ++y)
+		{
+			// LP change: using vertical pixel delta
+			// Also using vertical repeat if selected;
+			// fold the height into the range (-repeat_height/2, repeat_height)
+			short y_txtr_offset= FIXED_INTEGERAL_PART((y-horizon)*vertical_pixel_delta);
+			if (LandOpts->VertRepeat)
+				y_txtr_offset = ((y_txtr_offset + height_repeat_shift) & height_repeat_mask) -
+					height_repeat_shift;
+			rows[y-first_row]= texture_height - PIN(y_txtr_offset + height_shift, 0, height_reduced) - 1;
+		}
+		strip.landscape_first_row= first_row;
+		memcpy(strip.landscape_key, key, sizeof(key));
+	}
 	
-	y0-= view->half_screen_height + view->dtanpitch; /* back to virtual screen coordinates */
+	const short *source_y= &rows[0] + (y0-first_row);
 	while ((line_count-= 1)>=0)
 	{
 		short x0= *x0_table++;
 		
 		data->shading_table= shading_table;
-		// LP change: using vertical pixel delta
-		// Also using vertical repeat if selected;
-		// fold the height into the range (-repeat_height/2, repeat_height)
-		short y_txtr_offset= FIXED_INTEGERAL_PART(y0*vertical_pixel_delta);
-		if (LandOpts->VertRepeat)
-			y_txtr_offset = ((y_txtr_offset + height_repeat_shift) & height_repeat_mask) -
-				height_repeat_shift;
-		data->source_y= texture_height - PIN(y_txtr_offset + height_shift, 0, height_reduced) - 1;
+		data->source_y= *source_y++;
 		// LP change: using horizontal pixel delta
 		data->source_x= (first_horizontal_pixel + x0*horizontal_pixel_delta)<<landscape_free_bits;
 		data->source_dx= horizontal_pixel_delta<<landscape_free_bits;
 		
 		data+= 1;
-		y0+= 1;
 	}
 }
 
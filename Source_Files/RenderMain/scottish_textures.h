@@ -155,6 +155,7 @@ struct rectangle_definition
 	// For the convenience of the OpenGL 3D-model renderer
 	_fixed ceiling_light;		// The ambient_shade is the floor light
 	OGL_ModelData *ModelPtr;	// For models
+	short ModelLOD;				// Level of detail (NONE is the full model)
 	short ModelSequence, ModelFrame, NextModelFrame;	// For model animation
 	float MixFrac;				// Mixture between current and next frame
 	world_point3d Position;		// In overall world coordinates
@@ -212,6 +213,11 @@ extern short interface_bit_depth;
 
 extern short number_of_shading_tables, shading_table_fractional_bits, shading_table_size;
 
+// At 32 bits, collections have a shading table for every level, or for the software
+// renderer with compact shading, for every eighth one; it blends the levels between
+#define FULL_SHADING_TABLES32 256
+#define COMPACT_SHADING_TABLES32 32
+
 /* ---------- prototypes/SCOTTISH_TEXTURES.C */
 
 void allocate_texture_tables(void);
@@ -100,6 +100,7 @@ Jan 17, 2001 (Loren Petrich):
 #include "images.h"
 
 #include "map.h"
+#include "game_wad.h"
 
 // LP addition: OpenGL support
 #include "OGL_Render.h"
@@ -110,8 +111,13 @@ Jan 17, 2001 (Loren Petrich):
 
 #include "Packing.h"
 #include "SW_Texture_Extras.h"
+#include "preferences.h"
 
+#include <SDL_atomic.h>
+#include <SDL_cpuinfo.h>
 #include <SDL_rwops.h>
+#include <SDL_thread.h>
+#include <map>
 #include <memory>
 
 #include <boost/shared_ptr.hpp>
@@ -143,7 +149,8 @@ enum /* collection status */
 	markLOAD= 1,
 	markUNLOAD= 2,
 	markSTRIP= 4 /* we dont want bitmaps, just high/low-level shape data */,
-	markPATCHED = 8 /* force re-load */
+	markPATCHED = 8 /* force re-load */,
+	markPREFETCH = 16 /* the map uses it, so it is not loaded lazily */
 };
 
 enum /* flags */
@@ -172,6 +179,49 @@ short number_of_shading_tables, shading_table_fractional_bits, shading_table_siz
 // LP addition: opened-shapes-file object
 static OpenedFile ShapesFile;
 static OpenedResourceFile M1ShapesFile;
+static FileSpecifier ShapesFileSpec;
+
+// Collections' data read ahead of the next load_collections(), by collection
+struct staged_collection_data {
+	std::string path; // of the shapes file it was read from
+	int32 offset;
+	byte *data;
+	int32 length;
+};
+static std::map<short, staged_collection_data> staged_collections;
+static void free_staged_collections();
+
+// With lazy collections, only what's marked for prefetching (what the map
+// itself uses) is built at level start; the rest get their bitmaps read and
+// their colors and shading tables built the first time they are wanted
+struct deferred_collection_data {
+	bool bitmaps_deferred;
+	bool colors_deferred;
+	// where the collection is in the shapes file, and its bitmaps in it
+	int32 offset;
+	std::vector<uint32> bitmap_offsets;
+};
+static deferred_collection_data deferred_collections[MAXIMUM_COLLECTIONS];
+static bool loading_lazily = false;
+// nothing is materialized while load_collections() runs
+static bool collections_loading = false;
+static bool lazy_is_opengl = false;
+static void materialize_collection(short collection_index);
+static void load_deferred_bitmaps(short collection_index);
+
+// What the last load_collections() built its collections for; restoring a game on the
+// level already loaded keeps them all when none of this has changed since
+struct collections_build_data {
+	bool is_opengl;
+	short bit_depth;
+	short number_of_shading_tables;
+	bool loading_lazily;
+	std::vector<uint8> shapes_patch;
+
+	collections_build_data() : is_opengl(false), bit_depth(NONE), number_of_shading_tables(0), loading_lazily(false) {}
+};
+static collections_build_data last_collections_build;
+static bool collections_can_be_kept(bool is_opengl);
 
 static enum {
 	M1_SHAPES_VERSION = 1,
@@ -180,9 +230,39 @@ static enum {
 
 bool shapes_file_is_m1() { return shapes_file_version == M1_SHAPES_VERSION; }
 
+// bumped whenever shapes, bitmaps or shading tables are loaded, patched or freed;
+// never 0, so a cleared handle to any of them is never taken for a good one
+static uint32 shape_data_generation = 1;
+
+uint32 get_shape_data_generation() { return shape_data_generation; }
+
+static void shape_data_changed()
+{
+	if (++shape_data_generation == 0)
+		shape_data_generation = 1;
+}
+
+// What extended_get_shape_bitmap_and_shading_table() found for a shape lately;
+// every surface and sprite of every view asks again, mostly for the same few shapes
+struct resolved_shape_data
+{
+	uint32 generation;
+	int16 collection_code;
+	int16 low_level_shape_index;
+	int16 shading_mode; // NONE if the shading tables weren't asked for
+	struct bitmap_definition *bitmap;
+	void *shading_tables;
+};
+
+const int RESOLVED_SHAPE_CACHE_SIZE = 1024; // a power of two
+static resolved_shape_data resolved_shapes[RESOLVED_SHAPE_CACHE_SIZE];
+
 /* ---------- private prototypes */
 
 static void update_color_environment(bool is_opengl);
+static void update_collection_color_environment(short collection_index, pixel8 *remapping_table, struct rgb_color_value *colors, short& color_count, bool is_opengl);
+static void update_collection_color_environment_alone(short collection_index, bool is_opengl);
+static void update_color_environments_in_parallel(bool is_opengl, bool *updated);
 static short find_or_add_color(struct rgb_color_value *color, struct rgb_color_value *colors, short *color_count, bool update_flags);
 static void _change_clut(void (*change_clut_proc)(struct color_table *color_table), struct rgb_color_value *colors, short color_count);
 
@@ -202,7 +282,7 @@ static void build_tinting_table8(struct rgb_color_value *colors, short color_cou
 static void build_tinting_table16(struct rgb_color_value *colors, short color_count, pixel16 *tint_table, struct rgb_color *tint_color);
 static void build_tinting_table32(struct rgb_color_value *colors, short color_count, pixel32 *tint_table, struct rgb_color *tint_color, bool is_opengl);
 
-static void precalculate_bit_depth_constants(void);
+static void precalculate_bit_depth_constants(bool is_opengl);
 
 static bool collection_loaded(struct collection_header *header);
 static void unload_collection(struct collection_header *header);
@@ -500,6 +580,8 @@ static void load_clut(rgb_color_value *r, int count, SDL_RWops *p)
 
 static void load_high_level_shape(std::vector<uint8>& shape, SDL_RWops *p)
 {
+	shape_data_changed();
+	
 	int16 type = SDL_ReadBE16(p);
 	int16 flags = SDL_ReadBE16(p);
 	char name[HIGH_LEVEL_SHAPE_NAME_LENGTH + 2];
@@ -560,6 +642,8 @@ static void load_high_level_shape(std::vector<uint8>& shape, SDL_RWops *p)
 
 static void load_low_level_shape(low_level_shape_definition *d, SDL_RWops *p)
 {
+	shape_data_changed();
+	
 	d->flags = SDL_ReadBE16(p);
 	d->minimum_light_intensity = SDL_ReadBE32(p);
 	d->bitmap_index = SDL_ReadBE16(p);
@@ -639,6 +723,8 @@ static void convert_m1_rle(std::vector<uint8>& bitmap, int scanlines, int scanli
 
 static void load_bitmap(std::vector<uint8>& bitmap, SDL_RWops *p, int version)
 {
+	shape_data_changed();
+	
 	bitmap_definition b;
 
 	// Convert bitmap definition
@@ -734,6 +820,7 @@ static void load_bitmap(std::vector<uint8>& bitmap, SDL_RWops *p, int version)
 static void allocate_shading_tables(short collection_index, bool strip)
 {
 	collection_header *header = get_collection_header(collection_index);
+	shape_data_changed();
 	// Allocate enough space for this collection's shading tables
 	if (strip)
 		header->shading_tables = NULL;
@@ -782,9 +869,27 @@ static bool load_collection(short collection_index, bool strip)
 			src_offset = header->offset16;
 		}
 
-		p = ShapesFile.GetRWops();
-		ShapesFile.SetPosition(0);
-		src_offset += SDL_RWtell(p);
+		if (loading_lazily && !strip && collection_index != _collection_interface && !(header->status & markPREFETCH))
+		{
+			deferred_collections[collection_index].bitmaps_deferred = true;
+			deferred_collections[collection_index].colors_deferred = true;
+			deferred_collections[collection_index].offset = src_offset;
+		}
+
+		std::map<short, staged_collection_data>::iterator staged = staged_collections.find(collection_index);
+		if (staged != staged_collections.end() && staged->second.offset == src_offset &&
+			staged->second.path == ShapesFileSpec.GetPath())
+		{
+			m1_p.reset(SDL_RWFromConstMem(staged->second.data, staged->second.length), SDL_FreeRW);
+			p = m1_p.get();
+			src_offset = 0;
+		}
+		else
+		{
+			p = ShapesFile.GetRWops();
+			ShapesFile.SetPosition(0);
+			src_offset += SDL_RWtell(p);
+		}
 	}
 
 	// Read collection definition
@@ -825,9 +930,14 @@ static bool load_collection(short collection_index, bool strip)
 	SDL_RWread(p, &t[0], sizeof(uint32), cd->bitmap_count);
 	byte_swap_memory(&t[0], _4byte, cd->bitmap_count);
 
-	for (int i = 0; i < cd->bitmap_count; i++) {
-		SDL_RWseek(p, src_offset + t[i], RW_SEEK_SET);
-		load_bitmap(cd->bitmaps[i], p, shapes_file_version);
+	if (deferred_collections[collection_index].bitmaps_deferred)
+		deferred_collections[collection_index].bitmap_offsets.swap(t);
+	else
+	{
+		for (int i = 0; i < cd->bitmap_count; i++) {
+			SDL_RWseek(p, src_offset + t[i], RW_SEEK_SET);
+			load_bitmap(cd->bitmaps[i], p, shapes_file_version);
+		}
 	}
 
 	header->collection = cd.release();
@@ -843,6 +953,7 @@ static bool load_collection(short collection_index, bool strip)
 	if (header->shading_tables == NULL) {
 		delete header->collection;
 		header->collection = NULL;
+		deferred_collections[collection_index] = deferred_collection_data();
 		return false;
 	}
 
@@ -858,10 +969,46 @@ static bool load_collection(short collection_index, bool strip)
 static void unload_collection(struct collection_header *header)
 {
 	assert(header->collection);
+	shape_data_changed();
 	delete header->collection;
 	free(header->shading_tables);
 	header->collection = NULL;
 	header->shading_tables = NULL;
+	deferred_collections[header - collection_headers] = deferred_collection_data();
+}
+
+static void load_deferred_bitmaps(short collection_index)
+{
+	deferred_collection_data& deferred = deferred_collections[collection_index];
+	deferred.bitmaps_deferred = false;
+
+	collection_definition *cd = get_collection_definition(collection_index);
+	if (!cd || !ShapesFile.IsOpen()) return;
+
+	SDL_RWops *p = ShapesFile.GetRWops();
+	ShapesFile.SetPosition(0);
+	int32 src_offset = deferred.offset + SDL_RWtell(p);
+	for (size_t i = 0; i < deferred.bitmap_offsets.size(); i++) {
+		SDL_RWseek(p, src_offset + deferred.bitmap_offsets[i], RW_SEEK_SET);
+		load_bitmap(cd->bitmaps[i], p, shapes_file_version);
+	}
+	std::vector<uint32>().swap(deferred.bitmap_offsets);
+}
+
+static void materialize_collection(short collection_index)
+{
+	deferred_collection_data& deferred = deferred_collections[collection_index];
+	if (deferred.bitmaps_deferred)
+		load_deferred_bitmaps(collection_index);
+
+	if (deferred.colors_deferred)
+	{
+		deferred.colors_deferred = false;
+
+		update_collection_color_environment_alone(collection_index, lazy_is_opengl);
+		if (!lazy_is_opengl)
+			SW_Texture_Extras::instance()->Load(collection_index);
+	}
 }
 
 #define ENDC_TAG FOUR_CHARS_TO_INT('e', 'n', 'd', 'c')
@@ -909,6 +1056,10 @@ void load_shapes_patch(SDL_RWops *p, bool override_replacements)
 			int32 collection_index = SDL_ReadBE32(p);
 			int32 patch_bit_depth = SDL_ReadBE32(p);
 
+			// patched bitmaps mustn't be read over later
+			if (collection_index >= 0 && collection_index < MAXIMUM_COLLECTIONS && deferred_collections[collection_index].bitmaps_deferred)
+				load_deferred_bitmaps(collection_index);
+
 			bool collection_end = false;
 			while (!collection_end)
 			{
@@ -1033,6 +1184,9 @@ void initialize_shape_handler()
 
 void open_shapes_file(FileSpecifier& File)
 {
+	// it may be reading ahead from the old file
+	cancel_level_preload();
+
 	if (File.Open(M1ShapesFile) && M1ShapesFile.Check('.','2','5','6',128))
 	{
 		shapes_file_version = M1_SHAPES_VERSION;
@@ -1040,6 +1194,8 @@ void open_shapes_file(FileSpecifier& File)
 	else if (File.Open(ShapesFile))
 	{
 		shapes_file_version = M2_SHAPES_VERSION;
+		ShapesFileSpec = File;
+		free_staged_collections();
 		// Load the collection headers;
 		// need a buffer for the packed data
 		int Size = MAXIMUM_COLLECTIONS*SIZEOF_collection_header;
@@ -1110,6 +1266,53 @@ bool collection_loaded(short collection_index)
 	return collection_loaded(header);
 }
 
+bool get_shapes_file_for_staging(FileSpecifier& File)
+{
+	if (shapes_file_version == M1_SHAPES_VERSION || !ShapesFile.IsOpen())
+		return false;
+
+	File = ShapesFileSpec;
+	return true;
+}
+
+bool get_collection_extent(short collection_index, int32& offset, int32& length)
+{
+	if (shapes_file_version == M1_SHAPES_VERSION || collection_index < 0 || collection_index >= MAXIMUM_COLLECTIONS)
+		return false;
+
+	// the same choice load_collection() makes
+	collection_header *header = get_collection_header(collection_index);
+	if (bit_depth == 8 || header->offset16 == -1) {
+		offset = header->offset;
+		length = header->length;
+	} else {
+		offset = header->offset16;
+		length = header->length16;
+	}
+
+	return offset != -1 && length > 0;
+}
+
+void stage_collection_data(short collection_index, const FileSpecifier& File, int32 offset, byte *data, int32 length)
+{
+	std::map<short, staged_collection_data>::iterator staged = staged_collections.find(collection_index);
+	if (staged != staged_collections.end())
+		free(staged->second.data);
+
+	staged_collection_data& collection = staged_collections[collection_index];
+	collection.path = File.GetPath();
+	collection.offset = offset;
+	collection.data = data;
+	collection.length = length;
+}
+
+static void free_staged_collections()
+{
+	for (std::map<short, staged_collection_data>::iterator it = staged_collections.begin(); it != staged_collections.end(); ++it)
+		free(it->second.data);
+	staged_collections.clear();
+}
+
 bool can_load_collection(short collection_index)
 {
 	if (collection_index >= 0 && collection_index < NUMBER_OF_COLLECTIONS)
@@ -1165,6 +1368,18 @@ void mark_collection(
 	}
 }
 
+void prefetch_collection(
+	short collection_code)
+{
+	if (collection_code!=NONE)
+	{
+		short collection_index= GET_COLLECTION(collection_code);
+	
+		assert(collection_index>=0&&collection_index<MAXIMUM_COLLECTIONS);
+		collection_headers[collection_index].status|= markPREFETCH;
+	}
+}
+
 void strip_collection(
 	short collection_code)
 {
@@ -1244,6 +1459,20 @@ void extended_get_shape_bitmap_and_shading_table(
 		collection_index+1 == MAXIMUM_COLLECTIONS &&
 		low_level_shape_index+1 == MAXIMUM_SHAPES_PER_COLLECTION));
 	
+	if (!shading_tables) shading_mode= NONE;
+	
+	// Collections still to be materialized can't be cached; looking them up does that
+	bool cacheable= bitmap && collection_index>=0 && collection_index<MAXIMUM_COLLECTIONS && !collections_loading &&
+		!deferred_collections[collection_index].bitmaps_deferred && !deferred_collections[collection_index].colors_deferred;
+	resolved_shape_data& resolved= resolved_shapes[((uint32(collection_code)*131 + uint32(low_level_shape_index))*2 + (shading_mode==_shading_infravision)) & (RESOLVED_SHAPE_CACHE_SIZE-1)];
+	if (cacheable && resolved.generation==shape_data_generation && resolved.collection_code==collection_code &&
+		resolved.low_level_shape_index==low_level_shape_index && resolved.shading_mode==shading_mode)
+	{
+		*bitmap= resolved.bitmap;
+		if (shading_tables) *shading_tables= resolved.shading_tables;
+		return;
+	}
+	
 	struct low_level_shape_definition *low_level_shape= get_low_level_shape_definition(collection_index, low_level_shape_index);
 	// Return NULL pointers for bitmap and shading table if the frame does not exist
 	if (!low_level_shape)
@@ -1270,6 +1499,16 @@ void extended_get_shape_bitmap_and_shading_table(
 				break;
 		}
 	}
+	
+	if (cacheable)
+	{
+		resolved.generation= shape_data_generation;
+		resolved.collection_code= collection_code;
+		resolved.low_level_shape_index= low_level_shape_index;
+		resolved.shading_mode= shading_mode;
+		resolved.bitmap= *bitmap;
+		resolved.shading_tables= shading_tables ? *shading_tables : NULL;
+	}
 }
 
 struct shape_information_data *extended_get_shape_information(
@@ -1367,19 +1606,44 @@ void *get_global_shading_table(
 
 void load_collections(
 	bool with_progress_bar,
-	bool is_opengl)
+	bool is_opengl,
+	bool keep_loaded)
 {
 	struct collection_header *header;
 	short collection_index;
+	bool keeping;
 
 	if (with_progress_bar)
 	{
 //		open_progress_dialog(_loading_collections);
 //		draw_progress_bar(0, 2*MAXIMUM_COLLECTIONS);
 	}
-	precalculate_bit_depth_constants();
+	precalculate_bit_depth_constants(is_opengl);
 	
 	free_and_unlock_memory(); /* do our best to get a big, unfragmented heap */
+
+	// 8-bit colors depend on every collection loaded before, so they can't wait
+	loading_lazily = (graphics_preferences->lazy_collections || environment_preferences->low_memory) && bit_depth != 8 && shapes_file_version != M1_SHAPES_VERSION;
+	lazy_is_opengl = is_opengl;
+	collections_loading = true;
+
+	/* nothing to unload, load, patch or remap if what's wanted is what's there already;
+		substitute textures and opacity tables come from MML, which is run over again, so
+		they are redone either way */
+	keeping = keep_loaded && collections_can_be_kept(is_opengl);
+
+	if (loading_lazily)
+	{
+		// and the screen's colors come from the last collection built
+		for (collection_index= MAXIMUM_COLLECTIONS-1; collection_index>=0; --collection_index)
+		{
+			if (collection_headers[collection_index].status&markLOAD)
+			{
+				collection_headers[collection_index].status|= markPREFETCH;
+				break;
+			}
+		}
+	}
 	
 	/* first go through our list of shape collections and dispose of any collections which
 		were marked for unloading.  at the same time, unlock all those collections which
@@ -1390,7 +1654,7 @@ void load_collections(
 //			draw_progress_bar(collection_index, 2*MAXIMUM_COLLECTIONS);
 		if (true)
 		{
-			if (collection_loaded(header))
+			if (collection_loaded(header) && !keeping)
 			{
 				unload_collection(header);
 			}
@@ -1428,28 +1692,42 @@ void load_collections(
 		}
 		
 		/* clear action flags */
+		if (!keeping)
+			header->flags= (collection_loaded(header) && (header->status&markSTRIP)) ? _collection_is_stripped : 0;
 		header->status= markNONE;
-		header->flags= 0;
 	}
 
-	Plugins::instance()->load_shapes_patches(is_opengl);
+	// whatever was staged and not wanted after all
+	free_staged_collections();
 
-	if (shapes_patch.size())
+	if (!keeping)
 	{
-		SDL_RWops *f = SDL_RWFromMem(&shapes_patch[0], shapes_patch.size());
-		load_shapes_patch(f, true);
-		SDL_RWclose(f);
-	}
+		Plugins::instance()->load_shapes_patches(is_opengl);
 
-	/* remap the shapes, recalculate row base addresses, build our new world color table and
-		(finally) update the screen to reflect our changes */
-	update_color_environment(is_opengl);
+		if (shapes_patch.size())
+		{
+			SDL_RWops *f = SDL_RWFromMem(&shapes_patch[0], shapes_patch.size());
+			load_shapes_patch(f, true);
+			SDL_RWclose(f);
+		}
+
+		/* remap the shapes, recalculate row base addresses, build our new world color table and
+			(finally) update the screen to reflect our changes */
+		update_color_environment(is_opengl);
+
+		last_collections_build.is_opengl = is_opengl;
+		last_collections_build.bit_depth = bit_depth;
+		last_collections_build.number_of_shading_tables = number_of_shading_tables;
+		last_collections_build.loading_lazily = loading_lazily;
+		last_collections_build.shapes_patch = shapes_patch;
+	}
+	collections_loading = false;
 
 	// load software enhancements
 	if (!is_opengl) {
 		for (collection_index= 0, header= collection_headers; collection_index < MAXIMUM_COLLECTIONS; ++collection_index, ++header)
 		{
-			if (collection_loaded(header))
+			if (collection_loaded(header) && !deferred_collections[collection_index].colors_deferred)
 			{
 				SW_Texture_Extras::instance()->Load(collection_index);
 			}
@@ -1459,6 +1737,34 @@ void load_collections(
 //		close_progress_dialog();
 }
 
+/* whether every collection marked for loading is in memory already, and nothing else is,
+	built the way load_collections() would build it now */
+static bool collections_can_be_kept(
+	bool is_opengl)
+{
+	if (is_opengl != last_collections_build.is_opengl ||
+		bit_depth != last_collections_build.bit_depth ||
+		number_of_shading_tables != last_collections_build.number_of_shading_tables ||
+		loading_lazily != last_collections_build.loading_lazily ||
+		shapes_patch != last_collections_build.shapes_patch)
+	{
+		return false;
+	}
+
+	struct collection_header *header;
+	short collection_index;
+	for (collection_index= 0, header= collection_headers; collection_index<MAXIMUM_COLLECTIONS; ++collection_index, ++header)
+	{
+		bool wanted= (header->status&markLOAD) ? true : false;
+		if (wanted != collection_loaded(header)) return false;
+
+		bool stripped= (header->status&markSTRIP) ? true : false;
+		if (wanted && stripped != ((header->flags&_collection_is_stripped) ? true : false)) return false;
+	}
+
+	return true;
+}
+
 #ifdef HAVE_OPENGL
 
 int count_replacement_collections()
@@ -1496,8 +1802,10 @@ void load_replacement_collections()
 /* ---------- private code */
 
 static void precalculate_bit_depth_constants(
-	void)
+	bool is_opengl)
 {
+	shape_data_changed();
+	
 	switch (bit_depth)
 	{
 		case 8:
@@ -1513,8 +1821,17 @@ static void precalculate_bit_depth_constants(
 			shading_table_size= PIXEL8_MAXIMUM_COLORS*sizeof(pixel16);
 			break;
 		case 32:
-			number_of_shading_tables= 256;
-			shading_table_fractional_bits= 8;
+			// OpenGL only takes the brightest table, so there's nothing to save there
+			if (!is_opengl && (graphics_preferences->software_shading==_sw_shading_compact || environment_preferences->low_memory))
+			{
+				number_of_shading_tables= COMPACT_SHADING_TABLES32;
+				shading_table_fractional_bits= 5;
+			}
+			else
+			{
+				number_of_shading_tables= FULL_SHADING_TABLES32;
+				shading_table_fractional_bits= 8;
+			}
 //			next_shading_table_shift= 10;
 			shading_table_size= PIXEL8_MAXIMUM_COLORS*sizeof(pixel32);
 			break;
@@ -1580,13 +1897,202 @@ static short find_or_add_color(
 	return (*color_count)++;
 }
 
+/* add a collection's colors to the aggregate color table, remap its bitmaps, and build its
+	shading and tinting tables */
+static void update_collection_color_environment(
+	short collection_index,
+	pixel8 *remapping_table,
+	struct rgb_color_value *colors,
+	short& color_count,
+	bool is_opengl)
+{
+	struct collection_definition *collection= get_collection_definition(collection_index);
+	short bitmap_index;
+	
+	struct rgb_color_value *primary_colors= get_collection_colors(collection_index, 0)+NUMBER_OF_PRIVATE_COLORS;
+	assert(primary_colors);
+	short color_index, clut_index;
+
+//			if (collection_index==15) dprintf("primary clut %p", primary_colors);
+//			dprintf("primary clut %d entries;dm #%d #%d", collection->color_count, primary_colors, collection->color_count*sizeof(ColorSpec));
+
+	/* add the colors from this collections primary color table to the aggregate color
+		table and build the remapping table */
+	for (color_index=0;color_index<collection->color_count-NUMBER_OF_PRIVATE_COLORS;++color_index)
+	{
+		primary_colors[color_index].value= remapping_table[primary_colors[color_index].value]= 
+			find_or_add_color(&primary_colors[color_index], colors, &color_count);
+	}
+	
+	/* then remap the collection and recalculate the base addresses of each bitmap */
+	for (bitmap_index= 0; bitmap_index<collection->bitmap_count; ++bitmap_index)
+	{
+		struct bitmap_definition *bitmap= get_bitmap_definition(collection_index, bitmap_index);
+		assert(bitmap);
+		
+		/* calculate row base addresses ... */
+		bitmap->row_addresses[0]= calculate_bitmap_origin(bitmap);
+		precalculate_bitmap_row_addresses(bitmap);
+
+		/* ... and remap it */
+		remap_bitmap(bitmap, remapping_table);
+	}
+	
+	/* build a shading table for each clut in this collection */
+	for (clut_index= 0; clut_index<collection->clut_count; ++clut_index)
+	{
+		void *primary_shading_table= get_collection_shading_tables(collection_index, 0);
+		short collection_bit_depth= collection->type==_interface_collection ? 8 : bit_depth;
+
+		if (clut_index)
+		{
+			struct rgb_color_value *alternate_colors= get_collection_colors(collection_index, clut_index)+NUMBER_OF_PRIVATE_COLORS;
+			assert(alternate_colors);
+			void *alternate_shading_table= get_collection_shading_tables(collection_index, clut_index);
+			pixel8 shading_remapping_table[PIXEL8_MAXIMUM_COLORS];
+			
+			memset(shading_remapping_table, 0, PIXEL8_MAXIMUM_COLORS*sizeof(pixel8));
+			
+//					dprintf("alternate clut %d entries;dm #%d #%d", collection->color_count, alternate_colors, collection->color_count*sizeof(ColorSpec));
+			
+			/* build a remapping table for the primary shading table which we can use to
+				calculate this alternate shading table */
+			for (color_index= 0; color_index<PIXEL8_MAXIMUM_COLORS; ++color_index) shading_remapping_table[color_index]= static_cast<pixel8>(color_index);
+			for (color_index= 0; color_index<collection->color_count-NUMBER_OF_PRIVATE_COLORS; ++color_index)
+			{
+				shading_remapping_table[find_or_add_color(&primary_colors[color_index], colors, &color_count, false)]= 
+					find_or_add_color(&alternate_colors[color_index], colors, &color_count);
+			}
+//					shading_remapping_table[iBLACK]= iBLACK; /* make iBLACK==>iBLACK remapping explicit */
+
+			switch (collection_bit_depth)
+			{
+				case 8:
+					/* duplicate the primary shading table and remap it */
+					memcpy(alternate_shading_table, primary_shading_table, get_shading_table_size(collection_index));
+					map_bytes((unsigned char *)alternate_shading_table, shading_remapping_table, get_shading_table_size(collection_index));
+					break;
+				
+				case 16:
+					build_shading_tables16(colors, color_count, (pixel16 *)alternate_shading_table, shading_remapping_table, is_opengl); break;
+					break;
+				
+				case 32:
+					build_shading_tables32(colors, color_count, (pixel32 *)alternate_shading_table, shading_remapping_table, is_opengl); break;
+					break;
+				
+				default:
+					assert(false);
+					break;
+			}
+		}
+		else
+		{
+			/* build the primary shading table */
+			switch (collection_bit_depth)
+			{
+			case 8: build_shading_tables8(colors, color_count, (unsigned char *)primary_shading_table); break;
+			case 16: build_shading_tables16(colors, color_count, (pixel16 *)primary_shading_table, (byte *) NULL, is_opengl); break;
+			case 32: build_shading_tables32(colors, color_count,  (pixel32 *)primary_shading_table, (byte *) NULL, is_opengl); break;
+				default:
+					assert(false);
+					break;
+			}
+		}
+	}
+	
+	build_collection_tinting_table(colors, color_count, collection_index, is_opengl);
+	
+	/* 8-bit interface, non-8-bit main window; remember interface CLUT separately */
+	if (collection_index==_collection_interface && interface_bit_depth==8 && bit_depth!=interface_bit_depth) _change_clut(change_interface_clut, colors, color_count);
+}
+
+/* outside of 8-bit, no collection's colors carry over into the next, so each one can be
+	done on its own */
+static void update_collection_color_environment_alone(
+	short collection_index,
+	bool is_opengl)
+{
+	pixel8 remapping_table[PIXEL8_MAXIMUM_COLORS];
+	struct rgb_color_value colors[PIXEL8_MAXIMUM_COLORS];
+
+	memset(remapping_table, 0, PIXEL8_MAXIMUM_COLORS*sizeof(pixel8));
+
+	// dummy color to hold the first index (zero) for transparent pixels
+	colors[0].red= colors[0].green= colors[0].blue= 65535;
+	colors[0].flags= colors[0].value= 0;
+	short color_count= 1;
+
+	update_collection_color_environment(collection_index, remapping_table, colors, color_count, is_opengl);
+}
+
+enum {
+	MAXIMUM_COLOR_ENVIRONMENT_WORKERS = 8
+};
+
+struct color_environment_jobs {
+	short collections[MAXIMUM_COLLECTIONS];
+	int count;
+	SDL_atomic_t next;
+	bool is_opengl;
+};
+
+static int color_environment_worker(void *data)
+{
+	color_environment_jobs *jobs = (color_environment_jobs *) data;
+	int job;
+	while ((job = SDL_AtomicAdd(&jobs->next, 1)) < jobs->count)
+		update_collection_color_environment_alone(jobs->collections[job], jobs->is_opengl);
+	return 0;
+}
+
+/* builds every loaded collection's shading and tinting tables, but the interface's (which
+	may change the interface CLUT), with as many threads as there are processors */
+static void update_color_environments_in_parallel(
+	bool is_opengl,
+	bool *updated)
+{
+	color_environment_jobs jobs;
+	jobs.count = 0;
+	jobs.is_opengl = is_opengl;
+	SDL_AtomicSet(&jobs.next, 0);
+
+	for (short collection_index= 0; collection_index<MAXIMUM_COLLECTIONS; ++collection_index)
+	{
+		struct collection_definition *collection= get_collection_definition(collection_index);
+		if (collection && collection->bitmap_count && collection_index!=_collection_interface && !deferred_collections[collection_index].colors_deferred)
+			jobs.collections[jobs.count++] = collection_index;
+	}
+	if (jobs.count < 2) return;
+
+	SDL_Thread *workers[MAXIMUM_COLOR_ENVIRONMENT_WORKERS];
+	int worker_count = MIN(MIN(SDL_GetCPUCount() - 1, jobs.count - 1), int(MAXIMUM_COLOR_ENVIRONMENT_WORKERS));
+	int started = 0;
+	for (int i = 0; i < worker_count; ++i)
+	{
+		workers[started] = SDL_CreateThread(color_environment_worker, "shading_tables", &jobs);
+		if (workers[started]) ++started;
+	}
+
+	// this thread takes jobs too, so it all gets done even without workers
+	color_environment_worker(&jobs);
+	for (int i = 0; i < started; ++i)
+		SDL_WaitThread(workers[i], NULL);
+
+	for (int job = 0; job < jobs.count; ++job)
+		updated[jobs.collections[job]] = true;
+}
+
 static void update_color_environment(
 	bool is_opengl)
 {
 	short color_count;
 	short collection_index;
-	short bitmap_index;
+	bool updated[MAXIMUM_COLLECTIONS];
 	
+	objlist_clear(updated, MAXIMUM_COLLECTIONS);
+	if (bit_depth!=8) update_color_environments_in_parallel(is_opengl, updated);
+
 	pixel8 remapping_table[PIXEL8_MAXIMUM_COLORS];
 	struct rgb_color_value colors[PIXEL8_MAXIMUM_COLORS];
 
@@ -1606,104 +2112,10 @@ static void update_color_environment(
 
 //		dprintf("collection #%d", collection_index);
 		
-		if (collection && collection->bitmap_count)
+		// lazily loaded collections do this when they're first wanted
+		if (collection && collection->bitmap_count && !deferred_collections[collection_index].colors_deferred && !updated[collection_index])
 		{
-			struct rgb_color_value *primary_colors= get_collection_colors(collection_index, 0)+NUMBER_OF_PRIVATE_COLORS;
-			assert(primary_colors);
-			short color_index, clut_index;
-
-//			if (collection_index==15) dprintf("primary clut %p", primary_colors);
-//			dprintf("primary clut %d entries;dm #%d #%d", collection->color_count, primary_colors, collection->color_count*sizeof(ColorSpec));
-
-			/* add the colors from this collections primary color table to the aggregate color
-				table and build the remapping table */
-			for (color_index=0;color_index<collection->color_count-NUMBER_OF_PRIVATE_COLORS;++color_index)
-			{
-				primary_colors[color_index].value= remapping_table[primary_colors[color_index].value]= 
-					find_or_add_color(&primary_colors[color_index], colors, &color_count);
-			}
-			
-			/* then remap the collection and recalculate the base addresses of each bitmap */
-			for (bitmap_index= 0; bitmap_index<collection->bitmap_count; ++bitmap_index)
-			{
-				struct bitmap_definition *bitmap= get_bitmap_definition(collection_index, bitmap_index);
-				assert(bitmap);
-				
-				/* calculate row base addresses ... */
-				bitmap->row_addresses[0]= calculate_bitmap_origin(bitmap);
-				precalculate_bitmap_row_addresses(bitmap);
-
-				/* ... and remap it */
-				remap_bitmap(bitmap, remapping_table);
-			}
-			
-			/* build a shading table for each clut in this collection */
-			for (clut_index= 0; clut_index<collection->clut_count; ++clut_index)
-			{
-				void *primary_shading_table= get_collection_shading_tables(collection_index, 0);
-				short collection_bit_depth= collection->type==_interface_collection ? 8 : bit_depth;
-
-				if (clut_index)
-				{
-					struct rgb_color_value *alternate_colors= get_collection_colors(collection_index, clut_index)+NUMBER_OF_PRIVATE_COLORS;
-					assert(alternate_colors);
-					void *alternate_shading_table= get_collection_shading_tables(collection_index, clut_index);
-					pixel8 shading_remapping_table[PIXEL8_MAXIMUM_COLORS];
-					
-					memset(shading_remapping_table, 0, PIXEL8_MAXIMUM_COLORS*sizeof(pixel8));
-					
-//					dprintf("alternate clut %d entries;dm #%d #%d", collection->color_count, alternate_colors, collection->color_count*sizeof(ColorSpec));
-					
-					/* build a remapping table for the primary shading table which we can use to
-						calculate this alternate shading table */
-					for (color_index= 0; color_index<PIXEL8_MAXIMUM_COLORS; ++color_index) shading_remapping_table[color_index]= static_cast<pixel8>(color_index);
-					for (color_index= 0; color_index<collection->color_count-NUMBER_OF_PRIVATE_COLORS; ++color_index)
-					{
-						shading_remapping_table[find_or_add_color(&primary_colors[color_index], colors, &color_count, false)]= 
-							find_or_add_color(&alternate_colors[color_index], colors, &color_count);
-					}
-//					shading_remapping_table[iBLACK]= iBLACK; /* make iBLACK==>iBLACK remapping explicit */
-
-					switch (collection_bit_depth)
-					{
-						case 8:
-							/* duplicate the primary shading table and remap it */
-							memcpy(alternate_shading_table, primary_shading_table, get_shading_table_size(collection_index));
-							map_bytes((unsigned char *)alternate_shading_table, shading_remapping_table, get_shading_table_size(collection_index));
-							break;
-						
-						case 16:
-							build_shading_tables16(colors, color_count, (pixel16 *)alternate_shading_table, shading_remapping_table, is_opengl); break;
-							break;
-						
-						case 32:
-							build_shading_tables32(colors, color_count, (pixel32 *)alternate_shading_table, shading_remapping_table, is_opengl); break;
-							break;
-						
-						default:
-							assert(false);
-							break;
-					}
-				}
-				else
-				{
-					/* build the primary shading table */
-					switch (collection_bit_depth)
-					{
-					case 8: build_shading_tables8(colors, color_count, (unsigned char *)primary_shading_table); break;
-					case 16: build_shading_tables16(colors, color_count, (pixel16 *)primary_shading_table, (byte *) NULL, is_opengl); break;
-					case 32: build_shading_tables32(colors, color_count,  (pixel32 *)primary_shading_table, (byte *) NULL, is_opengl); break;
-						default:
-							assert(false);
-							break;
-					}
-				}
-			}
-			
-			build_collection_tinting_table(colors, color_count, collection_index, is_opengl);
-			
-			/* 8-bit interface, non-8-bit main window; remember interface CLUT separately */
-			if (collection_index==_collection_interface && interface_bit_depth==8 && bit_depth!=interface_bit_depth) _change_clut(change_interface_clut, colors, color_count);
+			update_collection_color_environment(collection_index, remapping_table, colors, color_count, is_opengl);
 			
 			/* if were not in 8-bit, we dont have to carry our colors over into the next collection */
 			if (bit_depth!=8) color_count= 1;
@@ -1867,6 +2279,62 @@ static void build_shading_tables16(
 	}
 }
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SHADING_TABLES_SSE2
+#include <emmintrin.h>
+
+/* four shading levels of one color at a time; the products stay under 2^24, and every
+	quotient is far enough from the next integer, that float division truncates exactly as
+	the integer division does; returns the first level left for the scalar loop */
+static short build_shading_levels32_sse2(
+	struct rgb_color_value *color,
+	pixel32 *shading_table,
+	SDL_PixelFormat *fmt,
+	bool is_opengl)
+{
+	const bool self_luminescent= (color->flags&SELF_LUMINESCENT_COLOR_FLAG) != 0;
+	const __m128 divisor= _mm_set1_ps(float(number_of_shading_tables-1));
+	const __m128 red= _mm_set1_ps(float(color->red));
+	const __m128 green= _mm_set1_ps(float(color->green));
+	const __m128 blue= _mm_set1_ps(float(color->blue));
+	const __m128i red_loss= _mm_cvtsi32_si128(8+fmt->Rloss), red_shift= _mm_cvtsi32_si128(fmt->Rshift);
+	const __m128i green_loss= _mm_cvtsi32_si128(8+fmt->Gloss), green_shift= _mm_cvtsi32_si128(fmt->Gshift);
+	const __m128i blue_loss= _mm_cvtsi32_si128(8+fmt->Bloss), blue_shift= _mm_cvtsi32_si128(fmt->Bshift);
+	const __m128i alpha= _mm_set1_epi32(int32(fmt->Amask));
+
+	short level;
+	for (level= 0; level+4<=number_of_shading_tables; level+= 4)
+	{
+		__m128 multiplier= self_luminescent ?
+			_mm_set_ps(float((number_of_shading_tables>>1)+((level+3)>>1)), float((number_of_shading_tables>>1)+((level+2)>>1)),
+				float((number_of_shading_tables>>1)+((level+1)>>1)), float((number_of_shading_tables>>1)+(level>>1))) :
+			_mm_set_ps(float(level+3), float(level+2), float(level+1), float(level));
+		__m128i r= _mm_cvttps_epi32(_mm_div_ps(_mm_mul_ps(red, multiplier), divisor));
+		__m128i g= _mm_cvttps_epi32(_mm_div_ps(_mm_mul_ps(green, multiplier), divisor));
+		__m128i b= _mm_cvttps_epi32(_mm_div_ps(_mm_mul_ps(blue, multiplier), divisor));
+
+		__m128i pixels;
+		if (!is_opengl)
+			// what SDL_MapRGB() does for formats without a palette
+			pixels= _mm_or_si128(_mm_or_si128(_mm_sll_epi32(_mm_srl_epi32(r, red_loss), red_shift),
+				_mm_sll_epi32(_mm_srl_epi32(g, green_loss), green_shift)),
+				_mm_or_si128(_mm_sll_epi32(_mm_srl_epi32(b, blue_loss), blue_shift), alpha));
+		else
+			// RGBCOLOR_TO_PIXEL32()
+			pixels= _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_slli_epi32(r, 8), _mm_set1_epi32(0x00FF0000)),
+				_mm_and_si128(g, _mm_set1_epi32(0x0000FF00))),
+				_mm_and_si128(_mm_srli_epi32(b, 8), _mm_set1_epi32(0x000000FF)));
+
+		uint32 values[4];
+		_mm_storeu_si128((__m128i *) values, pixels);
+		for (short j= 0; j<4; ++j)
+			shading_table[PIXEL8_MAXIMUM_COLORS*(level+j)]= values[j];
+	}
+
+	return level;
+}
+#endif
+
 static void build_shading_tables32(
 	struct rgb_color_value *colors,
 	short color_count,
@@ -1880,6 +2348,9 @@ static void build_shading_tables32(
 	objlist_set(shading_tables, 0, PIXEL8_MAXIMUM_COLORS);
 	
 	SDL_PixelFormat *fmt = &pixel_format_32;
+#ifdef SHADING_TABLES_SSE2
+	const bool use_sse2 = SDL_HasSSE2() && (is_opengl || !fmt->palette);
+#endif
 
 	start= 0, count= 0;
 	while (get_next_color_run(colors, color_count, &start, &count))
@@ -1887,7 +2358,15 @@ static void build_shading_tables32(
 		for (i= 0; i<count; ++i)
 		{
 			assert(number_of_shading_tables > 1);
-			for (level= 0; level<number_of_shading_tables; ++level)
+			level= 0;
+#ifdef SHADING_TABLES_SSE2
+			if (use_sse2)
+			{
+				struct rgb_color_value *color= colors + (remapping_table ? remapping_table[start+i] : (start+i));
+				level= build_shading_levels32_sse2(color, shading_tables+start+i, fmt, is_opengl);
+			}
+#endif
+			for (; level<number_of_shading_tables; ++level)
 			{
 				struct rgb_color_value *color= colors + (remapping_table ? remapping_table[start+i] : (start+i));
 				short multiplier= (color->flags&SELF_LUMINESCENT_COLOR_FLAG) ? ((number_of_shading_tables>>1)+(level>>1)) : level;
@@ -1943,6 +2422,7 @@ static void build_global_shading_table16(
 static void build_global_shading_table32(
 	void)
 {
+	// always every level: tinted transfer modes pick tables by 32nds of them
 	if (!global_shading_table32)
 	{
 		short value, shading_table;
@@ -1950,22 +2430,22 @@ static void build_global_shading_table32(
 		
 		SDL_PixelFormat *fmt = &pixel_format_32;
 
-		global_shading_table32= (pixel32 *) malloc(sizeof(pixel32)*number_of_shading_tables*NUMBER_OF_COLOR_COMPONENTS*(PIXEL32_MAXIMUM_COMPONENT+1));
+		global_shading_table32= (pixel32 *) malloc(sizeof(pixel32)*FULL_SHADING_TABLES32*NUMBER_OF_COLOR_COMPONENTS*(PIXEL32_MAXIMUM_COMPONENT+1));
 		assert(global_shading_table32);
 		
 		write= global_shading_table32;
-		for (shading_table= 0; shading_table<number_of_shading_tables; ++shading_table)
+		for (shading_table= 0; shading_table<FULL_SHADING_TABLES32; ++shading_table)
 		{
 			// Under SDL, the components may have different widths and different shifts
 			int shift = fmt->Rshift - fmt->Rloss;
 			for (value=0;value<=PIXEL32_MAXIMUM_COMPONENT;++value)
-				*write++ = ((value*(shading_table))/(number_of_shading_tables-1))<<shift;
+				*write++ = ((value*(shading_table))/(FULL_SHADING_TABLES32-1))<<shift;
 			shift = fmt->Gshift - fmt->Gloss;
 			for (value=0;value<=PIXEL32_MAXIMUM_COMPONENT;++value)
-				*write++ = ((value*(shading_table))/(number_of_shading_tables-1))<<shift;
+				*write++ = ((value*(shading_table))/(FULL_SHADING_TABLES32-1))<<shift;
 			shift = fmt->Bshift - fmt->Bloss;
 			for (value=0;value<=PIXEL32_MAXIMUM_COMPONENT;++value)
-				*write++ = ((value*(shading_table))/(number_of_shading_tables-1))<<shift;
+				*write++ = ((value*(shading_table))/(FULL_SHADING_TABLES32-1))<<shift;
 		}
 	}
 }
@@ -2282,6 +2762,8 @@ static struct rgb_color_value *get_collection_colors(
 	if (!definition) return NULL;
 	if (!(clut_number >= 0 && clut_number < definition->clut_count))
 		return NULL;
+	if (deferred_collections[collection_index].colors_deferred && !collections_loading)
+		materialize_collection(collection_index);
 	
 	return &definition->color_tables[clut_number * definition->color_count];
 }
@@ -2294,6 +2776,8 @@ struct rgb_color_value *get_collection_colors(
 	collection_definition *definition = get_collection_definition(collection_index);
 	if (!definition) return NULL;
 	if (!(clut_number >=0 && clut_number < definition->clut_count)) return NULL;
+	if (deferred_collections[collection_index].colors_deferred && !collections_loading)
+		materialize_collection(collection_index);
 	num_colors = definition->color_count;
 	return &definition->color_tables[clut_number * definition->color_count];
 }
@@ -2333,6 +2817,11 @@ static struct bitmap_definition *get_bitmap_definition(
 	if (!definition) return NULL;
 	if (!(bitmap_index >= 0 && bitmap_index < definition->bitmaps.size()))
 		return NULL;
+	if (collections_loading) {
+		if (deferred_collections[collection_index].bitmaps_deferred)
+			load_deferred_bitmaps(collection_index);
+	} else if (deferred_collections[collection_index].colors_deferred)
+		materialize_collection(collection_index);
 
 	return (bitmap_definition *) &definition->bitmaps[bitmap_index][0];
 }
@@ -2341,6 +2830,8 @@ static void *get_collection_shading_tables(
 	short collection_index,
 	short clut_index)
 {
+	if (deferred_collections[collection_index].colors_deferred && !collections_loading)
+		materialize_collection(collection_index);
 	void *shading_tables= get_collection_header(collection_index)->shading_tables;
 
 	shading_tables = (uint8 *)shading_tables + clut_index*get_shading_table_size(collection_index);
@@ -2354,6 +2845,8 @@ static void *get_collection_tint_tables(
 {
 	struct collection_definition *definition= get_collection_definition(collection_index);
 	if (!definition) return NULL;
+	if (deferred_collections[collection_index].colors_deferred && !collections_loading)
+		materialize_collection(collection_index);
 	
 	void *tint_table= get_collection_header(collection_index)->shading_tables;
 
@@ -2372,6 +2865,29 @@ bool is_collection_present(short collection_index)
 	return collection_loaded(CollHeader);
 }
 
+size_t get_collections_memory_usage()
+{
+	size_t bytes = 0;
+	for (short collection_index = 0; collection_index < MAXIMUM_COLLECTIONS; ++collection_index)
+	{
+		collection_header *header = get_collection_header(collection_index);
+		if (!collection_loaded(header)) continue;
+
+		collection_definition *definition = header->collection;
+		bytes += sizeof(collection_definition);
+		bytes += definition->color_tables.capacity() * sizeof(rgb_color_value);
+		for (size_t i = 0; i < definition->high_level_shapes.size(); ++i)
+			bytes += definition->high_level_shapes[i].capacity();
+		bytes += definition->low_level_shapes.capacity() * sizeof(low_level_shape_definition);
+		for (size_t i = 0; i < definition->bitmaps.size(); ++i)
+			bytes += definition->bitmaps[i].capacity();
+
+		if (header->shading_tables)
+			bytes += get_shading_table_size(collection_index) * definition->clut_count + shading_table_size * NUMBER_OF_TINT_TABLES;
+	}
+	return bytes;
+}
+
 // Number of texture frames in a collection (good for wall-texture error checking)
 short get_number_of_collection_frames(short collection_index)
 {
@@ -2435,7 +2951,7 @@ void parse_mml_infravision(const InfoTree& root)
 			OriginalCollectionTints[i] = CollectionTints[i];
 	}
 
-	BOOST_FOREACH(InfoTree color, root.children_named("color"))
+	BOOST_FOREACH(const InfoTree &color, root.children_named("color"))
 	{
 		int16 index;
 		if (!color.read_indexed("index", index, NUMBER_OF_TINT_COLORS))
@@ -2443,7 +2959,7 @@ void parse_mml_infravision(const InfoTree& root)
 		color.read_color(tint_colors16[index]);
 	}
 	
-	BOOST_FOREACH(InfoTree assign, root.children_named("assign"))
+	BOOST_FOREACH(const InfoTree &assign, root.children_named("assign"))
 	{
 		int16 coll, color;
 		if (!assign.read_indexed("coll", coll, NUMBER_OF_COLLECTIONS) ||
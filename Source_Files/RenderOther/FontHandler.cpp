@@ -45,6 +45,7 @@ Jan 12, 2001 (Loren Petrich):
 #include <math.h>
 #include <string.h>
 #include "FontHandler.h"
+#include "GlyphAtlas.h"
 
 #include "shape_descriptors.h"
 #include "screen_drawing.h"
@@ -186,6 +187,10 @@ void FontSpecifier::OGL_Reset(bool IsStarting)
     
     if (!IsStarting)
         return;
+
+	// TrueType fonts are drawn from their glyph atlases
+	if (Info && Info->get_glyph_atlas(Style))
+		return;
 	
 	// Put some padding around each glyph so as to avoid clipping it
 	const int Pad = 1;
@@ -339,6 +344,18 @@ void FontSpecifier::OGL_Reset(bool IsStarting)
 // One can surround it with glPushMatrix() and glPopMatrix() to remember the original.
 void FontSpecifier::OGL_Render(const char *Text)
 {
+	GlyphAtlas *Atlas = Info ? Info->get_glyph_atlas(Style) : NULL;
+	if (Atlas)
+	{
+		uint16 UText[256];
+		size_t Len = MIN(strlen(Text),255);
+		for (size_t k=0; k<Len; k++)
+			UText[k] = (Text[k] == '\t') ? ' ' : mac_roman_to_unicode(Text[k]);
+		UText[Len] = 0;
+		Atlas->OGL_Draw(UText);
+		return;
+	}
+
 	// Bug out if no texture to render
 	if (!OGL_Texture)
 	{
@@ -458,6 +475,9 @@ void FontSpecifier::OGL_DrawText(const char *text, const screen_rectangle &r, sh
 
 void FontSpecifier::OGL_ResetFonts(bool IsStarting)
 {
+	if (!IsStarting)
+		GlyphAtlas::StopTextures();
+
     if (!m_font_registry)
         return;
     
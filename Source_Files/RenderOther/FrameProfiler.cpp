@@ -0,0 +1,419 @@
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  Frame profiler
+
+ */
+
+#include "FrameProfiler.h"
+
+#include "Console.h"
+#include "FileHandler.h"
+#include "shell.h"
+
+#ifdef HAVE_OPENGL
+#include "OGL_Headers.h"
+#include "OGL_Setup.h"
+#endif
+
+#include <string.h>
+
+FrameProfiler *FrameProfiler::m_instance = NULL;
+
+static const char *section_names[FrameProfiler::NUMBER_OF_SECTIONS] = {
+	"frame",
+	"vis_tree",
+	"sort",
+	"objects",
+	"rasterize",
+	"glow",
+	"map",
+	"hud",
+	"lua_gc"
+};
+
+const char *FrameProfiler::SectionName(int section)
+{
+	return section_names[section];
+}
+
+#ifdef HAVE_OPENGL
+#ifndef GL_TIMESTAMP
+#define GL_TIMESTAMP 0x8E28
+#endif
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT 0x8866
+#endif
+
+typedef void (APIENTRY *GenQueriesProc)(GLsizei, GLuint *);
+typedef void (APIENTRY *DeleteQueriesProc)(GLsizei, const GLuint *);
+typedef void (APIENTRY *QueryCounterProc)(GLuint, GLenum);
+typedef void (APIENTRY *GetQueryObjectui64vProc)(GLuint, GLenum, uint64_t *);
+
+static GenQueriesProc genQueries = NULL;
+static DeleteQueriesProc deleteQueries = NULL;
+static QueryCounterProc queryCounter = NULL;
+static GetQueryObjectui64vProc getQueryObjectui64v = NULL;
+#endif
+
+FrameProfiler::FrameProfiler() :
+	overlay(false),
+	csv(NULL),
+	timing(false),
+	frame_count(0),
+	current(NULL),
+	gpu_checked(false),
+	gpu_timing(false)
+{
+	Reset();
+	ClearTotals();
+}
+
+void FrameProfiler::ClearTotals()
+{
+	memset(&totals, 0, sizeof(totals));
+}
+
+void FrameProfiler::Reset()
+{
+	for (int i = 0; i < FRAME_LATENCY; i++)
+	{
+		records[i].in_use = false;
+		memset(records[i].gpu_issued, 0, sizeof(records[i].gpu_issued));
+	}
+	current = NULL;
+	for (int s = 0; s < NUMBER_OF_SECTIONS; s++)
+	{
+		running[s] = gpu_running[s] = false;
+		cpu_average[s] = gpu_average[s] = -1;
+		pending[s] = -1;
+	}
+	input_sampled = 0;
+	input_late_pending = -1;
+	input_age_average = input_late_average = -1;
+}
+
+bool FrameProfiler::GPUTimingAvailable()
+{
+#ifdef HAVE_OPENGL
+	if (!OGL_IsActive()) return false;
+
+	if (!gpu_checked)
+	{
+		gpu_checked = true;
+		gpu_timing = false;
+		if (OGL_CheckExtension("GL_ARB_timer_query"))
+		{
+			genQueries = reinterpret_cast<GenQueriesProc>(SDL_GL_GetProcAddress("glGenQueriesARB"));
+			deleteQueries = reinterpret_cast<DeleteQueriesProc>(SDL_GL_GetProcAddress("glDeleteQueriesARB"));
+			queryCounter = reinterpret_cast<QueryCounterProc>(SDL_GL_GetProcAddress("glQueryCounter"));
+			getQueryObjectui64v = reinterpret_cast<GetQueryObjectui64vProc>(SDL_GL_GetProcAddress("glGetQueryObjectui64v"));
+			if (genQueries && deleteQueries && queryCounter && getQueryObjectui64v)
+			{
+				for (int i = 0; i < FRAME_LATENCY; i++)
+					genQueries(2 * NUMBER_OF_SECTIONS, records[i].queries);
+				gpu_timing = true;
+			}
+		}
+	}
+	return gpu_timing;
+#else
+	return false;
+#endif
+}
+
+void FrameProfiler::ResetGPU()
+{
+#ifdef HAVE_OPENGL
+	if (gpu_timing)
+	{
+		for (int i = 0; i < FRAME_LATENCY; i++)
+			deleteQueries(2 * NUMBER_OF_SECTIONS, records[i].queries);
+	}
+#endif
+	gpu_checked = false;
+	gpu_timing = false;
+	for (int i = 0; i < FRAME_LATENCY; i++)
+		memset(records[i].gpu_issued, 0, sizeof(records[i].gpu_issued));
+	memset(gpu_running, 0, sizeof(gpu_running));
+}
+
+void FrameProfiler::BeginFrame()
+{
+	if (!IsActive()) return;
+
+	FrameRecord& record = records[frame_count % FRAME_LATENCY];
+	if (record.in_use)
+		Resolve(record);
+
+	record.frame = frame_count++;
+	record.in_use = true;
+	for (int s = 0; s < NUMBER_OF_SECTIONS; s++)
+	{
+		record.cpu[s] = pending[s];
+		record.gpu_issued[s] = false;
+		pending[s] = -1;
+	}
+	record.draw_calls = record.texture_binds = record.streamed_vertices = 0;
+	record.input_age = -1;
+	record.input_late = input_late_pending;
+	input_late_pending = -1;
+	current = &record;
+
+	Begin(FRAME);
+}
+
+void FrameProfiler::EndFrame()
+{
+	if (!current) return;
+
+	End(FRAME);
+	if (input_sampled)
+		current->input_age = (SDL_GetPerformanceCounter() - input_sampled) * 1000.0 / SDL_GetPerformanceFrequency();
+	current = NULL;
+}
+
+void FrameProfiler::Begin(Section section)
+{
+	if (!current) return;
+
+	running[section] = true;
+	if (!current->gpu_issued[section] && GPUTimingAvailable())
+	{
+#ifdef HAVE_OPENGL
+		queryCounter(current->queries[2 * section], GL_TIMESTAMP);
+#endif
+		gpu_running[section] = true;
+	}
+	started[section] = SDL_GetPerformanceCounter();
+}
+
+void FrameProfiler::End(Section section)
+{
+	if (!current || !running[section]) return;
+
+	double elapsed = (SDL_GetPerformanceCounter() - started[section]) * 1000.0 / SDL_GetPerformanceFrequency();
+	current->cpu[section] = MAX(current->cpu[section], 0) + elapsed;
+	running[section] = false;
+
+	if (gpu_running[section])
+	{
+#ifdef HAVE_OPENGL
+		queryCounter(current->queries[2 * section + 1], GL_TIMESTAMP);
+#endif
+		current->gpu_issued[section] = true;
+		gpu_running[section] = false;
+	}
+}
+
+void FrameProfiler::Add(Section section, double milliseconds)
+{
+	if (!IsActive()) return;
+
+	pending[section] = MAX(pending[section], 0) + milliseconds;
+}
+
+void FrameProfiler::InputSampled(double late_milliseconds)
+{
+	if (!IsActive()) return;
+
+	input_sampled = SDL_GetPerformanceCounter();
+	input_late_pending = MAX(input_late_pending, late_milliseconds);
+}
+
+// Averages a new measurement into the overlay's values;
+// a section not measured in this frame drops out of the overlay
+static void smooth(double& average, double value)
+{
+	const double weight = 0.1;
+	if (value < 0)
+		average = -1;
+	else if (average < 0)
+		average = value;
+	else
+		average += weight * (value - average);
+}
+
+void FrameProfiler::Resolve(FrameRecord& record)
+{
+	double gpu[NUMBER_OF_SECTIONS];
+	for (int s = 0; s < NUMBER_OF_SECTIONS; s++)
+	{
+		gpu[s] = -1;
+#ifdef HAVE_OPENGL
+		if (record.gpu_issued[s] && gpu_timing)
+		{
+			uint64_t t0 = 0, t1 = 0;
+			getQueryObjectui64v(record.queries[2 * s], GL_QUERY_RESULT, &t0);
+			getQueryObjectui64v(record.queries[2 * s + 1], GL_QUERY_RESULT, &t1);
+			gpu[s] = (t1 - t0) / 1.0e6;
+		}
+#endif
+		smooth(cpu_average[s], record.cpu[s]);
+		smooth(gpu_average[s], gpu[s]);
+
+		if (record.cpu[s] >= 0)
+		{
+			totals.cpu[s] += record.cpu[s];
+			totals.cpu_frames[s]++;
+		}
+		if (gpu[s] >= 0)
+		{
+			totals.gpu[s] += gpu[s];
+			totals.gpu_frames[s]++;
+		}
+	}
+	smooth(input_age_average, record.input_age);
+	// Frames drawn between ticks read no input
+	if (record.input_late >= 0)
+		smooth(input_late_average, record.input_late);
+	totals.frames++;
+	totals.draw_calls += record.draw_calls;
+	totals.texture_binds += record.texture_binds;
+	totals.streamed_vertices += record.streamed_vertices;
+
+	if (csv)
+	{
+		fprintf(csv, "%u", record.frame);
+		for (int s = 0; s < NUMBER_OF_SECTIONS; s++)
+		{
+			if (record.cpu[s] >= 0)
+				fprintf(csv, ",%.3f", record.cpu[s]);
+			else
+				fprintf(csv, ",");
+		}
+		for (int s = 0; s < NUMBER_OF_SECTIONS; s++)
+		{
+			if (gpu[s] >= 0)
+				fprintf(csv, ",%.3f", gpu[s]);
+			else
+				fprintf(csv, ",");
+		}
+		fprintf(csv, ",%u,%u,%u", record.draw_calls, record.texture_binds, record.streamed_vertices);
+		if (record.input_age >= 0)
+			fprintf(csv, ",%.3f", record.input_age);
+		else
+			fprintf(csv, ",");
+		if (record.input_late >= 0)
+			fprintf(csv, ",%.3f\n", record.input_late);
+		else
+			fprintf(csv, ",\n");
+	}
+
+	record.in_use = false;
+}
+
+void FrameProfiler::ShowOverlay(bool show)
+{
+	overlay = show;
+	if (!IsActive())
+		Reset();
+}
+
+void FrameProfiler::KeepTiming(bool keep)
+{
+	if (keep == timing) return;
+
+	timing = keep;
+	if (!IsActive())
+		Reset();
+}
+
+bool FrameProfiler::StartCSV(const std::string& path)
+{
+	StopCSV();
+
+	csv = fopen(path.c_str(), "w");
+	if (!csv)
+		return false;
+
+	// Records being timed belong to no file yet
+	Reset();
+
+	fprintf(csv, "frame");
+	for (int s = 0; s < NUMBER_OF_SECTIONS; s++)
+		fprintf(csv, ",cpu_%s", section_names[s]);
+	for (int s = 0; s < NUMBER_OF_SECTIONS; s++)
+		fprintf(csv, ",gpu_%s", section_names[s]);
+	fprintf(csv, ",draw_calls,texture_binds,streamed_vertices,input_age,input_late\n");
+	return true;
+}
+
+void FrameProfiler::StopCSV()
+{
+	if (!csv) return;
+
+	// Write out what is still waiting for the GPU, oldest first
+	for (uint32 f = frame_count - MIN(frame_count, uint32(FRAME_LATENCY)); f < frame_count; f++)
+	{
+		FrameRecord& record = records[f % FRAME_LATENCY];
+		if (record.in_use && &record != current)
+			Resolve(record);
+	}
+
+	fclose(csv);
+	csv = NULL;
+	if (!IsActive())
+		Reset();
+}
+
+struct profile_overlay
+{
+	void operator() (const std::string& arg) const {
+		FrameProfiler *profiler = FrameProfiler::instance();
+		if (arg == "on")
+			profiler->ShowOverlay(true);
+		else if (arg == "off")
+			profiler->ShowOverlay(false);
+		else
+			profiler->ShowOverlay(!profiler->IsOverlayShown());
+	}
+};
+
+struct profile_csv
+{
+	void operator() (const std::string& arg) const {
+		FrameProfiler *profiler = FrameProfiler::instance();
+		if (arg == "")
+		{
+			profiler->StopCSV();
+			screen_printf("Frame profile closed");
+			return;
+		}
+
+		std::string filename = arg;
+		if (filename.find('.') == std::string::npos)
+			filename += ".csv";
+
+		FileSpecifier fs;
+		fs.SetToLocalDataDir();
+		fs += filename;
+		if (profiler->StartCSV(fs.GetPath()))
+			screen_printf("Writing frame profile to %s", utf8_to_mac_roman(fs.GetPath()).c_str());
+		else
+			screen_printf("Could not open %s", utf8_to_mac_roman(fs.GetPath()).c_str());
+	}
+};
+
+void FrameProfiler::RegisterCommands()
+{
+	CommandParser profileParser;
+	profileParser.register_command("overlay", profile_overlay());
+	profileParser.register_command("csv", profile_csv());
+	Console::instance()->register_command("profile", profileParser);
+}
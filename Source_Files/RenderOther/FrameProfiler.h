@@ -0,0 +1,161 @@
+#ifndef __FRAMEPROFILER_H
+#define __FRAMEPROFILER_H
+
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  Frame profiler: times each pass of a frame on the CPU and, where
+  GL_ARB_timer_query is available, on the GPU, and counts its draw calls
+  and texture bindings, and how old the input it shows is; shown as an
+  on-screen overlay, and written to a CSV file one frame per row
+
+ */
+
+#include "cseries.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+class FrameProfiler
+{
+public:
+	static FrameProfiler *instance() { if (!m_instance) m_instance = new FrameProfiler(); return m_instance; }
+
+	enum Section {
+		FRAME,
+		VIS_TREE,
+		SORT,
+		OBJECTS,
+		RASTERIZE,
+		GLOW,
+		MAP,
+		HUD,
+		LUA_GC,
+		NUMBER_OF_SECTIONS
+	};
+	static const char *SectionName(int section);
+
+	// "profile overlay on|off", "profile csv <file>" and "profile csv"
+	void RegisterCommands();
+
+	bool IsActive() const { return overlay || csv || timing; }
+	bool IsOverlayShown() const { return overlay; }
+	void ShowOverlay(bool show);
+
+	// Times frames even with neither the overlay nor a CSV file, for what
+	// reads the times back (dynamic resolution, say)
+	void KeepTiming(bool keep);
+	bool StartCSV(const std::string& path);
+	void StopCSV();
+
+	// Sections may nest; one that runs more than once in a frame
+	// adds up on the CPU, but only its first run is timed on the GPU
+	void BeginFrame();
+	void EndFrame();
+	void Begin(Section section);
+	void End(Section section);
+
+	// Time spent between frames (in the game tick, say), counted in the next frame
+	void Add(Section section, double milliseconds);
+
+	// Call while the OpenGL context that the queries belong to still exists
+	void ResetGPU();
+
+	// The heartbeat read the local player's input, this many milliseconds
+	// after it was due; each frame then reports how late the ticks it
+	// follows were read, and how old the last input read is once it's drawn
+	void InputSampled(double late_milliseconds);
+
+	// Counted against the frame being timed; calls that draw the world
+	// (or primitives handed to the software rasterizer), textures
+	// actually bound, and vertices copied to the streaming vertex buffer
+	static void CountDrawCall() { if (m_instance && m_instance->current) m_instance->current->draw_calls++; }
+	static void CountTextureBind() { if (m_instance && m_instance->current) m_instance->current->texture_binds++; }
+	static void CountStreamedVertices(uint32 count) { if (m_instance && m_instance->current) m_instance->current->streamed_vertices += count; }
+
+	// What every frame resolved since the last ClearTotals() adds up to
+	struct Totals {
+		uint32 frames;
+		double cpu[NUMBER_OF_SECTIONS];
+		double gpu[NUMBER_OF_SECTIONS];
+		uint32 cpu_frames[NUMBER_OF_SECTIONS];
+		uint32 gpu_frames[NUMBER_OF_SECTIONS];
+		uint64_t draw_calls;
+		uint64_t texture_binds;
+		uint64_t streamed_vertices;
+	};
+	const Totals& GetTotals() const { return totals; }
+	void ClearTotals();
+
+	// Smoothed milliseconds; negative if the section is not being measured
+	double CPUTime(int section) const { return cpu_average[section]; }
+	double GPUTime(int section) const { return gpu_average[section]; }
+	double InputAge() const { return input_age_average; }
+	double InputLateness() const { return input_late_average; }
+
+private:
+	static FrameProfiler *m_instance;
+
+	// GPU results are read this many frames late so that reading them
+	// doesn't stall the pipeline
+	enum { FRAME_LATENCY = 4 };
+
+	struct FrameRecord {
+		uint32 frame;
+		bool in_use;
+		double cpu[NUMBER_OF_SECTIONS];
+		bool gpu_issued[NUMBER_OF_SECTIONS];
+		uint32 queries[2 * NUMBER_OF_SECTIONS];
+		uint32 draw_calls;
+		uint32 texture_binds;
+		uint32 streamed_vertices;
+		double input_age;
+		double input_late;
+	};
+
+	bool overlay;
+	FILE *csv;
+	bool timing;
+
+	uint32 frame_count;
+	FrameRecord records[FRAME_LATENCY];
+	FrameRecord *current;
+	uint64_t started[NUMBER_OF_SECTIONS];
+	bool running[NUMBER_OF_SECTIONS];
+	bool gpu_running[NUMBER_OF_SECTIONS];
+	double pending[NUMBER_OF_SECTIONS];
+	uint64_t input_sampled;
+	double input_late_pending;
+
+	bool gpu_checked;
+	bool gpu_timing;
+
+	double cpu_average[NUMBER_OF_SECTIONS];
+	double gpu_average[NUMBER_OF_SECTIONS];
+	double input_age_average;
+	double input_late_average;
+
+	Totals totals;
+
+	FrameProfiler();
+	bool GPUTimingAvailable();
+	void Resolve(FrameRecord& record);
+	void Reset();
+};
+
+#endif
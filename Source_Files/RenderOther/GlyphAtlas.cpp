@@ -0,0 +1,394 @@
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  Glyph atlas
+
+ */
+
+#include "GlyphAtlas.h"
+
+#ifdef HAVE_OPENGL
+#include "OGL_StreamBuffer.h"
+#endif
+
+#include <string.h>
+
+// SDL_ttf got kerning by glyph in 2.0.14
+#if defined(SDL_TTF_MAJOR_VERSION) && (SDL_TTF_MAJOR_VERSION > 2 || (SDL_TTF_MAJOR_VERSION == 2 && (SDL_TTF_MINOR_VERSION > 0 || SDL_TTF_PATCHLEVEL >= 14)))
+#define GLYPH_ATLAS_KERNING
+#endif
+
+// Left empty around each glyph, so that filtering does not take in its neighbors
+static const int Pad = 1;
+
+std::map<GlyphAtlas::key_t, GlyphAtlas *> GlyphAtlas::m_atlases;
+
+GlyphAtlas *GlyphAtlas::instance(TTF_Font *font, bool smooth)
+{
+	if (!font)
+		return NULL;
+
+	key_t key(font, smooth);
+	std::map<key_t, GlyphAtlas *>::iterator it = m_atlases.find(key);
+	if (it != m_atlases.end())
+		return it->second;
+
+	GlyphAtlas *atlas = new GlyphAtlas(font, smooth);
+	m_atlases[key] = atlas;
+	return atlas;
+}
+
+void GlyphAtlas::Forget(TTF_Font *font)
+{
+	for (int smooth = 0; smooth < 2; ++smooth)
+	{
+		std::map<key_t, GlyphAtlas *>::iterator it = m_atlases.find(key_t(font, smooth != 0));
+		if (it != m_atlases.end())
+		{
+			delete it->second;
+			m_atlases.erase(it);
+		}
+	}
+}
+
+GlyphAtlas::GlyphAtlas(TTF_Font *font, bool smooth) :
+	m_font(font),
+	m_smooth(smooth),
+	m_ascent(TTF_FontAscent(font)),
+	m_kerned(false),
+	m_shelf_x(0),
+	m_shelf_y(0),
+	m_shelf_height(0)
+{
+	memset(m_latin1, 0, sizeof(m_latin1));
+	m_page_size = MAX(512, NextPowerOfTwo(TTF_FontHeight(font) + 2 * Pad));
+
+#ifdef GLYPH_ATLAS_KERNING
+	m_kerned = TTF_GetFontKerning(font) != 0;
+#endif
+}
+
+GlyphAtlas::~GlyphAtlas()
+{
+#ifdef HAVE_OPENGL
+	UnloadTextures();
+#endif
+	for (size_t i = 0; i < m_pages.size(); ++i)
+		SDL_FreeSurface(m_pages[i]);
+}
+
+GlyphAtlas::Glyph& GlyphAtlas::Find(uint16 c)
+{
+	if (c < 256)
+		return m_latin1[c];
+
+	std::map<uint16, Glyph>::iterator it = m_others.find(c);
+	if (it != m_others.end())
+		return it->second;
+
+	Glyph& glyph = m_others[c];
+	memset(&glyph, 0, sizeof(glyph));
+	return glyph;
+}
+
+GlyphAtlas::Glyph& GlyphAtlas::Measured(uint16 c)
+{
+	Glyph& glyph = Find(c);
+	if (!glyph.measured)
+	{
+		int minx = 0, advance = 0;
+		if (TTF_GlyphMetrics(m_font, c, &minx, 0, 0, 0, &advance) != 0)
+			minx = advance = 0;
+
+		glyph.measured = true;
+		glyph.advance = advance;
+		// Text rendering starts at the first glyph's overhang, if any
+		glyph.offset = MIN(minx, 0);
+		glyph.page = NONE;
+	}
+	return glyph;
+}
+
+GlyphAtlas::Glyph& GlyphAtlas::Rendered(uint16 c)
+{
+	Glyph& glyph = Measured(c);
+	if (glyph.rendered)
+		return glyph;
+	glyph.rendered = true;
+
+	uint16 text[2] = { c, 0 };
+	SDL_Color white = { 0xff, 0xff, 0xff, 0xff };
+	SDL_Surface *rendering = m_smooth ?
+		TTF_RenderUNICODE_Blended(m_font, text, white) :
+		TTF_RenderUNICODE_Solid(m_font, text, white);
+	if (!rendering)
+		return glyph;
+	if (rendering->w <= 0 || rendering->h <= 0 ||
+	    rendering->w + 2 * Pad > m_page_size || rendering->h + 2 * Pad > m_page_size)
+	{
+		SDL_FreeSurface(rendering);
+		return glyph;
+	}
+
+	// Find a place on the current shelf, on a new one, or on a new page
+	int w = rendering->w + 2 * Pad, h = rendering->h + 2 * Pad;
+	if (m_shelf_x + w > m_page_size)
+	{
+		m_shelf_x = 0;
+		m_shelf_y += m_shelf_height;
+		m_shelf_height = 0;
+	}
+	if (m_pages.empty() || m_shelf_y + h > m_page_size)
+	{
+		SDL_Surface *page = SDL_CreateRGBSurface(SDL_SWSURFACE, m_page_size, m_page_size, 32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000);
+		if (!page)
+		{
+			SDL_FreeSurface(rendering);
+			return glyph;
+		}
+		SDL_FillRect(page, NULL, SDL_MapRGBA(page->format, 0xff, 0xff, 0xff, 0));
+		SDL_SetSurfaceBlendMode(page, SDL_BLENDMODE_BLEND);
+		m_pages.push_back(page);
+#ifdef HAVE_OPENGL
+		m_textures.push_back(0);
+		m_stale.push_back(true);
+#endif
+		m_shelf_x = m_shelf_y = m_shelf_height = 0;
+	}
+
+	int page_index = m_pages.size() - 1;
+	SDL_Surface *page = m_pages[page_index];
+
+	// Copied in as white, with the coverage in alpha, so that it can take
+	// any color when drawn; solid renderings are palettized, with 0 as the
+	// background
+	SDL_LockSurface(rendering);
+	SDL_LockSurface(page);
+	for (int row = 0; row < rendering->h; ++row)
+	{
+		uint8 *src = static_cast<uint8 *>(rendering->pixels) + row * rendering->pitch;
+		uint32 *dst = reinterpret_cast<uint32 *>(static_cast<uint8 *>(page->pixels) + (m_shelf_y + Pad + row) * page->pitch) + m_shelf_x + Pad;
+		for (int col = 0; col < rendering->w; ++col)
+		{
+			uint8 alpha;
+			if (rendering->format->BytesPerPixel == 1)
+				alpha = src[col] ? 0xff : 0;
+			else
+				alpha = reinterpret_cast<uint32 *>(src)[col] >> 24;
+			dst[col] = (static_cast<uint32>(alpha) << 24) | 0x00ffffff;
+		}
+	}
+	SDL_UnlockSurface(page);
+	SDL_UnlockSurface(rendering);
+
+	glyph.page = page_index;
+	glyph.x = m_shelf_x + Pad;
+	glyph.y = m_shelf_y + Pad;
+	glyph.w = rendering->w;
+	glyph.h = rendering->h;
+	SDL_FreeSurface(rendering);
+
+	m_shelf_x += w;
+	m_shelf_height = MAX(m_shelf_height, h);
+#ifdef HAVE_OPENGL
+	m_stale[page_index] = true;
+#endif
+
+	return glyph;
+}
+
+int16 GlyphAtlas::Advance(uint16 c)
+{
+	return Measured(c).advance;
+}
+
+int16 GlyphAtlas::Kerning(uint16 previous, uint16 c)
+{
+	if (!m_kerned || !previous)
+		return 0;
+
+	uint32 pair = (static_cast<uint32>(previous) << 16) | c;
+	std::map<uint32, int16>::iterator it = m_kerning.find(pair);
+	if (it != m_kerning.end())
+		return it->second;
+
+	int16 kerning = 0;
+#ifdef GLYPH_ATLAS_KERNING
+	kerning = TTF_GetFontKerningSizeGlyphs(m_font, previous, c);
+#endif
+	m_kerning[pair] = kerning;
+	return kerning;
+}
+
+int GlyphAtlas::TextWidth(const uint16 *text)
+{
+	int width = 0;
+	uint16 previous = 0;
+	for (; *text; previous = *text++)
+		width += Kerning(previous, *text) + Advance(*text);
+	return width;
+}
+
+int GlyphAtlas::Draw(SDL_Surface *s, const uint16 *text, int x, int y, SDL_Color color)
+{
+	int pen = 0;
+	uint16 previous = 0;
+	for (; *text; previous = *text++)
+	{
+		pen += Kerning(previous, *text);
+		Glyph& glyph = Rendered(*text);
+		if (glyph.page != NONE)
+		{
+			SDL_Surface *page = m_pages[glyph.page];
+			SDL_SetSurfaceColorMod(page, color.r, color.g, color.b);
+
+			SDL_Rect src_rect = { glyph.x, glyph.y, glyph.w, glyph.h };
+			SDL_Rect dst_rect = { x + pen + glyph.offset, y - m_ascent, glyph.w, glyph.h };
+			SDL_BlitSurface(page, &src_rect, s, &dst_rect);
+		}
+		pen += glyph.advance;
+	}
+	return pen;
+}
+
+#ifdef HAVE_OPENGL
+
+void GlyphAtlas::StopTextures()
+{
+	for (std::map<key_t, GlyphAtlas *>::iterator it = m_atlases.begin(); it != m_atlases.end(); ++it)
+		it->second->UnloadTextures();
+}
+
+void GlyphAtlas::UnloadTextures()
+{
+	for (size_t i = 0; i < m_textures.size(); ++i)
+	{
+		if (m_textures[i])
+			glDeleteTextures(1, &m_textures[i]);
+		m_textures[i] = 0;
+		m_stale[i] = true;
+	}
+}
+
+void GlyphAtlas::Upload(int page_index)
+{
+	SDL_Surface *page = m_pages[page_index];
+
+	// LA 88, as for the bitmap fonts: white, with the coverage in alpha
+	std::vector<uint8> pixels(2 * m_page_size * m_page_size);
+	SDL_LockSurface(page);
+	for (int row = 0; row < m_page_size; ++row)
+	{
+		uint32 *src = reinterpret_cast<uint32 *>(static_cast<uint8 *>(page->pixels) + row * page->pitch);
+		uint8 *dst = &pixels[2 * row * m_page_size];
+		for (int col = 0; col < m_page_size; ++col)
+		{
+			*dst++ = 0xff;
+			*dst++ = src[col] >> 24;
+		}
+	}
+	SDL_UnlockSurface(page);
+
+	if (!m_textures[page_index])
+	{
+		glGenTextures(1, &m_textures[page_index]);
+		glBindTexture(GL_TEXTURE_2D, m_textures[page_index]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	else
+		glBindTexture(GL_TEXTURE_2D, m_textures[page_index]);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE_ALPHA, m_page_size, m_page_size,
+		0, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, &pixels[0]);
+	m_stale[page_index] = false;
+}
+
+int GlyphAtlas::OGL_Draw(const uint16 *text)
+{
+	// Two triangles a glyph, gathered by page
+	std::vector<std::vector<GLfloat> > vertices(m_pages.size()), texcoords(m_pages.size());
+
+	int pen = 0;
+	uint16 previous = 0;
+	for (; *text; previous = *text++)
+	{
+		pen += Kerning(previous, *text);
+		Glyph& glyph = Rendered(*text);
+		if (glyph.page != NONE)
+		{
+			if (vertices.size() < m_pages.size())
+			{
+				vertices.resize(m_pages.size());
+				texcoords.resize(m_pages.size());
+			}
+
+			GLfloat left = pen + glyph.offset, top = -m_ascent;
+			GLfloat right = left + glyph.w, bottom = top + glyph.h;
+			GLfloat scale = GLfloat(1) / m_page_size;
+			GLfloat tleft = scale * glyph.x, ttop = scale * glyph.y;
+			GLfloat tright = scale * (glyph.x + glyph.w), tbottom = scale * (glyph.y + glyph.h);
+
+			GLfloat quad[12] = { left, top, right, top, right, bottom, left, top, right, bottom, left, bottom };
+			GLfloat quad_texcoords[12] = { tleft, ttop, tright, ttop, tright, tbottom, tleft, ttop, tright, tbottom, tleft, tbottom };
+			vertices[glyph.page].insert(vertices[glyph.page].end(), quad, quad + 12);
+			texcoords[glyph.page].insert(texcoords[glyph.page].end(), quad_texcoords, quad_texcoords + 12);
+		}
+		pen += glyph.advance;
+	}
+
+	glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT);
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+
+	glEnable(GL_TEXTURE_2D);
+	glEnable(GL_BLEND);
+	glDisable(GL_ALPHA_TEST);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		if (vertices[i].empty())
+			continue;
+
+		if (m_stale[i])
+			Upload(i);
+		else
+			glBindTexture(GL_TEXTURE_2D, m_textures[i]);
+
+		size_t bytes = vertices[i].size() * sizeof(GLfloat);
+		OGL_StreamReserve(2 * bytes, 2);
+		glVertexPointer(2, GL_FLOAT, 0, OGL_StreamArray(&vertices[i][0], bytes));
+		glTexCoordPointer(2, GL_FLOAT, 0, OGL_StreamArray(&texcoords[i][0], bytes));
+		glDrawArrays(GL_TRIANGLES, 0, vertices[i].size() / 2);
+		OGL_StreamDone(vertices[i].size() / 2);
+	}
+
+	glPopClientAttrib();
+	glPopAttrib();
+
+	// Like the bitmap fonts' display lists, leave the pen moved along
+	glTranslatef(pen, 0, 0);
+	return pen;
+}
+
+#endif
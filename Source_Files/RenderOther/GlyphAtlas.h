@@ -0,0 +1,112 @@
+#ifndef __GLYPHATLAS_H
+#define __GLYPHATLAS_H
+
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  Glyph atlas: each TrueType face (file, size and style) rendered a glyph
+  at a time into shared pages as it is first drawn, with its advances and
+  kerning kept; text is then blitted, as SDL surfaces or OpenGL textured
+  quads, from the pages
+
+ */
+
+#include "cseries.h"
+#include <SDL_ttf.h>
+
+#ifdef HAVE_OPENGL
+#include "OGL_Headers.h"
+#endif
+
+#include <map>
+#include <vector>
+
+class GlyphAtlas
+{
+public:
+	// One for each opened font, drawn smoothed or not
+	static GlyphAtlas *instance(TTF_Font *font, bool smooth);
+
+	// Call before the font is closed
+	static void Forget(TTF_Font *font);
+
+#ifdef HAVE_OPENGL
+	// Call while the OpenGL context is still there; the pages are
+	// uploaded again when next drawn
+	static void StopTextures();
+#endif
+
+	// Strings are UCS-2, up to a terminating 0
+
+	int16 Advance(uint16 c);
+	int16 Kerning(uint16 previous, uint16 c);
+	int TextWidth(const uint16 *text);
+
+	// At the baseline's left end; returns the width drawn
+	int Draw(SDL_Surface *s, const uint16 *text, int x, int y, SDL_Color color);
+
+#ifdef HAVE_OPENGL
+	// At the modelview origin, as the baseline's left end, in the current
+	// color; returns the width drawn
+	int OGL_Draw(const uint16 *text);
+#endif
+
+	~GlyphAtlas();
+
+private:
+	typedef std::pair<TTF_Font *, bool> key_t;
+	static std::map<key_t, GlyphAtlas *> m_atlases;
+
+	struct Glyph {
+		bool measured;
+		bool rendered;
+		int16 advance;
+		int16 offset; // of the rendering from the pen, for overhangs
+		int16 page; // NONE if there is nothing to draw
+		int16 x, y, w, h;
+	};
+
+	TTF_Font *m_font;
+	bool m_smooth;
+	int m_ascent;
+
+	// Latin-1 by code; the rest as they come up
+	Glyph m_latin1[256];
+	std::map<uint16, Glyph> m_others;
+	std::map<uint32, int16> m_kerning;
+	bool m_kerned;
+
+	int m_page_size;
+	std::vector<SDL_Surface *> m_pages;
+	int m_shelf_x, m_shelf_y, m_shelf_height;
+
+#ifdef HAVE_OPENGL
+	std::vector<GLuint> m_textures;
+	std::vector<bool> m_stale;
+	void Upload(int page);
+	void UnloadTextures();
+#endif
+
+	GlyphAtlas(TTF_Font *font, bool smooth);
+
+	Glyph& Find(uint16 c);
+	Glyph& Measured(uint16 c);
+	Glyph& Rendered(uint16 c);
+};
+
+#endif
@@ -34,6 +34,7 @@ HUD_RENDERER_LUA.CPP
 #ifdef HAVE_OPENGL
 #include "OGL_Headers.h"
 #include "OGL_Render.h"
+#include "OGL_StreamBuffer.h"
 #endif
 
 #include <math.h>
@@ -157,6 +158,7 @@ void HUD_Lua_Class::start_draw(void)
 
 void HUD_Lua_Class::end_draw(void)
 {
+	flush_rects();
 	m_drawing = false;
 	
 #ifdef HAVE_OPENGL
@@ -204,6 +206,7 @@ void HUD_Lua_Class::set_masking_mode(short masking_mode)
 		masking_mode >= NUMBER_OF_LUA_MASKING_MODES)
 		return;
 	
+	flush_rects();
 	if (m_masking_mode == _mask_drawing)
 		end_drawing_mask();
 	else if (m_masking_mode == _mask_erasing)
@@ -225,6 +228,7 @@ void HUD_Lua_Class::clear_mask(void)
 	if (!m_drawing)
 		return;
 	
+	flush_rects();
 #ifdef HAVE_OPENGL
 	if (m_opengl)
 	{
@@ -285,6 +289,58 @@ void HUD_Lua_Class::end_drawing_mask(void)
 #endif
 }
 
+void HUD_Lua_Class::queue_rect(float x, float y, float w, float h,
+                                float r, float g, float b, float a)
+{
+	const float vertices[12] = {
+		x,     y,
+		x + w, y,
+		x + w, y + h,
+		x,     y,
+		x + w, y + h,
+		x,     y + h
+	};
+	m_rect_vertices.insert(m_rect_vertices.end(), vertices, vertices + 12);
+	for (int i = 0; i < 6; ++i)
+	{
+		m_rect_colors.push_back(r);
+		m_rect_colors.push_back(g);
+		m_rect_colors.push_back(b);
+		m_rect_colors.push_back(a);
+	}
+}
+
+void HUD_Lua_Class::flush_rects(void)
+{
+	if (m_rect_vertices.empty())
+		return;
+	
+#ifdef HAVE_OPENGL
+	glDisable(GL_TEXTURE_2D);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	
+	size_t vertex_bytes = m_rect_vertices.size() * sizeof(float);
+	size_t color_bytes = m_rect_colors.size() * sizeof(float);
+	OGL_StreamReserve(vertex_bytes + color_bytes, 2);
+	glVertexPointer(2, GL_FLOAT, 0, OGL_StreamArray(&m_rect_vertices[0], vertex_bytes));
+	glColorPointer(4, GL_FLOAT, 0, OGL_StreamArray(&m_rect_colors[0], color_bytes));
+	glDrawArrays(GL_TRIANGLES, 0, m_rect_vertices.size() / 2);
+	OGL_StreamDone(m_rect_vertices.size() / 2);
+	
+	glDisableClientState(GL_COLOR_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnable(GL_TEXTURE_2D);
+	
+	// what drawing each one by itself left as the current color
+	const float *color = &m_rect_colors[m_rect_colors.size() - 4];
+	glColor4f(color[0], color[1], color[2], color[3]);
+#endif
+	
+	m_rect_vertices.clear();
+	m_rect_colors.clear();
+}
+
 void HUD_Lua_Class::fill_rect(float x, float y, float w, float h,
 															float r, float g, float b, float a)
 {
@@ -298,8 +354,7 @@ void HUD_Lua_Class::fill_rect(float x, float y, float w, float h,
 #ifdef HAVE_OPENGL
 	if (m_opengl)
 	{
-		glColor4f(r, g, b, a);
-		OGL_RenderRect(x, y, w, h);
+		queue_rect(x, y, w, h, r, g, b, a);
 	}
 	else
 #endif
@@ -327,8 +382,10 @@ void HUD_Lua_Class::frame_rect(float x, float y, float w, float h,
 #ifdef HAVE_OPENGL
 	if (m_opengl)
 	{
-		glColor4f(r, g, b, a);
-		OGL_RenderFrame(x, y, w, h, t);
+		queue_rect(x, y, w, t, r, g, b, a);
+		queue_rect(x, y + h - t, w, t, r, g, b, a);
+		queue_rect(x, y + t, t, h - t - t, r, g, b, a);
+		queue_rect(x + w - t, y + t, t, h - t - t, r, g, b, a);
 	}
 	else
 #endif
@@ -374,6 +431,7 @@ void HUD_Lua_Class::draw_text(FontSpecifier *font, const char *text,
 	if (!text || !strlen(text))
 		return;
 	
+	flush_rects();
 	apply_clip();
 #ifdef HAVE_OPENGL
 	if (m_opengl)
@@ -453,6 +511,7 @@ void HUD_Lua_Class::draw_image(Image_Blitter *image, float x, float y)
 	if (!r.w || !r.h)
 		return;
 
+	flush_rects();
 	apply_clip();
     if (m_surface)
     {
@@ -476,6 +535,7 @@ void HUD_Lua_Class::draw_shape(Shape_Blitter *shape, float x, float y)
 	if (!r.w || !r.h)
 		return;
     
+	flush_rects();
 	apply_clip();
 #ifdef HAVE_OPENGL
     if (m_opengl)
@@ -84,6 +84,15 @@ protected:
 	SDL_Surface *m_surface;
 	SDL_Rect m_wr;
 	short m_masking_mode;
+
+	// Untextured rectangles queued as triangles, with a color for each
+	// vertex, until something else is drawn or the mask changes
+	std::vector<float> m_rect_vertices;
+	std::vector<float> m_rect_colors;
+
+	void queue_rect(float x, float y, float w, float h,
+	                float r, float g, float b, float a);
+	void flush_rects(void);
 	
 	void start_using_mask(void);
 	void end_using_mask(void);
@@ -40,6 +40,8 @@
 #include "OGL_Setup.h"
 #include "OGL_Textures.h"
 #include "OGL_Blitter.h"
+#include "OGL_FBO.h"
+#include "OGL_StreamBuffer.h"
 #include "Shape_Blitter.h"
 
 #ifdef HAVE_OPENGL
@@ -63,8 +65,38 @@ static HUD_OGL_Class HUD_OGL;
 static OGL_Blitter HUD_Blitter;  // HUD backdrop storage
 static bool hud_pict_not_found = false;	// HUD backdrop picture not found, don't try again to load it
 
+// The HUD as last composed, kept from frame to frame like the software HUD's buffer,
+// and what it was composed for
+static FBO *HUD_Cache = NULL;
+static short HUD_CachePlayer = NONE;
+static bool HUD_CacheMotionSensor = false;
+
 extern int LuaTexturePaletteSize();
 
+// Draws the backdrop into [0, width) x [0, height) and sets up the 640x160 panel coordinates
+static void draw_hud_backdrop(int width, int height)
+{
+	if (HUD_Blitter.Loaded() && !LuaTexturePaletteSize())
+	{
+		SDL_Rect hud_dest = { 0, 0, width, height };
+		HUD_Blitter.Draw(hud_dest);
+	}
+	else
+	{
+		glColor3ub(0, 0, 0);
+		OGL_RenderRect(0, 0, width, height);
+	}
+}
+
+static void setup_hud_coordinates(int width, int height)
+{
+	GLdouble x_scale = width / 640.0;
+	GLdouble y_scale = height / 160.0;
+	glMatrixMode(GL_MODELVIEW);
+	glTranslated(0.0, -(320.0 * y_scale), 0.0);
+	glScaled(x_scale, y_scale, 1.0);
+}
+
 void OGL_DrawHUD(Rect &dest, short time_elapsed)
 {	
 	// Load static HUD picture if necessary
@@ -73,6 +105,9 @@ void OGL_DrawHUD(Rect &dest, short time_elapsed)
             hud_pict_not_found = true;
 	}
 
+	int width = dest.right - dest.left;
+	int height = dest.bottom - dest.top;
+
 	glPushAttrib(GL_ALL_ATTRIB_BITS);
 	glDisable(GL_DEPTH_TEST);
 	glDisable(GL_ALPHA_TEST);
@@ -83,37 +118,63 @@ void OGL_DrawHUD(Rect &dest, short time_elapsed)
 	glPushMatrix();
 	glLoadIdentity();
 	
-	// Draw static HUD picture
-	if (HUD_Blitter.Loaded() && !LuaTexturePaletteSize())
+	if (FBO_Allowed && width > 0 && height > 0)
 	{
-		SDL_Rect hud_dest = { dest.left, dest.top, dest.right - dest.left, dest.bottom - dest.top };
-		HUD_Blitter.Draw(hud_dest);
+		if (HUD_Cache && (HUD_Cache->_w != GLuint(width) || HUD_Cache->_h != GLuint(height)))
+			OGL_ResetHUDBuffer();
+		
+		// Everything is drawn again only when there is no telling what is there;
+		// otherwise the panels draw themselves only if they are dirty
+		bool compose = (!HUD_Cache || time_elapsed == NONE ||
+			HUD_CachePlayer != current_player_index ||
+			HUD_CacheMotionSensor != MotionSensorActive ||
+			LuaTexturePaletteSize());
+		if (!HUD_Cache)
+			HUD_Cache = new FBO(width, height);
+		
+		glClearColor(0, 0, 0, 1);
+		HUD_Cache->activate(compose);
+		HUD_Cache->prepare_drawing_mode();
+		if (compose)
+			draw_hud_backdrop(width, height);
+		setup_hud_coordinates(width, height);
+		HUD_OGL.update_everything(compose ? NONE : time_elapsed);
+		HUD_Cache->reset_drawing_mode();
+		HUD_Cache->deactivate();
+		
+		HUD_CachePlayer = current_player_index;
+		HUD_CacheMotionSensor = MotionSensorActive;
+		
+		glDisable(GL_DEPTH_TEST);
+		glDisable(GL_BLEND);
+		glDisable(GL_TEXTURE_2D);
+		glMatrixMode(GL_MODELVIEW);
+		glLoadIdentity();
+		glTranslated(dest.left, dest.top, 0.0);
+		glColor4f(1.0, 1.0, 1.0, 1.0);
+		HUD_Cache->draw();
 	}
 	else
 	{
-		glColor3ub(0, 0, 0);
-		OGL_RenderRect(dest.left, dest.top, dest.right - dest.left, dest.bottom - dest.top);
+		// Draw static HUD picture and all the dynamic elements on top, every frame
+		glTranslated(dest.left, dest.top, 0.0);
+		draw_hud_backdrop(width, height);
+		setup_hud_coordinates(width, height);
+		HUD_OGL.update_everything(NONE);
 	}
 	
-	GLdouble x_scale = (dest.right - dest.left) / 640.0;
-	GLdouble y_scale = (dest.bottom - dest.top) / 160.0;
-	glMatrixMode(GL_MODELVIEW);
-	glTranslated(dest.left, dest.top - (320.0 * y_scale), 0.0);
-	glScaled(x_scale, y_scale, 1.0);
-
-	// Add dynamic elements (redraw everything)
-	mark_weapon_display_as_dirty();
-	mark_ammo_display_as_dirty();
-	mark_shield_display_as_dirty();
-	mark_oxygen_display_as_dirty();
-	mark_player_inventory_as_dirty(current_player_index, NONE);
-	HUD_OGL.update_everything(time_elapsed);
 	glMatrixMode(GL_MODELVIEW);
 	glPopMatrix();
 
 	glPopAttrib();
 }
 
+void OGL_ResetHUDBuffer()
+{
+	delete HUD_Cache;
+	HUD_Cache = NULL;
+}
+
 
 /*
  *  Update motion sensor
@@ -122,7 +183,17 @@ void OGL_DrawHUD(Rect &dest, short time_elapsed)
 void HUD_OGL_Class::update_motion_sensor(short time_elapsed)
 {
 	if (!(GET_GAME_OPTIONS() & _motion_sensor_does_not_work) && MotionSensorActive) {
-		render_motion_sensor(time_elapsed);
+		// The network compass doesn't count as a change to the sensor
+		short compass_state = 0;
+#if !defined(DISABLE_NETWORKING)
+		if (dynamic_world->player_count > 1)
+			compass_state = get_network_compass_state(current_player_index);
+#endif
+		if (motion_sensor_has_changed() || time_elapsed == NONE || compass_state != last_compass_state) {
+			render_motion_sensor(time_elapsed);
+			ForceUpdate = true;
+			last_compass_state = compass_state;
+		}
 	}
 }
 
@@ -316,19 +387,103 @@ void HUD_OGL_Class::DisableClipPlane(void)
 	glDisable(GL_CLIP_PLANE0);
 }
 
-#define MESSAGE_AREA_X_OFFSET -9
-#define MESSAGE_AREA_Y_OFFSET -5
+/*
+ *  Queue a blip, cut off where SetClipPlane() would cut it
+ */
 
-void HUD_OGL_Class::draw_message_area(short)
+void HUD_OGL_Class::QueueBlip(shape_descriptor shape, short left, short top, short width, short height,
+	int x, int y, int c_x, int c_y, int radius)
 {
-	{
-		screen_rectangle *player_name_rect = get_interface_rectangle(_player_name_rect);
-		DrawShapeAtXY(
-			BUILD_DESCRIPTOR(_collection_interface, _network_panel), 
-			player_name_rect->left + MESSAGE_AREA_X_OFFSET, player_name_rect->top + MESSAGE_AREA_Y_OFFSET);
-		draw_player_name();
+	if (shape != blip_shape)
+		FlushBlips();
+	blip_shape = shape;
+
+	float corners[4][4] = {
+		{ float(left), float(top), 0, 0 },
+		{ float(left + width), float(top), 1, 0 },
+		{ float(left + width), float(top + height), 1, 1 },
+		{ float(left), float(top + height), 0, 1 }
+	};
+
+	float polygon[5][4];
+	int count = 0;
+	GLdouble blip_dist = sqrt(static_cast<float>(x*x+y*y));
+	if (blip_dist <= 2.0) {
+		memcpy(polygon, corners, sizeof(corners));
+		count = 4;
+	} else {
+		// keep what is on the sensor's side of the line tangent to its
+		// edge, toward the blip
+		GLdouble normal_x = x / blip_dist, normal_y = y / blip_dist;
+		GLdouble tan_pt_x = c_x + normal_x * radius + 0.5, tan_pt_y = c_y + normal_y * radius + 0.5;
+		GLdouble d = normal_x * tan_pt_x + normal_y * tan_pt_y;
+		float side[4];
+		for (int i = 0; i < 4; ++i)
+			side[i] = d - normal_x * corners[i][0] - normal_y * corners[i][1];
+		for (int i = 0; i < 4; ++i) {
+			int j = (i + 1) % 4;
+			if (side[i] >= 0)
+				memcpy(polygon[count++], corners[i], sizeof(corners[i]));
+			if ((side[i] >= 0) != (side[j] >= 0)) {
+				float t = side[i] / (side[i] - side[j]);
+				for (int k = 0; k < 4; ++k)
+					polygon[count][k] = corners[i][k] + t * (corners[j][k] - corners[i][k]);
+				++count;
+			}
+		}
+	}
+
+	for (int i = 1; i + 1 < count; ++i) {
+		blip_vertices.insert(blip_vertices.end(), polygon[0], polygon[0] + 4);
+		blip_vertices.insert(blip_vertices.end(), polygon[i], polygon[i] + 4);
+		blip_vertices.insert(blip_vertices.end(), polygon[i + 1], polygon[i + 1] + 4);
 	}
 }
 
 
+/*
+ *  Draw the queued blips
+ */
+
+void HUD_OGL_Class::FlushBlips(void)
+{
+	if (blip_vertices.empty())
+		return;
+
+	TextureManager TMgr;
+	TMgr.ShapeDesc = blip_shape;
+	get_shape_bitmap_and_shading_table(blip_shape, &TMgr.Texture, &TMgr.ShadingTables, _shading_normal);
+	TMgr.IsShadeless = true;
+	TMgr.TransferMode = _shadeless_transfer;
+	TMgr.TextureType = OGL_Txtr_WeaponsInHand;
+	if (TMgr.Setup()) {
+		for (size_t i = 0; i < blip_vertices.size(); i += 4) {
+			blip_vertices[i + 2] = TMgr.U_Offset + blip_vertices[i + 2] * TMgr.U_Scale;
+			blip_vertices[i + 3] = TMgr.V_Offset + blip_vertices[i + 3] * TMgr.V_Scale;
+		}
+
+		glColor3f(1.0, 1.0, 1.0);
+		glEnable(GL_TEXTURE_2D);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		TMgr.SetupTextureMatrix();
+		TMgr.RenderNormal();
+
+		const size_t bytes = blip_vertices.size() * sizeof(GLfloat);
+		const GLsizei stride = 4 * sizeof(GLfloat);
+		OGL_StreamReserve(bytes);
+		const char *base = static_cast<const char *>(OGL_StreamArray(&blip_vertices[0], bytes));
+		glVertexPointer(2, GL_FLOAT, stride, base);
+		glTexCoordPointer(2, GL_FLOAT, stride, base + 2 * sizeof(GLfloat));
+		GLsizei count = blip_vertices.size() / 4;
+		glDrawArrays(GL_TRIANGLES, 0, count);
+		OGL_StreamDone(count);
+
+		TMgr.RestoreTextureMatrix();
+	}
+
+	blip_vertices.clear();
+	blip_shape = UNONE;
+}
+
 #endif // def HAVE_OPENGL
@@ -30,10 +30,12 @@
 
 #include "HUDRenderer.h"
 
+#include <vector>
+
 class HUD_OGL_Class : public HUD_Class
 {
 public:
-	HUD_OGL_Class() {}
+	HUD_OGL_Class() : blip_shape(UNONE), last_compass_state(0) {}
 	~HUD_OGL_Class() {}
 
 protected:
@@ -42,8 +44,6 @@ protected:
 	void draw_or_erase_unclipped_shape(short x, short y, shape_descriptor shape, bool draw);
 	void draw_entity_blip(point2d *location, shape_descriptor shape);
 
-	virtual void draw_message_area(short);
-
 	void DrawShape(shape_descriptor shape, screen_rectangle *dest, screen_rectangle *src);
 	void DrawShapeAtXY(shape_descriptor shape, short x, short y, bool transparency = false);
 	void DrawText(const char *text, screen_rectangle *dest, short flags, short font_id, short text_color);
@@ -54,6 +54,17 @@ protected:
 
 	void SetClipPlane(int x, int y, int c_x, int c_y, int radius);
 	void DisableClipPlane(void);
+
+	// Blips are clipped here rather than by a clip plane each, and a run
+	// of them with the same shape is drawn at once
+	void QueueBlip(shape_descriptor shape, short left, short top, short width, short height,
+		int x, int y, int c_x, int c_y, int radius);
+	void FlushBlips(void);
+
+private:
+	shape_descriptor blip_shape;
+	std::vector<float> blip_vertices; // x, y, and u, v across the blip
+	short last_compass_state; // as the motion sensor was last drawn
 };
 
 #endif
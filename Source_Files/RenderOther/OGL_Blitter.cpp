@@ -29,10 +29,12 @@
 #ifdef HAVE_OPENGL
 #include "OGL_Render.h"
 
-const int OGL_Blitter::tile_size;
+const int OGL_Blitter::max_tile_size;
 std::set<OGL_Blitter*> *OGL_Blitter::m_blitter_registry = NULL;
+GLuint OGL_Blitter::m_pixel_buffer = 0;
+bool OGL_Blitter::m_pixel_buffer_checked = false;
 
-OGL_Blitter::OGL_Blitter() : m_textures_loaded(false)
+OGL_Blitter::OGL_Blitter() : m_textures_loaded(false), m_textures_current(false), m_reloads(0)
 {
 	m_src.x = m_src.y = m_src.w = m_src.h = 0;
 	m_scaled_src.x = m_scaled_src.y = m_scaled_src.w = m_scaled_src.h = 0;
@@ -44,20 +46,44 @@ inline int NextPowerOfTwo(int n);
 
 void OGL_Blitter::_LoadTextures()
 {
-	if (m_textures_loaded)
+	if (m_textures_current)
 		return;
 	if (!m_surface)
 		return;
 	
-	m_tile_width  = std::min(NextPowerOfTwo(m_src.w), tile_size);
-	m_tile_height = std::min(NextPowerOfTwo(m_src.h), tile_size);
+	// fewer, larger tiles mean fewer textures to bind and draw
+	GLint max_texture_size = max_tile_size;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+	int tile_size = std::min(static_cast<int>(max_texture_size), static_cast<int>(max_tile_size));
+	
+	int tile_width  = std::min(NextPowerOfTwo(m_src.w), tile_size);
+	int tile_height = std::min(NextPowerOfTwo(m_src.h), tile_size);
 	
 	if (Get_OGL_ConfigureData().Flags & OGL_Flag_TextureFix)
 	{
-		m_tile_width = std::max(m_tile_width, 128);
-		m_tile_height = std::max(m_tile_height, 128);
+		tile_width = std::max(tile_width, 128);
+		tile_height = std::max(tile_height, 128);
 	}
 
+	// calculate how many rects we need
+	int v_rects = ((m_src.h + tile_height - 1) / tile_height);
+	int h_rects = ((m_src.w + tile_width - 1) / tile_width);
+	
+	// textures from an earlier image of the same layout can take this one
+	bool reuse = m_textures_loaded &&
+		tile_width == m_tile_width && tile_height == m_tile_height &&
+		m_refs.size() == static_cast<size_t>(v_rects * h_rects);
+	if (!reuse)
+	{
+		_DeleteTextures();
+		m_reloads = 0;
+	}
+	else
+		++m_reloads;
+	
+	m_tile_width = tile_width;
+	m_tile_height = tile_height;
+
 	SDL_Surface *t;
 #ifdef ALEPHONE_LITTLE_ENDIAN
 	t = SDL_CreateRGBSurface(SDL_SWSURFACE, m_tile_width, m_tile_height, 32, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
@@ -69,14 +95,22 @@ void OGL_Blitter::_LoadTextures()
 	
 	SDL_SetSurfaceBlendMode(t, SDL_BLENDMODE_NONE);
 	
-	// calculate how many rects we need
-	int v_rects = ((m_src.h + m_tile_height - 1) / m_tile_height);
-	int h_rects = ((m_src.w + m_tile_width - 1) / m_tile_width);
 	m_rects.resize(v_rects * h_rects);
 	m_refs.resize(v_rects * h_rects);
 
 	// ensure our textures get cleaned up
 	Register(this);
+	
+	// an image that keeps changing is streamed through a pixel buffer
+	if (!m_pixel_buffer_checked)
+	{
+		m_pixel_buffer_checked = true;
+		if (OGL_CheckExtension("GL_ARB_pixel_buffer_object"))
+			glGenBuffersARB(1, &m_pixel_buffer);
+	}
+	bool streaming = reuse && m_reloads > 1 && m_pixel_buffer;
+	if (streaming)
+		glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, m_pixel_buffer);
 
 	uint32 rgb_mask = ~(t->format->Amask);
 
@@ -114,22 +148,42 @@ void OGL_Blitter::_LoadTextures()
 				}
 			}
 			
-			glGenTextures(1, &m_refs[i]);
-			glBindTexture(GL_TEXTURE_2D, m_refs[i]);
-
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-			
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_tile_width, m_tile_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, t->pixels);
+			if (reuse)
+			{
+				glBindTexture(GL_TEXTURE_2D, m_refs[i]);
+				
+				const GLvoid *pixels = t->pixels;
+				if (streaming)
+				{
+					// orphan the last tile's storage rather than wait on it
+					glBufferDataARB(GL_PIXEL_UNPACK_BUFFER_ARB, m_tile_width * m_tile_height * 4, t->pixels, GL_STREAM_DRAW_ARB);
+					pixels = NULL;
+				}
+				glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_tile_width, m_tile_height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+			}
+			else
+			{
+				glGenTextures(1, &m_refs[i]);
+				glBindTexture(GL_TEXTURE_2D, m_refs[i]);
+
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+				
+				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_tile_width, m_tile_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, t->pixels);
+			}
 
 			i++;
 		}
 	}
 	
+	if (streaming)
+		glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
+	
 	SDL_FreeSurface(t);
 	m_textures_loaded = true;
+	m_textures_current = true;
 	return;
 }
 
@@ -139,7 +193,13 @@ void OGL_Blitter::Unload()
 	_UnloadTextures();
 }
 
+// Keeps the textures for whatever image comes next
 void OGL_Blitter::_UnloadTextures()
+{
+	m_textures_current = false;
+}
+
+void OGL_Blitter::_DeleteTextures()
 {
 	if (!m_textures_loaded)
 		return;
@@ -149,10 +209,18 @@ void OGL_Blitter::_UnloadTextures()
 	m_refs.clear();
 	m_rects.clear();
 	m_textures_loaded = false;
+	m_textures_current = false;
 }
 
 void OGL_Blitter::StopTextures()
 {
+	if (m_pixel_buffer)
+	{
+		glDeleteBuffersARB(1, &m_pixel_buffer);
+		m_pixel_buffer = 0;
+	}
+	m_pixel_buffer_checked = false;
+	
 	if (!m_blitter_registry)
 		return;
 	
@@ -160,12 +228,13 @@ void OGL_Blitter::StopTextures()
 	for (it = m_blitter_registry->begin();
 	     it != m_blitter_registry->end();
 	     it = m_blitter_registry->begin())
-		(*it)->_UnloadTextures();
+		(*it)->_DeleteTextures();
 }
 
 OGL_Blitter::~OGL_Blitter()
 {
 	Unload();
+	_DeleteTextures();
 }
 
 int OGL_Blitter::ScreenWidth()
@@ -193,7 +262,7 @@ void OGL_Blitter::Draw(const Image_Rect& dst, const Image_Rect& raw_src)
 	if (!Loaded())
 		return;
 	_LoadTextures();
-	if (!m_textures_loaded)
+	if (!m_textures_current)
 		return;
 
 	glPushAttrib(GL_ALL_ATTRIB_BITS);
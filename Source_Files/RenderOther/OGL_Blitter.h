@@ -62,6 +62,7 @@ private:
 	
 	void _LoadTextures();
 	void _UnloadTextures();
+	void _DeleteTextures();
 
 	// Add or remove an instance from the registry of in-use OpenGL blitters.
 	// To recycle OpenGL assets properly on context switches, the set
@@ -74,8 +75,18 @@ private:
 	int m_tile_width, m_tile_height;
 	bool m_textures_loaded;
 	
-	static const int tile_size = 256;
+	// The textures outlive the image they were made for, so that a new
+	// image of the same size is copied into them instead of reallocating;
+	// m_reloads counts those copies, to tell animated images from others
+	bool m_textures_current;
+	int m_reloads;
+	
+	static const int max_tile_size = 1024;
 	static std::set<OGL_Blitter*> *m_blitter_registry;
+	
+	// Shared staging buffer for streaming animated images, if supported
+	static GLuint m_pixel_buffer;
+	static bool m_pixel_buffer_checked;
 };
 
 #endif
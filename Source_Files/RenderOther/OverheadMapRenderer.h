@@ -180,6 +180,19 @@ protected:
 	// For special overall things
 	virtual void begin_overall() {}
 	virtual void end_overall() {}
+	
+	// For drawing all the polygons and lines at once, in place of the
+	// calls below; returns whether it did
+	virtual bool draw_cached_geometry(overhead_map_data& Control) {return false;}
+	
+	// What the polygons and lines of the map look like, wherever they are
+	// on the screen: a polygon color or a line definition, or NONE if they
+	// are not to be drawn
+	static short polygon_color(short polygon_index);
+	static short line_color(short line_index);
+	
+	// Map coordinates are shifted down by this to get screen coordinates
+	static int scale_shift(short scale) {return 8-scale;}
 
 	virtual void begin_polygons() {}
 	virtual void draw_polygon(
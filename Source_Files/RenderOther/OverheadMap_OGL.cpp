@@ -73,6 +73,8 @@ Jan 25, 2002 (Br'fin (Jeremy Parsons)):
 #ifdef HAVE_OPENGL
 #include "OGL_Headers.h"
 #include "OGL_Render.h"
+#include "OGL_Setup.h"
+#include "OGL_StreamBuffer.h"
 #endif
 
 
@@ -136,6 +138,203 @@ void OverheadMap_OGL_Class::end_overall()
 }
 
 
+OverheadMap_OGL_Class::OverheadMap_OGL_Class() :
+	GeometryValid(false),
+	GeometryCachedKey(0),
+	GeometryBuffer(0),
+	GeometryBufferChecked(false),
+	GeometryBufferCurrent(false)
+{
+}
+
+void OverheadMap_OGL_Class::ResetBuffers()
+{
+	if (GeometryBuffer)
+		glDeleteBuffersARB(1, &GeometryBuffer);
+	GeometryBuffer = 0;
+	GeometryBufferChecked = false;
+	GeometryBufferCurrent = false;
+}
+
+static inline void HashValue(uint32& Key, int32 Value)
+{
+	// FNV-1a, a byte at a time
+	for (int k=0; k<4; k++)
+	{
+		Key ^= (Value >> (8*k)) & 0xff;
+		Key *= 16777619;
+	}
+}
+
+// Covers everything the cached geometry is made from: what is explored, how
+// each polygon and line is colored (which changes with platforms and media),
+// the line widths for the scale, and, for a new level, the endpoints
+uint32 OverheadMap_OGL_Class::GeometryKey(short scale)
+{
+	uint32 Key = 2166136261U;
+	HashValue(Key, scale);
+	HashValue(Key, dynamic_world->endpoint_count);
+	HashValue(Key, dynamic_world->polygon_count);
+	HashValue(Key, dynamic_world->line_count);
+	
+	for (short i=0; i<dynamic_world->endpoint_count; i++)
+	{
+		endpoint_data *Endpoint = get_endpoint_data(i);
+		HashValue(Key, (int32(Endpoint->vertex.x) << 16) ^ uint16(Endpoint->vertex.y));
+	}
+	for (short i=0; i<dynamic_world->polygon_count; i++)
+		HashValue(Key, polygon_color(i));
+	for (short i=0; i<dynamic_world->line_count; i++)
+	{
+		short Color = line_color(i);
+		HashValue(Key, Color);
+		if (Color >= 0 && Color < NUMBER_OF_LINE_DEFINITIONS)
+			HashValue(Key, ConfigPtr->line_definitions[Color].pen_sizes[scale-OVERHEAD_MAP_MINIMUM_SCALE]);
+	}
+	return Key;
+}
+
+void OverheadMap_OGL_Class::BuildGeometry(short scale)
+{
+	float Scale = 1.0f / float(1 << scale_shift(scale));
+	
+	vector<float> PolygonVertices[NUMBER_OF_POLYGON_COLORS];
+	for (short i=0; i<dynamic_world->polygon_count; i++)
+	{
+		short Color = polygon_color(i);
+		if (!(Color >= 0 && Color < NUMBER_OF_POLYGON_COLORS)) continue;
+		
+		// As triangle fans
+		polygon_data *Polygon = get_polygon_data(i);
+		world_point2d& V0 = get_endpoint_data(Polygon->endpoint_indexes[0])->vertex;
+		for (int k=2; k<Polygon->vertex_count; k++)
+		{
+			world_point2d& V1 = get_endpoint_data(Polygon->endpoint_indexes[k-1])->vertex;
+			world_point2d& V2 = get_endpoint_data(Polygon->endpoint_indexes[k])->vertex;
+			float Triangle[6] = {
+				V0.x * Scale, V0.y * Scale,
+				V1.x * Scale, V1.y * Scale,
+				V2.x * Scale, V2.y * Scale
+			};
+			PolygonVertices[Color].insert(PolygonVertices[Color].end(), Triangle, Triangle + 6);
+		}
+	}
+	
+	vector<float> LineVertices[NUMBER_OF_LINE_DEFINITIONS];
+	for (short i=0; i<dynamic_world->line_count; i++)
+	{
+		short Color = line_color(i);
+		if (!(Color >= 0 && Color < NUMBER_OF_LINE_DEFINITIONS)) continue;
+		
+		// As quads of the pen's width, like OGL_RenderLines()
+		line_data *Line = get_line_data(i);
+		world_point2d& V0 = get_endpoint_data(Line->endpoint_indexes[0])->vertex;
+		world_point2d& V1 = get_endpoint_data(Line->endpoint_indexes[1])->vertex;
+		float x0 = V0.x * Scale, y0 = V0.y * Scale;
+		float x1 = V1.x * Scale, y1 = V1.y * Scale;
+		float rise = y1 - y0;
+		float run = x1 - x0;
+		float length = sqrtf(rise*rise + run*run);
+		if (length <= 0) continue;
+		
+		float thickness = ConfigPtr->line_definitions[Color].pen_sizes[scale-OVERHEAD_MAP_MINIMUM_SCALE];
+		float xd = run * (thickness / length) * 0.5f;
+		float yd = rise * (thickness / length) * 0.5f;
+		float Quad[12] = {
+			x0 - yd, y0 + xd,
+			x0 + yd, y0 - xd,
+			x1 - yd, y1 + xd,
+			x0 + yd, y0 - xd,
+			x1 + yd, y1 - xd,
+			x1 - yd, y1 + xd
+		};
+		LineVertices[Color].insert(LineVertices[Color].end(), Quad, Quad + 12);
+	}
+	
+	GeometryVertices.clear();
+	PolygonBatches.clear();
+	LineBatches.clear();
+	for (int c=0; c<NUMBER_OF_POLYGON_COLORS; c++)
+	{
+		if (PolygonVertices[c].empty()) continue;
+		GeometryBatch Batch;
+		Batch.Color = c;
+		Batch.First = GeometryVertices.size() / 2;
+		Batch.Count = PolygonVertices[c].size() / 2;
+		PolygonBatches.push_back(Batch);
+		GeometryVertices.insert(GeometryVertices.end(), PolygonVertices[c].begin(), PolygonVertices[c].end());
+	}
+	for (int c=0; c<NUMBER_OF_LINE_DEFINITIONS; c++)
+	{
+		if (LineVertices[c].empty()) continue;
+		GeometryBatch Batch;
+		Batch.Color = c;
+		Batch.First = GeometryVertices.size() / 2;
+		Batch.Count = LineVertices[c].size() / 2;
+		LineBatches.push_back(Batch);
+		GeometryVertices.insert(GeometryVertices.end(), LineVertices[c].begin(), LineVertices[c].end());
+	}
+	
+	GeometryBufferCurrent = false;
+}
+
+bool OverheadMap_OGL_Class::draw_cached_geometry(overhead_map_data& Control)
+{
+	uint32 Key = GeometryKey(Control.scale);
+	if (!GeometryValid || Key != GeometryCachedKey)
+	{
+		BuildGeometry(Control.scale);
+		GeometryCachedKey = Key;
+		GeometryValid = true;
+	}
+	if (GeometryVertices.empty())
+		return true;
+	
+	if (!GeometryBufferChecked)
+	{
+		GeometryBufferChecked = true;
+		if (OGL_CheckExtension("GL_ARB_vertex_buffer_object"))
+			glGenBuffersARB(1, &GeometryBuffer);
+	}
+	
+	const GLvoid *Vertices = &GeometryVertices.front();
+	if (GeometryBuffer)
+	{
+		glBindBufferARB(GL_ARRAY_BUFFER_ARB, GeometryBuffer);
+		if (!GeometryBufferCurrent)
+		{
+			glBufferDataARB(GL_ARRAY_BUFFER_ARB, GeometryVertices.size() * sizeof(float), Vertices, GL_STATIC_DRAW_ARB);
+			GeometryBufferCurrent = true;
+		}
+		Vertices = NULL;
+	}
+	
+	// Only the map's origin moves from frame to frame
+	float Scale = 1.0f / float(1 << scale_shift(Control.scale));
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glTranslatef(Control.left + Control.half_width - Control.origin.x * Scale,
+		Control.top + Control.half_height - Control.origin.y * Scale, 0);
+	
+	glVertexPointer(2, GL_FLOAT, 0, Vertices);
+	for (size_t k=0; k<PolygonBatches.size(); k++)
+	{
+		SetColor(ConfigPtr->polygon_colors[PolygonBatches[k].Color]);
+		glDrawArrays(GL_TRIANGLES, PolygonBatches[k].First, PolygonBatches[k].Count);
+	}
+	for (size_t k=0; k<LineBatches.size(); k++)
+	{
+		SetColor(ConfigPtr->line_definitions[LineBatches[k].Color].color);
+		glDrawArrays(GL_TRIANGLES, LineBatches[k].First, LineBatches[k].Count);
+	}
+	
+	glPopMatrix();
+	if (GeometryBuffer)
+		glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+	
+	return true;
+}
+
 void OverheadMap_OGL_Class::begin_polygons()
 {
 	// Polygons are rendered before lines, and use the endpoint array,
@@ -288,8 +487,9 @@ void OverheadMap_OGL_Class::draw_thing(
 				-0.30f - ht, -0.75f,
 				-0.30f + ht, -0.75f + ft
 			};
-			glVertexPointer(2, GL_FLOAT, 0, vertices);
-			glDrawArrays(GL_TRIANGLE_STRIP, 0, 36);
+			glVertexPointer(2, GL_FLOAT, 0, OGL_StreamArray(vertices, sizeof(vertices)));
+			glDrawArrays(GL_TRIANGLE_STRIP, 0, 18);
+			OGL_StreamDone(18);
 		}
 		break;
 	default:
@@ -331,8 +531,9 @@ void OverheadMap_OGL_Class::draw_player(
 	glScalef(scale,scale,1);
 	glDisable(GL_TEXTURE_2D);
 	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-	glVertexPointer(2,GL_FLOAT,0,PlayerShape[0]);
+	glVertexPointer(2,GL_FLOAT,0,OGL_StreamArray(PlayerShape[0],sizeof(PlayerShape)));
 	glDrawArrays(GL_POLYGON,0,3);
+	OGL_StreamDone(3);
 
 	glPopMatrix();
 }
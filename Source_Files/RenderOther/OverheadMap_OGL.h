@@ -32,12 +32,20 @@ Oct 13, 2000 (Loren Petrich)
 #include <vector>
 #include "OverheadMapRenderer.h"
 
+#ifdef HAVE_OPENGL
+#include "OGL_Headers.h"
+#endif
+
 
 class OverheadMap_OGL_Class: public OverheadMapClass
 {
 	void begin_overall();
 	void end_overall();
 	
+	bool draw_cached_geometry(overhead_map_data& Control);
+	uint32 GeometryKey(short scale);
+	void BuildGeometry(short scale);
+	
 	void begin_polygons();
 	
 	void draw_polygon(
@@ -100,8 +108,35 @@ class OverheadMap_OGL_Class: public OverheadMapClass
 	
 	// Cached lines For drawing monster paths
 	vector<world_point2d> PathPoints;
+	
+	// The explored map's polygons (as triangles) and lines (as quads),
+	// relative to the map's center and at its scale, grouped by
+	// polygon color or line definition; they are made again only when
+	// GeometryKey() changes, as with exploring, zooming, or platforms
+	// and media moving
+	struct GeometryBatch
+	{
+		short Color;
+		int First, Count;
+	};
+	vector<GeometryBatch> PolygonBatches, LineBatches;
+	vector<float> GeometryVertices;
+	bool GeometryValid;
+	uint32 GeometryCachedKey;
+	
+#ifdef HAVE_OPENGL
+	// Where the vertices are kept, if vertex buffers are supported
+	GLuint GeometryBuffer;
+	bool GeometryBufferChecked, GeometryBufferCurrent;
+#endif
 
 public:
+	OverheadMap_OGL_Class();
+	
+#ifdef HAVE_OPENGL
+	// Call before the OpenGL context goes away
+	void ResetBuffers();
+#endif
 };
 
 #endif
@@ -28,6 +28,8 @@
 #include "map.h"
 #include "screen_drawing.h"
 
+#include <stdlib.h>
+
 
 // From screen_sdl.cpp
 extern SDL_Surface *draw_surface;
@@ -176,3 +178,144 @@ void OverheadMap_SDL_Class::draw_path(short step, world_point2d &location)
 		::draw_line(draw_surface, &path_point, &location, path_pixel, 1);
 	path_point = location;
 }
+
+
+/*
+ *  Cached polygons and lines
+ */
+
+OverheadMap_SDL_Class::~OverheadMap_SDL_Class()
+{
+	if (cache)
+		SDL_FreeSurface(cache);
+}
+
+void OverheadMap_SDL_Class::transform_endpoints_for_cache()
+{
+	int xoff = cache->w / 2, yoff = cache->h / 2;
+	int shift = scale_shift(cache_scale);
+	for (short i = 0; i < dynamic_world->endpoint_count; i++) {
+		endpoint_data *endpoint = get_endpoint_data(i);
+		endpoint->transformed.x = xoff + ((endpoint->vertex.x >> shift) - (cache_origin.x >> shift));
+		endpoint->transformed.y = yoff + ((endpoint->vertex.y >> shift) - (cache_origin.y >> shift));
+	}
+}
+
+void OverheadMap_SDL_Class::draw_cached_polygon(short polygon_index, short color)
+{
+	if (!(color >= 0 && color < NUMBER_OF_POLYGON_COLORS))
+		return;
+	polygon_data *polygon = get_polygon_data(polygon_index);
+	draw_polygon(polygon->vertex_count, polygon->endpoint_indexes, ConfigPtr->polygon_colors[color]);
+}
+
+void OverheadMap_SDL_Class::draw_cached_line(short line_index, short color)
+{
+	if (!(color >= 0 && color < NUMBER_OF_LINE_DEFINITIONS))
+		return;
+	line_definition &LineDef = ConfigPtr->line_definitions[color];
+	draw_line(get_line_data(line_index)->endpoint_indexes, LineDef.color,
+		LineDef.pen_sizes[cache_scale - OVERHEAD_MAP_MINIMUM_SCALE]);
+}
+
+void OverheadMap_SDL_Class::build_cache(overhead_map_data &Control)
+{
+	// Half a view's margin all around
+	int width = 2 * Control.width, height = 2 * Control.height;
+	if (!cache || cache->w != width || cache->h != height || cache->format->format != draw_surface->format->format) {
+		if (cache)
+			SDL_FreeSurface(cache);
+		SDL_PixelFormat *f = draw_surface->format;
+		cache = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, f->BitsPerPixel, f->Rmask, f->Gmask, f->Bmask, 0);
+		if (!cache)
+			return;
+		SDL_SetSurfaceBlendMode(cache, SDL_BLENDMODE_NONE);
+	}
+
+	cache_origin = Control.origin;
+	cache_scale = Control.scale;
+	cache_level = dynamic_world->current_level_number;
+	SDL_FillRect(cache, NULL, SDL_MapRGB(cache->format, 0, 0, 0));
+
+	SDL_Surface *old_surface = draw_surface;
+	draw_surface = cache;
+	transform_endpoints_for_cache();
+	for (short i = 0; i < dynamic_world->polygon_count; i++)
+		draw_cached_polygon(i, cache_polygon_colors[i]);
+	for (short i = 0; i < dynamic_world->line_count; i++)
+		draw_cached_line(i, cache_line_colors[i]);
+	draw_surface = old_surface;
+}
+
+bool OverheadMap_SDL_Class::draw_cached_geometry(overhead_map_data &Control)
+{
+	// Checkpoints and previews are drawn once
+	if (Control.mode != _rendering_game_map)
+		return false;
+
+	std::vector<short> polygon_colors(dynamic_world->polygon_count), line_colors(dynamic_world->line_count);
+	for (short i = 0; i < dynamic_world->polygon_count; i++)
+		polygon_colors[i] = polygon_color(i);
+	for (short i = 0; i < dynamic_world->line_count; i++)
+		line_colors[i] = line_color(i);
+
+	// Has the view moved out of the cache?
+	int shift = scale_shift(Control.scale);
+	int dx = 0, dy = 0;
+	bool rebuild = !cache || cache->w != 2 * Control.width || cache->h != 2 * Control.height ||
+		cache->format->format != draw_surface->format->format ||
+		Control.scale != cache_scale || dynamic_world->current_level_number != cache_level ||
+		polygon_colors.size() != cache_polygon_colors.size() || line_colors.size() != cache_line_colors.size();
+	if (!rebuild) {
+		dx = (Control.origin.x >> shift) - (cache_origin.x >> shift);
+		dy = (Control.origin.y >> shift) - (cache_origin.y >> shift);
+		rebuild = abs(dx) > Control.width / 2 || abs(dy) > Control.height / 2;
+	}
+
+	// Polygons only ever being explored can be drawn in; they are drawn
+	// over their neighbors' lines, so those are drawn again
+	std::vector<short> explored;
+	for (size_t i = 0; !rebuild && i < polygon_colors.size(); i++) {
+		if (polygon_colors[i] == cache_polygon_colors[i])
+			continue;
+		if (cache_polygon_colors[i] == NONE)
+			explored.push_back(i);
+		else
+			rebuild = true;
+	}
+	for (size_t i = 0; !rebuild && i < line_colors.size(); i++) {
+		if (line_colors[i] != cache_line_colors[i] && cache_line_colors[i] != NONE)
+			rebuild = true;
+	}
+
+	cache_polygon_colors.swap(polygon_colors);
+	cache_line_colors.swap(line_colors);
+
+	if (rebuild) {
+		build_cache(Control);
+		if (!cache)
+			return false;
+		dx = dy = 0;
+	} else if (!explored.empty() || polygon_colors != cache_polygon_colors || line_colors != cache_line_colors) {
+		SDL_Surface *old_surface = draw_surface;
+		draw_surface = cache;
+		transform_endpoints_for_cache();
+		for (size_t k = 0; k < explored.size(); k++)
+			draw_cached_polygon(explored[k], cache_polygon_colors[explored[k]]);
+		for (size_t k = 0; k < explored.size(); k++) {
+			polygon_data *polygon = get_polygon_data(explored[k]);
+			for (short j = 0; j < polygon->vertex_count; j++)
+				draw_cached_line(polygon->line_indexes[j], cache_line_colors[polygon->line_indexes[j]]);
+		}
+		for (size_t i = 0; i < cache_line_colors.size(); i++) {
+			if (cache_line_colors[i] != line_colors[i])
+				draw_cached_line(i, cache_line_colors[i]);
+		}
+		draw_surface = old_surface;
+	}
+
+	SDL_Rect src = { cache->w / 2 - Control.half_width + dx, cache->h / 2 - Control.half_height + dy, Control.width, Control.height };
+	SDL_Rect dst = { Control.left, Control.top, Control.width, Control.height };
+	SDL_BlitSurface(cache, &src, draw_surface, &dst);
+	return true;
+}
@@ -28,9 +28,17 @@
 
 #include "OverheadMapRenderer.h"
 
+#include <vector>
+
 
 class OverheadMap_SDL_Class : public OverheadMapClass {
+public:
+	OverheadMap_SDL_Class() : cache(NULL) {}
+	~OverheadMap_SDL_Class();
+
 protected:
+	bool draw_cached_geometry(overhead_map_data &Control);
+
 	void draw_polygon(
 		short vertex_count,
 		short *vertices,
@@ -73,6 +81,20 @@ protected:
 private:
 	uint32 path_pixel;
 	world_point2d path_point;
+
+	// The explored map's polygons and lines, drawn around cache_origin with
+	// a margin so that the view can move some before it is drawn again;
+	// newly explored polygons are added to it, and any other change
+	// redraws it
+	SDL_Surface *cache;
+	world_point2d cache_origin;
+	short cache_scale, cache_level;
+	std::vector<short> cache_polygon_colors, cache_line_colors;
+
+	void build_cache(overhead_map_data &Control);
+	void draw_cached_polygon(short polygon_index, short color);
+	void draw_cached_line(short line_index, short color);
+	void transform_endpoints_for_cache();
 };
 
 #endif
@@ -32,6 +32,7 @@ SHAPE_BLITTER.CPP
 #include "OGL_Textures.h"
 #include "OGL_Blitter.h"
 #include "OGL_Render.h"
+#include "OGL_StreamBuffer.h"
 
 #include "OGL_Headers.h"
 #endif
@@ -225,9 +226,11 @@ void Shape_Blitter::OGL_Draw(const Image_Rect& dst)
 			dst.x + dst.w, dst.y + dst.h,
 			dst.x, dst.y + dst.h
 		};
-		glVertexPointer(2, GL_FLOAT, 0, vertices);
-		glTexCoordPointer(2, GL_FLOAT, 0, texcoords);
+		OGL_StreamReserve(sizeof(vertices) + sizeof(texcoords), 2);
+		glVertexPointer(2, GL_FLOAT, 0, OGL_StreamArray(vertices, sizeof(vertices)));
+		glTexCoordPointer(2, GL_FLOAT, 0, OGL_StreamArray(texcoords, sizeof(texcoords)));
 		glDrawArrays(GL_POLYGON, 0, 4);
+		OGL_StreamDone(4);
 	}
     
     if (rotating)
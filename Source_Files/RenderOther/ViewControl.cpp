@@ -256,13 +256,13 @@ void parse_mml_view(const InfoTree& root)
 	root.read_attr("interlevel_in_effects", view_settings.DoInterlevelTeleportInEffects);
 	root.read_attr("interlevel_out_effects", view_settings.DoInterlevelTeleportOutEffects);
 	
-	BOOST_FOREACH(InfoTree font, root.children_named("font"))
+	BOOST_FOREACH(const InfoTree &font, root.children_named("font"))
 	{
 		font.read_font(OnScreenFont);
 		ScreenFontInitedSize = -1;
 	}
 	
-	BOOST_FOREACH(InfoTree fov, root.children_named("fov"))
+	BOOST_FOREACH(const InfoTree &fov, root.children_named("fov"))
 	{
 		fov.read_attr_bounded<float>("normal", FOV_Normal, 0, 180);
 		fov.read_attr_bounded<float>("extra", FOV_ExtraVision, 0, 180);
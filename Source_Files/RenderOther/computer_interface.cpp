@@ -303,6 +303,21 @@ static vector<terminal_text_t> map_terminal_text;
 // ghs: for Lua
 short number_of_terminal_texts() { return map_terminal_text.size(); }
 
+short first_interlevel_teleport_destination()
+{
+	for (size_t i = 0; i < map_terminal_text.size(); ++i)
+	{
+		const vector<terminal_groupings>& groupings = map_terminal_text[i].groupings;
+		for (size_t j = 0; j < groupings.size(); ++j)
+		{
+			if (groupings[j].type == _interlevel_teleport_group)
+				return groupings[j].permutation;
+		}
+	}
+
+	return NONE;
+}
+
 /* internal global structure */
 static struct player_terminal_data *player_terminals;
 
@@ -479,6 +494,60 @@ static bool calculate_line(char *base_text, short width, short start_index, shor
 	return done;
 }
 
+/* Where each line of the group being read starts, as the terminal font in its
+   own style breaks it, to the end of the text; found once, rather than for each
+   line scrolled past every time the terminal is drawn */
+struct terminal_line_starts {
+	char *base_text;
+	short start_index, end_index;
+	short width;
+	font_info *font;
+	uint16 style;
+	vector<short> starts;
+};
+
+static terminal_line_starts line_starts_cache = { NULL, 0, 0, 0, NULL, 0, vector<short>() };
+
+static void forget_terminal_line_starts()
+{
+	line_starts_cache.base_text = NULL;
+	line_starts_cache.starts.clear();
+}
+
+static const vector<short>& get_terminal_line_starts(char *base_text, short width, short start_index, short end_index)
+{
+	terminal_line_starts& cache = line_starts_cache;
+	font_info *font = GetInterfaceFont(_computer_interface_font);
+	uint16 style = GetInterfaceStyle(_computer_interface_font);
+	if (cache.base_text == base_text && cache.start_index == start_index && cache.end_index == end_index &&
+		cache.width == width && cache.font == font && cache.style == style)
+		return cache.starts;
+
+	cache.base_text = base_text;
+	cache.start_index = start_index;
+	cache.end_index = end_index;
+	cache.width = width;
+	cache.font = font;
+	cache.style = style;
+	cache.starts.clear();
+
+	uint16 old_style = current_style;
+	current_style = style;
+
+	short line_end;
+	cache.starts.push_back(start_index);
+	while (!calculate_line(base_text, width, start_index, end_index, &line_end))
+	{
+		if (line_end > end_index)
+			line_end = end_index;
+		start_index = line_end;
+		cache.starts.push_back(start_index);
+	}
+
+	current_style = old_style;
+	return cache.starts;
+}
+
 /* ------------ code begins */
 
 player_terminal_data *get_player_terminal_data(
@@ -876,30 +945,16 @@ static void _draw_computer_text(
 	current_style = GetInterfaceStyle(_computer_interface_font);
 	// current_style = _get_font_spec(_computer_interface_font)->style;
 
-	start_index= current_group->start_index;
-	end_index= current_group->length+current_group->start_index;
-	
 	/* eat the previous lines */
-	for(index= 0; index<current_line; ++index)
+	const vector<short>& line_starts= get_terminal_line_starts(base_text, RECTANGLE_WIDTH(bounds),
+		current_group->start_index, current_group->start_index+current_group->length);
+	if(current_line<short(line_starts.size()))
 	{
-		/* Calculate one line.. */
-		if(!calculate_line(base_text, RECTANGLE_WIDTH(bounds), start_index, current_group->start_index+current_group->length, 
-			&end_index))
-		{
-			if(end_index>current_group->start_index+current_group->length)
-			{
-				// dprintf("Start: %d Length: %d End: %d;g", current_group->start_index, current_group->length, end_index);
-				// dprintf("Width: %d", RECTANGLE_WIDTH(bounds));
-				end_index= current_group->start_index+current_group->length;
-			}
-			//dprintf("calculate line: %d start: %d end: %d", index, start_index, end_index);
-			assert(end_index<=current_group->start_index+current_group->length);
-			
-			start_index= end_index;
-		} else {
-			/* End of text.. */
-			done= true;
-		}
+		start_index= line_starts[current_line];
+	} else {
+		/* End of text.. */
+		start_index= line_starts.back();
+		done= true;
 	}
 
 	if(!done)
@@ -1166,20 +1221,14 @@ static void display_shape(short shape, Rect* frame)
 	}
 }
 
-extern int get_pict_header_width(LoadedResource &);
-
 static void display_picture(
 	short picture_id,
 	Rect *frame,
 	short flags)
 {
-	LoadedResource PictRsrc;
-	SDL_Surface *s = NULL;
-
-	if (get_picture_resource_from_scenario(picture_id, PictRsrc))
-	{
-		s = picture_to_surface(PictRsrc);
-	}
+	// Kept decoded, as terminals redraw their pictures often
+	int pict_header_width;
+	SDL_Surface *s = get_picture_surface_from_scenario(picture_id, 0, 0, &pict_header_width);
 	if (s)
 	{
 		Rect bounds;
@@ -1189,7 +1238,6 @@ static void display_picture(
 		bounds.right = s->w;
 		bounds.bottom = s->h;
 
-		int pict_header_width = get_pict_header_width(PictRsrc);
 		bool cinemascopeHack = false;
 		if (bounds.right != pict_header_width)
 		{
@@ -1234,7 +1282,7 @@ static void display_picture(
 			SDL_BlitSurface(s, NULL, /*world_pixels*/draw_surface, &r);
 		else {
 			// Rescale picture
-			SDL_Surface *s2 = rescale_surface(s, r.w, r.h);
+			SDL_Surface *s2 = get_picture_surface_from_scenario(picture_id, r.w, r.h);
 			if (s2) {
 				SDL_BlitSurface(s2, NULL, /*world_pixels*/draw_surface, &r);
 				SDL_FreeSurface(s2);
@@ -1324,6 +1372,7 @@ void clear_compiled_terminal_cache()
 {
 	resource_terminal.reset();
 	resource_terminal_id = NONE;
+	forget_terminal_line_starts();
 }
 
 static terminal_text_t* compile_marathon_terminal(char*, short);
@@ -2583,6 +2632,7 @@ void unpack_map_terminal_data(uint8 *p, size_t count)
 {
 	// Clear existing terminals
 	map_terminal_text.clear();
+	forget_terminal_line_starts();
 
 	// Unpack all terminals
 	while (count > 0) {
@@ -109,6 +109,9 @@ void abort_terminal_mode(short player_index);
 
 bool player_in_terminal_mode(short player_index);
 
+// The level the map's first terminal teleport goes to, or NONE
+short first_interlevel_teleport_destination();
+
 // LP: to pack and unpack this data;
 // these hide the unpacked data from the outside world.
 // "Map terminal" means the terminal data read in from the map;
@@ -556,7 +556,7 @@ void parse_mml_interface(const InfoTree& root)
 	
 	root.read_attr("motion_sensor", MotionSensorActive);
 	
-	BOOST_FOREACH(InfoTree rect, root.children_named("rect"))
+	BOOST_FOREACH(const InfoTree &rect, root.children_named("rect"))
 	{
 		int16 index;
 		if (!rect.read_indexed("index", index, NUMBER_OF_INTERFACE_RECTANGLES))
@@ -576,14 +576,14 @@ void parse_mml_interface(const InfoTree& root)
 		}
 	}
 	
-	BOOST_FOREACH(InfoTree color, root.children_named("color"))
+	BOOST_FOREACH(const InfoTree &color, root.children_named("color"))
 	{
 		int16 index;
 		if (!color.read_indexed("index", index, NUMBER_OF_INTERFACE_COLORS))
 			continue;
 		color.read_color(get_interface_color(index));
 	}
-	BOOST_FOREACH(InfoTree font, root.children_named("font"))
+	BOOST_FOREACH(const InfoTree &font, root.children_named("font"))
 	{
 		int16 index;
 		if (!font.read_indexed("index", index, NUMBER_OF_INTERFACE_FONTS))
@@ -591,13 +591,13 @@ void parse_mml_interface(const InfoTree& root)
 		font.read_font(get_interface_font(index));
 	}
 	
-	BOOST_FOREACH(InfoTree vid, root.children_named("vidmaster"))
+	BOOST_FOREACH(const InfoTree &vid, root.children_named("vidmaster"))
 	{
 		vidmasterStringSetID = -1;
 		vid.read_attr_bounded<int16>("stringset_index", vidmasterStringSetID, -1, SHRT_MAX);
 	}
 	
-	BOOST_FOREACH(InfoTree weapon, root.children_named("weapon"))
+	BOOST_FOREACH(const InfoTree &weapon, root.children_named("weapon"))
 	{
 		int16 index;
 		if (!weapon.read_indexed("index", index, MAXIMUM_WEAPON_INTERFACE_DEFINITIONS))
@@ -617,7 +617,7 @@ void parse_mml_interface(const InfoTree& root)
 		weapon.read_attr("multiple_delta_x", def.multiple_delta_x);
 		weapon.read_attr("multiple_delta_y", def.multiple_delta_y);
 		
-		BOOST_FOREACH(InfoTree ammo, weapon.children_named("ammo"))
+		BOOST_FOREACH(const InfoTree &ammo, weapon.children_named("ammo"))
 		{
 			int16 index;
 			if (!ammo.read_indexed("index", index, NUMBER_OF_WEAPON_INTERFACE_ITEMS))
@@ -37,6 +37,8 @@ void update_interface(short time_elapsed);
 void scroll_inventory(short dy);
 
 void OGL_DrawHUD(Rect &dest, short time_elapsed);
+// Lets go of the composed HUD, which is drawn again in full next time
+void OGL_ResetHUDBuffer();
 
 void mark_ammo_display_as_dirty(void);
 void mark_shield_display_as_dirty(void);
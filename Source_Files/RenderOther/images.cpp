@@ -47,6 +47,7 @@ Jul 31, 2002 (Loren Petrich)
 #include "FileHandler.h"
 
 #include <stdlib.h>
+#include <list>
 
 #include "interface.h"
 #include "shell.h"
@@ -111,7 +112,8 @@ static image_file_t SoundsImagesFile;
 
 // Prototypes
 static void shutdown_images_handler(void);
-static void draw_picture(LoadedResource &PictRsrc);
+static void draw_picture_surface(SDL_Surface *s);
+static void forget_cached_pictures(void);
 
 
 #include <SDL_endian.h>
@@ -871,9 +873,116 @@ static void draw_picture_surface(SDL_Surface *s)
 	draw_intro_screen();
 }
 
-static void draw_picture(LoadedResource &rsrc)
+
+/*
+ *  Decoded picture cache
+ */
+
+// Pictures shown lately, decoded and at each size they were drawn at, most
+// recently shown first; a few full-screen pictures' worth
+const size_t MAXIMUM_CACHED_PICTURE_BYTES = 16 * 640 * 480 * 4;
+
+enum {
+	_picture_from_images,
+	_picture_from_scenario
+};
+
+struct cached_picture {
+	int source;
+	int base_resource;
+	int bit_depth;		// the resource for it depends on
+	int width, height;	// scaled to, or 0 for as decoded
+	int header_width;
+	SDL_Surface *surface;
+};
+
+static std::list<cached_picture> picture_cache;
+static size_t picture_cache_bytes = 0;
+
+static void forget_cached_pictures(void)
+{
+	for (std::list<cached_picture>::iterator it = picture_cache.begin(); it != picture_cache.end(); ++it)
+		SDL_FreeSurface(it->surface);
+	picture_cache.clear();
+	picture_cache_bytes = 0;
+}
+
+static SDL_Surface *cached_picture_surface(int source, int base_resource, int width, int height, int *header_width)
+{
+	for (std::list<cached_picture>::iterator it = picture_cache.begin(); it != picture_cache.end(); ++it)
+	{
+		if (it->source == source && it->base_resource == base_resource && it->bit_depth == interface_bit_depth &&
+			it->width == width && it->height == height)
+		{
+			picture_cache.splice(picture_cache.begin(), picture_cache, it);
+			if (header_width)
+				*header_width = it->header_width;
+			it->surface->refcount++;
+			return it->surface;
+		}
+	}
+
+	// A scaled picture is scaled from the cached original
+	SDL_Surface *s = NULL;
+	int original_width = 0;
+	if (width && height)
+	{
+		SDL_Surface *original = cached_picture_surface(source, base_resource, 0, 0, &original_width);
+		if (original)
+		{
+			s = rescale_surface(original, width, height);
+			SDL_FreeSurface(original);
+		}
+	}
+	else
+	{
+		LoadedResource rsrc;
+		bool found = (source == _picture_from_images) ?
+			get_picture_resource_from_images(base_resource, rsrc) :
+			get_picture_resource_from_scenario(base_resource, rsrc);
+		if (found)
+		{
+			s = picture_to_surface(rsrc);
+			original_width = get_pict_header_width(rsrc);
+		}
+	}
+	if (s == NULL)
+		return NULL;
+
+	cached_picture picture;
+	picture.source = source;
+	picture.base_resource = base_resource;
+	picture.bit_depth = interface_bit_depth;
+	picture.width = width;
+	picture.height = height;
+	picture.header_width = original_width;
+	picture.surface = s;
+	picture_cache.push_front(picture);
+	picture_cache_bytes += s->pitch * s->h;
+
+	// The one just added stays, however big
+	while (picture_cache_bytes > MAXIMUM_CACHED_PICTURE_BYTES && picture_cache.size() > 1)
+	{
+		SDL_Surface *oldest = picture_cache.back().surface;
+		picture_cache_bytes -= oldest->pitch * oldest->h;
+		SDL_FreeSurface(oldest);
+		picture_cache.pop_back();
+	}
+
+	if (header_width)
+		*header_width = original_width;
+	s->refcount++;
+	return s;
+}
+
+SDL_Surface *get_picture_surface_from_images(int base_resource)
+{
+	return cached_picture_surface(_picture_from_images, base_resource, 0, 0, NULL);
+}
+
+SDL_Surface *get_picture_surface_from_scenario(int base_resource, int width, int height, int *header_width)
 {
-    draw_picture_surface(picture_to_surface(rsrc));
+	return cached_picture_surface(_picture_from_scenario, base_resource, width, height, header_width);
 }
 
 
@@ -912,10 +1021,7 @@ struct color_table *build_8bit_system_color_table(void)
 
 void scroll_full_screen_pict_resource_from_scenario(int pict_resource_number, bool text_block)
 {
-	// Convert picture resource to surface, free resource
-	LoadedResource rsrc;
-	get_picture_resource_from_scenario(pict_resource_number, rsrc);
-	SDL_Surface *s = picture_to_surface(rsrc);
+	SDL_Surface *s = get_picture_surface_from_scenario(pict_resource_number);
 	if (s == NULL)
 		return;
 
@@ -1087,6 +1193,10 @@ bool image_file_t::open_file(FileSpecifier &file)
 
 void image_file_t::close_file(void)
 {
+	// Which file a picture comes from may change
+	if (is_open())
+		forget_cached_pictures();
+
 	rsrc_file.Close();
 	wad_file.Close();
 }
@@ -1391,9 +1501,12 @@ void draw_full_screen_pict_resource_from_images(int pict_resource_number)
 	if (m1_draw_full_screen_pict_resource_from_images(pict_resource_number))
 		return;
     
-    LoadedResource PictRsrc;
-    if (get_picture_resource_from_images(pict_resource_number, PictRsrc))
-        draw_picture(PictRsrc);
+    SDL_Surface *s = get_picture_surface_from_images(pict_resource_number);
+    if (s)
+    {
+        draw_picture_surface(s);
+        SDL_FreeSurface(s);
+    }
 }
 
 
@@ -1421,9 +1534,12 @@ bool scenario_picture_exists(int base_resource)
 
 void draw_full_screen_pict_resource_from_scenario(int pict_resource_number)
 {
-	LoadedResource PictRsrc;
-	if (get_picture_resource_from_scenario(pict_resource_number, PictRsrc))
-        draw_picture(PictRsrc);
+	SDL_Surface *s = get_picture_surface_from_scenario(pict_resource_number);
+	if (s)
+	{
+		draw_picture_surface(s);
+		SDL_FreeSurface(s);
+	}
 }
 
 
@@ -76,6 +76,13 @@ extern bool get_text_resource_from_scenario(int resource_number, LoadedResource&
 // Convert MacOS PICT resource to SDL surface
 extern SDL_Surface *picture_to_surface(LoadedResource &rsrc);
 
+// A picture from the images or scenario file, decoded (and scaled, given a
+// size) once and kept for the next time it's shown; free it as usual, but
+// leave its pixels alone, as they're shared. The header width is the one in
+// the picture's resource, as get_pict_header_width() gives
+extern SDL_Surface *get_picture_surface_from_images(int base_resource);
+extern SDL_Surface *get_picture_surface_from_scenario(int base_resource, int width = 0, int height = 0, int *header_width = NULL);
+
 // Rescale/tile surface
 extern SDL_Surface *rescale_surface(SDL_Surface *s, int width, int height);
 extern SDL_Surface *tile_surface(SDL_Surface *s, int width, int height);
@@ -56,6 +56,8 @@ Sep 2, 2000 (Loren Petrich):
 #include <string.h>
 #include <stdlib.h>
 
+#include <algorithm>
+
 static short MonsterDisplays[NUMBER_OF_MONSTER_TYPES] =
 {
 	// Marine
@@ -303,11 +305,37 @@ void motion_sensor_scan(void)
 		visible monsters within our range */
 	if ((--ticks_since_last_rescan) < 0)
 	{
-		struct monster_data *monster;
-		short monster_index;
+		static vector<short> nearby_polygons;
+		static vector<short> nearby_monsters;
 		
-		for (monster_index=0,monster=monsters;monster_index<MAXIMUM_MONSTERS_PER_MAP;++monster,++monster_index)
+		/* only monsters in the polygons around us can be in range; they are taken in the
+			order of the full walk, so the same ones find free slots */
+		nearby_monsters.clear();
+		if (find_polygons_near_point((world_point2d *) &owner_object->location, MOTION_SENSOR_RANGE, nearby_polygons))
 		{
+			for (size_t i= 0; i<nearby_polygons.size(); ++i)
+			{
+				short object_index= get_polygon_data(nearby_polygons[i])->first_object;
+				
+				while (object_index!=NONE)
+				{
+					struct object_data *object= get_object_data(object_index);
+					
+					if (GET_OBJECT_OWNER(object)==_object_is_monster) nearby_monsters.push_back(object->permutation);
+					object_index= object->next_object;
+				}
+			}
+			std::sort(nearby_monsters.begin(), nearby_monsters.end());
+		}
+		else
+		{
+			for (short monster_index= 0; monster_index<MAXIMUM_MONSTERS_PER_MAP; ++monster_index) nearby_monsters.push_back(monster_index);
+		}
+		
+		for (size_t i= 0; i<nearby_monsters.size(); ++i)
+		{
+			struct monster_data *monster= monsters+nearby_monsters[i];
+			
 			if (SLOT_IS_USED(monster)&&(MONSTER_IS_PLAYER(monster)||MONSTER_IS_ACTIVE(monster)))
 			{
 				struct object_data *object= get_object_data(monster->object_index);
@@ -357,6 +385,7 @@ void HUD_OGL_Class::render_motion_sensor(short ticks_elapsed)
 	/*if (dynamic_world->player_count > 1)*/
 		draw_network_compass();
 	draw_all_entity_blips();
+	FlushBlips();
 }
 
 void HUD_Lua_Class::render_motion_sensor(short ticks_elapsed)
@@ -574,12 +603,11 @@ void HUD_OGL_Class::draw_entity_blip(point2d *location, shape_descriptor shape)
 	int x = location->x, y = location->y;
 	int c_x = r->left + (motion_sensor_side_length >> 1);
 	int c_y = r->top + (motion_sensor_side_length >> 1);
-	SetClipPlane(x, y, c_x, c_y, motion_sensor_side_length >> 1);
-	DrawShapeAtXY(shape,
+	QueueBlip(shape,
 		x + c_x - (blip->width >> 1),
 		y + c_y - (blip->height >> 1),
-		true);
-	DisableClipPlane();
+		blip->width, blip->height,
+		x, y, c_x, c_y, motion_sensor_side_length >> 1);
 }
 
 /* if we find an entity that is being removed, we continue with the removal process and ignore
@@ -867,7 +895,7 @@ void parse_mml_motion_sensor(const InfoTree& root)
 	root.read_attr("update_frequency", MOTION_SENSOR_UPDATE_FREQUENCY);
 	root.read_attr("rescan_frequency", MOTION_SENSOR_RESCAN_FREQUENCY);
 	
-	BOOST_FOREACH(InfoTree assign, root.children_named("assign"))
+	BOOST_FOREACH(const InfoTree &assign, root.children_named("assign"))
 	{
 		int16 index;
 		if (!assign.read_indexed("monster", index, NUMBER_OF_MONSTER_TYPES))
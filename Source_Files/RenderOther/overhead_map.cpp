@@ -339,6 +339,13 @@ void _render_overhead_map(
 	OvhdMapPtr->Render(*data);
 }
 
+#ifdef HAVE_OPENGL
+void OGL_ResetMapBuffers()
+{
+	OverheadMap_OGL.ResetBuffers();
+}
+#endif
+
 
 void ResetOverheadMap()
 {
@@ -387,7 +394,7 @@ void parse_mml_overhead_map(const InfoTree& root)
 	root.read_indexed("mode", OverheadMapMode, NUMBER_OF_OVERHEAD_MAP_MODES);
 	root.read_attr("title_offset", OvhdMap_ConfigData.map_name_data.offset_down);
 
-	BOOST_FOREACH(InfoTree assign, root.children_named("assign_live"))
+	BOOST_FOREACH(const InfoTree &assign, root.children_named("assign_live"))
 	{
 		int16 monster;
 		if (!assign.read_indexed("monster", monster, NUMBER_OF_MONSTER_TYPES))
@@ -395,7 +402,7 @@ void parse_mml_overhead_map(const InfoTree& root)
 		assign.read_attr_bounded<int16>("type", OvhdMap_ConfigData.monster_displays[monster], -1, 1);
 	}
 	
-	BOOST_FOREACH(InfoTree assign, root.children_named("assign_dead"))
+	BOOST_FOREACH(const InfoTree &assign, root.children_named("assign_dead"))
 	{
 		int16 coll;
 		if (!assign.read_indexed("coll", coll, NUMBER_OF_COLLECTIONS))
@@ -403,24 +410,24 @@ void parse_mml_overhead_map(const InfoTree& root)
 		assign.read_attr_bounded<int16>("type", OvhdMap_ConfigData.dead_monster_displays[coll], -1, 1);
 	}
 	
-	BOOST_FOREACH(InfoTree child, root.children_named("aliens"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("aliens"))
 	{
 		child.read_attr("on", OvhdMap_ConfigData.ShowAliens);
 	}
-	BOOST_FOREACH(InfoTree child, root.children_named("items"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("items"))
 	{
 		child.read_attr("on", OvhdMap_ConfigData.ShowItems);
 	}
-	BOOST_FOREACH(InfoTree child, root.children_named("projectiles"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("projectiles"))
 	{
 		child.read_attr("on", OvhdMap_ConfigData.ShowProjectiles);
 	}
-	BOOST_FOREACH(InfoTree child, root.children_named("paths"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("paths"))
 	{
 		child.read_attr("on", OvhdMap_ConfigData.ShowPaths);
 	}
 
-	BOOST_FOREACH(InfoTree line, root.children_named("line_width"))
+	BOOST_FOREACH(const InfoTree &line, root.children_named("line_width"))
 	{
 		int16 index;
 		if (!line.read_indexed("index", index, NUMBER_OF_LINE_DEFINITIONS))
@@ -433,7 +440,7 @@ void parse_mml_overhead_map(const InfoTree& root)
 		line.read_attr("width", OvhdMap_ConfigData.line_definitions[index].pen_sizes[scale]);
 	}
 
-	BOOST_FOREACH(InfoTree color, root.children_named("color"))
+	BOOST_FOREACH(const InfoTree &color, root.children_named("color"))
 	{
 		int16 index;
 		if (!color.read_indexed("index", index, TOTAL_NUMBER_OF_COLORS))
@@ -490,7 +497,7 @@ void parse_mml_overhead_map(const InfoTree& root)
 		index -= NUMBER_OF_POLYGON_COLORS;
 	}
 	
-	BOOST_FOREACH(InfoTree font, root.children_named("font"))
+	BOOST_FOREACH(const InfoTree &font, root.children_named("font"))
 	{
 		int16 index;
 		if (!font.read_indexed("index", index, TOTAL_NUMBER_OF_FONTS))
@@ -54,6 +54,11 @@ struct overhead_map_data
 
 void _render_overhead_map(struct overhead_map_data *data);
 
+#ifdef HAVE_OPENGL
+// Call before the OpenGL context goes away
+void OGL_ResetMapBuffers();
+#endif
+
 class InfoTree;
 void parse_mml_overhead_map(const InfoTree& root);
 void reset_mml_overhead_map();
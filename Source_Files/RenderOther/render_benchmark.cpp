@@ -0,0 +1,366 @@
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  Renderer benchmark
+
+ */
+
+#include "render_benchmark.h"
+
+#include "FileHandler.h"
+#include "FrameProfiler.h"
+#include "Logging.h"
+#include "game_window.h"
+#include "interface.h"
+#include "map.h"
+#include "player.h"
+#include "preferences.h"
+#include "screen.h"
+#include "shell.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+struct camera_stop
+{
+	world_point3d position;
+	short polygon_index;
+	angle facing;
+};
+
+static const struct
+{
+	uint16 flag;
+	short acceleration;
+	const char *name;
+} renderer_list[] = {
+	{ _render_benchmark_software, _no_acceleration, "software" },
+	{ _render_benchmark_opengl, _opengl_acceleration, "opengl" },
+	{ _render_benchmark_shader, _shader_acceleration, "shader" }
+};
+static const int NUMBER_OF_RENDERERS = sizeof(renderer_list) / sizeof(renderer_list[0]);
+
+static bool camera_active = false;
+static camera_stop camera;
+
+/* ---------- parameters */
+
+static bool parse_renderers(const char *names, size_t length, uint16& renderers)
+{
+	renderers = 0;
+	while (length > 0)
+	{
+		const char *plus = static_cast<const char *>(memchr(names, '+', length));
+		size_t name_length = plus ? plus - names : length;
+
+		int r;
+		for (r = 0; r < NUMBER_OF_RENDERERS; ++r)
+		{
+			if (strlen(renderer_list[r].name) == name_length && strncmp(renderer_list[r].name, names, name_length) == 0)
+				break;
+		}
+		if (r == NUMBER_OF_RENDERERS)
+			return false;
+		renderers |= renderer_list[r].flag;
+
+		if (!plus)
+			break;
+		length -= name_length + 1;
+		names = plus + 1;
+	}
+	return renderers != 0;
+}
+
+static bool parse_parameter(const char *key, size_t key_length, int value, render_benchmark_parameters& parameters)
+{
+	struct { const char *name; int16 *value16; int32 *value32; int minimum, maximum; } fields[] = {
+		{ "level", &parameters.level, NULL, 0, INT16_MAX },
+		{ "width", &parameters.width, NULL, 640, INT16_MAX },
+		{ "height", &parameters.height, NULL, 480, INT16_MAX },
+		{ "stops", &parameters.stop_count, NULL, 1, INT16_MAX },
+		{ "frames", NULL, &parameters.frame_count, 1, INT32_MAX },
+		{ "warmup", NULL, &parameters.warmup_count, 0, INT32_MAX }
+	};
+
+	for (size_t i = 0; i < sizeof(fields)/sizeof(fields[0]); ++i)
+	{
+		if (strlen(fields[i].name) != key_length || strncmp(fields[i].name, key, key_length) != 0)
+			continue;
+
+		value = PIN(value, fields[i].minimum, fields[i].maximum);
+		if (fields[i].value16)
+			*fields[i].value16 = static_cast<int16>(value);
+		else
+			*fields[i].value32 = value;
+		return true;
+	}
+	return false;
+}
+
+bool parse_render_benchmark_parameters(const char *spec, render_benchmark_parameters& parameters)
+{
+	if (strcmp(spec, "default") == 0)
+		return true;
+
+	while (*spec)
+	{
+		const char *equals = strchr(spec, '=');
+		if (!equals)
+			return false;
+
+		const char *end = strchr(equals + 1, ',');
+		if (!end)
+			end = equals + strlen(equals);
+
+		if (equals - spec == 9 && strncmp(spec, "renderers", 9) == 0)
+		{
+			if (!parse_renderers(equals + 1, end - (equals + 1), parameters.renderers))
+				return false;
+		}
+		else
+		{
+			char *number_end;
+			long value = strtol(equals + 1, &number_end, 10);
+			if (number_end == equals + 1 || number_end != end)
+				return false;
+			if (!parse_parameter(spec, equals - spec, static_cast<int>(PIN(value, 0L, long(INT32_MAX))), parameters))
+				return false;
+		}
+
+		spec = *end ? end + 1 : end;
+	}
+	return true;
+}
+
+/* ---------- camera path */
+
+bool RenderBenchmark_GetPosition(world_point3d &position,
+	short &polygon_index, angle &yaw, angle &pitch)
+{
+	if (!camera_active) return false;
+
+	position = camera.position;
+	polygon_index = camera.polygon_index;
+	yaw = camera.facing;
+	pitch = 0;
+	return true;
+}
+
+// The player's start, then polygons evenly through the map that there is
+// room to stand in, each at about eye height
+static void build_camera_path(short stop_count, std::vector<camera_stop>& stops)
+{
+	stops.clear();
+
+	camera_stop start;
+	start.position = current_player->camera_location;
+	start.polygon_index = current_player->camera_polygon_index;
+	start.facing = current_player->facing;
+	stops.push_back(start);
+
+	std::vector<short> candidates;
+	for (short i = 0; i < dynamic_world->polygon_count; ++i)
+	{
+		polygon_data *polygon = get_polygon_data(i);
+		if (i != start.polygon_index && polygon->ceiling_height - polygon->floor_height > WORLD_ONE / 2)
+			candidates.push_back(i);
+	}
+
+	for (short k = 1; k < stop_count && !candidates.empty(); ++k)
+	{
+		short polygon_index = candidates[(k - 1) * candidates.size() / (stop_count - 1)];
+		polygon_data *polygon = get_polygon_data(polygon_index);
+
+		camera_stop stop;
+		stop.position.x = polygon->center.x;
+		stop.position.y = polygon->center.y;
+		stop.position.z = MIN(polygon->floor_height + (WORLD_ONE * 2) / 3, polygon->ceiling_height - WORLD_ONE / 16);
+		stop.polygon_index = polygon_index;
+		stop.facing = NORMALIZE_ANGLE(start.facing + k * (FULL_CIRCLE / 8));
+		stops.push_back(stop);
+	}
+}
+
+// Frame number along the path: an equal share of the frames at each stop,
+// turning all the way around
+static void set_camera(const std::vector<camera_stop>& stops, int32 frame, int32 frame_count)
+{
+	int32 per_stop = MAX(frame_count / static_cast<int32>(stops.size()), 1);
+	size_t s = MIN(static_cast<size_t>(frame / per_stop), stops.size() - 1);
+	int32 turned = frame - static_cast<int32>(s) * per_stop;
+
+	camera = stops[s];
+	camera.facing = NORMALIZE_ANGLE(stops[s].facing + static_cast<angle>((static_cast<int64_t>(turned) * FULL_CIRCLE) / per_stop));
+	camera_active = true;
+}
+
+/* ---------- running */
+
+// Switches renderer as a level start does, through the game screen;
+// the mode may come back with another one, if this one can't be had
+static bool use_renderer(short acceleration, short width, short height)
+{
+	exit_screen();
+
+	screen_mode_data mode = graphics_preferences->screen_mode;
+	mode.acceleration = acceleration;
+	mode.width = width;
+	mode.height = height;
+	mode.auto_resolution = false;
+	mode.fullscreen = false;
+	mode.high_dpi = false;
+	graphics_preferences->screen_mode = mode;
+	change_screen_mode(&mode, false);
+
+	enter_screen();
+	validate_world_window();
+	draw_interface();
+
+	return get_screen_mode()->acceleration == acceleration;
+}
+
+static FileSpecifier report_file(const std::string& name)
+{
+	FileSpecifier fs;
+	fs.SetToLocalDataDir();
+	fs += name;
+	return fs;
+}
+
+static void write_summary_header(FILE *summary)
+{
+	fprintf(summary, "renderer,width,height,frames");
+	for (int s = 0; s < FrameProfiler::NUMBER_OF_SECTIONS; s++)
+		fprintf(summary, ",cpu_%s", FrameProfiler::SectionName(s));
+	for (int s = 0; s < FrameProfiler::NUMBER_OF_SECTIONS; s++)
+		fprintf(summary, ",gpu_%s", FrameProfiler::SectionName(s));
+	fprintf(summary, ",draw_calls,texture_binds\n");
+}
+
+static void write_summary(FILE *summary, const char *name, short width, short height, const FrameProfiler::Totals& totals)
+{
+	fprintf(summary, "%s,%d,%d,%u", name, width, height, totals.frames);
+	for (int s = 0; s < FrameProfiler::NUMBER_OF_SECTIONS; s++)
+	{
+		if (totals.cpu_frames[s])
+			fprintf(summary, ",%.3f", totals.cpu[s] / totals.cpu_frames[s]);
+		else
+			fprintf(summary, ",");
+	}
+	for (int s = 0; s < FrameProfiler::NUMBER_OF_SECTIONS; s++)
+	{
+		if (totals.gpu_frames[s])
+			fprintf(summary, ",%.3f", totals.gpu[s] / totals.gpu_frames[s]);
+		else
+			fprintf(summary, ",");
+	}
+	uint32 frames = MAX(totals.frames, 1U);
+	fprintf(summary, ",%.1f,%.1f\n", double(totals.draw_calls) / frames, double(totals.texture_binds) / frames);
+
+	char report[256];
+	snprintf(report, sizeof(report), "renderbench %s %dx%d: %u frames, %.3f ms (cpu) / %.3f ms (gpu) a frame, %.1f draw calls, %.1f texture binds",
+		name, width, height, totals.frames,
+		totals.cpu_frames[FrameProfiler::FRAME] ? totals.cpu[FrameProfiler::FRAME] / totals.cpu_frames[FrameProfiler::FRAME] : 0.0,
+		totals.gpu_frames[FrameProfiler::FRAME] ? totals.gpu[FrameProfiler::FRAME] / totals.gpu_frames[FrameProfiler::FRAME] : 0.0,
+		double(totals.draw_calls) / frames, double(totals.texture_binds) / frames);
+	logNote("%s", report);
+	printf("%s\n", report);
+}
+
+bool run_render_benchmark(const render_benchmark_parameters& parameters)
+{
+	if (!start_benchmark_game(parameters.level))
+	{
+		logError("renderbench: could not start level %d", parameters.level);
+		return false;
+	}
+
+	std::vector<camera_stop> stops;
+	build_camera_path(parameters.stop_count, stops);
+
+	FileSpecifier summary_file = report_file("renderbench.csv");
+	FILE *summary = fopen(summary_file.GetPath(), "w");
+	if (!summary)
+	{
+		logError("renderbench: could not open %s", summary_file.GetPath());
+		return false;
+	}
+	write_summary_header(summary);
+
+	screen_mode_data saved_mode = graphics_preferences->screen_mode;
+	FrameProfiler *profiler = FrameProfiler::instance();
+	int run_count = 0;
+
+	for (int r = 0; r < NUMBER_OF_RENDERERS; ++r)
+	{
+		if (!(parameters.renderers & renderer_list[r].flag))
+			continue;
+
+#ifndef HAVE_OPENGL
+		if (renderer_list[r].acceleration != _no_acceleration)
+		{
+			logNote("renderbench: %s is not available", renderer_list[r].name);
+			continue;
+		}
+#endif
+		if (!use_renderer(renderer_list[r].acceleration, parameters.width, parameters.height))
+		{
+			logNote("renderbench: %s is not available", renderer_list[r].name);
+			continue;
+		}
+
+		// Textures and models load as they first come into view
+		for (int32 w = 0; w < parameters.warmup_count; ++w)
+		{
+			set_camera(stops, static_cast<int32>((static_cast<int64_t>(w) * parameters.frame_count) / parameters.warmup_count), parameters.frame_count);
+			SDL_PumpEvents();
+			render_screen(0);
+		}
+
+		FileSpecifier frames_file = report_file(std::string("renderbench_") + renderer_list[r].name + ".csv");
+		if (!profiler->StartCSV(frames_file.GetPath()))
+		{
+			logError("renderbench: could not open %s", frames_file.GetPath());
+			continue;
+		}
+		profiler->ClearTotals();
+
+		for (int32 f = 0; f < parameters.frame_count; ++f)
+		{
+			set_camera(stops, f, parameters.frame_count);
+			SDL_PumpEvents();
+			render_screen(0);
+		}
+
+		// Reads back what the GPU still has, while its context is there
+		profiler->StopCSV();
+		write_summary(summary, renderer_list[r].name, parameters.width, parameters.height, profiler->GetTotals());
+		++run_count;
+	}
+
+	camera_active = false;
+	fclose(summary);
+
+	graphics_preferences->screen_mode = saved_mode;
+	if (run_count == 0)
+		logError("renderbench: none of the renderers could be run");
+	return run_count > 0;
+}
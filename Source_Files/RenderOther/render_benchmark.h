@@ -0,0 +1,69 @@
+#ifndef __RENDER_BENCHMARK_H
+#define __RENDER_BENCHMARK_H
+
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  Renderer benchmark: starts a level of the current map, and with the world
+  standing still, moves the view along a camera path made from the map (a
+  full turn at each of a number of polygons, chosen evenly through it) and
+  draws it with each renderer in turn at a fixed resolution; each frame's
+  passes, draw calls and texture bindings go to a CSV file per renderer,
+  and their averages to a summary
+
+ */
+
+#include "cseries.h"
+#include "world.h"
+
+enum // renderers to run, as bits
+{
+	_render_benchmark_software = 0x0001,
+	_render_benchmark_opengl = 0x0002,
+	_render_benchmark_shader = 0x0004
+};
+
+struct render_benchmark_parameters
+{
+	int16 level;
+	int16 width, height;
+	int16 stop_count; // polygons the camera turns around in
+	int32 frame_count; // per renderer, along the whole path
+	int32 warmup_count; // frames drawn first, spread over the path, untimed
+	uint16 renderers;
+
+	render_benchmark_parameters() :
+		level(0), width(1280), height(720), stop_count(8), frame_count(960), warmup_count(64),
+		renderers(_render_benchmark_software | _render_benchmark_opengl | _render_benchmark_shader) { }
+};
+
+// Reads "key=value,key=value..." (level, width, height, stops, frames,
+// warmup, and renderers as names joined with '+': software, opengl, shader)
+// over the defaults; "default" keeps them
+bool parse_render_benchmark_parameters(const char *spec, render_benchmark_parameters& parameters);
+
+// Call once the application is initialized; leaves the level running, writes
+// renderbench.csv and renderbench_<renderer>.csv to the local data directory,
+// and returns whether any renderer could be run
+bool run_render_benchmark(const render_benchmark_parameters& parameters);
+
+// While the benchmark runs, where the view is; like ChaseCam_GetPosition()
+bool RenderBenchmark_GetPosition(world_point3d &position,
+	short &polygon_index, angle &yaw, angle &pitch);
+
+#endif
@@ -68,9 +68,20 @@
 #include "lua_hud_script.h"
 #include "HUDRenderer_Lua.h"
 #include "Movie.h"
+#include "FrameProfiler.h"
+#include "render_benchmark.h"
+#include "Trace.h"
 
 #include <algorithm>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SCREEN_SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SCREEN_SIMD_NEON
+#endif
+
 #if defined(__WIN32__) || (defined(__MACH__) && defined(__APPLE__))
 #define MUST_RELOAD_VIEW_CONTEXT
 #endif
@@ -138,6 +149,7 @@ static void apply_gamma(SDL_Surface *src, SDL_Surface *dst);
 static void update_screen(SDL_Rect &source, SDL_Rect &destination, bool hi_rez);
 static void update_fps_display(SDL_Surface *s);
 static void DisplayPosition(SDL_Surface *s);
+static void DisplayProfile(SDL_Surface *s);
 static void DisplayMessages(SDL_Surface *s);
 static void DisplayNetMicStatus(SDL_Surface *s);
 static void DrawSurface(SDL_Surface *s, SDL_Rect &dest_rect, SDL_Rect &src_rect);
@@ -1205,11 +1217,27 @@ static bool clear_next_screen = false;
 
 void render_screen(short ticks_elapsed)
 {
+	TRACE_SPAN("render_screen");
+	FrameProfiler::instance()->BeginFrame();
+
 	// Make whatever changes are necessary to the world_view structure based on whichever player is frontmost
 	world_view->ticks_elapsed = ticks_elapsed;
 	world_view->tick_count = dynamic_world->tick_count;
 	world_view->yaw = current_player->facing;
 	world_view->pitch = current_player->elevation;
+
+	// mouse motion the ticks haven't taken yet turns the view now
+	short delta_yaw, delta_pitch;
+	if (mouse_view_delta(&delta_yaw, &delta_pitch) && (delta_yaw || delta_pitch))
+	{
+		_fixed minimum_pitch, maximum_pitch;
+		get_absolute_pitch_range(&minimum_pitch, &maximum_pitch);
+		short pitch = world_view->pitch > HALF_CIRCLE ? world_view->pitch - FULL_CIRCLE : world_view->pitch;
+		pitch = PIN(pitch + delta_pitch, FIXED_INTEGERAL_PART(minimum_pitch), FIXED_INTEGERAL_PART(maximum_pitch));
+
+		world_view->yaw = NORMALIZE_ANGLE(world_view->yaw + delta_yaw);
+		world_view->pitch = NORMALIZE_ANGLE(pitch);
+	}
 	world_view->maximum_depth_intensity = current_player->weapon_intensity;
 	world_view->shading_mode = current_player->infravision_duration ? _shading_infravision : _shading_normal;
 
@@ -1368,6 +1396,10 @@ void render_screen(short ticks_elapsed)
 	if (!UseLuaCameras())
 		world_view->show_weapons_in_hand = !ChaseCam_GetPosition(world_view->origin, world_view->origin_polygon_index, world_view->yaw, world_view->pitch);
 
+	// A renderer benchmark's camera path
+	if (RenderBenchmark_GetPosition(world_view->origin, world_view->origin_polygon_index, world_view->yaw, world_view->pitch))
+		world_view->show_weapons_in_hand = false;
+
 #ifdef HAVE_OPENGL
 	// Is map to be drawn with OpenGL?
 	if (OGL_IsActive() && world_view->overhead_map_active)
@@ -1417,6 +1449,7 @@ void render_screen(short ticks_elapsed)
 		update_fps_display(disp_pixels);
 	  }
 	  DisplayPosition(disp_pixels);
+	  DisplayProfile(disp_pixels);
 	  DisplayNetMicStatus(disp_pixels);
 	  DisplayScores(disp_pixels);
 	}
@@ -1435,12 +1468,14 @@ void render_screen(short ticks_elapsed)
 	if (screen_mode.acceleration != _no_acceleration) {
 #ifdef HAVE_OPENGL
 		if (Screen::instance()->hud()) {
+			FrameProfiler::instance()->Begin(FrameProfiler::HUD);
 			if (Screen::instance()->lua_hud())
 				Lua_DrawHUD(ticks_elapsed);
 			else {
 				Rect dr = MakeRect(HUD_DestRect);
 				OGL_DrawHUD(dr, ticks_elapsed);
 			}
+			FrameProfiler::instance()->End(FrameProfiler::HUD);
 		}
 		
 		if (world_view->terminal_mode_active) {
@@ -1468,6 +1503,7 @@ void render_screen(short ticks_elapsed)
 		}
 		
 		// Update HUD
+		FrameProfiler::instance()->Begin(FrameProfiler::HUD);
 		if (Screen::instance()->lua_hud())
 		{
 			Lua_DrawHUD(ticks_elapsed);
@@ -1477,6 +1513,7 @@ void render_screen(short ticks_elapsed)
 			DrawSurface(HUD_Buffer, HUD_DestRect, src_rect);
 			HUD_RenderRequest = false;
 		}
+		FrameProfiler::instance()->End(FrameProfiler::HUD);
 
 		// Update terminal
 		if (world_view->terminal_mode_active) {
@@ -1498,6 +1535,8 @@ void render_screen(short ticks_elapsed)
 		}
 	}
 
+	FrameProfiler::instance()->EndFrame();
+
 #ifdef HAVE_OPENGL
 	// Swap OpenGL double-buffers
 	if (screen_mode.acceleration != _no_acceleration)
@@ -1511,6 +1550,80 @@ void render_screen(short ticks_elapsed)
  *  Blit world view to screen
  */
 
+static inline bool screen_simd_available()
+{
+#if defined(SCREEN_SIMD_SSE2)
+	static const bool available = SDL_HasSSE2();
+	return available;
+#elif defined(SCREEN_SIMD_NEON) && SDL_VERSION_ATLEAST(2,0,6)
+	static const bool available = SDL_HasNEON();
+	return available;
+#elif defined(SCREEN_SIMD_NEON)
+	return true;
+#else
+	return false;
+#endif
+}
+
+// These double whole vectors' worth of a row into the two rows below,
+// returning how many source pixels they did; the rest is left to the
+// ordinary loop
+template <class T>
+static inline int quadruple_row_vector(const T *src, T *dst, T *dst2, int width)
+{
+	return 0;
+}
+
+#if defined(SCREEN_SIMD_SSE2) || defined(SCREEN_SIMD_NEON)
+static inline int quadruple_row_vector(const pixel32 *src, pixel32 *dst, pixel32 *dst2, int width)
+{
+	int x = 0;
+	for (; x + 4 <= width; x += 4) {
+#if defined(SCREEN_SIMD_SSE2)
+		__m128i p = _mm_loadu_si128((const __m128i *) (src + x));
+		__m128i lo = _mm_unpacklo_epi32(p, p);
+		__m128i hi = _mm_unpackhi_epi32(p, p);
+		_mm_storeu_si128((__m128i *) (dst + x * 2), lo);
+		_mm_storeu_si128((__m128i *) (dst + x * 2 + 4), hi);
+		_mm_storeu_si128((__m128i *) (dst2 + x * 2), lo);
+		_mm_storeu_si128((__m128i *) (dst2 + x * 2 + 4), hi);
+#else
+		uint32x4_t p = vld1q_u32(src + x);
+		uint32x4x2_t d = vzipq_u32(p, p);
+		vst1q_u32(dst + x * 2, d.val[0]);
+		vst1q_u32(dst + x * 2 + 4, d.val[1]);
+		vst1q_u32(dst2 + x * 2, d.val[0]);
+		vst1q_u32(dst2 + x * 2 + 4, d.val[1]);
+#endif
+	}
+	return x;
+}
+
+static inline int quadruple_row_vector(const pixel16 *src, pixel16 *dst, pixel16 *dst2, int width)
+{
+	int x = 0;
+	for (; x + 8 <= width; x += 8) {
+#if defined(SCREEN_SIMD_SSE2)
+		__m128i p = _mm_loadu_si128((const __m128i *) (src + x));
+		__m128i lo = _mm_unpacklo_epi16(p, p);
+		__m128i hi = _mm_unpackhi_epi16(p, p);
+		_mm_storeu_si128((__m128i *) (dst + x * 2), lo);
+		_mm_storeu_si128((__m128i *) (dst + x * 2 + 8), hi);
+		_mm_storeu_si128((__m128i *) (dst2 + x * 2), lo);
+		_mm_storeu_si128((__m128i *) (dst2 + x * 2 + 8), hi);
+#else
+		uint16x8_t p = vld1q_u16(src + x);
+		uint16x8x2_t d = vzipq_u16(p, p);
+		vst1q_u16(dst + x * 2, d.val[0]);
+		vst1q_u16(dst + x * 2 + 8, d.val[1]);
+		vst1q_u16(dst2 + x * 2, d.val[0]);
+		vst1q_u16(dst2 + x * 2 + 8, d.val[1]);
+#endif
+	}
+	return x;
+}
+#endif
+
 template <class T>
 static inline void quadruple_surface(const T *src, int src_pitch, T *dst, int dst_pitch, const SDL_Rect &dst_rect)
 {
@@ -1518,9 +1631,11 @@ static inline void quadruple_surface(const T *src, int src_pitch, T *dst, int ds
 	int height = dst_rect.h / 2;
 	dst += dst_rect.y * dst_pitch / sizeof(T) + dst_rect.x;
 	T *dst2 = dst + dst_pitch / sizeof(T);
+	bool vector = screen_simd_available();
 
 	while (height-- > 0) {
-		for (int x=0; x<width; x++) {
+		int x = vector ? quadruple_row_vector(src, dst, dst2, width) : 0;
+		for (; x<width; x++) {
 			T p = src[x];
 			dst[x * 2] = dst[x * 2 + 1] = p;
 			dst2[x * 2] = dst2[x * 2 + 1] = p;
@@ -1531,60 +1646,158 @@ static inline void quadruple_surface(const T *src, int src_pitch, T *dst, int ds
 	}
 }
 
-static void apply_gamma(SDL_Surface *src, SDL_Surface *dst)
+// Each source channel's value, as the corrected destination bits;
+// and when both surfaces keep each channel in a whole byte at the same place,
+// each byte's value as the corrected byte
+struct gamma_tables
 {
-	if (SDL_MUSTLOCK(dst)) {
-	    if (SDL_LockSurface(dst) < 0) return;
+	uint32 r[256], g[256], b[256];
+	uint8 bytes[4][256];
+	bool byte_channels;
+};
+
+// Bumped whenever current_gamma_* change, so the tables are built once per step of a fade
+static uint32 gamma_generation = 0;
+
+static bool has_byte_channels(const SDL_PixelFormat *f)
+{
+	return f->BytesPerPixel == 4 &&
+		f->Rloss == 0 && f->Gloss == 0 && f->Bloss == 0 &&
+		f->Rshift % 8 == 0 && f->Gshift % 8 == 0 && f->Bshift % 8 == 0;
+}
+
+#if defined(SCREEN_SIMD_NEON) && defined(__aarch64__) && SDL_BYTEORDER == SDL_LIL_ENDIAN
+// 256 bytes of table is four of what one lookup instruction covers; each index
+// outside a quarter's 64 comes back 0, so the four quarters' results can be or'd
+static inline uint8x16_t lookup_bytes_vector(const uint8 *table, uint8x16_t i)
+{
+	uint8x16_t r = vdupq_n_u8(0);
+	for (int q = 0; q < 4; ++q) {
+		uint8x16x4_t t;
+		t.val[0] = vld1q_u8(table + q * 64);
+		t.val[1] = vld1q_u8(table + q * 64 + 16);
+		t.val[2] = vld1q_u8(table + q * 64 + 32);
+		t.val[3] = vld1q_u8(table + q * 64 + 48);
+		r = vorrq_u8(r, vqtbl4q_u8(t, vsubq_u8(i, vdupq_n_u8(q * 64))));
 	}
-	uint32 px, dst_px;
-	uint8 src_r, src_g, src_b;
-	uint8 dst_r, dst_g, dst_b;
-	
+	return r;
+}
+
+// Does whole vectors' worth of a row, returning how many pixels it did
+static inline int apply_gamma_bytes_vector(const uint32 *src, uint32 *dst, int width, const gamma_tables& t, const bool *used)
+{
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		uint8x16x4_t p = vld4q_u8(reinterpret_cast<const uint8 *>(src + x));
+		uint8x16x4_t d;
+		for (int k = 0; k < 4; ++k)
+			d.val[k] = used[k] ? lookup_bytes_vector(t.bytes[k], p.val[k]) : vdupq_n_u8(0);
+		vst4q_u8(reinterpret_cast<uint8 *>(dst + x), d);
+	}
+	return x;
+}
+#define SCREEN_GAMMA_BYTES_VECTOR
+#endif
+
+static void apply_gamma_bytes(SDL_Surface *src, SDL_Surface *dst, const gamma_tables& t)
+{
+	bool used[4] = { false, false, false, false };
+	used[src->format->Rshift / 8] = used[src->format->Gshift / 8] = used[src->format->Bshift / 8] = true;
+#ifdef SCREEN_GAMMA_BYTES_VECTOR
+	bool vector = screen_simd_available();
+#endif
+
+	int width = std::min(src->w, dst->w);
+	int height = std::min(src->h, dst->h);
+	for (int y = 0; y < height; ++y) {
+		const uint32 *sptr = reinterpret_cast<const uint32 *>(static_cast<uint8 *>(src->pixels) + y * src->pitch);
+		uint32 *dptr = reinterpret_cast<uint32 *>(static_cast<uint8 *>(dst->pixels) + y * dst->pitch);
+		int x = 0;
+#ifdef SCREEN_GAMMA_BYTES_VECTOR
+		if (vector)
+			x = apply_gamma_bytes_vector(sptr, dptr, width, t, used);
+#endif
+		for (; x < width; ++x) {
+			uint32 px = sptr[x];
+			dptr[x] = t.bytes[0][px & 0xff] | (t.bytes[1][(px >> 8) & 0xff] << 8) |
+				(t.bytes[2][(px >> 16) & 0xff] << 16) | (uint32(t.bytes[3][px >> 24]) << 24);
+		}
+	}
+}
+
+template <class S, class D>
+static void apply_gamma_rows(SDL_Surface *src, SDL_Surface *dst, const gamma_tables& t)
+{
 	uint32 srm = src->format->Rmask, sgm = src->format->Gmask, sbm = src->format->Bmask;
-	uint32 drm = dst->format->Rmask, dgm = dst->format->Gmask, dbm = dst->format->Bmask;
 	uint32 srs = src->format->Rshift, sgs = src->format->Gshift, sbs = src->format->Bshift;
-	uint32 drs = dst->format->Rshift, dgs = dst->format->Gshift, dbs = dst->format->Bshift;
-	uint32 srl = src->format->Rloss, sgl = src->format->Gloss, sbl = src->format->Bloss;
-	uint32 drl = dst->format->Rloss, dgl = dst->format->Gloss, dbl = dst->format->Bloss;
-	
+
+	int width = std::min(src->w, dst->w);
+	int height = std::min(src->h, dst->h);
+	for (int y = 0; y < height; ++y) {
+		const S *sptr = reinterpret_cast<const S *>(static_cast<uint8 *>(src->pixels) + y * src->pitch);
+		D *dptr = reinterpret_cast<D *>(static_cast<uint8 *>(dst->pixels) + y * dst->pitch);
+		for (int x = 0; x < width; ++x) {
+			uint32 px = sptr[x];
+			dptr[x] = t.r[((px & srm) >> srs) & 0xff] | t.g[((px & sgm) >> sgs) & 0xff] | t.b[((px & sbm) >> sbs) & 0xff];
+		}
+	}
+}
+
+static void apply_gamma(SDL_Surface *src, SDL_Surface *dst)
+{
 	int sbpp = src->format->BytesPerPixel;
 	int dbpp = dst->format->BytesPerPixel;
-	uint8 *sptr = static_cast<uint8*>(src->pixels);
-	uint8 *dptr = static_cast<uint8*>(dst->pixels);
-	size_t numpixels = src->w * src->h;
-	for (size_t i = 0; i < numpixels; ++i) {
-		switch (sbpp) {
-			case 2:
-				px = reinterpret_cast<uint16*>(sptr)[i];
-				break;
-			case 4:
-				px = reinterpret_cast<uint32*>(sptr)[i];
-				break;
-			default:
-				return;
-		}
+	if ((sbpp != 2 && sbpp != 4) || (dbpp != 2 && dbpp != 4))
+		return;
+
+	if (SDL_MUSTLOCK(dst)) {
+	    if (SDL_LockSurface(dst) < 0) return;
+	}
 	
-		src_r = ((px & srm) >> srs) << srl;
-		src_g = ((px & sgm) >> sgs) << sgl;
-		src_b = ((px & sbm) >> sbs) << sbl;
-		dst_r = current_gamma_r[src_r] >> 8;
-		dst_g = current_gamma_g[src_g] >> 8;
-		dst_b = current_gamma_b[src_b] >> 8;
-		dst_px = (((dst_r >> drl) << drs) & drm) |
-				 (((dst_g >> dgl) << dgs) & dgm) |
-				 (((dst_b >> dbl) << dbs) & dbm);
-			
-		switch (dbpp) {
-			case 2:
-				reinterpret_cast<uint16*>(dptr)[i] = dst_px;
-				break;
-			case 4:
-				reinterpret_cast<uint32*>(dptr)[i] = dst_px;
-				break;
-			default:
-				return;
+	// The per-pixel work comes down to three lookups, in tables that only
+	// change when the colors or the surfaces do
+	static gamma_tables t;
+	static uint32 t_generation = 0;
+	static Uint32 t_src_format = SDL_PIXELFORMAT_UNKNOWN, t_dst_format = SDL_PIXELFORMAT_UNKNOWN;
+	if (t_generation != gamma_generation || t_src_format != src->format->format || t_dst_format != dst->format->format ||
+		t_src_format == SDL_PIXELFORMAT_UNKNOWN) {
+		uint32 drm = dst->format->Rmask, dgm = dst->format->Gmask, dbm = dst->format->Bmask;
+		uint32 drs = dst->format->Rshift, dgs = dst->format->Gshift, dbs = dst->format->Bshift;
+		uint32 srl = src->format->Rloss, sgl = src->format->Gloss, sbl = src->format->Bloss;
+		uint32 drl = dst->format->Rloss, dgl = dst->format->Gloss, dbl = dst->format->Bloss;
+		
+		t.byte_channels = has_byte_channels(src->format) && has_byte_channels(dst->format) &&
+			src->format->Rshift == drs && src->format->Gshift == dgs && src->format->Bshift == dbs;
+		memset(t.bytes, 0, sizeof(t.bytes));
+		for (int c = 0; c < 256; ++c) {
+			uint8 dst_r = current_gamma_r[uint8(c << srl)] >> 8;
+			uint8 dst_g = current_gamma_g[uint8(c << sgl)] >> 8;
+			uint8 dst_b = current_gamma_b[uint8(c << sbl)] >> 8;
+			t.r[c] = ((dst_r >> drl) << drs) & drm;
+			t.g[c] = ((dst_g >> dgl) << dgs) & dgm;
+			t.b[c] = ((dst_b >> dbl) << dbs) & dbm;
+			if (t.byte_channels) {
+				t.bytes[drs / 8][c] = dst_r;
+				t.bytes[dgs / 8][c] = dst_g;
+				t.bytes[dbs / 8][c] = dst_b;
+			}
 		}
+		t_generation = gamma_generation;
+		t_src_format = src->format->format;
+		t_dst_format = dst->format->format;
 	}
+	
+	if (t.byte_channels)
+		apply_gamma_bytes(src, dst, t);
+	else if (sbpp == 4 && dbpp == 4)
+		apply_gamma_rows<uint32, uint32>(src, dst, t);
+	else if (sbpp == 4)
+		apply_gamma_rows<uint32, uint16>(src, dst, t);
+	else if (dbpp == 4)
+		apply_gamma_rows<uint16, uint32>(src, dst, t);
+	else
+		apply_gamma_rows<uint16, uint16>(src, dst, t);
+	
 	if (SDL_MUSTLOCK(dst))
 		SDL_UnlockSurface(dst);
 }
@@ -1611,16 +1824,27 @@ static void update_screen(SDL_Rect &source, SDL_Rect &destination, bool hi_rez)
 	} 
 	else 
 	{
-		SDL_Surface* intermediary = 0;
-		if (SDL_MUSTLOCK(main_surface)) 
+		// Kept from frame to frame, rather than made for each
+		static SDL_Surface* intermediary = 0;
+		if (s->format->BytesPerPixel != 1 && !pixel_formats_equal(s->format, main_surface->format))
 		{
-			if (SDL_LockSurface(main_surface) < 0) return;
+			if (!intermediary || intermediary->w != s->w || intermediary->h != s->h ||
+			    !pixel_formats_equal(intermediary->format, main_surface->format))
+			{
+				if (intermediary)
+					SDL_FreeSurface(intermediary);
+				intermediary = SDL_CreateRGBSurface(SDL_SWSURFACE, s->w, s->h, main_surface->format->BitsPerPixel,
+					main_surface->format->Rmask, main_surface->format->Gmask, main_surface->format->Bmask, 0);
+				if (!intermediary)
+					return;
+			}
+			SDL_BlitSurface(s, NULL, intermediary, NULL);
+			s = intermediary;
 		}
 
-		if (s->format->BytesPerPixel != 1 && !pixel_formats_equal(s->format, main_surface->format))
+		if (SDL_MUSTLOCK(main_surface)) 
 		{
-			intermediary = SDL_ConvertSurface(s, main_surface->format, s->flags);
-			s = intermediary;
+			if (SDL_LockSurface(main_surface) < 0) return;
 		}
 
 		switch (s->format->BytesPerPixel) 
@@ -1639,11 +1863,6 @@ static void update_screen(SDL_Rect &source, SDL_Rect &destination, bool hi_rez)
 		if (SDL_MUSTLOCK(main_surface)) {
 			SDL_UnlockSurface(main_surface);
 		}
-
-		if (intermediary) 
-		{
-			SDL_FreeSurface(intermediary);
-		}
 	}
 //	SDL_UpdateRects(main_surface, 1, &destination);
 }
@@ -1687,6 +1906,7 @@ void initialize_gamma(void)
 		memcpy(current_gamma_r, default_gamma_r, sizeof(current_gamma_r));
 		memcpy(current_gamma_g, default_gamma_g, sizeof(current_gamma_g));
 		memcpy(current_gamma_b, default_gamma_b, sizeof(current_gamma_b));
+		gamma_generation++;
 	}
 }
 
@@ -1729,6 +1949,7 @@ void animate_screen_clut(struct color_table *color_table, bool full_screen)
 		current_gamma_b[i] = color_table->colors[i].blue;
 	}
 	using_default_gamma = !memcmp(color_table, uncorrected_color_table, sizeof(struct color_table));
+	gamma_generation++;
 }
 
 void assert_world_color_table(struct color_table *interface_color_table, struct color_table *world_color_table)
@@ -571,6 +571,48 @@ static void DisplayPosition(SDL_Surface *s)
 	
 }
 
+// Frame profiler overlay, in the upper right corner:
+// smoothed CPU and GPU milliseconds for each pass measured, and the input latency
+static void DisplayProfile(SDL_Surface *s)
+{
+	FrameProfiler *Profiler = FrameProfiler::instance();
+	if (!Profiler->IsOverlayShown()) return;
+	
+	FontSpecifier& Font = GetOnScreenFont();
+	
+	DisplayTextDest = s;
+	DisplayTextFont = Font.Info;
+	DisplayTextStyle = Font.Style;
+	
+	short LineSpacing = Font.LineSpacing;
+	short Y = LineSpacing;
+	for (int i = 0; i < FrameProfiler::NUMBER_OF_SECTIONS; i++)
+	{
+		double CPUTime = Profiler->CPUTime(i);
+		if (CPUTime < 0) continue;
+		
+		double GPUTime = Profiler->GPUTime(i);
+		if (GPUTime >= 0)
+			sprintf(temporary, "%s %6.2f ms cpu %6.2f ms gpu", FrameProfiler::SectionName(i), CPUTime, GPUTime);
+		else
+			sprintf(temporary, "%s %6.2f ms cpu", FrameProfiler::SectionName(i), CPUTime);
+		
+		short X = s->w - LineSpacing/3 - DisplayTextWidth(temporary);
+		DisplayText(X,Y,temporary);
+		Y += LineSpacing;
+	}
+	
+	double InputAge = Profiler->InputAge();
+	if (InputAge >= 0)
+	{
+		double InputLateness = MAX(Profiler->InputLateness(), 0);
+		sprintf(temporary, "input %6.2f ms old %6.2f ms late", InputAge, InputLateness);
+		
+		short X = s->w - LineSpacing/3 - DisplayTextWidth(temporary);
+		DisplayText(X,Y,temporary);
+	}
+}
+
 static void DisplayInputLine(SDL_Surface *s)
 {
   if (Console::instance()->input_active() && 
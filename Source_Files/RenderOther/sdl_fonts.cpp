@@ -32,6 +32,7 @@
 #include "resource_manager.h"
 #include "FileHandler.h"
 #include "Logging.h"
+#include "GlyphAtlas.h"
 
 #include <SDL_endian.h>
 #include <vector>
@@ -448,6 +449,7 @@ void ttf_font_info::_unload()
 			--(it->second.second);
 			if (it->second.second <= 0)
 			{
+				GlyphAtlas::Forget(it->second.first);
 				TTF_CloseFont(it->second.first);
 				ttf_font_list.erase(m_keys[i]);
 			}
@@ -511,12 +513,14 @@ int sdl_font_info::_trunc_text(const char *text, int max_width, uint16 style) co
 
 // sdl_font_info::_draw_text is in screen_drawing.cpp
 
-int8 ttf_font_info::char_width(uint8 c, uint16 style) const
+GlyphAtlas *ttf_font_info::get_glyph_atlas(uint16 style) const
 {
-	int advance;
-	TTF_GlyphMetrics(get_ttf(style), mac_roman_to_unicode(static_cast<char>(c)), 0, 0, 0, 0, &advance);
+	return GlyphAtlas::instance(get_ttf(style), environment_preferences->smooth_text);
+}
 
-	return advance;
+int8 ttf_font_info::char_width(uint8 c, uint16 style) const
+{
+	return get_glyph_atlas(style)->Advance(mac_roman_to_unicode(static_cast<char>(c)));
 }
 uint16 ttf_font_info::_text_width(const char *text, uint16 style, bool utf8) const
 {
@@ -525,38 +529,26 @@ uint16 ttf_font_info::_text_width(const char *text, uint16 style, bool utf8) con
 
 uint16 ttf_font_info::_text_width(const char *text, size_t length, uint16 style, bool utf8) const
 {
-	int width = 0;
-	if (utf8)
-	{
-		char *temp = process_printable(text, length);
-		TTF_SizeUTF8(get_ttf(style), temp, &width, 0);
-	}
-	else
-	{
-		uint16 *temp = process_macroman(text, length);
-		TTF_SizeUNICODE(get_ttf(style), temp, &width, 0);
-	}
-	
-	return width;
+	uint16 *temp = utf8 ? process_utf8(text, length) : process_macroman(text, length);
+	return get_glyph_atlas(style)->TextWidth(temp);
 }
 
 int ttf_font_info::_trunc_text(const char *text, int max_width, uint16 style) const
 {
-	int width;
-	static uint16 temp[1024];
-	mac_roman_to_unicode(text, temp, 1024);
-	TTF_SizeUNICODE(get_ttf(style), temp, &width, 0);
-	if (width < max_width) return strlen(text);
-
-	int num = strlen(text) - 1;
-
-	while (num > 0 && width > max_width)
+	GlyphAtlas *atlas = get_glyph_atlas(style);
+	int width = 0;
+	int num = 0;
+	uint16 previous = 0;
+	char c;
+	while ((c = *text++) != 0)
 	{
-		num--;
-		temp[num] = 0x0;
-		TTF_SizeUNICODE(get_ttf(style), temp, &width, 0);
+		uint16 u = mac_roman_to_unicode(c);
+		width += atlas->Kerning(previous, u) + atlas->Advance(u);
+		if (width > max_width)
+			break;
+		previous = u;
+		num++;
 	}
-
 	return num;
 }
 
@@ -595,6 +587,40 @@ uint16 *ttf_font_info::process_macroman(const char *src, int len) const
 	return dst;
 }
 
+// Skips control characters, as process_printable() does; what is outside
+// UCS-2 comes out as the replacement character
+uint16 *ttf_font_info::process_utf8(const char *src, int len) const
+{
+	static uint16 dst[1024];
+	if (len > 1023) len = 1023;
+	uint16 *p = dst;
+	const unsigned char *s = reinterpret_cast<const unsigned char *>(src);
+	const unsigned char *end = s + len;
+	while (s < end && *s)
+	{
+		uint32 c = *s++;
+		int following = 0;
+		if (c >= 0xf0) { following = 3; c = 0xfffd; }
+		else if (c >= 0xe0) { following = 2; c &= 0x0f; }
+		else if (c >= 0xc0) { following = 1; c &= 0x1f; }
+		else if (c >= 0x80) c = 0xfffd;
+
+		for (; following > 0 && s < end && (*s & 0xc0) == 0x80; --following, ++s)
+		{
+			if (c != 0xfffd)
+				c = (c << 6) | (*s & 0x3f);
+		}
+		if (following > 0)
+			c = 0xfffd;
+
+		if (c >= ' ')
+			*p++ = c;
+	}
+
+	*p = 0x0;
+	return dst;
+}
+
 uint16 font_info::text_width(const char *text, uint16 style, bool utf8) const
 {
 	if (style & styleShadow)
@@ -39,6 +39,7 @@
  *  Definitions
  */
 
+class GlyphAtlas;
 
 class font_info {
 	friend void unload_font(font_info *font);
@@ -55,6 +56,9 @@ public:
 	int trunc_text(const char *text, int max_width, uint16 style) const;
 	virtual int8 char_width(uint8 c, uint16 style) const = 0;
 
+	// Where the glyphs are cached, for fonts that are drawn from an atlas
+	virtual GlyphAtlas *get_glyph_atlas(uint16 style) const { return NULL; }
+
 	int draw_styled_text(SDL_Surface *s, const std::string& text, size_t length, int x, int y, uint32 pixel, uint16 initial_style, bool utf = false) const;
 	int styled_text_width(const std::string& text, size_t length, uint16 initial_style, bool utf8 = false) const;
 	int trunc_styled_text(const std::string& text, int max_width, uint16 style) const;
@@ -126,6 +130,7 @@ public:
 	int m_adjust_height;
 
 	int8 char_width(uint8, uint16) const;
+	GlyphAtlas *get_glyph_atlas(uint16 style) const;
 
 	ttf_font_info() { 
 		for (int i = 0; i < styleUnderline; i++) { m_styles[i] = 0; } 
@@ -138,6 +143,7 @@ protected:
 private:
 	char *process_printable(const char *src, int len) const;
 	uint16 *process_macroman(const char *src, int len) const;
+	uint16 *process_utf8(const char *src, int len) const;
 	TTF_Font *get_ttf(uint16 style) const { return m_styles[style & (styleBold | styleItalic)]; }
 	virtual void _unload();
 };
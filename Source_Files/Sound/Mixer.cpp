@@ -21,12 +21,153 @@
 
 #include "Mixer.h"
 #include "interface.h" // for strERRORS
+#include "Logging.h"
+#include "Trace.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIXER_SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MIXER_SIMD_NEON
+#endif
 
 Mixer* Mixer::m_instance = 0;
 
 extern bool option_nosound;
 
-void Mixer::Start(uint16 rate, bool sixteen_bit, bool stereo, int num_channels, int volume, uint16 samples)
+/* ---------- mixing kernels */
+
+// output += (input * volume) >> 8
+static void accumulate_scalar(int32* output, const int16* input, int16 volume, int samples)
+{
+	for (int i = 0; i < samples; ++i)
+	{
+		output[i] += (input[i] * volume) >> 8;
+	}
+}
+
+static void apply_volume_and_clip_scalar(int32* v, int16 main_volume, int samples)
+{
+	while (samples--)
+	{
+		*v = (*v * main_volume) >> 8;
+		if (*v > INT16_MAX)
+		{
+			*v = INT16_MAX;
+		}
+		else if (*v < INT16_MIN)
+		{
+			*v = INT16_MIN;
+		}
+
+		++v;
+	}
+}
+
+// The vector versions do groups of eight samples, and leave the rest to the
+// scalar ones; the results are the same to the bit
+#if defined(MIXER_SIMD_SSE2)
+static void accumulate_vector(int32* output, const int16* input, int16 volume, int samples)
+{
+	int vectored = samples & ~7;
+	__m128i v = _mm_set1_epi16(volume);
+	for (int i = 0; i < vectored; i += 8)
+	{
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+		__m128i lo = _mm_mullo_epi16(x, v);
+		__m128i hi = _mm_mulhi_epi16(x, v);
+		__m128i p0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 8);
+		__m128i p1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 8);
+
+		__m128i* out = reinterpret_cast<__m128i*>(output + i);
+		_mm_storeu_si128(out, _mm_add_epi32(_mm_loadu_si128(out), p0));
+		_mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1), p1));
+	}
+	accumulate_scalar(output + vectored, input + vectored, volume, samples - vectored);
+}
+
+// SSE2 has no 32-bit multiply that keeps the low halves
+static inline __m128i mullo_epi32(__m128i a, __m128i b)
+{
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static void apply_volume_and_clip_vector(int32* v, int16 main_volume, int samples)
+{
+	int vectored = samples & ~7;
+	__m128i volume = _mm_set1_epi32(main_volume);
+	for (int i = 0; i < vectored; i += 8)
+	{
+		__m128i* p = reinterpret_cast<__m128i*>(v + i);
+		__m128i x0 = _mm_srai_epi32(mullo_epi32(_mm_loadu_si128(p), volume), 8);
+		__m128i x1 = _mm_srai_epi32(mullo_epi32(_mm_loadu_si128(p + 1), volume), 8);
+
+		// saturate to 16 bits, and sign extend back
+		__m128i clipped = _mm_packs_epi32(x0, x1);
+		_mm_storeu_si128(p, _mm_srai_epi32(_mm_unpacklo_epi16(clipped, clipped), 16));
+		_mm_storeu_si128(p + 1, _mm_srai_epi32(_mm_unpackhi_epi16(clipped, clipped), 16));
+	}
+	apply_volume_and_clip_scalar(v + vectored, main_volume, samples - vectored);
+}
+#elif defined(MIXER_SIMD_NEON)
+static void accumulate_vector(int32* output, const int16* input, int16 volume, int samples)
+{
+	int vectored = samples & ~7;
+	int16x4_t v = vdup_n_s16(volume);
+	for (int i = 0; i < vectored; i += 8)
+	{
+		int16x8_t x = vld1q_s16(input + i);
+		int32x4_t p0 = vshrq_n_s32(vmull_s16(vget_low_s16(x), v), 8);
+		int32x4_t p1 = vshrq_n_s32(vmull_s16(vget_high_s16(x), v), 8);
+		vst1q_s32(output + i, vaddq_s32(vld1q_s32(output + i), p0));
+		vst1q_s32(output + i + 4, vaddq_s32(vld1q_s32(output + i + 4), p1));
+	}
+	accumulate_scalar(output + vectored, input + vectored, volume, samples - vectored);
+}
+
+static void apply_volume_and_clip_vector(int32* v, int16 main_volume, int samples)
+{
+	int vectored = samples & ~7;
+	int32x4_t volume = vdupq_n_s32(main_volume);
+	for (int i = 0; i < vectored; i += 4)
+	{
+		int32x4_t x = vshrq_n_s32(vmulq_s32(vld1q_s32(v + i), volume), 8);
+		vst1q_s32(v + i, vmovl_s16(vqmovn_s32(x)));
+	}
+	apply_volume_and_clip_scalar(v + vectored, main_volume, samples - vectored);
+}
+#endif
+
+static void (*accumulate)(int32* output, const int16* input, int16 volume, int samples) = accumulate_scalar;
+static void (*apply_volume_and_clip)(int32* v, int16 main_volume, int samples) = apply_volume_and_clip_scalar;
+
+static void choose_mixing_kernels()
+{
+	bool available = false;
+#if defined(MIXER_SIMD_SSE2)
+	available = SDL_HasSSE2();
+#elif defined(MIXER_SIMD_NEON) && SDL_VERSION_ATLEAST(2,0,6)
+	available = SDL_HasNEON();
+#elif defined(MIXER_SIMD_NEON)
+	available = true;
+#endif
+
+#if defined(MIXER_SIMD_SSE2) || defined(MIXER_SIMD_NEON)
+	if (available)
+	{
+		accumulate = accumulate_vector;
+		apply_volume_and_clip = apply_volume_and_clip_vector;
+		return;
+	}
+#endif
+	accumulate = accumulate_scalar;
+	apply_volume_and_clip = apply_volume_and_clip_scalar;
+}
+
+void Mixer::Start(uint16 rate, bool sixteen_bit, bool stereo, int num_channels, int volume, uint16 samples, bool low_latency)
 {
 	sound_channel_count = num_channels;
 	main_volume = volume;
@@ -41,7 +182,31 @@ void Mixer::Start(uint16 rate, bool sixteen_bit, bool stereo, int num_channels,
 	desired.callback = MixerCallback;
 	desired.userdata = reinterpret_cast<void *>(this);
 
-	if (option_nosound || SDL_OpenAudio(&desired, &obtained) < 0) 
+	choose_mixing_kernels();
+
+	bool opened = false;
+	if (low_latency && !option_nosound)
+	{
+		for (int s = LOW_LATENCY_MINIMUM_SAMPLES; s < samples && !opened; s *= 2)
+		{
+			desired.samples = s;
+			if (SDL_OpenAudio(&desired, &obtained) < 0)
+				break;
+
+			opened = KeepsUp();
+			if (!opened)
+				SDL_CloseAudio();
+		}
+		desired.samples = samples;
+	}
+
+	if (!opened && !option_nosound)
+		opened = (SDL_OpenAudio(&desired, &obtained) >= 0);
+
+	if (opened)
+		logNote("audio buffer of %d samples, %d ms", obtained.samples, OutputLatency());
+
+	if (!opened) 
 	{
 		if (!option_nosound)
 			// opening audio failed
@@ -67,25 +232,158 @@ void Mixer::Start(uint16 rate, bool sixteen_bit, bool stereo, int num_channels,
 	}
 }
 
+bool Mixer::KeepsUp()
+{
+	SDL_AtomicSet(&measured_callbacks, 0);
+	measuring = true;
+	SDL_PauseAudio(false);
+
+	uint32 period_ms = obtained.samples * 1000 / obtained.freq + 1;
+	uint32 start = SDL_GetTicks();
+	while (SDL_AtomicGet(&measured_callbacks) < MEASURED_CALLBACKS && SDL_GetTicks() - start < 2 * MEASURED_CALLBACKS * period_ms + 100)
+		SDL_Delay(1);
+
+	SDL_PauseAudio(true);
+	SDL_LockAudio();
+	measuring = false;
+	int count = SDL_AtomicGet(&measured_callbacks);
+	SDL_UnlockAudio();
+
+	if (count < MEASURED_CALLBACKS)
+		return false;
+
+	// callbacks may come in bursts, so measure against the schedule rather
+	// than from one to the next
+	double period = static_cast<double>(obtained.samples) * SDL_GetPerformanceFrequency() / obtained.freq;
+	uint64_t first = callback_times[WARM_UP_CALLBACKS];
+	for (int i = WARM_UP_CALLBACKS + 1; i < MEASURED_CALLBACKS; ++i)
+	{
+		double due = first + (i - WARM_UP_CALLBACKS) * period;
+		if (callback_times[i] > due + period)
+			return false;
+	}
+
+	return true;
+}
+
 void Mixer::Stop()
 {
 	SDL_CloseAudio();
+
+	// nothing will carry these out now
+	for (int i = 0; i < COMMAND_QUEUE_SIZE; ++i)
+		commands[i].data.reset();
+	SDL_AtomicSet(&command_write, 0);
+	SDL_AtomicSet(&command_read, 0);
+
 	channels.clear();
 	sound_channel_count = 0;
 }
 
-void Mixer::BufferSound(int channel, const SoundInfo& header, boost::shared_ptr<SoundData> data, _fixed pitch)
+void Mixer::QueueCommand(Command& command)
 {
-	SDL_LockAudio();
-	if (channels[channel].active)
+	uint32 write = SDL_AtomicGet(&command_write);
+	uint32 read = SDL_AtomicGet(&command_read);
+	if (write - read == COMMAND_QUEUE_SIZE)
 	{
-		// queue the header
-		channels[channel].BufferSoundHeader(header, data, pitch);
-	} else {
-		// load it directly
-		channels[channel].active = true;
-		channels[channel].LoadSoundHeader(header, data, pitch);
+		// the callback is behind (or not running); catch up under the lock
+		SDL_LockAudio();
+		DrainCommands();
+		CarryOut(command);
+		SDL_UnlockAudio();
+		return;
 	}
+
+	Command& slot = commands[write & (COMMAND_QUEUE_SIZE - 1)];
+	slot = command;
+	SDL_AtomicSet(&command_write, write + 1);
+}
+
+void Mixer::DrainCommands()
+{
+	uint32 read = SDL_AtomicGet(&command_read);
+	uint32 write = SDL_AtomicGet(&command_write);
+	while (read != write)
+	{
+		Command& command = commands[read & (COMMAND_QUEUE_SIZE - 1)];
+		CarryOut(command);
+		command.data.reset();
+		SDL_AtomicSet(&command_read, ++read);
+	}
+}
+
+void Mixer::CarryOut(Command& command)
+{
+	Channel& c = channels[command.channel];
+	switch (command.type)
+	{
+	case Command::BUFFER_SOUND:
+		if (c.active)
+		{
+			// queue the header
+			c.BufferSoundHeader(command.header, command.data, command.pitch);
+		} else {
+			// load it directly
+			c.active = true;
+			c.LoadSoundHeader(command.header, command.data, command.pitch);
+		}
+		SDL_AtomicDecRef(&c.queued_sounds);
+		break;
+	case Command::QUIET:
+		c.Quiet();
+		break;
+	case Command::SET_VOLUMES:
+		c.left_volume = command.left_volume;
+		c.right_volume = command.right_volume;
+		break;
+	case Command::PLAY_RESOURCE:
+		c.active = true;
+		c.LoadSoundHeader(command.header, command.data, command.pitch);
+		c.left_volume = c.right_volume = 0x100;
+		break;
+	case Command::STOP_CHANNEL:
+		c.active = false;
+		break;
+	}
+}
+
+void Mixer::BufferSound(int channel, const SoundInfo& header, boost::shared_ptr<SoundData> data, _fixed pitch)
+{
+	Command command;
+	command.type = Command::BUFFER_SOUND;
+	command.channel = channel;
+	command.header = header;
+	command.data = data;
+	command.pitch = pitch;
+	SDL_AtomicIncRef(&channels[channel].queued_sounds);
+	QueueCommand(command);
+}
+
+void Mixer::QuietChannel(int channel)
+{
+	Command command;
+	command.type = Command::QUIET;
+	command.channel = channel;
+	QueueCommand(command);
+}
+
+void Mixer::SetChannelVolumes(int channel, int16 left, int16 right)
+{
+	Command command;
+	command.type = Command::SET_VOLUMES;
+	command.channel = channel;
+	command.left_volume = left;
+	command.right_volume = right;
+	QueueCommand(command);
+}
+
+// The music buffer may go away once this returns, so the callback must be
+// done with it
+void Mixer::StopMusicChannel()
+{
+	SDL_LockAudio();
+	DrainCommands();
+	channels[sound_channel_count + MUSIC_CHANNEL].active = false;
 	SDL_UnlockAudio();
 }
 
@@ -96,14 +394,79 @@ void Mixer::MixerCallback(void *usr, uint8 *stream, int len)
 
 void Mixer::Callback(uint8 *stream, int len)
 {
+	Tracer::NameThread("audio");
+	TRACE_SPAN("mix");
+
+	if (measuring)
+	{
+		int count = SDL_AtomicGet(&measured_callbacks);
+		if (count < MEASURED_CALLBACKS)
+		{
+			callback_times[count] = SDL_GetPerformanceCounter();
+			SDL_AtomicSet(&measured_callbacks, count + 1);
+		}
+		memset(stream, obtained.silence, len);
+		return;
+	}
+
 	bool stereo = (obtained.channels == 2);
 	bool is_sixteen_bit = ((obtained.format & 0xff) == 16);
 	bool is_signed = obtained.format & 0x8000;
 	int samples = len / (stereo ? 2 : 1) / (is_sixteen_bit ? 2 : 1);
 
+	if (timing)
+	{
+		int playing = 0;
+		for (size_t i = 0; i < channels.size(); ++i)
+			if (channels[i].active)
+				++playing;
+		playing = MIN(playing, static_cast<int>(TIMED_CHANNEL_COUNTS));
+
+		uint64_t start = SDL_GetPerformanceCounter();
+		Mix(stream, samples, stereo, is_sixteen_bit, is_signed);
+		uint64_t elapsed = SDL_GetPerformanceCounter() - start;
+
+		++timed_callbacks[playing];
+		timed_total[playing] += elapsed;
+		timed_max[playing] = MAX(timed_max[playing], elapsed);
+		return;
+	}
+
 	Mix(stream, samples, stereo, is_sixteen_bit, is_signed);
 }
 
+void Mixer::StartTiming()
+{
+	SDL_LockAudio();
+	memset(timed_callbacks, 0, sizeof(timed_callbacks));
+	memset(timed_total, 0, sizeof(timed_total));
+	memset(timed_max, 0, sizeof(timed_max));
+	timing = true;
+	SDL_UnlockAudio();
+}
+
+std::vector<std::string> Mixer::StopTiming()
+{
+	SDL_LockAudio();
+	timing = false;
+	SDL_UnlockAudio();
+
+	std::vector<std::string> report;
+	double us = 1000000.0 / SDL_GetPerformanceFrequency();
+	for (int i = 0; i <= TIMED_CHANNEL_COUNTS; ++i)
+	{
+		if (!timed_callbacks[i])
+			continue;
+
+		char line[128];
+		snprintf(line, sizeof(line), "%d channels: %u callbacks, avg %.1f us, max %.1f us",
+			i, timed_callbacks[i], timed_total[i] * us / timed_callbacks[i], timed_max[i] * us);
+		report.push_back(line);
+	}
+
+	return report;
+}
+
 void Mixer::StartMusicChannel(bool sixteen_bit, bool stereo, bool signed_8bit, int bytes_per_frame, _fixed rate, bool little_endian)
 {
 	Channel *c = &channels[sound_channel_count + MUSIC_CHANNEL];
@@ -195,11 +558,13 @@ void Mixer::PlaySoundResource(LoadedResource &rsrc, _fixed pitch)
 		boost::shared_ptr<SoundData> data = header.LoadData(rsrc);
 		if (data.get())
 		{
-			SDL_LockAudio();
-			c->active = true;
-			c->LoadSoundHeader(header, data, pitch);
-			c->left_volume = c->right_volume = 0x100;
-			SDL_UnlockAudio();
+			Command command;
+			command.type = Command::PLAY_RESOURCE;
+			command.channel = c - &channels[0];
+			command.header = header;
+			command.data = data;
+			command.pitch = pitch;
+			QueueCommand(command);
 		}
 	}
 }
@@ -207,9 +572,11 @@ void Mixer::PlaySoundResource(LoadedResource &rsrc, _fixed pitch)
 void Mixer::StopSoundResource()
 {
 	if (!channels.size()) return;
-	SDL_LockAudio();
-	channels[sound_channel_count + RESOURCE_CHANNEL].active = false;
-	SDL_UnlockAudio();
+
+	Command command;
+	command.type = Command::STOP_CHANNEL;
+	command.channel = sound_channel_count + RESOURCE_CHANNEL;
+	QueueCommand(command);
 }
 
 Mixer::Channel::Channel() :
@@ -224,6 +591,7 @@ Mixer::Channel::Channel() :
 	right_volume(0x100),
 	next_pitch(0)
 {
+	SDL_AtomicSet(&queued_sounds, 0);
 }
 
 void Mixer::Channel::LoadSoundHeader(const SoundInfo& header, boost::shared_ptr<SoundData> data, _fixed pitch)
@@ -405,6 +773,134 @@ void Mixer::Resample_(Channel* c, int16* left, int16* right, int& samples)
 	}
 }
 
+// Steps through the sound just like Resample_() does at normal pitch
+template<class T, bool stereo, bool le_or_signed>
+static void convert_(const uint8* data, int32 frames, _fixed rate, std::vector<int16>& out, int32 loop_start, int32 loop_end, int32& out_loop_start, int32& out_loop_end)
+{
+	const int channels = stereo ? 2 : 1;
+	const T* samples = reinterpret_cast<const T*>(data);
+
+	int32 frame = 0;
+	_fixed counter = 0;
+	out_loop_start = out_loop_end = NONE;
+	while (frame < frames)
+	{
+		int32 out_frame = out.size() / channels;
+		if (out_loop_start == NONE && frame >= loop_start)
+			out_loop_start = out_frame;
+		if (out_loop_end == NONE && frame >= loop_end)
+			out_loop_end = out_frame;
+
+		for (int i = 0; i < channels; ++i)
+		{
+			int32 x0 = Convert<le_or_signed>(samples[frame * channels + i]);
+			if ((counter & 0xffff) && frame + 1 < frames)
+			{
+				int32 x1 = Convert<le_or_signed>(samples[(frame + 1) * channels + i]);
+				out.push_back(lerp(x0, x1, counter));
+			}
+			else
+			{
+				out.push_back(x0);
+			}
+		}
+
+		counter += rate;
+		frame += counter >> 16;
+		counter &= 0xffff;
+	}
+
+	if (out_loop_start == NONE)
+		out_loop_start = out.size() / channels;
+	if (out_loop_end == NONE)
+		out_loop_end = out.size() / channels;
+}
+
+boost::shared_ptr<SoundData> Mixer::ConvertSound(const SoundInfo& header, const SoundData& data, SoundInfo& converted)
+{
+	boost::shared_ptr<SoundData> result;
+
+	// as LoadSoundHeader() works out the rate for normal pitch
+	_fixed rate = (_normal_frequency >> 8) * ((header.rate >> 8) / obtained.freq);
+	int32 frames = MIN(header.length, static_cast<int32>(data.size())) / header.bytes_per_frame;
+	if (rate <= 0 || frames <= 0)
+		return result;
+
+#ifdef ALEPHONE_LITTLE_ENDIAN
+	const bool native_endian = header.little_endian;
+#else
+	const bool native_endian = !header.little_endian;
+#endif
+	if (header.sixteen_bit && native_endian && rate == _normal_frequency)
+		return result;
+
+	int32 loop_start = header.loop_start / header.bytes_per_frame;
+	int32 loop_end = header.loop_end / header.bytes_per_frame;
+	int32 out_loop_start, out_loop_end;
+	std::vector<int16> out;
+	out.reserve(static_cast<size_t>(frames) * _normal_frequency / rate * (header.stereo ? 2 : 1) + 2);
+
+	const uint8* p = &data[0];
+	if (header.stereo)
+	{
+		if (header.sixteen_bit)
+		{
+			if (header.little_endian)
+				convert_<int16, true, true>(p, frames, rate, out, loop_start, loop_end, out_loop_start, out_loop_end);
+			else
+				convert_<int16, true, false>(p, frames, rate, out, loop_start, loop_end, out_loop_start, out_loop_end);
+		}
+		else
+		{
+			if (header.signed_8bit)
+				convert_<int8, true, true>(p, frames, rate, out, loop_start, loop_end, out_loop_start, out_loop_end);
+			else
+				convert_<uint8, true, false>(p, frames, rate, out, loop_start, loop_end, out_loop_start, out_loop_end);
+		}
+	}
+	else
+	{
+		if (header.sixteen_bit)
+		{
+			if (header.little_endian)
+				convert_<int16, false, true>(p, frames, rate, out, loop_start, loop_end, out_loop_start, out_loop_end);
+			else
+				convert_<int16, false, false>(p, frames, rate, out, loop_start, loop_end, out_loop_start, out_loop_end);
+		}
+		else
+		{
+			if (header.signed_8bit)
+				convert_<int8, false, true>(p, frames, rate, out, loop_start, loop_end, out_loop_start, out_loop_end);
+			else
+				convert_<uint8, false, false>(p, frames, rate, out, loop_start, loop_end, out_loop_start, out_loop_end);
+		}
+	}
+
+	converted = header;
+	converted.sixteen_bit = true;
+#ifdef ALEPHONE_LITTLE_ENDIAN
+	converted.little_endian = true;
+#else
+	converted.little_endian = false;
+#endif
+	converted.bytes_per_frame = header.stereo ? 4 : 2;
+	converted.rate = static_cast<uint32>(obtained.freq) << 16;
+	converted.length = out.size() * 2;
+	if (header.loop_end - header.loop_start >= 4)
+	{
+		converted.loop_start = out_loop_start * converted.bytes_per_frame;
+		converted.loop_end = out_loop_end * converted.bytes_per_frame;
+	}
+	else
+	{
+		converted.loop_start = converted.loop_end = 0;
+	}
+
+	result.reset(new SoundData(out.size() * 2));
+	memcpy(&(*result)[0], &out[0], out.size() * 2);
+	return result;
+}
+
 void Mixer::Resample(Channel* c, int16* left, int16* right, int samples)
 {
 	int left_to_process = samples;
@@ -468,24 +964,6 @@ void Mixer::ResampleInner(Channel* c, int16* left, int16* right, int& samples)
 	}
 }
 
-static inline void apply_volume_and_clip(int32* v, int16 main_volume, int samples)
-{
-	while (samples--)
-	{
-		*v = (*v * main_volume) >> 8;
-		if (*v > INT16_MAX)
-		{
-			*v = INT16_MAX;
-		}
-		else if (*v < INT16_MIN)
-		{
-			*v = INT16_MIN;
-		}
-
-		++v;
-	}
-}
-
 void Output(int16* output, int32* left, int32* right, int samples, bool)
 {
 	while (samples--)
@@ -550,6 +1028,9 @@ void Mixer::Mix(uint8* p, int len, bool stereo, bool is_sixteen_bit, bool is_sig
 	int32 output_left[FRAME_SIZE];
 	int32 output_right[FRAME_SIZE];
 
+	// here rather than in Callback(), since the movie recorder mixes too
+	DrainCommands();
+
 	while (len)
 	{
 		std::fill_n(output_left, FRAME_SIZE, 0);
@@ -561,6 +1042,11 @@ void Mixer::Mix(uint8* p, int len, bool stereo, bool is_sixteen_bit, bool is_sig
 		for (int channel = 0; channel < channel_count; ++channel)
 		{
 			Channel* c = &channels[channel];
+
+			// an idle channel would only add silence
+			if (!c->active)
+				continue;
+
 			Resample(c, channel_left, channel_right, samples);
 
 			int16 left_volume = c->left_volume;
@@ -570,11 +1056,8 @@ void Mixer::Mix(uint8* p, int len, bool stereo, bool is_sixteen_bit, bool is_sig
 				left_volume = right_volume = SoundManager::instance()->GetNetmicVolumeAdjustment();
 			}
 
-			for (int i = 0; i < samples; ++i)
-			{
-				output_left[i] += (channel_left[i] * left_volume) >> 8;
-				output_right[i] += (channel_right[i] * right_volume) >> 8;
-			}
+			accumulate(output_left, channel_left, left_volume, samples);
+			accumulate(output_right, channel_right, right_volume, samples);
 		}
 
 		if (game_is_networked &&
@@ -23,6 +23,7 @@
 */
 
 #include <SDL_endian.h>
+#include <SDL_atomic.h>
 #include "cseries.h"
 #include "network_speaker_sdl.h"
 #include "network_audio_shared.h"
@@ -30,6 +31,9 @@
 #include "Music.h"
 #include "SoundManager.h"
 
+#include <string>
+#include <vector>
+
 extern short local_player_index;
 extern bool game_is_networked;
 
@@ -37,9 +41,19 @@ class Mixer
 {
 public:
 	static Mixer *instance() { if (!m_instance) m_instance = new Mixer(); return m_instance; }
-	void Start(uint16 rate, bool sixteen_bit, bool stereo, int num_channels, int volume, uint16 samples);
+	// with low_latency, samples is the largest buffer to try; the smallest
+	// one the callback keeps up with is used
+	void Start(uint16 rate, bool sixteen_bit, bool stereo, int num_channels, int volume, uint16 samples, bool low_latency = false);
 	void Stop();
 
+	// of the buffer SDL asks the callback to fill, in ms
+	int OutputLatency() { return obtained.freq ? obtained.samples * 1000 / obtained.freq : 0; }
+
+	// Times each callback, by how many channels are playing in it; the
+	// report is a line for each count that came up
+	void StartTiming();
+	std::vector<std::string> StopTiming();
+
 	void SetVolume(short volume) { main_volume = volume; }
 
 	void BufferSound(int channel, const SoundInfo& header, boost::shared_ptr<SoundData> data, _fixed pitch);
@@ -47,31 +61,33 @@ public:
 	// returns the number of normal/ambient channels
 	int SoundChannelCount() { return sound_channel_count; }
 
-	void QuietChannel(int channel) { channels[channel].Quiet(); }
-	void SetChannelVolumes(int channel, int16 left, int16 right) { 
-		channels[channel].left_volume = left; 
-		channels[channel].right_volume = right; 
-	}
+	void QuietChannel(int channel);
+	void SetChannelVolumes(int channel, int16 left, int16 right);
 
-	bool ChannelBusy(int channel) { return channels[channel].active; }
+	// a sound still in the command queue counts
+	bool ChannelBusy(int channel) { return channels[channel].active || SDL_AtomicGet(&channels[channel].queued_sounds); }
 
 	// activates the channel
 	void StartMusicChannel(bool sixteen_bit, bool stereo, bool signed_8bit, int bytes_per_frame, _fixed rate, bool little_endian);
 	void UpdateMusicChannel(uint8* data, int len);
 	bool MusicPlaying() { return channels[sound_channel_count + MUSIC_CHANNEL].active; }
-	void StopMusicChannel() { SDL_LockAudio(); channels[sound_channel_count + MUSIC_CHANNEL].active = false; SDL_UnlockAudio(); }
-	void SetMusicChannelVolume(int16 volume) { channels[sound_channel_count + MUSIC_CHANNEL].left_volume = channels[sound_channel_count + MUSIC_CHANNEL].right_volume = volume; }
+	void StopMusicChannel();
+	void SetMusicChannelVolume(int16 volume) { SetChannelVolumes(sound_channel_count + MUSIC_CHANNEL, volume, volume); }
 
 	SDL_AudioSpec desired, obtained;
 
 	void EnsureNetworkAudioPlaying();
 	void StopNetworkAudio();
 
+	// The sound as 16-bit samples at the output rate, so that at normal
+	// pitch the mixer only has to scale and add it; NULL if it already is
+	boost::shared_ptr<SoundData> ConvertSound(const SoundInfo& header, const SoundData& data, SoundInfo& converted);
+
 	void PlaySoundResource(LoadedResource &rsrc, _fixed pitch = _normal_frequency);
 	void StopSoundResource();
 
 private:
-        Mixer() : sNetworkAudioBufferDesc(0) { };
+        Mixer() : measuring(false), timing(false), sNetworkAudioBufferDesc(0) { SDL_AtomicSet(&command_write, 0); SDL_AtomicSet(&command_read, 0); SDL_AtomicSet(&measured_callbacks, 0); };
 	
 	static Mixer *m_instance;
 	
@@ -114,6 +130,9 @@ private:
 
 		int sound_manager_index;
 
+		// BufferSound()s queued for this channel and not yet carried out
+		SDL_atomic_t queued_sounds;
+
 		void GetMoreData();
 	};
 
@@ -132,6 +151,53 @@ private:
 	int16 main_volume;
 	int sound_channel_count;
 
+	// While a low latency buffer size is being tried, the callback only
+	// plays silence and notes when it ran; it has kept up if no callback
+	// came more than a buffer's length behind schedule
+	enum {
+		LOW_LATENCY_MINIMUM_SAMPLES = 256,
+		MEASURED_CALLBACKS = 48,
+		WARM_UP_CALLBACKS = 8
+	};
+	bool KeepsUp();
+	bool measuring;
+
+	enum { TIMED_CHANNEL_COUNTS = 32 }; // and more
+	bool timing;
+	uint32 timed_callbacks[TIMED_CHANNEL_COUNTS + 1];
+	uint64_t timed_total[TIMED_CHANNEL_COUNTS + 1];
+	uint64_t timed_max[TIMED_CHANNEL_COUNTS + 1];
+	SDL_atomic_t measured_callbacks;
+	uint64_t callback_times[MEASURED_CALLBACKS];
+
+	// Changes to the channels from the game thread, carried out by the
+	// audio callback when it next mixes; a single producer and a single
+	// consumer, so the two only share the indices
+	struct Command {
+		enum Type {
+			BUFFER_SOUND,
+			QUIET,
+			SET_VOLUMES,
+			PLAY_RESOURCE,
+			STOP_CHANNEL
+		} type;
+		int channel;
+		SoundInfo header;
+		boost::shared_ptr<SoundData> data;
+		_fixed pitch;
+		int16 left_volume;
+		int16 right_volume;
+	};
+
+	enum { COMMAND_QUEUE_SIZE = 256 }; // a power of two
+	Command commands[COMMAND_QUEUE_SIZE];
+	SDL_atomic_t command_write;
+	SDL_atomic_t command_read;
+
+	void QueueCommand(Command& command);
+	void DrainCommands();
+	void CarryOut(Command& command);
+
 	void Resample(Channel* c, int16* left, int16* right, int samples);
 	void ResampleInner(Channel* c, int16* left, int16* right, int& samples);
 	template<class T, bool stereo, bool le_or_signed>
@@ -35,6 +35,19 @@ Music::Music() :
 	music_fade_start(0), 
 	music_fade_duration(0),
 	decoder(0),
+	decode_thread(0),
+	decode_lock(0),
+	decode_cond(0),
+	read_pos(0),
+	read_fill(0),
+	decode_generation(0),
+	decode_quit(false),
+	decode_rewind(false),
+	decode_ended(false),
+	next_decoder(0),
+	decode_handoffs(0),
+	handoffs_seen(0),
+	has_next_file(false),
 	marathon_1_song_index(NONE),
 	song_number(0),
 	random_order(false)
@@ -125,8 +138,25 @@ void Music::Idle()
 		Play();
 	}
 
+	if (decode_thread)
+	{
+		SDL_LockMutex(decode_lock);
+		bool handed_off = (decode_handoffs != handoffs_seen);
+		handoffs_seen = decode_handoffs;
+		SDL_UnlockMutex(decode_lock);
+
+		if (handed_off)
+		{
+			// the decode thread went on to the next song without a gap
+			music_file = next_file;
+			has_next_file = false;
+		}
+	}
+
 	if (!Playing())
 		Restart();
+	else if (music_play && music_level)
+		PreloadNextSong();
 
 	if (music_fading)
 	{
@@ -159,6 +189,7 @@ void Music::Close()
 	{
 		music_initialized = false;
 		Pause();
+		StopDecoding();
 		delete decoder;
 		decoder = 0;
 	}
@@ -167,6 +198,7 @@ void Music::Close()
 bool Music::Load(FileSpecifier &song_file)
 {
 
+	StopDecoding();
 	delete decoder;
 	decoder = StreamDecoder::Get(song_file);
 
@@ -178,7 +210,9 @@ bool Music::Load(FileSpecifier &song_file)
 		bytes_per_frame = decoder->BytesPerFrame();
 		rate = (_fixed) ((decoder->Rate() / Mixer::instance()->obtained.freq) * (1 << FIXED_FRACTIONAL_BITS));
 		little_endian = decoder->IsLittleEndian();
+		decoder_rate = decoder->Rate();
 
+		StartDecoding();
 		return true;
 		
 	}
@@ -190,14 +224,133 @@ bool Music::Load(FileSpecifier &song_file)
 
 void Music::Rewind()
 {
-	
-	if (decoder)
+	if (decode_thread)
+	{
+		// whatever was read ahead is from the wrong place now
+		SDL_LockMutex(decode_lock);
+		++decode_generation;
+		read_pos = read_fill = 0;
+		decode_rewind = true;
+		decode_ended = false;
+		SDL_CondBroadcast(decode_cond);
+		SDL_UnlockMutex(decode_lock);
+	}
+	else if (decoder)
 		decoder->Rewind();
 }
 
+void Music::StartDecoding()
+{
+	if (!decode_lock) decode_lock = SDL_CreateMutex();
+	if (!decode_cond) decode_cond = SDL_CreateCond();
+	if (!decode_lock || !decode_cond) return;
+
+	size_t size = static_cast<size_t>(decoder->Rate() * MUSIC_READ_AHEAD_MS / 1000) * bytes_per_frame;
+	read_ahead.resize(std::max(size, static_cast<size_t>(MUSIC_BUFFER_SIZE * 4)));
+	read_pos = read_fill = 0;
+	decode_quit = decode_rewind = decode_ended = false;
+
+	// without the thread, FillBuffer() decodes as it always has
+	decode_thread = SDL_CreateThread(DecodeThread, "Music_decodeThread", this);
+}
+
+void Music::StopDecoding()
+{
+	if (decode_thread)
+	{
+		SDL_LockMutex(decode_lock);
+		decode_quit = true;
+		SDL_CondBroadcast(decode_cond);
+		SDL_UnlockMutex(decode_lock);
+
+		SDL_WaitThread(decode_thread, NULL);
+		decode_thread = 0;
+	}
+	read_pos = read_fill = 0;
+
+	delete next_decoder;
+	next_decoder = 0;
+	handoffs_seen = decode_handoffs;
+}
+
+int Music::DecodeThread(void *p)
+{
+	static_cast<Music *>(p)->Decode();
+	return 0;
+}
+
+void Music::Decode()
+{
+	std::vector<uint8> chunk(MUSIC_BUFFER_SIZE);
+
+	SDL_LockMutex(decode_lock);
+	while (!decode_quit)
+	{
+		if (decode_rewind)
+		{
+			decode_rewind = false;
+			SDL_UnlockMutex(decode_lock);
+			decoder->Rewind();
+			SDL_LockMutex(decode_lock);
+			continue;
+		}
+
+		if (decode_ended || read_ahead.size() - read_fill < MUSIC_BUFFER_SIZE)
+		{
+			SDL_CondWait(decode_cond, decode_lock);
+			continue;
+		}
+
+		uint32 generation = decode_generation;
+		SDL_UnlockMutex(decode_lock);
+		int32 bytes_read = decoder->Decode(&chunk.front(), MUSIC_BUFFER_SIZE);
+		SDL_LockMutex(decode_lock);
+
+		if (generation != decode_generation)
+			continue;
+
+		if (!bytes_read && next_decoder)
+		{
+			StreamDecoder *finished = decoder;
+			decoder = next_decoder;
+			next_decoder = 0;
+			++decode_handoffs;
+
+			SDL_UnlockMutex(decode_lock);
+			delete finished;
+			SDL_LockMutex(decode_lock);
+			continue;
+		}
+		else if (!bytes_read)
+		{
+			decode_ended = true;
+		}
+		else
+		{
+			size_t write_pos = (read_pos + read_fill) % read_ahead.size();
+			size_t first = std::min(static_cast<size_t>(bytes_read), read_ahead.size() - write_pos);
+			memcpy(&read_ahead[write_pos], &chunk.front(), first);
+			memcpy(&read_ahead.front(), &chunk.front() + first, bytes_read - first);
+			read_fill += bytes_read;
+		}
+		SDL_CondBroadcast(decode_cond);
+	}
+	SDL_UnlockMutex(decode_lock);
+}
+
 void Music::Play()
 {
 	if (!music_initialized || !SoundManager::instance()->IsInitialized() || !SoundManager::instance()->IsActive()) return;
+	if (decode_thread)
+	{
+		// give the decode thread a moment to get ahead
+		uint32 start = SDL_GetTicks();
+		SDL_LockMutex(decode_lock);
+		while (!read_fill && !decode_ended && SDL_GetTicks() - start < MUSIC_READ_AHEAD_MS)
+			SDL_CondWaitTimeout(decode_cond, decode_lock, MUSIC_READ_AHEAD_MS);
+		SDL_UnlockMutex(decode_lock);
+	}
+
 	if (FillBuffer()) {
 		// let the mixer handle it
 		Mixer::instance()->StartMusicChannel(sixteen_bit, stereo, signed_8bit, bytes_per_frame, rate, little_endian);
@@ -210,7 +363,31 @@ bool Music::FillBuffer()
 	if (!GetVolumeLevel()) return false;
 
 	if (!decoder) return false;
-	int32 bytes_read = decoder->Decode(&music_buffer.front(), MUSIC_BUFFER_SIZE);
+	int32 bytes_read;
+	if (decode_thread)
+	{
+		SDL_LockMutex(decode_lock);
+		bytes_read = std::min(read_fill, static_cast<size_t>(MUSIC_BUFFER_SIZE));
+		bytes_read -= bytes_read % bytes_per_frame;
+		size_t first = std::min(static_cast<size_t>(bytes_read), read_ahead.size() - read_pos);
+		memcpy(&music_buffer.front(), &read_ahead[read_pos], first);
+		memcpy(&music_buffer.front() + first, &read_ahead.front(), bytes_read - first);
+		read_pos = (read_pos + bytes_read) % read_ahead.size();
+		read_fill -= bytes_read;
+		bool ended = decode_ended;
+		SDL_CondBroadcast(decode_cond);
+		SDL_UnlockMutex(decode_lock);
+
+		if (!bytes_read && !ended)
+		{
+			// the decoder fell behind; a moment of silence beats stopping
+			bytes_read = MUSIC_BUFFER_SIZE - MUSIC_BUFFER_SIZE % bytes_per_frame;
+			memset(&music_buffer.front(), (sixteen_bit || signed_8bit) ? 0 : 0x80, bytes_read);
+		}
+	}
+	else
+		bytes_read = decoder->Decode(&music_buffer.front(), MUSIC_BUFFER_SIZE);
+
 	if (bytes_read)
 	{
 		Mixer::instance()->UpdateMusicChannel(&music_buffer.front(), bytes_read);
@@ -223,10 +400,41 @@ bool Music::FillBuffer()
 
 void Music::LoadLevelMusic()
 {
-	FileSpecifier* level_song_file = GetLevelMusic();
+	FileSpecifier* level_song_file;
+	if (has_next_file)
+	{
+		// it was picked already, but couldn't follow on
+		has_next_file = false;
+		level_song_file = &next_file;
+	}
+	else
+		level_song_file = GetLevelMusic();
 	Open(level_song_file);
 }
 
+void Music::PreloadNextSong()
+{
+	if (!decode_thread || has_next_file) return;
+
+	FileSpecifier* file = GetLevelMusic();
+	if (!file) return;
+	next_file = *file;
+	has_next_file = true;
+
+	StreamDecoder *next = StreamDecoder::Get(next_file);
+	if (next && next->IsSixteenBit() == sixteen_bit && next->IsStereo() == stereo && next->IsSigned() == signed_8bit && next->BytesPerFrame() == bytes_per_frame && next->IsLittleEndian() == little_endian && next->Rate() == decoder_rate)
+	{
+		SDL_LockMutex(decode_lock);
+		next_decoder = next;
+		SDL_UnlockMutex(decode_lock);
+	}
+	else
+	{
+		// the mixer would have to start over for it anyway
+		delete next;
+	}
+}
+
 void Music::SeedLevelMusic()
 {
 	song_number = 0;
@@ -272,6 +480,7 @@ void Music::StopLevelMusic()
 {
 	music_level = false;
 	music_play = false;
+	has_next_file = false;
 	Close();
 }
 
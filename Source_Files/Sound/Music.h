@@ -29,6 +29,7 @@
 #include "FileHandler.h"
 #include "Random.h"
 #include "SoundManager.h"
+#include <SDL_thread.h>
 #include <vector>
 
 class Music
@@ -57,7 +58,7 @@ public:
 
 	void PreloadLevelMusic();
 	void StopLevelMusic();
-	void ClearLevelMusic() { playlist.clear(); marathon_1_song_index = NONE; }
+	void ClearLevelMusic() { playlist.clear(); marathon_1_song_index = NONE; has_next_file = false; }
 	void PushBackLevelMusic(FileSpecifier& file) { playlist.push_back(file); }
 	bool IsLevelMusicActive() { return (!playlist.empty()); }
 	void LevelMusicRandom(bool fRandom) { random_order = fRandom; }
@@ -74,14 +75,41 @@ private:
 
 	FileSpecifier* GetLevelMusic();
 	void LoadLevelMusic();
+	// opens the song after this one, for the decode thread to go straight
+	// on to if it's in the same format
+	void PreloadNextSong();
 
 	int16 GetVolumeLevel() { return SoundManager::instance()->parameters.music; }
 
 	static const int MUSIC_BUFFER_SIZE = 1024;
+	// how far ahead of the mixer the decode thread keeps
+	static const int MUSIC_READ_AHEAD_MS = 500;
 
 	std::vector<uint8> music_buffer;
 	StreamDecoder *decoder;
 
+	// the decoder is only used by the decode thread while it runs; it
+	// fills read_ahead, and FillBuffer() empties it
+	void StartDecoding();
+	void StopDecoding();
+	static int DecodeThread(void *);
+	void Decode();
+
+	SDL_Thread *decode_thread;
+	SDL_mutex *decode_lock;
+	SDL_cond *decode_cond;
+	std::vector<uint8> read_ahead;
+	size_t read_pos;
+	size_t read_fill;
+	uint32 decode_generation;
+	bool decode_quit;
+	bool decode_rewind;
+	bool decode_ended;
+	// next_file's decoder, until the decode thread takes it over
+	StreamDecoder *next_decoder;
+	uint32 decode_handoffs;
+	uint32 handoffs_seen;
+
 	SDL_RWops* music_rw;
 
 	// info about the music's format
@@ -91,8 +119,12 @@ private:
 	int bytes_per_frame;
 	_fixed rate;
 	bool little_endian;
+	float decoder_rate;
 
 	FileSpecifier music_file;
+	// the song after this one, already taken from the playlist
+	FileSpecifier next_file;
+	bool has_next_file;
 	FileSpecifier music_intro_file;
 
 	bool music_initialized;
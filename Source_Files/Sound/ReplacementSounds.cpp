@@ -33,25 +33,32 @@ boost::shared_ptr<SoundData> ExternalSoundHeader::LoadExternal(FileSpecifier& Fi
 	std::unique_ptr<Decoder> decoder(Decoder::Get(File));
 	if (!decoder.get()) return p;
 
-	length = decoder->Frames() * decoder->BytesPerFrame();
+	return LoadExternal(*decoder);
+}
+
+boost::shared_ptr<SoundData> ExternalSoundHeader::LoadExternal(Decoder& decoder)
+{
+	boost::shared_ptr<SoundData> p;
+
+	length = decoder.Frames() * decoder.BytesPerFrame();
 	if (!length) return p;
 
 	p = boost::make_shared<SoundData>(length);
 
-	if (decoder->Decode(&(*p)[0], length) != length) 
+	if (decoder.Decode(&(*p)[0], length) != length) 
 	{
 		p.reset();
 		length = 0;
 		return p;
 	}
 	
-	sixteen_bit = decoder->IsSixteenBit();
-	stereo = decoder->IsStereo();
-	signed_8bit = decoder->IsSigned();
-	bytes_per_frame = decoder->BytesPerFrame();
-	little_endian = decoder->IsLittleEndian();
+	sixteen_bit = decoder.IsSixteenBit();
+	stereo = decoder.IsStereo();
+	signed_8bit = decoder.IsSigned();
+	bytes_per_frame = decoder.BytesPerFrame();
+	little_endian = decoder.IsLittleEndian();
 	loop_start = loop_end = 0;
-	rate = (uint32 /* unsigned fixed */) (FIXED_ONE * decoder->Rate());
+	rate = (uint32 /* unsigned fixed */) (FIXED_ONE * decoder.Rate());
 
 	return p;
 }
@@ -69,7 +76,151 @@ SoundOptions* SoundReplacements::GetSoundOptions(short Index, short Slot)
 	}
 }
 
+void SoundReplacements::Reset()
+{
+	// what was on its way no longer goes with the options
+	CancelLoadingExternal();
+	m_hash.clear();
+}
+
 void SoundReplacements::Add(const SoundOptions& Data, short Index, short Slot)
 {
 	m_hash[key(Index, Slot)] = Data;
 }
+
+bool SoundReplacements::LoadExternalAsync(short Index, short Slot)
+{
+	SoundOptions *SndOpts = GetSoundOptions(Index, Slot);
+	if (!SndOpts) return false;
+
+	if (!m_lock) m_lock = SDL_CreateMutex();
+	if (!m_cond) m_cond = SDL_CreateCond();
+	if (!m_lock || !m_cond) return false;
+
+	if (!m_thread)
+	{
+		m_quit = false;
+		m_thread = SDL_CreateThread(LoadThread, "SoundReplacements_loadThread", this);
+		if (!m_thread) return false;
+	}
+
+	// opened here, as it reports through the game errors; only the decoding
+	// happens on the thread
+	Decoder *decoder = Decoder::Get(SndOpts->File);
+	if (!decoder) return false;
+
+	LoadJob job;
+	job.Key = key(Index, Slot);
+	job.Source = decoder;
+
+	SDL_LockMutex(m_lock);
+	job.Generation = m_generation;
+	m_waiting.push_back(job);
+	m_loading.insert(job.Key);
+	SDL_CondBroadcast(m_cond);
+	SDL_UnlockMutex(m_lock);
+
+	return true;
+}
+
+bool SoundReplacements::IsLoadingExternal(short Index, short Slot)
+{
+	if (!m_lock) return false;
+
+	SDL_LockMutex(m_lock);
+	bool loading = m_loading.count(key(Index, Slot)) > 0;
+	SDL_UnlockMutex(m_lock);
+	return loading;
+}
+
+bool SoundReplacements::GetLoadedExternal(short& Index, short& Slot, ExternalSoundHeader& Header, boost::shared_ptr<SoundData>& Data)
+{
+	if (!m_lock) return false;
+
+	SDL_LockMutex(m_lock);
+	bool loaded = !m_loaded.empty();
+	if (loaded)
+	{
+		LoadJob& job = m_loaded.front();
+		Index = job.Key.first;
+		Slot = job.Key.second;
+		Header = job.Header;
+		Data = job.Data;
+		m_loading.erase(job.Key);
+		m_loaded.pop_front();
+	}
+	SDL_UnlockMutex(m_lock);
+	return loaded;
+}
+
+void SoundReplacements::CancelLoadingExternal()
+{
+	if (!m_lock) return;
+
+	std::deque<LoadJob> waiting;
+
+	SDL_LockMutex(m_lock);
+	++m_generation;
+	waiting.swap(m_waiting);
+	m_loaded.clear();
+	m_loading.clear();
+	SDL_UnlockMutex(m_lock);
+
+	// one being decoded now is dropped when it's done
+	for (std::deque<LoadJob>::iterator it = waiting.begin(); it != waiting.end(); ++it)
+	{
+		delete it->Source;
+	}
+}
+
+void SoundReplacements::StopLoadingExternal()
+{
+	CancelLoadingExternal();
+	if (m_thread)
+	{
+		SDL_LockMutex(m_lock);
+		m_quit = true;
+		SDL_CondBroadcast(m_cond);
+		SDL_UnlockMutex(m_lock);
+
+		SDL_WaitThread(m_thread, NULL);
+		m_thread = 0;
+	}
+}
+
+int SoundReplacements::LoadThread(void *p)
+{
+	static_cast<SoundReplacements *>(p)->Load();
+	return 0;
+}
+
+void SoundReplacements::Load()
+{
+	SDL_LockMutex(m_lock);
+	while (!m_quit)
+	{
+		if (m_waiting.empty())
+		{
+			SDL_CondWait(m_cond, m_lock);
+			continue;
+		}
+
+		LoadJob job = m_waiting.front();
+		m_waiting.pop_front();
+		SDL_UnlockMutex(m_lock);
+
+		job.Data = job.Header.LoadExternal(*job.Source);
+		delete job.Source;
+		job.Source = 0;
+
+		SDL_LockMutex(m_lock);
+		if (job.Generation != m_generation)
+			continue;
+
+		if (job.Data.get())
+			m_loaded.push_back(job);
+		else
+			m_loading.erase(job.Key);
+	}
+	SDL_UnlockMutex(m_lock);
+}
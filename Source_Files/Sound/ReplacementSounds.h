@@ -25,16 +25,25 @@
 */
 
 #include <string>
+#include <deque>
+#include <set>
 #include "SoundFile.h"
 
 #include <boost/unordered_map.hpp>
 
+#include <SDL_mutex.h>
+#include <SDL_thread.h>
+
+class Decoder;
+
 class ExternalSoundHeader : public SoundInfo
 {
 public:
 	ExternalSoundHeader() : SoundInfo() { }
 	~ExternalSoundHeader() { }
 	boost::shared_ptr<SoundData> LoadExternal(FileSpecifier& File);
+	// Decodes all of an opened file, filling in the header from it
+	boost::shared_ptr<SoundData> LoadExternal(Decoder& decoder);
 };
 
 struct SoundOptions
@@ -52,16 +61,49 @@ public:
 	}
 
 	SoundOptions *GetSoundOptions(short Index, short Slot);
-	void Reset() { m_hash.clear(); }
+	void Reset();
 	void Add(const SoundOptions& Data, short Index, short Slot);
 
+	// Opens the replacement for Index/Slot and decodes it on a thread of its own;
+	// false if it can't be opened, and then there's nothing to wait for
+	bool LoadExternalAsync(short Index, short Slot);
+	bool IsLoadingExternal(short Index, short Slot);
+
+	// Hands back a decode that has finished, with the header that goes with it
+	bool GetLoadedExternal(short& Index, short& Slot, ExternalSoundHeader& Header, boost::shared_ptr<SoundData>& Data);
+
+	// Drops the decodes not yet handed back
+	void CancelLoadingExternal();
+	void StopLoadingExternal();
+
 private:
-	SoundReplacements() { }
+	SoundReplacements() : m_thread(0), m_lock(0), m_cond(0), m_generation(0), m_quit(false) { }
 	static SoundReplacements *m_instance;
 
 	typedef std::pair<short, short> key;
 
 	boost::unordered_map<key, SoundOptions> m_hash;
+
+	struct LoadJob {
+		key Key;
+		Decoder *Source;
+		ExternalSoundHeader Header;
+		boost::shared_ptr<SoundData> Data;
+		uint32 Generation;
+	};
+
+	static int LoadThread(void *);
+	void Load();
+
+	SDL_Thread *m_thread;
+	SDL_mutex *m_lock;
+	SDL_cond *m_cond;
+
+	std::deque<LoadJob> m_waiting; // opened, not yet decoded
+	std::deque<LoadJob> m_loaded;
+	std::set<key> m_loading; // waiting, being decoded or loaded
+	uint32 m_generation;
+	bool m_quit;
 };
 
 #endif
@@ -187,6 +187,22 @@ boost::shared_ptr<SoundData> SoundHeader::LoadData(OpenedFile& SoundFile)
 	return LoadData(s);
 }
 
+bool SoundHeader::Load(const uint8 *data, int32 length)
+{
+	io::stream_buffer<io::array_source> sb(reinterpret_cast<const char*>(data), length);
+	BIStreamBE s(&sb);
+
+	return Load(s);
+}
+
+boost::shared_ptr<SoundData> SoundHeader::LoadData(const uint8 *data, int32 length)
+{
+	io::stream_buffer<io::array_source> sb(reinterpret_cast<const char*>(data), length);
+	BIStreamBE s(&sb);
+
+	return LoadData(s);
+}
+
 bool SoundHeader::Load(LoadedResource& rsrc)
 {
 	io::stream_buffer<io::array_source> sb(reinterpret_cast<char*>(rsrc.GetPointer()), rsrc.GetLength());
@@ -257,7 +273,8 @@ SoundDefinition::SoundDefinition() :
 	permutations(1),
 	permutations_played(0),
 	group_offset(0), single_length(0), total_length(0),
-	last_played(0)
+	last_played(0),
+	headers_loaded(false)
 {
 }
 
@@ -339,6 +356,38 @@ boost::shared_ptr<SoundData> SoundDefinition::LoadData(OpenedFile& SoundFile, sh
 	return sounds[permutation].LoadData(SoundFile);
 }
 
+bool SoundDefinition::Load(const uint8 *file_data, int32 file_length, bool LoadPermutations)
+{
+	if (LoadPermutations)
+		sounds.resize(permutations);
+	else 
+		sounds.resize(std::min(permutations, static_cast<int16>(1)));
+
+	for (int i = 0; i < sounds.size(); i++)
+	{
+		int32 offset = group_offset + sound_offsets[i];
+		if (offset < 0 || offset >= file_length
+		    || !sounds[i].Load(file_data + offset, file_length - offset))
+		{
+			sounds.clear();
+			return false;
+		}
+	}
+    
+	return true;
+}
+
+boost::shared_ptr<SoundData> SoundDefinition::LoadData(const uint8 *file_data, int32 file_length, short permutation)
+{
+	int32 offset = group_offset + sound_offsets[permutation];
+	if (offset < 0 || offset >= file_length)
+	{
+		return boost::shared_ptr<SoundData>();
+	}
+
+	return sounds[permutation].LoadData(file_data + offset, file_length - offset);
+}
+
 bool M2SoundFile::Open(FileSpecifier& SoundFileSpec)
 {
 	Close();
@@ -389,12 +438,16 @@ bool M2SoundFile::Open(FileSpecifier& SoundFileSpec)
 		}
 	}
 
-	// load all the headers
-	for (int source = 0; source < source_count; ++source) 
+	// the permutations' headers wait until each sound is first wanted (LoadHeaders())
+	int32 file_length;
+	if (sound_file->GetLength(file_length))
 	{
-		for (int i = 0; i < sound_count; ++i) 
+		mapped_file = sound_file->Map(0, file_length, mapped_base, mapped_base_length);
+		if (mapped_file)
 		{
-			sound_definitions[source][i].Load(*sound_file, true);
+			mapped_length = file_length;
+			SDL_AtomicSet(&stop_prefetch, 0);
+			prefetch_thread = SDL_CreateThread(PrefetchThread, "M2SoundFile_prefetchThread", this);
 		}
 	}
 
@@ -404,11 +457,49 @@ bool M2SoundFile::Open(FileSpecifier& SoundFileSpec)
 	return true;
 }
 
+int M2SoundFile::PrefetchThread(void *data)
+{
+	M2SoundFile *file = static_cast<M2SoundFile *>(data);
+	const int32 page_size = 4096;
+	volatile uint8 sum = 0;
+
+	for (int32 offset = 0; offset < file->mapped_length && !SDL_AtomicGet(&file->stop_prefetch); offset += page_size)
+	{
+		sum = sum + file->mapped_file[offset];
+	}
+
+	return 0;
+}
+
 void M2SoundFile::Close()
 {
+	if (prefetch_thread)
+	{
+		SDL_AtomicSet(&stop_prefetch, 1);
+		SDL_WaitThread(prefetch_thread, NULL);
+		prefetch_thread = 0;
+	}
+
+	OpenedFile::Unmap(mapped_base, mapped_base_length);
+	mapped_file = 0;
+	mapped_base = 0;
+	mapped_base_length = 0;
+	mapped_length = 0;
+
 	sound_definitions.clear();
 }
 
+void M2SoundFile::LoadHeaders(SoundDefinition* definition)
+{
+	if (definition->headers_loaded) return;
+	definition->headers_loaded = true;
+
+	if (mapped_file)
+		definition->Load(mapped_file, mapped_length, true);
+	else
+		definition->Load(*opened_sound_file, true);
+}
+
 SoundDefinition* M2SoundFile::GetSoundDefinition(int source, int sound_index)
 {
 	if (source < sound_definitions.size() && sound_index < sound_definitions[source].size())
@@ -417,8 +508,24 @@ SoundDefinition* M2SoundFile::GetSoundDefinition(int source, int sound_index)
 		return 0;
 }
 
+SoundHeader M2SoundFile::GetSoundHeader(SoundDefinition* definition, int permutation)
+{
+	LoadHeaders(definition);
+	if (permutation < 0 || permutation >= definition->sounds.size())
+		return SoundHeader();
+
+	return definition->sounds[permutation];
+}
+
 boost::shared_ptr<SoundData> M2SoundFile::GetSoundData(SoundDefinition* definition, int permutation)
 {
+	LoadHeaders(definition);
+	if (permutation < 0 || permutation >= definition->sounds.size())
+		return boost::shared_ptr<SoundData>();
+
+	if (mapped_file)
+		return definition->LoadData(mapped_file, mapped_length, permutation);
+
 	return definition->LoadData(*opened_sound_file, permutation);
 }
 
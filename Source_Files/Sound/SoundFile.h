@@ -26,6 +26,8 @@ SOUND_DEFINITIONS.H
 #include "AStream.h"
 #include "BStream.h"
 #include "FileHandler.h"
+#include <SDL_atomic.h>
+#include <SDL_thread.h>
 #include <memory>
 #include <vector>
 #include <map>
@@ -73,6 +75,9 @@ public:
 	bool Load(LoadedResource& rsrc); // finds system 7 header in rsrc
 	boost::shared_ptr<SoundData> LoadData(LoadedResource& rsrc);
 
+	bool Load(const uint8 *data, int32 length); // loads a system 7 header from memory
+	boost::shared_ptr<SoundData> LoadData(const uint8 *data, int32 length);
+
 	int32 Length() const
 		{ return length; };
 	
@@ -97,7 +102,10 @@ public:
 	bool Unpack(OpenedFile &SoundFile);
 	bool Load(OpenedFile &SoundFile, bool LoadPermutations);
 	boost::shared_ptr<SoundData> LoadData(OpenedFile& SoundFile, short permutation);
-	void Unload() { sounds.clear(); }
+	// the same, from a whole sounds file in memory
+	bool Load(const uint8 *file_data, int32 file_length, bool LoadPermutations);
+	boost::shared_ptr<SoundData> LoadData(const uint8 *file_data, int32 file_length, short permutation);
+	void Unload() { sounds.clear(); headers_loaded = false; }
 
 	static const int MAXIMUM_PERMUTATIONS_PER_SOUND = 5;
 
@@ -124,11 +132,13 @@ public: // for now
 	uint32 last_played; // machine ticks
 
 	std::vector<SoundHeader> sounds;
+	bool headers_loaded; // sounds has been loaded (or tried to be)
 };
 
 class SoundFile
 {
 public:
+	virtual ~SoundFile() { }
 	virtual bool Open(FileSpecifier& SoundFile) = 0;
 	virtual void Close() = 0;
 	virtual SoundDefinition* GetSoundDefinition(int source, int sound_index) = 0;
@@ -163,12 +173,13 @@ private:
 class M2SoundFile : public SoundFile
 {
 public:
+	M2SoundFile() : mapped_file(0), mapped_base(0), mapped_base_length(0), mapped_length(0), prefetch_thread(0) { }
+	~M2SoundFile() { Close(); }
+
 	bool Open(FileSpecifier &SoundFile);
 	void Close();
 	SoundDefinition* GetSoundDefinition(int source, int sound_index);
-	SoundHeader GetSoundHeader(SoundDefinition* definition, int permutation) { 
-		return definition->sounds[permutation];
-	}
+	SoundHeader GetSoundHeader(SoundDefinition* definition, int permutation);
 	boost::shared_ptr<SoundData> GetSoundData(SoundDefinition* definition, int permutation);
 
 	int SourceCount() { return source_count; }
@@ -186,6 +197,21 @@ private:
 
 	static int HeaderSize() { return 260; }
 	std::unique_ptr<OpenedFile> opened_sound_file;
+
+	// a definition's permutation headers are read the first time it's wanted
+	void LoadHeaders(SoundDefinition* definition);
+
+	// the whole file, when it can be mapped: sounds are copied straight out of it, and
+	// a thread touches every page of it once, so that by the time a sound is first
+	// played its samples are already in memory instead of on disk
+	uint8 *mapped_file;
+	void *mapped_base;
+	size_t mapped_base_length;
+	int32 mapped_length;
+
+	SDL_Thread *prefetch_thread;
+	SDL_atomic_t stop_prefetch;
+	static int PrefetchThread(void *data);
 };
 
 #endif
@@ -38,10 +38,14 @@ class SoundMemoryManager {
 public:
 	SoundMemoryManager(std::size_t max_size) : m_size(0), m_max_size(max_size) { }
 
-	void SetMaxSize(std::size_t max_size) { m_max_size = max_size; }
+	void SetMaxSize(std::size_t max_size);
+	std::size_t MaxSize() const { return m_max_size; }
 
 	void Add(boost::shared_ptr<SoundData> data, short index, short slot);
+	// a sound converted for the mixer, with the header that now goes with it
+	void Add(boost::shared_ptr<SoundData> data, const SoundInfo& header, short index, short slot);
 	boost::shared_ptr<SoundData> Get(short index, short slot) { return m_entries[index].data[slot]; }
+	bool GetHeader(short index, short slot, SoundInfo& header);
 	void Update(short index);
 	boost::function<void (short)> SoundReleased;
 
@@ -51,10 +55,14 @@ public:
 
 	void Clear() { m_entries.clear(); m_size = 0; }
 
+	std::size_t Size() const { return m_size; }
+
 private:
 	struct Entry {
-		Entry() : data(5), last_played(0) { }
+		Entry() : data(5), headers(5), converted(5, false), last_played(0) { }
 		std::vector<boost::shared_ptr<SoundData> > data;
+		std::vector<SoundInfo> headers;
+		std::vector<bool> converted;
 		uint32 last_played;
 
 		std::size_t size() {
@@ -78,8 +86,22 @@ private:
 	std::size_t m_max_size;
 };
 
+void SoundMemoryManager::SetMaxSize(std::size_t max_size)
+{
+	m_max_size = max_size;
+	while (m_size > m_max_size)
+	{
+		ReleaseOldestSound();
+	}
+}
+
 void SoundMemoryManager::Add(boost::shared_ptr<SoundData> data, short index, short slot)
 {
+	// a decoded replacement takes the place of what stood in for it
+	if (m_entries[index].data[slot].get())
+	{
+		m_size -= m_entries[index].data[slot]->size();
+	}
 	m_entries[index].data[slot] = data;
 	m_entries[index].last_played = machine_tick_count();
 
@@ -92,6 +114,25 @@ void SoundMemoryManager::Add(boost::shared_ptr<SoundData> data, short index, sho
 	}
 }
 
+void SoundMemoryManager::Add(boost::shared_ptr<SoundData> data, const SoundInfo& header, short index, short slot)
+{
+	m_entries[index].headers[slot] = header;
+	m_entries[index].converted[slot] = true;
+	Add(data, index, slot);
+}
+
+bool SoundMemoryManager::GetHeader(short index, short slot, SoundInfo& header)
+{
+	std::map<short, Entry>::iterator it = m_entries.find(index);
+	if (it == m_entries.end() || !it->second.converted[slot])
+	{
+		return false;
+	}
+
+	header = it->second.headers[slot];
+	return true;
+}
+
 void SoundMemoryManager::Release(short index)
 {
 	if (SoundReleased) 
@@ -183,6 +224,7 @@ void SoundManager::SetParameters(const Parameters& parameters)
 
 void SoundManager::Shutdown()
 {
+	SoundReplacements::instance()->StopLoadingExternal();
 	instance()->SetStatus(false);
 	instance()->CloseSoundFile();
 }
@@ -254,6 +296,11 @@ void SoundManager::TestVolume(short volume, short sound_index)
 	}
 }
 
+std::size_t SoundManager::MemoryUsage()
+{
+	return sounds ? sounds->Size() : 0;
+}
+
 bool SoundManager::LoadSound(short sound_index)
 {
 	if (active)
@@ -285,19 +332,22 @@ bool SoundManager::LoadSound(short sound_index)
 			{
 				boost::shared_ptr<SoundData> p = sound_file->GetSoundData(definition, i);
 
-				SoundOptions *SndOpts = SoundReplacements::instance()->GetSoundOptions(sound_index, i);
-				if (SndOpts)
+				// the original stands in while the replacement decodes (see
+				// AddExternalSounds()); with no original, the slot is silent till then
+				SoundReplacements *replacements = SoundReplacements::instance();
+				if (replacements->GetSoundOptions(sound_index, i) &&
+				    (replacements->IsLoadingExternal(sound_index, i) || replacements->LoadExternalAsync(sound_index, i)))
 				{
-					boost::shared_ptr<SoundData> x = SndOpts->Sound.LoadExternal(SndOpts->File);
-					if (x.get()) 
+					if (p.get())
 					{
-						p = x;
+						AddSound(p, sound_file->GetSoundHeader(definition, i), sound_index, i, true);
 					}
+					continue;
 				}
 
 				if (p.get())
 				{
-					sounds->Add(p, sound_index, i);
+					AddSound(p, sound_file->GetSoundHeader(definition, i), sound_index, i, false);
 				}
 			}
 		}
@@ -308,6 +358,46 @@ bool SoundManager::LoadSound(short sound_index)
 	return false;
 }
 
+void SoundManager::AddSound(boost::shared_ptr<SoundData> data, const SoundInfo& header, short sound_index, short slot, bool keep_header)
+{
+	if (parameters.flags & _convert_sounds_flag)
+	{
+		SoundInfo converted;
+		boost::shared_ptr<SoundData> c = Mixer::instance()->ConvertSound(header, *data, converted);
+		if (c.get())
+		{
+			sounds->Add(c, converted, sound_index, slot);
+			return;
+		}
+	}
+
+	// a stand-in keeps its own header, not the replacement's
+	if (keep_header)
+		sounds->Add(data, header, sound_index, slot);
+	else
+		sounds->Add(data, sound_index, slot);
+}
+
+void SoundManager::AddExternalSounds()
+{
+	short sound_index, slot;
+	ExternalSoundHeader header;
+	boost::shared_ptr<SoundData> data;
+	while (SoundReplacements::instance()->GetLoadedExternal(sound_index, slot, header, data))
+	{
+		SoundOptions *SndOpts = SoundReplacements::instance()->GetSoundOptions(sound_index, slot);
+		if (!SndOpts) continue;
+
+		SndOpts->Sound = header;
+
+		// dropped to keep within the budget since it was asked for: the next
+		// LoadSound() starts over
+		if (!sounds->IsLoaded(sound_index)) continue;
+
+		AddSound(data, header, sound_index, slot, true);
+	}
+}
+
 void SoundManager::LoadSounds(short *sounds, short count)
 {
 	for (short i = 0; i < count; i++)
@@ -337,6 +427,7 @@ void SoundManager::UnloadAllSounds()
 	if (active)
 	{
 		StopSound(NONE, NONE);
+		SoundReplacements::instance()->CancelLoadingExternal();
 		sounds->Clear();
 	}
 }
@@ -354,6 +445,11 @@ void SoundManager::PlaySound(short sound_index,
 
 		CalculateInitialSoundVariables(sound_index, source, variables, pitch);
 		
+		/* a sound too far away to hear shouldn't take a channel from one we
+		   can, nor be loaded and mixed */
+		if (source && !variables.volume)
+			return;
+
 		/* make sure the sound data is in memory */
 		if (LoadSound(sound_index))
 		{
@@ -486,6 +582,11 @@ void SoundManager::StopSound(short identifier, short sound_index)
 
 void SoundManager::Idle()
 {
+	if (active)
+	{
+		AddExternalSounds();
+	}
+
 	if (active && total_channel_count > 0)
 	{
 		UnlockLockedSounds();
@@ -601,6 +702,13 @@ void SoundManager::AddOneAmbientSoundSource(ambient_sound_data *ambient_sounds,
 					
 					if (source)
 					{
+						// sources that can't be heard shouldn't take up a slot
+						// another sound could use; the largest axis distance
+						// never exceeds the real one
+						int32 bound= MAX(ABS(int32(listener->point.x) - int32(source->point.x)), ABS(int32(listener->point.y) - int32(source->point.y)));
+						bound= MAX(bound, ABS(int32(listener->point.z) - int32(source->point.z)));
+						if (bound>=behavior->unobstructed_curve.minimum_volume_distance) return;
+						
 						distance= distance3d(&listener->point, &source->point);
 					}
 					
@@ -711,11 +819,56 @@ bool SoundManager::Parameters::Verify()
 	return true;
 }
 
-SoundManager::SoundManager() : active(false), initialized(false), sounds(new SoundMemoryManager(10 << 20)) 
+SoundManager::SoundManager() : active(false), initialized(false), low_memory(false), sounds(new SoundMemoryManager(10 << 20)) 
 { 
 	channels.resize(MAXIMUM_SOUND_CHANNELS + MAXIMUM_AMBIENT_SOUND_CHANNELS);
 }
 
+std::size_t SoundManager::CalculateMemoryBudget()
+{
+	std::size_t total_buffer_size;
+	if (parameters.flags & _more_sounds_flag)
+		total_buffer_size = MORE_SOUND_BUFFER_SIZE;
+	else
+		total_buffer_size = MINIMUM_SOUND_BUFFER_SIZE;
+	if (parameters.flags & _ambient_sound_flag)
+		total_buffer_size += AMBIENT_SOUND_BUFFER_SIZE;
+	if (parameters.flags & _16bit_sound_flag)
+		total_buffer_size *= 2;
+
+	total_buffer_size *= 2;
+	if (parameters.flags & _convert_sounds_flag)
+	{
+		// converted sounds are 16-bit at the output rate
+		if (!(parameters.flags & _16bit_sound_flag))
+			total_buffer_size *= 2;
+		if (parameters.rate > Parameters::DEFAULT_RATE)
+			total_buffer_size = static_cast<std::size_t>(static_cast<uint64_t>(total_buffer_size) * parameters.rate / Parameters::DEFAULT_RATE);
+	}
+	if (parameters.channel_count > 4)
+	{
+		total_buffer_size = total_buffer_size * parameters.channel_count / 4;
+	}
+
+	// the sounds a level keeps coming back to stay; the rest are loaded again
+	if (low_memory)
+		total_buffer_size /= 4;
+
+	return total_buffer_size;
+}
+
+void SoundManager::SetLowMemory(bool low_memory)
+{
+	this->low_memory = low_memory;
+	if (active)
+		sounds->SetMaxSize(CalculateMemoryBudget());
+}
+
+std::size_t SoundManager::MemoryBudget()
+{
+	return sounds->MaxSize();
+}
+
 void SoundManager::SetStatus(bool active)
 {
 	if (initialized)
@@ -724,31 +877,16 @@ void SoundManager::SetStatus(bool active)
 		{
 			if (active) 
 			{
-				uint32 total_buffer_size;
-
 				total_channel_count = parameters.channel_count;
 				if (parameters.flags & _ambient_sound_flag)
 					total_channel_count += MAXIMUM_AMBIENT_SOUND_CHANNELS;
 				int32 samples = parameters.samples;
-				if (parameters.flags & _more_sounds_flag)
-					total_buffer_size = MORE_SOUND_BUFFER_SIZE;
-				else
-					total_buffer_size = MINIMUM_SOUND_BUFFER_SIZE;
-				if (parameters.flags & _ambient_sound_flag)
-					total_buffer_size += AMBIENT_SOUND_BUFFER_SIZE;
 				if (parameters.flags & _16bit_sound_flag)
 				{
-					total_buffer_size *= 2;
 					samples *= 2;
 				}
 
-				total_buffer_size *= 2;
-				if (parameters.channel_count > 4)
-				{
-					total_buffer_size = total_buffer_size * parameters.channel_count / 4;
-				}
-
-				sounds->SetMaxSize(total_buffer_size);
+				sounds->SetMaxSize(CalculateMemoryBudget());
 				
 				if (parameters.flags & _stereo_flag)
 					samples *= 2;
@@ -760,7 +898,7 @@ void SoundManager::SetStatus(bool active)
 
 				samples = samples * parameters.rate / Parameters::DEFAULT_RATE;
 
-				Mixer::instance()->Start(parameters.rate, parameters.flags & _16bit_sound_flag, parameters.flags & _stereo_flag, MAXIMUM_SOUND_CHANNELS + MAXIMUM_AMBIENT_SOUND_CHANNELS, parameters.volume * SOUND_VOLUME_DELTA, samples);
+				Mixer::instance()->Start(parameters.rate, parameters.flags & _16bit_sound_flag, parameters.flags & _stereo_flag, MAXIMUM_SOUND_CHANNELS + MAXIMUM_AMBIENT_SOUND_CHANNELS, parameters.volume * SOUND_VOLUME_DELTA, samples, parameters.flags & _low_latency_audio_flag);
 
 				if (Mixer::instance()->SoundChannelCount() == 0)
 				{
@@ -807,7 +945,11 @@ void SoundManager::BufferSound(Channel &channel, short sound_index, _fixed pitch
 	SoundInfo header;
 
 	SoundOptions *SndOpts = SoundReplacements::instance()->GetSoundOptions(sound_index, permutation);
-	if (SndOpts && SndOpts->Sound.length)
+	if (sounds->GetHeader(sound_index, permutation, header))
+	{
+		// already converted for the mixer
+	}
+	else if (SndOpts && SndOpts->Sound.length)
 	{
 		header = SndOpts->Sound;
 	}
@@ -932,7 +1074,7 @@ void SoundManager::UnlockLockedSounds()
 	}
 }
 
-void SoundManager::CalculateSoundVariables(short sound_index, world_location3d *source, Channel::Variables& variables)
+void SoundManager::CalculateSoundVariables(short sound_index, world_location3d *source, Channel::Variables& variables, world_distance distance)
 {
 	SoundDefinition *definition = GetSoundDefinition(sound_index);
 	if (!definition) return;
@@ -941,7 +1083,8 @@ void SoundManager::CalculateSoundVariables(short sound_index, world_location3d *
 
 	if (source && listener)
 	{
-		world_distance distance = distance3d(&source->point, &listener->point);
+		if (distance == NONE)
+			distance = distance3d(&source->point, &listener->point);
 		
 		// LP change: made this long-distance friendly
 		int32 dx = int32(listener->point.x) - int32(source->point.x);
@@ -1088,18 +1231,34 @@ void SoundManager::TrackStereoSounds()
 {
 	if (active && total_channel_count > 0 && (parameters.flags & _dynamic_tracking_flag))
 	{
+		// find every tracked channel's distance to the listener together
+		Channel *tracked[MAXIMUM_SOUND_CHANNELS];
+		world_point3d points[MAXIMUM_SOUND_CHANNELS];
+		world_distance distances[MAXIMUM_SOUND_CHANNELS];
+		int tracked_count = 0;
 		for (int i = 0; i < parameters.channel_count; i++)
 		{
 			Channel *channel = &channels[i];
 			if (SLOT_IS_USED(channel) && !Mixer::instance()->ChannelBusy(channel->mixer_channel) && !(channel->flags & _sound_is_local))
 			{
-				Channel::Variables variables = channel->variables;
 				if (channel->dynamic_source) 
 					channel->source = *channel->dynamic_source;
-				CalculateSoundVariables(channel->sound_index, &channel->source, variables);
-				InstantiateSoundVariables(variables, *channel, false);
+				points[tracked_count] = channel->source.point;
+				tracked[tracked_count++] = channel;
 			}
 		}
+		if (tracked_count == 0) return;
+
+		world_location3d *listener = _sound_listener_proc();
+		if (listener)
+			distance3d_batch(&listener->point, points, tracked_count, distances);
+
+		for (int i = 0; i < tracked_count; i++)
+		{
+			Channel::Variables variables = tracked[i]->variables;
+			CalculateSoundVariables(tracked[i]->sound_index, &tracked[i]->source, variables, listener ? distances[i] : NONE);
+			InstantiateSoundVariables(variables, *tracked[i], false);
+		}
 	}
 }
 
@@ -1380,21 +1539,21 @@ void parse_mml_sounds(const InfoTree& root)
 	root.read_attr("ogl_reset", _Sound_OGL_Reset);
 	root.read_attr("center_button", _Sound_Center_Button);
 	
-	BOOST_FOREACH(InfoTree ambient, root.children_named("ambient"))
+	BOOST_FOREACH(const InfoTree &ambient, root.children_named("ambient"))
 	{
 		int16 index;
 		if (!ambient.read_indexed("index", index, NUMBER_OF_AMBIENT_SOUND_DEFINITIONS))
 			continue;
 		ambient.read_indexed("sound", ambient_sound_definitions[index].sound_index, SHRT_MAX+1, true);
 	}
-	BOOST_FOREACH(InfoTree random, root.children_named("random"))
+	BOOST_FOREACH(const InfoTree &random, root.children_named("random"))
 	{
 		int16 index;
 		if (!random.read_indexed("index", index, NUMBER_OF_RANDOM_SOUND_DEFINITIONS))
 			continue;
 		random.read_indexed("sound", random_sound_definitions[index].sound_index, SHRT_MAX+1, true);
 	}
-	BOOST_FOREACH(InfoTree dialog, root.children_named("dialog"))
+	BOOST_FOREACH(const InfoTree &dialog, root.children_named("dialog"))
 	{
 		int16 index;
 		if (!dialog.read_indexed("index", index, number_of_dialog_sounds()))
@@ -64,6 +64,13 @@ public:
 
 	void UnloadAllSounds();
 
+	// Bytes the loaded sounds hold
+	std::size_t MemoryUsage();
+	// The most they may hold before the least recently played are dropped
+	std::size_t MemoryBudget();
+	// A quarter of the usual budget, for constrained devices
+	void SetLowMemory(bool low_memory);
+
 	void PlaySound(short sound_index, world_location3d *source, short identifier, _fixed pitch = _normal_frequency);
 	void PlayLocalSound(short sound_index, _fixed pitch = _normal_frequency) { PlaySound(sound_index, 0, NONE, pitch); }
 	void DirectPlaySound(short sound_index, angle direction, short volume, _fixed pitch);
@@ -143,16 +150,24 @@ public:
 private:
 	SoundManager();
 	void SetStatus(bool active);
+	std::size_t CalculateMemoryBudget();
 
 	SoundDefinition* GetSoundDefinition(short sound_index);
 	void BufferSound(Channel &, short sound_index, _fixed pitch, bool ext_play_immed = true);
 
+	// converted for the mixer if it's to be; keep_header stores the header with
+	// it, where it mustn't be taken from the replacement options
+	void AddSound(boost::shared_ptr<SoundData> data, const SoundInfo& header, short sound_index, short slot, bool keep_header);
+	// replacement sounds whose decodes have finished, in place of their stand-ins
+	void AddExternalSounds();
+
 	Channel *BestChannel(short sound_index, Channel::Variables& variables);
 	void FreeChannel(Channel &);
 
 	void UnlockLockedSounds();
 
-	void CalculateSoundVariables(short sound_index, world_location3d *source, Channel::Variables& variables);
+	// distance is from source to the listener, if the caller already knows it
+	void CalculateSoundVariables(short sound_index, world_location3d *source, Channel::Variables& variables, world_distance distance = NONE);
 	void CalculateInitialSoundVariables(short sound_index, world_location3d *source, Channel::Variables& variables, _fixed pitch);
 	void InstantiateSoundVariables(Channel::Variables& variables, Channel& channel, bool first_time);
 
@@ -168,6 +183,7 @@ private:
 
 	bool initialized;
 	bool active;
+	bool low_memory;
 
 	short total_channel_count;
 
@@ -379,7 +379,9 @@ enum // initialization flags (some of these are used by the prefs, which fixes t
 	_relative_volume_flag = 0x0040, /* LP: Ian Rickard's relative-volume flag [prefs] */
 	_extra_memory_flag= 0x0100, /* double usual memory */
 	_extra_extra_memory_flag= 0x0200, /* LP: quadruple usual memory, because RAM is more available */
-	_zero_restart_delay = 0x0400 /* ghs: restart sounds immediately */
+	_zero_restart_delay = 0x0400, /* ghs: restart sounds immediately */
+	_convert_sounds_flag = 0x0800, /* converts sounds to the mixer's format as they load */
+	_low_latency_audio_flag = 0x1000 /* uses the smallest audio buffer the mixer keeps up with */
 };
 
 enum // _sound_obstructed_proc() flags
@@ -41,6 +41,9 @@
 #include <winsock2.h> // hacky non-cross-platform setting of nonblocking
 #else
 #include <fcntl.h> // hacky non-cross-platform setting of nonblocking
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #endif
 #include <algorithm>
 
@@ -54,10 +57,14 @@ enum
 
 	// Milliseconds we wait between pump() calls during flushOutgoingMessages()
 	kFlushPumpInterval = kSSRPumpInterval,
+
+	// Most queued messages handed to TCP in one sendmsg()
+	kMaximumGatheredMessages = 16,
 };
 
-// if you really want to read what this does, scroll down
+// if you really want to read what these do, scroll down
 static void MakeTCPsocketNonBlocking(TCPsocket *socket); 
+static int TCPsocketDescriptor(TCPsocket socket);
 
 CommunicationsChannel::CommunicationsChannel()
 	: mConnected(false),
@@ -68,6 +75,7 @@ CommunicationsChannel::CommunicationsChannel()
 	mIncomingHeaderPosition(0),
 	mIncomingMessage(NULL),
 	mIncomingMessagePosition(0),
+	mIncomingMessageIsBorrowed(false),
 	mOutgoingHeaderPosition(0),
 	mOutgoingMessagePosition(0)
 {
@@ -86,6 +94,7 @@ CommunicationsChannel::CommunicationsChannel(TCPsocket inSocket)
 	mIncomingHeaderPosition(0),
 	mIncomingMessage(NULL),
 	mIncomingMessagePosition(0),
+	mIncomingMessageIsBorrowed(false),
 	mOutgoingHeaderPosition(0),
 	mOutgoingMessagePosition(0)
 {
@@ -247,8 +256,14 @@ CommunicationsChannel::receiveHeader()
 		}
 		else
 		{
-			// Successfully received a valid header; switch to receive-message mode
-			mIncomingMessage = new UninflatedMessage(theMessageType, theMessageLength);
+			// Successfully received a valid header; switch to receive-message mode.
+			// Small messages that will be inflated (copying what they need) can
+			// use our buffer; bigger ones get their own, which they can keep.
+			mIncomingMessageIsBorrowed = (mMessageInflater != NULL && theMessageLength <= kIncomingBufferSize);
+			if(mIncomingMessageIsBorrowed)
+				mIncomingMessage = new UninflatedMessage(theMessageType, theMessageLength, mIncomingBuffer, true);
+			else
+				mIncomingMessage = new UninflatedMessage(theMessageType, theMessageLength);
 			mIncomingMessagePosition = 0;
 		}
 
@@ -277,7 +292,13 @@ CommunicationsChannel::_receiveMessage()
 
 		if(mMessageInflater != NULL)
 		{
-			theMessageToEnqueue = mMessageInflater->inflate(*mIncomingMessage);
+			theMessageToEnqueue = mMessageInflater->inflateTaking(*mIncomingMessage);
+			delete mIncomingMessage;
+		}
+		else if(mIncomingMessageIsBorrowed)
+		{
+			// inflater went away while we were receiving; the next message needs our buffer
+			theMessageToEnqueue = mIncomingMessage->clone();
 			delete mIncomingMessage;
 		}
 
@@ -372,12 +393,108 @@ CommunicationsChannel::pumpReceivingSide()
 
 
 
+#if !defined(WIN32)
+// Sends the headers and bodies of as many queued messages as TCP will take, with
+// one system call, rather than a header and a body at a time
+bool
+CommunicationsChannel::sendGatheredMessages()
+{
+	Uint8 theHeaders[kMaximumGatheredMessages][kHeaderPackedSize];
+	struct iovec theVectors[2 * kMaximumGatheredMessages];
+	int theVectorCount = 0;
+	size_t theTotalLength = 0;
+
+	int theMessageCount = 0;
+	for(UninflatedMessageQueue::iterator i = mOutgoingMessages.begin(); i != mOutgoingMessages.end() && theMessageCount < kMaximumGatheredMessages; ++i, ++theMessageCount)
+	{
+		UninflatedMessage* theMessage = *i;
+		AOStreamBE theHeaderStream(theHeaders[theMessageCount], kHeaderPackedSize);
+		theHeaderStream << (Uint16)kHeaderMagic
+			<< theMessage->inflatedType()
+			<< (uint32)(theMessage->length() + kHeaderPackedSize);
+
+		// Only the message at the front can be partly sent already
+		size_t theHeaderPosition = (theMessageCount == 0) ? mOutgoingHeaderPosition : 0;
+		size_t theMessagePosition = (theMessageCount == 0 && mOutgoingHeaderPosition == kHeaderPackedSize) ? mOutgoingMessagePosition : 0;
+
+		if(theHeaderPosition < kHeaderPackedSize)
+		{
+			theVectors[theVectorCount].iov_base = theHeaders[theMessageCount] + theHeaderPosition;
+			theVectors[theVectorCount].iov_len = kHeaderPackedSize - theHeaderPosition;
+			theTotalLength += theVectors[theVectorCount++].iov_len;
+		}
+		if(theMessagePosition < theMessage->length())
+		{
+			theVectors[theVectorCount].iov_base = theMessage->buffer() + theMessagePosition;
+			theVectors[theVectorCount].iov_len = theMessage->length() - theMessagePosition;
+			theTotalLength += theVectors[theVectorCount++].iov_len;
+		}
+	}
+
+	struct msghdr theMessageHeader;
+	memset(&theMessageHeader, 0, sizeof(theMessageHeader));
+	theMessageHeader.msg_iov = theVectors;
+	theMessageHeader.msg_iovlen = theVectorCount;
+
+	int theFlags = 0;
+#ifdef MSG_NOSIGNAL
+	theFlags |= MSG_NOSIGNAL;
+#endif
+	ssize_t theResult = sendmsg(TCPsocketDescriptor(mSocket), &theMessageHeader, theFlags);
+	if(theResult < 0)
+	{
+		if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			return false;
+
+		disconnect();
+		return false;
+	}
+
+	if(theResult > 0)
+		mTicksAtLastSend = SDL_GetTicks();
+
+	// Account for what went out, retiring finished messages
+	size_t theBytesLeft = theResult;
+	while(!mOutgoingMessages.empty())
+	{
+		UninflatedMessage* theMessage = mOutgoingMessages.front();
+		if(mOutgoingHeaderPosition < kHeaderPackedSize)
+		{
+			size_t theHeaderBytes = std::min(theBytesLeft, kHeaderPackedSize - mOutgoingHeaderPosition);
+			mOutgoingHeaderPosition += theHeaderBytes;
+			theBytesLeft -= theHeaderBytes;
+			if(mOutgoingHeaderPosition < kHeaderPackedSize)
+				break;
+			mOutgoingMessagePosition = 0;
+		}
+
+		size_t theMessageBytes = std::min(theBytesLeft, theMessage->length() - mOutgoingMessagePosition);
+		mOutgoingMessagePosition += theMessageBytes;
+		theBytesLeft -= theMessageBytes;
+		if(mOutgoingMessagePosition < theMessage->length())
+			break;
+
+		delete theMessage;
+		mOutgoingMessages.pop_front();
+		mOutgoingHeaderPosition = 0;
+	}
+
+	// If TCP took everything we offered, there may be room for more
+	return static_cast<size_t>(theResult) == theTotalLength;
+}
+#endif
+
+
+
 void
 CommunicationsChannel::pumpSendingSide()
 {
 	bool keepGoing = true;
 	while(keepGoing && mConnected && !mOutgoingMessages.empty())
 	{
+#if !defined(WIN32)
+		keepGoing = sendGatheredMessages();
+#else
 		if(mOutgoingHeaderPosition == 0)
 		{
 			// Need to fill packed header buffer with packed header
@@ -398,6 +515,7 @@ CommunicationsChannel::pumpSendingSide()
 		{
 			keepGoing = sendMessage();
 		}
+#endif
 	}
 }
 
@@ -410,6 +528,69 @@ CommunicationsChannel::pump()
 	pumpReceivingSide();
 }
 
+void
+CommunicationsChannel::multiplePump(std::vector<CommunicationsChannel*>& channels, Uint32 inTimeout)
+{
+#if defined(WIN32)
+	// Readiness to send isn't something SDL_net can tell us; wait for incoming
+	// data only, then pump everyone
+	SDLNet_SocketSet theSocketSet = SDLNet_AllocSocketSet(channels.size());
+	bool someoneHasOutgoingMessages = false;
+	for(std::vector<CommunicationsChannel*>::iterator it = channels.begin(); it != channels.end(); ++it)
+	{
+		if((*it)->isConnected())
+		{
+			SDLNet_TCP_AddSocket(theSocketSet, (*it)->mSocket);
+			if(!(*it)->mOutgoingMessages.empty())
+				someoneHasOutgoingMessages = true;
+		}
+	}
+	SDLNet_CheckSockets(theSocketSet, someoneHasOutgoingMessages ? 0 : inTimeout);
+	SDLNet_FreeSocketSet(theSocketSet);
+
+	for(std::vector<CommunicationsChannel*>::iterator it = channels.begin(); it != channels.end(); ++it)
+		(*it)->pump();
+#else
+	std::vector<struct pollfd> theDescriptors;
+	std::vector<CommunicationsChannel*> thePolledChannels;
+	theDescriptors.reserve(channels.size());
+	thePolledChannels.reserve(channels.size());
+	for(std::vector<CommunicationsChannel*>::iterator it = channels.begin(); it != channels.end(); ++it)
+	{
+		if(!(*it)->isConnected())
+			continue;
+
+		struct pollfd theDescriptor;
+		theDescriptor.fd = TCPsocketDescriptor((*it)->mSocket);
+		theDescriptor.events = POLLIN;
+		if(!(*it)->mOutgoingMessages.empty())
+			theDescriptor.events |= POLLOUT;
+		theDescriptor.revents = 0;
+		theDescriptors.push_back(theDescriptor);
+		thePolledChannels.push_back(*it);
+	}
+
+	if(theDescriptors.empty())
+	{
+		SDL_Delay(inTimeout);
+		return;
+	}
+
+	if(poll(&theDescriptors[0], theDescriptors.size(), inTimeout) <= 0)
+		return;
+
+	for(size_t i = 0; i < theDescriptors.size(); i++)
+	{
+		// Errors and hangups are found out by trying
+		short theEvents = theDescriptors[i].revents;
+		if(theEvents & (POLLOUT | POLLERR | POLLHUP))
+			thePolledChannels[i]->pumpSendingSide();
+		if(theEvents & (POLLIN | POLLERR | POLLHUP | POLLNVAL))
+			thePolledChannels[i]->pumpReceivingSide();
+	}
+#endif
+}
+
 bool CommunicationsChannel::dispatchOneIncomingMessage() 
 {
   if (mIncomingMessages.empty()) return false;
@@ -538,13 +719,13 @@ CommunicationsChannel::receiveMessage(Uint32 inOverallTimeout, Uint32 inInactivi
 
 	pump();
 
+	std::vector<CommunicationsChannel*> theChannels(1, this);
 	while(SDL_GetTicks() - std::max(mTicksAtLastReceive, theTicksAtStart) < inInactivityTimeout
 		&& SDL_GetTicks() < theDeadline
 		&& isConnected()
 		&& mIncomingMessages.empty())
 	{
-		SDL_Delay(kSSRPumpInterval);
-		pump();
+		multiplePump(theChannels, kSSRPumpInterval);
 	}
 
 	Message* theMessage = NULL;
@@ -609,13 +790,13 @@ CommunicationsChannel::flushOutgoingMessages(bool shouldDispatchIncomingMessages
 	Uint32	theDeadline = SDL_GetTicks() + inOverallTimeout;
 	Uint32	theTicksAtStart = SDL_GetTicks();
 
+	std::vector<CommunicationsChannel*> theChannels(1, this);
 	while(isConnected()
 		&& !mOutgoingMessages.empty()
 		&& SDL_GetTicks() < theDeadline
 		&& SDL_GetTicks() - std::max(mTicksAtLastSend, theTicksAtStart) < inInactivityTimeout)
 	{
-		SDL_Delay(kFlushPumpInterval);
-		pump();
+		multiplePump(theChannels, kFlushPumpInterval);
 		if(shouldDispatchIncomingMessages)
 			dispatchIncomingMessages();
 	}
@@ -637,7 +818,7 @@ void CommunicationsChannel::multipleFlushOutgoingMessages(
 	{
 		someoneIsStillActive = false;
 
-		SDL_Delay(kFlushPumpInterval);
+		multiplePump(channels, kFlushPumpInterval);
 
 		for (std::vector<CommunicationsChannel*>::iterator it = channels.begin(); it != channels.end(); it++)
 		{
@@ -646,7 +827,6 @@ void CommunicationsChannel::multipleFlushOutgoingMessages(
 				someoneIsStillActive = true;
 			}
 
-			(*it)->pump();
 			if (shouldDispatchIncomingMessages)
 				(*it)->dispatchIncomingMessages();
 		}
@@ -663,6 +843,12 @@ CommunicationsChannelFactory::CommunicationsChannelFactory(uint16 inPort)
 	theAddress.port = SDL_SwapBE16(inPort);
 
 	mSocket = SDLNet_TCP_Open(&theAddress);
+	mSocketSet = NULL;
+	if(mSocket != NULL)
+	{
+		mSocketSet = SDLNet_AllocSocketSet(1);
+		SDLNet_TCP_AddSocket(mSocketSet, mSocket);
+	}
 }
 
 
@@ -674,16 +860,13 @@ CommunicationsChannelFactory::newIncomingConnection()
 	
 	if(isFunctional())
 	{
-		SDLNet_SocketSet theSocketSet = SDLNet_AllocSocketSet(1);
-		SDLNet_TCP_AddSocket(theSocketSet, mSocket);
-		if(SDLNet_CheckSockets(theSocketSet, 0) > 0) {
+		if(SDLNet_CheckSockets(mSocketSet, 0) > 0) {
 			// Yee-haw!  There's an incoming connection request.
 			TCPsocket theNewSocket = SDLNet_TCP_Accept(mSocket);
 			theNewChannel = new CommunicationsChannel(theNewSocket);
 			MakeTCPsocketNonBlocking(&theNewSocket);
 
 		}
-		SDLNet_FreeSocketSet(theSocketSet);
 	}
 
 	return theNewChannel;
@@ -693,15 +876,20 @@ CommunicationsChannelFactory::newIncomingConnection()
 
 CommunicationsChannelFactory::~CommunicationsChannelFactory()
 {
+	if(mSocketSet != NULL)
+		SDLNet_FreeSocketSet(mSocketSet);
 	SDLNet_TCP_Close(mSocket);
 }
 
+// XXX: this depends on intimate carnal knowledge of the SDL_net struct _TCPsocket
+// if it changes that structure, we are hosed.
+int TCPsocketDescriptor(TCPsocket socket) {
+  return ((int *) socket)[1];
+}
+
 void MakeTCPsocketNonBlocking(TCPsocket *socket) {
   // SET NONBLOCKING MODE
-  // XXX: this depends on intimate carnal knowledge of the SDL_net struct _UDPsocket
-  // if it changes that structure, we are hosed.
-  
-  int fd = ((int *) (*socket))[1];
+  int fd = TCPsocketDescriptor(*socket);
 #if defined(WIN32)
   u_long val = 1;
   ioctlsocket(fd, FIONBIO, &val);
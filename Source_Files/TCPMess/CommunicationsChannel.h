@@ -89,6 +89,11 @@ public:
 	// Moves data around but does not callback handlers
 	void		pump();
 
+	// As above, for many channels at once: waits up to inTimeout ms for any of
+	// them to be ready, then moves data only on those that are, so a slow peer
+	// doesn't hold up the rest
+	static void	multiplePump(std::vector<CommunicationsChannel*>& channels, Uint32 inTimeout = 0);
+
 	// Calls back message handler (if appropriate)
 	// returns false if there are no messages to dispatch
 	bool            dispatchOneIncomingMessage();
@@ -207,6 +212,7 @@ private:
 	void		pumpSendingSide();
 	bool		sendHeader();
 	bool		sendMessage();
+	bool		sendGatheredMessages();
 
 
 	bool		mConnected;
@@ -220,6 +226,10 @@ private:
 	{
 		kHeaderPackedSize = 8,
 		kHeaderMagic = 0xDEAD,
+
+		// Messages no longer than this are received into mIncomingBuffer,
+		// and so cost no allocation of their own until they're inflated
+		kIncomingBufferSize = 4 * 1024,
 	};
 
 	Uint8		mIncomingHeader[kHeaderPackedSize];
@@ -227,6 +237,8 @@ private:
 
 	UninflatedMessage* mIncomingMessage;
 	size_t		mIncomingMessagePosition;
+	bool		mIncomingMessageIsBorrowed;	// its buffer is mIncomingBuffer
+	Uint8		mIncomingBuffer[kIncomingBufferSize];
 
 	Uint32		mTicksAtLastReceive;
 
@@ -256,6 +268,7 @@ public:
 	
 private:
 	TCPsocket	mSocket;
+	SDLNet_SocketSet mSocketSet;	// just mSocket, for checking it without blocking
 };
 
 #endif // COMMUNICATIONSCHANNEL_H
@@ -30,17 +30,104 @@
 #include "Message.h"
 
 #include <string.h>	// memcpy
-#include <vector>
+#include <stdlib.h>	// malloc
+#include <new>		// std::bad_alloc
 
 #include "AStream.h"
+#include <SDL_atomic.h>
 
 
 
 enum
 {
-	kSmallMessageBufferSize = 4 * 1024
+	kSmallMessageBufferSize = 4 * 1024,
+
+	// Freed messages up to kLargestPooledMessage bytes are kept for reuse, in
+	// lists by size (rounded up to kPooledMessageGranularity); each list keeps
+	// at most kMaximumPooledMessagesPerSize of them
+	kPooledMessageGranularity = 16,
+	kLargestPooledMessage = 256,
+	kMaximumPooledMessagesPerSize = 64,
+	kNumberOfMessagePools = kLargestPooledMessage / kPooledMessageGranularity
 };
 
+struct PooledMessage
+{
+	PooledMessage* mNext;
+};
+
+static PooledMessage* sMessagePools[kNumberOfMessagePools];
+static int sMessagePoolSizes[kNumberOfMessagePools];
+// Messages are mostly made and done with on the main thread, but not always
+static SDL_SpinLock sMessagePoolLock = 0;
+
+static inline int
+message_pool_for_size(size_t inSize)
+{
+	return (inSize > 0 && inSize <= kLargestPooledMessage) ? (inSize - 1) / kPooledMessageGranularity : -1;
+}
+
+void*
+Message::operator new(size_t inSize)
+{
+	int thePool = message_pool_for_size(inSize);
+	if(thePool >= 0)
+	{
+		PooledMessage* theMessage = NULL;
+		SDL_AtomicLock(&sMessagePoolLock);
+		if(sMessagePools[thePool] != NULL)
+		{
+			theMessage = sMessagePools[thePool];
+			sMessagePools[thePool] = theMessage->mNext;
+			sMessagePoolSizes[thePool]--;
+		}
+		SDL_AtomicUnlock(&sMessagePoolLock);
+
+		if(theMessage != NULL)
+			return theMessage;
+
+		// allocate the whole size class, so it can go back to any list entry
+		inSize = (thePool + 1) * kPooledMessageGranularity;
+	}
+
+	void* theMemory = malloc(inSize);
+	if(theMemory == NULL)
+		throw std::bad_alloc();
+	return theMemory;
+}
+
+void
+Message::operator delete(void* inMemory, size_t inSize)
+{
+	if(inMemory == NULL)
+		return;
+
+	int thePool = message_pool_for_size(inSize);
+	if(thePool >= 0)
+	{
+		SDL_AtomicLock(&sMessagePoolLock);
+		if(sMessagePoolSizes[thePool] < kMaximumPooledMessagesPerSize)
+		{
+			PooledMessage* theMessage = static_cast<PooledMessage*>(inMemory);
+			theMessage->mNext = sMessagePools[thePool];
+			sMessagePools[thePool] = theMessage;
+			sMessagePoolSizes[thePool]++;
+			inMemory = NULL;
+		}
+		SDL_AtomicUnlock(&sMessagePoolLock);
+	}
+
+	free(inMemory);
+}
+
+
+
+bool
+Message::inflateFromTaking(UninflatedMessage& ioUninflated)
+{
+	return inflateFrom(ioUninflated);
+}
+
 bool
 SmallMessageHelper::inflateFrom(const UninflatedMessage& inUninflated)
 {
@@ -53,11 +140,11 @@ SmallMessageHelper::inflateFrom(const UninflatedMessage& inUninflated)
 UninflatedMessage*
 SmallMessageHelper::deflate() const
 {
-	std::vector<byte> theBuffer(kSmallMessageBufferSize);
-	AOStreamBE	theStream(&(theBuffer[0]), theBuffer.size());
+	byte theBuffer[kSmallMessageBufferSize];
+	AOStreamBE	theStream(theBuffer, sizeof(theBuffer));
 	reallyDeflateTo(theStream);
 	UninflatedMessage* theDeflatedMessage = new UninflatedMessage(type(), theStream.tellp());
-	memcpy(theDeflatedMessage->buffer(), &(theBuffer[0]), theDeflatedMessage->length());
+	memcpy(theDeflatedMessage->buffer(), theBuffer, theDeflatedMessage->length());
 	return theDeflatedMessage;
 }
 
@@ -80,6 +167,22 @@ BigChunkOfDataMessage::inflateFrom(const UninflatedMessage& inUninflated)
 
 
 
+bool
+BigChunkOfDataMessage::inflateFromTaking(UninflatedMessage& ioUninflated)
+{
+	size_t theLength = ioUninflated.length();
+	Uint8* theBuffer = (theLength > 0) ? ioUninflated.releaseBuffer() : NULL;
+	if(theBuffer == NULL)
+		return inflateFrom(ioUninflated);
+
+	delete [] mBuffer;
+	mBuffer = theBuffer;
+	mLength = theLength;
+	return true;
+}
+
+
+
 UninflatedMessage*
 BigChunkOfDataMessage::deflate() const
 {
@@ -43,6 +43,9 @@ public:
 	// May return false or raise an exception on failed inflation
 	virtual	bool			inflateFrom(const UninflatedMessage& inUninflated) = 0;
 
+	// As above, but may take ioUninflated's buffer rather than copy it
+	virtual	bool			inflateFromTaking(UninflatedMessage& ioUninflated);
+
 	// Caller must dispose of returned message via 'delete'
 	virtual	UninflatedMessage*	deflate() const = 0;
 
@@ -50,6 +53,10 @@ public:
 
 	virtual ~Message() {}
 
+	// Messages come and go all the time; freed ones are kept by size and reused
+	static void*	operator new(size_t inSize);
+	static void	operator delete(void* inMemory, size_t inSize);
+
 protected:
 };
 
@@ -60,14 +67,18 @@ class UninflatedMessage : public Message
 public:
 	enum { kTypeID = 0xffff };
 
-	// If bytes are provided, this object takes ownership of them (does not copy).
+	// If bytes are provided, this object takes ownership of them (does not copy),
+	//    unless inBorrowed, in which case they must outlive it.
 	// If no bytes are provided, this object creates a buffer of size inLength.
 	//    Clients should write into the pointer returned by buffer().
-	UninflatedMessage(MessageTypeID inType, size_t inLength, Uint8* inBytes = NULL)
-		: mType(inType), mLength(inLength), mBuffer(inBytes)
+	UninflatedMessage(MessageTypeID inType, size_t inLength, Uint8* inBytes = NULL, bool inBorrowed = false)
+		: mType(inType), mLength(inLength), mBuffer(inBytes), mOwnsBuffer(!inBorrowed)
 	{
 		if(mBuffer == NULL)
+		{
 			mBuffer = new Uint8[mLength];
+			mOwnsBuffer = true;
+		}
 	}
 
 	UninflatedMessage(const UninflatedMessage& inSource) { copyToThis(inSource); }
@@ -75,7 +86,11 @@ public:
 	UninflatedMessage& operator =(const UninflatedMessage& inSource)
 	{
 		if(&inSource != this)
+		{
+			if(mOwnsBuffer)
+				delete [] mBuffer;
 			copyToThis(inSource);
+		}
 
 		return *this;
 	}
@@ -86,25 +101,40 @@ public:
 	
 	UninflatedMessage* clone() const { return new UninflatedMessage(*this); }
 
-	~UninflatedMessage()	{ delete [] mBuffer; }
+	~UninflatedMessage()	{ if(mOwnsBuffer) delete [] mBuffer; }
 
 	MessageTypeID	inflatedType() const	{ return mType; }
 	size_t		length() const		{ return mLength; }
 	Uint8*		buffer()		{ return mBuffer; }
 	const Uint8*	buffer() const		{ return mBuffer; }
 
+	// Hands over the (new []ed) buffer, leaving this message empty;
+	// NULL if the buffer is only borrowed
+	Uint8*		releaseBuffer()
+	{
+		if(!mOwnsBuffer)
+			return NULL;
+
+		Uint8* theBuffer = mBuffer;
+		mBuffer = NULL;
+		mLength = 0;
+		return theBuffer;
+	}
+
 private:
 	void copyToThis(const UninflatedMessage& inSource)
 	{
 		mType	= inSource.mType;
 		mLength	= inSource.mLength;
 		mBuffer	= new Uint8[mLength];
+		mOwnsBuffer = true;
 		memcpy(mBuffer, inSource.mBuffer, mLength);
 	}
 		
 	MessageTypeID	mType;
 	size_t		mLength;
 	Uint8*		mBuffer;
+	bool		mOwnsBuffer;
 };
 
 
@@ -149,6 +179,7 @@ public:
 	}
 	
 	bool			inflateFrom(const UninflatedMessage& inUninflated);
+	bool			inflateFromTaking(UninflatedMessage& ioUninflated);
 	UninflatedMessage*	deflate() const;
 	MessageTypeID		type() const	{ return mType; }
 
@@ -32,6 +32,22 @@
 
 Message*
 MessageInflater::inflate(const UninflatedMessage& inSource)
+{
+	return inflate(inSource, NULL);
+}
+
+
+
+Message*
+MessageInflater::inflateTaking(UninflatedMessage& ioSource)
+{
+	return inflate(ioSource, &ioSource);
+}
+
+
+
+Message*
+MessageInflater::inflate(const UninflatedMessage& inSource, UninflatedMessage* ioTakeableSource)
 {
 	Message* theResult = NULL;
 	
@@ -43,7 +59,7 @@ MessageInflater::inflate(const UninflatedMessage& inSource)
 			theResult = i->second->clone();
 			if(theResult != NULL)
 			{
-				bool successfulInflate = theResult->inflateFrom(inSource);
+				bool successfulInflate = (ioTakeableSource != NULL) ? theResult->inflateFromTaking(*ioTakeableSource) : theResult->inflateFrom(inSource);
 				if(!successfulInflate)
 				{
 					logWarning("inflate failed of message type %i", inSource.inflatedType());
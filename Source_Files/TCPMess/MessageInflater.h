@@ -37,6 +37,8 @@ class MessageInflater
 {
 public:
 	Message*	inflate(const UninflatedMessage& inSource);
+	// As above, but the inflated message may take ioSource's buffer
+	Message*	inflateTaking(UninflatedMessage& ioSource);
 	void		learnPrototype(const Message& inPrototype) { learnPrototypeForType(inPrototype.type(), inPrototype); }
 	void		learnPrototypeForType(MessageTypeID inType, const Message& inPrototype);
 	void		removePrototypeForType(MessageTypeID inType);
@@ -44,6 +46,8 @@ public:
 	~MessageInflater();
 
 private:
+	Message*	inflate(const UninflatedMessage& inSource, UninflatedMessage* ioTakeableSource);
+
 	typedef std::map<MessageTypeID, Message*> MessageInflaterMap;
 	MessageInflaterMap	mMap;
 };
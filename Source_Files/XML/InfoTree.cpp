@@ -28,7 +28,7 @@
 
 #include <boost/function.hpp>
 #include <boost/version.hpp>
-#include <boost/range/adaptor/map.hpp>
+#include <boost/range/adaptor/transformed.hpp>
 
 InfoTree InfoTree::load_xml(FileSpecifier filename)
 {
@@ -60,22 +60,23 @@ InfoTree InfoTree::load_xml(FileSpecifier filename)
 		throw InfoTree::unexpected_error(errstr);
 	}
 	
-	boost::property_tree::ptree xtree;
-	boost::property_tree::read_xml(filename.GetPath(), xtree);
-	return InfoTree(xtree);
+	InfoTree xtree;
+	boost::property_tree::read_xml(filename.GetPath(), static_cast<boost::property_tree::ptree&>(xtree));
+	return xtree;
 }
 
+// Read straight into the tree returned, rather than into one copied from
 InfoTree InfoTree::load_xml(std::istringstream& stream)
 {
-	boost::property_tree::ptree xtree;
-	boost::property_tree::read_xml(stream, xtree);
-	return InfoTree(xtree);
+	InfoTree xtree;
+	boost::property_tree::read_xml(stream, static_cast<boost::property_tree::ptree&>(xtree));
+	return xtree;
 }
 
 void InfoTree::save_xml(FileSpecifier filename) const
 {
 	boost::property_tree::write_xml(filename.GetPath(),
-									boost::property_tree::ptree(*this),
+									static_cast<const boost::property_tree::ptree&>(*this),
 									std::locale(),
 #if BOOST_VERSION >= 105600
 									boost::property_tree::xml_writer_make_settings<boost::property_tree::ptree::key_type>(' ', 2)
@@ -88,7 +89,7 @@ void InfoTree::save_xml(FileSpecifier filename) const
 void InfoTree::save_xml(std::ostringstream& stream) const
 {
 	boost::property_tree::write_xml(stream,
-									boost::property_tree::ptree(*this),
+									static_cast<const boost::property_tree::ptree&>(*this),
 #if BOOST_VERSION >= 105600
 									boost::property_tree::xml_writer_make_settings<boost::property_tree::ptree::key_type>(' ', 2)
 #else
@@ -99,28 +100,28 @@ void InfoTree::save_xml(std::ostringstream& stream) const
 
 InfoTree InfoTree::load_ini(FileSpecifier filename)
 {
-	boost::property_tree::ptree itree;
-	boost::property_tree::read_ini(filename.GetPath(), itree);
-	return InfoTree(itree);
+	InfoTree itree;
+	boost::property_tree::read_ini(filename.GetPath(), static_cast<boost::property_tree::ptree&>(itree));
+	return itree;
 }
 
 InfoTree InfoTree::load_ini(std::istringstream& stream)
 {
-	boost::property_tree::ptree itree;
-	boost::property_tree::read_ini(stream, itree);
-	return InfoTree(itree);
+	InfoTree itree;
+	boost::property_tree::read_ini(stream, static_cast<boost::property_tree::ptree&>(itree));
+	return itree;
 }
 
 void InfoTree::save_ini(FileSpecifier filename) const
 {
 	boost::property_tree::write_ini(filename.GetPath(),
-									boost::property_tree::ptree(*this));
+									static_cast<const boost::property_tree::ptree&>(*this));
 }
 
 void InfoTree::save_ini(std::ostringstream& stream) const
 {
 	boost::property_tree::write_ini(stream,
-									boost::property_tree::ptree(*this));
+									static_cast<const boost::property_tree::ptree&>(*this));
 }
 
 bool InfoTree::read_fixed(std::string path, _fixed& value, float min, float max) const
@@ -345,9 +346,15 @@ bool InfoTree::read_font(FontSpecifier& font) const
 
 typedef boost::iterator_range<InfoTree::const_assoc_iterator> _match_range_type;
 
-InfoTree::const_child_range InfoTree::children_named(std::string key) const
+struct _as_info_tree
+{
+	typedef const InfoTree& result_type;
+	const InfoTree& operator()(const InfoTree::value_type& v) const { return static_cast<const InfoTree&>(v.second); }
+};
+
+InfoTree::const_child_range InfoTree::children_named(const std::string& key) const
 {
 	std::pair<const_assoc_iterator, const_assoc_iterator> matches = equal_range(key);
 	_match_range_type match_range = boost::make_iterator_range(matches.first, matches.second);
-	return boost::adaptors::values(static_cast<const _match_range_type&>(match_range));
+	return boost::adaptors::transform(static_cast<const _match_range_type&>(match_range), _as_info_tree());
 }
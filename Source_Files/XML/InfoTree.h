@@ -60,21 +60,26 @@ public:
 	void save_ini(FileSpecifier filename) const;
 	void save_ini(std::ostringstream& stream) const;
 
-	template<typename T> bool read(std::string path, T& value) const
+	// Most settings are optional, so a missing child or a bad value mustn't
+	// cost an exception
+	template<typename T> bool read(const std::string& path, T& value) const
 	{
-		try {
-			value = get_child(path).get_value<T>();
-			return true;
-		} catch (path_error ep) {} catch (data_error ed) {}
-		return false;
+		boost::optional<const boost::property_tree::ptree&> child = get_child_optional(path);
+		if (!child)
+			return false;
+		return read_value(*child, value);
 	}
 
-	template<typename T> bool read_attr(std::string path, T& value) const
+	template<typename T> bool read_attr(const std::string& path, T& value) const
 	{
-		return read(std::string("<xmlattr>.") + path, value);
+		if (path.find('.') != std::string::npos)
+			return read(std::string("<xmlattr>.") + path, value);
+
+		const boost::property_tree::ptree *attr = find_attr(path);
+		return attr && read_value(*attr, value);
 	}
 
-	template<typename T> bool read_attr_bounded(std::string path, T& value, const T min, const T max) const
+	template<typename T> bool read_attr_bounded(const std::string& path, T& value, const T min, const T max) const
 	{
 		T temp;
 		if (read_attr(path, temp) && temp >= min && temp <= max)
@@ -85,7 +90,7 @@ public:
 		return false;
 	}
 	
-	bool read_indexed(std::string path, int16& value, int num_slots, bool allow_none = false) const
+	bool read_indexed(const std::string& path, int16& value, int num_slots, bool allow_none = false) const
 	{
 		return read_attr_bounded<int16>(path, value, (allow_none ? NONE : 0), num_slots - 1);
 	}
@@ -117,8 +122,29 @@ public:
 	void put_cstr(std::string path, std::string cstr);
 	void put_attr_cstr(std::string path, std::string cstr);
 	
-	typedef boost::any_range<const InfoTree, boost::forward_traversal_tag, const InfoTree, std::ptrdiff_t> const_child_range;
-	const_child_range children_named(std::string key) const;
+	// The children themselves, not copies; InfoTree adds nothing to a ptree
+	typedef boost::any_range<const InfoTree, boost::forward_traversal_tag, const InfoTree&, std::ptrdiff_t> const_child_range;
+	const_child_range children_named(const std::string& key) const;
+
+private:
+	template<typename T> static bool read_value(const boost::property_tree::ptree& node, T& value)
+	{
+		boost::optional<T> v = node.get_value_optional<T>();
+		if (!v)
+			return false;
+		value = *v;
+		return true;
+	}
+
+	// An attribute's node, looked up by name without making a path of it
+	const boost::property_tree::ptree *find_attr(const std::string& name) const
+	{
+		const_assoc_iterator attrs = find("<xmlattr>");
+		if (attrs == not_found())
+			return 0;
+		const_assoc_iterator attr = attrs->second.find(name);
+		return attr != attrs->second.not_found() ? &attr->second : 0;
+	}
 };
 
 #endif
@@ -0,0 +1,221 @@
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  MML cache (see MMLCache.h)
+
+ */
+
+#include "cseries.h"
+#include "MMLCache.h"
+
+#include "crc.h"
+#include "FileHandler.h"
+#include "Logging.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// the second word is the format of the tree
+static const uint32 mmlCacheMagic = FOUR_CHARS_TO_INT('A','1','M','C');
+static const uint32 mmlCacheVersion = 1;
+// past this, the least recently written entries are deleted
+static const int64_t mmlCacheMaximumSize = 16 * 1024 * 1024;
+
+/*
+	Each node is its data, its child count, then each child's key and node;
+	strings are a length, then their bytes, all in native byte order (the
+	cache never leaves the machine that wrote it)
+*/
+
+static void put_uint32(std::vector<char>& out, uint32 value)
+{
+	const char *bytes = reinterpret_cast<const char *>(&value);
+	out.insert(out.end(), bytes, bytes + sizeof(value));
+}
+
+static void put_string(std::vector<char>& out, const std::string& value)
+{
+	put_uint32(out, uint32(value.size()));
+	out.insert(out.end(), value.begin(), value.end());
+}
+
+static void put_node(std::vector<char>& out, const boost::property_tree::ptree& node)
+{
+	put_string(out, node.data());
+	put_uint32(out, uint32(node.size()));
+	for (boost::property_tree::ptree::const_iterator it = node.begin(); it != node.end(); ++it)
+	{
+		put_string(out, it->first);
+		put_node(out, it->second);
+	}
+}
+
+class TreeReader
+{
+public:
+	TreeReader(const std::vector<char>& data) : m_data(data), m_position(0) { }
+
+	bool GetNode(boost::property_tree::ptree& node, int depth = 0)
+	{
+		std::string data;
+		uint32 count;
+		if (depth > 256 || !GetString(data) || !GetUInt32(count))
+			return false;
+
+		node.data() = data;
+		for (uint32 i = 0; i < count; i++)
+		{
+			std::string key;
+			if (!GetString(key))
+				return false;
+			boost::property_tree::ptree& child = node.push_back(std::make_pair(key, boost::property_tree::ptree()))->second;
+			if (!GetNode(child, depth + 1))
+				return false;
+		}
+		return true;
+	}
+
+	bool AtEnd() const { return m_position == m_data.size(); }
+
+private:
+	bool GetUInt32(uint32& value)
+	{
+		if (m_data.size() - m_position < sizeof(value))
+			return false;
+		memcpy(&value, &m_data[m_position], sizeof(value));
+		m_position += sizeof(value);
+		return true;
+	}
+
+	bool GetString(std::string& value)
+	{
+		uint32 length;
+		if (!GetUInt32(length) || m_data.size() - m_position < length)
+			return false;
+		value.assign(m_data.begin() + m_position, m_data.begin() + m_position + length);
+		m_position += length;
+		return true;
+	}
+
+	const std::vector<char>& m_data;
+	size_t m_position;
+};
+
+static DirectorySpecifier cache_directory()
+{
+	DirectorySpecifier dir;
+	dir.SetToLocalDataDir();
+	dir += "MML Cache";
+	return dir;
+}
+
+static bool cache_file(const char *buffer, size_t len, FileSpecifier& file)
+{
+	DirectorySpecifier dir = cache_directory();
+	if (!dir.Exists() && !dir.CreateDirectory())
+		return false;
+
+	char name[32];
+	sprintf(name, "%08x.mmlc", calculate_data_crc((unsigned char *) buffer, len));
+	file = dir + name;
+	return true;
+}
+
+static bool load_tree(const char *buffer, size_t len, InfoTree& tree)
+{
+	FileSpecifier file;
+	if (!cache_file(buffer, len, file) || !file.Exists())
+		return false;
+
+	OpenedFile of;
+	if (!file.Open(of))
+		return false;
+
+	uint32 header[4];
+	if (!of.Read(sizeof(header), header))
+		return false;
+	if (header[0] != mmlCacheMagic || header[1] != mmlCacheVersion || header[2] != len)
+		return false;
+
+	// the key is the whole source
+	std::vector<char> stored(len + 1);
+	if (!of.Read(len, &stored[0]) || memcmp(&stored[0], buffer, len) != 0)
+		return false;
+
+	std::vector<char> data(header[3]);
+	if (data.empty() || !of.Read(data.size(), &data[0]))
+		return false;
+
+	TreeReader reader(data);
+	InfoTree root;
+	if (!reader.GetNode(root) || !reader.AtEnd())
+		return false;
+
+	tree.swap(root);
+	return true;
+}
+
+static void save_tree(const char *buffer, size_t len, const InfoTree& tree)
+{
+	std::vector<char> data;
+	put_node(data, tree);
+
+	FileSpecifier file;
+	if (!cache_file(buffer, len, file))
+		return;
+	FileSpecifier temp_file;
+	temp_file.SetTempName(file);
+	if (!temp_file.Create(_typecode_unknown))
+		return;
+
+	bool written = false;
+	{
+		OpenedFile of;
+		if (temp_file.Open(of, true))
+		{
+			uint32 header[4] = { mmlCacheMagic, mmlCacheVersion, uint32(len), uint32(data.size()) };
+			written = of.Write(sizeof(header), header) &&
+				of.Write(len, const_cast<char *>(buffer)) &&
+				of.Write(data.size(), &data[0]);
+		}
+	}
+
+	if (!written || !temp_file.Rename(file))
+	{
+		logWarning("Could not write MML cache entry %s", file.GetPath());
+		temp_file.Delete();
+		return;
+	}
+
+	cache_directory().PruneDirectory(".mmlc", mmlCacheMaximumSize);
+}
+
+InfoTree MML_Load_Cached(const char *buffer, size_t len)
+{
+	InfoTree tree;
+	if (len && load_tree(buffer, len, tree))
+		return tree;
+
+	std::istringstream strm(std::string(buffer, len));
+	tree = InfoTree::load_xml(strm);
+	if (len)
+		save_tree(buffer, len, tree);
+	return tree;
+}
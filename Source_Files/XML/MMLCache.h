@@ -0,0 +1,36 @@
+#ifndef MML_CACHE_H
+#define MML_CACHE_H
+
+/*
+
+  Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  This license is contained in the file "COPYING",
+  which is included with this source code; it is available online at
+  http://www.gnu.org/licenses/gpl.html
+
+  MML cache: MML parsed once is written to the local data directory as a
+  compact binary tree, keyed by its source, and read from there instead of
+  being parsed again the next time
+
+ */
+
+#include "InfoTree.h"
+
+#include <stddef.h>
+
+// Like InfoTree::load_xml() on the source, and throws the same errors, but
+// from the cache when the same source was parsed before
+InfoTree MML_Load_Cached(const char *buffer, size_t len);
+
+#endif
@@ -33,6 +33,7 @@
 #include "InfoTree.h"
 #include "XML_ParseTreeRoot.h"
 #include "Scenario.h"
+#include "ScanCache.h"
 
 #ifdef HAVE_ZZIP
 #include <zzip/lib.h>
@@ -47,8 +48,11 @@ public:
 	PluginLoader() { }
 	~PluginLoader() { }
 	
-	bool ParsePlugin(FileSpecifier& file);
-	bool ParseDirectory(FileSpecifier& dir);
+	// date is the newest of what the plugin's metadata depends on
+	bool ParsePlugin(FileSpecifier& file, TimeType date);
+	// newest is set to the newest directory date in the tree
+	bool ParseDirectory(FileSpecifier& dir, TimeType& newest);
+	bool ParseArchive(FileSpecifier& archive, TimeType date);
 };
 
 bool Plugin::compatible() const {
@@ -235,8 +239,144 @@ static bool plugin_file_exists(const Plugin& Data, std::string Path)
 	return f.Exists();
 }
 
-bool PluginLoader::ParsePlugin(FileSpecifier& file_name)
+// Plugin.xml, or what plugin_record() made of it; files named in the
+// cached record were already checked
+static void read_plugin(const InfoTree& root, Plugin& Data, bool check_files)
 {
+	root.read_attr("name", Data.name);
+	root.read_attr("version", Data.version);
+	root.read_attr("description", Data.description);
+	root.read_attr("minimum_version", Data.required_version);
+	
+	if (root.read_attr("hud_lua", Data.hud_lua) && check_files &&
+		!plugin_file_exists(Data, Data.hud_lua))
+		Data.hud_lua = "";
+	
+	if (root.read_attr("solo_lua", Data.solo_lua) && check_files &&
+		!plugin_file_exists(Data, Data.solo_lua))
+		Data.solo_lua = "";
+	
+	if (root.read_attr("stats_lua", Data.stats_lua) && check_files &&
+		!plugin_file_exists(Data, Data.stats_lua))
+		Data.stats_lua = "";
+	
+	if (root.read_attr("theme_dir", Data.theme) && check_files &&
+		!plugin_file_exists(Data, Data.theme + "/theme2.mml"))
+		Data.theme = "";
+	
+	BOOST_FOREACH(const InfoTree &tree, root.children_named("mml"))
+	{
+		std::string mml_path;
+		if (tree.read_attr("file", mml_path) &&
+			(!check_files || plugin_file_exists(Data, mml_path)))
+			Data.mmls.push_back(mml_path);
+	}
+
+	BOOST_FOREACH(const InfoTree &tree, root.children_named("shapes_patch"))
+	{
+		ShapesPatch patch;
+		patch.requires_opengl = false;
+		tree.read_attr("file", patch.path);
+		tree.read_attr("requires_opengl", patch.requires_opengl);
+		if (!check_files || plugin_file_exists(Data, patch.path))
+			Data.shapes_patches.push_back(patch);
+	}
+
+	BOOST_FOREACH(const InfoTree &tree, root.children_named("scenario"))
+	{
+		ScenarioInfo info;
+		tree.read_attr("name", info.name);
+		if (info.name.size() > 31)
+			info.name.erase(31);
+		
+		tree.read_attr("id", info.scenario_id);
+		if (info.scenario_id.size() > 23)
+			info.scenario_id.erase(23);
+		
+		tree.read_attr("version", info.version);
+		if (info.version.size() > 7)
+			info.version.erase(7);
+		
+		if (info.name.size() || info.scenario_id.size())
+			Data.required_scenarios.push_back(info);
+	}
+	
+	if (Data.name.length()) {
+		std::sort(Data.mmls.begin(), Data.mmls.end());
+		if (Data.theme.size()) {
+			Data.hud_lua = "";
+			Data.solo_lua = "";
+			Data.shapes_patches.clear();
+		}
+	}
+}
+
+// What the scan cache keeps of a parsed plugin; nothing, if it had no name
+static InfoTree plugin_record(const Plugin& Data)
+{
+	InfoTree record;
+	if (!Data.name.length())
+		return record;
+
+	InfoTree root;
+	root.put_attr("name", Data.name);
+	root.put_attr("version", Data.version);
+	root.put_attr("description", Data.description);
+	root.put_attr("minimum_version", Data.required_version);
+	if (Data.hud_lua.size())
+		root.put_attr("hud_lua", Data.hud_lua);
+	if (Data.solo_lua.size())
+		root.put_attr("solo_lua", Data.solo_lua);
+	if (Data.stats_lua.size())
+		root.put_attr("stats_lua", Data.stats_lua);
+	if (Data.theme.size())
+		root.put_attr("theme_dir", Data.theme);
+	
+	for (std::vector<std::string>::const_iterator it = Data.mmls.begin(); it != Data.mmls.end(); ++it)
+	{
+		InfoTree tree;
+		tree.put_attr("file", *it);
+		root.add_child("mml", tree);
+	}
+	for (std::vector<ShapesPatch>::const_iterator it = Data.shapes_patches.begin(); it != Data.shapes_patches.end(); ++it)
+	{
+		InfoTree tree;
+		tree.put_attr("file", it->path);
+		tree.put_attr("requires_opengl", it->requires_opengl);
+		root.add_child("shapes_patch", tree);
+	}
+	for (std::vector<ScenarioInfo>::const_iterator it = Data.required_scenarios.begin(); it != Data.required_scenarios.end(); ++it)
+	{
+		InfoTree tree;
+		tree.put_attr("name", it->name);
+		tree.put_attr("id", it->scenario_id);
+		tree.put_attr("version", it->version);
+		root.add_child("scenario", tree);
+	}
+
+	record.add_child("plugin", root);
+	return record;
+}
+
+bool PluginLoader::ParsePlugin(FileSpecifier& file_name, TimeType date)
+{
+	DirectorySpecifier current_plugin_directory;
+	file_name.ToDirectory(current_plugin_directory);
+
+	InfoTree record;
+	if (ScanCache::instance()->GetRecord(file_name.GetPath(), date, record))
+	{
+		if (record.size())
+		{
+			Plugin Data = Plugin();
+			Data.directory = current_plugin_directory;
+			Data.enabled = true;
+			read_plugin(record.get_child("plugin"), Data, false);
+			Plugins::instance()->add(Data);
+		}
+		return true;
+	}
+
 	OpenedFile file;
 	if (file_name.Open(file)) 
 	{
@@ -247,9 +387,6 @@ bool PluginLoader::ParsePlugin(FileSpecifier& file_name)
 
 		if (file.Read(data_size, &file_data[0]))
 		{
-			DirectorySpecifier current_plugin_directory;
-			file_name.ToDirectory(current_plugin_directory);
-
 			char name[256];
 			current_plugin_directory.GetName(name);
 			
@@ -260,73 +397,12 @@ bool PluginLoader::ParsePlugin(FileSpecifier& file_name)
 				Plugin Data = Plugin();
 				Data.directory = current_plugin_directory;
 				Data.enabled = true;
-				
-				root.read_attr("name", Data.name);
-				root.read_attr("version", Data.version);
-				root.read_attr("description", Data.description);
-				root.read_attr("minimum_version", Data.required_version);
-				
-				if (root.read_attr("hud_lua", Data.hud_lua) &&
-					!plugin_file_exists(Data, Data.hud_lua))
-					Data.hud_lua = "";
-				
-				if (root.read_attr("solo_lua", Data.solo_lua) &&
-					!plugin_file_exists(Data, Data.solo_lua))
-					Data.solo_lua = "";
-				
-				if (root.read_attr("stats_lua", Data.stats_lua) &&
-					!plugin_file_exists(Data, Data.stats_lua))
-					Data.stats_lua = "";
-				
-				if (root.read_attr("theme_dir", Data.theme) &&
-					!plugin_file_exists(Data, Data.theme + "/theme2.mml"))
-					Data.theme = "";
-				
-				BOOST_FOREACH(InfoTree tree, root.children_named("mml"))
-				{
-					std::string mml_path;
-					if (tree.read_attr("file", mml_path) &&
-						plugin_file_exists(Data, mml_path))
-						Data.mmls.push_back(mml_path);
-				}
-
-				BOOST_FOREACH(InfoTree tree, root.children_named("shapes_patch"))
-				{
-					ShapesPatch patch;
-					tree.read_attr("file", patch.path);
-					tree.read_attr("requires_opengl", patch.requires_opengl);
-					if (plugin_file_exists(Data, patch.path))
-						Data.shapes_patches.push_back(patch);
-				}
-
-				BOOST_FOREACH(InfoTree tree, root.children_named("scenario"))
-				{
-					ScenarioInfo info;
-					tree.read_attr("name", info.name);
-					if (info.name.size() > 31)
-						info.name.erase(31);
-					
-					tree.read_attr("id", info.scenario_id);
-					if (info.scenario_id.size() > 23)
-						info.scenario_id.erase(23);
-					
-					tree.read_attr("version", info.version);
-					if (info.version.size() > 7)
-						info.version.erase(7);
-					
-					if (info.name.size() || info.scenario_id.size())
-						Data.required_scenarios.push_back(info);
-				}
+				read_plugin(root, Data, true);
 				
 				if (Data.name.length()) {
-					std::sort(Data.mmls.begin(), Data.mmls.end());
-					if (Data.theme.size()) {
-						Data.hud_lua = "";
-						Data.solo_lua = "";
-						Data.shapes_patches.clear();
-					}
 					Plugins::instance()->add(Data);
 				}
+				ScanCache::instance()->PutRecord(file_name.GetPath(), date, plugin_record(Data));
 				
 			} catch (InfoTree::parse_error e) {
 				logError("There were parsing errors in %s Plugin.xml: %s", name, e.what());
@@ -344,46 +420,84 @@ bool PluginLoader::ParsePlugin(FileSpecifier& file_name)
 	return false;
 }
 
-bool PluginLoader::ParseDirectory(FileSpecifier& dir) 
+bool PluginLoader::ParseDirectory(FileSpecifier& dir, TimeType& newest) 
 {
 	std::vector<dir_entry> de;
-	if (!dir.ReadDirectory(de))
+	if (!ScanCache::instance()->ReadDirectory(dir, de))
 		return false;
+	newest = dir.GetDate();
 	
+	// a plugin's files may be anywhere under its directory, so it's
+	// parsed once everything below has been looked at
+	bool has_plugin = false;
 	for (std::vector<dir_entry>::const_iterator it = de.begin(); it != de.end(); ++it) {
 		FileSpecifier file = dir + it->name;
 		if (it->name == "Plugin.xml")
 		{
-			ParsePlugin(file);
+			has_plugin = true;
 		}
 		else if (it->is_directory && it->name[0] != '.') 
 		{
-			ParseDirectory(file);
+			TimeType subdirectory_newest;
+			if (ParseDirectory(file, subdirectory_newest))
+				newest = MAX(newest, subdirectory_newest);
 		}
 #ifdef HAVE_ZZIP
 		else if (algo::ends_with(it->name, ".zip") || algo::ends_with(it->name, ".ZIP"))
 		{
-			// search it for a Plugin.xml file
-			ZZIP_DIR* zzipdir = zzip_dir_open(file.GetPath(), 0);
-			if (zzipdir)
+			ParseArchive(file, file.GetDate());
+		}
+#endif
+	}
+
+	if (has_plugin)
+	{
+		FileSpecifier file = dir + "Plugin.xml";
+		ParsePlugin(file, MAX(newest, file.GetDate()));
+	}
+
+	return true;
+}
+
+bool PluginLoader::ParseArchive(FileSpecifier& file, TimeType date)
+{
+#ifdef HAVE_ZZIP
+	// where its Plugin.xml files are
+	std::string archive = file.GetPath();
+	InfoTree record;
+	if (!ScanCache::instance()->GetRecord(archive, date, record))
+	{
+		ZZIP_DIR* zzipdir = zzip_dir_open(file.GetPath(), 0);
+		if (!zzipdir)
+			return false;
+
+		ZZIP_DIRENT dirent;
+		while (zzip_dir_read(zzipdir, &dirent))
+		{
+			if (strcmp(dirent.d_name, "Plugin.xml") == 0 || algo::ends_with(dirent.d_name, "/Plugin.xml"))
 			{
-				ZZIP_DIRENT dirent;
-				while (zzip_dir_read(zzipdir, &dirent))
-				{
-					if (strcmp(dirent.d_name, "Plugin.xml") == 0 || algo::ends_with(dirent.d_name, "/Plugin.xml"))
-					{
-						std::string archive = file.GetPath();
-						FileSpecifier file_name = FileSpecifier(archive.substr(0, archive.find_last_of('.'))) + dirent.d_name;
-						ParsePlugin(file_name);
-					}
-				}
-				zzip_dir_close(zzipdir);
+				InfoTree tree;
+				tree.put_attr("name", std::string(dirent.d_name));
+				record.add_child("plugin_xml", tree);
 			}
 		}
-#endif
+		zzip_dir_close(zzipdir);
+		ScanCache::instance()->PutRecord(archive, date, record);
 	}
 
+	BOOST_FOREACH(const InfoTree &tree, record.children_named("plugin_xml"))
+	{
+		std::string name;
+		if (tree.read_attr("name", name))
+		{
+			FileSpecifier file_name = FileSpecifier(archive.substr(0, archive.find_last_of('.'))) + name;
+			ParsePlugin(file_name, date);
+		}
+	}
 	return true;
+#else
+	return false;
+#endif
 }
 
 extern std::vector<DirectorySpecifier> data_search_path;
@@ -395,7 +509,8 @@ void Plugins::enumerate() {
 	
 	for (std::vector<DirectorySpecifier>::const_iterator it = data_search_path.begin(); it != data_search_path.end(); ++it) {
 		DirectorySpecifier path = *it + "Plugins";
-		loader.ParseDirectory(path);
+		TimeType newest;
+		loader.ParseDirectory(path, newest);
 	}
 	std::sort(m_plugins.begin(), m_plugins.end());
 	clear_game_error();
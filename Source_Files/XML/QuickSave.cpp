@@ -124,7 +124,8 @@ SDL_Surface* QuickSaveImageCache::get(std::string image_name) {
 	desc.index = SAVE_GAME_METADATA_INDEX;
 	desc.tag = SAVE_IMG_TAG;
 	
-	SDL_Surface *img = WadImageCache::instance()->get_image(desc, PREVIEW_WIDTH, PREVIEW_HEIGHT);
+	// NULL until a worker has made it; see saves_dialog_idle()
+	SDL_Surface *img = WadImageCache::instance()->get_image_async(desc, PREVIEW_WIDTH, PREVIEW_HEIGHT);
 	if (img) {
         m_used.push_front(cache_pair_t(image_name, img));
         m_images[image_name] = m_used.begin();
@@ -147,6 +148,7 @@ void QuickSaveImageCache::clear() {
         SDL_FreeSurface(it->second);
     }
     m_used.clear();
+    WadImageCache::instance()->discard_loaded_images();
 }
 
 
@@ -166,6 +168,7 @@ public:
     QuickSave selected_save() { return m_saves[get_selection()]; }
     void remove_selected();
     void update_selected(QuickSave& save) { m_saves[get_selection()] = save; dirty = true; }
+    void images_ready() { dirty = true; }
     bool has_selection() { return m_saves.size() > 0; }
     
 protected:
@@ -244,9 +247,6 @@ void w_saves::draw_item(QuickSaves::iterator it, SDL_Surface* s, int16 x, int16
     oss << it->save_time;
     SDL_Surface *image = QuickSaveImageCache::instance()->get(oss.str());
     SDL_Rect r = {x + 3, y + 3, PREVIEW_WIDTH, PREVIEW_HEIGHT};
-    SDL_BlitSurface(image, NULL, s, &r);
-    x += PREVIEW_WIDTH + 12;
-    width -= PREVIEW_WIDTH + 12;
     
     uint32 color;
     if (selected)
@@ -257,6 +257,13 @@ void w_saves::draw_item(QuickSaves::iterator it, SDL_Surface* s, int16 x, int16
     {
         color = get_theme_color(ITEM_WIDGET, DEFAULT_STATE);
     }
+    
+    if (image)
+        SDL_BlitSurface(image, NULL, s, &r);
+    else
+        draw_rectangle(s, &r, color);
+    x += PREVIEW_WIDTH + 12;
+    width -= PREVIEW_WIDTH + 12;
     set_drawing_clip_rectangle(0, x, static_cast<short>(s->h), x + width);
     
     y += font->get_ascent();
@@ -313,6 +320,16 @@ const int iDIALOG_DELETE_W = 44;
 const int iDIALOG_EXPORT_W = 45;
 const int iDIALOG_ACCEPT_W = 46;
 
+// Redraws the previews as the image cache finishes them
+static void saves_dialog_idle(dialog *d)
+{
+    if (WadImageCache::instance()->process_loads())
+    {
+        w_saves *saves_w = static_cast<w_saves *>(d->get_widget_by_id(iDIALOG_SAVES_W));
+        if (saves_w) saves_w->images_ready();
+    }
+}
+
 static void dialog_rename(void *arg)
 {
     dialog *d = static_cast<dialog *>(arg);
@@ -361,6 +378,7 @@ static void dialog_delete(void *arg)
 	std::vector<QuickSave> saves;
 	saves.push_back(sel);
 	w_saves* selsave_w = new w_saves(saves, 400, 1);
+	selsave_w->set_identifier(iDIALOG_SAVES_W);
 	placer->dual_add(selsave_w, rd);
 	placer->add(new w_spacer, true);
 	
@@ -372,6 +390,7 @@ static void dialog_delete(void *arg)
 	placer->add(button_placer, true);
 	rd.set_widget_placer(placer);
 	rd.activate_widget(accept_w);
+	rd.set_processing_function(saves_dialog_idle);
 
     if (rd.run() == 0 && delete_quick_save(sel)) {
         saves_w->remove_selected();
@@ -463,6 +482,7 @@ bool load_quick_save_dialog(FileSpecifier& saved_game)
     
     d.set_widget_placer(placer);
     d.activate_widget(saves_w);
+    d.set_processing_function(saves_dialog_idle);
     
     if (!saves_w->has_selection())
     {
@@ -500,12 +520,12 @@ bool load_quick_save_dialog(FileSpecifier& saved_game)
 extern SDL_Surface *draw_surface;
 extern bool OGL_MapActive;
 
-static bool build_map_preview(std::ostringstream& ostream)
+static SDL_Surface *build_map_preview()
 {
     SDL_Rect r = {0, 0, RENDER_WIDTH, RENDER_HEIGHT};
     SDL_Surface *surface = SDL_CreateRGBSurface(SDL_SWSURFACE, r.w, r.h, 32, 0xff0000, 0x00ff00, 0x0000ff, 0);
     if (!surface)
-        return false;
+        return NULL;
 	
     SDL_FillRect(surface, &r, SDL_MapRGB(surface->format, 0, 0, 0));
 	
@@ -526,7 +546,14 @@ static bool build_map_preview(std::ostringstream& ostream)
     _render_overhead_map(&overhead_data);
     OGL_MapActive = old_OGL_MapActive;
     _restore_port();
-	
+
+    return surface;
+}
+
+// save_game_file() runs this on its writing thread
+static std::string encode_map_preview(SDL_Surface *surface)
+{
+    std::ostringstream ostream;
     SDL_RWops *rwops = SDL_RWFromOStream(ostream);
 //#if defined(HAVE_PNG) && defined(HAVE_SDL_IMAGE)
 //    int ret = aoIMG_SavePNG_RW(rwops, surface, IMG_COMPRESS_DEFAULT, NULL, 0);
@@ -535,10 +562,9 @@ static bool build_map_preview(std::ostringstream& ostream)
 #else
     int ret = SDL_SaveBMP_RW(surface, rwops, false);
 #endif
-    SDL_FreeSurface(surface);
     SDL_RWclose(rwops);
 	
-    return (ret == 0);
+    return (ret == 0) ? ostream.str() : std::string();
 }
 
 std::string build_save_metadata(QuickSave& save)
@@ -567,6 +593,8 @@ void create_updated_save(QuickSave& save)
 	std::string imagedata;
 	short err = 0;
 	
+	finish_saving_game();
+
 	OpenedFile currentFile;
 	if (save.save_file.Open(currentFile))
 	{
@@ -576,6 +604,9 @@ void create_updated_save(QuickSave& save)
 			if (game_wad) game_wad_length = calculate_wad_length(&header, game_wad);
 
 			orig_meta_wad = read_indexed_wad_from_file(currentFile, &header, SAVE_GAME_METADATA_INDEX, true);
+
+			// which is written back uncompressed
+			header.flags &= ~WADFILE_ENTRIES_ARE_COMPRESSED;
 			
 			if (orig_meta_wad)
 			{
@@ -688,9 +719,7 @@ bool create_quick_save(void)
     save.save_file.AddPart(base + ".sgaA");
 	
     std::string metadata = build_save_metadata(save);
-    std::ostringstream image_stream;
-    bool success = build_map_preview(image_stream);
-    success = save_game_file(save.save_file, metadata, image_stream.str());
+    bool success = save_game_file(save.save_file, metadata, build_map_preview(), encode_map_preview);
     
     if (success)
         QuickSaves::instance()->delete_surplus_saves(environment_preferences->maximum_quick_saves);
@@ -527,7 +527,7 @@ void parse_mml_default_levels(const InfoTree& root)
 {
 	LevelScriptHeader *ls_ptr = &(LevelScripts[LevelScriptHeader::Default]);
 	
-	BOOST_FOREACH(InfoTree child, root.children_named("music"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("music"))
 	{
 		LevelScriptCommand cmd;
 		cmd.Type = LevelScriptCommand::Music;
@@ -538,13 +538,13 @@ void parse_mml_default_levels(const InfoTree& root)
 		ls_ptr->Commands.push_back(cmd);
 	}
 	
-	BOOST_FOREACH(InfoTree child, root.children_named("random_order"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("random_order"))
 	{
 		child.read_attr("on", ls_ptr->RandomOrder);
 	}
 	
 #ifdef HAVE_OPENGL
-	BOOST_FOREACH(InfoTree child, root.children_named("load_screen"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("load_screen"))
 	{
 		LevelScriptCommand cmd;
 		cmd.Type = LevelScriptCommand::LoadScreen;
@@ -559,7 +559,7 @@ void parse_mml_default_levels(const InfoTree& root)
 		child.read_attr("progress_left", cmd.L);
 		child.read_attr("progress_right", cmd.R);
 		
-		BOOST_FOREACH(InfoTree color, child.children_named("color"))
+		BOOST_FOREACH(const InfoTree &color, child.children_named("color"))
 		{
 			int index = -1;
 			if (color.read_attr_bounded("index", index, 0, 1))
@@ -578,7 +578,7 @@ void parse_level_commands(InfoTree root, int index)
 	// Find or create command list for this level
 	LevelScriptHeader *ls_ptr = &(LevelScripts[index]);
 
-	BOOST_FOREACH(InfoTree child, root.children_named("mml"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("mml"))
 	{
 		LevelScriptCommand cmd;
 		cmd.Type = LevelScriptCommand::MML;
@@ -590,7 +590,7 @@ void parse_level_commands(InfoTree root, int index)
 	}
 
 #ifdef HAVE_LUA
-	BOOST_FOREACH(InfoTree child, root.children_named("lua"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("lua"))
 	{
 		LevelScriptCommand cmd;
 		cmd.Type = LevelScriptCommand::Lua;
@@ -602,7 +602,7 @@ void parse_level_commands(InfoTree root, int index)
 	}
 #endif
 	
-	BOOST_FOREACH(InfoTree child, root.children_named("music"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("music"))
 	{
 		LevelScriptCommand cmd;
 		cmd.Type = LevelScriptCommand::Music;
@@ -613,12 +613,12 @@ void parse_level_commands(InfoTree root, int index)
 		ls_ptr->Commands.push_back(cmd);
 	}
 	
-	BOOST_FOREACH(InfoTree child, root.children_named("random_order"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("random_order"))
 	{
 		child.read_attr("on", ls_ptr->RandomOrder);
 	}
 	
-	BOOST_FOREACH(InfoTree child, root.children_named("movie"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("movie"))
 	{
 		LevelScriptCommand cmd;
 		cmd.Type = LevelScriptCommand::Movie;
@@ -632,7 +632,7 @@ void parse_level_commands(InfoTree root, int index)
 	}
 	
 #ifdef HAVE_OPENGL
-	BOOST_FOREACH(InfoTree child, root.children_named("load_screen"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("load_screen"))
 	{
 		LevelScriptCommand cmd;
 		cmd.Type = LevelScriptCommand::LoadScreen;
@@ -647,7 +647,7 @@ void parse_level_commands(InfoTree root, int index)
 		child.read_attr("progress_left", cmd.L);
 		child.read_attr("progress_right", cmd.R);
 		
-		BOOST_FOREACH(InfoTree color, child.children_named("color"))
+		BOOST_FOREACH(const InfoTree &color, child.children_named("color"))
 		{
 			int16 index;
 			if (color.read_indexed("index", index, 2))
@@ -663,7 +663,7 @@ void parse_level_commands(InfoTree root, int index)
 
 void parse_levels_xml(InfoTree root)
 {
-	BOOST_FOREACH(InfoTree lev, root.children_named("level"))
+	BOOST_FOREACH(const InfoTree &lev, root.children_named("level"))
 	{
 		int16 index;
 		if (lev.read_indexed("index", index, SHRT_MAX+1))
@@ -672,20 +672,20 @@ void parse_levels_xml(InfoTree root)
 		}
 	}
 	
-	BOOST_FOREACH(InfoTree child, root.children_named("end"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("end"))
 	{
 		parse_level_commands(child, LevelScriptHeader::End);
 	}
-	BOOST_FOREACH(InfoTree child, root.children_named("default"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("default"))
 	{
 		parse_level_commands(child, LevelScriptHeader::Default);
 	}
-	BOOST_FOREACH(InfoTree child, root.children_named("restore"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("restore"))
 	{
 		parse_level_commands(child, LevelScriptHeader::Restore);
 	}
 	
-	BOOST_FOREACH(InfoTree child, root.children_named("end_screens"))
+	BOOST_FOREACH(const InfoTree &child, root.children_named("end_screens"))
 	{
 		child.read_attr("index", EndScreenIndex);
 		child.read_indexed("count", NumEndScreens, SHRT_MAX+1);
@@ -56,6 +56,8 @@
 #include "Console.h"
 #include "XML_LevelScript.h"
 #include "InfoTree.h"
+#include "MMLCache.h"
+#include "lua_script.h"
 
 // This will reset all values changed by MML scripts which implement ResetValues() method
 // and are part of the master MarathonParser tree.
@@ -90,72 +92,75 @@ void ResetAllMMLValues()
 	reset_mml_cheats();
 	reset_mml_logging();
 	reset_mml_console();
+	reset_mml_lua();
 	reset_mml_default_levels();
 }
 
 void _ParseAllMML(const InfoTree& fileroot)
 {
-	BOOST_FOREACH(InfoTree root, fileroot.children_named("marathon"))
+	BOOST_FOREACH(const InfoTree &root, fileroot.children_named("marathon"))
 	{
-		BOOST_FOREACH(InfoTree child, root.children_named("stringset"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("stringset"))
 			parse_mml_stringset(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("interface"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("interface"))
 			parse_mml_interface(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("motion_sensor"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("motion_sensor"))
 			parse_mml_motion_sensor(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("overhead_map"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("overhead_map"))
 			parse_mml_overhead_map(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("infravision"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("infravision"))
 			parse_mml_infravision(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("animated_textures"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("animated_textures"))
 			parse_mml_animated_textures(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("control_panels"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("control_panels"))
 			parse_mml_control_panels(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("platforms"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("platforms"))
 			parse_mml_platforms(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("liquids"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("liquids"))
 			parse_mml_liquids(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("sounds"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("sounds"))
 			parse_mml_sounds(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("faders"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("faders"))
 			parse_mml_faders(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("player"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("player"))
 			parse_mml_player(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("view"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("view"))
 			parse_mml_view(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("weapons"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("weapons"))
 			parse_mml_weapons(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("items"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("items"))
 			parse_mml_items(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("damage_kicks"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("damage_kicks"))
 			parse_mml_damage_kicks(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("monsters"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("monsters"))
 			parse_mml_monsters(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("scenery"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("scenery"))
 			parse_mml_scenery(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("landscapes"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("landscapes"))
 			parse_mml_landscapes(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("texture_loading"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("texture_loading"))
 			parse_mml_texture_loading(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("opengl"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("opengl"))
 			parse_mml_opengl(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("software"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("software"))
 			parse_mml_software(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("dynamic_limits"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("dynamic_limits"))
 			parse_mml_dynamic_limits(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("player_name"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("player_name"))
 			parse_mml_player_name(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("scenario"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("scenario"))
 			parse_mml_scenario(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("keyboard"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("keyboard"))
 			parse_mml_keyboard(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("cheats"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("cheats"))
 			parse_mml_cheats(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("logging"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("logging"))
 			parse_mml_logging(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("console"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("console"))
 			parse_mml_console(child);
-		BOOST_FOREACH(InfoTree child, root.children_named("default_levels"))
+		BOOST_FOREACH(const InfoTree &child, root.children_named("lua"))
+			parse_mml_lua(child);
+		BOOST_FOREACH(const InfoTree &child, root.children_named("default_levels"))
 			parse_mml_default_levels(child);
 	}
 }
@@ -164,7 +169,24 @@ bool ParseMMLFromFile(const FileSpecifier& FileSpec)
 {
 	bool parse_error = false;
 	try {
-		InfoTree fileroot = InfoTree::load_xml(FileSpec);
+		InfoTree fileroot;
+		FileSpecifier file = FileSpec;
+		OpenedFile ofile;
+		int32 data_size = 0;
+		std::vector<char> file_data;
+		if (file.Open(ofile) && ofile.GetLength(data_size) && data_size > 0)
+		{
+			file_data.resize(data_size);
+			if (ofile.Read(data_size, &file_data[0]))
+				fileroot = MML_Load_Cached(&file_data[0], file_data.size());
+			else
+				fileroot = InfoTree::load_xml(FileSpec);
+		}
+		else
+		{
+			// for its errors
+			fileroot = InfoTree::load_xml(FileSpec);
+		}
 		_ParseAllMML(fileroot);
 	} catch (InfoTree::parse_error ex) {
 		logError("Error parsing MML file (%s): %s", FileSpec.GetPath(), ex.what());
@@ -186,8 +208,7 @@ bool ParseMMLFromData(const char *buffer, size_t buflen)
 {
 	bool parse_error = false;
 	try {
-		std::istringstream strm(std::string(buffer, buflen));
-		InfoTree fileroot = InfoTree::load_xml(strm);
+		InfoTree fileroot = MML_Load_Cached(buffer, buflen);
 		_ParseAllMML(fileroot);
 	} catch (InfoTree::parse_error ex) {
 		logError("Error parsing MML data: %s", ex.what());
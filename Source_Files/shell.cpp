@@ -51,6 +51,7 @@
 #include "interface_menus.h"
 #include "weapons.h"
 #include "lua_script.h"
+#include "lua_hud_script.h"
 
 #include "Crosshairs.h"
 #include "OGL_Render.h"
@@ -119,9 +120,18 @@
 #include "Logging.h"
 #include "network.h"
 #include "Console.h"
+#include "FrameProfiler.h"
+#include "StartupTasks.h"
+#include "lua_profiler.h"
+#include "Trace.h"
+#include "MemoryAccounting.h"
+#include "sim_benchmark.h"
+#include "render_benchmark.h"
+#include "lua_benchmark.h"
 #include "Movie.h"
 #include "HTTP.h"
 #include "WadImageCache.h"
+#include "ScanCache.h"
 
 // LP addition: whether or not the cheats are active
 // Defined in shell_misc.cpp
@@ -141,6 +151,13 @@ DirectorySpecifier screenshots_dir;   // Directory for screenshots
 DirectorySpecifier log_dir;           // Directory for Aleph One Log.txt
 std::string arg_directory;
 std::vector<std::string> arg_files;
+std::string arg_timedemo;
+bool arg_timedemo_headless = false;
+std::string arg_simbench;
+std::string arg_renderbench;
+std::string arg_luabench;
+std::string arg_export_film;
+std::string arg_export_movie;
 
 // Command-line options
 bool option_nogl = false;             // Disable OpenGL
@@ -149,6 +166,7 @@ bool option_nogamma = false;	      // Disable gamma table effects (menu fades)
 bool option_debug = false;
 bool option_nojoystick = false;
 bool insecure_lua = false;
+static bool option_startup_profile = false; // Print how long each step of startup takes
 static bool force_fullscreen = false; // Force fullscreen mode
 static bool force_windowed = false;   // Force windowed mode
 
@@ -163,8 +181,9 @@ void PlayInterfaceButtonSound(short SoundID);
 extern bool get_default_music_spec(FileSpecifier &file);
 extern bool get_default_theme_spec(FileSpecifier& file);
 
-// From vbl_sdl.cpp
-void execute_timer_tasks(uint32 time);
+// From vbl.cpp; times are SDL_GetPerformanceCounter() counts
+void execute_timer_tasks(uint64_t time);
+uint64_t timer_task_due();
 
 // Prototypes
 static void initialize_application(void);
@@ -195,6 +214,30 @@ static void usage(const char *prg_name)
 	  "\t[-s | --nosound]       Do not access the sound card\n"
 	  "\t[-m | --nogamma]       Disable gamma table effects (menu fades)\n"
           "\t[-j | --nojoystick]    Do not initialize joysticks\n"
+	  "\t[--startup-profile]    Print how long each step of startup takes\n"
+	  "\t[--timedemo film]      Replay a film as fast as possible, log\n"
+	  "\t                       frame and simulation times, and quit\n"
+	  "\t[--simdemo film]       Replay a film as fast as it simulates, with\n"
+	  "\t                       nothing drawn or heard, log tick rate,\n"
+	  "\t                       simulation times and world checksum, and quit\n"
+	  "\t[--simbench spec]      Time the simulation on a generated grid map,\n"
+	  "\t                       log the results, and quit; spec is \"default\"\n"
+	  "\t                       or grid=N,monsters=N,projectiles=N,effects=N,\n"
+	  "\t                       platforms=N,paths=N,floods=N,ticks=N\n"
+	  "\t[--renderbench spec]   Draw a level of the map along a camera path\n"
+	  "\t                       with each renderer, write the times to CSV\n"
+	  "\t                       files, and quit; spec is \"default\" or\n"
+	  "\t                       level=N,width=N,height=N,stops=N,frames=N,\n"
+	  "\t                       warmup=N,renderers=software+opengl+shader\n"
+	  "\t[--luabench spec]      Time Lua workloads through the bindings in each\n"
+	  "\t                       kind of Lua state on the --simbench map, log\n"
+	  "\t                       ns per operation, and quit; spec is \"default\"\n"
+	  "\t                       or grid=N,monsters=N,calls=N,ops=N\n"
+#ifdef HAVE_FFMPEG
+	  "\t[--export-film film movie]\n"
+	  "\t                       Record a film to a movie as fast as it\n"
+	  "\t                       encodes, and quit\n"
+#endif
 	  // Documenting this might be a bad idea?
 	  // "\t[-i | --insecure_lua]  Allow Lua netscripts to take over your computer\n"
 	  "\tdirectory              Directory containing scenario data files\n"
@@ -316,6 +359,62 @@ int main(int argc, char **argv)
 			insecure_lua = true;
 		} else if (strcmp(*argv, "-d") == 0 || strcmp(*argv, "--debug") == 0) {
 		  option_debug = true;
+		} else if (strcmp(*argv, "--startup-profile") == 0) {
+			option_startup_profile = true;
+		} else if (strcmp(*argv, "--timedemo") == 0) {
+			if (argc < 2) {
+				printf("--timedemo needs a film to replay.\n");
+				usage(prg_name);
+			}
+			argc--;
+			argv++;
+			arg_timedemo = *argv;
+		} else if (strcmp(*argv, "--simdemo") == 0) {
+			if (argc < 2) {
+				printf("--simdemo needs a film to replay.\n");
+				usage(prg_name);
+			}
+			argc--;
+			argv++;
+			arg_timedemo = *argv;
+			arg_timedemo_headless = true;
+			option_nosound = true;
+		} else if (strcmp(*argv, "--simbench") == 0) {
+			if (argc < 2) {
+				printf("--simbench needs a spec (or \"default\").\n");
+				usage(prg_name);
+			}
+			argc--;
+			argv++;
+			arg_simbench = *argv;
+			option_nosound = true;
+		} else if (strcmp(*argv, "--renderbench") == 0) {
+			if (argc < 2) {
+				printf("--renderbench needs a spec (or \"default\").\n");
+				usage(prg_name);
+			}
+			argc--;
+			argv++;
+			arg_renderbench = *argv;
+			option_nosound = true;
+		} else if (strcmp(*argv, "--luabench") == 0) {
+			if (argc < 2) {
+				printf("--luabench needs a spec (or \"default\").\n");
+				usage(prg_name);
+			}
+			argc--;
+			argv++;
+			arg_luabench = *argv;
+			option_nosound = true;
+		} else if (strcmp(*argv, "--export-film") == 0) {
+			if (argc < 3) {
+				printf("--export-film needs a film to replay and a movie to write.\n");
+				usage(prg_name);
+			}
+			arg_export_film = argv[1];
+			arg_export_movie = argv[2];
+			argc -= 2;
+			argv += 2;
 		} else if (*argv[0] != '-') {
 			// if it's a directory, make it the default data dir
 			// otherwise push it and handle it later
@@ -349,6 +448,57 @@ int main(int argc, char **argv)
 			}
 		}
 
+		if (!arg_simbench.empty())
+		{
+			sim_benchmark_parameters parameters;
+			if (!parse_sim_benchmark_parameters(arg_simbench.c_str(), parameters))
+			{
+				logError("simbench: could not read %s", arg_simbench.c_str());
+				exit(1);
+			}
+			exit(run_sim_benchmark(parameters) ? 0 : 1);
+		}
+		else if (!arg_renderbench.empty())
+		{
+			render_benchmark_parameters parameters;
+			if (!parse_render_benchmark_parameters(arg_renderbench.c_str(), parameters))
+			{
+				logError("renderbench: could not read %s", arg_renderbench.c_str());
+				exit(1);
+			}
+			exit(run_render_benchmark(parameters) ? 0 : 1);
+		}
+		else if (!arg_luabench.empty())
+		{
+			lua_benchmark_parameters parameters;
+			if (!parse_lua_benchmark_parameters(arg_luabench.c_str(), parameters))
+			{
+				logError("luabench: could not read %s", arg_luabench.c_str());
+				exit(1);
+			}
+			exit(run_lua_benchmark(parameters) ? 0 : 1);
+		}
+		else if (!arg_timedemo.empty())
+		{
+			FileSpecifier film(arg_timedemo);
+			start_timedemo(arg_timedemo_headless);
+			if (!handle_open_replay(film))
+			{
+				logError("timedemo: could not replay %s", arg_timedemo.c_str());
+				exit(1);
+			}
+		}
+		else if (!arg_export_film.empty())
+		{
+			FileSpecifier film(arg_export_film);
+			Movie::instance()->StartBatchExport(arg_export_movie);
+			if (!handle_open_replay(film))
+			{
+				logError("export: could not replay %s", arg_export_film.c_str());
+				exit(1);
+			}
+		}
+
 		// Run the main loop
 		main_event_loop();
 
@@ -380,7 +530,12 @@ static int char_is_not_filesafe(int c)
     return (c != ' ' && !std::isalnum(c));
 }
 
-static void initialize_application(void)
+// Where the search path gets the directory a scenario is chosen from, if
+// the default files can't be found
+static size_t dsp_insert_pos;
+static size_t dsp_delete_pos;
+
+static void initialize_sdl(void)
 {
 #if defined(__WIN32__) && defined(__MINGW32__)
 	if (LoadLibrary("exchndl.dll")) option_debug = true;
@@ -407,7 +562,23 @@ static void initialize_application(void)
 #endif
 	// We only want text input events at specific times
 	SDL_StopTextInput();
+}
 
+static void initialize_network_libraries(void)
+{
+#if !defined(DISABLE_NETWORKING)
+	// Initialize SDL_net
+	if (SDLNet_Init () < 0) {
+		fprintf (stderr, "Couldn't initialize SDL_net (%s)\n", SDLNet_GetError());
+		exit(1);
+	}
+#endif
+
+	HTTPClient::Init();
+}
+
+static void find_data_directories(void)
+{
 	// Find data directories, construct search path
 	InitDefaultStringSets();
 
@@ -431,8 +602,8 @@ static void initialize_application(void)
 	}
 	
 	// in case we need to redo search path later:
-	size_t dsp_insert_pos = data_search_path.size();
-	size_t dsp_delete_pos = (size_t)-1;
+	dsp_insert_pos = data_search_path.size();
+	dsp_delete_pos = (size_t)-1;
 	
 	if (arg_directory != "")
 	{
@@ -473,6 +644,10 @@ static void initialize_application(void)
 	initialize_resources();
 
 	init_physics_wad_data();
+}
+
+static void load_base_mml(void)
+{
 	initialize_fonts(false);
 
 	load_film_profile(FILM_PROFILE_DEFAULT, false);
@@ -505,15 +680,31 @@ static void initialize_application(void)
 	}
 
 	initialize_fonts(true);
+}
+
+static void enumerate_plugins(void)
+{
 	Plugins::instance()->enumerate();			
-	
+}
+
+static void load_preferences(void)
+{
 	preferences_dir.CreateDirectory();
 	if (!get_data_path(kPathLegacyPreferences).empty())
 		transition_preferences(DirectorySpecifier(get_data_path(kPathLegacyPreferences)));
 
 	// Load preferences
 	initialize_preferences();
+	FrameProfiler::instance()->RegisterCommands();
+#ifdef HAVE_LUA
+	LuaProfiler::instance()->RegisterCommands();
+	Tracer::RegisterCommands();
+	MemoryAccounting::RegisterCommands();
+#endif
+}
 
+static void create_data_directories(void)
+{
 	local_data_dir.CreateDirectory();
 	saved_games_dir.CreateDirectory();
 	quick_saves_dir.CreateDirectory();
@@ -529,9 +720,15 @@ static void initialize_application(void)
 	image_cache_dir.CreateDirectory();
 	recordings_dir.CreateDirectory();
 	screenshots_dir.CreateDirectory();
-	
+}
+
+static void load_image_cache(void)
+{
 	WadImageCache::instance()->initialize_cache();
+}
 
+static void apply_command_line_preferences(void)
+{
 #ifndef HAVE_OPENGL
 	graphics_preferences->screen_mode.acceleration = _no_acceleration;
 #endif
@@ -549,41 +746,79 @@ static void initialize_application(void)
 // 	SDL_WM_SetIcon(IMG_ReadXPMFromArray(const_cast<char**>(alephone_xpm)), 0);
 // #endif
 	atexit(shutdown_application);
+}
 
-#if !defined(DISABLE_NETWORKING)
-	// Initialize SDL_net
-	if (SDLNet_Init () < 0) {
-		fprintf (stderr, "Couldn't initialize SDL_net (%s)\n", SDLNet_GetError());
-		exit(1);
-	}
-#endif
-
+// After MML, which opens no fonts until now as it always has
+static void initialize_ttf(void)
+{
 	if (TTF_Init() < 0) {
 		fprintf (stderr, "Couldn't initialize SDL_ttf (%s)\n", TTF_GetError());
 		exit(1);
 	}
-	HTTPClient::Init();
+}
 
-	// Initialize everything
+static void initialize_sound(void)
+{
 	mytm_initialize();
 //	initialize_fonts();
 	SoundManager::instance()->Initialize(*sound_preferences);
 	initialize_marathon_music_handler();
+}
+
+static void initialize_input(void)
+{
 	initialize_keyboard_controller();
 	initialize_joystick();
 	initialize_gamma();
+}
+
+static void initialize_screen(void)
+{
 	alephone::Screen::instance()->Initialize(&graphics_preferences->screen_mode);
 	initialize_marathon();
 	initialize_screen_drawing();
 	initialize_dialogs();
 	initialize_terminal_manager();
+}
+
+static void initialize_shapes(void)
+{
 	initialize_shape_handler();
 	initialize_fades();
 	initialize_images_manager();
+}
+
+static void initialize_environment(void)
+{
 	load_environment_from_preferences();
 	initialize_game_state();
 }
 
+// Most steps touch the window, put up dialogs or go through state that
+// MML and the preferences change, so they stay on the main thread, in their
+// old order; setting up SDL_net and libcurl and reading the image cache's
+// index don't, and go on beside them
+static void initialize_application(void)
+{
+	StartupTasks tasks;
+	int sdl = tasks.Add("sdl", initialize_sdl, StartupTasks::_main_thread);
+	int libraries = tasks.Add("network libraries", initialize_network_libraries, StartupTasks::_any_thread, sdl);
+	tasks.Add("data directories", find_data_directories, StartupTasks::_main_thread);
+	tasks.Add("mml", load_base_mml, StartupTasks::_main_thread);
+	tasks.Add("plugins", enumerate_plugins, StartupTasks::_main_thread);
+	tasks.Add("preferences", load_preferences, StartupTasks::_main_thread);
+	int directories = tasks.Add("create directories", create_data_directories, StartupTasks::_main_thread);
+	int image_cache = tasks.Add("image cache", load_image_cache, StartupTasks::_any_thread, directories);
+	tasks.Add("plugin mml", apply_command_line_preferences, StartupTasks::_main_thread);
+	tasks.Add("sdl_ttf", initialize_ttf, StartupTasks::_main_thread);
+	tasks.Add("sound", initialize_sound, StartupTasks::_main_thread, libraries);
+	tasks.Add("input", initialize_input, StartupTasks::_main_thread);
+	tasks.Add("screen", initialize_screen, StartupTasks::_main_thread);
+	tasks.Add("shapes", initialize_shapes, StartupTasks::_main_thread);
+	tasks.Add("environment", initialize_environment, StartupTasks::_main_thread, image_cache);
+	tasks.Run(option_startup_profile);
+}
+
 void shutdown_application(void)
 {
         // ZZZ: seem to be having weird recursive shutdown problems esp. with fullscreen modes...
@@ -593,7 +828,12 @@ void shutdown_application(void)
 
         already_shutting_down = true;
         
+	cancel_level_preload();
+	finish_saving_game(false);
+	finish_writing_preferences();
+	WadImageCache::instance()->finish_loads();
 	WadImageCache::instance()->save_cache();
+	ScanCache::instance()->Save();
 	close_external_resources();
         
 #if defined(HAVE_SDL_IMAGE) && (SDL_IMAGE_PATCHLEVEL >= 8)
@@ -718,9 +958,14 @@ const uint32 TICKS_BETWEEN_EVENT_POLL = 16; // 60 Hz
 static void main_event_loop(void)
 {
 	uint32 last_event_poll = 0;
+	uint64_t last_frame_counts = 0;
 	short game_state;
 
 	while ((game_state = get_game_state()) != _quit_game) {
+		Tracer::NameThread("main");
+		TRACE_SPAN("main loop");
+		if (game_state == _game_in_progress)
+			MemoryAccounting::Idle();
 		uint32 cur_time = SDL_GetTicks();
 		bool yield_time = false;
 		bool poll_event = false;
@@ -783,12 +1028,37 @@ static void main_event_loop(void)
 			}
 		}
 
-		execute_timer_tasks(SDL_GetTicks());
+		uint64_t frame_started = SDL_GetPerformanceCounter();
+		execute_timer_tasks(frame_started);
 		idle_game_state(SDL_GetTicks());
+		last_frame_counts = SDL_GetPerformanceCounter() - frame_started;
 
-		if (game_state == _game_in_progress && !graphics_preferences->hog_the_cpu && (TICKS_PER_SECOND - (SDL_GetTicks() - cur_time)) > 10)
+		if (game_state == _game_in_progress && !graphics_preferences->hog_the_cpu && !timedemo_active() && !Movie::instance()->IsBatchExport() && !replay_seek_active())
 		{
-			SDL_Delay(1);
+			// Local games go at the heartbeat's pace; netgames at the
+			// network's, which the heartbeat isn't in step with
+			uint64_t now = SDL_GetPerformanceCounter();
+			uint64_t due = timer_task_due();
+			if (!game_is_networked && !graphics_preferences->interpolate_world)
+			{
+				// Nothing new is drawn until the next tick, so wait for it;
+				// the input it reads is then as fresh as it can be
+				L_Step_HUDGarbageCollector();
+				wait_for_performance_count(due);
+			}
+			else if (!game_is_networked && graphics_preferences->late_input && now < due && due - now < last_frame_counts)
+			{
+				// A frame begun now would be finished after the tick is
+				// due, showing input from the tick before; wait, and draw
+				// the tick instead
+				L_Step_HUDGarbageCollector();
+				wait_for_performance_count(due);
+			}
+			else if ((TICKS_PER_SECOND - (SDL_GetTicks() - cur_time)) > 10)
+			{
+				L_Step_HUDGarbageCollector();
+				SDL_Delay(1);
+			}
 		}
 	}
 }
@@ -820,6 +1090,9 @@ static void process_screen_click(const SDL_Event &event)
 	portable_process_screen_click(x, y, has_cheat_modifiers());
 }
 
+// How far Shift with the replay speed keys seeks in a film
+const int32 REPLAY_SEEK_STEP = 10 * TICKS_PER_SECOND;
+
 static void handle_game_key(const SDL_Event &event)
 {
 	SDL_Keycode key = event.key.keysym.sym;
@@ -968,7 +1241,9 @@ static void handle_game_key(const SDL_Event &event)
 			if (player_controlling_game()) {
 				PlayInterfaceButtonSound(Sound_ButtonSuccess());
 				scroll_inventory(-1);
-			} else
+			} else if (SDL_GetModState() & KMOD_SHIFT)
+				seek_replay(get_replay_position() - REPLAY_SEEK_STEP);
+			else
 				decrement_replay_speed();
 		}
 		else if (input_preferences->shell_key_bindings[_key_inventory_right].count(sc))
@@ -976,7 +1251,9 @@ static void handle_game_key(const SDL_Event &event)
 			if (player_controlling_game()) {
 				PlayInterfaceButtonSound(Sound_ButtonSuccess());
 				scroll_inventory(1);
-			} else
+			} else if (SDL_GetModState() & KMOD_SHIFT)
+				seek_replay(get_replay_position() + REPLAY_SEEK_STEP);
+			else
 				increment_replay_speed();
 		}
 		else if (input_preferences->shell_key_bindings[_key_toggle_fps].count(sc))
@@ -1318,7 +1595,7 @@ static void process_event(const SDL_Event &event)
 	case SDL_MOUSEMOTION:
 		if (get_game_state() == _game_in_progress)
 		{
-			mouse_moved(event.motion.xrel, event.motion.yrel);
+			mouse_moved(event.motion.xrel, event.motion.yrel, event.motion.timestamp);
 		}
 		break;
 	case SDL_MOUSEWHEEL:
@@ -1401,7 +1678,7 @@ static void process_event(const SDL_Event &event)
 	case SDL_WINDOWEVENT:
 		switch (event.window.event) {
 			case SDL_WINDOWEVENT_FOCUS_LOST:
-				if (get_game_state() == _game_in_progress && get_keyboard_controller_status() && !Movie::instance()->IsRecording()) {
+				if (get_game_state() == _game_in_progress && get_keyboard_controller_status() && !Movie::instance()->IsRecording() && !timedemo_active()) {
 					darken_world_window();
 					set_keyboard_controller_status(false);
 					show_cursor();
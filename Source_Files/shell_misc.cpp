@@ -46,6 +46,7 @@ bool chat_input_mode = false;
 #include "network_sound.h"
 #include "TextStrings.h"
 #include "InfoTree.h"
+#include "game_wad.h"
 
 #include <ctype.h>
 
@@ -302,6 +303,7 @@ void global_idle_proc(void)
 	network_speaker_idle_proc();
 	network_microphone_idle_proc();
 	SoundManager::instance()->Idle();
+	saving_game_idle_proc();
 }
 
 /*
@@ -396,7 +398,7 @@ void parse_mml_cheats(const InfoTree& root)
 	
 	root.read_attr("on", CheatsActive);
 	
-	BOOST_FOREACH(InfoTree ktree, root.children_named("keyword"))
+	BOOST_FOREACH(const InfoTree &ktree, root.children_named("keyword"))
 	{
 		int16 index;
 		if (!ktree.read_indexed("index", index, NUMBER_OF_KEYWORDS))